@@ -0,0 +1,241 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+#include "bench/layoutgolden.h"
+#include "core/batchconvert.h"
+#include "import/import.h"
+
+#include "layout/drawablecontext.h"
+#include "layout/drawablemuselement.h"
+#include "layout/sheetlayout.h"
+#include "layout/sheetrenderer.h"
+#include "score/document.h"
+#include "score/sheet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+const double CALayoutGolden::MIN_TIMED_LAYOUT = 5.0; // ms, faster layouts are too noisy to compare
+
+namespace {
+
+const QString header = "# Canorus layout golden 1";
+
+QString drawableLine(char kind, int type, CADrawable* d)
+{
+    return QString("%1 %2 %3 %4 %5 %6").arg(kind).arg(type).arg(d->xPos(), 0, 'f', 2).arg(d->yPos(), 0, 'f', 2).arg(d->width(), 0, 'f', 2).arg(d->height(), 0, 'f', 2);
+}
+
+}
+
+/*!
+	\class CALayoutGolden
+	\brief Layout regression checks of the example scores
+
+	Lays out each sheet of the given documents and compares the positions and sizes of the drawable
+	elements and contexts to the golden files stored in the golden directory, one golden file per
+	document. The positions may differ by the given tolerance. The layout time is compared to the
+	time stored in the golden file and the check fails, if it is slower by more than the given
+	percent. Layouts faster than MIN_TIMED_LAYOUT are not timed.
+
+	The golden files are written instead of compared when updating. They should be updated on the
+	same machine the checks are run on, when the layout changes on purpose:
+	\code
+	  canorus-bench --golden=golden --update-golden tests/*.xml ../examples/*.can
+	  canorus-bench --golden=golden --tolerance=0.5 --max-slowdown=25 tests/*.xml ../examples/*.can
+	\endcode
+*/
+
+CALayoutGolden::CALayoutGolden(const QString& goldenDir)
+    : _goldenDir(goldenDir)
+    , _tolerance(0.5)
+    , _maxSlowdown(50)
+    , _iterations(5)
+    , _update(false)
+{
+}
+
+/*!
+	Checks or updates all the \a fileNames. Returns the number of the failed files.
+*/
+int CALayoutGolden::check(const QStringList& fileNames)
+{
+    if (_update) {
+        QDir().mkpath(_goldenDir);
+    }
+
+    int failed = 0;
+    for (const QString& fileName : fileNames) {
+        if (!checkFile(fileName)) {
+            failed++;
+        }
+    }
+
+    fprintf(stderr, "%d of %d files %s\n", fileNames.size() - failed, fileNames.size(), _update ? "updated" : "passed");
+    return failed;
+}
+
+/*!
+	Lays out the document \a fileName and compares it to its golden file or writes the golden file,
+	if updating. Returns True on success.
+*/
+bool CALayoutGolden::checkFile(const QString& fileName)
+{
+    CAImport* import = CABatchConvert::createImport(fileName);
+    if (!import) {
+        fprintf(stderr, "%s: Unknown file format\n", qPrintable(fileName));
+        return false;
+    }
+
+    import->setStreamFromFile(fileName);
+    import->importDocument();
+    import->wait();
+    CADocument* doc = import->importedDocument();
+    if (import->status() < 0 || !doc) {
+        fprintf(stderr, "%s: %s\n", qPrintable(fileName), qPrintable(import->readableStatus()));
+        delete import;
+        delete doc;
+        return false;
+    }
+    delete import;
+
+    QStringList current;
+    double time = 0;
+    for (int i = 0; i < doc->sheetList().size(); i++) {
+        double sheetTime = 0;
+        QStringList drawables = layoutSheet(doc->sheetList()[i], &sheetTime);
+        current << QString("sheet %1 %2").arg(i).arg(drawables.size()) << drawables;
+        time += sheetTime;
+    }
+    delete doc;
+
+    QFile golden(goldenFileName(fileName));
+    if (_update) {
+        if (!golden.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            fprintf(stderr, "%s: Cannot write %s\n", qPrintable(fileName), qPrintable(golden.fileName()));
+            return false;
+        }
+
+        QTextStream out(&golden);
+        out << header << "\n"
+            << "time " << QString::number(time, 'f', 2) << "\n"
+            << current.join("\n") << "\n";
+        fprintf(stderr, "%s: %.2f ms\n", qPrintable(fileName), time);
+        return true;
+    }
+
+    if (!golden.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        fprintf(stderr, "%s: No golden file %s\n", qPrintable(fileName), qPrintable(golden.fileName()));
+        return false;
+    }
+
+    QTextStream in(&golden);
+    if (in.readLine() != header) {
+        fprintf(stderr, "%s: %s is not a layout golden file\n", qPrintable(fileName), qPrintable(golden.fileName()));
+        return false;
+    }
+
+    double goldenTime = in.readLine().section(' ', 1).toDouble();
+    QStringList expected;
+    while (!in.atEnd()) {
+        expected << in.readLine();
+    }
+
+    return compare(fileName, expected, current, goldenTime, time);
+}
+
+/*!
+	Lays out the \a sheet the given number of iterations and returns its drawables sorted by their
+	position, one per line. The median layout time in miliseconds is stored to \a time.
+*/
+QStringList CALayoutGolden::layoutSheet(CASheet* sheet, double* time)
+{
+    CASheetRenderer renderer(sheet);
+    QList<double> times;
+    for (int i = 0; i < std::max(_iterations, 1); i++) {
+        renderer.layout();
+        times << renderer.layoutTime() / 1e6;
+    }
+    std::sort(times.begin(), times.end());
+    *time = times[times.size() / 2];
+
+    QList<CADrawableMusElement*> elements = renderer.sheetLayout()->drawableMList().list();
+    QList<CADrawableContext*> contexts = renderer.sheetLayout()->drawableCList().list();
+    QStringList lines;
+    for (CADrawableContext* c : contexts) {
+        lines << drawableLine('c', c->drawableContextType(), c);
+    }
+    for (CADrawableMusElement* e : elements) {
+        lines << drawableLine('m', e->drawableMusElementType(), e);
+    }
+
+    // sort by the position, the order of the drawables at the same position doesn't matter
+    std::sort(lines.begin(), lines.end(), [](const QString& a, const QString& b) {
+        QStringList fa = a.split(' ');
+        QStringList fb = b.split(' ');
+        for (int i : { 2, 3, 0, 1, 4, 5 }) {
+            if (fa[i] != fb[i]) {
+                return (i >= 2) ? fa[i].toDouble() < fb[i].toDouble() : fa[i] < fb[i];
+            }
+        }
+        return false;
+    });
+
+    return lines;
+}
+
+/*!
+	Compares the \a current drawables to the \a golden ones and the layout \a time to the
+	\a goldenTime. Prints the first difference of each file. Returns True, if they match.
+*/
+bool CALayoutGolden::compare(const QString& fileName, const QStringList& golden, const QStringList& current, double goldenTime, double time)
+{
+    bool ok = true;
+    if (golden.size() != current.size()) {
+        fprintf(stderr, "%s: %d drawables instead of %d\n", qPrintable(fileName), current.size(), golden.size());
+        ok = false;
+    }
+
+    for (int i = 0; ok && i < golden.size(); i++) {
+        QStringList g = golden[i].split(' ');
+        QStringList c = current[i].split(' ');
+        bool same = (g.size() == c.size() && g.size() >= 2 && g[0] == c[0] && g[1] == c[1]);
+        for (int j = 2; same && j < g.size(); j++) {
+            same = (g[0] == "sheet") ? g[j] == c[j] : std::fabs(g[j].toDouble() - c[j].toDouble()) <= _tolerance;
+        }
+
+        if (!same) {
+            fprintf(stderr, "%s: \"%s\" instead of \"%s\"\n", qPrintable(fileName), qPrintable(current[i]), qPrintable(golden[i]));
+            ok = false;
+        }
+    }
+
+    if (goldenTime >= MIN_TIMED_LAYOUT && time > goldenTime * (100 + _maxSlowdown) / 100) {
+        fprintf(stderr, "%s: Layout took %.2f ms instead of %.2f ms\n", qPrintable(fileName), time, goldenTime);
+        ok = false;
+    } else if (ok) {
+        fprintf(stderr, "%s: OK, %.2f ms (golden %.2f ms)\n", qPrintable(fileName), time, goldenTime);
+    }
+
+    return ok;
+}
+
+/*!
+	Returns the golden file of the document \a fileName. The name of its directory is included, so
+	the documents of the same name in different directories don't clash.
+*/
+const QString CALayoutGolden::goldenFileName(const QString& fileName)
+{
+    QFileInfo info(fileName);
+    return QDir(_goldenDir).filePath(info.absoluteDir().dirName() + "-" + info.completeBaseName() + ".golden");
+}
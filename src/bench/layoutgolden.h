@@ -0,0 +1,49 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef LAYOUTGOLDEN_H_
+#define LAYOUTGOLDEN_H_
+
+#include <QString>
+#include <QStringList>
+
+class CASheet;
+
+class CALayoutGolden {
+public:
+    CALayoutGolden(const QString& goldenDir);
+
+    inline double tolerance() { return _tolerance; }
+    inline void setTolerance(double tolerance) { _tolerance = tolerance; }
+
+    inline int maxSlowdown() { return _maxSlowdown; }
+    inline void setMaxSlowdown(int percent) { _maxSlowdown = percent; }
+
+    inline int iterations() { return _iterations; }
+    inline void setIterations(int iterations) { _iterations = iterations; }
+
+    inline bool isUpdating() { return _update; }
+    inline void setUpdating(bool update) { _update = update; }
+
+    int check(const QStringList& fileNames);
+    bool checkFile(const QString& fileName);
+
+    static const double MIN_TIMED_LAYOUT;
+
+private:
+    QStringList layoutSheet(CASheet* sheet, double* time);
+    bool compare(const QString& fileName, const QStringList& golden, const QStringList& current, double goldenTime, double time);
+    const QString goldenFileName(const QString& fileName);
+
+    QString _goldenDir;
+    double _tolerance; // in score units
+    int _maxSlowdown; // in percent of the golden layout time
+    int _iterations; // layouts timed per sheet, the median is used
+    bool _update; // write the golden files instead of comparing
+};
+
+#endif /* LAYOUTGOLDEN_H_ */
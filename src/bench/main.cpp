@@ -0,0 +1,384 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+/*!
+	Benchmark suite of the Canorus hot paths.
+
+	Generates a synthetic score (see CAScoreGenerator) and measures the layout, undo, CanorusML,
+	LilyPond, MusicXML and MIDI code paths on it. The results are printed to the standard output
+	as JSON or written to the file given by --output, so they can be compared between builds:
+	\code
+	  canorus-bench --staffs=8 --voices=2 --bars=200 --marks=4 --lyrics --iterations=5 --output=bench.json
+	\endcode
+
+	The layout and the sheet exports are measured on the first sheet. With --generate, the score is
+	only saved to the given CanorusML file for the stress tests and nothing is measured:
+	\code
+	  canorus-bench --sheets=4 --staffs=30 --voices=2 --bars=2000 --chords=3 --tuplets=7 --slurs=5 --figured-bass=2 --generate=huge.xml
+	\endcode
+
+	With --golden, the given documents are laid out and compared to the golden files instead (see
+	CALayoutGolden). The exit code is 1, if any of them fails.
+*/
+
+#include <QApplication>
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QTemporaryFile>
+#include <QTextStream>
+
+#include "bench/layoutgolden.h"
+#include "canorus.h"
+#include "core/scoregenerator.h"
+#include "core/undo.h"
+
+#include "export/canorusmlexport.h"
+#include "export/lilypondexport.h"
+#include "export/midiexport.h"
+#include "export/musicxmlexport.h"
+#include "import/canorusmlimport.h"
+#include "import/midiimport.h"
+#include "import/musicxmlimport.h"
+#include "layout/sheetrenderer.h"
+
+#include "score/document.h"
+#include "score/sheet.h"
+#include "score/staff.h"
+#include "widgets/scoreview.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+
+namespace {
+
+const int undoSteps = 20; // undo commands pushed in each iteration of the undo benchmarks
+
+int iterations = 5;
+QJsonArray results;
+
+/*!
+	Calls \a run the given number of iterations and stores the minimum, mean and median time.
+	\a setup and \a cleanup are called before and after each run and are not measured.
+*/
+void measure(const QString& name, std::function<void()> run, std::function<void()> setup = nullptr, std::function<void()> cleanup = nullptr)
+{
+    QList<double> times;
+    for (int i = 0; i < iterations; i++) {
+        if (setup)
+            setup();
+
+        QElapsedTimer timer;
+        timer.start();
+        run();
+        times << timer.nsecsElapsed() / 1e6;
+
+        if (cleanup)
+            cleanup();
+    }
+
+    std::sort(times.begin(), times.end());
+    double sum = 0;
+    for (double t : times) {
+        sum += t;
+    }
+
+    QJsonObject result;
+    result["name"] = name;
+    result["min"] = times.first();
+    result["mean"] = sum / times.size();
+    result["median"] = (times.size() % 2) ? times[times.size() / 2] : (times[times.size() / 2 - 1] + times[times.size() / 2]) / 2;
+    results << result;
+
+    fprintf(stderr, "%-24s %10.2f ms\n", qPrintable(name), result["median"].toDouble());
+}
+
+void printUsage()
+{
+    fprintf(stderr, "Usage: canorus-bench [--sheets=<n>] [--staffs=<n>] [--voices=<n>] [--bars=<n>] [--chords=<every n-th beat>] [--tuplets=<every n-th beat>] [--slurs=<every n-th beat>] [--marks=<every n-th beat>] [--figured-bass=<every n-th beat>] [--lyrics] [--iterations=<n>] [--output=<file>] [--generate=<file>]\n"
+                    "       canorus-bench --golden=<dir> [--update-golden] [--tolerance=<score units>] [--max-slowdown=<percent>] [--iterations=<n>] <files>\n");
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen"); // no windows are shown
+    }
+
+    QApplication app(argc, argv);
+    CAScoreGenerator generator;
+    QString outputFileName;
+    QString generateFileName;
+    QString goldenDir;
+    bool updateGolden = false;
+    double tolerance = 0.5;
+    int maxSlowdown = 50;
+    QStringList goldenFiles;
+
+    QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); i++) {
+        QString arg = args[i].section('=', 0, 0);
+        QString value = args[i].section('=', 1);
+        bool ok = true;
+
+        if (arg == "--sheets") {
+            generator.setSheetCount(value.toInt(&ok));
+        } else if (arg == "--staffs") {
+            generator.setStaffCount(value.toInt(&ok));
+        } else if (arg == "--voices") {
+            generator.setVoiceCount(value.toInt(&ok));
+        } else if (arg == "--bars") {
+            generator.setBarCount(value.toInt(&ok));
+        } else if (arg == "--chords") {
+            generator.setChordsEvery(value.toInt(&ok));
+        } else if (arg == "--tuplets") {
+            generator.setTupletsEvery(value.toInt(&ok));
+        } else if (arg == "--slurs") {
+            generator.setSlursEvery(value.toInt(&ok));
+        } else if (arg == "--marks") {
+            generator.setMarksEvery(value.toInt(&ok));
+        } else if (arg == "--figured-bass") {
+            generator.setFiguredBassEvery(value.toInt(&ok));
+        } else if (arg == "--lyrics") {
+            generator.setLyrics(true);
+        } else if (arg == "--iterations") {
+            iterations = value.toInt(&ok);
+        } else if (arg == "--output") {
+            outputFileName = value;
+        } else if (arg == "--golden") {
+            goldenDir = value;
+            ok = !value.isEmpty();
+        } else if (arg == "--update-golden") {
+            updateGolden = true;
+        } else if (arg == "--tolerance") {
+            tolerance = value.toDouble(&ok);
+        } else if (arg == "--max-slowdown") {
+            maxSlowdown = value.toInt(&ok);
+        } else if (!arg.startsWith('-')) {
+            goldenFiles << args[i];
+        } else if (arg == "--generate") {
+            generateFileName = value;
+            ok = !value.isEmpty();
+        } else {
+            ok = false;
+        }
+
+        if (!ok || generator.sheetCount() < 1 || generator.staffCount() < 1 || generator.voiceCount() < 1 || generator.barCount() < 1 || iterations < 1) {
+            printUsage();
+            return 1;
+        }
+    }
+
+    CACanorus::initSearchPaths();
+    CACanorus::initMain();
+    CACanorus::initSettings();
+    CACanorus::initUndo(); // undo commands need it when deleted
+
+    if (!goldenDir.isEmpty()) {
+        CALayoutGolden golden(goldenDir);
+        golden.setUpdating(updateGolden);
+        golden.setTolerance(tolerance);
+        golden.setMaxSlowdown(maxSlowdown);
+        golden.setIterations(iterations);
+        return golden.check(goldenFiles) ? 1 : 0;
+    }
+
+    if (!generateFileName.isEmpty()) {
+        CADocument* doc = generator.generate();
+        CACanorusMLExport exporter;
+        exporter.setStreamToFile(generateFileName);
+        exporter.exportDocument(doc, false);
+        delete doc;
+
+        if (exporter.status() < 0) {
+            fprintf(stderr, "Cannot write the score to %s: %s\n", qPrintable(generateFileName), qPrintable(exporter.readableStatus()));
+            return 1;
+        }
+        fprintf(stderr, "%d notes written to %s\n", generator.noteCount(), qPrintable(generateFileName));
+        return 0;
+    }
+
+    CADocument* doc = nullptr;
+    measure("generate", [&]() { delete doc; doc = generator.generate(); });
+    CASheet* sheet = doc->sheetList()[0];
+
+    // Layout
+    CAScoreView* view = new CAScoreView(sheet);
+    measure("layout", [&]() { view->rebuild(); });
+    delete view;
+
+    // Rendering without a window, a full HD screen and a thumbnail
+    CASheetRenderer renderer(sheet);
+    measure("complete layout", [&]() { renderer.layout(); });
+    measure("render", [&]() { renderer.render(QRectF(0, 0, 1920, 1080), 1.0); });
+    measure("thumbnail", [&]() { renderer.thumbnail(QSize(400, 300)); });
+
+    // Undo
+    CADocument* undoDoc = nullptr;
+    auto createUndoDoc = [&]() { undoDoc = doc->clone(); CACanorus::undo()->createUndoStack(undoDoc); };
+    measure(
+        "undo document clone", [&]() {
+            for (int i = 0; i < undoSteps; i++) {
+                CACanorus::undo()->createUndoCommand(undoDoc, "bench");
+                CACanorus::undo()->pushUndoCommand();
+            }
+        },
+        createUndoDoc, [&]() { CACanorus::undo()->deleteUndoStack(undoDoc); }); // also deletes the document
+
+    measure(
+        "undo staff clone", [&]() {
+            CAStaff* staff = undoDoc->sheetList()[0]->staffList()[0];
+            for (int i = 0; i < undoSteps; i++) {
+                CACanorus::undo()->createUndoCommand(undoDoc, "bench", staff);
+                CACanorus::undo()->pushUndoCommand();
+            }
+        },
+        createUndoDoc, [&]() { CACanorus::undo()->deleteUndoStack(undoDoc); delete undoDoc; });
+
+    measure(
+        "undo redo", [&]() {
+            for (int i = 0; i < undoSteps; i++) {
+                CACanorus::undo()->undo(undoDoc);
+            }
+            for (int i = 0; i < undoSteps; i++) {
+                CACanorus::undo()->redo(undoDoc);
+            }
+        },
+        [&]() {
+            createUndoDoc();
+            for (int i = 0; i < undoSteps; i++) {
+                CACanorus::undo()->createUndoCommand(undoDoc, "bench");
+                CACanorus::undo()->pushUndoCommand();
+            }
+        },
+        [&]() { CACanorus::undo()->deleteUndoStack(undoDoc); });
+
+    // CanorusML
+    QString canorusML;
+    measure("canorusml export", [&]() {
+        canorusML.clear();
+        QTextStream stream(&canorusML);
+        CACanorusMLExport exporter(&stream);
+        exporter.exportDocument(doc, false);
+    });
+
+    measure("canorusml import", [&]() {
+        CACanorusMLImport importer(canorusML);
+        importer.importDocument();
+        importer.wait();
+        delete importer.importedDocument();
+    });
+
+    QBuffer binaryML;
+    measure("canorusml binary export", [&]() {
+        binaryML.close();
+        binaryML.setData(QByteArray());
+        binaryML.open(QIODevice::WriteOnly);
+        QTextStream stream(&binaryML);
+        CACanorusMLExport exporter(&stream);
+        exporter.setBinary(true);
+        exporter.exportDocument(doc, false);
+    });
+
+    measure("canorusml binary import", [&]() {
+        QBuffer buffer;
+        buffer.setData(binaryML.data());
+        buffer.open(QIODevice::ReadOnly);
+        QTextStream stream(&buffer);
+        CACanorusMLImport importer(&stream);
+        importer.importDocument();
+        importer.wait();
+        delete importer.importedDocument();
+    });
+
+    // LilyPond
+    measure("lilypond export", [&]() {
+        QString out;
+        QTextStream stream(&out);
+        CALilyPondExport exporter(&stream);
+        exporter.exportSheet(sheet);
+        exporter.wait();
+    });
+
+    // MusicXML
+    QString musicXml;
+    measure("musicxml export", [&]() {
+        musicXml.clear();
+        QTextStream stream(&musicXml);
+        CAMusicXmlExport exporter(&stream);
+        exporter.exportSheet(sheet);
+        exporter.wait();
+    });
+
+    measure("musicxml import", [&]() {
+        CAMusicXmlImport importer(musicXml);
+        importer.importDocument();
+        importer.wait();
+        delete importer.importedDocument();
+    });
+
+    // MIDI
+    QTemporaryFile midiFile;
+    measure("midi export", [&]() {
+        midiFile.close();
+        midiFile.open();
+        midiFile.resize(0);
+        QTextStream stream(&midiFile);
+        CAMidiExport exporter(&stream);
+        exporter.exportDocument(doc, false);
+        stream.flush();
+    });
+    midiFile.close();
+
+    measure("midi import", [&]() {
+        CAMidiImport importer;
+        importer.setStreamFromFile(midiFile.fileName());
+        importer.importDocument();
+        importer.wait();
+        delete importer.importedDocument();
+    });
+
+    delete doc;
+
+    QJsonObject params;
+    params["sheets"] = generator.sheetCount();
+    params["staffs"] = generator.staffCount();
+    params["voices"] = generator.voiceCount();
+    params["bars"] = generator.barCount();
+    params["chords"] = generator.chordsEvery();
+    params["tuplets"] = generator.tupletsEvery();
+    params["slurs"] = generator.slursEvery();
+    params["marks"] = generator.marksEvery();
+    params["figuredBass"] = generator.figuredBassEvery();
+    params["lyrics"] = generator.hasLyrics();
+    params["iterations"] = iterations;
+
+    QJsonObject json;
+    json["version"] = CANORUS_VERSION;
+    json["parameters"] = params;
+    json["results"] = results;
+    QByteArray data = QJsonDocument(json).toJson();
+
+    if (outputFileName.isEmpty()) {
+        fwrite(data.constData(), 1, data.size(), stdout);
+    } else {
+        QFile file(outputFileName);
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) == -1) {
+            fprintf(stderr, "Cannot write the results to %s\n", qPrintable(outputFileName));
+            return 1;
+        }
+    }
+
+    return 0;
+}
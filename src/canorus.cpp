@@ -12,17 +12,20 @@
 #include <QDebug>
 #include <QDir>
 #include <QFileInfo>
-#include <QFontDatabase>
 #include <QLocale>
 #include <QMetaMethod>
 #include <QTextCodec>
+#include <QTimer>
 #include <QTranslator>
 
 #include "canorus.h"
 #include "control/helpctl.h"
 #include "core/settings.h"
 #include "core/undo.h"
+#include "interface/audition.h"
+#include "interface/pluginmanager.h"
 #include "interface/rtmididevice.h"
+#include "layout/feta.h"
 #include "score/sheet.h"
 #include "scripting/swigruby.h"
 #include "ui/settingsdialog.h"
@@ -32,11 +35,21 @@ QList<CAMainWin*> CACanorus::_mainWinList;
 CASettings* CACanorus::_settings;
 CAAutoRecovery* CACanorus::_autoRecovery;
 CAMidiDevice* CACanorus::_midiDevice;
+CAAudition* CACanorus::_audition;
 CAUndo* CACanorus::_undo;
 CAHelpCtl* CACanorus::_help;
+std::unique_ptr<QFileDialog> CACanorus::_saveDialog;
+std::unique_ptr<QFileDialog> CACanorus::_openDialog;
+std::unique_ptr<QFileDialog> CACanorus::_exportDialog;
+std::unique_ptr<QFileDialog> CACanorus::_importDialog;
+QString CACanorus::_fileDialogsDirectory;
 QList<QString> CACanorus::_recentDocumentList;
-QHash<QString, int> CACanorus::_fetaMap;
 std::unique_ptr<QTranslator> CACanorus::_translator;
+bool CACanorus::_scriptingInitialized = false;
+int CACanorus::_batchDepth = 0;
+bool CACanorus::_rebuildScheduled = false;
+bool CACanorus::_rebuildAll = false;
+QHash<CADocument*, CACanorus::CARebuildRequest> CACanorus::_rebuildRequests;
 
 /*!
 	Add all search paths.
@@ -94,6 +107,9 @@ void CACanorus::initMain(int, char* [])
 /*!
 	Initializes language specific settings like the translation file for the GUI,
 	text flow (left-to-right or right-to-left), default string encoding etc.
+
+	The translation is loaded by its file name, so QTranslator maps the file to memory instead of
+	reading it.
  */
 void CACanorus::initTranslations()
 {
@@ -112,50 +128,114 @@ void CACanorus::initTranslations()
     }
 }
 
-void CACanorus::initCommonGUI(std::unique_ptr<QFileDialog>& uiSaveDialog,
-    std::unique_ptr<QFileDialog>& uiOpenDialog,
-    std::unique_ptr<QFileDialog>& uiExportDialog,
-    std::unique_ptr<QFileDialog>& uiImportDialog)
-{
-    // Initialize main window's load/save/import/export dialogs
-    qInfo() << "Entered initCommonGUI";
-    uiSaveDialog = std::make_unique<QFileDialog>(nullptr, QObject::tr("Choose a file to save"), settings()->documentsDirectory().absolutePath());
-    uiSaveDialog->setFileMode(QFileDialog::AnyFile);
-    uiSaveDialog->setAcceptMode(QFileDialog::AcceptSave);
-    uiSaveDialog->setNameFilters(QStringList() << CAFileFormats::CANORUSML_FILTER);
-    uiSaveDialog->setNameFilters(uiSaveDialog->nameFilters() << CAFileFormats::CAN_FILTER);
-    uiSaveDialog->selectNameFilter(CAFileFormats::getFilter(settings()->defaultSaveFormat()));
-
-    uiOpenDialog = std::make_unique<QFileDialog>(nullptr, QObject::tr("Choose a file to open"), settings()->documentsDirectory().absolutePath());
-    uiOpenDialog->setFileMode(QFileDialog::ExistingFile);
-    uiOpenDialog->setAcceptMode(QFileDialog::AcceptOpen);
-    uiOpenDialog->setNameFilters(QStringList() << CAFileFormats::CANORUSML_FILTER); // clear the * filter
-    uiOpenDialog->setNameFilters(uiOpenDialog->nameFilters() << CAFileFormats::CAN_FILTER);
-    QString allFilters; // generate list of all files
-    for (int i = 0; i < uiOpenDialog->nameFilters().size(); i++) {
-        QString curFilter = uiOpenDialog->nameFilters()[i];
-        int left = curFilter.indexOf('(') + 1;
-        allFilters += curFilter.mid(left, curFilter.size() - left - 1) + " ";
+/*!
+	Returns the save dialog shared by all the main windows. The dialogs are created on their first
+	use, so opening a window doesn't build them.
+
+	\sa openDialog(), exportDialog(), importDialog()
+*/
+QFileDialog* CACanorus::saveDialog()
+{
+    if (!_saveDialog) {
+        _saveDialog.reset(createFileDialog(QObject::tr("Choose a file to save"), QFileDialog::AnyFile, QFileDialog::AcceptSave,
+            QStringList() << CAFileFormats::CANORUSML_FILTER << CAFileFormats::CAN_FILTER << CAFileFormats::CAN_BINARY_FILTER));
+        _saveDialog->selectNameFilter(CAFileFormats::getFilter(settings()->defaultSaveFormat()));
     }
-    allFilters.chop(1);
-    uiOpenDialog->setNameFilters(QStringList() << QString(QObject::tr("All supported formats (%1)").arg(allFilters)) << uiOpenDialog->nameFilters());
+    return _saveDialog.get();
+}
 
-    uiExportDialog = std::make_unique<QFileDialog>(nullptr, QObject::tr("Choose a file to export"), settings()->documentsDirectory().absolutePath());
-    uiExportDialog->setFileMode(QFileDialog::AnyFile);
-    uiExportDialog->setAcceptMode(QFileDialog::AcceptSave);
-    uiExportDialog->setNameFilters(QStringList() << CAFileFormats::LILYPOND_FILTER);
-    uiExportDialog->setNameFilters(uiExportDialog->nameFilters() << CAFileFormats::MUSICXML_FILTER);
-    uiExportDialog->setNameFilters(uiExportDialog->nameFilters() << CAFileFormats::MIDI_FILTER);
-    uiExportDialog->setNameFilters(uiExportDialog->nameFilters() << CAFileFormats::PDF_FILTER);
-    uiExportDialog->setNameFilters(uiExportDialog->nameFilters() << CAFileFormats::SVG_FILTER);
+QFileDialog* CACanorus::openDialog()
+{
+    if (!_openDialog) {
+        QStringList filters;
+        filters << CAFileFormats::CANORUSML_FILTER << CAFileFormats::CAN_FILTER;
+        QString allFilters; // generate list of all files
+        for (int i = 0; i < filters.size(); i++) {
+            QString curFilter = filters[i];
+            int left = curFilter.indexOf('(') + 1;
+            allFilters += curFilter.mid(left, curFilter.size() - left - 1) + " ";
+        }
+        allFilters.chop(1);
+        filters.prepend(QString(QObject::tr("All supported formats (%1)").arg(allFilters)));
+
+        _openDialog.reset(createFileDialog(QObject::tr("Choose a file to open"), QFileDialog::ExistingFile, QFileDialog::AcceptOpen, filters));
+    }
+    return _openDialog.get();
+}
+
+/*!
+	Returns the export dialog shared by all the main windows including the export filters of the
+	enabled plugins.
+*/
+QFileDialog* CACanorus::exportDialog()
+{
+    if (!_exportDialog) {
+        _exportDialog.reset(createFileDialog(QObject::tr("Choose a file to export"), QFileDialog::AnyFile, QFileDialog::AcceptSave,
+            QStringList() << CAFileFormats::LILYPOND_FILTER << CAFileFormats::MUSICXML_FILTER << CAFileFormats::MXL_FILTER << CAFileFormats::MIDI_FILTER
+                          << CAFileFormats::PDF_FILTER << CAFileFormats::SVG_FILTER << CAFileFormats::ENGRAVED_PDF_FILTER
+                          << CAFileFormats::ENGRAVED_SVG_FILTER << CAFileFormats::WAV_FILTER << CAFileFormats::FLAC_FILTER));
+    }
+    addPluginFilters(_exportDialog.get(), CAPluginManager::exportFilters());
+    return _exportDialog.get();
+}
 
-    uiImportDialog = std::make_unique<QFileDialog>(nullptr, QObject::tr("Choose a file to import"), settings()->documentsDirectory().absolutePath());
-    uiImportDialog->setFileMode(QFileDialog::ExistingFile);
-    uiImportDialog->setAcceptMode(QFileDialog::AcceptOpen);
-    uiImportDialog->setNameFilters(QStringList() << CAFileFormats::MUSICXML_FILTER);
-    uiImportDialog->setNameFilters(uiImportDialog->nameFilters() << CAFileFormats::MXL_FILTER);
-    uiImportDialog->setNameFilters(uiImportDialog->nameFilters() << CAFileFormats::MIDI_FILTER);
-    // uiImportDialog->setNameFilters( uiImportDialog->nameFilters() << CAFileFormats::LILYPOND_FILTER ); // activate when usable
+/*!
+	Returns the import dialog shared by all the main windows including the import filters of the
+	enabled plugins.
+*/
+QFileDialog* CACanorus::importDialog()
+{
+    if (!_importDialog) {
+        _importDialog.reset(createFileDialog(QObject::tr("Choose a file to import"), QFileDialog::ExistingFile, QFileDialog::AcceptOpen,
+            QStringList() << CAFileFormats::MUSICXML_FILTER << CAFileFormats::MXL_FILTER << CAFileFormats::MIDI_FILTER));
+        // << CAFileFormats::LILYPOND_FILTER // activate when usable
+    }
+    addPluginFilters(_importDialog.get(), CAPluginManager::importFilters());
+    return _importDialog.get();
+}
+
+/*!
+	Sets the current directory of the file dialogs to \a dir. The dialogs not created yet start
+	in it.
+*/
+void CACanorus::setFileDialogsDirectory(const QDir& dir)
+{
+    _fileDialogsDirectory = dir.absolutePath();
+    for (QFileDialog* dialog : { _saveDialog.get(), _openDialog.get(), _exportDialog.get(), _importDialog.get() }) {
+        if (dialog) {
+            dialog->setDirectory(dir);
+        }
+    }
+}
+
+QFileDialog* CACanorus::createFileDialog(const QString& caption, QFileDialog::FileMode fileMode, QFileDialog::AcceptMode acceptMode, const QStringList& filters)
+{
+    QFileDialog* dialog = new QFileDialog(nullptr, caption, _fileDialogsDirectory.isEmpty() ? settings()->documentsDirectory().absolutePath() : _fileDialogsDirectory);
+    dialog->setFileMode(fileMode);
+    dialog->setAcceptMode(acceptMode);
+    dialog->setNameFilters(filters); // also clears the * filter
+    return dialog;
+}
+
+/*!
+	Adds the plugin \a filters missing in the \a dialog. The plugins can be enabled after the
+	dialog was created.
+*/
+void CACanorus::addPluginFilters(QFileDialog* dialog, const QStringList& filters)
+{
+    QStringList nameFilters = dialog->nameFilters();
+    int size = nameFilters.size();
+    for (const QString& filter : filters) {
+        if (!nameFilters.contains(filter)) {
+            nameFilters << filter;
+        }
+    }
+
+    if (nameFilters.size() != size) {
+        QString selected = dialog->selectedNameFilter();
+        dialog->setNameFilters(nameFilters);
+        dialog->selectNameFilter(selected);
+    }
 }
 
 /*!
@@ -165,6 +245,7 @@ void CACanorus::initPlayback()
 {
     qRegisterMetaType<QVector<unsigned char>>("QVector< unsigned char >");
     setMidiDevice(new CARtMidiDevice());
+    _audition = new CAAudition(_midiDevice);
 }
 
 /*!
@@ -187,13 +268,20 @@ CASettingsDialog::CASettingsPage CACanorus::initSettings()
 }
 
 /*!
-	Initializes scripting and plugins subsystem.
+	Initializes the Python scripting.
+
+	The interpreter is not loaded at startup. This function is called before the first Python script
+	or plugin action is run and does nothing, if the scripting was already initialized. Ruby is
+	initialized by CASwigRuby::init() before the first Ruby action.
+
+	\sa isScriptingInitialized()
 */
 void CACanorus::initScripting()
 {
-#ifdef USE_RUBY
-    CASwigRuby::init();
-#endif
+    if (_scriptingInitialized)
+        return;
+    _scriptingInitialized = true;
+
 #ifdef USE_PYTHON
     CASwigPython::init();
 #endif
@@ -212,30 +300,25 @@ void CACanorus::initUndo()
     _undo = new CAUndo();
 }
 
-void CACanorus::initFonts()
-{
-    // addApplicationFont doesn't understand prefix: paths.
-    QFontDatabase::addApplicationFont(QFileInfo("fonts:CenturySchL-Roma.ttf").absoluteFilePath());
-    QFontDatabase::addApplicationFont(QFileInfo("fonts:CenturySchL-Ital.ttf").absoluteFilePath());
-    QFontDatabase::addApplicationFont(QFileInfo("fonts:CenturySchL-Bold.ttf").absoluteFilePath());
-    QFontDatabase::addApplicationFont(QFileInfo("fonts:CenturySchL-BoldItal.ttf").absoluteFilePath());
-    QFontDatabase::addApplicationFont(QFileInfo("fonts:FreeSans.ttf").absoluteFilePath());
-    QFontDatabase::addApplicationFont(QFileInfo("fonts:Emmentaler-14.ttf").absoluteFilePath());
-// populate glyph->codepoint map using generated list
-#include "fonts/fetaList.cxx"
-}
-
 /*!
 	Returns codepoint for an Feta (Emmentaler) glyph by its name.
+	Drawables should use CAFeta::codepoint() with the glyph id instead.
  */
 int CACanorus::fetaCodepoint(const QString& name)
 {
-    return _fetaMap[name];
+    return CAFeta::codepoint(name);
 }
 
-void CACanorus::initHelp()
+/*!
+	Returns the help controller. It is created on the first use, so the user's guide isn't looked
+	up on the startup.
+*/
+CAHelpCtl* CACanorus::help()
 {
-    _help = new CAHelpCtl();
+    if (!_help) {
+        _help = new CAHelpCtl();
+    }
+    return _help;
 }
 
 void CACanorus::insertRecentDocument(QString filename)
@@ -267,10 +350,15 @@ void CACanorus::removeRecentDocument(QString filename)
 void CACanorus::cleanUp()
 {
     delete _settings;
+    delete _audition; // turns off its notes
     delete _midiDevice;
     autoRecovery()->cleanupRecovery();
     delete _autoRecovery;
     delete _undo;
+    _saveDialog.reset();
+    _openDialog.reset();
+    _exportDialog.reset();
+    _importDialog.reset();
 }
 
 /*!
@@ -338,24 +426,59 @@ int CACanorus::mainWinCount(CADocument* doc)
 
 /*!
 	Rebuilds main windows with the given \a document and its views showing the given \a sheet.
+	During a batch, the rebuild is postponed until endBatch().
 
 	\sa rebuildUI(CADocument*), CAMainWin::rebuildUI()
 */
 void CACanorus::rebuildUI(CADocument* document, CASheet* sheet)
 {
+    if (isBatch()) {
+        addRebuildRequest(document, sheet, -1, -1);
+        return;
+    }
+
     for (int i = 0; i < mainWinList().size(); i++)
         if (mainWinList()[i]->document() == document)
             mainWinList()[i]->rebuildUI(sheet);
 }
 
+/*!
+	Rebuilds main windows with the given \a document after a change in the \a sheet between
+	\a timeStart and \a timeEnd. Score views re-engrave only the changed part of the sheet.
+	During a batch, the rebuild is postponed until endBatch().
+
+	\sa rebuildUI(CADocument*, CASheet*), CAMainWin::rebuildUI(CASheet*, int, int, bool)
+*/
+void CACanorus::rebuildUI(CADocument* document, CASheet* sheet, int timeStart, int timeEnd)
+{
+    if (isBatch()) {
+        addRebuildRequest(document, sheet, timeStart, timeEnd);
+        return;
+    }
+
+    for (int i = 0; i < mainWinList().size(); i++)
+        if (mainWinList()[i]->document() == document)
+            mainWinList()[i]->rebuildUI(sheet, timeStart, timeEnd);
+}
+
 /*!
 	Rebuilds main windows with the given \a document.
 	Rebuilds all main windows, if \a document is not given or null.
+	During a batch, the rebuild is postponed until endBatch().
 
 	\sa rebuildUI(CADocument*, CASheet*), CAMainWin::rebuildUI()
 */
 void CACanorus::rebuildUI(CADocument* document)
 {
+    if (isBatch()) {
+        if (document) {
+            _rebuildRequests[document].full = true;
+        } else {
+            _rebuildAll = true;
+        }
+        return;
+    }
+
     for (int i = 0; i < mainWinList().size(); i++) {
         if (document && mainWinList()[i]->document() == document) {
             mainWinList()[i]->rebuildUI();
@@ -364,6 +487,115 @@ void CACanorus::rebuildUI(CADocument* document)
     }
 }
 
+/*!
+	Merges the rebuild of the \a sheet between \a timeStart and \a timeEnd into the pending rebuilds
+	of the \a document. Negative \a timeStart stands for the whole sheet.
+*/
+void CACanorus::addRebuildRequest(CADocument* document, CASheet* sheet, int timeStart, int timeEnd)
+{
+    CARebuildRequest& request = _rebuildRequests[document];
+    if (request.full) {
+        return;
+    }
+
+    if (!request.sheets.contains(sheet)) {
+        request.sheets[sheet] = qMakePair(timeStart, timeEnd);
+    } else {
+        QPair<int, int>& region = request.sheets[sheet];
+        if (region.first < 0 || timeStart < 0) {
+            region = qMakePair(-1, -1);
+        } else {
+            region = qMakePair(qMin(region.first, timeStart), qMax(region.second, timeEnd));
+        }
+    }
+}
+
+/*!
+	Rebuilds the views showing the \a sheet of the \a document after a change between \a timeStart and
+	\a timeEnd, when the control returns to the event loop or at the end of the current batch.
+
+	Use this instead of rebuildUI(), when the views are not needed until the next repaint. Many changes
+	made at once (eg. by a script) cause only a single rebuild of each sheet. If \a timeStart is negative,
+	the whole sheet is rebuilt. If \a sheet is null, all the views of the document are rebuilt.
+
+	\sa flushRebuildUI(), beginBatch()
+*/
+void CACanorus::scheduleRebuildUI(CADocument* document, CASheet* sheet, int timeStart, int timeEnd)
+{
+    addRebuildRequest(document, sheet, timeStart, timeEnd);
+
+    if (!_rebuildScheduled && !isBatch()) {
+        _rebuildScheduled = true;
+        QTimer::singleShot(0, &CACanorus::flushRebuildUI);
+    }
+}
+
+/*!
+	Immediately does the pending rebuilds, eg. when the drawable elements are needed.
+
+	\sa scheduleRebuildUI()
+*/
+void CACanorus::flushRebuildUI()
+{
+    _rebuildScheduled = false;
+
+    bool rebuildAll = _rebuildAll;
+    QHash<CADocument*, CARebuildRequest> requests = _rebuildRequests;
+    _rebuildAll = false;
+    _rebuildRequests.clear();
+
+    int batchDepth = _batchDepth; // rebuild now, even if called during a batch
+    _batchDepth = 0;
+
+    if (rebuildAll) {
+        rebuildUI();
+    } else {
+        for (auto it = requests.constBegin(); it != requests.constEnd(); it++) {
+            if (it.value().full) {
+                rebuildUI(it.key());
+                continue;
+            }
+
+            for (auto sheet = it.value().sheets.constBegin(); sheet != it.value().sheets.constEnd(); sheet++) {
+                if (sheet.value().first < 0) {
+                    rebuildUI(it.key(), sheet.key());
+                } else {
+                    rebuildUI(it.key(), sheet.key(), sheet.value().first, sheet.value().second);
+                }
+            }
+        }
+    }
+
+    _batchDepth = batchDepth;
+}
+
+/*!
+	Starts a batch of changes. Until the matching endBatch(), rebuildUI() calls only remember which
+	documents and sheets were changed. Batches can be nested.
+
+	This is used by plugins and scripts making many small changes, each followed by a rebuild.
+
+	\sa endBatch(), scheduleRebuildUI()
+*/
+void CACanorus::beginBatch()
+{
+    _batchDepth++;
+}
+
+/*!
+	Ends the batch started by beginBatch(). When the outermost batch ends, the merged rebuilds are done.
+*/
+void CACanorus::endBatch()
+{
+    if (_batchDepth <= 0) {
+        return;
+    }
+
+    if (!--_batchDepth) {
+        flushRebuildUI();
+    }
+}
+
 /*!
 	Repaints all main window.
 	This is useful for example if only selection was changed by external event (eg. plugin)
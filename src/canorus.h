@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -20,6 +20,7 @@
 
 #include <QHash>
 #include <QList>
+#include <QPair>
 #include <QString>
 #include <QUndoStack>
 #include <memory>
@@ -29,27 +30,28 @@
 
 class CASettings;
 class CAMidiDevice;
+class CAAudition;
 class CADocument;
 class CAUndo;
 class CAHelpCtl;
+class QDir;
 
 class CACanorus {
 public:
     static void initMain(int argc = 0, char* argv[] = nullptr);
     static CASettingsDialog::CASettingsPage initSettings();
     static void initTranslations();
-    static void initCommonGUI(std::unique_ptr<QFileDialog>& uiSaveDialog,
-        std::unique_ptr<QFileDialog>& uiOpenDialog,
-        std::unique_ptr<QFileDialog>& uiExportDialog,
-        std::unique_ptr<QFileDialog>& uiImportDialog);
+    static QFileDialog* saveDialog();
+    static QFileDialog* openDialog();
+    static QFileDialog* exportDialog();
+    static QFileDialog* importDialog();
+    static void setFileDialogsDirectory(const QDir& dir);
     static void initPlayback();
     static bool parseSettingsArguments(int argc, char* argv[]);
     static void initScripting();
     static void initAutoRecovery();
     static void initUndo();
     static void initSearchPaths();
-    static void initFonts();
-    static void initHelp();
     static void parseOpenFileArguments(int argc, char* argv[]);
     static void cleanUp();
 
@@ -84,11 +86,19 @@ public:
     inline static CAAutoRecovery* autoRecovery() { return _autoRecovery; }
     inline static CAMidiDevice* midiDevice() { return _midiDevice; }
     inline static void setMidiDevice(CAMidiDevice* d) { _midiDevice = d; }
+    inline static CAAudition* audition() { return _audition; }
 
-    inline static CAHelpCtl* help() { return _help; }
+    static CAHelpCtl* help();
+    inline static bool isScriptingInitialized() { return _scriptingInitialized; }
 
     static void rebuildUI(CADocument* document, CASheet* sheet);
+    static void rebuildUI(CADocument* document, CASheet* sheet, int timeStart, int timeEnd);
     static void rebuildUI(CADocument* document = nullptr);
+    static void scheduleRebuildUI(CADocument* document, CASheet* sheet, int timeStart = -1, int timeEnd = -1);
+    static void flushRebuildUI();
+    static void beginBatch();
+    static void endBatch();
+    inline static bool isBatch() { return _batchDepth > 0; }
     static void repaintUI();
 
     // Our own slot connection method
@@ -103,20 +113,44 @@ public:
     static const char* propConflicts() { return "Conflicts"; }
 
 private:
+    // Pending rebuild of a document, see scheduleRebuildUI()
+    struct CARebuildRequest {
+        bool full = false; // rebuild the whole document
+        QHash<CASheet*, QPair<int, int>> sheets; // changed time region of the sheets, (-1, -1) for the whole sheet
+    };
+
+    static void addRebuildRequest(CADocument* document, CASheet* sheet, int timeStart, int timeEnd);
+
     static QList<CAMainWin*> _mainWinList;
     static CASettings* _settings;
     static CAUndo* _undo;
     static QList<QString> _recentDocumentList;
     static std::unique_ptr<QTranslator> _translator;
-    static QHash<QString, int> _fetaMap;
+    static bool _scriptingInitialized;
+
+    // Deferred rebuilds
+    static int _batchDepth;
+    static bool _rebuildScheduled;
+    static bool _rebuildAll;
+    static QHash<CADocument*, CARebuildRequest> _rebuildRequests;
 
     // Playback output
     static CAMidiDevice* _midiDevice;
+    static CAAudition* _audition; // sounds the inserted notes
 
     // Auto recovery
     static CAAutoRecovery* _autoRecovery;
 
     // Help
     static CAHelpCtl* _help;
+
+    // File dialogs shared by all the main windows, created on the first use
+    static std::unique_ptr<QFileDialog> _saveDialog;
+    static std::unique_ptr<QFileDialog> _openDialog;
+    static std::unique_ptr<QFileDialog> _exportDialog;
+    static std::unique_ptr<QFileDialog> _importDialog;
+    static QString _fileDialogsDirectory; // last directory set by setFileDialogsDirectory(), empty for the documents directory
+    static QFileDialog* createFileDialog(const QString& caption, QFileDialog::FileMode fileMode, QFileDialog::AcceptMode acceptMode, const QStringList& filters);
+    static void addPluginFilters(QFileDialog* dialog, const QStringList& filters);
 };
 #endif /* CANORUS_H_ */
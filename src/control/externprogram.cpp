@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2019, Reinhard Katzmann, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Reinhard Katzmann, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -9,6 +9,11 @@
 #include "control/externprogram.h"
 #include <QDebug>
 
+#include <cstring>
+
+const int CAExternProgram::MAX_OUTPUT_SIZE = 256 * 1024;
+const int CAExternProgram::OUTPUT_INTERVAL = 200; // miliseconds
+
 /*!	\class CAExternProgram
 	\brief Start a program as extern background process
 
@@ -17,6 +22,11 @@
 	The output of the program can be fetched via signal/slots
 	Another signal is sent when the program finished including it's state
 
+	Verbose programs write their output in many small chunks. The output is collected and sent
+	by nextOutput at most every OUTPUT_INTERVAL miliseconds and once more, before the program
+	exits. The last MAX_OUTPUT_SIZE bytes of the output are kept in a ring buffer and can be
+	fetched by getOutput() at any time.
+
 	Constructor: If the stderr output should not be shown, \a bRcvStdErr has
 	             has to be set to false.
 */
@@ -26,6 +36,11 @@ CAExternProgram::CAExternProgram(bool bRcvStdErr /* = true */, bool bRcvStdOut /
 {
     _bRcvStdErr = bRcvStdErr;
     _oParamDelimiter = " ";
+    _iOutputPos = 0;
+    _bOutputWrapped = false;
+    _oOutputTimer.setSingleShot(true);
+    _oOutputTimer.setInterval(OUTPUT_INTERVAL);
+    connect(&_oOutputTimer, SIGNAL(timeout()), this, SLOT(flushOutput()));
     connect(_poExternProgram.get(), SIGNAL(error(QProcess::ProcessError)), this, SLOT(programError(QProcess::ProcessError)));
     connect(_poExternProgram.get(), SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(programFinished(int, QProcess::ExitStatus)));
     if (bRcvStdOut)
@@ -154,6 +169,8 @@ bool CAExternProgram::execProgram(const QString& roCwd /* = "." */)
     }
     if (!roCwd.isEmpty())
         _poExternProgram->setWorkingDirectory(roCwd);
+    _iOutputPos = 0; // getOutput() only returns the output of this run
+    _bOutputWrapped = false;
 
     // Add optional path (including dash, so there doesn't need to be a dash at the end of the path)
     if (_oProgramPath.isEmpty()) {
@@ -172,24 +189,69 @@ bool CAExternProgram::execProgram(const QString& roCwd /* = "." */)
 }
 
 /*!
-	This method sends a signal when data is received by the extern program
+	This method collects the data received by the extern program
 
 	To receive data from the extern program create a signal/slot connection
-	to the nextOutput signal. This class does not cache any data!
-	The \o roData contains the data received by the process output to
-	either stdout or stderr. Use the constructor to define if you don't wish to
+	to the nextOutput signal. The \a roData contains the data received by the process
+	output to either stdout or stderr. Use the constructor to define if you don't wish to
 	either receive standartd output or standard error.
 
+	The data is stored in the output ring buffer (see getOutput()) and sent by nextOutput
+	together with the rest of the output received during the OUTPUT_INTERVAL. If more than
+	MAX_OUTPUT_SIZE bytes are pending, only the last ones are sent.
+
 	\sa QProcess::setProgram( QString oProgram )
 */
 void CAExternProgram::rcvProgramOutput(const QByteArray& roData)
 {
-    // The data is not stored but has to be immediately read by the using object
-    // Else the data ist lost.
-    // If you need a data caching please create a sub class from this class like
-    // CACacheExternProgram or include it in a CACacheProgramData class or use
-    // the cache class Qt provides named QCache for such a purpose.
-    emit nextOutput(roData);
+    const char* pcData = roData.constData();
+    int iSize = roData.size();
+    if (iSize > MAX_OUTPUT_SIZE) {
+        pcData += iSize - MAX_OUTPUT_SIZE;
+        iSize = MAX_OUTPUT_SIZE;
+    }
+    if (_oOutput.size() < MAX_OUTPUT_SIZE)
+        _oOutput.resize(MAX_OUTPUT_SIZE);
+    // Write the data in at most two parts, wrapping around the end of the buffer
+    int iFirst = qMin(iSize, MAX_OUTPUT_SIZE - _iOutputPos);
+    memcpy(_oOutput.data() + _iOutputPos, pcData, static_cast<size_t>(iFirst));
+    memcpy(_oOutput.data(), pcData + iFirst, static_cast<size_t>(iSize - iFirst));
+    if (_iOutputPos + iSize >= MAX_OUTPUT_SIZE)
+        _bOutputWrapped = true;
+    _iOutputPos = (_iOutputPos + iSize) % MAX_OUTPUT_SIZE;
+
+    _oPendingOutput += roData;
+    if (_oPendingOutput.size() > MAX_OUTPUT_SIZE)
+        _oPendingOutput = _oPendingOutput.right(MAX_OUTPUT_SIZE);
+    if (!_oOutputTimer.isActive())
+        _oOutputTimer.start();
+}
+
+/*!
+	Sends the output received since the last call by nextOutput, if any
+*/
+void CAExternProgram::flushOutput()
+{
+    _oOutputTimer.stop();
+    if (_oPendingOutput.isEmpty())
+        return;
+
+    QByteArray oData;
+    oData.swap(_oPendingOutput);
+    emit nextOutput(oData);
+}
+
+/*!
+	Returns the last MAX_OUTPUT_SIZE bytes of the output of the last program run
+
+	Use it for showing the complete log on demand, while nextOutput only reports
+	the new output.
+*/
+QByteArray CAExternProgram::getOutput()
+{
+    if (!_bOutputWrapped)
+        return _oOutput.left(_iOutputPos);
+    return _oOutput.mid(_iOutputPos) + _oOutput.left(_iOutputPos);
 }
 
 /*!
@@ -203,6 +265,7 @@ void CAExternProgram::rcvProgramOutput(const QByteArray& roData)
 */
 void CAExternProgram::programExited()
 {
+    flushOutput(); // the observers get all the output before the exit
     if (getRunning()) {
         qCritical("%s",
             QString("ExternProgram: program %1 reported error %2!" + _poExternProgram->errorString()).arg(_poExternProgram->error()).toLatin1().constData());
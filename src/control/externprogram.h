@@ -1,5 +1,5 @@
 /*!
-        Copyright (c) 2006-2019, Reinhard Katzmann, Matevž Jekovec, Canorus development team
+        Copyright (c) 2006-2020, Reinhard Katzmann, Matevž Jekovec, Canorus development team
         All Rights Reserved. See AUTHORS for a complete list of authors.
 
         Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -9,9 +9,11 @@
 #define EXTERN_PROGRAM_H
 
 // Includes
+#include <QByteArray>
 #include <QObject>
 #include <QProcess>
 #include <QStringList>
+#include <QTimer>
 
 #include <memory>
 
@@ -38,6 +40,8 @@ public:
     }
 
     inline const QStringList& getParameters() { return _oParameters; }
+    inline const QString& getProgramName() { return _oProgramName; }
+    inline const QString& getProgramPath() { return _oProgramPath; }
     inline bool getRunning()
     {
         return _poExternProgram->state() == QProcess::Running;
@@ -49,6 +53,10 @@ public:
     inline void clearParameters() { _oParameters.clear(); }
     bool execProgram(const QString& roCwd = ".");
     inline bool waitForFinished(int iMSecs) { return _poExternProgram->waitForFinished(iMSecs); }
+    QByteArray getOutput();
+
+    static const int MAX_OUTPUT_SIZE;
+    static const int OUTPUT_INTERVAL;
 
 signals:
     void nextOutput(const QByteArray& roData);
@@ -59,6 +67,7 @@ protected slots:
     void rcvProgramStdErr() { rcvProgramOutput(_poExternProgram->readAllStandardError()); }
     void programError(QProcess::ProcessError) { programExited(); }
     void programFinished(int, QProcess::ExitStatus) { programExited(); }
+    void flushOutput();
 
 protected:
     void rcvProgramOutput(const QByteArray& roData);
@@ -71,6 +80,11 @@ protected:
     QStringList _oParameters; // List of program parameters
     QString _oParamDelimiter; // delimiter between the single parameters
     bool _bRcvStdErr; // 'true': Receive program output from stderr
+    QByteArray _oOutput; // Ring buffer with the last MAX_OUTPUT_SIZE bytes of the output
+    int _iOutputPos; // Position in _oOutput the next output is written to
+    bool _bOutputWrapped; // 'true': _oOutput is full and the oldest output starts at _iOutputPos
+    QByteArray _oPendingOutput; // Output not sent by nextOutput yet
+    QTimer _oOutputTimer; // Sends the pending output at most every OUTPUT_INTERVAL
 };
 
 #endif // EXTERN_PROGRAM
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2009-2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2009-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -12,6 +12,30 @@
 #include "ui/mainwin.h"
 #include "widgets/progressstatusbar.h"
 
+namespace {
+
+/*!
+	Returns the throughput of the \a progress for the status bar, eg. " (1.5 MB/s)", or an empty
+	string, if nothing was reported yet.
+*/
+QString throughputString(CAProgress* progress)
+{
+    double rate = progress->throughput();
+    if (rate <= 0) {
+        return QString();
+    }
+
+    if (progress->unit() == CAProgress::Bytes) {
+        if (rate >= 1024 * 1024) {
+            return QObject::tr(" (%1 MB/s)").arg(rate / (1024 * 1024), 0, 'f', 1);
+        }
+        return QObject::tr(" (%1 kB/s)").arg(rate / 1024, 0, 'f', 1);
+    }
+    return QObject::tr(" (%1/s)").arg(qRound(rate));
+}
+
+}
+
 CAMainWinProgressCtl::CAMainWinProgressCtl(CAMainWin* mainWin)
     : _mainWin(mainWin)
     , _bar(nullptr)
@@ -25,7 +49,7 @@ CAMainWinProgressCtl::~CAMainWinProgressCtl() = default;
 void CAMainWinProgressCtl::on_updateTimer_timeout()
 {
     if (_file) {
-        _bar->setProgress(_file->readableStatus(), _file->progress());
+        _bar->setProgress(_file->readableStatus() + throughputString(_file->progressToken()), _file->progress());
 
         if (_file->isFinished()) {
             restoreStatusBar();
@@ -34,10 +58,15 @@ void CAMainWinProgressCtl::on_updateTimer_timeout()
     }
 }
 
+/*!
+	Asks the running import or export to stop. The filter stops at its next check of
+	CAFile::isCanceled() and finishes with the CAFile::CANCELED status, so no partial result is
+	used by the main window.
+*/
 void CAMainWinProgressCtl::on_cancelButton_clicked(bool)
 {
     if (_file) {
-        _file->exit();
+        _file->cancel();
         restoreStatusBar();
         _updateTimer->stop();
 
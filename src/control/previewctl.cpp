@@ -51,9 +51,8 @@ void CAPreviewCtl::on_uiPrintPreview_triggered()
     //_poPDFExport->exportDocument( _poMainWin->document() );
     _poPDFExport->exportSheet(_poMainWin->currentSheet());
     _poPDFExport->wait();
-    const QString roTempPath = _poPDFExport->getTempFilePath();
     // Copy the name for later output on the printer
-    _oOutputPDFName = roTempPath;
+    _oOutputPDFName = oTempFileName;
 }
 
 void CAPreviewCtl::showPDF(int iExitCode)
@@ -6,6 +6,7 @@
 */
 
 // Includes
+#include <QApplication>
 #include <QDesktopServices>
 #include <QMessageBox>
 #include <QPainter>
@@ -18,6 +19,7 @@
 #include "control/printctl.h"
 #include "core/settings.h"
 #include "export/svgexport.h"
+#include "export/vectorexport.h"
 #include "ui/mainwin.h"
 
 CAPrintCtl::CAPrintCtl(CAMainWin* poMainWin)
@@ -48,6 +50,31 @@ void CAPrintCtl::on_uiPrintDirectly_triggered()
     printDocument();
 }
 
+/*!
+	Prints the current sheet as laid out in the score view without running the typesetter. The
+	pages are drawn directly on the printer chosen in the print dialog.
+
+	\sa CAVectorExport::printSheet()
+*/
+void CAPrintCtl::on_uiPrintEngraved_triggered()
+{
+    if (!_poMainWin->currentSheet())
+        return;
+
+    QPrinter oPrinter(QPrinterInfo::defaultPrinter(), QPrinter::HighResolution);
+    QPrintDialog oPrintDlg(&oPrinter, _poMainWin);
+    if (!oPrintDlg.exec())
+        return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    CAVectorExport oExport;
+    bool bSuccess = oExport.printSheet(_poMainWin->currentSheet(), &oPrinter);
+    QApplication::restoreOverrideCursor();
+    if (!bSuccess) {
+        QMessageBox::critical(_poMainWin, tr("Error while printing"), tr("Unable to print the sheet."));
+    }
+}
+
 void CAPrintCtl::printDocument()
 {
     QDir oPath(QDir::tempPath());
@@ -32,6 +32,7 @@ public:
 public slots:
     void on_uiPrint_triggered();
     void on_uiPrintDirectly_triggered();
+    void on_uiPrintEngraved_triggered();
 
 protected slots:
     void printSVG(int iExitCode);
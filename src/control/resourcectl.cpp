@@ -12,6 +12,7 @@
 #include "core/undo.h"
 #endif
 
+#include <QCryptographicHash>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
@@ -36,9 +37,15 @@
 	CAResourceContainer takes care of creating copies for non-linked resources.
 	It picks a random unique name for a new resource in the system temporary file.
 
+	The files are streamed by copyResource() in chunks of CHUNK bytes and hashed on the way, so
+	large recordings are never held in memory and don't need to be read again to decide whether
+	they changed when the document is saved.
+
 	\sa CAResource
 */
 
+const qint64 CAResourceCtl::CHUNK = 256 * 1024;
+
 /*!
 	Default constructor. Currently empty.
 */
@@ -63,15 +70,21 @@ std::shared_ptr<CAResource> CAResourceCtl::importResource(QString name, QString
     if (isLinked) {
         r = std::make_shared<CAResource>(fileName, name, true, t, parent);
     } else {
-        std::unique_ptr<QTemporaryFile> f = std::make_unique<QTemporaryFile>(QDir::tempPath() + "/" + name);
-        f->open();
-        QString targetFile = QFileInfo(*f).absoluteFilePath();
-        f->close();
-        f.reset();
-
-        if (QFile::exists(fileName)) {
-            QFile::copy(fileName, targetFile);
+        QFile source(fileName);
+        if (source.open(QIODevice::ReadOnly)) {
+            QTemporaryFile target(QDir::tempPath() + "/" + name);
+            target.setAutoRemove(false); // removed by the resource
+            QByteArray hash;
+            if (target.open()) {
+                hash = copyResource(source, target);
+            }
+            QString targetFile = QFileInfo(target).absoluteFilePath();
+            target.close();
+
             r = std::make_shared<CAResource>(QUrl::fromLocalFile(targetFile), name, false, t, parent);
+            if (!hash.isEmpty()) {
+                r->setHash(hash);
+            }
         } else {
             // file doesn't exist yet (eg. hasn't been extracted yet)
             // create a dummy resource using fileName url
@@ -142,3 +155,22 @@ void CAResourceCtl::deleteResource(std::shared_ptr<CAResource> r)
 
     r.reset();
 }
+
+/*!
+	Copies the rest of the \a source device to the \a target in chunks of CHUNK bytes.
+	Returns the hex SHA-1 hash of the copied data or an empty array, if reading or writing failed.
+ */
+QByteArray CAResourceCtl::copyResource(QIODevice& source, QIODevice& target)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    QByteArray buffer(static_cast<int>(CHUNK), 0);
+    qint64 size;
+    while ((size = source.read(buffer.data(), CHUNK)) > 0) {
+        if (target.write(buffer.constData(), size) != size) {
+            return QByteArray();
+        }
+        hash.addData(buffer.constData(), static_cast<int>(size));
+    }
+
+    return (size < 0) ? QByteArray() : hash.result().toHex();
+}
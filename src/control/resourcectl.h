@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2008-2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2008-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -8,6 +8,7 @@
 #ifndef RESOURCECTL_H_
 #define RESOURCECTL_H_
 
+#include <QByteArray>
 #include <QList>
 #include <QString>
 
@@ -15,6 +16,8 @@
 
 #include "score/resource.h"
 
+class QIODevice;
+
 class CAResourceCtl {
 public:
     CAResourceCtl();
@@ -23,6 +26,9 @@ public:
     static std::shared_ptr<CAResource> importResource(QString name, QString fileName, bool isLinked = false, CADocument* parent = nullptr, CAResource::CAResourceType t = CAResource::Other);
     static std::shared_ptr<CAResource> createEmptyResource(QString name, CADocument* parent = nullptr, CAResource::CAResourceType t = CAResource::Other);
     static void deleteResource(std::shared_ptr<CAResource>);
+    static QByteArray copyResource(QIODevice& source, QIODevice& target);
+
+    static const qint64 CHUNK; // number of bytes copied at once
 };
 
 #endif /* RESOURCECTL_H_ */
@@ -1,13 +1,17 @@
 /*!
-        Copyright (c) 2006-2019, Reinhard Katzmann, Matevž Jekovec, Canorus development team
+        Copyright (c) 2006-2020, Reinhard Katzmann, Matevž Jekovec, Canorus development team
         All Rights Reserved. See AUTHORS for a complete list of authors.
 
         Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
 */
 
 // Includes
+#include <QFile>
+
 #include "control/typesetctl.h"
 #include "control/externprogram.h"
+#include "control/typesetserver.h"
+#include "core/trace.h"
 #include "export/export.h"
 //#include "core/document.h"
 
@@ -28,8 +32,12 @@ CATypesetCtl::CATypesetCtl()
     _poConvPS2PDF = new CAExternProgram;
     _poExport = nullptr;
     _poOutputFile = nullptr;
+    _typesetterStart = 0;
+    _iExitCode = -1;
     _bPDFConversion = false;
     _bOutputFileNameFirst = false;
+    _bServerMode = false;
+    _iServerJob = -1;
     connect(_poTypesetter, SIGNAL(programExited(int)), this, SLOT(typsetterExited(int)));
     connect(_poTypesetter, SIGNAL(nextOutput(const QByteArray&)), this, SLOT(rcvTypesetterOutput(const QByteArray&)));
 }
@@ -37,6 +45,10 @@ CATypesetCtl::CATypesetCtl()
 // Destructor
 CATypesetCtl::~CATypesetCtl()
 {
+    if (_iServerJob != -1) {
+        int iExitCode;
+        CATypesetServer::instance()->waitForJob(_iServerJob, -1, &iExitCode); // the job writes to our files
+    }
     if (_poTypesetter)
         delete _poTypesetter;
     _poTypesetter = nullptr;
@@ -169,6 +181,7 @@ void CATypesetCtl::exportDocument(CADocument* poDoc)
         // Only add output file name as first parameter file name if it is needed
         if (true == _bOutputFileNameFirst)
             _poTypesetter->addParameter(_oOutputFileName, false);
+        CA_TRACE_ZONE("CATypesetCtl::exportDocument");
         _poExport->setStreamToDevice(_poOutputFile);
         _poExport->exportDocument(poDoc);
         // @ToDo use signal/slot mechanism to wait for the file
@@ -204,6 +217,7 @@ void CATypesetCtl::exportSheet(CASheet* poSheet)
         // Only add output file name as first parameter file name if it is needed
         if (true == _bOutputFileNameFirst)
             _poTypesetter->addParameter(_oOutputFileName, false);
+        CA_TRACE_ZONE("CATypesetCtl::exportSheet");
         _poExport->setStreamToDevice(_poOutputFile);
         _poExport->exportSheet(poSheet);
         // @ToDo use signal/slot mechanism to wait for the file
@@ -213,15 +227,54 @@ void CATypesetCtl::exportSheet(CASheet* poSheet)
         qCritical("TypesetCtl: No export was done - no exporter defined");
 }
 
+/*!
+	Writes the already exported typesetter input \a roData to disk to be run by the typesetter
+
+	This method creates a random file name as a stream file name like
+	exportSheet() does, but no exporter is run.
+*/
+void CATypesetCtl::exportData(const QByteArray& roData)
+{
+    if (_poOutputFile) {
+        delete _poOutputFile;
+        _poTypesetter->clearParameters();
+    }
+    _poOutputFile = new QTemporaryFile;
+    _poOutputFile->open();
+    _oOutputFileName = _poOutputFile->fileName();
+    // Only add output file name as first parameter file name if it is needed
+    if (true == _bOutputFileNameFirst)
+        _poTypesetter->addParameter(_oOutputFileName, false);
+    _poOutputFile->write(roData);
+    _poOutputFile->close();
+}
+
 /*!
 	Start the typesetter
 
 	This method runs the typesetter. Make sure that all the
 	required name, path and parameters are set
 
+	In server mode the job is queued in CATypesetServer. Several typesetter
+	controls can be run this way at the same time, eg. one per sheet, and
+	CATypesetServer runs up to CATypesetServer::maxJobs() of them in parallel.
+	The output and the exit code are delivered by waitForFinished().
+
 	\sa setTypesetter( const QString &roProgramName, const QString &roProgramPath )
+	\sa setServerMode( bool bServerMode )
 */
 void CATypesetCtl::runTypesetter()
+{
+    _typesetterStart = CATrace::now();
+    _iExitCode = -1;
+    _oServerOutput.clear();
+    if (_bServerMode && !_bOutputFileNameFirst && startServerTypesetter())
+        return;
+
+    execTypesetter();
+}
+
+void CATypesetCtl::execTypesetter()
 {
     // Only add output file name as first parameter file name if it is needed
     if (false == _bOutputFileNameFirst)
@@ -230,6 +283,43 @@ void CATypesetCtl::runTypesetter()
         qCritical("TypesetCtl: Running typesetter failed!");
 }
 
+/*!
+	Queues the typesetter job in CATypesetServer
+
+	The exported file is passed to the typesetter on the standard input.
+	The output file name is taken from the "o" typesetter option (see
+	setTSetOption()) and all the other parameters are passed unchanged.
+
+	Returns false, if the job couldn't be queued, so it can be run the
+	usual way.
+*/
+bool CATypesetCtl::startServerTypesetter()
+{
+    QString oOutputBase;
+    for (int i = 0; i + 1 < _oTSetOptList.size(); i += 2) {
+        if (_oTSetOptList[i].toString() == "o")
+            oOutputBase = _oTSetOptList[i + 1].toString();
+    }
+    if (oOutputBase.isEmpty())
+        return false;
+
+    QStringList oOptions = _poTypesetter->getParameters();
+    oOptions.removeAll(QString("-o") + oOutputBase);
+
+    QFile oInput(_oOutputFileName);
+    if (!oInput.open(QIODevice::ReadOnly))
+        return false;
+    QByteArray oSource = oInput.readAll();
+    oInput.close();
+
+    QString oProgram = _poTypesetter->getProgramName();
+    if (!_poTypesetter->getProgramPath().isEmpty())
+        oProgram = _poTypesetter->getProgramPath() + "/" + oProgram;
+
+    _iServerJob = CATypesetServer::instance()->startJob(oProgram, oOptions, oSource, oOutputBase);
+    return true;
+}
+
 /*!
 	Runs the conversion from postscript to pdf in the background
 
@@ -253,6 +343,21 @@ void CATypesetCtl::rcvTypesetterOutput(const QByteArray& roData)
     emit nextOutput(roData);
 }
 
+/*!
+	Returns the complete output of the last typesetter run
+
+	The typesetter output is sent by nextOutput in chunks at a limited rate
+	(see CAExternProgram::OUTPUT_INTERVAL). Use this method to show the whole
+	log on demand, eg. when the typesetter failed. Only the last
+	CAExternProgram::MAX_OUTPUT_SIZE bytes are kept.
+*/
+QByteArray CATypesetCtl::getTypesetterOutput()
+{
+    if (!_oServerOutput.isEmpty())
+        return _oServerOutput;
+    return _poTypesetter->getOutput();
+}
+
 /*!
 	Blocks until the process has finished and the finished() signal has been emitted
 	or until msecs milliseconds have passed.
@@ -262,6 +367,26 @@ void CATypesetCtl::rcvTypesetterOutput(const QByteArray& roData)
 */
 bool CATypesetCtl::waitForFinished(int iMSecs)
 {
+    CA_TRACE_ZONE("CATypesetCtl::waitForFinished");
+    if (_iServerJob != -1) {
+        int iExitCode;
+        QByteArray oOutput;
+        if (!CATypesetServer::instance()->waitForJob(_iServerJob, iMSecs, &iExitCode, &oOutput))
+            return false;
+        _iServerJob = -1;
+
+        if (iExitCode != -1) {
+            _oServerOutput = oOutput;
+            if (!oOutput.isEmpty())
+                rcvTypesetterOutput(oOutput);
+            typsetterExited(iExitCode);
+            return true;
+        }
+
+        // The server couldn't run the typesetter, run it the usual way
+        execTypesetter();
+    } else if (_bServerMode && !_poTypesetter->getRunning())
+        return true; // already finished
     return _poTypesetter->waitForFinished(iMSecs);
 }
 
@@ -278,6 +403,11 @@ bool CATypesetCtl::waitForFinished(int iMSecs)
 */
 void CATypesetCtl::typsetterExited(int iExitCode)
 {
+    // The typesetter runs in a separate process, record the whole run
+    if (CATrace::isEnabled())
+        CATrace::record("CATypesetCtl::typesetter", _typesetterStart, CATrace::now());
+    _iExitCode = iExitCode;
+
     if (iExitCode != 0)
         qCritical("TypesetCtl: Typesetter finished with code %d", iExitCode);
     else if (_bPDFConversion) {
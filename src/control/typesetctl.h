@@ -1,5 +1,5 @@
 /*!
-        Copyright (c) 2006-2019, Reinhard Katzmann, Matevž Jekovec, Canorus development team
+        Copyright (c) 2006-2020, Reinhard Katzmann, Matevž Jekovec, Canorus development team
         All Rights Reserved. See AUTHORS for a complete list of authors.
 
         Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -35,14 +35,19 @@ public:
     virtual void setTSetOption(const QVariant& roName, const QVariant& roValue, bool bSpace = false, bool bShortParam = true);
     inline void setPDFConversion(bool bConversion) { _bPDFConversion = bConversion; }
     inline void setExporter(CAExport* poExport) { _poExport = poExport; }
+    inline void setServerMode(bool bServerMode) { _bServerMode = bServerMode; }
     // Attention: .pdf automatically added and removed if it was added internally
     void exportDocument(CADocument* poDoc);
     void exportSheet(CASheet* poSheet);
+    void exportData(const QByteArray& roData);
     void runTypesetter();
 
     inline bool getPDFConversion() { return _bPDFConversion; }
+    inline bool getServerMode() { return _bServerMode; }
     inline CAExport* getExporter() { return _poExport; }
     inline QString getTempFilePath() { return _oOutputFileName; }
+    inline int getExitCode() { return _iExitCode; }
+    QByteArray getTypesetterOutput();
     bool waitForFinished(int iMSecs);
 
 signals:
@@ -56,6 +61,8 @@ protected slots:
 
 protected:
     bool createPDF();
+    void execTypesetter();
+    bool startServerTypesetter();
 
     CAExternProgram* _poTypesetter; // Transforms exported file to pdf / postscript
     CAExternProgram* _poConvPS2PDF; // Transforms postscripts files to pdf if needed
@@ -66,6 +73,11 @@ protected:
     QString _oOutputFileName; // Output file name for pdf (temporary file deletes it on close)
     bool _bPDFConversion; // Do a conversion from postscript to pdf
     bool _bOutputFileNameFirst; // File name as first parameter ? (Default: No)
+    bool _bServerMode; // Run the typesetter using CATypesetServer (Default: No)
+    int _iServerJob; // Id of the running CATypesetServer job, -1 for none
+    QByteArray _oServerOutput; // Output of the last CATypesetServer job
+    int _iExitCode; // Exit code of the last typesetter run, -1 if it didn't finish
+    qint64 _typesetterStart; // Start time of the typesetter run for tracing (see CATrace::now())
 };
 
 #endif // TYPESET_CTL_H
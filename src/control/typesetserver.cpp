@@ -0,0 +1,333 @@
+/*!
+        Copyright (c) 2020, Matevž Jekovec, Canorus development team
+        All Rights Reserved. See AUTHORS for a complete list of authors.
+
+        Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+// Includes
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QProcess>
+
+#include "control/typesetserver.h"
+#include "core/trace.h"
+
+CATypesetServer* CATypesetServer::_poInstance = nullptr;
+
+namespace {
+
+QMutex instanceMutex;
+
+}
+
+/*!	\class CATypesetServer
+	\brief Warm typesetter processes reused by the previews and printing
+
+	Most of the time of a LilyPond run is spent initializing Guile and loading the fonts before the
+	input is read. The server keeps a typesetter process already started for each combination of
+	the program and its options. The process waits for the input on the standard input ("-" as the
+	input file name), so a job only feeds it the exported source. A new process is started in
+	advance for the next run as soon as one finishes.
+
+	As the output file name is given when the process is started, the warm process writes to its own
+	temporary file name, which is renamed to the requested one afterwards.
+
+	Jobs are started by startJob() and run by a pool of worker threads, each with its own warm
+	processes, so up to maxJobs() typesetters run concurrently (eg. the sheets of a document).
+	Workers are only added when all the existing ones are busy. waitForJob() collects the result.
+	The workers are stopped and the waiting processes are killed when the application exits.
+
+	\sa CATypesetCtl::setServerMode()
+*/
+
+CATypesetServer::CATypesetServer()
+{
+    _iIdleWorkers = 0;
+    _iMaxJobs = qMax(1, QThread::idealThreadCount());
+    _iNextJob = 0;
+    _bQuit = false;
+}
+
+/*!
+	Returns the server and creates it on the first call.
+*/
+CATypesetServer* CATypesetServer::instance()
+{
+    QMutexLocker oLocker(&instanceMutex);
+    if (!_poInstance) {
+        _poInstance = new CATypesetServer();
+        qAddPostRoutine(&CATypesetServer::shutdown);
+    }
+
+    return _poInstance;
+}
+
+/*!
+	Stops the workers and kills the waiting processes. Called when the application exits.
+*/
+void CATypesetServer::shutdown()
+{
+    QMutexLocker oLocker(&instanceMutex);
+    if (!_poInstance)
+        return;
+
+    _poInstance->_oMutex.lock();
+    _poInstance->_bQuit = true;
+    _poInstance->_oJobAdded.wakeAll();
+    _poInstance->_oMutex.unlock();
+
+    for (CATypesetWorker* poWorker : _poInstance->_oWorkers) {
+        poWorker->wait();
+        delete poWorker;
+    }
+
+    // Jobs queued until now are not run
+    _poInstance->_oMutex.lock();
+    for (CATypesetJob* poJob : _poInstance->_oQueue)
+        poJob->done = true;
+    _poInstance->_oQueue.clear();
+    _poInstance->_oJobDone.wakeAll();
+    _poInstance->_oMutex.unlock();
+
+    qDeleteAll(_poInstance->_oJobs);
+    delete _poInstance;
+    _poInstance = nullptr;
+}
+
+/*!
+	Sets the maximum number of typesetters run at the same time.
+	The number of cores is used, if \a iMaxJobs is less than 1. Running workers are not stopped.
+*/
+void CATypesetServer::setMaxJobs(int iMaxJobs)
+{
+    QMutexLocker oLocker(&_oMutex);
+    _iMaxJobs = (iMaxJobs < 1) ? qMax(1, QThread::idealThreadCount()) : iMaxJobs;
+}
+
+int CATypesetServer::maxJobs()
+{
+    QMutexLocker oLocker(&_oMutex);
+    return _iMaxJobs;
+}
+
+/*!
+	Starts typesetting the \a roSource using the \a roProgram with the given \a roOptions. The result
+	is written to the files named \a roOutputBase plus the extension. The options shouldn't contain
+	the output and the input file names.
+
+	Returns the id of the job to be passed to waitForJob(). Each job has to be waited for.
+*/
+int CATypesetServer::startJob(const QString& roProgram, const QStringList& roOptions, const QByteArray& roSource, const QString& roOutputBase)
+{
+    CATypesetJob* poJob = new CATypesetJob;
+    poJob->program = roProgram;
+    poJob->options = roOptions;
+    poJob->source = roSource;
+    poJob->outputBase = roOutputBase;
+    poJob->exitCode = -1;
+    poJob->done = false;
+
+    QMutexLocker oLocker(&_oMutex);
+    int iJob = _iNextJob++;
+    _oJobs[iJob] = poJob;
+    if (_bQuit) {
+        poJob->done = true;
+        return iJob;
+    }
+
+    _oQueue << poJob;
+    if (_oQueue.size() > _iIdleWorkers && _oWorkers.size() < _iMaxJobs) {
+        CATypesetWorker* poWorker = new CATypesetWorker(this);
+        _oWorkers << poWorker;
+        poWorker->start();
+    }
+    _oJobAdded.wakeOne();
+
+    return iJob;
+}
+
+/*!
+	Blocks until the job \a iJob finished or \a iMSecs milliseconds passed (-1 for no timeout).
+
+	Returns true, if the job finished. Its typesetter exit code (-1, if it couldn't be started) is
+	stored to \a piExitCode and its output to \a poOutput, if given. Returns false on timeout and
+	the job can be waited for again.
+*/
+bool CATypesetServer::waitForJob(int iJob, int iMSecs, int* piExitCode, QByteArray* poOutput)
+{
+    CA_TRACE_ZONE("CATypesetServer::waitForJob");
+    QElapsedTimer oTimer;
+    oTimer.start();
+
+    QMutexLocker oLocker(&_oMutex);
+    CATypesetJob* poJob = _oJobs.value(iJob);
+    if (!poJob) {
+        *piExitCode = -1;
+        return true;
+    }
+
+    while (!poJob->done) {
+        if (iMSecs < 0) {
+            _oJobDone.wait(&_oMutex);
+            continue;
+        }
+
+        qint64 iLeft = iMSecs - oTimer.elapsed();
+        if (iLeft <= 0)
+            return false;
+        _oJobDone.wait(&_oMutex, static_cast<unsigned long>(iLeft));
+    }
+
+    _oJobs.remove(iJob);
+    *piExitCode = poJob->exitCode;
+    if (poOutput)
+        *poOutput = poJob->output;
+    delete poJob;
+    return true;
+}
+
+/*!
+	Typesets the \a roSource and blocks until the typesetter finished.
+	Returns the exit code of the typesetter or -1, if it couldn't be started.
+
+	\sa startJob(), waitForJob()
+*/
+int CATypesetServer::typeset(const QString& roProgram, const QStringList& roOptions, const QByteArray& roSource, const QString& roOutputBase, QByteArray* poOutput)
+{
+    CA_TRACE_ZONE("CATypesetServer::typeset");
+    int iExitCode = -1;
+    waitForJob(startJob(roProgram, roOptions, roSource, roOutputBase), -1, &iExitCode, poOutput);
+    return iExitCode;
+}
+
+QString CATypesetServer::processKey(const QString& roProgram, const QStringList& roOptions)
+{
+    return roOptions.join('\n') + '\n' + roProgram;
+}
+
+/*!
+	Renames all the files written by a process started with the output file name \a roFromBase
+	(eg. base.pdf, base-page1.svg) to the output file name \a roToBase keeping their suffixes.
+	The files are removed, if \a roToBase is empty.
+*/
+void CATypesetServer::moveOutput(const QString& roFromBase, const QString& roToBase)
+{
+    QFileInfo oFromInfo(roFromBase);
+    QDir oDir(oFromInfo.absolutePath());
+    QStringList oFiles = oDir.entryList(QStringList() << oFromInfo.fileName() + "*", QDir::Files);
+    for (const QString& roFile : oFiles) {
+        QString oFrom = oDir.absoluteFilePath(roFile);
+        if (roToBase.isEmpty()) {
+            QFile::remove(oFrom);
+            continue;
+        }
+
+        QString oTo = roToBase + roFile.mid(oFromInfo.fileName().size());
+        QFile::remove(oTo);
+        if (!QFile::rename(oFrom, oTo))
+            qWarning("TypesetServer: Could not rename %s to %s", qPrintable(oFrom), qPrintable(oTo));
+    }
+}
+
+CATypesetServer::CATypesetWorker::CATypesetWorker(CATypesetServer* poServer)
+    : _poServer(poServer)
+{
+    setObjectName("Typesetter worker");
+}
+
+void CATypesetServer::CATypesetWorker::run()
+{
+    QMutexLocker oLocker(&_poServer->_oMutex);
+    forever {
+        while (_poServer->_oQueue.isEmpty() && !_poServer->_bQuit) {
+            _poServer->_iIdleWorkers++;
+            _poServer->_oJobAdded.wait(&_poServer->_oMutex);
+            _poServer->_iIdleWorkers--;
+        }
+        if (_poServer->_bQuit)
+            break;
+        CATypesetJob* poJob = _poServer->_oQueue.takeFirst();
+        QString oKey = processKey(poJob->program, poJob->options);
+        QString oProgram = poJob->program;
+        QStringList oOptions = poJob->options;
+        oLocker.unlock();
+
+        runJob(poJob);
+
+        oLocker.relock();
+        poJob->done = true;
+        _poServer->_oJobDone.wakeAll();
+        oLocker.unlock();
+
+        // Warm up the next process while the user is looking at the result
+        if (!_oWarmProcesses.contains(oKey)) {
+            CAWarmProcess oWarm = startProcess(oProgram, oOptions);
+            if (oWarm.process)
+                _oWarmProcesses[oKey] = oWarm;
+        }
+
+        oLocker.relock();
+    }
+    oLocker.unlock();
+
+    for (const CAWarmProcess& roWarm : _oWarmProcesses) {
+        roWarm.process->kill();
+        roWarm.process->waitForFinished();
+        delete roWarm.process;
+        moveOutput(roWarm.outputBase, QString()); // remove anything the killed process might have written
+    }
+    _oWarmProcesses.clear();
+}
+
+/*!
+	Feeds the source of the job \a poJob to the warm process or a newly started one, if there is
+	none for the job's options or it has exited meanwhile.
+*/
+void CATypesetServer::CATypesetWorker::runJob(CATypesetJob* poJob)
+{
+    CAWarmProcess oWarm = _oWarmProcesses.take(processKey(poJob->program, poJob->options));
+    if (!oWarm.process || oWarm.process->state() != QProcess::Running) {
+        delete oWarm.process;
+        oWarm = startProcess(poJob->program, poJob->options);
+    }
+
+    if (!oWarm.process) {
+        qCritical("TypesetServer: Could not run typesetter %s!", qPrintable(poJob->program));
+        return;
+    }
+
+    oWarm.process->write(poJob->source);
+    oWarm.process->closeWriteChannel();
+    oWarm.process->waitForFinished(-1);
+
+    poJob->output = oWarm.process->readAll();
+    poJob->exitCode = (oWarm.process->exitStatus() == QProcess::NormalExit) ? oWarm.process->exitCode() : -1;
+    delete oWarm.process;
+
+    moveOutput(oWarm.outputBase, poJob->outputBase);
+}
+
+/*!
+	Starts the \a roProgram with the \a roOptions reading the input from the standard input and
+	writing to a new temporary output file name. Returns a null process, if it couldn't be started.
+*/
+CATypesetServer::CAWarmProcess CATypesetServer::CATypesetWorker::startProcess(const QString& roProgram, const QStringList& roOptions)
+{
+    CAWarmProcess oWarm;
+    oWarm.outputBase = QDir::tempPath() + QString("/canorus-typeset-%1-%2").arg(QCoreApplication::applicationPid()).arg(_poServer->_iNextProcess.fetchAndAddRelaxed(1));
+    oWarm.process = new QProcess();
+    oWarm.process->setProcessChannelMode(QProcess::MergedChannels);
+    oWarm.process->start(roProgram, QStringList(roOptions) << QString("-o") + oWarm.outputBase << "-");
+    if (!oWarm.process->waitForStarted()) {
+        qWarning("TypesetServer: Could not start %s, error %s", qPrintable(roProgram), qPrintable(oWarm.process->errorString()));
+        delete oWarm.process;
+        oWarm.process = nullptr;
+    }
+
+    return oWarm;
+}
@@ -0,0 +1,87 @@
+/*!
+        Copyright (c) 2020, Matevž Jekovec, Canorus development team
+        All Rights Reserved. See AUTHORS for a complete list of authors.
+
+        Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef TYPESET_SERVER_H
+#define TYPESET_SERVER_H
+
+// Includes
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+#include <QWaitCondition>
+
+// Forward declarations
+class QProcess;
+
+class CATypesetServer {
+public:
+    static CATypesetServer* instance();
+
+    int startJob(const QString& roProgram, const QStringList& roOptions, const QByteArray& roSource, const QString& roOutputBase);
+    bool waitForJob(int iJob, int iMSecs, int* piExitCode, QByteArray* poOutput = nullptr);
+    int typeset(const QString& roProgram, const QStringList& roOptions, const QByteArray& roSource, const QString& roOutputBase, QByteArray* poOutput);
+
+    void setMaxJobs(int iMaxJobs);
+    int maxJobs();
+
+private:
+    struct CATypesetJob {
+        QString program;
+        QStringList options;
+        QByteArray source;
+        QString outputBase;
+        QByteArray output;
+        int exitCode;
+        bool done;
+    };
+
+    struct CAWarmProcess {
+        QProcess* process;
+        QString outputBase; // output file name without extension the process was started with
+    };
+
+    class CATypesetWorker : public QThread {
+    public:
+        CATypesetWorker(CATypesetServer* poServer);
+
+    protected:
+        void run();
+
+    private:
+        void runJob(CATypesetJob* poJob);
+        CAWarmProcess startProcess(const QString& roProgram, const QStringList& roOptions);
+
+        CATypesetServer* _poServer;
+        QHash<QString, CAWarmProcess> _oWarmProcesses; // Started processes waiting for the input
+    };
+
+    CATypesetServer();
+    static void shutdown();
+    static QString processKey(const QString& roProgram, const QStringList& roOptions);
+    static void moveOutput(const QString& roFromBase, const QString& roToBase);
+
+    static CATypesetServer* _poInstance;
+
+    QMutex _oMutex;
+    QWaitCondition _oJobAdded;
+    QWaitCondition _oJobDone;
+    QList<CATypesetJob*> _oQueue; // Jobs waiting for a worker
+    QHash<int, CATypesetJob*> _oJobs; // All jobs not waited for yet
+    QList<CATypesetWorker*> _oWorkers;
+    int _iIdleWorkers;
+    int _iMaxJobs;
+    int _iNextJob;
+    bool _bQuit;
+
+    QAtomicInt _iNextProcess; // Number of the next started process used for its output file name
+};
+
+#endif // TYPESET_SERVER_H
@@ -0,0 +1,269 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QObject>
+#include <QTextStream>
+#include <QThread>
+
+#include "core/actionlatency.h"
+#include "core/trace.h"
+
+#include <algorithm>
+
+const int CAActionLatency::BUCKET_COUNT = 26; // up to about a minute
+const qint64 CAActionLatency::MAX_PENDING_TIME = 10000000000LL; // 10 seconds
+
+QMap<QString, CAActionLatency::CAActionStatistics> CAActionLatency::_actions;
+QString CAActionLatency::_pendingName;
+qint64 CAActionLatency::_pendingStart = 0;
+qint64 CAActionLatency::_phaseStart = 0;
+CAActionLatency::CAActionPhase CAActionLatency::_phase = CAActionLatency::UndoPhase;
+qint64 CAActionLatency::_phaseTimes[CAActionLatency::PhaseCount];
+
+namespace {
+
+QString milliseconds(qint64 nsecs)
+{
+    return QString::number(nsecs / 1e6, 'f', 1);
+}
+
+}
+
+/*!
+	\class CAActionLatency
+	\brief Latency histograms of the editor actions
+
+	Each undoable action of the user is timed from the start of its undo snapshot until the first
+	score view frame painted after it. The time is split into the phases: the undo snapshot, the
+	changes of the model, the layout of the score views and the paint. The durations are collected
+	in histograms per action and phase, so the regressions of single actions on large scores show
+	up without a profiler.
+
+	The action is named by its undo text and started by CAUndo::createUndoCommand(), undo() and
+	redo(). The following phases are started by CAUndo, CAScoreView::rebuild() and
+	CAScoreView::paintCanvas(), which also ends the action. The actions made of several undo
+	commands before the paint are merged into the first one. Actions not painted within
+	MAX_PENDING_TIME, eg. changing hidden views only, are dropped when the next action starts.
+
+	Only the actions in the main thread are timed, so the scripts run in the background don't
+	disturb them. The histograms are shown by Help->Action latencies and can be saved to a CSV
+	file there (see writeCsv()).
+
+	\sa CATrace
+*/
+
+CAActionLatency::CAHistogram::CAHistogram()
+    : count(0)
+    , total(0)
+    , buckets(BUCKET_COUNT, 0)
+{
+}
+
+void CAActionLatency::CAHistogram::add(qint64 nsecs)
+{
+    int bucket = 0;
+    for (qint64 usecs = nsecs / 1000; usecs > 1 && bucket < BUCKET_COUNT - 1; usecs >>= 1) {
+        bucket++;
+    }
+
+    count++;
+    total += nsecs;
+    buckets[bucket]++;
+}
+
+/*!
+	Returns the upper bound of the bucket containing the given \a percent of the durations in
+	nanoseconds.
+*/
+qint64 CAActionLatency::CAHistogram::percentile(int percent) const
+{
+    int needed = std::max((count * percent + 99) / 100, 1);
+    int seen = 0;
+    for (int i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= needed) {
+            return (static_cast<qint64>(2) << i) * 1000;
+        }
+    }
+    return 0;
+}
+
+bool CAActionLatency::isMainThread()
+{
+    return QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread();
+}
+
+/*!
+	Starts timing the action \a name in the undo phase.
+*/
+void CAActionLatency::beginAction(const QString& name)
+{
+    if (!isMainThread()) {
+        return;
+    }
+
+    qint64 now = CATrace::now();
+    if (!_pendingName.isEmpty() && now - _pendingStart <= MAX_PENDING_TIME) {
+        // a part of the same action, eg. several undo commands in one handler
+        beginPhase(UndoPhase);
+        return;
+    }
+
+    _pendingName = name.isEmpty() ? QString("unnamed") : name;
+    _pendingStart = now;
+    _phaseStart = now;
+    _phase = UndoPhase;
+    std::fill(_phaseTimes, _phaseTimes + PhaseCount, 0);
+}
+
+/*!
+	Ends the current phase of the pending action and starts the given \a phase. Does nothing, if no
+	action is pending.
+*/
+void CAActionLatency::beginPhase(CAActionPhase phase)
+{
+    if (_pendingName.isEmpty() || !isMainThread()) {
+        return;
+    }
+
+    qint64 now = CATrace::now();
+    if (now - _pendingStart > MAX_PENDING_TIME) {
+        _pendingName.clear(); // never painted
+        return;
+    }
+
+    _phaseTimes[_phase] += now - _phaseStart;
+    _phaseStart = now;
+    _phase = phase;
+}
+
+/*!
+	Ends the pending action and adds its phases to the histograms.
+*/
+void CAActionLatency::endAction()
+{
+    if (_pendingName.isEmpty() || !isMainThread()) {
+        return;
+    }
+
+    beginPhase(_phase);
+    if (_pendingName.isEmpty()) {
+        return; // dropped
+    }
+
+    CAActionStatistics& statistics = _actions[_pendingName];
+    qint64 total = 0;
+    for (int i = 0; i < PhaseCount; i++) {
+        statistics.phases[i].add(_phaseTimes[i]);
+        total += _phaseTimes[i];
+    }
+    statistics.total.add(total);
+
+    _pendingName.clear();
+}
+
+/*!
+	Forgets all the collected histograms.
+*/
+void CAActionLatency::clear()
+{
+    if (isMainThread()) {
+        _actions.clear();
+        _pendingName.clear();
+    }
+}
+
+/*!
+	Returns the name of the \a phase used in the report and the CSV file.
+*/
+const QString CAActionLatency::phaseName(CAActionPhase phase)
+{
+    switch (phase) {
+    case UndoPhase:
+        return "undo";
+    case ModelPhase:
+        return "model";
+    case LayoutPhase:
+        return "layout";
+    case PaintPhase:
+        return "paint";
+    case PhaseCount:
+        break;
+    }
+    return QString();
+}
+
+/*!
+	Returns the total time in nanoseconds spent in the \a phase by all the timed actions.
+*/
+qint64 CAActionLatency::phaseTime(CAActionPhase phase)
+{
+    qint64 total = 0;
+    for (QMap<QString, CAActionStatistics>::const_iterator it = _actions.constBegin(); it != _actions.constEnd(); it++) {
+        total += (phase < PhaseCount ? it.value().phases[phase].total : it.value().total.total);
+    }
+
+    return total;
+}
+
+/*!
+	Returns the number of runs, the mean and the 95th percentile in miliseconds of each action and
+	phase, one action per line.
+*/
+const QString CAActionLatency::report()
+{
+    QString s;
+    for (QMap<QString, CAActionStatistics>::const_iterator it = _actions.constBegin(); it != _actions.constEnd(); it++) {
+        const CAHistogram& total = it.value().total;
+        s += QObject::tr("%1 (%2x): %3 ms, 95% under %4 ms").arg(it.key()).arg(total.count).arg(milliseconds(total.total / total.count)).arg(milliseconds(total.percentile(95)));
+        for (int i = 0; i < PhaseCount; i++) {
+            const CAHistogram& phase = it.value().phases[i];
+            s += QString("; %1 %2/%3").arg(phaseName(static_cast<CAActionPhase>(i))).arg(milliseconds(phase.total / phase.count)).arg(milliseconds(phase.percentile(95)));
+        }
+        s += "\n";
+    }
+
+    return s;
+}
+
+/*!
+	Writes the histograms to \a fileName in CSV format: the action, the phase, the number of runs,
+	the total time in microseconds and the counts of the buckets. The bucket i is the number of
+	runs taking from 2^i to 2^(i+1) microseconds. Returns True on success.
+*/
+bool CAActionLatency::writeCsv(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "action,phase,count,total_us";
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        out << ",bucket" << i;
+    }
+    out << "\n";
+
+    for (QMap<QString, CAActionStatistics>::const_iterator it = _actions.constBegin(); it != _actions.constEnd(); it++) {
+        for (int i = 0; i <= PhaseCount; i++) {
+            const CAHistogram& h = (i < PhaseCount ? it.value().phases[i] : it.value().total);
+            QString name = it.key();
+            name.replace('"', "\"\"");
+            out << '"' << name << "\"," << (i < PhaseCount ? phaseName(static_cast<CAActionPhase>(i)) : QString("total")) << ',' << h.count << ',' << h.total / 1000;
+            for (int b = 0; b < h.buckets.size(); b++) {
+                out << ',' << h.buckets[b];
+            }
+            out << "\n";
+        }
+    }
+
+    out.flush();
+    return file.error() == QFile::NoError;
+}
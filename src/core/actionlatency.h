@@ -0,0 +1,65 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef ACTIONLATENCY_H_
+#define ACTIONLATENCY_H_
+
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+class CAActionLatency {
+public:
+    enum CAActionPhase {
+        UndoPhase, // storing the undo snapshot
+        ModelPhase, // changing the document
+        LayoutPhase, // engraving the score views
+        PaintPhase, // painting the first frame after the change
+        PhaseCount
+    };
+
+    static void beginAction(const QString& name);
+    static void beginPhase(CAActionPhase phase);
+    static void endAction();
+    static void clear();
+
+    static qint64 phaseTime(CAActionPhase phase);
+    static const QString report();
+    static bool writeCsv(const QString& fileName);
+
+    static const QString phaseName(CAActionPhase phase);
+
+    static const int BUCKET_COUNT;
+    static const qint64 MAX_PENDING_TIME;
+
+private:
+    struct CAHistogram {
+        CAHistogram();
+        void add(qint64 nsecs);
+        qint64 percentile(int percent) const;
+
+        int count;
+        qint64 total; // in nanoseconds
+        QVector<int> buckets; // bucket i counts the durations from 2^i to 2^(i+1) microseconds
+    };
+
+    struct CAActionStatistics {
+        CAHistogram phases[PhaseCount];
+        CAHistogram total;
+    };
+
+    static bool isMainThread();
+
+    static QMap<QString, CAActionStatistics> _actions;
+    static QString _pendingName; // action waiting for its first paint, empty if none
+    static qint64 _pendingStart; // start of the pending action
+    static qint64 _phaseStart; // start of the current phase of the pending action
+    static CAActionPhase _phase;
+    static qint64 _phaseTimes[PhaseCount]; // time spent in each phase of the pending action
+};
+
+#endif /* ACTIONLATENCY_H_ */
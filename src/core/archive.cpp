@@ -6,9 +6,12 @@
 */
 
 #include <QByteArray>
+#include <QFileInfo>
+#include <QQueue>
 #include <QRegExp>
 #include <QString>
 #include <QTemporaryFile>
+#include <QThread>
 #include <zlib.h>
 
 #ifdef Q_OS_WIN
@@ -17,6 +20,7 @@
 
 #include "core/archive.h"
 #include "core/tar.h"
+#include "core/taskscheduler.h"
 
 /*!
 	\class CAArchive
@@ -26,16 +30,85 @@
 	\warning This is not a CATar subclass as it does not represent a tar file, but a gzipped file. The uncompressed content is a tar file. 
 
 	See RFC 1952 for the GZIP specification.
+
+	Saving a large archive again only to store a few changed files is slow, because the whole tar
+	is compressed again. appendJournal() appends the files changed since the archive was last read
+	or written as another gzip member to the end of the file instead. The journal members carry
+	their own comment and are applied in order over the archive when it is parsed, so the file
+	reads the same as if it was written whole. A journal entry cut short, for example by a crash
+	while saving, is ignored and the archive reads as it was saved before.
+
+	The journal is dropped by the next write(), which should be done once canAppendJournal()
+	returns False. Older versions of Canorus only read the archive without its journal.
 */
 
 const int CAArchive::CHUNK = 16384;
+const int CAArchive::BLOCK_SIZE = 128 * 1024;
+const int CAArchive::DICTIONARY_SIZE = 32 * 1024;
 const QString CAArchive::COMMENT = "Canorus Archive v" + QString(CANORUS_VERSION).remove(QRegExp("[a-z]*$"));
+const QString CAArchive::JOURNAL_COMMENT = "Canorus Journal v" + QString(CANORUS_VERSION).remove(QRegExp("[a-z]*$"));
+const QString CAArchive::JOURNAL_REMOVED = ".journal-removed"; // list of the files removed by the journal entry
+const int CAArchive::MAX_JOURNAL_ENTRIES = 16;
+
+namespace {
+
+/*!
+	Inflates a single gzip member from \a arch into \a out. The compressed data already read is
+	taken from \a strm first and the data read ahead is left there for the next member. The
+	comment of the member header is stored to \a comment.
+
+	Returns True, if the whole member was read.
+*/
+bool inflateMember(z_stream* strm, QIODevice& arch, QByteArray& in, QIODevice& out, QByteArray& comment)
+{
+    QByteArray headerComment(64, '\0');
+    gz_header header = gz_header();
+    header.comment = reinterpret_cast<Bytef*>(headerComment.data());
+    header.comm_max = static_cast<uInt>(headerComment.size() - 1);
+    if (inflateGetHeader(strm, &header) != Z_OK) {
+        return false;
+    }
+
+    QByteArray buffer(in.size(), '\0');
+    int ret = Z_OK;
+    do {
+        if (strm->avail_in == 0) {
+            qint64 read = arch.read(in.data(), in.size());
+            if (read <= 0)
+                break;
+            strm->next_in = reinterpret_cast<Bytef*>(in.data());
+            strm->avail_in = static_cast<uInt>(read);
+        }
+        do {
+            strm->avail_out = static_cast<uInt>(buffer.size());
+            strm->next_out = reinterpret_cast<Bytef*>(buffer.data());
+            ret = inflate(strm, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) // buffer error is not fatal
+                return false;
+
+            qint64 produced = buffer.size() - strm->avail_out;
+            if (out.write(buffer.constData(), produced) != produced)
+                return false;
+        } while (strm->avail_out == 0 && ret != Z_STREAM_END);
+    } while (ret != Z_STREAM_END);
+
+    comment = QByteArray(headerComment.constData());
+    return ret == Z_STREAM_END;
+}
+
+}
 
 /*!
 	Creates and empty archive
 */
 CAArchive::CAArchive()
     : _err(false)
+    , _compressionLevel(Z_DEFAULT_COMPRESSION)
+    , _tarFile(nullptr)
+    , _fileSize(0)
+    , _baseSize(0)
+    , _journalSize(0)
+    , _journalEntries(0)
 {
     _tar = new CATar();
 }
@@ -45,6 +118,12 @@ CAArchive::CAArchive()
 */
 CAArchive::CAArchive(QIODevice& arch)
     : _err(false)
+    , _compressionLevel(Z_DEFAULT_COMPRESSION)
+    , _tarFile(nullptr)
+    , _fileSize(0)
+    , _baseSize(0)
+    , _journalSize(0)
+    , _journalEntries(0)
 {
     parse(arch);
 }
@@ -55,23 +134,25 @@ CAArchive::CAArchive(QIODevice& arch)
 CAArchive::~CAArchive()
 {
     delete _tar;
+    delete _tarFile; // after the tar, its entries are mapped from the file
 }
 
 /*!
 	Parse/decompress an existing archive
+
+	The archive is decompressed to a temporary file which is kept while the archive exists. The
+	tar entries are read directly from the memory mapped file. The journal entries following the
+	archive are applied over it, see appendJournal().
 */
 void CAArchive::parse(QIODevice& arch)
 {
     bool close = false;
-    int ret;
-    z_stream strm;
-    QTemporaryFile tar;
-    QBuffer in, out;
-    gz_header header = gz_header();
+    z_stream strm = z_stream();
+    QByteArray in(CHUNK, '\0');
+    QByteArray comment;
 
-    in.buffer().resize(CHUNK);
-    out.buffer().resize(CHUNK);
-    tar.open();
+    _tarFile = new QTemporaryFile();
+    _tarFile->open();
 
     if (!arch.isOpen()) {
         if (!arch.open(QIODevice::ReadOnly)) {
@@ -81,10 +162,6 @@ void CAArchive::parse(QIODevice& arch)
         close = true;
     }
 
-    header.os = getOS();
-    header.comment = new unsigned char[21];
-    header.comm_max = 21;
-
     // decompress
     arch.reset();
     strm.zalloc = Z_NULL;
@@ -92,160 +169,366 @@ void CAArchive::parse(QIODevice& arch)
     strm.opaque = Z_NULL;
     strm.avail_in = 0;
     strm.next_in = Z_NULL;
-    ret = inflateInit2(&strm, 31);
-    ret = (ret == Z_OK) ? inflateGetHeader(&strm, &header) : ret;
-    if (ret != Z_OK) //clean up, set error and return
+    if (inflateInit2(&strm, 31) != Z_OK) //clean up, set error and return
     {
-        delete[] header.comment;
         inflateEnd(&strm);
         if (close)
             arch.close();
         return;
     }
 
-    // decompress until deflate stream ends or EOF
-    do {
-        strm.avail_in = arch.read(in.buffer().data(), CHUNK);
-        if (strm.avail_in == 0)
-            break;
-        // The code purposely could cut contents of the array.
-        // For strings it would only work with ASCII code nothing else
-        strm.next_in = reinterpret_cast<Bytef*>(in.buffer().data());
-        do {
-            strm.avail_out = CHUNK;
-            // The code purposely could cut contents of the array.
-            // For strings it would only work with ASCII code nothing else
-            strm.next_out = reinterpret_cast<Bytef*>(out.buffer().data());
-            ret = inflate(&strm, Z_NO_FLUSH);
-            if ((ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) || // buffer error is not fatal
-                tar.write(out.buffer().data(), CHUNK - strm.avail_out) != CHUNK - strm.avail_out) {
-
-                _err = true;
-                break;
-            }
-        } while (strm.avail_out == 0);
-    } while (ret != Z_STREAM_END && !_err);
-    inflateEnd(&strm);
-
-    if (ret != Z_STREAM_END)
+    // decompress the archive until its deflate stream ends
+    if (!inflateMember(&strm, arch, in, *_tarFile, comment))
         _err = true;
+    _baseSize = static_cast<qint64>(strm.total_in);
 
     if (!_err) {
         QRegExp re("Canorus Archive v(\\d+\\.\\d+)");
         // The code purposely could cut contents of the array.
         // For strings it would only work with ASCII code nothing else
-        if (re.indexIn(reinterpret_cast<char*>(header.comment)) != -1)
+        if (re.indexIn(QString::fromLatin1(comment)) != -1)
             _version = re.cap(1);
         else {
             _err = true;
         }
 
-        tar.reset();
-        _tar = new CATar(tar);
+        _tarFile->flush();
+        _tarFile->reset();
+        _tar = new CATar(*_tarFile);
+    }
+
+    // apply the journal entries, the first incomplete one ends the journal
+    bool truncated = false;
+    while (!_err && (strm.avail_in || !arch.atEnd())) {
+        QBuffer journal;
+        journal.open(QIODevice::ReadWrite);
+        if (inflateReset(&strm) != Z_OK || !inflateMember(&strm, arch, in, journal, comment) || !comment.startsWith("Canorus Journal v")) {
+            truncated = true;
+            break;
+        }
+
+        journal.reset();
+        applyJournal(journal);
+        _journalEntries++;
+        _journalSize += static_cast<qint64>(strm.total_in);
     }
+    inflateEnd(&strm);
 
-    delete[] header.comment;
+    if (!_err)
+        writtenTo(arch);
+    // entries appended after the incomplete one would never be read, the next save rewrites the archive
+    if (truncated)
+        _fileName.clear();
     if (close)
         arch.close();
 }
 
+/*!
+	Applies the files of the \a journal entry over the archive.
+*/
+void CAArchive::applyJournal(QIODevice& journal)
+{
+    CATar entry(journal);
+    if (entry.error()) {
+        return;
+    }
+
+    if (entry.contains(JOURNAL_REMOVED)) {
+        QStringList removed = QString::fromUtf8(entry.file(JOURNAL_REMOVED)->readAll()).split('\n', QString::SkipEmptyParts);
+        for (const QString& name : removed) {
+            _tar->removeFile(name);
+        }
+    }
+
+    for (const QString& name : entry.fileNames()) {
+        if (name != JOURNAL_REMOVED) {
+            CAIOPtr data = entry.file(name);
+            _tar->addFile(name, *data);
+        }
+    }
+}
+
+/*!
+	\class CAArchiveBlock
+	\brief A block of the tar stream compressed in the task scheduler
+
+	CAArchive::write() cuts the tar stream into blocks of CAArchive::BLOCK_SIZE bytes and deflates
+	each of them independently into raw deflate data. The block is primed with the last
+	CAArchive::DICTIONARY_SIZE bytes of the previous block so the compression ratio stays close to
+	the single stream one. All but the last block are ended with a sync flush on a byte boundary, so
+	the concatenated blocks form a single deflate stream.
+*/
+class CAArchiveBlock : public CATask {
+public:
+    CAArchiveBlock(const QByteArray& input, const QByteArray& dictionary, int level, bool last)
+        : CATask(CATask::Normal)
+        , _input(input)
+        , _dictionary(dictionary)
+        , _level(level)
+        , _last(last)
+        , _ok(false)
+    {
+    }
+
+    void run();
+
+    inline const QByteArray& output() const { return _output; }
+    inline bool ok() const { return _ok; }
+
+private:
+    QByteArray _input;
+    QByteArray _dictionary;
+    QByteArray _output;
+    int _level;
+    bool _last;
+    bool _ok;
+};
+
+void CAArchiveBlock::run()
+{
+    z_stream strm = z_stream();
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    int ret = deflateInit2(&strm, _level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    if (ret == Z_OK && !_dictionary.isEmpty()) {
+        ret = deflateSetDictionary(&strm, reinterpret_cast<const Bytef*>(_dictionary.constData()), static_cast<uInt>(_dictionary.size()));
+    }
+
+    if (ret == Z_OK) {
+        const int flush = _last ? Z_FINISH : Z_SYNC_FLUSH;
+        int produced = 0;
+        _output.resize(static_cast<int>(deflateBound(&strm, static_cast<uLong>(_input.size()))) + 16);
+        strm.next_in = reinterpret_cast<Bytef*>(_input.data());
+        strm.avail_in = static_cast<uInt>(_input.size());
+        for (;;) {
+            if (produced == _output.size())
+                _output.resize(_output.size() * 2);
+            strm.next_out = reinterpret_cast<Bytef*>(_output.data()) + produced;
+            strm.avail_out = static_cast<uInt>(_output.size() - produced);
+            ret = deflate(&strm, flush);
+            produced = _output.size() - static_cast<int>(strm.avail_out);
+            if (ret == Z_STREAM_ERROR || (_last ? ret == Z_STREAM_END : strm.avail_out != 0))
+                break;
+        }
+        _output.resize(produced);
+        _ok = (_last ? ret == Z_STREAM_END : ret == Z_OK) && strm.avail_in == 0;
+    }
+
+    deflateEnd(&strm);
+    _input.clear();
+    _dictionary.clear();
+}
+
 /*!
 	Write the tar.gz archive into the given device.
 	Returns the number of byte written, or -1 on error.
-*/
 
+	The whole archive is written as a standard single member gzip stream and its journal is
+	dropped.
+
+	\sa setCompressionLevel(), appendJournal()
+*/
 qint64 CAArchive::write(QIODevice& dest)
 {
     bool close = false;
-    int ret, flush;
-    qint64 total = 0, read;
-    z_stream strm;
-    gz_header header = gz_header();
-    QBuffer in, out;
-
     if (!dest.isOpen()) {
         if (!dest.open(QIODevice::WriteOnly))
             return -1;
         close = true;
     }
 
+    qint64 total = writeMember(dest, _tar, COMMENT);
+    if (total >= 0) {
+        _baseSize = total;
+        _journalSize = 0;
+        _journalEntries = 0;
+        _changedFiles.clear();
+        _removedFiles.clear();
+        writtenTo(dest);
+    }
+
+    if (close)
+        dest.close();
+    return total;
+}
+
+/*!
+	Appends the files changed since the archive was last read or written to the end of the
+	archive in the device \a dest as a journal entry. The device should be opened for appending.
+	Returns the number of bytes written, or -1 on error.
+
+	\sa canAppendJournal(), write()
+*/
+qint64 CAArchive::appendJournal(QIODevice& dest)
+{
+    bool close = false;
+    if (!dest.isOpen()) {
+        if (!dest.open(QIODevice::WriteOnly | QIODevice::Append))
+            return -1;
+        close = true;
+    }
+
+    CATar entry;
+    for (const QString& name : _changedFiles) {
+        CAIOPtr data = _tar->file(name);
+        entry.addFile(name, *data);
+    }
+    if (!_removedFiles.isEmpty()) {
+        entry.addFile(JOURNAL_REMOVED, QStringList(_removedFiles.toList()).join("\n").toUtf8());
+    }
+
+    qint64 total = writeMember(dest, &entry, JOURNAL_COMMENT);
+    if (total >= 0) {
+        _journalSize += total;
+        _journalEntries++;
+        _changedFiles.clear();
+        _removedFiles.clear();
+        writtenTo(dest);
+    }
+
+    if (close)
+        dest.close();
+    return total;
+}
+
+/*!
+	Returns True, if the changes can be appended to the archive in the file \a fileName by
+	appendJournal(). This is the case, if the archive was last read from or written to the file
+	and the file wasn't changed since then. The archive should be written whole again instead,
+	once there are MAX_JOURNAL_ENTRIES journal entries or the journal is larger than the archive.
+*/
+bool CAArchive::canAppendJournal(const QString& fileName)
+{
+    QFileInfo info(fileName);
+    return !error() && !_fileName.isEmpty() && info.absoluteFilePath() == _fileName && info.size() == _fileSize
+        && _journalEntries < MAX_JOURNAL_ENTRIES && _journalSize < _baseSize;
+}
+
+/*!
+	Remembers the file the archive was read from or written to, if \a device is a file.
+*/
+void CAArchive::writtenTo(QIODevice& device)
+{
+    QFile* file = qobject_cast<QFile*>(&device);
+    if (file && !file->fileName().isEmpty()) {
+        file->flush();
+        _fileName = QFileInfo(*file).absoluteFilePath();
+        _fileSize = file->size();
+    } else {
+        _fileName.clear();
+    }
+}
+
+/*!
+	Writes the \a tar as a gzip member with the given \a comment to the open device \a dest.
+	Returns the number of bytes written, or -1 on error.
+
+	The tar is streamed in blocks which are deflated in parallel in the task scheduler the same way
+	pigz does it. The blocks are written in order as soon as they are compressed, so at most a few
+	blocks per thread are kept in memory.
+*/
+qint64 CAArchive::writeMember(QIODevice& dest, CATar* tar, const QString& comment)
+{
+    qint64 total = 0, ret;
+    bool eof = false;
+    uLong crc = crc32(0L, Z_NULL, 0);
+    quint32 size = 0; // ISIZE is the input size modulo 2^32
+    QBuffer in;
+    QByteArray previous;
+    QQueue<CAArchiveBlock*> pending;
+
     if (!dest.isWritable() || error()) {
-        if (close)
-            dest.close();
         return -1;
     }
 
-    header.os = getOS();
-    header.comment = new unsigned char[COMMENT.size() + 1];
+    // gzip member header, see RFC 1952
+    QByteArray header;
+    header.append('\x1f');
+    header.append('\x8b');
+    header.append(static_cast<char>(Z_DEFLATED));
+    header.append(static_cast<char>(0x10)); // FCOMMENT
+    header.append(4, '\0'); // MTIME not available
+    header.append(static_cast<char>(_compressionLevel == Z_BEST_COMPRESSION ? 2 : (_compressionLevel == Z_BEST_SPEED ? 4 : 0)));
+    header.append(static_cast<char>(getOS()));
     // The code purposely could cut contents of the array.
     // For strings it would only work with ASCII code nothing else
-    strcpy(reinterpret_cast<char*>(header.comment), COMMENT.toLatin1().data());
-
-    in.open(QIODevice::ReadWrite);
-    out.open(QIODevice::ReadWrite);
-    in.buffer().resize(CHUNK);
-    out.buffer().resize(CHUNK);
-    strm.zalloc = Z_NULL;
-    strm.zfree = Z_NULL;
-    strm.opaque = Z_NULL;
-    ret = deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 31, 8, Z_DEFAULT_STRATEGY);
-    ret = (ret == Z_OK) ? deflateSetHeader(&strm, &header) : ret;
-    if (ret != Z_OK) {
-        deflateEnd(&strm);
-        delete[] header.comment;
-        if (close)
-            dest.close();
-        in.close();
-        out.close();
+    header.append(comment.toLatin1());
+    header.append('\0');
+    if (dest.write(header) != header.size()) {
         return -1;
     }
+    total += header.size();
 
-    //compress until EOF
-    _tar->open(in);
-    do {
-        in.reset();
-        ret = _tar->write(in, CHUNK);
-        if (ret == -1) {
-            _err = true;
-            break;
-        }
-        flush = _tar->eof(in) ? Z_FINISH : Z_NO_FLUSH;
-        strm.avail_in = ret;
-        // The code purposely could cut contents of the array.
-        // For strings it would only work with ASCII code nothing else
-        strm.next_in = reinterpret_cast<unsigned char*>(in.buffer().data());
-        do {
-            strm.avail_out = CHUNK;
-            // The code purposely could cut contents of the array.
-            // For strings it would only work with ASCII code nothing else
-            strm.next_out = reinterpret_cast<unsigned char*>(out.buffer().data());
-            ret = deflate(&strm, flush);
-            if (ret == Z_STREAM_ERROR)
-                _err = true;
-            read = (!_err) ? dest.write(out.buffer().data(), CHUNK - strm.avail_out) : 0;
-            if (_err || (read != CHUNK - strm.avail_out)) {
+    const int maxPending = qMax(CATaskScheduler::instance()->workerCount(), 1) * 2;
+
+    in.open(QIODevice::ReadWrite);
+    tar->open(in);
+    while (!_err && (!eof || !pending.isEmpty())) {
+        if (!eof && pending.size() < maxPending) {
+            in.buffer().clear();
+            in.reset();
+            ret = tar->write(in, BLOCK_SIZE);
+            if (ret < 0) {
                 _err = true;
                 break;
             }
-            total += read;
-        } while (strm.avail_out == 0);
-        if (strm.avail_in != 0)
+            eof = tar->eof(in);
+
+            QByteArray block = in.buffer();
+            crc = crc32(crc, reinterpret_cast<const Bytef*>(block.constData()), static_cast<uInt>(block.size()));
+            size += static_cast<quint32>(block.size());
+
+            CAArchiveBlock* job = new CAArchiveBlock(block, previous, _compressionLevel, eof);
+            previous = block.right(DICTIONARY_SIZE);
+            pending.enqueue(job);
+            CATaskScheduler::instance()->start(job);
+            continue;
+        }
+
+        // Write the oldest block, once the pipeline is full or the whole tar is read.
+        CAArchiveBlock* job = pending.dequeue();
+        job->wait();
+        if (!job->ok() || dest.write(job->output()) != job->output().size()) {
             _err = true;
-    } while (flush != Z_FINISH && !_err);
+        } else {
+            total += job->output().size();
+        }
+        delete job;
+    }
 
-    deflateEnd(&strm);
-    if (ret != Z_STREAM_END)
-        _err = true;
+    // the blocks after an error are not needed anymore
+    for (CAArchiveBlock* job : pending) {
+        job->cancel();
+        job->wait();
+    }
+    qDeleteAll(pending);
 
-    delete[] header.comment;
-    if (close)
-        dest.close();
-    _tar->close(in);
+    if (!_err) {
+        QByteArray trailer;
+        for (int i = 0; i < 4; i++)
+            trailer.append(static_cast<char>((crc >> (8 * i)) & 0xff));
+        for (int i = 0; i < 4; i++)
+            trailer.append(static_cast<char>((size >> (8 * i)) & 0xff));
+        if (dest.write(trailer) != trailer.size())
+            _err = true;
+        total += trailer.size();
+    }
+
+    tar->close(in);
     in.close();
-    out.close();
     return (_err) ? -1 : total;
 }
 
+/*!
+	Sets the zlib compression \a level used by write(), from 0 (no compression) to 9 (best
+	compression). Negative values select the zlib default.
+*/
+void CAArchive::setCompressionLevel(int level)
+{
+    _compressionLevel = (level < 0) ? Z_DEFAULT_COMPRESSION : qMin(level, Z_BEST_COMPRESSION);
+}
+
 /*!
 	Return an operating system ID for use in a GZip header. 
 	See RFC 1952.
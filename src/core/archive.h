@@ -1,5 +1,5 @@
 /*! 
-	Copyright (c) 2007, Itay Perl, Canorus development team
+	Copyright (c) 2007-2020, Itay Perl, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 	
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -10,10 +10,12 @@
 
 #include "core/tar.h"
 #include <QBuffer>
+#include <QSet>
 #include <iostream>
 
 class QByteArray;
 class QString;
+class QTemporaryFile;
 
 class CAArchive {
 public:
@@ -22,25 +24,41 @@ public:
     qint64 write(QIODevice& dest);
     virtual ~CAArchive();
 
+    qint64 appendJournal(QIODevice& dest);
+    bool canAppendJournal(const QString& fileName);
+    inline int journalEntries() { return _journalEntries; }
+
     // interface to CATar
     inline bool addFile(const QString& filename, QIODevice& data)
     {
-        if (!error())
-            return _tar->addFile(filename, data);
-        else
+        if (!error() && _tar->addFile(filename, data)) {
+            fileChanged(filename);
+            return true;
+        } else
             return false;
     }
     inline bool addFile(const QString& filename, QByteArray data)
     {
-        if (!error())
-            return _tar->addFile(filename, data);
-        else
+        if (!error() && _tar->addFile(filename, data)) {
+            fileChanged(filename);
+            return true;
+        } else
             return false;
     }
     inline void removeFile(const QString& filename)
     {
-        if (!error())
+        if (!error() && _tar->contains(filename)) {
             _tar->removeFile(filename);
+            fileRemoved(filename);
+        }
+    }
+    inline bool contains(const QString& filename)
+    {
+        return !error() && _tar->contains(filename);
+    }
+    inline QStringList fileNames()
+    {
+        return error() ? QStringList() : _tar->fileNames();
     }
     inline CAIOPtr file(const QString& filename)
     {
@@ -51,17 +69,49 @@ public:
     }
     inline bool error() { return _err || _tar->error(); }
     inline const QString& version() { return _version; }
+    inline int compressionLevel() const { return _compressionLevel; }
+    void setCompressionLevel(int level);
+
+    static const int MAX_JOURNAL_ENTRIES;
 
 protected:
     static const int CHUNK;
+    static const int BLOCK_SIZE;
+    static const int DICTIONARY_SIZE;
     static const QString COMMENT;
+    static const QString JOURNAL_COMMENT;
+    static const QString JOURNAL_REMOVED;
 
     QString _version;
     bool _err;
+    int _compressionLevel; // zlib compression level used by write()
     void parse(QIODevice&);
+    void applyJournal(QIODevice& journal);
+    qint64 writeMember(QIODevice& dest, CATar* tar, const QString& comment);
+    void writtenTo(QIODevice& dest);
     int getOS();
 
+    inline void fileChanged(const QString& filename)
+    {
+        _changedFiles << filename;
+        _removedFiles.remove(filename);
+    }
+    inline void fileRemoved(const QString& filename)
+    {
+        _changedFiles.remove(filename);
+        _removedFiles << filename;
+    }
+
     CATar* _tar;
+    QTemporaryFile* _tarFile; // uncompressed tar of the parsed archive, the entries are mapped from it
+
+    QSet<QString> _changedFiles; // added or replaced since the archive was last read or written
+    QSet<QString> _removedFiles; // removed since the archive was last read or written
+    QString _fileName; // file the archive was last read from or written to, empty if none
+    qint64 _fileSize; // size of the file when it was last read or written
+    qint64 _baseSize; // compressed size of the archive without the journal
+    qint64 _journalSize; // compressed size of the journal entries
+    int _journalEntries; // number of the journal entries appended to the archive
 };
 
 #endif /* ARCHIVE_H_ */
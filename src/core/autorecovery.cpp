@@ -11,9 +11,14 @@
 #include "core/settings.h"
 #include "export/canorusmlexport.h"
 #include "import/canorusmlimport.h"
+#include "score/document.h"
+#include "score/resource.h"
+#include <QBuffer>
+#include <QDir>
 #include <QFile>
 #include <QMessageBox>
-#include <QSet>
+#include <QSaveFile>
+#include <QSettings>
 #include <QTimer>
 
 /*!
@@ -27,7 +32,10 @@
 	cleanupRecovery() method.
 
 	Otherwise Canorus looks for recovery files then next time it's executed and opens them
-	automatically by calling openRecovery(). After recovering the files documents are marked
+	automatically by calling openRecovery(). Each recovery file is opened in the background in
+	its own main window. The title and the modification date of the documents are stored next to
+	the recovery files (recovery0.info etc.), so they are listed before the documents are read.
+	After recovering the files documents are marked
 	as modified (so user needs to resave them, if closing the document by accident) and
 	a special short-interval singleshot timer (see _saveAfterRecoveryInterval) is started
 	to resave recovery files. This is usually needed when a user finds a bug, immediately
@@ -37,7 +45,8 @@
 	manually deleted.
 
 	Call saveRecovery() to save the currently opened documents to recovery files. The
-	autosave timer's signal is connected to this slot.
+	autosave timer's signal is connected to this slot. Documents are copied and exported to
+	binary CanorusML in the background, so the editor is not blocked while saving.
 
 	Settings class should already be initialized when creating instance of this class.
 */
@@ -47,7 +56,9 @@
 */
 CAAutoRecovery::CAAutoRecovery()
     : _saveAfterRecoveryTimer(nullptr)
+    , _recoveryCount(0)
 {
+    _lastSaveTime = -1;
     _autoRecoveryTimer = new QTimer(this);
     _autoRecoveryTimer->setSingleShot(false);
     connect(_autoRecoveryTimer, SIGNAL(timeout()), this, SLOT(saveRecovery()));
@@ -56,6 +67,7 @@ CAAutoRecovery::CAAutoRecovery()
 
 CAAutoRecovery::~CAAutoRecovery()
 {
+    discardRecoveryJobs();
     delete _autoRecoveryTimer;
 }
 
@@ -72,89 +84,272 @@ void CAAutoRecovery::updateTimer()
 
 /*!
 	Saves the currently opened documents into settings folder named recovery0, recovery1 etc.
+
+	A snapshot of each document (see CADocument::snapshot()) is exported to binary CanorusML in a
+	separate thread. The snapshot shares the unchanged staffs with the undo history, so only the
+	staffs changed since the last snapshot are copied in the main thread. The rest is restored by
+	the export thread, when it reads the snapshot.
+	When the export finishes, onRecoveryExported() replaces the recovery file atomically, so
+	a crash while saving never leaves a half-written recovery file behind. If the previous
+	exports haven't finished yet, this call is skipped.
+
+	Documents which haven't changed since their recovery file was written (see
+	CADocument::generation()) are not exported again.
+
+	The attached resources are copied next to the recovery file by saveRecoveryResources() before
+	the export is started.
 */
 void CAAutoRecovery::saveRecovery()
 {
-    cleanupRecovery();
+    if (!_recoveryJobs.isEmpty() || !_restoreJobs.isEmpty()) {
+        return; // the recovery files are still being read by openRecovery()
+    }
+
+    // keep the order of the main windows, so the documents keep their recovery files
+    QList<CADocument*> documents;
+    for (int i = 0; i < CACanorus::mainWinList().size(); i++) {
+        CADocument* doc = CACanorus::mainWinList()[i]->document();
+        if (doc && !documents.contains(doc))
+            documents << doc;
+    }
+
+    _recoveryCount = documents.size();
+    if (documents.isEmpty()) {
+        cleanupRecovery();
+        return;
+    }
+    _recoveredGenerations.resize(documents.size());
+    _saveTimer.start();
+
+    for (int c = 0; c < documents.size(); c++) {
+        if (_recoveredGenerations[c] == documents[c]->generation() && QFile::exists(CASettings::defaultSettingsPath() + "/recovery" + QString::number(c))) {
+            continue; // not changed since the last recovery
+        }
+
+        CARecoveryJob job;
+        job.snapshot = documents[c]->snapshot();
+        job.buffer = new QBuffer();
+        job.fileName = CASettings::defaultSettingsPath() + "/recovery" + QString::number(c);
+        job.index = c;
+        job.generation = documents[c]->generation();
+
+        saveRecoveryResources(job.snapshot, job.fileName);
+
+        /// \todo replace raw pointer with shared or unique pointer
+        CACanorusMLExport* save = new CACanorusMLExport();
+        save->setBinary(true);
+        save->setResourceDir("recovery" + QString::number(c) + " files");
+        save->setStreamToDevice(job.buffer);
+        _recoveryJobs[save] = job;
+        connect(save, SIGNAL(finished()), this, SLOT(onRecoveryExported()));
+        save->exportDocument(job.snapshot);
+    }
+
+    if (_recoveryJobs.isEmpty()) {
+        removeStaleRecovery();
+    }
+}
+
+/*!
+	Called in the main thread when the background export of a recovery file has finished.
+	Writes the exported content to the recovery file and removes the recovery files of the
+	documents which were closed in the meantime.
+*/
+void CAAutoRecovery::onRecoveryExported()
+{
+    CACanorusMLExport* save = static_cast<CACanorusMLExport*>(sender());
+    if (!_recoveryJobs.contains(save)) {
+        return;
+    }
 
-    QSet<CADocument*> documents;
-    for (int i = 0; i < CACanorus::mainWinList().size(); i++)
-        documents << CACanorus::mainWinList()[i]->document();
+    CARecoveryJob job = _recoveryJobs.take(save);
+    if (save->status() == 0) {
+        QSaveFile file(job.fileName);
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write(job.buffer->data());
+            if (file.commit() && job.index < _recoveredGenerations.size()) {
+                _recoveredGenerations[job.index] = job.generation;
 
-    int c = 0;
-    for (QSet<CADocument*>::const_iterator i = documents.constBegin(); i != documents.constEnd(); i++, c++) {
-        CACanorusMLExport save;
-        save.setStreamToFile(CASettings::defaultSettingsPath() + "/recovery" + QString::number(c));
-        save.exportDocument(*i);
-        save.wait();
+                QSettings info(job.fileName + ".info", QSettings::IniFormat);
+                info.setValue("title", job.snapshot->title());
+                info.setValue("modified", job.snapshot->dateLastModified());
+            }
+        }
+    }
+
+    save->deleteLater();
+    delete job.buffer;
+    deleteRecoverySnapshot(job.snapshot);
+
+    if (_recoveryJobs.isEmpty()) {
+        _lastSaveTime = _saveTimer.elapsed(); // shown in the performance panel
+        removeStaleRecovery();
     }
 }
 
+/*!
+	Removes the recovery files of the documents which are not opened anymore.
+*/
+void CAAutoRecovery::removeStaleRecovery()
+{
+    for (int i = _recoveryCount; QFile::exists(CASettings::defaultSettingsPath() + "/recovery" + QString::number(i)); i++) {
+        removeRecovery(CASettings::defaultSettingsPath() + "/recovery" + QString::number(i));
+    }
+}
+
+/*!
+	Waits for the running background exports and throws their results away.
+*/
+void CAAutoRecovery::discardRecoveryJobs()
+{
+    for (QHash<CACanorusMLExport*, CARecoveryJob>::iterator i = _recoveryJobs.begin(); i != _recoveryJobs.end(); i++) {
+        disconnect(i.key(), nullptr, this, nullptr);
+        i.key()->wait();
+        delete i.key();
+        delete i.value().buffer;
+        deleteRecoverySnapshot(i.value().snapshot);
+    }
+    _recoveryJobs.clear();
+}
+
 /*!
 	Deletes recovery files.
 	This method is usually called when successfully quiting Canorus.
 */
 void CAAutoRecovery::cleanupRecovery()
 {
+    discardRecoveryJobs();
+    _recoveredGenerations.clear();
+
     for (int i = 0; QFile::exists(CASettings::defaultSettingsPath() + "/recovery" + QString::number(i)); i++) {
-        QString fileName = CASettings::defaultSettingsPath() + "/recovery" + QString::number(i);
-        QFile::remove(fileName);
-        if (QDir(fileName + " files").exists()) {
-            foreach (QString entry, QDir(fileName + " files").entryList(QDir::Files)) {
-                QFile::remove(fileName + " files/" + entry);
-            }
-            QDir().rmdir(fileName + " files");
+        removeRecovery(CASettings::defaultSettingsPath() + "/recovery" + QString::number(i));
+    }
+}
+
+/*!
+	Copies the attached resources of the document \a doc to the "<fileName> files" directory next
+	to the recovery file \a fileName, the same as CACanorusMLExport does when saving to a file. The
+	resources already copied there are not copied again.
+
+	The resources are shared by the snapshot with the document, so this is called in the main
+	thread.
+*/
+void CAAutoRecovery::saveRecoveryResources(CADocument* doc, const QString& fileName)
+{
+    QDir dir(fileName + " files");
+    for (const std::shared_ptr<CAResource>& r : doc->resourceList()) {
+        if (r->isLinked()) {
+            continue;
+        }
+
+        if (!dir.exists()) {
+            QDir().mkpath(dir.absolutePath());
+        }
+        QString target = dir.absoluteFilePath(r->storedFileName());
+        if (!QFile::exists(target)) {
+            r->copy(target);
         }
     }
 }
 
 /*!
-	Searches for any not-cleaned up recovery files and opens them.
-	Also shows the recovery message.
+	Deletes the \a snapshot of the document after its export. The resources are shared with the
+	document, deleting them would remove them there too.
+*/
+void CAAutoRecovery::deleteRecoverySnapshot(CADocument* snapshot)
+{
+    while (snapshot->resourceList().size()) {
+        snapshot->removeResource(snapshot->resourceList().first());
+    }
+    delete snapshot;
+}
+
+/*!
+	Deletes the recovery file \a fileName and its resources directory.
+*/
+void CAAutoRecovery::removeRecovery(const QString& fileName)
+{
+    QFile::remove(fileName);
+    QFile::remove(fileName + ".info");
+    if (QDir(fileName + " files").exists()) {
+        foreach (QString entry, QDir(fileName + " files").entryList(QDir::Files)) {
+            QFile::remove(fileName + " files/" + entry);
+        }
+        QDir().rmdir(fileName + " files");
+    }
+}
+
+/*!
+	Searches for any not-cleaned up recovery files and opens each of them in a new main window.
+	The recovery message listing the documents is shown immediately, the documents are read in
+	the background. The recovery files are removed by onRecoveryRestored(), when all of them are
+	read.
 */
 void CAAutoRecovery::openRecovery()
 {
     QString documents;
     for (int i = 0; QFile::exists(CASettings::defaultSettingsPath() + "/recovery" + QString::number(i)); i++) {
-        CACanorusMLImport open;
-        open.setStreamFromFile(CASettings::defaultSettingsPath() + "/recovery" + QString::number(i));
-        open.importDocument();
-        open.wait(_recoveryTimeout);
-        if (open.importedDocument()) {
-            open.importedDocument()->setModified(true); // warn that the file is unsaved, if closing
-            open.importedDocument()->setFileName("");
-
-            // ToDo: Only one place of mainwin creation / initialization
-            CAMainWin* mainWin = new CAMainWin();
-
-            // Init dialogs etc.
-            CACanorus::initCommonGUI(mainWin->uiSaveDialog,
-                mainWin->uiOpenDialog,
-                mainWin->uiExportDialog,
-                mainWin->uiImportDialog);
-
-            documents.append(tr("- Document %1 last modified on %2.").arg(open.importedDocument()->title()).arg(open.importedDocument()->dateLastModified().toString()) + "\n");
-            mainWin->openDocument(open.importedDocument());
-            mainWin->show();
+        QString fileName = CASettings::defaultSettingsPath() + "/recovery" + QString::number(i);
+        QSettings info(fileName + ".info", QSettings::IniFormat);
+        if (info.contains("title")) {
+            documents.append(tr("- Document %1 last modified on %2.").arg(info.value("title").toString()).arg(info.value("modified").toDateTime().toString()) + "\n");
+        } else {
+            documents.append(tr("- Document %1.").arg(i + 1) + "\n");
         }
+
+        /// \todo replace raw pointer with shared or unique pointer
+        CACanorusMLImport* open = new CACanorusMLImport();
+        open->setStreamFromFile(fileName);
+        _restoreJobs << open;
+        connect(open, SIGNAL(importDone(int)), this, SLOT(onRecoveryRestored())); // before the main window opens the document
+
+        // ToDo: Only one place of mainwin creation / initialization
+        CAMainWin* mainWin = new CAMainWin();
+        mainWin->openImport(std::unique_ptr<CAImport>(open));
+        mainWin->show();
     }
 
-    cleanupRecovery();
+    if (documents.isEmpty()) {
+        cleanupRecovery();
+        return;
+    }
+
+    QMessageBox::information(
+        CACanorus::mainWinList()[CACanorus::mainWinList().size() - 1],
+        tr("Document recovery"),
+        tr("Previous session of Canorus was unexpectedly closed.\n\n\
+The following documents are being recovered:\n%1")
+            .arg(documents));
+}
 
-    if (!documents.isEmpty()) {
-        if (_saveAfterRecoveryTimer)
-            delete _saveAfterRecoveryTimer;
-        _saveAfterRecoveryTimer = new QTimer();
-        _saveAfterRecoveryTimer->setInterval(4000);
-        _saveAfterRecoveryTimer->setSingleShot(true);
-        connect(_saveAfterRecoveryTimer, SIGNAL(timeout()), this, SLOT(saveRecovery()));
-        _saveAfterRecoveryTimer->start();
-
-        QMessageBox::information(
-            CACanorus::mainWinList()[CACanorus::mainWinList().size() - 1],
-            tr("Document recovery"),
-            tr("Previous session of Canorus was unexpectedly closed.\n\n\
-The following documents were successfully recovered:\n%1")
-                .arg(documents));
+/*!
+	Called when a recovery file opened by openRecovery() was read. The recovered document is
+	marked as modified and unnamed before its main window opens it. When all the recovery files
+	are read, they are removed and resaved soon after.
+*/
+void CAAutoRecovery::onRecoveryRestored()
+{
+    CAImport* open = static_cast<CAImport*>(sender());
+    if (!_restoreJobs.removeOne(open)) {
+        return;
+    }
+
+    if (open->status() == 0 && open->importedDocument()) {
+        open->importedDocument()->setModified(true); // warn that the file is unsaved, if closing
+        open->importedDocument()->setFileName("");
     }
+
+    if (!_restoreJobs.isEmpty()) {
+        return;
+    }
+
+    cleanupRecovery();
+
+    if (_saveAfterRecoveryTimer)
+        delete _saveAfterRecoveryTimer;
+    _saveAfterRecoveryTimer = new QTimer();
+    _saveAfterRecoveryTimer->setInterval(4000);
+    _saveAfterRecoveryTimer->setSingleShot(true);
+    connect(_saveAfterRecoveryTimer, SIGNAL(timeout()), this, SLOT(saveRecovery()));
+    _saveAfterRecoveryTimer->start();
 }
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -8,9 +8,19 @@
 #ifndef AUTOSAVE_H_
 #define AUTOSAVE_H_
 
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
 #include <QObject>
+#include <QVector>
 
+#include <memory>
+
+class QBuffer;
 class QTimer;
+class CACanorusMLExport;
+class CAImport;
+class CADocument;
 
 class CAAutoRecovery : public QObject {
     Q_OBJECT
@@ -20,16 +30,40 @@ public:
     ~CAAutoRecovery();
     void updateTimer();
     void openRecovery();
+    inline qint64 lastSaveTime() { return _lastSaveTime; } // in miliseconds, -1 if nothing was saved yet
 
 public slots:
     void cleanupRecovery();
     void saveRecovery();
 
+private slots:
+    void onRecoveryExported();
+    void onRecoveryRestored();
+
 private:
+    struct CARecoveryJob {
+        CADocument* snapshot; // snapshot of the document being exported, read by the export thread only
+        QBuffer* buffer; // exported CanorusML
+        QString fileName; // recovery file name
+        int index; // number of the recovery file
+        quint64 generation; // generation of the document when the snapshot was made
+    };
+
+    void saveRecoveryResources(CADocument* doc, const QString& fileName);
+    void deleteRecoverySnapshot(CADocument* snapshot);
+    void removeRecovery(const QString& fileName);
+    void removeStaleRecovery();
+    void discardRecoveryJobs();
+
+    QHash<CACanorusMLExport*, CARecoveryJob> _recoveryJobs; // exports currently running in the background
+    int _recoveryCount; // number of recovery files written by the last saveRecovery()
+    QVector<quint64> _recoveredGenerations; // document generations stored in each recovery file
+    QList<CAImport*> _restoreJobs; // recovery files being opened by openRecovery(), owned by their main windows
+
     QTimer* _autoRecoveryTimer;
     QTimer* _saveAfterRecoveryTimer;
-
-    const int _recoveryTimeout = 120000;
+    QElapsedTimer _saveTimer; // started by saveRecovery(), when the exports are started
+    qint64 _lastSaveTime; // from starting the exports until the last recovery file was written
 };
 
 #endif /* AUTOSAVE_H_ */
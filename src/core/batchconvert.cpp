@@ -0,0 +1,395 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QObject>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include "core/batchconvert.h"
+#include "core/fileformats.h"
+
+#include "export/canexport.h"
+#include "export/canorusmlexport.h"
+#include "export/lilypondexport.h"
+#include "export/midiexport.h"
+#include "export/musicxmlexport.h"
+#include "export/mxlexport.h"
+#include "export/pdfexport.h"
+#include "import/canimport.h"
+#include "import/canorusmlimport.h"
+#include "import/midiimport.h"
+#include "import/musicxmlimport.h"
+#include "import/mxlimport.h"
+
+#include "score/document.h"
+#include "score/sheet.h"
+
+#include <iostream>
+
+const QString CABatchConvert::CONVERT_SWITCH = "--convert-to";
+const QString CABatchConvert::OUTPUT_DIR_SWITCH = "--output-dir";
+const QString CABatchConvert::JOBS_SWITCH = "--jobs";
+const QString CABatchConvert::TRANSFORM_SWITCH = "--transform";
+const QString CABatchConvert::TRANSFORM_SCRIPT_SWITCH = "--transform-script";
+
+namespace {
+
+struct CABatchFormat {
+    const char* name;
+    const char* extension;
+    bool wholeDocument;
+};
+
+const CABatchFormat batchFormats[] = {
+    { "can", "can", true },
+    { "can-binary", "can", true },
+    { "canorusml", "xml", true },
+    { "lilypond", "ly", false },
+    { "musicxml", "musicxml", false },
+    { "mxl", "mxl", false },
+    { "midi", "mid", true },
+    { "pdf", "pdf", true }
+};
+
+}
+
+/*!
+	\class CABatchConvertJob
+	\brief Converts a single document on the batch conversion thread pool
+*/
+class CABatchConvertJob : public QRunnable {
+public:
+    CABatchConvertJob(CABatchConvert* convert, const QString& fileName)
+        : _convert(convert)
+        , _fileName(fileName)
+    {
+    }
+
+    void run() { _convert->convert(_fileName); }
+
+private:
+    CABatchConvert* _convert;
+    QString _fileName;
+};
+
+/*!
+	\class CABatchConvert
+	\brief Headless conversion of documents passed in the command line
+
+	Canorus is run in the batch mode when the --convert-to switch is passed in the command line, for
+	example:
+	\code
+	  canorus --convert-to=lilypond --output-dir=out --jobs=4 first.can second.xml
+	\endcode
+
+	No main windows, fonts or other user interface parts are initialized in this mode. Each document
+	is read by the CAImport filter matching its file extension and written by the CAExport filter of
+	the requested format. The documents are converted in parallel, one document per worker of the
+	thread pool.
+
+	Formats which only export sheets (LilyPond, MusicXML and MXL) write each sheet into its own file with
+	the sheet number appended to the file name, if the document contains more than one sheet.
+
+	The --transform and --transform-script switches change each document before it is exported, see
+	CABatchTransform. They can be repeated and are applied in the given order. If no target format is
+	given, the transformed documents are saved by the binary Canorus writer. A document is never
+	overwritten, so pass an output directory when fixing the archived .can files:
+	\code
+	  canorus --transform=transpose:-2@Clarinet --transform-script=fix.py --output-dir=fixed *.can
+	\endcode
+
+	\sa CACanorus::initMain()
+*/
+
+CABatchConvert::CABatchConvert()
+    : _wholeDocument(true)
+    , _jobs(QThread::idealThreadCount())
+    , _failed(0)
+{
+}
+
+/*!
+	Returns True, if the batch conversion switch is passed in the command line.
+	This is checked before the application and the user interface are initialized.
+*/
+bool CABatchConvert::isBatchMode(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        for (const QString& batchSwitch : { CONVERT_SWITCH, TRANSFORM_SWITCH, TRANSFORM_SCRIPT_SWITCH }) {
+            if (QString(argv[i]) == batchSwitch || QString(argv[i]).startsWith(batchSwitch + "=")) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+/*!
+	Reads the target format, the output directory, the number of jobs and the files to convert
+	from the given command line \a arguments. The switch values can be passed either as
+	"--switch=value" or "--switch value".
+
+	Returns False and prints the usage, if the arguments are invalid.
+*/
+bool CABatchConvert::parseArguments(const QStringList& arguments)
+{
+    for (int i = 1; i < arguments.size(); i++) {
+        QString arg = arguments[i];
+        QString value;
+        int eq = arg.indexOf('=');
+        if (arg.startsWith("--")) {
+            if (eq != -1) {
+                value = arg.mid(eq + 1);
+                arg = arg.left(eq);
+            } else if ((arg == CONVERT_SWITCH || arg == OUTPUT_DIR_SWITCH || arg == JOBS_SWITCH || arg == TRANSFORM_SWITCH || arg == TRANSFORM_SCRIPT_SWITCH) && i + 1 < arguments.size()) {
+                value = arguments[++i];
+            }
+        }
+
+        if (arg == CONVERT_SWITCH) {
+            _format = value.toLower();
+        } else if (arg == OUTPUT_DIR_SWITCH) {
+            _outputDir = value;
+        } else if (arg == JOBS_SWITCH) {
+            bool ok;
+            _jobs = value.toInt(&ok);
+            if (!ok || _jobs < 1) {
+                report(QObject::tr("Invalid number of jobs: %1").arg(value), true);
+                return false;
+            }
+        } else if (arg == TRANSFORM_SWITCH || arg == TRANSFORM_SCRIPT_SWITCH) {
+            CABatchTransform transform = (arg == TRANSFORM_SWITCH ? CABatchTransform::fromString(value) : CABatchTransform::fromScript(value));
+            if (!transform.isValid()) {
+                report(QObject::tr("Invalid transform: %1").arg(value), true);
+                return false;
+            }
+            _transforms << transform;
+        } else if (!arg.startsWith('-')) {
+            _files << arg;
+        }
+    }
+
+    if (_format.isEmpty() && !_transforms.isEmpty()) {
+        _format = "can-binary";
+    }
+
+    for (const CABatchFormat& format : batchFormats) {
+        if (_format == format.name) {
+            _extension = format.extension;
+            _wholeDocument = format.wholeDocument;
+        }
+    }
+
+    if (_extension.isEmpty() || _files.isEmpty()) {
+        printUsage();
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+	Converts all the files passed in the command line and waits until they are finished.
+
+	Returns the exit code of the application: 0, if all the documents were converted successfully,
+	or 1, if any of them failed.
+*/
+int CABatchConvert::exec()
+{
+    if (!_outputDir.isEmpty() && !QDir().mkpath(_outputDir)) {
+        report(QObject::tr("Cannot create the output directory %1").arg(_outputDir), true);
+        return 1;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(_jobs);
+    for (const QString& fileName : _files) {
+        pool.start(new CABatchConvertJob(this, fileName));
+    }
+    pool.waitForDone();
+
+    return (_failed.load() ? 1 : 0);
+}
+
+/*!
+	Imports the document \a fileName and exports it to the target format.
+	This function is called by the worker threads.
+*/
+void CABatchConvert::convert(const QString& fileName)
+{
+    QFileInfo info(fileName);
+    if (!info.isReadable()) {
+        report(QObject::tr("%1: The file cannot be read").arg(fileName), true);
+        _failed.ref();
+        return;
+    }
+
+    CAImport* import = createImport(fileName);
+    if (!import) {
+        report(QObject::tr("%1: Unknown file format").arg(fileName), true);
+        _failed.ref();
+        return;
+    }
+
+    import->setStreamFromFile(info.absoluteFilePath());
+    import->importDocument();
+    import->wait();
+
+    CADocument* document = import->importedDocument();
+    if (import->status() < 0 || !document) {
+        report(QString("%1: %2").arg(fileName, import->readableStatus()), true);
+        delete import;
+        delete document;
+        _failed.ref();
+        return;
+    }
+    delete import;
+
+    for (const CABatchTransform& transform : _transforms) {
+        QString error;
+        if (!transform.apply(document, fileName, &error)) {
+            report(QString("%1: %2").arg(fileName, error), true);
+            delete document;
+            _failed.ref();
+            return;
+        }
+    }
+
+    int sheetCount = (_wholeDocument ? 1 : document->sheetList().size());
+    if (!sheetCount) {
+        report(QObject::tr("%1: The document contains no sheets").arg(fileName), true);
+        _failed.ref();
+    }
+
+    for (int i = 0; i < sheetCount; i++) {
+        QString outputName = outputFileName(fileName, i, sheetCount);
+        if (outputName == info.absoluteFilePath()) {
+            report(QObject::tr("%1: The document would be overwritten").arg(fileName), true);
+            _failed.ref();
+            break;
+        }
+
+        CAExport* exporter = createExport();
+        exporter->setStreamToFile(outputName);
+        if (_wholeDocument) {
+            exporter->exportDocument(document, false);
+        } else {
+            exporter->exportSheet(document->sheetList()[i]);
+            exporter->wait();
+        }
+
+        if (exporter->status() < 0) {
+            report(QString("%1: %2").arg(outputName, exporter->readableStatus()), true);
+            _failed.ref();
+        } else {
+            report(QString("%1 -> %2").arg(fileName, QDir::toNativeSeparators(outputName)));
+        }
+        delete exporter;
+    }
+
+    delete document;
+}
+
+/*!
+	Returns a new import filter for the given \a fileName or nullptr, if the format is not
+	supported. The format is sniffed from the beginning of the file, see CAFileFormats::detectType().
+*/
+CAImport* CABatchConvert::createImport(const QString& fileName)
+{
+    switch (CAFileFormats::detectType(fileName)) {
+    case CAFileFormats::Can:
+        return new CACanImport();
+    case CAFileFormats::CanorusML:
+        return new CACanorusMLImport();
+    case CAFileFormats::MusicXML:
+        return new CAMusicXmlImport();
+    case CAFileFormats::MXL:
+        return new CAMXLImport();
+    case CAFileFormats::Midi:
+        return new CAMidiImport();
+    default:
+        return nullptr;
+    }
+}
+
+/*!
+	Returns a new export filter for the target format.
+*/
+CAExport* CABatchConvert::createExport()
+{
+    if (_format == "can") {
+        return new CACanExport();
+    } else if (_format == "can-binary") {
+        CACanExport* save = new CACanExport();
+        save->setBinaryContent(true);
+        return save;
+    } else if (_format == "canorusml") {
+        return new CACanorusMLExport();
+    } else if (_format == "lilypond") {
+        return new CALilyPondExport();
+    } else if (_format == "musicxml") {
+        return new CAMusicXmlExport();
+    } else if (_format == "mxl") {
+        return new CAMXLExport();
+    } else if (_format == "midi") {
+        return new CAMidiExport();
+    } else {
+        return new CAPDFExport();
+    }
+}
+
+/*!
+	Returns the absolute path of the converted document \a fileName. The number of the \a sheet is
+	appended, if the document is exported into \a sheetCount files.
+*/
+QString CABatchConvert::outputFileName(const QString& fileName, int sheet, int sheetCount)
+{
+    QFileInfo info(fileName);
+    QString baseName = info.completeBaseName();
+    if (sheetCount > 1) {
+        baseName += QString("-%1").arg(sheet + 1);
+    }
+
+    QDir dir(_outputDir.isEmpty() ? info.absolutePath() : _outputDir);
+    return dir.absoluteFilePath(baseName + "." + _extension);
+}
+
+void CABatchConvert::printUsage()
+{
+    QStringList formats;
+    for (const CABatchFormat& format : batchFormats) {
+        formats << format.name;
+    }
+
+    report(QObject::tr("Usage: canorus %1=<format> [%2=<directory>] [%3=<number>] <files>...")
+               .arg(CONVERT_SWITCH, OUTPUT_DIR_SWITCH, JOBS_SWITCH),
+        true);
+    report(QObject::tr("       canorus [%1=<format>] %2=<transform>|%3=<script.py>... [%4=<directory>] <files>...")
+               .arg(CONVERT_SWITCH, TRANSFORM_SWITCH, TRANSFORM_SCRIPT_SWITCH, OUTPUT_DIR_SWITCH),
+        true);
+    report(QObject::tr("Supported formats: %1").arg(formats.join(", ")), true);
+    report(QObject::tr("Transforms: transpose:<semitones>, instrument:<program>, dynamic:<from>:<to>[:<volume>], articulation:<from>:<to>, each optionally followed by @<context>"), true);
+}
+
+/*!
+	Prints the \a message to the standard output or to the standard error, if \a error is True.
+	Messages of the parallel jobs are serialized.
+*/
+void CABatchConvert::report(const QString& message, bool error)
+{
+    QMutexLocker locker(&_reportMutex);
+    if (error) {
+        std::cerr << qPrintable(message) << std::endl;
+    } else {
+        std::cout << qPrintable(message) << std::endl;
+    }
+}
@@ -0,0 +1,56 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef BATCHCONVERT_H_
+#define BATCHCONVERT_H_
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+#include "core/batchtransform.h"
+
+class CAImport;
+class CAExport;
+
+class CABatchConvert {
+public:
+    CABatchConvert();
+
+    static bool isBatchMode(int argc, char* argv[]);
+    bool parseArguments(const QStringList& arguments);
+    int exec();
+
+    void convert(const QString& fileName);
+    static CAImport* createImport(const QString& fileName);
+
+    static const QString CONVERT_SWITCH;
+    static const QString OUTPUT_DIR_SWITCH;
+    static const QString JOBS_SWITCH;
+    static const QString TRANSFORM_SWITCH;
+    static const QString TRANSFORM_SCRIPT_SWITCH;
+
+private:
+    CAExport* createExport();
+    QString outputFileName(const QString& fileName, int sheet, int sheetCount);
+    void printUsage();
+    void report(const QString& message, bool error = false);
+
+    QString _format;
+    QString _extension;
+    bool _wholeDocument; // Export the whole document at once or each sheet into its own file
+    QString _outputDir;
+    int _jobs;
+    QStringList _files;
+    QList<CABatchTransform> _transforms; // applied to each document in the given order before exporting
+
+    QMutex _reportMutex;
+    QAtomicInt _failed;
+};
+
+#endif /* BATCHCONVERT_H_ */
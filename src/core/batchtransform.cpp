@@ -0,0 +1,330 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifdef USE_PYTHON
+// Python.h, which swigpython.h includes, must be included before any other headers
+#include "scripting/swigpython.h"
+
+#include "canorus.h"
+#endif
+
+#include <QFileInfo>
+#include <QObject>
+#include <QStringList>
+
+#include "core/batchtransform.h"
+#include "core/muselementfactory.h"
+#include "core/transpose.h"
+
+#include "score/articulation.h"
+#include "score/document.h"
+#include "score/dynamic.h"
+#include "score/note.h"
+#include "score/sheet.h"
+#include "score/staff.h"
+#include "score/voice.h"
+
+#include <memory>
+
+const QString CABatchTransform::SCRIPT_FUNCTION = "transform";
+
+namespace {
+
+/*!
+	Returns the articulation type named \a name, case insensitive, or CAArticulation::Undefined.
+*/
+CAArticulation::CAArticulationType articulationTypeFromName(const QString& name)
+{
+    for (int t = CAArticulation::Accent; t <= CAArticulation::Breath; t++) {
+        CAArticulation::CAArticulationType type = static_cast<CAArticulation::CAArticulationType>(t);
+        if (!CAArticulation::articulationTypeToString(type).compare(name, Qt::CaseInsensitive)) {
+            return type;
+        }
+    }
+
+    return CAArticulation::Undefined;
+}
+
+}
+
+/*!
+	\class CABatchTransform
+	\brief A single change applied to each document of the batch conversion
+
+	CABatchConvert applies the transforms passed by the --transform and --transform-script switches
+	to each imported document, before it is written by the export filter. This applies the same fix
+	to a whole archive of scores without opening them in the editor, for example:
+	\code
+	  canorus --transform=instrument:40@Violin --transform=dynamic:p:mp --output-dir=fixed *.can
+	\endcode
+
+	The declarative transforms are created by fromString() from "<kind>:<arguments>[@<context>]":
+	- transpose:<semitones> transposes the notes, key signatures and chord names by CATranspose
+	- instrument:<program> sets the MIDI program of the voices
+	- dynamic:<from>:<to>[:<volume>] replaces the dynamic marks with text \em from
+	- articulation:<from>:<to> replaces the articulations, eg. articulation:staccato:tenuto
+
+	If "@<context>" is given, only the contexts of that name are changed. The replaced marks are
+	created by CAMusElementFactory the same way as when inserted in the editor.
+
+	Python transforms are created by fromScript(). The script defines a function
+	transform(document, fileName), which changes the document in place using the scripting API. An
+	exception raised by the function marks the document failed and it is not written. The documents
+	are still processed in parallel, but the Python calls are serialized by the GIL.
+
+	The transforms are immutable after they are created, so a single instance is applied by all the
+	workers of the batch at once.
+
+	\sa CABatchConvert
+*/
+
+CABatchTransform::CABatchTransform()
+    : _transformType(Undefined)
+    , _value(-1)
+{
+}
+
+/*!
+	Creates a declarative transform of the given \a spec. Returns an invalid transform (see
+	isValid()), if the spec cannot be parsed.
+*/
+CABatchTransform CABatchTransform::fromString(const QString& spec)
+{
+    CABatchTransform t;
+
+    QString body = spec;
+    int at = spec.lastIndexOf('@');
+    if (at != -1) {
+        t._contextName = spec.mid(at + 1);
+        body = spec.left(at);
+    }
+
+    QStringList args = body.split(':');
+    QString kind = args.takeFirst().toLower();
+    bool ok = false;
+    if (kind == "transpose" && args.size() == 1) {
+        t._value = args[0].toInt(&ok);
+        if (ok) {
+            t._transformType = Transpose;
+        }
+    } else if (kind == "instrument" && args.size() == 1) {
+        t._value = args[0].toInt(&ok);
+        if (ok && t._value >= 0 && t._value < 128) {
+            t._transformType = Instrument;
+        }
+    } else if (kind == "dynamic" && (args.size() == 2 || args.size() == 3) && !args[1].isEmpty()) {
+        ok = true;
+        if (args.size() == 3) {
+            t._value = args[2].toInt(&ok);
+            ok = ok && t._value >= 0 && t._value <= 100;
+        }
+        if (ok) {
+            t._from = args[0];
+            t._to = args[1];
+            t._transformType = Dynamic;
+        }
+    } else if (kind == "articulation" && args.size() == 2) {
+        if (articulationTypeFromName(args[0]) != CAArticulation::Undefined && articulationTypeFromName(args[1]) != CAArticulation::Undefined) {
+            t._from = args[0];
+            t._to = args[1];
+            t._transformType = Articulation;
+        }
+    }
+
+    return t;
+}
+
+/*!
+	Creates a transform calling the transform() function of the Python script \a fileName.
+	Returns an invalid transform, if the script doesn't exist or Canorus was built without Python.
+
+	The scripting is initialized and the directory of the script is added to the Python path, so this
+	must be called from the main thread.
+*/
+CABatchTransform CABatchTransform::fromScript(const QString& fileName)
+{
+    CABatchTransform t;
+
+#ifdef USE_PYTHON
+    QFileInfo info(fileName);
+    if (!info.isReadable()) {
+        return t;
+    }
+
+    CACanorus::initScripting();
+    CASwigPython::lockGIL();
+    PyRun_SimpleString((QString("sys.path.append('") + info.absolutePath() + "')").toStdString().c_str());
+    CASwigPython::unlockGIL();
+    if (!CASwigPython::preloadFunction(info.absoluteFilePath(), SCRIPT_FUNCTION)) {
+        return t;
+    }
+
+    t._script = info.absoluteFilePath();
+    t._transformType = Script;
+#else
+    Q_UNUSED(fileName);
+#endif
+
+    return t;
+}
+
+/*!
+	Applies the transform to the \a document read from \a fileName. This is called by the worker
+	threads of the batch, each for its own document.
+
+	Returns True on success. Otherwise False and sets the \a error message.
+*/
+bool CABatchTransform::apply(CADocument* document, const QString& fileName, QString* error) const
+{
+    if (_transformType == Script) {
+        return runScript(document, fileName, error);
+    }
+
+    int changed = 0;
+    for (CASheet* sheet : document->sheetList()) {
+        QList<CAContext*> contexts = matchingContexts(sheet);
+        changed += contexts.size();
+        if (contexts.isEmpty()) {
+            continue;
+        }
+
+        switch (_transformType) {
+        case Transpose:
+            transpose(sheet);
+            break;
+        case Instrument:
+            changeInstrument(sheet);
+            break;
+        case Dynamic:
+        case Articulation:
+            replaceMarks(sheet);
+            break;
+        case Script:
+        case Undefined:
+            break;
+        }
+    }
+
+    if (!changed && !_contextName.isEmpty()) {
+        *error = QObject::tr("No context named %1").arg(_contextName);
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+	Returns the contexts of the \a sheet changed by the transform.
+*/
+QList<CAContext*> CABatchTransform::matchingContexts(CASheet* sheet) const
+{
+    QList<CAContext*> contexts;
+    for (CAContext* context : sheet->contextList()) {
+        if (_contextName.isEmpty() || context->name() == _contextName) {
+            contexts << context;
+        }
+    }
+
+    return contexts;
+}
+
+void CABatchTransform::transpose(CASheet* sheet) const
+{
+    std::unique_ptr<CATranspose> transpose(_contextName.isEmpty() ? new CATranspose(sheet) : new CATranspose(matchingContexts(sheet)));
+    transpose->transposeBySemitones(_value);
+}
+
+void CABatchTransform::changeInstrument(CASheet* sheet) const
+{
+    for (CAContext* context : matchingContexts(sheet)) {
+        if (context->contextType() != CAContext::Staff) {
+            continue;
+        }
+
+        for (CAVoice* voice : static_cast<CAStaff*>(context)->voiceList()) {
+            voice->setMidiProgram(static_cast<unsigned char>(_value));
+        }
+    }
+}
+
+/*!
+	Replaces the dynamics or articulations of the notes in the matching staffs of the \a sheet with
+	the new ones made by CAMusElementFactory. Returns the number of replaced marks.
+*/
+int CABatchTransform::replaceMarks(CASheet* sheet) const
+{
+    CAMusElementFactory factory;
+    if (_transformType == Dynamic) {
+        factory.setMarkType(CAMark::Dynamic);
+        factory.setDynamicText(_to);
+    } else {
+        factory.setMarkType(CAMark::Articulation);
+        factory.setArticulationType(articulationTypeFromName(_to));
+    }
+    CAArticulation::CAArticulationType from = articulationTypeFromName(_from);
+
+    int replaced = 0;
+    for (CAContext* context : matchingContexts(sheet)) {
+        if (context->contextType() != CAContext::Staff) {
+            continue;
+        }
+
+        for (CAVoice* voice : static_cast<CAStaff*>(context)->voiceList()) {
+            for (CAMusElement* elt : voice->musElementList()) {
+                if (elt->musElementType() != CAMusElement::Note) {
+                    continue;
+                }
+
+                QList<CAMark*> marks = elt->markList(); // copy, the list is changed below
+                for (CAMark* mark : marks) {
+                    if (_transformType == Dynamic && mark->markType() == CAMark::Dynamic && static_cast<CADynamic*>(mark)->text() == _from) {
+                        factory.setDynamicVolume(_value != -1 ? _value : static_cast<CADynamic*>(mark)->volume());
+                    } else if (!(_transformType == Articulation && mark->markType() == CAMark::Articulation && static_cast<CAArticulation*>(mark)->articulationType() == from)) {
+                        continue;
+                    }
+
+                    delete mark; // removes itself from the note
+                    if (factory.configureMark(elt)) {
+                        factory.emptyMusElem(); // the mark is owned by the note now
+                        replaced++;
+                    }
+                }
+            }
+        }
+    }
+
+    return replaced;
+}
+
+bool CABatchTransform::runScript(CADocument* document, const QString& fileName, QString* error) const
+{
+#ifdef USE_PYTHON
+    QString name = fileName;
+    QList<PyObject*> args;
+    CASwigPython::lockGIL();
+    args << CASwigPython::toPythonObject(document, CASwigPython::Document);
+    args << CASwigPython::toPythonObject(&name, CASwigPython::String);
+    CASwigPython::unlockGIL();
+
+    PyObject* ret = CASwigPython::callFunction(_script, SCRIPT_FUNCTION, args);
+    if (!ret) {
+        *error = QObject::tr("The transform script %1 failed").arg(_script);
+        return false;
+    }
+
+    CASwigPython::lockGIL();
+    Py_DECREF(ret);
+    CASwigPython::unlockGIL();
+
+    return true;
+#else
+    Q_UNUSED(document);
+    Q_UNUSED(fileName);
+    *error = QObject::tr("Canorus was built without Python");
+    return false;
+#endif
+}
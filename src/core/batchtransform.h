@@ -0,0 +1,56 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef BATCHTRANSFORM_H_
+#define BATCHTRANSFORM_H_
+
+#include <QList>
+#include <QString>
+
+class CAContext;
+class CADocument;
+class CASheet;
+
+class CABatchTransform {
+public:
+    enum CABatchTransformType {
+        Undefined = -1,
+        Transpose,
+        Instrument,
+        Dynamic,
+        Articulation,
+        Script
+    };
+
+    CABatchTransform();
+
+    static CABatchTransform fromString(const QString& spec);
+    static CABatchTransform fromScript(const QString& fileName);
+
+    inline CABatchTransformType transformType() const { return _transformType; }
+    inline bool isValid() const { return _transformType != Undefined; }
+
+    bool apply(CADocument* document, const QString& fileName, QString* error) const;
+
+    static const QString SCRIPT_FUNCTION;
+
+private:
+    QList<CAContext*> matchingContexts(CASheet* sheet) const;
+    void transpose(CASheet* sheet) const;
+    void changeInstrument(CASheet* sheet) const;
+    int replaceMarks(CASheet* sheet) const;
+    bool runScript(CADocument* document, const QString& fileName, QString* error) const;
+
+    CABatchTransformType _transformType;
+    QString _contextName; // only the contexts with this name are changed, all if empty
+    int _value; // semitones, MIDI program or the new dynamic volume, -1 to keep the old one
+    QString _from; // replaced dynamic text or articulation name
+    QString _to;
+    QString _script; // absolute path of the Python transform
+};
+
+#endif /* BATCHTRANSFORM_H_ */
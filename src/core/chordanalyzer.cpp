@@ -0,0 +1,364 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#include <QPair>
+
+#include <algorithm>
+#include <atomic>
+
+#include "core/chordanalyzer.h"
+#include "core/taskscheduler.h"
+
+#include "score/chordname.h"
+#include "score/chordnamecontext.h"
+#include "score/document.h"
+#include "score/documentversion.h"
+#include "score/note.h"
+#include "score/sheet.h"
+#include "score/staff.h"
+
+const int CAChordAnalyzer::BARS_PER_TASK = 8;
+
+namespace {
+
+struct CAChordTemplate {
+    const char* qualityModifier; // in the LilyPond chord mode syntax
+    int size;
+    int intervals[4]; // in semitones above the root
+};
+
+// the simpler chords first, they win when several chords fit equally well
+const CAChordTemplate CHORD_TEMPLATES[] = {
+    { "", 3, { 0, 4, 7 } },
+    { "m", 3, { 0, 3, 7 } },
+    { "7", 4, { 0, 4, 7, 10 } },
+    { "m7", 4, { 0, 3, 7, 10 } },
+    { "maj7", 4, { 0, 4, 7, 11 } },
+    { "5", 2, { 0, 7 } },
+    { "dim", 3, { 0, 3, 6 } },
+    { "aug", 3, { 0, 4, 8 } },
+    { "sus4", 3, { 0, 5, 7 } },
+    { "sus2", 3, { 0, 2, 7 } },
+    { "m7.5-", 4, { 0, 3, 6, 10 } },
+    { "dim7", 4, { 0, 3, 6, 9 } },
+    { "6", 4, { 0, 4, 7, 9 } },
+    { "m6", 4, { 0, 3, 7, 9 } },
+};
+
+/*!
+	Returns the chord name of the \a context starting exactly at \a time or nullptr.
+*/
+CAChordName* chordNameAt(CAChordNameContext* context, int time)
+{
+    const QList<CAChordName*>& names = context->chordNameList();
+    QList<CAChordName*>::const_iterator it = std::lower_bound(names.constBegin(), names.constEnd(), time,
+        [](CAChordName* name, int t) { return name->timeStart() < t; });
+    return (it != names.constEnd() && (*it)->timeStart() == time ? *it : nullptr);
+}
+
+}
+
+/*!
+	Analyzes the chord names of a few bars of a single chord name context in the task scheduler.
+	Only the published copy of the sheet is read, the results are applied to the live context by
+	CAChordAnalyzer in the main thread.
+*/
+class CAChordAnalysisTask : public CATask {
+public:
+    CAChordAnalysisTask(CAChordAnalyzer* analyzer, std::shared_ptr<CADocumentVersion> version, CASheet* sheet, CAChordNameContext* context)
+        : CATask(CATask::Background) // nobody waits for the chord names
+        , _analyzer(analyzer)
+        , _version(version)
+        , _sheet(sheet)
+        , _copy(version->sheet(sheet))
+        , _context(context)
+        , _done(false)
+    {
+    }
+
+    void run()
+    {
+        for (const QPair<int, int>& chord : _chords) {
+            if (isCanceled()) {
+                return;
+            }
+            int timeEnd = chord.first + chord.second;
+            _results << CAChordAnalyzer::analyzeChord(_copy->getPlayables(chord.first, timeEnd), chord.first, timeEnd);
+        }
+
+        _done.store(true);
+        QMetaObject::invokeMethod(_analyzer, "onTaskDone", Qt::QueuedConnection);
+    }
+
+    inline void addChord(int timeStart, int timeLength) { _chords << qMakePair(timeStart, timeLength); }
+    inline bool isDone() { return _done.load(); } // results are complete, the task may still be finishing
+    inline int timeEnd() { return _chords.isEmpty() ? 0 : _chords.last().first + _chords.last().second; }
+
+    inline CASheet* sheet() { return _sheet; }
+    inline CAChordNameContext* context() { return _context; }
+    inline const QList<CAChordAnalysisResult>& results() { return _results; }
+
+private:
+    CAChordAnalyzer* _analyzer;
+    std::shared_ptr<CADocumentVersion> _version; // keeps the copy alive while the task runs
+    CASheet* _sheet; // live sheet
+    CASheet* _copy; // copy of the sheet read by the task
+    CAChordNameContext* _context; // live context receiving the results
+    QList<QPair<int, int>> _chords; // start time and length of each chord name
+    QList<CAChordAnalysisResult> _results;
+    std::atomic<bool> _done;
+};
+
+/*!
+	\class CAChordAnalyzer
+	\brief Derives the chord names from the notes of the sheet in the background
+
+	CAChordAnalyzer fills the chord name contexts (see CAChordNameContext) of a sheet with the
+	chords sounding above each chord name. The notes are read from the published version of the
+	document (see CADocument::publish()), so the user can keep editing meanwhile.
+
+	The chord names are split by BARS_PER_TASK bars into tasks running in the task scheduler.
+	The results of each task are applied in the main thread as soon as the task finishes and
+	chordNamesChanged() is emitted, so the names appear bar by bar on long sheets.
+
+	Only the empty chord names and the ones generated by a previous analysis are changed, the chord
+	names entered by the user are kept (see CAChordName::isGenerated()). Starting a new analysis of
+	the same sheet cancels the tasks of the previous one after the given time, so calling analyze()
+	after each edit is cheap.
+
+	\code
+	  CAChordAnalyzer* analyzer = new CAChordAnalyzer(this);
+	  connect(analyzer, SIGNAL(chordNamesChanged(CASheet*)), this, SLOT(onChordNamesChanged(CASheet*)));
+	  analyzer->analyze(sheet);
+	\endcode
+
+	Function mark suggestions are not derived yet.
+*/
+
+CAChordAnalyzer::CAChordAnalyzer(QObject* parent)
+    : QObject(parent)
+{
+}
+
+CAChordAnalyzer::~CAChordAnalyzer()
+{
+    cancel();
+}
+
+/*!
+	Starts the analysis of the chord names of the \a sheet starting at or after \a timeStart.
+	Does nothing, if the sheet has no chord name contexts.
+
+	Call it from the thread owning the document.
+*/
+void CAChordAnalyzer::analyze(CASheet* sheet, int timeStart)
+{
+    cancel(sheet, timeStart);
+
+    QList<CAChordNameContext*> contexts;
+    for (CAContext* context : sheet->contextList()) {
+        if (context->contextType() == CAContext::ChordNameContext) {
+            contexts << static_cast<CAChordNameContext*>(context);
+        }
+    }
+    if (contexts.isEmpty() || !sheet->document()) {
+        return;
+    }
+
+    std::shared_ptr<CADocumentVersion> version = sheet->document()->publish();
+    if (!version->sheet(sheet)) {
+        return;
+    }
+
+    QList<CAChordAnalysisTask*> tasks;
+    for (CAChordNameContext* context : contexts) {
+        CAChordAnalysisTask* task = nullptr;
+        int chunk = -1;
+        for (CAChordName* name : context->chordNameList()) {
+            if (name->timeEnd() <= timeStart || name->timeLength() <= 0) {
+                continue;
+            }
+
+            int bar = sheet->barNumber(name->timeStart());
+            if (!task || bar / BARS_PER_TASK != chunk) {
+                task = new CAChordAnalysisTask(this, version, sheet, context);
+                tasks << task;
+                chunk = bar / BARS_PER_TASK;
+            }
+            task->addChord(name->timeStart(), name->timeLength());
+        }
+    }
+
+    for (CAChordAnalysisTask* task : tasks) {
+        _tasks << task;
+        CATaskScheduler::instance()->start(task);
+    }
+}
+
+/*!
+	Cancels the analysis of all the sheets. The results not applied yet are discarded.
+
+	Call it before the analyzed document is destroyed.
+*/
+void CAChordAnalyzer::cancel()
+{
+    for (CAChordAnalysisTask* task : _tasks) {
+        task->cancel();
+    }
+    for (CAChordAnalysisTask* task : _tasks) {
+        task->wait();
+    }
+    qDeleteAll(_tasks);
+    _tasks.clear();
+}
+
+/*!
+	Cancels the running analysis of the chord names of the \a sheet ending after \a timeStart.
+*/
+void CAChordAnalyzer::cancel(CASheet* sheet, int timeStart)
+{
+    for (int i = 0; i < _tasks.size(); i++) {
+        if (_tasks[i]->sheet() == sheet && _tasks[i]->timeEnd() > timeStart) {
+            _tasks[i]->cancel();
+            _tasks[i]->wait();
+            delete _tasks.takeAt(i--);
+        }
+    }
+}
+
+/*!
+	Applies the results of the finished tasks to their chord name contexts.
+*/
+void CAChordAnalyzer::onTaskDone()
+{
+    QList<CASheet*> changedSheets;
+    for (int i = 0; i < _tasks.size(); i++) {
+        CAChordAnalysisTask* task = _tasks[i];
+        if (!task->isDone()) {
+            continue;
+        }
+        task->wait(); // returns right after the run
+
+        bool changed = false;
+        for (const CAChordAnalysisResult& result : task->results()) {
+            CAChordName* name = chordNameAt(task->context(), result.timeStart);
+            if (!name) {
+                continue; // the chord names were changed meanwhile, a new analysis follows
+            }
+
+            bool empty = (name->diatonicPitch().noteName() == CADiatonicPitch::Undefined && name->qualityModifier().isEmpty());
+            if (!empty && !name->isGenerated()) {
+                continue; // entered by the user
+            }
+
+            if (name->diatonicPitch() != result.pitch || name->qualityModifier() != result.qualityModifier) {
+                name->setDiatonicPitch(result.pitch);
+                name->setQualityModifier(result.qualityModifier);
+                changed = true;
+            }
+            name->setGenerated(true);
+        }
+
+        if (changed && !changedSheets.contains(task->sheet())) {
+            changedSheets << task->sheet();
+        }
+        delete _tasks.takeAt(i--);
+    }
+
+    for (CASheet* sheet : changedSheets) {
+        emit chordNamesChanged(sheet);
+    }
+}
+
+/*!
+	Returns the chord formed by the notes among the \a playables sounding between \a timeStart
+	and \a timeEnd.
+
+	Each pitch class is weighted by how long it sounds in the given time. The chord with the most
+	weight of its tones, the least weight of the other tones and the fewest missing tones wins.
+	The chord with the root in the bass is preferred among the equal ones, so eg. C-E-G-A is C6
+	and A-C-E-G is Am7. The root is spelled as the note in the score.
+*/
+CAChordAnalysisResult CAChordAnalyzer::analyzeChord(const QList<CAPlayable*>& playables, int timeStart, int timeEnd)
+{
+    CAChordAnalysisResult result = { timeStart, CADiatonicPitch(CADiatonicPitch::Undefined), QString() };
+
+    double weights[12] = { 0 };
+    CANote* spelling[12] = { nullptr }; // a note of each pitch class
+    CANote* bass = nullptr;
+    double total = 0;
+    for (CAPlayable* p : playables) {
+        if (p->musElementType() != CAMusElement::Note) {
+            continue;
+        }
+
+        CANote* note = static_cast<CANote*>(p);
+        int pc = ((note->midiPitch() % 12) + 12) % 12;
+        double weight = qMin(note->timeEnd(), timeEnd) - qMax(note->timeStart(), timeStart);
+        if (weight <= 0) {
+            continue;
+        }
+
+        weights[pc] += weight;
+        total += weight;
+        if (!spelling[pc]) {
+            spelling[pc] = note;
+        }
+        if (!bass || note->midiPitch() < bass->midiPitch()) {
+            bass = note;
+        }
+    }
+
+    int pitchClasses = 0;
+    for (double weight : weights) {
+        if (weight > 0) {
+            pitchClasses++;
+        }
+    }
+    if (pitchClasses < 2) {
+        return result; // a single tone is no chord
+    }
+
+    int bassPc = ((bass->midiPitch() % 12) + 12) % 12;
+    double bestScore = 0;
+    int bestRoot = -1;
+    const CAChordTemplate* best = nullptr;
+    for (int root = 0; root < 12; root++) {
+        if (!spelling[root]) {
+            continue; // the root must be present to be spelled
+        }
+
+        for (const CAChordTemplate& chord : CHORD_TEMPLATES) {
+            double hit = 0;
+            int missing = 0;
+            for (int i = 0; i < chord.size; i++) {
+                int pc = (root + chord.intervals[i]) % 12;
+                hit += weights[pc];
+                if (weights[pc] <= 0) {
+                    missing++;
+                }
+            }
+
+            double miss = total - hit;
+            double score = hit - miss - missing * total / 3;
+            bool better = !best || score > bestScore || (score == bestScore && root == bassPc && bestRoot != bassPc);
+            if (better && score > 0) {
+                best = &chord;
+                bestScore = score;
+                bestRoot = root;
+            }
+        }
+    }
+
+    if (best) {
+        const CADiatonicPitch& pitch = spelling[bestRoot]->diatonicPitch();
+        result.pitch = CADiatonicPitch(((pitch.noteName() % 7) + 7) % 7, pitch.accs());
+        result.qualityModifier = QString::fromLatin1(best->qualityModifier);
+    }
+
+    return result;
+}
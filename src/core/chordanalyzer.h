@@ -0,0 +1,62 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#ifndef CHORDANALYZER_H_
+#define CHORDANALYZER_H_
+
+#include <QList>
+#include <QObject>
+#include <QString>
+
+#include <memory>
+
+#include "score/diatonicpitch.h"
+
+class CADocument;
+class CADocumentVersion;
+class CASheet;
+class CAChordNameContext;
+class CAChordAnalysisTask;
+class CAPlayable;
+
+struct CAChordAnalysisResult {
+    int timeStart;
+    CADiatonicPitch pitch; // Undefined, if no chord was recognized
+    QString qualityModifier;
+};
+
+class CAChordAnalyzer : public QObject {
+#ifndef SWIG
+    Q_OBJECT
+#endif
+public:
+    CAChordAnalyzer(QObject* parent = nullptr);
+    virtual ~CAChordAnalyzer();
+
+    void analyze(CASheet* sheet, int timeStart = 0);
+    void cancel();
+    inline bool isRunning() { return !_tasks.isEmpty(); }
+
+    static CAChordAnalysisResult analyzeChord(const QList<CAPlayable*>& playables, int timeStart, int timeEnd);
+
+    static const int BARS_PER_TASK;
+
+#ifndef SWIG
+signals:
+    void chordNamesChanged(CASheet* sheet);
+
+private slots:
+    void onTaskDone();
+#endif
+
+private:
+    void cancel(CASheet* sheet, int timeStart);
+
+    QList<CAChordAnalysisTask*> _tasks; // running analyses of all the sheets, applied in this order
+};
+
+#endif /* CHORDANALYZER_H_ */
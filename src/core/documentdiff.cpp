@@ -0,0 +1,296 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QVector>
+
+#include "core/documentdiff.h"
+#include "score/chordnamecontext.h"
+#include "score/document.h"
+#include "score/figuredbasscontext.h"
+#include "score/functionmarkcontext.h"
+#include "score/lyricscontext.h"
+#include "score/mark.h"
+#include "score/sheet.h"
+#include "score/staff.h"
+#include "score/voice.h"
+
+namespace {
+
+template <typename T>
+QList<CAMusElement*> toMusElementList(const QList<T*>& list)
+{
+    QList<CAMusElement*> elts;
+    elts.reserve(list.size());
+    for (T* elt : list) {
+        elts << elt;
+    }
+    return elts;
+}
+
+/*!
+	Returns the elements of the non-staff \a context in time order. The staffs are compared voice by
+	voice instead.
+*/
+QList<CAMusElement*> contextElements(CAContext* context)
+{
+    switch (context->contextType()) {
+    case CAContext::LyricsContext:
+        return toMusElementList(static_cast<CALyricsContext*>(context)->syllableList());
+    case CAContext::FunctionMarkContext:
+        return toMusElementList(static_cast<CAFunctionMarkContext*>(context)->functionMarkList());
+    case CAContext::FiguredBassContext:
+        return toMusElementList(static_cast<CAFiguredBassContext*>(context)->figuredBassMarkList());
+    case CAContext::ChordNameContext:
+        return toMusElementList(static_cast<CAChordNameContext*>(context)->chordNameList());
+    case CAContext::Staff:
+        break;
+    }
+
+    return QList<CAMusElement*>();
+}
+
+/*!
+	Returns True, if the elements \a a and \a b of the same type at the same time are equal
+	including their marks.
+*/
+bool isSameElement(CAMusElement* a, CAMusElement* b)
+{
+    if (a->compare(b) != 0 || a->timeLength() != b->timeLength()
+        || a->isVisible() != b->isVisible() || a->color() != b->color()
+        || a->markList().size() != b->markList().size()) {
+        return false;
+    }
+
+    for (int i = 0; i < a->markList().size(); i++) {
+        if (a->markList()[i]->compare(b->markList()[i]) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
+
+/*!
+	\class CADocumentDiff
+	\brief Structural difference of two documents
+
+	Compares the sheets, contexts and voices of two documents and lists the changes from
+	\a oldDocument to \a newDocument. Sheets, contexts and voices are paired by their index. The
+	elements of each voice or context are aligned by their start time in a single pass over both
+	lists; the elements starting at the same time are paired by their type in the order of the
+	list. Paired elements are compared with CAMusElement::compare() together with their length,
+	visibility, color and marks and reported as Changed, the unpaired ones as Removed or Added.
+
+	The properties which compare() doesn't look at (eg. the stem direction or ties) are not
+	reported, so an empty diff doesn't guarantee the documents are written the same. The undo uses
+	isSameSheet() to reject the changed sheets before exporting them to compare their source.
+
+	The changed elements of a sheet can be highlighted in its score view:
+	\code
+	  CADocumentDiff diff(savedDocument, document);
+	  scoreView->clearSelection();
+	  scoreView->addToSelection(diff.changedElements(sheetIndex));
+	\endcode
+*/
+
+CADocumentDiff::CADocumentDiff(CADocument* oldDocument, CADocument* newDocument)
+    : _oldDocument(oldDocument)
+    , _newDocument(newDocument)
+    , _firstOnly(false)
+{
+    const QList<CASheet*>& a = oldDocument->sheetList();
+    const QList<CASheet*>& b = newDocument->sheetList();
+    for (int i = 0; i < a.size() && i < b.size(); i++) {
+        diffSheet(i, a[i], b[i]);
+    }
+    for (int i = b.size(); i < a.size(); i++) {
+        addChange(Removed, i, nullptr, nullptr);
+    }
+    for (int i = a.size(); i < b.size(); i++) {
+        addChange(Added, i, nullptr, nullptr);
+    }
+}
+
+CADocumentDiff::CADocumentDiff()
+    : _oldDocument(nullptr)
+    , _newDocument(nullptr)
+    , _firstOnly(true)
+{
+}
+
+/*!
+	Returns the indices of the sheets with any change. The added sheets are included, the removed
+	ones are not.
+*/
+QList<int> CADocumentDiff::changedSheets()
+{
+    QList<int> sheets;
+    for (const CAChange& change : _changes) {
+        if ((change.type != Removed || change.oldContext) && (sheets.isEmpty() || sheets.last() != change.sheet)) {
+            sheets << change.sheet;
+        }
+    }
+    return sheets;
+}
+
+/*!
+	Returns the added and changed elements of the \a sheet of the new document. The removed elements
+	aren't part of the new document and are not returned.
+*/
+QList<CAMusElement*> CADocumentDiff::changedElements(int sheet)
+{
+    QList<CAMusElement*> elts;
+    for (const CAChange& change : _changes) {
+        if (change.sheet == sheet && change.newElement) {
+            elts << change.newElement;
+        }
+    }
+    return elts;
+}
+
+/*!
+	Returns False, if the sheets \a a and \a b differ structurally. Stops at the first change.
+*/
+bool CADocumentDiff::isSameSheet(CASheet* a, CASheet* b)
+{
+    CADocumentDiff diff;
+    return diff.diffSheet(0, a, b);
+}
+
+/*!
+	Appends the changes from the sheet \a a to \a b. Returns False, if the diff was stopped at the
+	first change.
+*/
+bool CADocumentDiff::diffSheet(int sheet, CASheet* a, CASheet* b)
+{
+    if (!a->isLoaded() && !b->isLoaded() && a->loader() == b->loader()) {
+        return true; // neither was read since it was cloned
+    }
+
+    if (a->name() != b->name() && !addChange(Changed, sheet, nullptr, nullptr)) {
+        return false;
+    }
+
+    const QList<CAContext*>& aList = a->contextList();
+    const QList<CAContext*>& bList = b->contextList();
+    for (int i = 0; i < aList.size() && i < bList.size(); i++) {
+        if (!diffContext(sheet, aList[i], bList[i])) {
+            return false;
+        }
+    }
+    for (int i = bList.size(); i < aList.size(); i++) {
+        if (!addChange(Removed, sheet, aList[i], nullptr)) {
+            return false;
+        }
+    }
+    for (int i = aList.size(); i < bList.size(); i++) {
+        if (!addChange(Added, sheet, nullptr, bList[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*!
+	Appends the changes from the context \a a to \a b. The contexts of a different type are reported
+	as changed without comparing their elements.
+*/
+bool CADocumentDiff::diffContext(int sheet, CAContext* a, CAContext* b)
+{
+    if (a->contextType() != b->contextType()) {
+        return addChange(Changed, sheet, a, b);
+    }
+
+    if (a->name() != b->name() && !addChange(Changed, sheet, a, b)) {
+        return false;
+    }
+
+    if (a->contextType() != CAContext::Staff) {
+        return diffElements(sheet, a, b, contextElements(a), contextElements(b));
+    }
+
+    const QList<CAVoice*>& aVoices = static_cast<CAStaff*>(a)->voiceList();
+    const QList<CAVoice*>& bVoices = static_cast<CAStaff*>(b)->voiceList();
+    for (int i = 0; i < aVoices.size() || i < bVoices.size(); i++) {
+        if (!diffElements(sheet, a, b,
+                i < aVoices.size() ? aVoices[i]->musElementList() : QList<CAMusElement*>(),
+                i < bVoices.size() ? bVoices[i]->musElementList() : QList<CAMusElement*>())) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*!
+	Aligns the time ordered elements \a aList of the context \a a and \a bList of \a b by their start
+	time and appends the changes.
+*/
+bool CADocumentDiff::diffElements(int sheet, CAContext* a, CAContext* b, const QList<CAMusElement*>& aList, const QList<CAMusElement*>& bList)
+{
+    int i = 0, j = 0;
+    QVector<bool> paired;
+    while (i < aList.size() || j < bList.size()) {
+        int time;
+        if (i == aList.size()) {
+            time = bList[j]->timeStart();
+        } else if (j == bList.size()) {
+            time = aList[i]->timeStart();
+        } else {
+            time = qMin(aList[i]->timeStart(), bList[j]->timeStart());
+        }
+
+        int aEnd = i, bEnd = j;
+        while (aEnd < aList.size() && aList[aEnd]->timeStart() == time) {
+            aEnd++;
+        }
+        while (bEnd < bList.size() && bList[bEnd]->timeStart() == time) {
+            bEnd++;
+        }
+
+        // pair the elements starting at this time by their type, usually only a few
+        int bStart = j;
+        paired.fill(false, bEnd - bStart);
+        for (; i < aEnd; i++) {
+            int k = bStart;
+            while (k < bEnd && (paired[k - bStart] || bList[k]->musElementType() != aList[i]->musElementType())) {
+                k++;
+            }
+
+            bool ok;
+            if (k == bEnd) {
+                ok = addChange(Removed, sheet, a, b, aList[i], nullptr);
+            } else {
+                paired[k - bStart] = true;
+                ok = isSameElement(aList[i], bList[k]) || addChange(Changed, sheet, a, b, aList[i], bList[k]);
+            }
+            if (!ok) {
+                return false;
+            }
+        }
+        for (; j < bEnd; j++) {
+            if (!paired[j - bStart] && !addChange(Added, sheet, a, b, nullptr, bList[j])) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/*!
+	Appends the change. Returns False, if the diff should stop.
+*/
+bool CADocumentDiff::addChange(CAChangeType type, int sheet, CAContext* oldContext, CAContext* newContext, CAMusElement* oldElement, CAMusElement* newElement)
+{
+    CAChange change = { type, sheet, oldContext, newContext, oldElement, newElement };
+    _changes << change;
+    return !_firstOnly;
+}
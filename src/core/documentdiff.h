@@ -0,0 +1,69 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef DOCUMENTDIFF_H_
+#define DOCUMENTDIFF_H_
+
+#include <QList>
+
+class CADocument;
+class CASheet;
+class CAContext;
+class CAMusElement;
+
+class CADocumentDiff {
+public:
+    enum CAChangeType {
+        Added,
+        Removed,
+        Changed
+    };
+
+#ifndef SWIG
+    struct CAChange {
+        CAChangeType type;
+        int sheet; // index in the new document, in the old one for the removed sheets
+        CAContext* oldContext; // null for the sheet changes
+        CAContext* newContext;
+        CAMusElement* oldElement; // null for the sheet and context changes
+        CAMusElement* newElement;
+    };
+#endif
+
+    CADocumentDiff(CADocument* oldDocument, CADocument* newDocument);
+
+    inline CADocument* oldDocument() { return _oldDocument; }
+    inline CADocument* newDocument() { return _newDocument; }
+
+#ifndef SWIG
+    inline const QList<CAChange>& changes() { return _changes; }
+#endif
+    inline int changeCount() { return _changes.size(); }
+    inline bool isEmpty() { return _changes.isEmpty(); }
+
+    QList<int> changedSheets();
+    QList<CAMusElement*> changedElements(int sheet);
+
+    static bool isSameSheet(CASheet* a, CASheet* b);
+
+private:
+    CADocumentDiff();
+
+    bool diffSheet(int sheet, CASheet* a, CASheet* b);
+    bool diffContext(int sheet, CAContext* a, CAContext* b);
+    bool diffElements(int sheet, CAContext* a, CAContext* b, const QList<CAMusElement*>& aList, const QList<CAMusElement*>& bList);
+    bool addChange(CAChangeType type, int sheet, CAContext* oldContext, CAContext* newContext, CAMusElement* oldElement = nullptr, CAMusElement* newElement = nullptr);
+
+    CADocument* _oldDocument;
+    CADocument* _newDocument;
+#ifndef SWIG
+    QList<CAChange> _changes;
+#endif
+    bool _firstOnly; // stop at the first change, see isSameSheet()
+};
+
+#endif /* DOCUMENTDIFF_H_ */
@@ -0,0 +1,455 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QFileInfo>
+#include <QObject>
+#include <QSet>
+#include <QThread>
+
+#include "core/documentstatistics.h"
+#include "score/articulation.h"
+#include "score/barline.h"
+#include "score/bookmark.h"
+#include "score/chordname.h"
+#include "score/chordnamecontext.h"
+#include "score/clef.h"
+#include "score/crescendo.h"
+#include "score/document.h"
+#include "score/dynamic.h"
+#include "score/fermata.h"
+#include "score/figuredbasscontext.h"
+#include "score/figuredbassmark.h"
+#include "score/fingering.h"
+#include "score/functionmark.h"
+#include "score/functionmarkcontext.h"
+#include "score/instrumentchange.h"
+#include "score/keysignature.h"
+#include "score/lyricscontext.h"
+#include "score/midinote.h"
+#include "score/note.h"
+#include "score/repeatmark.h"
+#include "score/resource.h"
+#include "score/rest.h"
+#include "score/ritardando.h"
+#include "score/sheet.h"
+#include "score/slur.h"
+#include "score/staff.h"
+#include "score/syllable.h"
+#include "score/tempo.h"
+#include "score/text.h"
+#include "score/timesignature.h"
+#include "score/tuplet.h"
+#include "score/voice.h"
+
+#if !defined(SWIGCPP)
+#include <QApplication>
+#include <QClipboard>
+#include <QTimer>
+
+#include "canorus.h"
+#include "core/mimedata.h"
+#include "core/undo.h"
+#include "layout/sheetlayout.h"
+#include "ui/mainwin.h"
+#include "widgets/scoreview.h"
+#endif
+
+const QString CADocumentStatistics::LOG_SWITCH = "--log-memory";
+const int CADocumentStatistics::DRAWABLE_MEMORY_USAGE = 160;
+int CADocumentStatistics::_logInterval = 0;
+
+namespace {
+
+/*!
+	Returns the size of the class of the music element \a elt.
+*/
+qint64 elementMemoryUsage(CAMusElement* elt)
+{
+    switch (elt->musElementType()) {
+    case CAMusElement::Note:
+        return sizeof(CANote);
+    case CAMusElement::Rest:
+        return sizeof(CARest);
+    case CAMusElement::MidiNote:
+        return sizeof(CAMidiNote);
+    case CAMusElement::Barline:
+        return sizeof(CABarline);
+    case CAMusElement::Clef:
+        return sizeof(CAClef);
+    case CAMusElement::TimeSignature:
+        return sizeof(CATimeSignature);
+    case CAMusElement::KeySignature:
+        return sizeof(CAKeySignature);
+    case CAMusElement::Slur:
+        return sizeof(CASlur);
+    case CAMusElement::Tuplet:
+        return sizeof(CATuplet);
+    case CAMusElement::Syllable:
+        return sizeof(CASyllable) + static_cast<CASyllable*>(elt)->text().size() * 2;
+    case CAMusElement::FunctionMark:
+        return sizeof(CAFunctionMark);
+    case CAMusElement::FiguredBassMark:
+        return sizeof(CAFiguredBassMark);
+    case CAMusElement::ChordName:
+        return sizeof(CAChordName);
+    case CAMusElement::Mark:
+        break;
+    case CAMusElement::Undefined:
+        return sizeof(CAMusElement);
+    }
+
+    switch (static_cast<CAMark*>(elt)->markType()) {
+    case CAMark::Text:
+        return sizeof(CAText) + static_cast<CAText*>(elt)->text().size() * 2;
+    case CAMark::Tempo:
+        return sizeof(CATempo);
+    case CAMark::Ritardando:
+        return sizeof(CARitardando);
+    case CAMark::Dynamic:
+        return sizeof(CADynamic);
+    case CAMark::Crescendo:
+        return sizeof(CACrescendo);
+    case CAMark::InstrumentChange:
+        return sizeof(CAInstrumentChange);
+    case CAMark::BookMark:
+        return sizeof(CABookMark);
+    case CAMark::Fermata:
+        return sizeof(CAFermata);
+    case CAMark::RepeatMark:
+        return sizeof(CARepeatMark);
+    case CAMark::Articulation:
+        return sizeof(CAArticulation);
+    case CAMark::Fingering:
+        return sizeof(CAFingering);
+    case CAMark::Undefined:
+    case CAMark::Pedal:
+    case CAMark::RehersalMark:
+        break;
+    }
+    return sizeof(CAMark);
+}
+
+QString kiloBytes(qint64 bytes)
+{
+    return QString::number(bytes / 1024.0, 'f', 1) + " kB";
+}
+
+}
+
+/*!
+	\class CADocumentStatistics
+	\brief Counts and approximate memory usage of a document
+
+	The statistics are collected when created and show which part of the program holds the memory
+	of the document: the music elements and marks, the attached resources, the undo history, the
+	drawables and the rendered tiles of the score views and the clipboard. The sizes are
+	estimated from the size of the classes, so they are only good for comparing the parts and
+	watching them grow.
+
+	The statistics are shown by Help->Memory statistics, available in scripting:
+	\code
+	  print(CanorusPython.CADocumentStatistics(document).toString())
+	\endcode
+	and logged periodically for all the opened documents, if Canorus is run with
+	--log-memory=<seconds> (see parseArguments()).
+
+	The undo history, the views and the clipboard are only counted in the main thread of the
+	application. The Python module run outside of Canorus only counts the document itself.
+
+	\sa CAUndo::memoryUsage()
+*/
+
+CADocumentStatistics::CADocumentStatistics(CADocument* document)
+    : _document(document)
+    , _sheetCount(0)
+    , _unloadedSheetCount(0)
+    , _contextCount(0)
+    , _voiceCount(0)
+    , _elementCount(0)
+    , _elementBytes(0)
+    , _markCount(0)
+    , _markBytes(0)
+    , _resourceCount(0)
+    , _resourceBytes(0)
+    , _undoCount(0)
+    , _undoBytes(0)
+    , _drawableCount(0)
+    , _drawableBytes(0)
+    , _tileCount(0)
+    , _tileBytes(0)
+    , _clipboardElementCount(0)
+    , _clipboardBytes(0)
+{
+    if (!document) {
+        return;
+    }
+
+    for (CASheet* sheet : document->sheetList()) {
+        _sheetCount++;
+        if (!sheet->isLoaded()) {
+            _unloadedSheetCount++; // counting would read it
+            continue;
+        }
+
+        for (CAContext* context : sheet->contextList()) {
+            addContext(context, &_elementCount, &_elementBytes, &_markCount, &_markBytes);
+        }
+    }
+
+    for (const std::shared_ptr<CAResource>& resource : document->resourceList()) {
+        _resourceCount++;
+        if (!resource->isLinked()) {
+            _resourceBytes += QFileInfo(resource->url().toLocalFile()).size();
+        }
+    }
+
+#if !defined(SWIGCPP)
+    if (qApp && QThread::currentThread() == qApp->thread()) {
+        collectApplication();
+    }
+#endif
+}
+
+void CADocumentStatistics::addContext(CAContext* context, int* count, qint64* bytes, int* marks, qint64* markBytes)
+{
+    _contextCount++;
+    switch (context->contextType()) {
+    case CAContext::Staff: {
+        QSet<CAMusElement*> elts; // the signs are shared by the voices
+        for (CAVoice* voice : static_cast<CAStaff*>(context)->voiceList()) {
+            _voiceCount++;
+            for (CAMusElement* elt : voice->musElementList()) {
+                if (!elts.contains(elt)) {
+                    elts.insert(elt);
+                    addElement(elt, count, bytes, marks, markBytes);
+                }
+            }
+        }
+        break;
+    }
+    case CAContext::LyricsContext:
+        for (CASyllable* syllable : static_cast<CALyricsContext*>(context)->syllableList()) {
+            addElement(syllable, count, bytes, marks, markBytes);
+        }
+        break;
+    case CAContext::FunctionMarkContext:
+        for (CAFunctionMark* mark : static_cast<CAFunctionMarkContext*>(context)->functionMarkList()) {
+            addElement(mark, count, bytes, marks, markBytes);
+        }
+        break;
+    case CAContext::FiguredBassContext:
+        for (CAFiguredBassMark* mark : static_cast<CAFiguredBassContext*>(context)->figuredBassMarkList()) {
+            addElement(mark, count, bytes, marks, markBytes);
+        }
+        break;
+    case CAContext::ChordNameContext:
+        for (CAChordName* chordName : static_cast<CAChordNameContext*>(context)->chordNameList()) {
+            addElement(chordName, count, bytes, marks, markBytes);
+        }
+        break;
+    }
+}
+
+void CADocumentStatistics::addElement(CAMusElement* elt, int* count, qint64* bytes, int* marks, qint64* markBytes)
+{
+    (*count)++;
+    *bytes += elementMemoryUsage(elt);
+    for (CAMark* mark : elt->markList()) {
+        (*marks)++;
+        *markBytes += elementMemoryUsage(mark);
+    }
+}
+
+#if !defined(SWIGCPP)
+/*!
+	Adds the parts of the document held by the user interface: the undo history, the score views
+	and the clipboard.
+*/
+void CADocumentStatistics::collectApplication()
+{
+    if (CACanorus::undo() && CACanorus::undo()->containsUndoStack(_document)) {
+        _undoCount = CACanorus::undo()->undoStack(_document)->size();
+        _undoBytes = CACanorus::undo()->memoryUsage(_document);
+    }
+
+    QSet<CASheetLayout*> layouts;
+    for (CAMainWin* mainWin : CACanorus::mainWinList()) {
+        if (mainWin->document() != _document) {
+            continue;
+        }
+
+        for (CAView* view : mainWin->viewList()) {
+            if (view->viewType() != CAView::ScoreView) {
+                continue;
+            }
+
+            CAScoreView* scoreView = static_cast<CAScoreView*>(view);
+            CASheetLayout* layout = scoreView->sheetLayout();
+            CAViewStatistics v;
+            v.name = scoreView->sheet() ? scoreView->sheet()->name() : QString();
+            v.drawables = layout ? layout->drawableMList().size() + layout->drawableCList().size() : 0;
+            v.tiles = scoreView->tileCount();
+            _views << v;
+
+            if (layout && !layouts.contains(layout)) {
+                layouts.insert(layout);
+                _drawableCount += v.drawables;
+            }
+            _tileCount += v.tiles;
+            _tileBytes += scoreView->tileMemoryUsage();
+        }
+    }
+    _drawableBytes = static_cast<qint64>(_drawableCount) * DRAWABLE_MEMORY_USAGE;
+
+    const CAMimeData* mimeData = dynamic_cast<const CAMimeData*>(QApplication::clipboard()->mimeData());
+    if (mimeData) {
+        int marks = 0;
+        qint64 markBytes = 0;
+        int contexts = _contextCount, voices = _voiceCount; // not a part of the document
+        for (CAContext* context : mimeData->contexts()) {
+            addContext(context, &_clipboardElementCount, &_clipboardBytes, &marks, &markBytes);
+        }
+        _contextCount = contexts;
+        _voiceCount = voices;
+        _clipboardElementCount += marks;
+        _clipboardBytes += markBytes;
+    }
+}
+#endif
+
+/*!
+	Returns the name of the sheet shown in the score view \a i.
+*/
+const QString CADocumentStatistics::viewName(int i)
+{
+    return (i >= 0 && i < _views.size()) ? _views[i].name : QString();
+}
+
+/*!
+	Returns the number of drawables in the layout of the score view \a i. Views of the same sheet
+	share the layout.
+*/
+int CADocumentStatistics::viewDrawableCount(int i)
+{
+    return (i >= 0 && i < _views.size()) ? _views[i].drawables : 0;
+}
+
+/*!
+	Returns the number of rendered tiles cached by the score view \a i.
+*/
+int CADocumentStatistics::viewTileCount(int i)
+{
+    return (i >= 0 && i < _views.size()) ? _views[i].tiles : 0;
+}
+
+/*!
+	Returns the sum of all the estimated sizes.
+*/
+qint64 CADocumentStatistics::totalBytes()
+{
+    return _elementBytes + _markBytes + _resourceBytes + _undoBytes + _drawableBytes + _tileBytes + _clipboardBytes;
+}
+
+/*!
+	Returns the statistics as a human-readable report with one part per line.
+*/
+const QString CADocumentStatistics::toString()
+{
+    QString s;
+    s += QObject::tr("Sheets: %1 (%2 not loaded), contexts: %3, voices: %4").arg(_sheetCount).arg(_unloadedSheetCount).arg(_contextCount).arg(_voiceCount) + "\n";
+    s += QObject::tr("Music elements: %1, %2").arg(_elementCount).arg(kiloBytes(_elementBytes)) + "\n";
+    s += QObject::tr("Marks: %1, %2").arg(_markCount).arg(kiloBytes(_markBytes)) + "\n";
+    s += QObject::tr("Resources: %1, %2").arg(_resourceCount).arg(kiloBytes(_resourceBytes)) + "\n";
+    s += QObject::tr("Undo history: %1 steps, %2").arg(_undoCount).arg(kiloBytes(_undoBytes)) + "\n";
+    s += QObject::tr("Drawables: %1, %2").arg(_drawableCount).arg(kiloBytes(_drawableBytes)) + "\n";
+    for (const CAViewStatistics& v : _views) {
+        s += QObject::tr("  View of %1: %2 drawables, %3 tiles").arg(v.name).arg(v.drawables).arg(v.tiles) + "\n";
+    }
+    s += QObject::tr("Rendered tiles: %1, %2").arg(_tileCount).arg(kiloBytes(_tileBytes)) + "\n";
+    s += QObject::tr("Clipboard: %1 elements, %2").arg(_clipboardElementCount).arg(kiloBytes(_clipboardBytes)) + "\n";
+    s += QObject::tr("Total: %1").arg(kiloBytes(totalBytes()));
+
+    return s;
+}
+
+/*!
+	Returns the statistics in a single line of key=value pairs for the periodic log. The sizes
+	are in bytes.
+*/
+const QString CADocumentStatistics::logLine()
+{
+    QString name = (_document && !_document->fileName().isEmpty()) ? QFileInfo(_document->fileName()).fileName() : QString("untitled");
+    return QString("memory: document=%1 elements=%2/%3 marks=%4/%5 resources=%6/%7 undo=%8/%9 drawables=%10/%11 tiles=%12/%13 clipboard=%14/%15 total=%16")
+        .arg(name)
+        .arg(_elementCount)
+        .arg(_elementBytes)
+        .arg(_markCount)
+        .arg(_markBytes)
+        .arg(_resourceCount)
+        .arg(_resourceBytes)
+        .arg(_undoCount)
+        .arg(_undoBytes)
+        .arg(_drawableCount)
+        .arg(_drawableBytes)
+        .arg(_tileCount)
+        .arg(_tileBytes)
+        .arg(_clipboardElementCount)
+        .arg(_clipboardBytes)
+        .arg(totalBytes());
+}
+
+/*!
+	Enables the periodic log, if --log-memory or --log-memory=<seconds> is passed in the command
+	line. The statistics are logged every minute by default. Returns True, if enabled.
+
+	\sa startLogging()
+*/
+bool CADocumentStatistics::parseArguments(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        QString arg(argv[i]);
+        if (arg == LOG_SWITCH) {
+            _logInterval = 60;
+        } else if (arg.startsWith(LOG_SWITCH + "=")) {
+            _logInterval = qMax(arg.mid(LOG_SWITCH.size() + 1).toInt(), 1);
+        }
+    }
+
+    return _logInterval > 0;
+}
+
+#if !defined(SWIGCPP)
+/*!
+	Starts logging the statistics of all the opened documents, if enabled by parseArguments().
+	Must be called from the main thread after the application is created.
+*/
+void CADocumentStatistics::startLogging()
+{
+    if (_logInterval <= 0) {
+        return;
+    }
+
+    QTimer* timer = new QTimer(qApp);
+    timer->setInterval(_logInterval * 1000);
+    QObject::connect(timer, &QTimer::timeout, []() {
+        QList<CADocument*> documents;
+        for (CAMainWin* mainWin : CACanorus::mainWinList()) {
+            if (mainWin->document() && !documents.contains(mainWin->document())) {
+                documents << mainWin->document();
+            }
+        }
+        for (CADocument* document : documents) {
+            qDebug("%s", qPrintable(CADocumentStatistics(document).logLine()));
+        }
+    });
+    timer->start();
+}
+#else
+void CADocumentStatistics::startLogging()
+{
+}
+#endif
@@ -0,0 +1,97 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef DOCUMENTSTATISTICS_H_
+#define DOCUMENTSTATISTICS_H_
+
+#include <QList>
+#include <QString>
+
+class CADocument;
+class CAContext;
+class CAMusElement;
+
+class CADocumentStatistics {
+public:
+    CADocumentStatistics(CADocument* document);
+
+    inline CADocument* document() { return _document; }
+
+    inline int sheetCount() { return _sheetCount; }
+    inline int unloadedSheetCount() { return _unloadedSheetCount; }
+    inline int contextCount() { return _contextCount; }
+    inline int voiceCount() { return _voiceCount; }
+    inline int elementCount() { return _elementCount; }
+    inline qint64 elementBytes() { return _elementBytes; }
+    inline int markCount() { return _markCount; }
+    inline qint64 markBytes() { return _markBytes; }
+    inline int resourceCount() { return _resourceCount; }
+    inline qint64 resourceBytes() { return _resourceBytes; }
+
+    inline int undoCount() { return _undoCount; }
+    inline qint64 undoBytes() { return _undoBytes; }
+    inline int viewCount() { return _views.size(); }
+    const QString viewName(int i);
+    int viewDrawableCount(int i);
+    int viewTileCount(int i);
+    inline int drawableCount() { return _drawableCount; }
+    inline qint64 drawableBytes() { return _drawableBytes; }
+    inline int tileCount() { return _tileCount; }
+    inline qint64 tileBytes() { return _tileBytes; }
+    inline int clipboardElementCount() { return _clipboardElementCount; }
+    inline qint64 clipboardBytes() { return _clipboardBytes; }
+
+    qint64 totalBytes();
+    const QString toString();
+    const QString logLine();
+
+    static bool parseArguments(int argc, char* argv[]);
+    static void startLogging();
+
+    static const QString LOG_SWITCH;
+    static const int DRAWABLE_MEMORY_USAGE;
+
+private:
+    void addContext(CAContext* context, int* count, qint64* bytes, int* marks, qint64* markBytes);
+    void addElement(CAMusElement* elt, int* count, qint64* bytes, int* marks, qint64* markBytes);
+#if !defined(SWIG) && !defined(SWIGCPP)
+    void collectApplication();
+#endif
+
+    CADocument* _document;
+    int _sheetCount;
+    int _unloadedSheetCount; // sheets of binary documents not read yet, their content isn't counted
+    int _contextCount;
+    int _voiceCount;
+    int _elementCount; // music elements, syllables, function marks etc. without the marks
+    qint64 _elementBytes;
+    int _markCount;
+    qint64 _markBytes;
+    int _resourceCount;
+    qint64 _resourceBytes; // size of the attached files, the linked ones are not counted
+    int _undoCount; // commands on the undo stack
+    qint64 _undoBytes; // see CAUndo::memoryUsage()
+    int _drawableCount; // drawables of the sheet layouts shown, each shared layout counted once
+    qint64 _drawableBytes;
+    int _tileCount;
+    qint64 _tileBytes;
+    int _clipboardElementCount; // the clipboard is shared by all the documents
+    qint64 _clipboardBytes;
+
+#ifndef SWIG
+    struct CAViewStatistics {
+        QString name;
+        int drawables;
+        int tiles;
+    };
+    QList<CAViewStatistics> _views; // score views of the document in all main windows
+
+    static int _logInterval; // in seconds, 0 if the periodic log is disabled
+#endif
+};
+
+#endif /* DOCUMENTSTATISTICS_H_ */
@@ -0,0 +1,147 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include "core/eventstore.h"
+
+#include "score/diatonicpitch.h"
+#include "score/note.h"
+#include "score/sheet.h"
+#include "score/slur.h"
+#include "score/staff.h"
+#include "score/voice.h"
+
+/*!
+	\class CAEventStore
+	\brief Snapshot of the music elements of a sheet for rendering to midi
+
+	The store generates one row for each music element of all the voices in the sheet. Voices
+	are stored one after another in the order of the contexts and each voice keeps the order of its
+	music element list, so the element at index \a idx of the stream \a s is at row(s, idx).
+
+	The start times, lengths, midi channels, midi pitches, velocities and flags of the rows are
+	stored in separate contiguous arrays. The renderers (eg. CAPlayback and the midi export using it)
+	read these instead of following the note, voice and pitch of every element again.
+
+	The store is not updated when the sheet changes. Call build() again to refresh it.
+
+	\sa CAPlayback
+*/
+
+const unsigned char CAEventStore::DEFAULT_VELOCITY = 127;
+
+CAEventStore::CAEventStore()
+{
+    _streamOffsets << 0;
+}
+
+/*!
+	Creates the store and generates the rows for the given \a sheet.
+*/
+CAEventStore::CAEventStore(CASheet* sheet)
+{
+    _streamOffsets << 0;
+    build(sheet);
+}
+
+/*!
+	Removes all the rows and generates them for the voices of the given \a sheet.
+*/
+void CAEventStore::build(CASheet* sheet)
+{
+    build(sheet->voiceList());
+}
+
+/*!
+	Removes all the rows and generates them for the given \a voices, one stream per voice in the
+	given order.
+*/
+void CAEventStore::build(const QList<CAVoice*>& voices)
+{
+    clear();
+
+    _voices = voices;
+    int rows = 0;
+    for (int i = 0; i < _voices.size(); i++) {
+        rows += _voices[i]->musElementList().size();
+    }
+
+    _time.reserve(rows);
+    _length.reserve(rows);
+    _channel.reserve(rows);
+    _pitch.reserve(rows);
+    _velocity.reserve(rows);
+    _flags.reserve(rows);
+    _elements.reserve(rows);
+    _streamOffsets.reserve(_voices.size() + 1);
+
+    for (int i = 0; i < _voices.size(); i++) {
+        CAVoice* voice = _voices[i];
+        const QList<CAMusElement*>& list = voice->musElementList();
+        unsigned char channel = voice->midiChannel();
+        int pitchOffset = voice->midiPitchOffset();
+
+        for (int j = 0; j < list.size(); j++) {
+            CAMusElement* elt = list[j];
+            unsigned char pitch = 0;
+            unsigned char velocity = 0;
+            unsigned char flags = 0;
+
+            if (elt->isPlayable()) {
+                flags |= Playable;
+            }
+
+            if (elt->musElementType() == CAMusElement::Note) {
+                CANote* note = static_cast<CANote*>(elt);
+                pitch = static_cast<unsigned char>(CADiatonicPitch::diatonicPitchToMidiPitch(note->diatonicPitch()) + pitchOffset);
+                velocity = DEFAULT_VELOCITY;
+                flags |= Note;
+                if (note->tieStart() && note->tieStart()->noteEnd())
+                    flags |= TieStart;
+                if (note->tieEnd())
+                    flags |= TieEnd;
+                if (note->isFirstInChord())
+                    flags |= FirstInChord;
+            }
+
+            _time << elt->timeStart();
+            _length << elt->timeLength();
+            _channel << channel;
+            _pitch << pitch;
+            _velocity << velocity;
+            _flags << flags;
+            _elements << elt;
+        }
+
+        _streamOffsets << _time.size();
+    }
+}
+
+/*!
+	Removes all the rows and streams.
+*/
+void CAEventStore::clear()
+{
+    _voices.clear();
+    _streamOffsets.clear();
+    _streamOffsets << 0;
+
+    _time.clear();
+    _length.clear();
+    _channel.clear();
+    _pitch.clear();
+    _velocity.clear();
+    _flags.clear();
+    _elements.clear();
+}
+
+/*!
+	Returns the playable element of the given \a row or nullptr, if the element is not playable.
+*/
+CAPlayable* CAEventStore::playable(int row) const
+{
+    return (_flags[row] & Playable) ? static_cast<CAPlayable*>(_elements[row]) : nullptr;
+}
@@ -0,0 +1,77 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef EVENTSTORE_H_
+#define EVENTSTORE_H_
+
+#include <QList>
+#include <QVector>
+
+class CASheet;
+class CAVoice;
+class CAMusElement;
+class CAPlayable;
+
+class CAEventStore {
+public:
+    enum CAEventFlag {
+        Playable = 0x01, // the element is a note or a rest
+        Note = 0x02, // the element is a note and sounds
+        TieStart = 0x04, // the note is tied to a following note and shouldn't be switched off
+        TieEnd = 0x08, // the note continues a tie and shouldn't be switched on
+        FirstInChord = 0x10 // the note is the first note in its chord
+    };
+
+    CAEventStore();
+    CAEventStore(CASheet* sheet);
+
+    void build(CASheet* sheet);
+    void build(const QList<CAVoice*>& voices);
+    void clear();
+
+    inline int size() const { return _time.size(); }
+    inline bool isEmpty() const { return _time.isEmpty(); }
+
+    inline int streamCount() const { return _voices.size(); }
+    inline CAVoice* voice(int stream) const { return _voices[stream]; }
+    inline int streamBegin(int stream) const { return _streamOffsets[stream]; }
+    inline int streamEnd(int stream) const { return _streamOffsets[stream + 1]; }
+    inline int row(int stream, int idx) const { return _streamOffsets[stream] + idx; }
+
+    inline int time(int row) const { return _time[row]; }
+    inline int length(int row) const { return _length[row]; }
+    inline int timeEnd(int row) const { return _time[row] + _length[row]; }
+    inline unsigned char channel(int row) const { return _channel[row]; }
+    inline unsigned char pitch(int row) const { return _pitch[row]; }
+    inline unsigned char velocity(int row) const { return _velocity[row]; }
+    inline unsigned char flags(int row) const { return _flags[row]; }
+    inline CAMusElement* element(int row) const { return _elements[row]; }
+    CAPlayable* playable(int row) const;
+
+    inline const QVector<int>& times() const { return _time; }
+    inline const QVector<int>& lengths() const { return _length; }
+    inline const QVector<unsigned char>& channels() const { return _channel; }
+    inline const QVector<unsigned char>& pitches() const { return _pitch; }
+    inline const QVector<unsigned char>& velocities() const { return _velocity; }
+    inline const QVector<unsigned char>& flagList() const { return _flags; }
+
+private:
+    static const unsigned char DEFAULT_VELOCITY; // velocity of the notes, dynamics are sent as volume changes
+
+    QList<CAVoice*> _voices; // voices the streams were generated from
+    QVector<int> _streamOffsets; // first row of each stream and the total number of rows at the end
+
+    QVector<int> _time; // start time of the element
+    QVector<int> _length; // time length of the element
+    QVector<unsigned char> _channel; // midi channel of the voice
+    QVector<unsigned char> _pitch; // midi pitch of the note including the voice pitch offset
+    QVector<unsigned char> _velocity; // midi velocity of the note
+    QVector<unsigned char> _flags; // CAEventFlag combination
+    QVector<CAMusElement*> _elements; // element the row was generated from
+};
+
+#endif /* EVENTSTORE_H_ */
@@ -19,22 +19,60 @@
 
 	All file operations are done in a separate thread. While the file operations are in progress user
 	can poll the status by calling status(), progress() and readableStatus() for human-readable status
-	defined by the filter. Waiting for the thread to be finished can be implemented by calling QThread::wait()
+	defined by the filter. The operation is aborted by cancel(). Filters check isCanceled() at coarse
+	points and set the CANCELED status. Filters report the work done in bytes read or elements
+	written by setProgress(qint64, qint64, CAProgress::CAProgressUnit), so the caller can also
+	show the throughput, see CAProgress::throughput(). Waiting for the thread to be finished can be implemented by calling QThread::wait()
 	or by catching the signals emitted by children import and export classes.
 
 	\sa CAImport, CAExport
 */
 
+const int CAFile::CANCELED = -100;
+
 CAFile::CAFile()
     : QThread()
+    , _progress(&_ownProgress)
 {
-    setProgress(0);
     setStatus(0);
     setStream(nullptr);
     setFile(nullptr);
     _deleteStream = false;
 }
 
+/*!
+	Makes the filter report its progress to and stop on the cancel request of the given \a progress
+	owned by the caller, eg. the token of the outer import reading this file. Setting null restores
+	the own token of the filter.
+*/
+void CAFile::setProgressToken(CAProgress* progress)
+{
+    _progress = progress ? progress : &_ownProgress;
+}
+
+/*!
+	Restarts the progress and the throughput estimate when the filter starts working. The token of
+	the caller set by setProgressToken() is left as is, because it measures the outer operation.
+*/
+void CAFile::startProgress()
+{
+    if (_progress == &_ownProgress) {
+        _ownProgress.start();
+    }
+}
+
+/*!
+	Marks the whole work done after the filter successfully finished, so the filters which don't
+	report their progress get to 100% as well.
+*/
+void CAFile::finishProgress()
+{
+    if (_progress == &_ownProgress && !isCanceled()) {
+        qint64 total = qMax(_ownProgress.total(), _ownProgress.done());
+        _ownProgress.setProgress(total ? total : 1, total ? total : 1, _ownProgress.unit());
+    }
+}
+
 /*!
 	Destructor.
 	Also destroys the created stream and file, if set.
@@ -71,12 +109,13 @@ void CAFile::setStreamFromFile(const QString filename)
 
 /*!
 	Creates and sets the stream from the file named \a filename.
-	Stream is Read-Write.
+	The file is opened with the given \a mode, write only by default. Pass QIODevice::Append to
+	keep the existing content, see CACanExport::setJournaled().
 	This method is usually called from the main window when saving the document.
 	This method is also very important for python developers as they cannot directly
 	access QTextStream class, so they call this wrapper instead with a simple string as parameter.
 */
-void CAFile::setStreamToFile(const QString filename)
+void CAFile::setStreamToFile(const QString filename, QIODevice::OpenMode mode)
 {
     if (stream() && _deleteStream) {
         delete stream();
@@ -84,7 +123,7 @@ void CAFile::setStreamToFile(const QString filename)
     }
     setFile(new QFile(filename));
 
-    if (file()->open(QIODevice::WriteOnly)) {
+    if (file()->open(mode)) {
         setStream(new QTextStream(file()));
         _deleteStream = true;
     }
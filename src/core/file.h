@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2007-2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -11,6 +11,8 @@
 #include <QFile>
 #include <QThread>
 
+#include "core/progress.h"
+
 class QTextStream;
 
 class CAFile : public QThread {
@@ -19,10 +21,15 @@ public:
     virtual ~CAFile();
 
     inline int status() { return _status; }
-    inline int progress() { return _progress; }
+    inline int progress() { return _progress->progress(); }
+    inline CAProgress* progressToken() { return _progress; }
+    void setProgressToken(CAProgress* progress);
+    virtual void cancel() { _progress->cancel(); }
+    inline bool isCanceled() { return _progress->isCanceled(); }
     virtual const QString readableStatus() = 0;
+    static const int CANCELED; // status of the canceled operation
     void setStreamFromFile(const QString filename);
-    void setStreamToFile(const QString filename);
+    void setStreamToFile(const QString filename, QIODevice::OpenMode mode = QIODevice::WriteOnly);
     void setStreamFromDevice(QIODevice* device);
     void setStreamToDevice(QIODevice* device);
 
@@ -31,7 +38,10 @@ public:
 
 protected:
     inline void setStatus(const int status) { _status = status; }
-    inline void setProgress(const int progress) { _progress = progress; }
+    inline void setProgress(const int progress) { _progress->setProgress(progress); }
+    inline void setProgress(qint64 done, qint64 total, CAProgress::CAProgressUnit unit = CAProgress::Elements) { _progress->setProgress(done, total, unit); }
+    void startProgress();
+    void finishProgress();
 
     inline QTextStream* stream() { return _stream; }
     virtual void setStream(QTextStream* stream) { _stream = stream; }
@@ -41,7 +51,8 @@ protected:
 
 private:
     int _status; // status number
-    int _progress; // percentage of the work already done
+    CAProgress* _progress; // progress and cancellation shared with the caller, _ownProgress by default
+    CAProgress _ownProgress;
     QTextStream* _stream;
     QFile* _file;
     bool _deleteStream; // whether to delete stream when destroyed.
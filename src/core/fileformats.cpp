@@ -1,11 +1,13 @@
 /*! 
-	Copyright (c) 2006-2019, Reinhard Katzmann, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Reinhard Katzmann, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 	
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
 */
 
 #include "core/fileformats.h"
+#include <QFile>
+#include <QFileInfo>
 #include <QObject>
 
 /*!
@@ -13,10 +15,15 @@
 	\brief File formats supported by Canorus
 	This class contains the filters shown in file dialogs (eg. when opening/saving a document) and its internal
 	enumeration values used when storing settings for default or last used filter.
+
+	CanBinary is the Canorus archive with the score stored in binary CanorusML (content.bin, see
+	CABinaryMLReader) instead of CanorusML XML (content.xml). It is faster to save and open, but
+	cannot be opened by older versions of Canorus.
 */
 
 const QString CAFileFormats::CANORUSML_FILTER = QObject::tr("Canorus document (*.xml)");
 const QString CAFileFormats::CAN_FILTER = QObject::tr("Canorus archive (*.can)");
+const QString CAFileFormats::CAN_BINARY_FILTER = QObject::tr("Canorus archive, binary score (*.can)");
 const QString CAFileFormats::LILYPOND_FILTER = QObject::tr("LilyPond document (*.ly)");
 const QString CAFileFormats::MUSICXML_FILTER = QObject::tr("MusicXML document (*.musicxml)");
 const QString CAFileFormats::MXL_FILTER = QObject::tr("Compressed MusicXML document (*.mxl)");
@@ -28,6 +35,14 @@ const QString CAFileFormats::CAPELLA_FILTER = QObject::tr("Capella document (*.c
 const QString CAFileFormats::MIDI_FILTER = QObject::tr("Midi file (*.mid *.midi)");
 const QString CAFileFormats::PDF_FILTER = QObject::tr("PDF file (*.pdf)");
 const QString CAFileFormats::SVG_FILTER = QObject::tr("SVG file (*.svg)");
+const QString CAFileFormats::ENGRAVED_PDF_FILTER = QObject::tr("PDF file, Canorus engraving (*.pdf)");
+const QString CAFileFormats::ENGRAVED_SVG_FILTER = QObject::tr("SVG file, Canorus engraving (*.svg)");
+const QString CAFileFormats::WAV_FILTER = QObject::tr("WAV audio (*.wav)");
+const QString CAFileFormats::FLAC_FILTER = QObject::tr("FLAC audio (*.flac)");
+
+const QByteArray CAFileFormats::CANORUSML_BINARY_MAGIC = QByteArray("CAML");
+const quint16 CAFileFormats::CANORUSML_BINARY_VERSION = 1;
+const int CAFileFormats::SNIFF_SIZE = 4096; // bytes read by detectType()
 
 /*!
 	Converts the file format enumeration to filter as string.
@@ -39,6 +54,8 @@ const QString CAFileFormats::getFilter(const CAFileFormats::CAFileFormatType t)
         return CANORUSML_FILTER;
     case Can:
         return CAN_FILTER;
+    case CanBinary:
+        return CAN_BINARY_FILTER;
     case LilyPond:
         return LILYPOND_FILTER;
     case MusicXML:
@@ -49,6 +66,14 @@ const QString CAFileFormats::getFilter(const CAFileFormats::CAFileFormatType t)
         return PDF_FILTER;
     case SVG:
         return SVG_FILTER;
+    case EngravedPDF:
+        return ENGRAVED_PDF_FILTER;
+    case EngravedSVG:
+        return ENGRAVED_SVG_FILTER;
+    case WAV:
+        return WAV_FILTER;
+    case FLAC:
+        return FLAC_FILTER;
     default:
         return CANORUSML_FILTER;
     }
@@ -63,6 +88,8 @@ CAFileFormats::CAFileFormatType CAFileFormats::getType(const QString t)
         return CanorusML;
     else if (t == CAN_FILTER)
         return Can;
+    else if (t == CAN_BINARY_FILTER)
+        return CanBinary;
     if (t == LILYPOND_FILTER)
         return LilyPond;
     else if (t == MUSICXML_FILTER)
@@ -73,6 +100,114 @@ CAFileFormats::CAFileFormatType CAFileFormats::getType(const QString t)
         return PDF;
     else if (t == SVG_FILTER)
         return SVG;
+    else if (t == ENGRAVED_PDF_FILTER)
+        return EngravedPDF;
+    else if (t == ENGRAVED_SVG_FILTER)
+        return EngravedSVG;
+    else if (t == WAV_FILTER)
+        return WAV;
+    else if (t == FLAC_FILTER)
+        return FLAC;
     else
         return CanorusML;
 }
+
+/*!
+	Returns the format of the file starting with \a head determined by its magic bytes:
+	the gzip header of the Canorus archive, the PK zip header of the compressed MusicXML, the MThd
+	chunk of the MIDI file, the magic of binary CanorusML, the \\version command of LilyPond and
+	the root element of CanorusML and MusicXML. Returns Unknown, if none of them is found.
+*/
+CAFileFormats::CAFileFormatType CAFileFormats::sniffType(const QByteArray& head)
+{
+    if (head.startsWith("\x1f\x8b")) {
+        return Can;
+    } else if (head.startsWith("PK\x03\x04")) {
+        return MXL;
+    } else if (head.startsWith("MThd")) {
+        return Midi;
+    } else if (head.startsWith(CANORUSML_BINARY_MAGIC)) {
+        return CanorusML;
+    }
+
+    QByteArray root = xmlRootElement(head);
+    if (root == "canorus-document") {
+        return CanorusML;
+    } else if (root == "score-partwise" || root == "score-timewise") {
+        return MusicXML;
+    } else if (root.isEmpty() && head.contains("\\version")) {
+        return LilyPond;
+    }
+
+    return Unknown;
+}
+
+/*!
+	Returns the name of the root element of the XML document starting with \a head or an empty
+	array, if \a head doesn't start with XML. The XML declaration, processing instructions,
+	comments and the document type are skipped.
+*/
+QByteArray CAFileFormats::xmlRootElement(const QByteArray& head)
+{
+    int i = head.startsWith("\xef\xbb\xbf") ? 3 : 0; // UTF-8 byte order mark
+    while (i < head.size()) {
+        char c = head[i];
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            i++;
+        } else if (c != '<' || i + 1 >= head.size()) {
+            return QByteArray();
+        } else if (head.mid(i, 4) == "<!--") {
+            i = head.indexOf("-->", i + 4);
+            if (i < 0) {
+                return QByteArray();
+            }
+            i += 3;
+        } else if (head[i + 1] == '?' || head[i + 1] == '!') {
+            i = head.indexOf('>', i + 2);
+            if (i < 0) {
+                return QByteArray();
+            }
+            i++;
+        } else {
+            int end = ++i;
+            while (end < head.size() && !QByteArray(" \t\r\n/>").contains(head[end])) {
+                end++;
+            }
+            return head.mid(i, end - i);
+        }
+    }
+
+    return QByteArray();
+}
+
+/*!
+	Returns the format of the file \a fileName. Only the first SNIFF_SIZE bytes are read and
+	passed to sniffType(). If the format cannot be sniffed, the file name extension is used.
+*/
+CAFileFormats::CAFileFormatType CAFileFormats::detectType(const QString& fileName)
+{
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly)) {
+        CAFileFormatType type = sniffType(file.read(SNIFF_SIZE));
+        if (type != Unknown) {
+            return type;
+        }
+    }
+
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+    if (suffix == "can") {
+        return Can;
+    } else if (suffix == "xml") {
+        return CanorusML;
+    } else if (suffix == "musicxml") {
+        return MusicXML;
+    } else if (suffix == "mxl") {
+        return MXL;
+    } else if (suffix == "mid" || suffix == "midi") {
+        return Midi;
+    } else if (suffix == "ly") {
+        return LilyPond;
+    }
+
+    return Unknown;
+}
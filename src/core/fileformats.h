@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2019, Reinhard Katzmann, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Reinhard Katzmann, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -8,11 +8,13 @@
 #ifndef FILEFORMATS_H_
 #define FILEFORMATS_H_
 
+#include <QByteArray>
 #include <QString>
 
 class CAFileFormats {
 public:
     enum CAFileFormatType {
+        Unknown = 0,
         CanorusML = 1,
         Can = 2,
         LilyPond = 3,
@@ -28,12 +30,18 @@ public:
         Capella = 12,
         Midi = 13,
         PDF = 14,
-        SVG = 15
+        SVG = 15,
+        EngravedPDF = 17,
+        EngravedSVG = 18,
+        CanBinary = 19,
+        WAV = 20,
+        FLAC = 21
     };
 
     static const QString LILYPOND_FILTER;
     static const QString CANORUSML_FILTER;
     static const QString CAN_FILTER;
+    static const QString CAN_BINARY_FILTER;
     static const QString MUSICXML_FILTER;
     static const QString MXL_FILTER;
     static const QString NOTEEDIT_FILTER;
@@ -44,9 +52,22 @@ public:
     static const QString MIDI_FILTER;
     static const QString PDF_FILTER;
     static const QString SVG_FILTER;
+    static const QString ENGRAVED_PDF_FILTER;
+    static const QString ENGRAVED_SVG_FILTER;
+    static const QString WAV_FILTER;
+    static const QString FLAC_FILTER;
+
+    static const QByteArray CANORUSML_BINARY_MAGIC;
+    static const quint16 CANORUSML_BINARY_VERSION;
+    static const int SNIFF_SIZE;
 
     static const QString getFilter(const CAFileFormatType);
     static CAFileFormatType getType(const QString);
+    static CAFileFormatType sniffType(const QByteArray& head);
+    static CAFileFormatType detectType(const QString& fileName);
+
+private:
+    static QByteArray xmlRootElement(const QByteArray& head);
 };
 
 #endif /*FILEFORMATS_H_*/
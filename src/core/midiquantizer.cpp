@@ -0,0 +1,252 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#include <QHash>
+
+#include "core/midiquantizer.h"
+
+#include <algorithm>
+
+const int CAMidiQuantizer::COMPLEXITY_COST = 1;
+const int CAMidiQuantizer::TRIPLET_COST = 16;
+
+namespace {
+
+// candidate grids of the automatic detection, from the coarsest to the finest
+const CAPlayableLength::CAMusicLength candidateGrids[] = {
+    CAPlayableLength::Quarter,
+    CAPlayableLength::Eighth,
+    CAPlayableLength::Sixteenth,
+    CAPlayableLength::ThirtySecond,
+    CAPlayableLength::SixtyFourth
+};
+
+inline int quarterTime()
+{
+    return CAPlayableLength::playableLengthToTimeLength(CAPlayableLength::Quarter);
+}
+
+inline int snapTime(int time, int grid)
+{
+    return ((time + grid / 2) / grid) * grid;
+}
+
+/*!
+	Returns the \a time moved to the nearest eighth triplet of its quarter. The triplets are
+	rounded the same way as CATuplet rounds the times of its members.
+*/
+inline int tripletTime(int time)
+{
+    int beatStart = (time / quarterTime()) * quarterTime();
+    return beatStart + (CAMidiQuantizer::tripletSlot(time - beatStart) * quarterTime() + 1) / 3;
+}
+
+}
+
+/*!
+	\class CAMidiQuantizer
+	\brief Quantization of the played notes to the score times
+
+	Moves the starts and ends of the notes read from a MIDI file or recorded from a MIDI device
+	to a grid, so they can be written as notes and rests of the score. Used by CAMidiImport and
+	CAMidiRecorder.
+
+	The grid is either set by setGrid() or detected from the notes, when it is Undefined. The
+	detection is driven by a cost model: each candidate grid is charged the mean distance of the
+	note starts to the grid plus COMPLEXITY_COST for every subdivision of the quarter. Finer grids
+	always fit better, so the penalty keeps the quantizer at the coarsest grid which still
+	describes the rhythm and avoids producing many short notes and ties out of a played
+	performance.
+
+	When triplets() are enabled, each quarter is checked for eighth triplets too. A quarter is
+	quantized on the triplets, when this saves more than TRIPLET_COST of the distance to the
+	grid and all the notes starting or ending inside the quarter stay in it, so they can be put
+	under a single tuplet. Use isTripletBeat() to get the result.
+
+	Finally, the notes of each channel played together with slightly different ends become a
+	chord and the notes held slightly over the start of the next note (legato) are shortened.
+	Only the notes which really overlap remain for a separate voice.
+*/
+
+CAMidiQuantizer::CAMidiQuantizer()
+    : _grid(CAPlayableLength::Undefined)
+    , _triplets(true)
+    , _gridTime(CAPlayableLength::playableLengthToTimeLength(CAPlayableLength::Sixteenth))
+{
+}
+
+/*!
+	Quantizes the starts and lengths of the given \a notes in place. The order of the notes is
+	kept and every note is at least one grid step long afterwards.
+*/
+void CAMidiQuantizer::quantize(QVector<CAMidiQuantizerNote>& notes)
+{
+    _gridTime = (_grid == CAPlayableLength::Undefined) ? detectGrid(notes) : CAPlayableLength::playableLengthToTimeLength(_grid);
+    if (_gridTime < 1) {
+        _gridTime = CAPlayableLength::playableLengthToTimeLength(CAPlayableLength::HundredTwentyEighth);
+    }
+    detectTriplets(notes);
+
+    for (CAMidiQuantizerNote& note : notes) {
+        int end = quantizeTime(note.time + note.length);
+        note.time = quantizeTime(note.time);
+        note.length = qMax(end, nextTime(note.time)) - note.time;
+    }
+
+    mergeNotes(notes);
+}
+
+/*!
+	Returns the \a time moved to the nearest time of the grid used by the last quantize().
+*/
+int CAMidiQuantizer::quantizeTime(int time) const
+{
+    return isTripletBeat(time) ? tripletTime(time) : snapTime(time, _gridTime);
+}
+
+/*!
+	Returns True, if the quarter containing the given \a time was quantized on eighth triplets.
+*/
+bool CAMidiQuantizer::isTripletBeat(int time) const
+{
+    return !_tripletBeats.isEmpty() && _tripletBeats.contains(time / quarterTime());
+}
+
+/*!
+	Returns the index of the nearest eighth triplet, 0 to 3, for the \a time offset from the start
+	of a quarter.
+*/
+int CAMidiQuantizer::tripletSlot(int time)
+{
+    return (time * 3 + quarterTime() / 2) / quarterTime();
+}
+
+/*!
+	Returns the grid time with the lowest cost for the given \a notes, see the class description.
+*/
+int CAMidiQuantizer::detectGrid(const QVector<CAMidiQuantizerNote>& notes) const
+{
+    int best = CAPlayableLength::playableLengthToTimeLength(CAPlayableLength::Sixteenth);
+    if (notes.isEmpty()) {
+        return best;
+    }
+
+    qint64 bestCost = -1;
+    for (CAPlayableLength::CAMusicLength candidate : candidateGrids) {
+        int grid = CAPlayableLength::playableLengthToTimeLength(candidate);
+        qint64 cost = static_cast<qint64>(COMPLEXITY_COST) * (quarterTime() / grid) * notes.size();
+        for (const CAMidiQuantizerNote& note : notes) {
+            cost += qAbs(note.time - snapTime(note.time, grid));
+            if (bestCost != -1 && cost >= bestCost) {
+                break; // already worse than a coarser grid
+            }
+        }
+
+        if (bestCost == -1 || cost < bestCost) {
+            bestCost = cost;
+            best = grid;
+        }
+    }
+
+    return best;
+}
+
+void CAMidiQuantizer::detectTriplets(const QVector<CAMidiQuantizerNote>& notes)
+{
+    _tripletBeats.clear();
+    if (!_triplets || _gridTime >= quarterTime()) {
+        return;
+    }
+
+    QHash<int, int> savings; // distance of the starts to the grid minus the distance to the triplets per quarter
+    QSet<int> candidates;
+    QSet<int> blocked; // quarters with notes going over their borders
+    for (const CAMidiQuantizerNote& note : notes) {
+        int beat = note.time / quarterTime();
+        int start = tripletTime(note.time);
+        int end = tripletTime(note.time + note.length);
+        savings[beat] += qAbs(note.time - snapTime(note.time, _gridTime)) - qAbs(note.time - start);
+
+        if (start % quarterTime()) {
+            candidates << beat;
+            if (end > (beat + 1) * quarterTime()) {
+                blocked << beat;
+            }
+        }
+        if ((end % quarterTime()) && start < (end / quarterTime()) * quarterTime()) {
+            blocked << end / quarterTime();
+        }
+    }
+
+    for (int beat : candidates) {
+        if (!blocked.contains(beat) && savings.value(beat) > TRIPLET_COST) {
+            _tripletBeats << beat;
+        }
+    }
+}
+
+/*!
+	Returns the grid time following the quantized \a time.
+*/
+int CAMidiQuantizer::nextTime(int time) const
+{
+    if (isTripletBeat(time)) {
+        int beatStart = (time / quarterTime()) * quarterTime();
+        return beatStart + ((tripletSlot(time - beatStart) + 1) * quarterTime() + 1) / 3;
+    }
+
+    return time + _gridTime;
+}
+
+/*!
+	Joins the notes of a channel starting together and ending at most one grid step apart into a
+	chord of the longest one and shortens the notes held over the start of the next note by at
+	most a grid step or a quarter of their length.
+*/
+void CAMidiQuantizer::mergeNotes(QVector<CAMidiQuantizerNote>& notes) const
+{
+    QVector<int> order(notes.size());
+    for (int i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&notes](int a, int b) {
+        return notes[a].channel < notes[b].channel || (notes[a].channel == notes[b].channel && notes[a].time < notes[b].time);
+    });
+
+    for (int first = 0; first < order.size();) {
+        const CAMidiQuantizerNote& start = notes[order[first]];
+        int last = first + 1;
+        while (last < order.size() && notes[order[last]].channel == start.channel && notes[order[last]].time == start.time) {
+            last++;
+        }
+        int nextStart = (last < order.size() && notes[order[last]].channel == start.channel) ? notes[order[last]].time : -1;
+
+        // chords, the notes with the same start are sorted by their ends
+        std::sort(order.begin() + first, order.begin() + last, [&notes](int a, int b) { return notes[a].length < notes[b].length; });
+        for (int i = first; i < last;) {
+            int j = i + 1;
+            while (j < last && notes[order[j]].length - notes[order[j - 1]].length <= _gridTime) {
+                j++;
+            }
+            for (int k = i; k < j - 1; k++) {
+                notes[order[k]].length = notes[order[j - 1]].length;
+            }
+            i = j;
+        }
+
+        // legato
+        for (int i = first; nextStart != -1 && i < last; i++) {
+            CAMidiQuantizerNote& note = notes[order[i]];
+            int overlap = note.time + note.length - nextStart;
+            if (overlap > 0 && overlap <= qMax(_gridTime, note.length / 4)) {
+                note.length = nextStart - note.time;
+            }
+        }
+
+        first = last;
+    }
+}
@@ -0,0 +1,55 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#ifndef MIDIQUANTIZER_H_
+#define MIDIQUANTIZER_H_
+
+#include <QSet>
+#include <QVector>
+
+#include "score/playablelength.h"
+
+struct CAMidiQuantizerNote {
+    int time; // time start in Canorus time
+    int length; // time length in Canorus time
+    int channel;
+    int pitch;
+};
+
+class CAMidiQuantizer {
+public:
+    CAMidiQuantizer();
+
+    inline CAPlayableLength::CAMusicLength grid() const { return _grid; }
+    inline void setGrid(CAPlayableLength::CAMusicLength grid) { _grid = grid; }
+    inline bool triplets() const { return _triplets; }
+    inline void setTriplets(bool triplets) { _triplets = triplets; }
+
+    void quantize(QVector<CAMidiQuantizerNote>& notes);
+    int quantizeTime(int time) const;
+
+    inline int gridTime() const { return _gridTime; }
+    bool isTripletBeat(int time) const;
+
+    static int tripletSlot(int time);
+
+    static const int COMPLEXITY_COST;
+    static const int TRIPLET_COST;
+
+private:
+    int detectGrid(const QVector<CAMidiQuantizerNote>& notes) const;
+    void detectTriplets(const QVector<CAMidiQuantizerNote>& notes);
+    int nextTime(int time) const;
+    void mergeNotes(QVector<CAMidiQuantizerNote>& notes) const;
+
+    CAPlayableLength::CAMusicLength _grid; // Undefined for the automatic detection
+    bool _triplets;
+    int _gridTime; // binary grid of the last quantize() in Canorus time
+    QSet<int> _tripletBeats; // indices of the quarters quantized on the eighth triplets
+};
+
+#endif /* MIDIQUANTIZER_H_ */
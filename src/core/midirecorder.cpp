@@ -5,11 +5,27 @@
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
 */
 
+#include <QHash>
+
+#ifndef SWIGCPP
+#include "canorus.h" // needed for settings()
+#include "core/settings.h"
+#endif
 #include "core/midirecorder.h"
+#include "core/trace.h"
 #include "export/midiexport.h"
 #include "interface/mididevice.h"
+#include "score/playablelength.h"
 #include "score/resource.h"
 
+#include <algorithm>
+
+namespace {
+
+const int recordingTempo = 120; // quarters per minute, written to the recorded file
+
+}
+
 /*!
 	\class CAMidiRecorder
 	\brief Class for live recording of the Midi events
@@ -21,18 +37,26 @@
 	2) Create this class and pass this resource
 	2) Call record(). Class will run in a separated thread and start recording
 	   all the midi events into the given resource file.
-	3) Call stop() when recording is done. Class will write the midi data and
-	   close the stream.
+	3) Call stop() when recording is done. Class will quantize the played notes
+	   by CAMidiQuantizer with the grid from the settings, write the midi data
+	   and close the stream.
  */
 CAMidiRecorder::CAMidiRecorder(std::shared_ptr<CAResource> r, CAMidiDevice* d)
     : QObject()
     , _resource(r)
     , _midiExport(nullptr)
-    , _curTime(0)
+    , _startTime(0)
+    , _pauseTime(0)
 {
     _paused = false;
+#ifndef SWIGCPP
+    if (CACanorus::settings()) {
+        _quantizer.setGrid(CACanorus::settings()->midiQuantizeGrid());
+        _quantizer.setTriplets(CACanorus::settings()->midiQuantizeTriplets());
+    }
+#endif
 
-    connect(d, SIGNAL(midiInEvent(QVector<unsigned char>)), this, SLOT(onMidiInEvent(QVector<unsigned char>)));
+    connect(d, SIGNAL(timedMidiInEvent(QVector<unsigned char>, qint64)), this, SLOT(onMidiInEvent(QVector<unsigned char>, qint64)));
 }
 
 CAMidiRecorder::~CAMidiRecorder()
@@ -40,51 +64,155 @@ CAMidiRecorder::~CAMidiRecorder()
     disconnect();
 }
 
-void CAMidiRecorder::timerTimeout()
-{
-    if (!_paused) {
-        _curTime += 10;
-    }
-}
-
 void CAMidiRecorder::startRecording(int)
 {
     if (!_paused) {
         _midiExport = new CAMidiExport();
         _midiExport->setStreamToFile(_resource->url().toLocalFile());
 
-        _curTime = 0;
+        _startTime = CATrace::now();
+        _messages.clear();
 
-        _timer = new QTimer();
-        _timer->setInterval(10);
-        connect(_timer, SIGNAL(timeout()), this, SLOT(timerTimeout()));
-        _timer->start();
         // the default time signature is a 4 quarters measure
         _midiExport->sendMetaEvent(0, CAMidiDevice::Meta_Timesig, 4, 4, 0);
-        _midiExport->sendMetaEvent(0, CAMidiDevice::Meta_Tempo, 120, 0, 0);
+        _midiExport->sendMetaEvent(0, CAMidiDevice::Meta_Tempo, recordingTempo, 0, 0);
     } else {
+        _startTime += CATrace::now() - _pauseTime;
         _paused = false;
     }
 }
 
 void CAMidiRecorder::stopRecording()
 {
+    writeQuantized();
     _midiExport->writeFile();
 
     delete _midiExport;
     _midiExport = nullptr;
-    _timer->stop();
-    _timer->disconnect();
+    _paused = false;
 }
 
 void CAMidiRecorder::pauseRecording()
 {
-    _paused = true;
+    if (!_paused) {
+        _pauseTime = CATrace::now();
+        _paused = true;
+    }
 }
 
-void CAMidiRecorder::onMidiInEvent(QVector<unsigned char> messages)
+/*!
+	Returns the recorded time in milliseconds.
+*/
+unsigned int CAMidiRecorder::curTime() const
+{
+    if (!_midiExport) {
+        return 0;
+    }
+
+    return static_cast<unsigned int>(((_paused ? _pauseTime : CATrace::now()) - _startTime) / 1000000);
+}
+
+/*!
+	Returns the recorded time in the Canorus time of the recorded file, as passed to
+	messageRecorded().
+*/
+int CAMidiRecorder::recordedTime() const
+{
+    if (!_midiExport) {
+        return 0;
+    }
+
+    return timeToMidiTime(_paused ? _pauseTime : CATrace::now());
+}
+
+/*!
+	Converts the device \a time (see CAMidiDevice::timedMidiInEvent()) to the Canorus time of the
+	recorded file.
+*/
+int CAMidiRecorder::timeToMidiTime(qint64 time) const
+{
+    qint64 elapsed = qMax(time - _startTime, static_cast<qint64>(0));
+    qint64 quarter = CAPlayableLength::playableLengthToTimeLength(CAPlayableLength::Quarter);
+    return static_cast<int>(elapsed * quarter * recordingTempo / (60 * static_cast<qint64>(1000000000)));
+}
+
+/*!
+	Pairs the recorded note ons and offs to notes, quantizes them and writes all the recorded
+	messages at the quantized times. The note offs are written before the note ons at the same
+	time, so the shortened legato notes don't cut the following ones. The notes still sounding
+	when the recording stopped are left without a note off as they were played.
+*/
+void CAMidiRecorder::writeQuantized()
+{
+    QVector<CAMidiQuantizerNote> notes;
+    QVector<int> noteOffs; // message index of the note off per note, -1 if still sounding
+    QVector<int> messageNotes(_messages.size(), -1); // note index of the note on and off messages
+    QHash<int, QVector<int>> openNotes; // indices of the sounding notes by channel and pitch
+    int endTime = 0;
+    for (int i = 0; i < _messages.size(); i++) {
+        const QVector<unsigned char>& m = _messages[i].message;
+        endTime = qMax(endTime, _messages[i].time);
+        if (m.size() < 3 || ((m[0] & 0xf0) != 0x80 && (m[0] & 0xf0) != 0x90)) {
+            continue;
+        }
+
+        QVector<int>& open = openNotes[(m[0] & 0x0f) * 128 + (m[1] & 0x7f)];
+        if ((m[0] & 0xf0) == 0x90 && m[2]) {
+            open << notes.size();
+            messageNotes[i] = notes.size();
+            CAMidiQuantizerNote note = { _messages[i].time, 0, m[0] & 0x0f, m[1] & 0x7f };
+            notes << note;
+            noteOffs << -1;
+        } else if (!open.isEmpty()) {
+            int n = open.takeLast();
+            notes[n].length = _messages[i].time - notes[n].time;
+            noteOffs[n] = i;
+            messageNotes[i] = n;
+        }
+    }
+    for (int n = 0; n < notes.size(); n++) {
+        if (noteOffs[n] == -1) {
+            notes[n].length = endTime - notes[n].time;
+        }
+    }
+
+    _quantizer.quantize(notes);
+
+    QVector<int> times(_messages.size());
+    QVector<int> order(_messages.size());
+    for (int i = 0; i < _messages.size(); i++) {
+        int n = messageNotes[i];
+        if (n == -1) {
+            times[i] = _quantizer.quantizeTime(_messages[i].time);
+        } else {
+            times[i] = (noteOffs[n] == i) ? notes[n].time + notes[n].length : notes[n].time;
+        }
+        order[i] = i;
+    }
+
+    auto rank = [&noteOffs, &messageNotes](int i) { return (messageNotes[i] == -1) ? 1 : (noteOffs[messageNotes[i]] == i) ? 0 : 2; };
+    std::stable_sort(order.begin(), order.end(), [&times, &rank](int a, int b) {
+        return times[a] < times[b] || (times[a] == times[b] && rank(a) < rank(b));
+    });
+
+    for (int i : order) {
+        _midiExport->send(_messages[i].message, times[i]);
+    }
+    _messages.clear();
+}
+
+/*!
+	Stores the received message for the recording. The message is timestamped with the \a time it
+	arrived to the device and not when it is delivered to the main thread, so the recording is not
+	delayed by a busy GUI.
+
+	The message is passed on unquantized by messageRecorded(), so it can be shown while recording.
+*/
+void CAMidiRecorder::onMidiInEvent(QVector<unsigned char> messages, qint64 time)
 {
-    if (_midiExport && !_paused) {
-        _midiExport->send(messages, _curTime / 2); // needs division somewhere else ...
+    if (_midiExport && !_paused && time >= _startTime) {
+        CARecordedMessage message = { messages, timeToMidiTime(time) };
+        _messages << message;
+        emit messageRecorded(messages, message.time);
     }
 }
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2008, Matevž Jekovec, Canorus development team
+	Copyright (c) 2008-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -8,11 +8,13 @@
 #ifndef MIDIRECORDER_H_
 #define MIDIRECORDER_H_
 
-#include <QTimer>
+#include <QObject>
 #include <QVector>
 
 #include <memory>
 
+#include "core/midiquantizer.h"
+
 class CAMidiExport;
 class CAResource;
 class CAMidiDevice;
@@ -29,19 +31,32 @@ public:
     void pauseRecording();
     void stopRecording();
 
-    const unsigned int& curTime() const { return _curTime; }
+    unsigned int curTime() const;
+    int recordedTime() const;
 
 #ifndef SWIG
+signals:
+    void messageRecorded(QVector<unsigned char> message, int time);
+
 private slots:
-    void timerTimeout();
-    void onMidiInEvent(QVector<unsigned char> messages);
+    void onMidiInEvent(QVector<unsigned char> messages, qint64 time);
 #endif
 
 private:
+    struct CARecordedMessage {
+        QVector<unsigned char> message;
+        int time; // in Canorus time
+    };
+
+    int timeToMidiTime(qint64 time) const;
+    void writeQuantized();
+
     std::shared_ptr<CAResource> _resource;
     CAMidiExport* _midiExport;
-    QTimer* _timer;
-    unsigned int _curTime;
+    qint64 _startTime; // when the recording was started, moved forward by the time spent paused
+    qint64 _pauseTime; // when the recording was paused
+    QVector<CARecordedMessage> _messages; // received messages, written quantized when the recording stops
+    CAMidiQuantizer _quantizer;
 
     bool _paused;
 };
@@ -5,14 +5,24 @@
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
 */
 
+#include <QTextStream>
+
 #include "core/mimedata.h"
+#include "export/canorusmlexport.h"
+#include "import/canorusmlimport.h"
 #include "score/context.h"
+#include "score/document.h"
+#include "score/sheet.h"
 
 /*!
 	Subclass of QMimeData which incorporates list of Music elements for
 	copy/paste functionality.
 
 	MIME types for Canorus contexts are "application/canorus-contexts".
+
+	Pasting inside the application uses the contexts directly. Other applications (eg. another
+	Canorus instance) get the contexts as a CanorusML document, which is only generated when they ask
+	for it. Use contextsFromCanorusML() to read it back.
 */
 
 const QString CAMimeData::CANORUS_MIME_TYPE = "application/canorus-contexts";
@@ -46,3 +56,62 @@ bool CAMimeData::hasFormat(const QString format) const
 {
     return formats().contains(format);
 }
+
+/*!
+	Returns the contexts serialized as a CanorusML document for the other applications.
+*/
+QVariant CAMimeData::retrieveData(const QString& mimeType, QVariant::Type type) const
+{
+    if (mimeType != CANORUS_MIME_TYPE || !hasContexts()) {
+        return QMimeData::retrieveData(mimeType, type);
+    }
+
+    if (_canorusML.isEmpty()) {
+        _canorusML = toCanorusML();
+    }
+    return _canorusML;
+}
+
+/*!
+	Writes the contexts into a single sheet of a temporary document using CanorusML.
+*/
+QByteArray CAMimeData::toCanorusML() const
+{
+    CADocument doc;
+    CASheet* sheet = doc.addSheet();
+    for (int i = 0; i < _contexts.size(); i++) {
+        sheet->addContext(_contexts[i]);
+    }
+
+    QString out;
+    QTextStream stream(&out);
+    CACanorusMLExport exporter(&stream);
+    exporter.exportDocument(&doc, false);
+    stream.flush();
+
+    // the contexts are owned by the mime data
+    for (int i = 0; i < _contexts.size(); i++) {
+        sheet->removeContext(_contexts[i]);
+    }
+
+    return out.toUtf8();
+}
+
+/*!
+	Reads the contexts from the CanorusML \a data provided by another application.
+	The contexts belong to the document returned in \a doc, which should be deleted by the caller
+	after pasting. Returns an empty list, if the data couldn't be read.
+*/
+QList<CAContext*> CAMimeData::contextsFromCanorusML(const QByteArray& data, CADocument** doc)
+{
+    CACanorusMLImport importer(QString::fromUtf8(data));
+    importer.importDocument();
+    importer.wait();
+
+    *doc = importer.importedDocument();
+    if (!*doc || (*doc)->sheetList().isEmpty()) {
+        return QList<CAContext*>();
+    }
+
+    return (*doc)->sheetList().first()->contextList();
+}
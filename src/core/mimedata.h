@@ -8,11 +8,13 @@
 #ifndef MIMETYPE_H_
 #define MIMETYPE_H_
 
+#include <QByteArray>
 #include <QList>
 #include <QMimeData>
 #include <QStringList>
 
 class CAContext;
+class CADocument;
 
 class CAMimeData : public QMimeData {
 public:
@@ -24,14 +26,25 @@ public:
     bool hasFormat(const QString) const;
     QStringList formats() const;
 
-    inline void setContexts(QList<CAContext*> list) { _contexts = list; }
+    inline void setContexts(QList<CAContext*> list)
+    {
+        _contexts = list;
+        _canorusML.clear();
+    }
     inline const QList<CAContext*>& contexts() const { return _contexts; }
     inline bool hasContexts() const { return _contexts.size(); }
 
     static const QString CANORUS_MIME_TYPE;
+    static QList<CAContext*> contextsFromCanorusML(const QByteArray& data, CADocument** doc);
+
+protected:
+    QVariant retrieveData(const QString& mimeType, QVariant::Type type) const;
 
 private:
+    QByteArray toCanorusML() const;
+
     QList<CAContext*> _contexts;
+    mutable QByteArray _canorusML; // serialized contexts, generated when another application asks for them
 };
 
 #endif /* MIMEDATA_H_ */
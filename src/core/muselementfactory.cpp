@@ -262,24 +262,7 @@ bool CAMusElementFactory::configureNote(int pitch,
 
         if (voice->lastNote() == mpoMusElement) {
             // note was appended, reposition elements in dependent contexts accordingly
-            for (CALyricsContext* lc : voice->lyricsContextList()) {
-                lc->repositSyllables();
-            }
-            for (CAContext* context : voice->staff()->sheet()->contextList()) {
-                switch (context->contextType()) {
-                case CAContext::FunctionMarkContext:
-                    static_cast<CAFunctionMarkContext*>(context)->repositFunctions();
-                    break;
-                case CAContext::FiguredBassContext:
-                    static_cast<CAFiguredBassContext*>(context)->repositFiguredBassMarks();
-                    break;
-                case CAContext::ChordNameContext:
-                    static_cast<CAChordNameContext*>(context)->repositChordNames();
-                    break;
-                default:
-                    break;
-                }
-            }
+            voice->staff()->sheet()->repositContexts(mpoMusElement->timeStart());
         } else {
             // note was inserted somewhere inbetween, insert empty element in dependent contexts accordingly
             for (CALyricsContext* lc : voice->lyricsContextList()) {
@@ -482,18 +465,7 @@ bool CAMusElementFactory::configureRest(CAVoice* voice, CAMusElement* right)
         if (!success)
             removeMusElem(true);
         else {
-            for (CALyricsContext* lc : voice->lyricsContextList()) {
-                lc->repositSyllables();
-            }
-            for (CAContext* context : voice->staff()->sheet()->contextList()) {
-                switch (context->contextType()) {
-                case CAContext::ChordNameContext:
-                    static_cast<CAChordNameContext*>(context)->repositChordNames();
-                    break;
-                default:
-                    break;
-                }
-            }
+            voice->staff()->sheet()->repositContexts(mpoMusElement->timeStart());
         }
     }
     return success;
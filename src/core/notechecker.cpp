@@ -1,23 +1,74 @@
 /*! 
-	Copyright (c) 2015-2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2015-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 	
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
 */
 
 #include <QObject>
+#include <QSet>
 
 #include "core/notechecker.h"
+#include "core/notecheckerrule.h"
+#include "core/taskscheduler.h"
 #include "score/notecheckererror.h"
 
-#include "score/chordnamecontext.h"
+#include "score/muselement.h"
 #include "score/sheet.h"
 #include "score/staff.h"
 
-#include "score/barline.h"
-#include "score/chordname.h"
-#include "score/playablelength.h"
-#include "score/timesignature.h"
+namespace {
+
+/*!
+	Marks the error of the element \a elt with the given \a message as valid and creates it, if the
+	element doesn't have it yet. Returns True, if a new error was created.
+*/
+bool requireError(CASheet* sheet, CAMusElement* elt, const QString& message, QSet<CANoteCheckerError*>& valid)
+{
+    const QList<CANoteCheckerError*>& errors = elt->noteCheckerErrorList();
+    for (int i = 0; i < errors.size(); i++) {
+        if (errors[i]->message() == message) {
+            valid << errors[i];
+            return false;
+        }
+    }
+
+    CANoteCheckerError* nce = new CANoteCheckerError(elt, message);
+    sheet->addNoteCheckerError(nce);
+    valid << nce;
+    return true;
+}
+
+/*!
+	Returns True, if the \a context is a frozen staff, which doesn't change.
+*/
+bool isFrozen(CAContext* context)
+{
+    return context && context->contextType() == CAContext::Staff && static_cast<CAStaff*>(context)->isFrozen();
+}
+
+/*!
+	A single rule checking a single context in the task scheduler.
+*/
+class CANoteCheckerTask : public CATask {
+public:
+    CANoteCheckerTask(CANoteCheckerRule* rule, CAContext* context)
+        : CATask(CATask::Interactive) // the errors are shown right after the edit
+        , _rule(rule)
+        , _context(context)
+    {
+    }
+
+    void run() { _rule->check(_context, _findings); }
+    inline const QList<CANoteCheckerFinding>& findings() const { return _findings; }
+
+private:
+    CANoteCheckerRule* _rule;
+    CAContext* _context;
+    QList<CANoteCheckerFinding> _findings;
+};
+
+}
 
 /*!
 	\class CANoteChecker
@@ -26,76 +77,90 @@
 	This class is spell checker that provides tools for checking potential
 	"typing" errors made by the user such as too little notes not filling the bar
 	and similar.
+
+	The checks are rules (see CANoteCheckerRule) registered by addRule(). The bar duration and chord
+	name syntax rules are registered by default.
+
+	Checking is incremental: the errors which are still valid are kept, only the new errors are
+	created and the fixed ones are removed. When the check didn't change the errors, there is no need
+	to lay out the sheet again and CAScoreView::updateNoteCheckerErrors() refreshes the drawable
+	errors otherwise.
 */
 
 CANoteChecker::CANoteChecker()
 {
+    addRule(new CABarDurationRule());
+    addRule(new CAChordNameSyntaxRule());
 }
 
 CANoteChecker::~CANoteChecker()
 {
+    qDeleteAll(_ruleList);
 }
 
 /*!
-	Parse/decompress an existing archive
+	Registers the given \a rule. The note checker takes the ownership of the rule.
 */
-void CANoteChecker::checkSheet(CASheet* sheet)
+void CANoteChecker::addRule(CANoteCheckerRule* rule)
 {
-    sheet->clearNoteCheckerErrors();
+    _ruleList << rule;
+}
+
+/*!
+	Checks the given \a sheet with all the rules and updates its note checker errors.
+	Returns True, if any errors were added or removed.
+
+	Frozen staffs (see CAStaff::setFrozen()) are not checked again, their errors are kept.
 
-    // check for incomplete bars
-    QList<CAContext*> contexts = sheet->contextList();
+	Each rule checks each context of the types it reads in a separate task. The tasks run
+	concurrently in the task scheduler, while the sheet isn't changed, and their findings are merged into
+	the sheet errors in the context and rule order afterwards.
+*/
+bool CANoteChecker::checkSheet(CASheet* sheet)
+{
+    QList<CANoteCheckerTask*> tasks;
+    const QList<CAContext*>& contexts = sheet->contextList();
     for (int i = 0; i < contexts.size(); i++) {
-        switch (contexts[i]->contextType()) {
-        case CAContext::Staff: {
-            CAStaff* staff = static_cast<CAStaff*>(contexts[i]);
-            QList<CAMusElement*> timeSigs = staff->timeSignatureRefs();
-            QList<CAMusElement*> barlines = staff->barlineRefs();
-
-            if (!timeSigs.size()) {
-                continue;
+        if (isFrozen(contexts[i])) {
+            continue; // the errors of the last check are kept
+        }
+        for (int j = 0; j < _ruleList.size(); j++) {
+            if (_ruleList[j]->contextTypes().contains(contexts[i]->contextType())) {
+                tasks << new CANoteCheckerTask(_ruleList[j], contexts[i]);
             }
+        }
+    }
 
-            int lastTimeSigIdx = 0;
-            int lastTimeSigRequiredDuration = static_cast<CATimeSignature*>(timeSigs[lastTimeSigIdx])->barDuration();
-            int lastBarlineTime = -1;
-            for (int j = 0; j < barlines.size(); j++) {
-                if (static_cast<CABarline*>(barlines[j])->barlineType() == CABarline::Dotted) {
-                    continue;
-                }
-
-                if (((lastTimeSigIdx + 1) < timeSigs.size()) && barlines[j]->timeStart() > timeSigs[lastTimeSigIdx]->timeStart()) {
-                    // go to next time sig
-                    lastTimeSigIdx++;
-                    lastTimeSigRequiredDuration = static_cast<CATimeSignature*>(timeSigs[lastTimeSigIdx])->barDuration();
-                }
-
-                // check the bar duration.
-                // If first bar is partial, the length should be shorter or equal to time sig.
-                if ((lastBarlineTime == -1 && barlines[j]->timeStart() > lastTimeSigRequiredDuration) || (lastBarlineTime != -1 && barlines[j]->timeStart() != lastBarlineTime + lastTimeSigRequiredDuration)) {
-                    CANoteCheckerError* nce = new CANoteCheckerError(barlines[j], QObject::tr("Bar duration incorrect."));
-                    sheet->addNoteCheckerError(nce);
-                }
-
-                lastBarlineTime = barlines[j]->timeStart();
-            }
-            break;
+    if (tasks.size() > 1) {
+        for (int i = 0; i < tasks.size(); i++) {
+            CATaskScheduler::instance()->start(tasks[i]);
         }
-        case CAContext::ChordNameContext: {
-            CAChordNameContext* cnc = static_cast<CAChordNameContext*>(contexts[i]);
-            for (int j = 0; j < cnc->chordNameList().size(); j++) {
-                CAChordName* cn = cnc->chordNameList()[j];
-                if (cn->diatonicPitch().noteName() == CADiatonicPitch::Undefined && !cn->qualityModifier().isEmpty()) {
-                    CANoteCheckerError* nce = new CANoteCheckerError(cn, QObject::tr("Invalid chord name syntax. Please use chord pitch and optionally ':' and quality modifier. e.g. cis:m"));
-                    sheet->addNoteCheckerError(nce);
-                }
-            }
-            break;
+        for (int i = 0; i < tasks.size(); i++) {
+            tasks[i]->wait();
+        }
+    } else if (tasks.size()) {
+        tasks[0]->run();
+    }
+
+    QSet<CANoteCheckerError*> valid;
+    bool changed = false;
+    for (int i = 0; i < tasks.size(); i++) {
+        const QList<CANoteCheckerFinding>& findings = tasks[i]->findings();
+        for (int j = 0; j < findings.size(); j++) {
+            changed |= requireError(sheet, findings[j].element, findings[j].message, valid);
         }
-        case CAContext::LyricsContext:
-        case CAContext::FunctionMarkContext:
-        case CAContext::FiguredBassContext:
-            break;
+    }
+    qDeleteAll(tasks);
+
+    // remove the fixed errors
+    QList<CANoteCheckerError*> errors = sheet->noteCheckerErrorList();
+    for (int i = 0; i < errors.size(); i++) {
+        if (!valid.contains(errors[i]) && !isFrozen(errors[i]->targetElement()->context())) {
+            sheet->noteCheckerErrorList().removeAll(errors[i]); // in case the target is not in the sheet anymore
+            delete errors[i];
+            changed = true;
         }
     }
+
+    return changed;
 }
@@ -8,14 +8,23 @@
 #ifndef NOTECHECKER_H_
 #define NOTECHECKER_H_
 
+#include <QList>
+
 class CASheet;
+class CANoteCheckerRule;
 
 class CANoteChecker {
 public:
     CANoteChecker();
     virtual ~CANoteChecker();
 
-    void checkSheet(CASheet*);
+    void addRule(CANoteCheckerRule* rule);
+    inline const QList<CANoteCheckerRule*>& ruleList() { return _ruleList; }
+
+    bool checkSheet(CASheet*);
+
+private:
+    QList<CANoteCheckerRule*> _ruleList; // owned
 };
 
 #endif /* NOTECHECKER_H_ */
@@ -0,0 +1,89 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#include <QObject>
+
+#include "core/notecheckerrule.h"
+
+#include "score/chordnamecontext.h"
+#include "score/staff.h"
+
+#include "score/barline.h"
+#include "score/chordname.h"
+#include "score/timesignature.h"
+
+/*!
+	\class CANoteCheckerRule
+	\brief A single check of the note checker
+
+	Each rule declares the context types it reads in contextTypes(). CANoteChecker calls check() for
+	every context of those types in the sheet, possibly for several contexts and rules at once on the
+	thread pool. check() must therefore only read the score and report the problems by appending
+	findings. The findings are turned into CANoteCheckerErrors after all the rules finish.
+
+	\sa CANoteChecker::addRule()
+*/
+
+CANoteCheckerRule::~CANoteCheckerRule()
+{
+}
+
+/*!
+	\class CABarDurationRule
+	\brief Checks the bars are as long as their time signature says
+
+	The first bar may be shorter (a partial bar), the others must match the duration of the time
+	signature in effect. Dotted barlines don't end a bar.
+*/
+void CABarDurationRule::check(CAContext* context, QList<CANoteCheckerFinding>& findings)
+{
+    CAStaff* staff = static_cast<CAStaff*>(context);
+    QList<CAMusElement*> timeSigs = staff->timeSignatureRefs();
+    QList<CAMusElement*> barlines = staff->barlineRefs();
+
+    if (!timeSigs.size()) {
+        return;
+    }
+
+    int lastTimeSigIdx = 0;
+    int lastTimeSigRequiredDuration = static_cast<CATimeSignature*>(timeSigs[lastTimeSigIdx])->barDuration();
+    int lastBarlineTime = -1;
+    for (int j = 0; j < barlines.size(); j++) {
+        if (static_cast<CABarline*>(barlines[j])->barlineType() == CABarline::Dotted) {
+            continue;
+        }
+
+        if (((lastTimeSigIdx + 1) < timeSigs.size()) && barlines[j]->timeStart() > timeSigs[lastTimeSigIdx]->timeStart()) {
+            // go to next time sig
+            lastTimeSigIdx++;
+            lastTimeSigRequiredDuration = static_cast<CATimeSignature*>(timeSigs[lastTimeSigIdx])->barDuration();
+        }
+
+        // check the bar duration.
+        // If first bar is partial, the length should be shorter or equal to time sig.
+        if ((lastBarlineTime == -1 && barlines[j]->timeStart() > lastTimeSigRequiredDuration) || (lastBarlineTime != -1 && barlines[j]->timeStart() != lastBarlineTime + lastTimeSigRequiredDuration)) {
+            findings << CANoteCheckerFinding{ barlines[j], QObject::tr("Bar duration incorrect.") };
+        }
+
+        lastBarlineTime = barlines[j]->timeStart();
+    }
+}
+
+/*!
+	\class CAChordNameSyntaxRule
+	\brief Checks the chord names have a valid pitch, if they have a quality modifier
+*/
+void CAChordNameSyntaxRule::check(CAContext* context, QList<CANoteCheckerFinding>& findings)
+{
+    CAChordNameContext* cnc = static_cast<CAChordNameContext*>(context);
+    for (int j = 0; j < cnc->chordNameList().size(); j++) {
+        CAChordName* cn = cnc->chordNameList()[j];
+        if (cn->diatonicPitch().noteName() == CADiatonicPitch::Undefined && !cn->qualityModifier().isEmpty()) {
+            findings << CANoteCheckerFinding{ cn, QObject::tr("Invalid chord name syntax. Please use chord pitch and optionally ':' and quality modifier. e.g. cis:m") };
+        }
+    }
+}
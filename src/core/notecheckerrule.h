@@ -0,0 +1,46 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#ifndef NOTECHECKERRULE_H_
+#define NOTECHECKERRULE_H_
+
+#include <QList>
+#include <QString>
+
+#include "score/context.h"
+
+class CAMusElement;
+
+struct CANoteCheckerFinding {
+    CAMusElement* element;
+    QString message;
+};
+
+class CANoteCheckerRule {
+public:
+    virtual ~CANoteCheckerRule();
+
+    virtual QString name() const = 0;
+    virtual QList<CAContext::CAContextType> contextTypes() const = 0;
+    virtual void check(CAContext* context, QList<CANoteCheckerFinding>& findings) = 0;
+};
+
+class CABarDurationRule : public CANoteCheckerRule {
+public:
+    QString name() const { return "bar-duration"; }
+    QList<CAContext::CAContextType> contextTypes() const { return QList<CAContext::CAContextType>() << CAContext::Staff; }
+    void check(CAContext* context, QList<CANoteCheckerFinding>& findings);
+};
+
+class CAChordNameSyntaxRule : public CANoteCheckerRule {
+public:
+    QString name() const { return "chord-name-syntax"; }
+    QList<CAContext::CAContextType> contextTypes() const { return QList<CAContext::CAContextType>() << CAContext::ChordNameContext; }
+    void check(CAContext* context, QList<CANoteCheckerFinding>& findings);
+};
+
+#endif /* NOTECHECKERRULE_H_ */
@@ -0,0 +1,109 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QMutexLocker>
+
+#include <new>
+
+#include "core/objectpool.h"
+
+const std::size_t CAObjectPool::GRANULARITY = 16;
+const std::size_t CAObjectPool::MAX_POOLED_SIZE = 512;
+const std::size_t CAObjectPool::CHUNK_SIZE = 64 * 1024;
+
+/*!
+	\class CAObjectPool
+	\brief Size class allocator for small, frequently created objects
+
+	Music elements and drawable elements are created and destroyed in large numbers, for example
+	every time the score is laid out again. CAMusElement and CADrawable route their operator new
+	and delete through this pool. Objects are rounded up to GRANULARITY bytes and served from
+	per size free lists, which are refilled from CHUNK_SIZE large chunks. Released blocks are
+	reused by the next allocation of the same size instead of going back to the system allocator.
+
+	Objects larger than MAX_POOLED_SIZE are allocated by the global operator new.
+
+	The pool is shared by all threads and guarded by a mutex, because music elements are also
+	created by the import filters running in their own threads.
+*/
+
+CAObjectPool::CAObjectPool()
+    : _freeLists(static_cast<int>(MAX_POOLED_SIZE / GRANULARITY), nullptr)
+    , _chunkPos(nullptr)
+    , _chunkLeft(0)
+{
+}
+
+/*!
+	Returns the pool instance. The pool is intentionally never destroyed, because static
+	objects holding pooled elements may be destroyed after it.
+*/
+CAObjectPool* CAObjectPool::instance()
+{
+    /// \todo replace raw pointer with shared or unique pointer
+    static CAObjectPool* pool = new CAObjectPool();
+    return pool;
+}
+
+/*!
+	Returns a block of at least \a size bytes.
+
+	\sa release()
+*/
+void* CAObjectPool::allocate(std::size_t size)
+{
+    if (!size || size > MAX_POOLED_SIZE) {
+        return ::operator new(size);
+    }
+
+    CAObjectPool* pool = instance();
+    int sizeClass = static_cast<int>((size - 1) / GRANULARITY);
+    std::size_t blockSize = (sizeClass + 1) * GRANULARITY;
+
+    QMutexLocker locker(&pool->_mutex);
+    CAFreeBlock* block = pool->_freeLists[sizeClass];
+    if (block) {
+        pool->_freeLists[sizeClass] = block->next;
+        return block;
+    }
+
+    if (pool->_chunkLeft < blockSize) {
+        // the rest of the current chunk is too small, carve the blocks from a new one
+        pool->_chunkPos = static_cast<char*>(::operator new(CHUNK_SIZE));
+        pool->_chunkLeft = CHUNK_SIZE;
+        pool->_chunks << pool->_chunkPos;
+    }
+
+    void* p = pool->_chunkPos;
+    pool->_chunkPos += blockSize;
+    pool->_chunkLeft -= blockSize;
+
+    return p;
+}
+
+/*!
+	Gives the block \a p allocated by allocate() with the same \a size back to the pool.
+*/
+void CAObjectPool::release(void* p, std::size_t size)
+{
+    if (!p) {
+        return;
+    }
+
+    if (!size || size > MAX_POOLED_SIZE) {
+        ::operator delete(p);
+        return;
+    }
+
+    CAObjectPool* pool = instance();
+    int sizeClass = static_cast<int>((size - 1) / GRANULARITY);
+
+    QMutexLocker locker(&pool->_mutex);
+    CAFreeBlock* block = static_cast<CAFreeBlock*>(p);
+    block->next = pool->_freeLists[sizeClass];
+    pool->_freeLists[sizeClass] = block;
+}
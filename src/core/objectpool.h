@@ -0,0 +1,41 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef OBJECTPOOL_H_
+#define OBJECTPOOL_H_
+
+#include <QList>
+#include <QMutex>
+#include <QVector>
+
+#include <cstddef>
+
+class CAObjectPool {
+public:
+    static void* allocate(std::size_t size);
+    static void release(void* p, std::size_t size);
+
+private:
+    struct CAFreeBlock {
+        CAFreeBlock* next;
+    };
+
+    CAObjectPool();
+    static CAObjectPool* instance();
+
+    static const std::size_t GRANULARITY;
+    static const std::size_t MAX_POOLED_SIZE;
+    static const std::size_t CHUNK_SIZE;
+
+    QMutex _mutex;
+    QVector<CAFreeBlock*> _freeLists; // released blocks for each size class
+    QList<char*> _chunks; // memory the blocks are carved from, never returned to the system
+    char* _chunkPos; // first unused byte in the last chunk
+    std::size_t _chunkLeft; // number of unused bytes in the last chunk
+};
+
+#endif /* OBJECTPOOL_H_ */
@@ -0,0 +1,97 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include "core/progress.h"
+#include "core/trace.h"
+
+/*!
+	\class CAProgress
+	\brief Progress and cancellation token of a long-running operation
+
+	The token is shared between the thread doing the work and the user interface. The worker
+	reports the progress by setProgress() and checks isCanceled() at coarse points (eg. after each
+	sheet, part or bar), returning early when set. The user interface polls progress() and calls
+	cancel() when the user aborts the operation. Both sides may run in different threads.
+
+	The same token can be passed on to the nested operations, so canceling the outer operation
+	also stops the inner one:
+	\code
+	  CAProgress progress;
+	  CATranspose t(sheet);
+	  t.setProgress(&progress);
+	  t.transposeBySemitones(2); // returns without changes, if progress.cancel() was called
+	\endcode
+
+	CAFile provides a token for each import and export, see CAFile::progressToken().
+
+	Besides the percentage, the worker can report the amount of the work done in bytes or
+	elements by setProgress(qint64, qint64, CAProgressUnit). The token then estimates the
+	throughput since start(). Reporting only stores a few atomics, so it can be called for each
+	element. The readers poll the values at their own rate, eg. CAMainWinProgressCtl a few times
+	per second, so the frequency of the updates doesn't depend on the worker.
+*/
+
+CAProgress::CAProgress()
+    : _progress(0)
+    , _canceled(false)
+    , _done(0)
+    , _total(0)
+    , _unit(Elements)
+    , _startTime(CATrace::now())
+{
+}
+
+/*!
+	Sets the progress to the \a done part of the \a total amount of work, both measured in
+	the given \a unit.
+*/
+void CAProgress::setProgress(qint64 done, qint64 total, CAProgressUnit unit)
+{
+    _done.store(done, std::memory_order_relaxed);
+    _total.store(total, std::memory_order_relaxed);
+    _unit.store(unit, std::memory_order_relaxed);
+    setProgress(total > 0 ? static_cast<int>(qBound(static_cast<qint64>(0), done * 100 / total, static_cast<qint64>(100))) : 0);
+}
+
+/*!
+	Returns the time in miliseconds since start().
+*/
+qint64 CAProgress::elapsed()
+{
+    return (CATrace::now() - _startTime.load(std::memory_order_relaxed)) / 1000000;
+}
+
+/*!
+	Returns the estimated throughput in unit() per second since start(), or 0, if nothing was
+	reported yet.
+*/
+double CAProgress::throughput()
+{
+    qint64 nsecs = CATrace::now() - _startTime.load(std::memory_order_relaxed);
+    return (nsecs > 0 ? done() * 1e9 / nsecs : 0.0);
+}
+
+/*!
+	Sets the progress to 0 and restarts the throughput estimate. Unlike reset(), the cancel
+	request is kept, so an operation canceled before it started doesn't run.
+*/
+void CAProgress::start()
+{
+    _progress.store(0, std::memory_order_relaxed);
+    _done.store(0, std::memory_order_relaxed);
+    _total.store(0, std::memory_order_relaxed);
+    _startTime.store(CATrace::now(), std::memory_order_relaxed);
+}
+
+/*!
+	Sets the progress to 0 and clears the cancel request, so the token can be reused.
+*/
+void CAProgress::reset()
+{
+    start();
+    _canceled.store(false, std::memory_order_relaxed);
+}
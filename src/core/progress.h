@@ -0,0 +1,53 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef PROGRESS_H_
+#define PROGRESS_H_
+
+#include <QtGlobal>
+
+#include <atomic>
+
+class CAProgress {
+public:
+    enum CAProgressUnit {
+        Elements, // music elements, voices, staffs or sheets
+        Bytes
+    };
+
+    CAProgress();
+
+    inline int progress() { return _progress.load(std::memory_order_relaxed); }
+    inline void setProgress(int percent) { _progress.store(qBound(0, percent, 100), std::memory_order_relaxed); }
+    void setProgress(qint64 done, qint64 total, CAProgressUnit unit = Elements);
+
+    inline qint64 done() { return _done.load(std::memory_order_relaxed); }
+    inline qint64 total() { return _total.load(std::memory_order_relaxed); }
+    inline CAProgressUnit unit() { return static_cast<CAProgressUnit>(_unit.load(std::memory_order_relaxed)); }
+    qint64 elapsed();
+    double throughput();
+    void start();
+
+    inline void cancel() { _canceled.store(true, std::memory_order_relaxed); }
+    inline bool isCanceled() { return _canceled.load(std::memory_order_relaxed); }
+    void reset();
+
+#ifndef SWIG
+private:
+    CAProgress(const CAProgress&);
+    CAProgress& operator=(const CAProgress&);
+
+    std::atomic<int> _progress; // percentage of the work already done
+    std::atomic<bool> _canceled;
+    std::atomic<qint64> _done; // amount of the work already done in _unit
+    std::atomic<qint64> _total; // total amount of the work in _unit, 0 if unknown
+    std::atomic<int> _unit; // CAProgressUnit of _done and _total
+    std::atomic<qint64> _startTime; // time of start() in nanoseconds, see CATrace::now()
+#endif
+};
+
+#endif /* PROGRESS_H_ */
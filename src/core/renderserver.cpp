@@ -0,0 +1,590 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QBuffer>
+#include <QFileInfo>
+#include <QHostAddress>
+#include <QImage>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QRunnable>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QUrl>
+#include <QUrlQuery>
+
+#include "core/batchconvert.h"
+#include "core/renderserver.h"
+
+#include "export/lilypondexport.h"
+#include "export/midiexport.h"
+#include "export/vectorexport.h"
+#include "import/import.h"
+#include "layout/sheetrenderer.h"
+
+#include "score/document.h"
+#include "score/sheet.h"
+#include "score/voice.h"
+
+#include <iostream>
+
+const QString CARenderServer::SERVE_SWITCH = "--serve";
+const QString CARenderServer::HTTP_SWITCH = "--serve-http";
+const QString CARenderServer::ROOT_SWITCH = "--root";
+const QString CARenderServer::CACHE_SWITCH = "--cache";
+const int CARenderServer::MAX_REQUEST_SIZE = 8192; // request line and headers in bytes
+const qint64 CARenderServer::MAX_IMAGE_PIXELS = 64 * 1024 * 1024;
+
+namespace {
+
+const QByteArray textType = "text/plain; charset=utf-8";
+
+const char* reasonPhrase(int status)
+{
+    switch (status) {
+    case 200:
+        return "OK";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    case 405:
+        return "Method Not Allowed";
+    case 413:
+        return "Payload Too Large";
+    default:
+        return "Internal Server Error";
+    }
+}
+
+}
+
+/*!
+	\class CARenderJob
+	\brief Exports a sheet of a cached document on the render server thread pool
+*/
+class CARenderJob : public QRunnable {
+public:
+    CARenderJob(CARenderServer* server, int id, std::shared_ptr<CADocument> document, int sheet, const QString& format)
+        : _server(server)
+        , _id(id)
+        , _document(document)
+        , _sheet(sheet)
+        , _format(format)
+    {
+    }
+
+    void run()
+    {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+
+        CAExport* exporter;
+        QByteArray contentType;
+        if (_format == "midi") {
+            exporter = new CAMidiExport();
+            contentType = "audio/midi";
+        } else {
+            exporter = new CALilyPondExport();
+            contentType = "text/x-lilypond; charset=utf-8";
+        }
+
+        exporter->setStreamToDevice(&buffer);
+        exporter->exportSheet(_document->sheetList()[_sheet]);
+        exporter->wait();
+
+        int status = 200;
+        QByteArray body = buffer.data();
+        if (exporter->status() < 0) {
+            status = 500;
+            contentType = textType;
+            body = exporter->readableStatus().toUtf8() + "\n";
+        }
+        delete exporter;
+        _document.reset(); // deleted here, if it was dropped from the cache meanwhile
+
+        QMetaObject::invokeMethod(_server, "finishRequest", Qt::QueuedConnection, Q_ARG(int, _id), Q_ARG(int, status), Q_ARG(QByteArray, contentType), Q_ARG(QByteArray, body));
+    }
+
+private:
+    CARenderServer* _server;
+    int _id;
+    std::shared_ptr<CADocument> _document;
+    int _sheet;
+    QString _format;
+};
+
+/*!
+	\class CARenderServer
+	\brief Long-running headless server rendering the stored documents
+
+	Canorus is run as a render server when the --serve or --serve-http switch is passed in the
+	command line, for example:
+	\code
+	  canorus --serve=/tmp/canorus.sock --root=/srv/scores --cache=32 --jobs=4
+	  canorus --serve-http=8080 --root=/srv/scores
+	\endcode
+
+	The server accepts HTTP GET requests on the local socket, the HTTP port or both. The port is
+	only bound to the loopback interface. Each connection carries a single request:
+	\code
+	  curl --unix-socket /tmp/canorus.sock "http://localhost/render?file=bach.can&sheet=1&format=png&zoom=2"
+	  curl "http://localhost:8080/render?file=bach.can&format=lilypond"
+	  curl "http://localhost:8080/status"
+	\endcode
+
+	The file is relative to the root directory and must be inside it. The sheet is counted from 1
+	and is the first one by default. The supported formats are png (the default), svg and pdf
+	drawn from the layout like CAVectorExport, midi and lilypond (the source, the typesetter is not
+	run). The PNG zoom is 1.0 by default.
+
+	The documents are read once and kept in memory together with their sheet layouts, so the next
+	renders of the same sheet only draw it. A document is read again, if its file was modified.
+	The least recently used documents are dropped, when more than the cache size are open.
+
+	The layout needs a score view, so PNG, SVG and PDF are rendered in the main thread one at a
+	time, the same as in the GUI. MIDI and LilyPond are exported on the thread pool with one
+	worker per core by default, which also keeps the LilyPond export caches warm. The lazily built
+	caches of the sheets and voices are built when the document is read, so the cached documents
+	are only read by the renders and the exports running at the same time.
+
+	\sa CABatchConvert, CASheetRenderer
+*/
+
+CARenderServer::CARenderServer(QObject* parent)
+    : QObject(parent)
+    , _localServer(nullptr)
+    , _tcpServer(nullptr)
+    , _port(0)
+    , _root(QDir::current())
+    , _cacheSize(16)
+    , _nextJobId(0)
+    , _requestCount(0)
+{
+    _pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+CARenderServer::~CARenderServer()
+{
+    _pool.waitForDone();
+    for (CACachedDocument* d : _cache) {
+        qDeleteAll(d->renderers);
+        delete d;
+    }
+}
+
+/*!
+	Returns True, if the server switch is passed in the command line.
+	This is checked before the application and the user interface are initialized.
+*/
+bool CARenderServer::isServerMode(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        QString arg(argv[i]);
+        if (arg == SERVE_SWITCH || arg.startsWith(SERVE_SWITCH + "=") || arg == HTTP_SWITCH || arg.startsWith(HTTP_SWITCH + "=")) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*!
+	Reads the socket name, the port, the root directory, the cache size and the number of the
+	export jobs from the given command line \a arguments. The switch values can be passed either
+	as "--switch=value" or "--switch value".
+
+	Returns False and prints the usage, if the arguments are invalid.
+*/
+bool CARenderServer::parseArguments(const QStringList& arguments)
+{
+    for (int i = 1; i < arguments.size(); i++) {
+        QString arg = arguments[i];
+        QString value;
+        int eq = arg.indexOf('=');
+        if (arg.startsWith("--")) {
+            if (eq != -1) {
+                value = arg.mid(eq + 1);
+                arg = arg.left(eq);
+            } else if ((arg == SERVE_SWITCH || arg == HTTP_SWITCH || arg == ROOT_SWITCH || arg == CACHE_SWITCH || arg == CABatchConvert::JOBS_SWITCH) && i + 1 < arguments.size()) {
+                value = arguments[++i];
+            }
+        }
+
+        bool ok = true;
+        if (arg == SERVE_SWITCH) {
+            _socketName = value;
+            ok = !value.isEmpty();
+        } else if (arg == HTTP_SWITCH) {
+            _port = value.toInt(&ok);
+            ok = ok && _port > 0 && _port < 65536;
+        } else if (arg == ROOT_SWITCH) {
+            _root = QDir(value);
+            ok = _root.exists();
+        } else if (arg == CACHE_SWITCH) {
+            _cacheSize = value.toInt(&ok);
+            ok = ok && _cacheSize > 0;
+        } else if (arg == CABatchConvert::JOBS_SWITCH) {
+            int jobs = value.toInt(&ok);
+            ok = ok && jobs > 0;
+            if (ok) {
+                _pool.setMaxThreadCount(jobs);
+            }
+        }
+
+        if (!ok) {
+            report(tr("Invalid value of %1: %2").arg(arg, value), true);
+            printUsage();
+            return false;
+        }
+    }
+
+    if (_socketName.isEmpty() && !_port) {
+        printUsage();
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+	Starts listening on the local socket and the HTTP port. Returns False, if any of them cannot
+	be opened.
+*/
+bool CARenderServer::listen()
+{
+    if (!_socketName.isEmpty()) {
+        _localServer = new QLocalServer(this);
+        if (!_localServer->listen(_socketName) && _localServer->serverError() == QAbstractSocket::AddressInUseError) {
+            QLocalSocket probe;
+            probe.connectToServer(_socketName);
+            if (!probe.waitForConnected(100)) {
+                QLocalServer::removeServer(_socketName); // left behind by a server which crashed
+                _localServer->listen(_socketName);
+            }
+        }
+
+        if (!_localServer->isListening()) {
+            report(tr("Cannot listen on %1: %2").arg(_socketName, _localServer->errorString()), true);
+            return false;
+        }
+        connect(_localServer, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+        report(tr("Listening on %1").arg(_localServer->fullServerName()));
+    }
+
+    if (_port) {
+        _tcpServer = new QTcpServer(this);
+        if (!_tcpServer->listen(QHostAddress::LocalHost, static_cast<quint16>(_port))) {
+            report(tr("Cannot listen on port %1: %2").arg(_port).arg(_tcpServer->errorString()), true);
+            return false;
+        }
+        connect(_tcpServer, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+        report(tr("Listening on http://localhost:%1").arg(_port));
+    }
+
+    return true;
+}
+
+void CARenderServer::onNewConnection()
+{
+    for (;;) {
+        QIODevice* socket = nullptr;
+        if (sender() == _localServer && _localServer->hasPendingConnections()) {
+            socket = _localServer->nextPendingConnection();
+        } else if (sender() == _tcpServer && _tcpServer->hasPendingConnections()) {
+            socket = _tcpServer->nextPendingConnection();
+        }
+        if (!socket) {
+            break;
+        }
+
+        connect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+    }
+}
+
+/*!
+	Collects the request head and handles the request once it is complete. The request body, if
+	any, is ignored.
+*/
+void CARenderServer::onReadyRead()
+{
+    QIODevice* socket = static_cast<QIODevice*>(sender());
+    QByteArray& head = _pendingHeads[socket];
+    head += socket->readAll();
+
+    int end = head.indexOf("\r\n\r\n");
+    if (end == -1) {
+        end = head.indexOf("\n\n");
+    }
+    if (end == -1 && head.size() <= MAX_REQUEST_SIZE) {
+        return; // wait for the rest
+    }
+
+    QByteArray request = _pendingHeads.take(socket);
+    disconnect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    if (end == -1) {
+        reply(socket, 413, textType, "The request is too large.\n");
+    } else {
+        handleRequest(socket, request.left(end));
+    }
+}
+
+void CARenderServer::onDisconnected()
+{
+    QIODevice* socket = static_cast<QIODevice*>(sender());
+    _pendingHeads.remove(socket);
+    for (QHash<int, QIODevice*>::iterator i = _runningJobs.begin(); i != _runningJobs.end(); i++) {
+        if (i.value() == socket) {
+            i.value() = nullptr; // the job keeps running, its result is dropped
+        }
+    }
+    socket->deleteLater();
+}
+
+/*!
+	Sends the result of the export job \a id, if its client is still connected.
+*/
+void CARenderServer::finishRequest(int id, int status, const QByteArray& contentType, const QByteArray& body)
+{
+    QIODevice* socket = _runningJobs.take(id);
+    if (socket) {
+        reply(socket, status, contentType, body);
+    }
+}
+
+void CARenderServer::handleRequest(QIODevice* socket, const QByteArray& head)
+{
+    _requestCount++;
+
+    QList<QByteArray> requestLine = head.left(head.indexOf('\n')).trimmed().split(' ');
+    if (requestLine.size() < 2) {
+        reply(socket, 400, textType, "Invalid request.\n");
+        return;
+    } else if (requestLine[0] != "GET") {
+        reply(socket, 405, textType, "Only GET requests are supported.\n");
+        return;
+    }
+
+    QUrl url(QString::fromLatin1(requestLine[1]));
+    if (url.path() == "/render") {
+        render(socket, QUrlQuery(url));
+    } else if (url.path() == "/status") {
+        reply(socket, 200, textType, status());
+    } else {
+        reply(socket, 404, textType, "Unknown request, use /render or /status.\n");
+    }
+}
+
+/*!
+	Renders the sheet given in the \a query or starts the export job for it.
+*/
+void CARenderServer::render(QIODevice* socket, const QUrlQuery& query)
+{
+    QString format = query.hasQueryItem("format") ? query.queryItemValue("format").toLower() : QString("png");
+    if (format != "png" && format != "svg" && format != "pdf" && format != "midi" && format != "lilypond") {
+        reply(socket, 400, textType, tr("Unknown format %1, use png, svg, pdf, midi or lilypond.\n").arg(format).toUtf8());
+        return;
+    }
+
+    bool ok = true;
+    int sheet = query.hasQueryItem("sheet") ? query.queryItemValue("sheet").toInt(&ok) : 1;
+    double zoom = query.hasQueryItem("zoom") ? query.queryItemValue("zoom").toDouble(&ok) : 1.0;
+    if (!ok || zoom <= 0) {
+        reply(socket, 400, textType, "Invalid sheet or zoom.\n");
+        return;
+    }
+
+    QString error;
+    CACachedDocument* d = cachedDocument(query.queryItemValue("file", QUrl::FullyDecoded), &error);
+    if (!d) {
+        reply(socket, 404, textType, error.toUtf8() + "\n");
+        return;
+    }
+
+    if (sheet < 1 || sheet > d->document->sheetList().size()) {
+        reply(socket, 404, textType, tr("The document has no sheet %1.\n").arg(sheet).toUtf8());
+        return;
+    }
+
+    if (format == "midi" || format == "lilypond") {
+        int id = _nextJobId++;
+        _runningJobs[id] = socket;
+        _pool.start(new CARenderJob(this, id, d->document, sheet - 1, format));
+        return;
+    }
+
+    // the renderer keeps the layout of the sheet, the vector export shares it
+    CASheetRenderer*& renderer = d->renderers[sheet - 1];
+    if (!renderer) {
+        renderer = new CASheetRenderer(d->document->sheetList()[sheet - 1]);
+    }
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    if (format == "png") {
+        renderer->layout();
+        QRectF world = renderer->worldRect();
+        if (world.width() * zoom * world.height() * zoom > MAX_IMAGE_PIXELS) {
+            reply(socket, 400, textType, "The image would be too large, use a smaller zoom.\n");
+            return;
+        }
+        renderer->render(world, zoom).save(&buffer, "PNG");
+        reply(socket, 200, "image/png", buffer.data());
+    } else {
+        CAVectorExport exporter((format == "pdf") ? CAVectorExport::PDF : CAVectorExport::SVG);
+        if (!exporter.exportSheet(renderer->sheet(), &buffer)) {
+            reply(socket, 500, textType, "The sheet cannot be rendered.\n");
+            return;
+        }
+        reply(socket, 200, (format == "pdf") ? "application/pdf" : "image/svg+xml", buffer.data());
+    }
+}
+
+/*!
+	Writes the HTTP response and closes the connection once it is sent.
+*/
+void CARenderServer::reply(QIODevice* socket, int status, const QByteArray& contentType, const QByteArray& body)
+{
+    socket->write(QString("HTTP/1.0 %1 %2\r\nContent-Type: %3\r\nContent-Length: %4\r\nConnection: close\r\n\r\n")
+                      .arg(status)
+                      .arg(reasonPhrase(status))
+                      .arg(QString::fromLatin1(contentType))
+                      .arg(body.size())
+                      .toLatin1());
+    socket->write(body);
+
+    if (QLocalSocket* localSocket = qobject_cast<QLocalSocket*>(socket)) {
+        localSocket->disconnectFromServer();
+    } else if (QTcpSocket* tcpSocket = qobject_cast<QTcpSocket*>(socket)) {
+        tcpSocket->disconnectFromHost();
+    }
+}
+
+QByteArray CARenderServer::status()
+{
+    return QString("documents %1\nrequests %2\nrunning %3\nthreads %4\n")
+        .arg(_cache.size())
+        .arg(_requestCount)
+        .arg(_runningJobs.size())
+        .arg(_pool.maxThreadCount())
+        .toUtf8();
+}
+
+/*!
+	Returns the cached document \a fileName relative to the root directory. The document is read,
+	if it isn't cached yet or its file was modified since. Returns nullptr and sets the \a error,
+	if the document cannot be read or is outside the root directory.
+*/
+CARenderServer::CACachedDocument* CARenderServer::cachedDocument(const QString& fileName, QString* error)
+{
+    QString root = _root.canonicalPath();
+    if (!root.endsWith('/')) {
+        root += '/';
+    }
+
+    QFileInfo info(_root.filePath(fileName));
+    QString path = info.canonicalFilePath();
+    if (fileName.isEmpty() || path.isEmpty() || !path.startsWith(root) || !info.isFile()) {
+        *error = tr("No document %1").arg(fileName);
+        return nullptr;
+    }
+
+    CACachedDocument* d = _cache.value(path);
+    if (d && d->modified != info.lastModified()) {
+        dropDocument(path);
+        d = nullptr;
+    }
+
+    if (!d) {
+        CAImport* import = CABatchConvert::createImport(path);
+        if (!import) {
+            *error = tr("%1: Unknown file format").arg(fileName);
+            return nullptr;
+        }
+
+        import->setStreamFromFile(path);
+        import->importDocument();
+        import->wait();
+
+        CADocument* document = import->importedDocument();
+        if (import->status() < 0 || !document) {
+            *error = QString("%1: %2").arg(fileName, import->readableStatus());
+            delete import;
+            delete document;
+            return nullptr;
+        }
+        delete import;
+
+        // read the lazily loaded sheets and build their caches here, the same as CADocumentVersion
+        // does, and not in the export jobs reading the document at the same time
+        for (CASheet* sheet : document->sheetList()) {
+            sheet->contextList();
+            sheet->staffList();
+            for (CAVoice* voice : sheet->voiceList()) {
+                voice->buildTypeIndex();
+            }
+            sheet->buildTempoMap();
+            sheet->buildChordIndex();
+            sheet->buildBarTable();
+        }
+
+        while (_cache.size() >= _cacheSize) {
+            QString oldest = _cache.begin().key();
+            for (QHash<QString, CACachedDocument*>::const_iterator i = _cache.constBegin(); i != _cache.constEnd(); i++) {
+                if (i.value()->lastUsed < _cache.value(oldest)->lastUsed) {
+                    oldest = i.key();
+                }
+            }
+            dropDocument(oldest);
+        }
+
+        d = new CACachedDocument;
+        d->document.reset(document);
+        d->modified = info.lastModified();
+        for (int i = 0; i < document->sheetList().size(); i++) {
+            d->renderers << nullptr;
+        }
+        _cache[path] = d;
+    }
+
+    d->lastUsed = _requestCount;
+    return d;
+}
+
+/*!
+	Removes the document \a fileName and its layouts from the cache. The running export jobs keep
+	the document until they are finished.
+*/
+void CARenderServer::dropDocument(const QString& fileName)
+{
+    CACachedDocument* d = _cache.take(fileName);
+    if (d) {
+        qDeleteAll(d->renderers);
+        delete d;
+    }
+}
+
+void CARenderServer::printUsage()
+{
+    report(tr("Usage: canorus %1=<socket> | %2=<port> [%3=<directory>] [%4=<documents>] [%5=<number>]")
+               .arg(SERVE_SWITCH, HTTP_SWITCH, ROOT_SWITCH, CACHE_SWITCH, CABatchConvert::JOBS_SWITCH),
+        true);
+}
+
+/*!
+	Prints the \a message to the standard output or to the standard error, if \a error is True.
+*/
+void CARenderServer::report(const QString& message, bool error)
+{
+    if (error) {
+        std::cerr << qPrintable(message) << std::endl;
+    } else {
+        std::cout << qPrintable(message) << std::endl;
+    }
+}
@@ -0,0 +1,84 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef RENDERSERVER_H_
+#define RENDERSERVER_H_
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QDir>
+#include <QHash>
+#include <QObject>
+#include <QThreadPool>
+
+#include <memory>
+
+class QIODevice;
+class QLocalServer;
+class QTcpServer;
+class QUrlQuery;
+class CADocument;
+class CASheetRenderer;
+
+class CARenderServer : public QObject {
+    Q_OBJECT
+public:
+    CARenderServer(QObject* parent = nullptr);
+    virtual ~CARenderServer();
+
+    static bool isServerMode(int argc, char* argv[]);
+    bool parseArguments(const QStringList& arguments);
+    bool listen();
+
+    static const QString SERVE_SWITCH;
+    static const QString HTTP_SWITCH;
+    static const QString ROOT_SWITCH;
+    static const QString CACHE_SWITCH;
+    static const int MAX_REQUEST_SIZE;
+    static const qint64 MAX_IMAGE_PIXELS;
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+    void finishRequest(int id, int status, const QByteArray& contentType, const QByteArray& body);
+
+private:
+    struct CACachedDocument {
+        std::shared_ptr<CADocument> document; // shared with the running export jobs
+        QDateTime modified; // of the file when it was read
+        QList<CASheetRenderer*> renderers; // per sheet, created on the first render, keep the layout
+        qint64 lastUsed; // request number, for dropping the least recently used documents
+    };
+
+    void handleRequest(QIODevice* socket, const QByteArray& head);
+    void render(QIODevice* socket, const QUrlQuery& query);
+    void reply(QIODevice* socket, int status, const QByteArray& contentType, const QByteArray& body);
+    QByteArray status();
+
+    CACachedDocument* cachedDocument(const QString& fileName, QString* error);
+    void dropDocument(const QString& fileName);
+
+    void printUsage();
+    void report(const QString& message, bool error = false);
+
+    QLocalServer* _localServer;
+    QTcpServer* _tcpServer;
+    QString _socketName; // local socket name or path, empty if not served
+    int _port; // HTTP port on the loopback interface, 0 if not served
+    QDir _root; // the rendered documents must be inside it
+    int _cacheSize; // max number of the cached documents
+    QThreadPool _pool; // export jobs, one per core by default
+
+    QHash<QIODevice*, QByteArray> _pendingHeads; // request heads read so far
+    QHash<int, QIODevice*> _runningJobs; // socket of each export job, null when disconnected
+    int _nextJobId;
+    qint64 _requestCount;
+    QHash<QString, CACachedDocument*> _cache; // by the canonical file path
+};
+
+#endif /* RENDERSERVER_H_ */
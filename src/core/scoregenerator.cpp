@@ -0,0 +1,230 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QObject>
+
+#include "core/scoregenerator.h"
+
+#include "score/articulation.h"
+#include "score/barline.h"
+#include "score/clef.h"
+#include "score/document.h"
+#include "score/dynamic.h"
+#include "score/figuredbasscontext.h"
+#include "score/figuredbassmark.h"
+#include "score/lyricscontext.h"
+#include "score/note.h"
+#include "score/sheet.h"
+#include "score/slur.h"
+#include "score/staff.h"
+#include "score/syllable.h"
+#include "score/timesignature.h"
+#include "score/tuplet.h"
+#include "score/voice.h"
+
+namespace {
+
+const int notesPerBar = 4; // quarters in 4/4
+
+/*!
+	Returns True, if the beat \a i is the n-th one. The \a offset shifts the pattern, so the
+	elements of different kinds don't always fall on the same beats.
+*/
+bool every(int n, int i, int offset = 0)
+{
+    return n > 0 && !((i + offset) % n);
+}
+
+}
+
+/*!
+	\class CAScoreGenerator
+	\brief Synthetic scores for the benchmarks and stress tests
+
+	Generates a document of the given number of sheets, staffs per sheet, voices per staff and
+	bars. Each staff starts with a clef and a 4/4 time signature and each bar is filled with
+	quarter notes in every voice.
+
+	The density of the other elements is set by their "every" setting, eg. setChordsEvery(4)
+	makes every fourth beat a triad. Tuplets replace the beat by a triplet of eighths, slurs span
+	two beats, marks are articulations and dynamics, figured bass is added below the lowest staff
+	of each sheet and a stanza of lyrics is added below each staff. 0 disables the element.
+
+	The generated documents are the same for the same settings, so the benchmark results of
+	different builds can be compared. The generator is used by canorus-bench and is also
+	available to the scripts:
+	\code
+	  gen = CanorusPython.CAScoreGenerator()
+	  gen.setSheetCount(2)
+	  gen.setBarCount(1000)
+	  gen.setTupletsEvery(7)
+	  doc = gen.generate()
+	\endcode
+*/
+
+CAScoreGenerator::CAScoreGenerator()
+    : _sheetCount(1)
+    , _staffCount(4)
+    , _voiceCount(1)
+    , _barCount(100)
+    , _chordsEvery(0)
+    , _tupletsEvery(0)
+    , _slursEvery(0)
+    , _marksEvery(0)
+    , _figuredBassEvery(0)
+    , _lyrics(false)
+{
+}
+
+/*!
+	Creates a new document according to the settings. The caller takes the ownership.
+*/
+CADocument* CAScoreGenerator::generate()
+{
+    CADocument* doc = new CADocument();
+    for (int i = 0; i < _sheetCount; i++) {
+        fillSheet(doc->addSheet());
+    }
+
+    return doc;
+}
+
+/*!
+	Returns the number of notes generate() creates with the current settings.
+*/
+int CAScoreGenerator::noteCount()
+{
+    int notes = 0;
+    for (int i = 0; i < _barCount * notesPerBar; i++) {
+        notes += (every(_tupletsEvery, i, 1) || every(_chordsEvery, i)) ? 3 : 1;
+    }
+
+    return notes * _voiceCount * _staffCount * _sheetCount;
+}
+
+void CAScoreGenerator::fillSheet(CASheet* sheet)
+{
+    for (int i = 0; i < _staffCount; i++) {
+        CAStaff* staff = sheet->addStaff();
+        for (int j = 1; j < _voiceCount; j++) {
+            staff->addVoice();
+        }
+
+        fillStaff(staff, i);
+    }
+
+    if (_figuredBassEvery > 0 && _staffCount > 0) {
+        CAFiguredBassContext* fbc = new CAFiguredBassContext(QObject::tr("FiguredBass"), sheet);
+        sheet->addContext(fbc);
+        fillFiguredBass(fbc);
+    }
+}
+
+void CAScoreGenerator::fillStaff(CAStaff* staff, int staffIdx)
+{
+    // clef, time signature and barlines are shared by all the voices
+    CAVoice* first = staff->voiceList()[0];
+    first->append(new CAClef((staffIdx % 2) ? CAClef::Bass : CAClef::Treble, staff, 0));
+    first->append(new CATimeSignature(4, 4, staff, 0));
+
+    for (int i = 0; i < staff->voiceList().size(); i++) {
+        CAVoice* voice = staff->voiceList()[i];
+        if (staff->voiceList().size() > 1) {
+            voice->setStemDirection((i % 2) ? CANote::StemDown : CANote::StemUp);
+        }
+
+        CALyricsContext* lc = nullptr;
+        if (_lyrics && i == 0) {
+            lc = new CALyricsContext(staff->name() + QObject::tr("Lyrics"), 1, voice);
+            staff->sheet()->insertContextAfter(staff, lc);
+        }
+
+        fillVoice(voice, staffIdx, i, lc);
+    }
+
+    staff->synchronizeVoices();
+}
+
+void CAScoreGenerator::fillVoice(CAVoice* voice, int staffIdx, int voiceIdx, CALyricsContext* lc)
+{
+    CAPlayableLength length(CAPlayableLength::Quarter);
+    CAPlayableLength tupletLength(CAPlayableLength::Eighth);
+    int timeLength = CAPlayableLength::playableLengthToTimeLength(length);
+    int basePitch = ((staffIdx % 2) ? 16 : 28) - voiceIdx * 4; // c or c' lowered for the lower voices
+    int beatCount = _barCount * notesPerBar;
+    CASlur* slur = nullptr;
+
+    for (int i = 0; i < beatCount; i++) {
+        int timeStart = i * timeLength;
+        CADiatonicPitch pitch(basePitch + (i % 8), (i % 13) ? 0 : 1);
+        bool tuplet = every(_tupletsEvery, i, 1);
+        CANote* note = new CANote(pitch, tuplet ? tupletLength : length, voice, timeStart);
+        CANote* last = note; // the note ending the beat
+
+        if (tuplet) {
+            voice->append(note);
+
+            QList<CAPlayable*> notes;
+            notes << note;
+            for (int j = 1; j < 3; j++) {
+                last = new CANote(CADiatonicPitch(pitch.noteName() + j), tupletLength, voice, timeStart);
+                voice->append(last);
+                notes << last;
+            }
+            new CATuplet(3, 2, notes); // owned by the notes
+        } else {
+            voice->append(note);
+            if (every(_chordsEvery, i)) {
+                voice->append(new CANote(CADiatonicPitch(pitch.noteName() + 2), length, voice, timeStart), true);
+                voice->append(new CANote(CADiatonicPitch(pitch.noteName() + 4), length, voice, timeStart), true);
+            }
+        }
+
+        if (slur) {
+            last->setSlurEnd(slur);
+            slur->setNoteEnd(last);
+            slur->setTimeLength(last->timeStart() - slur->noteStart()->timeStart());
+            slur = nullptr;
+        } else if (every(_slursEvery, i, 2) && i + 1 < beatCount) {
+            slur = new CASlur(CASlur::SlurType, CASlur::SlurPreferred, voice->staff(), note, nullptr);
+            note->setSlurStart(slur);
+        }
+
+        if (every(_marksEvery, i)) {
+            note->addMark(new CAArticulation((i % 2) ? CAArticulation::Staccato : CAArticulation::Accent, note));
+            if (!(i % (_marksEvery * notesPerBar))) {
+                note->addMark(new CADynamic("mf", 80, note));
+            }
+        }
+
+        if (lc) {
+            lc->addSyllable(new CASyllable(QString("la%1").arg(i % 10), (i % 2) == 0, false, lc, timeStart, timeLength, voice));
+        }
+
+        if (voiceIdx == 0 && !((i + 1) % notesPerBar)) {
+            int bar = (i + 1) / notesPerBar;
+            voice->append(new CABarline((bar == _barCount) ? CABarline::End : CABarline::Single, voice->staff(), timeStart + timeLength));
+        }
+    }
+}
+
+void CAScoreGenerator::fillFiguredBass(CAFiguredBassContext* fbc)
+{
+    int timeLength = CAPlayableLength::playableLengthToTimeLength(CAPlayableLength(CAPlayableLength::Quarter));
+    for (int i = 0; i < _barCount * notesPerBar; i++) {
+        if (!every(_figuredBassEvery, i)) {
+            continue;
+        }
+
+        CAFiguredBassMark* fbm = new CAFiguredBassMark(fbc, i * timeLength, timeLength);
+        fbm->addNumber(6);
+        if (i % 2) {
+            fbm->addNumber(4, (i % 3) ? 0 : 1);
+        }
+        fbc->addFiguredBassMark(fbm);
+    }
+}
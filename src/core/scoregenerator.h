@@ -0,0 +1,73 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef SCOREGENERATOR_H_
+#define SCOREGENERATOR_H_
+
+class CADocument;
+class CASheet;
+class CAStaff;
+class CAVoice;
+class CALyricsContext;
+class CAFiguredBassContext;
+
+class CAScoreGenerator {
+public:
+    CAScoreGenerator();
+
+    inline int sheetCount() { return _sheetCount; }
+    inline void setSheetCount(int count) { _sheetCount = count; }
+
+    inline int staffCount() { return _staffCount; }
+    inline void setStaffCount(int count) { _staffCount = count; }
+
+    inline int voiceCount() { return _voiceCount; }
+    inline void setVoiceCount(int count) { _voiceCount = count; }
+
+    inline int barCount() { return _barCount; }
+    inline void setBarCount(int count) { _barCount = count; }
+
+    inline int chordsEvery() { return _chordsEvery; }
+    inline void setChordsEvery(int n) { _chordsEvery = n; }
+
+    inline int tupletsEvery() { return _tupletsEvery; }
+    inline void setTupletsEvery(int n) { _tupletsEvery = n; }
+
+    inline int slursEvery() { return _slursEvery; }
+    inline void setSlursEvery(int n) { _slursEvery = n; }
+
+    inline int marksEvery() { return _marksEvery; }
+    inline void setMarksEvery(int n) { _marksEvery = n; }
+
+    inline int figuredBassEvery() { return _figuredBassEvery; }
+    inline void setFiguredBassEvery(int n) { _figuredBassEvery = n; }
+
+    inline bool hasLyrics() { return _lyrics; }
+    inline void setLyrics(bool lyrics) { _lyrics = lyrics; }
+
+    CADocument* generate();
+    int noteCount();
+
+private:
+    void fillSheet(CASheet* sheet);
+    void fillStaff(CAStaff* staff, int staffIdx);
+    void fillVoice(CAVoice* voice, int staffIdx, int voiceIdx, CALyricsContext* lc);
+    void fillFiguredBass(CAFiguredBassContext* fbc);
+
+    int _sheetCount;
+    int _staffCount; // per sheet
+    int _voiceCount; // per staff
+    int _barCount;
+    int _chordsEvery; // make every n-th beat a triad, 0 for none
+    int _tupletsEvery; // split every n-th beat into a triplet of eighths, 0 for none
+    int _slursEvery; // start a slur over two beats on every n-th beat, 0 for none
+    int _marksEvery; // add marks to every n-th beat, 0 for none
+    int _figuredBassEvery; // figure every n-th beat of the lowest staff, 0 for no figured bass
+    bool _lyrics; // add a stanza below each staff
+};
+
+#endif /* SCOREGENERATOR_H_ */
@@ -0,0 +1,419 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QAction>
+#include <QApplication>
+#include <QFile>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QTextStream>
+#include <QTimer>
+#include <QUrl>
+
+#include "canorus.h"
+#include "core/actionlatency.h"
+#include "core/documentstatistics.h"
+#include "core/sessionjournal.h"
+#include "core/trace.h"
+#include "score/document.h"
+#include "score/sheet.h"
+#include "ui/mainwin.h"
+#include "widgets/scoreview.h"
+
+const QString CASessionJournal::RECORD_SWITCH = "--record-session";
+const QString CASessionJournal::REPLAY_SWITCH = "--replay-session";
+const QString CASessionJournal::OUTPUT_SWITCH = "--replay-output";
+const QString CASessionJournal::HEADER = "# Canorus session journal 1";
+const int CASessionJournal::SAMPLE_INTERVAL = 20; // entries
+
+QFile* CASessionJournal::_file = nullptr;
+QTextStream* CASessionJournal::_stream = nullptr;
+qint64 CASessionJournal::_recordStart = 0;
+QString CASessionJournal::_replayFileName;
+QString CASessionJournal::_outputFileName;
+qint64 CASessionJournal::_layoutTime = 0;
+qint64 CASessionJournal::_paintTime = 0;
+
+namespace {
+
+QString recordFileName;
+
+/*!
+	Actions opening dialogs, windows or touching the files. They are not recorded, so the journal
+	can be replayed unattended and doesn't overwrite the user's files.
+*/
+const QStringList unrecordedActions = QStringList()
+    << "uiQuit" << "uiNewDocument" << "uiOpenDocument" << "uiSaveDocument" << "uiSaveDocumentAs"
+    << "uiCloseDocument" << "uiImportDocument" << "uiExportDocument" << "uiPublish" << "uiPrintPreview"
+    << "uiPrint" << "uiPrintDirectly" << "uiExportToPdf" << "uiNewDocumentWizard" << "uiNewWindow"
+    << "uiSettings" << "uiUsersGuide" << "uiWhatsThis" << "uiTipOfTheDay" << "uiSavePerformanceTrace"
+    << "uiMemoryStatistics" << "uiActionLatencies" << "uiAboutCanorus" << "uiAboutQt"
+    << "uiDocumentProperties" << "uiSheetProperties" << "uiContextProperties" << "uiVoiceProperties"
+    << "uiTranspose" << "uiCustomZoom" << "uiJumpTo" << "uiMidiRecorder" << "uiResourceView";
+
+const char* mouseEventNames[] = { "press", "move", "release", "double", "triple" };
+
+}
+
+/*!
+	\class CASessionJournal
+	\brief Recording and replaying of the editing sessions
+
+	The performance problems of long sessions, eg. the growth of the undo stack or the drawables
+	leaking across the rebuilds, are hard to reproduce by hand. Canorus run with
+	--record-session=<file> writes the user's edits in the main windows to a journal, one entry per
+	line. The entries are the triggered actions, the MIDI keyboard input, the mouse clicks and
+	drags, the key presses in the score views and the text typed in their text fields. Actions
+	opening dialogs or touching the files aren't recorded.
+
+	Canorus run with --replay-session=<file> [document] replays the journal in the first main
+	window and quits. The replay is headless (the offscreen platform is used) and runs as fast as
+	the events are processed, the recorded times are informational only. Every SAMPLE_INTERVAL
+	entries the memory usage of the document (see CADocumentStatistics) and the layout and paint
+	times of the replayed edits (see CAActionLatency) are written to a CSV file given by
+	--replay-output=<file>, <journal>.csv by default:
+	\code
+	  canorus --record-session=session.txt score.can
+	  canorus --replay-session=session.txt --replay-output=soak.csv score.can
+	\endcode
+
+	The replay is deterministic when started from the same document, the same settings and the
+	same window size as the recording. The mouse positions are stored in the score coordinates, so
+	the zoom and the scroll position only need to match when they change the clicked element.
+*/
+
+/*!
+	Reads the journal switches from the command line. The offscreen platform is chosen for the
+	replay, if no platform was set. Returns True, if the session is recorded or replayed.
+
+	\sa start()
+*/
+bool CASessionJournal::parseArguments(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        QString arg = QString::fromLocal8Bit(argv[i]);
+        if (arg.startsWith(RECORD_SWITCH + "=")) {
+            recordFileName = arg.mid(RECORD_SWITCH.size() + 1);
+        } else if (arg.startsWith(REPLAY_SWITCH + "=")) {
+            _replayFileName = arg.mid(REPLAY_SWITCH.size() + 1);
+        } else if (arg.startsWith(OUTPUT_SWITCH + "=")) {
+            _outputFileName = arg.mid(OUTPUT_SWITCH.size() + 1);
+        }
+    }
+
+    if (isReplaying()) {
+        recordFileName.clear(); // the replayed actions would be recorded again
+        if (_outputFileName.isEmpty()) {
+            _outputFileName = _replayFileName + ".csv";
+        }
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+    }
+
+    return isReplaying() || !recordFileName.isEmpty();
+}
+
+/*!
+	Opens the journal for recording or schedules the replay in the first main window once the
+	event loop starts. Must be called after the application is created and before the main
+	windows are created.
+*/
+void CASessionJournal::start()
+{
+    if (!recordFileName.isEmpty()) {
+        _file = new QFile(recordFileName);
+        if (!_file->open(QIODevice::WriteOnly | QIODevice::Text)) {
+            qWarning("Cannot record the session to %s", qPrintable(recordFileName));
+            delete _file;
+            _file = nullptr;
+            return;
+        }
+
+        _stream = new QTextStream(_file);
+        *_stream << HEADER << "\n";
+        _stream->flush();
+        _recordStart = CATrace::now();
+    }
+
+    if (isReplaying()) {
+        QTimer* timer = new QTimer(qApp);
+        timer->setSingleShot(true);
+        QObject::connect(timer, &QTimer::timeout, []() {
+            bool ok = !CACanorus::mainWinList().isEmpty() && replay(CACanorus::mainWinList()[0]);
+            QCoreApplication::exit(ok ? 0 : 1);
+        });
+        timer->start(0);
+    }
+}
+
+bool CASessionJournal::isRecorded(const QString& actionName)
+{
+    return !actionName.isEmpty() && !unrecordedActions.contains(actionName);
+}
+
+/*!
+	Writes an entry of the given \a fields prefixed by the time in miliseconds since the start of
+	the recording. The journal is flushed after each entry, so it survives a crash.
+*/
+void CASessionJournal::write(const QStringList& fields)
+{
+    *_stream << (CATrace::now() - _recordStart) / 1000000 << '\t' << fields.join('\t') << "\n";
+    _stream->flush();
+}
+
+int CASessionJournal::sheetIndex(CAScoreView* v)
+{
+    return (v->sheet() && v->sheet()->document()) ? v->sheet()->document()->sheetList().indexOf(v->sheet()) : -1;
+}
+
+/*!
+	Records the action of the main window named \a name, if recording.
+*/
+void CASessionJournal::recordAction(const QString& name)
+{
+    if (isRecording() && isRecorded(name)) {
+        write(QStringList() << "action" << name);
+    }
+}
+
+/*!
+	Records the MIDI IN \a message processed by CAKeybdInput, if recording.
+*/
+void CASessionJournal::recordMidiIn(const QVector<unsigned char>& message)
+{
+    if (!isRecording()) {
+        return;
+    }
+
+    QByteArray data;
+    for (int i = 0; i < message.size(); i++) {
+        data.append(static_cast<char>(message[i]));
+    }
+    write(QStringList() << "midi" << QString::fromLatin1(data.toHex()));
+}
+
+/*!
+	Records the mouse event \a e of the score view \a v at the score \a coords, if recording. The
+	mouse moves are recorded only while a button is pressed.
+*/
+void CASessionJournal::recordMouse(CAMouseEventType type, CAScoreView* v, QMouseEvent* e, const QPoint coords)
+{
+    if (!isRecording() || (type == MouseMove && e->buttons() == Qt::NoButton)) {
+        return;
+    }
+
+    write(QStringList() << mouseEventNames[type] << QString::number(sheetIndex(v))
+                        << QString::number(coords.x()) << QString::number(coords.y())
+                        << QString::number(e->button()) << QString::number(e->buttons())
+                        << QString::number(e->modifiers()));
+}
+
+/*!
+	Records the key press \a e in the score view \a v, if recording.
+*/
+void CASessionJournal::recordKey(CAScoreView* v, QKeyEvent* e)
+{
+    if (isRecording()) {
+        write(QStringList() << "key" << QString::number(sheetIndex(v)) << QString::number(e->key())
+                            << QString::number(e->modifiers()) << QString::fromLatin1(QUrl::toPercentEncoding(e->text())));
+    }
+}
+
+/*!
+	Records the key press \a e in the text field of the score view \a v, if recording. The text of
+	the field after the key is stored, so the replay doesn't depend on the cursor movements.
+*/
+void CASessionJournal::recordText(CAScoreView* v, QKeyEvent* e)
+{
+    if (isRecording()) {
+        write(QStringList() << "text" << QString::number(sheetIndex(v)) << QString::number(e->key())
+                            << QString::number(e->modifiers()) << QString::fromLatin1(QUrl::toPercentEncoding(v->textEdit()->text())));
+    }
+}
+
+/*!
+	Replays the journal given by parseArguments() in \a mainWin and writes the samples to the
+	output file. Returns True on success. The entries which cannot be replayed, eg. the actions
+	disabled in the current state, are skipped. The whole replay is recorded as a CATrace zone.
+*/
+bool CASessionJournal::replay(CAMainWin* mainWin)
+{
+    QFile file(_replayFileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning("Cannot open the session journal %s", qPrintable(_replayFileName));
+        return false;
+    }
+
+    QTextStream in(&file);
+    if (in.readLine() != HEADER) {
+        qWarning("%s is not a Canorus session journal", qPrintable(_replayFileName));
+        return false;
+    }
+
+    QFile output(_outputFileName);
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning("Cannot write the replay samples to %s", qPrintable(_outputFileName));
+        return false;
+    }
+
+    QTextStream out(&output);
+    out << "entry,time_ms,memory_bytes,elements,undo_commands,drawables,tiles,layout_ms,paint_ms\n";
+
+    QCoreApplication::processEvents(); // show the document first
+    qint64 replayStart = CATrace::now();
+    _layoutTime = CAActionLatency::phaseTime(CAActionLatency::LayoutPhase);
+    _paintTime = CAActionLatency::phaseTime(CAActionLatency::PaintPhase);
+    out << sample(mainWin, 0, replayStart);
+
+    int entry = 0;
+    while (!in.atEnd()) {
+        QString line = in.readLine();
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+
+        replayEntry(mainWin, line.split('\t'));
+        QCoreApplication::processEvents(); // layout and paint the change
+
+        if (!(++entry % SAMPLE_INTERVAL)) {
+            out << sample(mainWin, entry, replayStart);
+        }
+    }
+
+    if (entry % SAMPLE_INTERVAL) {
+        out << sample(mainWin, entry, replayStart);
+    }
+
+    out.flush();
+    CATrace::record("CASessionJournal::replay", replayStart, CATrace::now());
+    return output.error() == QFile::NoError;
+}
+
+/*!
+	Replays a single journal entry of the given \a fields. Returns False, if it cannot be replayed.
+*/
+bool CASessionJournal::replayEntry(CAMainWin* mainWin, const QStringList& fields)
+{
+    if (fields.size() < 3) {
+        return false;
+    }
+
+    const QString& type = fields[1];
+    if (type == "action") {
+        QAction* action = mainWin->findChild<QAction*>(fields[2]);
+        if (!action || !action->isEnabled()) {
+            return false;
+        }
+        action->trigger();
+        return true;
+    }
+
+    if (type == "midi") {
+        QByteArray data = QByteArray::fromHex(fields[2].toLatin1());
+        QVector<unsigned char> message;
+        for (int i = 0; i < data.size(); i++) {
+            message << static_cast<unsigned char>(data[i]);
+        }
+        mainWin->onMidiInEvent(message);
+        return true;
+    }
+
+    CAScoreView* v = replayView(mainWin, fields[2].toInt());
+    if (!v) {
+        return false;
+    }
+
+    if ((type == "key" || type == "text") && fields.size() >= 6) {
+        QString text = QUrl::fromPercentEncoding(fields[5].toLatin1());
+        Qt::KeyboardModifiers modifiers(fields[4].toInt());
+        if (type == "key") {
+            QKeyEvent e(QEvent::KeyPress, fields[3].toInt(), modifiers, text);
+            emit v->CAKeyPressEvent(&e);
+        } else {
+            v->textEdit()->setText(text);
+            QKeyEvent e(QEvent::KeyPress, fields[3].toInt(), modifiers);
+            emit v->textEdit()->CAKeyPressEvent(&e);
+        }
+        return true;
+    }
+
+    if (fields.size() < 8) {
+        return false;
+    }
+
+    QPoint coords(fields[3].toInt(), fields[4].toInt());
+    QPointF pos((coords.x() - v->worldX()) * v->zoom(), (coords.y() - v->worldY()) * v->zoom());
+    Qt::MouseButton button = static_cast<Qt::MouseButton>(fields[5].toInt());
+    Qt::MouseButtons buttons(fields[6].toInt());
+    Qt::KeyboardModifiers modifiers(fields[7].toInt());
+
+    if (type == mouseEventNames[MousePress]) {
+        QMouseEvent e(QEvent::MouseButtonPress, pos, button, buttons, modifiers);
+        emit v->CAMousePressEvent(&e, coords);
+    } else if (type == mouseEventNames[MouseMove]) {
+        QMouseEvent e(QEvent::MouseMove, pos, button, buttons, modifiers);
+        emit v->CAMouseMoveEvent(&e, coords);
+    } else if (type == mouseEventNames[MouseRelease]) {
+        QMouseEvent e(QEvent::MouseButtonRelease, pos, button, buttons, modifiers);
+        emit v->CAMouseReleaseEvent(&e, coords);
+    } else if (type == mouseEventNames[MouseDoubleClick]) {
+        QMouseEvent e(QEvent::MouseButtonDblClick, pos, button, buttons, modifiers);
+        emit v->CADoubleClickEvent(&e, coords);
+    } else if (type == mouseEventNames[MouseTripleClick]) {
+        QMouseEvent e(QEvent::MouseButtonDblClick, pos, button, buttons, modifiers);
+        emit v->CATripleClickEvent(&e, coords);
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+	Returns the score view of the sheet \a sheetIdx in \a mainWin and makes it current. The
+	current view is preferred, if it shows the sheet. Returns nullptr, if the sheet isn't shown.
+*/
+CAScoreView* CASessionJournal::replayView(CAMainWin* mainWin, int sheetIdx)
+{
+    CAScoreView* current = mainWin->currentScoreView();
+    if (current && sheetIndex(current) == sheetIdx) {
+        return current;
+    }
+
+    for (CAView* view : mainWin->viewList()) {
+        if (view->viewType() == CAView::ScoreView && sheetIndex(static_cast<CAScoreView*>(view)) == sheetIdx) {
+            mainWin->setCurrentView(view);
+            return static_cast<CAScoreView*>(view);
+        }
+    }
+
+    return nullptr;
+}
+
+/*!
+	Returns a CSV line of the document usage after the \a entry and the layout and paint times
+	since the previous sample.
+*/
+const QString CASessionJournal::sample(CAMainWin* mainWin, int entry, qint64 replayStart)
+{
+    qint64 layoutTime = CAActionLatency::phaseTime(CAActionLatency::LayoutPhase);
+    qint64 paintTime = CAActionLatency::phaseTime(CAActionLatency::PaintPhase);
+    QString line = QString("%1,%2").arg(entry).arg((CATrace::now() - replayStart) / 1000000);
+
+    if (mainWin->document()) {
+        CADocumentStatistics statistics(mainWin->document());
+        line += QString(",%1,%2,%3,%4,%5").arg(statistics.totalBytes()).arg(statistics.elementCount()).arg(statistics.undoCount()).arg(statistics.drawableCount()).arg(statistics.tileCount());
+    } else {
+        line += ",0,0,0,0,0";
+    }
+
+    line += QString(",%1,%2\n").arg((layoutTime - _layoutTime) / 1e6, 0, 'f', 1).arg((paintTime - _paintTime) / 1e6, 0, 'f', 1);
+    _layoutTime = layoutTime;
+    _paintTime = paintTime;
+    return line;
+}
@@ -0,0 +1,72 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef SESSIONJOURNAL_H_
+#define SESSIONJOURNAL_H_
+
+#include <QPoint>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QFile;
+class QMouseEvent;
+class QKeyEvent;
+class QTextStream;
+class CAMainWin;
+class CAScoreView;
+
+class CASessionJournal {
+public:
+    enum CAMouseEventType {
+        MousePress,
+        MouseMove,
+        MouseRelease,
+        MouseDoubleClick,
+        MouseTripleClick
+    };
+
+    static bool parseArguments(int argc, char* argv[]);
+    static void start();
+
+    static inline bool isRecording() { return _stream != nullptr; }
+    static inline bool isReplaying() { return !_replayFileName.isEmpty(); }
+
+    static void recordAction(const QString& name);
+    static void recordMidiIn(const QVector<unsigned char>& message);
+    static void recordMouse(CAMouseEventType type, CAScoreView* v, QMouseEvent* e, const QPoint coords);
+    static void recordKey(CAScoreView* v, QKeyEvent* e);
+    static void recordText(CAScoreView* v, QKeyEvent* e);
+
+    static bool replay(CAMainWin* mainWin);
+
+    static const QString RECORD_SWITCH;
+    static const QString REPLAY_SWITCH;
+    static const QString OUTPUT_SWITCH;
+    static const QString HEADER;
+    static const int SAMPLE_INTERVAL;
+
+private:
+    static bool isRecorded(const QString& actionName);
+    static void write(const QStringList& fields);
+    static int sheetIndex(CAScoreView* v);
+
+    static bool replayEntry(CAMainWin* mainWin, const QStringList& fields);
+    static CAScoreView* replayView(CAMainWin* mainWin, int sheetIdx);
+    static const QString sample(CAMainWin* mainWin, int entry, qint64 replayStart);
+
+    static QFile* _file; // journal being recorded
+    static QTextStream* _stream; // nullptr if not recording
+    static qint64 _recordStart;
+
+    static QString _replayFileName; // empty if not replaying
+    static QString _outputFileName; // samples of the replay
+    static qint64 _layoutTime; // layout and paint times at the last sample
+    static qint64 _paintTime;
+};
+
+#endif /* SESSIONJOURNAL_H_ */
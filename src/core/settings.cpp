@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2007-2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -21,17 +21,21 @@ const bool CASettings::DEFAULT_SHADOW_NOTES_IN_OTHER_STAFFS = false;
 const bool CASettings::DEFAULT_PLAY_INSERTED_NOTES = true;
 const bool CASettings::DEFAULT_AUTO_BAR = true;
 const bool CASettings::DEFAULT_USE_NOTE_CHECKER = true;
+const int CASettings::DEFAULT_UNDO_MEMORY_LIMIT = 512;
 
 const QDir CASettings::DEFAULT_DOCUMENTS_DIRECTORY = QDir::home();
 const QDir CASettings::DEFAULT_SHORTCUTS_DIRECTORY = QDir(QDir::homePath() + "/.config/Canorus");
 const CAFileFormats::CAFileFormatType CASettings::DEFAULT_SAVE_FORMAT = CAFileFormats::Can;
 const int CASettings::DEFAULT_AUTO_RECOVERY_INTERVAL = 1;
 const int CASettings::DEFAULT_MAX_RECENT_DOCUMENTS = 15;
+const bool CASettings::DEFAULT_JOURNALED_SAVE = false;
 
 #ifndef SWIGCPP
 const bool CASettings::DEFAULT_LOCK_SCROLL_PLAYBACK = true; // scroll while playing
 const bool CASettings::DEFAULT_ANIMATED_SCROLL = true;
 const bool CASettings::DEFAULT_ANTIALIASING = true;
+const double CASettings::DEFAULT_LOD_ZOOM_FACTOR = 1.0;
+const bool CASettings::DEFAULT_OPENGL_CANVAS = false;
 const bool CASettings::DEFAULT_SHOW_RULER = true;
 const QColor CASettings::DEFAULT_BACKGROUND_COLOR = QColor(255, 255, 240);
 const QColor CASettings::DEFAULT_FOREGROUND_COLOR = Qt::black;
@@ -46,6 +50,10 @@ const int CASettings::DEFAULT_MIDI_IN_PORT = -1;
 const int CASettings::DEFAULT_MIDI_OUT_PORT = -1;
 const int CASettings::DEFAULT_MIDI_IN_NUM_DEVICES = 0;
 const int CASettings::DEFAULT_MIDI_OUT_NUM_DEVICES = 0;
+const int CASettings::DEFAULT_MIDI_OUT_LATENCY = 0;
+const CAPlayableLength::CAMusicLength CASettings::DEFAULT_MIDI_QUANTIZE_GRID = CAPlayableLength::Undefined;
+const bool CASettings::DEFAULT_MIDI_QUANTIZE_TRIPLETS = true;
+const QString CASettings::DEFAULT_SOUND_FONT = "";
 
 const CATypesetter::CATypesetterType CASettings::DEFAULT_TYPESETTER = CATypesetter::LilyPond;
 #ifdef Q_OS_WIN
@@ -56,6 +64,7 @@ const QString CASettings::DEFAULT_TYPESETTER_LOCATION = "/Applications/LilyPond.
 const QString CASettings::DEFAULT_TYPESETTER_LOCATION = "lilypond";
 #endif
 const bool CASettings::DEFAULT_USE_SYSTEM_TYPESETTER = true;
+const int CASettings::DEFAULT_TYPESETTER_JOBS = 0;
 const QString CASettings::DEFAULT_PDF_VIEWER_LOCATION = "";
 const bool CASettings::DEFAULT_USE_SYSTEM_PDF_VIEWER = true;
 
@@ -106,6 +115,7 @@ void CASettings::initSettings()
 {
 #ifndef SWIGCPP
     _poEmptyEntry = new CASingleAction(this);
+    _iActionIndexRevision = -1;
 #endif
 }
 
@@ -129,7 +139,8 @@ CASettings::~CASettings()
 }
 
 /*!
-	Writes the stored settings to a config file.
+	Writes the stored settings to a config file and emits settingsChanged(), so the views
+	can refresh the settings they keep for painting.
 */
 void CASettings::writeSettings()
 {
@@ -138,18 +149,22 @@ void CASettings::writeSettings()
     setValue("editor/playinsertednotes", playInsertedNotes());
     setValue("editor/autobar", autoBar());
     setValue("editor/usenotechecker", useNoteChecker());
+    setValue("editor/undomemorylimit", undoMemoryLimit());
     setValue("appearance/showruler", showRuler());
 
     setValue("files/documentsdirectory", documentsDirectory().absolutePath());
     setValue("files/defaultsaveformat", defaultSaveFormat());
     setValue("files/autorecoveryinterval", autoRecoveryInterval());
     setValue("files/maxrecentdocuments", maxRecentDocuments());
+    setValue("files/journaledsave", journaledSave());
 #ifndef SWIGCPP
     writeRecentDocuments();
 
     setValue("appearance/lockscrollplayback", lockScrollPlayback());
     setValue("appearance/animatedscroll", animatedScroll());
     setValue("appearance/antialiasing", antiAliasing());
+    setValue("appearance/lodzoomfactor", lodZoomFactor());
+    setValue("appearance/openglcanvas", openGLCanvas());
     setValue("appearance/backgroundcolor", backgroundColor());
     setValue("appearance/foregroundcolor", foregroundColor());
     setValue("appearance/selectioncolor", selectionColor());
@@ -162,14 +177,24 @@ void CASettings::writeSettings()
     setValue("rtmidi/midiinport", midiInPort());
     setValue("rtmidi/midioutnumdevices", midiOutNumDevices());
     setValue("rtmidi/midiinnumdevices", midiInNumDevices());
+    QVariantMap latencies;
+    for (QMap<QString, int>::const_iterator i = _midiOutLatencies.constBegin(); i != _midiOutLatencies.constEnd(); i++) {
+        latencies[i.key()] = i.value();
+    }
+    setValue("rtmidi/midioutlatencies", latencies);
+    setValue("midi/quantizegrid", midiQuantizeGrid());
+    setValue("midi/quantizetriplets", midiQuantizeTriplets());
+    setValue("midi/soundfont", soundFont());
 
     setValue("printing/typesetter", typesetter());
     setValue("printing/typesetterlocation", typesetterLocation());
     setValue("printing/usesystemdefaulttypesetter", useSystemDefaultTypesetter());
+    setValue("printing/typesetterjobs", typesetterJobs());
     setValue("printing/pdfviewerlocation", pdfViewerLocation());
     setValue("printing/usesystemdefaultpdfviewer", useSystemDefaultPdfViewer());
 
     sync();
+    emit settingsChanged();
 }
 
 /*!
@@ -210,6 +235,11 @@ int CASettings::readSettings()
     else
         setUseNoteChecker(DEFAULT_USE_NOTE_CHECKER);
 
+    if (contains("editor/undomemorylimit"))
+        setUndoMemoryLimit(value("editor/undomemorylimit").toInt());
+    else
+        setUndoMemoryLimit(DEFAULT_UNDO_MEMORY_LIMIT);
+
     // Saving/Loading settings
     if (contains("files/documentsdirectory"))
         setDocumentsDirectory(value("files/documentsdirectory").toString());
@@ -232,6 +262,11 @@ int CASettings::readSettings()
     else
         setMaxRecentDocuments(DEFAULT_MAX_RECENT_DOCUMENTS);
 
+    if (contains("files/journaledsave"))
+        setJournaledSave(value("files/journaledsave").toBool());
+    else
+        setJournaledSave(DEFAULT_JOURNALED_SAVE);
+
 #ifndef SWIGCPP
     readRecentDocuments();
 
@@ -251,6 +286,16 @@ int CASettings::readSettings()
     else
         setAntiAliasing(DEFAULT_ANTIALIASING);
 
+    if (contains("appearance/lodzoomfactor"))
+        setLodZoomFactor(value("appearance/lodzoomfactor").toDouble());
+    else
+        setLodZoomFactor(DEFAULT_LOD_ZOOM_FACTOR);
+
+    if (contains("appearance/openglcanvas"))
+        setOpenGLCanvas(value("appearance/openglcanvas").toBool());
+    else
+        setOpenGLCanvas(DEFAULT_OPENGL_CANVAS);
+
     if (contains("appearance/backgroundcolor"))
         setBackgroundColor(value("appearance/backgroundcolor").value<QColor>());
     else
@@ -337,6 +382,27 @@ int CASettings::readSettings()
         settingsPage = -1;
     }
 
+    _midiOutLatencies.clear();
+    QVariantMap latencies = value("rtmidi/midioutlatencies").toMap();
+    for (QVariantMap::const_iterator i = latencies.constBegin(); i != latencies.constEnd(); i++) {
+        setMidiOutLatency(i.key(), i.value().toInt());
+    }
+
+    if (contains("midi/quantizegrid"))
+        setMidiQuantizeGrid(static_cast<CAPlayableLength::CAMusicLength>(value("midi/quantizegrid").toInt()));
+    else
+        setMidiQuantizeGrid(DEFAULT_MIDI_QUANTIZE_GRID);
+
+    if (contains("midi/quantizetriplets"))
+        setMidiQuantizeTriplets(value("midi/quantizetriplets").toBool());
+    else
+        setMidiQuantizeTriplets(DEFAULT_MIDI_QUANTIZE_TRIPLETS);
+
+    if (contains("midi/soundfont"))
+        setSoundFont(value("midi/soundfont").toString());
+    else
+        setSoundFont(DEFAULT_SOUND_FONT);
+
     // Printing settings
     if (contains("printing/typesetter"))
         setTypesetter(static_cast<CATypesetter::CATypesetterType>(value("printing/typesetter").toInt()));
@@ -353,6 +419,11 @@ int CASettings::readSettings()
     else
         setUseSystemDefaultTypesetter(DEFAULT_USE_SYSTEM_TYPESETTER);
 
+    if (contains("printing/typesetterjobs"))
+        setTypesetterJobs(value("printing/typesetterjobs").toInt());
+    else
+        setTypesetterJobs(DEFAULT_TYPESETTER_JOBS);
+
     if (contains("printing/pdfviewerlocation"))
         setPdfViewerLocation(value("printing/pdfviewerlocation").toString());
     else
@@ -392,29 +463,73 @@ void CASettings::setMidiInPort(int in)
 int CASettings::getSingleAction(const QString& oCommandName, QAction*& poResAction)
 {
     CASingleAction* poEntryAction;
-    for (int i = 0; i < _oActionList.count(); i++) {
-        poEntryAction = _oActionList[i];
-        if (poEntryAction->getCommandName() == oCommandName) {
-            poResAction = poEntryAction->getAction();
-            return i;
-        }
-    }
-    poResAction = _poEmptyEntry->getAction();
-    return -1;
+    int iPos = getSingleAction(oCommandName, poEntryAction);
+    poResAction = poEntryAction->getAction();
+    return iPos;
 }
 
 int CASettings::getSingleAction(const QString& oCommandName, CASingleAction*& poResAction)
 {
-    CASingleAction* poEntryAction;
-    for (int i = 0; i < _oActionList.count(); i++) {
-        poEntryAction = _oActionList[i];
-        if (poEntryAction->getCommandName() == oCommandName) {
-            poResAction = poEntryAction;
-            return i;
-        }
+    updateActionIndex();
+    int iPos = _oCommandNameIndex.value(oCommandName, -1);
+    poResAction = (iPos >= 0) ? _oActionList[iPos] : _poEmptyEntry;
+    return iPos;
+}
+
+/*!
+  Returns the actions bound to the given shortcut in the order of the action list.
+  More than one action is returned when the shortcuts conflict.
+*/
+QList<CASingleAction*> CASettings::findActionsByShortCut(const QString& oShortCut)
+{
+    QList<CASingleAction*> oResList;
+    updateActionIndex();
+    for (int iPos : _oShortCutIndex.values(oShortCut)) {
+        oResList << _oActionList[iPos];
+    }
+    return oResList;
+}
+
+/*!
+  Returns the actions bound to the given midi key sequence in the order of the action list.
+*/
+QList<CASingleAction*> CASettings::findActionsByMidiKeySequence(const QString& oMidiKeySequence)
+{
+    QList<CASingleAction*> oResList;
+    updateActionIndex();
+    for (int iPos : _oMidiKeySequenceIndex.values(oMidiKeySequence)) {
+        oResList << _oActionList[iPos];
+    }
+    return oResList;
+}
+
+/*!
+  Rebuilds the command name, shortcut and midi key sequence indexes of the action list.
+  The actions can be changed directly, so the indexes are rebuilt whenever any key of any
+  action changed since the last build (see CASingleAction::keyRevision()) or the list itself
+  was changed.
+*/
+void CASettings::updateActionIndex()
+{
+    if (_iActionIndexRevision == CASingleAction::keyRevision())
+        return;
+
+    _oCommandNameIndex.clear();
+    _oShortCutIndex.clear();
+    _oMidiKeySequenceIndex.clear();
+    _oCommandNameIndex.reserve(_oActionList.count());
+
+    // QMultiHash::values() returns the most recently inserted values first
+    for (int i = _oActionList.count() - 1; i >= 0; i--) {
+        CASingleAction* poEntryAction = _oActionList[i];
+        _oCommandNameIndex.insert(poEntryAction->getCommandName(), i);
+        if (!poEntryAction->getShortCutAsString().isEmpty())
+            _oShortCutIndex.insert(poEntryAction->getShortCutAsString(), i);
+        if (!poEntryAction->getMidiKeySequence().isEmpty())
+            _oMidiKeySequenceIndex.insert(poEntryAction->getMidiKeySequence(), i);
     }
-    poResAction = _poEmptyEntry;
-    return -1;
+
+    _iActionIndexRevision = CASingleAction::keyRevision();
 }
 
 /*!
@@ -453,6 +568,7 @@ void CASettings::setActionList(QList<CASingleAction*>& oActionList)
 #else
     _oActionList = oActionList;
 #endif
+    _iActionIndexRevision = -1;
 }
 
 /*!
@@ -480,6 +596,7 @@ void CASettings::addSingleAction(CASingleAction& oSingleAction)
 #else
     _oActionList.append(&oSingleAction);
 #endif
+    _iActionIndexRevision = -1;
     qWarning() << "New size is " << _oActionList.size() << endl;
 }
 
@@ -495,6 +612,7 @@ bool CASettings::deleteSingleAction(QString oCommand, CASingleAction*& poResActi
     if (iPos >= 0) // Double entries should not be in the list
     {
         _oActionList.removeOne(poResAction);
+        _iActionIndexRevision = -1;
         bRet = true;
     }
 #ifdef COPY_ACTIONLIST_ELEMS_MANUALLY
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2007-2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -16,7 +16,10 @@
 #endif
 #include "core/fileformats.h"
 #include "core/typesetter.h"
+#include "score/playablelength.h"
 #include <QDir>
+#include <QHash>
+#include <QMap>
 
 class CASettings : public QSettings {
 #ifndef SWIG
@@ -51,6 +54,9 @@ public:
     inline bool useNoteChecker() { return _useNoteChecker; }
     inline void setUseNoteChecker(bool b) { _useNoteChecker = b; }
     static const bool DEFAULT_USE_NOTE_CHECKER;
+    inline int undoMemoryLimit() { return _undoMemoryLimit; }
+    inline void setUndoMemoryLimit(int limit) { _undoMemoryLimit = limit; }
+    static const int DEFAULT_UNDO_MEMORY_LIMIT;
 
     /////////////////////////////
     // Loading/Saving settings //
@@ -67,6 +73,9 @@ public:
     inline int maxRecentDocuments() { return _maxRecentDocuments; }
     inline void setMaxRecentDocuments(int r) { _maxRecentDocuments = r; }
     static const int DEFAULT_MAX_RECENT_DOCUMENTS;
+    inline bool journaledSave() { return _journaledSave; }
+    inline void setJournaledSave(bool j) { _journaledSave = j; }
+    static const bool DEFAULT_JOURNALED_SAVE;
 
     /////////////////////////
     // Appearance settings //
@@ -84,6 +93,12 @@ public:
     inline bool antiAliasing() { return _antiAliasing; }
     inline void setAntiAliasing(bool a) { _antiAliasing = a; }
     static const bool DEFAULT_ANTIALIASING;
+    inline double lodZoomFactor() { return _lodZoomFactor; }
+    inline void setLodZoomFactor(double f) { _lodZoomFactor = f; }
+    static const double DEFAULT_LOD_ZOOM_FACTOR;
+    inline bool openGLCanvas() { return _openGLCanvas; }
+    inline void setOpenGLCanvas(bool gl) { _openGLCanvas = gl; }
+    static const bool DEFAULT_OPENGL_CANVAS;
     inline bool showRuler() { return _showRuler; }
     inline void setShowRuler(bool b) { _showRuler = b; }
     static const bool DEFAULT_SHOW_RULER;
@@ -125,6 +140,18 @@ public:
     inline int midiOutNumDevices() { return _midiOutNumDevices; }
     void setMidiOutNumDevices(int outNum) { _midiOutNumDevices = outNum; }
     static const int DEFAULT_MIDI_OUT_NUM_DEVICES;
+    inline int midiOutLatency(const QString& port) { return _midiOutLatencies.value(port, DEFAULT_MIDI_OUT_LATENCY); }
+    inline void setMidiOutLatency(const QString& port, int msecs) { _midiOutLatencies[port] = msecs; }
+    static const int DEFAULT_MIDI_OUT_LATENCY;
+    inline CAPlayableLength::CAMusicLength midiQuantizeGrid() { return _midiQuantizeGrid; }
+    inline void setMidiQuantizeGrid(CAPlayableLength::CAMusicLength grid) { _midiQuantizeGrid = grid; }
+    static const CAPlayableLength::CAMusicLength DEFAULT_MIDI_QUANTIZE_GRID;
+    inline bool midiQuantizeTriplets() { return _midiQuantizeTriplets; }
+    inline void setMidiQuantizeTriplets(bool triplets) { _midiQuantizeTriplets = triplets; }
+    static const bool DEFAULT_MIDI_QUANTIZE_TRIPLETS;
+    inline const QString soundFont() { return _soundFont; }
+    inline void setSoundFont(const QString soundFont) { _soundFont = soundFont; }
+    static const QString DEFAULT_SOUND_FONT;
 
     ///////////////////////
     // Printing settings //
@@ -138,6 +165,9 @@ public:
     inline bool useSystemDefaultTypesetter() { return _useSystemDefaultTypesetter; }
     void setUseSystemDefaultTypesetter(bool s) { _useSystemDefaultTypesetter = s; }
     static const bool DEFAULT_USE_SYSTEM_TYPESETTER;
+    inline int typesetterJobs() { return _typesetterJobs; }
+    void setTypesetterJobs(int j) { _typesetterJobs = j; }
+    static const int DEFAULT_TYPESETTER_JOBS;
     inline QString pdfViewerLocation() { return _pdfViewerLocation; }
     void setPdfViewerLocation(QString pl) { _pdfViewerLocation = pl; }
     static const QString DEFAULT_PDF_VIEWER_LOCATION;
@@ -169,6 +199,13 @@ public:
     void setActionList(QList<CASingleAction*>& oActionList);
     void addSingleAction(CASingleAction& oAction);
     bool deleteSingleAction(QString oCommandName, CASingleAction*& poResAction);
+    QList<CASingleAction*> findActionsByShortCut(const QString& oShortCut);
+    QList<CASingleAction*> findActionsByMidiKeySequence(const QString& oMidiKeySequence);
+#endif
+
+#ifndef SWIG
+signals:
+    void settingsChanged();
 #endif
 
 private:
@@ -185,6 +222,7 @@ private:
     bool _playInsertedNotes;
     bool _autoBar;
     bool _useNoteChecker;
+    int _undoMemoryLimit; // memory limit of the undo history of each document in MB, 0 for unlimited
 
     /////////////////////////////
     // Loading/Saving settings //
@@ -193,6 +231,7 @@ private:
     CAFileFormats::CAFileFormatType _defaultSaveFormat;
     int _autoRecoveryInterval; // auto recovery interval in minutes
     int _maxRecentDocuments; // number of stored recently opened files
+    bool _journaledSave; // append the changes to the saved .can file, see CAArchive::appendJournal()
 
     /////////////////////////
     // Appearance settings //
@@ -201,6 +240,8 @@ private:
     bool _lockScrollPlayback;
     bool _animatedScroll;
     bool _antiAliasing;
+    double _lodZoomFactor; // multiplies CADrawable::minLegibleZoom() of the drawables, 0 to always draw the details
+    bool _openGLCanvas; // composite the score view tiles using OpenGL, applied to the newly created views
     bool _showRuler;
     QColor _backgroundColor;
     QColor _foregroundColor;
@@ -216,7 +257,11 @@ private:
     int _midiOutPort; // -1 disabled, 0+ port number
     int _midiInPort; // -1 disabled, 0+ port number
     int _midiOutNumDevices; // last number of MIDI out ports
+    QMap<QString, int> _midiOutLatencies; // output latency in milliseconds by the MIDI out port name
     int _midiInNumDevices; // last number of MIDI in ports
+    CAPlayableLength::CAMusicLength _midiQuantizeGrid; // grid of the imported and recorded notes, Undefined for automatic
+    bool _midiQuantizeTriplets; // detect triplets when quantizing
+    QString _soundFont; // SoundFont file used by the audio export, empty for the built-in tone
 
     ///////////////////////
     // Printing settings //
@@ -224,6 +269,7 @@ private:
     CATypesetter::CATypesetterType _typesetter;
     QString _typesetterLocation;
     bool _useSystemDefaultTypesetter;
+    int _typesetterJobs; // number of typesetter processes run concurrently, 0 for the number of cores
     QString _pdfViewerLocation;
     bool _useSystemDefaultPdfViewer;
 
@@ -253,6 +299,11 @@ private:
 #ifndef SWIG
     QList<CASingleAction*> _oActionList;
     CASingleAction* _poEmptyEntry; // Entry is unused for search function
+    void updateActionIndex();
+    QHash<QString, int> _oCommandNameIndex; // first position of each command name in _oActionList
+    QMultiHash<QString, int> _oShortCutIndex; // positions in _oActionList by shortcut
+    QMultiHash<QString, int> _oMidiKeySequenceIndex; // positions in _oActionList by midi key sequence
+    int _iActionIndexRevision; // CASingleAction::keyRevision() when the indexes were built, -1 if invalid
 #endif
 };
 
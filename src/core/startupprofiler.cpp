@@ -0,0 +1,149 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "core/startupprofiler.h"
+
+#include <cstdio>
+
+const QString CAStartupProfiler::PROFILE_SWITCH = "--profile-startup";
+
+bool CAStartupProfiler::_enabled = false;
+QString CAStartupProfiler::_traceFileName;
+QElapsedTimer CAStartupProfiler::_timer;
+QList<CAStartupProfiler::CAStartupPhase> CAStartupProfiler::_phases;
+
+/*!
+	\class CAStartupProfiler
+	\brief Timing of the application startup phases
+
+	The profiler is enabled by passing --profile-startup in the command line. main() marks the
+	beginning of each initialization step using beginPhase(). Each phase lasts until the next one
+	begins or finish() is called, when the main window is shown and the event loop is entered.
+
+	The breakdown of the phases is printed to the standard output. If a file name is given as
+	--profile-startup=<file>, the phases are also written in Chrome trace event format, which can
+	be opened in chrome://tracing or Perfetto.
+
+	When the profiler is not enabled, all the functions return immediately.
+*/
+
+/*!
+	Enables the profiler, if the profiling switch is found in the command line arguments.
+	This should be called first in main() so the timer starts as early as possible.
+
+	Returns True, if the profiler was enabled.
+*/
+bool CAStartupProfiler::parseArguments(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        QString arg(argv[i]);
+        if (arg == PROFILE_SWITCH || arg.startsWith(PROFILE_SWITCH + "=")) {
+            _enabled = true;
+            _traceFileName = arg.mid(PROFILE_SWITCH.size() + 1);
+        }
+    }
+
+    if (_enabled) {
+        _timer.start();
+    }
+
+    return _enabled;
+}
+
+/*!
+	Ends the current phase and starts a new one with the given \a name.
+*/
+void CAStartupProfiler::beginPhase(const QString& name)
+{
+    if (!_enabled)
+        return;
+
+    endPhase();
+
+    CAStartupPhase phase;
+    phase.name = name;
+    phase.start = _timer.nsecsElapsed();
+    phase.end = -1;
+    _phases << phase;
+}
+
+void CAStartupProfiler::endPhase()
+{
+    if (!_phases.isEmpty() && _phases.last().end == -1) {
+        _phases.last().end = _timer.nsecsElapsed();
+    }
+}
+
+/*!
+	Ends the last phase, prints the startup breakdown and writes the trace file, if requested.
+	Further calls are ignored.
+*/
+void CAStartupProfiler::finish()
+{
+    if (!_enabled)
+        return;
+
+    endPhase();
+    printReport();
+    if (!_traceFileName.isEmpty() && !writeTrace(_traceFileName)) {
+        fprintf(stderr, "Cannot write the startup trace to %s\n", qPrintable(_traceFileName));
+    }
+
+    _enabled = false;
+}
+
+void CAStartupProfiler::printReport()
+{
+    int width = 0;
+    for (const CAStartupPhase& phase : _phases) {
+        width = qMax(width, phase.name.size());
+    }
+
+    fprintf(stdout, "Startup profile:\n");
+    for (const CAStartupPhase& phase : _phases) {
+        fprintf(stdout, "  %-*s %10.2f ms\n", width, qPrintable(phase.name), (phase.end - phase.start) / 1e6);
+    }
+    fprintf(stdout, "  %-*s %10.2f ms\n", width, "Total", (_phases.isEmpty() ? 0 : _phases.last().end) / 1e6);
+    fflush(stdout);
+}
+
+/*!
+	Writes the phases as complete events ("ph": "X") of Chrome trace event format to \a fileName.
+	Returns True on success, otherwise False.
+*/
+bool CAStartupProfiler::writeTrace(const QString& fileName)
+{
+    QJsonArray events;
+    for (const CAStartupPhase& phase : _phases) {
+        QJsonObject event;
+        event["name"] = phase.name;
+        event["cat"] = "startup";
+        event["ph"] = "X";
+        event["ts"] = phase.start / 1000.0;
+        event["dur"] = (phase.end - phase.start) / 1000.0;
+        event["pid"] = static_cast<double>(QCoreApplication::applicationPid());
+        event["tid"] = 0;
+        events << event;
+    }
+
+    QJsonObject trace;
+    trace["traceEvents"] = events;
+    trace["displayTimeUnit"] = "ms";
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    return (file.write(QJsonDocument(trace).toJson()) != -1);
+}
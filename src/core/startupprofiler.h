@@ -0,0 +1,42 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef STARTUPPROFILER_H_
+#define STARTUPPROFILER_H_
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+
+class CAStartupProfiler {
+public:
+    static bool parseArguments(int argc, char* argv[]);
+    inline static bool isEnabled() { return _enabled; }
+
+    static void beginPhase(const QString& name);
+    static void finish();
+
+    static const QString PROFILE_SWITCH;
+
+private:
+    struct CAStartupPhase {
+        QString name;
+        qint64 start; // ns since the profiler was started
+        qint64 end;
+    };
+
+    static void endPhase();
+    static void printReport();
+    static bool writeTrace(const QString& fileName);
+
+    static bool _enabled;
+    static QString _traceFileName;
+    static QElapsedTimer _timer;
+    static QList<CAStartupPhase> _phases;
+};
+
+#endif /* STARTUPPROFILER_H_ */
@@ -13,6 +13,7 @@
 
 #include <QDebug>
 #include <cmath> // pow()
+#include <limits>
 
 #include "core/tar.h"
 
@@ -34,6 +35,7 @@ const int CATar::CHUNK = 16384;
 */
 CATar::CATar()
     : _ok(true)
+    , _map(nullptr)
 {
     /* An empty file is a valid tar */
 }
@@ -51,9 +53,13 @@ CATar::~CATar()
 
 /*!
 	Parse the given tar file and allow reading from it.
+
+	If \a data is a file, it is mapped to memory and the entries are read directly from it.
+	The file must not be closed or destroyed before this object then.
 */
 CATar::CATar(QIODevice& data)
     : _ok(true)
+    , _map(nullptr)
 {
     parse(data);
 }
@@ -63,6 +69,9 @@ CATar::CATar(QIODevice& data)
 
 	Parsing stops when a parsing errors occurs. The files that were parsed until the error will be available.
 	error() can tell whether an error ocurred.
+
+	If the tar is an open file, only the offsets of the entries are indexed and the entries are
+	served as buffers over the memory mapped file. Otherwise each entry is copied to a temporary file.
 */
 void CATar::parse(QIODevice& tar)
 {
@@ -74,6 +83,11 @@ void CATar::parse(QIODevice& tar)
         wasOpen = false;
     }
 
+    QFile* source = qobject_cast<QFile*>(&tar);
+    if (wasOpen && source && source->size() > 0) {
+        _map = source->map(0, source->size());
+    }
+
     while (!tar.atEnd()) {
         QByteArray hdrba = tar.read(512);
         CATarFile* file;
@@ -135,17 +149,39 @@ void CATar::parse(QIODevice& tar)
             continue;
         }
 
-        tempfile = new QTemporaryFile;
-        tempfile->open();
-        file->data = tempfile;
-        for (unsigned int i = 0; i < file->hdr.size / CHUNK; i++)
-            file->data->write(tar.read(CHUNK));
-        file->data->write(tar.read(file->hdr.size % CHUNK));
-        file->data->flush();
         pad = file->hdr.size % 512;
-        if (pad > 0)
-            tar.read(512 - pad);
+        if (_map && file->hdr.size <= static_cast<quint64>(std::numeric_limits<int>::max())) {
+            // serve the entry from the mapped archive and skip it
+            qint64 offset = tar.pos();
+            if (offset + static_cast<qint64>(file->hdr.size) > source->size()) {
+                delete file;
+                _ok = false;
+                break;
+            }
+            QBuffer* buffer = new QBuffer;
+            buffer->setData(QByteArray::fromRawData(reinterpret_cast<const char*>(_map + offset), static_cast<int>(file->hdr.size)));
+            buffer->open(QIODevice::ReadOnly);
+            file->data = buffer;
+            tar.seek(offset + static_cast<qint64>(file->hdr.size) + (pad > 0 ? 512 - pad : 0));
+        } else {
+            tempfile = new QTemporaryFile;
+            tempfile->open();
+            file->data = tempfile;
+            for (unsigned int i = 0; i < file->hdr.size / CHUNK; i++)
+                file->data->write(tar.read(CHUNK));
+            file->data->write(tar.read(file->hdr.size % CHUNK));
+            file->data->flush();
+            if (pad > 0)
+                tar.read(512 - pad);
+        }
+
+        // the later entry of the same name wins, as when extracting the archive
+        QString name = QString::fromUtf8(file->hdr.name);
+        if (_index.contains(name)) {
+            removeEntry(_index[name]);
+        }
         _files << file;
+        _index[name] = file;
     }
     if (!wasOpen)
         tar.close();
@@ -154,14 +190,24 @@ void CATar::parse(QIODevice& tar)
 /** 
 	Returns true if the tar contains a file with the given filename. Otherwise false
 	filename may be a relative path.
+
+	The files are looked up by their names in constant time.
 */
 bool CATar::contains(const QString& filename)
 {
+    return _index.contains(filename);
+}
+
+/*!
+	Returns the names of all the files in the archive.
+*/
+QStringList CATar::fileNames()
+{
+    QStringList names;
     for (CATarFile* t : _files) {
-        if (filename == t->hdr.name)
-            return true;
+        names << QString::fromUtf8(t->hdr.name);
     }
-    return false;
+    return names;
 }
 
 /*!
@@ -220,6 +266,7 @@ bool CATar::addFile(const QString& filename, QIODevice& data, bool replace /* =
     if (!wasOpen)
         data.close();
     _files << file;
+    _index[QString::fromUtf8(file->hdr.name)] = file;
     return true;
 }
 
@@ -237,33 +284,50 @@ bool CATar::addFile(const QString& filename, QByteArray data, bool replace)
 */
 void CATar::removeFile(const QString& filename)
 {
-    for (CATarFile* t : _files) {
-        if (filename == t->hdr.name) {
-            delete t;
-            _files.removeAll(t);
-        }
+    CATarFile* file = _index.value(filename);
+    if (file) {
+        removeEntry(file);
     }
 }
 
+/*!
+	Removes the entry \a file from the archive and its index and deletes it.
+*/
+void CATar::removeEntry(CATarFile* file)
+{
+    _index.remove(QString::fromUtf8(file->hdr.name));
+    _files.removeOne(file);
+    delete file->data;
+    delete file;
+}
+
 /*!
 	Returns a reader for a file in the tar.	
 	If the file is not found, an empty buffer is returned.
 	The function returns a smart (auto) pointer to a QIODevice.
 
+	Entries of a parsed archive are returned as read-only buffers over the mapped archive, so
+	nothing is read until the returned device is.
+
 	\param filename	The file name (including its path if needed).
 */
 CAIOPtr CATar::file(const QString& filename)
 {
-    if (_files.isEmpty())
+    CATarFile* t = _index.value(filename);
+    if (!t)
         return CAIOPtr(new QBuffer());
-    for (CATarFile* t : _files) {
-        if (filename == t->hdr.name) {
-            QFile* f = new QFile(t->data->fileName());
-            f->open(QIODevice::ReadWrite);
-            return CAIOPtr(f);
-        }
+
+    QFile* data = qobject_cast<QFile*>(t->data);
+    if (data) {
+        QFile* f = new QFile(data->fileName());
+        f->open(QIODevice::ReadWrite);
+        return CAIOPtr(f);
     }
-    return CAIOPtr(new QBuffer());
+
+    QBuffer* b = new QBuffer();
+    b->setData(static_cast<QBuffer*>(t->data)->data()); // shares the mapped data
+    b->open(QIODevice::ReadOnly);
+    return CAIOPtr(b);
 }
 
 /*!
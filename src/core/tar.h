@@ -1,5 +1,5 @@
 /*! 
-	Copyright (c) 2007-2019, Itay Perl, Canorus development team
+	Copyright (c) 2007-2020, Itay Perl, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 	
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -12,6 +12,7 @@
 #include <QFile>
 #include <QHash>
 #include <QString>
+#include <QStringList>
 #include <memory>
 using std::unique_ptr;
 
@@ -27,7 +28,8 @@ public:
     bool addFile(const QString& filename, QIODevice& data, bool replace = true);
     bool addFile(const QString& filename, QByteArray data, bool replace = true);
     void removeFile(const QString& filename);
-    inline bool contains(const QString& filename);
+    bool contains(const QString& filename);
+    QStringList fileNames();
     CAIOPtr file(const QString& filename);
     qint64 write(QIODevice& dest, qint64 chunk);
     qint64 write(QIODevice& dest);
@@ -65,11 +67,14 @@ protected:
     } CATarHeader;
     typedef struct {
         CATarHeader hdr;
-        QFile* data;
+        QIODevice* data; // temporary file or a buffer over the mapped archive
     } CATarFile;
-    QList<CATarFile*> _files;
+    QList<CATarFile*> _files; // in the archive order
+    QHash<QString, CATarFile*> _index; // _files by their names
     void parse(QIODevice& data);
+    void removeEntry(CATarFile* file);
     bool _ok;
+    uchar* _map; // the parsed archive mapped to memory or nullptr, if the entries were copied
     typedef struct {
         qint64 pos;
         qint32 file;
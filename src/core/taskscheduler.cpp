@@ -0,0 +1,388 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QThread>
+
+#include "core/taskscheduler.h"
+#include "core/trace.h"
+
+namespace {
+
+thread_local int workerQueue = 0; // queue of the worker running in this thread, 0 outside the workers
+
+}
+
+/*!
+	Tasks of a single worker or the tasks started outside the workers, one list for each priority.
+*/
+class CATaskQueue {
+public:
+    QMutex mutex;
+    QList<CATask*> tasks[3];
+};
+
+/*!
+	Thread running the tasks of the scheduler. Takes the newest task of its own queue first and
+	steals the oldest tasks of the other queues, when its own queue is empty.
+*/
+class CATaskWorker : public QThread {
+public:
+    CATaskWorker(CATaskScheduler* scheduler, int queue)
+        : _scheduler(scheduler)
+        , _queue(queue)
+    {
+    }
+
+protected:
+    void run()
+    {
+        workerQueue = _queue;
+        for (;;) {
+            bool reserved = false;
+            CATask* task = _scheduler->take(_queue, CATask::Background, &reserved);
+            if (task) {
+                _scheduler->runTask(task, reserved);
+                continue;
+            }
+
+            QMutexLocker locker(&_scheduler->_mutex);
+            if (_scheduler->_quit) {
+                return;
+            }
+            if (!_scheduler->hasWork()) {
+                _scheduler->_workAvailable.wait(&_scheduler->_mutex);
+            }
+        }
+    }
+
+private:
+    CATaskScheduler* _scheduler;
+    int _queue;
+};
+
+/*!
+	\class CATask
+	\brief Unit of work run by CATaskScheduler
+
+	Subclass CATask and implement run(). Start the task by CATaskScheduler::start() and call
+	wait() before reading its results or destroying it. The task is owned by the caller, the
+	scheduler never deletes it.
+
+	Long tasks should check isCanceled() regularly and return early, when it is set. A task
+	canceled before it started is not run at all.
+
+	\sa CATaskScheduler
+*/
+
+CATask::CATask(CATaskPriority priority)
+    : _priority(priority)
+    , _state(Idle)
+    , _canceled(false)
+    , _queue(-1)
+{
+}
+
+/*!
+	Destroys the task. A queued task is canceled. A running task must not be destroyed, wait()
+	for it first.
+*/
+CATask::~CATask()
+{
+    if (_state.load() == Queued) {
+        cancel();
+    }
+}
+
+/*!
+	Cancels the task. A queued task is removed from the scheduler and marked finished, a running
+	task finishes once its run() checks isCanceled().
+*/
+void CATask::cancel()
+{
+    _canceled.store(true, std::memory_order_relaxed);
+
+    CATaskScheduler* scheduler = CATaskScheduler::instance();
+    if (scheduler->unqueue(this)) {
+        QMutexLocker locker(&scheduler->_doneMutex);
+        _state.store(Finished);
+        scheduler->_taskDone.wakeAll();
+    }
+}
+
+/*!
+	Returns True, if the task isn't queued or running.
+*/
+bool CATask::isFinished()
+{
+    int state = _state.load();
+    return state != Queued && state != Running;
+}
+
+/*!
+	Blocks until the task is finished. A task which hasn't been taken by a worker yet is run
+	immediately in the calling thread, so waiting for an interactive task never waits for the
+	background work occupying the workers.
+
+	When called from a task, the worker runs the other queued tasks of the same or higher priority
+	meanwhile, so tasks waiting for their subtasks don't block all the workers.
+*/
+void CATask::wait()
+{
+    if (isFinished()) {
+        return;
+    }
+
+    CATaskScheduler* scheduler = CATaskScheduler::instance();
+    if (scheduler->unqueue(this)) {
+        scheduler->runTask(this, false);
+        return;
+    }
+
+    int queue = scheduler->currentQueue();
+    if (queue > 0) {
+        while (!isFinished()) {
+            bool reserved = false;
+            CATask* task = scheduler->take(queue, _priority, &reserved);
+            if (!task) {
+                break;
+            }
+            scheduler->runTask(task, reserved);
+        }
+    }
+
+    QMutexLocker locker(&scheduler->_doneMutex);
+    while (_state.load() != Finished) {
+        scheduler->_taskDone.wait(&scheduler->_doneMutex);
+    }
+}
+
+/*!
+	\class CATaskScheduler
+	\brief Application-wide work-stealing pool of worker threads
+
+	CATaskScheduler runs CATask instances on a fixed number of worker threads shared by the whole
+	application, instead of each subsystem creating its own threads.
+
+	Each worker has its own queue. Tasks started by a running task are put to the queue of its
+	worker and taken from its back, so the related work stays on the same thread. The tasks
+	started from the other threads are put to a shared queue. An idle worker steals the oldest
+	tasks of the shared queue and of the other workers.
+
+	The interactive tasks are always taken before the normal ones and the normal before the
+	background ones. The background tasks never occupy all the workers at once, so an interactive
+	task started meanwhile gets a worker as soon as possible:
+	\code
+	  CAMyTask task(CATask::Interactive); // inherits CATask
+	  CATaskScheduler::instance()->start(&task);
+	  task.wait(); // runs the task right away, if no worker took it yet
+	\endcode
+
+	The scheduler is available to the plugins as well.
+*/
+
+/*!
+	Returns the application scheduler. The workers are started on the first call.
+*/
+CATaskScheduler* CATaskScheduler::instance()
+{
+    static CATaskScheduler scheduler(qMax(2, QThread::idealThreadCount()));
+    return &scheduler;
+}
+
+CATaskScheduler::CATaskScheduler(int workers)
+    : _runningBackground(0)
+    , _maxBackground(qMax(1, workers - 1))
+    , _quit(false)
+{
+    for (int i = 0; i < 3; i++) {
+        _queued[i].store(0);
+    }
+
+    for (int i = 0; i <= workers; i++) {
+        _queues.emplace_back(new CATaskQueue());
+    }
+
+    for (int i = 0; i < workers; i++) {
+        _workers.emplace_back(new CATaskWorker(this, i + 1));
+        _workers.back()->start();
+    }
+}
+
+/*!
+	Stops the workers. The tasks still queued are not run.
+*/
+CATaskScheduler::~CATaskScheduler()
+{
+    _mutex.lock();
+    _quit = true;
+    _workAvailable.wakeAll();
+    _mutex.unlock();
+
+    for (const std::unique_ptr<CATaskWorker>& worker : _workers) {
+        worker->wait();
+    }
+}
+
+/*!
+	Queues the \a task to be run by a worker. The task must not be queued or running already.
+*/
+void CATaskScheduler::start(CATask* task)
+{
+    if (!task->isFinished()) {
+        qWarning("CATaskScheduler: the task was started already");
+        return;
+    }
+
+    task->_canceled.store(false, std::memory_order_relaxed);
+    task->_state.store(CATask::Queued);
+    _queued[task->priority()]++;
+
+    CATaskQueue* queue = _queues[currentQueue()].get();
+    queue->mutex.lock();
+    task->_queue.store(currentQueue());
+    queue->tasks[task->priority()] << task;
+    queue->mutex.unlock();
+
+    QMutexLocker locker(&_mutex);
+    _workAvailable.wakeOne();
+}
+
+/*!
+	Blocks until all the \a tasks are finished.
+
+	\sa CATask::wait()
+*/
+void CATaskScheduler::wait(const QList<CATask*>& tasks)
+{
+    for (CATask* task : tasks) {
+        task->wait();
+    }
+}
+
+/*!
+	Returns the number of the tasks waiting for a worker.
+*/
+int CATaskScheduler::queuedCount()
+{
+    return _queued[CATask::Interactive].load() + _queued[CATask::Normal].load() + _queued[CATask::Background].load();
+}
+
+/*!
+	Takes the most important task of priority \a lowest or higher for the thread owning the
+	\a queue. The newest task of its own queue is taken first, then the oldest task of the shared
+	queue and of the other workers.
+
+	A worker taking a background task reserves a background slot, which sets \a reserved. The slot
+	is released by runTask().
+*/
+CATask* CATaskScheduler::take(int queue, CATask::CATaskPriority lowest, bool* reserved)
+{
+    for (int p = CATask::Interactive; p <= lowest; p++) {
+        if (_queued[p].load() <= 0) {
+            continue;
+        }
+
+        *reserved = false;
+        if (p == CATask::Background && queue > 0) {
+            int running = _runningBackground.load();
+            do {
+                if (running >= _maxBackground) {
+                    break;
+                }
+            } while (!_runningBackground.compare_exchange_weak(running, running + 1));
+            if (running >= _maxBackground) {
+                continue;
+            }
+            *reserved = true;
+        }
+
+        int queues = static_cast<int>(_queues.size());
+        for (int i = 0; i < queues; i++) {
+            int q = (queue + i) % queues; // own queue first, then the others
+            CATaskQueue* taskQueue = _queues[q].get();
+            QMutexLocker locker(&taskQueue->mutex);
+            if (taskQueue->tasks[p].isEmpty()) {
+                continue;
+            }
+
+            CATask* task = (q == queue ? taskQueue->tasks[p].takeLast() : taskQueue->tasks[p].takeFirst());
+            task->_queue.store(-1);
+            _queued[p]--;
+            return task;
+        }
+
+        if (*reserved) {
+            _runningBackground--;
+            *reserved = false;
+        }
+    }
+
+    return nullptr;
+}
+
+/*!
+	Removes the queued \a task from its queue. Returns False, if the task isn't queued anymore.
+*/
+bool CATaskScheduler::unqueue(CATask* task)
+{
+    int q = task->_queue.load();
+    if (q < 0) {
+        return false;
+    }
+
+    CATaskQueue* queue = _queues[q].get();
+    QMutexLocker locker(&queue->mutex);
+    if (!queue->tasks[task->priority()].removeOne(task)) {
+        return false;
+    }
+
+    task->_queue.store(-1);
+    _queued[task->priority()]--;
+    return true;
+}
+
+/*!
+	Runs the \a task taken from a queue in the current thread and marks it finished. Releases the
+	background slot, if \a reserved.
+*/
+void CATaskScheduler::runTask(CATask* task, bool reserved)
+{
+    task->_state.store(CATask::Running);
+    if (!task->isCanceled()) {
+        CA_TRACE_ZONE("CATask");
+        task->run();
+    }
+
+    if (reserved) {
+        _runningBackground--;
+        QMutexLocker locker(&_mutex);
+        _workAvailable.wakeOne(); // another background task may be waiting for the slot
+    }
+
+    // the task may be destroyed by its owner as soon as it is finished
+    QMutexLocker locker(&_doneMutex);
+    task->_state.store(CATask::Finished);
+    _taskDone.wakeAll();
+}
+
+/*!
+	Returns True, if an idle worker can take any of the queued tasks. Called with _mutex locked.
+*/
+bool CATaskScheduler::hasWork()
+{
+    return _queued[CATask::Interactive].load() > 0 || _queued[CATask::Normal].load() > 0
+        || (_queued[CATask::Background].load() > 0 && _runningBackground.load() < _maxBackground);
+}
+
+/*!
+	Returns the queue of the worker running in the current thread or 0, the shared queue, when
+	called outside the workers.
+*/
+int CATaskScheduler::currentQueue()
+{
+    return workerQueue;
+}
@@ -0,0 +1,102 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef TASKSCHEDULER_H_
+#define TASKSCHEDULER_H_
+
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class CATaskWorker;
+class CATaskQueue;
+
+class CATask {
+public:
+    enum CATaskPriority {
+        Interactive, // the user waits for the result, eg. layout or note checking after an edit
+        Normal, // import, export
+        Background // autosave and other work nobody waits for
+    };
+
+    CATask(CATaskPriority priority = Normal);
+    virtual ~CATask();
+
+    virtual void run() = 0;
+
+    inline CATaskPriority priority() { return _priority; }
+    inline void setPriority(CATaskPriority priority) { _priority = priority; }
+
+    void cancel();
+    inline bool isCanceled() { return _canceled.load(std::memory_order_relaxed); }
+    bool isFinished();
+    void wait();
+
+#ifndef SWIG
+private:
+    friend class CATaskScheduler;
+    enum CATaskState {
+        Idle,
+        Queued,
+        Running,
+        Finished
+    };
+
+    CATask(const CATask&);
+    CATask& operator=(const CATask&);
+
+    CATaskPriority _priority;
+    std::atomic<int> _state;
+    std::atomic<bool> _canceled;
+    std::atomic<int> _queue; // index of the queue holding the task while queued
+#endif
+};
+
+class CATaskScheduler {
+public:
+    static CATaskScheduler* instance();
+    ~CATaskScheduler();
+
+    void start(CATask* task);
+    void wait(const QList<CATask*>& tasks);
+
+    inline int workerCount() { return static_cast<int>(_workers.size()); }
+    int queuedCount();
+
+#ifndef SWIG
+private:
+    friend class CATask;
+    friend class CATaskWorker;
+
+    CATaskScheduler(int workers);
+
+    CATask* take(int queue, CATask::CATaskPriority lowest, bool* reserved);
+    bool unqueue(CATask* task);
+    void runTask(CATask* task, bool reserved);
+    bool hasWork();
+    int currentQueue();
+
+    std::vector<std::unique_ptr<CATaskQueue>> _queues; // 0 for the tasks started outside the workers, then a queue of each worker
+    std::vector<std::unique_ptr<CATaskWorker>> _workers;
+    std::atomic<int> _queued[3]; // number of the queued tasks of each priority
+    std::atomic<int> _runningBackground; // background tasks run by the workers
+    int _maxBackground; // workers allowed to run background tasks at once
+
+    QMutex _mutex; // guards sleeping of the idle workers
+    QWaitCondition _workAvailable;
+    bool _quit;
+
+    QMutex _doneMutex; // guards the finished state of all the tasks
+    QWaitCondition _taskDone;
+#endif
+};
+
+#endif /* TASKSCHEDULER_H_ */
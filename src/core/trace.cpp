@@ -0,0 +1,254 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+#include "core/trace.h"
+
+#include <chrono>
+#include <memory>
+
+const int CATrace::BUFFER_SIZE = 4096;
+
+std::atomic<bool> CATrace::_enabled(true);
+
+namespace {
+
+struct CATraceEvent {
+    std::atomic<quint64> seq; // number of the event in the buffer plus one, 0 while being written
+    std::atomic<const char*> name;
+    std::atomic<qint64> start;
+    std::atomic<qint64> end;
+    std::atomic<int> thread;
+};
+
+const std::chrono::steady_clock::time_point traceEpoch = std::chrono::steady_clock::now();
+
+}
+
+/*!
+	\class CATraceBuffer
+	\brief Ring buffer of the trace events recorded by a single thread
+
+	Only the owning thread writes to the buffer, so recording doesn't need any locks. Each event is
+	published with its sequence number, which is used by CATrace::writeChromeTrace() to skip the
+	events being overwritten while the buffer is read.
+
+	Buffers of the finished threads are reused by the new ones and keep their events until they
+	are overwritten.
+*/
+class CATraceBuffer {
+public:
+    CATraceBuffer()
+        : events(new CATraceEvent[CATrace::BUFFER_SIZE])
+        , head(0)
+        , thread(0)
+    {
+        for (int i = 0; i < CATrace::BUFFER_SIZE; i++) {
+            events[i].seq.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::unique_ptr<CATraceEvent[]> events;
+    std::atomic<quint64> head; // number of all events written to the buffer
+    int thread; // id of the thread currently writing to the buffer
+};
+
+namespace {
+
+struct CATraceRegistry {
+    QMutex mutex;
+    QList<CATraceBuffer*> buffers;
+    QList<CATraceBuffer*> freeBuffers;
+    QHash<int, QString> threadNames;
+    int nextThread = 1;
+};
+
+CATraceRegistry& traceRegistry()
+{
+    static CATraceRegistry registry;
+    return registry;
+}
+
+// Returns the buffer to the registry when the thread finishes
+struct CATraceThread {
+    CATraceBuffer* buffer = nullptr;
+
+    ~CATraceThread()
+    {
+        if (buffer) {
+            CATraceRegistry& registry = traceRegistry();
+            QMutexLocker locker(&registry.mutex);
+            registry.freeBuffers << buffer;
+        }
+    }
+};
+
+thread_local CATraceThread traceThread;
+
+}
+
+/*!
+	\class CATrace
+	\brief Low overhead tracing of the hot paths
+
+	Code paths are measured by placing a CATraceZone object (usually using the CA_TRACE_ZONE() macro)
+	at the beginning of the scope:
+	\code
+	  void CAScoreView::paintEvent(QPaintEvent*)
+	  {
+	      CA_TRACE_ZONE("CAScoreView::paintEvent");
+	      ...
+	  }
+	\endcode
+
+	The zone records its name, start and end time into the ring buffer of the current thread when it
+	goes out of scope. Only the last BUFFER_SIZE zones of each thread are kept. The zone names must be
+	string literals or other strings which outlive the trace.
+
+	The recorded zones of all the threads can be written in Chrome trace event format using
+	writeChromeTrace() and opened in chrome://tracing or Perfetto. The trace is saved from the Help
+	menu or by the "/trace <file>" command in the Python console and can be attached to bug reports.
+
+	Tracing is enabled by default. When disabled, zones only check the flag.
+*/
+
+/*!
+	Returns the current time in nanoseconds since the tracing was started.
+*/
+qint64 CATrace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceEpoch).count();
+}
+
+/*!
+	Returns the trace buffer of the current thread and assigns one on the first call.
+*/
+CATraceBuffer* CATrace::threadBuffer()
+{
+    if (!traceThread.buffer) {
+        CATraceRegistry& registry = traceRegistry();
+        QMutexLocker locker(&registry.mutex);
+        if (registry.freeBuffers.isEmpty()) {
+            registry.buffers << new CATraceBuffer();
+            traceThread.buffer = registry.buffers.last();
+        } else {
+            traceThread.buffer = registry.freeBuffers.takeLast();
+        }
+
+        int thread = registry.nextThread++;
+        QThread* qThread = QThread::currentThread();
+        if (QCoreApplication::instance() && qThread == QCoreApplication::instance()->thread()) {
+            registry.threadNames[thread] = "Main";
+        } else if (qThread && !qThread->objectName().isEmpty()) {
+            registry.threadNames[thread] = qThread->objectName();
+        } else if (qThread) {
+            registry.threadNames[thread] = qThread->metaObject()->className();
+        }
+        traceThread.buffer->thread = thread;
+    }
+
+    return traceThread.buffer;
+}
+
+/*!
+	Stores the zone \a name lasting from \a start to \a end (see now()) into the ring buffer of the
+	current thread.
+*/
+void CATrace::record(const char* name, qint64 start, qint64 end)
+{
+    CATraceBuffer* buffer = threadBuffer();
+    quint64 head = buffer->head.load(std::memory_order_relaxed);
+    CATraceEvent& event = buffer->events[head % BUFFER_SIZE];
+
+    event.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name.store(name, std::memory_order_relaxed);
+    event.start.store(start, std::memory_order_relaxed);
+    event.end.store(end, std::memory_order_relaxed);
+    event.thread.store(buffer->thread, std::memory_order_relaxed);
+    event.seq.store(head + 1, std::memory_order_release);
+
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+/*!
+	Writes the recorded zones of all the threads to \a fileName in Chrome trace event format.
+	Returns True on success, otherwise False.
+*/
+bool CATrace::writeChromeTrace(const QString& fileName)
+{
+    QJsonArray events;
+    double pid = QCoreApplication::applicationPid();
+
+    CATraceRegistry& registry = traceRegistry();
+    QMutexLocker locker(&registry.mutex);
+
+    for (CATraceBuffer* buffer : registry.buffers) {
+        quint64 head = buffer->head.load(std::memory_order_acquire);
+        quint64 first = (head > static_cast<quint64>(BUFFER_SIZE) ? head - BUFFER_SIZE : 0);
+        for (quint64 i = first; i < head; i++) {
+            CATraceEvent& event = buffer->events[i % BUFFER_SIZE];
+            quint64 seq = event.seq.load(std::memory_order_acquire);
+            if (seq != i + 1) {
+                continue;
+            }
+
+            const char* name = event.name.load(std::memory_order_relaxed);
+            qint64 start = event.start.load(std::memory_order_relaxed);
+            qint64 end = event.end.load(std::memory_order_relaxed);
+            int thread = event.thread.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (event.seq.load(std::memory_order_relaxed) != seq) {
+                continue; // overwritten while reading
+            }
+
+            QJsonObject json;
+            json["name"] = QString(name);
+            json["ph"] = "X";
+            json["ts"] = start / 1000.0;
+            json["dur"] = (end - start) / 1000.0;
+            json["pid"] = pid;
+            json["tid"] = thread;
+            events << json;
+        }
+    }
+
+    for (int thread : registry.threadNames.keys()) {
+        QJsonObject args;
+        args["name"] = registry.threadNames[thread];
+
+        QJsonObject json;
+        json["name"] = "thread_name";
+        json["ph"] = "M";
+        json["pid"] = pid;
+        json["tid"] = thread;
+        json["args"] = args;
+        events << json;
+    }
+    locker.unlock();
+
+    QJsonObject trace;
+    trace["traceEvents"] = events;
+    trace["displayTimeUnit"] = "ms";
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    return (file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact)) != -1);
+}
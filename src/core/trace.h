@@ -0,0 +1,60 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <QString>
+
+#include <atomic>
+
+class CATraceBuffer;
+
+class CATrace {
+public:
+    inline static bool isEnabled() { return _enabled.load(std::memory_order_relaxed); }
+    inline static void setEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+
+    static qint64 now();
+    static void record(const char* name, qint64 start, qint64 end);
+    static bool writeChromeTrace(const QString& fileName);
+
+    static const int BUFFER_SIZE;
+
+private:
+    static CATraceBuffer* threadBuffer();
+
+    static std::atomic<bool> _enabled;
+};
+
+class CATraceZone {
+public:
+    inline CATraceZone(const char* name)
+        : _name(name)
+        , _start(CATrace::isEnabled() ? CATrace::now() : -1)
+    {
+    }
+
+    inline ~CATraceZone()
+    {
+        if (_start != -1)
+            CATrace::record(_name, _start, CATrace::now());
+    }
+
+    CATraceZone(const CATraceZone&) = delete;
+    CATraceZone& operator=(const CATraceZone&) = delete;
+
+private:
+    const char* _name;
+    qint64 _start;
+};
+
+#define CA_TRACE_CONCAT_(a, b) a##b
+#define CA_TRACE_CONCAT(a, b) CA_TRACE_CONCAT_(a, b)
+#define CA_TRACE_ZONE(name) CATraceZone CA_TRACE_CONCAT(traceZone, __LINE__)(name)
+
+#endif /* TRACE_H_ */
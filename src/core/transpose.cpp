@@ -5,6 +5,9 @@
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
 */
 
+#include <QHash>
+
+#include "core/progress.h"
 #include "core/transpose.h"
 
 #include "score/chordname.h"
@@ -19,6 +22,44 @@
 #include "score/staff.h"
 #include "score/voice.h"
 
+namespace {
+
+/*!
+	Pitch changes of the seven note names for the given transposition. The result of adding an
+	interval to a pitch only depends on the note name within the octave, so each pitch is transposed
+	by looking up its note name instead of doing the interval arithmetic again.
+*/
+class CAPitchTable {
+public:
+    CAPitchTable(CAInterval interval)
+        : _interval(interval)
+    {
+        for (int i = 0; i < 7; i++) {
+            CADiatonicPitch from(28 + i, 0);
+            CADiatonicPitch to = from + interval;
+            _noteName[i] = to.noteName() - from.noteName();
+            _accs[i] = to.accs();
+        }
+    }
+
+    inline CADiatonicPitch transpose(const CADiatonicPitch& pitch)
+    {
+        if (pitch.noteName() < 0) {
+            return CADiatonicPitch(pitch) + _interval; // undefined pitch, left unchanged
+        }
+
+        int i = pitch.noteName() % 7;
+        return CADiatonicPitch(pitch.noteName() + _noteName[i], pitch.accs() + _accs[i]);
+    }
+
+private:
+    CAInterval _interval;
+    int _noteName[7];
+    int _accs[7];
+};
+
+}
+
 /*!
 	\class CATranspose
 	\brief Class used for transposing a set of notes for the given interval
@@ -33,14 +74,24 @@
 	3) Transpose the elements by calling transposeByKeySig(), transposeByInterval(),
 	   transposeBySemitones() or reinterpretAccidentals().
 
+	Transposing a large sheet may be canceled through the CAProgress token set by setProgress().
+	The cancel request is checked before any element is changed, so a canceled transposition
+	leaves the elements untouched.
+
 	\sa CAInterval::fromSemitones()
  */
 
 CATranspose::CATranspose()
+    : _timeStart(-1)
+    , _timeEnd(-1)
+    , _progress(nullptr)
 {
 }
 
 CATranspose::CATranspose(CASheet* sheet)
+    : _timeStart(-1)
+    , _timeEnd(-1)
+    , _progress(nullptr)
 {
     for (int i = 0; i < sheet->contextList().size(); i++) {
         addContext(sheet->contextList()[i]);
@@ -48,6 +99,9 @@ CATranspose::CATranspose(CASheet* sheet)
 }
 
 CATranspose::CATranspose(QList<CAContext*> contexts)
+    : _timeStart(-1)
+    , _timeEnd(-1)
+    , _progress(nullptr)
 {
     for (int i = 0; i < contexts.size(); i++) {
         addContext(contexts[i]);
@@ -55,6 +109,9 @@ CATranspose::CATranspose(QList<CAContext*> contexts)
 }
 
 CATranspose::CATranspose(QList<CAMusElement*> selection)
+    : _timeStart(-1)
+    , _timeEnd(-1)
+    , _progress(nullptr)
 {
     _elements = QSet<CAMusElement*>::fromList(selection);
 }
@@ -132,38 +189,33 @@ void CATranspose::transposeByKeySig(CADiatonicKey from, CADiatonicKey to, int di
  */
 void CATranspose::transposeByInterval(CAInterval interval)
 {
-    for (CAMusElement* elt : _elements) {
-        switch (elt->musElementType()) {
-        case CAMusElement::Note:
-        case CAMusElement::ChordName: {
-            CADiatonicPitch newPitch;
-            if (elt->musElementType() == CAMusElement::Note) {
-                newPitch = static_cast<CANote*>(elt)->diatonicPitch();
-            } else if (elt->musElementType() == CAMusElement::ChordName) {
-                newPitch = static_cast<CAChordName*>(elt)->diatonicPitch();
-            }
-
-            newPitch = newPitch + interval;
-
-            if (elt->musElementType() == CAMusElement::Note) {
-                static_cast<CANote*>(elt)->setDiatonicPitch(newPitch);
-            } else if (elt->musElementType() == CAMusElement::ChordName) {
-                static_cast<CAChordName*>(elt)->setDiatonicPitch(newPitch);
-            }
+    if (!collectElements()) {
+        return;
+    }
+    CAPitchTable table(interval);
 
-            break;
-        }
-        case CAMusElement::KeySignature:
-            static_cast<CAKeySignature*>(elt)->setDiatonicKey(static_cast<CAKeySignature*>(elt)->diatonicKey() + interval);
-            break;
-        case CAMusElement::FunctionMark:
-            static_cast<CAFunctionMark*>(elt)->setKey(static_cast<CAFunctionMark*>(elt)->key() + interval);
-            break;
-        case CAMusElement::MidiNote: // ToDo
-            break;
-        default:
-            break;
-        }
+    QVector<CADiatonicPitch> pitches(_notes.size());
+    for (int i = 0; i < _notes.size(); i++) {
+        pitches[i] = table.transpose(_notes[i]->diatonicPitch());
+    }
+    if (isCanceled()) {
+        return;
+    }
+    setNotePitches(pitches);
+
+    for (CAChordName* chordName : _chordNames) {
+        chordName->setDiatonicPitch(table.transpose(chordName->diatonicPitch()));
+    }
+
+    for (CAKeySignature* keySig : _keySignatures) {
+        keySig->setDiatonicKey(keySig->diatonicKey() + interval);
+    }
+
+    for (CAFunctionMark* functionMark : _functionMarks) {
+        functionMark->setKey(functionMark->key() + interval);
+    }
+    if (_progress) {
+        _progress->setProgress(100);
     }
 }
 
@@ -178,44 +230,138 @@ void CATranspose::transposeByInterval(CAInterval interval)
 */
 void CATranspose::reinterpretAccidentals(int type)
 {
+    if (!collectElements()) {
+        return;
+    }
+    CAPitchTable sharpsToFlats(CAInterval(-2, 2)); // diminished second up
+    CAPitchTable flatsToSharps(CAInterval(-2, -2)); // diminished second down
+
+    auto reinterpret = [&](const CADiatonicPitch& pitch) {
+        if (type >= 0 && pitch.accs() > 0) {
+            return sharpsToFlats.transpose(pitch);
+        } else if (type <= 0 && pitch.accs() < 0) {
+            return flatsToSharps.transpose(pitch);
+        }
+        return pitch;
+    };
+
+    QVector<CADiatonicPitch> pitches(_notes.size());
+    for (int i = 0; i < _notes.size(); i++) {
+        pitches[i] = reinterpret(_notes[i]->diatonicPitch());
+    }
+    if (isCanceled()) {
+        return;
+    }
+    setNotePitches(pitches);
+
+    for (CAChordName* chordName : _chordNames) {
+        chordName->setDiatonicPitch(reinterpret(chordName->diatonicPitch()));
+    }
+
+    for (CAKeySignature* keySig : _keySignatures) {
+        CADiatonicKey newDiatonicKey = keySig->diatonicKey();
+        if (type >= 0 && keySig->diatonicKey().numberOfAccs() >= 5) {
+            newDiatonicKey = CADiatonicKey(keySig->diatonicKey().diatonicPitch() + CAInterval(-2, 2), keySig->diatonicKey().gender());
+        } else if (type <= 0 && keySig->diatonicKey().numberOfAccs() <= -5) {
+            newDiatonicKey = CADiatonicKey(keySig->diatonicKey().diatonicPitch() - CAInterval(-2, 2), keySig->diatonicKey().gender());
+        }
+        keySig->setDiatonicKey(newDiatonicKey);
+    }
+    if (_progress) {
+        _progress->setProgress(100);
+    }
+}
+
+/*!
+	Sorts the music elements to transpose by their type and computes the time region which
+	is changed by the transposition.
+
+	Changing key signatures or function marks affects the rest of the sheet, so timeStart()
+	returns -1 in that case.
+
+	Returns False, if the transposition was canceled meanwhile.
+*/
+bool CATranspose::collectElements()
+{
+    _notes.clear();
+    _chordNames.clear();
+    _keySignatures.clear();
+    _functionMarks.clear();
+    _timeStart = _timeEnd = -1;
+
     for (CAMusElement* elt : _elements) {
         switch (elt->musElementType()) {
         case CAMusElement::Note:
-        case CAMusElement::ChordName: {
-            CADiatonicPitch newPitch;
-            if (elt->musElementType() == CAMusElement::Note) {
-                newPitch = static_cast<CANote*>(elt)->diatonicPitch();
-            } else if (elt->musElementType() == CAMusElement::ChordName) {
-                newPitch = static_cast<CAChordName*>(elt)->diatonicPitch();
-            }
-
-            if (type >= 0 && newPitch.accs() > 0) {
-                newPitch = newPitch + CAInterval(-2, 2);
-            } else if (type <= 0 && newPitch.accs() < 0) {
-                newPitch = newPitch - CAInterval(-2, 2);
-            }
-
-            if (elt->musElementType() == CAMusElement::Note) {
-                static_cast<CANote*>(elt)->setDiatonicPitch(newPitch);
-            } else if (elt->musElementType() == CAMusElement::ChordName) {
-                static_cast<CAChordName*>(elt)->setDiatonicPitch(newPitch);
-            }
-
+            _notes << static_cast<CANote*>(elt);
             break;
-        }
-        case CAMusElement::KeySignature: {
-            CAKeySignature* keySig = static_cast<CAKeySignature*>(elt);
-            CADiatonicKey newDiatonicKey = keySig->diatonicKey();
-            if (type >= 0 && keySig->diatonicKey().numberOfAccs() >= 5) {
-                newDiatonicKey = CADiatonicKey(keySig->diatonicKey().diatonicPitch() + CAInterval(-2, 2), keySig->diatonicKey().gender());
-            } else if (type <= 0 && keySig->diatonicKey().numberOfAccs() <= -5) {
-                newDiatonicKey = CADiatonicKey(keySig->diatonicKey().diatonicPitch() - CAInterval(-2, 2), keySig->diatonicKey().gender());
-            }
-            keySig->setDiatonicKey(newDiatonicKey);
+        case CAMusElement::ChordName:
+            _chordNames << static_cast<CAChordName*>(elt);
             break;
-        }
+        case CAMusElement::KeySignature:
+            _keySignatures << static_cast<CAKeySignature*>(elt);
+            continue;
+        case CAMusElement::FunctionMark:
+            _functionMarks << static_cast<CAFunctionMark*>(elt);
+            continue;
+        case CAMusElement::MidiNote: // ToDo
         default:
-            break;
+            continue;
+        }
+
+        if (_timeStart == -1 || elt->timeStart() < _timeStart) {
+            _timeStart = elt->timeStart();
         }
+        _timeEnd = qMax(_timeEnd, elt->timeEnd());
+    }
+
+    if (!_keySignatures.isEmpty() || !_functionMarks.isEmpty()) {
+        _timeStart = _timeEnd = -1;
+    }
+    if (_progress) {
+        _progress->setProgress(50);
+    }
+    return !isCanceled();
+}
+
+/*!
+	Returns True, if the transposition was canceled by the progress token.
+*/
+bool CATranspose::isCanceled()
+{
+    return _progress && _progress->isCanceled();
+}
+
+/*!
+	Sets the new \a pitches of the collected notes.
+
+	Both notes of a tie are changed the same way, so the ties need to be updated only if some notes of
+	the voice are not transposed, or there is an open tie which may now end at the next note.
+	Updating the ties searches the whole voice, so this is skipped for the fully transposed voices.
+*/
+void CATranspose::setNotePitches(const QVector<CADiatonicPitch>& pitches)
+{
+    QHash<CAVoice*, int> transposedNotes;
+    for (CANote* note : _notes) {
+        transposedNotes[note->voice()]++;
+    }
+
+    QHash<CAVoice*, bool> fullVoice;
+    for (QHash<CAVoice*, int>::const_iterator it = transposedNotes.constBegin(); it != transposedNotes.constEnd(); it++) {
+        fullVoice[it.key()] = (it.key() && it.key()->getNoteList().size() == it.value());
+    }
+
+    QList<CANote*> tieUpdates;
+    for (int i = 0; i < _notes.size(); i++) {
+        CANote* note = _notes[i];
+        bool openTie = (note->tieStart() && !note->tieStart()->noteEnd());
+        note->setDiatonicPitch(pitches[i], false);
+        if (!fullVoice[note->voice()] || openTie) {
+            tieUpdates << note;
+        }
+    }
+
+    // ties are checked after all the notes were changed
+    for (CANote* note : tieUpdates) {
+        note->updateTies();
     }
 }
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2008, Matevž Jekovec, Canorus development team
+	Copyright (c) 2008-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -10,6 +10,7 @@
 
 #include <QList>
 #include <QSet>
+#include <QVector>
 
 #include "score/diatonickey.h"
 #include "score/interval.h"
@@ -17,6 +18,11 @@
 class CAMusElement;
 class CASheet;
 class CAContext;
+class CANote;
+class CAChordName;
+class CAKeySignature;
+class CAFunctionMark;
+class CAProgress;
 
 class CATranspose {
 public:
@@ -37,8 +43,29 @@ public:
     void addContext(CAContext* context);
     void addMusElement(CAMusElement* musElt) { _elements << musElt; }
 
+    inline CAProgress* progress() { return _progress; }
+    inline void setProgress(CAProgress* progress) { _progress = progress; }
+
+    inline int timeStart() { return _timeStart; }
+    inline int timeEnd() { return _timeEnd; }
+
 private:
+    bool collectElements();
+    bool isCanceled();
+    void setNotePitches(const QVector<CADiatonicPitch>& pitches);
+
     QSet<CAMusElement*> _elements;
+
+    // elements of _elements sorted by type, filled by collectElements()
+    QVector<CANote*> _notes;
+    QVector<CAChordName*> _chordNames;
+    QVector<CAKeySignature*> _keySignatures;
+    QVector<CAFunctionMark*> _functionMarks;
+
+    int _timeStart; // region changed by the last transposition, -1 if the whole sheet is affected
+    int _timeEnd;
+
+    CAProgress* _progress; // progress and cancellation of the transposition, optional
 };
 
 #endif /* TRANSPOSE_H_ */
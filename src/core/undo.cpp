@@ -1,13 +1,25 @@
 /*!
-	Copyright (c) 2007-2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
 */
 
+#include <QRunnable>
+#include <QSet>
+#include <QThreadPool>
+
+#include "canorus.h"
+#include "control/resourcectl.h"
+#include "core/actionlatency.h"
+#include "core/settings.h"
+#include "core/trace.h"
 #include "core/undo.h"
 #include "core/undocommand.h"
+#include "score/context.h"
 #include "score/document.h" // needed for setting the modified flag
+#include "score/sheet.h"
+#include "score/staff.h"
 #include <iostream>
 
 /*!
@@ -18,8 +30,9 @@
 
     This singleton object is created upon Canorus startup and is accessed via CACanorus::undo() getter.
     In essence there is one undo stack for each opened file. When changes to the document are made, the
-    undo action is created and the current document is cloned. This copy is then used to replace the
-    active document in case of undo. A mapping of any document copy out there to the undo stack it
+    undo action is created and a snapshot of the current document is made (see CADocument::snapshot()).
+    The snapshot shares the unchanged staffs with the previous ones and is read only when it replaces
+    the active document in case of undo. A mapping of any document copy out there to the undo stack it
     belongs to is stored in _undoStack.
 
     Each main window has one undo stack or a shared undo stack, if multiple windows represent the same
@@ -38,7 +51,14 @@
 	4) For undo/redo, simply call CAUndo::undoStack()->undo().
 	5) When destroying the document, also destroy the undo stack (which also destroys all its commands) by
 	   calling CAUndo::deleteUndoStack(). This is not done automatically because CADocument is part of the
-	   data model and CAUndo part of the controller.
+	   data model and CAUndo part of the controller. When closing a document in the user interface, call
+	   CAUndo::deleteUndoStackLater() instead, which deletes the documents in the background.
+
+    If the action changes a single staff only, the staff can be passed to CAUndo::createUndoCommand().
+    Only the staff is cloned in this case and the document is changed in place on undo/redo.
+
+    The oldest commands are deleted when the undo history of a document exceeds the memory limit set
+    in CASettings::undoMemoryLimit().
 
     If the user already created its own instance of the new document without calling CAUndo::createUndoCommand()
     (e.g. when parsing the source-view of the whole document), he should use CAUndo::replaceDocument().
@@ -46,13 +66,38 @@
 	\sa CAUndoCommand
 */
 
+/*!
+	\class CADocumentTeardown
+	\brief Deletes the closed documents on the undo teardown thread
+
+	\sa CAUndo::deleteUndoStackLater()
+*/
+class CADocumentTeardown : public QRunnable {
+public:
+    CADocumentTeardown(const QList<CADocument*>& documents)
+        : _documents(documents)
+    {
+    }
+
+    void run() { qDeleteAll(_documents); }
+
+private:
+    QList<CADocument*> _documents;
+};
+
 CAUndo::CAUndo()
 {
     _undoCommand = nullptr;
+    _teardownPool = new QThreadPool();
+    _teardownPool->setMaxThreadCount(1); // closing the documents shouldn't compete with the user interface
 }
 
+/*!
+	Waits for the documents being deleted in the background.
+*/
 CAUndo::~CAUndo()
 {
+    delete _teardownPool;
 }
 
 /*!
@@ -72,8 +117,13 @@ void CAUndo::createUndoStack(CADocument* doc)
 void CAUndo::undo(CADocument* doc)
 {
     if (_undoStack[doc] && canUndo(doc)) {
-        _undoStack[doc]->at(undoIndex(doc))->undo();
+        CAActionLatency::beginAction("undo");
+        CAActionLatency::beginPhase(CAActionLatency::ModelPhase);
+        CAUndoCommand* c = _undoStack[doc]->at(undoIndex(doc));
+        c->undo();
+        addChangedSheets(c);
         undoIndex(doc)--;
+        doc->updateGeneration();
     }
 }
 
@@ -84,8 +134,27 @@ void CAUndo::undo(CADocument* doc)
 void CAUndo::redo(CADocument* doc)
 {
     if (_undoStack[doc] && canRedo(doc)) {
-        _undoStack[doc]->at(undoIndex(doc) + 1)->redo();
+        CAActionLatency::beginAction("redo");
+        CAActionLatency::beginPhase(CAActionLatency::ModelPhase);
+        CAUndoCommand* c = _undoStack[doc]->at(undoIndex(doc) + 1);
+        c->redo();
+        addChangedSheets(c);
         undoIndex(doc)++;
+        doc->updateGeneration();
+    }
+}
+
+/*!
+	Remembers the sheets changed by the last undo or redo of the command \a c.
+	The views of these sheets need to be rebuilt, the other views are still up to date.
+
+	\sa changedSheets(), CAUndoCommand::changedSheets()
+*/
+void CAUndo::addChangedSheets(CAUndoCommand* c)
+{
+    for (int idx : c->changedSheets()) {
+        if (!_changedSheets.contains(idx))
+            _changedSheets << idx;
     }
 }
 
@@ -108,6 +177,69 @@ void CAUndo::deleteUndoStack(CADocument* doc)
         removeUndoStack(keys[i]);
 }
 
+/*!
+	Deletes the undo stack of the given document like deleteUndoStack(), but the documents stored in
+	the stack are deleted in a background thread. Deleting a large document with a long undo history
+	takes a while, so the user interface doesn't freeze when closing it. If \a deleteDocument is True,
+	\a doc is deleted in the background as well.
+
+	The undo commands and the resources of the documents are still deleted here, because they use
+	the undo stacks and the main windows. None of the deleted documents may be used afterwards, so
+	the user interface showing \a doc should be cleared before.
+
+	\sa deleteUndoStack()
+*/
+void CAUndo::deleteUndoStackLater(CADocument* doc, bool deleteDocument)
+{
+    clearUndoCommand();
+    QList<CAUndoCommand*>* stack = (containsUndoStack(doc) ? undoStack(doc) : nullptr);
+
+    QSet<CADocument*> documents;
+    if (stack) {
+        QList<CADocument*> keys = _undoStack.keys(stack);
+        for (CAUndoCommand* c : *stack) {
+            keys << c->getUndoDocument() << c->getRedoDocument();
+        }
+        for (CADocument* d : keys) {
+            if (d && d != doc && !CACanorus::mainWinCount(d)) {
+                documents << d;
+            }
+        }
+    }
+    if (deleteDocument && doc) {
+        documents << doc;
+    }
+
+    // the resources are shared among the documents of the same undo stack
+    for (CADocument* d : documents) {
+        while (d->resourceList().size()) {
+            std::shared_ptr<CAResource> r = d->resourceList()[0];
+            CAResourceCtl::deleteResource(r);
+            d->removeResource(r);
+        }
+    }
+
+    if (stack) {
+        for (CAUndoCommand* c : *stack) {
+            if (!c->isStaffCommand()) {
+                c->setUndoDocument(nullptr);
+                c->setRedoDocument(nullptr);
+            }
+        }
+        qDeleteAll(*stack); // the staff commands still delete their staff snapshots
+        delete stack;
+
+        QList<CADocument*> keys = _undoStack.keys(stack);
+        for (int i = 0; i < keys.size(); i++)
+            removeUndoStack(keys[i]);
+        _undoIndex.remove(stack);
+    }
+
+    if (!documents.isEmpty()) {
+        _teardownPool->start(new CADocumentTeardown(documents.toList()));
+    }
+}
+
 /*!
 	Call this to add an undo command (created by createUndoCommand()) to the stack.
 	Undo commands *after* the currently active command will be deleted.
@@ -125,26 +257,76 @@ void CAUndo::pushUndoCommand()
 
     _undoCommand->getUndoDocument()->setModified(true);
     _undoCommand->getRedoDocument()->setModified(true);
+    d->updateGeneration(); // the current document is being changed
 
     QList<CAUndoCommand*>* s = _undoStack[d];
     CAUndoCommand* prevUndoCommand = (undoIndex(d) < s->size() && undoIndex(d) >= 0 ? s->at(undoIndex(d)) : nullptr);
 
     // delete undo commands after the new one, if any (eg. 3x changes, 2x undo, 1x change => removes last 2 undos when making a change)
     for (int i = undoIndex(d) + 1; i < s->size();) {
-        _undoStack.remove(s->at(i)->getRedoDocument());
+        if (s->at(i)->getRedoDocument() != d) // staff commands share the current document
+            _undoStack.remove(s->at(i)->getRedoDocument());
         delete s->at(i);
         s->removeAt(i);
     }
 
     if (prevUndoCommand) {
         if (_undoCommand->getRedoDocument() && prevUndoCommand->getRedoDocument())
-            prevUndoCommand->setRedoDocument(_undoCommand->getUndoDocument());
+            relinkDocument(s, undoIndex(d), _undoCommand->getUndoDocument());
     }
 
     s->append(_undoCommand); // push the command on stack
     _undoStack[_undoCommand->getUndoDocument()] = s;
     undoIndex(d) = _undoStack[d]->size() - 1;
     _undoCommand = nullptr;
+
+    limitMemoryUsage(d);
+}
+
+/*!
+	Returns the estimated memory used by the undo history of the document \a d in bytes.
+
+	\sa CAUndoCommand::memoryUsage()
+*/
+qint64 CAUndo::memoryUsage(CADocument* d)
+{
+    qint64 usage = 0;
+    QList<CAUndoCommand*>* stack = _undoStack.value(d);
+    for (int i = 0; stack && i < stack->size(); i++) {
+        usage += stack->at(i)->memoryUsage();
+    }
+
+    return usage;
+}
+
+/*!
+	Deletes the oldest commands of the undo history of the document \a d, until its memory usage
+	is within the limit set in CASettings. The last undo step is always kept.
+*/
+void CAUndo::limitMemoryUsage(CADocument* d)
+{
+    qint64 limit = static_cast<qint64>(CACanorus::settings()->undoMemoryLimit()) * 1024 * 1024;
+    if (limit <= 0)
+        return;
+
+    QList<CAUndoCommand*>* stack = _undoStack[d];
+    qint64 usage = memoryUsage(d);
+    while (usage > limit && undoIndex(d) > 0) {
+        CAUndoCommand* c = stack->takeFirst();
+        undoIndex(d)--;
+        usage -= c->memoryUsage();
+
+        // staff commands share the undo document with the following commands
+        CADocument* doc = c->getUndoDocument();
+        bool shared = (doc == d);
+        for (int i = 0; !shared && i < stack->size(); i++) {
+            shared = (stack->at(i)->getUndoDocument() == doc || stack->at(i)->getRedoDocument() == doc);
+        }
+        if (!shared)
+            _undoStack.remove(doc);
+
+        delete c;
+    }
 }
 
 /*!
@@ -192,12 +374,59 @@ void CAUndo::clearUndoCommand()
 	This function is usually called when making changes to the document in the score -
 	all changes ranging from creation/removal of sheets and editing document properties.
 
+	If the action only changes the given \a staff, only the staff is stored instead of the whole
+	document. The whole document is still stored, if the sheet contains contexts which are filled
+	according to all the staffs (function marks, figured bass and chord names).
+
 	\warning This function is not thread-safe. createUndoCommand() and pushUndoCommand() should be called from the same thread.
 */
-void CAUndo::createUndoCommand(CADocument* d, QString text)
+void CAUndo::createUndoCommand(CADocument* d, QString text, CAStaff* staff)
 {
+    CA_TRACE_ZONE("CAUndo::createUndoCommand");
+    CAActionLatency::beginAction(text);
     clearUndoCommand();
-    _undoCommand = new CAUndoCommand(d, text);
+
+    if (staff && staff->sheet() && d->sheetList().contains(staff->sheet())) {
+        for (int i = 0; staff && i < staff->sheet()->contextList().size(); i++) {
+            switch (staff->sheet()->contextList()[i]->contextType()) {
+            case CAContext::FunctionMarkContext:
+            case CAContext::FiguredBassContext:
+            case CAContext::ChordNameContext:
+                staff = nullptr;
+                break;
+            default:
+                break;
+            }
+        }
+    } else {
+        staff = nullptr;
+    }
+
+    if (staff) {
+        _undoCommand = new CAUndoCommand(d, staff, text);
+    } else {
+        _undoCommand = new CAUndoCommand(d, text);
+    }
+    CAActionLatency::beginPhase(CAActionLatency::ModelPhase);
+}
+
+/*!
+	Sets the redo document of the command at \a index in the \a stack to \a doc.
+	Staff commands before it share the document with it, so their undo and redo documents are
+	relinked as well until the first command storing the whole document.
+*/
+void CAUndo::relinkDocument(QList<CAUndoCommand*>* stack, int index, CADocument* doc)
+{
+    for (int i = index; i >= 0; i--) {
+        CAUndoCommand* c = stack->at(i);
+        if (!c->isStaffCommand()) {
+            c->setRedoDocument(doc);
+            break;
+        }
+
+        c->setUndoDocument(doc);
+        c->setRedoDocument(doc);
+    }
 }
 
 /*!
@@ -213,7 +442,7 @@ void CAUndo::replaceDocument(CADocument* oldDoc, CADocument* newDoc)
     CAUndoCommand* prevUndoCommand = (undoIndex(oldDoc) < stack->size() && undoIndex(oldDoc) >= 0 ? stack->at(undoIndex(oldDoc)) : nullptr);
     if (prevUndoCommand) {
         if (prevUndoCommand->getRedoDocument() == oldDoc)
-            prevUndoCommand->setRedoDocument(newDoc);
+            relinkDocument(stack, undoIndex(oldDoc), newDoc);
     }
 
     _undoStack.remove(oldDoc);
@@ -233,10 +462,11 @@ QList<CADocument*> CAUndo::getAllDocuments(CADocument* d)
 
     if (undoCommands && undoCommands->size()) {
         for (int i = 0; i < undoCommands->size(); i++) {
-            documents << undoCommands->at(i)->getUndoDocument();
+            if (!documents.contains(undoCommands->at(i)->getUndoDocument())) // staff commands share the document
+                documents << undoCommands->at(i)->getUndoDocument();
         }
 
-        if (undoCommands->size() > 0) {
+        if (undoCommands->size() > 0 && !documents.contains(undoCommands->at(undoCommands->size() - 1)->getRedoDocument())) {
             documents << undoCommands->at(undoCommands->size() - 1)->getRedoDocument();
         }
     } else {
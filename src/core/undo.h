@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -10,6 +10,8 @@
 
 class CAUndoCommand;
 class CADocument;
+class CAStaff;
+class QThreadPool;
 
 #include <QHash>
 #include <QList>
@@ -29,20 +31,29 @@ public:
     inline int& undoIndex(CADocument* d) { return _undoIndex[undoStack(d)]; }
     inline void removeUndoStack(CADocument* d) { _undoStack.remove(d); }
     void deleteUndoStack(CADocument* doc);
-    void createUndoCommand(CADocument* d, QString text);
+    void deleteUndoStackLater(CADocument* doc, bool deleteDocument = false);
+    void createUndoCommand(CADocument* d, QString text, CAStaff* staff = nullptr);
     void pushUndoCommand();
     CAUndoCommand* undoCommand(CADocument* d);
     CAUndoCommand* redoCommand(CADocument* d);
     void updateLastUndoCommand(CAUndoCommand* c);
     void replaceDocument(CADocument*, CADocument*);
     QList<CADocument*> getAllDocuments(CADocument* d);
+    qint64 memoryUsage(CADocument* d);
+    inline const QList<int>& changedSheets() { return _changedSheets; }
+    inline void clearChangedSheets() { _changedSheets.clear(); }
 
 private:
     void clearUndoCommand();
+    void relinkDocument(QList<CAUndoCommand*>* stack, int index, CADocument* doc);
+    void limitMemoryUsage(CADocument* d);
+    void addChangedSheets(CAUndoCommand* c);
     CAUndoCommand* _undoCommand; // current undo command created to be put on the undo stack
 
     QHash<CADocument*, QList<CAUndoCommand*>*> _undoStack;
     QHash<QList<CAUndoCommand*>*, int> _undoIndex;
+    QList<int> _changedSheets; // indices of the sheets changed by undo() and redo() since clearChangedSheets()
+    QThreadPool* _teardownPool; // deletes the documents of the closed undo stacks
 };
 
 #endif /* UNDO_H_ */
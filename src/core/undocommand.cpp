@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -7,14 +7,111 @@
 
 #include "core/undocommand.h"
 #include "canorus.h"
+#include "core/documentdiff.h"
 #include "core/undo.h"
+#include "export/canorusmlexport.h"
+#include "score/chordnamecontext.h"
 #include "score/document.h"
+#include "score/figuredbasscontext.h"
+#include "score/functionmarkcontext.h"
 #include "score/lyricscontext.h"
 #include "score/resource.h"
 #include "score/sheet.h"
+#include "score/staff.h"
+#include "score/staffchunk.h"
+#include "score/syllable.h"
 #include "score/voice.h"
 #include "widgets/scoreview.h"
 #include "widgets/sourceview.h"
+#include <QTextStream>
+
+const int CAUndoCommand::ELEMENT_MEMORY_USAGE = 256;
+
+namespace {
+
+int elementCount(CAContext* context)
+{
+    switch (context->contextType()) {
+    case CAContext::Staff: {
+        int count = 0;
+        for (CAVoice* voice : static_cast<CAStaff*>(context)->voiceList()) {
+            count += voice->musElementList().size();
+        }
+        return count;
+    }
+    case CAContext::LyricsContext:
+        return static_cast<CALyricsContext*>(context)->syllableList().size();
+    case CAContext::FunctionMarkContext:
+        return static_cast<CAFunctionMarkContext*>(context)->functionMarkList().size();
+    case CAContext::FiguredBassContext:
+        return static_cast<CAFiguredBassContext*>(context)->figuredBassMarkList().size();
+    case CAContext::ChordNameContext:
+        return static_cast<CAChordNameContext*>(context)->chordNameList().size();
+    }
+
+    return 0;
+}
+
+QString sheetSource(CASheet* sheet)
+{
+    QString source;
+    QTextStream stream(&source);
+    CACanorusMLExport exporter(&stream);
+    exporter.exportSheet(sheet);
+    exporter.wait();
+
+    return source;
+}
+
+/*!
+	Returns True, if sheets \a a and \a b have the same content. Element counts and the structural
+	diff are compared first, so the sheets are only exported to CanorusML when they are possibly the
+	same.
+*/
+bool isSameSheet(CASheet* a, CASheet* b)
+{
+    if (!a->isLoaded() && !b->isLoaded() && a->loader() == b->loader())
+        return true; // neither was read since it was cloned
+
+    if (a->contextList().size() != b->contextList().size())
+        return false;
+
+    for (int i = 0; i < a->contextList().size(); i++) {
+        if (a->contextList()[i]->contextType() != b->contextList()[i]->contextType()
+            || elementCount(a->contextList()[i]) != elementCount(b->contextList()[i])) {
+            return false;
+        }
+    }
+
+    if (!CADocumentDiff::isSameSheet(a, b))
+        return false; // changed notes, signs or marks, no need to export
+
+    return sheetSource(a) == sheetSource(b);
+}
+
+/*!
+	Returns the number of elements copied by the snapshot \a document. The staffs shared with the
+	previous snapshots and the sheets sharing the source with the original document are not
+	counted, see CADocument::snapshot().
+*/
+int elementCount(CADocument* document)
+{
+    int count = 0;
+    for (CASheet* sheet : document->sheetList()) {
+        if (!sheet->isLoaded()) {
+            CASnapshotSheetLoader* snapshot = dynamic_cast<CASnapshotSheetLoader*>(sheet->loader().get());
+            count += (snapshot ? snapshot->newElementCount() : 0);
+            continue;
+        }
+
+        for (CAContext* context : sheet->contextList()) {
+            count += elementCount(context);
+        }
+    }
+    return count;
+}
+
+}
 
 /*!
 	\class CAUndoCommand
@@ -29,6 +126,18 @@
 	sheets currently opened are updated pointing to the previous (undone) or next (redone) states of the
 	structures.
 
+	Actions which change a single staff only can create a staff command instead. Staff command stores a
+	clone of the affected staff only and swaps it with the staff in the document on undo/redo. The document
+	itself is not replaced, so its undo and redo documents are always the same.
+
+	The undo document is a snapshot of the document, which is only read when the command is undone.
+	Its staffs are shared with the snapshots of the previous commands until they are changed, see
+	CAStaffChunk.
+
+	memoryUsage() returns the estimated size of the stored snapshot, without the staffs shared with
+	the previous commands. It is used by CAUndo to keep the undo history within the memory limit set
+	in CASettings.
+
 	\warning You should never directly access this class. Use CAUndo instead.
 
 	\sa CAUndo
@@ -36,7 +145,8 @@
 
 /*!
 	Creates a new undo command.
-	Internally, it clones the given document and sets it as an undo document.
+	Internally, it makes a snapshot of the given document and sets it as an undo document (see
+	CADocument::snapshot()), so the unchanged staffs are shared with the previous commands.
 	The redo document is directly the passed document.
 	When having multiple undo commands, you should take care of relinking the previous undo commmand's redo
 	document to next command's undo document. This is usually done when pushing the command onto the stack.
@@ -44,12 +154,44 @@
 CAUndoCommand::CAUndoCommand(CADocument* document, QString text)
     : QUndoCommand(text)
 {
-    setUndoDocument(document->clone());
+    setUndoDocument(document->snapshot());
+    setRedoDocument(document);
+    _staff = nullptr;
+    _sheetIndex = -1;
+    _contextIndex = -1;
+    _memoryUsage = static_cast<qint64>(elementCount(getUndoDocument())) * ELEMENT_MEMORY_USAGE;
+}
+
+/*!
+	Creates a new staff undo command.
+	Internally, it clones the given \a staff only. Both undo and redo documents are the passed \a document.
+	The staff is later found by the sheet and context index, because the document might get replaced by
+	the commands before or after this one.
+*/
+CAUndoCommand::CAUndoCommand(CADocument* document, CAStaff* staff, QString text)
+    : QUndoCommand(text)
+{
+    setUndoDocument(document);
     setRedoDocument(document);
+    _sheetIndex = document->sheetList().indexOf(staff->sheet());
+    _contextIndex = staff->sheet()->contextList().indexOf(staff);
+    _staff = staff->clone(staff->sheet());
+
+    // lyrics contexts are relinked when the staff is swapped
+    for (int i = 0; i < _staff->voiceList().size(); i++) {
+        _staff->voiceList()[i]->setLyricsContexts(QList<CALyricsContext*>());
+    }
+    _memoryUsage = static_cast<qint64>(elementCount(_staff)) * ELEMENT_MEMORY_USAGE;
 }
 
 CAUndoCommand::~CAUndoCommand()
 {
+    if (isStaffCommand()) {
+        // documents are shared with the neighbouring commands
+        delete _staff;
+        return;
+    }
+
     if (getUndoDocument() && (!CACanorus::mainWinCount(getUndoDocument())))
         delete getUndoDocument();
 
@@ -60,37 +202,84 @@ CAUndoCommand::~CAUndoCommand()
 
 void CAUndoCommand::undo()
 {
+    if (isStaffCommand()) {
+        swapStaff(getRedoDocument());
+        _changedSheets = QList<int>() << _sheetIndex;
+        return;
+    }
+
     getUndoDocument()->setTimeEdited(getRedoDocument()->timeEdited()); // time edited might get lost when saving the document and undoing right after
     getUndoDocument()->setFileName(getRedoDocument()->fileName());
-    CAUndoCommand::undoDocument(getRedoDocument(), getUndoDocument());
+    _changedSheets = CAUndoCommand::undoDocument(getRedoDocument(), getUndoDocument());
 }
 
 void CAUndoCommand::redo()
 {
+    if (isStaffCommand()) {
+        swapStaff(getUndoDocument());
+        _changedSheets = QList<int>() << _sheetIndex;
+        return;
+    }
+
     getRedoDocument()->setTimeEdited(getUndoDocument()->timeEdited()); // time edited might get lost when saving the document and redoing right after
     getRedoDocument()->setFileName(getUndoDocument()->fileName());
-    CAUndoCommand::undoDocument(getUndoDocument(), getRedoDocument());
+    _changedSheets = CAUndoCommand::undoDocument(getUndoDocument(), getRedoDocument());
 }
 
 /*!
 	Creates the actual undo (switches the pointers of the document) and updates the GUI.
 	The updating GUI part is quite complicated as it has to update all views showing
-	the right structure and sub-structure (eg. voice with the same index in the new document).
+	the right structure and sub-structure (eg. the context with the same id and its voice with the
+	same index in the new document).
+
+	Sheets which are the same in both documents are exchanged between them, so the views keep showing
+	the already laid out sheet. Returns the indices of the sheets which differ and whose views need to
+	be rebuilt. If the number of sheets differs, the whole UI is rebuilt here and an empty list is
+	returned.
 */
-void CAUndoCommand::undoDocument(CADocument* current, CADocument* newDocument)
+QList<int> CAUndoCommand::undoDocument(CADocument* current, CADocument* newDocument)
 {
     QHash<CASheet*, CASheet*> sheetMap; // map old->new sheets
     QHash<CAContext*, CAContext*> contextMap; // map old->new contexts
     QHash<CAVoice*, CAVoice*> voiceMap; // map old->new voices
+    QList<int> changedSheets;
     bool rebuildNeeded = false;
 
+    if (newDocument->sheetList().size() == current->sheetList().size()) {
+        for (int i = 0; i < current->sheetList().size(); i++) {
+            if (current->sheetList().size() == 1 || !isSameSheet(current->sheetList()[i], newDocument->sheetList()[i])) {
+                changedSheets << i;
+            } else {
+                CASheet* sheet = current->replaceSheet(i, newDocument->sheetList()[i]);
+                newDocument->replaceSheet(i, sheet);
+            }
+        }
+    }
+
     for (int i = 0; i < newDocument->sheetList().size() && i < current->sheetList().size(); i++) {
         sheetMap[current->sheetList()[i]] = newDocument->sheetList()[i];
-        for (int j = 0; j < newDocument->sheetList()[i]->contextList().size() && j < current->sheetList()[i]->contextList().size(); j++) {
-            contextMap[current->sheetList()[i]->contextList()[j]] = newDocument->sheetList()[i]->contextList()[j];
+        if (!current->sheetList()[i]->isLoaded() || !newDocument->sheetList()[i]->isLoaded())
+            continue; // not shown yet, there is nothing to relink
+
+        // the contexts are matched by their ids, so the views follow them when contexts were added or removed
+        QHash<quint64, CAContext*> newContexts;
+        for (CAContext* context : newDocument->sheetList()[i]->contextList()) {
+            newContexts[context->id()] = context;
         }
-        for (int j = 0; j < newDocument->sheetList()[i]->voiceList().size() && j < current->sheetList()[i]->voiceList().size(); j++) {
-            voiceMap[current->sheetList()[i]->voiceList()[j]] = newDocument->sheetList()[i]->voiceList()[j];
+        for (CAContext* context : current->sheetList()[i]->contextList()) {
+            CAContext* newContext = newContexts.value(context->id(), nullptr);
+            if (!newContext || newContext->contextType() != context->contextType()) {
+                continue;
+            }
+
+            contextMap[context] = newContext;
+            if (context->contextType() == CAContext::Staff) {
+                const QList<CAVoice*>& voices = static_cast<CAStaff*>(context)->voiceList();
+                const QList<CAVoice*>& newVoices = static_cast<CAStaff*>(newContext)->voiceList();
+                for (int j = 0; j < voices.size() && j < newVoices.size(); j++) {
+                    voiceMap[voices[j]] = newVoices[j];
+                }
+            }
         }
     }
 
@@ -164,4 +353,77 @@ void CAUndoCommand::undoDocument(CADocument* current, CADocument* newDocument)
 
     if (rebuildNeeded)
         CACanorus::rebuildUI(newDocument);
+
+    return changedSheets;
+}
+
+/*!
+	Replaces the staff in the given \a document with the stored staff snapshot and keeps the replaced
+	staff for the next undo/redo. Lyrics contexts and views pointing to the old voices are relinked to
+	the new ones.
+*/
+void CAUndoCommand::swapStaff(CADocument* document)
+{
+    if (_sheetIndex < 0 || _sheetIndex >= document->sheetList().size()
+        || _contextIndex < 0 || _contextIndex >= document->sheetList()[_sheetIndex]->contextList().size()
+        || document->sheetList()[_sheetIndex]->contextList()[_contextIndex]->contextType() != CAContext::Staff) {
+        return; // the document doesn't have the staff any more, nothing to swap
+    }
+
+    CASheet* sheet = document->sheetList()[_sheetIndex];
+    CAStaff* current = static_cast<CAStaff*>(sheet->contextList()[_contextIndex]);
+
+    sheet->removeContext(current);
+    sheet->insertContext(_contextIndex, _staff);
+    _staff->setSheet(sheet);
+
+    QHash<CAVoice*, CAVoice*> voiceMap; // map old->new voices
+    for (int i = 0; i < current->voiceList().size(); i++) {
+        voiceMap[current->voiceList()[i]] = (i < _staff->voiceList().size() ? _staff->voiceList()[i] : nullptr);
+    }
+
+    // relink lyrics
+    for (int i = 0; i < sheet->contextList().size(); i++) {
+        if (sheet->contextList()[i]->contextType() != CAContext::LyricsContext)
+            continue;
+
+        CALyricsContext* lc = static_cast<CALyricsContext*>(sheet->contextList()[i]);
+        for (int j = 0; j < lc->syllableList().size(); j++) {
+            if (voiceMap.contains(lc->syllableList()[j]->associatedVoice()))
+                lc->syllableList()[j]->setAssociatedVoice(voiceMap[lc->syllableList()[j]->associatedVoice()]);
+        }
+
+        if (voiceMap.contains(lc->associatedVoice()))
+            lc->setAssociatedVoice(voiceMap[lc->associatedVoice()]); // also reposits syllables
+    }
+
+    for (int i = 0; i < current->voiceList().size(); i++) {
+        current->voiceList()[i]->setLyricsContexts(QList<CALyricsContext*>());
+    }
+
+    sheet->clearNoteCheckerErrors(); // errors point to the replaced elements
+
+    // update views showing the replaced voices, current drawable context is restored by index when rebuilding
+    QList<CAMainWin*> mainWinList = CACanorus::findMainWin(document);
+    for (int i = 0; i < mainWinList.size(); i++) {
+        QList<CAView*> viewList = mainWinList[i]->viewList();
+        for (int j = 0; j < viewList.size(); j++) {
+            if (viewList[j]->viewType() == CAView::ScoreView) {
+                CAScoreView* sv = static_cast<CAScoreView*>(viewList[j]);
+                if (voiceMap.contains(sv->selectedVoice())) {
+                    sv->setSelectedVoice(voiceMap[sv->selectedVoice()]);
+                }
+            } else if (viewList[j]->viewType() == CAView::SourceView) {
+                CASourceView* sv = static_cast<CASourceView*>(viewList[j]);
+                if (voiceMap.contains(sv->voice())) {
+                    if (voiceMap[sv->voice()])
+                        sv->setVoice(voiceMap[sv->voice()]);
+                    else
+                        delete sv;
+                }
+            }
+        }
+    }
+
+    _staff = current;
 }
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 	
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -8,28 +8,46 @@
 #ifndef UNDOCOMMAND_H_
 #define UNDOCOMMAND_H_
 
+#include <QList>
 #include <QUndoCommand>
 
 class CASheet;
+class CAStaff;
 class CADocument;
 
 class CAUndoCommand : public QUndoCommand {
 public:
     CAUndoCommand(CADocument* document, QString text);
+    CAUndoCommand(CADocument* document, CAStaff* staff, QString text);
     virtual ~CAUndoCommand();
     virtual void undo();
     virtual void redo();
 
-    static void undoDocument(CADocument* current, CADocument* newDocument);
+    static QList<int> undoDocument(CADocument* current, CADocument* newDocument);
 
     inline CADocument* getUndoDocument() { return _undoDocument; }
     inline void setUndoDocument(CADocument* doc) { _undoDocument = doc; }
     inline CADocument* getRedoDocument() { return _redoDocument; }
     inline void setRedoDocument(CADocument* doc) { _redoDocument = doc; }
 
+    inline bool isStaffCommand() { return _staff; }
+    inline qint64 memoryUsage() { return _memoryUsage; }
+    inline const QList<int>& changedSheets() { return _changedSheets; }
+
+    static const int ELEMENT_MEMORY_USAGE;
+
 private:
+    void swapStaff(CADocument* document);
+
     CADocument* _undoDocument;
     CADocument* _redoDocument;
+
+    /// \todo replace raw pointer with shared or unique pointer
+    CAStaff* _staff; // staff snapshot swapped with the one in the document on undo/redo, nullptr if the whole document is stored
+    int _sheetIndex;
+    int _contextIndex;
+    qint64 _memoryUsage; // estimated size of the stored snapshot in bytes
+    QList<int> _changedSheets; // indices of the sheets changed by the last undo() or redo()
 };
 
 #endif /* UNDOCOMMAND_H_ */
@@ -0,0 +1,272 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QObject>
+#include <QRegExp>
+#include <QSet>
+
+#include "export/audioexport.h"
+#include "export/flacwriter.h"
+
+#include "interface/playback.h"
+#include "interface/synth.h"
+#include "score/playable.h"
+#include "score/sheet.h"
+#include "score/staff.h"
+#include "score/voice.h"
+
+#include "core/taskscheduler.h"
+#include "core/trace.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+const int CAAudioExport::DEFAULT_SAMPLE_RATE = 44100;
+const int CAAudioExport::RELEASE_TAIL = 2000; // in miliseconds, rendered after the last event for the notes to fade out
+
+namespace {
+
+const int RENDER_BLOCK = 1024; // frames rendered at once after the last event
+
+/*!
+	Renders the timeline events of the given voices by its own CASynth into a stereo buffer.
+	Several renderers run in the task scheduler in parallel, they only share the read-only
+	timeline and SoundFont.
+*/
+class CAAudioRenderer : public CATask {
+public:
+    CAAudioRenderer(const CASoundFont* soundFont, int sampleRate, int frames, const QList<CAPlaybackEvent>& timeline, const QSet<CAVoice*>& voices)
+        : CATask(CATask::Normal)
+        , _soundFont(soundFont)
+        , _sampleRate(sampleRate)
+        , _frames(frames)
+        , _timeline(timeline)
+        , _voices(voices)
+    {
+    }
+
+    void run()
+    {
+        _buffer.fill(0, 2 * _frames);
+        CASynth synth(_soundFont, _sampleRate);
+
+        int frame = 0;
+        for (const CAPlaybackEvent& event : _timeline) {
+            // program and volume changes don't belong to any voice and are played by all the renderers
+            if (event.type != CAPlaybackEvent::Message || (event.playable && !_voices.contains(event.playable->voice()))) {
+                continue;
+            }
+
+            int target = qMin(static_cast<int>(std::lround(event.msecs * _sampleRate / 1000)), _frames);
+            if (target > frame) {
+                synth.render(_buffer.data() + 2 * frame, target - frame);
+                frame = target;
+            }
+            synth.send(event.message);
+        }
+
+        while (frame < _frames && synth.isPlaying()) {
+            int frames = qMin(RENDER_BLOCK, _frames - frame);
+            synth.render(_buffer.data() + 2 * frame, frames);
+            frame += frames;
+        }
+    }
+
+    inline const QVector<float>& buffer() const { return _buffer; }
+
+private:
+    const CASoundFont* _soundFont;
+    int _sampleRate;
+    int _frames;
+    const QList<CAPlaybackEvent>& _timeline;
+    QSet<CAVoice*> _voices;
+    QVector<float> _buffer; // interleaved stereo
+};
+
+QByteArray wavData(const QVector<qint16>& samples, int sampleRate)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    quint32 size = static_cast<quint32>(samples.size() * 2);
+    stream.writeRawData("RIFF", 4);
+    stream << quint32(36 + size);
+    stream.writeRawData("WAVE", 4);
+    stream.writeRawData("fmt ", 4);
+    stream << quint32(16) << quint16(1); // PCM
+    stream << quint16(2) << quint32(sampleRate) << quint32(sampleRate * 4); // stereo, byte rate
+    stream << quint16(4) << quint16(16); // block align, bits per sample
+    stream.writeRawData("data", 4);
+    stream << size;
+    for (qint16 sample : samples) {
+        stream << sample;
+    }
+
+    return data;
+}
+
+}
+
+/*!
+	\class CAAudioExport
+	\brief Offline rendering of the sheet to WAV or FLAC audio
+
+	Renders the sheet by the embedded CASynth instead of sending it to a midi device in real time,
+	so rehearsal tracks can be made without routing the playback through another application.
+	The events are compiled by CAPlayback the same way as for the playback, including the tempo
+	changes and repeats, and fed to the synth as fast as the CPU allows.
+
+	The voices are divided among the renderers running in the task scheduler in parallel, each
+	with its own synth. When stems() are enabled, each voice gets its own renderer and is also
+	written to a separate file next to the mix, see stemFileName(). All the files share the
+	same gain, so the stems add up to the mix:
+	\code
+	  CAAudioExport exporter(CAAudioExport::FLAC);
+	  exporter.setSoundFont("GeneralUser.sf2");
+	  exporter.setStems(true);
+	  exporter.exportSheet(sheet, "rehearsal.flac");
+	\endcode
+
+	Without a SoundFont, a simple built-in tone is used.
+*/
+
+CAAudioExport::CAAudioExport(CAAudioFormat format)
+    : _format(format)
+    , _sampleRate(DEFAULT_SAMPLE_RATE)
+    , _stems(false)
+{
+}
+
+/*!
+	Loads the SoundFont \a fileName used for rendering. An empty file name uses the built-in tone.
+	Returns True on success. Otherwise returns False and sets errorString().
+*/
+bool CAAudioExport::setSoundFont(const QString& fileName)
+{
+    if (fileName.isEmpty()) {
+        _soundFont = CASoundFont();
+        return true;
+    }
+
+    if (!_soundFont.load(fileName)) {
+        _errorString = _soundFont.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+	Renders the \a sheet and writes it to \a fileName in the current format.
+	Returns True on success. Otherwise returns False and sets errorString().
+*/
+bool CAAudioExport::exportSheet(CASheet* sheet, const QString& fileName)
+{
+    CA_TRACE_ZONE("CAAudioExport::exportSheet");
+
+    CAPlayback playback(sheet, nullptr);
+    const QList<CAPlaybackEvent>& timeline = playback.timeline();
+    QList<CAVoice*> voices = sheet->voiceList();
+    if (timeline.isEmpty() || voices.isEmpty()) {
+        _errorString = QObject::tr("The sheet has nothing to play.");
+        return false;
+    }
+
+    qint64 frames = static_cast<qint64>(std::ceil((timeline.last().msecs + RELEASE_TAIL) * _sampleRate / 1000));
+    if (frames > 0x3fffffff / 2) {
+        _errorString = QObject::tr("The sheet is too long to be rendered.");
+        return false;
+    }
+
+    // a renderer for each voice when writing the stems, otherwise the voices are split among the threads
+    int renderers = _stems ? voices.size() : qMin(voices.size(), CATaskScheduler::instance()->workerCount());
+    QVector<QSet<CAVoice*>> groups(renderers);
+    for (int i = 0; i < voices.size(); i++) {
+        groups[i % renderers] << voices[i];
+    }
+
+    std::vector<std::unique_ptr<CAAudioRenderer>> jobs;
+    for (const QSet<CAVoice*>& group : groups) {
+        jobs.emplace_back(new CAAudioRenderer(&_soundFont, _sampleRate, static_cast<int>(frames), timeline, group));
+        CATaskScheduler::instance()->start(jobs.back().get());
+    }
+    for (const std::unique_ptr<CAAudioRenderer>& job : jobs) {
+        job->wait();
+    }
+
+    QVector<float> mix(static_cast<int>(frames) * 2, 0.0f);
+    for (const std::unique_ptr<CAAudioRenderer>& job : jobs) {
+        const float* buffer = job->buffer().constData();
+        for (int i = 0; i < mix.size(); i++) {
+            mix[i] += buffer[i];
+        }
+    }
+
+    float peak = 0;
+    for (float sample : mix) {
+        peak = qMax(peak, std::fabs(sample));
+    }
+    float gain = (peak > 1) ? 1 / peak : 1; // only turned down, so the renders of different sheets are comparable
+
+    if (!writeFile(mix, gain, fileName)) {
+        return false;
+    }
+
+    if (_stems) {
+        for (int i = 0; i < voices.size(); i++) {
+            if (!writeFile(jobs[i]->buffer(), gain, stemFileName(fileName, voices[i], i))) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/*!
+	Returns the file name of the stem of the \a voice with the given \a index derived from the
+	mix \a fileName, eg. "song-1-Piano-Voice 1.wav" for "song.wav".
+*/
+QString CAAudioExport::stemFileName(const QString& fileName, CAVoice* voice, int index)
+{
+    QFileInfo info(fileName);
+    QString name = QString::number(index + 1);
+    if (voice->staff()) {
+        name += "-" + voice->staff()->name();
+    }
+    name += "-" + voice->name();
+    name.replace(QRegExp("[\\\\/:*?\"<>|]"), "_");
+
+    return info.path() + "/" + info.completeBaseName() + "-" + name + "." + info.suffix();
+}
+
+bool CAAudioExport::writeFile(const QVector<float>& buffer, float gain, const QString& fileName)
+{
+    QVector<qint16> samples(buffer.size());
+    for (int i = 0; i < buffer.size(); i++) {
+        samples[i] = static_cast<qint16>(qBound(-32768L, std::lround(buffer[i] * gain * 32767), 32767L));
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        _errorString = QObject::tr("Unable to write %1.").arg(fileName);
+        return false;
+    }
+
+    QByteArray data = (_format == FLAC) ? CAFlacWriter(_sampleRate, 2).encode(samples) : wavData(samples, _sampleRate);
+    if (file.write(data) != data.size()) {
+        _errorString = QObject::tr("Unable to write %1.").arg(fileName);
+        return false;
+    }
+
+    return true;
+}
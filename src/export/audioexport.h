@@ -0,0 +1,55 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef AUDIOEXPORT_H_
+#define AUDIOEXPORT_H_
+
+#include <QString>
+#include <QVector>
+
+#include "interface/soundfont.h"
+
+class CASheet;
+class CAVoice;
+
+class CAAudioExport {
+public:
+    enum CAAudioFormat {
+        WAV,
+        FLAC
+    };
+
+    CAAudioExport(CAAudioFormat format = WAV);
+
+    inline CAAudioFormat format() { return _format; }
+    inline void setFormat(CAAudioFormat format) { _format = format; }
+    inline int sampleRate() { return _sampleRate; }
+    inline void setSampleRate(int sampleRate) { _sampleRate = sampleRate; }
+    inline bool stems() { return _stems; }
+    inline void setStems(bool stems) { _stems = stems; }
+    bool setSoundFont(const QString& fileName);
+    inline const CASoundFont& soundFont() { return _soundFont; }
+
+    bool exportSheet(CASheet* sheet, const QString& fileName);
+    inline const QString& errorString() { return _errorString; }
+
+    static QString stemFileName(const QString& fileName, CAVoice* voice, int index);
+
+    static const int DEFAULT_SAMPLE_RATE;
+    static const int RELEASE_TAIL;
+
+private:
+    bool writeFile(const QVector<float>& buffer, float gain, const QString& fileName);
+
+    CAAudioFormat _format;
+    int _sampleRate;
+    bool _stems; // also write each voice to its own file
+    CASoundFont _soundFont; // empty for the built-in tone
+    QString _errorString;
+};
+
+#endif /* AUDIOEXPORT_H_ */
@@ -0,0 +1,223 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#include <QtEndian>
+
+#include "core/fileformats.h"
+#include "export/binarymlwriter.h"
+#include "import/binarymlreader.h"
+
+namespace {
+
+// elements written as length-prefixed sections
+bool isSection(const QString& name)
+{
+    return name == QLatin1String("sheet") || name == QLatin1String("staff") || name == QLatin1String("voice")
+        || name == QLatin1String("lyrics-context") || name == QLatin1String("figured-bass-context")
+        || name == QLatin1String("function-mark-context") || name == QLatin1String("chord-name-context");
+}
+
+}
+
+/*!
+	\class CABinaryMLWriter
+	\brief Writer of the binary CanorusML
+
+	Binary CanorusML stores the same elements, attributes and text as the CanorusML XML, but as a
+	compact token stream with all the names and values kept once in a string table. It offers
+	the subset of the QXmlStreamWriter interface used by CACanorusMLExport, so the same export code
+	writes both formats. See CABinaryMLReader for the description of the format.
+
+	The whole document is kept in memory and returned by data() when the writing is finished.
+
+	\sa CABinaryMLReader, CACanorusMLExport
+*/
+
+CABinaryMLWriter::CABinaryMLWriter()
+    : _pendingEmpty(false)
+{
+}
+
+void CABinaryMLWriter::writeEndDocument()
+{
+    flushStartElement();
+    while (!_openSections.isEmpty()) {
+        writeEndElement();
+    }
+}
+
+void CABinaryMLWriter::writeStartElement(const QString& name)
+{
+    flushStartElement();
+    _pendingName = name;
+    _pendingEmpty = false;
+}
+
+void CABinaryMLWriter::writeEmptyElement(const QString& name)
+{
+    flushStartElement();
+    _pendingName = name;
+    _pendingEmpty = true;
+}
+
+/*!
+	Adds the attribute to the last started element. Attributes written after the element content
+	are ignored the same as with QXmlStreamWriter.
+*/
+void CABinaryMLWriter::writeAttribute(const QString& name, const QString& value)
+{
+    if (!_pendingName.isEmpty()) {
+        _pendingAttributes << name << value;
+    }
+}
+
+void CABinaryMLWriter::writeCharacters(const QString& text)
+{
+    flushStartElement();
+    _events.append(static_cast<char>(CABinaryMLReader::CharactersToken));
+    writeString(text);
+}
+
+void CABinaryMLWriter::writeTextElement(const QString& name, const QString& text)
+{
+    writeStartElement(name);
+    writeCharacters(text);
+    writeEndElement();
+}
+
+/*!
+	Closes the last open element. If the element is a section, its length is filled in.
+*/
+void CABinaryMLWriter::writeEndElement()
+{
+    flushStartElement();
+    if (_openSections.isEmpty()) {
+        return;
+    }
+
+    _events.append(static_cast<char>(CABinaryMLReader::EndElementToken));
+
+    int lengthPos = _openSections.takeLast();
+    if (lengthPos >= 0) {
+        qToLittleEndian<quint32>(static_cast<quint32>(_events.size() - lengthPos - 4), reinterpret_cast<uchar*>(_events.data() + lengthPos));
+    }
+}
+
+/*!
+	Returns the written document: the header, the string table section and the token section.
+	The open elements are closed first.
+*/
+QByteArray CABinaryMLWriter::data()
+{
+    writeEndDocument();
+
+    QByteArray strings;
+    strings.reserve(_strings.size() * 8);
+    for (const QString& string : _strings) {
+        QByteArray utf8 = string.toUtf8();
+        quint32 size = static_cast<quint32>(utf8.size());
+        while (size >= 0x80) {
+            strings.append(static_cast<char>((size & 0x7f) | 0x80));
+            size >>= 7;
+        }
+        strings.append(static_cast<char>(size));
+        strings.append(utf8);
+    }
+
+    QByteArray out;
+    out.reserve(CABinaryMLReader::HEADER_SIZE + 12 + strings.size() + _events.size());
+    out.append(CAFileFormats::CANORUSML_BINARY_MAGIC);
+    uchar header[4];
+    qToLittleEndian<quint16>(CAFileFormats::CANORUSML_BINARY_VERSION, header);
+    qToLittleEndian<quint16>(0, header + 2); // flags, reserved
+    out.append(reinterpret_cast<const char*>(header), 4);
+
+    uchar length[4];
+    qToLittleEndian<quint32>(static_cast<quint32>(_strings.size()), length);
+    out.append(reinterpret_cast<const char*>(length), 4);
+    qToLittleEndian<quint32>(static_cast<quint32>(strings.size()), length);
+    out.append(reinterpret_cast<const char*>(length), 4);
+    out.append(strings);
+
+    qToLittleEndian<quint32>(static_cast<quint32>(_events.size()), length);
+    out.append(reinterpret_cast<const char*>(length), 4);
+    out.append(_events);
+
+    return out;
+}
+
+/*!
+	Writes the start element waiting for its attributes, if any.
+*/
+void CABinaryMLWriter::flushStartElement()
+{
+    if (_pendingName.isEmpty()) {
+        return;
+    }
+
+    bool section = !_pendingEmpty && isSection(_pendingName);
+    _events.append(static_cast<char>(section ? CABinaryMLReader::StartSectionToken : CABinaryMLReader::StartElementToken));
+    writeString(_pendingName);
+    writeVarInt(static_cast<quint32>(_pendingAttributes.size() / 2));
+    for (const QString& s : _pendingAttributes) {
+        writeString(s);
+    }
+
+    if (_pendingEmpty) {
+        _events.append(static_cast<char>(CABinaryMLReader::EndElementToken));
+    } else if (section) {
+        _openSections << _events.size();
+        writeUInt32(0); // filled in by writeEndElement()
+    } else {
+        _openSections << -1;
+    }
+
+    _pendingName.clear();
+    _pendingAttributes.clear();
+    _pendingEmpty = false;
+}
+
+/*!
+	Writes the index of the \a string in the string table. The string is added to the table, if
+	it is not there yet.
+*/
+void CABinaryMLWriter::writeString(const QString& string)
+{
+    QHash<QString, quint32>::const_iterator it = _stringIndex.constFind(string);
+    if (it == _stringIndex.constEnd()) {
+        it = _stringIndex.insert(string, static_cast<quint32>(_strings.size()));
+        _strings << string;
+    }
+
+    writeVarInt(it.value());
+}
+
+/*!
+	Writes the \a value in 7 bits per byte, starting with the lowest ones. The highest bit is set
+	when more bytes follow.
+*/
+void CABinaryMLWriter::writeVarInt(quint32 value)
+{
+    while (value >= 0x80) {
+        _events.append(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    _events.append(static_cast<char>(value));
+}
+
+void CABinaryMLWriter::writeUInt32(quint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian<quint32>(value, bytes);
+    _events.append(reinterpret_cast<const char*>(bytes), 4);
+}
+
+/*!
+	\var CABinaryMLWriter::_openSections
+	Stack of the open elements. Sections hold the position of their length in the token stream,
+	which is written when the section is closed.
+*/
@@ -0,0 +1,52 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#ifndef BINARYMLWRITER_H_
+#define BINARYMLWRITER_H_
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+class CABinaryMLWriter {
+public:
+    CABinaryMLWriter();
+
+    // QXmlStreamWriter compatible interface used by CACanorusMLExport
+    inline void setAutoFormatting(bool) {}
+    inline void setAutoFormattingIndent(int) {}
+    inline void writeStartDocument() {}
+    inline void writeDTD(const QString&) {}
+    void writeEndDocument();
+    void writeStartElement(const QString& name);
+    void writeEmptyElement(const QString& name);
+    void writeAttribute(const QString& name, const QString& value);
+    void writeCharacters(const QString& text);
+    void writeTextElement(const QString& name, const QString& text);
+    void writeEndElement();
+
+    QByteArray data();
+
+private:
+    void flushStartElement();
+    void writeString(const QString& string);
+    void writeVarInt(quint32 value);
+    void writeUInt32(quint32 value);
+
+    QByteArray _events; // token stream, the string table is prepended by data()
+    QHash<QString, quint32> _stringIndex; // string -> index in the string table
+    QVector<QString> _strings; // string table
+
+    QString _pendingName; // start element waiting for its attributes, empty if none
+    QVector<QString> _pendingAttributes; // names and values
+    bool _pendingEmpty; // is the pending element written by writeEmptyElement()
+
+    QVector<int> _openSections; // positions of the section lengths, -1 for plain elements
+};
+
+#endif /* BINARYMLWRITER_H_ */
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2007, Matevž Jekovec, Itay Perl, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Itay Perl, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -8,17 +8,22 @@
 #include "export/canexport.h"
 #include "core/archive.h"
 #include "export/canorusmlexport.h"
+#include "layout/sheetlayout.h"
 
 #include "score/document.h"
 #include "score/resource.h"
 
 #include <QFile>
 #include <QFileInfo>
+#include <QSet>
 #include <QTemporaryFile>
 #include <QTextStream>
 
 CACanExport::CACanExport(QTextStream* stream)
     : CAExport(stream)
+    , _archive(nullptr)
+    , _binaryContent(false)
+    , _journaled(false)
 {
 }
 
@@ -26,28 +31,69 @@ CACanExport::~CACanExport()
 {
 }
 
+/*!
+	Writes the document to the Canorus archive.
+	The score is stored as content.xml in CanorusML or, if binaryContent() is set, as content.bin
+	in binary CanorusML. The other one is removed from the archive, so a file written by an older
+	version of Canorus is never read instead of the current score.
+
+	The attached resources are stored under the hash of their content (see
+	CAResource::storedFileName()). When the document is saved again, only the new and changed
+	resources are copied into the archive.
+
+	If journaled() is set, only the changed files are appended to the end of the archive as a
+	journal entry (see CAArchive::appendJournal()) and the stream should be opened for appending.
+	The whole archive is written otherwise, which also compacts the journal.
+*/
 void CACanExport::exportDocumentImpl(CADocument* doc)
 {
     // Write the score
     QBuffer score;
     CACanorusMLExport* content = new CACanorusMLExport();
+    content->setBinary(binaryContent());
     content->setStreamToDevice(&score);
+    content->setProgressToken(progressToken());
     content->exportDocument(doc);
     content->wait();
+    int contentStatus = content->status();
     delete content;
 
-    QString fileName = "content.xml";
-    if (!doc->archive()->addFile(fileName, score)) {
+    if (isCanceled()) {
+        return; // the archive is left unchanged
+    }
+    if (contentStatus < 0 || !doc->archive()->addFile(binaryContent() ? "content.bin" : "content.xml", score)) {
         setStatus(-2);
         return;
     }
+    doc->archive()->removeFile(binaryContent() ? "content.xml" : "content.bin");
+    QString fileName = "content.xml"; // resources are stored in "content.xml files/" in both cases
+
+    // Write the layout hints for a faster reopen
+    QByteArray layout = CASheetLayout::saveLayoutHints(doc, score.data());
+    if (layout.isEmpty()) {
+        doc->archive()->removeFile("layout.xml");
+    } else {
+        doc->archive()->addFile("layout.xml", layout);
+    }
 
+    // Write the attached resources named by their content, the unchanged ones are already in the archive
+    QSet<QString> resources;
     for (int i = 0; i < doc->resourceList().size(); i++) {
         std::shared_ptr<CAResource> r = doc->resourceList()[i];
         if (!r->isLinked()) {
-            // /tmp/qt_tempXXXXX -> qt_tempXXXXX
-            QFile target(r->url().toLocalFile());
-            doc->archive()->addFile(fileName + " files/" + QFileInfo(target).fileName(), target);
+            QString name = fileName + " files/" + r->storedFileName();
+            resources << name;
+            if (!doc->archive()->contains(name)) {
+                QFile target(r->url().toLocalFile());
+                doc->archive()->addFile(name, target);
+            }
+        }
+    }
+
+    // Remove the resources deleted or changed since the last save
+    for (const QString& name : doc->archive()->fileNames()) {
+        if (name.startsWith(fileName + " files/") && !resources.contains(name)) {
+            doc->archive()->removeFile(name);
         }
     }
 
@@ -60,7 +106,19 @@ void CACanExport::exportDocumentImpl(CADocument* doc)
         }
     }
 
-    // Save the archive
-    doc->archive()->write(*stream()->device());
-    setStatus(0); // done
+    // Save the archive or append the changes to it
+    stream()->flush();
+    qint64 written = journaled() ? doc->archive()->appendJournal(*stream()->device()) : doc->archive()->write(*stream()->device());
+    setStatus(written < 0 ? -2 : 0); // done
+}
+
+/*!
+	Returns True, if the changes of the document \a doc can be appended to the file \a fileName
+	it was opened from or saved to last time, instead of writing the whole archive again.
+
+	\sa setJournaled(), CAArchive::canAppendJournal()
+*/
+bool CACanExport::canAppendJournal(CADocument* doc, const QString& fileName)
+{
+    return doc && doc->archive() && doc->archive()->canAppendJournal(fileName);
 }
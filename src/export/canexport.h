@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2007-2019, Matevž Jekovec, Itay Perl, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Itay Perl, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 	
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -20,11 +20,20 @@ public:
     inline CAArchive* archive() { return _archive; }
     inline void setArchive(CAArchive* a) { _archive = a; }
 
+    inline bool binaryContent() { return _binaryContent; }
+    inline void setBinaryContent(bool binary) { _binaryContent = binary; }
+
+    inline bool journaled() { return _journaled; }
+    inline void setJournaled(bool journaled) { _journaled = journaled; }
+    static bool canAppendJournal(CADocument* doc, const QString& fileName);
+
 protected:
     void exportDocumentImpl(CADocument* doc);
 
 private:
     CAArchive* _archive;
+    bool _binaryContent; // store the score as content.bin instead of content.xml
+    bool _journaled; // append the changes to the file instead of writing the whole archive
 };
 
 #endif /* CANEXPORT_H_ */
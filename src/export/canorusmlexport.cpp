@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -7,11 +7,13 @@
 
 #include <QDebug>
 #include <QDir>
-#include <QDomDocument>
+#include <QFile>
 #include <QString>
 #include <QTextStream>
 #include <QVariant>
+#include <QXmlStreamWriter>
 
+#include "export/binarymlwriter.h"
 #include "export/canorusmlexport.h"
 
 #include "score/barline.h"
@@ -55,7 +57,9 @@
 
 CACanorusMLExport::CACanorusMLExport(QTextStream* stream)
     : CAExport(stream)
+    , _binary(false)
 {
+    _tupletOpen = false;
 }
 
 CACanorusMLExport::~CACanorusMLExport()
@@ -64,237 +68,302 @@ CACanorusMLExport::~CACanorusMLExport()
 
 /*!
 	Saves the document to CanorusML XML format.
-	It uses DOM object internally for writing the XML output.
+	It uses QXmlStreamWriter internally and writes the elements directly to the output device while
+	walking the document, so no DOM tree of the whole score is built in memory.
+
+	If binary() is set, the document is written in binary CanorusML by CABinaryMLWriter instead.
+	The binary output needs a device to write to.
 */
 void CACanorusMLExport::exportDocumentImpl(CADocument* doc)
 {
-    //int depth = 0;
+    out().setCodec("UTF-8");
 
+    if (binary()) {
+        if (!out().device()) {
+            setStatus(-1);
+            return;
+        }
+        out().flush();
+        CABinaryMLWriter writer;
+        exportDocument(doc, writer);
+        if (out().device()->write(writer.data()) == -1) {
+            setStatus(-1);
+        }
+    } else if (out().device()) {
+        out().flush();
+        QXmlStreamWriter xml(out().device());
+        exportDocument(doc, xml);
+    } else {
+        // stream without device, usually set by setStreamToString()
+        QString string;
+        QXmlStreamWriter xml(&string);
+        exportDocument(doc, xml);
+        out() << string;
+    }
+}
+
+/*!
+	Saves the sheet alone to CanorusML XML format.
+	The output contains the sheet element only. It is used for comparing the sheets, but cannot be
+	opened as a document.
+*/
+void CACanorusMLExport::exportSheetImpl(CASheet* sheet)
+{
     out().setCodec("UTF-8");
 
-    // CADocument
-    QDomDocument dDoc("canorusml");
+    if (out().device()) {
+        out().flush();
+        QXmlStreamWriter xml(out().device());
+        exportSheet(sheet, xml);
+    } else {
+        QString string;
+        QXmlStreamWriter xml(&string);
+        exportSheet(sheet, xml);
+        out() << string;
+    }
+}
 
-    // Add encoding
-    dDoc.appendChild(dDoc.createProcessingInstruction("xml", "version=\"1.0\" encoding=\"UTF-8\" "));
+/*!
+	Writes the document \a doc with all its sheets and resources to the \a xml writer.
+	This method is usually called by exportDocumentImpl(). The writer is either QXmlStreamWriter or
+	CABinaryMLWriter.
+*/
+template <class Writer>
+void CACanorusMLExport::exportDocument(CADocument* doc, Writer& xml)
+{
+    xml.setAutoFormatting(true);
+    xml.setAutoFormattingIndent(1);
+    xml.writeStartDocument();
+    xml.writeDTD("<!DOCTYPE canorusml>");
 
     // Root node - <canorus-document>
-    QDomElement dCanorusDocument = dDoc.createElement("canorus-document");
-    dDoc.appendChild(dCanorusDocument);
+    xml.writeStartElement("canorus-document");
     // Add program version
-    QDomElement dCanorusVersion = dDoc.createElement("canorus-version");
-    dCanorusDocument.appendChild(dCanorusVersion);
-    dCanorusVersion.appendChild(dDoc.createTextNode(CANORUS_VERSION));
+    xml.writeTextElement("canorus-version", CANORUS_VERSION);
 
     // Document content node - <document>
-    QDomElement dDocument = dDoc.createElement("document");
-    dCanorusDocument.appendChild(dDocument);
+    xml.writeStartElement("document");
 
     if (!doc->title().isEmpty())
-        dDocument.setAttribute("title", doc->title());
+        xml.writeAttribute("title", doc->title());
     if (!doc->subtitle().isEmpty())
-        dDocument.setAttribute("subtitle", doc->subtitle());
+        xml.writeAttribute("subtitle", doc->subtitle());
     if (!doc->composer().isEmpty())
-        dDocument.setAttribute("composer", doc->composer());
+        xml.writeAttribute("composer", doc->composer());
     if (!doc->arranger().isEmpty())
-        dDocument.setAttribute("arranger", doc->arranger());
+        xml.writeAttribute("arranger", doc->arranger());
     if (!doc->poet().isEmpty())
-        dDocument.setAttribute("poet", doc->poet());
+        xml.writeAttribute("poet", doc->poet());
     if (!doc->textTranslator().isEmpty())
-        dDocument.setAttribute("text-translator", doc->textTranslator());
+        xml.writeAttribute("text-translator", doc->textTranslator());
     if (!doc->dedication().isEmpty())
-        dDocument.setAttribute("dedication", doc->dedication());
+        xml.writeAttribute("dedication", doc->dedication());
     if (!doc->copyright().isEmpty())
-        dDocument.setAttribute("copyright", doc->copyright());
+        xml.writeAttribute("copyright", doc->copyright());
     if (!doc->comments().isEmpty())
-        dDocument.setAttribute("comments", doc->comments());
-
-    dDocument.setAttribute("date-created", doc->dateCreated().toString(Qt::ISODate));
-    dDocument.setAttribute("date-last-modified", doc->dateLastModified().toString(Qt::ISODate));
-    dDocument.setAttribute("time-edited", doc->timeEdited());
-
-    for (int sheetIdx = 0; sheetIdx < doc->sheetList().size(); sheetIdx++) {
-        setProgress(qRound((static_cast<float>(sheetIdx) / doc->sheetList().size()) * 100));
-
-        // CASheet
-        QDomElement dSheet = dDoc.createElement("sheet");
-        dDocument.appendChild(dSheet);
-        dSheet.setAttribute("name", doc->sheetList()[sheetIdx]->name());
-
-        for (int contextIdx = 0; contextIdx < doc->sheetList()[sheetIdx]->contextList().size(); contextIdx++) {
-            // (CAContext)
-            CAContext* c = doc->sheetList()[sheetIdx]->contextList()[contextIdx];
-
-            switch (c->contextType()) {
-            case CAContext::Staff: {
-                // CAStaff
-                CAStaff* staff = static_cast<CAStaff*>(c);
-                QDomElement dStaff = dDoc.createElement("staff");
-                dSheet.appendChild(dStaff);
-                dStaff.setAttribute("name", staff->name());
-                dStaff.setAttribute("number-of-lines", staff->numberOfLines());
-
-                for (int voiceIdx = 0; voiceIdx < staff->voiceList().size(); voiceIdx++) {
-                    // CAVoice
-                    CAVoice* v = staff->voiceList()[voiceIdx];
-                    QDomElement dVoice = dDoc.createElement("voice");
-                    dStaff.appendChild(dVoice);
-                    dVoice.setAttribute("name", v->name());
-                    dVoice.setAttribute("midi-channel", v->midiChannel());
-                    dVoice.setAttribute("midi-program", v->midiProgram());
-                    dVoice.setAttribute("midi-pitch-offset", v->midiPitchOffset());
-                    dVoice.setAttribute("stem-direction", CANote::stemDirectionToString(v->stemDirection()));
-
-                    exportVoiceImpl(v, dVoice); // writes notes, clefs etc.
-                }
+        xml.writeAttribute("comments", doc->comments());
 
-                break;
-            }
-            case CAContext::LyricsContext: {
-                // CALyricsContext
-                CALyricsContext* lc = static_cast<CALyricsContext*>(c);
-                QDomElement dlc = dDoc.createElement("lyrics-context");
-                dSheet.appendChild(dlc);
-                dlc.setAttribute("name", lc->name());
-                dlc.setAttribute("stanza-number", lc->stanzaNumber());
-                dlc.setAttribute("associated-voice-idx", doc->sheetList()[sheetIdx]->voiceList().indexOf(lc->associatedVoice()));
-
-                QList<CASyllable*> syllables = lc->syllableList();
-                for (int i = 0; i < syllables.size(); i++) {
-                    QDomElement s = dDoc.createElement("syllable");
-                    dlc.appendChild(s);
-                    s.setAttribute("time-start", syllables[i]->timeStart());
-                    s.setAttribute("time-length", syllables[i]->timeLength());
-                    s.setAttribute("text", syllables[i]->text());
-                    s.setAttribute("hyphen", syllables[i]->hyphenStart());
-                    s.setAttribute("melisma", syllables[i]->melismaStart());
-
-                    if (syllables[i]->associatedVoice() && doc->sheetList()[sheetIdx]->voiceList().contains(syllables[i]->associatedVoice())) {
-                        s.setAttribute("associated-voice-idx", doc->sheetList()[sheetIdx]->voiceList().indexOf(syllables[i]->associatedVoice()));
-                    }
-                }
+    xml.writeAttribute("date-created", doc->dateCreated().toString(Qt::ISODate));
+    xml.writeAttribute("date-last-modified", doc->dateLastModified().toString(Qt::ISODate));
+    xml.writeAttribute("time-edited", QString::number(doc->timeEdited()));
 
-                break;
-            }
-            case CAContext::FiguredBassContext: {
-                exportFiguredBass(static_cast<CAFiguredBassContext*>(c), dSheet);
-                break;
-            }
-            case CAContext::FunctionMarkContext: {
-                // CAFunctionMarkContext
-                CAFunctionMarkContext* fmc = static_cast<CAFunctionMarkContext*>(c);
-                QDomElement dFmc = dDoc.createElement("function-mark-context");
-                dSheet.appendChild(dFmc);
-                dFmc.setAttribute("name", fmc->name());
-
-                QList<CAFunctionMark*> elts = fmc->functionMarkList();
-                for (int i = 0; i < elts.size(); i++) {
-                    QDomElement dFm = dDoc.createElement("function-mark");
-                    dFmc.appendChild(dFm);
-                    dFm.setAttribute("time-start", elts[i]->timeStart());
-                    dFm.setAttribute("time-length", elts[i]->timeLength());
-                    dFm.setAttribute("function", CAFunctionMark::functionTypeToString(elts[i]->function()));
-                    dFm.setAttribute("minor", elts[i]->isMinor());
-                    dFm.setAttribute("chord-area", CAFunctionMark::functionTypeToString(elts[i]->chordArea()));
-                    dFm.setAttribute("chord-area-minor", elts[i]->isChordAreaMinor());
-                    dFm.setAttribute("tonic-degree", CAFunctionMark::functionTypeToString(elts[i]->tonicDegree()));
-                    dFm.setAttribute("tonic-degree-minor", elts[i]->isTonicDegreeMinor());
-                    exportDiatonicKey(elts[i]->key(), dFm);
-                    //dFm.setAttribute( "altered-degrees", elts[i]->alteredDegrees() );
-                    //dFm.setAttribute( "added-degrees", elts[i]->addedDegrees() );
-                    dFm.setAttribute("ellipse", elts[i]->isPartOfEllipse());
-                }
-                break;
-            }
-            case CAContext::ChordNameContext: {
-                // CAChordNameContext
-                CAChordNameContext* cnc = static_cast<CAChordNameContext*>(c);
-                QDomElement dCnc = dDoc.createElement("chord-name-context");
-                dSheet.appendChild(dCnc);
-                dCnc.setAttribute("name", cnc->name());
-
-                QList<CAChordName*> elts = cnc->chordNameList();
-                for (int i = 0; i < elts.size(); i++) {
-                    QDomElement dCn = dDoc.createElement("chord-name");
-                    dCnc.appendChild(dCn);
-                    dCn.setAttribute("time-start", elts[i]->timeStart());
-                    dCn.setAttribute("time-length", elts[i]->timeLength());
-                    exportDiatonicPitch(elts[i]->diatonicPitch(), dCn);
-                    dCn.setAttribute("quality-modifier", elts[i]->qualityModifier());
+    for (int sheetIdx = 0; sheetIdx < doc->sheetList().size() && !isCanceled(); sheetIdx++) {
+        setProgress(sheetIdx, doc->sheetList().size());
+
+        exportSheet(doc->sheetList()[sheetIdx], xml);
+    }
+
+    xml.writeEndElement(); // document
+
+    exportResources(doc, xml);
+
+    xml.writeEndElement(); // canorus-document
+    xml.writeEndDocument();
+}
+
+/*!
+	Writes the \a sheet with all its contexts to the \a xml writer.
+*/
+template <class Writer>
+void CACanorusMLExport::exportSheet(CASheet* sheet, Writer& xml)
+{
+    xml.writeStartElement("sheet");
+    xml.writeAttribute("name", sheet->name());
+
+    for (int contextIdx = 0; contextIdx < sheet->contextList().size(); contextIdx++) {
+        // (CAContext)
+        CAContext* c = sheet->contextList()[contextIdx];
+
+        switch (c->contextType()) {
+        case CAContext::Staff: {
+            // CAStaff
+            CAStaff* staff = static_cast<CAStaff*>(c);
+            xml.writeStartElement("staff");
+            xml.writeAttribute("name", staff->name());
+            xml.writeAttribute("number-of-lines", QString::number(staff->numberOfLines()));
+            if (staff->isFrozen())
+                xml.writeAttribute("frozen", "1");
+
+            for (int voiceIdx = 0; voiceIdx < staff->voiceList().size(); voiceIdx++) {
+                // CAVoice
+                CAVoice* v = staff->voiceList()[voiceIdx];
+                xml.writeStartElement("voice");
+                xml.writeAttribute("name", v->name());
+                xml.writeAttribute("midi-channel", QString::number(v->midiChannel()));
+                xml.writeAttribute("midi-program", QString::number(v->midiProgram()));
+                xml.writeAttribute("midi-pitch-offset", QString::number(v->midiPitchOffset()));
+                if (!v->midiPort().isEmpty())
+                    xml.writeAttribute("midi-port", v->midiPort());
+                xml.writeAttribute("stem-direction", CANote::stemDirectionToString(v->stemDirection()));
+
+                exportVoiceImpl(v, xml); // writes notes, clefs etc.
+
+                xml.writeEndElement(); // voice
+            }
+
+            xml.writeEndElement(); // staff
+            break;
+        }
+        case CAContext::LyricsContext: {
+            // CALyricsContext
+            CALyricsContext* lc = static_cast<CALyricsContext*>(c);
+            xml.writeStartElement("lyrics-context");
+            xml.writeAttribute("name", lc->name());
+            xml.writeAttribute("stanza-number", QString::number(lc->stanzaNumber()));
+            xml.writeAttribute("associated-voice-idx", QString::number(sheet->voiceList().indexOf(lc->associatedVoice())));
+
+            QList<CASyllable*> syllables = lc->syllableList();
+            for (int i = 0; i < syllables.size(); i++) {
+                xml.writeEmptyElement("syllable");
+                xml.writeAttribute("time-start", QString::number(syllables[i]->timeStart()));
+                xml.writeAttribute("time-length", QString::number(syllables[i]->timeLength()));
+                xml.writeAttribute("text", syllables[i]->text());
+                xml.writeAttribute("hyphen", QString::number(syllables[i]->hyphenStart()));
+                xml.writeAttribute("melisma", QString::number(syllables[i]->melismaStart()));
+
+                if (syllables[i]->associatedVoice() && sheet->voiceList().contains(syllables[i]->associatedVoice())) {
+                    xml.writeAttribute("associated-voice-idx", QString::number(sheet->voiceList().indexOf(syllables[i]->associatedVoice())));
                 }
-                break;
-            }
             }
+
+            xml.writeEndElement(); // lyrics-context
+            break;
+        }
+        case CAContext::FiguredBassContext: {
+            exportFiguredBass(static_cast<CAFiguredBassContext*>(c), xml);
+            break;
+        }
+        case CAContext::FunctionMarkContext: {
+            // CAFunctionMarkContext
+            CAFunctionMarkContext* fmc = static_cast<CAFunctionMarkContext*>(c);
+            xml.writeStartElement("function-mark-context");
+            xml.writeAttribute("name", fmc->name());
+
+            QList<CAFunctionMark*> elts = fmc->functionMarkList();
+            for (int i = 0; i < elts.size(); i++) {
+                xml.writeStartElement("function-mark");
+                xml.writeAttribute("time-start", QString::number(elts[i]->timeStart()));
+                xml.writeAttribute("time-length", QString::number(elts[i]->timeLength()));
+                xml.writeAttribute("function", CAFunctionMark::functionTypeToString(elts[i]->function()));
+                xml.writeAttribute("minor", QString::number(elts[i]->isMinor()));
+                xml.writeAttribute("chord-area", CAFunctionMark::functionTypeToString(elts[i]->chordArea()));
+                xml.writeAttribute("chord-area-minor", QString::number(elts[i]->isChordAreaMinor()));
+                xml.writeAttribute("tonic-degree", CAFunctionMark::functionTypeToString(elts[i]->tonicDegree()));
+                xml.writeAttribute("tonic-degree-minor", QString::number(elts[i]->isTonicDegreeMinor()));
+                //xml.writeAttribute( "altered-degrees", elts[i]->alteredDegrees() );
+                //xml.writeAttribute( "added-degrees", elts[i]->addedDegrees() );
+                xml.writeAttribute("ellipse", QString::number(elts[i]->isPartOfEllipse()));
+                exportDiatonicKey(elts[i]->key(), xml);
+                xml.writeEndElement(); // function-mark
+            }
+
+            xml.writeEndElement(); // function-mark-context
+            break;
+        }
+        case CAContext::ChordNameContext: {
+            // CAChordNameContext
+            CAChordNameContext* cnc = static_cast<CAChordNameContext*>(c);
+            xml.writeStartElement("chord-name-context");
+            xml.writeAttribute("name", cnc->name());
+
+            QList<CAChordName*> elts = cnc->chordNameList();
+            for (int i = 0; i < elts.size(); i++) {
+                xml.writeStartElement("chord-name");
+                xml.writeAttribute("time-start", QString::number(elts[i]->timeStart()));
+                xml.writeAttribute("time-length", QString::number(elts[i]->timeLength()));
+                xml.writeAttribute("quality-modifier", elts[i]->qualityModifier());
+                exportDiatonicPitch(elts[i]->diatonicPitch(), xml);
+                xml.writeEndElement(); // chord-name
+            }
+
+            xml.writeEndElement(); // chord-name-context
+            break;
+        }
         }
     }
 
-    exportResources(doc, dCanorusDocument);
-
-    out() << dDoc.toString();
+    xml.writeEndElement(); // sheet
 }
 
 /*!
 	Used for writing the voice node in XML output.
-	It uses DOM object internally for writing the XML output.
-	This method is usually called by saveDocument().
+	Attributes of each element are written first, followed by its playable length, pitch, slurs
+	and marks as the child elements.
+	This method is usually called by exportDocument().
 
 	\sa exportDocumentImpl()
 */
-void CACanorusMLExport::exportVoiceImpl(CAVoice* voice, QDomElement& dVoice)
+template <class Writer>
+void CACanorusMLExport::exportVoiceImpl(CAVoice* voice, Writer& xml)
 {
-    QDomDocument dDoc = dVoice.ownerDocument();
     for (int i = 0; i < voice->musElementList().size(); i++) {
         CAMusElement* curElt = voice->musElementList()[i];
-        QDomElement dElt;
         switch (curElt->musElementType()) {
         case CAMusElement::Note: {
             CANote* note = static_cast<CANote*>(curElt);
 
             if (note->isFirstInTuplet()) {
-                _dTuplet = dDoc.createElement("tuplet");
-                _dTuplet.setAttribute("number", note->tuplet()->number());
-                _dTuplet.setAttribute("actual-number", note->tuplet()->actualNumber());
-                dVoice.appendChild(_dTuplet);
+                startTuplet(note->tuplet(), xml);
             }
 
-            dElt = dDoc.createElement("note");
-            if (note->tuplet()) {
-                _dTuplet.appendChild(dElt);
-            } else {
-                dVoice.appendChild(dElt);
-            }
+            xml.writeStartElement("note");
 
             if (note->stemDirection() != CANote::StemPreferred)
-                dElt.setAttribute("stem-direction", CANote::stemDirectionToString(note->stemDirection()));
+                xml.writeAttribute("stem-direction", CANote::stemDirectionToString(note->stemDirection()));
+
+            exportTime(curElt, xml);
+            exportColor(curElt, xml);
 
-            exportPlayableLength(note->playableLength(), dElt);
-            exportDiatonicPitch(note->diatonicPitch(), dElt);
+            exportPlayableLength(note->playableLength(), xml);
+            exportDiatonicPitch(note->diatonicPitch(), xml);
 
             if (note->tieStart()) {
-                QDomElement dTie = dDoc.createElement("tie");
-                dElt.appendChild(dTie);
-                dTie.setAttribute("slur-style", CASlur::slurStyleToString(note->tieStart()->slurStyle()));
-                dTie.setAttribute("slur-direction", CASlur::slurDirectionToString(note->tieStart()->slurDirection()));
+                xml.writeEmptyElement("tie");
+                xml.writeAttribute("slur-style", CASlur::slurStyleToString(note->tieStart()->slurStyle()));
+                xml.writeAttribute("slur-direction", CASlur::slurDirectionToString(note->tieStart()->slurDirection()));
             }
             if (note->slurStart()) {
-                QDomElement dSlur = dDoc.createElement("slur-start");
-                dElt.appendChild(dSlur);
-                dSlur.setAttribute("slur-style", CASlur::slurStyleToString(note->slurStart()->slurStyle()));
-                dSlur.setAttribute("slur-direction", CASlur::slurDirectionToString(note->slurStart()->slurDirection()));
+                xml.writeEmptyElement("slur-start");
+                xml.writeAttribute("slur-style", CASlur::slurStyleToString(note->slurStart()->slurStyle()));
+                xml.writeAttribute("slur-direction", CASlur::slurDirectionToString(note->slurStart()->slurDirection()));
             }
             if (note->slurEnd()) {
-                QDomElement dSlur = dDoc.createElement("slur-end");
-                dElt.appendChild(dSlur);
+                xml.writeEmptyElement("slur-end");
             }
             if (note->phrasingSlurStart()) {
-                QDomElement dPhrasingSlur = dDoc.createElement("phrasing-slur-start");
-                dElt.appendChild(dPhrasingSlur);
-                dPhrasingSlur.setAttribute("slur-style", CASlur::slurStyleToString(note->phrasingSlurStart()->slurStyle()));
-                dPhrasingSlur.setAttribute("slur-direction", CASlur::slurDirectionToString(note->phrasingSlurStart()->slurDirection()));
+                xml.writeEmptyElement("phrasing-slur-start");
+                xml.writeAttribute("slur-style", CASlur::slurStyleToString(note->phrasingSlurStart()->slurStyle()));
+                xml.writeAttribute("slur-direction", CASlur::slurDirectionToString(note->phrasingSlurStart()->slurDirection()));
             }
             if (note->phrasingSlurEnd()) {
-                QDomElement dPhrasingSlur = dDoc.createElement("phrasing-slur-end");
-                dElt.appendChild(dPhrasingSlur);
+                xml.writeEmptyElement("phrasing-slur-end");
+            }
+
+            exportMarks(curElt, xml);
+            xml.writeEndElement(); // note
+
+            if (note->isLastInTuplet()) {
+                endTuplet(xml);
             }
 
             break;
@@ -303,66 +372,81 @@ void CACanorusMLExport::exportVoiceImpl(CAVoice* voice, QDomElement& dVoice)
             CARest* rest = static_cast<CARest*>(curElt);
 
             if (rest->isFirstInTuplet()) {
-                _dTuplet = dDoc.createElement("tuplet");
-                _dTuplet.setAttribute("number", rest->tuplet()->number());
-                _dTuplet.setAttribute("actual-number", rest->tuplet()->actualNumber());
-                dVoice.appendChild(_dTuplet);
+                startTuplet(rest->tuplet(), xml);
             }
 
-            dElt = dDoc.createElement("rest");
-            if (rest->tuplet()) {
-                _dTuplet.appendChild(dElt);
-            } else {
-                dVoice.appendChild(dElt);
-            }
+            xml.writeStartElement("rest");
+            xml.writeAttribute("rest-type", CARest::restTypeToString(rest->restType()));
+            exportTime(curElt, xml);
+            exportColor(curElt, xml);
 
-            dElt.setAttribute("rest-type", CARest::restTypeToString(rest->restType()));
+            exportPlayableLength(rest->playableLength(), xml);
 
-            exportPlayableLength(rest->playableLength(), dElt);
+            exportMarks(curElt, xml);
+            xml.writeEndElement(); // rest
+
+            if (rest->isLastInTuplet()) {
+                endTuplet(xml);
+            }
 
             break;
         }
         case CAMusElement::Clef: {
             CAClef* clef = static_cast<CAClef*>(curElt);
-            dElt = dDoc.createElement("clef");
-            dVoice.appendChild(dElt);
-            dElt.setAttribute("clef-type", CAClef::clefTypeToString(clef->clefType()));
-            dElt.setAttribute("c1", clef->c1());
-            dElt.setAttribute("offset", clef->offset());
+            xml.writeStartElement("clef");
+            xml.writeAttribute("clef-type", CAClef::clefTypeToString(clef->clefType()));
+            xml.writeAttribute("c1", QString::number(clef->c1()));
+            xml.writeAttribute("offset", QString::number(clef->offset()));
+            exportTime(curElt, xml);
+            exportColor(curElt, xml);
+            exportMarks(curElt, xml);
+            xml.writeEndElement(); // clef
 
             break;
         }
         case CAMusElement::KeySignature: {
             CAKeySignature* key = static_cast<CAKeySignature*>(curElt);
-            dElt = dDoc.createElement("key-signature");
-            dVoice.appendChild(dElt);
-            dElt.setAttribute("key-signature-type", CAKeySignature::keySignatureTypeToString(key->keySignatureType()));
+            xml.writeStartElement("key-signature");
+            xml.writeAttribute("key-signature-type", CAKeySignature::keySignatureTypeToString(key->keySignatureType()));
+
+            if (key->keySignatureType() == CAKeySignature::Modus) {
+                xml.writeAttribute("modus", CAKeySignature::modusToString(key->modus()));
+            }
+            exportTime(curElt, xml);
+            exportColor(curElt, xml);
 
             if (key->keySignatureType() == CAKeySignature::MajorMinor) {
-                exportDiatonicKey(key->diatonicKey(), dElt);
-            } else if (key->keySignatureType() == CAKeySignature::Modus) {
-                dElt.setAttribute("modus", CAKeySignature::modusToString(key->modus()));
+                exportDiatonicKey(key->diatonicKey(), xml);
             }
             //! \todo Custom accidentals in key signature saving -Matevz
-            // exportDiatonicPitch( key->diatonicKey().diatonicPitch(), dKey );
+            // exportDiatonicPitch( key->diatonicKey().diatonicPitch(), xml );
+
+            exportMarks(curElt, xml);
+            xml.writeEndElement(); // key-signature
 
             break;
         }
         case CAMusElement::TimeSignature: {
             CATimeSignature* time = static_cast<CATimeSignature*>(curElt);
-            dElt = dDoc.createElement("time-signature");
-            dVoice.appendChild(dElt);
-            dElt.setAttribute("time-signature-type", CATimeSignature::timeSignatureTypeToString(time->timeSignatureType()));
-            dElt.setAttribute("beats", time->beats());
-            dElt.setAttribute("beat", time->beat());
+            xml.writeStartElement("time-signature");
+            xml.writeAttribute("time-signature-type", CATimeSignature::timeSignatureTypeToString(time->timeSignatureType()));
+            xml.writeAttribute("beats", QString::number(time->beats()));
+            xml.writeAttribute("beat", QString::number(time->beat()));
+            exportTime(curElt, xml);
+            exportColor(curElt, xml);
+            exportMarks(curElt, xml);
+            xml.writeEndElement(); // time-signature
 
             break;
         }
         case CAMusElement::Barline: {
             CABarline* barline = static_cast<CABarline*>(curElt);
-            dElt = dDoc.createElement("barline");
-            dVoice.appendChild(dElt);
-            dElt.setAttribute("barline-type", CABarline::barlineTypeToString(barline->barlineType()));
+            xml.writeStartElement("barline");
+            xml.writeAttribute("barline-type", CABarline::barlineTypeToString(barline->barlineType()));
+            exportTime(curElt, xml);
+            exportColor(curElt, xml);
+            exportMarks(curElt, xml);
+            xml.writeEndElement(); // barline
 
             break;
         }
@@ -378,78 +462,105 @@ void CACanorusMLExport::exportVoiceImpl(CAVoice* voice, QDomElement& dVoice)
             qDebug() << "Error: Element" << curElt << "should not be member of the voice. musElementType:" << curElt->musElementType();
             break;
         }
+    }
+
+    // incomplete tuplet at the end of the voice
+    endTuplet(xml);
+}
+
+/*!
+	Opens the tuplet element for the given \a tuplet. Notes and rests are written inside it until
+	endTuplet() is called.
+*/
+template <class Writer>
+void CACanorusMLExport::startTuplet(CATuplet* tuplet, Writer& xml)
+{
+    endTuplet(xml);
 
-        exportTime(curElt, dElt);
-        exportColor(curElt, dElt);
+    xml.writeStartElement("tuplet");
+    xml.writeAttribute("number", QString::number(tuplet->number()));
+    xml.writeAttribute("actual-number", QString::number(tuplet->actualNumber()));
+    _tupletOpen = true;
+}
 
-        exportMarks(curElt, dElt);
+/*!
+	Closes the tuplet element opened by startTuplet(), if any.
+*/
+template <class Writer>
+void CACanorusMLExport::endTuplet(Writer& xml)
+{
+    if (_tupletOpen) {
+        xml.writeEndElement(); // tuplet
+        _tupletOpen = false;
     }
 }
 
-void CACanorusMLExport::exportFiguredBass(CAFiguredBassContext* fbc, QDomElement& dSheet)
+template <class Writer>
+void CACanorusMLExport::exportFiguredBass(CAFiguredBassContext* fbc, Writer& xml)
 {
-    QDomElement dFbc = dSheet.ownerDocument().createElement("figured-bass-context");
-    dSheet.appendChild(dFbc);
-    dFbc.setAttribute("name", fbc->name());
+    xml.writeStartElement("figured-bass-context");
+    xml.writeAttribute("name", fbc->name());
 
     QList<CAFiguredBassMark*> elts = fbc->figuredBassMarkList();
     for (int i = 0; i < elts.size(); i++) {
-        QDomElement dFbm = dSheet.ownerDocument().createElement("figured-bass-mark");
-        dFbc.appendChild(dFbm);
-        dFbm.setAttribute("time-start", elts[i]->timeStart());
-        dFbm.setAttribute("time-length", elts[i]->timeLength());
-        exportColor(elts[i], dFbm);
+        xml.writeStartElement("figured-bass-mark");
+        xml.writeAttribute("time-start", QString::number(elts[i]->timeStart()));
+        xml.writeAttribute("time-length", QString::number(elts[i]->timeLength()));
+        exportColor(elts[i], xml);
 
         for (int j = 0; j < elts[i]->numbers().size(); j++) {
-            QDomElement dFbn = dSheet.ownerDocument().createElement("figured-bass-number");
-            dFbm.appendChild(dFbn);
-            dFbn.setAttribute("number", elts[i]->numbers()[j]);
+            xml.writeEmptyElement("figured-bass-number");
+            xml.writeAttribute("number", QString::number(elts[i]->numbers()[j]));
             if (elts[i]->accs().contains(elts[i]->numbers()[j])) {
-                dFbn.setAttribute("accs", elts[i]->accs()[elts[i]->numbers()[j]]);
+                xml.writeAttribute("accs", QString::number(elts[i]->accs()[elts[i]->numbers()[j]]));
             }
         }
+
+        xml.writeEndElement(); // figured-bass-mark
     }
+
+    xml.writeEndElement(); // figured-bass-context
 }
 
-void CACanorusMLExport::exportMarks(CAMusElement* elt, QDomElement& domElt)
+template <class Writer>
+void CACanorusMLExport::exportMarks(CAMusElement* elt, Writer& xml)
 {
-    for (int i = 0; i < elt->markList().size(); i++) {
-        CAMark* mark = elt->markList()[i];
+    for (CAMark* mark : elt->markList()) {
         if (!mark->isCommon() || elt->musElementType() != CAMusElement::Note || (elt->musElementType() == CAMusElement::Note && static_cast<CANote*>(elt)->isFirstInChord())) {
-            QDomElement dMark = domElt.ownerDocument().createElement("mark");
-            domElt.appendChild(dMark);
-            dMark.setAttribute("time-start", mark->timeStart());
-            dMark.setAttribute("time-length", mark->timeLength());
-            dMark.setAttribute("mark-type", CAMark::markTypeToString(mark->markType()));
+            xml.writeStartElement("mark");
+            xml.writeAttribute("time-start", QString::number(mark->timeStart()));
+            xml.writeAttribute("time-length", QString::number(mark->timeLength()));
+            xml.writeAttribute("mark-type", CAMark::markTypeToString(mark->markType()));
+            exportColor(mark, xml);
 
             switch (mark->markType()) {
             case CAMark::Text: {
                 CAText* text = static_cast<CAText*>(mark);
-                dMark.setAttribute("text", text->text());
+                xml.writeAttribute("text", text->text());
                 break;
             }
             case CAMark::Tempo: {
                 CATempo* tempo = static_cast<CATempo*>(mark);
-                dMark.setAttribute("bpm", tempo->bpm());
-                exportPlayableLength(tempo->beat(), dMark);
+                xml.writeAttribute("bpm", QString::number(tempo->bpm()));
+                exportPlayableLength(tempo->beat(), xml);
                 break;
             }
             case CAMark::Ritardando: {
                 CARitardando* rit = static_cast<CARitardando*>(mark);
-                dMark.setAttribute("ritardando-type", CARitardando::ritardandoTypeToString(rit->ritardandoType()));
-                dMark.setAttribute("final-tempo", rit->finalTempo());
+                xml.writeAttribute("ritardando-type", CARitardando::ritardandoTypeToString(rit->ritardandoType()));
+                xml.writeAttribute("final-tempo", QString::number(rit->finalTempo()));
                 break;
             }
             case CAMark::Dynamic: {
                 CADynamic* dyn = static_cast<CADynamic*>(mark);
-                dMark.setAttribute("volume", dyn->volume());
-                dMark.setAttribute("text", dyn->text());
+                xml.writeAttribute("volume", QString::number(dyn->volume()));
+                xml.writeAttribute("text", dyn->text());
                 break;
             }
             case CAMark::Crescendo: {
                 CACrescendo* cresc = static_cast<CACrescendo*>(mark);
-                dMark.setAttribute("final-volume", cresc->finalVolume());
-                dMark.setAttribute("crescendo-type", CACrescendo::crescendoTypeToString(cresc->crescendoType()));
+                xml.writeAttribute("final-volume", QString::number(cresc->finalVolume()));
+                xml.writeAttribute("crescendo-type", CACrescendo::crescendoTypeToString(cresc->crescendoType()));
                 break;
             }
             case CAMark::Pedal: {
@@ -458,12 +569,12 @@ void CACanorusMLExport::exportMarks(CAMusElement* elt, QDomElement& domElt)
             }
             case CAMark::InstrumentChange: {
                 CAInstrumentChange* ic = static_cast<CAInstrumentChange*>(mark);
-                dMark.setAttribute("instrument", ic->instrument());
+                xml.writeAttribute("instrument", QString::number(ic->instrument()));
                 break;
             }
             case CAMark::BookMark: {
                 CABookMark* b = static_cast<CABookMark*>(mark);
-                dMark.setAttribute("text", b->text());
+                xml.writeAttribute("text", b->text());
                 break;
             }
             case CAMark::RehersalMark: {
@@ -472,76 +583,87 @@ void CACanorusMLExport::exportMarks(CAMusElement* elt, QDomElement& domElt)
             }
             case CAMark::Fermata: {
                 CAFermata* f = static_cast<CAFermata*>(mark);
-                dMark.setAttribute("fermata-type", CAFermata::fermataTypeToString(f->fermataType()));
+                xml.writeAttribute("fermata-type", CAFermata::fermataTypeToString(f->fermataType()));
                 break;
             }
             case CAMark::RepeatMark: {
                 CARepeatMark* r = static_cast<CARepeatMark*>(mark);
-                dMark.setAttribute("repeat-mark-type", CARepeatMark::repeatMarkTypeToString(r->repeatMarkType()));
+                xml.writeAttribute("repeat-mark-type", CARepeatMark::repeatMarkTypeToString(r->repeatMarkType()));
                 if (r->repeatMarkType() == CARepeatMark::Volta) {
-                    dMark.setAttribute("volta-number", r->voltaNumber());
+                    xml.writeAttribute("volta-number", QString::number(r->voltaNumber()));
                 }
                 break;
             }
             case CAMark::Articulation: {
                 CAArticulation* a = static_cast<CAArticulation*>(mark);
-                dMark.setAttribute("articulation-type", CAArticulation::articulationTypeToString(a->articulationType()));
+                xml.writeAttribute("articulation-type", CAArticulation::articulationTypeToString(a->articulationType()));
                 break;
             }
             case CAMark::Fingering: {
                 CAFingering* f = static_cast<CAFingering*>(mark);
-                dMark.setAttribute("original", f->isOriginal());
+                xml.writeAttribute("original", QString::number(f->isOriginal()));
                 for (int i = 0; i < f->fingerList().size(); i++)
-                    dMark.setAttribute(QString("finger%1").arg(i), CAFingering::fingerNumberToString(f->fingerList()[i]));
+                    xml.writeAttribute(QString("finger%1").arg(i), CAFingering::fingerNumberToString(f->fingerList()[i]));
                 break;
             }
             case CAMark::Undefined:
                 break;
             }
 
-            exportColor(mark, dMark);
+            xml.writeEndElement(); // mark
         }
     }
 }
 
-void CACanorusMLExport::exportColor(CAMusElement* elt, QDomElement& domParent)
+/*!
+	Writes the color attribute of the element \a elt, if set.
+	Attributes can only be written right after the element was started.
+*/
+template <class Writer>
+void CACanorusMLExport::exportColor(CAMusElement* elt, Writer& xml)
 {
     if (elt->color().isValid()) {
-        domParent.setAttribute("color", QVariant(elt->color()).toString());
+        xml.writeAttribute("color", QVariant(elt->color()).toString());
     }
 }
 
-void CACanorusMLExport::exportTime(CAMusElement* elt, QDomElement& domParent)
+/*!
+	Writes the time-start and time-length attributes of the element \a elt.
+	Attributes can only be written right after the element was started.
+*/
+template <class Writer>
+void CACanorusMLExport::exportTime(CAMusElement* elt, Writer& xml)
 {
-    domParent.setAttribute("time-start", elt->timeStart());
+    xml.writeAttribute("time-start", QString::number(elt->timeStart()));
 
     if (elt->isPlayable()) {
-        domParent.setAttribute("time-length", elt->timeLength());
+        xml.writeAttribute("time-length", QString::number(elt->timeLength()));
     }
 }
 
-void CACanorusMLExport::exportPlayableLength(CAPlayableLength l, QDomElement& domParent)
+template <class Writer>
+void CACanorusMLExport::exportPlayableLength(CAPlayableLength l, Writer& xml)
 {
-    QDomElement dl = domParent.ownerDocument().createElement("playable-length");
-    domParent.appendChild(dl);
-    dl.setAttribute("music-length", CAPlayableLength::musicLengthToString(l.musicLength()));
-    dl.setAttribute("dotted", l.dotted());
+    xml.writeEmptyElement("playable-length");
+    xml.writeAttribute("music-length", CAPlayableLength::musicLengthToString(l.musicLength()));
+    xml.writeAttribute("dotted", QString::number(l.dotted()));
 }
 
-void CACanorusMLExport::exportDiatonicPitch(CADiatonicPitch p, QDomElement& domParent)
+template <class Writer>
+void CACanorusMLExport::exportDiatonicPitch(CADiatonicPitch p, Writer& xml)
 {
-    QDomElement dp = domParent.ownerDocument().createElement("diatonic-pitch");
-    domParent.appendChild(dp);
-    dp.setAttribute("note-name", p.noteName());
-    dp.setAttribute("accs", p.accs());
+    xml.writeEmptyElement("diatonic-pitch");
+    xml.writeAttribute("note-name", QString::number(p.noteName()));
+    xml.writeAttribute("accs", QString::number(p.accs()));
 }
 
-void CACanorusMLExport::exportDiatonicKey(CADiatonicKey k, QDomElement& domParent)
+template <class Writer>
+void CACanorusMLExport::exportDiatonicKey(CADiatonicKey k, Writer& xml)
 {
-    QDomElement dk = domParent.ownerDocument().createElement("diatonic-key");
-    domParent.appendChild(dk);
-    dk.setAttribute("gender", CADiatonicKey::genderToString(k.gender()));
-    exportDiatonicPitch(k.diatonicPitch(), dk);
+    xml.writeStartElement("diatonic-key");
+    xml.writeAttribute("gender", CADiatonicKey::genderToString(k.gender()));
+    exportDiatonicPitch(k.diatonicPitch(), xml);
+    xml.writeEndElement(); // diatonic-key
 }
 
 /*!
@@ -555,9 +677,13 @@ void CACanorusMLExport::exportDiatonicKey(CADiatonicKey k, QDomElement& domParen
 	   document is being saved.
 	3) Attached resource:
 	   Resource is copied from the tmp/ directory to the directory where the document
-	   is being saved + "filename files/". eg. "content.xml files/myImageXXXX.png"
+	   is being saved + "filename files/" and named by the hash of its content,
+	   eg. "content.xml files/<sha1>.png". Files already saved there are not copied again.
+	   When writing to a stream, the resources are stored in the directory given by
+	   setResourceDir() and copied there by the caller.
  */
-void CACanorusMLExport::exportResources(CADocument* doc, QDomElement& dCanorusDocument)
+template <class Writer>
+void CACanorusMLExport::exportResources(CADocument* doc, Writer& xml)
 {
     for (int i = 0; i < doc->resourceList().size(); i++) {
         std::shared_ptr<CAResource> r = doc->resourceList()[i];
@@ -583,25 +709,25 @@ void CACanorusMLExport::exportResources(CADocument* doc, QDomElement& dCanorusDo
                 QDir(targetDir).mkdir(targetFileName + " files");
             }
 
-            // copies resource /tmp/qt_tempXXXX -> myDocument files/qt_tempXXXX
-            r->copy(targetDir + "/" + targetFileName + " files/" + QFileInfo(r->url().toLocalFile()).fileName());
+            // copies resource /tmp/qt_tempXXXX -> myDocument files/<hash>, unless it was saved unchanged before
+            QString target = targetDir + "/" + targetFileName + " files/" + r->storedFileName();
+            if (!QFile::exists(target)) {
+                r->copy(target);
+            }
 
             // generates relative path
-            url = QUrl::fromLocalFile(targetFileName + " files/" + QFileInfo(r->url().toLocalFile()).fileName());
+            url = QUrl::fromLocalFile(targetFileName + " files/" + r->storedFileName());
         } else {
             // saving to stream - usually when compressing to .can format
-            // copying is done in CACanExport class
-            url = QUrl::fromLocalFile(QString("content.xml files/") + QFileInfo(r->url().toLocalFile()).fileName());
+            // copying is done in CACanExport class or by the caller of setResourceDir()
+            url = QUrl::fromLocalFile((_resourceDir.isEmpty() ? QString("content.xml files") : _resourceDir) + "/" + r->storedFileName());
         }
 
-        QDomElement dResource = dCanorusDocument.ownerDocument().createElement("resource");
-
-        dResource.setAttribute("name", r->name());
-        dResource.setAttribute("description", r->description());
-        dResource.setAttribute("linked", r->isLinked());
-        dResource.setAttribute("resource-type", CAResource::resourceTypeToString(r->resourceType()));
-        dResource.setAttribute("url", url.toString());
-
-        dCanorusDocument.appendChild(dResource);
+        xml.writeEmptyElement("resource");
+        xml.writeAttribute("name", r->name());
+        xml.writeAttribute("description", r->description());
+        xml.writeAttribute("linked", QString::number(r->isLinked()));
+        xml.writeAttribute("resource-type", CAResource::resourceTypeToString(r->resourceType()));
+        xml.writeAttribute("url", url.toString());
     }
 }
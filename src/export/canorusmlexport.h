@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -9,7 +9,6 @@
 #define CANORUSMLEXPORT_H_
 
 #include <QColor>
-#include <QDomElement>
 
 #include "export/export.h"
 #include "score/diatonickey.h"
@@ -18,6 +17,7 @@
 
 class CAMusElement;
 class CAFiguredBassContext;
+class CATuplet;
 
 class CACanorusMLExport : public CAExport {
 public:
@@ -25,21 +25,47 @@ public:
     virtual ~CACanorusMLExport();
 
     void exportDocumentImpl(CADocument* doc);
+    void exportSheetImpl(CASheet* sheet);
+    using CAExport::exportSheet;
+
+    inline bool binary() { return _binary; }
+    inline void setBinary(bool binary) { _binary = binary; }
+    inline const QString& resourceDir() { return _resourceDir; }
+    inline void setResourceDir(const QString& dir) { _resourceDir = dir; }
 
 private:
     using CAExport::exportVoiceImpl;
-    void exportVoiceImpl(CAVoice* voice, QDomElement& dVoice);
-    void exportFiguredBass(CAFiguredBassContext* c, QDomElement& domParent);
-    void exportMarks(CAMusElement* associatedElt, QDomElement& domParent);
-    void exportPlayableLength(CAPlayableLength l, QDomElement& domParent);
-    void exportDiatonicPitch(CADiatonicPitch p, QDomElement& domParent);
-    void exportDiatonicKey(CADiatonicKey k, QDomElement& domParent);
-    void exportColor(CAMusElement* elt, QDomElement& domParent);
-    void exportTime(CAMusElement* elt, QDomElement& domParent);
-    void exportResources(CADocument*, QDomElement&);
-
-    QDomElement _dTuplet;
+    template <class Writer>
+    void exportDocument(CADocument* doc, Writer& xml);
+    template <class Writer>
+    void exportSheet(CASheet* sheet, Writer& xml);
+    template <class Writer>
+    void exportVoiceImpl(CAVoice* voice, Writer& xml);
+    template <class Writer>
+    void startTuplet(CATuplet* tuplet, Writer& xml);
+    template <class Writer>
+    void endTuplet(Writer& xml);
+    template <class Writer>
+    void exportFiguredBass(CAFiguredBassContext* c, Writer& xml);
+    template <class Writer>
+    void exportMarks(CAMusElement* associatedElt, Writer& xml);
+    template <class Writer>
+    void exportPlayableLength(CAPlayableLength l, Writer& xml);
+    template <class Writer>
+    void exportDiatonicPitch(CADiatonicPitch p, Writer& xml);
+    template <class Writer>
+    void exportDiatonicKey(CADiatonicKey k, Writer& xml);
+    template <class Writer>
+    void exportColor(CAMusElement* elt, Writer& xml);
+    template <class Writer>
+    void exportTime(CAMusElement* elt, Writer& xml);
+    template <class Writer>
+    void exportResources(CADocument*, Writer&);
+
+    bool _binary; // write binary CanorusML instead of XML
+    bool _tupletOpen; // is the tuplet element currently open
     QColor _color; // foreground color of elements
+    QString _resourceDir; // directory of the attached resources relative to the exported stream, "content.xml files" if empty
 };
 
 #endif /* CANORUSMLEXPORT_H_ */
@@ -1,11 +1,12 @@
 /*!
-	Copyright (c) 2007-2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
 */
 
 #include "export/export.h"
+#include "core/trace.h"
 #include <QTextStream>
 
 /*!
@@ -23,7 +24,9 @@
 
 	Optionally:
 	Developer should change the current status and progress while operations are in progress. He should
-	also rewrite the readableStatus() function.
+	also rewrite the readableStatus() function. Long operations should check isCanceled() at coarse
+	points (eg. after each sheet or part) and return early, the CANCELED status is then set
+	automatically.
 
 	The following example illustrates the usage of export class:
 	\code
@@ -59,6 +62,8 @@ CAExport::~CAExport()
 */
 void CAExport::run()
 {
+    CA_TRACE_ZONE(metaObject()->className());
+    startProgress();
     if (!stream()) {
         setStatus(-1);
     } else {
@@ -86,10 +91,15 @@ void CAExport::run()
         if (stream()->device() && stream()->device()->isOpen()) {
             stream()->device()->close();
         }
-        if (status() > 0) { // error - bad implemented filter
+        if (isCanceled()) {
+            setStatus(CANCELED);
+        } else if (status() > 0) { // error - bad implemented filter
             // job is finished but status is still marked as working, set to Ready to prevent infinite loops
             setStatus(0);
         }
+        if (status() == 0) {
+            finishProgress();
+        }
     }
 
     emit exportDone(status());
@@ -102,6 +112,8 @@ void CAExport::exportDocument(CADocument* doc, bool bStartThread)
     if (bStartThread)
         start();
     else {
+        CA_TRACE_ZONE(metaObject()->className());
+        startProgress();
         if (!stream()) {
             setStatus(-1);
         } else {
@@ -110,10 +122,15 @@ void CAExport::exportDocument(CADocument* doc, bool bStartThread)
                 emit documentExported(exportedDocument());
             }
             stream()->flush();
-            if (status() > 0) { // error - bad implemented filter
+            if (isCanceled()) {
+            setStatus(CANCELED);
+        } else if (status() > 0) { // error - bad implemented filter
                 // job is finished but status is still marked as working, set to Ready to prevent infinite loops
                 setStatus(0);
             }
+            if (status() == 0) {
+                finishProgress();
+            }
         }
         emit exportDone(status());
     }
@@ -163,6 +180,8 @@ const QString CAExport::readableStatus()
         return tr("Ready");
     case -1:
         return tr("Unable to open file for writing");
+    case CANCELED:
+        return tr("Canceled");
     }
     return tr("Ready");
 }
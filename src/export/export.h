@@ -43,9 +43,9 @@ public:
     inline CAFunctionMarkContext* exportedFunctionMarkContext() { return _exportedFunctionMarkContext; }
 
     // Methods from CAFile to be called via abstract class CAAbsExport
-    virtual void setStreamToFile(const QString filename)
+    virtual void setStreamToFile(const QString filename, QIODevice::OpenMode mode = QIODevice::WriteOnly)
     {
-        CAFile::setStreamToFile(filename);
+        CAFile::setStreamToFile(filename, mode);
     }
     bool wait(unsigned long time = ULONG_MAX)
     {
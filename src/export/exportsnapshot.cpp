@@ -0,0 +1,135 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#include "export/exportsnapshot.h"
+#include "export/export.h"
+
+#include "score/document.h"
+#include "score/documentversion.h"
+
+/*!
+	\class CAExportSnapshot
+	\brief Runs several export filters concurrently on a copy of the document
+
+	Each CAExport runs in its own thread and reads the document while it is writing the file.
+	Exporting the live document is unsafe, if the user keeps editing it in the meantime.
+	CAExportSnapshot takes the published version of the document (see CADocument::publish())
+	when it is created, and all the added exports read only the immutable copy.
+
+	The exports are started by start() and emit finished() when they are all done:
+	\code
+	  CAExportSnapshot* snapshot = new CAExportSnapshot(document);
+	  snapshot->addExport(new CALilyPondExport(), "song.ly", currentSheet);
+	  snapshot->addExport(new CAMidiExport(), "song.mid", currentSheet);
+	  connect(snapshot, SIGNAL(finished()), this, SLOT(onPublishFinished()));
+	  snapshot->start();
+	\endcode
+
+	The exports using external programs (CAPDFExport, CASVGExport) don't support threading and
+	shouldn't be added.
+*/
+
+/*!
+	Creates a snapshot of the document \a doc. Call it from the thread owning the document.
+*/
+CAExportSnapshot::CAExportSnapshot(CADocument* doc, QObject* parent)
+    : QObject(parent)
+    , _version(doc->publish())
+    , _running(0)
+{
+}
+
+/*!
+	Waits for the running exports and destroys them. The copy of the document is destroyed
+	together with its last reader.
+*/
+CAExportSnapshot::~CAExportSnapshot()
+{
+    wait();
+    qDeleteAll(_exports);
+}
+
+/*!
+	Returns the copy of the exported document.
+*/
+CADocument* CAExportSnapshot::document()
+{
+    return _version->document();
+}
+
+/*!
+	Returns the copy of the \a original sheet of the exported document or nullptr, if
+	the sheet wasn't part of the document when the snapshot was made.
+*/
+CASheet* CAExportSnapshot::sheet(CASheet* original)
+{
+    return _version->sheet(original);
+}
+
+/*!
+	Adds the \a exp writing the copy of the \a original sheet or the whole document, if
+	\a original is null, to the file \a fileName. The snapshot takes the ownership of \a exp.
+*/
+void CAExportSnapshot::addExport(CAExport* exp, const QString& fileName, CASheet* original)
+{
+    _exports << exp;
+    _exportedSheets << (original ? sheet(original) : nullptr);
+    _fileNames << fileName;
+}
+
+/*!
+	Starts all the added exports, each in its own thread.
+*/
+void CAExportSnapshot::start()
+{
+    for (int i = 0; i < _exports.size(); i++) {
+        CAExport* exp = _exports[i];
+        connect(exp, SIGNAL(exportDone(int)), this, SLOT(onExportDone(int)), Qt::QueuedConnection);
+        exp->setStreamToFile(_fileNames[i]);
+        _running++;
+        if (_exportedSheets[i]) {
+            exp->exportSheet(_exportedSheets[i]);
+        } else {
+            exp->exportDocument(document());
+        }
+    }
+
+    if (!_running) {
+        emit finished();
+    }
+}
+
+/*!
+	Blocks until all the started exports are done.
+*/
+void CAExportSnapshot::wait()
+{
+    for (CAExport* exp : _exports) {
+        exp->wait();
+    }
+}
+
+/*!
+	Returns the files which couldn't be written.
+*/
+QStringList CAExportSnapshot::failedFileNames()
+{
+    QStringList failed;
+    for (int i = 0; i < _exports.size(); i++) {
+        if (_exports[i]->status() < 0) {
+            failed << _fileNames[i];
+        }
+    }
+    return failed;
+}
+
+void CAExportSnapshot::onExportDone(int)
+{
+    if (--_running == 0) {
+        emit finished();
+    }
+}
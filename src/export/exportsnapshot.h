@@ -0,0 +1,59 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#ifndef EXPORTSNAPSHOT_H_
+#define EXPORTSNAPSHOT_H_
+
+#include <QList>
+#include <QObject>
+#include <QStringList>
+
+#include <memory>
+
+class CADocument;
+class CASheet;
+class CAExport;
+class CADocumentVersion;
+
+class CAExportSnapshot : public QObject {
+#ifndef SWIG
+    Q_OBJECT
+#endif
+public:
+    CAExportSnapshot(CADocument* doc, QObject* parent = nullptr);
+    virtual ~CAExportSnapshot();
+
+    CADocument* document();
+    inline const std::shared_ptr<CADocumentVersion>& version() { return _version; }
+    CASheet* sheet(CASheet* original);
+
+    void addExport(CAExport* exp, const QString& fileName, CASheet* original = nullptr);
+    inline const QList<CAExport*>& exports() { return _exports; }
+    inline const QStringList& fileNames() { return _fileNames; }
+
+    void start();
+    void wait();
+    inline bool isFinished() { return !_running; }
+    QStringList failedFileNames();
+
+#ifndef SWIG
+signals:
+    void finished();
+
+private slots:
+    void onExportDone(int status);
+#endif
+
+private:
+    std::shared_ptr<CADocumentVersion> _version; // published copy of the document, only read by the exports
+    QList<CAExport*> _exports;
+    QList<CASheet*> _exportedSheets; // snapshot sheet for each export, null for the whole document
+    QStringList _fileNames; // target file for each export
+    int _running; // number of exports not done yet
+};
+
+#endif /* EXPORTSNAPSHOT_H_ */
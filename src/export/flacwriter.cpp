@@ -0,0 +1,397 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QCryptographicHash>
+
+#include "export/flacwriter.h"
+
+const int CAFlacWriter::BLOCK_SIZE = 4096; // frames per FLAC block, the common choice of the reference encoder
+const int CAFlacWriter::BITS_PER_SAMPLE = 16;
+
+namespace {
+
+const int MAX_FIXED_ORDER = 4;
+const int MAX_PARTITION_ORDER = 8;
+const int MAX_RICE_PARAMETER = 14; // 15 is the escape code
+
+enum CAFlacChannelAssignment {
+    LeftSide = 8,
+    RightSide = 9,
+    MidSide = 10
+};
+
+struct CAFlacSubframe {
+    int order; // order of the fixed predictor, -1 for a constant and -2 for a verbatim subframe
+    int partitionOrder;
+    QVector<int> riceParameters; // for each partition of the residual
+    qint64 bits; // estimated size of the encoded subframe
+};
+
+class CABitWriter {
+public:
+    CABitWriter()
+        : _accumulator(0)
+        , _bits(0)
+    {
+    }
+
+    // writes the lowest \a bits, at most 32, of the \a value
+    inline void write(quint64 value, int bits)
+    {
+        _accumulator = (_accumulator << bits) | (value & ((quint64(1) << bits) - 1));
+        _bits += bits;
+        while (_bits >= 8) {
+            _bits -= 8;
+            _data.append(static_cast<char>((_accumulator >> _bits) & 0xff));
+        }
+    }
+
+    inline void writeUnary(quint32 zeros)
+    {
+        while (zeros >= 31) {
+            write(0, 31);
+            zeros -= 31;
+        }
+        write(1, zeros + 1);
+    }
+
+    inline void align()
+    {
+        if (_bits) {
+            write(0, 8 - _bits);
+        }
+    }
+
+    inline QByteArray& data() { return _data; }
+
+private:
+    quint64 _accumulator;
+    int _bits; // bits in the accumulator not written to the data yet
+    QByteArray _data;
+};
+
+quint8 crc8(const QByteArray& data)
+{
+    quint8 crc = 0;
+    for (char byte : data) {
+        crc ^= static_cast<quint8>(byte);
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x80) ? static_cast<quint8>((crc << 1) ^ 0x07) : static_cast<quint8>(crc << 1);
+        }
+    }
+    return crc;
+}
+
+quint16 crc16(const QByteArray& data)
+{
+    quint16 crc = 0;
+    for (char byte : data) {
+        crc ^= static_cast<quint16>(static_cast<quint8>(byte) << 8);
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? static_cast<quint16>((crc << 1) ^ 0x8005) : static_cast<quint16>(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/*!
+	Writes the frame \a number in the UTF-8 like coding of the FLAC frame header.
+*/
+void writeFrameNumber(CABitWriter& w, quint32 number)
+{
+    if (number < 0x80) {
+        w.write(number, 8);
+        return;
+    }
+
+    int bytes = 2;
+    while (bytes < 6 && number >= (quint32(1) << (5 * bytes + 1))) {
+        bytes++;
+    }
+    w.write(((0xff << (8 - bytes)) & 0xff) | (number >> (6 * (bytes - 1))), 8);
+    for (int i = bytes - 2; i >= 0; i--) {
+        w.write(0x80 | ((number >> (6 * i)) & 0x3f), 8);
+    }
+}
+
+inline int fixedResidual(const int* x, int i, int order)
+{
+    switch (order) {
+    case 0:
+        return x[i];
+    case 1:
+        return x[i] - x[i - 1];
+    case 2:
+        return x[i] - 2 * x[i - 1] + x[i - 2];
+    case 3:
+        return x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+    default:
+        return x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4];
+    }
+}
+
+inline quint32 zigzag(int residual)
+{
+    return (residual >= 0) ? (static_cast<quint32>(residual) << 1) : ((static_cast<quint32>(-(residual + 1)) << 1) | 1);
+}
+
+/*!
+	Returns the Rice parameter with the lowest estimated size of the \a count residuals with the
+	given \a sum of their zigzag values and stores the size to \a bits.
+*/
+int riceParameter(qint64 sum, int count, qint64& bits)
+{
+    int best = 0;
+    bits = -1;
+    for (int k = 0; k <= MAX_RICE_PARAMETER; k++) {
+        qint64 size = static_cast<qint64>(count) * (k + 1) + (sum >> k);
+        if (bits == -1 || size < bits) {
+            bits = size;
+            best = k;
+        }
+    }
+    return best;
+}
+
+/*!
+	Chooses the smallest coding of the \a n samples \a x with \a bps bits per sample: a constant,
+	a fixed predictor of order 0 to 4 with the best Rice partitioning of its residual or verbatim.
+*/
+CAFlacSubframe analyseSubframe(const int* x, int n, int bps)
+{
+    bool constant = true;
+    for (int i = 1; i < n && constant; i++) {
+        constant = (x[i] == x[0]);
+    }
+    if (constant) {
+        CAFlacSubframe subframe = { -1, 0, QVector<int>(), 8 + bps };
+        return subframe;
+    }
+
+    CAFlacSubframe best = { -2, 0, QVector<int>(), 8 + static_cast<qint64>(n) * bps };
+    QVector<qint64> sums; // zigzag residual sums of the finest partitions
+    for (int order = 0; order <= MAX_FIXED_ORDER && order < n; order++) {
+        int finest = 0;
+        while (finest < MAX_PARTITION_ORDER && !(n % (1 << (finest + 1))) && (n >> (finest + 1)) > order) {
+            finest++;
+        }
+
+        int partitionSize = n >> finest;
+        sums.fill(0, 1 << finest);
+        for (int i = order; i < n; i++) {
+            sums[i / partitionSize] += zigzag(fixedResidual(x, i, order));
+        }
+
+        for (int partitionOrder = finest; partitionOrder >= 0; partitionOrder--) {
+            if (partitionOrder < finest) { // merge the pairs of the finer partitions
+                for (int p = 0; p < (1 << partitionOrder); p++) {
+                    sums[p] = sums[2 * p] + sums[2 * p + 1];
+                }
+            }
+
+            CAFlacSubframe subframe = { order, partitionOrder, QVector<int>(1 << partitionOrder), 8 + order * bps + 6 };
+            int size = n >> partitionOrder;
+            for (int p = 0; p < (1 << partitionOrder); p++) {
+                qint64 bits;
+                subframe.riceParameters[p] = riceParameter(sums[p], p ? size : size - order, bits);
+                subframe.bits += 4 + bits;
+            }
+
+            if (subframe.bits < best.bits) {
+                best = subframe;
+            }
+        }
+    }
+
+    return best;
+}
+
+void writeSubframe(CABitWriter& w, const int* x, int n, int bps, const CAFlacSubframe& subframe)
+{
+    w.write(0, 1);
+    if (subframe.order == -1) {
+        w.write(0, 6); // constant
+        w.write(0, 1); // no wasted bits
+        w.write(static_cast<quint64>(x[0]), bps);
+        return;
+    }
+
+    if (subframe.order == -2) {
+        w.write(1, 6); // verbatim
+        w.write(0, 1);
+        for (int i = 0; i < n; i++) {
+            w.write(static_cast<quint64>(x[i]), bps);
+        }
+        return;
+    }
+
+    w.write(8 | subframe.order, 6); // fixed
+    w.write(0, 1);
+    for (int i = 0; i < subframe.order; i++) {
+        w.write(static_cast<quint64>(x[i]), bps); // warm-up samples
+    }
+
+    w.write(0, 2); // Rice coding with 4-bit parameters
+    w.write(subframe.partitionOrder, 4);
+    int size = n >> subframe.partitionOrder;
+    for (int p = 0; p < subframe.riceParameters.size(); p++) {
+        int k = subframe.riceParameters[p];
+        w.write(k, 4);
+        for (int i = qMax(p * size, subframe.order); i < (p + 1) * size; i++) {
+            quint32 value = zigzag(fixedResidual(x, i, subframe.order));
+            w.writeUnary(value >> k);
+            if (k) {
+                w.write(value, k);
+            }
+        }
+    }
+}
+
+}
+
+/*!
+	\class CAFlacWriter
+	\brief Encoder of 16-bit audio to FLAC
+
+	A small FLAC encoder used by CAAudioExport, so the audio can be written losslessly compressed
+	without an external library. Each block is coded by the fixed polynomial predictors of the
+	FLAC format with the Rice partitioning of their residual chosen by the estimated size. Stereo
+	blocks are also tried as left/side, right/side and mid/side.
+
+	This gets most of the compression of the reference encoder at its fast presets, which is
+	plenty for rendered scores.
+*/
+
+CAFlacWriter::CAFlacWriter(int sampleRate, int channels)
+    : _sampleRate(sampleRate)
+    , _channels(qBound(1, channels, 8))
+{
+}
+
+/*!
+	Encodes the interleaved \a samples and returns the complete FLAC file.
+*/
+QByteArray CAFlacWriter::encode(const QVector<qint16>& samples)
+{
+    int total = samples.size() / _channels;
+
+    QByteArray frames;
+    int minFrameSize = 0, maxFrameSize = 0;
+    for (int start = 0, number = 0; start < total; start += BLOCK_SIZE, number++) {
+        QByteArray frame = encodeFrame(samples.constData() + start * _channels, qMin(BLOCK_SIZE, total - start), number);
+        minFrameSize = number ? qMin(minFrameSize, frame.size()) : frame.size();
+        maxFrameSize = qMax(maxFrameSize, frame.size());
+        frames += frame;
+    }
+
+    QByteArray raw; // samples as stored by the decoder for the MD5 signature
+    raw.reserve(samples.size() * 2);
+    for (qint16 sample : samples) {
+        raw.append(static_cast<char>(sample & 0xff));
+        raw.append(static_cast<char>((sample >> 8) & 0xff));
+    }
+
+    CABitWriter w;
+    w.write(0x664c6143, 32); // fLaC
+    w.write(1, 1); // last metadata block
+    w.write(0, 7); // STREAMINFO
+    w.write(34, 24);
+    int blockSize = (total >= BLOCK_SIZE) ? BLOCK_SIZE : qMax(total, 16);
+    w.write(blockSize, 16);
+    w.write(blockSize, 16);
+    w.write(minFrameSize, 24);
+    w.write(maxFrameSize, 24);
+    w.write(_sampleRate, 20);
+    w.write(_channels - 1, 3);
+    w.write(BITS_PER_SAMPLE - 1, 5);
+    w.write(static_cast<quint64>(total) >> 4, 32); // 36-bit number of samples
+    w.write(total & 0x0f, 4);
+
+    return w.data() + QCryptographicHash::hash(raw, QCryptographicHash::Md5) + frames;
+}
+
+QByteArray CAFlacWriter::encodeFrame(const qint16* samples, int frames, int frameNumber)
+{
+    QVector<QVector<int>> channels(_channels, QVector<int>(frames));
+    for (int i = 0; i < frames; i++) {
+        for (int c = 0; c < _channels; c++) {
+            channels[c][i] = samples[i * _channels + c];
+        }
+    }
+
+    QVector<int> bps(_channels, BITS_PER_SAMPLE);
+    QVector<CAFlacSubframe> subframes;
+    for (int c = 0; c < _channels; c++) {
+        subframes << analyseSubframe(channels[c].constData(), frames, BITS_PER_SAMPLE);
+    }
+
+    int assignment = _channels - 1;
+    if (_channels == 2) {
+        QVector<int> mid(frames), side(frames);
+        for (int i = 0; i < frames; i++) {
+            mid[i] = (channels[0][i] + channels[1][i]) >> 1;
+            side[i] = channels[0][i] - channels[1][i];
+        }
+        CAFlacSubframe midFrame = analyseSubframe(mid.constData(), frames, BITS_PER_SAMPLE);
+        CAFlacSubframe sideFrame = analyseSubframe(side.constData(), frames, BITS_PER_SAMPLE + 1);
+
+        qint64 left = subframes[0].bits, right = subframes[1].bits;
+        qint64 best = left + right;
+        if (left + sideFrame.bits < best) {
+            best = left + sideFrame.bits;
+            assignment = LeftSide;
+        }
+        if (sideFrame.bits + right < best) {
+            best = sideFrame.bits + right;
+            assignment = RightSide;
+        }
+        if (midFrame.bits + sideFrame.bits < best) {
+            assignment = MidSide;
+        }
+
+        switch (assignment) {
+        case LeftSide:
+            channels[1] = side;
+            subframes[1] = sideFrame;
+            bps[1]++;
+            break;
+        case RightSide:
+            channels[0] = side;
+            subframes[0] = sideFrame;
+            bps[0]++;
+            break;
+        case MidSide:
+            channels[0] = mid;
+            subframes[0] = midFrame;
+            channels[1] = side;
+            subframes[1] = sideFrame;
+            bps[1]++;
+            break;
+        }
+    }
+
+    CABitWriter w;
+    w.write(0xfff8, 16); // sync code, fixed block size
+    w.write((frames == BLOCK_SIZE) ? 12 : 7, 4); // 4096 or the size at the end of the header
+    w.write(0, 4); // sample rate from STREAMINFO
+    w.write(assignment, 4);
+    w.write(4, 3); // 16 bits per sample
+    w.write(0, 1);
+    writeFrameNumber(w, frameNumber);
+    if (frames != BLOCK_SIZE) {
+        w.write(frames - 1, 16);
+    }
+    w.write(crc8(w.data()), 8);
+
+    for (int c = 0; c < _channels; c++) {
+        writeSubframe(w, channels[c].constData(), frames, bps[c], subframes[c]);
+    }
+    w.align();
+    w.write(crc16(w.data()), 16);
+
+    return w.data();
+}
@@ -0,0 +1,33 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef FLACWRITER_H_
+#define FLACWRITER_H_
+
+#include <QByteArray>
+#include <QVector>
+
+class CAFlacWriter {
+public:
+    CAFlacWriter(int sampleRate, int channels);
+
+    QByteArray encode(const QVector<qint16>& samples);
+
+    inline int sampleRate() const { return _sampleRate; }
+    inline int channels() const { return _channels; }
+
+    static const int BLOCK_SIZE;
+    static const int BITS_PER_SAMPLE;
+
+private:
+    QByteArray encodeFrame(const qint16* samples, int frames, int frameNumber);
+
+    int _sampleRate;
+    int _channels;
+};
+
+#endif /* FLACWRITER_H_ */
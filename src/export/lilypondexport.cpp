@@ -5,10 +5,13 @@
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
 */
 
+#include <QBuffer>
 #include <QFileInfo>
 #include <QList>
+#include <QMutexLocker>
 #include <QRegExp>
 #include <QTextStream>
+#include <QThread>
 
 #include "export/lilypondexport.h"
 
@@ -77,6 +80,7 @@ void CALilyPondExport::exportVoiceImpl(CAVoice* v)
     bool anacrusisCheck = true; // process upbeat eventually
     CATimeSignature* time = nullptr;
     int barNumber = 1;
+    CASheet* sheet = (v->staff() ? v->staff()->sheet() : nullptr);
 
     // Write \relative note for the first note
     _lastNotePitch = writeRelativeIntro();
@@ -86,7 +90,7 @@ void CALilyPondExport::exportVoiceImpl(CAVoice* v)
     indentMore();
     indent();
 
-    for (int i = 0; i < v->musElementList().size(); i++, out() << " ") { // append blank after each element
+    for (int i = 0; i < v->musElementList().size() && !isCanceled(); i++, out() << " ") { // append blank after each element
         // (CAMusElement)
         switch (v->musElementList()[i]->musElementType()) {
         case CAMusElement::Clef: {
@@ -137,6 +141,9 @@ void CALilyPondExport::exportVoiceImpl(CAVoice* v)
                 _voltaBracketFinishAtBar = false;
             }
 
+            if (sheet) {
+                barNumber = sheet->barNumber(bar->timeStart() - 1); // the bar closed by the barline
+            }
             if (bar->barlineType() == CABarline::Single)
                 out() << "| % bar " << barNumber << "\n	";
             else
@@ -448,19 +455,9 @@ void CALilyPondExport::exportMarksAfterElement(CAMusElement* elt)
     }
 
     // Export breath articulation mark at the very end. Otherwise Lilypond complains.
-    for (CAMark* curMark : elt->markList()) {
-        switch (curMark->markType()) {
-        case CAMark::Articulation: {
-            switch (static_cast<CAArticulation*>(curMark)->articulationType()) {
-            case CAArticulation::Breath:
-                out() << "\\breathe ";
-                break;
-            default:
-                break;
-            }
-        }
-        default:
-            break;
+    for (CAArticulation* articulation : elt->marksOfType<CAArticulation>(CAMark::Articulation)) {
+        if (articulation->articulationType() == CAArticulation::Breath) {
+            out() << "\\breathe ";
         }
     }
 }
@@ -472,35 +469,14 @@ void CALilyPondExport::exportMarksAfterElement(CAMusElement* elt)
  */
 void CALilyPondExport::exportNoteMarks(CANote* elt)
 {
-    for (int i = 0; i < elt->markList().size(); i++) {
-        CAMark* curMark = elt->markList()[i];
-
-        switch (curMark->markType()) {
-        case CAMark::Fingering: {
-            CAFingering::CAFingerNumber n = static_cast<CAFingering*>(curMark)->finger();
-            if (n < 1 || n > 5)
-                break;
-
-            out() << "-";
-            out() << QString::number(static_cast<CAFingering*>(curMark)->finger());
-            out() << " ";
-            break;
-        }
-        case CAMark::Text:
-        case CAMark::Tempo:
-        case CAMark::Ritardando:
-        case CAMark::Crescendo:
-        case CAMark::Pedal:
-        case CAMark::InstrumentChange:
-        case CAMark::Undefined:
-        case CAMark::BookMark:
-        case CAMark::RepeatMark:
-        case CAMark::Dynamic:
-        case CAMark::RehersalMark:
-        case CAMark::Articulation:
-        case CAMark::Fermata:
-            break;
-        }
+    for (CAFingering* fingering : elt->marksOfType<CAFingering>(CAMark::Fingering)) {
+        CAFingering::CAFingerNumber n = fingering->finger();
+        if (n < 1 || n > 5)
+            continue;
+
+        out() << "-";
+        out() << QString::number(fingering->finger());
+        out() << " ";
     }
 }
 
@@ -509,48 +485,25 @@ void CALilyPondExport::exportNoteMarks(CANote* elt)
 */
 void CALilyPondExport::exportMarksBeforeElement(CAMusElement* elt)
 {
-    for (int i = 0; i < elt->markList().size(); i++) {
-        CAMark* curMark = elt->markList()[i];
-
-        switch (curMark->markType()) {
-        case CAMark::Text: {
-
-            QRegExp vr = QRegExp(_regExpVoltaRepeat);
-            QRegExp vb = QRegExp(_regExpVoltaBar);
-            QString txt;
-            if (vb.indexIn(qPrintable(static_cast<CAText*>(curMark)->text())) >= 0) {
-                txt = vb.cap(1);
-                _voltaBracketFinishAtBar = true;
-            } else if (vr.indexIn(qPrintable(static_cast<CAText*>(curMark)->text())) >= 0) {
-                txt = vr.cap(1);
-                _voltaBracketFinishAtRepeat = true;
-            }
-            if (_voltaBracketFinishAtRepeat || _voltaBracketFinishAtBar) {
-                out() << "\\voltaStart \\markup \\text { \"" << txt << "\" }  ";
-            }
-            break;
+    // the marks are sorted by their type, so the text marks are exported before the tempo marks
+    for (CAText* text : elt->marksOfType<CAText>(CAMark::Text)) {
+        QRegExp vr = QRegExp(_regExpVoltaRepeat);
+        QRegExp vb = QRegExp(_regExpVoltaBar);
+        QString txt;
+        if (vb.indexIn(qPrintable(text->text())) >= 0) {
+            txt = vb.cap(1);
+            _voltaBracketFinishAtBar = true;
+        } else if (vr.indexIn(qPrintable(text->text())) >= 0) {
+            txt = vr.cap(1);
+            _voltaBracketFinishAtRepeat = true;
         }
-        case CAMark::Tempo: {
-            CATempo* t = static_cast<CATempo*>(curMark);
-            out() << "\\tempo " << playableLengthToLilyPond(t->beat()) << " = " << t->bpm() << " ";
-
-            break;
+        if (_voltaBracketFinishAtRepeat || _voltaBracketFinishAtBar) {
+            out() << "\\voltaStart \\markup \\text { \"" << txt << "\" }  ";
         }
+    }
 
-        case CAMark::Fingering:
-        case CAMark::Ritardando:
-        case CAMark::Crescendo:
-        case CAMark::Pedal:
-        case CAMark::InstrumentChange:
-        case CAMark::Undefined:
-        case CAMark::BookMark:
-        case CAMark::RepeatMark:
-        case CAMark::Dynamic:
-        case CAMark::RehersalMark:
-        case CAMark::Articulation:
-        case CAMark::Fermata:
-            break;
-        }
+    for (CATempo* t : elt->marksOfType<CATempo>(CAMark::Tempo)) {
+        out() << "\\tempo " << playableLengthToLilyPond(t->beat()) << " = " << t->bpm() << " ";
     }
 }
 
@@ -983,12 +936,18 @@ void CALilyPondExport::exportSheetImpl(CASheet* sheet)
 		voltaFunction();
 	 */
 
+    // Voice bodies are independent of each other, render them in parallel first
+    sheet->buildBarTable();
+    QList<CALilyPondVoicePart> voiceParts = startVoiceExports(sheet);
+    int voiceCount = voiceParts.size();
+
     // Export voices as Lilypond variables: \StaffOneVoiceOne = \relative c { ... }
     for (int c = 0; c < sheet->contextList().size(); ++c) {
         setCurContextIndex(c);
         switch (sheet->contextList()[c]->contextType()) {
         case CAContext::Staff:
-            exportStaffVoices(static_cast<CAStaff*>(sheet->contextList()[c]));
+            exportStaffVoices(static_cast<CAStaff*>(sheet->contextList()[c]), voiceParts);
+            setProgress(voiceCount - voiceParts.size(), voiceCount);
             break;
         case CAContext::LyricsContext:
             exportLyricsContextBlock(static_cast<CALyricsContext*>(sheet->contextList()[c]));
@@ -1041,7 +1000,6 @@ void CALilyPondExport::scanForRepeats(CAStaff* staff)
     out() << "\n % \\repeat volta xxx \n";
 
     CABarline* bl;
-    QList<CAMark*> ml;
 
     // barlineRefs aus score/staff.h
     for (int b = 0; b < staff->barlineRefs().size(); b++) {
@@ -1052,10 +1010,9 @@ void CALilyPondExport::scanForRepeats(CAStaff* staff)
         if (bl->barlineType() == CABarline::RepeatClose || bl->barlineType() == CABarline::RepeatOpen || bl->barlineType() == CABarline::RepeatCloseOpen) {
             out() << "\n % \\repeat volta X " << CABarline::barlineTypeToString(bl->barlineType()) << "\n";
         }
-        ml = bl->markList();
-        for (int e = 0; e < ml.size(); e++) {
-            if (ml[e]->markType() == CAMark::RepeatMark && static_cast<CARepeatMark*>(ml[e])->repeatMarkType() == CARepeatMark::Volta) {
-                out() << "\n % \\repeat volta X " << CARepeatMark::repeatMarkTypeToString(static_cast<CARepeatMark*>(ml[e])->repeatMarkType()) << "\n";
+        for (CARepeatMark* repeatMark : bl->marksOfType<CARepeatMark>(CAMark::RepeatMark)) {
+            if (repeatMark->repeatMarkType() == CARepeatMark::Volta) {
+                out() << "\n % \\repeat volta X " << CARepeatMark::repeatMarkTypeToString(repeatMark->repeatMarkType()) << "\n";
             }
         }
     }
@@ -1078,13 +1035,88 @@ QString CALilyPondExport::escapeWeirdChars(QString in)
     return in.replace("\\", "\\\\").replace("\"", "\\\"");
 }
 
+/*!
+	Starts rendering the bodies of all the voices in the given \a sheet, each one in its own
+	export filter with a separate string buffer. Voices are exported in worker threads and at most
+	QThread::idealThreadCount() of them run at the same time.
+
+	The bodies of the recently exported voices are kept in a cache shared by all the exports and
+	looked up by the voice generation (see CAVoice::generation()). A body is only taken from the
+	cache, if the numbers of the bars written in its comments are still the same, so repeated
+	previews render just the voices changed meanwhile.
+
+	Returns the list of the voice parts in the order of contexts and voices. The caller should
+	wait for the export of each part, if there is one, collect its output and delete it.
+
+	\sa exportStaffVoices()
+*/
+QList<CALilyPondExport::CALilyPondVoicePart> CALilyPondExport::startVoiceExports(CASheet* sheet)
+{
+    QList<CALilyPondVoicePart> voiceParts;
+    QList<CALilyPondExport*> running;
+    int maxThreads = qMax(1, QThread::idealThreadCount());
+
+    for (int c = 0; c < sheet->contextList().size(); ++c) {
+        if (sheet->contextList()[c]->contextType() != CAContext::Staff) {
+            continue;
+        }
+
+        CAStaff* staff = static_cast<CAStaff*>(sheet->contextList()[c]);
+        for (int v = 0; v < staff->voiceList().size(); ++v) {
+            CAVoice* voice = staff->voiceList()[v];
+            CALilyPondVoicePart part = { nullptr, voice->generation(), QVector<int>(), QString(), false };
+            for (CAMusElement* elt : voice->musElementList()) { // the same bars as numbered by exportVoiceImpl()
+                if (elt->musElementType() == CAMusElement::Barline) {
+                    part.bars << sheet->barNumber(elt->timeStart() - 1);
+                }
+            }
+
+            {
+                QMutexLocker locker(&_voiceBodiesMutex);
+                CALilyPondVoiceBody* cached = _voiceBodies.object(part.generation);
+                if (cached && cached->indentLevel == curIndentLevel() && cached->bars == part.bars) {
+                    part.body = cached->body;
+                    part.timeSignatureFound = cached->timeSignatureFound;
+                    voiceParts << part;
+                    continue;
+                }
+            }
+
+            if (running.size() >= maxThreads) {
+                running[running.size() - maxThreads]->wait();
+            }
+
+            /// \todo replace raw pointer with shared or unique pointer
+            CALilyPondExport* voiceExport = new CALilyPondExport();
+            voiceExport->setStreamToString();
+            voiceExport->out().setCodec("UTF-8");
+            voiceExport->setCurSheet(sheet);
+            voiceExport->setCurDocument(curDocument());
+            voiceExport->setCurContext(staff);
+            voiceExport->setCurContextIndex(c);
+            voiceExport->setIndentLevel(curIndentLevel());
+            voiceExport->setProgressToken(progressToken()); // canceling the sheet stops its voices too
+            voiceExport->exportVoice(voice);
+
+            part.exporter = voiceExport;
+            voiceParts << part;
+            running << voiceExport;
+        }
+    }
+
+    return voiceParts;
+}
+
 /*!
 	Exports all the voices in the staff to Lilypond.
 	Each voice in the staff is stored as a Lilypond variable:
 
 	StaffOneVoiceOne = \relative c { ... }
+
+	Voice bodies are taken from the front of \a voiceParts started by startVoiceExports(). The
+	newly rendered bodies are added to the cache.
 */
-void CALilyPondExport::exportStaffVoices(CAStaff* staff)
+void CALilyPondExport::exportStaffVoices(CAStaff* staff, QList<CALilyPondVoicePart>& voiceParts)
 {
     for (int v = 0; v < staff->voiceList().size(); ++v) {
         setCurVoice(staff->voiceList()[v]);
@@ -1099,7 +1131,25 @@ void CALilyPondExport::exportStaffVoices(CAStaff* staff)
         voiceVariableName(voiceName, curContextIndex(), v);
         out() << voiceName << " = ";
 
-        exportVoiceImpl(curVoice());
+        CALilyPondVoicePart part = voiceParts.takeFirst();
+        if (part.exporter) {
+            part.exporter->wait();
+            part.body = part.exporter->getStreamAsString();
+            part.timeSignatureFound = part.exporter->_timeSignatureFound;
+            delete part.exporter->stream()->device();
+            delete part.exporter;
+
+            if (!isCanceled()) { // canceled bodies are incomplete
+                QMutexLocker locker(&_voiceBodiesMutex);
+                _voiceBodies.insert(part.generation, new CALilyPondVoiceBody{ curIndentLevel(), part.bars, part.body, part.timeSignatureFound }, part.body.size());
+            }
+        }
+
+        out() << part.body;
+        if (part.timeSignatureFound) {
+            _timeSignatureFound = true;
+        }
+
         out() << "\n"; // exportVoiceImpl doesn't put endline at the end
     }
 }
@@ -1392,5 +1442,10 @@ void CALilyPondExport::voltaFunction(void)
     _voltaFunctionWritten = true;
 }
 
+const int CALilyPondExport::MAX_CACHED_BODIES_SIZE = 16 * 1024 * 1024; // characters
+
+QMutex CALilyPondExport::_voiceBodiesMutex;
+QCache<quint64, CALilyPondExport::CALilyPondVoiceBody> CALilyPondExport::_voiceBodies(CALilyPondExport::MAX_CACHED_BODIES_SIZE);
+
 const QString CALilyPondExport::_regExpVoltaRepeat = QString("voltaRepeat (.*)");
 const QString CALilyPondExport::_regExpVoltaBar = QString("voltaBar (.*)");
@@ -8,8 +8,12 @@
 #ifndef LILYPONDEXPORT_H_
 #define LILYPONDEXPORT_H_
 
+#include <QCache>
+#include <QList>
+#include <QMutex>
 #include <QString>
 #include <QTextStream>
+#include <QVector>
 
 #include "score/barline.h"
 #include "score/clef.h"
@@ -47,7 +51,18 @@ public:
 private:
     void exportSheetImpl(CASheet* sheet);
     void exportScoreBlock(CASheet* sheet);
-    void exportStaffVoices(CAStaff* staff);
+#ifndef SWIG
+    // voice body rendered in parallel or taken from the cache, see startVoiceExports()
+    struct CALilyPondVoicePart {
+        CALilyPondExport* exporter; // renders the body, nullptr if it was cached
+        quint64 generation; // of the voice, see CAVoice::generation()
+        QVector<int> bars; // numbers of the bars closed by the barlines of the voice
+        QString body;
+        bool timeSignatureFound;
+    };
+    QList<CALilyPondVoicePart> startVoiceExports(CASheet* sheet);
+    void exportStaffVoices(CAStaff* staff, QList<CALilyPondVoicePart>& voiceParts);
+#endif
     void exportVoiceImpl(CAVoice* voice);
     void exportLyricsContextBlock(CALyricsContext* lc);
     void exportLyricsContextImpl(CALyricsContext* lc);
@@ -124,6 +139,19 @@ private:
     static const QString _regExpVoltaRepeat;
     static const QString _regExpVoltaBar;
     bool _timeSignatureFound;
+
+#ifndef SWIG
+    // cached voice body, see startVoiceExports()
+    struct CALilyPondVoiceBody {
+        int indentLevel;
+        QVector<int> bars;
+        QString body;
+        bool timeSignatureFound;
+    };
+    static const int MAX_CACHED_BODIES_SIZE;
+    static QMutex _voiceBodiesMutex;
+    static QCache<quint64, CALilyPondVoiceBody> _voiceBodies; // bodies of the voice generations exported recently
+#endif
 };
 
 #endif /* LILYPONDEXPORT_H_*/
@@ -6,6 +6,7 @@
 */
 
 #include <QFileInfo>
+#include <QIODevice>
 #include <QRegExp>
 #include <QTextStream>
 #include <iomanip>
@@ -21,8 +22,17 @@
 #include "score/staff.h"
 #include "score/voice.h"
 
+#include "core/taskscheduler.h"
+#include "core/trace.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 class CACanorus;
 
+const int CAMidiExport::TRACK_RESERVE = 64 * 1024;
+
 /*!
 	\class CAMidiExport
 	\brief Midi file export filter
@@ -34,6 +44,11 @@ class CACanorus;
 
 	\a textStream is usually the file stream.
 
+	The whole document is exported as a single file with the sheets played one after another.
+	The events are rendered from the timeline compiled by CAPlayback and the tempo map of each
+	sheet, see exportSheets(). The midi device interface is kept for the scripts sending their
+	own events followed by writeFile().
+
 	\sa CAMidiImport
 */
 
@@ -48,6 +63,7 @@ CAMidiExport::CAMidiExport(QTextStream* out)
     _midiDeviceType = MidiExportDevice;
     setRealTime(false);
     _trackTime = 0;
+    trackChunk.reserve(TRACK_RESERVE);
 }
 
 /*!
@@ -65,60 +81,37 @@ int CAMidiExport::timeIncrement(int time)
 
 void CAMidiExport::send(QVector<unsigned char> message, int time)
 {
-    if (message.size())
-        trackChunk.append(writeTime(timeIncrement(time)));
-    char q;
-    for (int i = 0; i < message.size(); i++) {
-        q = static_cast<char>(message[i]);
-        trackChunk.append(q);
-    }
-    for (int i = 0; i < message.size(); i++) {
-        q = static_cast<char>(message[i]);
-    }
+    if (!message.size())
+        return;
+
+    writeVariableLength(trackChunk, timeIncrement(time));
+    trackChunk.append(reinterpret_cast<const char*>(message.constData()), message.size());
 }
 
 void CAMidiExport::sendMetaEvent(int time, char event, char a, char b, int)
 {
     // We don't do a time check on time, and we compute
     // only the time increment when we really send an event out.
-    QByteArray tc;
     if (event == CAMidiDevice::Meta_Keysig) {
-        tc.append(writeTime(timeIncrement(time)));
-        tc.append(static_cast<char>(CAMidiDevice::Midi_Ctl_Event));
-        tc.append(event);
-        tc.append(variableLengthValue(2));
-        tc.append(a);
-        tc.append(b);
-        trackChunk.append(tc);
+        QByteArray data;
+        data.append(a);
+        data.append(b);
+        writeMetaEvent(trackChunk, timeIncrement(time), event, data);
     } else if (event == CAMidiDevice::Meta_Timesig) {
         char lbBeat = 0;
         for (; lbBeat < 5; lbBeat++) { // natural logarithm, smallest is 128th
             if (1 << lbBeat >= b)
                 break;
         }
-        tc.append(writeTime(timeIncrement(time)));
-        tc.append(static_cast<char>(CAMidiDevice::Midi_Ctl_Event));
-        tc.append(event);
-        tc.append(variableLengthValue(4));
-        tc.append(a);
-        tc.append(lbBeat);
-        tc.append(18);
-        tc.append(8);
-        trackChunk.append(tc);
-    } else if (event == CAMidiDevice::Meta_Tempo) {
-        int usPerQuarter = 60000000 / a;
-        tc.append(writeTime(timeIncrement(time)));
-        tc.append(static_cast<char>(CAMidiDevice::Midi_Ctl_Event));
-        tc.append(event);
-        tc.append(variableLengthValue(3));
-        char q;
-        q = char(usPerQuarter >> 16);
-        tc.append(q);
-        q = char(usPerQuarter >> 8);
-        tc.append(q);
-        q = char(usPerQuarter >> 0);
-        tc.append(q);
-        trackChunk.append(tc);
+        QByteArray data;
+        data.append(a);
+        data.append(lbBeat);
+        data.append(18);
+        data.append(8);
+        writeMetaEvent(trackChunk, timeIncrement(time), event, data);
+    } else if (event == CAMidiDevice::Meta_Tempo && a) {
+        int timePerQuarter = CAPlayableLength::playableLengthToTimeLength(CAPlayableLength::Quarter);
+        writeTempo(trackChunk, timeIncrement(time), 60000.0 / (timePerQuarter * static_cast<unsigned char>(a)));
     }
 }
 
@@ -137,93 +130,198 @@ void CAMidiExport::sendMetaEvent(int time, char event, char a, char b, int)
 #define MIDI_CTL_SUSTAIN 0x40
 
 /*!
-    Converts 16-bit number to big endian byte array.
+	\class CAMidiExport::CASheetTrack
+	\brief Midi events of a single sheet
+
+	Renders the timeline compiled by CAPlayback for the sheet into the bodies of the conductor
+	(tempo, time and key signatures) and the music track. The tempo is written from the tempo map
+	of the sheet instead of the tempo events of the timeline, so the beat of each tempo mark is
+	respected. The repeats are unrolled the same way as in the playback.
+
+	The tracks of several sheets are rendered in the task scheduler in parallel. The renderer
+	only reads its sheet, so the sheet caches must be built before (see exportSheets()). The
+	delta time of the first event in each track is counted from the start of the sheet.
 */
-QByteArray CAMidiExport::word16(short x)
+class CAMidiExport::CASheetTrack : public CATask {
+public:
+    CASheetTrack(CASheet* sheet)
+        : CATask(CATask::Normal)
+        , _sheet(sheet)
+        , _length(0)
+        , _conductorTime(0)
+        , _musicTime(0)
+    {
+    }
+
+    void run()
+    {
+        CA_TRACE_ZONE("CAMidiExport::CASheetTrack::run");
+
+        CAPlayback playback(_sheet, nullptr);
+        const QList<CAPlaybackEvent>& timeline = playback.timeline();
+        const QVector<CATempoMapEntry>& tempoMap = _sheet->tempoMap();
+
+        int time = 0; // sheet time of the previous event, goes back at the repeats
+        int tempo = -2; // tempo map index of the last tempo written, -1 for the default tempo
+        QByteArray timeSignature, keySignature; // last written, each voice sends its own
+        for (const CAPlaybackEvent& event : timeline) {
+            if (isCanceled()) {
+                return;
+            }
+
+            if (event.time > time) {
+                _length += event.time - time;
+            }
+            time = event.time;
+
+            int t = static_cast<int>(std::upper_bound(tempoMap.constBegin(), tempoMap.constEnd(), time,
+                                         [](int a, const CATempoMapEntry& e) { return a < e.time; })
+                        - tempoMap.constBegin())
+                - 1;
+            if (t != tempo) {
+                writeTempo(_conductor, _length - _conductorTime, (t >= 0 ? tempoMap[t].msecsPerTime : CASheet::DEFAULT_MSECS_PER_TIME));
+                _conductorTime = _length;
+                tempo = t;
+            }
+
+            switch (event.type) {
+            case CAPlaybackEvent::Message:
+                writeVariableLength(_music, _length - _musicTime);
+                _music.append(reinterpret_cast<const char*>(event.message.constData()), event.message.size());
+                _musicTime = _length;
+                break;
+            case CAPlaybackEvent::MetaEvent: {
+                QByteArray data;
+                if (event.metaEvent == CAMidiDevice::Meta_Timesig) {
+                    char lbBeat = 0;
+                    while (lbBeat < 5 && 1 << lbBeat < event.b) { // logarithm of the beat, smallest is 32nd
+                        lbBeat++;
+                    }
+                    data.append(event.a);
+                    data.append(lbBeat);
+                    data.append(18);
+                    data.append(8);
+                    if (data == timeSignature) {
+                        break;
+                    }
+                    timeSignature = data;
+                } else if (event.metaEvent == CAMidiDevice::Meta_Keysig) {
+                    data.append(event.a);
+                    data.append(event.b);
+                    if (data == keySignature) {
+                        break;
+                    }
+                    keySignature = data;
+                } else {
+                    break; // tempo is written from the tempo map
+                }
+                writeMetaEvent(_conductor, _length - _conductorTime, event.metaEvent, data);
+                _conductorTime = _length;
+                break;
+            }
+            case CAPlaybackEvent::PlayableOn:
+            case CAPlaybackEvent::PlayableOff:
+                break;
+            }
+        }
+    }
+
+    inline CASheet* sheet() const { return _sheet; }
+    inline const QByteArray& conductor() const { return _conductor; }
+    inline const QByteArray& music() const { return _music; }
+    inline int length() const { return _length; }
+    inline int conductorTime() const { return _conductorTime; }
+    inline int musicTime() const { return _musicTime; }
+
+private:
+    CASheet* _sheet;
+    QByteArray _conductor; // events without the chunk header and the track end
+    QByteArray _music;
+    int _length; // of the sheet in midi ticks, repeats unrolled
+    int _conductorTime; // time of the last event in the conductor track
+    int _musicTime; // time of the last event in the music track
+};
+
+/*!
+	Appends the 16-bit number \a x to the \a chunk in big endian order.
+*/
+void CAMidiExport::writeWord16(QByteArray& chunk, int x)
 {
-    QByteArray ba;
-    ba.append(x >> 8);
-    ba.append(x);
-    return ba;
+    chunk.append(static_cast<char>(x >> 8));
+    chunk.append(static_cast<char>(x));
 }
 
-QByteArray CAMidiExport::variableLengthValue(int value)
+/*!
+	Appends the \a value to the \a chunk as a midi variable length quantity.
+	Only the lowest 28 bits of the value are written.
+*/
+void CAMidiExport::writeVariableLength(QByteArray& chunk, int value)
 {
+    int shift = 3 * 7;
+    while (shift > 0 && !((value >> shift) & 0x7f))
+        shift -= 7;
 
-    QByteArray chunk;
-    char b;
-    bool byteswritten = false;
-    b = (value >> 3 * 7) & 0x7f;
-    if (b) {
-        chunk.append(0x80 | b);
-        byteswritten = true;
-    }
-    b = (value >> 2 * 7) & 0x7f;
-    if (b || byteswritten) {
-        chunk.append(0x80 | b);
-        byteswritten = true;
-    }
-    b = (value >> 7) & 0x7f;
-    if (b || byteswritten) {
-        chunk.append(0x80 | b);
-        byteswritten = true;
-    }
-    b = value & 0x7f;
-    chunk.append(b);
-    return chunk;
+    for (; shift > 0; shift -= 7)
+        chunk.append(static_cast<char>(0x80 | ((value >> shift) & 0x7f)));
+    chunk.append(static_cast<char>(value & 0x7f));
 }
 
-QByteArray CAMidiExport::writeTime(int time)
+void CAMidiExport::writeTrackEnd(QByteArray& chunk)
 {
-    char b;
-    bool byteswritten = false;
-    QByteArray ba;
-
-    b = (time >> 3 * 7) & 0x7f;
-    if (b) {
-        ba.append(0x80 | b);
-        byteswritten = true;
-    }
-    b = (time >> 2 * 7) & 0x7f;
-    if (b || byteswritten) {
-        ba.append(0x80 | b);
-        byteswritten = true;
-    }
-    b = (time >> 7) & 0x7f;
-    if (b || byteswritten) {
-        ba.append(0x80 | b);
-        byteswritten = true;
-    }
-    b = time & 0x7f;
-    ba.append(b);
-    return ba;
+    writeVariableLength(chunk, 0);
+    /// \todo replace with enum
+    chunk.append(static_cast<char>(MIDI_CTL_EVENT));
+    chunk.append(META_TRACK_END);
+    chunk.append(static_cast<char>(0));
 }
 
-QByteArray CAMidiExport::trackEnd(void)
+/*!
+	Appends the meta \a event with the given \a data to the \a chunk, \a time ticks after the
+	previous event.
+*/
+void CAMidiExport::writeMetaEvent(QByteArray& chunk, int time, char event, const QByteArray& data)
 {
-    QByteArray tc;
-    tc.append(writeTime(0));
-    /// \todo replace with enum
-    tc.append(static_cast<char>(MIDI_CTL_EVENT));
-    tc.append(META_TRACK_END);
-    tc.append(static_cast<char>(0));
-    return tc;
+    writeVariableLength(chunk, time);
+    chunk.append(static_cast<char>(CAMidiDevice::Midi_Ctl_Event));
+    chunk.append(event);
+    writeVariableLength(chunk, data.size());
+    chunk.append(data);
 }
 
-QByteArray CAMidiExport::textEvent(int time, QString s)
+/*!
+	Appends the text \a s as the meta \a event (eg. Meta_Text or Meta_Marker) to the \a chunk.
+*/
+void CAMidiExport::writeTextEvent(QByteArray& chunk, int time, const QString& s, char event)
 {
-    QByteArray tc;
-    tc.append(writeTime(time));
-    /// \todo replace with enum
-    tc.append(static_cast<char>(MIDI_CTL_EVENT));
-    tc.append(META_TEXT);
-    tc.append(variableLengthValue(s.length()));
-    tc.append(s);
-    return tc;
+    writeMetaEvent(chunk, time, event, s.toUtf8());
 }
 
 /*!
-	Exports the current document to Lilypond syntax as a complete .ly file.
+	Appends the tempo event to the \a chunk. The tempo is given in miliseconds per canorus time
+	unit, which is also the midi tick (see CATempoMapEntry).
+*/
+void CAMidiExport::writeTempo(QByteArray& chunk, int time, double msecsPerTime)
+{
+    int timePerQuarter = CAPlayableLength::playableLengthToTimeLength(CAPlayableLength::Quarter);
+    int usPerQuarter = qBound(1, qRound(msecsPerTime * timePerQuarter * 1000), 0xffffff);
+
+    QByteArray data;
+    data.append(static_cast<char>(usPerQuarter >> 16));
+    data.append(static_cast<char>(usPerQuarter >> 8));
+    data.append(static_cast<char>(usPerQuarter >> 0));
+    writeMetaEvent(chunk, time, CAMidiDevice::Meta_Tempo, data);
+}
+
+void CAMidiExport::writeVersionText(QByteArray& chunk)
+{
+    writeTextEvent(chunk, 0, QString("Canorus Version ") + CANORUS_VERSION + " generated. ");
+    writeTextEvent(chunk, 0, "It's still a work in progress.");
+}
+
+/*!
+	Exports all the sheets of the document one after another.
+
+	\sa exportSheets()
 */
 void CAMidiExport::exportDocumentImpl(CADocument* doc)
 {
@@ -232,141 +330,132 @@ void CAMidiExport::exportDocumentImpl(CADocument* doc)
         return;
     }
 
-    // In the header chunk we need to know the count of tracks.
-    // We export every non empty voice as separate track.
-    // For now we export only the first sheet.
-    CASheet* sheet = doc->sheetList()[0];
-    setCurSheet(sheet);
-    trackChunk.clear();
-
-    // Let's playback this sheet and dump that into a file,
-    // and for this we have our own midi driver.
-    CAPlayback* _playback = new CAPlayback(sheet, this);
-    _playback->run();
-
-    int count = 0;
-    for (int c = 0; c < doc->sheetList()[0]->contextList().size(); ++c) {
-        switch (sheet->contextList()[c]->contextType()) {
-        case CAContext::Staff: {
-            // exportStaffVoices( static_cast<CAStaff*>(sheet->contextList()[c]) );
-            CAStaff* staff = static_cast<CAStaff*>(sheet->contextList()[c]);
-            for (int v = 0; v < staff->voiceList().size(); ++v) {
-                setCurVoice(staff->voiceList()[v]);
-                count++;
-                //std::cout << "Hallo  " << c << " " << v << "\n" << std::endl;
-            }
-            break;
-        }
-        case CAContext::ChordNameContext:
-            break; // TODO
-        case CAContext::LyricsContext:
-        case CAContext::FunctionMarkContext:
-        case CAContext::FiguredBassContext:
-            break;
-        }
-    }
-
-    writeFile();
+    exportSheets(doc->sheetList());
 }
 
 /*!
-	Exports the current document to Lilypond syntax as a complete .ly file.
+	Exports the given sheet only.
 */
 void CAMidiExport::exportSheetImpl(CASheet* sheet)
 {
-    /*
-	if ( doc->sheetList().size() < 1 ) {
-		//TODO: no sheets, raise an error
-		return;
-	}
+    setCurSheet(sheet);
+    exportSheets(QList<CASheet*>() << sheet);
+}
 
+/*!
+	Writes the \a sheets to a single midi file with a conductor and a music track. The sheets are
+	played one after another, each starting with a marker carrying its name.
 
-	// In the header chunk we need to know the count of tracks.
-	// We export every non empty voice as separate track.
-	// For now we export only the first sheet.
-	CASheet *sheet = doc->sheetList()[ 0 ];
+	The events of each sheet are rendered from its compiled timeline and tempo map by a
+	CASheetTrack in the task scheduler, so the sheets are rendered in parallel and no playback is
+	run. Several exports can run at once, eg. in the batch conversion, as they don't share any
+	state.
 */
-    setCurSheet(sheet);
-    trackChunk.clear();
-
-    // Let's playback this sheet and dump that into a file,
-    // and for this we have our own midi driver.
-    CAPlayback* _playback = new CAPlayback(sheet, this);
-    _playback->run();
-
-    int count = 0;
-    for (int c = 0; c < sheet->contextList().size(); ++c) {
-        switch (sheet->contextList()[c]->contextType()) {
-        case CAContext::Staff: {
-            // exportStaffVoices( static_cast<CAStaff*>(sheet->contextList()[c]) );
-            CAStaff* staff = static_cast<CAStaff*>(sheet->contextList()[c]);
-            for (int v = 0; v < staff->voiceList().size(); ++v) {
-                setCurVoice(staff->voiceList()[v]);
-                count++;
-                //std::cout << "Hallo  " << c << " " << v << "\n" << std::endl;
-            }
-            break;
+void CAMidiExport::exportSheets(const QList<CASheet*>& sheets)
+{
+    CA_TRACE_ZONE("CAMidiExport::exportSheets");
+
+    // the renderers only read the sheets, build the caches they would otherwise create on the fly
+    for (CASheet* sheet : sheets) {
+        for (CAVoice* voice : sheet->voiceList()) {
+            voice->buildTypeIndex();
         }
-        case CAContext::LyricsContext:
-        case CAContext::FunctionMarkContext:
-        case CAContext::FiguredBassContext:
-        case CAContext::ChordNameContext:
-            break;
+        sheet->buildTempoMap();
+    }
+
+    std::vector<std::unique_ptr<CASheetTrack>> tracks;
+    for (CASheet* sheet : sheets) {
+        tracks.emplace_back(new CASheetTrack(sheet));
+        CATaskScheduler::instance()->start(tracks.back().get());
+    }
+    for (const std::unique_ptr<CASheetTrack>& track : tracks) {
+        if (isCanceled()) {
+            track->cancel();
         }
+        track->wait();
     }
 
-    writeFile();
+    if (isCanceled()) {
+        return; // the rendering of a long document may take a while
+    }
+
+    QByteArray conductor;
+    writeVersionText(conductor);
+    QByteArray music;
+    music.reserve(TRACK_RESERVE);
+
+    int start = 0; // of the current sheet
+    int conductorTime = 0;
+    int musicTime = 0;
+    for (const std::unique_ptr<CASheetTrack>& track : tracks) {
+        // the marker also carries the gap since the last event of the previous sheet
+        writeTextEvent(conductor, start - conductorTime, track->sheet()->name(), CAMidiDevice::Meta_Marker);
+        conductor.append(track->conductor());
+        conductorTime = start + track->conductorTime();
+
+        writeTextEvent(music, start - musicTime, track->sheet()->name());
+        music.append(track->music());
+        musicTime = start + track->musicTime();
+
+        start += track->length();
+    }
+
+    writeFile(conductor, music);
 }
 
+/*!
+	Writes the events sent by the playback to the midi device interface of the export.
+*/
 void CAMidiExport::writeFile()
 {
+    QByteArray controlTrackChunk;
+    writeVersionText(controlTrackChunk);
+    writeFile(controlTrackChunk, trackChunk);
+}
 
+/*!
+	Writes the format 1 midi file with the given bodies of the \a conductorTrack and the
+	\a musicTrack. The track ends are added.
+*/
+void CAMidiExport::writeFile(QByteArray conductorTrack, QByteArray musicTrack)
+{
     QByteArray headerChunk;
-    headerChunk.append("MThd...."); // header and space for length
-    headerChunk.append(word16(1)); // Midi-Format version
-    headerChunk.append(word16(2)); // number of tracks, a control track and a music track for a trying out ...
-    /// \todo QByteArray does not support char values > 0x7f
-    headerChunk.append(word16(static_cast<short>(CAPlayableLength::playableLengthToTimeLength(CAPlayableLength::Quarter)))); // time division ticks per quarter
-    setChunkLength(&headerChunk);
-    streamQByteArray(headerChunk);
+    writeWord16(headerChunk, 1); // Midi-Format version
+    writeWord16(headerChunk, 2); // number of tracks, the conductor and the music track
+    writeWord16(headerChunk, CAPlayableLength::playableLengthToTimeLength(CAPlayableLength::Quarter)); // time division ticks per quarter
+    writeChunk("MThd", headerChunk);
 
-    QByteArray controlTrackChunk;
-    controlTrackChunk.append("MTrk....");
-    controlTrackChunk.append(textEvent(0, QString("Canorus Version ") + CANORUS_VERSION + " generated. "));
-    controlTrackChunk.append(textEvent(0, "It's still a work in progress."));
-    controlTrackChunk.append(trackEnd());
-    setChunkLength(&controlTrackChunk);
-    streamQByteArray(controlTrackChunk);
-
-    // trackChunk is already filled with midi data,
-    // let's add chunk header, in reverse, ...
-    trackChunk.prepend("MTrk....");
-    // ... and add the tail:
-    trackChunk.append(trackEnd());
-    setChunkLength(&trackChunk);
-    streamQByteArray(trackChunk);
+    writeTrackEnd(conductorTrack);
+    writeChunk("MTrk", conductorTrack);
+
+    writeTrackEnd(musicTrack);
+    writeChunk("MTrk", musicTrack);
 }
 
-void CAMidiExport::setChunkLength(QByteArray* x)
+/*!
+	Writes the chunk with the 4-character \a id, the length of the \a data and the data itself
+	directly to the output device.
+*/
+void CAMidiExport::writeChunk(const char* id, const QByteArray& data)
 {
-    /// \todo QByteArray does not support char values > 0x7f
-    qint32 l = (*x).size() - 8; // subtract header length
+    char header[8];
+    qint32 l = data.size();
     for (int i = 0; i < 4; i++) {
-        (*x)[7 - i] = static_cast<char>((l >> (8 * i)));
+        header[i] = id[i];
+        header[7 - i] = static_cast<char>(l >> (8 * i));
     }
-}
 
-void CAMidiExport::streamQByteArray(QByteArray x)
-{
-    for (int i = 0; i < x.size(); i++) // here we pass binary data through QTextStream
-        out().device()->putChar(x[i]);
+    QIODevice* device = out().device(); // here we pass binary data around QTextStream
+    device->write(header, sizeof(header));
+    device->write(data);
 
 #ifdef QT_DEBUG
-    for (int i = 0; i < x.size(); i++) {
-        printf(" %02x", 0x0ff & x.at(i));
+    for (unsigned int i = 0; i < sizeof(header); i++) {
+        printf(" %02x", 0x0ff & header[i]);
+    }
+    for (int i = 0; i < data.size(); i++) {
+        printf(" %02x", 0x0ff & data.at(i));
     }
     printf("\n");
 #endif
-
-    return; // when no debugging
 }
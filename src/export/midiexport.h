@@ -56,23 +56,29 @@ public:
 */
 
 private:
-    QByteArray writeTime(int time);
+    class CASheetTrack;
+
     void exportDocumentImpl(CADocument* doc);
     void exportSheetImpl(CASheet* sheet);
+    void exportSheets(const QList<CASheet*>& sheets);
     int midiTrackCount;
-    QByteArray trackChunk; // for the time beeing we build one big track
+    QByteArray trackChunk; // for the time beeing we build one big track, events only without the chunk header
+    static const int TRACK_RESERVE; // Initial capacity of the track data in bytes
     int timeIncrement(int time);
     int _trackTime; // which this is the time line for
     QVector<QByteArray> trackChunks; // for the future
     QVector<int> trackTimes;
-    void streamQByteArray(QByteArray x); // streaming binary data to midi file, possibly with print for debugging
-    QByteArray variableLengthValue(int value);
-    QByteArray word16(short x);
-    QByteArray textEvent(int time, QString s);
-    QByteArray trackEnd(void);
+    void writeFile(QByteArray conductorTrack, QByteArray musicTrack);
+    void writeChunk(const char* id, const QByteArray& data); // streaming binary data to midi file, possibly with print for debugging
+    static void writeVariableLength(QByteArray& chunk, int value);
+    static void writeWord16(QByteArray& chunk, int x);
+    static void writeMetaEvent(QByteArray& chunk, int time, char event, const QByteArray& data);
+    static void writeTextEvent(QByteArray& chunk, int time, const QString& s, char event = CAMidiDevice::Meta_Text);
+    static void writeTempo(QByteArray& chunk, int time, double msecsPerTime);
+    static void writeVersionText(QByteArray& chunk);
+    static void writeTrackEnd(QByteArray& chunk);
     QByteArray timeSignature(void);
     QByteArray keySignature(void);
-    void setChunkLength(QByteArray* x);
 
     /*
 
@@ -5,14 +5,16 @@
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
 */
 
-#include <QDomDocument>
-#include <QDomElement>
-#include <QDomImplementation>
+#include <QQueue>
 #include <QString>
 #include <QTextStream>
+#include <QVector>
+#include <QXmlStreamWriter>
 
 #include "export/musicxmlexport.h"
 
+#include "core/taskscheduler.h"
+
 #include "score/barline.h"
 #include "score/clef.h"
 #include "score/context.h"
@@ -45,10 +47,47 @@
 #include "score/functionmark.h"
 #include "score/functionmarkcontext.h"
 
+/*!
+	\class CAMusicXmlPartWriter
+	\brief A single MusicXML <part> written in the task scheduler
+
+	Each staff of the sheet is written into its own buffer by a separate QXmlStreamWriter. The
+	buffers are appended to the output in the part order as soon as they are finished.
+*/
+class CAMusicXmlPartWriter : public CATask {
+public:
+    CAMusicXmlPartWriter(CAMusicXmlExport* e, CAStaff* staff, int partNumber)
+        : CATask(CATask::Normal)
+        , _export(e)
+        , _staff(staff)
+        , _partNumber(partNumber)
+    {
+    }
+
+    void run()
+    {
+        QXmlStreamWriter xml(&_output);
+        xml.setAutoFormatting(true);
+        xml.setAutoFormattingIndent(1);
+
+        xml.writeStartElement("part");
+        xml.writeAttribute("id", QString("P") + QString::number(_partNumber));
+        _export->exportStaffImpl(_staff, xml);
+        xml.writeEndElement();
+    }
+
+    inline const QString& output() const { return _output; }
+
+private:
+    CAMusicXmlExport* _export;
+    CAStaff* _staff;
+    int _partNumber;
+    QString _output;
+};
+
 CAMusicXmlExport::CAMusicXmlExport(QTextStream* stream)
     : CAExport(stream)
 {
-    _xmlDoc = nullptr;
 }
 
 CAMusicXmlExport::~CAMusicXmlExport()
@@ -57,7 +96,8 @@ CAMusicXmlExport::~CAMusicXmlExport()
 
 /*!
 	Exports the document to MusicXML 3.0 format.
-	It uses DOM object internally for writing the XML output.
+	It uses QXmlStreamWriter internally for writing the XML output. The parts are written in the
+	task scheduler in parallel and only a few finished parts wait in memory for being written out.
  
 	The implementation relies heavily on the tutorial found at musicxml.com.
  */
@@ -71,71 +111,91 @@ void CAMusicXmlExport::exportSheetImpl(CASheet* sheet)
         setCurDocument(sheet->document());
     }
 
-    // DOCTYPE
-    QDomImplementation di;
-    QDomDocument xmlDoc(
-        di.createDocumentType("score-partwise", "-//Recordare//DTD MusicXML 3.0 Partwise//EN", "http://www.musicxml.org/dtds/partwise.dtd"));
-    _xmlDoc = &xmlDoc;
+    QString buffer;
+    QXmlStreamWriter xml(&buffer);
+    xml.setAutoFormatting(true);
+    xml.setAutoFormattingIndent(1);
 
-    // Add encoding
-    xmlDoc.appendChild(xmlDoc.createProcessingInstruction("xml",
-        "version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\""));
+    // Add encoding (QXmlStreamWriter omits it when writing into a string) and DOCTYPE
+    out() << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>";
+    xml.writeDTD("<!DOCTYPE score-partwise PUBLIC \"-//Recordare//DTD MusicXML 3.0 Partwise//EN\" \"http://www.musicxml.org/dtds/partwise.dtd\">");
 
-    // Root node - <canorus-document>
-    QDomElement xmlScorePartwise = xmlDoc.createElement("score-partwise");
-    xmlScorePartwise.setAttribute("version", "3.0");
+    // Root node - <score-partwise>
+    xml.writeStartElement("score-partwise");
+    xml.writeAttribute("version", "3.0");
 
-    QDomElement xmlPartList = xmlDoc.createElement("part-list");
     QList<CAStaff*> staffList = sheet->staffList();
 
     // first export part information
+    xml.writeStartElement("part-list");
     for (int i = 0; i < staffList.size(); i++) {
-        QDomElement xmlScorePart = xmlDoc.createElement("score-part");
-        xmlScorePart.setAttribute("id", QString("P") + QString::number(i + 1));
-
-        QDomElement xmlPartName = xmlDoc.createElement("part-name");
-        QDomText xmlPartNameText = xmlDoc.createTextNode(staffList[i]->name());
-        xmlPartName.appendChild(xmlPartNameText);
-        xmlScorePart.appendChild(xmlPartName);
-
-        xmlPartList.appendChild(xmlScorePart);
+        xml.writeStartElement("score-part");
+        xml.writeAttribute("id", QString("P") + QString::number(i + 1));
+        xml.writeTextElement("part-name", staffList[i]->name());
+        xml.writeEndElement();
     }
-    xmlScorePartwise.appendChild(xmlPartList);
+    xml.writeEndElement();
+    out() << buffer;
+    buffer.clear();
+
+    // then export the part content, the parts read the bar numbers in parallel
+    sheet->buildBarTable();
+    const int maxPending = qMax(CATaskScheduler::instance()->workerCount(), 1) * 2;
+    QQueue<CAMusicXmlPartWriter*> pending;
+    int next = 0;
+    int written = 0;
+    while (next < staffList.size() || !pending.isEmpty()) {
+        if (next < staffList.size() && pending.size() < maxPending && !isCanceled()) {
+            CAMusicXmlPartWriter* part = new CAMusicXmlPartWriter(this, staffList[next], next + 1);
+            pending.enqueue(part);
+            CATaskScheduler::instance()->start(part);
+            next++;
+            continue;
+        }
+        if (pending.isEmpty()) {
+            break; // canceled
+        }
 
-    // then export the part content
-    for (int i = 0; i < staffList.size(); i++) {
-        QDomElement xmlPart = xmlDoc.createElement("part");
-        xmlPart.setAttribute("id", QString("P") + QString::number(i + 1));
-        exportStaffImpl(staffList[i], xmlPart);
-        xmlScorePartwise.appendChild(xmlPart);
+        CAMusicXmlPartWriter* part = pending.dequeue();
+        if (isCanceled()) {
+            part->cancel();
+        }
+        part->wait();
+        if (!isCanceled()) {
+            out() << part->output();
+        }
+        delete part;
+        setProgress(++written, staffList.size());
     }
 
-    xmlDoc.appendChild(xmlScorePartwise);
-    out() << xmlDoc.toString();
+    xml.writeEndElement(); // score-partwise
+    xml.writeEndDocument();
+    out() << buffer;
 }
 
 /*!
- * Exports the given staff to the provided DOM part element.
+ * Exports the given staff into the current <part> element of the given writer.
+ * This function is called from the task scheduler and only reads the score.
  */
-void CAMusicXmlExport::exportStaffImpl(CAStaff* staff, QDomElement& xmlPart)
+void CAMusicXmlExport::exportStaffImpl(CAStaff* staff, QXmlStreamWriter& xml)
 {
-    int measureNumber = 1;
+    int measureNumber = (staff->sheet() ? staff->sheet()->firstBarNumber() : 1); // a partial first bar is numbered 0
     int voicesFinished = 0;
 
     QList<CAVoice*> voiceList = staff->voiceList();
-    int* curIndex = new int[voiceList.size()]; // frontline of exported elements
-    for (int i = 0; i < voiceList.size(); i++) {
-        curIndex[i] = 0;
-    }
+    QVector<int> curIndex(voiceList.size(), 0); // frontline of exported elements
 
     while (voicesFinished < voiceList.size()) {
         // write the measure content
-        QDomElement xmlMeasure = _xmlDoc->createElement("measure");
-        xmlMeasure.setAttribute("number", measureNumber);
+        xml.writeStartElement("measure");
+        xml.writeAttribute("number", QString::number(measureNumber));
+        if (measureNumber == 0) {
+            xml.writeAttribute("implicit", "yes");
+        }
 
-        exportMeasure(voiceList, curIndex, xmlMeasure);
+        exportMeasure(voiceList, curIndex.data(), xml);
 
-        xmlPart.appendChild(xmlMeasure);
+        xml.writeEndElement();
 
         // check the end of staff
         voicesFinished = 0;
@@ -152,10 +212,10 @@ void CAMusicXmlExport::exportStaffImpl(CAStaff* staff, QDomElement& xmlPart)
 }
 
 /*!
- * Exports the voice elements at provided indices to the given DOM measure
- * element.
+ * Exports the voice elements at provided indices into the current <measure>
+ * element of the given writer.
  */
-void CAMusicXmlExport::exportMeasure(QList<CAVoice*>& voiceList, int* curIndex, QDomElement& xmlMeasure)
+void CAMusicXmlExport::exportMeasure(QList<CAVoice*>& voiceList, int* curIndex, QXmlStreamWriter& xml)
 {
     QList<CAMusElement*> attributeChanges;
 
@@ -178,33 +238,29 @@ void CAMusicXmlExport::exportMeasure(QList<CAVoice*>& voiceList, int* curIndex,
     }
 
     // check for attributes changes in the first pass
-    QDomElement xmlAttributes = _xmlDoc->createElement("attributes");
-
-    QDomElement xmlDivisions = _xmlDoc->createElement("divisions");
-    QDomText xmlDivisionsText = _xmlDoc->createTextNode(QString::number(32)); // 32 divisions per quarter gives us 128th - the shortest Canorus length
-    xmlDivisions.appendChild(xmlDivisionsText);
-    xmlAttributes.appendChild(xmlDivisions);
+    xml.writeStartElement("attributes");
+    xml.writeTextElement("divisions", QString::number(32)); // 32 divisions per quarter gives us 128th - the shortest Canorus length
 
     for (int i = 0; i < attributeChanges.size(); i++) {
         switch (attributeChanges[i]->musElementType()) {
         case CAMusElement::Clef: {
-            QDomElement xmlClef = _xmlDoc->createElement("clef");
-            exportClef(static_cast<CAClef*>(attributeChanges[i]), xmlClef);
-            xmlAttributes.appendChild(xmlClef);
+            xml.writeStartElement("clef");
+            exportClef(static_cast<CAClef*>(attributeChanges[i]), xml);
+            xml.writeEndElement();
             break;
         }
 
         case CAMusElement::TimeSignature: {
-            QDomElement xmlTimeSig = _xmlDoc->createElement("time");
-            exportTimeSig(static_cast<CATimeSignature*>(attributeChanges[i]), xmlTimeSig);
-            xmlAttributes.appendChild(xmlTimeSig);
+            xml.writeStartElement("time");
+            exportTimeSig(static_cast<CATimeSignature*>(attributeChanges[i]), xml);
+            xml.writeEndElement();
             break;
         }
 
         case CAMusElement::KeySignature: {
-            QDomElement xmlKeySig = _xmlDoc->createElement("key");
-            exportKeySig(static_cast<CAKeySignature*>(attributeChanges[i]), xmlKeySig);
-            xmlAttributes.appendChild(xmlKeySig);
+            xml.writeStartElement("key");
+            exportKeySig(static_cast<CAKeySignature*>(attributeChanges[i]), xml);
+            xml.writeEndElement();
             break;
         }
 
@@ -213,7 +269,7 @@ void CAMusicXmlExport::exportMeasure(QList<CAVoice*>& voiceList, int* curIndex,
         }
         }
     }
-    xmlMeasure.appendChild(xmlAttributes);
+    xml.writeEndElement(); // attributes
 
     // TODO: check for dynamics (mf, pp)
 
@@ -223,38 +279,31 @@ void CAMusicXmlExport::exportMeasure(QList<CAVoice*>& voiceList, int* curIndex,
         while (curIndex[i] < v->musElementList().size() && v->musElementList()[curIndex[i]] != targetBarline) {
             if (v->musElementList()[curIndex[i]]->isPlayable()) {
                 CAMusElement* elt = v->musElementList()[curIndex[i]];
-                QDomElement xmlNote = _xmlDoc->createElement("note");
+                xml.writeStartElement("note");
 
-                QDomElement xmlDuration = _xmlDoc->createElement("duration");
                 // duration=timeLength/8 comes from the hardcoded divisions (set to 32)
                 int duration = CAPlayableLength::playableLengthToTimeLength(static_cast<CAPlayable*>(elt)->playableLength()) / 8;
-                QDomText xmlDurationValue = _xmlDoc->createTextNode(QString::number(duration));
-                xmlDuration.appendChild(xmlDurationValue);
-                xmlNote.appendChild(xmlDuration);
+                xml.writeTextElement("duration", QString::number(duration));
 
                 for (int j = 0; j < static_cast<CAPlayable*>(elt)->playableLength().dotted(); j++) {
-                    QDomElement xmlDot = _xmlDoc->createElement("dot");
-                    xmlNote.appendChild(xmlDot);
+                    xml.writeEmptyElement("dot");
                 }
 
-                QDomElement xmlVoice = _xmlDoc->createElement("voice");
-                QDomText xmlVoiceNr = _xmlDoc->createTextNode(QString::number(v->voiceNumber()));
-                xmlVoice.appendChild(xmlVoiceNr);
-                xmlNote.appendChild(xmlVoice);
+                xml.writeTextElement("voice", QString::number(v->voiceNumber()));
 
                 if (elt->musElementType() == CAMusElement::Note) {
-                    exportNote(static_cast<CANote*>(elt), xmlNote);
+                    exportNote(static_cast<CANote*>(elt), xml);
                 } else if (elt->musElementType() == CAMusElement::Rest) {
-                    exportRest(static_cast<CARest*>(elt), xmlNote);
+                    exportRest(static_cast<CARest*>(elt), xml);
                 }
-                xmlMeasure.appendChild(xmlNote);
+                xml.writeEndElement(); // note
             }
             curIndex[i]++;
         }
     }
 }
 
-void CAMusicXmlExport::exportClef(CAClef* clef, QDomElement& xmlClef)
+void CAMusicXmlExport::exportClef(CAClef* clef, QXmlStreamWriter& xml)
 {
     QString sign;
     int line = 0;
@@ -285,46 +334,27 @@ void CAMusicXmlExport::exportClef(CAClef* clef, QDomElement& xmlClef)
         break;
     }
     if (sign.size()) {
-        QDomElement xmlSign = _xmlDoc->createElement("sign");
-        QDomText xmlSignValue = _xmlDoc->createTextNode(sign);
-        xmlSign.appendChild(xmlSignValue);
-        xmlClef.appendChild(xmlSign);
+        xml.writeTextElement("sign", sign);
     }
 
     if (line) {
-        QDomElement xmlLine = _xmlDoc->createElement("line");
-        QDomText xmlLineValue = _xmlDoc->createTextNode(QString::number(line));
-        xmlLine.appendChild(xmlLineValue);
-        xmlClef.appendChild(xmlLine);
+        xml.writeTextElement("line", QString::number(line));
     }
 
     if (clef->offset()) {
-        QDomElement xmlClefOctaveChange = _xmlDoc->createElement("clef-octave-change");
-        QDomText xmlClefOctaveChangeValue = _xmlDoc->createTextNode(QString::number(clef->offset() / 8));
-        xmlClefOctaveChange.appendChild(xmlClefOctaveChangeValue);
-        xmlClef.appendChild(xmlClefOctaveChange);
+        xml.writeTextElement("clef-octave-change", QString::number(clef->offset() / 8));
     }
 }
 
-void CAMusicXmlExport::exportTimeSig(CATimeSignature* time, QDomElement& xmlTime)
+void CAMusicXmlExport::exportTimeSig(CATimeSignature* time, QXmlStreamWriter& xml)
 {
-    QDomElement xmlBeats = _xmlDoc->createElement("beats");
-    QDomText xmlBeatsValue = _xmlDoc->createTextNode(QString::number(time->beats()));
-    xmlBeats.appendChild(xmlBeatsValue);
-    xmlTime.appendChild(xmlBeats);
-
-    QDomElement xmlBeatType = _xmlDoc->createElement("beat-type");
-    QDomText xmlBeatTypeValue = _xmlDoc->createTextNode(QString::number(time->beat()));
-    xmlBeatType.appendChild(xmlBeatTypeValue);
-    xmlTime.appendChild(xmlBeatType);
+    xml.writeTextElement("beats", QString::number(time->beats()));
+    xml.writeTextElement("beat-type", QString::number(time->beat()));
 }
 
-void CAMusicXmlExport::exportKeySig(CAKeySignature* key, QDomElement& xmlKey)
+void CAMusicXmlExport::exportKeySig(CAKeySignature* key, QXmlStreamWriter& xml)
 {
-    QDomElement xmlFifths = _xmlDoc->createElement("fifths");
-    QDomText xmlFifthsValue = _xmlDoc->createTextNode(QString::number(key->diatonicKey().numberOfAccs()));
-    xmlFifths.appendChild(xmlFifthsValue);
-    xmlKey.appendChild(xmlFifths);
+    xml.writeTextElement("fifths", QString::number(key->diatonicKey().numberOfAccs()));
 
     QString mode;
     if (key->diatonicKey().gender() == CADiatonicKey::Major) {
@@ -333,18 +363,14 @@ void CAMusicXmlExport::exportKeySig(CAKeySignature* key, QDomElement& xmlKey)
         mode = "minor";
     }
     if (mode.size()) {
-        QDomElement xmlMode = _xmlDoc->createElement("mode");
-        QDomText xmlModeValue = _xmlDoc->createTextNode(mode);
-        xmlMode.appendChild(xmlModeValue);
-        xmlKey.appendChild(xmlMode);
+        xml.writeTextElement("mode", mode);
     }
 }
 
-void CAMusicXmlExport::exportNote(CANote* note, QDomElement& xmlNote)
+void CAMusicXmlExport::exportNote(CANote* note, QXmlStreamWriter& xml)
 {
     if (note->isPartOfChord() && !note->isFirstInChord()) {
-        QDomElement xmlChord = _xmlDoc->createElement("chord");
-        xmlNote.appendChild(xmlChord);
+        xml.writeEmptyElement("chord");
     }
 
     QString stemDirection;
@@ -354,28 +380,16 @@ void CAMusicXmlExport::exportNote(CANote* note, QDomElement& xmlNote)
         stemDirection = "down";
     }
     if (stemDirection.size()) {
-        QDomElement xmlStemDirection = _xmlDoc->createElement("stem");
-        QDomText xmlStemDirectionValue = _xmlDoc->createTextNode(stemDirection);
-        xmlStemDirection.appendChild(xmlStemDirectionValue);
-        xmlNote.appendChild(xmlStemDirection);
+        xml.writeTextElement("stem", stemDirection);
     }
 
-    QDomElement xmlPitch = _xmlDoc->createElement("pitch");
-    QDomElement xmlStep = _xmlDoc->createElement("step");
-    QDomText xmlStepValue = _xmlDoc->createTextNode(QChar(static_cast<char>((note->diatonicPitch().noteName() + 2) % 7 + 'A')));
-    xmlStep.appendChild(xmlStepValue);
-    xmlPitch.appendChild(xmlStep);
+    xml.writeStartElement("pitch");
+    xml.writeTextElement("step", QString(QChar(static_cast<char>((note->diatonicPitch().noteName() + 2) % 7 + 'A'))));
     if (note->diatonicPitch().accs()) {
-        QDomElement xmlAlter = _xmlDoc->createElement("alter");
-        QDomText xmlAlterValue = _xmlDoc->createTextNode(QString::number(note->diatonicPitch().accs()));
-        xmlAlter.appendChild(xmlAlterValue);
-        xmlPitch.appendChild(xmlAlter);
+        xml.writeTextElement("alter", QString::number(note->diatonicPitch().accs()));
     }
-    QDomElement xmlOctave = _xmlDoc->createElement("octave");
-    QDomText xmlOctaveValue = _xmlDoc->createTextNode(QString::number(note->diatonicPitch().noteName() / 7));
-    xmlOctave.appendChild(xmlOctaveValue);
-    xmlPitch.appendChild(xmlOctave);
-    xmlNote.appendChild(xmlPitch);
+    xml.writeTextElement("octave", QString::number(note->diatonicPitch().noteName() / 7));
+    xml.writeEndElement(); // pitch
 
     QString type;
     switch (note->playableLength().musicLength()) {
@@ -410,15 +424,11 @@ void CAMusicXmlExport::exportNote(CANote* note, QDomElement& xmlNote)
         break;
     }
     if (type.size()) {
-        QDomElement xmlType = _xmlDoc->createElement("type");
-        QDomText xmlTypeValue = _xmlDoc->createTextNode(type);
-        xmlType.appendChild(xmlTypeValue);
-        xmlNote.appendChild(xmlType);
+        xml.writeTextElement("type", type);
     }
 }
 
-void CAMusicXmlExport::exportRest(CARest*, QDomElement& xmlNote)
+void CAMusicXmlExport::exportRest(CARest*, QXmlStreamWriter& xml)
 {
-    QDomElement xmlRest = _xmlDoc->createElement("rest");
-    xmlNote.appendChild(xmlRest);
+    xml.writeEmptyElement("rest");
 }
@@ -10,8 +10,7 @@
 
 #include "export/export.h"
 
-#include <QDomElement>
-
+class QXmlStreamWriter;
 class CAContext;
 class CADocument;
 class CAVoice;
@@ -21,6 +20,7 @@ class CAKeySignature;
 class CATimeSignature;
 class CANote;
 class CARest;
+class CAMusicXmlPartWriter;
 
 class CAMusicXmlExport : public CAExport {
 public:
@@ -33,17 +33,21 @@ public:
     inline CAContext* curContext() { return _curContext; }
     inline int curContextIndex() { return _curContextIndex; }
 
-private:
+protected:
     void exportSheetImpl(CASheet* s);
+
+private:
+    friend class CAMusicXmlPartWriter;
+
     using CAExport::exportStaffImpl;
-    void exportStaffImpl(CAStaff*, QDomElement&);
-    void exportMeasure(QList<CAVoice*>&, int*, QDomElement&);
+    void exportStaffImpl(CAStaff*, QXmlStreamWriter&);
+    void exportMeasure(QList<CAVoice*>&, int*, QXmlStreamWriter&);
 
-    void exportClef(CAClef*, QDomElement&);
-    void exportTimeSig(CATimeSignature*, QDomElement&);
-    void exportKeySig(CAKeySignature*, QDomElement&);
-    void exportNote(CANote*, QDomElement&);
-    void exportRest(CARest*, QDomElement&);
+    void exportClef(CAClef*, QXmlStreamWriter&);
+    void exportTimeSig(CATimeSignature*, QXmlStreamWriter&);
+    void exportKeySig(CAKeySignature*, QXmlStreamWriter&);
+    void exportNote(CANote*, QXmlStreamWriter&);
+    void exportRest(CARest*, QXmlStreamWriter&);
 
     inline void setCurVoice(CAVoice* voice) { _curVoice = voice; }
     inline void setCurSheet(CASheet* sheet) { _curSheet = sheet; }
@@ -56,8 +60,6 @@ private:
     CAContext* _curContext;
     CADocument* _curDocument;
     int _curContextIndex;
-
-    QDomDocument* _xmlDoc;
 };
 
 #endif /* MUSICXMLEXPORT_H_ */
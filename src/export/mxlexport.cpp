@@ -0,0 +1,375 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QTextStream>
+#include <cstring>
+
+#include "export/mxlexport.h"
+
+#define MINIZ_HEADER_FILE_ONLY
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
+#include "zip/miniz.h"
+
+namespace {
+
+void put16(QByteArray& a, quint32 v)
+{
+    a.append(static_cast<char>(v & 0xff));
+    a.append(static_cast<char>((v >> 8) & 0xff));
+}
+
+void put32(QByteArray& a, quint32 v)
+{
+    put16(a, v & 0xffff);
+    put16(a, v >> 16);
+}
+
+}
+
+/*!
+	\class CAZipWriter
+	\brief Writes a zip archive sequentially to a device
+
+	The members are written one after another and the central directory is appended by finish(),
+	so the device doesn't need to be seekable. Small members are stored by addFile(). The member
+	started by beginFile() is deflated while it is written to the returned device, and its sizes and
+	checksum are written after the data in a data descriptor. Zip64 is not supported, so the members
+	and the archive must be smaller than 4 GB.
+*/
+class CAZipWriter : public QIODevice {
+public:
+    CAZipWriter(QIODevice* archive);
+    ~CAZipWriter();
+
+    bool addFile(const QByteArray& name, const QByteArray& data);
+    QIODevice* beginFile(const QByteArray& name);
+    bool endFile();
+    bool finish();
+
+    bool isSequential() const { return true; }
+
+protected:
+    qint64 readData(char*, qint64) { return -1; }
+    qint64 writeData(const char* data, qint64 size);
+
+private:
+    struct CAZipEntry {
+        QByteArray name;
+        quint32 method;
+        quint32 flags;
+        quint32 crc;
+        qint64 compressedSize;
+        qint64 size;
+        qint64 offset; // of the local header
+    };
+
+    bool writeLocalHeader(const CAZipEntry& entry);
+    bool writeArchive(const QByteArray& data);
+    bool deflate(int flush);
+
+    static const int CHUNK;
+    static const qint64 MAX_SIZE;
+
+    QIODevice* _archive;
+    qint64 _offset; // bytes written to the archive
+    quint32 _time; // DOS time and date of the members
+    quint32 _date;
+    QList<CAZipEntry> _entries;
+    mz_stream _strm;
+    bool _deflating; // _strm is initialized, the last entry is being written
+    QByteArray _out; // deflated output buffer
+    bool _ok;
+};
+
+const int CAZipWriter::CHUNK = 65536;
+const qint64 CAZipWriter::MAX_SIZE = 0xffffffffLL;
+
+CAZipWriter::CAZipWriter(QIODevice* archive)
+    : _archive(archive)
+    , _offset(0)
+    , _deflating(false)
+    , _ok(true)
+{
+    memset(&_strm, 0, sizeof(_strm));
+
+    QDateTime now = QDateTime::currentDateTime();
+    _time = static_cast<quint32>((now.time().hour() << 11) | (now.time().minute() << 5) | (now.time().second() / 2));
+    _date = static_cast<quint32>(((qMax(now.date().year(), 1980) - 1980) << 9) | (now.date().month() << 5) | now.date().day());
+}
+
+CAZipWriter::~CAZipWriter()
+{
+    if (_deflating) {
+        mz_deflateEnd(&_strm);
+    }
+}
+
+/*!
+	Stores the member \a name with the given \a data uncompressed. Returns False on a write error.
+*/
+bool CAZipWriter::addFile(const QByteArray& name, const QByteArray& data)
+{
+    CAZipEntry entry = { name, 0, 0, static_cast<quint32>(mz_crc32(MZ_CRC32_INIT, reinterpret_cast<const unsigned char*>(data.constData()), static_cast<size_t>(data.size()))), data.size(), data.size(), _offset };
+    _entries << entry;
+    return writeLocalHeader(entry) && writeArchive(data);
+}
+
+/*!
+	Starts the deflated member \a name. The returned device deflates the data written to it into
+	the archive until endFile() is called. Returns nullptr on a write error.
+*/
+QIODevice* CAZipWriter::beginFile(const QByteArray& name)
+{
+    CAZipEntry entry = { name, MZ_DEFLATED, 0x0008, MZ_CRC32_INIT, 0, 0, _offset }; // sizes in the data descriptor
+    _entries << entry;
+    if (!writeLocalHeader(entry)) {
+        return nullptr;
+    }
+
+    memset(&_strm, 0, sizeof(_strm));
+    if (mz_deflateInit2(&_strm, MZ_DEFAULT_LEVEL, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 9, MZ_DEFAULT_STRATEGY) != MZ_OK) {
+        _ok = false;
+        return nullptr;
+    }
+    _deflating = true;
+    _out.resize(CHUNK);
+
+    open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+    return this;
+}
+
+/*!
+	Flushes the deflated member and writes its data descriptor. Returns False on a write error.
+*/
+bool CAZipWriter::endFile()
+{
+    if (!_deflating) {
+        return false;
+    }
+
+    _strm.next_in = nullptr;
+    _strm.avail_in = 0;
+    deflate(MZ_FINISH);
+    mz_deflateEnd(&_strm);
+    _deflating = false;
+    close();
+
+    CAZipEntry& entry = _entries.last();
+    entry.compressedSize = _offset - entry.offset - 30 - entry.name.size();
+    if (entry.size > MAX_SIZE || entry.compressedSize > MAX_SIZE) {
+        _ok = false;
+    }
+
+    QByteArray descriptor;
+    put32(descriptor, 0x08074b50);
+    put32(descriptor, entry.crc);
+    put32(descriptor, static_cast<quint32>(entry.compressedSize));
+    put32(descriptor, static_cast<quint32>(entry.size));
+    return writeArchive(descriptor) && _ok;
+}
+
+/*!
+	Writes the central directory. Returns True, if the whole archive was written successfully.
+*/
+bool CAZipWriter::finish()
+{
+    qint64 directoryOffset = _offset;
+    QByteArray directory;
+    for (const CAZipEntry& entry : _entries) {
+        put32(directory, 0x02014b50);
+        put16(directory, 20); // made by
+        put16(directory, 20); // needed to extract
+        put16(directory, entry.flags);
+        put16(directory, entry.method);
+        put16(directory, _time);
+        put16(directory, _date);
+        put32(directory, entry.crc);
+        put32(directory, static_cast<quint32>(entry.compressedSize));
+        put32(directory, static_cast<quint32>(entry.size));
+        put16(directory, static_cast<quint32>(entry.name.size()));
+        put16(directory, 0); // extra field
+        put16(directory, 0); // comment
+        put16(directory, 0); // disk
+        put16(directory, 0); // internal attributes
+        put32(directory, 0); // external attributes
+        put32(directory, static_cast<quint32>(entry.offset));
+        directory += entry.name;
+    }
+
+    int directorySize = directory.size();
+    put32(directory, 0x06054b50);
+    put16(directory, 0); // disk
+    put16(directory, 0); // disk with the central directory
+    put16(directory, static_cast<quint32>(_entries.size()));
+    put16(directory, static_cast<quint32>(_entries.size()));
+    put32(directory, static_cast<quint32>(directorySize));
+    put32(directory, static_cast<quint32>(directoryOffset));
+    put16(directory, 0); // comment
+
+    return writeArchive(directory) && _offset <= MAX_SIZE && _ok;
+}
+
+qint64 CAZipWriter::writeData(const char* data, qint64 size)
+{
+    if (!_deflating || !_ok) {
+        return -1;
+    }
+
+    CAZipEntry& entry = _entries.last();
+    entry.crc = static_cast<quint32>(mz_crc32(entry.crc, reinterpret_cast<const unsigned char*>(data), static_cast<size_t>(size)));
+    entry.size += size;
+
+    _strm.next_in = reinterpret_cast<const unsigned char*>(data);
+    _strm.avail_in = static_cast<unsigned int>(size);
+    return deflate(MZ_NO_FLUSH) ? size : -1;
+}
+
+bool CAZipWriter::writeLocalHeader(const CAZipEntry& entry)
+{
+    QByteArray header;
+    put32(header, 0x04034b50);
+    put16(header, 20); // needed to extract
+    put16(header, entry.flags);
+    put16(header, entry.method);
+    put16(header, _time);
+    put16(header, _date);
+    put32(header, (entry.flags & 0x0008) ? 0 : entry.crc);
+    put32(header, (entry.flags & 0x0008) ? 0 : static_cast<quint32>(entry.compressedSize));
+    put32(header, (entry.flags & 0x0008) ? 0 : static_cast<quint32>(entry.size));
+    put16(header, static_cast<quint32>(entry.name.size()));
+    put16(header, 0); // extra field
+
+    return writeArchive(header + entry.name);
+}
+
+bool CAZipWriter::writeArchive(const QByteArray& data)
+{
+    if (_ok && _archive->write(data) != data.size()) {
+        _ok = false;
+    }
+    _offset += data.size();
+    return _ok;
+}
+
+/*!
+	Deflates the pending input into the archive. With MZ_FINISH, the stream is flushed to its end.
+*/
+bool CAZipWriter::deflate(int flush)
+{
+    for (;;) {
+        _strm.next_out = reinterpret_cast<unsigned char*>(_out.data());
+        _strm.avail_out = static_cast<unsigned int>(_out.size());
+        int ret = mz_deflate(&_strm, flush);
+        if (ret != MZ_OK && ret != MZ_STREAM_END && ret != MZ_BUF_ERROR) {
+            _ok = false;
+            return false;
+        }
+
+        int n = _out.size() - static_cast<int>(_strm.avail_out);
+        if (n && !writeArchive(QByteArray::fromRawData(_out.constData(), n))) {
+            return false;
+        }
+
+        if ((flush == MZ_FINISH) ? (ret == MZ_STREAM_END) : (!_strm.avail_in && _strm.avail_out)) {
+            return true;
+        }
+    }
+}
+
+const char* CAMXLExport::CONTAINER_FILE = "META-INF/container.xml";
+const char* CAMXLExport::MIMETYPE = "application/vnd.recordare.musicxml";
+
+/*!
+	\class CAMXLExport
+	\brief Compressed MusicXML (.mxl) export
+
+	Writes the MusicXML of the sheet produced by CAMusicXmlExport into a zip container readable by
+	CAMXLImport. The MusicXML is deflated by miniz while it is written, so neither the uncompressed
+	score nor the compressed archive are kept in memory. The archive is written sequentially to the
+	stream's device, which doesn't need to be seekable:
+	\code
+	  CAMXLExport mxl;
+	  mxl.setStreamToFile("score.mxl");
+	  mxl.exportSheet(sheet);
+	  mxl.wait();
+	\endcode
+
+	The container contains the uncompressed mimetype member, META-INF/container.xml pointing to the
+	score and the score itself named after the exported file.
+
+	\sa CAMXLImport
+*/
+
+CAMXLExport::CAMXLExport(QTextStream* stream)
+    : CAMusicXmlExport(stream)
+{
+}
+
+CAMXLExport::~CAMXLExport()
+{
+}
+
+const QString CAMXLExport::readableStatus()
+{
+    if (status() == -2) {
+        return tr("Unable to write the compressed archive");
+    }
+
+    return CAMusicXmlExport::readableStatus();
+}
+
+void CAMXLExport::exportSheetImpl(CASheet* sheet)
+{
+    QTextStream* archiveStream = stream();
+    QIODevice* archive = archiveStream->device();
+    if (!archive) {
+        setStatus(-1);
+        return;
+    }
+    archiveStream->flush();
+
+    QString scoreName = "score.musicxml";
+    if (file() && archive == file()) {
+        scoreName = QFileInfo(file()->fileName()).completeBaseName() + ".musicxml";
+    }
+
+    QByteArray container;
+    QTextStream containerStream(&container);
+    containerStream.setCodec("UTF-8");
+    containerStream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                    << "<container>\n"
+                    << "  <rootfiles>\n"
+                    << "    <rootfile full-path=\"" << scoreName.toHtmlEscaped() << "\" media-type=\"application/vnd.recordare.musicxml+xml\"/>\n"
+                    << "  </rootfiles>\n"
+                    << "</container>\n";
+    containerStream.flush();
+
+    CAZipWriter zip(archive);
+    QIODevice* score = nullptr;
+    if (zip.addFile("mimetype", MIMETYPE) && zip.addFile(CONTAINER_FILE, container)) {
+        score = zip.beginFile(scoreName.toUtf8());
+    }
+    if (!score) {
+        setStatus(-2);
+        return;
+    }
+
+    // the MusicXML export writes to out(), redirect it into the deflated member
+    QTextStream scoreStream(score);
+    setStream(&scoreStream);
+    CAMusicXmlExport::exportSheetImpl(sheet);
+    scoreStream.flush();
+    setStream(archiveStream);
+
+    if (!zip.endFile() || !zip.finish()) {
+        setStatus(-2);
+    }
+}
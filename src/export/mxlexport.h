@@ -0,0 +1,28 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#ifndef MXLEXPORT_H_
+#define MXLEXPORT_H_
+
+#include "export/musicxmlexport.h"
+
+class CAMXLExport : public CAMusicXmlExport {
+public:
+    CAMXLExport(QTextStream* stream = nullptr);
+    virtual ~CAMXLExport();
+
+    const QString readableStatus();
+
+protected:
+    void exportSheetImpl(CASheet* sheet);
+
+private:
+    static const char* CONTAINER_FILE; // name of the container description in the archive
+    static const char* MIMETYPE; // of the archive, stored uncompressed as the first member
+};
+
+#endif /* MXLEXPORT_H_ */
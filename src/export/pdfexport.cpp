@@ -6,13 +6,44 @@
 */
 
 // Includes
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QProcess>
+#include <QTextStream>
+
 #include "export/pdfexport.h"
 #include "control/typesetctl.h"
+#include "control/typesetserver.h"
 #include "export/lilypondexport.h"
 #ifndef SWIGCPP
 #include "canorus.h" // needed for settings()
 #endif
 #include "core/settings.h"
+#include "core/trace.h"
+#include "score/document.h"
+#include "score/sheet.h"
+
+namespace {
+
+QMutex sheetCacheMutex;
+QHash<CADocument*, QHash<QByteArray, QString>> sheetCache; // LilyPond source hash -> typeset PDF file of each document
+bool sheetCacheCleanup = false;
+
+void clearSheetCache()
+{
+    QMutexLocker oLocker(&sheetCacheMutex);
+    for (const QHash<QByteArray, QString>& roSheets : sheetCache) {
+        for (const QString& roPdfFile : roSheets)
+            QFile::remove(roPdfFile);
+    }
+    sheetCache.clear();
+}
+
+}
 
 /*!
 	\class CAPDFExport
@@ -24,6 +55,10 @@
 	\endcode
 
 	\a textStream is usually the file stream or the content of the score source view widget.
+
+	Each sheet is typeset separately and the typeset PDF is kept in a per-document cache indexed by
+	the hash of the sheet's LilyPond source. Exporting the document again only runs the typesetter
+	for the sheets whose source changed. The PDFs of the sheets are then merged using Ghostscript.
 */
 
 /*!
@@ -33,48 +68,41 @@
 CAPDFExport::CAPDFExport(QTextStream* stream)
     : CAExport(stream)
 {
-    _poTypesetCtl = nullptr;
 }
 
 // Destructor
 CAPDFExport::~CAPDFExport()
 {
-    if (_poTypesetCtl) {
-        delete _poTypesetCtl->getExporter();
-        delete _poTypesetCtl;
-    }
-    _poTypesetCtl = nullptr;
 }
 
-void CAPDFExport::startExport()
+/*!
+	Creates the typesetter instance. The caller takes the ownership of it and its exporter.
+*/
+CATypesetCtl* CAPDFExport::createTypesetCtl()
 {
-    _poTypesetCtl = new CATypesetCtl();
+    CATypesetCtl* poTypesetCtl = new CATypesetCtl();
     // For now we support only lilypond export
 #ifndef SWIGCPP
-    _poTypesetCtl->setTypesetter((CACanorus::settings()->useSystemDefaultTypesetter()) ? (CASettings::DEFAULT_TYPESETTER_LOCATION) : (CACanorus::settings()->typesetterLocation()));
+    poTypesetCtl->setTypesetter((CACanorus::settings()->useSystemDefaultTypesetter()) ? (CASettings::DEFAULT_TYPESETTER_LOCATION) : (CACanorus::settings()->typesetterLocation()));
 #else
-    _poTypesetCtl->setTypesetter(CASettings::DEFAULT_TYPESETTER_LOCATION);
+    poTypesetCtl->setTypesetter(CASettings::DEFAULT_TYPESETTER_LOCATION);
+#endif
+    poTypesetCtl->setExporter(new CALilyPondExport());
+    poTypesetCtl->setServerMode(true); // reuse the warm typesetter process
+#ifndef SWIGCPP
+    CATypesetServer::instance()->setMaxJobs(CACanorus::settings()->typesetterJobs());
 #endif
-    _poTypesetCtl->setExporter(new CALilyPondExport());
     // Put lilypond output to console, could be shown on a canorus console later
-    connect(_poTypesetCtl, SIGNAL(nextOutput(const QByteArray&)), this, SLOT(outputTypsetterOutput(const QByteArray&)));
-    connect(_poTypesetCtl, SIGNAL(typesetterFinished(int)), this, SLOT(pdfFinished(int)));
-}
-
-void CAPDFExport::finishExport()
-{
-    if (_poTypesetCtl) {
-        // Put lilypond output to console, could be shown on a canorus console later
-        disconnect(_poTypesetCtl, SIGNAL(nextOutput(const QByteArray&)), this, SLOT(outputTypsetterOutput(const QByteArray&)));
-        disconnect(_poTypesetCtl, SIGNAL(typesetterFinished(int)), this, SLOT(pdfFinished(int)));
-        delete _poTypesetCtl;
-        _poTypesetCtl = nullptr; // Destruktor may not delete the same object again
-    }
+    connect(poTypesetCtl, SIGNAL(nextOutput(const QByteArray&)), this, SLOT(outputTypsetterOutput(const QByteArray&)));
+    return poTypesetCtl;
 }
 
 /*!
 	Exports the document \a poDoc to LilyPond first and create a PDF from it
 	using the Typesetter instance.
+
+	Only the sheets changed since the last export are typeset. They are typeset
+	in parallel and the PDFs of the sheets are merged into the output file afterwards.
 */
 void CAPDFExport::exportDocumentImpl(CADocument* poDoc)
 {
@@ -82,50 +110,176 @@ void CAPDFExport::exportDocumentImpl(CADocument* poDoc)
         //TODO: no sheets, raise an error
         return;
     }
-    // We cannot create the typesetter instance (a QProcess in the end)
-    // in the constructor as it's parent would be in a different thread!
-    startExport();
-    // The exportDocument method defines the temporary file name and
-    // directory, so we can only read it after the creation
-    _poTypesetCtl->exportDocument(poDoc);
-    // actual PDF creation is done now
-    runTypesetter();
+
+    QList<CASheetJob> oJobs;
+    for (CASheet* poSheet : poDoc->sheetList())
+        oJobs << startSheet(poSheet);
+
+    QStringList oPdfFiles;
+    int iExitCode = 0;
+    for (CASheetJob& roJob : oJobs) {
+        int iSheetExitCode = finishSheet(roJob); // all the jobs need to be finished
+        if (!iExitCode)
+            iExitCode = iSheetExitCode;
+        oPdfFiles << roJob.pdfFile;
+    }
+
+    if (!iExitCode) {
+        pruneCache(poDoc, oPdfFiles);
+        iExitCode = writePdf(oPdfFiles);
+    }
+    pdfFinished(iExitCode);
 }
 
 /*!
 	Exports the sheet \a poSheet to LilyPond first and create a PDF from it
-	using the Typesetter instance.
+	using the Typesetter instance. The typesetter is not run, if the sheet
+	didn't change since the last export.
 */
 void CAPDFExport::exportSheetImpl(CASheet* poSheet)
 {
-    // We cannot create the typesetter instance (a QProcess in the end)
-    // in the constructor as it's parent would be in a different thread!
-    startExport();
-    // The exportSheet method defines the temporary file name and
-    // directory, so we can only read it after the creation
-    _poTypesetCtl->exportSheet(poSheet);
-    // actual PDF creation is done now
-    runTypesetter();
+    CASheetJob oJob = startSheet(poSheet);
+    int iExitCode = finishSheet(oJob);
+    if (!iExitCode)
+        iExitCode = writePdf(QStringList() << oJob.pdfFile);
+    pdfFinished(iExitCode);
+}
+
+/*!
+	Exports the sheet \a poSheet to LilyPond and starts typesetting it, unless
+	the cached PDF of the same LilyPond source exists.
+
+	\sa finishSheet()
+*/
+CAPDFExport::CASheetJob CAPDFExport::startSheet(CASheet* poSheet)
+{
+    QString oSource;
+    QTextStream oStream(&oSource);
+    CALilyPondExport oExport(&oStream);
+    oExport.exportSheet(poSheet);
+    oExport.wait();
+    oStream.flush();
+
+    QByteArray oData = oSource.toUtf8();
+    CASheetJob oJob;
+    oJob.document = poSheet->document();
+    oJob.hash = QCryptographicHash::hash(oData, QCryptographicHash::Sha1);
+    oJob.typesetCtl = nullptr;
+
+    sheetCacheMutex.lock();
+    oJob.pdfFile = sheetCache[oJob.document].value(oJob.hash);
+    sheetCacheMutex.unlock();
+    if (!oJob.pdfFile.isEmpty() && QFile::exists(oJob.pdfFile))
+        return oJob;
+
+    oJob.pdfFile = QDir::tempPath() + QString("/canorus-sheet-%1-%2.pdf").arg(QCoreApplication::applicationPid()).arg(QString(oJob.hash.toHex()));
+    oJob.typesetCtl = createTypesetCtl();
+    oJob.typesetCtl->exportData(oData);
+    oJob.typesetCtl->setTSetOption(QString("o"), oJob.typesetCtl->getTempFilePath());
+    oJob.typesetCtl->runTypesetter(); // create pdf
+    return oJob;
 }
 
 /*!
-	Run creation of PDF file after deleting a potential old one
+	Waits for the typesetter started by startSheet() and stores the typeset PDF
+	of the sheet to the cache. Returns the typesetter exit code.
 */
-void CAPDFExport::runTypesetter()
+int CAPDFExport::finishSheet(CASheetJob& roJob)
+{
+    if (!roJob.typesetCtl)
+        return 0; // cached
+
+    CA_TRACE_ZONE("CAPDFExport::finishSheet");
+    // as we are not in the main thread wait until we are finished
+    if (roJob.typesetCtl->waitForFinished(-1) == false) {
+        qWarning("PDFExport: Typesetter %s was not finished", "lilypond");
+    }
+    int iExitCode = roJob.typesetCtl->getExitCode();
+    const QString roTempPath = roJob.typesetCtl->getTempFilePath();
+    delete roJob.typesetCtl->getExporter();
+    delete roJob.typesetCtl;
+    roJob.typesetCtl = nullptr;
+
+    QFile::remove(roJob.pdfFile);
+    if (!iExitCode && !QFile::rename(roTempPath + ".pdf", roJob.pdfFile)) {
+        qCritical("PDFExport: Could not move temporary file %s", qPrintable(roTempPath + ".pdf"));
+        iExitCode = -1;
+    }
+    // Remove temporary files. No warning as not every typesetter leaves postscript files behind
+    QFile::remove(roTempPath + ".pdf");
+    QFile::remove(roTempPath + ".ps");
+    QFile::remove(roTempPath);
+
+    if (!iExitCode) {
+        QMutexLocker oLocker(&sheetCacheMutex);
+        sheetCache[roJob.document][roJob.hash] = roJob.pdfFile;
+        if (!sheetCacheCleanup) {
+            qAddPostRoutine(clearSheetCache);
+            sheetCacheCleanup = true;
+        }
+    }
+    return iExitCode;
+}
+
+/*!
+	Removes the cached PDFs of the document \a poDoc not being used by any of its
+	sheets \a roPdfFiles anymore.
+*/
+void CAPDFExport::pruneCache(CADocument* poDoc, const QStringList& roPdfFiles)
+{
+    QMutexLocker oLocker(&sheetCacheMutex);
+    QHash<QByteArray, QString>& roSheets = sheetCache[poDoc];
+    for (QHash<QByteArray, QString>::iterator it = roSheets.begin(); it != roSheets.end();) {
+        if (!roPdfFiles.contains(it.value())) {
+            QFile::remove(it.value());
+            it = roSheets.erase(it);
+        } else
+            ++it;
+    }
+}
+
+/*!
+	Writes the PDFs \a roPdfFiles to the destination file merging them using
+	Ghostscript, if there is more than one. Returns 0 on success.
+*/
+int CAPDFExport::writePdf(const QStringList& roPdfFiles)
 {
-    const QString roTempPath = _poTypesetCtl->getTempFilePath();
-    _poTypesetCtl->setTSetOption(QString("o"), roTempPath);
     // Remove old pdf file first, but ignore error (file might not exist)
     if (!file()->remove()) {
         qWarning("PDFExport: Could not remove old pdf file %s, error %s", qPrintable(file()->fileName()),
             qPrintable(file()->errorString()));
         file()->unsetError();
     }
-    _poTypesetCtl->runTypesetter(); // create pdf
-    // as we are not in the main thread wait until we are finished
-    if (_poTypesetCtl->waitForFinished(-1) == false) {
-        qWarning("PDFExport: Typesetter %s was not finished", "lilypond");
+
+    qDebug("Exporting PDF file %s", file()->fileName().toLatin1().data());
+    if (roPdfFiles.size() == 1) {
+        if (!QFile::copy(roPdfFiles[0], file()->fileName())) {
+            qCritical("PDFExport: Could not copy temporary file %s", qPrintable(roPdfFiles[0]));
+            return -1;
+        }
+        return 0;
     }
+
+    CA_TRACE_ZONE("CAPDFExport::mergePdf");
+    // LilyPond ships with Ghostscript, prefer the one next to the typesetter
+#ifndef SWIGCPP
+    QFileInfo oTypesetter((CACanorus::settings()->useSystemDefaultTypesetter()) ? (CASettings::DEFAULT_TYPESETTER_LOCATION) : (CACanorus::settings()->typesetterLocation()));
+#else
+    QFileInfo oTypesetter(CASettings::DEFAULT_TYPESETTER_LOCATION);
+#endif
+    QString oGhostscript = oTypesetter.path() + "/gs" + (oTypesetter.suffix().isEmpty() ? "" : "." + oTypesetter.suffix());
+    if (oTypesetter.path() == "." || !QFile::exists(oGhostscript))
+        oGhostscript = "gs";
+
+    int iExitCode = QProcess::execute(oGhostscript, QStringList() << "-q"
+                                                                  << "-dBATCH"
+                                                                  << "-dNOPAUSE"
+                                                                  << "-sDEVICE=pdfwrite"
+                                                                  << QString("-sOutputFile=") + file()->fileName()
+                                                                  << roPdfFiles);
+    if (iExitCode)
+        qCritical("PDFExport: Merging the sheets using %s failed with code %d", qPrintable(oGhostscript), iExitCode);
+    return iExitCode;
 }
 
 /*!
@@ -138,40 +292,10 @@ void CAPDFExport::outputTypsetterOutput(const QByteArray& roOutput)
 }
 
 /*!
-	When the typesetter is finished copy the pdf file to the defined destination
+	Sets the export status and signals the PDF is written.
 */
 void CAPDFExport::pdfFinished(int iExitCode)
 {
     setStatus(iExitCode);
-    QFile oTempFile(getTempFilePath() + ".pdf");
-    oTempFile.setFileName(getTempFilePath() + ".pdf");
-    qDebug("Exporting PDF file %s", file()->fileName().toLatin1().data());
-    if (!iExitCode && !oTempFile.copy(file()->fileName())) // Rename it, so we can delete the temporary file
-    {
-        qCritical("PDFExport: Could not copy temporary file %s, error %s", qPrintable(oTempFile.fileName()),
-            qPrintable(oTempFile.errorString()));
-        return;
-    }
     emit pdfIsFinished(iExitCode);
-    // Remove temporary files.
-    if (!oTempFile.remove()) {
-        qWarning("PDFExport: Could not remove temporary file %s, error %s", qPrintable(oTempFile.fileName()),
-            qPrintable(oTempFile.errorString()));
-        oTempFile.unsetError();
-    }
-    oTempFile.setFileName(getTempFilePath() + ".ps");
-    // No warning as not every typesetter leaves postscript files behind
-    oTempFile.remove();
-    oTempFile.setFileName(getTempFilePath());
-    if (!oTempFile.remove()) {
-        qWarning("PDFExport: Could not remove temporary file %s, error %s", qPrintable(oTempFile.fileName()),
-            qPrintable(oTempFile.errorString()));
-        oTempFile.unsetError();
-    }
-    finishExport();
-}
-
-QString CAPDFExport::getTempFilePath()
-{
-    return (_poTypesetCtl ? _poTypesetCtl->getTempFilePath() : "");
 }
@@ -25,24 +25,31 @@ public:
     CAPDFExport(QTextStream* stream = 0);
     ~CAPDFExport();
 
-    QString getTempFilePath();
 #ifndef SWIG
 signals:
     void pdfIsFinished(int iExitCode);
 
 protected slots:
     void outputTypsetterOutput(const QByteArray& roOutput);
+
+protected:
     void pdfFinished(int iExitCode);
 
 private:
-    void startExport();
-    void finishExport();
+    struct CASheetJob {
+        CADocument* document;
+        QByteArray hash; // of the sheet's LilyPond source
+        QString pdfFile; // typeset PDF of the sheet
+        CATypesetCtl* typesetCtl; // running typesetter or null, if the cached PDF is used
+    };
+
+    CATypesetCtl* createTypesetCtl();
     void exportDocumentImpl(CADocument* doc);
     void exportSheetImpl(CASheet* poSheet);
-    void runTypesetter();
-
-protected:
-    CATypesetCtl* _poTypesetCtl;
+    CASheetJob startSheet(CASheet* poSheet);
+    int finishSheet(CASheetJob& roJob);
+    void pruneCache(CADocument* poDoc, const QStringList& roPdfFiles);
+    int writePdf(const QStringList& roPdfFiles);
 #endif
 };
 
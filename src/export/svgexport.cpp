@@ -8,6 +8,7 @@
 // Includes
 #include "export/svgexport.h"
 #include "control/typesetctl.h"
+#include "control/typesetserver.h"
 #include "export/lilypondexport.h"
 #ifndef SWIGCPP
 #include "canorus.h" // needed for settings()
@@ -57,6 +58,10 @@ void CASVGExport::startExport()
 #endif
     _poTypesetCtl->setTSetOption("dbackend", "svg", false, false);
     _poTypesetCtl->setExporter(new CALilyPondExport());
+    _poTypesetCtl->setServerMode(true); // reuse the warm typesetter process
+#ifndef SWIGCPP
+    CATypesetServer::instance()->setMaxJobs(CACanorus::settings()->typesetterJobs());
+#endif
     // Put lilypond output to console, could be shown on a canorus console later
     connect(_poTypesetCtl, SIGNAL(nextOutput(const QByteArray&)), this, SLOT(outputTypsetterOutput(const QByteArray&)));
     connect(_poTypesetCtl, SIGNAL(typesetterFinished(int)), this, SLOT(svgFinished(int)));
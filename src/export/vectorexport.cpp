@@ -0,0 +1,273 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QFile>
+#include <QPainter>
+#include <QPdfWriter>
+#include <QPrinter>
+#include <QSvgGenerator>
+
+#include "export/vectorexport.h"
+
+#include "layout/drawablecontext.h"
+#include "layout/drawablemuselement.h"
+#include "layout/layoutcache.h"
+#include "layout/sheetlayout.h"
+#include "score/muselement.h"
+#include "score/rest.h"
+#include "score/sheet.h"
+#include "widgets/scoreview.h"
+
+#include "core/progress.h"
+#include "core/trace.h"
+
+#include <cmath>
+#include <memory>
+
+const double CAVectorExport::RENDER_SCALE = 4; // drawables are placed in whole pixels, render them at a finer resolution
+const int CAVectorExport::MARGIN = 20; // in world units
+
+/*!
+	\class CAVectorExport
+	\brief Native SVG and PDF export of the engraved sheet
+
+	Unlike CASVGExport and CAPDFExport, which typeset the sheet by LilyPond, this export renders the
+	drawables placed by CALayoutEngine directly using QSvgGenerator or QPdfWriter. The output looks
+	the same as the score view and is written almost instantly, so it is suitable for quick previews.
+
+	The layout is shared with the score views of the sheet (see CASheetLayout), so the sheet is only
+	engraved again, if it was changed. SVG is written as a single strip of the whole sheet. PDF
+	splits the strip at the bars into systems placed below each other on A4 pages. printSheet()
+	paginates the same way directly on a QPrinter for the quick proof prints.
+
+	As the layout needs a score view, the export must be run in the main thread:
+	\code
+	  CAVectorExport exporter(CAVectorExport::SVG);
+	  exporter.exportSheet(sheet, "preview.svg");
+	\endcode
+*/
+
+CAVectorExport::CAVectorExport(CAVectorFormat format)
+    : _format(format)
+    , _progress(nullptr)
+{
+}
+
+/*!
+	Engraves the \a sheet and writes it to \a fileName in the current format.
+	Returns True on success, otherwise False. Nothing is written, if the progress() token was
+	canceled during the layout.
+*/
+bool CAVectorExport::exportSheet(CASheet* sheet, const QString& fileName)
+{
+    QFile file(fileName);
+    return exportSheet(sheet, &file);
+}
+
+/*!
+	Engraves the \a sheet and writes it to the \a device in the current format. The device is
+	opened for writing after the layout, if it isn't open yet.
+*/
+bool CAVectorExport::exportSheet(CASheet* sheet, QIODevice* device)
+{
+    CA_TRACE_ZONE("CAVectorExport::exportSheet");
+
+    // hidden view sharing the layout of the sheet
+    std::unique_ptr<CAScoreView> v(new CAScoreView(sheet));
+    if (!v->completeLayout(_progress)) {
+        return false;
+    }
+
+    if (!device->isOpen() && !device->open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    return (_format == PDF) ? exportPDF(v.get(), device) : exportSVG(v.get(), device);
+}
+
+bool CAVectorExport::exportSVG(CAScoreView* v, QIODevice* device)
+{
+    QRectF bounds = sheetBounds(v);
+
+    QSvgGenerator generator;
+    generator.setOutputDevice(device);
+    generator.setTitle(v->sheet()->name());
+    generator.setDescription(QString("Generated by Canorus, version ") + CANORUS_VERSION);
+    generator.setSize(bounds.size().toSize());
+    generator.setViewBox(QRectF(QPointF(0, 0), bounds.size()));
+
+    QPainter p;
+    if (!p.begin(&generator)) {
+        return false;
+    }
+    render(&p, v, bounds);
+
+    return p.end();
+}
+
+bool CAVectorExport::exportPDF(CAScoreView* v, QIODevice* device)
+{
+    QPdfWriter writer(device);
+    writer.setTitle(v->sheet()->name());
+    writer.setCreator(QString("Canorus ") + CANORUS_VERSION);
+    writer.setPageSize(QPagedPaintDevice::A4);
+
+    return paintPages(v, &writer);
+}
+
+/*!
+	Engraves the \a sheet and prints it on the \a printer set up by the caller, eg. by QPrintDialog,
+	without running the typesetter. The pages are split the same as in the PDF export and the
+	printer's page range is respected. Each page is passed to the printer as soon as it is drawn.
+	Returns True on success or False, if the printing failed or the progress() token was canceled.
+*/
+bool CAVectorExport::printSheet(CASheet* sheet, QPrinter* printer)
+{
+    CA_TRACE_ZONE("CAVectorExport::printSheet");
+
+    std::unique_ptr<CAScoreView> v(new CAScoreView(sheet));
+    if (!v->completeLayout(_progress)) {
+        return false;
+    }
+
+    if (printer->docName().isEmpty()) {
+        printer->setDocName(sheet->name());
+    }
+    printer->setCreator(QString("Canorus ") + CANORUS_VERSION);
+
+    return paintPages(v.get(), printer, printer->fromPage(), printer->toPage());
+}
+
+/*!
+	Breaks the engraved strip of the view \a v into systems at the bars and paints them below each
+	other on the pages of the \a device. Only the pages from \a fromPage to \a toPage, counted from
+	1, are painted, if set. Returns False, if the device cannot be painted or the progress() token
+	was canceled.
+*/
+bool CAVectorExport::paintPages(CAScoreView* v, QPagedPaintDevice* device, int fromPage, int toPage)
+{
+    QRectF bounds = sheetBounds(v);
+
+    QPainter p;
+    if (!p.begin(device)) {
+        return false;
+    }
+
+    // one world unit is a pixel at 100% zoom on a 96 dpi screen
+    double scale = device->logicalDpiX() / 96.0;
+    p.scale(scale, scale);
+    double pageWidth = device->width() / scale;
+    double pageHeight = device->height() / scale;
+    double systemWidth = pageWidth - 2 * MARGIN;
+
+    // break the strip at the bars
+    const QList<CALayoutColumn>& columns = v->layoutCache().columnList();
+    double y = MARGIN;
+    double start = bounds.left();
+    int page = 1;
+    bool pagePainted = false; // the current page was already started on the device
+    while (start < bounds.right() && (!toPage || page <= toPage)) {
+        if (_progress && _progress->isCanceled()) {
+            p.end();
+            return false;
+        }
+
+        double end = qMin(bounds.right(), start + systemWidth);
+        if (end < bounds.right()) {
+            for (int i = columns.size() - 1; i >= 0; i--) {
+                if (columns[i].x > start && columns[i].x <= end) {
+                    end = columns[i].x;
+                    break;
+                }
+            }
+        }
+
+        if (y + bounds.height() > pageHeight - MARGIN && y > MARGIN) {
+            page++;
+            y = MARGIN;
+        }
+
+        if (page >= fromPage && (!toPage || page <= toPage)) {
+            if (pagePainted && y == MARGIN) {
+                device->newPage(); // the previous page is sent to the printer
+            }
+            pagePainted = true;
+
+            p.save();
+            p.translate(MARGIN, y);
+            render(&p, v, QRectF(start, bounds.top(), end - start, bounds.height()));
+            p.restore();
+        }
+
+        y += bounds.height();
+        start = end;
+    }
+
+    return p.end();
+}
+
+/*!
+	Returns the area of the sheet covered by the drawables including the margin.
+*/
+QRectF CAVectorExport::sheetBounds(CAScoreView* v)
+{
+    double maxX = qMax(v->sheetLayout()->drawableMList().getMaxX(), v->sheetLayout()->drawableCList().getMaxX());
+    double maxY = qMax(v->sheetLayout()->drawableMList().getMaxY(), v->sheetLayout()->drawableCList().getMaxY());
+
+    return QRectF(0, 0, maxX + MARGIN, maxY + MARGIN);
+}
+
+/*!
+	Draws the contexts and music elements inside \a region of the sheet with the region's top-left
+	corner at the painter's origin.
+*/
+void CAVectorExport::render(QPainter* p, CAScoreView* v, const QRectF& region)
+{
+    int w = static_cast<int>(std::ceil(region.width() * RENDER_SCALE));
+    int h = static_cast<int>(std::ceil(region.height() * RENDER_SCALE));
+
+    p->save();
+    p->scale(1 / RENDER_SCALE, 1 / RENDER_SCALE);
+    p->setClipRect(0, 0, w, h);
+
+    QList<CADrawableContext*> cList = v->sheetLayout()->drawableCList().findInRange(region.x(), region.y(), region.width(), region.height());
+    for (int i = 0; i < cList.size(); i++) {
+        CADrawSettings s = {
+            RENDER_SCALE,
+            qRound((cList[i]->xPos() - region.x()) * RENDER_SCALE),
+            qRound((cList[i]->yPos() - region.y()) * RENDER_SCALE),
+            w, h,
+            Qt::black,
+            region.x(),
+            region.y()
+        };
+        cList[i]->draw(p, s);
+    }
+
+    p->setRenderHint(QPainter::Antialiasing, true);
+
+    QList<CADrawableMusElement*> mList = v->sheetLayout()->drawableMList().findInRange(region.x(), region.y(), region.width(), region.height());
+    for (int i = 0; i < mList.size(); i++) {
+        CAMusElement* elt = mList[i]->musElement();
+        if (elt && (!elt->isVisible() || (elt->musElementType() == CAMusElement::Rest && static_cast<CARest*>(elt)->restType() == CARest::Hidden))) {
+            continue;
+        }
+
+        CADrawSettings s = {
+            RENDER_SCALE,
+            qRound((mList[i]->xPos() - region.x()) * RENDER_SCALE),
+            qRound((mList[i]->yPos() - region.y()) * RENDER_SCALE),
+            w, h,
+            (elt && elt->color().isValid()) ? elt->color() : QColor(Qt::black),
+            region.x(),
+            region.y()
+        };
+        mList[i]->draw(p, s);
+    }
+
+    p->restore();
+}
@@ -0,0 +1,54 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef VECTOREXPORT_H_
+#define VECTOREXPORT_H_
+
+#include <QRectF>
+#include <QString>
+
+class QIODevice;
+class QPagedPaintDevice;
+class QPainter;
+class QPrinter;
+class CAProgress;
+class CAScoreView;
+class CASheet;
+
+class CAVectorExport {
+public:
+    enum CAVectorFormat {
+        SVG,
+        PDF
+    };
+
+    CAVectorExport(CAVectorFormat format = SVG);
+
+    inline CAVectorFormat format() { return _format; }
+    inline void setFormat(CAVectorFormat format) { _format = format; }
+    inline CAProgress* progress() { return _progress; }
+    inline void setProgress(CAProgress* progress) { _progress = progress; }
+
+    bool exportSheet(CASheet* sheet, const QString& fileName);
+    bool exportSheet(CASheet* sheet, QIODevice* device);
+    bool printSheet(CASheet* sheet, QPrinter* printer);
+
+private:
+    bool exportSVG(CAScoreView* v, QIODevice* device);
+    bool exportPDF(CAScoreView* v, QIODevice* device);
+    bool paintPages(CAScoreView* v, QPagedPaintDevice* device, int fromPage = 0, int toPage = 0);
+    QRectF sheetBounds(CAScoreView* v);
+    void render(QPainter* p, CAScoreView* v, const QRectF& region);
+
+    static const double RENDER_SCALE;
+    static const int MARGIN;
+
+    CAVectorFormat _format;
+    CAProgress* _progress; // progress and cancellation of the layout, optional
+};
+
+#endif /* VECTOREXPORT_H_ */
@@ -1,384 +1,385 @@
 // To regenerate using linux tools:
 // 1. Put the new font in this directory, and load it in fontforge, then save a namelist (Encoding->Save Namelist of Font) to fetaList.nam in this directory.
-// 2. Run: ( grep '^//' fetaList.cxx; cat fetaList.nam | while read ln; do echo '_fetaMap["'`echo $ln | cut -d" " -f2`'"]='`echo $ln | cut -d" " -f1`';'; done | grep -v "0x00" ) > fetaListNew.cxx && mv fetaList{New,}.cxx
-_fetaMap["rests.0"]=0xE100;
-_fetaMap["rests.1"]=0xE101;
-_fetaMap["rests.0o"]=0xE102;
-_fetaMap["rests.1o"]=0xE103;
-_fetaMap["rests.M3"]=0xE104;
-_fetaMap["rests.M2"]=0xE105;
-_fetaMap["rests.M1"]=0xE106;
-_fetaMap["rests.2"]=0xE107;
-_fetaMap["rests.2classical"]=0xE108;
-_fetaMap["rests.3"]=0xE109;
-_fetaMap["rests.4"]=0xE10A;
-_fetaMap["rests.5"]=0xE10B;
-_fetaMap["rests.6"]=0xE10C;
-_fetaMap["rests.7"]=0xE10D;
-_fetaMap["accidentals.sharp"]=0xE10E;
-_fetaMap["accidentals.sharp.arrowup"]=0xE10F;
-_fetaMap["accidentals.sharp.arrowdown"]=0xE110;
-_fetaMap["accidentals.sharp.arrowboth"]=0xE111;
-_fetaMap["accidentals.sharp.slashslash.stem"]=0xE112;
-_fetaMap["accidentals.sharp.slashslashslash.stemstem"]=0xE113;
-_fetaMap["accidentals.sharp.slashslashslash.stem"]=0xE114;
-_fetaMap["accidentals.sharp.slashslash.stemstemstem"]=0xE115;
-_fetaMap["accidentals.natural"]=0xE116;
-_fetaMap["accidentals.natural.arrowup"]=0xE117;
-_fetaMap["accidentals.natural.arrowdown"]=0xE118;
-_fetaMap["accidentals.natural.arrowboth"]=0xE119;
-_fetaMap["accidentals.flat"]=0xE11A;
-_fetaMap["accidentals.flat.arrowup"]=0xE11B;
-_fetaMap["accidentals.flat.arrowdown"]=0xE11C;
-_fetaMap["accidentals.flat.arrowboth"]=0xE11D;
-_fetaMap["accidentals.flat.slash"]=0xE11E;
-_fetaMap["accidentals.flat.slashslash"]=0xE11F;
-_fetaMap["accidentals.mirroredflat.flat"]=0xE120;
-_fetaMap["accidentals.mirroredflat"]=0xE121;
-_fetaMap["accidentals.mirroredflat.backslash"]=0xE122;
-_fetaMap["accidentals.flatflat"]=0xE123;
-_fetaMap["accidentals.flatflat.slash"]=0xE124;
-_fetaMap["accidentals.doublesharp"]=0xE125;
-_fetaMap["accidentals.rightparen"]=0xE126;
-_fetaMap["accidentals.leftparen"]=0xE127;
-_fetaMap["arrowheads.open.01"]=0xE128;
-_fetaMap["arrowheads.open.0M1"]=0xE129;
-_fetaMap["arrowheads.open.11"]=0xE12A;
-_fetaMap["arrowheads.open.1M1"]=0xE12B;
-_fetaMap["arrowheads.close.01"]=0xE12C;
-_fetaMap["arrowheads.close.0M1"]=0xE12D;
-_fetaMap["arrowheads.close.11"]=0xE12E;
-_fetaMap["arrowheads.close.1M1"]=0xE12F;
-_fetaMap["dots.dot"]=0xE130;
-_fetaMap["noteheads.uM2"]=0xE131;
-_fetaMap["noteheads.dM2"]=0xE132;
-_fetaMap["noteheads.sM1"]=0xE133;
-_fetaMap["noteheads.s0"]=0xE134;
-_fetaMap["noteheads.s1"]=0xE135;
-_fetaMap["noteheads.s2"]=0xE136;
-_fetaMap["noteheads.s0diamond"]=0xE137;
-_fetaMap["noteheads.s1diamond"]=0xE138;
-_fetaMap["noteheads.s2diamond"]=0xE139;
-_fetaMap["noteheads.s0triangle"]=0xE13A;
-_fetaMap["noteheads.d1triangle"]=0xE13B;
-_fetaMap["noteheads.u1triangle"]=0xE13C;
-_fetaMap["noteheads.u2triangle"]=0xE13D;
-_fetaMap["noteheads.d2triangle"]=0xE13E;
-_fetaMap["noteheads.s0slash"]=0xE13F;
-_fetaMap["noteheads.s1slash"]=0xE140;
-_fetaMap["noteheads.s2slash"]=0xE141;
-_fetaMap["noteheads.s0cross"]=0xE142;
-_fetaMap["noteheads.s1cross"]=0xE143;
-_fetaMap["noteheads.s2cross"]=0xE144;
-_fetaMap["noteheads.s2xcircle"]=0xE145;
-_fetaMap["noteheads.s0do"]=0xE146;
-_fetaMap["noteheads.d1do"]=0xE147;
-_fetaMap["noteheads.u1do"]=0xE148;
-_fetaMap["noteheads.d2do"]=0xE149;
-_fetaMap["noteheads.u2do"]=0xE14A;
-_fetaMap["noteheads.s0re"]=0xE14B;
-_fetaMap["noteheads.u1re"]=0xE14C;
-_fetaMap["noteheads.d1re"]=0xE14D;
-_fetaMap["noteheads.u2re"]=0xE14E;
-_fetaMap["noteheads.d2re"]=0xE14F;
-_fetaMap["noteheads.s0mi"]=0xE150;
-_fetaMap["noteheads.s1mi"]=0xE151;
-_fetaMap["noteheads.s2mi"]=0xE152;
-_fetaMap["noteheads.u0fa"]=0xE153;
-_fetaMap["noteheads.d0fa"]=0xE154;
-_fetaMap["noteheads.u1fa"]=0xE155;
-_fetaMap["noteheads.d1fa"]=0xE156;
-_fetaMap["noteheads.u2fa"]=0xE157;
-_fetaMap["noteheads.d2fa"]=0xE158;
-_fetaMap["noteheads.s0la"]=0xE159;
-_fetaMap["noteheads.s1la"]=0xE15A;
-_fetaMap["noteheads.s2la"]=0xE15B;
-_fetaMap["noteheads.s0ti"]=0xE15C;
-_fetaMap["noteheads.u1ti"]=0xE15D;
-_fetaMap["noteheads.d1ti"]=0xE15E;
-_fetaMap["noteheads.u2ti"]=0xE15F;
-_fetaMap["noteheads.d2ti"]=0xE160;
-_fetaMap["scripts.ufermata"]=0xE161;
-_fetaMap["scripts.dfermata"]=0xE162;
-_fetaMap["scripts.ushortfermata"]=0xE163;
-_fetaMap["scripts.dshortfermata"]=0xE164;
-_fetaMap["scripts.ulongfermata"]=0xE165;
-_fetaMap["scripts.dlongfermata"]=0xE166;
-_fetaMap["scripts.uverylongfermata"]=0xE167;
-_fetaMap["scripts.dverylongfermata"]=0xE168;
-_fetaMap["scripts.thumb"]=0xE169;
-_fetaMap["scripts.sforzato"]=0xE16A;
-_fetaMap["scripts.espr"]=0xE16B;
-_fetaMap["scripts.staccato"]=0xE16C;
-_fetaMap["scripts.ustaccatissimo"]=0xE16D;
-_fetaMap["scripts.dstaccatissimo"]=0xE16E;
-_fetaMap["scripts.tenuto"]=0xE16F;
-_fetaMap["scripts.uportato"]=0xE170;
-_fetaMap["scripts.dportato"]=0xE171;
-_fetaMap["scripts.umarcato"]=0xE172;
-_fetaMap["scripts.dmarcato"]=0xE173;
-_fetaMap["scripts.open"]=0xE174;
-_fetaMap["scripts.stopped"]=0xE175;
-_fetaMap["scripts.upbow"]=0xE176;
-_fetaMap["scripts.downbow"]=0xE177;
-_fetaMap["scripts.reverseturn"]=0xE178;
-_fetaMap["scripts.turn"]=0xE179;
-_fetaMap["scripts.trill"]=0xE17A;
-_fetaMap["scripts.upedalheel"]=0xE17B;
-_fetaMap["scripts.dpedalheel"]=0xE17C;
-_fetaMap["scripts.upedaltoe"]=0xE17D;
-_fetaMap["scripts.dpedaltoe"]=0xE17E;
-_fetaMap["scripts.flageolet"]=0xE17F;
-_fetaMap["scripts.segno"]=0xE180;
-_fetaMap["scripts.coda"]=0xE181;
-_fetaMap["scripts.varcoda"]=0xE182;
-_fetaMap["scripts.rcomma"]=0xE183;
-_fetaMap["scripts.lcomma"]=0xE184;
-_fetaMap["scripts.rvarcomma"]=0xE185;
-_fetaMap["scripts.lvarcomma"]=0xE186;
-_fetaMap["scripts.arpeggio"]=0xE187;
-_fetaMap["scripts.trill_element"]=0xE188;
-_fetaMap["scripts.arpeggio.arrow.M1"]=0xE189;
-_fetaMap["scripts.arpeggio.arrow.1"]=0xE18A;
-_fetaMap["scripts.trilelement"]=0xE18B;
-_fetaMap["scripts.prall"]=0xE18C;
-_fetaMap["scripts.mordent"]=0xE18D;
-_fetaMap["scripts.prallprall"]=0xE18E;
-_fetaMap["scripts.prallmordent"]=0xE18F;
-_fetaMap["scripts.upprall"]=0xE190;
-_fetaMap["scripts.upmordent"]=0xE191;
-_fetaMap["scripts.pralldown"]=0xE192;
-_fetaMap["scripts.downprall"]=0xE193;
-_fetaMap["scripts.downmordent"]=0xE194;
-_fetaMap["scripts.prallup"]=0xE195;
-_fetaMap["scripts.lineprall"]=0xE196;
-_fetaMap["scripts.caesura.curved"]=0xE197;
-_fetaMap["scripts.caesura.straight"]=0xE198;
-_fetaMap["flags.u3"]=0xE199;
-_fetaMap["flags.u4"]=0xE19A;
-_fetaMap["flags.u5"]=0xE19B;
-_fetaMap["flags.u6"]=0xE19C;
-_fetaMap["flags.u7"]=0xE19D;
-_fetaMap["flags.d3"]=0xE19E;
-_fetaMap["flags.ugrace"]=0xE19F;
-_fetaMap["flags.dgrace"]=0xE1A0;
-_fetaMap["flags.d4"]=0xE1A1;
-_fetaMap["flags.d5"]=0xE1A2;
-_fetaMap["flags.d6"]=0xE1A3;
-_fetaMap["flags.d7"]=0xE1A4;
-_fetaMap["clefs.C"]=0xE1A5;
-_fetaMap["clefs.C_change"]=0xE1A6;
-_fetaMap["clefs.F"]=0xE1A7;
-_fetaMap["clefs.F_change"]=0xE1A8;
-_fetaMap["clefs.G"]=0xE1A9;
-_fetaMap["clefs.G_change"]=0xE1AA;
-_fetaMap["clefs.percussion"]=0xE1AB;
-_fetaMap["clefs.percussion_change"]=0xE1AC;
-_fetaMap["clefs.tab"]=0xE1AD;
-_fetaMap["clefs.tab_change"]=0xE1AE;
-_fetaMap["timesig.C44"]=0xE1AF;
-_fetaMap["timesig.C22"]=0xE1B0;
-_fetaMap["pedal.*"]=0xE1B1;
-_fetaMap["pedal.M"]=0xE1B2;
-_fetaMap["pedal.."]=0xE1B3;
-_fetaMap["pedal.P"]=0xE1B4;
-_fetaMap["pedal.d"]=0xE1B5;
-_fetaMap["pedal.e"]=0xE1B6;
-_fetaMap["pedal.Ped"]=0xE1B7;
-_fetaMap["brackettips.up"]=0xE1B8;
-_fetaMap["brackettips.down"]=0xE1B9;
-_fetaMap["accordion.accDiscant"]=0xE1BA;
-_fetaMap["accordion.accDot"]=0xE1BB;
-_fetaMap["accordion.accFreebase"]=0xE1BC;
-_fetaMap["accordion.accStdbase"]=0xE1BD;
-_fetaMap["accordion.accBayanbase"]=0xE1BE;
-_fetaMap["accordion.accOldEE"]=0xE1BF;
-_fetaMap["rests.M3neomensural"]=0xE1C0;
-_fetaMap["rests.M2neomensural"]=0xE1C1;
-_fetaMap["rests.M1neomensural"]=0xE1C2;
-_fetaMap["rests.0neomensural"]=0xE1C3;
-_fetaMap["rests.1neomensural"]=0xE1C4;
-_fetaMap["rests.2neomensural"]=0xE1C5;
-_fetaMap["rests.3neomensural"]=0xE1C6;
-_fetaMap["rests.4neomensural"]=0xE1C7;
-_fetaMap["rests.M3mensural"]=0xE1C8;
-_fetaMap["rests.M2mensural"]=0xE1C9;
-_fetaMap["rests.M1mensural"]=0xE1CA;
-_fetaMap["rests.0mensural"]=0xE1CB;
-_fetaMap["rests.1mensural"]=0xE1CC;
-_fetaMap["rests.2mensural"]=0xE1CD;
-_fetaMap["rests.3mensural"]=0xE1CE;
-_fetaMap["rests.4mensural"]=0xE1CF;
-_fetaMap["noteheads.slneomensural"]=0xE1D0;
-_fetaMap["noteheads.sM3neomensural"]=0xE1D1;
-_fetaMap["noteheads.sM2neomensural"]=0xE1D2;
-_fetaMap["noteheads.sM1neomensural"]=0xE1D3;
-_fetaMap["noteheads.s0harmonic"]=0xE1D4;
-_fetaMap["noteheads.s2harmonic"]=0xE1D5;
-_fetaMap["noteheads.s0neomensural"]=0xE1D6;
-_fetaMap["noteheads.s1neomensural"]=0xE1D7;
-_fetaMap["noteheads.s2neomensural"]=0xE1D8;
-_fetaMap["noteheads.slmensural"]=0xE1D9;
-_fetaMap["noteheads.sM3mensural"]=0xE1DA;
-_fetaMap["noteheads.sM2mensural"]=0xE1DB;
-_fetaMap["noteheads.sM1mensural"]=0xE1DC;
-_fetaMap["noteheads.s0mensural"]=0xE1DD;
-_fetaMap["noteheads.s1mensural"]=0xE1DE;
-_fetaMap["noteheads.s2mensural"]=0xE1DF;
-_fetaMap["noteheads.s0petrucci"]=0xE1E0;
-_fetaMap["noteheads.s1petrucci"]=0xE1E1;
-_fetaMap["noteheads.s2petrucci"]=0xE1E2;
-_fetaMap["noteheads.svaticana.punctum"]=0xE1E3;
-_fetaMap["noteheads.svaticana.punctum.cavum"]=0xE1E4;
-_fetaMap["noteheads.svaticana.linea.punctum"]=0xE1E5;
-_fetaMap["noteheads.svaticana.linea.punctum.cavum"]=0xE1E6;
-_fetaMap["noteheads.svaticana.inclinatum"]=0xE1E7;
-_fetaMap["noteheads.svaticana.lpes"]=0xE1E8;
-_fetaMap["noteheads.svaticana.vlpes"]=0xE1E9;
-_fetaMap["noteheads.svaticana.upes"]=0xE1EA;
-_fetaMap["noteheads.svaticana.vupes"]=0xE1EB;
-_fetaMap["noteheads.svaticana.plica"]=0xE1EC;
-_fetaMap["noteheads.svaticana.vplica"]=0xE1ED;
-_fetaMap["noteheads.svaticana.epiphonus"]=0xE1EE;
-_fetaMap["noteheads.svaticana.vepiphonus"]=0xE1EF;
-_fetaMap["noteheads.svaticana.reverse.plica"]=0xE1F0;
-_fetaMap["noteheads.svaticana.reverse.vplica"]=0xE1F1;
-_fetaMap["noteheads.svaticana.inner.cephalicus"]=0xE1F2;
-_fetaMap["noteheads.svaticana.cephalicus"]=0xE1F3;
-_fetaMap["noteheads.svaticana.quilisma"]=0xE1F4;
-_fetaMap["noteheads.ssolesmes.incl.parvum"]=0xE1F5;
-_fetaMap["noteheads.ssolesmes.auct.asc"]=0xE1F6;
-_fetaMap["noteheads.ssolesmes.auct.desc"]=0xE1F7;
-_fetaMap["noteheads.ssolesmes.incl.auctum"]=0xE1F8;
-_fetaMap["noteheads.ssolesmes.stropha"]=0xE1F9;
-_fetaMap["noteheads.ssolesmes.stropha.aucta"]=0xE1FA;
-_fetaMap["noteheads.ssolesmes.oriscus"]=0xE1FB;
-_fetaMap["noteheads.smedicaea.inclinatum"]=0xE1FC;
-_fetaMap["noteheads.smedicaea.punctum"]=0xE1FD;
-_fetaMap["noteheads.smedicaea.rvirga"]=0xE1FE;
-_fetaMap["noteheads.smedicaea.virga"]=0xE1FF;
-_fetaMap["noteheads.shufnagel.punctum"]=0xE200;
-_fetaMap["noteheads.shufnagel.virga"]=0xE201;
-_fetaMap["noteheads.shufnagel.lpes"]=0xE202;
-_fetaMap["clefs.vaticana.do"]=0xE203;
-_fetaMap["clefs.vaticana.do_change"]=0xE204;
-_fetaMap["clefs.vaticana.fa"]=0xE205;
-_fetaMap["clefs.vaticana.fa_change"]=0xE206;
-_fetaMap["clefs.medicaea.do"]=0xE207;
-_fetaMap["clefs.medicaea.do_change"]=0xE208;
-_fetaMap["clefs.medicaea.fa"]=0xE209;
-_fetaMap["clefs.medicaea.fa_change"]=0xE20A;
-_fetaMap["clefs.neomensural.c"]=0xE20B;
-_fetaMap["clefs.neomensural.c_change"]=0xE20C;
-_fetaMap["clefs.petrucci.c1"]=0xE20D;
-_fetaMap["clefs.petrucci.c1_change"]=0xE20E;
-_fetaMap["clefs.petrucci.c2"]=0xE20F;
-_fetaMap["clefs.petrucci.c2_change"]=0xE210;
-_fetaMap["clefs.petrucci.c3"]=0xE211;
-_fetaMap["clefs.petrucci.c3_change"]=0xE212;
-_fetaMap["clefs.petrucci.c4"]=0xE213;
-_fetaMap["clefs.petrucci.c4_change"]=0xE214;
-_fetaMap["clefs.petrucci.c5"]=0xE215;
-_fetaMap["clefs.petrucci.c5_change"]=0xE216;
-_fetaMap["clefs.mensural.c"]=0xE217;
-_fetaMap["clefs.mensural.c_change"]=0xE218;
-_fetaMap["clefs.petrucci.f"]=0xE219;
-_fetaMap["clefs.petrucci.f_change"]=0xE21A;
-_fetaMap["clefs.mensural.f"]=0xE21B;
-_fetaMap["clefs.mensural.f_change"]=0xE21C;
-_fetaMap["clefs.petrucci.g"]=0xE21D;
-_fetaMap["clefs.petrucci.g_change"]=0xE21E;
-_fetaMap["clefs.mensural.g"]=0xE21F;
-_fetaMap["clefs.mensural.g_change"]=0xE220;
-_fetaMap["clefs.hufnagel.do"]=0xE221;
-_fetaMap["clefs.hufnagel.do_change"]=0xE222;
-_fetaMap["clefs.hufnagel.fa"]=0xE223;
-_fetaMap["clefs.hufnagel.fa_change"]=0xE224;
-_fetaMap["clefs.hufnagel.do.fa"]=0xE225;
-_fetaMap["clefs.hufnagel.do.fa_change"]=0xE226;
-_fetaMap["custodes.hufnagel.u0"]=0xE227;
-_fetaMap["custodes.hufnagel.u1"]=0xE228;
-_fetaMap["custodes.hufnagel.u2"]=0xE229;
-_fetaMap["custodes.hufnagel.d0"]=0xE22A;
-_fetaMap["custodes.hufnagel.d1"]=0xE22B;
-_fetaMap["custodes.hufnagel.d2"]=0xE22C;
-_fetaMap["custodes.medicaea.u0"]=0xE22D;
-_fetaMap["custodes.medicaea.u1"]=0xE22E;
-_fetaMap["custodes.medicaea.u2"]=0xE22F;
-_fetaMap["custodes.medicaea.d0"]=0xE230;
-_fetaMap["custodes.medicaea.d1"]=0xE231;
-_fetaMap["custodes.medicaea.d2"]=0xE232;
-_fetaMap["custodes.vaticana.u0"]=0xE233;
-_fetaMap["custodes.vaticana.u1"]=0xE234;
-_fetaMap["custodes.vaticana.u2"]=0xE235;
-_fetaMap["custodes.vaticana.d0"]=0xE236;
-_fetaMap["custodes.vaticana.d1"]=0xE237;
-_fetaMap["custodes.vaticana.d2"]=0xE238;
-_fetaMap["custodes.mensural.u0"]=0xE239;
-_fetaMap["custodes.mensural.u1"]=0xE23A;
-_fetaMap["custodes.mensural.u2"]=0xE23B;
-_fetaMap["custodes.mensural.d0"]=0xE23C;
-_fetaMap["custodes.mensural.d1"]=0xE23D;
-_fetaMap["custodes.mensural.d2"]=0xE23E;
-_fetaMap["accidentals.medicaeaM1"]=0xE23F;
-_fetaMap["accidentals.vaticanaM1"]=0xE240;
-_fetaMap["accidentals.vaticana0"]=0xE241;
-_fetaMap["accidentals.mensural1"]=0xE242;
-_fetaMap["accidentals.mensuralM1"]=0xE243;
-_fetaMap["accidentals.hufnagelM1"]=0xE244;
-_fetaMap["flags.mensuralu03"]=0xE245;
-_fetaMap["flags.mensuralu13"]=0xE246;
-_fetaMap["flags.mensuralu23"]=0xE247;
-_fetaMap["flags.mensurald03"]=0xE248;
-_fetaMap["flags.mensurald13"]=0xE249;
-_fetaMap["flags.mensurald23"]=0xE24A;
-_fetaMap["flags.mensuralu04"]=0xE24B;
-_fetaMap["flags.mensuralu14"]=0xE24C;
-_fetaMap["flags.mensuralu24"]=0xE24D;
-_fetaMap["flags.mensurald04"]=0xE24E;
-_fetaMap["flags.mensurald14"]=0xE24F;
-_fetaMap["flags.mensurald24"]=0xE250;
-_fetaMap["flags.mensuralu05"]=0xE251;
-_fetaMap["flags.mensuralu15"]=0xE252;
-_fetaMap["flags.mensuralu25"]=0xE253;
-_fetaMap["flags.mensurald05"]=0xE254;
-_fetaMap["flags.mensurald15"]=0xE255;
-_fetaMap["flags.mensurald25"]=0xE256;
-_fetaMap["flags.mensuralu06"]=0xE257;
-_fetaMap["flags.mensuralu16"]=0xE258;
-_fetaMap["flags.mensuralu26"]=0xE259;
-_fetaMap["flags.mensurald06"]=0xE25A;
-_fetaMap["flags.mensurald16"]=0xE25B;
-_fetaMap["flags.mensurald26"]=0xE25C;
-_fetaMap["timesig.mensural44"]=0xE25D;
-_fetaMap["timesig.mensural22"]=0xE25E;
-_fetaMap["timesig.mensural32"]=0xE25F;
-_fetaMap["timesig.mensural64"]=0xE260;
-_fetaMap["timesig.mensural94"]=0xE261;
-_fetaMap["timesig.mensural34"]=0xE262;
-_fetaMap["timesig.mensural68"]=0xE263;
-_fetaMap["timesig.mensural98"]=0xE264;
-_fetaMap["timesig.mensural48"]=0xE265;
-_fetaMap["timesig.mensural68alt"]=0xE266;
-_fetaMap["timesig.mensural24"]=0xE267;
-_fetaMap["timesig.neomensural44"]=0xE268;
-_fetaMap["timesig.neomensural22"]=0xE269;
-_fetaMap["timesig.neomensural32"]=0xE26A;
-_fetaMap["timesig.neomensural64"]=0xE26B;
-_fetaMap["timesig.neomensural94"]=0xE26C;
-_fetaMap["timesig.neomensural34"]=0xE26D;
-_fetaMap["timesig.neomensural68"]=0xE26E;
-_fetaMap["timesig.neomensural98"]=0xE26F;
-_fetaMap["timesig.neomensural48"]=0xE270;
-_fetaMap["timesig.neomensural68alt"]=0xE271;
-_fetaMap["timesig.neomensural24"]=0xE272;
-_fetaMap["scripts.ictus"]=0xE273;
-_fetaMap["scripts.uaccentus"]=0xE274;
-_fetaMap["scripts.daccentus"]=0xE275;
-_fetaMap["scripts.usemicirculus"]=0xE276;
-_fetaMap["scripts.dsemicirculus"]=0xE277;
-_fetaMap["scripts.circulus"]=0xE278;
-_fetaMap["scripts.augmentum"]=0xE279;
-_fetaMap["scripts.usignumcongruentiae"]=0xE27A;
-_fetaMap["scripts.dsignumcongruentiae"]=0xE27B;
-_fetaMap["dots.dotvaticana"]=0xE27C;
+// 2. Run: ( grep '^//' fetaList.cxx; cat fetaList.nam | grep -v "^0x00" | while read code name; do echo "CA_FETA_GLYPH(`echo $name | sed 's/\*/star/;s/\.\.$/.dot/;s/[.-]/_/g'`, \"$name\", $code)"; done ) > fetaListNew.cxx && mv fetaList{New,}.cxx
+// The list is expanded by CA_FETA_GLYPH(id, name, codepoint) defined by the includer, see layout/feta.h.
+CA_FETA_GLYPH(rests_0, "rests.0", 0xE100)
+CA_FETA_GLYPH(rests_1, "rests.1", 0xE101)
+CA_FETA_GLYPH(rests_0o, "rests.0o", 0xE102)
+CA_FETA_GLYPH(rests_1o, "rests.1o", 0xE103)
+CA_FETA_GLYPH(rests_M3, "rests.M3", 0xE104)
+CA_FETA_GLYPH(rests_M2, "rests.M2", 0xE105)
+CA_FETA_GLYPH(rests_M1, "rests.M1", 0xE106)
+CA_FETA_GLYPH(rests_2, "rests.2", 0xE107)
+CA_FETA_GLYPH(rests_2classical, "rests.2classical", 0xE108)
+CA_FETA_GLYPH(rests_3, "rests.3", 0xE109)
+CA_FETA_GLYPH(rests_4, "rests.4", 0xE10A)
+CA_FETA_GLYPH(rests_5, "rests.5", 0xE10B)
+CA_FETA_GLYPH(rests_6, "rests.6", 0xE10C)
+CA_FETA_GLYPH(rests_7, "rests.7", 0xE10D)
+CA_FETA_GLYPH(accidentals_sharp, "accidentals.sharp", 0xE10E)
+CA_FETA_GLYPH(accidentals_sharp_arrowup, "accidentals.sharp.arrowup", 0xE10F)
+CA_FETA_GLYPH(accidentals_sharp_arrowdown, "accidentals.sharp.arrowdown", 0xE110)
+CA_FETA_GLYPH(accidentals_sharp_arrowboth, "accidentals.sharp.arrowboth", 0xE111)
+CA_FETA_GLYPH(accidentals_sharp_slashslash_stem, "accidentals.sharp.slashslash.stem", 0xE112)
+CA_FETA_GLYPH(accidentals_sharp_slashslashslash_stemstem, "accidentals.sharp.slashslashslash.stemstem", 0xE113)
+CA_FETA_GLYPH(accidentals_sharp_slashslashslash_stem, "accidentals.sharp.slashslashslash.stem", 0xE114)
+CA_FETA_GLYPH(accidentals_sharp_slashslash_stemstemstem, "accidentals.sharp.slashslash.stemstemstem", 0xE115)
+CA_FETA_GLYPH(accidentals_natural, "accidentals.natural", 0xE116)
+CA_FETA_GLYPH(accidentals_natural_arrowup, "accidentals.natural.arrowup", 0xE117)
+CA_FETA_GLYPH(accidentals_natural_arrowdown, "accidentals.natural.arrowdown", 0xE118)
+CA_FETA_GLYPH(accidentals_natural_arrowboth, "accidentals.natural.arrowboth", 0xE119)
+CA_FETA_GLYPH(accidentals_flat, "accidentals.flat", 0xE11A)
+CA_FETA_GLYPH(accidentals_flat_arrowup, "accidentals.flat.arrowup", 0xE11B)
+CA_FETA_GLYPH(accidentals_flat_arrowdown, "accidentals.flat.arrowdown", 0xE11C)
+CA_FETA_GLYPH(accidentals_flat_arrowboth, "accidentals.flat.arrowboth", 0xE11D)
+CA_FETA_GLYPH(accidentals_flat_slash, "accidentals.flat.slash", 0xE11E)
+CA_FETA_GLYPH(accidentals_flat_slashslash, "accidentals.flat.slashslash", 0xE11F)
+CA_FETA_GLYPH(accidentals_mirroredflat_flat, "accidentals.mirroredflat.flat", 0xE120)
+CA_FETA_GLYPH(accidentals_mirroredflat, "accidentals.mirroredflat", 0xE121)
+CA_FETA_GLYPH(accidentals_mirroredflat_backslash, "accidentals.mirroredflat.backslash", 0xE122)
+CA_FETA_GLYPH(accidentals_flatflat, "accidentals.flatflat", 0xE123)
+CA_FETA_GLYPH(accidentals_flatflat_slash, "accidentals.flatflat.slash", 0xE124)
+CA_FETA_GLYPH(accidentals_doublesharp, "accidentals.doublesharp", 0xE125)
+CA_FETA_GLYPH(accidentals_rightparen, "accidentals.rightparen", 0xE126)
+CA_FETA_GLYPH(accidentals_leftparen, "accidentals.leftparen", 0xE127)
+CA_FETA_GLYPH(arrowheads_open_01, "arrowheads.open.01", 0xE128)
+CA_FETA_GLYPH(arrowheads_open_0M1, "arrowheads.open.0M1", 0xE129)
+CA_FETA_GLYPH(arrowheads_open_11, "arrowheads.open.11", 0xE12A)
+CA_FETA_GLYPH(arrowheads_open_1M1, "arrowheads.open.1M1", 0xE12B)
+CA_FETA_GLYPH(arrowheads_close_01, "arrowheads.close.01", 0xE12C)
+CA_FETA_GLYPH(arrowheads_close_0M1, "arrowheads.close.0M1", 0xE12D)
+CA_FETA_GLYPH(arrowheads_close_11, "arrowheads.close.11", 0xE12E)
+CA_FETA_GLYPH(arrowheads_close_1M1, "arrowheads.close.1M1", 0xE12F)
+CA_FETA_GLYPH(dots_dot, "dots.dot", 0xE130)
+CA_FETA_GLYPH(noteheads_uM2, "noteheads.uM2", 0xE131)
+CA_FETA_GLYPH(noteheads_dM2, "noteheads.dM2", 0xE132)
+CA_FETA_GLYPH(noteheads_sM1, "noteheads.sM1", 0xE133)
+CA_FETA_GLYPH(noteheads_s0, "noteheads.s0", 0xE134)
+CA_FETA_GLYPH(noteheads_s1, "noteheads.s1", 0xE135)
+CA_FETA_GLYPH(noteheads_s2, "noteheads.s2", 0xE136)
+CA_FETA_GLYPH(noteheads_s0diamond, "noteheads.s0diamond", 0xE137)
+CA_FETA_GLYPH(noteheads_s1diamond, "noteheads.s1diamond", 0xE138)
+CA_FETA_GLYPH(noteheads_s2diamond, "noteheads.s2diamond", 0xE139)
+CA_FETA_GLYPH(noteheads_s0triangle, "noteheads.s0triangle", 0xE13A)
+CA_FETA_GLYPH(noteheads_d1triangle, "noteheads.d1triangle", 0xE13B)
+CA_FETA_GLYPH(noteheads_u1triangle, "noteheads.u1triangle", 0xE13C)
+CA_FETA_GLYPH(noteheads_u2triangle, "noteheads.u2triangle", 0xE13D)
+CA_FETA_GLYPH(noteheads_d2triangle, "noteheads.d2triangle", 0xE13E)
+CA_FETA_GLYPH(noteheads_s0slash, "noteheads.s0slash", 0xE13F)
+CA_FETA_GLYPH(noteheads_s1slash, "noteheads.s1slash", 0xE140)
+CA_FETA_GLYPH(noteheads_s2slash, "noteheads.s2slash", 0xE141)
+CA_FETA_GLYPH(noteheads_s0cross, "noteheads.s0cross", 0xE142)
+CA_FETA_GLYPH(noteheads_s1cross, "noteheads.s1cross", 0xE143)
+CA_FETA_GLYPH(noteheads_s2cross, "noteheads.s2cross", 0xE144)
+CA_FETA_GLYPH(noteheads_s2xcircle, "noteheads.s2xcircle", 0xE145)
+CA_FETA_GLYPH(noteheads_s0do, "noteheads.s0do", 0xE146)
+CA_FETA_GLYPH(noteheads_d1do, "noteheads.d1do", 0xE147)
+CA_FETA_GLYPH(noteheads_u1do, "noteheads.u1do", 0xE148)
+CA_FETA_GLYPH(noteheads_d2do, "noteheads.d2do", 0xE149)
+CA_FETA_GLYPH(noteheads_u2do, "noteheads.u2do", 0xE14A)
+CA_FETA_GLYPH(noteheads_s0re, "noteheads.s0re", 0xE14B)
+CA_FETA_GLYPH(noteheads_u1re, "noteheads.u1re", 0xE14C)
+CA_FETA_GLYPH(noteheads_d1re, "noteheads.d1re", 0xE14D)
+CA_FETA_GLYPH(noteheads_u2re, "noteheads.u2re", 0xE14E)
+CA_FETA_GLYPH(noteheads_d2re, "noteheads.d2re", 0xE14F)
+CA_FETA_GLYPH(noteheads_s0mi, "noteheads.s0mi", 0xE150)
+CA_FETA_GLYPH(noteheads_s1mi, "noteheads.s1mi", 0xE151)
+CA_FETA_GLYPH(noteheads_s2mi, "noteheads.s2mi", 0xE152)
+CA_FETA_GLYPH(noteheads_u0fa, "noteheads.u0fa", 0xE153)
+CA_FETA_GLYPH(noteheads_d0fa, "noteheads.d0fa", 0xE154)
+CA_FETA_GLYPH(noteheads_u1fa, "noteheads.u1fa", 0xE155)
+CA_FETA_GLYPH(noteheads_d1fa, "noteheads.d1fa", 0xE156)
+CA_FETA_GLYPH(noteheads_u2fa, "noteheads.u2fa", 0xE157)
+CA_FETA_GLYPH(noteheads_d2fa, "noteheads.d2fa", 0xE158)
+CA_FETA_GLYPH(noteheads_s0la, "noteheads.s0la", 0xE159)
+CA_FETA_GLYPH(noteheads_s1la, "noteheads.s1la", 0xE15A)
+CA_FETA_GLYPH(noteheads_s2la, "noteheads.s2la", 0xE15B)
+CA_FETA_GLYPH(noteheads_s0ti, "noteheads.s0ti", 0xE15C)
+CA_FETA_GLYPH(noteheads_u1ti, "noteheads.u1ti", 0xE15D)
+CA_FETA_GLYPH(noteheads_d1ti, "noteheads.d1ti", 0xE15E)
+CA_FETA_GLYPH(noteheads_u2ti, "noteheads.u2ti", 0xE15F)
+CA_FETA_GLYPH(noteheads_d2ti, "noteheads.d2ti", 0xE160)
+CA_FETA_GLYPH(scripts_ufermata, "scripts.ufermata", 0xE161)
+CA_FETA_GLYPH(scripts_dfermata, "scripts.dfermata", 0xE162)
+CA_FETA_GLYPH(scripts_ushortfermata, "scripts.ushortfermata", 0xE163)
+CA_FETA_GLYPH(scripts_dshortfermata, "scripts.dshortfermata", 0xE164)
+CA_FETA_GLYPH(scripts_ulongfermata, "scripts.ulongfermata", 0xE165)
+CA_FETA_GLYPH(scripts_dlongfermata, "scripts.dlongfermata", 0xE166)
+CA_FETA_GLYPH(scripts_uverylongfermata, "scripts.uverylongfermata", 0xE167)
+CA_FETA_GLYPH(scripts_dverylongfermata, "scripts.dverylongfermata", 0xE168)
+CA_FETA_GLYPH(scripts_thumb, "scripts.thumb", 0xE169)
+CA_FETA_GLYPH(scripts_sforzato, "scripts.sforzato", 0xE16A)
+CA_FETA_GLYPH(scripts_espr, "scripts.espr", 0xE16B)
+CA_FETA_GLYPH(scripts_staccato, "scripts.staccato", 0xE16C)
+CA_FETA_GLYPH(scripts_ustaccatissimo, "scripts.ustaccatissimo", 0xE16D)
+CA_FETA_GLYPH(scripts_dstaccatissimo, "scripts.dstaccatissimo", 0xE16E)
+CA_FETA_GLYPH(scripts_tenuto, "scripts.tenuto", 0xE16F)
+CA_FETA_GLYPH(scripts_uportato, "scripts.uportato", 0xE170)
+CA_FETA_GLYPH(scripts_dportato, "scripts.dportato", 0xE171)
+CA_FETA_GLYPH(scripts_umarcato, "scripts.umarcato", 0xE172)
+CA_FETA_GLYPH(scripts_dmarcato, "scripts.dmarcato", 0xE173)
+CA_FETA_GLYPH(scripts_open, "scripts.open", 0xE174)
+CA_FETA_GLYPH(scripts_stopped, "scripts.stopped", 0xE175)
+CA_FETA_GLYPH(scripts_upbow, "scripts.upbow", 0xE176)
+CA_FETA_GLYPH(scripts_downbow, "scripts.downbow", 0xE177)
+CA_FETA_GLYPH(scripts_reverseturn, "scripts.reverseturn", 0xE178)
+CA_FETA_GLYPH(scripts_turn, "scripts.turn", 0xE179)
+CA_FETA_GLYPH(scripts_trill, "scripts.trill", 0xE17A)
+CA_FETA_GLYPH(scripts_upedalheel, "scripts.upedalheel", 0xE17B)
+CA_FETA_GLYPH(scripts_dpedalheel, "scripts.dpedalheel", 0xE17C)
+CA_FETA_GLYPH(scripts_upedaltoe, "scripts.upedaltoe", 0xE17D)
+CA_FETA_GLYPH(scripts_dpedaltoe, "scripts.dpedaltoe", 0xE17E)
+CA_FETA_GLYPH(scripts_flageolet, "scripts.flageolet", 0xE17F)
+CA_FETA_GLYPH(scripts_segno, "scripts.segno", 0xE180)
+CA_FETA_GLYPH(scripts_coda, "scripts.coda", 0xE181)
+CA_FETA_GLYPH(scripts_varcoda, "scripts.varcoda", 0xE182)
+CA_FETA_GLYPH(scripts_rcomma, "scripts.rcomma", 0xE183)
+CA_FETA_GLYPH(scripts_lcomma, "scripts.lcomma", 0xE184)
+CA_FETA_GLYPH(scripts_rvarcomma, "scripts.rvarcomma", 0xE185)
+CA_FETA_GLYPH(scripts_lvarcomma, "scripts.lvarcomma", 0xE186)
+CA_FETA_GLYPH(scripts_arpeggio, "scripts.arpeggio", 0xE187)
+CA_FETA_GLYPH(scripts_trill_element, "scripts.trill_element", 0xE188)
+CA_FETA_GLYPH(scripts_arpeggio_arrow_M1, "scripts.arpeggio.arrow.M1", 0xE189)
+CA_FETA_GLYPH(scripts_arpeggio_arrow_1, "scripts.arpeggio.arrow.1", 0xE18A)
+CA_FETA_GLYPH(scripts_trilelement, "scripts.trilelement", 0xE18B)
+CA_FETA_GLYPH(scripts_prall, "scripts.prall", 0xE18C)
+CA_FETA_GLYPH(scripts_mordent, "scripts.mordent", 0xE18D)
+CA_FETA_GLYPH(scripts_prallprall, "scripts.prallprall", 0xE18E)
+CA_FETA_GLYPH(scripts_prallmordent, "scripts.prallmordent", 0xE18F)
+CA_FETA_GLYPH(scripts_upprall, "scripts.upprall", 0xE190)
+CA_FETA_GLYPH(scripts_upmordent, "scripts.upmordent", 0xE191)
+CA_FETA_GLYPH(scripts_pralldown, "scripts.pralldown", 0xE192)
+CA_FETA_GLYPH(scripts_downprall, "scripts.downprall", 0xE193)
+CA_FETA_GLYPH(scripts_downmordent, "scripts.downmordent", 0xE194)
+CA_FETA_GLYPH(scripts_prallup, "scripts.prallup", 0xE195)
+CA_FETA_GLYPH(scripts_lineprall, "scripts.lineprall", 0xE196)
+CA_FETA_GLYPH(scripts_caesura_curved, "scripts.caesura.curved", 0xE197)
+CA_FETA_GLYPH(scripts_caesura_straight, "scripts.caesura.straight", 0xE198)
+CA_FETA_GLYPH(flags_u3, "flags.u3", 0xE199)
+CA_FETA_GLYPH(flags_u4, "flags.u4", 0xE19A)
+CA_FETA_GLYPH(flags_u5, "flags.u5", 0xE19B)
+CA_FETA_GLYPH(flags_u6, "flags.u6", 0xE19C)
+CA_FETA_GLYPH(flags_u7, "flags.u7", 0xE19D)
+CA_FETA_GLYPH(flags_d3, "flags.d3", 0xE19E)
+CA_FETA_GLYPH(flags_ugrace, "flags.ugrace", 0xE19F)
+CA_FETA_GLYPH(flags_dgrace, "flags.dgrace", 0xE1A0)
+CA_FETA_GLYPH(flags_d4, "flags.d4", 0xE1A1)
+CA_FETA_GLYPH(flags_d5, "flags.d5", 0xE1A2)
+CA_FETA_GLYPH(flags_d6, "flags.d6", 0xE1A3)
+CA_FETA_GLYPH(flags_d7, "flags.d7", 0xE1A4)
+CA_FETA_GLYPH(clefs_C, "clefs.C", 0xE1A5)
+CA_FETA_GLYPH(clefs_C_change, "clefs.C_change", 0xE1A6)
+CA_FETA_GLYPH(clefs_F, "clefs.F", 0xE1A7)
+CA_FETA_GLYPH(clefs_F_change, "clefs.F_change", 0xE1A8)
+CA_FETA_GLYPH(clefs_G, "clefs.G", 0xE1A9)
+CA_FETA_GLYPH(clefs_G_change, "clefs.G_change", 0xE1AA)
+CA_FETA_GLYPH(clefs_percussion, "clefs.percussion", 0xE1AB)
+CA_FETA_GLYPH(clefs_percussion_change, "clefs.percussion_change", 0xE1AC)
+CA_FETA_GLYPH(clefs_tab, "clefs.tab", 0xE1AD)
+CA_FETA_GLYPH(clefs_tab_change, "clefs.tab_change", 0xE1AE)
+CA_FETA_GLYPH(timesig_C44, "timesig.C44", 0xE1AF)
+CA_FETA_GLYPH(timesig_C22, "timesig.C22", 0xE1B0)
+CA_FETA_GLYPH(pedal_star, "pedal.*", 0xE1B1)
+CA_FETA_GLYPH(pedal_M, "pedal.M", 0xE1B2)
+CA_FETA_GLYPH(pedal_dot, "pedal..", 0xE1B3)
+CA_FETA_GLYPH(pedal_P, "pedal.P", 0xE1B4)
+CA_FETA_GLYPH(pedal_d, "pedal.d", 0xE1B5)
+CA_FETA_GLYPH(pedal_e, "pedal.e", 0xE1B6)
+CA_FETA_GLYPH(pedal_Ped, "pedal.Ped", 0xE1B7)
+CA_FETA_GLYPH(brackettips_up, "brackettips.up", 0xE1B8)
+CA_FETA_GLYPH(brackettips_down, "brackettips.down", 0xE1B9)
+CA_FETA_GLYPH(accordion_accDiscant, "accordion.accDiscant", 0xE1BA)
+CA_FETA_GLYPH(accordion_accDot, "accordion.accDot", 0xE1BB)
+CA_FETA_GLYPH(accordion_accFreebase, "accordion.accFreebase", 0xE1BC)
+CA_FETA_GLYPH(accordion_accStdbase, "accordion.accStdbase", 0xE1BD)
+CA_FETA_GLYPH(accordion_accBayanbase, "accordion.accBayanbase", 0xE1BE)
+CA_FETA_GLYPH(accordion_accOldEE, "accordion.accOldEE", 0xE1BF)
+CA_FETA_GLYPH(rests_M3neomensural, "rests.M3neomensural", 0xE1C0)
+CA_FETA_GLYPH(rests_M2neomensural, "rests.M2neomensural", 0xE1C1)
+CA_FETA_GLYPH(rests_M1neomensural, "rests.M1neomensural", 0xE1C2)
+CA_FETA_GLYPH(rests_0neomensural, "rests.0neomensural", 0xE1C3)
+CA_FETA_GLYPH(rests_1neomensural, "rests.1neomensural", 0xE1C4)
+CA_FETA_GLYPH(rests_2neomensural, "rests.2neomensural", 0xE1C5)
+CA_FETA_GLYPH(rests_3neomensural, "rests.3neomensural", 0xE1C6)
+CA_FETA_GLYPH(rests_4neomensural, "rests.4neomensural", 0xE1C7)
+CA_FETA_GLYPH(rests_M3mensural, "rests.M3mensural", 0xE1C8)
+CA_FETA_GLYPH(rests_M2mensural, "rests.M2mensural", 0xE1C9)
+CA_FETA_GLYPH(rests_M1mensural, "rests.M1mensural", 0xE1CA)
+CA_FETA_GLYPH(rests_0mensural, "rests.0mensural", 0xE1CB)
+CA_FETA_GLYPH(rests_1mensural, "rests.1mensural", 0xE1CC)
+CA_FETA_GLYPH(rests_2mensural, "rests.2mensural", 0xE1CD)
+CA_FETA_GLYPH(rests_3mensural, "rests.3mensural", 0xE1CE)
+CA_FETA_GLYPH(rests_4mensural, "rests.4mensural", 0xE1CF)
+CA_FETA_GLYPH(noteheads_slneomensural, "noteheads.slneomensural", 0xE1D0)
+CA_FETA_GLYPH(noteheads_sM3neomensural, "noteheads.sM3neomensural", 0xE1D1)
+CA_FETA_GLYPH(noteheads_sM2neomensural, "noteheads.sM2neomensural", 0xE1D2)
+CA_FETA_GLYPH(noteheads_sM1neomensural, "noteheads.sM1neomensural", 0xE1D3)
+CA_FETA_GLYPH(noteheads_s0harmonic, "noteheads.s0harmonic", 0xE1D4)
+CA_FETA_GLYPH(noteheads_s2harmonic, "noteheads.s2harmonic", 0xE1D5)
+CA_FETA_GLYPH(noteheads_s0neomensural, "noteheads.s0neomensural", 0xE1D6)
+CA_FETA_GLYPH(noteheads_s1neomensural, "noteheads.s1neomensural", 0xE1D7)
+CA_FETA_GLYPH(noteheads_s2neomensural, "noteheads.s2neomensural", 0xE1D8)
+CA_FETA_GLYPH(noteheads_slmensural, "noteheads.slmensural", 0xE1D9)
+CA_FETA_GLYPH(noteheads_sM3mensural, "noteheads.sM3mensural", 0xE1DA)
+CA_FETA_GLYPH(noteheads_sM2mensural, "noteheads.sM2mensural", 0xE1DB)
+CA_FETA_GLYPH(noteheads_sM1mensural, "noteheads.sM1mensural", 0xE1DC)
+CA_FETA_GLYPH(noteheads_s0mensural, "noteheads.s0mensural", 0xE1DD)
+CA_FETA_GLYPH(noteheads_s1mensural, "noteheads.s1mensural", 0xE1DE)
+CA_FETA_GLYPH(noteheads_s2mensural, "noteheads.s2mensural", 0xE1DF)
+CA_FETA_GLYPH(noteheads_s0petrucci, "noteheads.s0petrucci", 0xE1E0)
+CA_FETA_GLYPH(noteheads_s1petrucci, "noteheads.s1petrucci", 0xE1E1)
+CA_FETA_GLYPH(noteheads_s2petrucci, "noteheads.s2petrucci", 0xE1E2)
+CA_FETA_GLYPH(noteheads_svaticana_punctum, "noteheads.svaticana.punctum", 0xE1E3)
+CA_FETA_GLYPH(noteheads_svaticana_punctum_cavum, "noteheads.svaticana.punctum.cavum", 0xE1E4)
+CA_FETA_GLYPH(noteheads_svaticana_linea_punctum, "noteheads.svaticana.linea.punctum", 0xE1E5)
+CA_FETA_GLYPH(noteheads_svaticana_linea_punctum_cavum, "noteheads.svaticana.linea.punctum.cavum", 0xE1E6)
+CA_FETA_GLYPH(noteheads_svaticana_inclinatum, "noteheads.svaticana.inclinatum", 0xE1E7)
+CA_FETA_GLYPH(noteheads_svaticana_lpes, "noteheads.svaticana.lpes", 0xE1E8)
+CA_FETA_GLYPH(noteheads_svaticana_vlpes, "noteheads.svaticana.vlpes", 0xE1E9)
+CA_FETA_GLYPH(noteheads_svaticana_upes, "noteheads.svaticana.upes", 0xE1EA)
+CA_FETA_GLYPH(noteheads_svaticana_vupes, "noteheads.svaticana.vupes", 0xE1EB)
+CA_FETA_GLYPH(noteheads_svaticana_plica, "noteheads.svaticana.plica", 0xE1EC)
+CA_FETA_GLYPH(noteheads_svaticana_vplica, "noteheads.svaticana.vplica", 0xE1ED)
+CA_FETA_GLYPH(noteheads_svaticana_epiphonus, "noteheads.svaticana.epiphonus", 0xE1EE)
+CA_FETA_GLYPH(noteheads_svaticana_vepiphonus, "noteheads.svaticana.vepiphonus", 0xE1EF)
+CA_FETA_GLYPH(noteheads_svaticana_reverse_plica, "noteheads.svaticana.reverse.plica", 0xE1F0)
+CA_FETA_GLYPH(noteheads_svaticana_reverse_vplica, "noteheads.svaticana.reverse.vplica", 0xE1F1)
+CA_FETA_GLYPH(noteheads_svaticana_inner_cephalicus, "noteheads.svaticana.inner.cephalicus", 0xE1F2)
+CA_FETA_GLYPH(noteheads_svaticana_cephalicus, "noteheads.svaticana.cephalicus", 0xE1F3)
+CA_FETA_GLYPH(noteheads_svaticana_quilisma, "noteheads.svaticana.quilisma", 0xE1F4)
+CA_FETA_GLYPH(noteheads_ssolesmes_incl_parvum, "noteheads.ssolesmes.incl.parvum", 0xE1F5)
+CA_FETA_GLYPH(noteheads_ssolesmes_auct_asc, "noteheads.ssolesmes.auct.asc", 0xE1F6)
+CA_FETA_GLYPH(noteheads_ssolesmes_auct_desc, "noteheads.ssolesmes.auct.desc", 0xE1F7)
+CA_FETA_GLYPH(noteheads_ssolesmes_incl_auctum, "noteheads.ssolesmes.incl.auctum", 0xE1F8)
+CA_FETA_GLYPH(noteheads_ssolesmes_stropha, "noteheads.ssolesmes.stropha", 0xE1F9)
+CA_FETA_GLYPH(noteheads_ssolesmes_stropha_aucta, "noteheads.ssolesmes.stropha.aucta", 0xE1FA)
+CA_FETA_GLYPH(noteheads_ssolesmes_oriscus, "noteheads.ssolesmes.oriscus", 0xE1FB)
+CA_FETA_GLYPH(noteheads_smedicaea_inclinatum, "noteheads.smedicaea.inclinatum", 0xE1FC)
+CA_FETA_GLYPH(noteheads_smedicaea_punctum, "noteheads.smedicaea.punctum", 0xE1FD)
+CA_FETA_GLYPH(noteheads_smedicaea_rvirga, "noteheads.smedicaea.rvirga", 0xE1FE)
+CA_FETA_GLYPH(noteheads_smedicaea_virga, "noteheads.smedicaea.virga", 0xE1FF)
+CA_FETA_GLYPH(noteheads_shufnagel_punctum, "noteheads.shufnagel.punctum", 0xE200)
+CA_FETA_GLYPH(noteheads_shufnagel_virga, "noteheads.shufnagel.virga", 0xE201)
+CA_FETA_GLYPH(noteheads_shufnagel_lpes, "noteheads.shufnagel.lpes", 0xE202)
+CA_FETA_GLYPH(clefs_vaticana_do, "clefs.vaticana.do", 0xE203)
+CA_FETA_GLYPH(clefs_vaticana_do_change, "clefs.vaticana.do_change", 0xE204)
+CA_FETA_GLYPH(clefs_vaticana_fa, "clefs.vaticana.fa", 0xE205)
+CA_FETA_GLYPH(clefs_vaticana_fa_change, "clefs.vaticana.fa_change", 0xE206)
+CA_FETA_GLYPH(clefs_medicaea_do, "clefs.medicaea.do", 0xE207)
+CA_FETA_GLYPH(clefs_medicaea_do_change, "clefs.medicaea.do_change", 0xE208)
+CA_FETA_GLYPH(clefs_medicaea_fa, "clefs.medicaea.fa", 0xE209)
+CA_FETA_GLYPH(clefs_medicaea_fa_change, "clefs.medicaea.fa_change", 0xE20A)
+CA_FETA_GLYPH(clefs_neomensural_c, "clefs.neomensural.c", 0xE20B)
+CA_FETA_GLYPH(clefs_neomensural_c_change, "clefs.neomensural.c_change", 0xE20C)
+CA_FETA_GLYPH(clefs_petrucci_c1, "clefs.petrucci.c1", 0xE20D)
+CA_FETA_GLYPH(clefs_petrucci_c1_change, "clefs.petrucci.c1_change", 0xE20E)
+CA_FETA_GLYPH(clefs_petrucci_c2, "clefs.petrucci.c2", 0xE20F)
+CA_FETA_GLYPH(clefs_petrucci_c2_change, "clefs.petrucci.c2_change", 0xE210)
+CA_FETA_GLYPH(clefs_petrucci_c3, "clefs.petrucci.c3", 0xE211)
+CA_FETA_GLYPH(clefs_petrucci_c3_change, "clefs.petrucci.c3_change", 0xE212)
+CA_FETA_GLYPH(clefs_petrucci_c4, "clefs.petrucci.c4", 0xE213)
+CA_FETA_GLYPH(clefs_petrucci_c4_change, "clefs.petrucci.c4_change", 0xE214)
+CA_FETA_GLYPH(clefs_petrucci_c5, "clefs.petrucci.c5", 0xE215)
+CA_FETA_GLYPH(clefs_petrucci_c5_change, "clefs.petrucci.c5_change", 0xE216)
+CA_FETA_GLYPH(clefs_mensural_c, "clefs.mensural.c", 0xE217)
+CA_FETA_GLYPH(clefs_mensural_c_change, "clefs.mensural.c_change", 0xE218)
+CA_FETA_GLYPH(clefs_petrucci_f, "clefs.petrucci.f", 0xE219)
+CA_FETA_GLYPH(clefs_petrucci_f_change, "clefs.petrucci.f_change", 0xE21A)
+CA_FETA_GLYPH(clefs_mensural_f, "clefs.mensural.f", 0xE21B)
+CA_FETA_GLYPH(clefs_mensural_f_change, "clefs.mensural.f_change", 0xE21C)
+CA_FETA_GLYPH(clefs_petrucci_g, "clefs.petrucci.g", 0xE21D)
+CA_FETA_GLYPH(clefs_petrucci_g_change, "clefs.petrucci.g_change", 0xE21E)
+CA_FETA_GLYPH(clefs_mensural_g, "clefs.mensural.g", 0xE21F)
+CA_FETA_GLYPH(clefs_mensural_g_change, "clefs.mensural.g_change", 0xE220)
+CA_FETA_GLYPH(clefs_hufnagel_do, "clefs.hufnagel.do", 0xE221)
+CA_FETA_GLYPH(clefs_hufnagel_do_change, "clefs.hufnagel.do_change", 0xE222)
+CA_FETA_GLYPH(clefs_hufnagel_fa, "clefs.hufnagel.fa", 0xE223)
+CA_FETA_GLYPH(clefs_hufnagel_fa_change, "clefs.hufnagel.fa_change", 0xE224)
+CA_FETA_GLYPH(clefs_hufnagel_do_fa, "clefs.hufnagel.do.fa", 0xE225)
+CA_FETA_GLYPH(clefs_hufnagel_do_fa_change, "clefs.hufnagel.do.fa_change", 0xE226)
+CA_FETA_GLYPH(custodes_hufnagel_u0, "custodes.hufnagel.u0", 0xE227)
+CA_FETA_GLYPH(custodes_hufnagel_u1, "custodes.hufnagel.u1", 0xE228)
+CA_FETA_GLYPH(custodes_hufnagel_u2, "custodes.hufnagel.u2", 0xE229)
+CA_FETA_GLYPH(custodes_hufnagel_d0, "custodes.hufnagel.d0", 0xE22A)
+CA_FETA_GLYPH(custodes_hufnagel_d1, "custodes.hufnagel.d1", 0xE22B)
+CA_FETA_GLYPH(custodes_hufnagel_d2, "custodes.hufnagel.d2", 0xE22C)
+CA_FETA_GLYPH(custodes_medicaea_u0, "custodes.medicaea.u0", 0xE22D)
+CA_FETA_GLYPH(custodes_medicaea_u1, "custodes.medicaea.u1", 0xE22E)
+CA_FETA_GLYPH(custodes_medicaea_u2, "custodes.medicaea.u2", 0xE22F)
+CA_FETA_GLYPH(custodes_medicaea_d0, "custodes.medicaea.d0", 0xE230)
+CA_FETA_GLYPH(custodes_medicaea_d1, "custodes.medicaea.d1", 0xE231)
+CA_FETA_GLYPH(custodes_medicaea_d2, "custodes.medicaea.d2", 0xE232)
+CA_FETA_GLYPH(custodes_vaticana_u0, "custodes.vaticana.u0", 0xE233)
+CA_FETA_GLYPH(custodes_vaticana_u1, "custodes.vaticana.u1", 0xE234)
+CA_FETA_GLYPH(custodes_vaticana_u2, "custodes.vaticana.u2", 0xE235)
+CA_FETA_GLYPH(custodes_vaticana_d0, "custodes.vaticana.d0", 0xE236)
+CA_FETA_GLYPH(custodes_vaticana_d1, "custodes.vaticana.d1", 0xE237)
+CA_FETA_GLYPH(custodes_vaticana_d2, "custodes.vaticana.d2", 0xE238)
+CA_FETA_GLYPH(custodes_mensural_u0, "custodes.mensural.u0", 0xE239)
+CA_FETA_GLYPH(custodes_mensural_u1, "custodes.mensural.u1", 0xE23A)
+CA_FETA_GLYPH(custodes_mensural_u2, "custodes.mensural.u2", 0xE23B)
+CA_FETA_GLYPH(custodes_mensural_d0, "custodes.mensural.d0", 0xE23C)
+CA_FETA_GLYPH(custodes_mensural_d1, "custodes.mensural.d1", 0xE23D)
+CA_FETA_GLYPH(custodes_mensural_d2, "custodes.mensural.d2", 0xE23E)
+CA_FETA_GLYPH(accidentals_medicaeaM1, "accidentals.medicaeaM1", 0xE23F)
+CA_FETA_GLYPH(accidentals_vaticanaM1, "accidentals.vaticanaM1", 0xE240)
+CA_FETA_GLYPH(accidentals_vaticana0, "accidentals.vaticana0", 0xE241)
+CA_FETA_GLYPH(accidentals_mensural1, "accidentals.mensural1", 0xE242)
+CA_FETA_GLYPH(accidentals_mensuralM1, "accidentals.mensuralM1", 0xE243)
+CA_FETA_GLYPH(accidentals_hufnagelM1, "accidentals.hufnagelM1", 0xE244)
+CA_FETA_GLYPH(flags_mensuralu03, "flags.mensuralu03", 0xE245)
+CA_FETA_GLYPH(flags_mensuralu13, "flags.mensuralu13", 0xE246)
+CA_FETA_GLYPH(flags_mensuralu23, "flags.mensuralu23", 0xE247)
+CA_FETA_GLYPH(flags_mensurald03, "flags.mensurald03", 0xE248)
+CA_FETA_GLYPH(flags_mensurald13, "flags.mensurald13", 0xE249)
+CA_FETA_GLYPH(flags_mensurald23, "flags.mensurald23", 0xE24A)
+CA_FETA_GLYPH(flags_mensuralu04, "flags.mensuralu04", 0xE24B)
+CA_FETA_GLYPH(flags_mensuralu14, "flags.mensuralu14", 0xE24C)
+CA_FETA_GLYPH(flags_mensuralu24, "flags.mensuralu24", 0xE24D)
+CA_FETA_GLYPH(flags_mensurald04, "flags.mensurald04", 0xE24E)
+CA_FETA_GLYPH(flags_mensurald14, "flags.mensurald14", 0xE24F)
+CA_FETA_GLYPH(flags_mensurald24, "flags.mensurald24", 0xE250)
+CA_FETA_GLYPH(flags_mensuralu05, "flags.mensuralu05", 0xE251)
+CA_FETA_GLYPH(flags_mensuralu15, "flags.mensuralu15", 0xE252)
+CA_FETA_GLYPH(flags_mensuralu25, "flags.mensuralu25", 0xE253)
+CA_FETA_GLYPH(flags_mensurald05, "flags.mensurald05", 0xE254)
+CA_FETA_GLYPH(flags_mensurald15, "flags.mensurald15", 0xE255)
+CA_FETA_GLYPH(flags_mensurald25, "flags.mensurald25", 0xE256)
+CA_FETA_GLYPH(flags_mensuralu06, "flags.mensuralu06", 0xE257)
+CA_FETA_GLYPH(flags_mensuralu16, "flags.mensuralu16", 0xE258)
+CA_FETA_GLYPH(flags_mensuralu26, "flags.mensuralu26", 0xE259)
+CA_FETA_GLYPH(flags_mensurald06, "flags.mensurald06", 0xE25A)
+CA_FETA_GLYPH(flags_mensurald16, "flags.mensurald16", 0xE25B)
+CA_FETA_GLYPH(flags_mensurald26, "flags.mensurald26", 0xE25C)
+CA_FETA_GLYPH(timesig_mensural44, "timesig.mensural44", 0xE25D)
+CA_FETA_GLYPH(timesig_mensural22, "timesig.mensural22", 0xE25E)
+CA_FETA_GLYPH(timesig_mensural32, "timesig.mensural32", 0xE25F)
+CA_FETA_GLYPH(timesig_mensural64, "timesig.mensural64", 0xE260)
+CA_FETA_GLYPH(timesig_mensural94, "timesig.mensural94", 0xE261)
+CA_FETA_GLYPH(timesig_mensural34, "timesig.mensural34", 0xE262)
+CA_FETA_GLYPH(timesig_mensural68, "timesig.mensural68", 0xE263)
+CA_FETA_GLYPH(timesig_mensural98, "timesig.mensural98", 0xE264)
+CA_FETA_GLYPH(timesig_mensural48, "timesig.mensural48", 0xE265)
+CA_FETA_GLYPH(timesig_mensural68alt, "timesig.mensural68alt", 0xE266)
+CA_FETA_GLYPH(timesig_mensural24, "timesig.mensural24", 0xE267)
+CA_FETA_GLYPH(timesig_neomensural44, "timesig.neomensural44", 0xE268)
+CA_FETA_GLYPH(timesig_neomensural22, "timesig.neomensural22", 0xE269)
+CA_FETA_GLYPH(timesig_neomensural32, "timesig.neomensural32", 0xE26A)
+CA_FETA_GLYPH(timesig_neomensural64, "timesig.neomensural64", 0xE26B)
+CA_FETA_GLYPH(timesig_neomensural94, "timesig.neomensural94", 0xE26C)
+CA_FETA_GLYPH(timesig_neomensural34, "timesig.neomensural34", 0xE26D)
+CA_FETA_GLYPH(timesig_neomensural68, "timesig.neomensural68", 0xE26E)
+CA_FETA_GLYPH(timesig_neomensural98, "timesig.neomensural98", 0xE26F)
+CA_FETA_GLYPH(timesig_neomensural48, "timesig.neomensural48", 0xE270)
+CA_FETA_GLYPH(timesig_neomensural68alt, "timesig.neomensural68alt", 0xE271)
+CA_FETA_GLYPH(timesig_neomensural24, "timesig.neomensural24", 0xE272)
+CA_FETA_GLYPH(scripts_ictus, "scripts.ictus", 0xE273)
+CA_FETA_GLYPH(scripts_uaccentus, "scripts.uaccentus", 0xE274)
+CA_FETA_GLYPH(scripts_daccentus, "scripts.daccentus", 0xE275)
+CA_FETA_GLYPH(scripts_usemicirculus, "scripts.usemicirculus", 0xE276)
+CA_FETA_GLYPH(scripts_dsemicirculus, "scripts.dsemicirculus", 0xE277)
+CA_FETA_GLYPH(scripts_circulus, "scripts.circulus", 0xE278)
+CA_FETA_GLYPH(scripts_augmentum, "scripts.augmentum", 0xE279)
+CA_FETA_GLYPH(scripts_usignumcongruentiae, "scripts.usignumcongruentiae", 0xE27A)
+CA_FETA_GLYPH(scripts_dsignumcongruentiae, "scripts.dsignumcongruentiae", 0xE27B)
+CA_FETA_GLYPH(dots_dotvaticana, "dots.dotvaticana", 0xE27C)
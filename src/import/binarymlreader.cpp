@@ -0,0 +1,327 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#include <QBuffer>
+#include <QFile>
+#include <QObject>
+#include <QtEndian>
+
+#include "core/fileformats.h"
+#include "import/binarymlreader.h"
+
+/*!
+	\class CABinaryMLReader
+	\brief Reader of the binary CanorusML
+
+	Binary CanorusML is the CanorusML document stored as a token stream instead of XML text. It is
+	written by CABinaryMLWriter and read by CACanorusMLImport, which uses the same element handlers
+	for both formats. All little-endian, the document consists of:
+	- the header: CAFileFormats::CANORUSML_BINARY_MAGIC, 16-bit CAFileFormats::CANORUSML_BINARY_VERSION
+	  and 16-bit flags (reserved, 0),
+	- the string table section: 32-bit number of strings, 32-bit byte length of the section and
+	  each string as its UTF-8 byte length followed by the bytes,
+	- the token section: 32-bit byte length of the section and the tokens.
+
+	Element names, attribute names and values and text are stored as the indices in the string
+	table. Numbers are variable length: 7 bits per byte, the lowest first, the highest bit set when
+	more bytes follow. The tokens are:
+	- StartElementToken: name, number of attributes and the pairs of attribute names and values,
+	- StartSectionToken: the same as StartElementToken followed by the 32-bit byte length of the
+	  element content, including its EndElementToken. Sheets, contexts and voices are written as
+	  sections, so they can be skipped or checked without reading their content,
+	- EndElementToken: closes the last open element,
+	- CharactersToken: text.
+
+	The reader is given the whole document at once. Files and buffers are not copied, files are
+	memory mapped when possible. Readers check the CAFileFormats::CANORUSML_BINARY_VERSION of the
+	document and refuse newer versions.
+
+	\sa CABinaryMLWriter, CACanorusMLImport
+*/
+
+const int CABinaryMLReader::HEADER_SIZE = 8;
+
+CABinaryMLReader::CABinaryMLReader()
+    : _pos(0)
+    , _end(0)
+    , _tokenType(NoToken)
+    , _nameIndex(-1)
+{
+}
+
+/*!
+	Returns True, if the \a device opened for reading starts with the binary CanorusML magic.
+	The device position is not changed.
+*/
+bool CABinaryMLReader::isBinaryML(QIODevice* device)
+{
+    return device && device->isReadable() && device->peek(CAFileFormats::CANORUSML_BINARY_MAGIC.size()) == CAFileFormats::CANORUSML_BINARY_MAGIC;
+}
+
+/*!
+	Reads the document from the current position of the \a device to its end.
+	Buffers are shared and files are mapped to memory; other devices are read at once.
+*/
+bool CABinaryMLReader::setDevice(QIODevice* device)
+{
+    if (QBuffer* buffer = qobject_cast<QBuffer*>(device)) {
+        return setData(buffer->data().mid(static_cast<int>(buffer->pos())));
+    }
+
+    QFile* file = qobject_cast<QFile*>(device);
+    if (file && file->size() > file->pos()) {
+        uchar* map = file->map(file->pos(), file->size() - file->pos());
+        if (map) {
+            return setData(QByteArray::fromRawData(reinterpret_cast<const char*>(map), static_cast<int>(file->size() - file->pos())));
+        }
+    }
+
+    return setData(device->readAll());
+}
+
+/*!
+	Checks the header and reads the string table of the \a data.
+	Returns True on success. Otherwise the error is raised and False is returned.
+*/
+bool CABinaryMLReader::setData(const QByteArray& data)
+{
+    _data = data;
+    _pos = 0;
+    _end = _data.size();
+    _strings.clear();
+    _sectionEnds.clear();
+    _tokenType = NoToken;
+    _errorString.clear();
+
+    if (_data.size() < HEADER_SIZE || !_data.startsWith(CAFileFormats::CANORUSML_BINARY_MAGIC)) {
+        raiseError(QObject::tr("Not a binary CanorusML document."));
+        return false;
+    }
+
+    const uchar* header = reinterpret_cast<const uchar*>(_data.constData()) + CAFileFormats::CANORUSML_BINARY_MAGIC.size();
+    quint16 version = qFromLittleEndian<quint16>(header);
+    if (version > CAFileFormats::CANORUSML_BINARY_VERSION) {
+        raiseError(QObject::tr("Unsupported binary CanorusML version %1.").arg(version));
+        return false;
+    }
+    _pos = HEADER_SIZE;
+
+    quint32 count, length;
+    if (!readUInt32(count) || !readUInt32(length) || length > static_cast<quint64>(_data.size() - _pos) || count > length) {
+        raiseError(QObject::tr("Corrupt string table."));
+        return false;
+    }
+
+    _end = _pos + length;
+    _strings.reserve(static_cast<int>(count));
+    for (quint32 i = 0; i < count; i++) {
+        quint32 size;
+        if (!readVarInt(size) || size > static_cast<quint64>(_end - _pos)) {
+            raiseError(QObject::tr("Corrupt string table."));
+            return false;
+        }
+        _strings << QString::fromUtf8(_data.constData() + _pos, static_cast<int>(size));
+        _pos += size;
+    }
+
+    if (_pos != _end) {
+        raiseError(QObject::tr("Corrupt string table."));
+        return false;
+    }
+
+    _end = _data.size();
+    if (!readUInt32(length) || length > static_cast<quint64>(_data.size() - _pos)) {
+        raiseError(QObject::tr("Corrupt token section."));
+        return false;
+    }
+    _end = _pos + length;
+
+    return true;
+}
+
+/*!
+	Reads the section \a content returned by sectionContent() using the string table \a strings of
+	the document it was taken from.
+*/
+void CABinaryMLReader::setSection(const QByteArray& content, const QVector<QString>& strings)
+{
+    _data = content;
+    _pos = 0;
+    _end = _data.size();
+    _strings = strings;
+    _sectionEnds.clear();
+    _tokenType = NoToken;
+    _errorString.clear();
+}
+
+/*!
+	Returns a copy of the content of the section just started by StartSectionToken, without its
+	end element. The copy doesn't depend on the data of the reader, which may be mapped.
+
+	\sa skipSection(), setSection()
+*/
+QByteArray CABinaryMLReader::sectionContent()
+{
+    if (_tokenType != StartSectionToken || _sectionEnds.isEmpty()) {
+        return QByteArray();
+    }
+
+    return QByteArray(_data.constData() + _pos, static_cast<int>(_sectionEnds.last() - _pos - 1));
+}
+
+/*!
+	Continues after the end of the section just started by StartSectionToken. The next token read
+	is the one following the section end element.
+*/
+void CABinaryMLReader::skipSection()
+{
+    if (_tokenType != StartSectionToken || _sectionEnds.isEmpty()) {
+        return;
+    }
+
+    _pos = _sectionEnds.takeLast();
+    if (_data.at(static_cast<int>(_pos - 1)) != static_cast<char>(EndElementToken)) {
+        raiseError(QObject::tr("Corrupt section."));
+    }
+    _tokenType = EndElementToken;
+}
+
+/*!
+	Reads the next token and returns its type. The element name, attributes and text are
+	available until the next call.
+*/
+CABinaryMLReader::CATokenType CABinaryMLReader::readNext()
+{
+    if (hasError()) {
+        return _tokenType = InvalidToken;
+    }
+    if (_pos >= _end) {
+        if (!_sectionEnds.isEmpty()) {
+            raiseError(QObject::tr("Unexpected end of the document."));
+            return _tokenType = InvalidToken;
+        }
+        return _tokenType = EndDocumentToken;
+    }
+
+    _tokenType = static_cast<CATokenType>(static_cast<uchar>(_data.at(static_cast<int>(_pos++))));
+    switch (_tokenType) {
+    case StartElementToken:
+    case StartSectionToken: {
+        int name;
+        quint32 count;
+        if (!readIndex(name) || !readVarInt(count) || count > static_cast<quint64>(_end - _pos)) {
+            raiseError(QObject::tr("Corrupt element."));
+            break;
+        }
+
+        _nameIndex = name;
+        _attributes.clear();
+        _attributes.reserve(static_cast<int>(count));
+        for (quint32 i = 0; i < count && !hasError(); i++) {
+            int attrName, attrValue;
+            if (readIndex(attrName) && readIndex(attrValue)) {
+                _attributes.append(_strings.at(attrName), _strings.at(attrValue));
+            } else {
+                raiseError(QObject::tr("Corrupt attribute."));
+            }
+        }
+
+        if (hasError()) {
+            break;
+        } else if (_tokenType == StartSectionToken) {
+            quint32 length;
+            if (!readUInt32(length) || !length || length > static_cast<quint64>(_end - _pos)) {
+                raiseError(QObject::tr("Corrupt section."));
+                break;
+            }
+            _sectionEnds << _pos + length;
+        } else {
+            _sectionEnds << -1;
+        }
+        break;
+    }
+    case EndElementToken:
+        if (_sectionEnds.isEmpty()) {
+            raiseError(QObject::tr("Unexpected end element."));
+        } else {
+            qint64 sectionEnd = _sectionEnds.takeLast();
+            if (sectionEnd >= 0 && sectionEnd != _pos) {
+                raiseError(QObject::tr("Corrupt section."));
+            }
+        }
+        break;
+    case CharactersToken: {
+        int text;
+        if (readIndex(text)) {
+            _text = _strings.at(text);
+        } else {
+            raiseError(QObject::tr("Corrupt text."));
+        }
+        break;
+    }
+    default:
+        raiseError(QObject::tr("Unknown token %1.").arg(static_cast<int>(_tokenType)));
+        break;
+    }
+
+    return hasError() ? (_tokenType = InvalidToken) : _tokenType;
+}
+
+/*!
+	Stops reading with the given error \a message. Only the first error is kept.
+*/
+void CABinaryMLReader::raiseError(const QString& message)
+{
+    if (_errorString.isEmpty()) {
+        _errorString = message;
+    }
+}
+
+bool CABinaryMLReader::readVarInt(quint32& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 32 && _pos < _end; shift += 7) {
+        uchar byte = static_cast<uchar>(_data.at(static_cast<int>(_pos++)));
+        value |= static_cast<quint32>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool CABinaryMLReader::readUInt32(quint32& value)
+{
+    if (_end - _pos < 4) {
+        return false;
+    }
+
+    value = qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(_data.constData() + _pos));
+    _pos += 4;
+    return true;
+}
+
+/*!
+	Reads the string table \a index and checks it.
+*/
+bool CABinaryMLReader::readIndex(int& index)
+{
+    quint32 value;
+    if (!readVarInt(value) || value >= static_cast<quint32>(_strings.size())) {
+        return false;
+    }
+
+    index = static_cast<int>(value);
+    return true;
+}
+
+/*!
+	\var CABinaryMLReader::_sectionEnds
+	Stack of the open elements. Sections hold the expected position after their end element,
+	which is checked when the section is closed.
+*/
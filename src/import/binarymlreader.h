@@ -0,0 +1,76 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#ifndef BINARYMLREADER_H_
+#define BINARYMLREADER_H_
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QXmlStreamAttributes>
+
+class QIODevice;
+
+class CABinaryMLReader {
+public:
+    enum CATokenType {
+        NoToken = 0,
+        StartElementToken = 1,
+        StartSectionToken = 2,
+        EndElementToken = 3,
+        CharactersToken = 4,
+        EndDocumentToken,
+        InvalidToken
+    };
+
+    CABinaryMLReader();
+
+    static const int HEADER_SIZE;
+    static bool isBinaryML(QIODevice* device);
+
+    bool setDevice(QIODevice* device);
+    bool setData(const QByteArray& data);
+    void setSection(const QByteArray& content, const QVector<QString>& strings);
+
+    CATokenType readNext();
+    inline CATokenType tokenType() { return _tokenType; }
+
+    inline int nameIndex() { return _nameIndex; }
+    inline const QXmlStreamAttributes& attributes() { return _attributes; }
+    inline const QString& text() { return _text; }
+
+    QByteArray sectionContent();
+    void skipSection();
+
+    inline const QVector<QString>& strings() { return _strings; }
+    inline qint64 offset() { return _pos; }
+    inline qint64 size() { return _data.size(); }
+
+    inline bool hasError() { return !_errorString.isEmpty(); }
+    inline const QString& errorString() { return _errorString; }
+    void raiseError(const QString& message);
+
+private:
+    bool readVarInt(quint32& value);
+    bool readUInt32(quint32& value);
+    bool readIndex(int& index);
+
+    QByteArray _data; // whole document, maps the file if possible
+    qint64 _pos; // read position in _data
+    qint64 _end; // end of the token section
+
+    QVector<QString> _strings; // string table
+    QVector<qint64> _sectionEnds; // ends of the open elements, -1 for plain elements
+
+    CATokenType _tokenType;
+    int _nameIndex; // index of the element name in the string table
+    QXmlStreamAttributes _attributes;
+    QString _text;
+    QString _errorString;
+};
+
+#endif /* BINARYMLREADER_H_ */
@@ -6,6 +6,7 @@
 */
 
 #include "import/canimport.h"
+#include "control/resourcectl.h"
 #include "core/archive.h"
 #include "import/canorusmlimport.h"
 #include "score/resource.h"
@@ -17,6 +18,7 @@
 #include <QTemporaryFile>
 #include <QTextStream>
 
+
 CACanImport::CACanImport(QTextStream* stream)
     : CAImport(stream)
 {
@@ -31,14 +33,23 @@ CADocument* CACanImport::importDocumentImpl()
     CAArchive* arc = new CAArchive(*stream()->device());
 
     if (!arc->error()) {
-        // Read the score
-        CAIOPtr filePtr = arc->file("content.xml");
+        // Read the score, content.bin is stored instead of content.xml by CAFileFormats::CanBinary
+        CAIOPtr filePtr = arc->file(arc->contains("content.bin") ? "content.bin" : "content.xml");
         CACanorusMLImport* content = new CACanorusMLImport(new QTextStream(&*filePtr));
+        content->setLazySheets(true); // binary sheets are read when first needed
+        // pass the sheets and the progress of the content on as it is read
+        connect(content, SIGNAL(sheetPublished(CASheet*)), this, SIGNAL(sheetPublished(CASheet*)), Qt::DirectConnection);
+        content->setProgressToken(progressToken());
         content->importDocument();
         content->wait();
         CADocument* doc = content->importedDocument();
         delete content;
 
+        if (isCanceled()) {
+            delete arc;
+            return doc; // deleted by the caller
+        }
+
         if (!doc) {
             setStatus(-1);
             return nullptr;
@@ -49,20 +60,25 @@ CADocument* CACanImport::importDocumentImpl()
             std::shared_ptr<CAResource> r = doc->resourceList()[i];
             if (!r->isLinked()) {
                 // attached file - copy to /tmp
-                CAIOPtr rPtr = arc->file(r->url().toLocalFile()); // chop the two leading slashes
-                if (!dynamic_cast<QFile*>(&*rPtr)) {
+                if (!arc->contains(r->url().toLocalFile())) {
                     qCritical() << "CACanImport: Resource \"" << r->url().toLocalFile() << "\" not found in the file.";
                     continue;
                 }
+                CAIOPtr rPtr = arc->file(r->url().toLocalFile()); // chop the two leading slashes
 
-                QTemporaryFile* f = new QTemporaryFile(QDir::tempPath() + "/" + r->name());
-                f->open();
-                QString targetFile = QFileInfo(*f).absoluteFilePath();
-                f->close();
-                delete f;
+                QTemporaryFile f(QDir::tempPath() + "/" + r->name());
+                f.setAutoRemove(false);
+                QByteArray hash;
+                if (f.open()) {
+                    hash = CAResourceCtl::copyResource(*rPtr, f);
+                }
+                QString targetFile = QFileInfo(f).absoluteFilePath();
+                f.close();
 
-                static_cast<QFile*>(&*rPtr)->copy(targetFile);
                 r->setUrl(QUrl::fromLocalFile(targetFile));
+                if (!hash.isEmpty()) {
+                    r->setHash(hash); // unchanged resources are not written again by CACanExport
+                }
             } else if (r->url().scheme() == "file" && file()) {
                 // linked local file - convert the relative path to absolute
                 QString outDir(QFileInfo(*file()).absolutePath());
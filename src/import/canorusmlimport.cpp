@@ -11,6 +11,7 @@
 #include <QVariant>
 #include <QVersionNumber>
 
+#include "import/binarymlreader.h"
 #include "import/canorusmlimport.h"
 
 #include "control/resourcectl.h"
@@ -59,21 +60,22 @@
 	\brief Class for opening the Canorus documents
 
 	CACanorusMLImport class opens the XML based Canorus documents.
-	It uses SAX parser for reading.
+	It uses QXmlStreamReader for reading. Documents in binary CanorusML are recognized by their
+	header and read by CABinaryMLReader using the same element handlers.
 
 	\sa CAImport, CACanorusMLExport
 */
 
 CACanorusMLImport::CACanorusMLImport(QTextStream* stream)
     : CAImport(stream)
-    , QXmlDefaultHandler()
+    , QXmlStreamReader()
 {
     initCanorusMLImport();
 }
 
 CACanorusMLImport::CACanorusMLImport(const QString stream)
     : CAImport(stream)
-    , QXmlDefaultHandler()
+    , QXmlStreamReader()
 {
     initCanorusMLImport();
 }
@@ -84,6 +86,8 @@ CACanorusMLImport::~CACanorusMLImport()
 
 void CACanorusMLImport::initCanorusMLImport()
 {
+    _binary = false;
+    _lazySheets = false;
     _document = nullptr;
     _curSheet = nullptr;
     _curContext = nullptr;
@@ -104,60 +108,298 @@ void CACanorusMLImport::initCanorusMLImport()
     _curTuplet = nullptr;
 }
 
+/*!
+	Reads the CanorusML source with QXmlStreamReader and creates the document.
+	Element names are mapped to tags by tagFromName() and dispatched to startElement() and
+	endElement(). The progress is updated from the position in the source. When canceled, the
+	document read so far is returned.
+
+	Binary CanorusML is read by importBinaryDocument().
+*/
 CADocument* CACanorusMLImport::importDocumentImpl()
 {
     QIODevice* device = stream()->device();
-    QXmlInputSource* src;
-    if (device)
-        src = new QXmlInputSource(device);
-    else {
-        src = new QXmlInputSource();
-        src->setData(*stream()->string());
-    }
-    QXmlSimpleReader* reader = new QXmlSimpleReader();
-    reader->setContentHandler(this);
-    reader->setErrorHandler(this);
-    reader->parse(src);
+    if (CABinaryMLReader::isBinaryML(device)) {
+        return importBinaryDocument(device);
+    }
+
+    qint64 size;
+    if (device) {
+        QXmlStreamReader::setDevice(device);
+        size = device->size();
+    } else {
+        QXmlStreamReader::addData(*stream()->string());
+        size = stream()->string()->size();
+    }
+
+    while (!atEnd() && !isCanceled()) {
+        readNext();
+
+        switch (tokenType()) {
+        case StartElement: {
+            if (!startElement(tagFromName(name()), attributes())) {
+                raiseError(_errorMsg);
+            }
+            break;
+        }
+        case EndElement: {
+            if (!endElement(tagFromName(name()))) {
+                raiseError(_errorMsg);
+            }
+            break;
+        }
+        case Characters: {
+            if (!isWhitespace()) {
+                _cha = text().toString();
+            }
+            break;
+        }
+        case StartDocument:
+        case EndDocument:
+        case DTD:
+        case ProcessingInstruction:
+        case EntityReference:
+        case Comment:
+        case Invalid:
+        case NoToken:
+            break;
+        }
+
+        if (size > 0) {
+            setProgress(device ? device->pos() : characterOffset(), size, CAProgress::Bytes);
+        }
+    }
+
+    if (hasError()) {
+        qWarning() << "Fatal error on line " << lineNumber()
+                   << ", column " << columnNumber() << ": "
+                   << errorString();
+        setStatus(-2);
+    }
 
     if (document() && !_fileName.isEmpty()) {
         document()->setFileName(_fileName);
     }
 
-    delete reader;
-    delete src;
+    return document();
+}
+
+namespace {
+
+/*!
+	Reads the content of the sheet which was skipped by the binary CanorusML import.
+*/
+class CACanorusMLSheetLoader : public CASheetLoader {
+public:
+    CACanorusMLSheetLoader(const QByteArray& content, const QVector<QString>& strings, const QVersionNumber& version)
+        : _content(content)
+        , _strings(strings)
+        , _version(version)
+    {
+    }
+
+    void load(CASheet* sheet) { CACanorusMLImport::importSheetContent(sheet, _content, _strings, _version); }
+
+private:
+    const QByteArray _content; // sheet section without its end element
+    const QVector<QString> _strings; // string table of the document
+    const QVersionNumber _version;
+};
+
+}
+
+/*!
+	Reads the binary CanorusML document from the \a device and creates the document.
+	The element names are mapped to tags once for the whole string table and the tokens are
+	dispatched to the same startElement() and endElement() as the XML elements.
+
+	If lazySheets() is set, the sheets are not read. They are created with their names and a loader
+	which reads their content when it is first accessed, see CASheet::load().
+*/
+CADocument* CACanorusMLImport::importBinaryDocument(QIODevice* device)
+{
+    _binary = true;
+
+    CABinaryMLReader reader;
+    if (reader.setDevice(device)) {
+        readBinary(reader);
+    }
+
+    if (reader.hasError()) {
+        _errorMsg = tr("Error at byte %1: %2").arg(reader.offset()).arg(reader.errorString());
+        qWarning() << "Fatal error:" << _errorMsg;
+        setStatus(-2);
+    }
+
+    if (document() && !_fileName.isEmpty()) {
+        document()->setFileName(_fileName);
+    }
 
     return document();
 }
 
 /*!
-	This method should be called when a critical error occurs while parsing the XML source.
+	Reads the tokens of the \a reader until the end of the document or an error.
+*/
+void CACanorusMLImport::readBinary(CABinaryMLReader& reader)
+{
+    QVector<CATag> tags;
+    tags.reserve(reader.strings().size());
+    for (const QString& string : reader.strings()) {
+        tags << tagFromName(QStringRef(&string));
+    }
 
-	\sa startElement(), endElement()
+    qint64 size = reader.size();
+    while (!isCanceled() && reader.readNext() != CABinaryMLReader::EndDocumentToken && !reader.hasError()) {
+        switch (reader.tokenType()) {
+        case CABinaryMLReader::StartElementToken:
+        case CABinaryMLReader::StartSectionToken:
+            if (!startElement(tags[reader.nameIndex()], reader.attributes())) {
+                reader.raiseError(_errorMsg);
+            } else if (lazySheets() && _depth.top() == SheetTag && reader.tokenType() == CABinaryMLReader::StartSectionToken) {
+                _curSheet->setLoader(std::make_shared<CACanorusMLSheetLoader>(reader.sectionContent(), reader.strings(), _version));
+                reader.skipSection();
+                _depth.pop();
+                publishSheet(_curSheet);
+                _curSheet = nullptr;
+            }
+            break;
+        case CABinaryMLReader::EndElementToken:
+            if (!endElement(_depth.isEmpty() ? UndefinedTag : _depth.top())) {
+                reader.raiseError(_errorMsg);
+            }
+            break;
+        case CABinaryMLReader::CharactersToken:
+            _cha = reader.text();
+            break;
+        default:
+            break;
+        }
+
+        if (size > 0) {
+            setProgress(reader.offset(), size, CAProgress::Bytes);
+        }
+    }
+}
+
+/*!
+	Reads the \a content of the sheet section of binary CanorusML into the empty \a sheet.
+	\a strings is the string table and \a version the Canorus version of the document. The errors
+	are printed, the sheet keeps the content read until the error.
+
+	This function is called by the loader of the sheets left unloaded by the import.
 */
-bool CACanorusMLImport::fatalError(const QXmlParseException& exception)
+void CACanorusMLImport::importSheetContent(CASheet* sheet, const QByteArray& content, const QVector<QString>& strings, const QVersionNumber& version)
 {
-    qWarning() << "Fatal error on line " << exception.lineNumber()
-               << ", column " << exception.columnNumber() << ": "
-               << exception.message() << "\n\nParser message:\n"
-               << _errorMsg;
+    CACanorusMLImport import;
+    import._binary = true;
+    import._document = sheet->document();
+    import._curSheet = sheet;
+    import._version = version;
+    import._depth.push(SheetTag);
+
+    CABinaryMLReader reader;
+    reader.setSection(content, strings);
+    import.readBinary(reader);
+    if (!reader.hasError()) {
+        import.endElement(SheetTag);
+    }
+
+    if (reader.hasError()) {
+        qWarning() << "Fatal error in sheet" << sheet->name() << "at byte" << reader.offset() << ":" << reader.errorString();
+    }
+}
 
-    return false;
+const QString CACanorusMLImport::readableStatus()
+{
+    if (status() == -2 && _binary) {
+        return _errorMsg;
+    } else if (status() == -2) {
+        return tr("Error on line %1, column %2: %3").arg(lineNumber()).arg(columnNumber()).arg(errorString());
+    } else {
+        return CAImport::readableStatus();
+    }
 }
 
 /*!
-	This function is called automatically by Qt SAX parser while reading the CanorusML
-	source. This function is called when a new node is opened. It already reads node
-	attributes.
+	Returns the tag for the given element \a name or UndefinedTag, if the element is not known.
+	The names are looked up by binary search in a sorted table, so no strings are allocated while
+	parsing.
+*/
+CACanorusMLImport::CATag CACanorusMLImport::tagFromName(const QStringRef& name)
+{
+    struct CATagName {
+        const char* name;
+        CATag tag;
+    };
+
+    // sorted by name
+    static const CATagName tags[] = {
+        { "barline", BarlineTag },
+        { "canorus-version", CanorusVersionTag },
+        { "chord-name", ChordNameTag },
+        { "chord-name-context", ChordNameContextTag },
+        { "clef", ClefTag },
+        { "diatonic-key", DiatonicKeyTag },
+        { "diatonic-pitch", DiatonicPitchTag },
+        { "document", DocumentTag },
+        { "figured-bass-context", FiguredBassContextTag },
+        { "figured-bass-mark", FiguredBassMarkTag },
+        { "figured-bass-number", FiguredBassNumberTag },
+        { "function-mark", FunctionMarkTag },
+        { "function-mark-context", FunctionMarkContextTag },
+        { "function-marking", FunctionMarkingTag },
+        { "function-marking-context", FunctionMarkingContextTag },
+        { "key-signature", KeySignatureTag },
+        { "lyrics-context", LyricsContextTag },
+        { "mark", MarkTag },
+        { "note", NoteTag },
+        { "phrasing-slur-end", PhrasingSlurEndTag },
+        { "phrasing-slur-start", PhrasingSlurStartTag },
+        { "playable-length", PlayableLengthTag },
+        { "resource", ResourceTag },
+        { "rest", RestTag },
+        { "sheet", SheetTag },
+        { "slur-end", SlurEndTag },
+        { "slur-start", SlurStartTag },
+        { "staff", StaffTag },
+        { "syllable", SyllableTag },
+        { "tie", TieTag },
+        { "time-signature", TimeSignatureTag },
+        { "tuplet", TupletTag },
+        { "voice", VoiceTag }
+    };
+
+    int low = 0;
+    int high = static_cast<int>(sizeof(tags) / sizeof(tags[0])) - 1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        int cmp = name.compare(QLatin1String(tags[mid].name));
+        if (cmp == 0) {
+            return tags[mid].tag;
+        } else if (cmp < 0) {
+            high = mid - 1;
+        } else {
+            low = mid + 1;
+        }
+    }
+
+    return UndefinedTag;
+}
+
+/*!
+	This function is called while reading the CanorusML source when a new node with the given
+	\a tag is opened. It already reads node attributes.
 
 	The function returns true, if the node was successfully recognized and parsed;
 	otherwise false.
 
 	\sa endElement()
 */
-bool CACanorusMLImport::startElement(const QString&, const QString&, const QString& qName, const QXmlAttributes& attributes)
+bool CACanorusMLImport::startElement(CATag tag, const QXmlStreamAttributes& attributes)
 {
-    if (attributes.value("color") != "") {
-        _color = QVariant(attributes.value("color")).value<QColor>();
+    if (attributes.value(QLatin1String("color")) != "") {
+        _color = QVariant(attributes.value(QLatin1String("color")).toString()).value<QColor>();
         if (_version <= QVersionNumber(0, 7, 3)) {
             // before Canorus 0.7.4, color was incorrectly saved (always #000000)
             _color = QColor();
@@ -166,26 +408,26 @@ bool CACanorusMLImport::startElement(const QString&, const QString&, const QStri
         _color = QColor();
     }
 
-    if (qName == "document") {
+    if (tag == DocumentTag) {
         // CADocument
         _document = new CADocument();
-        _document->setTitle(attributes.value("title"));
-        _document->setSubtitle(attributes.value("subtitle"));
-        _document->setComposer(attributes.value("composer"));
-        _document->setArranger(attributes.value("arranger"));
-        _document->setPoet(attributes.value("poet"));
-        _document->setTextTranslator(attributes.value("text-translator"));
-        _document->setCopyright(attributes.value("copyright"));
-        _document->setDedication(attributes.value("dedication"));
-        _document->setComments(attributes.value("comments"));
-
-        _document->setDateCreated(QDateTime::fromString(attributes.value("date-created"), Qt::ISODate));
-        _document->setDateLastModified(QDateTime::fromString(attributes.value("date-last-modified"), Qt::ISODate));
-        _document->setTimeEdited(attributes.value("time-edited").toUInt());
-
-    } else if (qName == "sheet") {
+        _document->setTitle(attributes.value(QLatin1String("title")).toString());
+        _document->setSubtitle(attributes.value(QLatin1String("subtitle")).toString());
+        _document->setComposer(attributes.value(QLatin1String("composer")).toString());
+        _document->setArranger(attributes.value(QLatin1String("arranger")).toString());
+        _document->setPoet(attributes.value(QLatin1String("poet")).toString());
+        _document->setTextTranslator(attributes.value(QLatin1String("text-translator")).toString());
+        _document->setCopyright(attributes.value(QLatin1String("copyright")).toString());
+        _document->setDedication(attributes.value(QLatin1String("dedication")).toString());
+        _document->setComments(attributes.value(QLatin1String("comments")).toString());
+
+        _document->setDateCreated(QDateTime::fromString(attributes.value(QLatin1String("date-created")).toString(), Qt::ISODate));
+        _document->setDateLastModified(QDateTime::fromString(attributes.value(QLatin1String("date-last-modified")).toString(), Qt::ISODate));
+        _document->setTimeEdited(attributes.value(QLatin1String("time-edited")).toUInt());
+
+    } else if (tag == SheetTag) {
         // CASheet
-        QString sheetName = attributes.value("name");
+        QString sheetName = attributes.value(QLatin1String("name")).toString();
 
         if (sheetName.isEmpty())
             sheetName = QObject::tr("Sheet%1").arg(_document->sheetList().size() + 1);
@@ -193,9 +435,9 @@ bool CACanorusMLImport::startElement(const QString&, const QString&, const QStri
 
         _document->addSheet(_curSheet);
 
-    } else if (qName == "staff") {
+    } else if (tag == StaffTag) {
         // CAStaff
-        QString staffName = attributes.value("name");
+        QString staffName = attributes.value(QLatin1String("name")).toString();
         if (!_curSheet) {
             _errorMsg = "The sheet where to add the staff doesn't exist yet!";
             return false;
@@ -203,13 +445,14 @@ bool CACanorusMLImport::startElement(const QString&, const QString&, const QStri
 
         if (staffName.isEmpty())
             staffName = QObject::tr("Staff%1").arg(_curSheet->staffList().size() + 1);
-        _curContext = new CAStaff(staffName, _curSheet, attributes.value("number-of-lines").toInt());
+        _curContext = new CAStaff(staffName, _curSheet, attributes.value(QLatin1String("number-of-lines")).toInt());
+        static_cast<CAStaff*>(_curContext)->setFrozen(attributes.value(QLatin1String("frozen")) == "1"); // synchronized once after loading anyway
 
         _curSheet->addContext(_curContext);
 
-    } else if (qName == "lyrics-context") {
+    } else if (tag == LyricsContextTag) {
         // CALyricsContext
-        QString lcName = attributes.value("name");
+        QString lcName = attributes.value(QLatin1String("name")).toString();
         if (!_curSheet) {
             _errorMsg = "The sheet where to add the lyrics context doesn't exist yet!";
             return false;
@@ -217,17 +460,17 @@ bool CACanorusMLImport::startElement(const QString&, const QString&, const QStri
 
         if (lcName.isEmpty())
             lcName = QObject::tr("LyricsContext%1").arg(_curSheet->contextList().size() + 1);
-        _curContext = new CALyricsContext(lcName, attributes.value("stanza-number").toInt(), _curSheet);
+        _curContext = new CALyricsContext(lcName, attributes.value(QLatin1String("stanza-number")).toInt(), _curSheet);
 
         // voices are not neccesseraly completely read - store indices of the voices internally and then assign them at the end
-        if (!attributes.value("associated-voice-idx").isEmpty())
-            _lcMap[static_cast<CALyricsContext*>(_curContext)] = attributes.value("associated-voice-idx").toInt();
+        if (!attributes.value(QLatin1String("associated-voice-idx")).isEmpty())
+            _lcMap[static_cast<CALyricsContext*>(_curContext)] = attributes.value(QLatin1String("associated-voice-idx")).toInt();
 
         _curSheet->addContext(_curContext);
 
-    } else if (qName == "figured-bass-context") {
+    } else if (tag == FiguredBassContextTag) {
         // CAFiguredBassContext
-        QString fbcName = attributes.value("name");
+        QString fbcName = attributes.value(QLatin1String("name")).toString();
         if (!_curSheet) {
             _errorMsg = "The sheet where to add the figured bass context doesn't exist yet!";
             return false;
@@ -239,9 +482,9 @@ bool CACanorusMLImport::startElement(const QString&, const QString&, const QStri
 
         _curSheet->addContext(_curContext);
 
-    } else if (qName == "function-mark-context" || qName == "function-marking-context") {
+    } else if (tag == FunctionMarkContextTag || tag == FunctionMarkingContextTag) {
         // CAFunctionMarkContext
-        QString fmcName = attributes.value("name");
+        QString fmcName = attributes.value(QLatin1String("name")).toString();
         if (!_curSheet) {
             _errorMsg = "The sheet where to add the function mark context doesn't exist yet!";
             return false;
@@ -253,9 +496,9 @@ bool CACanorusMLImport::startElement(const QString&, const QString&, const QStri
 
         _curSheet->addContext(_curContext);
 
-    } else if (qName == "chord-name-context") {
+    } else if (tag == ChordNameContextTag) {
         // CAChordNameContext
-        QString cncName = attributes.value("name");
+        QString cncName = attributes.value(QLatin1String("name")).toString();
         if (!_curSheet) {
             _errorMsg = "The sheet where to add the chord name context doesn't exist yet!";
             return false;
@@ -267,9 +510,9 @@ bool CACanorusMLImport::startElement(const QString&, const QString&, const QStri
 
         _curSheet->addContext(_curContext);
 
-    } else if (qName == "voice") {
+    } else if (tag == VoiceTag) {
         // CAVoice
-        QString voiceName = attributes.value("name");
+        QString voiceName = attributes.value(QLatin1String("name")).toString();
         if (!_curContext) {
             _errorMsg = "The context where the voice " + voiceName + " should be added doesn't exist yet!";
             return false;
@@ -286,54 +529,55 @@ bool CACanorusMLImport::startElement(const QString&, const QString&, const QStri
             voiceName = QObject::tr("Voice%1").arg(voiceNumber);
 
         CANote::CAStemDirection stemDir = CANote::StemNeutral;
-        if (!attributes.value("stem-direction").isEmpty())
-            stemDir = CANote::stemDirectionFromString(attributes.value("stem-direction"));
+        if (!attributes.value(QLatin1String("stem-direction")).isEmpty())
+            stemDir = CANote::stemDirectionFromString(attributes.value(QLatin1String("stem-direction")).toString());
 
         _curVoice = new CAVoice(voiceName, staff, stemDir);
-        if (!attributes.value("midi-channel").isEmpty()) {
-            _curVoice->setMidiChannel(static_cast<unsigned char>(attributes.value("midi-channel").toUInt()));
+        if (!attributes.value(QLatin1String("midi-channel")).isEmpty()) {
+            _curVoice->setMidiChannel(static_cast<unsigned char>(attributes.value(QLatin1String("midi-channel")).toUInt()));
         }
-        if (!attributes.value("midi-program").isEmpty()) {
-            _curVoice->setMidiProgram(static_cast<unsigned char>(attributes.value("midi-program").toUInt()));
+        if (!attributes.value(QLatin1String("midi-program")).isEmpty()) {
+            _curVoice->setMidiProgram(static_cast<unsigned char>(attributes.value(QLatin1String("midi-program")).toUInt()));
         }
-        if (!attributes.value("midi-pitch-offset").isEmpty()) {
-            _curVoice->setMidiPitchOffset(static_cast<char>(attributes.value("midi-pitch-offset").toInt()));
+        if (!attributes.value(QLatin1String("midi-pitch-offset")).isEmpty()) {
+            _curVoice->setMidiPitchOffset(static_cast<char>(attributes.value(QLatin1String("midi-pitch-offset")).toInt()));
         }
+        _curVoice->setMidiPort(attributes.value(QLatin1String("midi-port")).toString());
 
         staff->addVoice(_curVoice);
 
-    } else if (qName == "clef") {
+    } else if (tag == ClefTag) {
         // CAClef
-        _curClef = new CAClef(CAClef::clefTypeFromString(attributes.value("clef-type")),
-            attributes.value("c1").toInt(),
+        _curClef = new CAClef(CAClef::clefTypeFromString(attributes.value(QLatin1String("clef-type")).toString()),
+            attributes.value(QLatin1String("c1")).toInt(),
             _curVoice->staff(),
-            attributes.value("time-start").toInt(),
-            attributes.value("offset").toInt());
+            attributes.value(QLatin1String("time-start")).toInt(),
+            attributes.value(QLatin1String("offset")).toInt());
         _curMusElt = _curClef;
         _curMusElt->setColor(_color);
-    } else if (qName == "time-signature") {
+    } else if (tag == TimeSignatureTag) {
         // CATimeSignature
-        _curTimeSig = new CATimeSignature(attributes.value("beats").toInt(),
-            attributes.value("beat").toInt(),
+        _curTimeSig = new CATimeSignature(attributes.value(QLatin1String("beats")).toInt(),
+            attributes.value(QLatin1String("beat")).toInt(),
             _curVoice->staff(),
-            attributes.value("time-start").toInt(),
-            CATimeSignature::timeSignatureTypeFromString(attributes.value("time-signature-type")));
+            attributes.value(QLatin1String("time-start")).toInt(),
+            CATimeSignature::timeSignatureTypeFromString(attributes.value(QLatin1String("time-signature-type")).toString()));
         _curMusElt = _curTimeSig;
         _curMusElt->setColor(_color);
-    } else if (qName == "key-signature") {
+    } else if (tag == KeySignatureTag) {
         // CAKeySignature
-        CAKeySignature::CAKeySignatureType type = CAKeySignature::keySignatureTypeFromString(attributes.value("key-signature-type"));
+        CAKeySignature::CAKeySignatureType type = CAKeySignature::keySignatureTypeFromString(attributes.value(QLatin1String("key-signature-type")).toString());
         switch (type) {
         case CAKeySignature::MajorMinor: {
             _curKeySig = new CAKeySignature(CADiatonicKey(),
                 _curVoice->staff(),
-                attributes.value("time-start").toInt());
+                attributes.value(QLatin1String("time-start")).toInt());
             break;
         }
         case CAKeySignature::Modus: {
-            _curKeySig = new CAKeySignature(CAKeySignature::modusFromString(attributes.value("modus")),
+            _curKeySig = new CAKeySignature(CAKeySignature::modusFromString(attributes.value(QLatin1String("modus")).toString()),
                 _curVoice->staff(),
-                attributes.value("time-start").toInt());
+                attributes.value(QLatin1String("time-start")).toInt());
             break;
         }
         case CAKeySignature::Custom:
@@ -342,30 +586,30 @@ bool CACanorusMLImport::startElement(const QString&, const QString&, const QStri
 
         _curMusElt = _curKeySig;
         _curMusElt->setColor(_color);
-    } else if (qName == "barline") {
+    } else if (tag == BarlineTag) {
         // CABarline
-        _curBarline = new CABarline(CABarline::barlineTypeFromString(attributes.value("barline-type")),
+        _curBarline = new CABarline(CABarline::barlineTypeFromString(attributes.value(QLatin1String("barline-type")).toString()),
             _curVoice->staff(),
-            attributes.value("time-start").toInt());
+            attributes.value(QLatin1String("time-start")).toInt());
         _curMusElt = _curBarline;
-    } else if (qName == "note") {
+    } else if (tag == NoteTag) {
         // CANote
         if (QVersionNumber(0, 5).isPrefixOf(_version)) {
-            _curNote = new CANote(CADiatonicPitch(attributes.value("pitch").toInt(), attributes.value("accs").toInt()),
-                CAPlayableLength(CAPlayableLength::musicLengthFromString(attributes.value("playable-length")), attributes.value("dotted").toInt()),
+            _curNote = new CANote(CADiatonicPitch(attributes.value(QLatin1String("pitch")).toInt(), attributes.value(QLatin1String("accs")).toInt()),
+                CAPlayableLength(CAPlayableLength::musicLengthFromString(attributes.value(QLatin1String("playable-length")).toString()), attributes.value(QLatin1String("dotted")).toInt()),
                 _curVoice,
-                attributes.value("time-start").toInt(),
-                attributes.value("time-length").toInt());
+                attributes.value(QLatin1String("time-start")).toInt(),
+                attributes.value(QLatin1String("time-length")).toInt());
         } else {
             _curNote = new CANote(CADiatonicPitch(),
                 CAPlayableLength(),
                 _curVoice,
-                attributes.value("time-start").toInt(),
-                attributes.value("time-length").toInt());
+                attributes.value(QLatin1String("time-start")).toInt(),
+                attributes.value(QLatin1String("time-length")).toInt());
         }
 
-        if (!attributes.value("stem-direction").isEmpty()) {
-            _curNote->setStemDirection(CANote::stemDirectionFromString(attributes.value("stem-direction")));
+        if (!attributes.value(QLatin1String("stem-direction")).isEmpty()) {
+            _curNote->setStemDirection(CANote::stemDirectionFromString(attributes.value(QLatin1String("stem-direction")).toString()));
         }
 
         if (_curTuplet) {
@@ -375,67 +619,67 @@ bool CACanorusMLImport::startElement(const QString&, const QString&, const QStri
 
         _curMusElt = _curNote;
         _curMusElt->setColor(_color);
-    } else if (qName == "tie") {
+    } else if (tag == TieTag) {
         _curTie = new CASlur(CASlur::TieType, CASlur::SlurPreferred, _curNote->staff(), _curNote, nullptr);
         _curNote->setTieStart(_curTie);
-        if (!attributes.value("slur-style").isEmpty())
-            _curTie->setSlurStyle(CASlur::slurStyleFromString(attributes.value("slur-style")));
-        if (!attributes.value("slur-direction").isEmpty())
-            _curTie->setSlurDirection(CASlur::slurDirectionFromString(attributes.value("slur-direction")));
+        if (!attributes.value(QLatin1String("slur-style")).isEmpty())
+            _curTie->setSlurStyle(CASlur::slurStyleFromString(attributes.value(QLatin1String("slur-style")).toString()));
+        if (!attributes.value(QLatin1String("slur-direction")).isEmpty())
+            _curTie->setSlurDirection(CASlur::slurDirectionFromString(attributes.value(QLatin1String("slur-direction")).toString()));
         _prevMusElt = _curMusElt;
         _curMusElt = _curTie;
         _curMusElt->setColor(_color);
-    } else if (qName == "slur-start") {
+    } else if (tag == SlurStartTag) {
         _curSlur = new CASlur(CASlur::SlurType, CASlur::SlurPreferred, _curNote->staff(), _curNote, nullptr);
         _curNote->setSlurStart(_curSlur);
-        if (!attributes.value("slur-style").isEmpty())
-            _curSlur->setSlurStyle(CASlur::slurStyleFromString(attributes.value("slur-style")));
-        if (!attributes.value("slur-direction").isEmpty())
-            _curSlur->setSlurDirection(CASlur::slurDirectionFromString(attributes.value("slur-direction")));
+        if (!attributes.value(QLatin1String("slur-style")).isEmpty())
+            _curSlur->setSlurStyle(CASlur::slurStyleFromString(attributes.value(QLatin1String("slur-style")).toString()));
+        if (!attributes.value(QLatin1String("slur-direction")).isEmpty())
+            _curSlur->setSlurDirection(CASlur::slurDirectionFromString(attributes.value(QLatin1String("slur-direction")).toString()));
         _prevMusElt = _curMusElt;
         _curMusElt = _curSlur;
         _curMusElt->setColor(_color);
-    } else if (qName == "slur-end") {
+    } else if (tag == SlurEndTag) {
         if (_curSlur) {
             _curNote->setSlurEnd(_curSlur);
             _curSlur->setNoteEnd(_curNote);
             _curSlur->setTimeLength(_curNote->timeStart() - _curSlur->noteStart()->timeStart());
             _curSlur = nullptr;
         }
-    } else if (qName == "phrasing-slur-start") {
+    } else if (tag == PhrasingSlurStartTag) {
         _curPhrasingSlur = new CASlur(CASlur::PhrasingSlurType, CASlur::SlurPreferred, _curNote->staff(), _curNote, nullptr);
         _curNote->setPhrasingSlurStart(_curPhrasingSlur);
-        if (!attributes.value("slur-style").isEmpty())
-            _curPhrasingSlur->setSlurStyle(CASlur::slurStyleFromString(attributes.value("slur-style")));
-        if (!attributes.value("slur-direction").isEmpty())
-            _curPhrasingSlur->setSlurDirection(CASlur::slurDirectionFromString(attributes.value("slur-direction")));
+        if (!attributes.value(QLatin1String("slur-style")).isEmpty())
+            _curPhrasingSlur->setSlurStyle(CASlur::slurStyleFromString(attributes.value(QLatin1String("slur-style")).toString()));
+        if (!attributes.value(QLatin1String("slur-direction")).isEmpty())
+            _curPhrasingSlur->setSlurDirection(CASlur::slurDirectionFromString(attributes.value(QLatin1String("slur-direction")).toString()));
         _prevMusElt = _curMusElt;
         _curMusElt = _curPhrasingSlur;
         _curMusElt->setColor(_color);
-    } else if (qName == "phrasing-slur-end") {
+    } else if (tag == PhrasingSlurEndTag) {
         if (_curPhrasingSlur) {
             _curNote->setPhrasingSlurEnd(_curPhrasingSlur);
             _curPhrasingSlur->setNoteEnd(_curNote);
             _curPhrasingSlur->setTimeLength(_curNote->timeStart() - _curPhrasingSlur->noteStart()->timeStart());
             _curPhrasingSlur = nullptr;
         }
-    } else if (qName == "tuplet") {
-        _curTuplet = new CATuplet(attributes.value("number").toInt(), attributes.value("actual-number").toInt());
+    } else if (tag == TupletTag) {
+        _curTuplet = new CATuplet(attributes.value(QLatin1String("number")).toInt(), attributes.value(QLatin1String("actual-number")).toInt());
         _curTuplet->setColor(_color);
-    } else if (qName == "rest") {
+    } else if (tag == RestTag) {
         // CARest
         if (QVersionNumber(0, 5).isPrefixOf(_version)) {
-            _curRest = new CARest(CARest::restTypeFromString(attributes.value("rest-type")),
-                CAPlayableLength(CAPlayableLength::musicLengthFromString(attributes.value("playable-length")), attributes.value("dotted").toInt()),
+            _curRest = new CARest(CARest::restTypeFromString(attributes.value(QLatin1String("rest-type")).toString()),
+                CAPlayableLength(CAPlayableLength::musicLengthFromString(attributes.value(QLatin1String("playable-length")).toString()), attributes.value(QLatin1String("dotted")).toInt()),
                 _curVoice,
-                attributes.value("time-start").toInt(),
-                attributes.value("time-length").toInt());
+                attributes.value(QLatin1String("time-start")).toInt(),
+                attributes.value(QLatin1String("time-length")).toInt());
         } else {
-            _curRest = new CARest(CARest::restTypeFromString(attributes.value("rest-type")),
+            _curRest = new CARest(CARest::restTypeFromString(attributes.value(QLatin1String("rest-type")).toString()),
                 CAPlayableLength(),
                 _curVoice,
-                attributes.value("time-start").toInt(),
-                attributes.value("time-length").toInt());
+                attributes.value(QLatin1String("time-start")).toInt(),
+                attributes.value(QLatin1String("time-length")).toInt());
         }
 
         if (_curTuplet) {
@@ -445,119 +689,111 @@ bool CACanorusMLImport::startElement(const QString&, const QString&, const QStri
 
         _curMusElt = _curRest;
         _curMusElt->setColor(_color);
-    } else if (qName == "syllable") {
+    } else if (tag == SyllableTag) {
         // CASyllable
         CASyllable* s = new CASyllable(
-            attributes.value("text"),
-            attributes.value("hyphen") == "1",
-            attributes.value("melisma") == "1",
+            attributes.value(QLatin1String("text")).toString(),
+            attributes.value(QLatin1String("hyphen")) == "1",
+            attributes.value(QLatin1String("melisma")) == "1",
             static_cast<CALyricsContext*>(_curContext),
-            attributes.value("time-start").toInt(),
-            attributes.value("time-length").toInt());
+            attributes.value(QLatin1String("time-start")).toInt(),
+            attributes.value(QLatin1String("time-length")).toInt());
         // Note: associatedVoice property is set when finishing parsing the sheet
 
         static_cast<CALyricsContext*>(_curContext)->addSyllable(s);
-        if (!attributes.value("associated-voice-idx").isEmpty())
-            _syllableMap[s] = attributes.value("associated-voice-idx").toInt();
+        if (!attributes.value(QLatin1String("associated-voice-idx")).isEmpty())
+            _syllableMap[s] = attributes.value(QLatin1String("associated-voice-idx")).toInt();
         _curMusElt = s;
         _curMusElt->setColor(_color);
-    } else if (qName == "figured-bass-mark") {
+    } else if (tag == FiguredBassMarkTag) {
         // CAFiguredBassMark
         CAFiguredBassMark* f = new CAFiguredBassMark(
             static_cast<CAFiguredBassContext*>(_curContext),
-            attributes.value("time-start").toInt(),
-            attributes.value("time-length").toInt());
+            attributes.value(QLatin1String("time-start")).toInt(),
+            attributes.value(QLatin1String("time-length")).toInt());
 
         static_cast<CAFiguredBassContext*>(_curContext)->addFiguredBassMark(f);
         _curMusElt = f;
         _curMusElt->setColor(_color);
 
-    } else if (qName == "figured-bass-number") {
+    } else if (tag == FiguredBassNumberTag) {
         // CAFiguredBassMark
         CAFiguredBassMark* f = static_cast<CAFiguredBassMark*>(_curMusElt);
-        if (attributes.value("accs").isEmpty()) {
-            f->addNumber(attributes.value("number").toInt());
+        if (attributes.value(QLatin1String("accs")).isEmpty()) {
+            f->addNumber(attributes.value(QLatin1String("number")).toInt());
         } else {
-            f->addNumber(attributes.value("number").toInt(), attributes.value("accs").toInt());
+            f->addNumber(attributes.value(QLatin1String("number")).toInt(), attributes.value(QLatin1String("accs")).toInt());
         }
 
-    } else if (qName == "function-mark" || (QVersionNumber(0, 5).isPrefixOf(_version) && qName == "function-marking")) {
+    } else if (tag == FunctionMarkTag || (QVersionNumber(0, 5).isPrefixOf(_version) && tag == FunctionMarkingTag)) {
         // CAFunctionMark
         CAFunctionMark* f = new CAFunctionMark(
-            CAFunctionMark::functionTypeFromString(attributes.value("function")),
-            (attributes.value("minor") == "1" ? true : false),
-            (QVersionNumber(0, 5).isPrefixOf(_version) ? (attributes.value("key").isEmpty() ? "C" : attributes.value("key")) : CADiatonicKey()),
+            CAFunctionMark::functionTypeFromString(attributes.value(QLatin1String("function")).toString()),
+            (attributes.value(QLatin1String("minor")) == "1" ? true : false),
+            (QVersionNumber(0, 5).isPrefixOf(_version) ? (attributes.value(QLatin1String("key")).isEmpty() ? "C" : attributes.value(QLatin1String("key")).toString()) : CADiatonicKey()),
             static_cast<CAFunctionMarkContext*>(_curContext),
-            attributes.value("time-start").toInt(),
-            attributes.value("time-length").toInt(),
-            CAFunctionMark::functionTypeFromString(attributes.value("chord-area")),
-            (attributes.value("chord-area-minor") == "1" ? true : false),
-            CAFunctionMark::functionTypeFromString(attributes.value("tonic-degree")),
-            (attributes.value("tonic-degree-minor") == "1" ? true : false),
+            attributes.value(QLatin1String("time-start")).toInt(),
+            attributes.value(QLatin1String("time-length")).toInt(),
+            CAFunctionMark::functionTypeFromString(attributes.value(QLatin1String("chord-area")).toString()),
+            (attributes.value(QLatin1String("chord-area-minor")) == "1" ? true : false),
+            CAFunctionMark::functionTypeFromString(attributes.value(QLatin1String("tonic-degree")).toString()),
+            (attributes.value(QLatin1String("tonic-degree-minor")) == "1" ? true : false),
             "",
-            (attributes.value("ellipse") == "1" ? true : false));
+            (attributes.value(QLatin1String("ellipse")) == "1" ? true : false));
 
         static_cast<CAFunctionMarkContext*>(_curContext)->addFunctionMark(f);
         _curMusElt = f;
         _curMusElt->setColor(_color);
-    } else if (qName == "chord-name") {
+    } else if (tag == ChordNameTag) {
         // CAChordName
         CAChordName* cn = new CAChordName(
             CADiatonicPitch(),
-            attributes.value("quality-modifier"),
+            attributes.value(QLatin1String("quality-modifier")).toString(),
             static_cast<CAChordNameContext*>(_curContext),
-            attributes.value("time-start").toInt(),
-            attributes.value("time-length").toInt());
+            attributes.value(QLatin1String("time-start")).toInt(),
+            attributes.value(QLatin1String("time-length")).toInt());
 
         _curMusElt = cn;
         _curMusElt->setColor(_color);
-    } else if (qName == "mark") {
+    } else if (tag == MarkTag) {
         // CAMark and subvariants
         importMark(attributes);
         _curMark->setColor(_color);
-    } else if (qName == "playable-length") {
-        CAPlayableLength pl = CAPlayableLength(CAPlayableLength::musicLengthFromString(attributes.value("music-length")), attributes.value("dotted").toInt());
-        if (_depth.top() == "mark") {
+    } else if (tag == PlayableLengthTag) {
+        CAPlayableLength pl = CAPlayableLength(CAPlayableLength::musicLengthFromString(attributes.value(QLatin1String("music-length")).toString()), attributes.value(QLatin1String("dotted")).toInt());
+        if (_depth.top() == MarkTag) {
             _curTempoPlayableLength = pl;
         } else {
             _curPlayableLength = pl;
         }
-    } else if (qName == "diatonic-pitch") {
-        _curDiatonicPitch = CADiatonicPitch(attributes.value("note-name").toInt(), attributes.value("accs").toInt());
-    } else if (qName == "diatonic-key") {
-        _curDiatonicKey = CADiatonicKey(CADiatonicPitch(), CADiatonicKey::genderFromString(attributes.value("gender")));
-    } else if (qName == "resource") {
+    } else if (tag == DiatonicPitchTag) {
+        _curDiatonicPitch = CADiatonicPitch(attributes.value(QLatin1String("note-name")).toInt(), attributes.value(QLatin1String("accs")).toInt());
+    } else if (tag == DiatonicKeyTag) {
+        _curDiatonicKey = CADiatonicKey(CADiatonicPitch(), CADiatonicKey::genderFromString(attributes.value(QLatin1String("gender")).toString()));
+    } else if (tag == ResourceTag) {
         importResource(attributes);
     }
 
-    _depth.push(qName);
+    _depth.push(tag);
     return true;
 }
 
 /*!
-	This function is called automatically by Qt SAX parser while reading the CanorusML
-	source. This function is called when a node has been closed (\</nodeName\>). Attributes
-	for closed notes are usually not set in CanorusML format. That's why we need to store
-	local node attributes (set when the node is opened) each time.
+	This function is called while reading the CanorusML source when a node with the given \a tag
+	has been closed (\</nodeName\>). Attributes for closed notes are usually not set in CanorusML
+	format. That's why we need to store local node attributes (set when the node is opened) each time.
 
 	The function returns true, if the node was successfully recognized and parsed;
 	otherwise false.
 
 	\sa startElement()
 */
-bool CACanorusMLImport::endElement(const QString&, const QString&, const QString& qName)
+bool CACanorusMLImport::endElement(CATag tag)
 {
-    if (qName == "canorus-version") {
+    if (tag == CanorusVersionTag) {
         // version of Canorus which saved the document
         _version = QVersionNumber::fromString(_cha);
-    } else if (qName == "document") {
-        //fix voice errors like shared voice elements not being present in both voices etc.
-        for (int i = 0; _document && i < _document->sheetList().size(); i++) {
-            for (int j = 0; j < _document->sheetList()[i]->staffList().size(); j++) {
-                _document->sheetList()[i]->staffList()[j]->synchronizeVoices();
-            }
-        }
-    } else if (qName == "sheet") {
+    } else if (tag == SheetTag) {
         // CASheet
         QList<CAVoice*> voices = _curSheet->voiceList();
         QList<CALyricsContext*> lcs = _lcMap.keys();
@@ -571,19 +807,25 @@ bool CACanorusMLImport::endElement(const QString&, const QString&, const QString
             }
         }
 
+        //fix voice errors like shared voice elements not being present in both voices etc.
+        for (int j = 0; j < _curSheet->staffList().size(); j++) {
+            _curSheet->staffList()[j]->synchronizeVoices();
+        }
+
         _lcMap.clear();
         _syllableMap.clear();
+        publishSheet(_curSheet); // the sheet is complete, it can be shown already
         _curSheet = nullptr;
-    } else if (qName == "staff") {
+    } else if (tag == StaffTag) {
         // CAStaff
         _curContext = nullptr;
-    } else if (qName == "voice") {
+    } else if (tag == VoiceTag) {
         // CAVoice
         _curVoice = nullptr;
     }
     // Every voice *must* contain signs on their own (eg. a clef is placed in all voices, not just the first one).
     // The following code finds a sign with the same properties at the same time in other voices. If such a sign exists, only place a pointer to this sign in the current voice. Otherwise, add a sign to all the voices read so far.
-    else if (qName == "clef") {
+    else if (tag == ClefTag) {
         // CAClef
         if (!_curContext || !_curVoice || _curContext->contextType() != CAContext::Staff) {
             return false;
@@ -609,7 +851,7 @@ bool CACanorusMLImport::endElement(const QString&, const QString&, const QString
             delete _curClef;
             _curClef = nullptr;
         }
-    } else if (qName == "key-signature") {
+    } else if (tag == KeySignatureTag) {
         // CAKeySignature
         if (!_curContext || !_curVoice || _curContext->contextType() != CAContext::Staff) {
             return false;
@@ -644,7 +886,7 @@ bool CACanorusMLImport::endElement(const QString&, const QString&, const QString
             delete _curKeySig;
             _curKeySig = nullptr;
         }
-    } else if (qName == "time-signature") {
+    } else if (tag == TimeSignatureTag) {
         // CATimeSignature
         if (!_curContext || !_curVoice || _curContext->contextType() != CAContext::Staff) {
             return false;
@@ -670,7 +912,7 @@ bool CACanorusMLImport::endElement(const QString&, const QString&, const QString
             delete _curTimeSig;
             _curTimeSig = nullptr;
         }
-    } else if (qName == "barline") {
+    } else if (tag == BarlineTag) {
         // CABarline
         if (!_curContext || !_curVoice || _curContext->contextType() != CAContext::Staff) {
             return false;
@@ -696,7 +938,7 @@ bool CACanorusMLImport::endElement(const QString&, const QString&, const QString
             delete _curBarline;
             _curBarline = nullptr;
         }
-    } else if (qName == "note") {
+    } else if (tag == NoteTag) {
         // CANote
         if (QVersionNumber(0, 5).isPrefixOf(_version)) {
         } else {
@@ -714,12 +956,12 @@ bool CACanorusMLImport::endElement(const QString&, const QString&, const QString
 
         _curNote->updateTies();
         _curNote = nullptr;
-    } else if (qName == "tie") {
+    } else if (tag == TieTag) {
         // CASlur - tie
-    } else if (qName == "tuplet") {
+    } else if (tag == TupletTag) {
         _curTuplet->assignTimes();
         _curTuplet = nullptr;
-    } else if (qName == "rest") {
+    } else if (tag == RestTag) {
         // CARest
         if (QVersionNumber(0, 5).isPrefixOf(_version)) {
         } else {
@@ -731,17 +973,17 @@ bool CACanorusMLImport::endElement(const QString&, const QString&, const QString
 
         _curVoice->append(_curRest);
         _curRest = nullptr;
-    } else if (qName == "mark") {
+    } else if (tag == MarkTag) {
         if (!QVersionNumber(0, 5).isPrefixOf(_version) && _curMark->markType() == CAMark::Tempo) {
             static_cast<CATempo*>(_curMark)->setBeat(_curTempoPlayableLength);
         }
-    } else if (qName == "function-mark") {
+    } else if (tag == FunctionMarkTag) {
         if (!QVersionNumber(0, 5).isPrefixOf(_version) && _curMusElt->musElementType() == CAMusElement::FunctionMark) {
             static_cast<CAFunctionMark*>(_curMusElt)->setKey(_curDiatonicKey);
         }
-    } else if (qName == "diatonic-key") {
+    } else if (tag == DiatonicKeyTag) {
         _curDiatonicKey.setDiatonicPitch(_curDiatonicPitch);
-    } else if (qName == "chord-name") {
+    } else if (tag == ChordNameTag) {
         CAChordName* cn = static_cast<CAChordName*>(_curMusElt);
         cn->setDiatonicPitch(_curDiatonicPitch);
         static_cast<CAChordNameContext*>(_curContext)->addChordName(cn);
@@ -757,93 +999,73 @@ bool CACanorusMLImport::endElement(const QString&, const QString&, const QString
     return true;
 }
 
-/*!
-	Stores the characters between the greater-lesser signs while parsing the XML file.
-	This is usually needed for getting the property values stored not as node attributes,
-	but between greater-lesser signs.
-
-	eg.
-	\code
-		<length>127</length>
-	\endcode
-	Would set _cha value to "127".
-
-	\sa startElement(), endElement()
-*/
-bool CACanorusMLImport::characters(const QString& ch)
-{
-    _cha = ch;
-
-    return true;
-}
-
-void CACanorusMLImport::importMark(const QXmlAttributes& attributes)
+void CACanorusMLImport::importMark(const QXmlStreamAttributes& attributes)
 {
-    CAMark::CAMarkType type = CAMark::markTypeFromString(attributes.value("mark-type"));
+    CAMark::CAMarkType type = CAMark::markTypeFromString(attributes.value(QLatin1String("mark-type")).toString());
     _curMark = nullptr;
 
     switch (type) {
     case CAMark::Text: {
         _curMark = new CAText(
-            attributes.value("text"),
+            attributes.value(QLatin1String("text")).toString(),
             static_cast<CAPlayable*>(_curMusElt));
         break;
     }
     case CAMark::Tempo: {
         if (QVersionNumber(0, 5).isPrefixOf(_version)) {
             _curMark = new CATempo(
-                CAPlayableLength(CAPlayableLength::musicLengthFromString(attributes.value("beat")), attributes.value("beat-dotted").toInt()),
-                static_cast<unsigned char>(attributes.value("bpm").toUInt()),
+                CAPlayableLength(CAPlayableLength::musicLengthFromString(attributes.value(QLatin1String("beat")).toString()), attributes.value(QLatin1String("beat-dotted")).toInt()),
+                static_cast<unsigned char>(attributes.value(QLatin1String("bpm")).toUInt()),
                 _curMusElt);
         } else {
             _curMark = new CATempo(
                 CAPlayableLength(),
-                static_cast<unsigned char>(attributes.value("bpm").toUInt()),
+                static_cast<unsigned char>(attributes.value(QLatin1String("bpm")).toUInt()),
                 _curMusElt);
         }
         break;
     }
     case CAMark::Ritardando: {
         _curMark = new CARitardando(
-            attributes.value("final-tempo").toInt(),
+            attributes.value(QLatin1String("final-tempo")).toInt(),
             static_cast<CAPlayable*>(_curMusElt),
-            attributes.value("time-length").toInt(),
-            CARitardando::ritardandoTypeFromString(attributes.value("ritardando-type")));
+            attributes.value(QLatin1String("time-length")).toInt(),
+            CARitardando::ritardandoTypeFromString(attributes.value(QLatin1String("ritardando-type")).toString()));
         break;
     }
     case CAMark::Dynamic: {
         _curMark = new CADynamic(
-            attributes.value("text"),
-            attributes.value("volume").toInt(),
+            attributes.value(QLatin1String("text")).toString(),
+            attributes.value(QLatin1String("volume")).toInt(),
             static_cast<CANote*>(_curMusElt));
         break;
     }
     case CAMark::Crescendo: {
         _curMark = new CACrescendo(
-            attributes.value("final-volume").toInt(),
+            attributes.value(QLatin1String("final-volume")).toInt(),
             static_cast<CANote*>(_curMusElt),
-            CACrescendo::crescendoTypeFromString(attributes.value("crescendo-type")),
-            attributes.value("time-start").toInt(),
-            attributes.value("time-length").toInt());
+            CACrescendo::crescendoTypeFromString(attributes.value(QLatin1String("crescendo-type")).toString()),
+            attributes.value(QLatin1String("time-start")).toInt(),
+            attributes.value(QLatin1String("time-length")).toInt());
         break;
     }
     case CAMark::Pedal: {
         _curMark = new CAMark(
             CAMark::Pedal,
             _curMusElt,
-            attributes.value("time-start").toInt(),
-            attributes.value("time-length").toInt());
+            attributes.value(QLatin1String("time-start")).toInt(),
+            attributes.value(QLatin1String("time-length")).toInt());
         break;
     }
     case CAMark::InstrumentChange: {
         _curMark = new CAInstrumentChange(
-            attributes.value("instrument").toInt(),
+            attributes.value(QLatin1String("instrument")).toInt(),
             static_cast<CANote*>(_curMusElt));
         break;
     }
     case CAMark::BookMark: {
         _curMark = new CABookMark(
-            attributes.value("text"),
+            attributes.value(QLatin1String("text")).toString(),
             _curMusElt);
         break;
     }
@@ -857,36 +1079,36 @@ void CACanorusMLImport::importMark(const QXmlAttributes& attributes)
         if (_curMusElt->isPlayable()) {
             _curMark = new CAFermata(
                 static_cast<CAPlayable*>(_curMusElt),
-                CAFermata::fermataTypeFromString(attributes.value("fermata-type")));
+                CAFermata::fermataTypeFromString(attributes.value(QLatin1String("fermata-type")).toString()));
         } else if (_curMusElt->musElementType() == CAMusElement::Barline) {
             _curMark = new CAFermata(
                 static_cast<CABarline*>(_curMusElt),
-                CAFermata::fermataTypeFromString(attributes.value("fermata-type")));
+                CAFermata::fermataTypeFromString(attributes.value(QLatin1String("fermata-type")).toString()));
         }
         break;
     }
     case CAMark::RepeatMark: {
         _curMark = new CARepeatMark(
             static_cast<CABarline*>(_curMusElt),
-            CARepeatMark::repeatMarkTypeFromString(attributes.value("repeat-mark-type")),
-            attributes.value("volta-number").toInt());
+            CARepeatMark::repeatMarkTypeFromString(attributes.value(QLatin1String("repeat-mark-type")).toString()),
+            attributes.value(QLatin1String("volta-number")).toInt());
         break;
     }
     case CAMark::Articulation: {
         _curMark = new CAArticulation(
-            CAArticulation::articulationTypeFromString(attributes.value("articulation-type")),
+            CAArticulation::articulationTypeFromString(attributes.value(QLatin1String("articulation-type")).toString()),
             static_cast<CANote*>(_curMusElt));
         break;
     }
     case CAMark::Fingering: {
         QList<CAFingering::CAFingerNumber> fingers;
         for (int i = 0; !attributes.value(QString("finger%1").arg(i)).isEmpty(); i++)
-            fingers << CAFingering::fingerNumberFromString(attributes.value(QString("finger%1").arg(i)));
+            fingers << CAFingering::fingerNumberFromString(attributes.value(QString("finger%1").arg(i)).toString());
 
         _curMark = new CAFingering(
             fingers,
             static_cast<CANote*>(_curMusElt),
-            attributes.value("original").toInt());
+            attributes.value(QLatin1String("original")).toInt());
         break;
     }
     case CAMark::Undefined:
@@ -901,15 +1123,15 @@ void CACanorusMLImport::importMark(const QXmlAttributes& attributes)
 /*!
 	Imports the current resource.
  */
-void CACanorusMLImport::importResource(const QXmlAttributes& attributes)
+void CACanorusMLImport::importResource(const QXmlStreamAttributes& attributes)
 {
-    bool isLinked = attributes.value("linked").toInt();
+    bool isLinked = attributes.value(QLatin1String("linked")).toInt();
 
     std::shared_ptr<CAResource> r;
-    QUrl url = attributes.value("url");
-    QString name = attributes.value("name");
-    QString description = attributes.value("description");
-    CAResource::CAResourceType type = CAResource::resourceTypeFromString(attributes.value("resource-type"));
+    QUrl url = attributes.value(QLatin1String("url")).toString();
+    QString name = attributes.value(QLatin1String("name")).toString();
+    QString description = attributes.value(QLatin1String("description")).toString();
+    CAResource::CAResourceType type = CAResource::resourceTypeFromString(attributes.value(QLatin1String("resource-type")).toString());
     QString rUrl = url.toString();
 
     if (!isLinked && file()) {
@@ -927,16 +1149,15 @@ void CACanorusMLImport::importResource(const QXmlAttributes& attributes)
 
 /*!
 	\var CACanorusMLImport::_cha
-	Current characters being read using characters() method between the greater/lesser
-	separators in XML file.
+	Current characters being read between the greater/lesser separators in XML file.
 
-	\sa characters()
+	\sa importDocumentImpl()
 */
 
 /*!
 	\var CACanorusMLImport::_depth
-	Stack which represents the current depth of the document while SAX parsing. It contains
-	the tag names as the values.
+	Stack which represents the current depth of the document while parsing. It contains
+	the tags of the opened nodes as the values.
 
 	\sa startElement(), endElement()
 */
@@ -945,7 +1166,7 @@ void CACanorusMLImport::importResource(const QXmlAttributes& attributes)
 	\var CACanorusMLImport::_errorMsg
 	The error message content stored as QString, if the error happens.
 
-	\sa fatalError()
+	\sa importDocumentImpl()
 */
 
 /*!
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2009, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -12,7 +12,7 @@
 #include <QHash>
 #include <QStack>
 #include <QVersionNumber>
-#include <QXmlDefaultHandler>
+#include <QXmlStreamReader>
 
 #include "import/import.h"
 
@@ -32,8 +32,9 @@ class CASyllable;
 class CAMusElement;
 class CAMark;
 class CATuplet;
+class CABinaryMLReader;
 
-class CACanorusMLImport : public CAImport, public QXmlDefaultHandler {
+class CACanorusMLImport : public CAImport, private QXmlStreamReader {
 public:
     CACanorusMLImport(QTextStream* stream = 0);
     CACanorusMLImport(const QString stream);
@@ -42,24 +43,67 @@ public:
     void initCanorusMLImport();
 
     CADocument* importDocumentImpl();
+    const QString readableStatus();
 
-    bool startElement(const QString& namespaceURI, const QString& localName, const QString& qName,
-        const QXmlAttributes& attributes);
-    bool endElement(const QString& namespaceURI, const QString& localName,
-        const QString& qName);
-    bool fatalError(const QXmlParseException& exception);
-    bool characters(const QString& ch);
+    inline bool lazySheets() { return _lazySheets; }
+    inline void setLazySheets(bool lazy) { _lazySheets = lazy; }
+    static void importSheetContent(CASheet* sheet, const QByteArray& content, const QVector<QString>& strings, const QVersionNumber& version);
 
 private:
-    void importMark(const QXmlAttributes& attributes);
-    void importResource(const QXmlAttributes& attributes);
+    enum CATag {
+        UndefinedTag,
+        BarlineTag,
+        CanorusVersionTag,
+        ChordNameTag,
+        ChordNameContextTag,
+        ClefTag,
+        DiatonicKeyTag,
+        DiatonicPitchTag,
+        DocumentTag,
+        FiguredBassContextTag,
+        FiguredBassMarkTag,
+        FiguredBassNumberTag,
+        FunctionMarkTag,
+        FunctionMarkContextTag,
+        FunctionMarkingTag,
+        FunctionMarkingContextTag,
+        KeySignatureTag,
+        LyricsContextTag,
+        MarkTag,
+        NoteTag,
+        PhrasingSlurEndTag,
+        PhrasingSlurStartTag,
+        PlayableLengthTag,
+        ResourceTag,
+        RestTag,
+        SheetTag,
+        SlurEndTag,
+        SlurStartTag,
+        StaffTag,
+        SyllableTag,
+        TieTag,
+        TimeSignatureTag,
+        TupletTag,
+        VoiceTag
+    };
+    static CATag tagFromName(const QStringRef& name);
+
+    CADocument* importBinaryDocument(QIODevice* device);
+    void readBinary(CABinaryMLReader& reader);
+
+    bool startElement(CATag tag, const QXmlStreamAttributes& attributes);
+    bool endElement(CATag tag);
+    void importMark(const QXmlStreamAttributes& attributes);
+    void importResource(const QXmlStreamAttributes& attributes);
 
     inline CADocument* document() { return _document; }
     CADocument* _document;
 
     QVersionNumber _version; // version of Canorus the imported file was created with
     QString _errorMsg;
-    QStack<QString> _depth;
+    bool _binary; // is the source in binary CanorusML
+    bool _lazySheets; // leave the sheets of binary CanorusML unloaded
+    QStack<CATag> _depth;
 
     // Pointers to the current elements when reading the XML file
     CASheet* _curSheet;
@@ -1,11 +1,12 @@
 /*!
-	Copyright (c) 2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 	
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
 */
 
 #include "import/import.h"
+#include "core/trace.h"
 #include <QTextStream>
 
 /*!
@@ -24,7 +25,12 @@
 	
 	Optionally:
 	Developer should change the current status and progress while operations are in progress. He should
-	also rewrite the readableStatus() function.
+	also rewrite the readableStatus() function. Long operations should check isCanceled() at coarse
+	points (eg. after each sheet or part) and return early, the CANCELED status is then set
+	automatically.
+
+	Filters which read the document sheet by sheet should call publishSheet() for each completely
+	read sheet, so the user interface can show it before the whole document is imported.
 	
 	The following example illustrates the usage of import class:
 	\code
@@ -88,7 +94,7 @@ CAImport::~CAImport()
 
 /*!
 	Extends CAFile::setStreamFromFile by storing the filename in a public variable
-	for use in the pmidi midi file parser.
+	for use in the midi file reader.
 */
 void CAImport::setStreamFromFile(const QString filename)
 {
@@ -108,6 +114,8 @@ QString CAImport::fileName()
 */
 void CAImport::run()
 {
+    CA_TRACE_ZONE(metaObject()->className());
+    startProgress();
     if (!stream()) {
         setStatus(-1);
     } else {
@@ -152,15 +160,34 @@ void CAImport::run()
             break;
         }
 
-        if (status() > 0) { // error - bad implemented filter
+        if (isCanceled()) {
+            setStatus(CANCELED);
+        } else if (status() > 0) { // error - bad implemented filter
             // job is finished but status is still marked as working, set to Ready to prevent infinite loops
             setStatus(0);
         }
+        if (status() == 0) {
+            finishProgress();
+        }
     }
 
     emit importDone(status());
 }
 
+/*!
+	Tells the listeners the given \a sheet of the document being imported is completely read.
+
+	The filter must not change the sheet after calling this function, because the sheet may already
+	be shown in the main thread while the rest of the document is imported. sheetPublished() is
+	emitted from the import thread, so the receivers should use queued connections.
+
+	\sa sheetPublished()
+*/
+void CAImport::publishSheet(CASheet* sheet)
+{
+    emit sheetPublished(sheet);
+}
+
 void CAImport::importDocument()
 {
     setImportPart(Document);
@@ -212,6 +239,8 @@ const QString CAImport::readableStatus()
         return tr("Ready");
     case -1:
         return tr("Unable to open file for reading");
+    case CANCELED:
+        return tr("Canceled");
     }
     return "Ready";
 }
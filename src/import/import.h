@@ -53,10 +53,13 @@ signals:
     void lyricsContextImported(CALyricsContext*);
     void functionMarkContextImported(CAFunctionMarkContext*);
 
+    void sheetPublished(CASheet*);
     void importDone(int status);
 #endif
 
 protected:
+    void publishSheet(CASheet* sheet);
+
     virtual CADocument* importDocumentImpl()
     {
         setStatus(0);
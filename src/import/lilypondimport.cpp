@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -17,26 +17,18 @@
 #include "score/sheet.h"
 #include "score/slur.h"
 
-/*!
-	Delimiters which separate various music elements in LilyPond syntax. These are new lines, tabs, blanks etc.
-
-	\sa nextElement(), parseNextElement()
-*/
-const QRegExp CALilyPondImport::WHITESPACE_DELIMITERS = QRegExp("[\\s]");
+namespace {
 
 /*!
-	Delimiters which separate various music elements in LilyPond syntax, but are specific for LilyPond syntax.
-	They are reported as its own element when parsing the next element.
-
-	\sa nextElement(), parseNextElement()
+	Returns True, if the given character separates the music elements in LilyPond syntax and is
+	reported as its own element.
 */
-const QRegExp CALilyPondImport::SYNTAX_DELIMITERS = QRegExp("[<>{}]");
+inline bool isSyntaxDelimiter(QChar c)
+{
+    return (c == '<' || c == '>' || c == '{' || c == '}');
+}
 
-/*!
-	Combined WHITESPACE_DELIMITERS and SYNTAX_DELIMITERS.
-*/
-const QRegExp CALilyPondImport::DELIMITERS = QRegExp(
-    CALilyPondImport::WHITESPACE_DELIMITERS.pattern().left(CALilyPondImport::WHITESPACE_DELIMITERS.pattern().size() - 1) + CALilyPondImport::SYNTAX_DELIMITERS.pattern().mid(1));
+}
 
 CALilyPondImport::CALilyPondImport(const QString in)
     : CAImport(in)
@@ -64,11 +56,24 @@ CALilyPondImport::~CALilyPondImport()
 void CALilyPondImport::initLilyPondImport()
 {
     _curLine = _curChar = 0;
+    _inPos = _linePos = _countedPos = 0;
+    _peekPos = -1;
     _curSlur = nullptr;
     _curPhrasingSlur = nullptr;
     _templateVoice = nullptr;
 }
 
+/*!
+	Starts reading the input from the beginning.
+*/
+void CALilyPondImport::resetInput()
+{
+    _curLine = 1;
+    _curChar = 0;
+    _inPos = _linePos = _countedPos = 0;
+    _peekPos = -1;
+}
+
 void CALilyPondImport::addError(QString description, int curLine, int curChar)
 {
     _errors << QString(QObject::tr("<i>Fatal error, line %1, char %2:</i><br>"))
@@ -97,8 +102,9 @@ CASheet* CALilyPondImport::importSheetImpl()
 
     bool changed = false;
 
+    resetInput();
     for (QString curElt = parseNextElement();
-         (!in().isEmpty());
+         (!atEnd() && !isCanceled());
          curElt = ((curElt.size() && changed) ? curElt : parseNextElement())) { // go to next element, if current one is empty or not changed
         if (curElt.startsWith("\\header")) {
             std::cout << "lilyimport header" << std::endl;
@@ -124,8 +130,9 @@ CAVoice* CALilyPondImport::importVoiceImpl()
     bool chordCreated = false;
     bool changed = false;
 
+    resetInput();
     for (QString curElt = parseNextElement();
-         (!in().isEmpty());
+         (!atEnd() && !isCanceled());
          curElt = ((curElt.size() && changed) ? curElt : parseNextElement())) { // go to next element, if current one is empty or not changed
         changed = true; // changed is default to true and false, if none of if clauses were found
         if (curElt.startsWith("\\relative")) {
@@ -354,7 +361,8 @@ CALyricsContext* CALilyPondImport::importLyricsContextImpl()
 
     CASyllable* lastSyllable = nullptr;
     int timeSDummy = 0; // dummy timestart to keep the order of inserted syllables. Real timeStarts are sets when repositSyllables() is called
-    for (QString curElt = parseNextElement(); (!in().isEmpty() || !curElt.isEmpty()); curElt = parseNextElement(), timeSDummy++) {
+    resetInput();
+    for (QString curElt = parseNextElement(); (!atEnd() || !curElt.isEmpty()); curElt = parseNextElement(), timeSDummy++) {
         QString text = curElt;
         if (curElt == "_")
             text = "";
@@ -384,87 +392,90 @@ CALyricsContext* CALilyPondImport::importLyricsContextImpl()
 }
 
 /*!
-	Returns the first element in input stream ended with one of the delimiters and shorten input stream for the element.
+	Returns the next element in the input and moves the input position after it. Elements are
+	separated by whitespaces. Syntax delimiters <, >, { and } are returned as their own elements.
+	Comments are skipped. An empty string is returned at the end of the input.
+
+	The input is read in a single pass and is not changed. The line and the character of the returned
+	element are stored for the error reports.
 
-	\todo Only one-character syntax delimiters are supported so far.
 	\sa peekNextElement()
 */
 const QString CALilyPondImport::parseNextElement()
 {
-    // find the first non-whitespace character
-    int start = in().indexOf(QRegExp("\\S"));
-    if (start == -1) {
-        start = 0;
-    } else if (in().mid(start, 1) == "%") {
-        // handle comments
-        start = in().indexOf(QRegExp("[\n\r]"), start);
-        if (start == -1) {
-            start = in().size();
-        } else {
-            start = in().indexOf(QRegExp("\\S"), start);
-            if (start == -1) {
-                start = in().size();
-            }
-        }
-    }
-
-    int i = in().indexOf(DELIMITERS, start);
-    if (i == -1) {
-        i = in().size();
+    int start, end;
+    if (_peekPos == _inPos) {
+        start = _peekStart;
+        end = _peekEnd;
+    } else {
+        findNextElement(_inPos, start, end);
     }
+    _peekPos = -1;
 
-    QString ret;
-    if (i == start) {
-        // syntax delimiter only
-        ret = in().mid(start, 1); /// \todo Support for syntax delimiters longer than 1 character
-        in().remove(0, start + 1);
-    } else {
-        // ordinary whitespace/syntax delimiter
-        ret = in().mid(start, i - start);
-        in().remove(0, i);
+    const QString& input = in();
+    for (int i = _countedPos; i < start; i++) {
+        if (input[i] == '\n') {
+            _curLine++;
+            _linePos = i + 1;
+        }
     }
+    _countedPos = start;
+    _curChar = start - _linePos + 1;
 
-    return ret;
+    _inPos = end;
+    setProgress(_inPos, input.size(), CAProgress::Bytes); // characters of the source
+    return input.mid(start, end - start);
 }
 
 /*!
-	Returns the first element in input stream ended with one of the delimiters but don't shorten the stream.
+	Returns the next element in the input but doesn't move the input position. The element is
+	remembered, so the following parseNextElement() doesn't scan the input again.
 
 	\sa parseNextElement()
 */
 const QString CALilyPondImport::peekNextElement()
 {
-    // find the first non-whitespace character
-    int start = in().indexOf(QRegExp("\\S"));
-    if (start == -1) {
-        start = 0;
-    } else if (in().mid(start, 1) == "%") {
-        // handle comments
-        start = in().indexOf(QRegExp("[\n\r]"), start);
-        if (start == -1) {
-            start = in().size();
-        } else {
-            start = in().indexOf(QRegExp("\\S"), start);
-            if (start == -1) {
-                start = in().size();
+    if (_peekPos != _inPos) {
+        findNextElement(_inPos, _peekStart, _peekEnd);
+        _peekPos = _inPos;
+    }
+
+    return in().mid(_peekStart, _peekEnd - _peekStart);
+}
+
+/*!
+	Finds the bounds \a start and \a end of the first element in the input at or after \a pos.
+*/
+void CALilyPondImport::findNextElement(int pos, int& start, int& end)
+{
+    const QString& input = in();
+    const int size = input.size();
+
+    start = pos;
+    while (true) {
+        while (start < size && input[start].isSpace()) {
+            start++;
+        }
+
+        if (start < size && input[start] == '%') {
+            // comment until the end of line
+            while (start < size && input[start] != '\n' && input[start] != '\r') {
+                start++;
             }
+        } else {
+            break;
         }
     }
 
-    int i = in().indexOf(DELIMITERS, start);
-    if (i == -1)
-        i = in().size();
-
-    QString ret;
-    if (i == start) {
-        // syntax delimiter only
-        ret = in().left(1); /// \todo
-    } else {
-        // ordinary whitespace/syntax delimiter
-        ret = in().mid(start, i - start);
+    end = start;
+    if (end < size && isSyntaxDelimiter(input[end])) {
+        end++;
+        return;
     }
 
-    return ret;
+    while (end < size && !input[end].isSpace() && !isSyntaxDelimiter(input[end])) {
+        end++;
+    }
 }
 
 /*!
@@ -504,7 +515,7 @@ CAMusElement* CALilyPondImport::findSharedElement(CAMusElement* elt)
 */
 bool CALilyPondImport::isNote(const QString elt)
 {
-    return QString(elt[0]).contains(QRegExp("[a-g]"));
+    return (!elt.isEmpty() && elt[0] >= 'a' && elt[0] <= 'g');
 }
 
 /*!
@@ -514,7 +525,7 @@ bool CALilyPondImport::isNote(const QString elt)
 */
 bool CALilyPondImport::isRest(const QString elt)
 {
-    return (elt[0] == 'r' || elt[0] == 's' || elt[0] == 'R');
+    return (!elt.isEmpty() && (elt[0] == 'r' || elt[0] == 's' || elt[0] == 'R'));
 }
 
 /*!
@@ -582,8 +593,10 @@ CAPlayableLength CALilyPondImport::playableLengthFromLilyPond(QString& elt, bool
     CAPlayableLength ret;
 
     // index of the first number
-    int start = elt.indexOf(QRegExp("[\\d]"));
-    if (start == -1) // no length written
+    int start = 0;
+    while (start < elt.size() && !elt[start].isDigit())
+        start++;
+    if (start == elt.size()) // no length written
         return ret;
     else { // length written
         // count dots
@@ -594,10 +607,10 @@ CAPlayableLength CALilyPondImport::playableLengthFromLilyPond(QString& elt, bool
              i++, ret.setDotted(ret.dotted() + 1))
             ;
 
-        if (dStart == -1)
-            dStart = elt.indexOf(QRegExp("[\\D]"), start);
-        if (dStart == -1)
-            dStart = elt.size();
+        if (dStart == -1) {
+            for (dStart = start; dStart < elt.size() && elt[dStart].isDigit(); dStart++)
+                ;
+        }
 
         ret.setMusicLength(static_cast<CAPlayableLength::CAMusicLength>(elt.mid(start, dStart - start).toInt()));
         if (parse)
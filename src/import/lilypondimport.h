@@ -47,10 +47,6 @@ public:
 private:
     void initLilyPondImport();
 
-    static const QRegExp WHITESPACE_DELIMITERS;
-    static const QRegExp SYNTAX_DELIMITERS;
-    static const QRegExp DELIMITERS;
-
     // Internal time signature
     struct CATime {
         int beats;
@@ -73,6 +69,8 @@ private:
 
     const QString parseNextElement();
     const QString peekNextElement();
+    void findNextElement(int pos, int& start, int& end);
+    void resetInput();
     void addError(QString description, int lineError = 0, int charError = 0);
 
     //////////////////////
@@ -96,6 +94,7 @@ private:
     // Getter/Setter methods //
     ///////////////////////////
     inline QString& in() { return *stream()->string(); }
+    inline bool atEnd() { return _inPos >= in().size(); }
     inline CALilyPondDepth curDepth() { return _depth.top(); }
     inline void pushDepth(CALilyPondDepth depth) { _depth.push(depth); }
     inline CALilyPondDepth popDepth() { return _depth.pop(); }
@@ -108,6 +107,10 @@ private:
     CASlur* _curPhrasingSlur;
     QStack<CALilyPondDepth> _depth; // which block is currently processed
     int _curLine, _curChar;
+    int _inPos; // position of the next element in the input
+    int _linePos; // position of the first character of the current line
+    int _countedPos; // position up to which the lines were counted
+    int _peekPos, _peekStart, _peekEnd; // element found by the last peekNextElement() call at _peekPos, or -1
     QList<QString> _errors;
     QList<QString> _warnings;
 
@@ -0,0 +1,354 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#include <QFile>
+#include <QObject>
+
+#include "import/midifilereader.h"
+
+#include "core/taskscheduler.h"
+
+#include <algorithm>
+
+const int CAMidiFileReader::MIN_PARALLEL_SIZE = 64 * 1024;
+
+namespace {
+
+const int MIDI_HEADER_SIZE = 14; // "MThd", length and the 6 bytes of format, tracks and division
+const int CHUNK_HEADER_SIZE = 8; // chunk id and length
+
+inline quint32 readInt(const uchar* p, int n)
+{
+    quint32 val = 0;
+    for (int i = 0; i < n; i++) {
+        val = (val << 8) | p[i];
+    }
+    return val;
+}
+
+/*!
+	Reads a variable length quantity at \a p and moves \a p after it.
+	Returns False, if the quantity is not finished before \a end.
+*/
+inline bool readVar(const uchar*& p, const uchar* end, int& val)
+{
+    val = 0;
+    for (int i = 0; i < 4; i++) {
+        if (p >= end) {
+            return false;
+        }
+        uchar c = *p++;
+        val = (val << 7) | (c & 0x7f);
+        if (!(c & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool timeLess(const CAMidiFileEvent& a, const CAMidiFileEvent& b)
+{
+    return a.time < b.time;
+}
+
+}
+
+/*!
+	\class CAMidiFileTrack
+	\brief A single MTrk chunk decoded in the task scheduler
+
+	The events of the track are written into a flat array in the order of the file. Note on and
+	note off events are paired into a single Note event with its length, pmidi-style: a note off
+	finishes the last started note of the same pitch and channel and the notes left sounding are
+	finished at the end of the track.
+
+	Tempo, time signature and key signature events are collected separately, because they form
+	the tempo map of the whole file.
+*/
+class CAMidiFileTrack : public CATask {
+public:
+    CAMidiFileTrack(const uchar* begin, const uchar* end)
+        : CATask(CATask::Normal)
+        , _begin(begin)
+        , _end(end)
+    {
+    }
+
+    void run();
+
+    inline const QVector<CAMidiFileEvent>& events() const { return _events; }
+    inline const QVector<CAMidiFileEvent>& tempoMap() const { return _tempoMap; }
+    inline const QString& errorString() const { return _errorString; }
+
+private:
+    void readMeta(int time, int type, const uchar* data, int length);
+
+    const uchar* _begin;
+    const uchar* _end;
+    QVector<CAMidiFileEvent> _events;
+    QVector<CAMidiFileEvent> _tempoMap;
+    QString _errorString;
+};
+
+void CAMidiFileTrack::run()
+{
+    const uchar* p = _begin;
+    int time = 0;
+    int status = 0;
+    QVector<QVector<int>> openNotes(16 * 128); // indices of the sounding notes by channel and pitch
+
+    while (p < _end && _errorString.isEmpty()) {
+        int delta;
+        if (!readVar(p, _end, delta) || p >= _end) {
+            _errorString = QObject::tr("Unexpected end of track");
+            break;
+        }
+        time += delta;
+
+        if (*p & 0x80) {
+            status = *p++;
+        } else if (!status) {
+            _errorString = QObject::tr("Bad status type 0x%1").arg(static_cast<int>(*p), 0, 16);
+            break;
+        } // otherwise running status
+
+        int channel = status & 0x0f;
+        int dataLength = ((status & 0xf0) == 0xc0 || (status & 0xf0) == 0xd0) ? 1 : 2;
+        if (status < 0xf0 && _end - p < dataLength) {
+            _errorString = QObject::tr("Unexpected end of track");
+            break;
+        }
+
+        switch (status & 0xf0) {
+        case 0x80:
+        case 0x90: {
+            int pitch = p[0] & 0x7f;
+            int velocity = p[1] & 0x7f;
+            QVector<int>& open = openNotes[channel * 128 + pitch];
+            if ((status & 0xf0) == 0x90 && velocity) {
+                open << _events.size();
+                CAMidiFileEvent e = { time, CAMidiFileEvent::Note, channel, pitch, velocity, -1 };
+                _events << e;
+            } else if (!open.isEmpty()) {
+                CAMidiFileEvent& e = _events[open.takeLast()];
+                e.length = time - e.time;
+            }
+            break;
+        }
+        case 0xb0: {
+            CAMidiFileEvent e = { time, CAMidiFileEvent::Control, channel, p[0] & 0x7f, p[1] & 0x7f, 0 };
+            _events << e;
+            break;
+        }
+        case 0xc0: {
+            CAMidiFileEvent e = { time, CAMidiFileEvent::Program, channel, p[0] & 0x7f, 0, 0 };
+            _events << e;
+            break;
+        }
+        case 0xa0: // key pressure, channel pressure and pitch wheel are not needed
+        case 0xd0:
+        case 0xe0:
+            break;
+        case 0xf0: {
+            int type = -1;
+            if (status == 0xff) {
+                if (p >= _end) {
+                    _errorString = QObject::tr("Unexpected end of track");
+                    break;
+                }
+                type = *p++;
+                if (type == 0x2f) { // end of track, skip the rest of the chunk
+                    p = _end;
+                    break;
+                }
+            }
+
+            int length;
+            if (!readVar(p, _end, length) || length > _end - p) {
+                _errorString = QObject::tr("Unexpected end of track");
+                break;
+            }
+            if (type != -1) {
+                readMeta(time, type, p, length);
+            } // system exclusive messages are skipped
+            p += length;
+            dataLength = 0;
+            status = 0; // meta and system exclusive events cancel the running status
+            break;
+        }
+        }
+
+        if (status < 0xf0) {
+            p += dataLength;
+        }
+    }
+
+    // finish the notes left sounding
+    for (const QVector<int>& open : openNotes) {
+        for (int i : open) {
+            _events[i].length = time - _events[i].time;
+        }
+    }
+}
+
+void CAMidiFileTrack::readMeta(int time, int type, const uchar* data, int length)
+{
+    switch (type) {
+    case 0x51: // tempo
+        if (length >= 3 && readInt(data, 3)) {
+            CAMidiFileEvent e = { time, CAMidiFileEvent::Tempo, 0, static_cast<int>(readInt(data, 3)), 0, 0 };
+            _tempoMap << e;
+        }
+        break;
+    case 0x58: // time signature
+        if (length >= 2 && data[1] < 16) {
+            CAMidiFileEvent e = { time, CAMidiFileEvent::TimeSignature, 0, data[0], 1 << data[1], 0 };
+            _tempoMap << e;
+        }
+        break;
+    case 0x59: // key signature
+        if (length >= 2) {
+            CAMidiFileEvent e = { time, CAMidiFileEvent::KeySignature, 0, static_cast<signed char>(data[0]), (data[1] == 1) ? 1 : 0, 0 };
+            _tempoMap << e;
+        }
+        break;
+    }
+}
+
+/*!
+	\class CAMidiFileReader
+	\brief Reader of Standard MIDI files
+
+	Reads a MIDI file of format 0, 1 or 2 into a flat array of events per track, see tracks().
+	The track chunks are located first and then decoded in parallel in the task scheduler, unless the
+	file is smaller than MIN_PARALLEL_SIZE. The reader keeps no global state, so many files can be
+	read at the same time, for example by the batch conversion.
+
+	The first track returned is the tempo map with the tempo, time signature and key signature
+	events of all the tracks sorted by time. Use events() to get all the events ordered by time as
+	they are played.
+
+	Only the events needed by CAMidiImport are kept: notes with their lengths, controllers,
+	programs and the tempo map. Other events are skipped.
+*/
+
+CAMidiFileReader::CAMidiFileReader()
+    : _format(0)
+    , _timeBase(0)
+{
+}
+
+/*!
+	Reads the MIDI file with the given \a fileName.
+	Returns True on success. Otherwise returns False and sets errorString().
+*/
+bool CAMidiFileReader::read(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        _tracks.clear();
+        _errorString = QObject::tr("Could not open file %1").arg(fileName);
+        return false;
+    }
+
+    return read(file.readAll());
+}
+
+/*!
+	Reads the MIDI file contents from \a data.
+	Returns True on success. Otherwise returns False and sets errorString().
+*/
+bool CAMidiFileReader::read(const QByteArray& data)
+{
+    _data = data;
+    _tracks.clear();
+    _errorString.clear();
+
+    const uchar* begin = reinterpret_cast<const uchar*>(_data.constData());
+    const uchar* end = begin + _data.size();
+
+    if (_data.size() < MIDI_HEADER_SIZE || _data.left(4) != "MThd") {
+        _errorString = QObject::tr("Bad header, probably not a real midi file");
+        return false;
+    }
+
+    quint32 headerLength = readInt(begin + 4, 4);
+    if (headerLength < 6 || headerLength > static_cast<quint32>(_data.size() - CHUNK_HEADER_SIZE)) {
+        _errorString = QObject::tr("Bad header length, probably not a real midi file");
+        return false;
+    }
+
+    _format = readInt(begin + 8, 2);
+    int trackCount = readInt(begin + 10, 2);
+    _timeBase = readInt(begin + 12, 2);
+    if (!_timeBase) {
+        _errorString = QObject::tr("Bad time base, probably not a real midi file");
+        return false;
+    }
+
+    // locate the track chunks, unknown chunks are skipped
+    QList<CAMidiFileTrack*> tracks;
+    const uchar* p = begin + CHUNK_HEADER_SIZE + headerLength;
+    while (tracks.size() < trackCount && end - p >= CHUNK_HEADER_SIZE) {
+        quint32 length = readInt(p + 4, 4);
+        const uchar* chunkEnd = (length > static_cast<quint32>(end - p - CHUNK_HEADER_SIZE)) ? end : p + CHUNK_HEADER_SIZE + length;
+        if (!qstrncmp(reinterpret_cast<const char*>(p), "MTrk", 4)) {
+            tracks << new CAMidiFileTrack(p + CHUNK_HEADER_SIZE, chunkEnd);
+        }
+        p = chunkEnd;
+    }
+
+    if (tracks.size() > 1 && _data.size() >= MIN_PARALLEL_SIZE) {
+        for (CAMidiFileTrack* track : tracks) {
+            CATaskScheduler::instance()->start(track);
+        }
+        for (CAMidiFileTrack* track : tracks) {
+            track->wait();
+        }
+    } else {
+        for (CAMidiFileTrack* track : tracks) {
+            track->run();
+        }
+    }
+
+    QVector<CAMidiFileEvent> tempoMap;
+    _tracks << tempoMap;
+    for (int i = 0; i < tracks.size(); i++) {
+        if (!tracks[i]->errorString().isEmpty() && _errorString.isEmpty()) {
+            _errorString = QObject::tr("Track %1: %2").arg(i + 1).arg(tracks[i]->errorString());
+        }
+        tempoMap << tracks[i]->tempoMap();
+        _tracks << tracks[i]->events();
+    }
+    qDeleteAll(tracks);
+
+    std::stable_sort(tempoMap.begin(), tempoMap.end(), timeLess);
+    _tracks[0] = tempoMap;
+
+    return _errorString.isEmpty();
+}
+
+/*!
+	Returns the events of all the tracks sorted by time. The events at the same time are ordered
+	by their track, the tempo map first.
+*/
+QVector<CAMidiFileEvent> CAMidiFileReader::events() const
+{
+    QVector<CAMidiFileEvent> events;
+    int size = 0;
+    for (const QVector<CAMidiFileEvent>& track : _tracks) {
+        size += track.size();
+    }
+    events.reserve(size);
+
+    for (const QVector<CAMidiFileEvent>& track : _tracks) {
+        events << track;
+    }
+    std::stable_sort(events.begin(), events.end(), timeLess);
+
+    return events;
+}
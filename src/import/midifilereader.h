@@ -0,0 +1,57 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#ifndef MIDIFILEREADER_H_
+#define MIDIFILEREADER_H_
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+struct CAMidiFileEvent {
+    enum CAMidiFileEventType {
+        Note,
+        Control,
+        Program,
+        Tempo,
+        TimeSignature,
+        KeySignature
+    };
+
+    int time; // in ticks of the file time base
+    CAMidiFileEventType type;
+    int channel; // 0-15, 0 for the tempo map events
+    int data1; // note pitch, controller, program, microseconds per quarter, time signature beats or key accidentals
+    int data2; // note velocity, controller value, time signature beat or 1 for minor key
+    int length; // note length in ticks
+};
+
+class CAMidiFileReader {
+public:
+    CAMidiFileReader();
+
+    bool read(const QString& fileName);
+    bool read(const QByteArray& data);
+
+    inline int format() const { return _format; }
+    inline int timeBase() const { return _timeBase; }
+    inline const QVector<QVector<CAMidiFileEvent>>& tracks() const { return _tracks; }
+    QVector<CAMidiFileEvent> events() const;
+
+    inline const QString& errorString() const { return _errorString; }
+
+    static const int MIN_PARALLEL_SIZE;
+
+private:
+    QByteArray _data;
+    int _format;
+    int _timeBase;
+    QVector<QVector<CAMidiFileEvent>> _tracks; // the first one is the tempo map
+    QString _errorString;
+};
+
+#endif /* MIDIFILEREADER_H_ */
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -9,11 +9,20 @@
 //#include <QRegExp>
 #include <QFileInfo>
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream> // DEBUG
 
+#ifndef SWIGCPP
+#include "canorus.h" // needed for settings()
+#include "core/settings.h"
+#endif
+#include "core/midiquantizer.h"
+#include "core/objectpool.h"
+#include "import/midifilereader.h"
 #include "import/midiimport.h"
 #include "interface/mididevice.h"
+#include "score/accidentalstate.h"
 #include "score/clef.h"
 #include "score/document.h"
 #include "score/keysignature.h"
@@ -25,14 +34,18 @@
 #include "score/slur.h"
 #include "score/tempo.h"
 #include "score/timesignature.h"
+#include "score/tuplet.h"
 
-#include "import/pmidi/wrapper.h"
 
 // Note Reinhard Padding Size with 3 bytes to alignment boundary due to "bool" member
 class CAMidiImportEvent {
 public:
     CAMidiImportEvent(bool on, int channel, int pitch, int velocity, int time, int length, int tempo, int program);
     ~CAMidiImportEvent();
+
+    static void* operator new(std::size_t size) { return CAObjectPool::allocate(size); }
+    static void operator delete(void* p, std::size_t size) { CAObjectPool::release(p, size); }
+
     QList<int> _pitchList; // to build chords when neccessary
     int _channel;
     int _velocity;
@@ -69,6 +82,12 @@ CAMidiImport::CAMidiImport(CADocument* document, QTextStream* in)
 {
     _document = document;
     initMidiImport();
+#ifndef SWIGCPP
+    if (CACanorus::settings()) {
+        _quantizer.setGrid(CACanorus::settings()->midiQuantizeGrid());
+        _quantizer.setTriplets(CACanorus::settings()->midiQuantizeTriplets());
+    }
+#endif
     for (int i = 0; i < 16; i++) {
         _allChannelsEvents << new QList<QList<CAMidiImportEvent*>*>;
         _allChannelsEvents[i]->append(new QList<CAMidiImportEvent*>);
@@ -79,10 +98,26 @@ CAMidiImport::CAMidiImport(CADocument* document, QTextStream* in)
     for (int i = 0; i < 16; i++) {
         _midiProgramList << -1;
     }
+
+    // no notes are sounding yet
+    for (int i = 0; i < 16; i++) {
+        for (int j = 0; j < 128; j++) {
+            _openNotes[i][j] = nullptr;
+            _openNoteVoices[i][j] = -1;
+        }
+    }
 }
 
 CAMidiImport::~CAMidiImport()
 {
+    for (int i = 0; i < _allChannelsEvents.size(); i++) {
+        for (int voiceIdx = 0; voiceIdx < _allChannelsEvents[i]->size(); voiceIdx++) {
+            qDeleteAll(*_allChannelsEvents[i]->at(voiceIdx));
+            delete _allChannelsEvents[i]->at(voiceIdx);
+        }
+        delete _allChannelsEvents[i];
+    }
+    qDeleteAll(_allChannelsTimeSignatures);
 }
 
 void CAMidiImport::initMidiImport()
@@ -112,7 +147,7 @@ CADocument* CAMidiImport::importDocumentImpl()
 CASheet* CAMidiImport::importSheetImpl()
 {
     CASheet* sheet = new CASheet(tr("Midi imported sheet"), _document);
-    sheet = importSheetImplPmidiParser(sheet);
+    sheet = importSheetImplMidiFile(sheet);
     // Show filename as sheet name. The tr() string above should only be changed after a release.
     QFileInfo fi(fileName());
     sheet->setName(fi.baseName());
@@ -141,13 +176,12 @@ QList<QList<CAMidiNote*>> CAMidiImport::importMidiNotes()
             for (int j = 0; j < _allChannelsEvents[i]->at(voiceIdx)->size(); j++) {
                 CAMidiImportEvent* event = _allChannelsEvents[i]->at(voiceIdx)->at(j);
                 for (int pitchIdx = 0; pitchIdx < event->_pitchList.size(); pitchIdx++) {
-                    // temporary solutionsort midi events by time
+                    // sort midi notes by time, the new note is placed before the notes with the same start
                     int timeStart = event->_time;
                     int timeLength = event->_length;
-                    int k;
-                    for (k = 0; k < midiNotes.last().size() && midiNotes.last()[k]->timeStart() < timeStart; k++)
-                        ;
-                    midiNotes.last().insert(k, new CAMidiNote(event->_pitchList[pitchIdx], timeStart, timeLength, nullptr));
+                    QList<CAMidiNote*>::iterator it = std::lower_bound(midiNotes.last().begin(), midiNotes.last().end(), timeStart,
+                        [](CAMidiNote* note, int time) { return note->timeStart() < time; });
+                    midiNotes.last().insert(it, new CAMidiNote(event->_pitchList[pitchIdx], timeStart, timeLength, nullptr));
                 }
             }
         }
@@ -157,124 +191,113 @@ QList<QList<CAMidiNote*>> CAMidiImport::importMidiNotes()
 }
 
 /*!
-	The midi file is opened by calling the pmidi wrapper function \a pmidi_open_midi_file(), then,
-	in a polling loop, the wrapper function pmidi_parse_midi_file() brings out the relevant midi events
-	which are stored in the array _allChannelsEvents[].
+	The midi file is read by CAMidiFileReader, which decodes the tracks in parallel into flat
+	arrays of events. The events of all the tracks are then processed in the order of their time
+	and the notes are stored in the array _allChannelsEvents[].
 	All time signatures are stored in the array _allChannelsTimeSignatures[].
-	The work of pmidi and the wrapper is done then.
 
-	All time values are scaled here to canorus' own music time scale.
+	All time values are scaled here to canorus' own music time scale and quantized by
+	CAMidiQuantizer. The grid is taken from the settings or detected from the notes of the file.
 
 	Further processing is referred to function \a writeMidiFileEventsToScore_New().
+
+	Returns False, if the file could not be read.
 */
-void CAMidiImport::importMidiEvents()
+bool CAMidiImport::importMidiEvents()
 {
-    QByteArray s;
-    s.append(fileName());
-    pmidi_open_midi_file(s.constData());
+    setStatus(2);
+
+    CAMidiFileReader reader;
+    if (!reader.read(fileName())) {
+        _errors << reader.errorString();
+        return false;
+    }
+
     int voiceIndex;
-    int res = PMIDI_STATUS_DUMMY;
     const int quarterLength = CAPlayableLength::playableLengthToTimeLength(CAPlayableLength::Quarter);
     int programCache[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    int microTempo = 60000000 / 120; // default tempo
     CADiatonicKey dk;
     bool leftOverNote;
+    CAMidiImportEvent* openNote;
     bool chordNote;
     bool timeSigAlreadyThere;
 
-    setStatus(2);
-    for (; res != PMIDI_STATUS_END;) {
-
-        res = pmidi_parse_midi_file();
-
-        // Scale music time properly
-        pmidi_out.time = (pmidi_out.time * quarterLength) / pmidi_out.time_base;
-        pmidi_out.length = (pmidi_out.length * quarterLength) / pmidi_out.time_base;
-
-        //
-        // Quantization on hundredtwentyeighths of time starts and lengths by zeroing the msbits, quant being always a power of two
-        //
-        const int quant = CAPlayableLength::playableLengthToTimeLength(CAPlayableLength::HundredTwentyEighth /* CAPlayableLength::SixtyFourth */);
-        int lengthEnd = pmidi_out.time + pmidi_out.length;
-        pmidi_out.time += quant / 2; // rounding
-        pmidi_out.time &= ~(quant - 1); // quant is power of two
-        lengthEnd += quant / 2;
-        lengthEnd &= ~(quant - 1);
-        pmidi_out.length = lengthEnd - pmidi_out.time;
-
-        switch (res) {
-        case PMIDI_STATUS_END:
-        case PMIDI_STATUS_VERSION:
-            break;
-        case PMIDI_STATUS_TEXT:
-            //			std::cout<<" at "<<pmidi_out.time<<" type "<<pmidi_out.type<<" ("<<pmidi_out.name<<")         "<< pmidi_out.text<<std::endl;
-            break;
-        case PMIDI_STATUS_TIMESIG:
-            //			std::cout<<" Timesig "<<pmidi_out.top
-            //					<<"/"<<pmidi_out.bottom
-            //					<<" at "<<pmidi_out.time
-            //					<<std::endl;
+    // Scale music time properly and quantize the notes of all the channels together
+    const QVector<CAMidiFileEvent> events = reader.events();
+    QVector<int> times(events.size());
+    QVector<CAMidiQuantizerNote> notes;
+    for (int i = 0; i < events.size(); i++) {
+        const CAMidiFileEvent& e = events[i];
+        times[i] = static_cast<int>((static_cast<qint64>(e.time) * quarterLength) / reader.timeBase());
+        if (e.type == CAMidiFileEvent::Note) {
+            int length = static_cast<int>((static_cast<qint64>(e.length) * quarterLength) / reader.timeBase());
+            CAMidiQuantizerNote note = { times[i], length, e.channel, e.data1 };
+            notes << note;
+        } else if (e.type == CAMidiFileEvent::TimeSignature && e.data2 > 4) {
+            _quantizer.setTriplets(false); // the triplets are written per quarter, which might be split by the barlines
+        }
+    }
+    _quantizer.quantize(notes);
+
+    int noteIndex = 0;
+    for (int eventIdx = 0; eventIdx < events.size(); eventIdx++) {
+        const CAMidiFileEvent& e = events[eventIdx];
+        int time = _quantizer.quantizeTime(times[eventIdx]);
+        int length = 0;
+        if (e.type == CAMidiFileEvent::Note) {
+            time = notes[noteIndex].time;
+            length = notes[noteIndex].length;
+            noteIndex++;
+        }
 
-            // We build the list of time signatures. We assume they are ordered in time.
+        switch (e.type) {
+        case CAMidiFileEvent::TimeSignature:
+            // We build the list of time signatures. They are ordered in time by the reader.
             // We don't allow doublets to sneak in.
             timeSigAlreadyThere = false;
             for (int i = 0; i < _allChannelsTimeSignatures.size(); i++) {
-                if (_allChannelsTimeSignatures[i]->_time == pmidi_out.time && _allChannelsTimeSignatures[i]->_top == pmidi_out.top && _allChannelsTimeSignatures[i]->_bottom == pmidi_out.bottom)
+                if (_allChannelsTimeSignatures[i]->_time == time && _allChannelsTimeSignatures[i]->_top == e.data1 && _allChannelsTimeSignatures[i]->_bottom == e.data2)
                     timeSigAlreadyThere = true;
             }
             if (timeSigAlreadyThere)
                 break;
             // If at the same last time another signature comes in the latter one wins.
-            if (!_allChannelsTimeSignatures.size() || _allChannelsTimeSignatures[_allChannelsTimeSignatures.size() - 1]->_time != pmidi_out.time) {
+            if (!_allChannelsTimeSignatures.size() || _allChannelsTimeSignatures[_allChannelsTimeSignatures.size() - 1]->_time != time) {
                 // Normal detection of time signature, store it.
-                _allChannelsTimeSignatures << new CAMidiImportEvent(true, 0, 0, 0, pmidi_out.time, 0, 0);
-                _allChannelsTimeSignatures[_allChannelsTimeSignatures.size() - 1]->_top = pmidi_out.top;
-                _allChannelsTimeSignatures[_allChannelsTimeSignatures.size() - 1]->_bottom = pmidi_out.bottom;
-            } else {
-                // overwrite the last one with new values
-                _allChannelsTimeSignatures[_allChannelsTimeSignatures.size() - 1]->_top = pmidi_out.top;
-                _allChannelsTimeSignatures[_allChannelsTimeSignatures.size() - 1]->_bottom = pmidi_out.bottom;
+                _allChannelsTimeSignatures << new CAMidiImportEvent(true, 0, 0, 0, time, 0, 0);
             }
+            _allChannelsTimeSignatures[_allChannelsTimeSignatures.size() - 1]->_top = e.data1;
+            _allChannelsTimeSignatures[_allChannelsTimeSignatures.size() - 1]->_bottom = e.data2;
             break;
-        case PMIDI_STATUS_TEMPO:
-            //			std::cout<<" Tempo "<<pmidi_out.micro_tempo
-            //				<<"  at "<<pmidi_out.time
-            //				<<std::endl;
+        case CAMidiFileEvent::Tempo:
+            microTempo = e.data1;
             break;
-        case PMIDI_STATUS_NOTE:
-            /*
-			std::cout<<" at "<<pmidi_out.time
-				<<"  chan "<<pmidi_out.chan
-				<<" note "<<pmidi_out.note
-				<<" vel "<<pmidi_out.vel
-				<<" len "<<pmidi_out.length<<std::endl;
-			*/
-
+        case CAMidiFileEvent::Note:
             // Deal with unfinished notes. This is a note that get's keyed when the old same pitch note is not yet expired.
-            // Pmidi does a printf message with those. We adjust the length and next time of the original note according
+            // We adjust the length and next time of the original note according
             // the new event, and we don't create a new note in our list.
+            // The last event of each pitch in the channel is looked up in the open notes table.
             leftOverNote = false;
-            for (voiceIndex = 0; !leftOverNote && voiceIndex < _allChannelsEvents[pmidi_out.chan]->size(); voiceIndex++) {
-
-                if (_allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->size()) {
-                    if (pmidi_out.time < _allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->back()->_nextTime && _allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->back()->_pitchList.indexOf(pmidi_out.note) >= 0) {
-
-                        _allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->back()->_length = pmidi_out.time - _allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->back()->_time + pmidi_out.length;
-                        _allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->back()->_nextTime = _allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->back()->_time + _allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->back()->_length;
-                        leftOverNote = true;
-                    }
-                }
+            openNote = _openNotes[e.channel][e.data1];
+            if (openNote && time < openNote->_nextTime && _allChannelsEvents[e.channel]->at(_openNoteVoices[e.channel][e.data1])->back() == openNote) {
+                openNote->_length = time - openNote->_time + length;
+                openNote->_nextTime = openNote->_time + openNote->_length;
+                leftOverNote = true;
             }
 
             // Check for building a chord
             chordNote = false;
-            for (voiceIndex = 0; !leftOverNote && !chordNote && voiceIndex < _allChannelsEvents[pmidi_out.chan]->size(); voiceIndex++) {
-                for (int i = _allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->size() - 1; i >= 0; i--) {
+            for (voiceIndex = 0; !leftOverNote && !chordNote && voiceIndex < _allChannelsEvents[e.channel]->size(); voiceIndex++) {
+                for (int i = _allChannelsEvents[e.channel]->at(voiceIndex)->size() - 1; i >= 0; i--) {
                     // finish chord search when start is too early
-                    if (_allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->at(i)->_time < pmidi_out.time)
+                    if (_allChannelsEvents[e.channel]->at(voiceIndex)->at(i)->_time < time)
                         break;
-                    if (_allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->at(i)->_time == pmidi_out.time && _allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->at(i)->_length == pmidi_out.length) {
+                    if (_allChannelsEvents[e.channel]->at(voiceIndex)->at(i)->_time == time && _allChannelsEvents[e.channel]->at(voiceIndex)->at(i)->_length == length) {
 
-                        _allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->at(i)->_pitchList << pmidi_out.note;
+                        _allChannelsEvents[e.channel]->at(voiceIndex)->at(i)->_pitchList << e.data1;
+                        _openNotes[e.channel][e.data1] = _allChannelsEvents[e.channel]->at(voiceIndex)->at(i);
+                        _openNoteVoices[e.channel][e.data1] = voiceIndex;
                         chordNote = true;
                     }
                 }
@@ -283,70 +306,55 @@ void CAMidiImport::importMidiEvents()
             // Get note to the right voice
             for (voiceIndex = 0; !leftOverNote && !chordNote && voiceIndex < 30; voiceIndex++) { // we can't imagine that so many voices ar needed in any case so let's put a limit
                 // if another voice is needed and not yet there we create it
-                if (voiceIndex >= _allChannelsEvents[pmidi_out.chan]->size()) {
-                    _allChannelsEvents[pmidi_out.chan]->append(new QList<CAMidiImportEvent*>);
+                if (voiceIndex >= _allChannelsEvents[e.channel]->size()) {
+                    _allChannelsEvents[e.channel]->append(new QList<CAMidiImportEvent*>);
                 }
-                if (_allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->size() == 0 || _allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->last()->_nextTime <= pmidi_out.time) {
+                if (_allChannelsEvents[e.channel]->at(voiceIndex)->size() == 0 || _allChannelsEvents[e.channel]->at(voiceIndex)->last()->_nextTime <= time) {
                     // the note can be added
-                    _allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->append(new CAMidiImportEvent(true, pmidi_out.chan, pmidi_out.note, pmidi_out.vel, pmidi_out.time, pmidi_out.length, 60000000 / pmidi_out.micro_tempo));
+                    _allChannelsEvents[e.channel]->at(voiceIndex)->append(new CAMidiImportEvent(true, e.channel, e.data1, e.data2, time, length, 60000000 / microTempo));
                     // attach the right program to the event
-                    _allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->at(_allChannelsEvents[pmidi_out.chan]->at(voiceIndex)->size() - 1)->_program = programCache[pmidi_out.chan];
+                    _allChannelsEvents[e.channel]->at(voiceIndex)->back()->_program = programCache[e.channel];
+                    _openNotes[e.channel][e.data1] = _allChannelsEvents[e.channel]->at(voiceIndex)->back();
+                    _openNoteVoices[e.channel][e.data1] = voiceIndex;
                     break;
                 }
             }
             break;
-        case PMIDI_STATUS_DUMMY:
-        case PMIDI_STATUS_ROOT:
-            //			std::cout<<" Midi-Format: "<<pmidi_out.format
-            //				<<"  Tracks: "<<pmidi_out.tracks
-            //				<<"  Time Base: "<<pmidi_out.time_base<<std::endl;
+        case CAMidiFileEvent::Control:
             break;
-        case PMIDI_STATUS_CONTROL:
-            break;
-        case PMIDI_STATUS_PROGRAM:
-            //			std::cout<<" Program: "<<pmidi_out.program
-            //				<<"  Channel: "<<pmidi_out.chan
-            //				<<std::endl;
-            programCache[pmidi_out.chan] = pmidi_out.program;
+        case CAMidiFileEvent::Program:
+            programCache[e.channel] = e.data1;
 
             // store the first instrument in the channel to _midiProgramList variable
-            if (_midiProgramList[pmidi_out.chan] == -1) {
-                _midiProgramList[pmidi_out.chan] = pmidi_out.program;
+            if (_midiProgramList[e.channel] == -1) {
+                _midiProgramList[e.channel] = e.data1;
             }
-
             break;
-        case PMIDI_STATUS_PITCH:
-        case PMIDI_STATUS_PRESSURE:
-        case PMIDI_STATUS_KEYTOUCH:
-        case PMIDI_STATUS_SYSEX:
-            break;
-        case PMIDI_STATUS_KEYSIG:
-
-            //			std::cout<<" Keys: "<<pmidi_out.key
-            //				<<"  Minor: "<<pmidi_out.minor<<std::endl;
-            dk = CADiatonicKey(pmidi_out.key, pmidi_out.minor ? CADiatonicKey::Minor : CADiatonicKey::Major);
+        case CAMidiFileEvent::KeySignature:
+            dk = CADiatonicKey(e.data1, e.data2 ? CADiatonicKey::Minor : CADiatonicKey::Major);
             // After the first key signature only changes are imported
             if (!_allChannelsKeySignatures.size() || _allChannelsKeySignatures.last()->diatonicKey() != dk)
-                _allChannelsKeySignatures << new CAKeySignature(dk, nullptr, pmidi_out.time);
-
-            break;
-        case PMIDI_STATUS_SMPTEOFFS:
-            /*
-			std::cout<<"  Stunden "<<pmidi_out.hours
-				<<" Minuten "<<pmidi_out.minutes
-				<<" Sekunden "<<pmidi_out.seconds
-				<<" Frames "<<pmidi_out.frames
-				<<" Subframes "<<pmidi_out.subframes<<std::endl;
-			*/
+                _allChannelsKeySignatures << new CAKeySignature(dk, nullptr, time);
             break;
         }
     }
+
+    return true;
 }
 
-CASheet* CAMidiImport::importSheetImplPmidiParser(CASheet* sheet)
+CASheet* CAMidiImport::importSheetImplMidiFile(CASheet* sheet)
 {
-    importMidiEvents();
+    if (!importMidiEvents()) {
+        setStatus(-1);
+        return sheet;
+    }
+    if (isCanceled()) {
+        return sheet;
+    }
     writeMidiFileEventsToScore_New(sheet);
+    if (isCanceled()) {
+        return sheet;
+    }
     fixAccidentals(sheet);
     setStatus(5);
     return sheet;
@@ -376,7 +384,7 @@ void CAMidiImport::writeMidiFileEventsToScore_New(CASheet* sheet)
     }
 
     // Calculate the medium pitch for every staff for the key selection later
-    _numberOfAllVoices = 2; // plus one for preprocessing, thats calling pmidi, and one for postprocessing
+    _numberOfAllVoices = 2; // plus one for preprocessing, thats reading the midi file, and one for postprocessing
     for (int chanIndex = 0; chanIndex < 16; chanIndex++) {
         int n = 0;
         for (voiceIndex = 0; voiceIndex < _allChannelsEvents[chanIndex]->size(); voiceIndex++) {
@@ -430,10 +438,10 @@ void CAMidiImport::writeMidiFileEventsToScore_New(CASheet* sheet)
         _allChannelsTimeSignatures[_allChannelsTimeSignatures.size() - 1]->_bottom = 4;
     }
 
-    int nImportedVoices = 1; // one because preprocessing, ie calling pmidi, is already done
-    setProgress(_numberOfAllVoices ? nImportedVoices * 100 / _numberOfAllVoices : 50);
+    int nImportedVoices = 1; // one because preprocessing, ie reading the midi file, is already done
+    setProgress(nImportedVoices, _numberOfAllVoices);
 
-    for (unsigned char ch = 0; ch < 16; ch++) {
+    for (unsigned char ch = 0; ch < 16 && !isCanceled(); ch++) {
 
         if (!_allChannelsEvents[ch]->size() || !_allChannelsEvents[ch]->first()->size()) /* staff or first voice empty */
             continue;
@@ -465,7 +473,7 @@ void CAMidiImport::writeMidiFileEventsToScore_New(CASheet* sheet)
             }
             voice->append(musElemClef, false);
             writeMidiChannelEventsToVoice_New(ch, voiceIndex, staff, voice);
-            setProgress(_numberOfAllVoices ? nImportedVoices * 100 / _numberOfAllVoices : 50);
+            setProgress(nImportedVoices, _numberOfAllVoices);
 
             ++nImportedVoices;
             staff->synchronizeVoices();
@@ -559,6 +567,7 @@ CAMusElement* CAMidiImport::getOrCreateTimeSignature(int time, int, CAStaff* sta
 void CAMidiImport::writeMidiChannelEventsToVoice_New(int channel, int voiceIndex, CAStaff* staff, CAVoice* voice)
 {
 
+    const int quarterLength = CAPlayableLength::playableLengthToTimeLength(CAPlayableLength::Quarter);
     QList<CAMidiImportEvent*>* events = _allChannelsEvents[channel]->at(voiceIndex);
     QList<CANote*> noteList;
     CARest* rest;
@@ -602,8 +611,18 @@ void CAMidiImport::writeMidiChannelEventsToVoice_New(int channel, int voiceIndex
             }
         }
 
+        // the events quantized on triplets are written as a single tuplet over their quarter
+        int restEnd = events->at(i)->_time;
+        int tripletEnd = i;
+        if (isTripletEvent(events->at(i))) {
+            restEnd = (restEnd / quarterLength) * quarterLength;
+            while (tripletEnd < events->size() && events->at(tripletEnd)->_time < restEnd + quarterLength) {
+                tripletEnd++;
+            }
+        }
+
         // check if we need to add rests
-        length = events->at(i)->_time - time;
+        length = restEnd - time;
 
         while (length > 0) {
 
@@ -662,6 +681,34 @@ void CAMidiImport::writeMidiChannelEventsToVoice_New(int channel, int voiceIndex
                 }
             }
         }
+        if (tripletEnd > i) {
+            CAPlayable* last = writeTripletToVoice(events, i, tripletEnd, restEnd, voice);
+            if (tempo) {
+                last->tuplet()->firstNote()->addMark(new CATempo(CAPlayableLength::Quarter, tempo, last->tuplet()->firstNote()));
+            }
+            time = restEnd + quarterLength;
+            i = tripletEnd - 1;
+
+            tsElem = getOrCreateTimeSignature(time, voiceIndex, staff, voice);
+            if (tsElem) {
+                voice->append(tsElem, false);
+                ts = static_cast<CATimeSignature*>(tsElem);
+            }
+
+            CAMusElement* ksElem = getOrCreateKeySignature(time, voiceIndex, staff, voice);
+            if (ksElem) {
+                voice->append(ksElem, false);
+            }
+
+            CAMusElement* bl = staff->getOneEltByType(CAMusElement::Barline, time);
+            if (bl) {
+                voice->append(bl, false);
+            } else {
+                staff->placeAutoBar(last);
+            }
+            continue;
+        }
+
         // notes to be added
         length = events->at(i)->_length;
         program = events->at(i)->_program;
@@ -741,6 +788,56 @@ void CAMidiImport::writeMidiChannelEventsToVoice_New(int channel, int voiceIndex
     }
 }
 
+/*!
+	Returns True, if the \a event starts or ends inside a quarter quantized on eighth triplets.
+	The quantizer keeps such events inside their quarter.
+*/
+bool CAMidiImport::isTripletEvent(CAMidiImportEvent* event)
+{
+    const int quarterLength = CAPlayableLength::playableLengthToTimeLength(CAPlayableLength::Quarter);
+    return _quantizer.isTripletBeat(event->_time) && ((event->_time % quarterLength) || ((event->_time + event->_length) % quarterLength));
+}
+
+/*!
+	Writes the \a events from \a first to \a last - 1, which lie in the quarter starting at
+	\a time, as a triplet of eighths. The notes one or two eighth triplets long become eighths or
+	quarters under the tuplet and the free triplets are filled with rests.
+
+	Returns the last written playable.
+*/
+CAPlayable* CAMidiImport::writeTripletToVoice(QList<CAMidiImportEvent*>* events, int first, int last, int time, CAVoice* voice)
+{
+    QList<CAPlayable*> playables;
+    int slot = 0;
+    for (int i = first; i <= last && slot < 3; i++) {
+        int start = (i < last) ? qMin(CAMidiQuantizer::tripletSlot(events->at(i)->_time - time), 2) : 3;
+        if (start > slot) { // rest before the note or at the end of the quarter
+            CARest* rest = new CARest(CARest::Normal, CAPlayableLength((start - slot == 1) ? CAPlayableLength::Eighth : CAPlayableLength::Quarter), voice, 0, -1);
+            voice->append(rest, false);
+            playables << rest;
+            slot = start;
+        }
+        if (i == last) {
+            break;
+        }
+
+        CAMidiImportEvent* event = events->at(i);
+        int end = qBound(slot + 1, CAMidiQuantizer::tripletSlot(event->_time + event->_length - time), 3);
+        CAPlayableLength length((end - slot == 1) ? CAPlayableLength::Eighth : CAPlayableLength::Quarter);
+        for (int k = 0; k < event->_pitchList.size(); k++) {
+            CANote* note = new CANote(matchPitchToKey(voice, event->_pitchList[k]), length, voice, -1);
+            voice->append(note, k ? true : false);
+            note->setStemDirection(CANote::StemPreferred);
+            playables << note;
+        }
+        voice->setMidiProgram(event->_program);
+        slot = end;
+    }
+
+    new CATuplet(3, 2, playables);
+    return playables.back();
+}
+
 void CAMidiImport::closeFile()
 {
     file()->close();
@@ -757,6 +854,9 @@ const QString CAMidiImport::readableStatus()
     case 1:
         return tr("Importing...");
     case -1:
+        if (!_errors.isEmpty()) {
+            return tr("Error while importing!\n%1").arg(_errors.last());
+        }
         return tr("Error while importing!\nLine %1:%2.").arg(curLine()).arg(curChar());
     case 2:
         return tr("Importing Midi events...");
@@ -790,14 +890,27 @@ CADiatonicPitch CAMidiImport::matchPitchToKey(CAVoice* voice, int midiPitch)
     _actualKeyAccidentalsSum = 0;
 
     // Trace which Key Signature might be in effect.
-    // We make a local copy for later optimisation by only updating at a non
-    // linear input
-    QList<CAMusElement*> keyList = voice->getPreviousByType(
-        CAMusElement::KeySignature, voice->lastTimeEnd());
-    if (keyList.size()) {
+    CAMusElement* key = voice->getOnePreviousByType(CAMusElement::KeySignature, voice->lastTimeEnd());
+    if (key) {
         // set the note name and its accidental and the accidentals of the scale
-        CAKeySignature* effSig = static_cast<CAKeySignature*>(keyList.last());
-        return CADiatonicPitch::diatonicPitchFromMidiPitchKey(midiPitch, effSig->diatonicKey());
+        CAKeySignature* effSig = static_cast<CAKeySignature*>(key);
+        CADiatonicPitch p = CADiatonicPitch::diatonicPitchFromMidiPitchKey(midiPitch, effSig->diatonicKey());
+
+        // keep the spelling of the pitches already altered in the bar
+        if (voice->staff()) {
+            CAAccidentalState state(voice->staff());
+            int time = voice->lastTimeEnd();
+            if (!state.isInEffect(p, time)) {
+                CADiatonicPitch lower = p - CAInterval(CAInterval::Diminished, CAInterval::Second);
+                CADiatonicPitch higher = p + CAInterval(CAInterval::Diminished, CAInterval::Second);
+                if (state.isInEffect(lower, time)) {
+                    return lower;
+                } else if (state.isInEffect(higher, time)) {
+                    return higher;
+                }
+            }
+        }
+        return p;
     } else {
         return CADiatonicPitch::diatonicPitchFromMidiPitch(midiPitch);
     }
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -25,6 +25,7 @@
 #include "score/timesignature.h"
 #include "score/voice.h"
 
+#include "core/midiquantizer.h"
 #include "import/import.h"
 
 class QTextStream;
@@ -53,11 +54,12 @@ public:
 
     const QString readableStatus();
     QList<int> midiProgramList() { return _midiProgramList; }
+    inline CAMidiQuantizer& quantizer() { return _quantizer; }
 
 private:
     // Alternatives during developement
-    CASheet* importSheetImplPmidiParser(CASheet* sheet);
-    void importMidiEvents();
+    CASheet* importSheetImplMidiFile(CASheet* sheet);
+    bool importMidiEvents();
 
     void initMidiImport();
 
@@ -113,6 +115,7 @@ private:
     QList<QString> _errors;
     QList<QString> _warnings;
     QList<int> _midiProgramList; // list of first instruments in the channel or -1, if not defined
+    CAMidiQuantizer _quantizer; // grid and triplets of the imported notes
 
     //inline CAVoice *templateVoice() { return _templateVoice; }
     //CAVoice *_templateVoice; // used when importing voice to set the staff etc.
@@ -123,9 +126,13 @@ private:
 
     CADocument* _document;
     QVector<QList<QList<CAMidiImportEvent*>*>*> _allChannelsEvents;
+    CAMidiImportEvent* _openNotes[16][128]; // last event of each pitch in each channel, used to extend the unfinished notes
+    int _openNoteVoices[16][128]; // voice index of the events in _openNotes
     QList<CAMidiImportEvent*> _eventsX;
     void writeMidiFileEventsToScore_New(CASheet* sheet);
     void writeMidiChannelEventsToVoice_New(int channel, int voiceIndex, CAStaff* staff, CAVoice* voice);
+    bool isTripletEvent(CAMidiImportEvent* event);
+    CAPlayable* writeTripletToVoice(QList<CAMidiImportEvent*>* events, int first, int last, int time, CAVoice* voice);
     QVector<int> _allChannelsMediumPitch;
     QVector<CAClef*> _allChannelsClef;
     QVector<CAKeySignature*> _allChannelsKeySignatures;
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2008, Matevž Jekovec, Canorus development team
+	Copyright (c) 2008-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -7,21 +7,27 @@
 
 #include "import/musicxmlimport.h"
 #include <QDebug>
+#include <QVector>
 #include <QXmlStreamAttributes>
 #include <iostream> // debug
 
 #include "import/canorusmlimport.h"
 
+#include "core/taskscheduler.h"
+
 #include "score/barline.h"
 #include "score/clef.h"
 #include "score/context.h"
+#include "score/diatonicpitch.h"
 #include "score/document.h"
 #include "score/keysignature.h"
 #include "score/muselement.h"
 #include "score/note.h"
 #include "score/playable.h"
+#include "score/playablelength.h"
 #include "score/rest.h"
 #include "score/sheet.h"
+#include "score/slur.h"
 #include "score/staff.h"
 #include "score/timesignature.h"
 #include "score/voice.h"
@@ -45,6 +51,320 @@
 #include "score/functionmark.h"
 #include "score/functionmarkcontext.h"
 
+/*!
+	\struct CAMusicXmlEvent
+	\brief Element of a MusicXML part in the intermediate form
+
+	The lengths are already resolved from the divisions of the part and the tempo from the last
+	<sound> element is stored in the note it belongs to, so the events of a part can be converted
+	independently of the other parts.
+
+	\sa CAMusicXmlPart
+*/
+struct CAMusicXmlEvent {
+    enum CAEventType {
+        NoteEvent,
+        ForwardEvent,
+        StavesEvent,
+        ClefEvent,
+        KeySignatureEvent,
+        TimeSignatureEvent,
+        MeasureEndEvent
+    };
+
+    CAMusicXmlEvent(CAEventType t)
+        : type(t)
+        , staff(1)
+        , voice(1)
+        , number(1)
+        , value(0)
+        , extra(0)
+        , rest(false)
+        , chord(false)
+        , tieStop(false)
+        , hyphen(false)
+        , melisma(false)
+        , tempoBpm(-1)
+        , lyricsNumber(-1)
+    {
+    }
+
+    CAEventType type;
+    int staff; // staff number in the part, starting with 1
+    int voice; // voice number in the part or -1, if not given
+    int number; // number attribute of the clef, key or time signature
+    int value; // number of staves, clef type, key accidentals, time signature beats or forward time length
+    int extra; // key gender or time signature beat
+    CAPlayableLength length;
+    CADiatonicPitch pitch;
+    bool rest;
+    bool chord;
+    bool tieStop;
+    bool hyphen;
+    bool melisma;
+    int tempoBpm; // tempo mark of the note or -1
+    int lyricsNumber; // stanza number of the syllable or -1, if none
+    QString lyricsText;
+};
+
+/*!
+	\class CAMusicXmlPart
+	\brief A single MusicXML <part> converted in the task scheduler
+
+	CAMusicXmlImport reads each part into a compact list of CAMusicXmlEvent. When the part is read,
+	it is converted into staffs and voices on a worker thread while the reader continues with the
+	next part. The part only creates its own staffs; they are added to the sheet in the document
+	order by CAMusicXmlImport once all the parts are converted.
+*/
+class CAMusicXmlPart : public CATask {
+public:
+    CAMusicXmlPart(CASheet* sheet, int midiProgram, int midiChannel)
+        : CATask(CATask::Normal)
+        , _sheet(sheet)
+        , _midiProgram(midiProgram)
+        , _midiChannel(midiChannel)
+        , _divisions(0)
+    {
+    }
+
+    void run();
+
+    inline int divisions() const { return _divisions; }
+    inline void setDivisions(int divisions) { _divisions = divisions; }
+    inline void addEvent(const CAMusicXmlEvent& e) { _events << e; }
+    inline const QList<CAStaff*>& staffList() const { return _staffs; }
+
+private:
+    void addStavesIfNeeded(int staves);
+    CAVoice* addVoiceIfNeeded(int staff, int voice);
+    void convertNote(const CAMusicXmlEvent& e);
+    void convertForward(const CAMusicXmlEvent& e);
+    void finishMeasure();
+
+    CASheet* _sheet;
+    int _midiProgram; // 1-128 or 0, if not given
+    int _midiChannel; // 1-16 or 0, if not given
+    int _divisions;
+    QVector<CAMusicXmlEvent> _events;
+
+    QList<CAStaff*> _staffs;
+    QHash<int, CAVoice*> _voices; // voice number : voice
+    QHash<int, CAClef*> _clefs; // staff number : last clef
+    QHash<int, CAKeySignature*> _keySigs; // staff number : last keysig
+    QHash<int, CATimeSignature*> _timeSigs; // staff number : last timesig
+};
+
+void CAMusicXmlPart::run()
+{
+    addStavesIfNeeded(1);
+
+    for (int i = 0; i < _events.size(); i++) {
+        const CAMusicXmlEvent& e = _events[i];
+        switch (e.type) {
+        case CAMusicXmlEvent::NoteEvent:
+            convertNote(e);
+            break;
+        case CAMusicXmlEvent::ForwardEvent:
+            convertForward(e);
+            break;
+        case CAMusicXmlEvent::StavesEvent:
+            addStavesIfNeeded(e.value);
+            break;
+        case CAMusicXmlEvent::ClefEvent:
+            _clefs[e.number] = new CAClef(static_cast<CAClef::CAPredefinedClefType>(e.value), (_staffs.size() >= e.number) ? _staffs[e.number - 1] : nullptr, 0);
+            break;
+        case CAMusicXmlEvent::KeySignatureEvent:
+            _keySigs[e.number] = new CAKeySignature(CADiatonicKey(e.value, static_cast<CADiatonicKey::CAGender>(e.extra)), (_staffs.size() >= e.number) ? _staffs[e.number - 1] : nullptr, 0);
+            break;
+        case CAMusicXmlEvent::TimeSignatureEvent:
+            _timeSigs[e.number] = new CATimeSignature(e.value, e.extra, (_staffs.size() >= e.number) ? _staffs[e.number - 1] : nullptr, 0);
+            break;
+        case CAMusicXmlEvent::MeasureEndEvent:
+            finishMeasure();
+            break;
+        }
+    }
+    _events.clear();
+
+    for (int j = 0; j < _staffs.size(); j++) {
+        for (int k = 0; k < _staffs[j]->voiceList().size(); k++) {
+            // Note Reinhard: Not sure if program and channel cannot exceed 256, "int" is used everywhere
+            _staffs[j]->voiceList()[k]->setMidiProgram(static_cast<unsigned char>(_midiProgram - 1));
+            _staffs[j]->voiceList()[k]->setMidiChannel(static_cast<unsigned char>(_midiChannel - 1));
+        }
+    }
+}
+
+/*!
+	Assures that the part contains at least \a staves number of staves.
+	Adds new staves, if needed and assings any clefs, key signatures or time signatures in the buffer
+	to the new staff, if their number is the number of the new staff.
+	The staffs are named when they are added to the sheet.
+*/
+void CAMusicXmlPart::addStavesIfNeeded(int staves)
+{
+    for (int i = _staffs.size() + 1; i <= staves; i++) {
+        CAStaff* s = new CAStaff(QString(), _sheet);
+        _staffs.append(s);
+
+        if (_keySigs.contains(i)) {
+            _keySigs[i]->setContext(s);
+        }
+        if (_timeSigs.contains(i)) {
+            _timeSigs[i]->setContext(s);
+        }
+        if (_clefs.contains(i)) {
+            _clefs[i]->setContext(s);
+        }
+    }
+}
+
+/*!
+	Assures that the given \a staff contains the voice with the given \a voice number.
+	Adds new voices, if needed and adds any clefs, key signatures or time signatures in the buffer
+	to the new voice.
+*/
+CAVoice* CAMusicXmlPart::addVoiceIfNeeded(int staff, int voice)
+{
+    CAVoice* v = _voices.value(voice, nullptr);
+    if (v) {
+        return v;
+    }
+
+    if (staff < 1 || staff > _staffs.size()) {
+        staff = 1;
+    }
+
+    CAStaff* s = _staffs[staff - 1];
+    v = new CAVoice(CAMusicXmlImport::tr("Voice%1").arg(s->voiceList().size()), s);
+    if (!s->voiceList().size()) {
+        if (_clefs.contains(staff)) {
+            v->append(_clefs[staff]);
+        } else if (_clefs.contains(1)) { // add the default clef
+            v->append(_clefs[1]->clone(s));
+        }
+
+        if (_keySigs.contains(staff)) {
+            v->append(_keySigs[staff]);
+        } else if (_keySigs.contains(1)) { // add the default keysig
+            v->append(_keySigs[1]->clone(s));
+        }
+
+        if (_timeSigs.contains(staff)) {
+            v->append(_timeSigs[staff]);
+        } else if (_timeSigs.contains(1)) { // add the default timesig
+            v->append(_timeSigs[1]->clone(s));
+        }
+    }
+
+    s->addVoice(v);
+    s->synchronizeVoices();
+    _voices[voice] = v;
+
+    return v;
+}
+
+void CAMusicXmlPart::convertNote(const CAMusicXmlEvent& e)
+{
+    CAVoice* v = addVoiceIfNeeded(e.staff, e.voice);
+
+    // grace notes are not supported yet
+    if (e.length.musicLength() == CAPlayableLength::Undefined) {
+        // grace notes don't have musicLength set
+        return;
+    }
+
+    CAPlayable* p = nullptr;
+    if (!e.rest) {
+        p = new CANote(e.pitch, e.length, v, 0);
+        if (e.tempoBpm != -1) {
+            p->addMark(new CATempo(CAPlayableLength::Quarter, static_cast<uchar>(e.tempoBpm), p));
+        }
+    } else {
+        p = new CARest(CARest::Normal, e.length, v, 0);
+    }
+
+    v->append(p, e.chord);
+
+    // create ties
+    if (e.tieStop && !e.rest) {
+        CANote* noteEnd = static_cast<CANote*>(p);
+        CANote* noteStart = nullptr;
+        CANote* prevNote = v->previousNote(p->timeStart());
+        if (prevNote) {
+            QList<CANote*> prevChord = prevNote->getChord();
+            for (int i = 0; i < prevChord.size(); i++) {
+                if (prevChord[i]->diatonicPitch() == noteEnd->diatonicPitch()) {
+                    noteStart = prevChord[i];
+                    break;
+                }
+            }
+        }
+
+        if (noteStart) {
+            CASlur* tie = new CASlur(CASlur::TieType, CASlur::SlurPreferred, v->staff(), noteStart, noteEnd);
+            noteStart->setTieStart(tie);
+            noteEnd->setTieEnd(tie);
+        }
+    }
+
+    // create lyrics, the contexts are added to the sheet below their staff later
+    if (e.lyricsNumber != -1) {
+        while (e.lyricsNumber > v->lyricsContextList().size()) {
+            new CALyricsContext(v->name() + CAMusicXmlImport::tr("Lyrics"), v->lyricsContextList().size() + 1, v); // adds itself to the voice
+        }
+
+        CALyricsContext* lc = v->lyricsContextList()[e.lyricsNumber - 1];
+        lc->addSyllable(new CASyllable(e.lyricsText, e.hyphen, e.melisma, lc, p->timeStart(), p->timeLength()));
+    }
+}
+
+void CAMusicXmlPart::convertForward(const CAMusicXmlEvent& e)
+{
+    if (e.voice == -1 || e.value == -1) {
+        return;
+    }
+
+    CAVoice* v = addVoiceIfNeeded(e.staff, e.voice);
+    QList<CARest*> hiddenRests = CARest::composeRests(e.value, v->lastTimeEnd(), v);
+    for (int i = 0; i < hiddenRests.size(); i++) {
+        v->append(hiddenRests[i]);
+    }
+}
+
+/*!
+	Finishes the measure by adding barlines to all the staffs of the part.
+*/
+void CAMusicXmlPart::finishMeasure()
+{
+    for (int staffIdx = 0; staffIdx < _staffs.size(); staffIdx++) {
+        CAStaff* staff = _staffs[staffIdx];
+        int lastVoice = -1;
+        for (int i = 0; i < staff->voiceList().size(); i++) {
+            if (lastVoice == -1 || staff->voiceList()[lastVoice]->lastTimeEnd() < staff->voiceList()[i]->lastTimeEnd()) {
+                lastVoice = i;
+            }
+        }
+
+        if (lastVoice != -1) {
+            staff->voiceList()[lastVoice]->append(new CABarline(CABarline::Single, staff, 0));
+            staff->synchronizeVoices();
+        }
+    }
+}
+
+/*!
+	\class CAMusicXmlImport
+	\brief MusicXML import filter
+
+	The source is read with QXmlStreamReader. The element name of each token is resolved to a tag
+	once by readNextToken() and the read functions compare the tags only.
+
+	Partwise scores are read part by part into CAMusicXmlPart. Each part is converted into staffs
+	and voices in the task scheduler as soon as its end tag is read. The staffs and their lyrics are
+	added to the sheet in the document order at the end.
+*/
+
 CAMusicXmlImport::CAMusicXmlImport(QTextStream* stream)
     : CAImport(stream)
     , QXmlStreamReader()
@@ -61,24 +381,121 @@ CAMusicXmlImport::CAMusicXmlImport(const QString stream)
 
 CAMusicXmlImport::~CAMusicXmlImport()
 {
+    for (CAMusicXmlPart* part : _parts) {
+        part->wait();
+    }
+    qDeleteAll(_parts);
 }
 
 void CAMusicXmlImport::initMusicXmlImport()
 {
     _document = nullptr;
     _tempoBpm = -1;
+    _tag = UndefinedTag;
+}
+
+/*!
+	Returns the tag of the element with the given \a name or UndefinedTag, if the element is not
+	read by the filter.
+*/
+CAMusicXmlImport::CATag CAMusicXmlImport::tagFromName(const QStringRef& name)
+{
+    struct CATagName {
+        const char* name;
+        CATag tag;
+    };
+
+    // sorted by name
+    static const CATagName tags[] = {
+        { "alter", AlterTag },
+        { "attributes", AttributesTag },
+        { "beat-type", BeatTypeTag },
+        { "beats", BeatsTag },
+        { "chord", ChordTag },
+        { "clef", ClefTag },
+        { "creator", CreatorTag },
+        { "defaults", DefaultsTag },
+        { "direction", DirectionTag },
+        { "divisions", DivisionsTag },
+        { "duration", DurationTag },
+        { "extend", ExtendTag },
+        { "fifths", FifthsTag },
+        { "forward", ForwardTag },
+        { "identification", IdentificationTag },
+        { "key", KeyTag },
+        { "lyric", LyricTag },
+        { "measure", MeasureTag },
+        { "midi-channel", MidiChannelTag },
+        { "midi-program", MidiProgramTag },
+        { "mode", ModeTag },
+        { "movement-title", MovementTitleTag },
+        { "note", NoteTag },
+        { "octave", OctaveTag },
+        { "part", PartTag },
+        { "part-list", PartListTag },
+        { "part-name", PartNameTag },
+        { "pitch", PitchTag },
+        { "rest", RestTag },
+        { "rights", RightsTag },
+        { "score-part", ScorePartTag },
+        { "score-partwise", ScorePartwiseTag },
+        { "score-timewise", ScoreTimewiseTag },
+        { "sign", SignTag },
+        { "sound", SoundTag },
+        { "staff", StaffTag },
+        { "staves", StavesTag },
+        { "stem", StemTag },
+        { "step", StepTag },
+        { "syllabic", SyllabicTag },
+        { "text", TextTag },
+        { "tie", TieTag },
+        { "time", TimeTag },
+        { "voice", VoiceTag },
+        { "work", WorkTag },
+        { "work-title", WorkTitleTag }
+    };
+
+    int low = 0;
+    int high = static_cast<int>(sizeof(tags) / sizeof(tags[0])) - 1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        int cmp = name.compare(QLatin1String(tags[mid].name));
+        if (cmp == 0) {
+            return tags[mid].tag;
+        } else if (cmp < 0) {
+            high = mid - 1;
+        } else {
+            low = mid + 1;
+        }
+    }
+
+    return UndefinedTag;
+}
+
+/*!
+	Reads the next token and resolves the element name of start and end elements to _tag.
+	readElementText() leaves the reader at the end element of the same element, so _tag stays
+	valid after it.
+*/
+void CAMusicXmlImport::readNextToken()
+{
+    readNext();
+    _tag = (tokenType() == StartElement || tokenType() == EndElement) ? tagFromName(name()) : UndefinedTag;
 }
 
 /*!
 	Opens a MusicXML source \a in and creates a document out of it.
 	CAMusicXmlImport uses QXmlStreamReader and SAX model for reading.
+
+	The progress is updated and the cancel request checked after each measure. When canceled, the
+	document read so far is returned.
 */
 CADocument* CAMusicXmlImport::importDocumentImpl()
 {
     QXmlStreamReader::setDevice(stream()->device());
 
-    while (!atEnd()) {
-        readNext();
+    while (!atEnd() && !isCanceled()) {
+        readNextToken();
 
         if (error()) {
             setStatus(-2);
@@ -92,10 +509,10 @@ CADocument* CAMusicXmlImport::importDocumentImpl()
             break;
         }
         case StartElement: {
-            if (name() == "score-partwise") {
+            if (_tag == ScorePartwiseTag) {
                 _musicXmlVersion = attributes().value("version").toString();
                 readScorePartwise();
-            } else if (name() == "score-timewise") {
+            } else if (_tag == ScoreTimewiseTag) {
                 _musicXmlVersion = attributes().value("version").toString();
                 readScoreTimewise();
             }
@@ -136,49 +553,70 @@ void CAMusicXmlImport::readHeader()
 
 void CAMusicXmlImport::readScorePartwise()
 {
-    if (name() != "score-partwise")
+    if (_tag != ScorePartwiseTag)
         return;
 
     _document = new CADocument();
 
-    while (!atEnd() && !(tokenType() == EndElement && name() == "score-partwise")) {
-        readNext();
+    while (!atEnd() && !isEndOf(ScorePartwiseTag) && !isCanceled()) {
+        readNextToken();
 
         if (tokenType() == StartElement) {
-            if (name() == "work") {
+            if (_tag == WorkTag) {
                 readWork();
-            } else if (name() == "movement-title") {
+            } else if (_tag == MovementTitleTag) {
                 _document->setTitle(readElementText());
-            } else if (name() == "identification") {
+            } else if (_tag == IdentificationTag) {
                 readIdentification();
-            } else if (name() == "defaults") {
+            } else if (_tag == DefaultsTag) {
                 readDefaults();
-            } else if (name() == "part-list") {
+            } else if (_tag == PartListTag) {
                 readPartList();
-            } else if (name() == "part") {
+            } else if (_tag == PartTag) {
                 readPart();
             }
         }
     }
 
-    for (int i = 0; i < _partMapStaff.keys().size(); i++) {
-        // go through all partIds
-        for (int j = 0; j < _partMapStaff[_partMapStaff.keys()[i]].size(); j++) {
-            // go through all staffs with this partId
-            CAStaff* s = _partMapStaff[_partMapStaff.keys()[i]][j];
+    finishParts();
+}
+
+/*!
+	Waits for all the parts to be converted and adds their staffs to the sheet in the document
+	order. The lyrics contexts of each staff are placed right below it. When the import is canceled,
+	the parts still queued are not converted.
+*/
+void CAMusicXmlImport::finishParts()
+{
+    for (CAMusicXmlPart* part : _parts) {
+        if (isCanceled()) {
+            part->cancel(); // the parts not converted yet are skipped
+        }
+        part->wait();
+    }
+
+    for (int i = 0; i < _parts.size(); i++) {
+        for (int j = 0; j < _parts[i]->staffList().size(); j++) {
+            CAStaff* s = _parts[i]->staffList()[j];
+            CASheet* sheet = s->sheet();
+            s->setName(tr("Staff%1").arg(sheet->staffList().size()));
+            sheet->addContext(s);
+
             for (int k = 0; k < s->voiceList().size(); k++) {
-                // go through all voices in this staff
-                // Note Reinhard: Not sure if program and channel cannot exceed 256, "int" is used everywhere
-                s->voiceList()[k]->setMidiProgram(_midiProgram[_partMapStaff.keys()[i]] - 1);
-                s->voiceList()[k]->setMidiChannel(_midiChannel[_partMapStaff.keys()[i]] - 1);
+                for (int l = 0; l < s->voiceList()[k]->lyricsContextList().size(); l++) {
+                    sheet->addContext(s->voiceList()[k]->lyricsContextList()[l]);
+                }
             }
         }
     }
+
+    qDeleteAll(_parts);
+    _parts.clear();
 }
 
 void CAMusicXmlImport::readScoreTimewise()
 {
-    if (name() != "score-timewise")
+    if (_tag != ScoreTimewiseTag)
         return;
 
     _document = new CADocument();
@@ -188,14 +626,14 @@ void CAMusicXmlImport::readScoreTimewise()
 
 void CAMusicXmlImport::readWork()
 {
-    if (name() != "work")
+    if (_tag != WorkTag)
         return;
 
-    while (!atEnd() && !(tokenType() == EndElement && name() == "work")) {
-        readNext();
+    while (!atEnd() && !isEndOf(WorkTag)) {
+        readNextToken();
 
         if (tokenType() == StartElement) {
-            if (name() == "work-title") {
+            if (_tag == WorkTitleTag) {
                 _document->setTitle(readElementText());
             }
         }
@@ -204,30 +642,29 @@ void CAMusicXmlImport::readWork()
 
 void CAMusicXmlImport::readDefaults()
 {
-    if (name() != "defaults")
+    if (_tag != DefaultsTag)
         return;
 
     // TODO: Currently this just ignores the defaults
-    while (!atEnd() && !(tokenType() == EndElement && name() == "defaults")) {
-        readNext();
-    }
+    skipCurrentElement();
+    _tag = DefaultsTag;
 }
 
 void CAMusicXmlImport::readIdentification()
 {
-    if (name() != "identification")
+    if (_tag != IdentificationTag)
         return;
 
-    while (!atEnd() && !(tokenType() == EndElement && name() == "identification")) {
-        readNext();
+    while (!atEnd() && !isEndOf(IdentificationTag)) {
+        readNextToken();
 
         if (tokenType() == StartElement) {
-            if (name() == "creator" && attributes().value("type") == "composer") {
+            if (_tag == CreatorTag && attributes().value("type") == "composer") {
                 _document->setComposer(readElementText());
-            } else if (name() == "creator" && attributes().value("type") == "lyricist") {
+            } else if (_tag == CreatorTag && attributes().value("type") == "lyricist") {
                 _document->setPoet(readElementText());
             }
-            if (name() == "rights") {
+            if (_tag == RightsTag) {
                 _document->setCopyright(readElementText());
             }
         }
@@ -236,27 +673,27 @@ void CAMusicXmlImport::readIdentification()
 
 void CAMusicXmlImport::readPartList()
 {
-    if (name() != "part-list")
+    if (_tag != PartListTag)
         return;
 
     _document->addSheet();
 
-    while (!atEnd() && !(tokenType() == EndElement && name() == "part-list")) {
-        readNext();
+    while (!atEnd() && !isEndOf(PartListTag)) {
+        readNextToken();
 
         if (tokenType() == StartElement) {
             QString partId;
-            if (name() == "score-part") {
+            if (_tag == ScorePartTag) {
                 partId = attributes().value("id").toString();
 
-                while (!atEnd() && !(tokenType() == EndElement && name() == "score-part")) {
-                    readNext();
+                while (!atEnd() && !isEndOf(ScorePartTag)) {
+                    readNextToken();
 
-                    if (tokenType() == StartElement && name() == "part-name") {
+                    if (tokenType() == StartElement && _tag == PartNameTag) {
                         _partName[partId] = readElementText();
-                    } else if (tokenType() == StartElement && name() == "midi-channel") {
+                    } else if (tokenType() == StartElement && _tag == MidiChannelTag) {
                         _midiChannel[partId] = readElementText().toInt();
-                    } else if (tokenType() == StartElement && name() == "midi-program") {
+                    } else if (tokenType() == StartElement && _tag == MidiProgramTag) {
                         _midiProgram[partId] = readElementText().toInt();
                     }
                 }
@@ -265,329 +702,252 @@ void CAMusicXmlImport::readPartList()
     }
 }
 
+/*!
+	Reads the part into its intermediate form and starts converting it in the task scheduler.
+*/
 void CAMusicXmlImport::readPart()
 {
-    if (name() != "part")
+    if (_tag != PartTag)
         return;
 
+    if (_document->sheetList().isEmpty()) {
+        _document->addSheet();
+    }
+
     QString partId = attributes().value("id").toString();
-    _partMapStaff[partId] = QList<CAStaff*>();
-    addStavesIfNeeded(partId, 1);
-    _partMapClef[partId] = QHash<int, CAClef*>();
-    _partMapKeySig[partId] = QHash<int, CAKeySignature*>();
-    _partMapTimeSig[partId] = QHash<int, CATimeSignature*>();
+    CAMusicXmlPart* part = new CAMusicXmlPart(_document->sheetList()[0], _midiProgram.value(partId), _midiChannel.value(partId));
 
-    while (!atEnd() && !(tokenType() == EndElement && name() == "part")) {
-        readNext();
+    QIODevice* device = stream()->device();
+    while (!atEnd() && !isEndOf(PartTag) && !isCanceled()) {
+        readNextToken();
 
         if (tokenType() == StartElement) {
-            if (name() == "measure") {
-                readMeasure(partId);
+            if (_tag == MeasureTag) {
+                readMeasure(part);
+                if (device) {
+                    setProgress(device->pos(), device->size(), CAProgress::Bytes);
+                }
             }
         }
     }
+
+    _parts << part;
+    CATaskScheduler::instance()->start(part);
 }
 
-void CAMusicXmlImport::readMeasure(QString partId)
+void CAMusicXmlImport::readMeasure(CAMusicXmlPart* part)
 {
-    if (name() != "measure")
+    if (_tag != MeasureTag)
         return;
 
-    while (!atEnd() && !(tokenType() == EndElement && name() == "measure")) {
-        readNext();
+    while (!atEnd() && !isEndOf(MeasureTag)) {
+        readNextToken();
 
         if (tokenType() == StartElement) {
-            if (name() == "attributes") {
-                readAttributes(partId);
-            } else if (name() == "note") {
-                readNote(partId, _divisions[partId]);
-            } else if (name() == "forward") {
-                readForward(partId, _divisions[partId]);
-            } else if (name() == "direction") {
-
-            } else if (name() == "sound") {
-                readSound(partId);
+            if (_tag == AttributesTag) {
+                readAttributes(part);
+            } else if (_tag == NoteTag) {
+                readNote(part);
+            } else if (_tag == ForwardTag) {
+                readForward(part);
+            } else if (_tag == DirectionTag) {
+
+            } else if (_tag == SoundTag) {
+                readSound();
             }
         }
     }
 
     // Finish the measure (add barlines to all staffs)
-    for (int staffIdx = 0; staffIdx < _partMapStaff[partId].size(); staffIdx++) {
-        CAStaff* staff = _partMapStaff[partId][staffIdx];
-        int lastVoice = -1;
-        for (int i = 0; i < staff->voiceList().size(); i++) {
-            if (lastVoice == -1 || staff->voiceList()[lastVoice]->lastTimeEnd() < staff->voiceList()[i]->lastTimeEnd()) {
-                lastVoice = i;
-            }
-        }
-
-        if (lastVoice != -1) {
-            staff->voiceList()[lastVoice]->append(new CABarline(CABarline::Single, staff, 0));
-            staff->synchronizeVoices();
-        }
-    }
+    part->addEvent(CAMusicXmlEvent(CAMusicXmlEvent::MeasureEndEvent));
 }
 
-void CAMusicXmlImport::readAttributes(QString partId)
+void CAMusicXmlImport::readAttributes(CAMusicXmlPart* part)
 {
-    if (name() != "attributes")
+    if (_tag != AttributesTag)
         return;
 
     int staves = 1;
 
-    while (!atEnd() && !(tokenType() == EndElement && name() == "attributes")) {
-        readNext();
+    while (!atEnd() && !isEndOf(AttributesTag)) {
+        readNextToken();
 
         if (tokenType() == StartElement) {
-            if (name() == "divisions") {
+            if (_tag == DivisionsTag) {
 
-                _divisions[partId] = readElementText().toInt();
+                part->setDivisions(readElementText().toInt());
 
-            } else if (name() == "staves") {
+            } else if (_tag == StavesTag) {
                 staves = readElementText().toInt();
-            } else if (name() == "key") {
+            } else if (_tag == KeyTag) {
 
-                int accs = 0;
-                int number = (attributes().value("number").toString().isEmpty() ? 1 : attributes().value("number").toString().toInt());
-                CADiatonicKey::CAGender gender = CADiatonicKey::Major;
+                CAMusicXmlEvent e(CAMusicXmlEvent::KeySignatureEvent);
+                e.number = (attributes().value("number").toString().isEmpty() ? 1 : attributes().value("number").toString().toInt());
+                e.extra = CADiatonicKey::Major;
 
-                while (!atEnd() && !(tokenType() == EndElement && name() == "key")) {
-                    readNext();
+                while (!atEnd() && !isEndOf(KeyTag)) {
+                    readNextToken();
 
                     if (tokenType() == StartElement) {
-                        if (name() == "fifths") {
-                            accs = readElementText().toInt();
+                        if (_tag == FifthsTag) {
+                            e.value = readElementText().toInt();
                         }
-                        if (name() == "mode") {
-                            gender = CADiatonicKey::genderFromString(readElementText());
+                        if (_tag == ModeTag) {
+                            e.extra = CADiatonicKey::genderFromString(readElementText());
                         }
                     }
                 }
 
-                if (_partMapStaff[partId].size() >= number) {
-                    _partMapKeySig[partId][number] = new CAKeySignature(CADiatonicKey(accs, gender), _partMapStaff[partId][number - 1], 0);
-                } else {
-                    _partMapKeySig[partId][number] = new CAKeySignature(CADiatonicKey(accs, gender), nullptr, 0);
-                }
+                part->addEvent(e);
 
-            } else if (name() == "time") {
+            } else if (_tag == TimeTag) {
 
-                int beats = 1;
-                int beat = 1;
-                int number = (attributes().value("number").toString().isEmpty() ? 1 : attributes().value("number").toString().toInt());
+                CAMusicXmlEvent e(CAMusicXmlEvent::TimeSignatureEvent);
+                e.number = (attributes().value("number").toString().isEmpty() ? 1 : attributes().value("number").toString().toInt());
+                e.value = 1;
+                e.extra = 1;
 
-                while (!atEnd() && !(tokenType() == EndElement && name() == "time")) {
-                    readNext();
+                while (!atEnd() && !isEndOf(TimeTag)) {
+                    readNextToken();
 
                     if (tokenType() == StartElement) {
-                        if (name() == "beats") {
-                            beats = readElementText().toInt();
+                        if (_tag == BeatsTag) {
+                            e.value = readElementText().toInt();
                         }
-                        if (name() == "beat-type") {
-                            beat = readElementText().toInt();
+                        if (_tag == BeatTypeTag) {
+                            e.extra = readElementText().toInt();
                         }
                     }
                 }
 
-                if (_partMapStaff[partId].size() >= number) {
-                    _partMapTimeSig[partId][number] = new CATimeSignature(beats, beat, _partMapStaff[partId][number - 1], 0);
-                } else {
-                    _partMapTimeSig[partId][number] = new CATimeSignature(beats, beat, nullptr, 0);
-                }
+                part->addEvent(e);
 
-            } else if (name() == "clef") {
+            } else if (_tag == ClefTag) {
 
                 QString sign;
-                int number = (attributes().value("number").toString().isEmpty() ? 1 : attributes().value("number").toString().toInt());
+                CAMusicXmlEvent e(CAMusicXmlEvent::ClefEvent);
+                e.number = (attributes().value("number").toString().isEmpty() ? 1 : attributes().value("number").toString().toInt());
 
-                while (!atEnd() && !(tokenType() == EndElement && name() == "clef")) {
-                    readNext();
+                while (!atEnd() && !isEndOf(ClefTag)) {
+                    readNextToken();
 
                     if (tokenType() == StartElement) {
-                        if (name() == "sign") {
+                        if (_tag == SignTag) {
                             sign = readElementText();
                         }
                     }
                 }
 
-                CAClef::CAPredefinedClefType t;
                 if (sign == "G")
-                    t = CAClef::Treble; // only treble and bass clefs are supported for now
+                    e.value = CAClef::Treble; // only treble and bass clefs are supported for now
                 else if (sign == "F")
-                    t = CAClef::Bass;
+                    e.value = CAClef::Bass;
                 else
-                    t = CAClef::Undefined;
+                    e.value = CAClef::Undefined;
 
-                if (_partMapStaff[partId].size() >= number) {
-                    _partMapClef[partId][number] = new CAClef(t, _partMapStaff[partId][number - 1], 0);
-                } else {
-                    _partMapClef[partId][number] = new CAClef(t, nullptr, 0);
-                }
+                part->addEvent(e);
             }
         }
     }
 
-    addStavesIfNeeded(partId, staves);
+    CAMusicXmlEvent e(CAMusicXmlEvent::StavesEvent);
+    e.value = staves;
+    part->addEvent(e);
 }
 
-void CAMusicXmlImport::readNote(QString partId, int divisions)
+void CAMusicXmlImport::readNote(CAMusicXmlPart* part)
 {
-    if (name() != "note")
+    if (_tag != NoteTag)
         return;
 
-    bool isRest = false;
-    bool isPartOfChord = false;
-    bool tieStop = false;
-    int voice = 1;
-    int staff = 1;
-    CAPlayableLength length;
-    CADiatonicPitch pitch;
-    //CANote::CAStemDirection stem = CANote::StemPreferred;
-    int lyricsNumber = -1;
-    bool hyphen = false;
-    bool melisma = false;
-    QString lyricsText;
+    CAMusicXmlEvent e(CAMusicXmlEvent::NoteEvent);
+    int divisions = part->divisions();
 
     if (!divisions) {
         std::cerr << "CAMusicXmlImport::readNote()- Error: divisions is 0, setting to 8" << std::endl;
         divisions = 8;
     }
 
-    while (!atEnd() && !(tokenType() == EndElement && name() == "note")) {
-        readNext();
+    while (!atEnd() && !isEndOf(NoteTag)) {
+        readNextToken();
 
         if (tokenType() == StartElement) {
-            if (name() == "rest") {
-                isRest = true;
-            } else if (name() == "chord") {
-                isPartOfChord = true;
-            } else if (name() == "duration") {
+            if (_tag == RestTag) {
+                e.rest = true;
+            } else if (_tag == ChordTag) {
+                e.chord = true;
+            } else if (_tag == DurationTag) {
                 int duration = readElementText().toInt();
                 float fDivisions = divisions;
-                length = CAPlayableLength::timeLengthToPlayableLengthList(static_cast<int>((duration / fDivisions) * 256)).first();
-            } else if (name() == "stem") {
-                QString s = readElementText();
-                //if (s=="up") stem = CANote::StemUp;
-                //else if (s=="down") stem = CANote::StemDown;
-            } else if (name() == "pitch") {
+                e.length = CAPlayableLength::timeLengthToPlayableLengthList(static_cast<int>((duration / fDivisions) * 256)).first();
+            } else if (_tag == StemTag) {
+                readElementText(); // stem directions are not supported yet
+            } else if (_tag == PitchTag) {
                 int alter = 0;
                 QString step;
                 int octave = -1;
-                while (!atEnd() && !(tokenType() == EndElement && name() == "pitch")) {
-                    readNext();
+                while (!atEnd() && !isEndOf(PitchTag)) {
+                    readNextToken();
 
                     if (tokenType() == StartElement) {
-                        if (name() == "step") {
+                        if (_tag == StepTag) {
                             step = readElementText();
-                        } else if (name() == "octave") {
+                        } else if (_tag == OctaveTag) {
                             octave = readElementText().toInt();
-                        } else if (name() == "alter") {
+                        } else if (_tag == AlterTag) {
                             alter = readElementText().toInt();
                         }
                     }
                 }
 
-                pitch = CADiatonicPitch::diatonicPitchFromString(step);
-                pitch.setNoteName(pitch.noteName() + (octave * 7));
-                pitch.setAccs(static_cast<char>(alter));
-            } else if (name() == "voice") {
-                voice = readElementText().toInt();
-            } else if (name() == "staff") {
-                staff = readElementText().toInt();
-            } else if (name() == "lyric") {
-                lyricsNumber = 1;
+                e.pitch = CADiatonicPitch::diatonicPitchFromString(step);
+                e.pitch.setNoteName(e.pitch.noteName() + (octave * 7));
+                e.pitch.setAccs(static_cast<char>(alter));
+            } else if (_tag == VoiceTag) {
+                e.voice = readElementText().toInt();
+            } else if (_tag == StaffTag) {
+                e.staff = readElementText().toInt();
+            } else if (_tag == LyricTag) {
+                e.lyricsNumber = 1;
 
                 if (!attributes().value("number").isEmpty()) {
-                    lyricsNumber = attributes().value("number").toString().toInt();
+                    e.lyricsNumber = attributes().value("number").toString().toInt();
                 }
 
-                while (!atEnd() && !(tokenType() == EndElement && name() == "lyric")) {
-                    readNext();
+                while (!atEnd() && !isEndOf(LyricTag)) {
+                    readNextToken();
 
                     if (tokenType() == StartElement) {
-                        if (name() == "text") {
-                            lyricsText = readElementText();
-                        } else if (name() == "syllabic") {
-                            hyphen = (readElementText() == "begin" || readElementText() == "middle");
-                        } else if (name() == "extend") {
-                            melisma = true;
+                        if (_tag == TextTag) {
+                            e.lyricsText = readElementText();
+                        } else if (_tag == SyllabicTag) {
+                            QString syllabic = readElementText();
+                            e.hyphen = (syllabic == "begin" || syllabic == "middle");
+                        } else if (_tag == ExtendTag) {
+                            e.melisma = true;
                         }
                     }
                 }
-            } else if (name() == "tie") {
+            } else if (_tag == TieTag) {
                 if (attributes().value("type") == "stop") {
-                    tieStop = true;
+                    e.tieStop = true;
                 }
             }
         }
     }
 
-    CAVoice* v = addVoiceIfNeeded(partId, staff, voice);
-
-    // grace notes are not supported yet
-    if (length.musicLength() == CAPlayableLength::Undefined) {
-        // grace notes don't have musicLength set
-        return;
-    }
-
-    CAPlayable* p = nullptr;
-    if (!isRest) {
-        p = new CANote(pitch, length, v, 0);
-        if (_tempoBpm != -1) {
-            p->addMark(new CATempo(CAPlayableLength::Quarter, static_cast<uchar>(_tempoBpm), p));
-            _tempoBpm = -1;
-        }
-    } else {
-        p = new CARest(CARest::Normal, length, v, 0);
-    }
-
-    v->append(p, isPartOfChord);
-
-    // create ties
-    if (tieStop) {
-        CANote* noteEnd = static_cast<CANote*>(p);
-        CANote* noteStart = nullptr;
-        CANote* prevNote = v->previousNote(p->timeStart());
-        if (prevNote) {
-            QList<CANote*> prevChord = prevNote->getChord();
-            for (int i = 0; i < prevChord.size(); i++) {
-                if (static_cast<CANote*>(prevChord[i])->diatonicPitch() == noteEnd->diatonicPitch()) {
-                    noteStart = static_cast<CANote*>(prevChord[i]);
-                    break;
-                }
-            }
-        }
-
-        if (noteStart) {
-            CASlur* tie = new CASlur(CASlur::TieType, CASlur::SlurPreferred, v->staff(), noteStart, noteEnd);
-            noteStart->setTieStart(tie);
-            noteEnd->setTieEnd(tie);
-        }
+    // the tempo is attached to the first note after the <sound> element
+    if (!e.rest && e.length.musicLength() != CAPlayableLength::Undefined && _tempoBpm != -1) {
+        e.tempoBpm = _tempoBpm;
+        _tempoBpm = -1;
     }
 
-    // create lyrics
-    if (lyricsNumber != -1) {
-        while (lyricsNumber > v->lyricsContextList().size()) {
-            v->addLyricsContext(new CALyricsContext(v->name() + tr("Lyrics"), v->lyricsContextList().size() + 1, v));
-            int idx = 0;
-            if (v->lyricsContextList().size() == 1) {
-                // Add the first lyrics right below the staff
-                idx = _document->sheetList()[0]->contextList().indexOf(v->staff()) + 1;
-            } else {
-                // Add next lyrics below the last lyrics line
-                idx = _document->sheetList()[0]->contextList().indexOf(v->lyricsContextList().last()) + 1;
-            }
-            _document->sheetList()[0]->insertContext(idx, v->lyricsContextList().last());
-        }
-
-        v->lyricsContextList()[lyricsNumber - 1]->addSyllable(new CASyllable(lyricsText, hyphen, melisma, v->lyricsContextList()[lyricsNumber - 1], p->timeStart(), p->timeLength()));
-    }
+    part->addEvent(e);
 }
 
-void CAMusicXmlImport::readSound(QString partId)
+void CAMusicXmlImport::readSound()
 {
-    (void)partId;
-    if (name() != "sound")
+    if (_tag != SoundTag)
         return;
 
     if (!attributes().value("tempo").isEmpty()) {
@@ -595,105 +955,30 @@ void CAMusicXmlImport::readSound(QString partId)
     }
 }
 
-/*!
-	Assures that the given \a partId contains at least \a staves number of staves.
-	Adds new staves, if needed and assings any clefs, key signatures or time signatures in the buffer
-	to the new staff, if their number is the number of the new staff.
-*/
-void CAMusicXmlImport::addStavesIfNeeded(QString partId, int staves)
-{
-    for (int i = _partMapStaff[partId].size() + 1; i <= staves && staves > _partMapStaff[partId].size(); i++) {
-        CAStaff* s = new CAStaff(tr("Staff%1").arg(_document->sheetList()[0]->staffList().size()), _document->sheetList()[0]);
-        _document->sheetList()[0]->addContext(s);
-        _partMapStaff[partId].append(s);
-
-        if (_partMapKeySig[partId].contains(i)) {
-            _partMapKeySig[partId][i]->setContext(s);
-        }
-        if (_partMapTimeSig[partId].contains(i)) {
-            _partMapTimeSig[partId][i]->setContext(s);
-        }
-        if (_partMapClef[partId].contains(i)) {
-            _partMapClef[partId][i]->setContext(s);
-        }
-    }
-}
-
-/*!
-	Assures that the given \a partId and \a staff contains at least \a voice number of voices.
-	Adds new voices, if needed and adds any clefs, key signatures or time signatures in the buffer
-	to the new voice.
-*/
-CAVoice* CAMusicXmlImport::addVoiceIfNeeded(QString partId, int staff, int voice)
+void CAMusicXmlImport::readForward(CAMusicXmlPart* part)
 {
-    CAVoice* v = nullptr;
-    CAStaff* s = nullptr;
-
-    if (!_partMapVoice[partId].contains(voice)) {
-        s = _partMapStaff[partId][staff - 1];
-        v = new CAVoice(tr("Voice%1").arg(s->voiceList().size()), s);
-        if (!s->voiceList().size()) {
-            if (_partMapClef[partId].contains(staff)) {
-                v->append(_partMapClef[partId][staff]);
-            } else if (_partMapClef[partId].contains(1)) { // add the default clef
-                v->append(_partMapClef[partId][1]->clone(s));
-            }
-
-            if (_partMapKeySig[partId].contains(staff)) {
-                v->append(_partMapKeySig[partId][staff]);
-            } else if (_partMapKeySig[partId].contains(1)) { // add the default keysig
-                v->append(_partMapKeySig[partId][1]->clone(s));
-            }
-
-            if (_partMapTimeSig[partId].contains(staff)) {
-                v->append(_partMapTimeSig[partId][staff]);
-            } else if (_partMapTimeSig[partId].contains(1)) { // add the default timesig
-                v->append(_partMapTimeSig[partId][1]->clone(s));
-            }
-        }
-
-        s->addVoice(v);
-        s->synchronizeVoices();
-        _partMapVoice[partId][voice] = v;
-    } else {
-        v = _partMapVoice[partId][voice];
-        s = v->staff();
-    }
-
-    return v;
-}
-
-void CAMusicXmlImport::readForward(QString partId, int divisions)
-{
-    if (name() != "forward")
+    if (_tag != ForwardTag)
         return;
 
-    int voice = -1;
-    int length = -1;
-    int staff = 1;
+    CAMusicXmlEvent e(CAMusicXmlEvent::ForwardEvent);
+    e.voice = -1;
+    e.value = -1;
+    int divisions = part->divisions();
 
-    while (!atEnd() && !(tokenType() == EndElement && name() == "forward")) {
-        readNext();
+    while (!atEnd() && !isEndOf(ForwardTag)) {
+        readNextToken();
 
         if (tokenType() == StartElement) {
-            if (name() == "duration") {
+            if (_tag == DurationTag) {
                 float fDivisions = divisions;
-                length = static_cast<int>((readElementText().toInt() / fDivisions) * 256);
-            } else if (name() == "voice") {
-                voice = readElementText().toInt();
-            } else if (name() == "staff") {
-                staff = readElementText().toInt();
+                e.value = static_cast<int>((readElementText().toInt() / fDivisions) * 256);
+            } else if (_tag == VoiceTag) {
+                e.voice = readElementText().toInt();
+            } else if (_tag == StaffTag) {
+                e.staff = readElementText().toInt();
             }
         }
     }
 
-    if (voice != -1 && length != -1) {
-        CAVoice* v = addVoiceIfNeeded(partId, staff, voice);
-
-        QList<CARest*> hiddenRests = CARest::composeRests(length, v->lastTimeEnd(), v);
-
-        for (int i = 0; i < hiddenRests.size(); i++) {
-            v->append(hiddenRests[i]);
-        }
-    }
+    part->addEvent(e);
 }
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2008, Matevž Jekovec, Canorus development team
+	Copyright (c) 2008-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -9,22 +9,16 @@
 #define MUSICXMLIMPORT_H_
 
 #include <QHash>
-#include <QMultiHash>
-#include <QStack>
+#include <QList>
 #include <QString>
 #include <QXmlStreamReader>
 
 #include "import/import.h"
-#include "score/diatonicpitch.h"
-#include "score/playablelength.h"
 
 class CADocument;
 class CASheet;
 class CAStaff;
-class CAClef;
-class CAKeySignature;
-class CATimeSignature;
-class CATempo;
+class CAMusicXmlPart;
 
 class CAMusicXmlImport : public CAImport, private QXmlStreamReader {
 #ifndef SWIG
@@ -41,6 +35,60 @@ protected:
     CADocument* importDocumentImpl();
 
 private:
+    enum CATag {
+        UndefinedTag,
+        AlterTag,
+        AttributesTag,
+        BeatTypeTag,
+        BeatsTag,
+        ChordTag,
+        ClefTag,
+        CreatorTag,
+        DefaultsTag,
+        DirectionTag,
+        DivisionsTag,
+        DurationTag,
+        ExtendTag,
+        FifthsTag,
+        ForwardTag,
+        IdentificationTag,
+        KeyTag,
+        LyricTag,
+        MeasureTag,
+        MidiChannelTag,
+        MidiProgramTag,
+        ModeTag,
+        MovementTitleTag,
+        NoteTag,
+        OctaveTag,
+        PartTag,
+        PartListTag,
+        PartNameTag,
+        PitchTag,
+        RestTag,
+        RightsTag,
+        ScorePartTag,
+        ScorePartwiseTag,
+        ScoreTimewiseTag,
+        SignTag,
+        SoundTag,
+        StaffTag,
+        StavesTag,
+        StemTag,
+        StepTag,
+        SyllabicTag,
+        TextTag,
+        TieTag,
+        TimeTag,
+        VoiceTag,
+        WorkTag,
+        WorkTitleTag
+    };
+
+    static CATag tagFromName(const QStringRef& name);
+    void readNextToken();
+    inline bool isEndOf(CATag tag) { return tokenType() == EndElement && _tag == tag; }
+
     void initMusicXmlImport();
 
     void readHeader();
@@ -51,26 +99,21 @@ private:
     void readDefaults();
     void readPartList();
     void readPart();
-    void readMeasure(QString partId);
-    void readAttributes(QString partId);
-    void readNote(QString partId, int);
-    void readForward(QString partId, int);
-    void readSound(QString partId);
-    CAVoice* addVoiceIfNeeded(QString partId, int staff, int voice);
-    void addStavesIfNeeded(QString partId, int staves);
+    void readMeasure(CAMusicXmlPart* part);
+    void readAttributes(CAMusicXmlPart* part);
+    void readNote(CAMusicXmlPart* part);
+    void readForward(CAMusicXmlPart* part);
+    void readSound();
+    void finishParts();
 
     QString _musicXmlVersion;
+    CATag _tag; // tag of the current start or end element
 
     CADocument* _document;
-    QHash<QString, QHash<int, CAVoice*>> _partMapVoice; // part name -> map of voice number : voice
-    QHash<QString, QList<CAStaff*>> _partMapStaff; // part name -> list of staffs
-    QHash<QString, QHash<int, CAClef*>> _partMapClef; // part name -> map of staff number : last clef
-    QHash<QString, QHash<int, CAKeySignature*>> _partMapKeySig; // part name -> map of staff number : last keysig
-    QHash<QString, QHash<int, CATimeSignature*>> _partMapTimeSig; // part name -> map of staff number : last timesig
+    QList<CAMusicXmlPart*> _parts; // parts in the document order, converted in the task scheduler
     QHash<QString, int> _midiChannel; // 1-16
     QHash<QString, int> _midiProgram; // 1-128
     QHash<QString, QString> _partName;
-    QHash<QString, int> _divisions; // part name -> divisions
     int _tempoBpm; // current tempo buffer, append to first found note, set to -1 then
 };
 
@@ -6,10 +6,199 @@
 */
 
 #include "import/mxlimport.h"
+#include <QByteArray>
 #include <QDebug>
 #include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
 #include <iostream> // debug
 
+#define MINIZ_HEADER_FILE_ONLY
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
+#include "zip/miniz.h"
+
+/*!
+	\class CAZipEntryDevice
+	\brief Sequential read-only device which inflates a single zip archive member on the fly
+
+	The compressed data of the member is read from the archive file in small chunks and inflated
+	directly into the buffer of the reader, so the uncompressed member is never kept in memory or
+	extracted to the disk. Stored and deflated members are supported.
+*/
+class CAZipEntryDevice : public QIODevice {
+public:
+    CAZipEntryDevice(const QString& archive, const QString& entry);
+    ~CAZipEntryDevice();
+
+    bool open(OpenMode mode);
+    void close();
+    bool isSequential() const { return true; }
+    qint64 bytesAvailable() const { return _uncompressedLeft + QIODevice::bytesAvailable(); }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize);
+    qint64 writeData(const char*, qint64) { return -1; }
+
+private:
+    static const int CHUNK;
+
+    QFile _file;
+    QString _entry;
+    QByteArray _in; // compressed input buffer
+    mz_stream _strm;
+    bool _deflated;
+    bool _inflating; // _strm is initialized
+    qint64 _compressedLeft;
+    qint64 _uncompressedLeft;
+    mz_ulong _crc;
+    mz_ulong _expectedCrc;
+};
+
+const int CAZipEntryDevice::CHUNK = 65536;
+
+CAZipEntryDevice::CAZipEntryDevice(const QString& archive, const QString& entry)
+    : _file(archive)
+    , _entry(entry)
+    , _deflated(false)
+    , _inflating(false)
+    , _compressedLeft(0)
+    , _uncompressedLeft(0)
+    , _crc(MZ_CRC32_INIT)
+    , _expectedCrc(0)
+{
+    memset(&_strm, 0, sizeof(_strm));
+}
+
+CAZipEntryDevice::~CAZipEntryDevice()
+{
+    close();
+}
+
+/*!
+	Locates the member in the central directory and positions the archive file at its data.
+*/
+bool CAZipEntryDevice::open(OpenMode mode)
+{
+    if ((mode & QIODevice::WriteOnly) || !_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    mz_zip_archive zip;
+    mz_zip_archive_file_stat stat;
+    bool found = false;
+    memset(&zip, 0, sizeof(zip));
+    memset(&stat, 0, sizeof(stat));
+    if (mz_zip_reader_init_file(&zip, QFile::encodeName(_file.fileName()).constData(), 0)) {
+        int index = mz_zip_reader_locate_file(&zip, _entry.toUtf8().constData(), nullptr, 0);
+        found = (index >= 0 && mz_zip_reader_file_stat(&zip, static_cast<mz_uint>(index), &stat));
+        mz_zip_reader_end(&zip);
+    }
+
+    // only unencrypted stored or deflated members
+    if (!found || (stat.m_bit_flag & 1) || (stat.m_method != 0 && stat.m_method != MZ_DEFLATED)) {
+        _file.close();
+        return false;
+    }
+
+    // skip the local header, its name and extra field lengths may differ from the central directory
+    QByteArray header;
+    if (_file.seek(static_cast<qint64>(stat.m_local_header_ofs))) {
+        header = _file.read(30);
+    }
+    const uchar* h = reinterpret_cast<const uchar*>(header.constData());
+    if (header.size() != 30 || h[0] != 0x50 || h[1] != 0x4b || h[2] != 0x03 || h[3] != 0x04
+        || !_file.seek(static_cast<qint64>(stat.m_local_header_ofs) + 30 + (h[26] | (h[27] << 8)) + (h[28] | (h[29] << 8)))) {
+        _file.close();
+        return false;
+    }
+
+    _deflated = (stat.m_method == MZ_DEFLATED);
+    _compressedLeft = static_cast<qint64>(stat.m_comp_size);
+    _uncompressedLeft = static_cast<qint64>(stat.m_uncomp_size);
+    _expectedCrc = stat.m_crc32;
+    _crc = MZ_CRC32_INIT;
+
+    if (_deflated) {
+        memset(&_strm, 0, sizeof(_strm));
+        if (mz_inflateInit2(&_strm, -MZ_DEFAULT_WINDOW_BITS) != MZ_OK) {
+            _file.close();
+            return false;
+        }
+        _inflating = true;
+        _in.resize(CHUNK);
+    }
+
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+void CAZipEntryDevice::close()
+{
+    if (_inflating) {
+        mz_inflateEnd(&_strm);
+        _inflating = false;
+    }
+    _in.clear();
+    _file.close();
+    if (isOpen()) {
+        QIODevice::close();
+    }
+}
+
+qint64 CAZipEntryDevice::readData(char* data, qint64 maxSize)
+{
+    maxSize = qMin(qMin(maxSize, _uncompressedLeft), static_cast<qint64>(INT_MAX));
+    if (maxSize <= 0) {
+        return _uncompressedLeft ? 0 : -1;
+    }
+
+    qint64 read = 0;
+    if (!_deflated) {
+        read = _file.read(data, maxSize);
+        if (read <= 0) {
+            setErrorString(tr("Unexpected end of the archive"));
+            return -1;
+        }
+    } else {
+        _strm.next_out = reinterpret_cast<unsigned char*>(data);
+        _strm.avail_out = static_cast<unsigned int>(maxSize);
+        while (_strm.avail_out) {
+            if (!_strm.avail_in && _compressedLeft) {
+                qint64 n = _file.read(_in.data(), qMin(static_cast<qint64>(_in.size()), _compressedLeft));
+                if (n <= 0) {
+                    break;
+                }
+                _compressedLeft -= n;
+                _strm.next_in = reinterpret_cast<const unsigned char*>(_in.constData());
+                _strm.avail_in = static_cast<unsigned int>(n);
+            }
+
+            int ret = mz_inflate(&_strm, MZ_NO_FLUSH);
+            if (ret == MZ_STREAM_END || (ret != MZ_OK && ret != MZ_BUF_ERROR) || (ret == MZ_BUF_ERROR && !_strm.avail_in && !_compressedLeft)) {
+                break;
+            }
+        }
+        read = maxSize - _strm.avail_out;
+        if (!read) {
+            setErrorString(tr("Corrupted member %1 in the archive").arg(_entry));
+            return -1;
+        }
+    }
+
+    _uncompressedLeft -= read;
+    _crc = mz_crc32(_crc, reinterpret_cast<const unsigned char*>(data), static_cast<size_t>(read));
+    if (!_uncompressedLeft && _crc != _expectedCrc) {
+        setErrorString(tr("CRC error in member %1 of the archive").arg(_entry));
+        return -1;
+    }
+
+    return read;
+}
+
+const char* CAMXLImport::CONTAINER_FILE = "META-INF/container.xml";
+
 CAMXLImport::CAMXLImport(QTextStream* stream)
     : CAMusicXmlImport(stream)
 {
@@ -22,56 +211,78 @@ CAMXLImport::CAMXLImport(const QString stream)
 
 CAMXLImport::~CAMXLImport()
 {
+    delete _scoreDevice;
 }
 
+/*!
+	Reads the container description and imports the MusicXML score it points to.
+	The score is inflated straight from the archive into the MusicXML reader by CAZipEntryDevice
+	instead of extracting the archive to the temporary directory first.
+*/
 CADocument* CAMXLImport::importDocumentImpl()
 {
-    int arg = 2;
     _zipArchivePath = fileName();
-    // Extract whole archive to temp folder
-    zip_extract(fileName().toLatin1().constData(), QDir::tempPath().toLatin1().constData(), [](const char* filename, void* arg) {
-        static int i = 0;
-        int n = *static_cast<int*>(arg);
-        qDebug().noquote() << "Extracted: " << filename << "(" << ++i << " of " << n << ")\n";
 
-        return 0;
-    },
-        &arg);
-
-    QFileInfo containerInfo(QDir::tempPath() + QString("/META-INF/container.xml"));
+    QByteArray container;
     QString musicXMLFileName;
-    bool eocRes = openContainer(containerInfo);
-    if (eocRes) {
-        eocRes = readContainerInfo(musicXMLFileName);
-        QFileInfo musicXMLFileInfo(QDir::tempPath() + "/" + musicXMLFileName);
-        if (musicXMLFileInfo.exists()) {
-            setStreamFromFile(musicXMLFileInfo.filePath());
-            return CAMusicXmlImport::importDocumentImpl();
-        }
-        qDebug() << "Failed to find musicxml file " << musicXMLFileInfo.filePath() << " in archive";
+    if (!readContainer(container)) {
+        qDebug() << "Failed to find container file " << CONTAINER_FILE << " in archive";
+        setStatus(-1);
+        return nullptr;
+    }
+
+    QTextStream containerStream(&container, QIODevice::ReadOnly);
+    if (!readContainerInfo(containerStream, musicXMLFileName)) {
+        setStatus(-1);
+        return nullptr;
+    }
+
+    delete _scoreDevice;
+    _scoreDevice = new CAZipEntryDevice(_zipArchivePath, musicXMLFileName);
+    if (!_scoreDevice->open(QIODevice::ReadOnly)) {
+        qDebug() << "Failed to find musicxml file " << musicXMLFileName << " in archive";
+        setStatus(-1);
+        return nullptr;
     }
-    return nullptr;
+
+    setStreamFromDevice(_scoreDevice);
+    return CAMusicXmlImport::importDocumentImpl();
 }
 
-bool CAMXLImport::openContainer(const QFileInfo& containerInfo)
+/*!
+	Inflates the small container description of the archive into \a container.
+*/
+bool CAMXLImport::readContainer(QByteArray& container)
 {
-    if (containerInfo.exists()) {
-        setStreamFromFile(containerInfo.filePath());
-    } else {
-        qDebug() << "Failed to find container file " << containerInfo.filePath() << " in archive";
+    struct zip_t* zip = zip_open(QFile::encodeName(_zipArchivePath).constData(), 0, 'r');
+    if (!zip) {
         return false;
     }
-    return true;
+
+    void* buf = nullptr;
+    size_t size = 0;
+    bool ok = (zip_entry_open(zip, CONTAINER_FILE) == 0);
+    if (ok) {
+        ok = (zip_entry_read(zip, &buf, &size) == 0);
+        if (ok) {
+            container = QByteArray(static_cast<const char*>(buf), static_cast<int>(size));
+            free(buf);
+        }
+        zip_entry_close(zip);
+    }
+    zip_close(zip);
+
+    return ok;
 }
 
-bool CAMXLImport::readContainerInfo(QString& musicXMLFileName)
+bool CAMXLImport::readContainerInfo(QTextStream& container, QString& musicXMLFileName)
 {
     QString containerLine, rootFileLine, mediaTypeLine, fullPathLine;
     do {
-        containerLine = stream()->readLine();
+        containerLine = container.readLine();
         if (containerLine.contains("<rootfiles")) {
             do { // No check for <rootfile> to make logic easier (strictly it's required)
-                rootFileLine = stream()->readLine();
+                rootFileLine = container.readLine();
                 if (rootFileLine.contains("full-path")) {
                     fullPathLine = rootFileLine;
                     if (mediaTypeLine.contains("application/vnd.recordare.musicxml+xml")) {
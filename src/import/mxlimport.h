@@ -28,11 +28,14 @@ protected:
     CADocument* importDocumentImpl();
 
 private:
-    bool openContainer(const QFileInfo& containerInfo);
-    bool readContainerInfo(QString& musicXMLFileName);
+    static const char* CONTAINER_FILE; // name of the container description in the archive
+
+    bool readContainer(QByteArray& container);
+    bool readContainerInfo(QTextStream& container, QString& musicXMLFileName);
 
     QTextStream* _txtStream = nullptr;
     QString _zipArchivePath;
+    QIODevice* _scoreDevice = nullptr; // inflates the score from the archive while it is read
 };
 
 #endif /* MUSICXMLIMPORT_H_ */
@@ -0,0 +1,219 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QVector>
+
+#include "interface/audition.h"
+#include "interface/mididevice.h"
+#include "score/note.h"
+#include "score/voice.h"
+
+#include <algorithm>
+
+namespace {
+
+const int VOLUME = 100;
+const int VELOCITY = 127;
+
+void sendMessage(CAMidiDevice* midiDevice, unsigned char status, unsigned char data)
+{
+    QVector<unsigned char> message;
+    message << status << data;
+    midiDevice->send(message, 0);
+}
+
+void sendMessage(CAMidiDevice* midiDevice, unsigned char status, unsigned char data1, unsigned char data2)
+{
+    QVector<unsigned char> message;
+    message << status << data1 << data2;
+    midiDevice->send(message, 0);
+}
+
+}
+
+/*!
+	\class CAAudition
+	\brief Persistent thread sounding the notes while they are being entered
+
+	CAMainWin plays each inserted note or changed pitch by play(). The notes are copied into
+	a command queue and the thread, which starts on the first play() and keeps running until the
+	audition is destroyed, sends them right away. The output port stays open meanwhile, so fast
+	step-entry doesn't pay for a thread start or opening the port on each note.
+
+	Overlapping auditions are mixed: each sounding key is turned off at its own end. A key struck
+	again while still sounding is retriggered and keeps sounding for the new duration. The
+	program and volume are only sent, when the channel's program changes.
+
+	The sheet playback sends to the same device, so call stop() before starting it.
+
+	\sa CAPlayback
+*/
+
+CAAudition::CAAudition(CAMidiDevice* midiDevice)
+    : _midiDevice(midiDevice)
+    , _silence(false)
+    , _quit(false)
+{
+    setObjectName("Audition");
+}
+
+/*!
+	Turns off the sounding notes and finishes the thread.
+*/
+CAAudition::~CAAudition()
+{
+    _mutex.lock();
+    _quit = true;
+    _commandsAvailable.wakeOne();
+    _mutex.unlock();
+
+    wait();
+}
+
+/*!
+	Sounds the notes of \a elts on the output \a port. Other elements are ignored.
+	Returns immediately, the notes are played and turned off by the audition thread.
+
+	Must be called from the main thread, which also opens and closes the port for the playback.
+*/
+void CAAudition::play(const QList<CAMusElement*>& elts, int port)
+{
+    QList<CAAuditionNote> notes;
+    for (CAMusElement* elt : elts) {
+        if (elt->musElementType() != CAMusElement::Note) {
+            continue;
+        }
+
+        CANote* note = static_cast<CANote*>(elt);
+        CAAuditionNote n;
+        n.channel = note->voice()->midiChannel();
+        n.program = note->voice()->midiProgram();
+        n.pitch = static_cast<unsigned char>(CADiatonicPitch::diatonicPitchToMidiPitch(note->diatonicPitch()) + note->voice()->midiPitchOffset());
+        n.msecs = note->timeLength() * 4;
+        notes << n;
+    }
+
+    if (notes.isEmpty()) {
+        return;
+    }
+
+    _midiDevice->openOutputPort(port); // does nothing when already open
+
+    QMutexLocker locker(&_mutex);
+    _commands << notes;
+    if (isRunning()) {
+        _commandsAvailable.wakeOne();
+    } else {
+        start(QThread::TimeCriticalPriority);
+    }
+}
+
+/*!
+	Turns off all the sounding notes and drops the queued ones. Blocks until the note offs are
+	sent.
+*/
+void CAAudition::stop()
+{
+    QMutexLocker locker(&_mutex);
+    _commands.clear();
+    if (!isRunning()) {
+        return;
+    }
+
+    _silence = true;
+    _commandsAvailable.wakeOne();
+    while (_silence) {
+        _silenced.wait(&_mutex);
+    }
+}
+
+void CAAudition::run()
+{
+    // key of a channel currently sounding
+    struct CASoundingKey {
+        unsigned char channel;
+        unsigned char pitch;
+        qint64 end; // in miliseconds of the clock
+    };
+
+    QList<CASoundingKey> sounding;
+    int programs[16]; // program sent to each channel, -1 if unknown
+    std::fill(programs, programs + 16, -1);
+    QElapsedTimer clock;
+    clock.start();
+
+    QMutexLocker locker(&_mutex);
+    while (true) {
+        if (_silence || _quit) {
+            for (const CASoundingKey& key : sounding) {
+                sendMessage(_midiDevice, CAMidiDevice::Midi_Note_Off + key.channel, key.pitch, VELOCITY);
+            }
+            sounding.clear();
+            std::fill(programs, programs + 16, -1); // the playback may change them meanwhile
+
+            if (_quit) {
+                return;
+            }
+            _silence = false;
+            _silenced.wakeAll();
+        }
+
+        QList<CAAuditionNote> commands;
+        commands.swap(_commands);
+        locker.unlock();
+
+        qint64 now = clock.elapsed();
+        for (const CAAuditionNote& note : commands) {
+            unsigned char channel = note.channel & 0x0f;
+            if (programs[channel] != note.program) {
+                sendMessage(_midiDevice, CAMidiDevice::Midi_Prog_Change + channel, note.program);
+                sendMessage(_midiDevice, CAMidiDevice::Midi_Control_Chg + channel, CAMidiDevice::Midi_Ctl_Volume, VOLUME);
+                programs[channel] = note.program;
+            }
+
+            bool retriggered = false;
+            for (CASoundingKey& key : sounding) {
+                if (key.channel == channel && key.pitch == note.pitch) {
+                    sendMessage(_midiDevice, CAMidiDevice::Midi_Note_Off + channel, note.pitch, VELOCITY);
+                    key.end = now + note.msecs;
+                    retriggered = true;
+                    break;
+                }
+            }
+            if (!retriggered) {
+                CASoundingKey key;
+                key.channel = channel;
+                key.pitch = note.pitch;
+                key.end = now + note.msecs;
+                sounding << key;
+            }
+            sendMessage(_midiDevice, CAMidiDevice::Midi_Note_On + channel, note.pitch, VELOCITY);
+        }
+
+        qint64 nextEnd = -1;
+        for (int i = 0; i < sounding.size(); i++) {
+            if (sounding[i].end <= now) {
+                sendMessage(_midiDevice, CAMidiDevice::Midi_Note_Off + sounding[i].channel, sounding[i].pitch, VELOCITY);
+                sounding.removeAt(i--);
+            } else if (nextEnd < 0 || sounding[i].end < nextEnd) {
+                nextEnd = sounding[i].end;
+            }
+        }
+
+        locker.relock();
+        if (!_commands.isEmpty() || _silence || _quit) {
+            continue;
+        }
+        if (nextEnd < 0) {
+            _commandsAvailable.wait(&_mutex);
+        } else {
+            _commandsAvailable.wait(&_mutex, static_cast<unsigned long>(qMax<qint64>(1, nextEnd - clock.elapsed())));
+        }
+    }
+}
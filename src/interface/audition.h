@@ -0,0 +1,50 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef AUDITION_H_
+#define AUDITION_H_
+
+#include <QList>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+class CAMidiDevice;
+class CAMusElement;
+
+class CAAudition : public QThread {
+public:
+    CAAudition(CAMidiDevice* midiDevice);
+    ~CAAudition();
+
+    void play(const QList<CAMusElement*>& elts, int port);
+    void stop();
+
+    inline CAMidiDevice* midiDevice() { return _midiDevice; }
+
+protected:
+    void run();
+
+private:
+    // Note to be auditioned, copied from the score so the thread never touches the elements
+    struct CAAuditionNote {
+        unsigned char channel;
+        unsigned char program;
+        unsigned char pitch; // midi pitch, voice offset applied
+        int msecs; // duration
+    };
+
+    CAMidiDevice* _midiDevice;
+    QMutex _mutex; // guards the members below
+    QWaitCondition _commandsAvailable;
+    QWaitCondition _silenced;
+    QList<CAAuditionNote> _commands; // notes queued by play() and not yet started
+    bool _silence; // stop() was called, all the notes are turned off
+    bool _quit;
+};
+
+#endif /* AUDITION_H_ */
@@ -7,7 +7,6 @@
 */
 
 #include <QObject>
-#include <iostream> //debugging
 
 #include "canorus.h"
 #include "core/muselementfactory.h"
@@ -16,6 +15,7 @@
 #include "interface/keybdinput.h"
 #include "interface/mididevice.h"
 #include "layout/drawablestaff.h"
+#include "score/accidentalstate.h"
 #include "score/interval.h"
 #include "widgets/menutoolbutton.h"
 
@@ -31,7 +31,8 @@ class CAMenuToolButton;
 	the alsa midi port of your midi keyboard. When in input mode, when a voice and a duration
 	is selected, notes can be entered with the midi keyboard too.
 
-	Key strockes within 100 ms will be combined into a chord.
+	Key strockes within 100 ms will be combined into a chord. The chord is inserted as a whole when the
+	chord timer times out, so it is a single undo step and the score is rebuilt only once.
 
 	Accents are set according the current key pitch. Automatic tracking of the scene is done too.
 
@@ -46,6 +47,7 @@ CAKeybdInput::CAKeybdInput(CAMainWin* mw)
     // Initialize keyboad input chord timer
     _midiInChordTimer.stop();
     _midiInChordTimer.setSingleShot(true);
+    QObject::connect(&_midiInChordTimer, &QTimer::timeout, [this]() { flushMidiIn(); });
     _tupPla = nullptr;
     _tup = nullptr;
     _lastMidiInVoice = nullptr;
@@ -59,225 +61,254 @@ CAKeybdInput::~CAKeybdInput()
 {
 }
 
+/*!
+	Collects the note on events. The first one starts the chord timer and all the notes received until
+	it times out are inserted at once by flushMidiIn().
+*/
 void CAKeybdInput::onMidiInEvent(QVector<unsigned char> m)
 {
-    unsigned char event, velocity;
-    std::cout << "MidiInEvent: ";
-    for (int i = 0; i < m.size(); i++)
-        std::cout << static_cast<int>(m[i]) << " ";
-    std::cout << std::endl;
     if (m.size() < 3) // only note on/off here which are 3 bytes
         return;
-    event = m[0];
-    velocity = m[2];
+    unsigned char event = m[0];
+    unsigned char velocity = m[2];
     if (event == CAMidiDevice::Midi_Note_On && velocity != 0) {
-        //CADiatonicPitch x = CADiatonicPitch::diatonicPitchFromMidiPitch( m[1] );
-        midiInEventToScore(_mw->currentScoreView(), m);
+        _midiInPitches << m[1];
+        if (!_midiInChordTimer.isActive()) {
+            _midiInChordTimer.start(100); // Notes max 100 ms apart will form a chord
+        }
     }
 }
 
 /*!
-	This is the entry point the midi input device. All note on events are passed over here.
+	Inserts the notes collected since the chord timer was started.
 */
-void CAKeybdInput::midiInEventToScore(CAScoreView* v, QVector<unsigned char> m)
+void CAKeybdInput::flushMidiIn()
 {
+    QList<int> pitches = _midiInPitches;
+    _midiInPitches.clear();
 
-    int i;
-    CADiatonicPitch p = CADiatonicPitch::diatonicPitchFromMidiPitch(m[1]);
-    CADiatonicPitch nonenharmonicPitch;
+    if (!pitches.isEmpty() && _mw->currentScoreView()) {
+        midiInEventToScore(_mw->currentScoreView(), pitches);
+    }
+}
 
-    CAVoice* voice = _mw->currentVoice();
-    if (voice) {
-
-        int cpitch = m[1];
-        /*
-
-		// will publish this only when it's configurable. Have only a four octave keyboard ...
-
-		CAPlayableLength plength = CAPlayableLength::Undefined;
-		switch (cpitch) {
-		case 39:	plength = CAPlayableLength::Whole;		break;
-		case 40:	plength = CAPlayableLength::Half;		break;
-		case 41:	plength = CAPlayableLength::Quarter;	break;
-		case 42:	plength = CAPlayableLength::Eighth;		break;
-		case 43:	plength = CAPlayableLength::Sixteenth;	break;
-		default:	;
-		}
-		if (plength !=  CAPlayableLength::Undefined) {
-			_mw->uiPlayableLength->setCurrentId( plength.musicLength(), true );
-			_mw->musElementFactory()->playableLength().setDotted( 0 );
-			v->setShadowNoteLength( _mw->musElementFactory()->playableLength() );
-			v->updateHelpers();
-			v->repaint();
-			return;
-		}
+/*!
+	This is the entry point the midi input device. The note on events received within the chord
+	timer are passed over here as a list of midi \a pitches. The first pitch is inserted as a new
+	note and the others are added to its chord.
 
+	The whole chord is inserted as a single undo step and the score is rebuilt once.
 */
+void CAKeybdInput::midiInEventToScore(CAScoreView* v, QList<int> pitches)
+{
+    CAVoice* voice = _mw->currentVoice();
+    if (!voice) {
+        return;
+    }
 
-        CADrawableContext* drawableContext = v->currentContext();
-        CAStaff* staff = nullptr;
-        //CADrawableStaff *drawableStaff = nullptr;
-        if (drawableContext) {
-            //drawableStaff = dynamic_cast<CADrawableStaff*>(drawableContext);
-            staff = dynamic_cast<CAStaff*>(drawableContext->context());
-        }
+    CADrawableContext* drawableContext = v->currentContext();
+    CAStaff* staff = nullptr;
+    if (drawableContext) {
+        staff = dynamic_cast<CAStaff*>(drawableContext->context());
+    }
+
+    // we create undo only for chords as a whole
+    CACanorus::undo()->createUndoCommand(_mw->document(), QObject::tr("insert midi note", "undo"), voice->staff());
 
-        CANote* note = nullptr;
-        CARest* rest = nullptr;
-
-        switch (cpitch) {
-            //		case 37:	std::cout << "  Pause" << std::endl;
-            //					rest = new CARest( CARest::Normal, _mw->musElementFactory()->playableLength(), voice, 0, -1 );
-            //					break;
-            //		case 38:	_mw->uiTupletType->defaultAction()->setChecked( !_mw->uiTupletType->isChecked() );
-            //					return;
-        default:
-            nonenharmonicPitch = matchPitchToKey(voice, p);
-            note = new CANote(nonenharmonicPitch, _mw->musElementFactory()->playableLength(), voice, -1);
+    int timeStart = -1;
+    for (int i = 0; i < pitches.size(); i++) {
+        CAMusElement* elt = insertMidiNote(voice, staff, pitches[i], i > 0);
+        if (elt && (timeStart == -1 || elt->timeStart() < timeStart)) {
+            timeStart = elt->timeStart();
         }
+    }
+    int timeEnd = voice->lastTimeEnd();
 
-        // if notes come in sufficiently close together we make a chord of them
-        bool appendToChord = _midiInChordTimer.isActive();
+    voice->synchronizeMusElements(); // probably not needed
 
-        // we create undo only for chords as a whole
-        if (!appendToChord)
-            CACanorus::undo()->createUndoCommand(_mw->document(), QObject::tr("insert midi note", "undo"));
+    CACanorus::undo()->pushUndoCommand();
 
-        // If we are still in the processing of a tuplet, check if it's still there.
-        // Possibly editing on the GUI could have moved it around or away, and no crash please.
-        if (_tupPla && (!voice->musElementList().contains(_tupPla) || _tupPla->tuplet() != _tup))
-            _tupPla = nullptr;
+    // now we try to highlight the inserted note/chord by selection:
+    v->clearSelection(); // remove old note/chord from selection
+    if (voice->lastMusElement()) {
+        QList<CAPlayable*> lp = voice->getChord(voice->lastMusElement()->timeStart());
+        QList<CAMusElement*> lme;
+        for (int i = 0; i < lp.size(); i++)
+            lme << static_cast<CAMusElement*>(lp[i]);
+        v->addToSelection(lme);
+    }
 
-        // Where to put the note? When in a tuplet, do a chord in the tuplet or the nex not in the tuplet.
-        if (_tupPla && !appendToChord) {
-            _tupPla = _tup->nextTimed(_tupPla);
-        }
+    // scene tracking
+    QRectF scene = v->worldCoords();
+    double xlast = v->timeToCoordsSimpleVersion(voice->lastTimeStart());
+    if (((xlast + 50) > scene.right())) { // the magic number 50 should be defined, ist the width of an element
+        scene.translate(scene.width() / 2, 0);
+        v->setWorldCoords(scene, false, true);
+    }
+    v->updateHelpers();
+    v->repaint();
+    if (timeStart == -1) {
+        CACanorus::rebuildUI(_mw->document(), _mw->currentSheet());
+    } else {
+        CACanorus::rebuildUI(_mw->document(), _mw->currentSheet(), timeStart, timeEnd);
+    }
+}
 
-        if (_tupPla) {
-            // next note in tuplet
-            if (note) {
-                _tupPla = voice->insertInTupletAndVoiceAt(_tupPla, note);
-                _tup = _tupPla->tuplet();
-            }
-        } else if (_mw->uiTupletType->isChecked()) {
-            // start a new tuplet
-            QList<CAPlayable*> elements;
-            if (note) {
-                elements << static_cast<CAPlayable*>(note);
-            } else
-                elements << static_cast<CAPlayable*>(rest);
-            for (int i = 1; i < _mw->uiTupletNumber->value(); i++) {
-                _mw->musElementFactory()->configureRest(voice, nullptr);
-                elements << static_cast<CAPlayable*>(_mw->musElementFactory()->musElement());
-            }
-            _tup = new CATuplet(_mw->uiTupletNumber->value(), _mw->uiTupletActualNumber->value(), elements);
-            _tupPla = _tup->firstNote();
-        } else {
-            // insert just a note
-            if (note) {
-
-                //voice->append( note, appendToChord );
-                if (appendToChord && _noteLayout.size()) {
-                    CANote* prevNote = nullptr;
-                    for (i = 0; i < _noteLayout.size(); i++) {
-                        note = new CANote(nonenharmonicPitch, static_cast<CAPlayable*>(_noteLayout[i])->playableLength(), voice, -1);
-                        voice->insert(_noteLayout[i], note, appendToChord);
-                        if (i > 0) {
-                            _mw->musElementFactory()->configureSlur(staff, prevNote, note);
-                        }
-                        prevNote = note;
-                    }
-                } else {
-                    if (note) {
-                        delete note;
-                    }
+/*!
+	Inserts a single note of the given \a midiPitch into the \a voice. If \a appendToChord is True, the
+	note is added to the chord inserted last.
 
-                    //CAMusElement *elt = voice->lastMusElement();
-                    CABarline* b = static_cast<CABarline*>(voice->previousByType(CAMusElement::Barline,
-                        voice->lastMusElement()));
-                    //CABarline *b = static_cast<CABarline*>(
-                    //	voice->lastPlayableElt()->voice()->previousByType( CAMusElement::Barline, voice->lastMusElement() ));
-                    CATimeSignature* ts = static_cast<CATimeSignature*>(
-                        voice->previousByType(CAMusElement::TimeSignature, voice->lastPlayableElt()));
-                    QList<CAPlayableLength> lll;
-                    CAPlayableLength px;
-                    lll << px.matchToBars(_mw->musElementFactory()->playableLength(), voice->lastTimeEnd(), b, ts);
-                    CANote* prevNote = nullptr;
-                    _noteLayout.clear();
-                    for (i = 0; i < lll.size(); i++) {
-
-                        note = new CANote(nonenharmonicPitch, lll[i], voice, -1);
-                        voice->append(note, appendToChord);
-                        _noteLayout.append(voice->lastMusElement());
-                        std::cout << " -- " << lll[i].musicLength() << "." << lll[i].dotted();
-                        CAStaff::placeAutoBar(note);
-                        if (i > 0) {
-                            _mw->musElementFactory()->configureSlur(staff, prevNote, note);
-                        }
-                        prevNote = note;
+	Returns the first inserted element or null, if nothing was inserted.
+*/
+CAMusElement* CAKeybdInput::insertMidiNote(CAVoice* voice, CAStaff* staff, int midiPitch, bool appendToChord)
+{
+    int i;
+    CADiatonicPitch p = CADiatonicPitch::diatonicPitchFromMidiPitch(midiPitch);
+    CADiatonicPitch nonenharmonicPitch;
+    CAMusElement* inserted = nullptr;
+
+    /*
+
+	// will publish this only when it's configurable. Have only a four octave keyboard ...
+
+	CAPlayableLength plength = CAPlayableLength::Undefined;
+	switch (midiPitch) {
+	case 39:	plength = CAPlayableLength::Whole;		break;
+	case 40:	plength = CAPlayableLength::Half;		break;
+	case 41:	plength = CAPlayableLength::Quarter;	break;
+	case 42:	plength = CAPlayableLength::Eighth;		break;
+	case 43:	plength = CAPlayableLength::Sixteenth;	break;
+	default:	;
+	}
+	if (plength !=  CAPlayableLength::Undefined) {
+		_mw->uiPlayableLength->setCurrentId( plength.musicLength(), true );
+		_mw->musElementFactory()->playableLength().setDotted( 0 );
+		v->setShadowNoteLength( _mw->musElementFactory()->playableLength() );
+		v->updateHelpers();
+		v->repaint();
+		return;
+	}
+
+*/
+
+    CANote* note = nullptr;
+    CARest* rest = nullptr;
+
+    switch (midiPitch) {
+        //		case 37:	std::cout << "  Pause" << std::endl;
+        //					rest = new CARest( CARest::Normal, _mw->musElementFactory()->playableLength(), voice, 0, -1 );
+        //					break;
+        //		case 38:	_mw->uiTupletType->defaultAction()->setChecked( !_mw->uiTupletType->isChecked() );
+        //					return;
+    default:
+        nonenharmonicPitch = matchPitchToKey(voice, p);
+        note = new CANote(nonenharmonicPitch, _mw->musElementFactory()->playableLength(), voice, -1);
+    }
+
+    // If we are still in the processing of a tuplet, check if it's still there.
+    // Possibly editing on the GUI could have moved it around or away, and no crash please.
+    if (_tupPla && (!voice->musElementList().contains(_tupPla) || _tupPla->tuplet() != _tup))
+        _tupPla = nullptr;
+
+    // Where to put the note? When in a tuplet, do a chord in the tuplet or the nex not in the tuplet.
+    if (_tupPla && !appendToChord) {
+        _tupPla = _tup->nextTimed(_tupPla);
+    }
+
+    if (_tupPla) {
+        // next note in tuplet
+        if (note) {
+            _tupPla = voice->insertInTupletAndVoiceAt(_tupPla, note);
+            _tup = _tupPla->tuplet();
+            inserted = _tupPla;
+        }
+    } else if (_mw->uiTupletType->isChecked()) {
+        // start a new tuplet
+        QList<CAPlayable*> elements;
+        if (note) {
+            elements << static_cast<CAPlayable*>(note);
+        } else
+            elements << static_cast<CAPlayable*>(rest);
+        for (int i = 1; i < _mw->uiTupletNumber->value(); i++) {
+            _mw->musElementFactory()->configureRest(voice, nullptr);
+            elements << static_cast<CAPlayable*>(_mw->musElementFactory()->musElement());
+        }
+        _tup = new CATuplet(_mw->uiTupletNumber->value(), _mw->uiTupletActualNumber->value(), elements);
+        _tupPla = _tup->firstNote();
+        inserted = _tupPla;
+    } else {
+        // insert just a note
+        if (note) {
+
+            if (appendToChord && _noteLayout.size()) {
+                CANote* prevNote = nullptr;
+                for (i = 0; i < _noteLayout.size(); i++) {
+                    note = new CANote(nonenharmonicPitch, static_cast<CAPlayable*>(_noteLayout[i])->playableLength(), voice, -1);
+                    voice->insert(_noteLayout[i], note, appendToChord);
+                    if (i > 0) {
+                        _mw->musElementFactory()->configureSlur(staff, prevNote, note);
+                    } else {
+                        inserted = note;
                     }
-                    std::cout << " -- " << std::endl;
+                    prevNote = note;
                 }
-
             } else {
-                delete rest;
+                if (note) {
+                    delete note;
+                }
+
                 CABarline* b = static_cast<CABarline*>(voice->previousByType(CAMusElement::Barline,
                     voice->lastMusElement()));
                 CATimeSignature* ts = static_cast<CATimeSignature*>(
                     voice->previousByType(CAMusElement::TimeSignature, voice->lastPlayableElt()));
-                CAPlayableLength pr;
-                QList<CAPlayableLength> rests;
-                rests << pr.matchToBars(_mw->musElementFactory()->playableLength(), voice->lastTimeEnd(), b, ts);
-                for (i = 0; i < rests.size(); i++) {
-                    rest = new CARest(CARest::Normal, rests[i], voice, 0, -1);
-                    voice->append(rest, false);
+                QList<CAPlayableLength> lll;
+                CAPlayableLength px;
+                lll << px.matchToBars(_mw->musElementFactory()->playableLength(), voice->lastTimeEnd(), b, ts);
+                CANote* prevNote = nullptr;
+                _noteLayout.clear();
+                for (i = 0; i < lll.size(); i++) {
+
+                    note = new CANote(nonenharmonicPitch, lll[i], voice, -1);
+                    voice->append(note, false);
+                    _noteLayout.append(voice->lastMusElement());
+                    CAStaff::placeAutoBar(note);
+                    if (i > 0) {
+                        _mw->musElementFactory()->configureSlur(staff, prevNote, note);
+                    } else {
+                        inserted = note;
+                    }
+                    prevNote = note;
                 }
             }
-        }
-
-        // We make shure not to try to place a barline inside a chord or inside a tuplet
-        if (CACanorus::settings()->autoBar() && !appendToChord && (!_tupPla || _tupPla->isFirstInTuplet())) {
-            if (note)
-                CAStaff::placeAutoBar(note);
-            else
-                CAStaff::placeAutoBar(rest);
-        }
-
-        voice->synchronizeMusElements(); // probably not needed
-
-        CACanorus::undo()->pushUndoCommand();
 
-        // now we try to highlight the inserted note/chord by selection:
-        if (!appendToChord) {
-            v->clearSelection(); // remove old note/chord from selection
-        }
-        QList<CAPlayable*> lp = voice->getChord(voice->lastMusElement()->timeStart());
-        QList<CAMusElement*> lme;
-        for (int i = 0; i < lp.size(); i++)
-            lme << static_cast<CAMusElement*>(lp[i]);
-        _mw->currentScoreView()->addToSelection(lme);
-
-        // When I looking the last appended note is note showing up. Where goes it missing?
-        // Still without a clue. georg
-        // QList<CADrawableMusElement*> list = v->selection();
-        // std::cout << " Selektierte Elemente: " << list.size() << " Stück, oben "<<lp.size()<<" und "<<lme.size() << std::endl;
-
-        // scene tracking
-        QRectF scene = v->worldCoords();
-        double xlast = v->timeToCoordsSimpleVersion(voice->lastTimeStart());
-        if (((xlast + 50) > scene.right())) { // the magic number 50 should be defined, ist the width of an element
-            scene.translate(scene.width() / 2, 0);
-            v->setWorldCoords(scene, false, true);
+        } else {
+            delete rest;
+            CABarline* b = static_cast<CABarline*>(voice->previousByType(CAMusElement::Barline,
+                voice->lastMusElement()));
+            CATimeSignature* ts = static_cast<CATimeSignature*>(
+                voice->previousByType(CAMusElement::TimeSignature, voice->lastPlayableElt()));
+            CAPlayableLength pr;
+            QList<CAPlayableLength> rests;
+            rests << pr.matchToBars(_mw->musElementFactory()->playableLength(), voice->lastTimeEnd(), b, ts);
+            for (i = 0; i < rests.size(); i++) {
+                rest = new CARest(CARest::Normal, rests[i], voice, 0, -1);
+                voice->append(rest, false);
+                if (!inserted) {
+                    inserted = rest;
+                }
+            }
         }
-        v->updateHelpers();
-        v->repaint();
-        CACanorus::rebuildUI(_mw->document(), _mw->currentSheet());
+    }
 
-        // start timer eventually for chord detection
-        if (!_midiInChordTimer.isActive()) {
-            _midiInChordTimer.start(100); // Notes max 100 ms apart will form a chord
-        }
+    // We make shure not to try to place a barline inside a chord or inside a tuplet
+    if (CACanorus::settings()->autoBar() && !appendToChord && (!_tupPla || _tupPla->isFirstInTuplet())) {
+        if (note)
+            CAStaff::placeAutoBar(note);
+        else
+            CAStaff::placeAutoBar(rest);
     }
+
+    return inserted;
 }
 
 /*!
@@ -317,8 +348,21 @@ CADiatonicPitch CAKeybdInput::matchPitchToKey(CAVoice* voice, CADiatonicPitch p)
     CADiatonicPitch f = p + CAInterval(CAInterval::Diminished, CAInterval::Second);
     CADiatonicPitch s = p - CAInterval(CAInterval::Diminished, CAInterval::Second);
 
-    // If the pitch appears in the keys scale we are done
-    if (p.accs() == _actualKeySignatureAccs[p.noteName() % 7]) {
+    // If the pitch, or its enharmonic pitch, needs no accidental in the bar we are done
+    // eg. des after a des in the same bar, instead of cis
+    if (voice->staff()) {
+        CAAccidentalState state(voice->staff());
+        int time = voice->lastTimeEnd();
+        if (state.isInEffect(p, time)) {
+            return p;
+        }
+        if (state.isInEffect(f, time)) {
+            return f;
+        }
+        if (state.isInEffect(s, time)) {
+            return s;
+        }
+    } else if (p.accs() == _actualKeySignatureAccs[p.noteName() % 7]) {
         return p;
     }
     // When the key is with flats we don't want sharps
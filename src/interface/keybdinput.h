@@ -24,8 +24,11 @@ public:
 
 private:
     CAMainWin* _mw;
-    void midiInEventToScore(CAScoreView* v, QVector<unsigned char> m);
+    void flushMidiIn();
+    void midiInEventToScore(CAScoreView* v, QList<int> pitches);
+    CAMusElement* insertMidiNote(CAVoice* voice, CAStaff* staff, int midiPitch, bool appendToChord);
     QTimer _midiInChordTimer;
+    QList<int> _midiInPitches; // pitches of the note on events waiting for _midiInChordTimer
     //CASheet *_lastMidiInSheet;
     //CAStaff *_lastMidiInStaff;
     CAVoice* _lastMidiInVoice;
@@ -31,11 +31,17 @@ QStringList CAMidiDevice::GM_INSTRUMENTS = QStringList() <<
 	of the non-real-time Midi classes. It needs also the time to write the
 	midi event to a file.
 
+	Real-time devices may sound later than the message is sent, eg. USB synthesizers and software
+	instruments. The outputLatency() is set for each output port from the settings (see
+	CAMidiLatencyCalibration) and CAPlayback sends the messages earlier by it, while the playback
+	cursor stays aligned with the sound.
+
 	\warning MIDI INPUT is not available for Swig and therefore scripting languages yet.
 */
 
 CAMidiDevice::CAMidiDevice()
     : QObject()
+    , _outputLatency(0)
 {
 }
 
@@ -73,6 +73,8 @@ public:
     inline CAMidiDeviceType midiDeviceType() { return _midiDeviceType; }
 
     bool isRealTime() { return _realTime; }
+    inline int outputLatency() { return _outputLatency; }
+    inline void setOutputLatency(int msecs) { _outputLatency = msecs; }
     virtual QMap<int, QString> getOutputPorts() = 0;
     virtual QMap<int, QString> getInputPorts() = 0;
 
@@ -83,9 +85,14 @@ public:
     virtual void send(QVector<unsigned char> message, int time) = 0; // message and absolute canorus time (independent of tempo)
     virtual void sendMetaEvent(int time, char event, char a, char b, int c) = 0; // absolute time of the meta event which is meant only for midi file export
 
+    virtual bool openExtraOutputPort(int) { return false; } // opens another output port next to the one of openOutputPort(), closed by closeOutputPort()
+    virtual void sendToPort(int, QVector<unsigned char> message, int time) { send(message, time); } // sends to the extra output port, the default one for -1 or a closed port
+    virtual int portLatency(int) { return outputLatency(); } // output latency of the extra port in miliseconds
+
 #ifndef SWIG
 signals:
     void midiInEvent(QVector<unsigned char> message);
+    void timedMidiInEvent(QVector<unsigned char> message, qint64 time); // time of arrival in nanoseconds, see CATrace::now()
 #endif
 
 protected:
@@ -93,6 +100,7 @@ protected:
     inline void setMidiDeviceType(CAMidiDeviceType t) { _midiDeviceType = t; }
     CAMidiDeviceType _midiDeviceType;
     bool _realTime; // is the device
+    int _outputLatency; // in miliseconds, the playback sends the messages earlier by this
 
 private:
     static QStringList GM_INSTRUMENTS;
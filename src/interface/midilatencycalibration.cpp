@@ -0,0 +1,135 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include "interface/midilatencycalibration.h"
+#include "core/trace.h"
+#include "interface/mididevice.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+const int CAMidiLatencyCalibration::CLICKS = 16;
+const int CAMidiLatencyCalibration::SKIPPED_CLICKS = 4;
+const int CAMidiLatencyCalibration::INTERVAL = 600;
+
+/*!
+	\class CAMidiLatencyCalibration
+	\brief Measures the output latency of a MIDI port
+
+	The calibration plays CLICKS side stick clicks on the percussion channel of the open output port
+	of the \a device, one each INTERVAL miliseconds. The player taps any key of the MIDI keyboard
+	along with the clicks they hear. The clicks can also be routed back to the MIDI input by a
+	loopback cable or a synthesizer echoing its input, then no one needs to tap.
+
+	Each tap received by CAMidiDevice::timedMidiInEvent() is matched to the nearest click and the
+	median of the delays between sending the clicks and hearing them is the measured latency. The
+	first SKIPPED_CLICKS clicks are not measured, while the player gets into the rhythm. The result
+	includes the input latency and the reaction of the player, which are small compared to the
+	latency of the typical USB synthesizers and software instruments.
+
+	finished() is emitted with the latency, which is stored by CASettings::setMidiOutLatency() for
+	the port and used by CAPlayback through CAMidiDevice::outputLatency().
+*/
+
+CAMidiLatencyCalibration::CAMidiLatencyCalibration(CAMidiDevice* device, QObject* parent)
+    : QObject(parent)
+    , _device(device)
+{
+    _timer.setInterval(INTERVAL);
+    _timer.setTimerType(Qt::PreciseTimer);
+    connect(&_timer, SIGNAL(timeout()), this, SLOT(click()));
+    connect(_device, SIGNAL(timedMidiInEvent(QVector<unsigned char>, qint64)), this, SLOT(midiIn(QVector<unsigned char>, qint64)));
+}
+
+CAMidiLatencyCalibration::~CAMidiLatencyCalibration()
+{
+    stop();
+}
+
+/*!
+	Starts playing the clicks. The output port of the device must be open.
+*/
+void CAMidiLatencyCalibration::start()
+{
+    _clicks.clear();
+    _taps.clear();
+    _timer.start();
+    click();
+}
+
+/*!
+	Stops the calibration without emitting finished().
+*/
+void CAMidiLatencyCalibration::stop()
+{
+    if (_timer.isActive()) {
+        _timer.stop();
+        sendNote(0);
+    }
+}
+
+void CAMidiLatencyCalibration::click()
+{
+    sendNote(0); // the previous click
+
+    if (_clicks.size() == CLICKS) {
+        _timer.stop();
+        emit finished(latency());
+        return;
+    }
+
+    _clicks << CATrace::now();
+    sendNote(100);
+    emit clicked(_clicks.size());
+}
+
+void CAMidiLatencyCalibration::midiIn(QVector<unsigned char> message, qint64 time)
+{
+    if (_timer.isActive() && message.size() >= 3 && (message[0] & 0xf0) == CAMidiDevice::Midi_Note_On && message[2]) {
+        _taps << time;
+    }
+}
+
+/*!
+	Returns the latency in miliseconds measured from the taps so far or -1, if fewer than half of
+	the measured clicks were tapped.
+*/
+int CAMidiLatencyCalibration::latency()
+{
+    QVector<qint64> delays;
+    for (qint64 tap : _taps) {
+        bool matched = false;
+        qint64 delay = 0; // from the nearest click
+        for (int i = SKIPPED_CLICKS; i < _clicks.size(); i++) {
+            if (!matched || std::llabs(tap - _clicks[i]) < std::llabs(delay)) {
+                delay = tap - _clicks[i];
+                matched = true;
+            }
+        }
+
+        // early taps and taps out of the rhythm are ignored
+        if (matched && delay >= 0 && delay < INTERVAL * 500000LL) {
+            delays << delay;
+        }
+    }
+
+    if (delays.size() < (CLICKS - SKIPPED_CLICKS) / 2) {
+        return -1;
+    }
+
+    std::sort(delays.begin(), delays.end());
+    return static_cast<int>(delays[delays.size() / 2] / 1000000);
+}
+
+void CAMidiLatencyCalibration::sendNote(unsigned char velocity)
+{
+    QVector<unsigned char> message;
+    message << (CAMidiDevice::Midi_Note_On + 9); // percussion channel
+    message << 37; // side stick
+    message << velocity;
+    _device->send(message, 0);
+}
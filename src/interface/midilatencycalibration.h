@@ -0,0 +1,51 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef MIDILATENCYCALIBRATION_H_
+#define MIDILATENCYCALIBRATION_H_
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+class CAMidiDevice;
+
+class CAMidiLatencyCalibration : public QObject {
+    Q_OBJECT
+public:
+    CAMidiLatencyCalibration(CAMidiDevice* device, QObject* parent = nullptr);
+    virtual ~CAMidiLatencyCalibration();
+
+    void start();
+    void stop();
+
+    inline bool isRunning() { return _timer.isActive(); }
+    inline int clickCount() { return _clicks.size(); }
+    int latency();
+
+    static const int CLICKS; // number of clicks played
+    static const int SKIPPED_CLICKS; // first clicks not measured, the player gets into the rhythm
+    static const int INTERVAL; // between the clicks in miliseconds
+
+signals:
+    void clicked(int click);
+    void finished(int latency); // measured latency in miliseconds, -1 if there weren't enough taps
+
+private slots:
+    void click();
+    void midiIn(QVector<unsigned char> message, qint64 time);
+
+private:
+    void sendNote(unsigned char velocity);
+
+    CAMidiDevice* _device;
+    QTimer _timer;
+    QVector<qint64> _clicks; // send times of the clicks, see CATrace::now()
+    QVector<qint64> _taps; // arrival times of the note on messages
+};
+
+#endif /* MIDILATENCYCALIBRATION_H_ */
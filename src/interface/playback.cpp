@@ -1,16 +1,21 @@
 /*!
-	Copyright (c) 2006-2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
 */
 
+#include <QElapsedTimer>
+#include <QMutexLocker>
 #include <QPen>
 #include <QRect>
 #include <QVector> // needed for RtMidi send message
 
+#include <algorithm>
+#include <climits>
 #include <iostream>
 
+#include "core/trace.h"
 #include "interface/mididevice.h"
 #include "interface/playback.h"
 #include "score/barline.h"
@@ -38,15 +43,40 @@
 	   the sheet (usually used in scripting environment) and the midi device.
 	3) Optionally configure playback (setInitTimeStart() to start playback from the specific time. Default 0).
 	4) Call myPlaybackObject->run(). This will start playing in a new thread.
+	   Call seek() to continue playing from another time.
 	5) Call myPlaybackObject->stop() to stop the playback. Playback also stops automatically when finished.
 	6) Playback is also used for creating the events for midi file export. Therefore the music length time _curTime
 	   is also transferred as a paramter in send() and sendMetaEvent() to export the music lengths independent of tempo.
 
 	The playbackFinished() signal is emitted once playback has finished or stopped.
 
-	If you want to immediately play only given elements (eg. when inserting notes), call playImmediately().
+	If you want to immediately play only given elements, call playImmediately(). Notes being inserted are played
+	by CAAudition instead, which keeps its thread and the output port open between the notes.
 */
 
+const int CAPlayback::STOP_CHECK_INTERVAL = 10;
+
+namespace {
+
+/*!
+	Returns True, if the \a event moves the playback cursor instead of sending a message.
+*/
+inline bool isPlayableEvent(const CAPlaybackEvent& event)
+{
+    return event.type == CAPlaybackEvent::PlayableOn || event.type == CAPlaybackEvent::PlayableOff;
+}
+
+/*!
+	Returns the key of the midi \a channel of the output \a port in the controller changes and the
+	sounding notes. The default port is -1.
+*/
+inline int controlKey(int port, int channel)
+{
+    return (port + 1) * 16 + channel;
+}
+
+}
+
 CAPlayback::CAPlayback(CASheet* s, CAMidiDevice* m)
 {
     initPlayback();
@@ -87,6 +117,10 @@ void CAPlayback::initPlayback()
     _playSelectionOnly = false;
     _initTimeStart = 0;
     _sleepFactor = 1.0; // set by tempo to determine the miliseconds for sleep
+    _msecs = 0;
+    _seekTime.store(-1);
+    _maxLateness.store(0);
+    _playingGeneration.store(0);
 
     connect(this, SIGNAL(finished()), SLOT(stopNow()));
 }
@@ -122,20 +156,62 @@ void CAPlayback::playImmediately(QList<CAMusElement*> elts, int port)
     }
 }
 
+/*!
+	Continues the playback from the first time the sheet \a time is played. The playback controller
+	state (program and volume) at that point is restored.
+
+	This can be called from any thread while playing. The seek is done by the playback thread.
+*/
+void CAPlayback::seek(int time)
+{
+    _seekTime.store(qMax(time, 0));
+}
+
+/*!
+	Returns a copy of the notes and rests currently playing.
+	This can be called from any thread. Use playingGeneration() to check whether the list changed
+	since the last call, without locking.
+*/
+QList<CAPlayable*> CAPlayback::curPlaying()
+{
+    QMutexLocker locker(&_curPlayingMutex);
+    return _curPlaying;
+}
+
+/*!
+	Plays the sheet or the immediate elements.
+
+	The sheet is compiled into a timeline of midi events first (see compileTimeline()), unless
+	timeline() was called already. Call timeline() from the main thread before starting the
+	playback, so the playback thread doesn't read the score while it is being edited. The events
+	are then dispatched at their real times measured by a monotonic clock, so the work done per event
+	does not accumulate into the playback timing. Non real-time devices (eg. midi export) receive all
+	the events at once.
+
+	For real-time devices the thread runs at the time critical priority, if the system allows it.
+	Each event sent after its deadline is recorded as a "CAPlayback lateness" zone in CATrace, so
+	the lateness statistics can be inspected in the saved trace.
+
+	The voices routed to other output ports than the default one (see CAVoice::midiPort()) are
+	played by the additional ports of the device, each with its own output thread, see
+	CAMidiDevice::openExtraOutputPort(). The messages of each port are sent earlier than the
+	playable events by the output latency of the port (see CAMidiDevice::portLatency()), so the
+	playback cursor, which follows curPlaying(), moves when the notes are heard on all the
+	synthesizers.
+*/
 void CAPlayback::run()
 {
+    CA_TRACE_ZONE("CAPlayback::run");
     if (_playSelectionOnly) {
         playSelectionImpl();
         return;
     }
 
-    // list of all the music element lists (ie. streams) taken from all the contexts
-    QList<QList<CAMusElement*>> stream;
-    QVector<unsigned char> message; // midi 3-byte message sent to midi device
-
-    // initializes all the streams, indices, repeat barlines etc.
+    // initializes all the streams, indices, repeat barlines and generates the events
     if (!streamList().size()) {
         initStreams(sheet());
+        if (streamList().size())
+            compileTimeline();
     }
 
     if (!streamList().size())
@@ -143,23 +219,191 @@ void CAPlayback::run()
     else
         setStop(false);
 
+    int i = 0;
+    if (getInitTimeStart() > 0) {
+        i = seekEvent(getInitTimeStart());
+        restoreControls(i);
+    }
+    double startMsecs = (i < _timeline.size() ? _timeline[i].msecs : 0);
+
+    // each output port gets its own lane of messages, sent ahead by the port latency, so all the synthesizers sound in time with the cursor
+    QVector<int> lanePorts; // output port of each message lane, the playable events are in the last lane
+    lanePorts << -1 << _ports;
+    int latency = 0; // largest latency of the ports, the playback cursor is delayed by it
+    QVector<int> laneDelays;
+    if (midiDevice()->isRealTime()) {
+        for (int port : _ports) {
+            midiDevice()->openExtraOutputPort(port);
+        }
+        for (int port : lanePorts) {
+            latency = qMax(latency, midiDevice()->portLatency(port));
+        }
+    }
+    for (int port : lanePorts) {
+        laneDelays << (midiDevice()->isRealTime() ? latency - midiDevice()->portLatency(port) : 0);
+    }
+    laneDelays << latency;
+    const int cursorLane = laneDelays.size() - 1;
+    QVector<int> next(laneDelays.size(), i); // next timeline event of each lane
+
+    if (midiDevice()->isRealTime()) {
+        setPriority(QThread::TimeCriticalPriority); // ignored, if not allowed by the system
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    qint64 traceOffset = CATrace::now() - clock.nsecsElapsed(); // trace time of the clock start
+
+    while (!_stop) {
+        int seekTime = _seekTime.fetchAndStoreOrdered(-1);
+        if (seekTime >= 0) {
+            switchOffPlaying();
+            i = seekEvent(seekTime);
+            next.fill(i);
+            restoreControls(i);
+            startMsecs = (i < _timeline.size() ? _timeline[i].msecs : 0);
+            clock.restart();
+            traceOffset = CATrace::now() - clock.nsecsElapsed();
+            continue;
+        }
+
+        // the earliest next event of all the lanes, in the timeline order when simultaneous
+        int lane = -1;
+        for (int l = 0; l < next.size(); l++) {
+            while (next[l] < _timeline.size() && (isPlayableEvent(_timeline[next[l]]) ? cursorLane : qMax(lanePorts.indexOf(_timeline[next[l]].port), 0)) != l) {
+                next[l]++;
+            }
+            if (next[l] < _timeline.size()) {
+                double due = _timeline[next[l]].msecs + laneDelays[l];
+                if (lane == -1 || due < _timeline[next[lane]].msecs + laneDelays[lane] || (due == _timeline[next[lane]].msecs + laneDelays[lane] && next[l] < next[lane])) {
+                    lane = l;
+                }
+            }
+        }
+        if (lane == -1) {
+            break;
+        }
+        const CAPlaybackEvent& event = _timeline[next[lane]];
+
+        if (midiDevice()->isRealTime()) {
+            // sleep in short steps to react to stop() and seek() in time
+            qint64 deadline = qRound64((event.msecs + laneDelays[lane] - startMsecs) * 1000000);
+            qint64 delay;
+            while (!_stop && _seekTime.load() < 0 && (delay = deadline - clock.nsecsElapsed()) > 0) {
+                usleep(static_cast<ulong>(qMin(delay / 1000 + 1, static_cast<qint64>(STOP_CHECK_INTERVAL) * 1000)));
+            }
+            if (_stop)
+                break;
+            if (_seekTime.load() >= 0)
+                continue;
+
+            // lateness of the event is traced as a zone from its deadline until it is sent
+            qint64 lateness = clock.nsecsElapsed() - deadline;
+            if (lateness > 0) {
+                if (CATrace::isEnabled()) {
+                    CATrace::record("CAPlayback lateness", traceOffset + deadline, CATrace::now());
+                }
+
+                // the largest lateness is shown as the timing jitter in the performance panel
+                int late = static_cast<int>(qMin(lateness / 1000, static_cast<qint64>(INT_MAX)));
+                int max = _maxLateness.load();
+                while (late > max && !_maxLateness.testAndSetOrdered(max, late)) {
+                    max = _maxLateness.load();
+                }
+            }
+        }
+
+        switch (event.type) {
+        case CAPlaybackEvent::Message:
+            midiDevice()->sendToPort(event.port, event.message, event.time);
+            if (event.message.size() >= 3 && (event.message[0] & 0xe0) == 0x80) {
+                int note = controlKey(event.port, event.message[0] & 0x0f) * 128 + (event.message[1] & 0x7f);
+                if ((event.message[0] & 0xf0) == 0x90 && event.message[2]) {
+                    _sounding << note;
+                } else if (_sounding.contains(note)) {
+                    _sounding.remove(_sounding.indexOf(note));
+                }
+            }
+            break;
+        case CAPlaybackEvent::MetaEvent:
+            midiDevice()->sendMetaEvent(event.time, event.metaEvent, event.a, event.b, event.c);
+            break;
+        case CAPlaybackEvent::PlayableOn: {
+            QMutexLocker locker(&_curPlayingMutex);
+            _curPlaying << event.playable;
+            _playingGeneration.ref();
+            break;
+        }
+        case CAPlaybackEvent::PlayableOff: {
+            QMutexLocker locker(&_curPlayingMutex);
+            _curPlaying.removeOne(event.playable);
+            _playingGeneration.ref();
+            break;
+        }
+        }
+
+        next[lane]++;
+    }
+
+    switchOffPlaying();
+    stop();
+}
+
+/*!
+	Switches off the notes still playing, when the playback is stopped or seeks to another time.
+	The notes are known from the sent timeline events, so the score isn't read by the playback
+	thread.
+*/
+void CAPlayback::switchOffPlaying()
+{
+    QVector<unsigned char> message;
+    for (int note : _sounding) {
+        message << (128 + note / 128 % 16); // note off
+        message << static_cast<uchar>(note % 128);
+        message << (127);
+        midiDevice()->sendToPort(note / 128 / 16 - 1, message, _curTime);
+        message.clear();
+    }
+    _sounding.clear();
+
+    QMutexLocker locker(&_curPlayingMutex);
+    _curPlaying.clear();
+    _playingGeneration.ref();
+}
+
+/*!
+	Walks the streams created by initStreams() and generates the timeline of midi events for the
+	whole sheet including the repeats. Real times of the events are computed from the tempo marks
+	in the score. Times, channels and pitches of the elements are read from the event store.
+
+	The timeline is always compiled from the beginning of the sheet. The seek points and controller
+	changes recorded along the way are used to start playing at any time without walking the streams
+	again.
+
+	\sa run()
+*/
+void CAPlayback::compileTimeline()
+{
+    QList<int> playing; // rows of the playables sounding at the current time
+    QVector<unsigned char> message; // midi 3-byte message sent to midi device
+
+    bool finished = false;
     int minLength = -1;
-    int mSeconds = 0; // actual song time, used when creating a midi file
-    while (!_stop || _curPlaying.size()) { // at stop true: enter to switch all notes off
-        for (int i = 0; i < _curPlaying.size(); i++) {
-            if (_stop || _curPlaying[i]->timeEnd() <= _curTime) {
+    while (!finished || playing.size()) { // at finished true: enter to switch all notes off
+        for (int i = 0; i < playing.size(); i++) {
+            int row = playing[i];
+            if (finished || _events.timeEnd(row) <= _curTime) {
                 // note off
-                CANote* note = dynamic_cast<CANote*>(_curPlaying[i]);
-                if (note) {
-                    message << (128 + note->voice()->midiChannel()); // note off
-                    message << static_cast<uchar>(CADiatonicPitch::diatonicPitchToMidiPitch(note->diatonicPitch()) + note->voice()->midiPitchOffset());
+                if (_events.flags(row) & CAEventStore::Note) {
+                    message << (128 + _events.channel(row)); // note off
+                    message << _events.pitch(row);
                     message << (127);
-                    if ((note->musElementType() != CAMusElement::Rest) && // first because rest has no tie
-                        !(note->tieStart() && note->tieStart()->noteEnd()))
-                        midiDevice()->send(message, _curTime);
+                    if (!(_events.flags(row) & CAEventStore::TieStart))
+                        addMessage(message, voicePort(_events.playable(row)->voice()), _events.playable(row));
                     message.clear();
                 }
-                _curPlaying.removeAt(i--);
+                addPlayableEvent(CAPlaybackEvent::PlayableOff, _events.playable(row));
+                playing.removeAt(i--);
             }
         }
 
@@ -167,97 +411,217 @@ void CAPlayback::run()
             loopUntilPlayable(i);
         }
 
-        if (_stop)
+        if (finished)
             continue; // no notes on anymore
 
+        addSeekPoint();
+
         minLength = -1;
         for (int i = 0; i < streamList().size(); i++) {
 
-            while (streamAt(i).size() > streamIdx(i) && streamAt(i).at(streamIdx(i))->timeStart() == _curTime) {
+            while (streamAt(i).size() > streamIdx(i) && _events.time(_events.row(i, streamIdx(i))) == _curTime) {
+                int row = _events.row(i, streamIdx(i));
+                CAMusElement* me = _events.element(row);
 
                 // check if a rest carries a tempo mark
-                CAMusElement* me = streamAt(i).at(streamIdx(i));
                 if (me->musElementType() == CAMusElement::Rest) {
-                    for (int j = 0; j < me->markList().size(); j++) {
-                        if (me->markList()[j]->markType() == CAMark::Tempo) {
-                            CATempo* tempo = static_cast<CATempo*>(me->markList()[j]);
-                            midiDevice()->sendMetaEvent(_curTime, CAMidiDevice::Meta_Tempo, static_cast<char>(tempo->bpm()), 0, 0);
-                        }
+                    for (CATempo* tempo : me->marksOfType<CATempo>(CAMark::Tempo)) {
+                        updateSleepFactor(tempo);
+                        addMetaEvent(CAMidiDevice::Meta_Tempo, static_cast<char>(tempo->bpm()), 0, 0);
                     }
                 }
 
                 // note on
-
-                CANote* note = dynamic_cast<CANote*>(streamAt(i).at(streamIdx(i)));
-                if (note) {
-                    QVector<unsigned char> message;
-
-                    // send dynamic information
-                    for (int j = 0; j < note->markList().size(); j++) {
-                        if (note->markList()[j]->markType() == CAMark::Dynamic) {
-                            message << (176 + note->voice()->midiChannel()); // set volume
-                            message << (CAMidiDevice::Midi_Ctl_Volume /* 7 */);
-                            message << static_cast<uchar>(qRound(127 * static_cast<CADynamic*>(note->markList()[j])->volume() / 100.0));
-                            midiDevice()->send(message, _curTime);
-                            message.clear();
-                        } else if (note->markList()[j]->markType() == CAMark::InstrumentChange) {
-                            message << (192 + note->voice()->midiChannel()); // change program
-                            message << static_cast<unsigned char>(static_cast<CAInstrumentChange*>(note->markList()[j])->instrument());
-                            midiDevice()->send(message, _curTime);
-                            message.clear();
-                        } else if (note->markList()[j]->markType() == CAMark::Tempo) {
-                            updateSleepFactor(static_cast<CATempo*>(note->markList()[j]));
-                            CATempo* tempo = static_cast<CATempo*>(note->markList()[j]);
-                            midiDevice()->sendMetaEvent(_curTime, CAMidiDevice::Meta_Tempo, tempo->bpm(), 0, 0);
+                if (_events.flags(row) & CAEventStore::Note) {
+                    const int port = voicePort(_events.playable(row)->voice());
+
+                    // send dynamic information, most of the notes have none
+                    const quint32 playedMarks = CAMark::markTypeBit(CAMark::Dynamic) | CAMark::markTypeBit(CAMark::InstrumentChange) | CAMark::markTypeBit(CAMark::Tempo);
+                    if (me->markTypes() & playedMarks) {
+                        for (CAMark* mark : me->markList()) {
+                            if (mark->markType() == CAMark::Dynamic) {
+                                message << (176 + _events.channel(row)); // set volume
+                                message << (CAMidiDevice::Midi_Ctl_Volume /* 7 */);
+                                message << static_cast<uchar>(qRound(127 * static_cast<CADynamic*>(mark)->volume() / 100.0));
+                                addMessage(message, port);
+                                message.clear();
+                            } else if (mark->markType() == CAMark::InstrumentChange) {
+                                message << (192 + _events.channel(row)); // change program
+                                message << static_cast<unsigned char>(static_cast<CAInstrumentChange*>(mark)->instrument());
+                                addMessage(message, port);
+                                message.clear();
+                            } else if (mark->markType() == CAMark::Tempo) {
+                                CATempo* tempo = static_cast<CATempo*>(mark);
+                                updateSleepFactor(tempo);
+                                addMetaEvent(CAMidiDevice::Meta_Tempo, static_cast<char>(tempo->bpm()), 0, 0);
+                            }
                         }
                     }
 
-                    message << (144 + note->voice()->midiChannel()); // note on
-                    message << static_cast<uchar>(CADiatonicPitch::diatonicPitchToMidiPitch(note->diatonicPitch()) + note->voice()->midiPitchOffset());
-                    message << (127);
-                    if (!note->tieEnd())
-                        midiDevice()->send(message, _curTime);
+                    message << (144 + _events.channel(row)); // note on
+                    message << _events.pitch(row);
+                    message << _events.velocity(row);
+                    if (!(_events.flags(row) & CAEventStore::TieEnd))
+                        addMessage(message, port, _events.playable(row));
                     message.clear();
                 }
 
-                if (streamAt(i).at(streamIdx(i))->isPlayable()) {
-                    _curPlaying << static_cast<CAPlayable*>(streamAt(i).at(streamIdx(i)));
+                if (_events.flags(row) & CAEventStore::Playable) {
+                    playing << row;
+                    addPlayableEvent(CAPlaybackEvent::PlayableOn, _events.playable(row));
                 }
 
                 int delta;
-                if ((delta = (streamAt(i).at(streamIdx(i))->timeEnd() - _curTime)) < minLength
+                if ((delta = (_events.timeEnd(row) - _curTime)) < minLength
                     || minLength == -1)
                     minLength = delta;
 
                 streamIdx(i)++;
             }
 
-            // calculate the pause needed by msleep
-            // last playables in the stream - _curPlaying is otherwise always set!
+            // calculate the pause till the next events
+            // last playables in the stream - playing is otherwise always set!
             // pre-last pass, set minLength to their timeLengths to stop the notes
-            for (int j = 0; j < _curPlaying.size(); j++) {
-                if ((_curPlaying[j]->timeEnd() - _curTime) < minLength || minLength == -1)
-                    minLength = _curPlaying[j]->timeEnd() - _curTime;
+            for (int j = 0; j < playing.size(); j++) {
+                if ((_events.timeEnd(playing[j]) - _curTime) < minLength || minLength == -1)
+                    minLength = _events.timeEnd(playing[j]) - _curTime;
             }
         }
 
         if (minLength == -1) {
             // last pass, notes indices are at the ends and no notes are played anymore
-            setStop(true);
+            finished = true;
+        } else {
+            _msecs += minLength * _sleepFactor;
+            _curTime += minLength;
         }
+    }
+}
 
-        if (minLength != -1) {
-            mSeconds += qRound(minLength * _sleepFactor);
+/*!
+	Appends the midi \a message for the output \a port to the timeline at the current time. Note on
+	and off messages carry the \a playable they were generated from, so the events can be split per
+	voice.
+*/
+void CAPlayback::addMessage(QVector<unsigned char> message, int port, CAPlayable* playable)
+{
+    if (message.size() >= 2 && (message[0] & 0xF0) == 192) { // change program
+        CAPlaybackControl program = { _timeline.size(), message[1] };
+        _programs[controlKey(port, message[0] & 0x0F)] << program;
+    } else if (message.size() >= 3 && (message[0] & 0xF0) == 176 && message[1] == CAMidiDevice::Midi_Ctl_Volume) {
+        CAPlaybackControl volume = { _timeline.size(), message[2] };
+        _volumes[controlKey(port, message[0] & 0x0F)] << volume;
+    }
 
-            if (midiDevice()->isRealTime())
-                msleep(static_cast<ulong>(qRound(minLength * _sleepFactor)));
+    CAPlaybackEvent event = { CAPlaybackEvent::Message, _curTime, _msecs, message, 0, 0, 0, 0, playable, port };
+    _timeline << event;
+}
 
-            _curTime += minLength;
+/*!
+	Compiles the timeline of the whole sheet without playing it and returns it. The events are
+	sorted by their real time. This is used by the offline renderers, eg. CAAudioExport, which
+	don't need a midi device.
+*/
+const QList<CAPlaybackEvent>& CAPlayback::timeline()
+{
+    if (!streamList().size() && sheet()) {
+        initStreams(sheet());
+        if (streamList().size())
+            compileTimeline();
+    }
+
+    return _timeline;
+}
+
+/*!
+	Appends the meta \a event with the arguments \a a, \a b and \a c to the timeline at the current time.
+*/
+void CAPlayback::addMetaEvent(char event, char a, char b, int c)
+{
+    CAPlaybackEvent metaEvent = { CAPlaybackEvent::MetaEvent, _curTime, _msecs, QVector<unsigned char>(), event, a, b, c, nullptr, -1 };
+    _timeline << metaEvent;
+}
+
+/*!
+	Appends the event of the given \a type for the \a playable to the timeline at the current time.
+	These events update the list of currently playing elements.
+
+	\sa curPlaying()
+*/
+void CAPlayback::addPlayableEvent(CAPlaybackEvent::CAPlaybackEventType type, CAPlayable* playable)
+{
+    CAPlaybackEvent event = { type, _curTime, _msecs, QVector<unsigned char>(), 0, 0, 0, 0, playable, -1 };
+    _timeline << event;
+}
+
+/*!
+	Remembers the index of the next timeline event for the current time. A new pass is started, if
+	the time went back because of a repeat.
+
+	\sa seekEvent()
+*/
+void CAPlayback::addSeekPoint()
+{
+    if (_seekPoints.isEmpty() || _seekPoints.last().time >= _curTime)
+        _passStarts << _seekPoints.size();
+
+    CAPlaybackSeekPoint point = { _curTime, _timeline.size() };
+    _seekPoints << point;
+}
+
+/*!
+	Returns the index of the first timeline event played at or after the given sheet \a time.
+	If the time is played multiple times because of the repeats, the first pass is used.
+	Returns the size of the timeline, if nothing is played after \a time.
+*/
+int CAPlayback::seekEvent(int time)
+{
+    for (int p = 0; p < _passStarts.size(); p++) {
+        int first = _passStarts[p];
+        int last = (p + 1 < _passStarts.size() ? _passStarts[p + 1] : _seekPoints.size());
+        if (_seekPoints[last - 1].time < time)
+            continue;
+
+        const CAPlaybackSeekPoint* point = std::lower_bound(_seekPoints.constData() + first, _seekPoints.constData() + last, time,
+            [](const CAPlaybackSeekPoint& a, int t) { return a.time < t; });
+        return point->event;
+    }
+
+    return _timeline.size();
+}
+
+/*!
+	Sends the last program and volume change of each port and midi channel before the timeline
+	\a event.
+*/
+void CAPlayback::restoreControls(int event)
+{
+    auto lastBefore = [event](const QVector<CAPlaybackControl>& controls) {
+        return std::lower_bound(controls.constBegin(), controls.constEnd(), event,
+            [](const CAPlaybackControl& a, int e) { return a.event < e; });
+    };
+
+    QVector<unsigned char> message;
+    for (auto it = _programs.constBegin(); it != _programs.constEnd(); ++it) {
+        QVector<CAPlaybackControl>::const_iterator program = lastBefore(it.value());
+        if (program != it.value().constBegin()) {
+            message << (192 + it.key() % 16); // change program
+            message << (program - 1)->value;
+            midiDevice()->sendToPort(it.key() / 16 - 1, message, _curTime);
+            message.clear();
         }
     }
 
-    _curPlaying.clear();
-    stop();
+    for (auto it = _volumes.constBegin(); it != _volumes.constEnd(); ++it) {
+        QVector<CAPlaybackControl>::const_iterator volume = lastBefore(it.value());
+        if (volume != it.value().constBegin()) {
+            message << (176 + it.key() % 16); // set volume
+            message << (CAMidiDevice::Midi_Ctl_Volume);
+            message << (volume - 1)->value;
+            midiDevice()->sendToPort(it.key() / 16 - 1, message, _curTime);
+            message.clear();
+        }
+    }
 }
 
 /*!
@@ -313,7 +677,9 @@ void CAPlayback::playSelectionImpl()
             midiDevice()->send(message, _curTime);
             message.clear();
 
+            _curPlayingMutex.lock();
             _curPlaying << note;
+            _curPlayingMutex.unlock();
             timeEnds << curTime + note->timeLength() * 4;
         }
 
@@ -331,7 +697,9 @@ void CAPlayback::playSelectionImpl()
                 }
 
                 timeEnds.removeAt(i);
+                _curPlayingMutex.lock();
                 _curPlaying.removeAt(i);
+                _curPlayingMutex.unlock();
                 i--;
             }
         }
@@ -376,10 +744,25 @@ void CAPlayback::stopNow()
 }
 
 /*!
-	Generates streams (elements lists) of playable elements (notes, rests) from the given sheet.
+	Generates streams (elements lists) of playable elements (notes, rests) from the given sheet and
+	the event store rows for them.
 */
 void CAPlayback::initStreams(CASheet* sheet)
 {
+    _events.build(sheet);
+
+    // the voices routed to other ports than the default one, the ports missing on this computer are ignored
+    QMap<int, QString> outputPorts = midiDevice() ? midiDevice()->getOutputPorts() : QMap<int, QString>();
+    for (int i = 0; i < sheet->voiceList().size(); i++) {
+        int port = outputPorts.key(sheet->voiceList()[i]->midiPort(), -1);
+        if (!sheet->voiceList()[i]->midiPort().isEmpty() && port != -1) {
+            _voicePorts[sheet->voiceList()[i]] = port;
+            if (!_ports.contains(port)) {
+                _ports << port;
+            }
+        }
+    }
+
     for (int i = 0; i < sheet->contextList().size(); i++) {
         if (sheet->contextList()[i]->contextType() == CAContext::Staff) {
             CAStaff* staff = static_cast<CAStaff*>(sheet->contextList()[i]);
@@ -390,13 +773,13 @@ void CAPlayback::initStreams(CASheet* sheet)
                 QVector<unsigned char> message;
                 message << (192 + staff->voiceList()[j]->midiChannel()); // change program
                 message << (staff->voiceList()[j]->midiProgram());
-                midiDevice()->send(message, _curTime);
+                addMessage(message, voicePort(staff->voiceList()[j]));
                 message.clear();
 
                 message << (176 + staff->voiceList()[j]->midiChannel()); // set volume
                 message << (7);
                 message << (100);
-                midiDevice()->send(message, _curTime);
+                addMessage(message, voicePort(staff->voiceList()[j]));
                 message.clear();
             }
         }
@@ -406,7 +789,7 @@ void CAPlayback::initStreams(CASheet* sheet)
 
     // init streams indices, current times and last repeat barlines
     for (int i = 0; i < streamList().size(); i++) {
-        _curTime = getInitTimeStart();
+        _curTime = 0; // the timeline is compiled from the beginning, see seekEvent()
         streamIdx(i) = 0;
         lastRepeatOpenIdx(i) = -1;
         _repeating = false;
@@ -414,7 +797,7 @@ void CAPlayback::initStreams(CASheet* sheet)
     }
 
     if (_sheet) {
-        updateSleepFactor(_sheet->getTempo(getInitTimeStart()));
+        updateSleepFactor(_sheet->getTempo(0));
     }
 }
 
@@ -433,7 +816,7 @@ void CAPlayback::loopUntilPlayable(int i, bool ignoreRepeats)
             int beats = static_cast<CATimeSignature*>(streamAt(i).at(j))->beats();
             int beat = static_cast<CATimeSignature*>(streamAt(i).at(j))->beat();
             //std::cout<<"  exportiere Time Signature    "<<_curTime<<" mit "<<beats<<"/"<<beat<<std::endl;
-            midiDevice()->sendMetaEvent(_curTime, CAMidiDevice::Meta_Timesig, beats, beat, 0);
+            addMetaEvent(CAMidiDevice::Meta_Timesig, beats, beat, 0);
         }
         if (streamAt(i).at(j)->musElementType() == CAMusElement::KeySignature) {
             //int key = (static_cast<CAKeySignature*>(streamAt(i).at(j)))->diatonicKey()->numberOfAccs();
@@ -441,7 +824,7 @@ void CAPlayback::loopUntilPlayable(int i, bool ignoreRepeats)
             CADiatonicKey dk = ks->diatonicKey();
             int key = dk.numberOfAccs();
             int minor = dk.gender() == CADiatonicKey::Minor ? 1 : 0;
-            midiDevice()->sendMetaEvent(_curTime, CAMidiDevice::Meta_Keysig, key, minor, 0);
+            addMetaEvent(CAMidiDevice::Meta_Keysig, key, minor, 0);
         }
 
         if (streamAt(i).at(j)->musElementType() == CAMusElement::Barline && static_cast<CABarline*>(streamAt(i).at(j))->barlineType() == CABarline::RepeatOpen) {
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -8,8 +8,14 @@
 #ifndef PLAYBACK_H_
 #define PLAYBACK_H_
 
+#include <QAtomicInt>
+#include <QHash>
 #include <QList>
+#include <QMutex>
 #include <QThread>
+#include <QVector>
+
+#include "core/eventstore.h"
 
 class CAMidiDevice;
 class CASheet;
@@ -17,6 +23,37 @@ class CAMusElement;
 class CAPlayable;
 class CANote;
 class CATempo;
+class CAVoice;
+
+#ifndef SWIG
+struct CAPlaybackEvent {
+    enum CAPlaybackEventType {
+        Message, // midi message sent by CAMidiDevice::send()
+        MetaEvent, // meta event sent by CAMidiDevice::sendMetaEvent()
+        PlayableOn, // playable starts playing
+        PlayableOff // playable stops playing
+    };
+
+    CAPlaybackEventType type;
+    int time; // canorus time of the event, independent of tempo
+    double msecs; // real time of the event in miliseconds from the playback start, tempo applied
+    QVector<unsigned char> message;
+    char metaEvent, a, b;
+    int c;
+    CAPlayable* playable; // for the playable events and the note on and off messages
+    int port; // output port of the messages, see CAMidiDevice::sendToPort(), -1 for the default one
+};
+
+struct CAPlaybackSeekPoint {
+    int time; // canorus time
+    int event; // index of the first timeline event played at this time
+};
+
+struct CAPlaybackControl {
+    int event; // index of the timeline event changing the controller
+    unsigned char value;
+};
+#endif
 
 class CAPlayback : public QThread {
 #ifndef SWIG
@@ -31,13 +68,19 @@ public:
     void stop();
 
     void playImmediately(QList<CAMusElement*> elts, int port);
+    void seek(int time);
 
     inline int getInitTimeStart() { return _initTimeStart; }
     inline void setInitTimeStart(int t) { _initTimeStart = t; }
     inline CAMidiDevice* midiDevice() { return _midiDevice; }
     inline CASheet* sheet() { return _sheet; }
     inline void setSheet(CASheet* s) { _sheet = s; }
-    inline QList<CAPlayable*>& curPlaying() { return _curPlaying; }
+    QList<CAPlayable*> curPlaying();
+    inline int playingGeneration() { return _playingGeneration.load(); }
+    inline int takeMaxLateness() { return _maxLateness.fetchAndStoreOrdered(0); } // in microseconds
+#ifndef SWIG
+    const QList<CAPlaybackEvent>& timeline();
+#endif
 
 #ifndef SWIG
 public slots:
@@ -54,9 +97,18 @@ signals:
 private:
     void initPlayback();
     void initStreams(CASheet* sheet);
+    void compileTimeline();
+    void addMessage(QVector<unsigned char> message, int port, CAPlayable* playable = nullptr);
+    void addMetaEvent(char event, char a, char b, int c);
+    void addPlayableEvent(CAPlaybackEvent::CAPlaybackEventType type, CAPlayable* playable);
+    void addSeekPoint();
+    int seekEvent(int time);
+    void restoreControls(int event);
+    void switchOffPlaying();
     void loopUntilPlayable(int i, bool ignoreRepeats = false);
     void playSelectionImpl();
     void updateSleepFactor(CATempo* t);
+    inline int voicePort(CAVoice* voice) { return _voicePorts.value(voice, -1); }
 
     inline QList<CAMusElement*>& streamAt(int idx) { return _streamList[idx]; }
     inline const QList<QList<CAMusElement*>>& streamList() { return _streamList; }
@@ -78,11 +130,26 @@ private:
     bool _playSelectionOnly;
     QList<CAMusElement*> _selection;
 
+    static const int STOP_CHECK_INTERVAL; // Longest sleep in miliseconds between checks whether the playback was stopped
     int _initTimeStart;
     float _sleepFactor;
+    double _msecs; // real time of the events being compiled
+    QList<CAPlaybackEvent> _timeline; // midi events of the whole sheet sorted by their real time
+    QVector<CAPlaybackSeekPoint> _seekPoints; // time steps of the timeline in the played order, repeats unrolled
+    QList<int> _passStarts; // indices of the seek points where the time starts again after a repeat
+    QHash<int, QVector<CAPlaybackControl>> _programs; // program changes of each port and midi channel in the timeline, see controlKey()
+    QHash<int, QVector<CAPlaybackControl>> _volumes; // volume changes of each port and midi channel in the timeline
+    QHash<CAVoice*, int> _voicePorts; // output ports of the voices routed away from the default port, see CAVoice::midiPort()
+    QList<int> _ports; // distinct output ports in _voicePorts
+    QAtomicInt _seekTime; // time requested by seek(), -1 if none
+    QAtomicInt _maxLateness; // of the events sent since the last takeMaxLateness() in microseconds
 
     QList<QList<CAMusElement*>> _streamList;
-    QList<CAPlayable*> _curPlaying; // list of currently playing notes and rests
+    CAEventStore _events; // times, channels and pitches of the stream elements, row(i, idx) is the element idx in stream i
+    QList<CAPlayable*> _curPlaying; // list of currently playing notes and rests, changed by the playback thread only
+    QMutex _curPlayingMutex; // locked when changing _curPlaying and when copying it from other threads
+    QAtomicInt _playingGeneration; // increased on every change of _curPlaying
+    QVector<int> _sounding; // controlKey(port, channel) * 128 + key of the notes sent by run() and not switched off yet
     int* _streamIdx;
     bool _repeating;
     int* _lastRepeatOpenIdx;
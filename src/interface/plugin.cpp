@@ -22,6 +22,8 @@
 #include "widgets/scoreview.h"
 #include "widgets/view.h"
 #include "widgets/viewcontainer.h"
+#include <QCoreApplication>
+#include <QThread>
 #else
 #include "interface/plugins_swig.h"
 #include <QMenu>
@@ -40,6 +42,7 @@ CAPlugin::CAPlugin()
     _updateUrl = "";
 
     _enabled = false;
+    _initialized = false;
 }
 
 CAPlugin::CAPlugin(QString name, QString author, QString version, QString date, QString dirName, QString homeUrl, QString updateUrl)
@@ -53,6 +56,7 @@ CAPlugin::CAPlugin(QString name, QString author, QString version, QString date,
     _updateUrl = updateUrl;
 
     _enabled = false;
+    _initialized = false;
 }
 
 CAPlugin::~CAPlugin()
@@ -82,8 +86,44 @@ bool CAPlugin::action(QString onAction, CAMainWin* mainWin, CADocument* document
     return (!error);
 }
 
+/*!
+	Loads the scripting engine of the \a action and initializes the plugin, if not done yet.
+	It is called by callAction(). Call it from the main thread before calling the action from a
+	worker thread (see CAPluginExport and CAPluginImport).
+*/
+void CAPlugin::initAction(CAPluginAction* action, CAMainWin* mainWin)
+{
+#ifndef SWIGCPP
+    // Scripting engine of the action's language is loaded on its first call
+    if (action->lang() == "python")
+        CACanorus::initScripting();
+#ifdef USE_RUBY
+    if (action->lang() == "ruby")
+        CASwigRuby::init();
+#endif
+#endif
+
+    // Plugins are initialized before their first action is called
+    if (!_initialized && action->onAction() != "onInit") {
+        _initialized = true;
+        this->action("onInit", mainWin);
+
+#ifdef USE_PYTHON
+        // import the scripts of the other actions now, so the frequently triggered ones (eg. onMouseMove) respond at once
+        QList<CAPluginAction*> actionList = _actionMap.values();
+        for (int i = 0; i < actionList.size(); i++) {
+            if (actionList[i]->lang() == "python" && actionList[i]->onAction() != "onInit" && _name != "pyCLI") {
+                CASwigPython::preloadFunction(_dirName + "/" + actionList[i]->filename(), actionList[i]->function());
+            }
+        }
+#endif
+    }
+}
+
 bool CAPlugin::callAction(CAPluginAction* action, CAMainWin* mainWin, CADocument* document, QEvent*, QPoint*, QString filename)
 {
+    initAction(action, mainWin);
+
     bool error = false;
 #ifndef SWIGCPP
     bool rebuildDocument = false;
@@ -113,9 +153,9 @@ bool CAPlugin::callAction(CAPluginAction* action, CAMainWin* mainWin, CADocument
 #endif
 #ifdef USE_PYTHON
             if (action->lang() == "python") {
-                PyEval_RestoreThread(CASwigPython::mainThreadState);
+                CASwigPython::lockGIL();
                 pythonArgs << CASwigPython::toPythonObject(document, CASwigPython::Document);
-                PyEval_ReleaseThread(CASwigPython::mainThreadState);
+                CASwigPython::unlockGIL();
             }
 #endif
         } else
@@ -135,9 +175,9 @@ bool CAPlugin::callAction(CAPluginAction* action, CAMainWin* mainWin, CADocument
 #ifdef USE_PYTHON
             if (action->lang() == "python") {
                 if (mainWin->currentSheet()) {
-                    PyEval_RestoreThread(CASwigPython::mainThreadState);
+                    CASwigPython::lockGIL();
                     pythonArgs << CASwigPython::toPythonObject(mainWin->currentSheet(), CASwigPython::Sheet);
-                    PyEval_ReleaseThread(CASwigPython::mainThreadState);
+                    CASwigPython::unlockGIL();
                 } else {
                     error = true;
                     break;
@@ -174,9 +214,9 @@ bool CAPlugin::callAction(CAPluginAction* action, CAMainWin* mainWin, CADocument
                         error = true;
                         break;
                     }
-                    PyEval_RestoreThread(CASwigPython::mainThreadState);
+                    CASwigPython::lockGIL();
                     pythonArgs << CASwigPython::toPythonObject(v->selection().front()->musElement(), CASwigPython::MusElement);
-                    PyEval_ReleaseThread(CASwigPython::mainThreadState);
+                    CASwigPython::unlockGIL();
                 } else {
                     error = true;
                     break;
@@ -196,11 +236,11 @@ bool CAPlugin::callAction(CAPluginAction* action, CAMainWin* mainWin, CADocument
                 if (mainWin->currentScoreView()) {
                     QList<CAMusElement*> musElements = mainWin->currentScoreView()->musElementSelection();
                     PyObject* list = PyList_New(0);
-                    PyEval_RestoreThread(CASwigPython::mainThreadState);
+                    CASwigPython::lockGIL();
                     for (int i = 0; i < musElements.size(); i++) {
                         PyList_Append(list, CASwigPython::toPythonObject(musElements[i], CASwigPython::MusElement));
                     }
-                    PyEval_ReleaseThread(CASwigPython::mainThreadState);
+                    CASwigPython::unlockGIL();
 
                     pythonArgs << list;
                 } else {
@@ -221,9 +261,9 @@ bool CAPlugin::callAction(CAPluginAction* action, CAMainWin* mainWin, CADocument
 #endif
 #ifdef USE_PYTHON
             if (action->lang() == "python") {
-                PyEval_RestoreThread(CASwigPython::mainThreadState);
+                CASwigPython::lockGIL();
                 pythonArgs << CASwigPython::toPythonObject(&_dirName, CASwigPython::String);
-                PyEval_ReleaseThread(CASwigPython::mainThreadState);
+                CASwigPython::unlockGIL();
             }
 #endif
         } else
@@ -237,9 +277,9 @@ bool CAPlugin::callAction(CAPluginAction* action, CAMainWin* mainWin, CADocument
 #endif
 #ifdef USE_PYTHON
             if (action->lang() == "python") {
-                PyEval_RestoreThread(CASwigPython::mainThreadState);
+                CASwigPython::lockGIL();
                 pythonArgs << CASwigPython::toPythonObject(&filename, CASwigPython::String);
-                PyEval_ReleaseThread(CASwigPython::mainThreadState);
+                CASwigPython::unlockGIL();
             }
 #endif
         }
@@ -247,9 +287,9 @@ bool CAPlugin::callAction(CAPluginAction* action, CAMainWin* mainWin, CADocument
 #ifdef USE_PYTHON
     if (_name == "pyCLI") {
         if (mainWin->pyConsoleIface) {
-            PyEval_RestoreThread(CASwigPython::mainThreadState);
+            CASwigPython::lockGIL();
             pythonArgs << CASwigPython::toPythonObject(mainWin->pyConsoleIface, CASwigPython::PyConsoleInterface);
-            PyEval_ReleaseThread(CASwigPython::mainThreadState);
+            CASwigPython::unlockGIL();
         }
     }
 #endif
@@ -263,13 +303,23 @@ bool CAPlugin::callAction(CAPluginAction* action, CAMainWin* mainWin, CADocument
 #endif
 #ifdef USE_PYTHON
         if (action->lang() == "python") {
-            PyEval_RestoreThread(CASwigPython::mainThreadState);
+            CASwigPython::lockGIL();
             PyRun_SimpleString((QString("sys.path.append('") + dirName() + "')").toStdString().c_str());
-            PyEval_ReleaseThread(CASwigPython::mainThreadState);
+            CASwigPython::unlockGIL();
         }
 #endif
     }
 
+#ifndef SWIGCPP
+    // merge the rebuilds requested by the plugin with the final refresh, the console runs interactively
+    // the actions run by a worker thread change their own document only, the caller rebuilds the UI
+    bool mainThread = (QThread::currentThread() == QCoreApplication::instance()->thread());
+    bool batch = (_name != "pyCLI" && mainThread);
+    if (batch) {
+        CACanorus::beginBatch();
+    }
+#endif
+
     if (!error) {
 #ifdef USE_RUBY
         if (action->lang() == "ruby") {
@@ -284,12 +334,16 @@ bool CAPlugin::callAction(CAPluginAction* action, CAMainWin* mainWin, CADocument
     }
 
 #ifndef SWIGCPP
-    if (action->refresh()) {
+    if (action->refresh() && mainThread) {
         if (rebuildDocument == true)
             CACanorus::rebuildUI(document);
         else
             CACanorus::rebuildUI(document, mainWin->currentSheet());
     }
+
+    if (batch) {
+        CACanorus::endBatch();
+    }
 #endif
 
     return (!error);
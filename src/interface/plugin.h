@@ -51,6 +51,7 @@ public:
 		 * @return True, if the action succeeded, False otherwise.
 		 */
     bool callAction(CAPluginAction* action, CAMainWin* mainWin = nullptr, CADocument* document = nullptr, QEvent* evt = nullptr, QPoint* coords = nullptr, QString filename = "");
+    void initAction(CAPluginAction* action, CAMainWin* mainWin = nullptr);
 
     /**
 		 * Adds an action to the plugin, if the actionName&action aren't present yet.
@@ -66,6 +67,8 @@ public:
 
     void setEnabled(bool enabled) { _enabled = enabled; }
     bool isEnabled() { return _enabled; }
+    void setInitialized(bool initialized) { _initialized = initialized; }
+    bool isInitialized() { return _initialized; }
 
     QString name() { return _name; }
     QString author() { return _author; }
@@ -110,6 +113,7 @@ private:
     QString _homeUrl;
     QString _updateUrl;
     bool _enabled;
+    bool _initialized; /// True, if the plugin's "onInit" actions were already called
 
     QMultiHash<QString, CAPluginAction*> _actionMap; /// Key: onAction, Value: plugin's action
     QHash<QString, QMenu*> _menuMap; /// Map of plugin menu name -> Canorus menu object
@@ -0,0 +1,150 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifdef USE_PYTHON
+// Python.h, which swigpython.h includes, must be included before any other headers
+#include "scripting/swigpython.h"
+#endif
+
+#include "interface/pluginfilter.h"
+#include "interface/plugin.h"
+#include "interface/pluginaction.h"
+
+#include "score/document.h"
+
+/*!
+	\class CAPluginExport
+	\brief Export filter running the export action of a plugin in its own thread
+
+	The action is called with the document being exported, so the main window adds it to a
+	CAExportSnapshot and the plugin reads a copy of the document, while the user keeps editing.
+	Several plugin exports can run at once, each in its own thread. The plugin writes the file
+	itself, so setStreamToFile() only stores its name.
+
+	cancel() interrupts the running Python script by raising KeyboardInterrupt in it.
+
+	Only the Python actions run in a thread, the Ruby interpreter can only be used by the main
+	thread. Use runsInThread() to check the action and CAPluginManager::exportAction() otherwise.
+
+	\sa CAPluginImport
+*/
+
+CAPluginExport::CAPluginExport(CAPluginAction* action)
+    : CAExport()
+    , _action(action)
+    , _threadId(0)
+{
+    // the scripting engine and the plugin are initialized by the main thread
+    _action->plugin()->initAction(_action);
+}
+
+/*!
+	Returns True, if the export \a action can be run by CAPluginExport.
+*/
+bool CAPluginExport::runsInThread(CAPluginAction* action)
+{
+#ifdef USE_PYTHON
+    return action && action->lang() == "python";
+#else
+    Q_UNUSED(action)
+    return false;
+#endif
+}
+
+/*!
+	Stores the \a filename passed to the plugin. The file isn't opened, the exported data goes
+	to an unused string stream.
+*/
+void CAPluginExport::setStreamToFile(const QString filename, QIODevice::OpenMode)
+{
+    _fileName = filename;
+    setStreamToString();
+}
+
+void CAPluginExport::cancel()
+{
+    CAExport::cancel();
+#ifdef USE_PYTHON
+    unsigned long threadId = _threadId;
+    if (threadId) {
+        CASwigPython::interruptThread(threadId);
+    }
+#endif
+}
+
+void CAPluginExport::exportDocumentImpl(CADocument* doc)
+{
+#ifdef USE_PYTHON
+    _threadId = CASwigPython::currentThreadId();
+#endif
+    bool success = _action->plugin()->callAction(_action, nullptr, doc, nullptr, nullptr, _fileName);
+    _threadId = 0;
+
+    setStatus(success ? 0 : -1);
+}
+
+/*!
+	\class CAPluginImport
+	\brief Import filter running the import action of a plugin in its own thread
+
+	The action fills a new document in the filter's thread. The main window gets it from
+	importedDocument() when importDone() is emitted, as with the other import filters, and shows
+	the progress and the cancel button meanwhile.
+
+	As in CAPluginExport, only the Python actions run in a thread, see runsInThread().
+*/
+
+CAPluginImport::CAPluginImport(CAPluginAction* action)
+    : CAImport()
+    , _action(action)
+    , _threadId(0)
+{
+    _action->plugin()->initAction(_action);
+}
+
+/*!
+	Returns True, if the import \a action can be run by CAPluginImport.
+*/
+bool CAPluginImport::runsInThread(CAPluginAction* action)
+{
+    return CAPluginExport::runsInThread(action);
+}
+
+void CAPluginImport::cancel()
+{
+    CAImport::cancel();
+#ifdef USE_PYTHON
+    unsigned long threadId = _threadId;
+    if (threadId) {
+        CASwigPython::interruptThread(threadId);
+    }
+#endif
+}
+
+/*!
+	Calls the action with the new document and the imported file name. The document is thrown
+	away, if the action failed.
+*/
+CADocument* CAPluginImport::importDocumentImpl()
+{
+    CADocument* doc = new CADocument();
+
+#ifdef USE_PYTHON
+    _threadId = CASwigPython::currentThreadId();
+#endif
+    bool success = _action->plugin()->callAction(_action, nullptr, doc, nullptr, nullptr, fileName());
+    _threadId = 0;
+
+    if (!success && !isCanceled()) {
+        delete doc;
+        setStatus(-1);
+        return nullptr;
+    }
+
+    setStatus(0);
+    return doc;
+}
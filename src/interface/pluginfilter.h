@@ -0,0 +1,54 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef PLUGINFILTER_H_
+#define PLUGINFILTER_H_
+
+#include <QString>
+
+#include <atomic>
+
+#include "export/export.h"
+#include "import/import.h"
+
+class CAPluginAction;
+
+class CAPluginExport : public CAExport {
+public:
+    CAPluginExport(CAPluginAction* action);
+
+    static bool runsInThread(CAPluginAction* action);
+
+    void setStreamToFile(const QString filename, QIODevice::OpenMode mode = QIODevice::WriteOnly);
+    void cancel();
+
+protected:
+    void exportDocumentImpl(CADocument* doc);
+
+private:
+    CAPluginAction* _action;
+    QString _fileName; // written by the plugin itself
+    std::atomic<unsigned long> _threadId; // of the running script, 0 if not running
+};
+
+class CAPluginImport : public CAImport {
+public:
+    CAPluginImport(CAPluginAction* action);
+
+    static bool runsInThread(CAPluginAction* action);
+
+    void cancel();
+
+protected:
+    CADocument* importDocumentImpl();
+
+private:
+    CAPluginAction* _action;
+    std::atomic<unsigned long> _threadId; // of the running script, 0 if not running
+};
+
+#endif /* PLUGINFILTER_H_ */
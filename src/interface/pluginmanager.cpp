@@ -15,16 +15,30 @@
 #include "interface/pluginaction.h"
 #include "interface/pluginmanager.h"
 
+#include "core/settings.h"
+
+#include <QDataStream>
+#include <QDateTime>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QMenu>
 #include <QXmlInputSource>
 
+#include <memory>
+
 // define static members
 QList<CAPlugin*> CAPluginManager::_pluginList;
 QMultiHash<QString, CAPlugin*> CAPluginManager::_actionMap;
 QHash<QString, CAPluginAction*> CAPluginManager::_exportFilterMap;
 QHash<QString, CAPluginAction*> CAPluginManager::_importFilterMap;
+QHash<CAPlugin*, CAPluginDescriptor> CAPluginManager::_descriptorMap;
+
+const QString CAPluginManager::DESCRIPTOR_FILE = "canorusplugin.xml";
+const QString CAPluginManager::INDEX_FILE = "plugins.idx";
+
+static const quint32 INDEX_MAGIC = 0x43415049; // "CAPI"
+static const qint32 INDEX_VERSION = 1;
 
 /*!
 	\class CAPluginManager
@@ -41,13 +55,15 @@ QHash<QString, CAPluginAction*> CAPluginManager::_importFilterMap;
 	directory from the disk.
 
 	After plugins are installed readPlugins() method should be called. This creates a list of available plugin
-	objects and stores their location paths.
+	objects and stores their location paths and descriptors. Parsed descriptors are kept in a binary index
+	in the user's settings directory and are only parsed again, when the descriptor file was modified.
 
-	To parse plugins descriptor files and enable plugins, call enablePlugins() to enable plugins marked as
-	auto-load in Canorus config file or enablePlugin() to load a specific plugin. These methods use Qt's XML
-	facilities to parse plugins descriptor files and use the non-static part of the class. They also require
-	an already created main window as the parser creates menu structures, toolbars and other elements
-	the plugin might offer.
+	To enable plugins, call enablePlugins() to enable plugins marked as auto-load in Canorus config file or
+	enablePlugin() to load a specific plugin. These methods create menu structures, toolbars and other
+	elements the plugin might offer from the stored descriptor and require an already created main window.
+	Only the top-level menus are created at once, their content is built when they are first opened.
+	The plugin itself (action "onInit") and the scripting engine are only initialized when one of its
+	actions is called for the first time.
 
  	An action (eg. when a user moves mouse in score viewport) is triggered by calling action() method and
  	pass the action type (eg. "onMouseMove") and other parameters. actionExport() and actionImport() are
@@ -58,16 +74,58 @@ QHash<QString, CAPluginAction*> CAPluginManager::_importFilterMap;
  	\sa CAPlugin, CAPluginManagerWin
 */
 
+/*!
+	\struct CAPluginItem
+	\brief Menu, action or separator read from the plugin's descriptor file
+*/
+
+/*!
+	\struct CAPluginDescriptor
+	\brief Parsed content of the plugin's descriptor file
+
+	The descriptor is stored in the plugins index together with the modification time of the
+	descriptor file.
+*/
+
+QDataStream& operator<<(QDataStream& out, const CAPluginItem& item)
+{
+    out << static_cast<qint32>(item.type) << item.name << item.parentMenu << item.texts
+        << item.onAction << item.lang << item.function << item.filename << item.args
+        << item.exportFilters << item.importFilters << item.parentToolbar << item.refresh;
+    return out;
+}
+
+QDataStream& operator>>(QDataStream& in, CAPluginItem& item)
+{
+    qint32 type;
+    in >> type >> item.name >> item.parentMenu >> item.texts
+        >> item.onAction >> item.lang >> item.function >> item.filename >> item.args
+        >> item.exportFilters >> item.importFilters >> item.parentToolbar >> item.refresh;
+    item.type = static_cast<CAPluginItem::CAPluginItemType>(type);
+    return in;
+}
+
+QDataStream& operator<<(QDataStream& out, const CAPluginDescriptor& descriptor)
+{
+    out << descriptor.modified << descriptor.name << descriptor.version << descriptor.author
+        << descriptor.homeUrl << descriptor.updateUrl << descriptor.descriptions << descriptor.items;
+    return out;
+}
+
+QDataStream& operator>>(QDataStream& in, CAPluginDescriptor& descriptor)
+{
+    in >> descriptor.modified >> descriptor.name >> descriptor.version >> descriptor.author
+        >> descriptor.homeUrl >> descriptor.updateUrl >> descriptor.descriptions >> descriptor.items;
+    return in;
+}
+
 /*!
 	Used if parsing plugin's descriptor file.
-	It uses the given \a mainWin in order to create new menus and toolbars the plugin might include.
-	If the plugin has already been created (eg. using the same plugin in multiple main windows)
-	\a plugin is the existing plugin.
+	The parsed metadata, menus and actions are stored into the given \a descriptor.
 */
-CAPluginManager::CAPluginManager(CAMainWin* mainWin, CAPlugin* plugin)
+CAPluginManager::CAPluginManager(CAPluginDescriptor* descriptor)
 {
-    _mainWin = mainWin;
-    _curPlugin = plugin;
+    _descriptor = descriptor;
     _curPluginCanorusVersion = CANORUS_VERSION; /// \todo This should be read from the descriptor file as well
 }
 
@@ -77,6 +135,8 @@ CAPluginManager::~CAPluginManager()
 
 /*!
 	Reads the system and user's plugins directories and adds all the plugins to the internal plugins list.
+	Descriptors are taken from the plugins index, if their files weren't modified since, otherwise
+	they are parsed and the index is updated.
 	\warning This function doesn't enable or initialize any of the plugins - use enablePlugins() for this.
 
 	\todo Add support for a user plugins directory.
@@ -95,25 +155,110 @@ void CAPluginManager::readPlugins()
             pluginPaths << curDir.absolutePath() + "/" + curDir[j];
         }
 
+        QHash<QString, CAPluginDescriptor> index = readIndex();
+        bool indexChanged = false;
+
         for (int i = 0; i < pluginPaths.size(); i++) {
-            QXmlSimpleReader reader;
-            QFile* file = new QFile(pluginPaths[i] + "/canorusplugin.xml");
-            file->open(QIODevice::ReadOnly);
+            QFileInfo file(pluginPaths[i] + "/" + DESCRIPTOR_FILE);
 
             // test if the descriptor file can be opened
-            if (!file->isOpen()) {
-                delete file;
+            if (!file.isFile() || !file.isReadable()) {
                 continue;
             }
 
-            delete file;
-            CAPlugin* plugin = new CAPlugin();
-            plugin->setDirName(pluginPaths[i]);
+            CAPluginDescriptor descriptor;
+            qint64 modified = file.lastModified().toMSecsSinceEpoch();
+            if (index.contains(pluginPaths[i]) && index[pluginPaths[i]].modified == modified) {
+                descriptor = index[pluginPaths[i]];
+            } else if (readDescriptor(file.absoluteFilePath(), descriptor)) {
+                descriptor.modified = modified;
+                indexChanged = true;
+            } else {
+                continue;
+            }
+
+            CAPlugin* plugin = new CAPlugin(descriptor.name, descriptor.author, descriptor.version, "", pluginPaths[i], descriptor.homeUrl, descriptor.updateUrl);
+            for (const QString& lang : descriptor.descriptions.keys()) {
+                plugin->setDescription(descriptor.descriptions[lang], lang);
+            }
             _pluginList << plugin;
+            _descriptorMap[plugin] = descriptor;
+        }
+
+        if (indexChanged || index.size() != _pluginList.size()) {
+            writeIndex();
         }
     }
 }
 
+/*!
+	Parses the plugin's descriptor file \a fileName and stores its content into \a descriptor.
+	Returns True, if the file was parsed successfully, otherwise False.
+*/
+bool CAPluginManager::readDescriptor(const QString& fileName, CAPluginDescriptor& descriptor)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QXmlInputSource in(&file);
+    QXmlSimpleReader reader;
+    CAPluginManager pm(&descriptor);
+    reader.setContentHandler(&pm);
+    return reader.parse(in);
+}
+
+/*!
+	Returns the plugins index mapping the plugin directories to their descriptors or an empty map,
+	if the index doesn't exist or was written by a different version of Canorus.
+*/
+QHash<QString, CAPluginDescriptor> CAPluginManager::readIndex()
+{
+    QHash<QString, CAPluginDescriptor> index;
+
+    QFile file(CASettings::defaultSettingsPath() + "/" + INDEX_FILE);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return index;
+    }
+
+    QDataStream in(&file);
+    quint32 magic;
+    qint32 version;
+    QString canorusVersion;
+    in >> magic >> version >> canorusVersion;
+    if (magic != INDEX_MAGIC || version != INDEX_VERSION || canorusVersion != CANORUS_VERSION) {
+        return index;
+    }
+
+    in >> index;
+    if (in.status() != QDataStream::Ok) {
+        index.clear();
+    }
+
+    return index;
+}
+
+/*!
+	Stores the descriptors of all the read plugins into the plugins index.
+*/
+void CAPluginManager::writeIndex()
+{
+    QHash<QString, CAPluginDescriptor> index;
+    for (CAPlugin* plugin : _pluginList) {
+        index[plugin->dirName()] = _descriptorMap[plugin];
+    }
+
+    QDir().mkpath(CASettings::defaultSettingsPath());
+    QFile file(CASettings::defaultSettingsPath() + "/" + INDEX_FILE);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream out(&file);
+    out << INDEX_MAGIC << INDEX_VERSION << QString(CANORUS_VERSION) << index;
+}
+
 /*!
 	Enables and initializes all plugins, which are marked as auto-load in Canorus config file.
 	Returns true if all the plugins were successfully loaded, otherwise False.
@@ -151,7 +296,8 @@ bool CAPluginManager::disablePlugins()
 }
 
 /*!
-	Enables the plugin \a plugin and initializes it (action "onInit").
+	Enables the plugin \a plugin and creates its menus and actions in the given \a mainWin.
+	The plugin is initialized (action "onInit") when one of its actions is called for the first time.
 
 	Returns True, if the plugin was loaded successfully, otherwise False.
 
@@ -159,16 +305,17 @@ bool CAPluginManager::disablePlugins()
 */
 bool CAPluginManager::enablePlugin(CAPlugin* plugin, CAMainWin* mainWin)
 {
-    CAPluginManager* pm;
-    QFile* file = new QFile(plugin->dirName() + "/canorusplugin.xml");
-    file->open(QIODevice::ReadOnly);
-    QXmlInputSource in(file);
+    if (!_descriptorMap.contains(plugin)) {
+        CAPluginDescriptor descriptor;
+        QFileInfo file(plugin->dirName() + "/" + DESCRIPTOR_FILE);
+        if (!readDescriptor(file.absoluteFilePath(), descriptor)) {
+            return false;
+        }
+        descriptor.modified = file.lastModified().toMSecsSinceEpoch();
+        _descriptorMap[plugin] = descriptor;
+    }
 
-    QXmlSimpleReader reader;
-    reader.setContentHandler(pm = new CAPluginManager(mainWin, plugin));
-    reader.parse(in);
-    delete file;
-    delete pm;
+    createItems(plugin, _descriptorMap[plugin], mainWin);
 
     if (plugin->isEnabled())
         // plugin was enabled before
@@ -181,9 +328,125 @@ bool CAPluginManager::enablePlugin(CAPlugin* plugin, CAMainWin* mainWin)
     }
 
     plugin->setEnabled(true);
-    return plugin->action("onInit", mainWin);
+    return true;
+}
+
+/*!
+	Creates the actions and the top-level menus of the \a plugin's \a descriptor in the given
+	\a mainWin. The content of the menus (submenus, actions and separators) is only created when
+	the menu is opened for the first time, see fillMenuOnShow().
+*/
+void CAPluginManager::createItems(CAPlugin* plugin, const CAPluginDescriptor& descriptor, CAMainWin* mainWin)
+{
+    QList<CAPluginAction*> actions; // created action of each item or nullptr
+    for (const CAPluginItem& item : descriptor.items) {
+        if (item.type != CAPluginItem::Action) {
+            actions << nullptr;
+            continue;
+        }
+
+        CAPluginAction* action = new CAPluginAction(plugin, item.name, item.lang, item.function, item.args, item.filename);
+        if (!item.parentMenu.isEmpty()) {
+#ifndef SWIGCPP
+            action->setParent(mainWin);
+#else
+#endif
+        }
+
+        action->setOnAction(item.onAction);
+        action->setExportFilters(item.exportFilters);
+        action->setImportFilters(item.importFilters);
+        action->setTexts(item.texts);
+        action->setRefresh(item.refresh);
+
+        if (!item.parentToolbar.isEmpty())
+            ;
+        // TODO: add action to toolbar
+
+        // Add import and export filters to the generic list for faster lookup
+        QList<QString> filters;
+        filters = item.exportFilters.values();
+        for (int i = 0; i < filters.size(); i++) {
+            _exportFilterMap[filters[i]] = action; // added to the export dialog by CACanorus::exportDialog()
+        }
+
+        filters = item.importFilters.values();
+        for (int i = 0; i < filters.size(); i++) {
+            _importFilterMap[filters[i]] = action; // added to the import dialog by CACanorus::importDialog()
+        }
+
+        plugin->addAction(action);
+        actions << action;
+    }
+
+#ifndef SWIGCPP
+    for (const CAPluginItem& item : descriptor.items) {
+        if (item.type != CAPluginItem::Menu || !item.parentMenu.isEmpty()) {
+            continue;
+        }
+
+        // no parent menu set, add it to the top-level mainwindow's menu before the Help menu
+        QMenu* menu = new QMenu(mainWin->menuBar());
+        mainWin->menuBar()->insertMenu(mainWin->menuBar()->actions().last(), menu);
+        setupMenu(plugin, menu, item);
+        fillMenuOnShow(plugin, menu, item.name, descriptor, actions);
+    }
+#endif
 }
 
+#ifndef SWIGCPP
+/*!
+	Sets the name and the localized title of the plugin's \a menu from its descriptor \a item and
+	registers it in the \a plugin.
+*/
+void CAPluginManager::setupMenu(CAPlugin* plugin, QMenu* menu, const CAPluginItem& item)
+{
+    menu->setObjectName(item.name);
+
+    if (item.texts.contains(QLocale::system().name()))
+        menu->setTitle(item.texts[QLocale::system().name()]);
+    else
+        menu->setTitle(item.texts[""]);
+
+    plugin->addMenu(item.name, menu);
+}
+
+/*!
+	Fills the plugin's \a menu called \a menuName with its submenus, \a actions and separators
+	from the \a descriptor, when it is about to be shown for the first time.
+*/
+void CAPluginManager::fillMenuOnShow(CAPlugin* plugin, QMenu* menu, const QString& menuName, const CAPluginDescriptor& descriptor, const QList<CAPluginAction*>& actions)
+{
+    std::shared_ptr<QMetaObject::Connection> connection = std::make_shared<QMetaObject::Connection>();
+    *connection = QObject::connect(menu, &QMenu::aboutToShow, [connection, plugin, menu, menuName, descriptor, actions]() {
+        QObject::disconnect(*connection);
+        for (int i = 0; i < descriptor.items.size(); i++) {
+            const CAPluginItem& item = descriptor.items[i];
+            if (item.parentMenu != menuName) {
+                continue;
+            }
+
+            switch (item.type) {
+            case CAPluginItem::Separator:
+                menu->addSeparator();
+                break;
+            case CAPluginItem::Action:
+                menu->addAction(actions[i]);
+                break;
+            case CAPluginItem::Menu: {
+                // parent menu set, add a new submenu to it
+                QMenu* submenu = new QMenu(menu);
+                menu->addMenu(submenu);
+                setupMenu(plugin, submenu, item);
+                fillMenuOnShow(plugin, submenu, item.name, descriptor, actions);
+                break;
+            }
+            }
+        }
+    });
+}
+#endif
+
 /*!
 	Deinitializes the given \a plugin and remove any menus, toolbars and other GUI elements the plugin might
 	have created from all the main windows.
@@ -197,13 +460,16 @@ bool CAPluginManager::disablePlugin(CAPlugin* plugin)
         return true;
 
     bool res = true;
-    for (int i = 0; i < CACanorus::mainWinList().size(); i++) {
-        if (!plugin->action("onExit", CACanorus::mainWinList()[i])) {
-            res = false;
+    if (plugin->isInitialized()) {
+        for (int i = 0; i < CACanorus::mainWinList().size(); i++) {
+            if (!plugin->action("onExit", CACanorus::mainWinList()[i])) {
+                res = false;
+            }
         }
     }
 
     plugin->setEnabled(false);
+    plugin->setInitialized(false);
 
     // remove plugin specific actions from generic plugins actions list
     QList<QString> actions = plugin->actionList();
@@ -245,6 +511,10 @@ bool CAPluginManager::removePlugin(CAPlugin* plugin)
     disablePlugin(plugin);
     bool res = QFile::remove(plugin->dirName());
 
+    _pluginList.removeAll(plugin);
+    _descriptorMap.remove(plugin);
+    writeIndex();
+
     delete plugin;
     return res;
 }
@@ -256,36 +526,34 @@ bool CAPluginManager::startElement(const QString&, const QString&, const QString
     if (qName == "plugin") {
     }
 
-    if (_curPlugin) {
-        if (qName == "description") {
-            _curPluginLocale = attributes.value("lang");
-        } else if (qName == "text") {
-            _curActionLocale = attributes.value("lang");
-        } else if (qName == "title") {
-            _curMenuLocale = attributes.value("lang");
-        } else if (qName == "export-filter") {
-        } else if (qName == "import-filter") {
-        } else if (qName == "action") {
-            _curActionLang = "python";
-            _curActionFunction.clear();
-            _curActionFilename.clear();
-            _curActionArgs.clear();
-            _curActionText.clear();
-            _curActionLocale.clear();
-            _curActionName.clear();
-            _curActionExportFilter.clear();
-            _curActionImportFilter.clear();
-            _curActionOnAction.clear();
-            _curActionParentMenu.clear();
-            _curActionParentToolbar.clear();
-            _curActionRefresh = false;
-        } else if (qName == "menu") {
-            _curMenuTitle.clear();
-            _curMenuName.clear();
-            _curMenuLocale.clear();
-            _curMenuParentMenu.clear();
-        } else if (qName == "toolbar") {
-        }
+    if (qName == "description") {
+        _curPluginLocale = attributes.value("lang");
+    } else if (qName == "text") {
+        _curActionLocale = attributes.value("lang");
+    } else if (qName == "title") {
+        _curMenuLocale = attributes.value("lang");
+    } else if (qName == "export-filter") {
+    } else if (qName == "import-filter") {
+    } else if (qName == "action") {
+        _curActionLang = "python";
+        _curActionFunction.clear();
+        _curActionFilename.clear();
+        _curActionArgs.clear();
+        _curActionText.clear();
+        _curActionLocale.clear();
+        _curActionName.clear();
+        _curActionExportFilter.clear();
+        _curActionImportFilter.clear();
+        _curActionOnAction.clear();
+        _curActionParentMenu.clear();
+        _curActionParentToolbar.clear();
+        _curActionRefresh = false;
+    } else if (qName == "menu") {
+        _curMenuTitle.clear();
+        _curMenuName.clear();
+        _curMenuLocale.clear();
+        _curMenuParentMenu.clear();
+    } else if (qName == "toolbar") {
     }
 
     return true;
@@ -295,124 +563,85 @@ bool CAPluginManager::endElement(const QString&, const QString&, const QString&
 {
     _tree.pop();
 
-    if (_curPlugin) {
-        // top-level tags
-        if (qName == "canorus-version") {
-            _curPluginCanorusVersion = _curChars;
-        } else if (qName == "name") {
-            if (_tree.back() == "plugin")
-                _curPlugin->setName(_curChars);
-            else if (_tree.back() == "action")
-                _curActionName = _curChars;
-            else if (_tree.back() == "menu")
-                _curMenuName = _curChars;
-        } else if (qName == "version") {
-            _curPlugin->setVersion(_curChars);
-        } else if (qName == "author") {
-            _curPlugin->setAuthor(_curChars);
-        } else if (qName == "home-url") {
-            _curPlugin->setHomeUrl(_curChars);
-        } else if (qName == "update-url") {
-            _curPlugin->setUpdateUrl(_curChars);
-        } else if (qName == "description") {
-            _curPlugin->setDescription(_curChars, _curPluginLocale);
-        } else if (qName == "separator") {
-            _curPlugin->menu(_curActionParentMenu)->addSeparator();
-        } else if (qName == "action") {
-            CAPluginAction* action = new CAPluginAction(_curPlugin, _curActionName, _curActionLang, _curActionFunction, _curActionArgs, _curActionFilename);
-            if (!_curActionParentMenu.isEmpty()) {
-#ifndef SWIGCPP
-                action->setParent(_mainWin);
-#else
-#endif
-                _curPlugin->menu(_curActionParentMenu)->addAction(action);
-            }
-
-            action->setOnAction(_curActionOnAction);
-            action->setExportFilters(_curActionExportFilter);
-            action->setImportFilters(_curActionImportFilter);
-            action->setTexts(_curActionText);
-            action->setRefresh(_curActionRefresh);
-
-            if (!_curActionParentToolbar.isEmpty())
-                ;
-            // TODO: add action to toolbar
-
-            // Add import and export filters to the generic list for faster lookup
-            QList<QString> filters;
-            filters = _curActionExportFilter.values();
-            for (int i = 0; i < filters.size(); i++) {
-                _exportFilterMap[filters[i]] = action;
-#ifndef SWIGCPP
-                _mainWin->exportDialog()->setNameFilters(_mainWin->exportDialog()->nameFilters() << filters[i]);
-#else
-// TODO
-#endif
-            }
-
-            filters = _curActionImportFilter.values();
-            for (int i = 0; i < filters.size(); i++) {
-                _importFilterMap[filters[i]] = action;
-#ifndef SWIGCPP
-                _mainWin->importDialog()->setNameFilters(_mainWin->importDialog()->nameFilters() << filters[i]);
-#else
-// TODO
-#endif
-            }
-
-            _curPlugin->addAction(action);
-        } else if (qName == "menu") {
-#ifndef SWIGCPP
-            QMenu* menu;
-            if (_curMenuParentMenu.isEmpty()) {
-                // no parefnt menu set, add it to the top-level mainwindow's menu before the Help menu
-                menu = new QMenu(_mainWin->menuBar());
-                _mainWin->menuBar()->insertMenu(_mainWin->menuBar()->actions().last(), menu);
-            } else {
-                // parent menu set, find it and add a new submenu to it
-                menu = new QMenu(_curPlugin->menu(_curMenuParentMenu));
-                _curPlugin->menu(_curMenuParentMenu)->addMenu(menu);
-            }
-            menu->setObjectName(_curMenuName);
-
-            if (_curMenuTitle.contains(QLocale::system().name()))
-                menu->setTitle(_curMenuTitle[QLocale::system().name()]);
-            else
-                menu->setTitle(_curMenuTitle[""]);
-
-            _curPlugin->addMenu(_curMenuName, menu);
-#else
-#endif
-        } else
-            // action level
-            if (qName == "on-action") {
-            _curActionOnAction = _curChars;
-        } else if (qName == "lang") {
-            if (_tree.back() == "action")
-                _curActionLocale = _curChars;
-            else if (_tree.back() == "menu")
-                _curMenuLocale = _curChars;
-        } else if (qName == "function") {
-            _curActionFunction = _curChars;
-        } else if (qName == "filename") {
-            _curActionFilename = _curChars;
-        } else if (qName == "text") {
-            _curActionText[_curActionLocale] = _curChars;
-        } else if (qName == "args") {
-            _curActionArgs << _curChars;
-        } else if (qName == "parent-menu") {
-            _curActionParentMenu = _curChars;
-        } else if (qName == "export-filter") {
-            _curActionExportFilter[_curActionLocale] = _curChars;
-        } else if (qName == "import-filter") {
-            _curActionImportFilter[_curActionLocale] = _curChars;
-        } else if (qName == "refresh") {
-            _curActionRefresh = true;
-        } else
-            // menu level
-            if (qName == "title") {
-            _curMenuTitle[_curMenuLocale] = _curChars;
-        }
+    // top-level tags
+    if (qName == "canorus-version") {
+        _curPluginCanorusVersion = _curChars;
+    } else if (qName == "name") {
+        if (_tree.back() == "plugin")
+            _descriptor->name = _curChars;
+        else if (_tree.back() == "action")
+            _curActionName = _curChars;
+        else if (_tree.back() == "menu")
+            _curMenuName = _curChars;
+    } else if (qName == "version") {
+        _descriptor->version = _curChars;
+    } else if (qName == "author") {
+        _descriptor->author = _curChars;
+    } else if (qName == "home-url") {
+        _descriptor->homeUrl = _curChars;
+    } else if (qName == "update-url") {
+        _descriptor->updateUrl = _curChars;
+    } else if (qName == "description") {
+        _descriptor->descriptions[_curPluginLocale] = _curChars;
+    } else if (qName == "separator") {
+        CAPluginItem separator;
+        separator.type = CAPluginItem::Separator;
+        separator.parentMenu = _curActionParentMenu;
+        separator.refresh = false;
+        _descriptor->items << separator;
+    } else if (qName == "action") {
+        CAPluginItem action;
+        action.type = CAPluginItem::Action;
+        action.name = _curActionName;
+        action.parentMenu = _curActionParentMenu;
+        action.texts = _curActionText;
+        action.onAction = _curActionOnAction;
+        action.lang = _curActionLang;
+        action.function = _curActionFunction;
+        action.filename = _curActionFilename;
+        action.args = _curActionArgs;
+        action.exportFilters = _curActionExportFilter;
+        action.importFilters = _curActionImportFilter;
+        action.parentToolbar = _curActionParentToolbar;
+        action.refresh = _curActionRefresh;
+        _descriptor->items << action;
+    } else if (qName == "menu") {
+        CAPluginItem menu;
+        menu.type = CAPluginItem::Menu;
+        menu.name = _curMenuName;
+        menu.parentMenu = _curMenuParentMenu;
+        menu.texts = _curMenuTitle;
+        menu.refresh = false;
+        _descriptor->items << menu;
+    } else
+        // action level
+        if (qName == "on-action") {
+        _curActionOnAction = _curChars;
+    } else if (qName == "lang") {
+        if (_tree.back() == "action")
+            _curActionLocale = _curChars;
+        else if (_tree.back() == "menu")
+            _curMenuLocale = _curChars;
+    } else if (qName == "function") {
+        _curActionFunction = _curChars;
+    } else if (qName == "filename") {
+        _curActionFilename = _curChars;
+    } else if (qName == "text") {
+        _curActionText[_curActionLocale] = _curChars;
+    } else if (qName == "args") {
+        _curActionArgs << _curChars;
+    } else if (qName == "parent-menu") {
+        _curActionParentMenu = _curChars;
+    } else if (qName == "export-filter") {
+        _curActionExportFilter[_curActionLocale] = _curChars;
+    } else if (qName == "import-filter") {
+        _curActionImportFilter[_curActionLocale] = _curChars;
+    } else if (qName == "refresh") {
+        _curActionRefresh = true;
+    } else
+        // menu level
+        if (qName == "title") {
+        _curMenuTitle[_curMenuLocale] = _curChars;
     }
 
     return true;
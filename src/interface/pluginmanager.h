@@ -1,6 +1,6 @@
 /** @file interface/pluginmanager.h
  *
- * Copyright (c) 2006-2019, Matevž Jekovec, Canorus development team
+ * Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
  * All Rights Reserved. See AUTHORS for a complete list of authors.
  * 
  * Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -9,9 +9,11 @@
 #ifndef PLUGINMANAGER_H_
 #define PLUGINMANAGER_H_
 
+#include <QList>
 #include <QMultiHash>
 #include <QStack>
 #include <QString>
+#include <QStringList>
 #include <QXmlDefaultHandler>
 
 class CAMainWin;
@@ -19,12 +21,55 @@ class CADocument;
 class CAPlugin;
 class CAPluginAction;
 
+class QDataStream;
 class QEvent;
+class QMenu;
 class QPoint;
 
+struct CAPluginDescriptor;
+
+#ifndef SWIG
+struct CAPluginItem {
+    enum CAPluginItemType {
+        Menu,
+        Action,
+        Separator
+    };
+
+    CAPluginItemType type;
+    QString name;
+    QString parentMenu;
+    QHash<QString, QString> texts; // LOCALE menu titles or action texts
+
+    // <action> tag:
+    QString onAction;
+    QString lang, function, filename;
+    QList<QString> args;
+    QHash<QString, QString> exportFilters, importFilters;
+    QString parentToolbar;
+    bool refresh;
+};
+
+struct CAPluginDescriptor {
+    qint64 modified; // modification time of the descriptor file in ms since epoch
+    QString name;
+    QString version;
+    QString author;
+    QString homeUrl;
+    QString updateUrl;
+    QHash<QString, QString> descriptions; // LOCALE descriptions
+    QList<CAPluginItem> items; // menus, actions and separators in the descriptor order
+};
+
+QDataStream& operator<<(QDataStream& out, const CAPluginItem& item);
+QDataStream& operator>>(QDataStream& in, CAPluginItem& item);
+QDataStream& operator<<(QDataStream& out, const CAPluginDescriptor& descriptor);
+QDataStream& operator>>(QDataStream& in, CAPluginDescriptor& descriptor);
+#endif
+
 class CAPluginManager : public QXmlDefaultHandler {
 public:
-    CAPluginManager(CAMainWin* mainWin, CAPlugin* plugin);
+    CAPluginManager(CAPluginDescriptor* descriptor);
     ~CAPluginManager();
 
     static void readPlugins();
@@ -37,7 +82,11 @@ public:
     static bool exportFilterExists(const QString filter) { return _exportFilterMap.contains(filter); }
     static void exportAction(QString filter, CADocument* document, QString filename);
     static bool importFilterExists(const QString filter) { return _importFilterMap.contains(filter); }
+    static QStringList exportFilters() { return _exportFilterMap.keys(); }
+    static QStringList importFilters() { return _importFilterMap.keys(); }
     static void importAction(QString filter, CADocument* document, QString filename);
+    static CAPluginAction* exportFilterAction(const QString filter) { return _exportFilterMap.value(filter); }
+    static CAPluginAction* importFilterAction(const QString filter) { return _importFilterMap.value(filter); }
 
     static bool installPlugin(QString path);
     static bool removePlugin(CAPlugin* plugin);
@@ -52,18 +101,33 @@ public:
     bool fatalError(const QXmlParseException& exception);
     bool characters(const QString& ch);
 
+    static const QString DESCRIPTOR_FILE;
+    static const QString INDEX_FILE;
+
 private:
     static QList<CAPlugin*> _pluginList;
     static QMultiHash<QString, CAPlugin*> _actionMap;
     static QHash<QString, CAPluginAction*> _exportFilterMap;
     static QHash<QString, CAPluginAction*> _importFilterMap;
 
+#ifndef SWIG
+    static QHash<CAPlugin*, CAPluginDescriptor> _descriptorMap;
+
+    static bool readDescriptor(const QString& fileName, CAPluginDescriptor& descriptor);
+    static QHash<QString, CAPluginDescriptor> readIndex();
+    static void writeIndex();
+    static void createItems(CAPlugin* plugin, const CAPluginDescriptor& descriptor, CAMainWin* mainWin);
+#ifndef SWIGCPP
+    static void setupMenu(CAPlugin* plugin, QMenu* menu, const CAPluginItem& item);
+    static void fillMenuOnShow(CAPlugin* plugin, QMenu* menu, const QString& menuName, const CAPluginDescriptor& descriptor, const QList<CAPluginAction*>& actions);
+#endif
+
     // non-static members needed while parsing plugin's descriptor file:
-    CAMainWin* _mainWin;
+    CAPluginDescriptor* _descriptor;
+#endif
     QString _curChars;
     QStack<QString> _tree;
 
-    CAPlugin* _curPlugin;
     QString _curPluginCanorusVersion;
     QString _curPluginLocale;
 
@@ -6,16 +6,227 @@
 */
 
 #include <QCoreApplication>
+#include <QMutexLocker>
+#include <QSemaphore>
+#include <QThread>
 #include <QVector>
 #include <sstream>
 
 #include "../lib/rtmidi-4.0.0/RtMidi.h"
+#include "core/trace.h"
 #include "interface/rtmididevice.h"
 
+#include <atomic>
+#include <cstring>
+
 #ifndef SWIGCPP
 #include "canorus.h"
 #endif
 
+/*!
+	\class CAMidiQueue
+	\brief Fixed size single-producer, single-consumer queue of MIDI messages
+
+	The queue indices are atomic, so one thread can queue the messages while another one takes them
+	without any locks. Each message keeps its time in nanoseconds of CATrace::now().
+*/
+class CAMidiQueue {
+public:
+    static const int MESSAGE_SIZE = 4; // longest channel message with a spare byte
+
+    struct CAMidiMessage {
+        qint64 time; // see CATrace::now()
+        int size;
+        unsigned char data[MESSAGE_SIZE];
+    };
+
+    CAMidiQueue()
+        : _head(0)
+        , _tail(0)
+    {
+    }
+
+    bool push(const unsigned char* data, int size, qint64 time);
+    bool pop(CAMidiMessage& message);
+
+private:
+    static const int QUEUE_SIZE = 1024;
+
+    CAMidiMessage _queue[QUEUE_SIZE];
+    std::atomic<quint32> _head; // number of queued messages, written by the producer only
+    std::atomic<quint32> _tail; // number of taken messages, written by the consumer only
+};
+
+/*!
+	Queues the message of the given \a size with its \a time. Returns False, if the queue is full.
+	The message must not be longer than MESSAGE_SIZE.
+*/
+bool CAMidiQueue::push(const unsigned char* data, int size, qint64 time)
+{
+    quint32 head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) >= static_cast<quint32>(QUEUE_SIZE)) {
+        return false;
+    }
+
+    CAMidiMessage& message = _queue[head % QUEUE_SIZE];
+    message.time = time;
+    message.size = size;
+    memcpy(message.data, data, static_cast<size_t>(size));
+
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+/*!
+	Takes the oldest \a message from the queue. Returns False, if the queue is empty.
+*/
+bool CAMidiQueue::pop(CAMidiMessage& message)
+{
+    quint32 tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    message = _queue[tail % QUEUE_SIZE];
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+/*!
+	\class CARtMidiSender
+	\brief Output thread of CARtMidiDevice
+
+	Messages are passed from the playback to this thread through CAMidiQueue, so the playback never
+	waits for the MIDI driver and a slow ALSA or CoreMIDI call doesn't delay its next event. The
+	thread is woken up by a semaphore for each queued message. Messages too long for the queue,
+	eg. system exclusive, are sent by sendLong() after the queued ones.
+
+	Each message is recorded in the trace from the time it was queued until it was sent.
+*/
+class CARtMidiSender : public QThread {
+public:
+    CARtMidiSender(RtMidiOut* out, QMutex* outMutex)
+        : _running(true)
+        , _out(out)
+        , _outMutex(outMutex)
+        , _queued(0)
+        , _sent(0)
+    {
+        setObjectName("MIDI output");
+    }
+
+    bool push(const unsigned char* data, int size);
+    void sendLong(const unsigned char* data, int size);
+    void stop();
+
+protected:
+    void run();
+
+private:
+    CAMidiQueue _queue;
+    QSemaphore _pending;
+    std::atomic<bool> _running;
+    RtMidiOut* _out;
+    QMutex* _outMutex;
+    quint32 _queued; // number of queued messages, used by the producer only
+    std::atomic<quint32> _sent; // number of sent queued messages, written by the sender thread only
+};
+
+/*!
+	Queues the message of the given \a size. If the queue is full, waits until the sender thread
+	makes space.
+
+	Returns False, if the message is too long for the queue.
+*/
+bool CARtMidiSender::push(const unsigned char* data, int size)
+{
+    if (size > CAMidiQueue::MESSAGE_SIZE) {
+        return false;
+    }
+
+    qint64 time = CATrace::now();
+    while (!_queue.push(data, size, time)) {
+        QThread::yieldCurrentThread();
+    }
+    _queued++;
+    _pending.release();
+
+    return true;
+}
+
+/*!
+	Sends the message of the given  size, which is too long for the queue, directly from the
+	calling thread. Waits until the sender thread sent all the queued messages first, so eg. the
+	program changes queued before a reset system exclusive message aren't reset by it.
+*/
+void CARtMidiSender::sendLong(const unsigned char* data, int size)
+{
+    while (_sent.load(std::memory_order_acquire) != _queued) {
+        QThread::yieldCurrentThread();
+    }
+
+    QMutexLocker locker(_outMutex);
+    try {
+        _out->sendMessage(data, static_cast<size_t>(size));
+    } catch (RtMidiError& error) {
+        error.printMessage();
+    }
+}
+
+/*!
+	Sends the remaining queued messages and finishes the thread.
+*/
+void CARtMidiSender::stop()
+{
+    _running.store(false);
+    _pending.release();
+    wait();
+}
+
+void CARtMidiSender::run()
+{
+    CAMidiQueue::CAMidiMessage message;
+    while (true) {
+        _pending.acquire();
+
+        if (!_queue.pop(message)) {
+            if (!_running.load()) {
+                break;
+            }
+            continue;
+        }
+
+        {
+            QMutexLocker locker(_outMutex);
+            try {
+                _out->sendMessage(message.data, static_cast<size_t>(message.size));
+            } catch (RtMidiError& error) {
+                error.printMessage();
+            }
+        }
+        _sent.fetch_add(1, std::memory_order_release);
+        if (CATrace::isEnabled()) {
+            CATrace::record("CARtMidiDevice::send", message.time, CATrace::now());
+        }
+    }
+}
+
+/*!
+	\class CARtMidiOutput
+	\brief Extra output port of CARtMidiDevice
+
+	Each extra port has its own RtMidi client and output thread, so a slow synthesizer on one port
+	doesn't delay the messages of the others.
+*/
+struct CARtMidiOutput {
+    RtMidiOut* out;
+    CARtMidiSender* sender;
+    QMutex outMutex; // guards out used by the sender thread
+    int latency; // in miliseconds, see CASettings::midiOutLatency()
+};
+
+const QEvent::Type CARtMidiDevice::MIDI_IN_EVENT = static_cast<QEvent::Type>(QEvent::registerEventType());
+
 /*!
 	\class CARtMidiDevice
 	\brief Canorus wrapper for RtMidi library
@@ -26,7 +237,11 @@
 	1) When created, Input and Output MIDI devices get initialized.
 	2) Call getOutputPorts() and getInputPorts() to retreive a map of portNumber/portName.
 	3) Call openOutputPort(port) and/or openInputPort(port) to open an Output/Input port.
-	4) Send MIDI events (for midi output) using send(QVector<unsigned char>).
+	4) Send MIDI events (for midi output) using send(QVector<unsigned char>). The events are queued
+	   and sent by the output thread, see CARtMidiSender.
+
+	Voices routed to other synthesizers are played by the extra output ports, opened by
+	openExtraOutputPort() and fed by sendToPort(). They are closed together with the output port.
 
 	\todo Callback function implementation for retreiving MIDI-IN events. This should
 	      probably be done by using Qt's signal-slot implementation. -Matevz
@@ -38,7 +253,12 @@ CARtMidiDevice::CARtMidiDevice()
     _midiDeviceType = RtMidiDevice;
     _out = nullptr;
     _in = nullptr;
+    _sender = nullptr;
+    _inQueue = new CAMidiQueue();
+    _inPending = false;
+    _inTime = -1;
     _outOpen = false;
+    _outPort = -1;
     _inOpen = false;
     setRealTime(true);
 
@@ -63,11 +283,20 @@ bool CARtMidiDevice::openOutputPort(int port)
     if (_out && static_cast<int>(_out->getPortCount()) > port) { // check outputs
         try {
             _out->openPort(static_cast<unsigned int>(port));
+#ifndef SWIGCPP
+            // the latency is calibrated for each synthesizer
+            if (CACanorus::settings()) {
+                setOutputLatency(CACanorus::settings()->midiOutLatency(QString::fromStdString(_out->getPortName(static_cast<unsigned int>(port)))));
+            }
+#endif
         } catch (RtMidiError& error) {
             error.printMessage();
             return false; // error when opening the port
         }
         _outOpen = true;
+        _outPort = port;
+        _sender = new CARtMidiSender(_out, &_outMutex);
+        _sender->start(QThread::TimeCriticalPriority);
         return true; // port opened successfully
     } else {
         std::cerr << "CARtMidiDevice::openOutputPort(): Port number " << port << " doesn't exist!" << std::endl;
@@ -81,13 +310,14 @@ bool CARtMidiDevice::openInputPort(int port)
         return false;
 
     if (_in && static_cast<int>(_in->getPortCount()) > port) { // check outputs
+        _inTime = -1; // deltatime of the first message is measured from the previous port
         try {
             _in->openPort(static_cast<unsigned int>(port));
         } catch (RtMidiError& error) {
             error.printMessage();
             return false; // error when opening the port
         }
-        _in->setCallback(&rtMidiInCallback); // sets the callback function
+        _in->setCallback(&rtMidiInCallback, this); // sets the callback function
         _inOpen = true;
         return true; // port opened successfully
     } else {
@@ -98,19 +328,80 @@ bool CARtMidiDevice::openInputPort(int port)
 
 /*!
 	Callback function which gets called by RtMidi automatically when an information on MidiIn device has come.
+
+	The callback runs on the RtMidi input thread. The message is only put into the input queue of
+	the device given by \a userData and the main thread is notified, if it isn't already going to
+	read the queue. Messages longer than a channel message (eg. system exclusive) are ignored.
+
+	Messages are timestamped by summing the \a deltatime reported by RtMidi, which is measured by
+	the driver when the message arrives, so the time doesn't depend on how soon the callback was
+	called. The sum starts at CATrace::now() of the first message and is synchronized again,
+	if it drifts away from the clock by more than a second (eg. after the driver dropped messages).
+
+	\sa CARtMidiDevice::event()
+*/
+void rtMidiInCallback(double deltatime, std::vector<unsigned char>* message, void* userData)
+{
+    CARtMidiDevice* device = static_cast<CARtMidiDevice*>(userData);
+    if (!device)
+        return;
+
+    qint64 now = CATrace::now();
+    if (device->_inTime < 0) {
+        device->_inTime = now;
+    } else {
+        device->_inTime += qRound64(deltatime * 1e9);
+        if (device->_inTime > now || now - device->_inTime > 1000000000) {
+            device->_inTime = now;
+        }
+    }
+
+    if (message->empty() || message->size() > static_cast<size_t>(CAMidiQueue::MESSAGE_SIZE))
+        return;
+
+    if (!device->_inQueue->push(message->data(), static_cast<int>(message->size()), device->_inTime)) {
+        std::cerr << "CARtMidiDevice: MIDI input queue is full, message dropped" << std::endl;
+    }
+
+    if (!device->_inPending.exchange(true)) {
+        QCoreApplication::postEvent(device, new QEvent(CARtMidiDevice::MIDI_IN_EVENT));
+    }
+}
+
+/*!
+	Emits midiInEvent() and timedMidiInEvent() for each message received since the last call on the
+	main thread. Notes played together are delivered at once, so the receivers can group them into a
+	chord.
 */
-void rtMidiInCallback(double, std::vector<unsigned char>* message, void*)
+bool CARtMidiDevice::event(QEvent* event)
 {
-    (void)message; // Only used in with SWIGCPP
+    if (event->type() != MIDI_IN_EVENT) {
+        return CAMidiDevice::event(event);
+    }
+
+    _inPending.store(false); // messages coming from now on post a new event
+    CAMidiQueue::CAMidiMessage message;
+    while (_inQueue->pop(message)) {
 #ifndef SWIGCPP
-    emit CACanorus::midiDevice()->midiInEvent(QVector<unsigned char>::fromStdVector(*message));
-#else
-        // call scripting callback?
+        QVector<unsigned char> m(message.size);
+        memcpy(m.data(), message.data, static_cast<size_t>(message.size));
+        emit midiInEvent(m);
+        emit timedMidiInEvent(m, message.time);
 #endif
+    }
+
+    return true;
 }
 
 void CARtMidiDevice::closeOutputPort()
 {
+    if (_sender) {
+        QMutexLocker locker(&_sendMutex);
+        _sender->stop(); // note off events may still be queued
+        delete _sender;
+        _sender = nullptr;
+    }
+
     try {
         if (_outOpen)
             _out->closePort();
@@ -118,6 +409,75 @@ void CARtMidiDevice::closeOutputPort()
         error.printMessage();
     }
     _outOpen = false;
+    _outPort = -1;
+
+    QMutexLocker locker(&_sendMutex);
+    for (CARtMidiOutput* output : _extraOutputs) {
+        output->sender->stop();
+        delete output->sender;
+        try {
+            output->out->closePort();
+        } catch (RtMidiError& error) {
+            error.printMessage();
+        }
+        delete output->out;
+        delete output;
+    }
+    _extraOutputs.clear();
+}
+
+/*!
+	Opens the output \a port in addition to the one opened by openOutputPort(). Returns True, if the
+	port is open now. The port opened by openOutputPort() is not opened again, sendToPort() uses it
+	directly.
+*/
+bool CARtMidiDevice::openExtraOutputPort(int port)
+{
+    if (port == -1 || !_outOpen || port == _outPort)
+        return false;
+
+    QMutexLocker locker(&_sendMutex);
+    if (_extraOutputs.contains(port))
+        return true;
+
+    RtMidiOut* out = nullptr;
+    try {
+        out = new RtMidiOut(RtMidi::UNSPECIFIED, _midiNameOut.str());
+        if (static_cast<int>(out->getPortCount()) <= port) {
+            std::cerr << "CARtMidiDevice::openExtraOutputPort(): Port number " << port << " doesn't exist!" << std::endl;
+            delete out;
+            return false;
+        }
+        out->openPort(static_cast<unsigned int>(port));
+    } catch (RtMidiError& error) {
+        error.printMessage();
+        delete out;
+        return false;
+    }
+
+    CARtMidiOutput* output = new CARtMidiOutput;
+    output->out = out;
+    output->latency = outputLatency();
+#ifndef SWIGCPP
+    if (CACanorus::settings()) {
+        output->latency = CACanorus::settings()->midiOutLatency(QString::fromStdString(out->getPortName(static_cast<unsigned int>(port))));
+    }
+#endif
+    output->sender = new CARtMidiSender(out, &output->outMutex);
+    output->sender->start(QThread::TimeCriticalPriority);
+    _extraOutputs[port] = output;
+
+    return true;
+}
+
+/*!
+	Returns the output latency of the given output \a port, the one of the default port for -1 or
+	a port not opened by openExtraOutputPort().
+*/
+int CARtMidiDevice::portLatency(int port)
+{
+    QMutexLocker locker(&_sendMutex);
+    return _extraOutputs.contains(port) ? _extraOutputs[port]->latency : outputLatency();
 }
 
 void CARtMidiDevice::closeInputPort()
@@ -167,14 +527,42 @@ CARtMidiDevice::~CARtMidiDevice()
         delete _out;
     if (_in)
         delete _in;
+    delete _inQueue;
 }
 
 /*!
 	Sends the given \a message to the midi device. \a offset is ignored because CARtMidiDevice is a realtime device.
+
+	The message is queued and sent by the output thread. Messages longer than a channel message
+	(eg. system exclusive) are sent directly.
 */
 void CARtMidiDevice::send(QVector<unsigned char> message, int)
 {
-    std::vector<unsigned char> messageVector = message.toStdVector();
-    if (_outOpen)
-        _out->sendMessage(&messageVector);
+    QMutexLocker locker(&_sendMutex);
+    if (!_outOpen || !_sender || message.isEmpty())
+        return;
+
+    if (!_sender->push(message.constData(), message.size())) {
+        _sender->sendLong(message.constData(), message.size());
+    }
+}
+
+/*!
+	Sends the given \a message to the output \a port opened by openExtraOutputPort(). The message is
+	sent to the default output port, if the port is -1 or it isn't open.
+*/
+void CARtMidiDevice::sendToPort(int port, QVector<unsigned char> message, int time)
+{
+    {
+        QMutexLocker locker(&_sendMutex);
+        CARtMidiOutput* output = _extraOutputs.value(port, nullptr);
+        if (output) {
+            if (!message.isEmpty() && !output->sender->push(message.constData(), message.size())) {
+                output->sender->sendLong(message.constData(), message.size());
+            }
+            return;
+        }
+    }
+
+    send(message, time);
 }
@@ -8,11 +8,18 @@
 #ifndef RTMIDIDEVICE_H_
 #define RTMIDIDEVICE_H_
 
+#include <QEvent>
+#include <QMutex>
+
 #include "interface/mididevice.h"
+#include <atomic>
 #include <sstream>
 
 class RtMidiOut;
 class RtMidiIn;
+class CARtMidiSender;
+class CAMidiQueue;
+struct CARtMidiOutput;
 
 #ifndef SWIG
 void rtMidiInCallback(double deltatime, std::vector<unsigned char>* message, void* userData);
@@ -33,10 +40,32 @@ public:
     void send(QVector<unsigned char> message, int time);
     void sendMetaEvent(int, char, char, char, int) {}
 
+    bool openExtraOutputPort(int port);
+    void sendToPort(int port, QVector<unsigned char> message, int time);
+    int portLatency(int port);
+
+#ifndef SWIG
+protected:
+    bool event(QEvent* event);
+#endif
+
 private:
+#ifndef SWIG
+    friend void rtMidiInCallback(double deltatime, std::vector<unsigned char>* message, void* userData);
+    static const QEvent::Type MIDI_IN_EVENT;
+    CAMidiQueue* _inQueue; // messages received by rtMidiInCallback() and not yet read by the main thread
+    std::atomic<bool> _inPending; // MIDI_IN_EVENT was posted and not handled yet
+    qint64 _inTime; // time of the last received message, used by rtMidiInCallback() only
+#endif
+
     RtMidiOut* _out;
     RtMidiIn* _in;
+    CARtMidiSender* _sender; // sends the queued messages to _out while the output port is open
+    QMutex _sendMutex; // serializes the callers of send()
+    QMutex _outMutex; // guards _out used by the sender thread
     bool _outOpen;
+    int _outPort; // number of the open output port, -1 if closed
+    QMap<int, CARtMidiOutput*> _extraOutputs; // output ports opened by openExtraOutputPort()
     bool _inOpen;
     qint64 _pid;
     std::stringstream _midiNameIn;
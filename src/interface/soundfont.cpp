@@ -0,0 +1,348 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QFile>
+#include <QObject>
+#include <QtEndian>
+
+#include "interface/soundfont.h"
+
+#include <cmath>
+
+namespace {
+
+// generators used by the synth, see the SoundFont 2.01 specification
+enum CAGenerator {
+    StartAddrsOffset = 0,
+    EndAddrsOffset = 1,
+    StartloopAddrsOffset = 2,
+    EndloopAddrsOffset = 3,
+    StartAddrsCoarseOffset = 4,
+    EndAddrsCoarseOffset = 12,
+    Pan = 17,
+    DelayVolEnv = 33,
+    AttackVolEnv = 34,
+    HoldVolEnv = 35,
+    DecayVolEnv = 36,
+    SustainVolEnv = 37,
+    ReleaseVolEnv = 38,
+    Instrument = 41,
+    KeyRange = 43,
+    VelRange = 44,
+    StartloopAddrsCoarseOffset = 45,
+    InitialAttenuation = 48,
+    EndloopAddrsCoarseOffset = 50,
+    CoarseTune = 51,
+    FineTune = 52,
+    SampleID = 53,
+    SampleModes = 54,
+    ScaleTuning = 56,
+    OverridingRootKey = 58,
+    GeneratorCount = 61
+};
+
+// generators of the preset zones added to the instrument zones, the others are instrument only
+const int additiveGenerators[] = { Pan, DelayVolEnv, AttackVolEnv, HoldVolEnv, DecayVolEnv, SustainVolEnv, ReleaseVolEnv, InitialAttenuation, CoarseTune, FineTune, ScaleTuning };
+
+const int PHDR_SIZE = 38;
+const int BAG_SIZE = 4;
+const int GEN_SIZE = 4;
+const int INST_SIZE = 22;
+const int SHDR_SIZE = 46;
+
+struct CAGeneratorList {
+    int amount[GeneratorCount];
+    int keyLow, keyHigh;
+    int velocityLow, velocityHigh;
+};
+
+/*!
+	Records of a pdta sub-chunk.
+*/
+class CARecords {
+public:
+    CARecords(const QByteArray& data, QPair<int, int> chunk, int size)
+        : _data(reinterpret_cast<const uchar*>(data.constData()) + chunk.first)
+        , _size(size)
+        , _count(chunk.second / size)
+    {
+    }
+
+    inline int count() const { return _count; }
+    inline int u8(int i, int offset) const { return _data[i * _size + offset]; }
+    inline int s8(int i, int offset) const { return static_cast<signed char>(_data[i * _size + offset]); }
+    inline int u16(int i, int offset) const { return qFromLittleEndian<quint16>(_data + i * _size + offset); }
+    inline int s16(int i, int offset) const { return qFromLittleEndian<qint16>(_data + i * _size + offset); }
+    inline int u32(int i, int offset) const { return static_cast<int>(qMin(qFromLittleEndian<quint32>(_data + i * _size + offset), 0x7fffffffu)); }
+
+private:
+    const uchar* _data;
+    int _size;
+    int _count;
+};
+
+/*!
+	Collects the chunks from \a begin to \a end of the RIFF \a data by their id. The LIST chunks are
+	entered, so their sub-chunks are collected instead.
+*/
+void readChunks(const QByteArray& data, int begin, int end, QHash<QByteArray, QPair<int, int>>& chunks)
+{
+    const uchar* p = reinterpret_cast<const uchar*>(data.constData());
+    int pos = begin;
+    while (pos + 8 <= end) {
+        QByteArray id = data.mid(pos, 4);
+        quint32 size = qFromLittleEndian<quint32>(p + pos + 4);
+        if (size > static_cast<quint32>(end - pos - 8)) {
+            break;
+        }
+
+        if (id == "LIST" && size >= 4) {
+            readChunks(data, pos + 12, pos + 8 + size, chunks);
+        } else {
+            chunks[id] = qMakePair(pos + 8, static_cast<int>(size));
+        }
+        pos += 8 + size + (size & 1);
+    }
+}
+
+/*!
+	Applies the generators from \a first to \a last - 1 to the \a list.
+	Returns the value of the \a terminal generator (instrument or sample id), -1 if not set.
+*/
+int applyGenerators(const CARecords& gens, int first, int last, int terminal, CAGeneratorList& list)
+{
+    int value = -1;
+    for (int i = first; i < last && i < gens.count(); i++) {
+        int oper = gens.u16(i, 0);
+        if (oper == KeyRange) {
+            list.keyLow = gens.u8(i, 2);
+            list.keyHigh = gens.u8(i, 3);
+        } else if (oper == VelRange) {
+            list.velocityLow = gens.u8(i, 2);
+            list.velocityHigh = gens.u8(i, 3);
+        } else if (oper == terminal) {
+            value = gens.u16(i, 2);
+        } else if (oper < GeneratorCount) {
+            list.amount[oper] = gens.s16(i, 2);
+        }
+    }
+    return value;
+}
+
+inline float timecentsToSeconds(int timecents)
+{
+    return (timecents <= -12000) ? 0 : static_cast<float>(std::pow(2.0, timecents / 1200.0));
+}
+
+inline float centibelsToGain(int centibels)
+{
+    return static_cast<float>(std::pow(10.0, -qBound(0, centibels, 1440) / 200.0));
+}
+
+}
+
+/*!
+	\class CASoundFont
+	\brief SoundFont 2 instruments for the embedded synth
+
+	Loads the presets and samples of a SoundFont 2 (.sf2) file for CASynth. The preset and
+	instrument zones are resolved when loading into one flat list of zones per preset, each
+	referring to a sample with its key and velocity range, tuning, loop and volume envelope. The
+	synth then only looks the zones up by zones() when a note is started.
+
+	Only the generators needed for sample playback with a volume envelope are used. Modulators,
+	filters, the modulation envelope and the LFOs are ignored.
+
+	The loaded font is not changed afterwards, so it can be shared by the synths rendering on
+	different threads.
+*/
+
+CASoundFont::CASoundFont()
+{
+}
+
+/*!
+	Loads the SoundFont file \a fileName.
+	Returns True on success. Otherwise returns False and sets errorString().
+*/
+bool CASoundFont::load(const QString& fileName)
+{
+    _samples.clear();
+    _presets.clear();
+    _errorString.clear();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        _errorString = QObject::tr("Could not open file %1").arg(fileName);
+        return false;
+    }
+    QByteArray data = file.readAll();
+
+    if (data.size() < 12 || data.left(4) != "RIFF" || data.mid(8, 4) != "sfbk") {
+        _errorString = QObject::tr("%1 is not a SoundFont 2 file").arg(fileName);
+        return false;
+    }
+
+    QHash<QByteArray, QPair<int, int>> chunks;
+    readChunks(data, 12, data.size(), chunks);
+
+    if (!chunks.contains("smpl")) {
+        _errorString = QObject::tr("The SoundFont contains no samples");
+        return false;
+    }
+    QPair<int, int> smpl = chunks["smpl"];
+    const uchar* p = reinterpret_cast<const uchar*>(data.constData()) + smpl.first;
+    _samples.resize(smpl.second / 2);
+    for (int i = 0; i < _samples.size(); i++) {
+        _samples[i] = qFromLittleEndian<qint16>(p + i * 2) / 32768.0f;
+    }
+
+    if (!readPresets(data, chunks)) {
+        _samples.clear();
+        _presets.clear();
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+	Resolves the preset zones of the pdta \a chunks to the zones of the samples.
+*/
+bool CASoundFont::readPresets(const QByteArray& data, const QHash<QByteArray, QPair<int, int>>& chunks)
+{
+    const char* ids[] = { "phdr", "pbag", "pgen", "inst", "ibag", "igen", "shdr" };
+    for (const char* id : ids) {
+        if (!chunks.contains(id)) {
+            _errorString = QObject::tr("The SoundFont has no %1 chunk").arg(id);
+            return false;
+        }
+    }
+
+    CARecords phdr(data, chunks["phdr"], PHDR_SIZE);
+    CARecords pbag(data, chunks["pbag"], BAG_SIZE);
+    CARecords pgen(data, chunks["pgen"], GEN_SIZE);
+    CARecords inst(data, chunks["inst"], INST_SIZE);
+    CARecords ibag(data, chunks["ibag"], BAG_SIZE);
+    CARecords igen(data, chunks["igen"], GEN_SIZE);
+    CARecords shdr(data, chunks["shdr"], SHDR_SIZE);
+
+    CAGeneratorList presetDefaults;
+    std::fill(presetDefaults.amount, presetDefaults.amount + GeneratorCount, 0);
+    presetDefaults.keyLow = presetDefaults.velocityLow = 0;
+    presetDefaults.keyHigh = presetDefaults.velocityHigh = 127;
+
+    CAGeneratorList instrumentDefaults = presetDefaults;
+    for (int g : { DelayVolEnv, AttackVolEnv, HoldVolEnv, DecayVolEnv, ReleaseVolEnv }) {
+        instrumentDefaults.amount[g] = -12000;
+    }
+    instrumentDefaults.amount[ScaleTuning] = 100;
+    instrumentDefaults.amount[OverridingRootKey] = -1;
+
+    // the last records of the headers and bags are terminals
+    for (int p = 0; p + 1 < phdr.count(); p++) {
+        QVector<CASoundFontZone>& zones = _presets[phdr.u16(p, 22) * 128 + phdr.u16(p, 20)]; // bank * 128 + preset
+        CAGeneratorList presetGlobal = presetDefaults;
+
+        for (int pb = phdr.u16(p, 24); pb < phdr.u16(p + 1, 24) && pb + 1 < pbag.count(); pb++) {
+            CAGeneratorList preset = presetGlobal;
+            int instrument = applyGenerators(pgen, pbag.u16(pb, 0), pbag.u16(pb + 1, 0), Instrument, preset);
+            if (instrument == -1) {
+                if (pb == phdr.u16(p, 24)) {
+                    presetGlobal = preset;
+                }
+                continue;
+            }
+            if (instrument + 1 >= inst.count()) {
+                continue;
+            }
+
+            CAGeneratorList instrumentGlobal = instrumentDefaults;
+            for (int ib = inst.u16(instrument, 20); ib < inst.u16(instrument + 1, 20) && ib + 1 < ibag.count(); ib++) {
+                CAGeneratorList gen = instrumentGlobal;
+                int sample = applyGenerators(igen, ibag.u16(ib, 0), ibag.u16(ib + 1, 0), SampleID, gen);
+                if (sample == -1) {
+                    if (ib == inst.u16(instrument, 20)) {
+                        instrumentGlobal = gen;
+                    }
+                    continue;
+                }
+                if (sample >= shdr.count()) {
+                    continue;
+                }
+
+                for (int g : additiveGenerators) {
+                    gen.amount[g] += preset.amount[g];
+                }
+
+                CASoundFontZone zone;
+                zone.keyLow = qMax(gen.keyLow, preset.keyLow);
+                zone.keyHigh = qMin(gen.keyHigh, preset.keyHigh);
+                zone.velocityLow = qMax(gen.velocityLow, preset.velocityLow);
+                zone.velocityHigh = qMin(gen.velocityHigh, preset.velocityHigh);
+                if (zone.keyLow > zone.keyHigh || zone.velocityLow > zone.velocityHigh) {
+                    continue;
+                }
+
+                const int* a = gen.amount;
+                zone.start = qBound(0, shdr.u32(sample, 20) + a[StartAddrsOffset] + a[StartAddrsCoarseOffset] * 32768, _samples.size());
+                zone.end = qBound(zone.start, shdr.u32(sample, 24) + a[EndAddrsOffset] + a[EndAddrsCoarseOffset] * 32768, _samples.size());
+                zone.loopStart = qBound(zone.start, shdr.u32(sample, 28) + a[StartloopAddrsOffset] + a[StartloopAddrsCoarseOffset] * 32768, zone.end);
+                zone.loopEnd = qBound(zone.loopStart, shdr.u32(sample, 32) + a[EndloopAddrsOffset] + a[EndloopAddrsCoarseOffset] * 32768, zone.end);
+                zone.loopMode = (zone.loopEnd > zone.loopStart) ? (a[SampleModes] & 3) : 0;
+                zone.sampleRate = qMax(shdr.u32(sample, 36), 1);
+                int originalPitch = shdr.u8(sample, 40);
+                zone.rootKey = (a[OverridingRootKey] >= 0) ? a[OverridingRootKey] : (originalPitch <= 127 ? originalPitch : 60);
+                zone.tune = a[CoarseTune] * 100 + a[FineTune] + shdr.s8(sample, 41);
+                zone.scaleTuning = a[ScaleTuning];
+                zone.gain = centibelsToGain(a[InitialAttenuation]);
+                zone.pan = qBound(-1.0f, a[Pan] / 500.0f, 1.0f);
+                zone.delay = timecentsToSeconds(a[DelayVolEnv]);
+                zone.attack = timecentsToSeconds(a[AttackVolEnv]);
+                zone.hold = timecentsToSeconds(a[HoldVolEnv]);
+                zone.decay = timecentsToSeconds(a[DecayVolEnv]);
+                zone.sustain = centibelsToGain(a[SustainVolEnv]);
+                zone.release = timecentsToSeconds(a[ReleaseVolEnv]);
+                zones << zone;
+            }
+        }
+    }
+
+    if (_presets.isEmpty()) {
+        _errorString = QObject::tr("The SoundFont contains no presets");
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+	Returns the zones to be played for the \a key and \a velocity by the preset \a program in the
+	\a bank. If the preset doesn't exist, the same program of the first bank or the first program
+	of the bank is used, so a font without the drum kits or the variations still sounds.
+*/
+QVector<const CASoundFontZone*> CASoundFont::zones(int bank, int program, int key, int velocity) const
+{
+    QVector<const CASoundFontZone*> found;
+    QHash<int, QVector<CASoundFontZone>>::const_iterator preset = _presets.constFind(bank * 128 + program);
+    if (preset == _presets.constEnd()) {
+        preset = _presets.constFind((bank == 128) ? 128 * 128 : program);
+    }
+    if (preset == _presets.constEnd()) {
+        preset = _presets.constFind(bank * 128);
+    }
+    if (preset == _presets.constEnd()) {
+        return found;
+    }
+
+    for (const CASoundFontZone& zone : preset.value()) {
+        if (key >= zone.keyLow && key <= zone.keyHigh && velocity >= zone.velocityLow && velocity <= zone.velocityHigh) {
+            found << &zone;
+        }
+    }
+    return found;
+}
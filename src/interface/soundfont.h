@@ -0,0 +1,53 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef SOUNDFONT_H_
+#define SOUNDFONT_H_
+
+#include <QByteArray>
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+struct CASoundFontZone {
+    int keyLow, keyHigh;
+    int velocityLow, velocityHigh;
+    int start, end; // sample frames in CASoundFont::samples()
+    int loopStart, loopEnd;
+    int loopMode; // 0 no loop, 1 loop, 3 loop until released
+    int sampleRate;
+    int rootKey;
+    int tune; // in cents
+    int scaleTuning; // cents per key
+    float gain; // initial attenuation as a factor
+    float pan; // -1 left, 1 right
+    float delay, attack, hold, decay, release; // volume envelope in seconds
+    float sustain; // sustain level of the volume envelope as a factor
+};
+
+class CASoundFont {
+public:
+    CASoundFont();
+
+    bool load(const QString& fileName);
+
+    QVector<const CASoundFontZone*> zones(int bank, int program, int key, int velocity) const;
+    inline const QVector<float>& samples() const { return _samples; }
+    inline bool isEmpty() const { return _presets.isEmpty(); }
+
+    inline const QString& errorString() const { return _errorString; }
+
+private:
+    bool readPresets(const QByteArray& data, const QHash<QByteArray, QPair<int, int>>& chunks);
+
+    QVector<float> _samples; // all the samples of the font, mono
+    QHash<int, QVector<CASoundFontZone>> _presets; // resolved zones by bank * 128 + program
+    QString _errorString;
+};
+
+#endif /* SOUNDFONT_H_ */
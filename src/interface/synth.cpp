@@ -0,0 +1,303 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include "interface/synth.h"
+#include "interface/mididevice.h"
+#include "interface/soundfont.h"
+
+#include <cmath>
+
+const float CASynth::MASTER_GAIN = 0.5f;
+
+namespace {
+
+const double TWO_PI = 6.283185307179586;
+const int DRUM_CHANNEL = 9;
+const int DRUM_BANK = 128;
+const float MIN_RELEASE = 0.005f; // in seconds, avoids clicks when a note is released
+
+// envelope of the built-in tone used without a SoundFont
+const float TONE_ATTACK = 0.005f;
+const float TONE_DECAY = 0.4f;
+const float TONE_SUSTAIN = 0.5f;
+const float TONE_RELEASE = 0.15f;
+const float DRUM_DECAY = 0.15f;
+
+inline float controllerGain(int value)
+{
+    return (value * value) / (127.0f * 127.0f);
+}
+
+/*!
+	Built-in tone with a few harmonics at the given \a phase.
+*/
+inline float tone(double phase)
+{
+    return static_cast<float>((std::sin(phase) + 0.5 * std::sin(2 * phase) + 0.25 * std::sin(3 * phase)) / 1.75);
+}
+
+}
+
+/*!
+	\class CASynth
+	\brief Embedded software synth rendering midi messages to audio
+
+	Plays the note on, note off, program change and controller messages sent to it by send() with
+	the instruments of the given CASoundFont and renders the sound by render() into a stereo buffer.
+	CASynth doesn't keep time: the caller renders the frames between the messages, so the audio can
+	be rendered offline as fast as possible, see CAAudioExport.
+
+	Each started note plays all the zones of the preset matching its key and velocity with linear
+	interpolation of the samples and a linear delay, attack, hold, decay, sustain and release
+	volume envelope. The volume, expression and pan controllers are applied when the note starts.
+	Channel 10 uses the drum bank 128 as usual in General MIDI.
+
+	Without a SoundFont, CASynth plays a simple built-in tone, so the rendered audio is still
+	usable for checking the timing.
+*/
+
+/*!
+	Creates a synth playing the instruments of the \a soundFont at the given \a sampleRate.
+	The font is only read, so it can be shared by synths rendering on different threads.
+*/
+CASynth::CASynth(const CASoundFont* soundFont, int sampleRate)
+    : _soundFont((soundFont && !soundFont->isEmpty()) ? soundFont : nullptr)
+    , _sampleRate(sampleRate)
+{
+    for (int i = 0; i < 16; i++) {
+        CASynthChannel channel = { (i == DRUM_CHANNEL) ? DRUM_BANK : 0, 0, 0, 100, 127, 0 };
+        channel.volume = controllerGain(channel.volumeValue) * controllerGain(channel.expressionValue);
+        _channels[i] = channel;
+    }
+}
+
+/*!
+	Plays the midi \a message immediately.
+*/
+void CASynth::send(const QVector<unsigned char>& message)
+{
+    if (message.isEmpty()) {
+        return;
+    }
+
+    int channel = message[0] & 0x0f;
+    CASynthChannel& c = _channels[channel];
+    switch (message[0] & 0xf0) {
+    case 0x90:
+        if (message.size() >= 3 && message[2]) {
+            noteOn(channel, message[1] & 0x7f, message[2] & 0x7f);
+        } else if (message.size() >= 2) {
+            noteOff(channel, message[1] & 0x7f); // zero velocity
+        }
+        break;
+    case 0x80:
+        if (message.size() >= 2) {
+            noteOff(channel, message[1] & 0x7f);
+        }
+        break;
+    case 0xc0:
+        if (message.size() >= 2) {
+            c.program = message[1] & 0x7f;
+        }
+        break;
+    case 0xb0:
+        if (message.size() < 3) {
+            break;
+        }
+        switch (message[1]) {
+        case 0: // bank select
+            if (channel != DRUM_CHANNEL) {
+                c.bank = message[2] & 0x7f;
+            }
+            break;
+        case CAMidiDevice::Midi_Ctl_Volume:
+            c.volumeValue = message[2] & 0x7f;
+            break;
+        case 10: // pan
+            c.pan = ((message[2] & 0x7f) - 64) / 64.0f;
+            break;
+        case 11: // expression
+            c.expressionValue = message[2] & 0x7f;
+            break;
+        case 120: // all sound off
+        case 123: // all notes off
+            for (int key = 0; key < 128; key++) {
+                noteOff(channel, key);
+            }
+            break;
+        }
+        c.volume = controllerGain(c.volumeValue) * controllerGain(c.expressionValue);
+        break;
+    }
+}
+
+void CASynth::noteOn(int channel, int key, int velocity)
+{
+    const CASynthChannel& c = _channels[channel];
+    float gain = MASTER_GAIN * c.volume * controllerGain(velocity);
+
+    QVector<const CASoundFontZone*> zones;
+    if (_soundFont) {
+        zones = _soundFont->zones(c.bank, c.program, key, velocity);
+        if (zones.isEmpty()) {
+            return;
+        }
+    } else {
+        zones << nullptr; // built-in tone
+    }
+
+    for (const CASoundFontZone* zone : zones) {
+        float pan = qBound(-1.0f, c.pan + (zone ? zone->pan : 0), 1.0f);
+        float zoneGain = gain * (zone ? zone->gain : 1.0f);
+
+        CASynthVoice voice;
+        voice.zone = zone;
+        voice.channel = channel;
+        voice.key = key;
+        if (zone) {
+            double cents = (key - zone->rootKey) * zone->scaleTuning + zone->tune;
+            voice.position = zone->start;
+            voice.step = std::pow(2.0, cents / 1200.0) * zone->sampleRate / _sampleRate;
+        } else {
+            voice.position = 0;
+            voice.step = TWO_PI * 440.0 * std::pow(2.0, (key - 69) / 12.0) / _sampleRate;
+        }
+        voice.gainLeft = zoneGain * static_cast<float>(std::cos((pan + 1) * TWO_PI / 8));
+        voice.gainRight = zoneGain * static_cast<float>(std::sin((pan + 1) * TWO_PI / 8));
+        voice.level = 0;
+        startStage(voice, Delay);
+        _voices << voice;
+    }
+}
+
+void CASynth::noteOff(int channel, int key)
+{
+    for (CASynthVoice& voice : _voices) {
+        if (voice.channel == channel && voice.key == key && voice.stage < Release) {
+            startStage(voice, Release);
+        }
+    }
+}
+
+/*!
+	Starts the envelope \a stage of the \a voice. The stages of zero length are skipped.
+*/
+void CASynth::startStage(CASynthVoice& voice, CAEnvelopeStage stage)
+{
+    const CASoundFontZone* zone = voice.zone;
+    bool drum = (voice.channel == DRUM_CHANNEL);
+    float sustain = zone ? zone->sustain : (drum ? 0 : TONE_SUSTAIN);
+
+    for (;;) {
+        voice.stage = stage;
+        float seconds = 0;
+        float target = voice.level;
+        switch (stage) {
+        case Delay:
+            seconds = zone ? zone->delay : 0;
+            break;
+        case Attack:
+            seconds = zone ? zone->attack : TONE_ATTACK;
+            target = 1;
+            break;
+        case Hold:
+            seconds = zone ? zone->hold : 0;
+            break;
+        case Decay:
+            seconds = zone ? zone->decay : (drum ? DRUM_DECAY : TONE_DECAY);
+            target = sustain;
+            break;
+        case Sustain:
+            if (sustain <= 0) {
+                stage = Finished;
+                continue;
+            }
+            voice.level = sustain;
+            voice.levelStep = 0;
+            voice.stageFrames = -1; // until released
+            return;
+        case Release:
+            seconds = qMax(zone ? zone->release : TONE_RELEASE, MIN_RELEASE);
+            target = 0;
+            break;
+        case Finished:
+            voice.levelStep = 0;
+            voice.stageFrames = 0;
+            return;
+        }
+
+        int frames = qRound(seconds * _sampleRate);
+        if (frames > 0) {
+            voice.stageFrames = frames;
+            voice.levelStep = (target - voice.level) / frames;
+            return;
+        }
+
+        voice.level = target;
+        stage = static_cast<CAEnvelopeStage>(stage + 1);
+    }
+}
+
+inline void CASynth::advanceEnvelope(CASynthVoice& voice)
+{
+    if (voice.stageFrames < 0) {
+        return; // sustain
+    }
+
+    voice.level += voice.levelStep;
+    if (--voice.stageFrames <= 0) {
+        startStage(voice, (voice.stage == Release) ? Finished : static_cast<CAEnvelopeStage>(voice.stage + 1));
+    }
+}
+
+/*!
+	Adds the next \a frames of the sound to the interleaved stereo buffer \a out.
+*/
+void CASynth::render(float* out, int frames)
+{
+    const float* samples = _soundFont ? _soundFont->samples().constData() : nullptr;
+
+    for (int v = 0; v < _voices.size(); v++) {
+        CASynthVoice& voice = _voices[v];
+        const CASoundFontZone* zone = voice.zone;
+
+        for (int f = 0; f < frames && voice.stage != Finished; f++) {
+            float value;
+            if (zone) {
+                bool looping = zone->loopMode == 1 || (zone->loopMode == 3 && voice.stage != Release);
+                int i = static_cast<int>(voice.position);
+                int next = (looping && i + 1 >= zone->loopEnd) ? zone->loopStart : qMin(i + 1, zone->end - 1);
+                float frac = static_cast<float>(voice.position - i);
+                value = samples[i] + (samples[next] - samples[i]) * frac;
+
+                voice.position += voice.step;
+                if (looping && voice.position >= zone->loopEnd) {
+                    voice.position -= zone->loopEnd - zone->loopStart;
+                } else if (voice.position >= zone->end - 1) {
+                    voice.stage = Finished;
+                }
+            } else {
+                value = tone(voice.position);
+                voice.position += voice.step;
+                if (voice.position >= TWO_PI) {
+                    voice.position -= TWO_PI;
+                }
+            }
+
+            value *= voice.level;
+            out[2 * f] += value * voice.gainLeft;
+            out[2 * f + 1] += value * voice.gainRight;
+            advanceEnvelope(voice);
+        }
+
+        if (voice.stage == Finished) {
+            _voices[v] = _voices.last();
+            _voices.removeLast();
+            v--;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef SYNTH_H_
+#define SYNTH_H_
+
+#include <QVector>
+
+class CASoundFont;
+struct CASoundFontZone;
+
+class CASynth {
+public:
+    CASynth(const CASoundFont* soundFont, int sampleRate);
+
+    void send(const QVector<unsigned char>& message);
+    void render(float* out, int frames);
+
+    inline bool isPlaying() const { return !_voices.isEmpty(); }
+    inline int sampleRate() const { return _sampleRate; }
+
+    static const float MASTER_GAIN;
+
+private:
+    enum CAEnvelopeStage {
+        Delay,
+        Attack,
+        Hold,
+        Decay,
+        Sustain,
+        Release,
+        Finished
+    };
+
+    struct CASynthVoice {
+        const CASoundFontZone* zone; // nullptr for the built-in tone
+        int channel;
+        int key;
+        double position; // in the samples of the zone or the phase of the built-in tone
+        double step; // position increment per frame
+        float gainLeft, gainRight;
+        CAEnvelopeStage stage;
+        int stageFrames; // frames left in the current stage
+        float level; // envelope level
+        float levelStep; // envelope level increment per frame in the current stage
+    };
+
+    struct CASynthChannel {
+        int bank;
+        int program;
+        float volume; // gain of the volume and expression controllers
+        int volumeValue, expressionValue;
+        float pan;
+    };
+
+    void noteOn(int channel, int key, int velocity);
+    void noteOff(int channel, int key);
+    void startStage(CASynthVoice& voice, CAEnvelopeStage stage);
+    void advanceEnvelope(CASynthVoice& voice);
+
+    const CASoundFont* _soundFont; // nullptr renders the built-in tone
+    int _sampleRate;
+    CASynthChannel _channels[16];
+    QVector<CASynthVoice> _voices;
+};
+
+#endif /* SYNTH_H_ */
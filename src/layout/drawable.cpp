@@ -25,6 +25,18 @@ CADrawable::CADrawable(double x, double y)
 {
 }
 
+/*!
+	Draws a simplified shape of the drawable used at zoom levels, where it wouldn't be legible
+	anyway (see minLegibleZoom()). The default implementation fills the bounding box with a
+	translucent color.
+*/
+void CADrawable::drawPlaceholder(QPainter* p, const CADrawSettings s)
+{
+    QColor color(s.color);
+    color.setAlpha(color.alpha() / 3);
+    p->fillRect(QRectF(s.x, s.y, qMax(1.0, width() * s.z), qMax(1.0, height() * s.z)), color);
+}
+
 void CADrawable::drawHScaleHandles(QPainter* p, CADrawSettings s)
 {
     p->setPen(QPen(s.color));
@@ -11,6 +11,8 @@
 #include <QColor>
 #include <QRectF>
 
+#include "core/objectpool.h"
+
 class QPainter;
 
 struct CADrawSettings {
@@ -45,7 +47,12 @@ public:
 
     CADrawable(double x, double y); // x and y position of an element in absolute world units
     virtual ~CADrawable() {}
+
+    static void* operator new(std::size_t size) { return CAObjectPool::allocate(size); }
+    static void operator delete(void* p, std::size_t size) { CAObjectPool::release(p, size); }
     virtual void draw(QPainter* p, const CADrawSettings s) = 0;
+    virtual void drawPlaceholder(QPainter* p, const CADrawSettings s);
+    virtual double minLegibleZoom() const { return 0; } // zoom level under which drawPlaceholder() is used instead of draw()
     virtual CADrawable* clone() = 0;
 
     void drawHScaleHandles(QPainter* p, const CADrawSettings s);
@@ -79,6 +86,8 @@ public:
     inline void setHScalable(bool s) { _hScalable = s; }
     inline void setVScalable(bool s) { _vScalable = s; }
 
+    virtual void moveXPos(double dx) { _xPos += dx; }
+
 protected:
     void setDrawableType(CADrawableType t) { _drawableType = t; }
 
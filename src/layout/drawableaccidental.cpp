@@ -8,10 +8,12 @@
 #include <QFont>
 #include <QPainter>
 
-#include "canorus.h"
 #include "layout/drawableaccidental.h"
 #include "layout/drawableclef.h"
 #include "layout/drawablecontext.h"
+#include "layout/feta.h"
+#include "layout/fontcache.h"
+#include "layout/glyphcache.h"
 #include "score/muselement.h"
 
 /*!
@@ -50,6 +52,27 @@ CADrawableAccidental::CADrawableAccidental(signed char accs, CAMusElement* musEl
 
     _centerX = x;
     _centerY = y;
+
+    switch (accs) {
+    case 0:
+        _glyph = CAFeta::codepoint(CAFeta::accidentals_natural);
+        break;
+    case 1:
+        _glyph = CAFeta::codepoint(CAFeta::accidentals_sharp);
+        break;
+    case -1:
+        _glyph = CAFeta::codepoint(CAFeta::accidentals_flat);
+        break;
+    case 2:
+        _glyph = CAFeta::codepoint(CAFeta::accidentals_doublesharp);
+        break;
+    case -2:
+        _glyph = CAFeta::codepoint(CAFeta::accidentals_flatflat);
+        break;
+    default:
+        _glyph = 0;
+        break;
+    }
 }
 
 CADrawableAccidental::~CADrawableAccidental()
@@ -58,26 +81,25 @@ CADrawableAccidental::~CADrawableAccidental()
 
 void CADrawableAccidental::draw(QPainter* p, CADrawSettings s)
 {
-    QFont font("Emmentaler");
-    font.setPixelSize(qRound(34 * s.z));
+    QFont font = CAFontCache::font(CAFontCache::Emmentaler, qRound(34 * s.z));
     p->setPen(QPen(s.color));
     p->setFont(font);
 
     switch (_accs) {
     case 0:
-        p->drawText(s.x, s.y + qRound(height() / 2 * s.z), QString(CACanorus::fetaCodepoint("accidentals.natural")));
+        CAGlyphCache::drawGlyph(p, s.x, s.y + qRound(height() / 2 * s.z), _glyph);
         break;
     case 1:
-        p->drawText(s.x, s.y + qRound((height() / 2 + 0.3) * s.z), QString(CACanorus::fetaCodepoint("accidentals.sharp")));
+        CAGlyphCache::drawGlyph(p, s.x, s.y + qRound((height() / 2 + 0.3) * s.z), _glyph);
         break;
     case -1:
-        p->drawText(s.x, s.y + qRound((height() / 2 + 5) * s.z), QString(CACanorus::fetaCodepoint("accidentals.flat")));
+        CAGlyphCache::drawGlyph(p, s.x, s.y + qRound((height() / 2 + 5) * s.z), _glyph);
         break;
     case 2:
-        p->drawText(s.x, s.y + qRound(height() / 2 * s.z), QString(CACanorus::fetaCodepoint("accidentals.doublesharp")));
+        CAGlyphCache::drawGlyph(p, s.x, s.y + qRound(height() / 2 * s.z), _glyph);
         break;
     case -2:
-        p->drawText(s.x, s.y + qRound((height() / 2 + 5) * s.z), QString(CACanorus::fetaCodepoint("accidentals.flatflat")));
+        CAGlyphCache::drawGlyph(p, s.x, s.y + qRound((height() / 2 + 5) * s.z), _glyph);
         break;
     }
 }
@@ -15,11 +15,13 @@ public:
     CADrawableAccidental(signed char accs, CAMusElement* musElement, CADrawableContext* drawableContext, double x, double y);
     ~CADrawableAccidental();
     void draw(QPainter* p, CADrawSettings s);
+    double minLegibleZoom() const { return 0.4; }
     CADrawableAccidental* clone(CADrawableContext* newContext = nullptr);
 
 private:
     signed char _accs;
     double _centerX, _centerY; // easier to do clone(), otherwise not needed
+    int _glyph; // Feta glyph codepoint of the accidental
 };
 
 #endif /* DRAWABLEACCIDENTAL_H_ */
@@ -7,11 +7,12 @@
 
 #include "layout/drawablechordname.h"
 #include "layout/drawablechordnamecontext.h"
+#include "layout/fontcache.h"
+#include "layout/textmetrics.h"
 
 #include "score/chordnamecontext.h"
 
 #include <QFont>
-#include <QFontMetrics>
 #include <QPainter>
 
 const double CADrawableChordName::DEFAULT_TEXT_SIZE = 16;
@@ -22,18 +23,15 @@ CADrawableChordName::CADrawableChordName(CAChordName* s, CADrawableChordNameCont
     setDrawableMusElementType(DrawableChordName);
 
     // some work to compute the drawable width
-    QFont font("Century Schoolbook L");
-    font.setPixelSize(qRound(DEFAULT_TEXT_SIZE));
-    QFontMetricsF fm(font);
+    QFont font = CAFontCache::font(CAFontCache::CenturySchoolbook, qRound(DEFAULT_TEXT_SIZE));
     qreal textWidth;
     if (!drawableDiatonicPitch().isEmpty()) {
-        textWidth = fm.width(drawableDiatonicPitch());
-        font.setPixelSize(qRound(DEFAULT_TEXT_SIZE * 0.75));
-        fm = QFontMetricsF(font);
-        textWidth += fm.width(chordName()->qualityModifier());
+        textWidth = CATextMetrics::widthF(font, drawableDiatonicPitch());
+        font = CAFontCache::font(CAFontCache::CenturySchoolbook, qRound(DEFAULT_TEXT_SIZE * 0.75));
+        textWidth += CATextMetrics::widthF(font, chordName()->qualityModifier());
     } else {
         // syntax error, print qualityModifier() which includes everything
-        textWidth = fm.width(chordName()->qualityModifier());
+        textWidth = CATextMetrics::widthF(font, chordName()->qualityModifier());
     }
     setWidth(textWidth < 11 ? 11 : textWidth); // set minimum text width at least 11 points
 
@@ -50,8 +48,7 @@ void CADrawableChordName::draw(QPainter* p, const CADrawSettings s)
     pen.setWidth(qRound(1.2 * s.z));
     pen.setCapStyle(Qt::RoundCap);
     p->setPen(pen);
-    QFont font("Century Schoolbook L");
-    font.setPixelSize(qRound(DEFAULT_TEXT_SIZE * s.z));
+    QFont font = CAFontCache::font(CAFontCache::CenturySchoolbook, qRound(DEFAULT_TEXT_SIZE * s.z));
     p->setFont(font);
     QString dChordPitch = drawableDiatonicPitch();
     if (dChordPitch.isEmpty()) {
@@ -61,10 +58,9 @@ void CADrawableChordName::draw(QPainter* p, const CADrawSettings s)
     }
 
     p->drawText(s.x, s.y + qRound(height() * s.z), dChordPitch);
-    QFontMetricsF fm(font);
-    qreal w = fm.width(dChordPitch);
+    qreal w = CATextMetrics::widthF(font, dChordPitch);
 
-    font.setPixelSize(qRound(DEFAULT_TEXT_SIZE * s.z * 0.75));
+    font = CAFontCache::font(CAFontCache::CenturySchoolbook, qRound(DEFAULT_TEXT_SIZE * s.z * 0.75));
     p->setFont(font);
     p->drawText(s.x + w, s.y + qRound(height() * s.z * 0.5), chordName()->qualityModifier());
 }
@@ -12,8 +12,10 @@
 
 #include "layout/drawableclef.h"
 #include "layout/drawablestaff.h"
+#include "layout/feta.h"
+#include "layout/fontcache.h"
+#include "layout/glyphcache.h"
 
-#include "canorus.h"
 #include "score/clef.h"
 
 const int CADrawableClef::CLEF_EIGHT_SIZE = 8;
@@ -73,8 +75,7 @@ CADrawableClef::CADrawableClef(CAClef* musElement, CADrawableStaff* drawableStaf
 
 void CADrawableClef::draw(QPainter* p, CADrawSettings s)
 {
-    QFont font("Emmentaler");
-    font.setPixelSize(qRound(35 * s.z));
+    QFont font = CAFontCache::font(CAFontCache::Emmentaler, qRound(35 * s.z));
     p->setPen(QPen(s.color));
     p->setFont(font);
 
@@ -84,13 +85,13 @@ void CADrawableClef::draw(QPainter* p, CADrawSettings s)
 	*/
     switch (clef()->clefType()) {
     case CAClef::G:
-        p->drawText(s.x, qRound(s.y + (clef()->offset() > 0 ? CLEF_EIGHT_SIZE * s.z : 0) + 0.63 * (height() - (clef()->offset() ? CLEF_EIGHT_SIZE : 0)) * s.z), QString(CACanorus::fetaCodepoint("clefs.G")));
+        CAGlyphCache::drawGlyph(p, s.x, qRound(s.y + (clef()->offset() > 0 ? CLEF_EIGHT_SIZE * s.z : 0) + 0.63 * (height() - (clef()->offset() ? CLEF_EIGHT_SIZE : 0)) * s.z), CAFeta::codepoint(CAFeta::clefs_G));
         break;
     case CAClef::F:
-        p->drawText(s.x, qRound(s.y + (clef()->offset() > 0 ? CLEF_EIGHT_SIZE * s.z : 0) + 0.32 * (height() - (clef()->offset() ? CLEF_EIGHT_SIZE : 0)) * s.z), QString(CACanorus::fetaCodepoint("clefs.F")));
+        CAGlyphCache::drawGlyph(p, s.x, qRound(s.y + (clef()->offset() > 0 ? CLEF_EIGHT_SIZE * s.z : 0) + 0.32 * (height() - (clef()->offset() ? CLEF_EIGHT_SIZE : 0)) * s.z), CAFeta::codepoint(CAFeta::clefs_F));
         break;
     case CAClef::C:
-        p->drawText(s.x, qRound(s.y + (clef()->offset() > 0 ? CLEF_EIGHT_SIZE * s.z : 0) + 0.5 * (height() - (clef()->offset() ? CLEF_EIGHT_SIZE : 0)) * s.z), QString(CACanorus::fetaCodepoint("clefs.C")));
+        CAGlyphCache::drawGlyph(p, s.x, qRound(s.y + (clef()->offset() > 0 ? CLEF_EIGHT_SIZE * s.z : 0) + 0.5 * (height() - (clef()->offset() ? CLEF_EIGHT_SIZE : 0)) * s.z), CAFeta::codepoint(CAFeta::clefs_C));
         break;
     case CAClef::Tab:
     case CAClef::PercussionHigh:
@@ -100,9 +101,7 @@ void CADrawableClef::draw(QPainter* p, CADrawSettings s)
     }
 
     if (clef()->offset()) {
-        QFont number("Century Schoolbook L");
-        number.setPixelSize(qRound((CLEF_EIGHT_SIZE + 5) * s.z));
-        number.setStyle(QFont::StyleItalic);
+        QFont number = CAFontCache::font(CAFontCache::CenturySchoolbook, qRound((CLEF_EIGHT_SIZE + 5) * s.z), CAFontCache::Italic);
         p->setFont(number);
 
         if (clef()->offset() > 0) {
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2009, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -7,9 +7,13 @@
 
 #include "layout/drawablecontext.h"
 
+#include <algorithm>
+
 CADrawableContext::CADrawableContext(CAContext* c, double x, double y)
     : CADrawable(x, y)
     , _context(c)
+    , _maxElementWidth(0)
+    , _rangeIndexDirty(true)
 {
     setDrawableType(CADrawable::DrawableContext);
 }
@@ -23,13 +27,53 @@ CADrawableContext::CADrawableContext(CAContext* c, double x, double y)
 */
 QList<CADrawableMusElement*> CADrawableContext::findInRange(double x1, double x2)
 {
-    //int i;
+    if (_rangeIndexDirty) {
+        buildRangeIndex();
+    }
+
+    // no element starting left of x1 - _maxElementWidth reaches x1
+    QVector<CADrawableMusElement*>::const_iterator it = std::lower_bound(_rangeIndex.constBegin(), _rangeIndex.constEnd(), x1 - _maxElementWidth,
+        [](CADrawableMusElement* elt, double x) { return elt->xPos() < x; });
+
     QList<CADrawableMusElement*> list;
-    for (int i = 0; i < _drawableMusElementList.size(); i++) {
-        if (static_cast<CADrawable*>(_drawableMusElementList[i])->xPos() <= x2 && // The object is normal and fits into the area
-            static_cast<CADrawable*>(_drawableMusElementList[i])->xPos() + static_cast<CADrawable*>(_drawableMusElementList[i])->width() >= x1) {
-            list << _drawableMusElementList[i];
+    for (; it != _rangeIndex.constEnd() && (*it)->xPos() <= x2; it++) {
+        if ((*it)->xPos() + (*it)->width() >= x1) {
+            list << *it;
         }
     }
     return list;
 }
+
+/*!
+	Sorts the elements of the context by their left borders for findInRange(). Called on the first
+	query after the elements were added or removed, so the mouse interaction doesn't scan all the
+	elements of the staff on every move.
+*/
+void CADrawableContext::buildRangeIndex()
+{
+    _rangeIndex = _drawableMusElementList.toVector();
+    std::stable_sort(_rangeIndex.begin(), _rangeIndex.end(), [](CADrawableMusElement* a, CADrawableMusElement* b) { return a->xPos() < b->xPos(); });
+
+    _maxElementWidth = 0;
+    for (int i = 0; i < _rangeIndex.size(); i++) {
+        _maxElementWidth = qMax(_maxElementWidth, _rangeIndex[i]->width());
+    }
+    _rangeIndexDirty = false;
+}
+
+/*!
+	Removes all the drawable music elements \a elts from the context.
+	The elements are searched from the end of the list, because the removed elements are usually
+	the right-most ones. The elements are not destroyed.
+*/
+void CADrawableContext::removeMElements(const QSet<CADrawableMusElement*>& elts)
+{
+    invalidateRangeIndex();
+    int left = elts.size();
+    for (int i = _drawableMusElementList.size() - 1; i >= 0 && left > 0; i--) {
+        if (elts.contains(_drawableMusElementList[i])) {
+            _drawableMusElementList.removeAt(i);
+            left--;
+        }
+    }
+}
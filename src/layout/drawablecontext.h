@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -9,6 +9,8 @@
 #define DRAWABLECONTEXT_H_
 
 #include <QList>
+#include <QSet>
+#include <QVector>
 
 #include "layout/drawable.h"
 #include "layout/drawablemuselement.h"
@@ -34,8 +36,14 @@ public:
         for (i = _drawableMusElementList.size() - 1; (i >= 0) && _drawableMusElementList[i]->xPos() > elt->xPos(); i--)
             ;
         _drawableMusElementList.insert(++i, elt);
+        invalidateRangeIndex();
     }
-    virtual int removeMElement(CADrawableMusElement* elt) { return _drawableMusElementList.removeAll(elt); }
+    virtual int removeMElement(CADrawableMusElement* elt)
+    {
+        invalidateRangeIndex();
+        return _drawableMusElementList.removeAll(elt);
+    }
+    virtual void removeMElements(const QSet<CADrawableMusElement*>& elts);
     CADrawableMusElement* lastDrawableMusElement()
     {
         if (_drawableMusElementList.size())
@@ -58,10 +66,18 @@ public:
 
 protected:
     void setDrawableContextType(CADrawableContextType type) { _drawableContextType = type; }
+    inline void invalidateRangeIndex() { _rangeIndexDirty = true; }
 
     CADrawableContextType _drawableContextType;
     CAContext* _context;
     QList<CADrawableMusElement*> _drawableMusElementList; // List of all the drawable musElements in this context sorted by their left borders
+
+private:
+    void buildRangeIndex();
+
+    QVector<CADrawableMusElement*> _rangeIndex; // elements sorted by their left borders for findInRange(), rebuilt when dirty
+    double _maxElementWidth; // width of the widest element in the range index
+    bool _rangeIndexDirty;
 };
 
 #endif /* DRAWABLECONTEXT_H_ */
@@ -6,8 +6,9 @@
 */
 
 #include "layout/drawablefiguredbassnumber.h"
-#include "canorus.h"
 #include "layout/drawablefiguredbasscontext.h"
+#include "layout/feta.h"
+#include "layout/fontcache.h"
 #include "score/figuredbassmark.h"
 #include <QPainter>
 #include <QPen>
@@ -34,22 +35,21 @@ void CADrawableFiguredBassNumber::draw(QPainter* p, const CADrawSettings s)
     pen.setWidth(qRound(1.2 * s.z));
     pen.setCapStyle(Qt::RoundCap);
     p->setPen(pen);
-    QFont font("Emmentaler");
-    font.setPixelSize(qRound(DEFAULT_NUMBER_SIZE * s.z * 1.3));
+    QFont font = CAFontCache::font(CAFontCache::Emmentaler, qRound(DEFAULT_NUMBER_SIZE * s.z * 1.3));
     p->setFont(font);
 
     QString accs;
     if (figuredBassMark()->accs().contains(_number)) {
         if (figuredBassMark()->accs()[_number] == -2) {
-            accs += QString(CACanorus::fetaCodepoint("accidentals.flatflat"));
+            accs += QString(CAFeta::codepoint(CAFeta::accidentals_flatflat));
         } else if (figuredBassMark()->accs()[_number] == -1) {
-            accs += QString(CACanorus::fetaCodepoint("accidentals.flat"));
+            accs += QString(CAFeta::codepoint(CAFeta::accidentals_flat));
         } else if (figuredBassMark()->accs()[_number] == 0) {
-            accs += QString(CACanorus::fetaCodepoint("accidentals.natural"));
+            accs += QString(CAFeta::codepoint(CAFeta::accidentals_natural));
         } else if (figuredBassMark()->accs()[_number] == 1) {
-            accs += QString(CACanorus::fetaCodepoint("accidentals.sharp"));
+            accs += QString(CAFeta::codepoint(CAFeta::accidentals_sharp));
         } else if (figuredBassMark()->accs()[_number] == 2) {
-            accs += QString(CACanorus::fetaCodepoint("accidentals.doublesharp"));
+            accs += QString(CAFeta::codepoint(CAFeta::accidentals_doublesharp));
         }
     }
 
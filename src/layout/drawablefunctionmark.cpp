@@ -12,6 +12,8 @@
 
 #include "layout/drawablefunctionmark.h"
 #include "layout/drawablefunctionmarkcontext.h"
+#include "layout/fontcache.h"
+#include "layout/textmetrics.h"
 #include "score/functionmark.h"
 
 /*!
@@ -178,18 +180,14 @@ void CADrawableFunctionMark::draw(QPainter* p, CADrawSettings s)
 {
     int rightBorder = s.x + qRound(width() * s.z);
 
-    QFont font("FreeSans");
-    if (functionMark()->tonicDegree() == CAFunctionMark::T)
-        font.setPixelSize(qRound(19 * s.z));
-    else
-        font.setPixelSize(qRound(17 * s.z));
+    QFont font = CAFontCache::font(CAFontCache::FreeSans, qRound((functionMark()->tonicDegree() == CAFunctionMark::T ? 19 : 17) * s.z));
 
     p->setPen(QPen(s.color));
     p->setFont(font);
 
     if (!isExtenderLineOnly()) {
         p->drawText(s.x, s.y + qRound(height() * s.z), _text);
-        s.x += qRound(p->boundingRect(0, 0, 0, 0, 0, _text).width() + 1 * s.z);
+        s.x += qRound(CATextMetrics::width(font, _text) + 1 * s.z);
     }
 
     if (isExtenderLineVisible())
@@ -390,7 +388,7 @@ CADrawableFunctionMarkSupport::~CADrawableFunctionMarkSupport()
 
 void CADrawableFunctionMarkSupport::draw(QPainter* p, const CADrawSettings s)
 {
-    QFont font("FreeSans");
+    QFont font;
     QString text;
     CAFunctionMark::CAFunctionType type = CAFunctionMark::CAFunctionType::Undefined;
     bool minor = false;
@@ -398,25 +396,25 @@ void CADrawableFunctionMarkSupport::draw(QPainter* p, const CADrawSettings s)
     //prepare drawing stuff
     switch (_drawableFunctionMarkSupportType) {
     case Key:
-        font.setPixelSize(qRound(17 * s.z));
+        font = CAFontCache::font(CAFontCache::FreeSans, qRound(17 * s.z));
         break;
     case ChordArea:
-        font.setPixelSize(qRound(17 * s.z));
+        font = CAFontCache::font(CAFontCache::FreeSans, qRound(17 * s.z));
         type = _function1->functionMark()->chordArea();
         minor = _function1->functionMark()->isChordAreaMinor();
         break;
     case Tonicization:
-        font.setPixelSize(qRound(19 * s.z));
+        font = CAFontCache::font(CAFontCache::FreeSans, qRound(19 * s.z));
         type = _function1->functionMark()->tonicDegree();
         minor = _function1->functionMark()->isTonicDegreeMinor();
         break;
     case Ellipse:
-        font.setPixelSize(qRound(14 * s.z));
+        font = CAFontCache::font(CAFontCache::FreeSans, qRound(14 * s.z));
         break;
     case Alterations:
-        font.setPixelSize(qRound(9 * s.z));
+        font = CAFontCache::font(CAFontCache::FreeSans, qRound(9 * s.z));
         break;
-    case Rectangle:
+    case Rectangle: // no text
         break;
     }
 
@@ -547,7 +545,7 @@ void CADrawableFunctionMarkSupport::draw(QPainter* p, const CADrawSettings s)
         // draw paranthesis, if needed
         if (f1->function() == CAFunctionMark::Undefined) {
             curX -= qRound(0.3 * _height * s.z);
-            font.setPixelSize(qRound(_height * s.z));
+            font = CAFontCache::font(CAFontCache::FreeSans, qRound(_height * s.z));
             p->setFont(font);
             p->drawText(curX, qRound(curY - _height * s.z / 6.0), "(");
             p->drawText(qRound(curX + (_width - 0.3 * _height) * s.z), qRound(curY - _height * s.z / 6.0), ")");
@@ -20,6 +20,7 @@ public:
     ~CADrawableFunctionMark();
 
     void draw(QPainter* p, const CADrawSettings s);
+    double minLegibleZoom() const { return 0.5; }
     CADrawableFunctionMark* clone(CADrawableContext* newContext = 0);
 
     inline CAFunctionMark* functionMark() { return (CAFunctionMark*)_musElement; };
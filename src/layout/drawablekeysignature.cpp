@@ -163,6 +163,17 @@ CADrawableKeySignature::~CADrawableKeySignature()
     _drawableAccidentalList.clear();
 }
 
+/*!
+	Moves the key signature together with its accidentals horizontally by \a dx.
+*/
+void CADrawableKeySignature::moveXPos(double dx)
+{
+    for (int i = 0; i < _drawableAccidentalList.size(); i++)
+        _drawableAccidentalList[i]->moveXPos(dx);
+
+    setXPos(xPos() + dx);
+}
+
 void CADrawableKeySignature::draw(QPainter* p, CADrawSettings s)
 {
     int xOrig = s.x;
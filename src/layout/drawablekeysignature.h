@@ -24,6 +24,7 @@ public:
 
     void draw(QPainter* p, CADrawSettings s);
     CADrawableKeySignature* clone(CADrawableContext* newContext = 0);
+    void moveXPos(double dx);
     inline CAKeySignature* keySignature() { return (CAKeySignature*)_musElement; }
 
 private:
@@ -11,10 +11,13 @@
 #include "layout/drawablecontext.h"
 #include "layout/drawablemark.h"
 #include "layout/drawablenote.h" // needed for tempo mark
+#include "layout/feta.h"
+#include "layout/fontcache.h"
+#include "layout/glyphcache.h"
+#include "layout/textmetrics.h"
 
 #include "interface/mididevice.h" // needed for instrument change
 
-#include "canorus.h"
 #include "score/articulation.h"
 #include "score/bookmark.h"
 #include "score/crescendo.h"
@@ -54,44 +57,23 @@ CADrawableMark::CADrawableMark(CAMark* mark, CADrawableContext* dContext, double
 
     switch (mark->markType()) {
     case CAMark::Text: {
-        QFont font("FreeSans");
-        font.setPixelSize(qRound(DEFAULT_TEXT_SIZE));
-        QFontMetrics fm(font);
-
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 11, 0))
-        int textWidth = fm.horizontalAdvance(static_cast<CAText*>(this->mark())->text());
-#else
-        int textWidth = fm.width(static_cast<CAText*>(this->mark())->text());
-#endif
+        QFont font = CAFontCache::font(CAFontCache::FreeSans, qRound(DEFAULT_TEXT_SIZE));
+        int textWidth = CATextMetrics::width(font, static_cast<CAText*>(this->mark())->text());
         setWidth(textWidth < 11 ? 11 : textWidth); // set minimum text width at least 11 points
         setHeight(qRound(DEFAULT_TEXT_SIZE));
         break;
     }
     case CAMark::BookMark: {
-        QFont font("FreeSans");
-        font.setPixelSize(qRound(DEFAULT_TEXT_SIZE));
-        QFontMetrics fm(font);
-
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 11, 0))
-        int textWidth = fm.horizontalAdvance(static_cast<CABookMark*>(this->mark())->text());
-#else
-        int textWidth = fm.width(static_cast<CABookMark*>(this->mark())->text());
-#endif
+        QFont font = CAFontCache::font(CAFontCache::FreeSans, qRound(DEFAULT_TEXT_SIZE));
+        int textWidth = CATextMetrics::width(font, static_cast<CABookMark*>(this->mark())->text());
         setWidth(DEFAULT_PIXMAP_SIZE + textWidth);
         setHeight(qRound(DEFAULT_TEXT_SIZE));
         _pixmap = new QPixmap("images:mark/bookmark.svg");
         break;
     }
     case CAMark::Dynamic: {
-        QFont font("Emmentaler");
-        font.setPixelSize(qRound(DEFAULT_TEXT_SIZE));
-        QFontMetrics fm(font);
-
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 11, 0))
-        int textWidth = fm.horizontalAdvance(static_cast<CADynamic*>(this->mark())->text());
-#else
-        int textWidth = fm.width(static_cast<CADynamic*>(this->mark())->text());
-#endif
+        QFont font = CAFontCache::font(CAFontCache::Emmentaler, qRound(DEFAULT_TEXT_SIZE));
+        int textWidth = CATextMetrics::width(font, static_cast<CADynamic*>(this->mark())->text());
         setWidth(textWidth < 11 ? 11 : textWidth); // set minimum text width at least 11 points
         setHeight(qRound(DEFAULT_TEXT_SIZE));
         break;
@@ -114,17 +96,10 @@ CADrawableMark::CADrawableMark(CAMark* mark, CADrawableContext* dContext, double
         break;
     }
     case CAMark::InstrumentChange: {
-        QFont font("FreeSans");
-        font.setStyle(QFont::StyleItalic);
-        font.setPixelSize(qRound(DEFAULT_TEXT_SIZE));
-        QFontMetrics fm(font);
+        QFont font = CAFontCache::font(CAFontCache::FreeSans, qRound(DEFAULT_TEXT_SIZE), CAFontCache::Italic);
 
         _pixmap = new QPixmap("images:mark/instrumentchange.svg");
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 11, 0))
-        int textWidth = fm.horizontalAdvance(CAMidiDevice::instrumentName(static_cast<CAInstrumentChange*>(this->mark())->instrument()));
-#else
-        int textWidth = fm.width(CAMidiDevice::instrumentName(static_cast<CAInstrumentChange*>(this->mark())->instrument()));
-#endif
+        int textWidth = CATextMetrics::width(font, CAMidiDevice::instrumentName(static_cast<CAInstrumentChange*>(this->mark())->instrument()));
         setWidth(DEFAULT_PIXMAP_SIZE + textWidth); // set minimum text width at least 11 points
         setHeight(qRound(DEFAULT_TEXT_SIZE));
         break;
@@ -149,16 +124,10 @@ CADrawableMark::CADrawableMark(CAMark* mark, CADrawableContext* dContext, double
     }
     case CAMark::Fingering: {
         setXPos(xPos() + 6);
-        QFont font("Emmentaler");
-        font.setPixelSize(11);
-        QFontMetrics fm(font);
+        QFont font = CAFontCache::font(CAFontCache::Emmentaler, 11);
 
         QString text = fingerListToString(static_cast<CAFingering*>(mark)->fingerList());
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 11, 0))
-        setWidth(fm.horizontalAdvance(text)); // set minimum text width at least 11 points
-#else
-        setWidth(fm.width(text)); // set minimum text width at least 11 points
-#endif
+        setWidth(CATextMetrics::width(font, text)); // set minimum text width at least 11 points
         setHeight(11);
 
         break;
@@ -197,8 +166,7 @@ void CADrawableMark::draw(QPainter* p, CADrawSettings s)
 
     switch (mark()->markType()) {
     case CAMark::Dynamic: {
-        QFont font("Emmentaler");
-        font.setPixelSize(qRound(DEFAULT_TEXT_SIZE * s.z));
+        QFont font = CAFontCache::font(CAFontCache::Emmentaler, qRound(DEFAULT_TEXT_SIZE * s.z));
         p->setFont(font);
 
         p->drawText(s.x, s.y + qRound(height() * s.z), static_cast<CADynamic*>(mark())->text());
@@ -215,16 +183,14 @@ void CADrawableMark::draw(QPainter* p, CADrawSettings s)
         break;
     }
     case CAMark::Text: {
-        QFont font("FreeSans");
-        font.setPixelSize(qRound(DEFAULT_TEXT_SIZE * s.z));
+        QFont font = CAFontCache::font(CAFontCache::FreeSans, qRound(DEFAULT_TEXT_SIZE * s.z));
         p->setFont(font);
 
         p->drawText(s.x, s.y + qRound(height() * s.z), static_cast<CAText*>(mark())->text());
         break;
     }
     case CAMark::BookMark: {
-        QFont font("FreeSans");
-        font.setPixelSize(qRound(DEFAULT_TEXT_SIZE * s.z));
+        QFont font = CAFontCache::font(CAFontCache::FreeSans, qRound(DEFAULT_TEXT_SIZE * s.z));
         p->setFont(font);
 
         p->drawPixmap(s.x, s.y, _pixmap->scaled(qRound(DEFAULT_PIXMAP_SIZE * s.z), qRound(DEFAULT_PIXMAP_SIZE * s.z)));
@@ -232,9 +198,7 @@ void CADrawableMark::draw(QPainter* p, CADrawSettings s)
         break;
     }
     case CAMark::RehersalMark: {
-        QFont font("FreeSans");
-        font.setBold(true);
-        font.setPixelSize(qRound(DEFAULT_TEXT_SIZE * s.z));
+        QFont font = CAFontCache::font(CAFontCache::FreeSans, qRound(DEFAULT_TEXT_SIZE * s.z), CAFontCache::Bold);
         p->setFont(font);
 
         p->drawRect(s.x, s.y, qRound(width() * s.z), qRound(height() * s.z));
@@ -243,17 +207,14 @@ void CADrawableMark::draw(QPainter* p, CADrawSettings s)
     }
     case CAMark::InstrumentChange: {
         p->drawPixmap(s.x, s.y, _pixmap->scaled(qRound(DEFAULT_PIXMAP_SIZE * s.z), qRound(DEFAULT_PIXMAP_SIZE * s.z)));
-        QFont font("FreeSans");
-        font.setItalic(true);
-        font.setPixelSize(qRound(DEFAULT_TEXT_SIZE * s.z));
+        QFont font = CAFontCache::font(CAFontCache::FreeSans, qRound(DEFAULT_TEXT_SIZE * s.z), CAFontCache::Italic);
         p->setFont(font);
 
         p->drawText(s.x + qRound((DEFAULT_PIXMAP_SIZE + 1) * s.z), s.y + qRound(height() * s.z), CAMidiDevice::instrumentName(static_cast<CAInstrumentChange*>(mark())->instrument()));
         break;
     }
     case CAMark::Fermata: {
-        QFont font("Emmentaler");
-        font.setPixelSize(qRound(DEFAULT_TEXT_SIZE * 1.1 * s.z));
+        QFont font = CAFontCache::font(CAFontCache::Emmentaler, qRound(DEFAULT_TEXT_SIZE * 1.1 * s.z));
         p->setFont(font);
 
         int inverted = 0;
@@ -264,16 +225,16 @@ void CADrawableMark::draw(QPainter* p, CADrawSettings s)
         int y = qRound(s.y + (inverted ? 0 : (height() * s.z)));
         switch (static_cast<CAFermata*>(mark())->fermataType()) {
         case CAFermata::NormalFermata:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.ufermata") + inverted));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_ufermata) + inverted);
             break;
         case CAFermata::ShortFermata:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.ushortfermata") + inverted));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_ushortfermata) + inverted);
             break;
         case CAFermata::LongFermata:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.ulongfermata") + inverted));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_ulongfermata) + inverted);
             break;
         case CAFermata::VeryLongFermata:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.uverylongfermata") + inverted));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_uverylongfermata) + inverted);
             break;
         }
         break;
@@ -282,16 +243,13 @@ void CADrawableMark::draw(QPainter* p, CADrawSettings s)
         _tempoDNote->draw(p, s);
 
         s.x += qRound(_tempoDNote->width() * s.z);
-        QFont font("FreeSans");
-        font.setPixelSize(qRound(DEFAULT_TEXT_SIZE * s.z));
+        QFont font = CAFontCache::font(CAFontCache::FreeSans, qRound(DEFAULT_TEXT_SIZE * s.z));
         p->setFont(font);
         p->drawText(s.x, s.y + qRound(height() * s.z), QString(" = ") + QString::number(static_cast<CATempo*>(mark())->bpm()));
         break;
     }
     case CAMark::Ritardando: {
-        QFont font("FreeSans");
-        font.setPixelSize(qRound(DEFAULT_TEXT_SIZE * s.z));
-        font.setItalic(true);
+        QFont font = CAFontCache::font(CAFontCache::FreeSans, qRound(DEFAULT_TEXT_SIZE * s.z), CAFontCache::Italic);
         p->setFont(font);
 
         p->drawText(s.x, s.y + qRound(height() * s.z), static_cast<CARitardando*>(mark())->ritardandoType() == CARitardando::Ritardando ? "rit." : "accel.");
@@ -302,30 +260,27 @@ void CADrawableMark::draw(QPainter* p, CADrawSettings s)
 
         // draw "dal" if needed
         if (r->repeatMarkType() == CARepeatMark::DalSegno || r->repeatMarkType() == CARepeatMark::DalCoda || r->repeatMarkType() == CARepeatMark::DalVarCoda) {
-            QFont font("Century Schoolbook L");
-            font.setStyle(QFont::StyleItalic);
-            font.setPixelSize(qRound(DEFAULT_TEXT_SIZE * s.z));
+            QFont font = CAFontCache::font(CAFontCache::CenturySchoolbook, qRound(DEFAULT_TEXT_SIZE * s.z), CAFontCache::Italic);
             p->setFont(font);
             p->drawText(s.x, s.y, QString("Dal"));
             s.x += qRound(45 * s.z);
         }
 
         // draw the actual sign
-        QFont font("Emmentaler");
-        font.setPixelSize(qRound(DEFAULT_TEXT_SIZE * 1.4 * s.z));
+        QFont font = CAFontCache::font(CAFontCache::Emmentaler, qRound(DEFAULT_TEXT_SIZE * 1.4 * s.z));
         p->setFont(font);
         switch (static_cast<CARepeatMark*>(mark())->repeatMarkType()) {
         case CARepeatMark::Segno:
         case CARepeatMark::DalSegno:
-            p->drawText(s.x, s.y, QString(CACanorus::fetaCodepoint("scripts.segno")));
+            CAGlyphCache::drawGlyph(p, s.x, s.y, CAFeta::codepoint(CAFeta::scripts_segno));
             break;
         case CARepeatMark::Coda:
         case CARepeatMark::DalCoda:
-            p->drawText(s.x, s.y, QString(CACanorus::fetaCodepoint("scripts.coda")));
+            CAGlyphCache::drawGlyph(p, s.x, s.y, CAFeta::codepoint(CAFeta::scripts_coda));
             break;
         case CARepeatMark::VarCoda:
         case CARepeatMark::DalVarCoda:
-            p->drawText(s.x, s.y, QString(CACanorus::fetaCodepoint("scripts.varcoda")));
+            CAGlyphCache::drawGlyph(p, s.x, s.y, CAFeta::codepoint(CAFeta::scripts_varcoda));
             break;
         case CARepeatMark::Volta:
             break;
@@ -343,10 +298,10 @@ void CADrawableMark::draw(QPainter* p, CADrawSettings s)
         break;
     }
     case CAMark::Fingering: {
-        QFont font("Emmentaler");
         CAFingering* f = static_cast<CAFingering*>(mark());
-        font.setPixelSize(f->fingerList()[0] > 5 ? qRound(DEFAULT_TEXT_SIZE * 2 * s.z) : qRound(DEFAULT_TEXT_SIZE * 1.3 * s.z));
-        font.setItalic(static_cast<CAFingering*>(mark())->isOriginal());
+        QFont font = CAFontCache::font(CAFontCache::Emmentaler,
+            f->fingerList()[0] > 5 ? qRound(DEFAULT_TEXT_SIZE * 2 * s.z) : qRound(DEFAULT_TEXT_SIZE * 1.3 * s.z),
+            f->isOriginal() ? CAFontCache::Italic : CAFontCache::Regular);
         p->setFont(font);
         QString text = fingerListToString(static_cast<CAFingering*>(mark())->fingerList());
         p->drawText(s.x, s.y + qRound(height() * s.z), text);
@@ -354,102 +309,100 @@ void CADrawableMark::draw(QPainter* p, CADrawSettings s)
         break;
     }
     case CAMark::Pedal: {
-        QFont font("Emmentaler");
-        font.setPixelSize(qRound(DEFAULT_TEXT_SIZE * 1.6 * s.z));
+        QFont font = CAFontCache::font(CAFontCache::Emmentaler, qRound(DEFAULT_TEXT_SIZE * 1.6 * s.z));
         p->setFont(font);
-        p->drawText(s.x, s.y + qRound(height() * s.z), QString(CACanorus::fetaCodepoint("pedal.Ped")));
-        p->drawText(s.x + qRound((width() - 10) * s.z), s.y + qRound(height() * s.z), QString(CACanorus::fetaCodepoint("pedal.*")));
+        CAGlyphCache::drawGlyph(p, s.x, s.y + qRound(height() * s.z), CAFeta::codepoint(CAFeta::pedal_Ped));
+        CAGlyphCache::drawGlyph(p, s.x + qRound((width() - 10) * s.z), s.y + qRound(height() * s.z), CAFeta::codepoint(CAFeta::pedal_star));
 
         break;
     }
     case CAMark::Articulation: {
-        QFont font("Emmentaler");
-        font.setPixelSize(qRound(DEFAULT_TEXT_SIZE * 1.4 * s.z));
+        QFont font = CAFontCache::font(CAFontCache::Emmentaler, qRound(DEFAULT_TEXT_SIZE * 1.4 * s.z));
         p->setFont(font);
 
         int x = s.x + qRound((width() / 2.0) * s.z);
         int y = s.y + qRound(height() * s.z);
         switch (static_cast<CAArticulation*>(mark())->articulationType()) {
         case CAArticulation::Accent:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.sforzato")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_sforzato));
             break;
         case CAArticulation::Marcato:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.umarcato")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_umarcato));
             break;
         case CAArticulation::Staccatissimo:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.ustaccatissimo")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_ustaccatissimo));
             break;
         case CAArticulation::Espressivo:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.espr")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_espr));
             break;
         case CAArticulation::Staccato:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.staccato")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_staccato));
             break;
         case CAArticulation::Tenuto:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.tenuto")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_tenuto));
             break;
         case CAArticulation::Breath:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.rcomma")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_rcomma));
             break;
         case CAArticulation::Portato:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.uportato")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_uportato));
             break;
         case CAArticulation::UpBow:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.upbow")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_upbow));
             break;
         case CAArticulation::DownBow:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.downbow")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_downbow));
             break;
         case CAArticulation::Flageolet:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.flageolet")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_flageolet));
             break;
         case CAArticulation::Open:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.open")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_open));
             break;
         case CAArticulation::Stopped:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.stopped")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_stopped));
             break;
         case CAArticulation::Turn:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.turn")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_turn));
             break;
         case CAArticulation::ReverseTurn:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.reverseturn")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_reverseturn));
             break;
         case CAArticulation::Trill:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.trill")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_trill));
             break;
         case CAArticulation::Prall:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.prall")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_prall));
             break;
         case CAArticulation::Mordent:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.mordent")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_mordent));
             break;
         case CAArticulation::PrallPrall:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.prallprall")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_prallprall));
             break;
         case CAArticulation::PrallMordent:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.prallmordent")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_prallmordent));
             break;
         case CAArticulation::UpPrall:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.upprall")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_upprall));
             break;
         case CAArticulation::DownPrall:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.downprall")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_downprall));
             break;
         case CAArticulation::UpMordent:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.upmordent")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_upmordent));
             break;
         case CAArticulation::DownMordent:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.downmordent")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_downmordent));
             break;
         case CAArticulation::PrallDown:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.pralldown")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_pralldown));
             break;
         case CAArticulation::PrallUp:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.prallup")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_prallup));
             break;
         case CAArticulation::LinePrall:
-            p->drawText(x, y, QString(CACanorus::fetaCodepoint("scripts.lineprall")));
+            CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::scripts_lineprall));
             break;
         case CAArticulation::Undefined:
             fprintf(stderr, "Warning: CADrawableMark::draw - Unhandled A-Type %d", static_cast<CAArticulation*>(mark())->articulationType());
@@ -479,15 +432,15 @@ QString CADrawableMark::fingerListToString(const QList<CAFingering::CAFingerNumb
         if (list[i] > 0 && list[i] < 6)
             text += QString::number(list[i]);
         else if (list[i] == CAFingering::Thumb)
-            text += QString(CACanorus::fetaCodepoint("scripts.thumb"));
+            text += QString(CAFeta::codepoint(CAFeta::scripts_thumb));
         else if (list[i] == CAFingering::LHeel)
-            text += QString(CACanorus::fetaCodepoint("scripts.upedalheel"));
+            text += QString(CAFeta::codepoint(CAFeta::scripts_upedalheel));
         else if (list[i] == CAFingering::RHeel)
-            text += QString(CACanorus::fetaCodepoint("scripts.dpedalheel"));
+            text += QString(CAFeta::codepoint(CAFeta::scripts_dpedalheel));
         else if (list[i] == CAFingering::LToe)
-            text += QString(CACanorus::fetaCodepoint("scripts.upedaltoe"));
+            text += QString(CAFeta::codepoint(CAFeta::scripts_upedaltoe));
         else if (list[i] == CAFingering::RToe)
-            text += QString(CACanorus::fetaCodepoint("scripts.dpedaltoe"));
+            text += QString(CAFeta::codepoint(CAFeta::scripts_dpedaltoe));
     }
 
     return text;
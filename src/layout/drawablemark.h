@@ -22,6 +22,7 @@ public:
     virtual ~CADrawableMark();
 
     void draw(QPainter* p, CADrawSettings s);
+    double minLegibleZoom() const { return 0.5; }
     CADrawableMark* clone(CADrawableContext* newContext = nullptr);
     inline CAMark* mark() { return static_cast<CAMark*>(musElement()); }
 
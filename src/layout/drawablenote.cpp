@@ -6,10 +6,12 @@
 */
 
 #include "layout/drawablenote.h"
-#include "canorus.h"
 #include "layout/drawableaccidental.h"
 #include "layout/drawablecontext.h"
 #include "layout/drawablestaff.h"
+#include "layout/feta.h"
+#include "layout/fontcache.h"
+#include "layout/glyphcache.h"
 #include "score/staff.h"
 #include "score/voice.h"
 #include <QPainter>
@@ -31,13 +33,17 @@ const double CADrawableNote::HALF_YPOS_DELTA = 23;
 	\param x coordinate represents the left border of the notehead.
 	\param y coordinate represents the center of the notehead.
 */
-CADrawableNote::CADrawableNote(CANote* n, CADrawableContext* drawableContext, double x, double y, bool shadowNote, CADrawableAccidental* drawableAcc)
+CADrawableNote::CADrawableNote(CANote* n, CADrawableContext* drawableContext, double x, double y, bool shadowNote, CADrawableAccidental* drawableAcc, CANote::CAStemDirection stemDirection)
     : CADrawableMusElement(n, drawableContext, x, y)
 {
     _drawableMusElementType = CADrawableMusElement::DrawableNote;
     _drawableAcc = drawableAcc;
+    _noteHeadGlyph = 0;
+    _flagUpGlyph = 0;
+    _flagDownGlyph = 0;
 
-    _stemDirection = note()->actualStemDirection();
+    _notePosition = n->notePosition();
+    _stemDirection = (stemDirection == CANote::StemUp || stemDirection == CANote::StemDown) ? stemDirection : note()->actualStemDirection();
 
     // Notehead widths are hardcoded below; it's possible to determine them at runtime using QFontMetrics, if necessary.
     switch (n->playableLength().musicLength()) {
@@ -47,28 +53,28 @@ CADrawableNote::CADrawableNote(CANote* n, CADrawableContext* drawableContext, do
     case CAPlayableLength::Sixteenth:
     case CAPlayableLength::Eighth:
     case CAPlayableLength::Quarter:
-        _noteHeadGlyphName = "noteheads.s2";
+        _noteHeadGlyph = CAFeta::codepoint(CAFeta::noteheads_s2);
         _penWidth = 1.2;
         setWidth(11);
         setHeight(10);
         break;
 
     case CAPlayableLength::Half:
-        _noteHeadGlyphName = "noteheads.s1";
+        _noteHeadGlyph = CAFeta::codepoint(CAFeta::noteheads_s1);
         _penWidth = 1.3;
         setWidth(12);
         setHeight(10);
         break;
 
     case CAPlayableLength::Whole:
-        _noteHeadGlyphName = "noteheads.s0";
+        _noteHeadGlyph = CAFeta::codepoint(CAFeta::noteheads_s0);
         _penWidth = 0;
         setWidth(17);
         setHeight(8);
         break;
 
     case CAPlayableLength::Breve:
-        _noteHeadGlyphName = "noteheads.sM1";
+        _noteHeadGlyph = CAFeta::codepoint(CAFeta::noteheads_sM1);
         _penWidth = 0;
         setWidth(18);
         setHeight(8);
@@ -85,28 +91,28 @@ CADrawableNote::CADrawableNote(CANote* n, CADrawableContext* drawableContext, do
     case CAPlayableLength::HundredTwentyEighth:
         /// \todo Emmentaler font doesn't have 128th, 64th flag is drawn instead! Need to somehow compose the 128th flag? -Matevz
         _stemLength = HUNDREDTWENTYEIGHTH_STEM_LENGTH;
-        _flagUpGlyphName = "flags.u7";
-        _flagDownGlyphName = "flags.d7";
+        _flagUpGlyph = CAFeta::codepoint(CAFeta::flags_u7);
+        _flagDownGlyph = CAFeta::codepoint(CAFeta::flags_d7);
         break;
     case CAPlayableLength::SixtyFourth:
         _stemLength = SIXTYFOURTH_STEM_LENGTH;
-        _flagUpGlyphName = "flags.u6";
-        _flagDownGlyphName = "flags.d6";
+        _flagUpGlyph = CAFeta::codepoint(CAFeta::flags_u6);
+        _flagDownGlyph = CAFeta::codepoint(CAFeta::flags_d6);
         break;
     case CAPlayableLength::ThirtySecond:
         _stemLength = THIRTYSECOND_STEM_LENGTH;
-        _flagUpGlyphName = "flags.u5";
-        _flagDownGlyphName = "flags.d5";
+        _flagUpGlyph = CAFeta::codepoint(CAFeta::flags_u5);
+        _flagDownGlyph = CAFeta::codepoint(CAFeta::flags_d5);
         break;
     case CAPlayableLength::Sixteenth:
         _stemLength = SIXTEENTH_STEM_LENGTH;
-        _flagUpGlyphName = "flags.u4";
-        _flagDownGlyphName = "flags.d4";
+        _flagUpGlyph = CAFeta::codepoint(CAFeta::flags_u4);
+        _flagDownGlyph = CAFeta::codepoint(CAFeta::flags_d4);
         break;
     case CAPlayableLength::Eighth:
         _stemLength = EIGHTH_STEM_LENGTH;
-        _flagUpGlyphName = "flags.u3";
-        _flagDownGlyphName = "flags.d3";
+        _flagUpGlyph = CAFeta::codepoint(CAFeta::flags_u3);
+        _flagDownGlyph = CAFeta::codepoint(CAFeta::flags_d3);
         break;
     case CAPlayableLength::Quarter:
         _stemLength = QUARTER_STEM_LENGTH;
@@ -141,8 +147,7 @@ CADrawableNote::~CADrawableNote()
 
 void CADrawableNote::draw(QPainter* p, CADrawSettings s)
 {
-    QFont font("Emmentaler");
-    font.setPixelSize(qRound(35 * s.z));
+    QFont font = CAFontCache::font(CAFontCache::Emmentaler, qRound(35 * s.z));
 
     p->setPen(QPen(s.color));
     p->setFont(font);
@@ -150,10 +155,10 @@ void CADrawableNote::draw(QPainter* p, CADrawSettings s)
     QPen pen;
 
     // Draw ledger lines
-    if (_drawLedgerLines && drawableContext() && drawableContext()->drawableContextType() == CADrawableContext::DrawableStaff && note() && note()->voice() && note()->voice()->staff() && ((note()->notePosition() <= -2) || // note is below the staff
-                                                                                                                                                                                              (note()->notePosition() >= note()->voice()->staff()->numberOfLines() * 2) // note is above the staff
+    if (_drawLedgerLines && drawableContext() && drawableContext()->drawableContextType() == CADrawableContext::DrawableStaff && note() && note()->voice() && note()->voice()->staff() && ((_notePosition <= -2) || // note is below the staff
+                                                                                                                                                                                              (_notePosition >= note()->voice()->staff()->numberOfLines() * 2) // note is above the staff
                                                                                                                                                                                               )) {
-        int direction = (note()->notePosition() > 0 ? 1 : -1); // 1 falling, -1 rising
+        int direction = (_notePosition > 0 ? 1 : -1); // 1 falling, -1 rising
         double ledgerDist = static_cast<CADrawableStaff*>(drawableContext())->lineSpace() * s.z; // distance between the ledger lines - notehead height
 
         // draw ledger lines in direction from the notehead to staff
@@ -164,7 +169,7 @@ void CADrawableNote::draw(QPainter* p, CADrawSettings s)
         pen.setWidthF(1.0 * s.z);
         p->setPen(pen);
         for (int i = 0;
-             i < ((note()->notePosition() * direction - ((direction > 0) ? ((note()->voice()->staff()->numberOfLines() - 1) * 2) : 0)) / 2);
+             i < ((_notePosition * direction - ((direction > 0) ? ((note()->voice()->staff()->numberOfLines() - 1) * 2) : 0)) / 2);
              ++i) {
             ry -= ledgerDist * direction;
             p->drawLine(qRound(s.x - 4 * s.z), qRound(ry), qRound(s.x + (_noteHeadWidth + 4) * s.z), qRound(ry));
@@ -173,7 +178,7 @@ void CADrawableNote::draw(QPainter* p, CADrawSettings s)
 
     // Draw notehead
     s.y += height() * s.z / 2;
-    p->drawText(s.x, s.y, QString(CACanorus::fetaCodepoint(_noteHeadGlyphName)));
+    CAGlyphCache::drawGlyph(p, s.x, s.y, _noteHeadGlyph);
 
     if (note()->noteLength().musicLength() >= CAPlayableLength::Half) {
         // Draw stem and flag
@@ -185,14 +190,14 @@ void CADrawableNote::draw(QPainter* p, CADrawSettings s)
             s.x += qRound(_noteHeadWidth * s.z); // increase X-offset before drawing the stem
             p->drawLine(s.x, qRound(s.y - 1 * s.z), s.x, s.y - qRound(_stemLength * s.z));
             if (note()->noteLength().musicLength() >= CAPlayableLength::Eighth) {
-                p->drawText(qRound(s.x + 0.6 * s.z), qRound(s.y - _stemLength * s.z), QString(CACanorus::fetaCodepoint(_flagUpGlyphName)));
+                CAGlyphCache::drawGlyph(p, qRound(s.x + 0.6 * s.z), qRound(s.y - _stemLength * s.z), _flagUpGlyph);
                 s.x += qRound(6 * s.z); // additional X-offset for dots because of the flag on the right
             }
         } else {
             s.x += qRound(0.6 * s.z);
             p->drawLine(s.x, qRound(s.y + 1 * s.z), s.x, s.y + qRound(_stemLength * s.z));
             if (note()->noteLength().musicLength() >= CAPlayableLength::Eighth) {
-                p->drawText(qRound(s.x + 0.4 * s.z), qRound(s.y + (_stemLength + 5) * s.z), QString(CACanorus::fetaCodepoint(_flagDownGlyphName)));
+                CAGlyphCache::drawGlyph(p, qRound(s.x + 0.4 * s.z), qRound(s.y + (_stemLength + 5) * s.z), _flagDownGlyph);
             }
             s.x += qRound(_noteHeadWidth * s.z); // increase X-offset after drawing the stem
         }
@@ -216,5 +221,33 @@ void CADrawableNote::draw(QPainter* p, CADrawSettings s)
 
 CADrawableNote* CADrawableNote::clone(CADrawableContext* newContext)
 {
-    return new CADrawableNote(note(), (newContext) ? newContext : _drawableContext, xPos(), yPos() + height() / 2);
+    return new CADrawableNote(note(), (newContext) ? newContext : _drawableContext, xPos(), yPos() + height() / 2, false, nullptr, _stemDirection);
+}
+
+/*!
+	Returns the stem direction of the chord starting with the note at \a idx in the voice's
+	music elements \a elts. All the notes of the chord share the stem, so the direction is
+	computed once per chord by the layout engine and passed to each CADrawableNote of the chord.
+
+	The stem direction set by the user or the voice is kept. The neutral stem points away from the
+	note farthest from the middle line of the staff.
+*/
+CANote::CAStemDirection CADrawableNote::chordStemDirection(const QList<CAMusElement*>& elts, int idx)
+{
+    CANote* first = static_cast<CANote*>(elts[idx]);
+    bool neutral = (first->stemDirection() == CANote::StemNeutral || (first->stemDirection() == CANote::StemPreferred && first->voice() && first->voice()->stemDirection() == CANote::StemNeutral));
+    if (!neutral || !first->staff()) {
+        return first->actualStemDirection();
+    }
+
+    int lowest = first->notePosition();
+    int highest = lowest;
+    for (int i = idx + 1; i < elts.size() && elts[i]->musElementType() == CAMusElement::Note && elts[i]->timeStart() == first->timeStart(); i++) {
+        int position = static_cast<CANote*>(elts[i])->notePosition();
+        lowest = qMin(lowest, position);
+        highest = qMax(highest, position);
+    }
+
+    // position has step of 2 per line, see CANote::actualStemDirection()
+    return (lowest + highest < 2 * (first->staff()->numberOfLines() - 1)) ? CANote::StemUp : CANote::StemDown;
 }
@@ -16,7 +16,7 @@ class CADrawableAccidental;
 
 class CADrawableNote : public CADrawableMusElement {
 public:
-    CADrawableNote(CANote* note, CADrawableContext* drawableContext, double x, double y, bool shadowNote = false, CADrawableAccidental* acc = 0);
+    CADrawableNote(CANote* note, CADrawableContext* drawableContext, double x, double y, bool shadowNote = false, CADrawableAccidental* acc = 0, CANote::CAStemDirection stemDirection = CANote::StemUndefined);
 
     ~CADrawableNote();
 
@@ -32,17 +32,21 @@ public:
     void setDrawableAccidental(CADrawableAccidental* acc) { _drawableAcc = acc; }
     CADrawableAccidental* drawableAccidental() { return _drawableAcc; }
 
+    inline CANote::CAStemDirection stemDirection() { return _stemDirection; }
+    static CANote::CAStemDirection chordStemDirection(const QList<CAMusElement*>& elts, int idx);
+
 private:
     bool _drawLedgerLines; ///Are the ledger lines drawn or not. True when ledger lines needed, False when the note is inside the staff
     bool _shadowNote; ///Is the current note shadow note?
     CADrawableAccidental* _drawableAcc;
-    CANote::CAStemDirection _stemDirection; /// This value is StemUp or StemDown only, no StemPreferred or StemNeutral present. We generate this on CADrawableNote constructor.
+    CANote::CAStemDirection _stemDirection; /// This value is StemUp or StemDown only, no StemPreferred or StemNeutral present. We generate this on CADrawableNote constructor or get it for the whole chord.
     double _stemLength;
+    int _notePosition; // of the note in the staff, looked up once as it depends on the clef
     double _noteHeadWidth;
     double _penWidth; // pen width for stem
-    QString _noteHeadGlyphName; // Feta glyph name for the notehead symbol.
-    QString _flagUpGlyphName; // likewise for stem flags
-    QString _flagDownGlyphName;
+    int _noteHeadGlyph; // Feta glyph codepoint for the notehead symbol.
+    int _flagUpGlyph; // likewise for stem flags
+    int _flagDownGlyph;
     static const double HUNDREDTWENTYEIGHTH_STEM_LENGTH;
     static const double SIXTYFOURTH_STEM_LENGTH;
     static const double THIRTYSECOND_STEM_LENGTH;
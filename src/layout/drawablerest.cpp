@@ -6,9 +6,11 @@
 */
 
 #include "layout/drawablerest.h"
-#include "canorus.h"
 #include "layout/drawablecontext.h"
 #include "layout/drawablestaff.h"
+#include "layout/feta.h"
+#include "layout/fontcache.h"
+#include "layout/glyphcache.h"
 #include "score/rest.h"
 
 #include <QPainter>
@@ -17,52 +19,61 @@ CADrawableRest::CADrawableRest(CARest* rest, CADrawableContext* drawableContext,
     : CADrawableMusElement(rest, drawableContext, x, y)
 {
     _drawableMusElementType = CADrawableMusElement::DrawableRest;
+    _glyph = 0;
 
     if (drawableContext->drawableContextType() != CADrawableContext::DrawableStaff)
         return;
 
     switch (rest->playableLength().musicLength()) {
     case CAPlayableLength::HundredTwentyEighth:
+        _glyph = CAFeta::codepoint(CAFeta::rests_7);
         setWidth(16);
         setHeight(49);
         break;
 
     case CAPlayableLength::SixtyFourth:
+        _glyph = CAFeta::codepoint(CAFeta::rests_6);
         setWidth(14);
         setHeight(41);
         break;
 
     case CAPlayableLength::ThirtySecond:
+        _glyph = CAFeta::codepoint(CAFeta::rests_5);
         setWidth(12);
         setHeight(33);
         setYPos(y + 2);
         break;
 
     case CAPlayableLength::Sixteenth:
+        _glyph = CAFeta::codepoint(CAFeta::rests_4);
         setWidth(10);
         setHeight(24);
         setYPos(y + static_cast<CADrawableStaff*>(drawableContext)->lineSpace());
         break;
 
     case CAPlayableLength::Eighth:
+        _glyph = CAFeta::codepoint(CAFeta::rests_3);
         setWidth(8);
         setHeight(17);
         setYPos(y + static_cast<CADrawableStaff*>(drawableContext)->lineSpace());
         break;
 
     case CAPlayableLength::Quarter:
+        _glyph = CAFeta::codepoint(CAFeta::rests_2);
         setWidth(8);
         setHeight(20);
         setYPos(y + static_cast<CADrawableStaff*>(drawableContext)->lineSpace());
         break;
 
     case CAPlayableLength::Half:
+        _glyph = CAFeta::codepoint(CAFeta::rests_1);
         setWidth(12);
         setHeight(5);
         setYPos(y + 1.5 * static_cast<CADrawableStaff*>(drawableContext)->lineSpace());
         break;
 
     case CAPlayableLength::Whole:
+        _glyph = CAFeta::codepoint(CAFeta::rests_0);
         setWidth(12);
         setHeight(5);
         //values in constructor are the notehead center coords. yPos represents the top of the stem.
@@ -70,6 +81,7 @@ CADrawableRest::CADrawableRest(CARest* rest, CADrawableContext* drawableContext,
         break;
 
     case CAPlayableLength::Breve:
+        _glyph = CAFeta::codepoint(CAFeta::rests_M1);
         setWidth(4);
         setHeight(9);
         setYPos(y + static_cast<CADrawableStaff*>(drawableContext)->lineSpace());
@@ -100,8 +112,7 @@ CADrawableRest* CADrawableRest::clone(CADrawableContext* newContext)
 
 void CADrawableRest::draw(QPainter* p, CADrawSettings s)
 {
-    QFont font("Emmentaler");
-    font.setPixelSize(qRound(35 * s.z));
+    QFont font = CAFontCache::font(CAFontCache::Emmentaler, qRound(35 * s.z));
 
     p->setPen(QPen(s.color));
     p->setFont(font);
@@ -109,39 +120,39 @@ void CADrawableRest::draw(QPainter* p, CADrawSettings s)
     QPen pen;
     switch (rest()->playableLength().musicLength()) {
     case CAPlayableLength::HundredTwentyEighth: {
-        p->drawText(qRound(s.x + 4 * s.z), qRound(s.y + (2.6 * (static_cast<CADrawableStaff*>(_drawableContext))->lineSpace()) * s.z), QString(CACanorus::fetaCodepoint("rests.7")));
+        CAGlyphCache::drawGlyph(p, qRound(s.x + 4 * s.z), qRound(s.y + (2.6 * (static_cast<CADrawableStaff*>(_drawableContext))->lineSpace()) * s.z), _glyph);
         break;
     }
     case CAPlayableLength::SixtyFourth: {
-        p->drawText(qRound(s.x + 3 * s.z), qRound(s.y + (1.75 * (static_cast<CADrawableStaff*>(_drawableContext))->lineSpace()) * s.z), QString(CACanorus::fetaCodepoint("rests.6")));
+        CAGlyphCache::drawGlyph(p, qRound(s.x + 3 * s.z), qRound(s.y + (1.75 * (static_cast<CADrawableStaff*>(_drawableContext))->lineSpace()) * s.z), _glyph);
         break;
     }
     case CAPlayableLength::ThirtySecond: {
-        p->drawText(qRound(s.x + 2.5 * s.z), qRound(s.y + (1.8 * (static_cast<CADrawableStaff*>(_drawableContext))->lineSpace()) * s.z), QString(CACanorus::fetaCodepoint("rests.5")));
+        CAGlyphCache::drawGlyph(p, qRound(s.x + 2.5 * s.z), qRound(s.y + (1.8 * (static_cast<CADrawableStaff*>(_drawableContext))->lineSpace()) * s.z), _glyph);
         break;
     }
     case CAPlayableLength::Sixteenth: {
-        p->drawText(qRound(s.x + 1 * s.z), qRound(s.y + ((static_cast<CADrawableStaff*>(_drawableContext))->lineSpace() - 0.9) * s.z), QString(CACanorus::fetaCodepoint("rests.4")));
+        CAGlyphCache::drawGlyph(p, qRound(s.x + 1 * s.z), qRound(s.y + ((static_cast<CADrawableStaff*>(_drawableContext))->lineSpace() - 0.9) * s.z), _glyph);
         break;
     }
     case CAPlayableLength::Eighth: {
-        p->drawText(s.x, qRound(s.y + ((static_cast<CADrawableStaff*>(_drawableContext))->lineSpace() - 0.9) * s.z), QString(CACanorus::fetaCodepoint("rests.3")));
+        CAGlyphCache::drawGlyph(p, s.x, qRound(s.y + ((static_cast<CADrawableStaff*>(_drawableContext))->lineSpace() - 0.9) * s.z), _glyph);
         break;
     }
     case CAPlayableLength::Quarter: {
-        p->drawText(s.x, qRound(s.y + 0.5 * height() * s.z), QString(CACanorus::fetaCodepoint("rests.2")));
+        CAGlyphCache::drawGlyph(p, s.x, qRound(s.y + 0.5 * height() * s.z), _glyph);
         break;
     }
     case CAPlayableLength::Half: {
-        p->drawText(s.x, qRound(s.y + height() * s.z + 0.5), QString(CACanorus::fetaCodepoint("rests.1")));
+        CAGlyphCache::drawGlyph(p, s.x, qRound(s.y + height() * s.z + 0.5), _glyph);
         break;
     }
     case CAPlayableLength::Whole: {
-        p->drawText(s.x, s.y, QString(CACanorus::fetaCodepoint("rests.0")));
+        CAGlyphCache::drawGlyph(p, s.x, s.y, _glyph);
         break;
     }
     case CAPlayableLength::Breve: {
-        p->drawText(s.x, qRound(s.y + height() * s.z), QString(CACanorus::fetaCodepoint("rests.M1")));
+        CAGlyphCache::drawGlyph(p, s.x, qRound(s.y + height() * s.z), _glyph);
         break;
     }
     case CAPlayableLength::Undefined:
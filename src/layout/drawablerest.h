@@ -23,6 +23,7 @@ public:
 
 private:
     double _restWidth; ///Width of the rest itself without dots, ledger lines etc.
+    int _glyph; // Feta glyph codepoint of the rest symbol
 };
 
 #endif /*DRAWABLEREST_H_*/
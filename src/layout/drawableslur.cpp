@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -30,6 +30,23 @@ CADrawableSlur::~CADrawableSlur()
 {
 }
 
+/*!
+	Moves all the control points of the slur horizontally by \a dx.
+*/
+void CADrawableSlur::moveXPos(double dx)
+{
+    _x1 += dx;
+    _xMid += dx;
+    _x2 += dx;
+    updateGeometry();
+}
+
+/*!
+	Updates the bounding box and the cached shape of the slur after the control points change.
+
+	The shape is computed once in world coordinates relative to the top-left corner of the bounding
+	box, so drawing only scales and translates the points.
+*/
 void CADrawableSlur::updateGeometry()
 {
     setXPos(min(x1(), xMid(), x2()));
@@ -37,6 +54,23 @@ void CADrawableSlur::updateGeometry()
 
     setYPos(min(y1(), yMid(), y2()));
     setHeight(max(y1(), yMid(), y2()) - yPos());
+
+    // rounded slur using the exponent shape, left and right half of the curve
+    static const double leftShape[SHAPE_POINTS / 2] = { 0, 0.34, 0.53, 0.71, 0.79, 0.86, 0.90, 0.94, 0.95, 0.97 };
+    static const double rightShape[SHAPE_POINTS / 2] = { 0.02, 0.03, 0.05, 0.06, 0.10, 0.14, 0.21, 0.29, 0.47, 0.66 };
+
+    double yLeft = y1() - yPos();
+    double xMidl = xMid() - xPos();
+    double yMidl = yMid() - yPos();
+    double deltaY1 = yMidl - yLeft;
+    double deltaY2 = (y2() - yPos()) - yMidl;
+    double deltaX2 = width() - xMidl;
+
+    for (int i = 0; i < SHAPE_POINTS / 2; i++) {
+        _shape[i] = QPointF(0.1 * i * xMidl, yLeft + deltaY1 * leftShape[i]);
+        _shape[SHAPE_POINTS / 2 + i] = QPointF(xMidl + 0.1 * i * deltaX2, yMidl + deltaY2 * rightShape[i]);
+    }
+    _shape[SHAPE_POINTS - 1] = QPointF(width(), y2() - yPos());
 }
 
 /*!
@@ -86,41 +120,12 @@ void CADrawableSlur::draw(QPainter* p, const CADrawSettings s)
     bool aliasing = p->testRenderHint(QPainter::Antialiasing);
     p->setRenderHint(QPainter::Antialiasing, true);
 
-    double minY = min(y1(), yMid(), y2());
-    double yLeft = s.y + (y1() - minY) * s.z;
-    double yMidl = s.y + (yMid() - minY) * s.z;
-    double xMidl = s.x + (xMid() - xPos()) * s.z;
-    double yRight = s.y + (y2() - minY) * s.z;
-    double deltaY1 = (yMidl - yLeft);
-    double deltaY2 = (yRight - yMidl);
-    double deltaX1 = xMidl - s.x;
-    double deltaX2 = qRound(s.x + width() * s.z - xMidl);
-
-    // generate an array of points for the rounded slur using the exponent shape
-    QPoint points[21];
-    points[0] = QPoint(s.x, qRound(yLeft));
-    points[1] = QPoint(qRound(s.x + 0.1 * deltaX1), qRound(yLeft + deltaY1 * 0.34));
-    points[2] = QPoint(qRound(s.x + 0.2 * deltaX1), qRound(yLeft + deltaY1 * 0.53));
-    points[3] = QPoint(qRound(s.x + 0.3 * deltaX1), qRound(yLeft + deltaY1 * 0.71));
-    points[4] = QPoint(qRound(s.x + 0.4 * deltaX1), qRound(yLeft + deltaY1 * 0.79));
-    points[5] = QPoint(qRound(s.x + 0.5 * deltaX1), qRound(yLeft + deltaY1 * 0.86));
-    points[6] = QPoint(qRound(s.x + 0.6 * deltaX1), qRound(yLeft + deltaY1 * 0.90));
-    points[7] = QPoint(qRound(s.x + 0.7 * deltaX1), qRound(yLeft + deltaY1 * 0.94));
-    points[8] = QPoint(qRound(s.x + 0.8 * deltaX1), qRound(yLeft + deltaY1 * 0.95));
-    points[9] = QPoint(qRound(s.x + 0.9 * deltaX1), qRound(yLeft + deltaY1 * 0.97));
-    points[10] = QPoint(static_cast<int>(xMidl), qRound(yMidl + deltaY2 * 0.02));
-    points[11] = QPoint(qRound(xMidl + 0.1 * deltaX2), qRound(yMidl + deltaY2 * 0.03));
-    points[12] = QPoint(qRound(xMidl + 0.2 * deltaX2), qRound(yMidl + deltaY2 * 0.05));
-    points[13] = QPoint(qRound(xMidl + 0.3 * deltaX2), qRound(yMidl + deltaY2 * 0.06));
-    points[14] = QPoint(qRound(xMidl + 0.4 * deltaX2), qRound(yMidl + deltaY2 * 0.10));
-    points[15] = QPoint(qRound(xMidl + 0.5 * deltaX2), qRound(yMidl + deltaY2 * 0.14));
-    points[16] = QPoint(qRound(xMidl + 0.6 * deltaX2), qRound(yMidl + deltaY2 * 0.21));
-    points[17] = QPoint(qRound(xMidl + 0.7 * deltaX2), qRound(yMidl + deltaY2 * 0.29));
-    points[18] = QPoint(qRound(xMidl + 0.8 * deltaX2), qRound(yMidl + deltaY2 * 0.47));
-    points[19] = QPoint(qRound(xMidl + 0.9 * deltaX2), qRound(yMidl + deltaY2 * 0.66));
-    points[20] = QPoint(qRound(s.x + width() * s.z), static_cast<int>(yRight));
-
-    p->drawPolyline(points, 21);
+    QPointF points[SHAPE_POINTS];
+    for (int i = 0; i < SHAPE_POINTS; i++) {
+        points[i] = QPointF(s.x + _shape[i].x() * s.z, s.y + _shape[i].y() * s.z);
+    }
+
+    p->drawPolyline(points, SHAPE_POINTS);
 
     p->setRenderHint(QPainter::Antialiasing, aliasing);
 }
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -8,6 +8,8 @@
 #ifndef DRAWABLESLUR_H_
 #define DRAWABLESLUR_H_
 
+#include <QPointF>
+
 #include "layout/drawablemuselement.h"
 #include "score/slur.h"
 
@@ -59,6 +61,7 @@ public:
         _y2 = y2;
         updateGeometry();
     }
+    void moveXPos(double dx);
 
 private:
     void updateGeometry();
@@ -71,6 +74,9 @@ private:
     double _yMid;
     double _x2;
     double _y2;
+
+    static const int SHAPE_POINTS = 21;
+    QPointF _shape[SHAPE_POINTS]; // polyline of the slur in world coordinates relative to xPos() and yPos()
 };
 
 #endif /* DRAWABLESLUR_H_ */
@@ -6,7 +6,11 @@
 */
 
 #include <QDebug>
+#include <QLine>
 #include <QPainter>
+#include <QVarLengthArray>
+
+#include <algorithm>
 
 #include "layout/drawablebarline.h"
 #include "layout/drawableclef.h"
@@ -22,6 +26,44 @@
 
 const double CADrawableStaff::STAFFLINE_WIDTH = 0.8;
 
+namespace {
+
+/*!
+	Returns the index of the first element in the \a list sorted by X coordinates which is placed at
+	\a x or right of it.
+*/
+template <typename T>
+int lowerBound(const QList<T*>& list, double x)
+{
+    return static_cast<int>(std::lower_bound(list.constBegin(), list.constEnd(), x, [](T* a, double x) { return a->xPos() < x; }) - list.constBegin());
+}
+
+/*!
+	Inserts the element \a elt into the \a list sorted by X coordinates before the elements placed at
+	the same coordinate.
+*/
+template <typename T>
+void insertSorted(QList<T*>& list, T* elt)
+{
+    list.insert(lowerBound(list, elt->xPos()), elt);
+}
+
+/*!
+	Inserts the element \a elt into the \a list sorted by X coordinates after the elements placed at
+	the same coordinate. The list is searched from the end, because the elements are usually added
+	from left to right.
+*/
+template <typename T>
+void appendSorted(QList<T*>& list, T* elt)
+{
+    int i;
+    for (i = list.size() - 1; (i >= 0) && list[i]->xPos() > elt->xPos(); i--)
+        ;
+    list.insert(i + 1, elt);
+}
+
+}
+
 CADrawableStaff::CADrawableStaff(CAStaff* s, double x, double y)
     : CADrawableContext(s, x, y)
 {
@@ -38,10 +80,11 @@ void CADrawableStaff::draw(QPainter* p, const CADrawSettings s)
     pen.setColor(s.color);
     p->setPen(pen);
     double dy = lineSpace() * s.z;
+    QVarLengthArray<QLine, 8> lines;
     for (int i = 0; i < staff()->numberOfLines(); i++) {
-        p->drawLine(0, qRound(s.y + dy * i),
-            s.w, qRound(s.y + dy * i));
+        lines.append(QLine(0, qRound(s.y + dy * i), s.w, qRound(s.y + dy * i)));
     }
+    p->drawLines(lines.constData(), lines.size());
 }
 
 CADrawableStaff* CADrawableStaff::clone()
@@ -143,10 +186,7 @@ int CADrawableStaff::calculatePitch(double x, double y)
 */
 void CADrawableStaff::addClef(CADrawableClef* clef)
 {
-    int i;
-    for (i = 0; ((i < _drawableClefList.size()) && (clef->xPos() > _drawableClefList[i]->xPos())); i++)
-        ;
-    _drawableClefList.insert(i, clef);
+    insertSorted(_drawableClefList, clef);
 }
 
 /*!
@@ -163,11 +203,8 @@ bool CADrawableStaff::removeClef(CADrawableClef* clef)
 */
 CAClef* CADrawableStaff::getClef(double x)
 {
-    int i;
-    for (i = 0; ((i < _drawableClefList.size()) && (x > _drawableClefList[i]->xPos())); i++)
-        ;
-
-    return ((--i < 0) ? nullptr : _drawableClefList[i]->clef());
+    int i = lowerBound(_drawableClefList, x) - 1;
+    return ((i < 0) ? nullptr : _drawableClefList[i]->clef());
 }
 
 /*!
@@ -180,21 +217,18 @@ int CADrawableStaff::getAccs(double x, int pitch)
     CAKeySignature* key = getKeySignature(x);
 
     //find nearest left element
-    int i;
-    for (i = 0; i < _drawableMusElementList.size() && _drawableMusElementList[i]->xPos() < x; i++)
-        ;
-    i--;
+    int i = lowerBound(_drawableAccsLookupList, x) - 1;
 
-    while (i >= 0 && _drawableMusElementList[i]->drawableMusElementType() != CADrawableMusElement::DrawableBarline && _drawableMusElementList[i]->drawableMusElementType() != CADrawableMusElement::DrawableKeySignature && (!(_drawableMusElementList[i]->drawableMusElementType() == CADrawableMusElement::DrawableNote && (static_cast<CANote*>(_drawableMusElementList[i]->musElement())->diatonicPitch().noteName() == pitch)))) { // go back until the barline, key signature or note with accidentals is found
+    while (i >= 0 && _drawableAccsLookupList[i]->drawableMusElementType() == CADrawableMusElement::DrawableNote && static_cast<CANote*>(_drawableAccsLookupList[i]->musElement())->diatonicPitch().noteName() != pitch) { // go back until the barline, key signature or note with accidentals is found
         i--;
     }
 
     if (i == -1)
         return 0;
-    if (_drawableMusElementList[i]->drawableMusElementType() == CADrawableMusElement::DrawableBarline || _drawableMusElementList[i]->drawableMusElementType() == CADrawableMusElement::DrawableKeySignature)
+    if (_drawableAccsLookupList[i]->drawableMusElementType() == CADrawableMusElement::DrawableBarline || _drawableAccsLookupList[i]->drawableMusElementType() == CADrawableMusElement::DrawableKeySignature)
         return (key ? key->accidentals()[pitch < 0 ? 6 - (-pitch - 1) % 7 : pitch % 7] : 0); // watch: % operator with negative numbers is implementation dependent
     else // note before
-        return (static_cast<CANote*>(_drawableMusElementList[i]->musElement())->diatonicPitch().accs());
+        return (static_cast<CANote*>(_drawableAccsLookupList[i]->musElement())->diatonicPitch().accs());
 }
 
 /*!
@@ -202,10 +236,7 @@ int CADrawableStaff::getAccs(double x, int pitch)
 */
 void CADrawableStaff::addKeySignature(CADrawableKeySignature* keySig)
 {
-    int i;
-    for (i = 0; ((i < _drawableKeySignatureList.size()) && (keySig->xPos() > _drawableKeySignatureList[i]->xPos())); i++)
-        ;
-    _drawableKeySignatureList.insert(i, keySig);
+    insertSorted(_drawableKeySignatureList, keySig);
 }
 
 /*!
@@ -244,10 +275,7 @@ CABarline* CADrawableStaff::getBarline(double x)
 */
 void CADrawableStaff::addBarline(CADrawableBarline* barline)
 {
-    int i;
-    for (i = 0; ((i < _drawableBarlineList.size()) && (barline->xPos() > _drawableBarlineList[i]->xPos())); i++)
-        ;
-    _drawableBarlineList.insert(i, barline);
+    insertSorted(_drawableBarlineList, barline);
 }
 
 /*!
@@ -264,11 +292,8 @@ bool CADrawableStaff::removeBarline(CADrawableBarline* barline)
 */
 CAKeySignature* CADrawableStaff::getKeySignature(double x)
 {
-    int i;
-    for (i = 0; ((i < _drawableKeySignatureList.size()) && (x > _drawableKeySignatureList[i]->xPos())); i++)
-        ;
-
-    return ((--i < 0) ? nullptr : _drawableKeySignatureList[i]->keySignature());
+    int i = lowerBound(_drawableKeySignatureList, x) - 1;
+    return ((i < 0) ? nullptr : _drawableKeySignatureList[i]->keySignature());
 }
 
 /*!
@@ -276,10 +301,7 @@ CAKeySignature* CADrawableStaff::getKeySignature(double x)
 */
 void CADrawableStaff::addTimeSignature(CADrawableTimeSignature* timeSig)
 {
-    int i;
-    for (i = 0; ((i < _drawableTimeSignatureList.size()) && (timeSig->xPos() > _drawableTimeSignatureList[i]->xPos())); i++)
-        ;
-    _drawableTimeSignatureList.insert(i, timeSig);
+    insertSorted(_drawableTimeSignatureList, timeSig);
 }
 
 /*!
@@ -296,11 +318,8 @@ bool CADrawableStaff::removeTimeSignature(CADrawableTimeSignature* timeSig)
 */
 CATimeSignature* CADrawableStaff::getTimeSignature(double x)
 {
-    int i;
-    for (i = 0; ((i < _drawableTimeSignatureList.size()) && (x > _drawableTimeSignatureList[i]->xPos())); i++)
-        ;
-
-    return ((--i < 0) ? nullptr : _drawableTimeSignatureList[i]->timeSignature());
+    int i = lowerBound(_drawableTimeSignatureList, x) - 1;
+    return ((i < 0) ? nullptr : _drawableTimeSignatureList[i]->timeSignature());
 }
 
 void CADrawableStaff::addMElement(CADrawableMusElement* elt)
@@ -311,14 +330,18 @@ void CADrawableStaff::addMElement(CADrawableMusElement* elt)
         break;
     case CADrawableMusElement::DrawableKeySignature:
         addKeySignature(static_cast<CADrawableKeySignature*>(elt));
+        appendSorted(_drawableAccsLookupList, elt);
         break;
     case CADrawableMusElement::DrawableTimeSignature:
         addTimeSignature(static_cast<CADrawableTimeSignature*>(elt));
         break;
     case CADrawableMusElement::DrawableBarline:
         addBarline(static_cast<CADrawableBarline*>(elt));
+        appendSorted(_drawableAccsLookupList, elt);
         break;
     case CADrawableMusElement::DrawableNote:
+        appendSorted(_drawableAccsLookupList, elt);
+        break;
     case CADrawableMusElement::DrawableRest:
     case CADrawableMusElement::DrawableMidiNote:
     case CADrawableMusElement::DrawableAccidental:
@@ -336,6 +359,7 @@ void CADrawableStaff::addMElement(CADrawableMusElement* elt)
     }
 
     _drawableMusElementList << elt;
+    invalidateRangeIndex();
 }
 
 int CADrawableStaff::removeMElement(CADrawableMusElement* elt)
@@ -346,14 +370,20 @@ int CADrawableStaff::removeMElement(CADrawableMusElement* elt)
         break;
     case CADrawableMusElement::DrawableKeySignature:
         removeKeySignature(static_cast<CADrawableKeySignature*>(elt));
+        _drawableAccsLookupList.removeAll(elt);
         break;
     case CADrawableMusElement::DrawableTimeSignature:
         removeTimeSignature(static_cast<CADrawableTimeSignature*>(elt));
         break;
+    case CADrawableMusElement::DrawableBarline:
+        removeBarline(static_cast<CADrawableBarline*>(elt));
+        _drawableAccsLookupList.removeAll(elt);
+        break;
     case CADrawableMusElement::DrawableNote:
+        _drawableAccsLookupList.removeAll(elt);
+        break;
     case CADrawableMusElement::DrawableRest:
     case CADrawableMusElement::DrawableMidiNote:
-    case CADrawableMusElement::DrawableBarline:
     case CADrawableMusElement::DrawableAccidental:
     case CADrawableMusElement::DrawableSlur:
     case CADrawableMusElement::DrawableTuplet:
@@ -367,5 +397,31 @@ int CADrawableStaff::removeMElement(CADrawableMusElement* elt)
         break;
     }
 
+    invalidateRangeIndex();
     return _drawableMusElementList.removeAll(elt);
 }
+
+/*!
+	Removes all the drawable music elements \a elts from the staff and from the clef, key signature,
+	time signature, barline and accidentals look-up lists. The elements are not destroyed.
+*/
+void CADrawableStaff::removeMElements(const QSet<CADrawableMusElement*>& elts)
+{
+    for (int i = _drawableClefList.size() - 1; i >= 0; i--)
+        if (elts.contains(_drawableClefList[i]))
+            _drawableClefList.removeAt(i);
+    for (int i = _drawableKeySignatureList.size() - 1; i >= 0; i--)
+        if (elts.contains(_drawableKeySignatureList[i]))
+            _drawableKeySignatureList.removeAt(i);
+    for (int i = _drawableTimeSignatureList.size() - 1; i >= 0; i--)
+        if (elts.contains(_drawableTimeSignatureList[i]))
+            _drawableTimeSignatureList.removeAt(i);
+    for (int i = _drawableBarlineList.size() - 1; i >= 0; i--)
+        if (elts.contains(_drawableBarlineList[i]))
+            _drawableBarlineList.removeAt(i);
+    for (int i = _drawableAccsLookupList.size() - 1; i >= 0; i--)
+        if (elts.contains(_drawableAccsLookupList[i]))
+            _drawableAccsLookupList.removeAt(i);
+
+    CADrawableContext::removeMElements(elts);
+}
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2009, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -59,12 +59,14 @@ public:
     int getAccs(double x, int pitch);
     void addMElement(CADrawableMusElement* elt);
     int removeMElement(CADrawableMusElement* elt);
+    void removeMElements(const QSet<CADrawableMusElement*>& elts);
 
 private:
     QList<CADrawableClef*> _drawableClefList; // List of all the drawable clefs. Used for fast look-up with the given key - X-coordinate usually.
     QList<CADrawableKeySignature*> _drawableKeySignatureList; // List of all the drawable key signatures. Used for fast look-up with the given key - X-coordinate usually.
     QList<CADrawableTimeSignature*> _drawableTimeSignatureList; // List of all the drawable time signatures. Used for fast look-up with the given key - X-coordinate usually.
     QList<CADrawableBarline*> _drawableBarlineList; // List of all the barlines. Used for fast look-up with the given key - X-coordinate usually.
+    QList<CADrawableMusElement*> _drawableAccsLookupList; // Notes, barlines and key signatures sorted by X-coordinate. Used by getAccs().
     static const double STAFFLINE_WIDTH; // Width of the staffs' lines. Defined in drawablestaff.cpp
 };
 
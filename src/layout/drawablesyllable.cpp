@@ -7,11 +7,12 @@
 
 #include "layout/drawablesyllable.h"
 #include "layout/drawablelyricscontext.h"
+#include "layout/fontcache.h"
+#include "layout/textmetrics.h"
 
 #include "score/lyricscontext.h"
 
 #include <QFont>
-#include <QFontMetrics>
 #include <QPainter>
 
 const double CADrawableSyllable::DEFAULT_TEXT_SIZE = 16;
@@ -21,14 +22,8 @@ CADrawableSyllable::CADrawableSyllable(CASyllable* s, CADrawableLyricsContext* c
     : CADrawableMusElement(s, c, x, y)
 {
     setDrawableMusElementType(DrawableSyllable);
-    QFont font("Century Schoolbook L");
-    font.setPixelSize(qRound(DEFAULT_TEXT_SIZE));
-    QFontMetrics fm(font);
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 11, 0))
-    int textWidth = fm.horizontalAdvance(textToDrawableText(s->text()));
-#else
-    int textWidth = fm.width(textToDrawableText(s->text()));
-#endif
+    QFont font = CAFontCache::font(CAFontCache::CenturySchoolbook, qRound(DEFAULT_TEXT_SIZE));
+    int textWidth = CATextMetrics::width(font, textToDrawableText(s->text()));
     setWidth(textWidth < 11 ? 11 : textWidth); // set minimum text width at least 11 points
     setHeight(qRound(DEFAULT_TEXT_SIZE));
 }
@@ -43,16 +38,11 @@ void CADrawableSyllable::draw(QPainter* p, const CADrawSettings s)
     pen.setWidth(qRound(1.2 * s.z));
     pen.setCapStyle(Qt::RoundCap);
     p->setPen(pen);
-    QFont font("Century Schoolbook L");
-    font.setPixelSize(qRound(DEFAULT_TEXT_SIZE * s.z));
+    QFont font = CAFontCache::font(CAFontCache::CenturySchoolbook, qRound(DEFAULT_TEXT_SIZE * s.z));
     p->setFont(font);
     p->drawText(s.x, s.y + qRound(height() * s.z), textToDrawableText(syllable()->text()));
 
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 11, 0))
-    int textWidth = QFontMetrics(font).horizontalAdvance(textToDrawableText(syllable()->text()));
-#else
-    int textWidth = QFontMetrics(font).width(textToDrawableText(syllable()->text()));
-#endif
+    int textWidth = CATextMetrics::width(font, textToDrawableText(syllable()->text()));
     if (syllable()->hyphenStart() && (width() * s.z - textWidth) > qRound(DEFAULT_DASH_LENGTH * s.z)) {
         p->drawLine(qRound(s.x + width() * s.z * 0.5 + 0.5 * textWidth - 0.5 * s.z * DEFAULT_DASH_LENGTH), s.y + qRound(height() * s.z * 0.7),
             qRound(s.x + width() * s.z * 0.5 + 0.5 * textWidth + 0.5 * s.z * DEFAULT_DASH_LENGTH), s.y + qRound(height() * s.z * 0.7));
@@ -19,6 +19,7 @@ public:
     CADrawableSyllable(CASyllable*, CADrawableLyricsContext*, double x, double y);
     ~CADrawableSyllable();
     void draw(QPainter* p, const CADrawSettings s);
+    double minLegibleZoom() const { return 0.5; }
     CADrawableSyllable* clone(CADrawableContext* c = nullptr);
 
     CASyllable* syllable() { return static_cast<CASyllable*>(musElement()); }
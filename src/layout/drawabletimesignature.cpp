@@ -7,6 +7,9 @@
 
 #include "layout/drawabletimesignature.h"
 #include "layout/drawablestaff.h"
+#include "layout/feta.h"
+#include "layout/fontcache.h"
+#include "layout/glyphcache.h"
 #include "score/timesignature.h"
 
 #include <QDebug>
@@ -47,8 +50,7 @@ CADrawableTimeSignature::~CADrawableTimeSignature()
 
 void CADrawableTimeSignature::draw(QPainter* p, CADrawSettings s)
 {
-    QFont font("Emmentaler");
-    font.setPixelSize(qRound(37 * s.z));
+    QFont font = CAFontCache::font(CAFontCache::Emmentaler, qRound(37 * s.z));
     p->setPen(QPen(s.color));
     p->setFont(font);
 
@@ -64,10 +66,10 @@ void CADrawableTimeSignature::draw(QPainter* p, CADrawSettings s)
         // Draw C or C|, if needed.
         if (timeSignature()->timeSignatureType() == CATimeSignature::Classical) {
             if ((timeSignature()->beat() == 4) && (timeSignature()->beats() == 4)) {
-                p->drawText(s.x, qRound(s.y + 0.5 * height() * s.z), QString(CACanorus::fetaCodepoint("timesig.C44")));
+                CAGlyphCache::drawGlyph(p, s.x, qRound(s.y + 0.5 * height() * s.z), CAFeta::codepoint(CAFeta::timesig_C44));
                 break;
             } else if ((timeSignature()->beat() == 2) && (timeSignature()->beats() == 2)) {
-                p->drawText(s.x, qRound(s.y + 0.5 * height() * s.z), QString(CACanorus::fetaCodepoint("timesig.C22")));
+                CAGlyphCache::drawGlyph(p, s.x, qRound(s.y + 0.5 * height() * s.z), CAFeta::codepoint(CAFeta::timesig_C22));
                 break;
             }
         }
@@ -7,24 +7,82 @@
 
 #include "layout/drawabletuplet.h"
 #include "layout/drawablecontext.h"
+#include "layout/fontcache.h"
 #include <QFont>
 #include <QPainter>
 #include <QPen>
 
+const int CADrawableTuplet::BRACKET_POINTS;
+
 CADrawableTuplet::CADrawableTuplet(CATuplet* tuplet, CADrawableContext* c, double x1, double y1, double x2, double y2)
     : CADrawableMusElement(tuplet, c, x1, 0)
+    , _x1(x1)
+    , _x2(x2)
+    , _y1(y1)
+    , _y2(y2)
 {
     setDrawableMusElementType(DrawableTuplet);
 
     setWidth(x2 - x1);
     setHeight((abs(y2 - y1) > 5) ? abs(y2 - y1) : 8);
     setYPos((c && qMin(y1, y2) > c->yPos()) ? qMin(y1, y2) : (qMin(y1, y2) - height()));
+    updateBracket();
 }
 
 CADrawableTuplet::~CADrawableTuplet()
 {
 }
 
+/*!
+	Moves the tuplet together with its end points horizontally by \a dx. The bracket is relative to
+	the tuplet and isn't recomputed.
+*/
+void CADrawableTuplet::moveXPos(double dx)
+{
+    _x1 += dx;
+    _x2 += dx;
+    setXPos(xPos() + dx);
+}
+
+/*!
+	Returns True, if the bracket of this drawable tuplet would be the same for the given \a tuplet
+	in the context \a c with the end points \a x1, \a y1, \a x2 and \a y2, only shifted
+	horizontally. The layout engine then moves this drawable instead of creating a new one.
+*/
+bool CADrawableTuplet::hasBracket(CATuplet* tuplet, CADrawableContext* c, double x1, double y1, double x2, double y2)
+{
+    return musElement() == tuplet && drawableContext() == c && _number == tuplet->number() && _x2 - _x1 == x2 - x1 && _y1 == y1 && _y2 == y2;
+}
+
+/*!
+	Computes the bracket and the position of the number in world units. Called once per drawable
+	tuplet, drawing only scales the points.
+*/
+void CADrawableTuplet::updateBracket()
+{
+    static const double shape[2][BRACKET_POINTS] = {
+        { 0, 0.34, 0.53, 0.71, 0.79, 0.86, 0.90, 0.94, 0.95 },
+        { 0.05, 0.06, 0.10, 0.14, 0.21, 0.29, 0.47, 0.66, 1 }
+    };
+
+    _number = tuplet()->number();
+
+    double minY = yPos() - 8;
+    double yLeft = yPos() - minY;
+    double yMidl = yPos() - minY;
+    double yRight = yPos() - minY;
+    double xMidl = width() / 2.0;
+
+    // the rounded slur using the exponent shape
+    for (int i = 0; i < BRACKET_POINTS; i++) {
+        _bracket[0][i] = QPointF(0.1 * i * xMidl, yLeft + (yMidl - yLeft) * shape[0][i]);
+        _bracket[1][i] = QPointF(xMidl + 0.1 * (i + 2) * (width() - xMidl), yMidl + (yRight - yMidl) * shape[1][i]);
+    }
+    _bracket[1][BRACKET_POINTS - 1].setX(width());
+
+    _numberPos = QPointF(width() / 2.0 - 3, height() / 2.0 + 9);
+}
+
 void CADrawableTuplet::draw(QPainter* p, const CADrawSettings s)
 {
     QPen pen(s.color);
@@ -32,45 +90,17 @@ void CADrawableTuplet::draw(QPainter* p, const CADrawSettings s)
     pen.setCapStyle(Qt::RoundCap);
     p->setPen(pen);
 
-    double minY = qMin(yPos(), yPos()) - 8;
-    double yLeft = s.y + (yPos() - minY) * s.z;
-    double yMidl = s.y + (yPos() - minY) * s.z;
-    double xMidl = s.x + (width() / 2.0) * s.z;
-    double yRight = s.y + (yPos() - minY) * s.z;
-    double deltaY1 = yMidl - yLeft;
-    double deltaY2 = yRight - yMidl;
-    double deltaX1 = xMidl - s.x;
-    double deltaX2 = s.x + width() * s.z - xMidl;
-
-    // generate an array of points for the rounded slur using the exponent shape
-    QPoint points[9];
-    points[0] = QPoint(s.x, qRound(yLeft));
-    points[1] = QPoint(qRound(s.x + 0.1 * deltaX1), qRound(yLeft + deltaY1 * 0.34));
-    points[2] = QPoint(qRound(s.x + 0.2 * deltaX1), qRound(yLeft + deltaY1 * 0.53));
-    points[3] = QPoint(qRound(s.x + 0.3 * deltaX1), qRound(yLeft + deltaY1 * 0.71));
-    points[4] = QPoint(qRound(s.x + 0.4 * deltaX1), qRound(yLeft + deltaY1 * 0.79));
-    points[5] = QPoint(qRound(s.x + 0.5 * deltaX1), qRound(yLeft + deltaY1 * 0.86));
-    points[6] = QPoint(qRound(s.x + 0.6 * deltaX1), qRound(yLeft + deltaY1 * 0.90));
-    points[7] = QPoint(qRound(s.x + 0.7 * deltaX1), qRound(yLeft + deltaY1 * 0.94));
-    points[8] = QPoint(qRound(s.x + 0.8 * deltaX1), qRound(yLeft + deltaY1 * 0.95));
-    p->drawPolyline(points, 9);
-
-    points[0] = QPoint(qRound(xMidl + 0.2 * deltaX2), qRound(yMidl + deltaY2 * 0.05));
-    points[1] = QPoint(qRound(xMidl + 0.3 * deltaX2), qRound(yMidl + deltaY2 * 0.06));
-    points[2] = QPoint(qRound(xMidl + 0.4 * deltaX2), qRound(yMidl + deltaY2 * 0.10));
-    points[3] = QPoint(qRound(xMidl + 0.5 * deltaX2), qRound(yMidl + deltaY2 * 0.14));
-    points[4] = QPoint(qRound(xMidl + 0.6 * deltaX2), qRound(yMidl + deltaY2 * 0.21));
-    points[5] = QPoint(qRound(xMidl + 0.7 * deltaX2), qRound(yMidl + deltaY2 * 0.29));
-    points[6] = QPoint(qRound(xMidl + 0.8 * deltaX2), qRound(yMidl + deltaY2 * 0.47));
-    points[7] = QPoint(qRound(xMidl + 0.9 * deltaX2), qRound(yMidl + deltaY2 * 0.66));
-    points[8] = QPoint(qRound(s.x + width() * s.z), static_cast<int>(yRight));
-    p->drawPolyline(points, 9);
-
-    QFont font("Emmentaler");
-    font.setPixelSize(qRound(16 * 1.3 * s.z));
-    font.setItalic(true);
+    QPoint points[BRACKET_POINTS];
+    for (int h = 0; h < 2; h++) {
+        for (int i = 0; i < BRACKET_POINTS; i++) {
+            points[i] = QPoint(s.x + qRound(_bracket[h][i].x() * s.z), s.y + qRound(_bracket[h][i].y() * s.z));
+        }
+        p->drawPolyline(points, BRACKET_POINTS);
+    }
+
+    QFont font = CAFontCache::font(CAFontCache::Emmentaler, qRound(16 * 1.3 * s.z), CAFontCache::Italic);
     p->setFont(font);
-    p->drawText(s.x + qRound((width() / 2.0 - 3) * s.z), s.y + qRound((height() / 2.0 + 9) * s.z), QString::number(tuplet()->number()));
+    p->drawText(s.x + qRound(_numberPos.x() * s.z), s.y + qRound(_numberPos.y() * s.z), QString::number(_number));
 }
 
 CADrawableTuplet* CADrawableTuplet::clone(CADrawableContext* newContext)
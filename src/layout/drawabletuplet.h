@@ -8,6 +8,8 @@
 #ifndef DRAWABLETUPLET_H_
 #define DRAWABLETUPLET_H_
 
+#include <QPointF>
+
 #include "layout/drawablemuselement.h"
 #include "score/tuplet.h"
 
@@ -29,12 +31,22 @@ public:
     inline void setY1(double y1) { _y1 = y1; }
     inline void setX2(double x2) { _x2 = x2; }
     inline void setY2(double y2) { _y2 = y2; }
+    void moveXPos(double dx);
+
+    bool hasBracket(CATuplet* tuplet, CADrawableContext* c, double x1, double y1, double x2, double y2);
+
+    static const int BRACKET_POINTS = 9; // points of each half of the bracket
 
 private:
+    void updateBracket();
+
     double _x1;
     double _x2;
     double _y1;
     double _y2;
+    int _number; // tuplet number when the bracket was computed
+    QPointF _bracket[2][BRACKET_POINTS]; // both halves of the bracket relative to the top-left corner
+    QPointF _numberPos; // baseline of the number relative to the top-left corner
 };
 
 #endif /* DRAWABLETUPLET_H_ */
@@ -0,0 +1,68 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QHash>
+
+#include "layout/feta.h"
+
+namespace {
+
+const char* const NAMES[CAFeta::GlyphCount] = {
+#define CA_FETA_GLYPH(id, name, codepoint) name,
+#include "fonts/fetaList.cxx"
+#undef CA_FETA_GLYPH
+};
+
+}
+
+constexpr int CAFeta::CODEPOINTS[];
+
+/*!
+	\class CAFeta
+	\brief Glyphs of the Feta (Emmentaler) font
+
+	The glyph list fonts/fetaList.cxx generated from the font is expanded into the CAFetaGlyph
+	enum and a table of codepoints at compile time, so the drawables resolve their glyphs by
+	codepoint(CAFetaGlyph) without any lookups:
+	\code
+	  CAGlyphCache::drawGlyph(p, x, y, CAFeta::codepoint(CAFeta::clefs_G));
+	\endcode
+
+	The id of a glyph is its name with the dots replaced by underscores. The glyphs can also be
+	looked up by their names, which is meant for the scripting and plugins only.
+*/
+
+/*!
+	\fn int CAFeta::codepoint(CAFetaGlyph glyph)
+	Returns the codepoint of the given \a glyph in the Emmentaler font.
+*/
+
+/*!
+	Returns the codepoint of the glyph with the given \a name (eg. "noteheads.s2") or 0, if there
+	is no such glyph. The name index is built on the first call.
+*/
+int CAFeta::codepoint(const QString& name)
+{
+    static const QHash<QString, int> codepoints = [] {
+        QHash<QString, int> hash;
+        hash.reserve(GlyphCount);
+        for (int i = 0; i < GlyphCount; i++) {
+            hash.insert(QString::fromLatin1(NAMES[i]), CODEPOINTS[i]);
+        }
+        return hash;
+    }();
+
+    return codepoints.value(name);
+}
+
+/*!
+	Returns the name of the \a glyph as used by the font, eg. "noteheads.s2".
+*/
+const char* CAFeta::name(CAFetaGlyph glyph)
+{
+    return NAMES[glyph];
+}
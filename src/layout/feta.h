@@ -0,0 +1,34 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef FETA_H_
+#define FETA_H_
+
+#include <QString>
+
+class CAFeta {
+public:
+    enum CAFetaGlyph {
+#define CA_FETA_GLYPH(id, name, codepoint) id,
+#include "fonts/fetaList.cxx"
+#undef CA_FETA_GLYPH
+        GlyphCount
+    };
+
+    static constexpr int codepoint(CAFetaGlyph glyph) { return CODEPOINTS[glyph]; }
+    static int codepoint(const QString& name);
+    static const char* name(CAFetaGlyph glyph);
+
+private:
+    static constexpr int CODEPOINTS[GlyphCount] = {
+#define CA_FETA_GLYPH(id, name, codepoint) codepoint,
+#include "fonts/fetaList.cxx"
+#undef CA_FETA_GLYPH
+    };
+};
+
+#endif /* FETA_H_ */
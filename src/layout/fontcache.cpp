@@ -0,0 +1,120 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QFileInfo>
+#include <QFontDatabase>
+#include <QMutexLocker>
+#include <QStringList>
+
+#include "layout/fontcache.h"
+
+const int CAFontCache::MAX_FONTS = 512;
+
+QMutex CAFontCache::_mutex;
+QCache<quint32, QFont> CAFontCache::_fonts(CAFontCache::MAX_FONTS);
+bool CAFontCache::_registered[CAFontCache::FamilyCount] = {};
+
+namespace {
+
+const char* const FAMILY_NAMES[CAFontCache::FamilyCount] = { "Emmentaler", "Century Schoolbook L", "FreeSans" };
+
+}
+
+/*!
+	\class CAFontCache
+	\brief Bundled fonts shared by all the drawables and views
+
+	Constructing a QFont by its family name and matching it to the font files each time an element
+	is drawn or measured is expensive. The font cache hands out the fonts of the bundled families
+	resolved once per family, style and pixel size (which changes with the zoom level), while the
+	returned copies share the same font data:
+	\code
+	  p->setFont(CAFontCache::font(CAFontCache::Emmentaler, qRound(35 * s.z)));
+	\endcode
+
+	The font files of a family are added to the application font database when the family is used
+	for the first time, so they are not loaded at startup.
+*/
+
+/*!
+	Returns the font of the given \a family, \a pixelSize and \a style, a combination of
+	CAFontStyle flags.
+*/
+QFont CAFontCache::font(CAFontFamily family, int pixelSize, int style)
+{
+    quint32 key = (static_cast<quint32>(pixelSize) << 4) | (static_cast<quint32>(style) << 2) | static_cast<quint32>(family);
+
+    QMutexLocker locker(&_mutex);
+    QFont* font = _fonts.object(key);
+    if (!font) {
+        registerFamily(family);
+
+        /// \todo replace raw pointer with shared or unique pointer
+        font = new QFont(QString::fromLatin1(FAMILY_NAMES[family]));
+        font->setPixelSize(pixelSize);
+        font->setBold(style & Bold);
+        font->setItalic(style & Italic);
+        _fonts.insert(key, font);
+    }
+
+    return *font;
+}
+
+/*!
+	Returns the name of the font \a family. The family is registered, so the name can be used for
+	fonts given in points, eg. for the text editing widgets.
+*/
+QString CAFontCache::family(CAFontFamily family)
+{
+    QMutexLocker locker(&_mutex);
+    registerFamily(family);
+    return QString::fromLatin1(FAMILY_NAMES[family]);
+}
+
+/*!
+	Forgets all the cached fonts. The families stay registered.
+*/
+void CAFontCache::clear()
+{
+    QMutexLocker locker(&_mutex);
+    _fonts.clear();
+}
+
+/*!
+	Adds the bundled files of the font \a family to the application font database, if not added
+	yet. Called with _mutex locked.
+*/
+void CAFontCache::registerFamily(CAFontFamily family)
+{
+    if (_registered[family]) {
+        return;
+    }
+    _registered[family] = true;
+
+    QStringList files;
+    switch (family) {
+    case Emmentaler:
+        files << "Emmentaler-14.ttf";
+        break;
+    case CenturySchoolbook:
+        files << "CenturySchL-Roma.ttf"
+              << "CenturySchL-Ital.ttf"
+              << "CenturySchL-Bold.ttf"
+              << "CenturySchL-BoldItal.ttf";
+        break;
+    case FreeSans:
+        files << "FreeSans.ttf";
+        break;
+    case FamilyCount:
+        break;
+    }
+
+    // addApplicationFont doesn't understand prefix: paths.
+    for (const QString& file : files) {
+        QFontDatabase::addApplicationFont(QFileInfo("fonts:" + file).absoluteFilePath());
+    }
+}
@@ -0,0 +1,45 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef FONTCACHE_H_
+#define FONTCACHE_H_
+
+#include <QCache>
+#include <QFont>
+#include <QMutex>
+#include <QString>
+
+class CAFontCache {
+public:
+    enum CAFontFamily {
+        Emmentaler, // music symbols
+        CenturySchoolbook, // numbers, lyrics and chord names
+        FreeSans, // texts and function marks
+        FamilyCount
+    };
+
+    enum CAFontStyle {
+        Regular = 0,
+        Bold = 1,
+        Italic = 2
+    };
+
+    static QFont font(CAFontFamily family, int pixelSize, int style = Regular);
+    static QString family(CAFontFamily family);
+    static void clear();
+
+private:
+    static const int MAX_FONTS;
+
+    static void registerFamily(CAFontFamily family);
+
+    static QMutex _mutex;
+    static QCache<quint32, QFont> _fonts; // fonts indexed by family, style and pixel size
+    static bool _registered[FamilyCount]; // bundled font files of the family were added to the font database
+};
+
+#endif /* FONTCACHE_H_ */
@@ -0,0 +1,59 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QMutexLocker>
+#include <QPainter>
+
+#include "layout/glyphcache.h"
+
+const int CAGlyphCache::MAX_GLYPHS = 2048;
+
+QMutex CAGlyphCache::_mutex;
+QCache<quint64, QPainterPath> CAGlyphCache::_glyphs(CAGlyphCache::MAX_GLYPHS);
+
+/*!
+	\class CAGlyphCache
+	\brief Cache of Emmentaler glyph outlines
+
+	Drawing a music symbol with QPainter::drawText() shapes the text every time the symbol is
+	painted. The glyph cache converts each Feta glyph to a QPainterPath once per font pixel size
+	(which changes with the zoom level) and fills the cached outline afterwards.
+
+	Codepoints are usually resolved by CAFeta::codepoint() when the drawable element is created.
+*/
+
+/*!
+	Draws the glyph with the given \a codepoint using the current font and pen color of the
+	painter \a p. \a x and \a y are the coordinates of the glyph baseline, the same as in
+	QPainter::drawText().
+*/
+void CAGlyphCache::drawGlyph(QPainter* p, qreal x, qreal y, int codepoint)
+{
+    quint64 key = (static_cast<quint64>(static_cast<quint32>(codepoint)) << 32) | static_cast<quint32>(p->font().pixelSize());
+
+    QMutexLocker locker(&_mutex);
+    QPainterPath* path = _glyphs.object(key);
+    if (!path) {
+        /// \todo replace raw pointer with shared or unique pointer
+        path = new QPainterPath();
+        path->addText(0, 0, p->font(), QString(QChar(codepoint)));
+        _glyphs.insert(key, path);
+    }
+
+    p->translate(x, y);
+    p->fillPath(*path, p->pen().color());
+    p->translate(-x, -y);
+}
+
+/*!
+	Forgets all the cached glyph outlines, for example when the font is reloaded.
+*/
+void CAGlyphCache::clear()
+{
+    QMutexLocker locker(&_mutex);
+    _glyphs.clear();
+}
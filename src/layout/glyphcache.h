@@ -0,0 +1,29 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef GLYPHCACHE_H_
+#define GLYPHCACHE_H_
+
+#include <QCache>
+#include <QMutex>
+#include <QPainterPath>
+
+class QPainter;
+
+class CAGlyphCache {
+public:
+    static void drawGlyph(QPainter* p, qreal x, qreal y, int codepoint);
+    static void clear();
+
+private:
+    static const int MAX_GLYPHS;
+
+    static QMutex _mutex;
+    static QCache<quint64, QPainterPath> _glyphs; // glyph outlines indexed by codepoint and pixel size
+};
+
+#endif /* GLYPHCACHE_H_ */
@@ -8,8 +8,12 @@
 #ifndef KDTREE_H
 #define KDTREE_H
 
+#include <QHash>
 #include <QMultiMap>
 #include <QRect>
+#include <QSet>
+#include <algorithm>
+#include <cmath>
 #include <iostream> // debugging
 #include <limits> // max double for managing staffs with unlimited width
 
@@ -27,10 +31,17 @@
 	\brief Space partitioning structure for fast access to drawable elements on canvas
 
 	This class is a data structure focused on efficient access to the drawable
-	instances of the music elements. It is based on an interval tree and employs
-	multiple QMap instances to enable efficient query of elements in the given
-	interval, finding the next element in the same staff and mapping a music
-	element to one or more drawable instances.
+	instances of the music elements. Elements are indexed in multiple ways:
+	- QMultiMap instances sorted by x, x+width, y and y+height are used for finding
+	  the nearest element in the given direction and for the total dimensions.
+	- A uniform grid of buckets in world coordinates is used for querying elements in
+	  the given rectangular area. Elements with unlimited width or height (eg. contexts
+	  and helper lines) and very large elements are stored separately and tested on each
+	  query.
+
+	The grid is updated lazily on the first query after the elements were added. This way
+	adding all the elements of the score when repositing them is a bulk-load and the
+	elements can still change their dimensions until they are queried for the first time.
 
 	\sa CAScoreView, CADrawable
 */
@@ -42,6 +53,8 @@ public:
 
     void addElement(T elt);
     T removeElement(double x, double y);
+    bool removeElement(T elt);
+    QList<T> takeFrom(double x);
 
     QList<T> findInRange(double x, double y, double w = 0, double h = 0);
     QList<T> findInRange(QRect& area);
@@ -58,14 +71,42 @@ public:
     QList<T> list() { return _mapX.values(); }
 
 private:
+    enum {
+        CellSize = 128, // width and height of a grid cell in world coordinates
+        MaxCells = 64 // elements covering more cells are not stored in the grid
+    };
+
+    struct CAKDTreeEntry {
+        double x, xw, y, yh; // keys used in the maps when the element was added
+        int serial; // order of additions
+        bool indexed; // the element is stored in the grid or the unbounded list
+        bool unbounded; // the element is stored in the unbounded list
+        int cx1, cy1, cx2, cy2; // grid cells the element is stored in
+    };
+
     //////////////////////
     // Basic properties //
     //////////////////////
     QMultiMap<double, T> _mapX; // List of all the drawable elements sorted by xPos()
     QMultiMap<double, T> _mapXW; // List of all the drawable elements sorted by xPos()+width()
-    double _maxY; // The largest Ypos()+height() value of any element
-
-    void calculateMaxY();
+    QMultiMap<double, T> _mapY; // List of all the drawable elements sorted by yPos()
+    QMultiMap<double, T> _mapYH; // List of all the drawable elements sorted by yPos()+height()
+    QHash<T, CAKDTreeEntry> _entries;
+    int _serial;
+
+    ///////////////////
+    // Spatial index //
+    ///////////////////
+    QHash<quint64, QList<T>> _grid; // elements in each grid cell
+    QList<T> _unbounded; // elements with unlimited width or height or spanning too many cells
+    QList<T> _pending; // elements added after the last query, not yet in the grid
+
+    inline static int cell(double c) { return static_cast<int>(std::floor(std::max(-1e9, std::min(1e9, c / CellSize)))); }
+    inline static quint64 cellKey(int cx, int cy) { return (static_cast<quint64>(static_cast<quint32>(cx)) << 32) | static_cast<quint32>(cy); }
+    static void removeFromMap(QMultiMap<double, T>& map, double key, T elt);
+    void indexPending();
+    void removeFromIndex(T elt, const CAKDTreeEntry& entry);
+    bool overlaps(T elt, double x, double y, double w, double h);
 };
 
 /*!
@@ -74,28 +115,182 @@ private:
 template <typename T>
 CAKDTree<T>::CAKDTree()
 {
-    _maxY = 0;
+    _serial = 0;
 }
 
 /*!
 	Adds a drawable element \a elt to the tree.
+	The element is put into the grid on the next query.
 */
 template <typename T>
 void CAKDTree<T>::addElement(T elt)
 {
-    _mapX.insertMulti(elt->xPos(), elt);
+    CAKDTreeEntry entry;
+    entry.x = elt->xPos();
+    // music elements with unlimited width (e.g. staffs) are sorted at the end
+    entry.xw = elt->width() ? (elt->xPos() + elt->width()) : std::numeric_limits<double>::max();
+    entry.y = elt->yPos();
+    entry.yh = elt->yPos() + elt->height();
+    entry.serial = _serial++;
+    entry.indexed = false;
+    entry.unbounded = false;
+    entry.cx1 = entry.cy1 = entry.cx2 = entry.cy2 = 0;
+
+    _mapX.insertMulti(entry.x, elt);
+    _mapXW.insertMulti(entry.xw, elt);
+    _mapY.insertMulti(entry.y, elt);
+    _mapYH.insertMulti(entry.yh, elt);
+    _entries.insert(elt, entry);
+    _pending << elt;
+}
+
+/*!
+	Removes the given element \a elt from the tree without destroying it.
+	Returns True, if the element was found, False otherwise.
+*/
+template <typename T>
+bool CAKDTree<T>::removeElement(T elt)
+{
+    typename QHash<T, CAKDTreeEntry>::iterator it = _entries.find(elt);
+    if (it == _entries.end()) {
+        return false;
+    }
+
+    CAKDTreeEntry entry = it.value();
+    _entries.erase(it);
+
+    removeFromMap(_mapX, entry.x, elt);
+    removeFromIndex(elt, entry);
+
+    return true;
+}
+
+/*!
+	Removes all the elements which were added at the horizontal coordinate \a x or right of it
+	and returns them sorted by their x coordinate. The elements are not destroyed.
+
+	This is used by the incremental layout to detach the part of the score which needs to be
+	re-engraved or shifted.
+*/
+template <typename T>
+QList<T> CAKDTree<T>::takeFrom(double x)
+{
+    QList<T> l;
+
+    typename QMultiMap<double, T>::iterator it = _mapX.lowerBound(x);
+    while (it != _mapX.end()) {
+        T elt = it.value();
+        l << elt;
+        it = _mapX.erase(it);
+
+        typename QHash<T, CAKDTreeEntry>::iterator entryIt = _entries.find(elt);
+        if (entryIt != _entries.end()) {
+            CAKDTreeEntry entry = entryIt.value();
+            _entries.erase(entryIt);
+            removeFromIndex(elt, entry);
+        }
+    }
+
+    return l;
+}
+
+/*!
+	Removes the \a elt stored under the given \a key from the \a map.
+*/
+template <typename T>
+void CAKDTree<T>::removeFromMap(QMultiMap<double, T>& map, double key, T elt)
+{
+    for (typename QMultiMap<double, T>::iterator it = map.find(key); it != map.end() && it.key() == key; it++) {
+        if (it.value() == elt) {
+            map.erase(it);
+            return;
+        }
+    }
+}
 
-    if (elt->width()) {
-        // regular music element
-        _mapXW.insertMulti(elt->xPos() + elt->width(), elt);
+/*!
+	Removes the \a elt from all the maps except the x-sorted one and from the grid.
+	The \a entry holds the keys used when adding the element.
+*/
+template <typename T>
+void CAKDTree<T>::removeFromIndex(T elt, const CAKDTreeEntry& entry)
+{
+    removeFromMap(_mapXW, entry.xw, elt);
+    removeFromMap(_mapY, entry.y, elt);
+    removeFromMap(_mapYH, entry.yh, elt);
+
+    if (!entry.indexed) {
+        _pending.removeOne(elt);
+    } else if (entry.unbounded) {
+        _unbounded.removeOne(elt);
     } else {
-        // music element with unlimited width (e.g. staffs)
-        _mapXW.insertMulti(std::numeric_limits<double>::max(), elt);
+        for (int cx = entry.cx1; cx <= entry.cx2; cx++) {
+            for (int cy = entry.cy1; cy <= entry.cy2; cy++) {
+                typename QHash<quint64, QList<T>>::iterator cellIt = _grid.find(cellKey(cx, cy));
+                if (cellIt != _grid.end()) {
+                    cellIt.value().removeOne(elt);
+                    if (cellIt.value().isEmpty()) {
+                        _grid.erase(cellIt);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*!
+	Puts the elements added since the last query into the grid according to their current
+	dimensions.
+*/
+template <typename T>
+void CAKDTree<T>::indexPending()
+{
+    for (int i = 0; i < _pending.size(); i++) {
+        T elt = _pending[i];
+        CAKDTreeEntry& entry = _entries[elt];
+        entry.indexed = true;
+
+        if (!elt->width() || !elt->height()) {
+            entry.unbounded = true;
+        } else {
+            entry.cx1 = cell(elt->xPos());
+            entry.cx2 = cell(elt->xPos() + elt->width());
+            entry.cy1 = cell(elt->yPos());
+            entry.cy2 = cell(elt->yPos() + elt->height());
+            entry.unbounded = ((static_cast<qint64>(entry.cx2) - entry.cx1 + 1) * (static_cast<qint64>(entry.cy2) - entry.cy1 + 1) > MaxCells);
+        }
+
+        if (entry.unbounded) {
+            _unbounded << elt;
+        } else {
+            for (int cx = entry.cx1; cx <= entry.cx2; cx++) {
+                for (int cy = entry.cy1; cy <= entry.cy2; cy++) {
+                    _grid[cellKey(cx, cy)] << elt;
+                }
+            }
+        }
+    }
+
+    _pending.clear();
+}
+
+/*!
+	Returns True, if the element \a elt touches the given rectangular area.
+	Elements with zero width are unlimited in width and elements with zero height are unlimited
+	in height.
+*/
+template <typename T>
+bool CAKDTree<T>::overlaps(T elt, double x, double y, double w, double h)
+{
+    if (elt->width() && (elt->xPos() > x + w || elt->xPos() + elt->width() < x)) {
+        return false;
     }
 
-    if (elt->yPos() + elt->height() > _maxY) {
-        _maxY = elt->yPos() + elt->height();
+    if (elt->height() && (elt->yPos() > y + h || elt->yPos() + elt->height() < y)) {
+        return false;
     }
+
+    return true;
 }
 
 /*!
@@ -113,31 +308,72 @@ void CAKDTree<T>::clear(bool autoDelete)
 
     _mapX.clear();
     _mapXW.clear();
-
-    _maxY = 0;
+    _mapY.clear();
+    _mapYH.clear();
+    _entries.clear();
+    _grid.clear();
+    _unbounded.clear();
+    _pending.clear();
+    _serial = 0;
 }
 
 /*!
 	Returns the list of elements present in the given rectangular area or an empty list if none found.
 	Element is in the list, if the region only touches it - not neccessarily fits the whole in the region.
+
+	Elements are sorted by their right border. Only the grid cells covering the area are visited.
 */
 template <typename T>
 QList<T> CAKDTree<T>::findInRange(double x, double y, double w, double h)
 {
+    indexPending();
+
     QList<T> l;
+    QSet<T> found;
+
+    int cx1 = cell(x), cx2 = cell(x + w);
+    int cy1 = cell(y), cy2 = cell(y + h);
+    if ((static_cast<qint64>(cx2) - cx1 + 1) * (static_cast<qint64>(cy2) - cy1 + 1) > _grid.size()) {
+        // the area covers more cells than there are non-empty ones
+        for (typename QHash<quint64, QList<T>>::const_iterator it = _grid.constBegin(); it != _grid.constEnd(); it++) {
+            for (int i = 0; i < it.value().size(); i++) {
+                if (!found.contains(it.value()[i]) && overlaps(it.value()[i], x, y, w, h)) {
+                    found.insert(it.value()[i]);
+                    l << it.value()[i];
+                }
+            }
+        }
+    } else {
+        for (int cx = cx1; cx <= cx2; cx++) {
+            for (int cy = cy1; cy <= cy2; cy++) {
+                typename QHash<quint64, QList<T>>::const_iterator it = _grid.constFind(cellKey(cx, cy));
+                if (it == _grid.constEnd()) {
+                    continue;
+                }
+
+                for (int i = 0; i < it.value().size(); i++) {
+                    if (!found.contains(it.value()[i]) && overlaps(it.value()[i], x, y, w, h)) {
+                        found.insert(it.value()[i]);
+                        l << it.value()[i];
+                    }
+                }
+            }
+        }
+    }
 
-    T rightMostElt = _mapX.lowerBound(x + w).value();
-    for (typename QMultiMap<double, T>::const_iterator it = _mapXW.upperBound(x); (it != _mapXW.end()) && (it.value() != rightMostElt); it++) {
-        if (( // The object is normal and fits into the area
-                (it.value()->yPos() <= y + h) && (it.value()->yPos() + it.value()->height() >= y))
-            || ( // The object is unlimited in width (eg. contexts)
-                   (it.value()->width() == 0) && (it.value()->yPos() <= y + h) && (it.value()->yPos() + it.value()->height() >= y))
-            || ( // The object is unlimited in height (eg. helper lines)
-                   (it.value()->height() == 0))) {
-            l << it.value();
+    for (int i = 0; i < _unbounded.size(); i++) {
+        if (overlaps(_unbounded[i], x, y, w, h)) {
+            l << _unbounded[i];
         }
     }
 
+    // keep the order of x+width, the last added first for the same borders
+    std::sort(l.begin(), l.end(), [this](T a, T b) {
+        const CAKDTreeEntry& ea = _entries[a];
+        const CAKDTreeEntry& eb = _entries[b];
+        return (ea.xw < eb.xw) || (ea.xw == eb.xw && ea.serial > eb.serial);
+    });
+
     return l;
 }
 
@@ -237,17 +473,11 @@ T CAKDTree<T>::findNearestRight(double x, bool timeBased, CADrawableContext* con
 template <typename T>
 T CAKDTree<T>::findNearestUp(double y)
 {
-    if (_mapX.isEmpty())
+    typename QMultiMap<double, T>::const_iterator it = _mapYH.lowerBound(y);
+    if (it == _mapYH.constBegin())
         return 0;
 
-    T elt = 0;
-    for (typename QMultiMap<double, T>::const_iterator it = _mapX.constBegin(); it != _mapX.constEnd(); it++) {
-        if (((!elt) || ((it.value()->yPos() + it.value()->height()) > (elt->yPos() + elt->height())))
-            && ((it.value()->yPos() + it.value()->height()) < y)) {
-            elt = it.value();
-        }
-    }
-    return elt;
+    return (--it).value();
 }
 
 /*!
@@ -261,17 +491,11 @@ T CAKDTree<T>::findNearestUp(double y)
 template <typename T>
 T CAKDTree<T>::findNearestDown(double y)
 {
-    if (_mapX.isEmpty())
+    typename QMultiMap<double, T>::const_iterator it = _mapY.upperBound(y);
+    if (it == _mapY.constEnd())
         return 0;
 
-    T elt = 0;
-    for (typename QMultiMap<double, T>::const_iterator it = _mapX.constBegin(); it != _mapX.constEnd(); it++) {
-        if (((!elt) || (it.value()->yPos() < elt->yPos())) && (it.value()->yPos() > y)) {
-            elt = it.value();
-        }
-    }
-
-    return elt;
+    return it.value();
 }
 
 /*!
@@ -296,28 +520,15 @@ double CAKDTree<T>::getMaxX()
 
 /*!
 	Returns the max Y coordinate of the end of the most-bottom element.
-	This value is read from buffer, so the calculation time is constant.
+	This value is read from the y+height sorted map, so the calculation time is logarithmic.
 */
 template <typename T>
 double CAKDTree<T>::getMaxY()
 {
-    return _maxY;
-}
+    if (_mapYH.isEmpty() || _mapYH.lastKey() < 0)
+        return 0.0;
 
-/*!
-	Used internally for the maxX and maxY properties to update.
-	Calculates the largest X and Y coordinates among all ends of elements and store it locally.
-	This operation takes O(n) time complexity where n is number of elements in the tree.
-*/
-template <typename T>
-void CAKDTree<T>::calculateMaxY()
-{
-    _maxY = 0;
-    for (typename QMultiMap<double, T>::iterator it = _mapX.begin(); it != _mapX.end(); it++) {
-        if (it.value()->yPos() + it.value()->height() > _maxY) {
-            _maxY = it.value()->yPos() + it.value()->height();
-        }
-    }
+    return _mapYH.lastKey();
 }
 
 #endif
@@ -0,0 +1,73 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include "layout/layoutcache.h"
+
+/*!
+	\struct CALayoutColumn
+	\brief Snapshot of the layout engine state at the beginning of a bar
+
+	Columns are recorded by CALayoutEngine::reposit() every time all the streams are aligned at the
+	barline. The layout can be resumed from any column without engraving the music before it.
+
+	\sa CALayoutCache
+*/
+
+/*!
+	\class CALayoutCache
+	\brief Layout state of the last engraving pass stored in the sheet layout
+
+	The cache holds the per-stream indices, x coordinates and the last clefs, key and time signatures
+	at the beginning of each bar of the last CALayoutEngine::reposit() pass. It is used by
+	CALayoutEngine::repositRegion() to re-engrave only the bars touched by a change and shift the
+	drawable elements after the point where the horizontal positions settle again.
+
+	If the last pass was stopped at the given horizontal limit, the cache is not complete and the
+	last column is the state CALayoutEngine::repositRemaining() continues from.
+
+	\sa CALayoutColumn, CAScoreView::rebuildRegion()
+*/
+
+CALayoutCache::CALayoutCache()
+    : _complete(true)
+{
+}
+
+/*!
+	Forgets the stored layout state. The next rebuild will be a complete one.
+*/
+void CALayoutCache::clear()
+{
+    _streamList.clear();
+    _streamSizes.clear();
+    _streamLastTimes.clear();
+    _columns.clear();
+    _scalableElements.clear();
+    _complete = true;
+}
+
+/*!
+	Returns the index of the last column which starts strictly before the given \a timeStart or -1,
+	if no such column exists.
+*/
+int CALayoutCache::findRestartColumn(int timeStart)
+{
+    int low = 0;
+    int high = _columns.size() - 1;
+    int result = -1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        if (_columns[mid].timeStart < timeStart) {
+            result = mid;
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    return result;
+}
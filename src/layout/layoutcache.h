@@ -0,0 +1,60 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef LAYOUTCACHE_H_
+#define LAYOUTCACHE_H_
+
+#include <QList>
+#include <QVector>
+
+class CAMusElement;
+class CABarline;
+class CAClef;
+class CAKeySignature;
+class CATimeSignature;
+class CADrawableMusElement;
+
+struct CALayoutColumn {
+    int timeStart; // time of the column
+    int x; // aligned x coordinate of all the streams at the beginning of the column
+    CABarline* barline; // barline which starts the column or nullptr for the first column
+    QVector<int> streamsIdx; // index of the next element to place in each stream
+    QVector<CAMusElement*> fronts; // the next element to place in each stream or nullptr, if the stream is at the end
+    QVector<int> frontTimes; // start times of the fronts or -1, if the stream is at the end
+    QVector<CAClef*> lastClef;
+    QVector<CAKeySignature*> lastKeySig;
+    QVector<CATimeSignature*> lastTimeSig;
+    QVector<int> rehersalMarks; // number of already placed rehersal marks in each stream
+};
+
+class CALayoutCache {
+public:
+    CALayoutCache();
+
+    void clear();
+    inline bool isEmpty() const { return _columns.isEmpty(); }
+    inline bool isComplete() const { return _complete; }
+    inline void setComplete(bool complete) { _complete = complete; }
+
+    inline QList<void*>& streamList() { return _streamList; }
+    inline QVector<int>& streamSizes() { return _streamSizes; }
+    inline QVector<int>& streamLastTimes() { return _streamLastTimes; }
+    inline QList<CALayoutColumn>& columnList() { return _columns; }
+    inline QList<CADrawableMusElement*>& scalableElementList() { return _scalableElements; }
+
+    int findRestartColumn(int timeStart);
+
+private:
+    QList<void*> _streamList; // voices or contexts the streams were generated from
+    QVector<int> _streamSizes; // number of elements in each stream
+    QVector<int> _streamLastTimes; // start time of the last element in each stream or -1, if empty
+    QList<CALayoutColumn> _columns; // state of the layout engine at the beginning of each bar, sorted by time
+    QList<CADrawableMusElement*> _scalableElements; // scalable elements (eg. crescendo) placed in the last pass
+    bool _complete; // False, if the last pass stopped at the last column and the rest of the sheet is not placed yet
+};
+
+#endif /* LAYOUTCACHE_H_ */
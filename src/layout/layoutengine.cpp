@@ -6,10 +6,22 @@
 */
 
 #include <QDebug>
+#include <QHash>
 #include <QList>
 #include <QMap>
+#include <QSet>
+#include <QVector>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
 
 #include "layout/layoutengine.h"
+#include "core/progress.h"
+#include "core/trace.h"
 
 #include "widgets/scoreview.h"
 
@@ -26,6 +38,8 @@
 #include "layout/drawablestaff.h"
 #include "layout/drawabletimesignature.h"
 #include "layout/drawabletuplet.h"
+#include "layout/layoutcache.h"
+#include "layout/sheetlayout.h"
 
 #include "layout/drawablelyricscontext.h"
 #include "layout/drawablesyllable.h"
@@ -39,6 +53,7 @@
 #include "layout/drawablechordname.h"
 #include "layout/drawablechordnamecontext.h"
 
+#include "score/accidentalstate.h"
 #include "score/sheet.h"
 
 #include "score/keysignature.h"
@@ -68,6 +83,43 @@
 
 QList<CADrawableMusElement*> CALayoutEngine::scalableElts;
 int* CALayoutEngine::streamsRehersalMarks;
+QList<CALayoutEngine::CAPendingMarks> CALayoutEngine::pendingMarks;
+
+namespace {
+
+// Vertical extent of the elements and marks above or below a staff used for stacking the marks
+struct CAMarkSkyline {
+    struct Segment {
+        double x1, x2, y;
+    };
+
+    // Returns the highest Y coordinate above the segments overlapping the range x1..x2
+    double top(double x1, double x2) const
+    {
+        double y = std::numeric_limits<double>::max();
+        for (int i = 0; i < above.size(); i++) {
+            if (above[i].x1 <= x2 && above[i].x2 >= x1)
+                y = qMin(y, above[i].y);
+        }
+        return y;
+    }
+
+    // Returns the lowest Y coordinate below the segments overlapping the range x1..x2
+    double bottom(double x1, double x2) const
+    {
+        double y = std::numeric_limits<double>::lowest();
+        for (int i = 0; i < below.size(); i++) {
+            if (below[i].x1 <= x2 && below[i].x2 >= x1)
+                y = qMax(y, below[i].y);
+        }
+        return y;
+    }
+
+    QVector<Segment> above;
+    QVector<Segment> below;
+};
+
+}
 
 /*!
 	\class CAEngraver
@@ -80,35 +132,145 @@ int* CALayoutEngine::streamsRehersalMarks;
 /*!
 	Repositions the notes in the abstract sheet of the given score view \a v so they fit nicely.
 	This function doesn't clear the view, but only adds the elements.
+
+	The state of the layout at the beginning of each bar is stored to the view's layout cache so
+	the later changes can be re-engraved by repositRegion().
+
+	If \a xLimit is set, the layout stops at the first bar starting right of the given horizontal
+	coordinate and the layout cache is marked as not complete. The rest of the sheet is placed by
+	calling repositRemaining(). Scalable elements (eg. crescendo) are placed when the layout is
+	complete. Sheets with function marks are always laid out completely.
+
+	If \a progress is set, the layout reports the progress of the sheet placed so far and stops at
+	the first possible bar after the \a progress was canceled, the same way as when reaching
+	\a xLimit.
+
+	\sa repositRemaining()
+*/
+void CALayoutEngine::reposit(CAScoreView* v, int xLimit, CAProgress* progress)
+{
+    CA_TRACE_ZONE("CALayoutEngine::reposit");
+    repositStreams(v, false, 0, 0, xLimit, progress);
+}
+
+/*!
+	Re-engraves only the part of the sheet in the score view \a v which was changed between
+	\a timeStart and \a timeEnd.
+
+	The layout is resumed at the last bar before \a timeStart as it was stored by the previous pass.
+	After \a timeEnd, the engraving stops at the first bar where all the streams continue with the
+	same elements as in the previous pass. The drawable elements right of that bar are shifted
+	instead of being re-engraved.
+
+	Returns False without changing the view, if the change cannot be re-engraved separately (eg.
+	no previous pass, changed contexts or function marks present). The view should be completely
+	rebuilt then.
+
+	\sa reposit(), CAScoreView::rebuildRegion()
+*/
+bool CALayoutEngine::repositRegion(CAScoreView* v, int timeStart, int timeEnd)
+{
+    CA_TRACE_ZONE("CALayoutEngine::repositRegion");
+    if (!v->layoutCache().isComplete()) {
+        return false;
+    }
+
+    return repositStreams(v, true, timeStart, timeEnd, 0, nullptr);
+}
+
+/*!
+	Continues the layout of the score view \a v stopped by reposit() at the last stored bar.
+	If \a xLimit is set, the layout stops again at the first bar starting right of it. The layout
+	also stops, when the \a progress is canceled, see reposit().
+
+	Returns False without changing the view, if the sheet was changed since the last pass. The view
+	should be completely rebuilt then.
+
+	\sa reposit()
 */
-void CALayoutEngine::reposit(CAScoreView* v)
+bool CALayoutEngine::repositRemaining(CAScoreView* v, int xLimit, CAProgress* progress)
+{
+    CA_TRACE_ZONE("CALayoutEngine::repositRemaining");
+    if (v->layoutCache().isComplete()) {
+        return true;
+    }
+
+    return repositStreams(v, true, 0, 0, xLimit, progress);
+}
+
+/*!
+	Does the actual layout for reposit(), repositRegion() and repositRemaining().
+	If \a incremental is False, all the elements are placed. Otherwise only the elements in the region
+	between \a regionStart and \a regionEnd and up to the next settled bar are re-engraved or, if
+	the layout cache is not complete, the layout continues at its last column.
+	If \a xLimit is set, the layout stops at the first bar right of it. If \a progress is set,
+	the progress is reported at each bar and the layout stops at the first bar after canceling.
+*/
+bool CALayoutEngine::repositStreams(CAScoreView* v, bool incremental, int regionStart, int regionEnd, int xLimit, CAProgress* progress)
 {
     //int i;
     CASheet* sheet = v->sheet();
+    CALayoutCache& cache = v->layoutCache();
+    bool resume = incremental && !cache.isComplete(); // continue the stopped layout
+    bool stopped = false; // the layout was stopped at xLimit or canceled
+    bool cancelable = true; // the layout can be stopped before the end of the sheet
 
     //list of all the music element lists (ie. streams) taken from all the contexts
     QList<QList<CAMusElement*>> musStreamList; // streams music elements
     QList<CAContext*> contexts; // which context does the stream belong to
+    QList<void*> streamOwners; // which voice or context was the stream generated from
 
     int dy = 50;
-    QList<int> nonFirstVoiceIdxs; //list of indexes of musStreamLists which the voices aren't the first voice. This is used later for determining should a sign be created or not (if it has been created in 1st voice already, don't recreate it in the other voices in the same staff).
+    QSet<int> nonFirstVoiceIdxs; //set of indexes of musStreamLists which the voices aren't the first voice. This is used later for determining should a sign be created or not (if it has been created in 1st voice already, don't recreate it in the other voices in the same staff).
     QMap<CAContext*, CADrawableContext*> drawableContextMap;
+    CASheetLayout* sheetLayout = v->sheetLayout();
+
+    if (incremental) {
+        if (cache.isEmpty())
+            return false;
+
+        // reuse the existing drawable contexts
+        for (int i = 0; i < sheet->contextList().size(); i++) {
+            CAContext* context = sheet->contextList()[i];
+            if (sheetLayout->isHidden(context)) {
+                continue;
+            }
+            if (context->contextType() == CAContext::FunctionMarkContext) {
+                return false; // function marks depend on their neighbours too much
+            }
+
+            CADrawableContext* drawableContext = v->findCElement(context);
+            if (!drawableContext) {
+                return false;
+            }
+            drawableContextMap[context] = drawableContext;
+        }
+    }
 
+    // the folded contexts are left out, only their neighbours are aligned
+    CAContext* previous = nullptr; // last laid out context
     for (int i = 0; i < sheet->contextList().size(); i++) {
+        if (sheetLayout->isHidden(sheet->contextList()[i])) {
+            continue;
+        }
+
         switch (sheet->contextList()[i]->contextType()) {
         case CAContext::Staff: {
-            if (i > 0)
+            if (previous)
                 dy += 70;
 
             CAStaff* staff = static_cast<CAStaff*>(sheet->contextList()[i]);
-            /// \todo replace raw pointer with shared or unique pointer
-            drawableContextMap[staff] = new CADrawableStaff(staff, 0, dy);
-            v->addCElement(drawableContextMap[staff]);
+            if (!drawableContextMap.contains(staff)) {
+                /// \todo replace raw pointer with shared or unique pointer
+                drawableContextMap[staff] = new CADrawableStaff(staff, 0, dy);
+                v->addCElement(drawableContextMap[staff]);
+            }
 
             //add all the voices lists to the common list
             for (int j = 0; j < staff->voiceList().size(); j++) {
                 musStreamList << staff->voiceList()[j]->musElementList();
                 contexts << staff;
+                streamOwners << staff->voiceList()[j];
                 if (staff->voiceList()[j]->voiceNumber() != 1)
                     nonFirstVoiceIdxs << musStreamList.size() - 1;
             }
@@ -117,12 +279,14 @@ void CALayoutEngine::reposit(CAScoreView* v)
         }
         case CAContext::LyricsContext: {
             CALyricsContext* lyricsContext = static_cast<CALyricsContext*>(sheet->contextList()[i]);
-            if (i > 0 && (sheet->contextList()[i - 1]->contextType() != CAContext::LyricsContext || static_cast<CALyricsContext*>(sheet->contextList()[i - 1])->associatedVoice()->staff() != lyricsContext->associatedVoice()->staff())) {
+            if (previous && (previous->contextType() != CAContext::LyricsContext || static_cast<CALyricsContext*>(previous)->associatedVoice()->staff() != lyricsContext->associatedVoice()->staff())) {
                 dy += 70; // the previous context wasn't lyrics or was not related to the current lyrics
             }
 
-            drawableContextMap[lyricsContext] = new CADrawableLyricsContext(lyricsContext, 0, dy);
-            v->addCElement(drawableContextMap[lyricsContext]);
+            if (!drawableContextMap.contains(lyricsContext)) {
+                drawableContextMap[lyricsContext] = new CADrawableLyricsContext(lyricsContext, 0, dy);
+                v->addCElement(drawableContextMap[lyricsContext]);
+            }
 
             // convert QList<CASyllable*> to QList<CAMusElement*>
             QList<CAMusElement*> syllableList;
@@ -132,16 +296,19 @@ void CALayoutEngine::reposit(CAScoreView* v)
 
             musStreamList << syllableList;
             contexts << lyricsContext;
+            streamOwners << lyricsContext;
             dy += drawableContextMap[lyricsContext]->height();
             break;
         }
         case CAContext::FiguredBassContext: {
-            if (i > 0)
+            if (previous)
                 dy += 70;
 
             CAFiguredBassContext* fbContext = static_cast<CAFiguredBassContext*>(sheet->contextList()[i]);
-            drawableContextMap[fbContext] = new CADrawableFiguredBassContext(fbContext, 0, dy);
-            v->addCElement(drawableContextMap[fbContext]);
+            if (!drawableContextMap.contains(fbContext)) {
+                drawableContextMap[fbContext] = new CADrawableFiguredBassContext(fbContext, 0, dy);
+                v->addCElement(drawableContextMap[fbContext]);
+            }
             QList<CAFiguredBassMark*> fbmList = fbContext->figuredBassMarkList();
             // TODO: Is there a faster way to cast QList<CAFiguredBassMark*> to QList<CAMusElement*>?
             QList<CAMusElement*> musList;
@@ -149,14 +316,18 @@ void CALayoutEngine::reposit(CAScoreView* v)
                 musList << fbmList[j];
             musStreamList << musList;
             contexts << fbContext;
+            streamOwners << fbContext;
             dy += drawableContextMap[fbContext]->height();
             break;
         }
         case CAContext::FunctionMarkContext: {
-            if (i > 0 && sheet->contextList()[i - 1]->contextType() != CAContext::FiguredBassContext) {
+            if (previous && previous->contextType() != CAContext::FiguredBassContext) {
                 dy += 70;
             }
 
+            xLimit = 0; // function marks are placed in a single pass
+            cancelable = false;
+
             CAFunctionMarkContext* fmContext = static_cast<CAFunctionMarkContext*>(sheet->contextList()[i]);
             drawableContextMap[fmContext] = new CADrawableFunctionMarkContext(fmContext, 0, dy);
             v->addCElement(drawableContextMap[fmContext]);
@@ -167,16 +338,19 @@ void CALayoutEngine::reposit(CAScoreView* v)
                 musList << fmList[j];
             musStreamList << musList;
             contexts << fmContext;
+            streamOwners << fmContext;
             dy += drawableContextMap[fmContext]->height();
             break;
         }
         case CAContext::ChordNameContext: {
-            if (i > 0)
+            if (previous)
                 dy += 70;
 
             CAChordNameContext* cnContext = static_cast<CAChordNameContext*>(sheet->contextList()[i]);
-            drawableContextMap[cnContext] = new CADrawableChordNameContext(cnContext, 0, dy);
-            v->addCElement(drawableContextMap[cnContext]);
+            if (!drawableContextMap.contains(cnContext)) {
+                drawableContextMap[cnContext] = new CADrawableChordNameContext(cnContext, 0, dy);
+                v->addCElement(drawableContextMap[cnContext]);
+            }
             QList<CAChordName*> cnList = cnContext->chordNameList();
             // TODO: Is there a faster way to cast QList<CAChordName*> to QList<CAMusElement*>?
             QList<CAMusElement*> musList;
@@ -184,10 +358,80 @@ void CALayoutEngine::reposit(CAScoreView* v)
                 musList << cnList[j];
             musStreamList << musList;
             contexts << cnContext;
+            streamOwners << cnContext;
             dy += drawableContextMap[cnContext]->height();
             break;
         }
         }
+        previous = sheet->contextList()[i];
+    }
+
+    // refresh the accidentals in effect, the notes showing or hiding their accidental now are re-engraved too
+    if (!incremental) {
+        sheetLayout->clearAccidentalStates();
+    } else if (!resume) {
+        for (int i = 0; i < sheet->contextList().size(); i++) {
+            // frozen staffs are not edited, their accidentals in effect stay the same
+            if (sheet->contextList()[i]->contextType() == CAContext::Staff && !static_cast<CAStaff*>(sheet->contextList()[i])->isFrozen() && !sheetLayout->isHidden(sheet->contextList()[i])) {
+                QList<CANote*> changed = sheetLayout->accidentalState(static_cast<CAStaff*>(sheet->contextList()[i])).update(regionStart, regionEnd);
+                for (int j = 0; j < changed.size(); j++) {
+                    regionEnd = qMax(regionEnd, changed[j]->timeEnd());
+                }
+            }
+        }
+    }
+
+    // find the bar to resume the layout from
+    int restartColumn = -1;
+    if (incremental) {
+        if (streamOwners != cache.streamList()) {
+            return false;
+        }
+
+        if (resume) {
+            for (int i = 0; i < musStreamList.size(); i++) {
+                if (musStreamList[i].size() != cache.streamSizes()[i]) {
+                    return false;
+                }
+            }
+
+            restartColumn = cache.columnList().size() - 1;
+            if (!isValidRestart(cache.columnList()[restartColumn], musStreamList)) {
+                return false;
+            }
+        } else {
+            for (restartColumn = cache.findRestartColumn(regionStart); restartColumn >= 0; restartColumn--) {
+                if (isValidRestart(cache.columnList()[restartColumn], musStreamList))
+                    break;
+            }
+        }
+        if (restartColumn < 0) {
+            return false;
+        }
+    }
+
+    // detach the drawable elements which will be re-engraved or shifted
+    QList<CADrawableMusElement*> detachedElts;
+    QList<CADrawableNoteCheckerError*> detachedNCEs;
+    QList<QPair<double, double>> detachedTuplets; // horizontal extents of the detached tuplets in the previous pass
+    QHash<CATuplet*, CADrawableTuplet*> reusableTuplets; // detached tuplets which are moved, if their bracket doesn't change
+    QHash<CABarline*, int> oldColumns; // barlines starting the columns of the previous pass right of the restart column
+    int restartX = 0;
+    if (incremental && !resume) {
+        restartX = cache.columnList()[restartColumn].x;
+        detachedElts = v->detachMElements(restartX, cache.scalableElementList());
+        detachedNCEs = v->detachDrawableNoteCheckerErrors(restartX - 5); // note checker errors start 5 points left of their element
+        for (int i = 0; i < detachedElts.size(); i++) {
+            if (detachedElts[i]->drawableMusElementType() == CADrawableMusElement::DrawableTuplet) {
+                CADrawableTuplet* dTuplet = static_cast<CADrawableTuplet*>(detachedElts[i]);
+                detachedTuplets << qMakePair(dTuplet->xPos(), dTuplet->xPos() + dTuplet->width());
+                reusableTuplets[dTuplet->tuplet()] = dTuplet;
+            }
+        }
+        for (int i = restartColumn + 1; i < cache.columnList().size(); i++) {
+            if (cache.columnList()[i].barline)
+                oldColumns[cache.columnList()[i].barline] = i;
+        }
     }
 
     unsigned int streams = static_cast<unsigned int>(musStreamList.size());
@@ -214,6 +458,7 @@ void CALayoutEngine::reposit(CAScoreView* v)
     for (unsigned int i = 0; i < streams; i++)
         lastTimeSig[i] = nullptr;
     scalableElts.clear();
+    pendingMarks.clear();
 
     int timeStart = 0;
     bool done = false;
@@ -221,12 +466,50 @@ void CALayoutEngine::reposit(CAScoreView* v)
     CADrawableFunctionMarkSupport** lastDFMTonicizations = new CADrawableFunctionMarkSupport*[streams];
     for (unsigned int i = 0; i < streams; i++)
         lastDFMTonicizations[i] = nullptr;
+
+    QList<CALayoutColumn> columns; // columns of this pass
+    bool firstColumn = true;
+    int settledColumn = -1; // column of the previous pass where the layout settled
+    int deltaX = 0; // horizontal shift of the elements right of the settled column
+    if (incremental) {
+        const CALayoutColumn& restart = cache.columnList()[restartColumn];
+        for (unsigned int i = 0; i < streams; i++) {
+            streamsIdx[i] = restart.streamsIdx[static_cast<int>(i)];
+            streamsX[i] = restart.x;
+            streamsRehersalMarks[i] = restart.rehersalMarks[static_cast<int>(i)];
+            lastClef[i] = restart.lastClef[static_cast<int>(i)];
+            lastKeySig[i] = restart.lastKeySig[static_cast<int>(i)];
+            lastTimeSig[i] = restart.lastTimeSig[static_cast<int>(i)];
+        }
+        columns = cache.columnList().mid(0, restartColumn);
+        if (resume) {
+            scalableElts = cache.scalableElementList(); // placed when the layout is complete
+        }
+    }
+
+    // Start times of the next element in each stream, the soonest first. Each stream which is not at
+    // the end has exactly one entry. Only the streams having an element at the current time are
+    // processed in each step and queued again afterwards.
+    typedef std::pair<int, unsigned int> CALayoutOnset; // time, stream
+    std::priority_queue<CALayoutOnset, std::vector<CALayoutOnset>, std::greater<CALayoutOnset>> onsets;
+    for (unsigned int i = 0; i < streams; i++) {
+        if (streamsIdx[i] < musStreamList[static_cast<int>(i)].size())
+            onsets.push(CALayoutOnset(musStreamList[static_cast<int>(i)].at(streamsIdx[i])->timeStart(), i));
+    }
+    QVector<unsigned int> activeStreams; // streams with the next element at timeStart, in the order of streams
+
+    int sheetEnd = 0; // for reporting the progress
+    if (progress) {
+        for (const QList<CAMusElement*>& stream : musStreamList) {
+            if (!stream.isEmpty()) {
+                sheetEnd = qMax(sheetEnd, stream.last()->timeEnd());
+            }
+        }
+    }
+
     while (!done) {
         //if all the indices are at the end of the streams, finish.
-        unsigned int idx;
-        for (idx = 0; (idx < streams) && (streamsIdx[idx] == musStreamList[static_cast<int>(idx)].size()); idx++)
-            ;
-        if (idx == streams) {
+        if (onsets.empty()) {
             done = true;
             continue;
         }
@@ -239,19 +522,80 @@ void CALayoutEngine::reposit(CAScoreView* v)
             if (musStreamList[static_cast<int>(i)].size() && musStreamList[static_cast<int>(i)].last()->musElementType() != CAMusElement::FunctionMark)
                 streamsX[i] = maxX;
 
-        //go through all the streams and remember the time of the soonest element that will happen
-        timeStart = -1; //reset the timeStart - the next one minimum will be set in the following loop
-        for (unsigned int idx = 0; idx < streams; idx++) {
-            if ((musStreamList[static_cast<int>(idx)].size() > streamsIdx[idx]) && ((timeStart == -1) || (musStreamList[static_cast<int>(idx)].at(streamsIdx[idx])->timeStart() < timeStart)))
-                timeStart = musStreamList[static_cast<int>(idx)].at(streamsIdx[idx])->timeStart();
+        //take the time of the soonest element that will happen and the streams having an element at that time
+        timeStart = onsets.top().first;
+        activeStreams.clear();
+        while (!onsets.empty() && onsets.top().first == timeStart) {
+            activeStreams << onsets.top().second;
+            onsets.pop();
         }
+        std::sort(activeStreams.begin(), activeStreams.end());
         //timeStart now holds the nearest next time we're going to draw
 
+        // Remember the state at the beginning of each bar for the incremental layout
+        CABarline* columnBarline = nullptr;
+        for (int a = 0; (a < activeStreams.size()) && !columnBarline; a++) {
+            unsigned int i = activeStreams[a];
+            if ((streamsIdx[i] < musStreamList[static_cast<int>(i)].size()) && (contexts[static_cast<int>(i)]->contextType() == CAContext::Staff) && (!nonFirstVoiceIdxs.contains(static_cast<int>(i)))) {
+                CAMusElement* front = musStreamList[static_cast<int>(i)].at(streamsIdx[i]);
+                if (front->timeStart() == timeStart && front->musElementType() == CAMusElement::Barline)
+                    columnBarline = static_cast<CABarline*>(front);
+            }
+        }
+
+        if (columnBarline || firstColumn) {
+            CALayoutColumn column;
+            column.timeStart = timeStart;
+            column.x = maxX;
+            column.barline = columnBarline;
+            for (unsigned int i = 0; i < streams; i++) {
+                bool atEnd = (streamsIdx[i] >= musStreamList[static_cast<int>(i)].size());
+                column.streamsIdx << streamsIdx[i];
+                column.fronts << (atEnd ? nullptr : musStreamList[static_cast<int>(i)].at(streamsIdx[i]));
+                column.frontTimes << (atEnd ? -1 : musStreamList[static_cast<int>(i)].at(streamsIdx[i])->timeStart());
+                column.lastClef << lastClef[i];
+                column.lastKeySig << lastKeySig[i];
+                column.lastTimeSig << lastTimeSig[i];
+                column.rehersalMarks << streamsRehersalMarks[i];
+            }
+            columns << column;
+
+            // stop, if the rest of the score is the same as in the previous pass
+            if (incremental && !firstColumn && columnBarline && timeStart >= regionEnd && oldColumns.contains(columnBarline)) {
+                int oldIdx = oldColumns[columnBarline];
+                if (isSettled(cache.columnList()[oldIdx], column, cache, musStreamList, detachedTuplets)) {
+                    settledColumn = oldIdx;
+                    deltaX = column.x - cache.columnList()[oldIdx].x;
+                    done = true;
+                    continue;
+                }
+            }
+
+            // stop, if the rest of the sheet is placed later
+            if (xLimit && !firstColumn && column.x >= xLimit && isValidRestart(column, musStreamList)) {
+                stopped = true;
+                done = true;
+                continue;
+            }
+
+            // stop, if canceled, the rest is placed by repositRemaining()
+            if (progress) {
+                progress->setProgress(timeStart, sheetEnd);
+                if (cancelable && !firstColumn && progress->isCanceled() && isValidRestart(column, musStreamList)) {
+                    stopped = true;
+                    done = true;
+                    continue;
+                }
+            }
+        }
+        firstColumn = false;
+
         //go through all the streams and check if the following element has this time
         CAMusElement* elt;
         CADrawableContext* drawableContext;
         //bool placedSymbol = false;	//used if waiting for notes to gather and a non-time-consuming symbol has been placed
-        for (unsigned int i = 0; i < streams; i++) {
+        for (int a = 0; a < activeStreams.size(); a++) {
+            unsigned int i = activeStreams[a];
             //loop until the first playable element
             //multiple elements can have the same start time. eg. Clef + Key signature + Time signature + First note
             while ((streamsIdx[i] < musStreamList[static_cast<int>(i)].size()) && ((elt = musStreamList[static_cast<int>(i)].at(streamsIdx[i]))->timeStart() == timeStart) && (!elt->isPlayable()) && (elt->musElementType() != CAMusElement::Barline) && //barlines should be aligned
@@ -370,7 +714,8 @@ void CALayoutEngine::reposit(CAScoreView* v)
                 streamsX[i] = maxX;
 
         // Place barlines
-        for (unsigned int i = 0; i < streams; i++) {
+        for (int a = 0; a < activeStreams.size(); a++) {
+            unsigned int i = activeStreams[a];
             if (!(musStreamList[static_cast<int>(i)].size() > streamsIdx[i]) || //if the stream is already at the end, continue to the next stream
                 ((elt = musStreamList[static_cast<int>(i)].at(streamsIdx[i]))->timeStart() != timeStart))
                 continue;
@@ -410,14 +755,15 @@ void CALayoutEngine::reposit(CAScoreView* v)
         double maxWidth = 0;
         double maxAccidentalXEnd = 0;
         QList<CADrawableAccidental*> lastAccidentals;
-        for (unsigned int i = 0; i < streams; i++) {
+        for (int a = 0; a < activeStreams.size(); a++) {
+            unsigned int i = activeStreams[a];
             // loop until the element has come, which has bigger timeStart
             CADrawableMusElement* newElt = nullptr;
             int oldStreamIdx = streamsIdx[i];
             while ((streamsIdx[i] < musStreamList[static_cast<int>(i)].size()) && ((elt = musStreamList[static_cast<int>(i)].at(streamsIdx[i]))->timeStart() == timeStart) && (elt->isPlayable())) {
                 drawableContext = drawableContextMap[elt->context()];
 
-                if (elt->musElementType() == CAMusElement::Note && static_cast<CADrawableStaff*>(drawableContext)->getAccs(streamsX[i], static_cast<CANote*>(elt)->diatonicPitch().noteName()) != static_cast<CANote*>(elt)->diatonicPitch().accs()) {
+                if (elt->musElementType() == CAMusElement::Note && sheetLayout->accidentalState(static_cast<CAStaff*>(elt->context())).hasAccidental(static_cast<CANote*>(elt))) {
                     newElt = new CADrawableAccidental(
                         static_cast<signed char>(static_cast<CANote*>(elt)->diatonicPitch().accs()),
                         static_cast<CANote*>(elt),
@@ -436,8 +782,11 @@ void CALayoutEngine::reposit(CAScoreView* v)
                 streamsIdx[i]++;
             }
             streamsIdx[i] = oldStreamIdx;
-
-            streamsX[i] += ((maxWidth != 0.0) ? (maxWidth + 1) : 0); // append the needed space for the last used note
+        }
+        if (maxWidth != 0.0) {
+            // append the needed space for the widest accidental
+            for (int a = 0; a < activeStreams.size(); a++)
+                streamsX[activeStreams[a]] += (maxWidth + 1);
         }
 
         // Synchronize minimum X-es between the contexts - all the noteheads or barlines should be horizontally aligned.
@@ -456,7 +805,9 @@ void CALayoutEngine::reposit(CAScoreView* v)
         }
 
         // Place noteheads and other elements aligned to noteheads (syllables, function marks)
-        for (unsigned int i = 0; i < streams; i++) {
+        for (int a = 0; a < activeStreams.size(); a++) {
+            unsigned int i = activeStreams[a];
+            CANote::CAStemDirection chordStem = CANote::StemUndefined; // shared by the notes of the current chord
             // loop until the element has come, which has bigger timeStart
             while ((streamsIdx[i] < musStreamList[static_cast<int>(i)].size()) && ((elt = musStreamList[static_cast<int>(i)].at(streamsIdx[i]))->timeStart() == timeStart) && (elt->isPlayable() || elt->musElementType() == CAMusElement::FiguredBassMark || elt->musElementType() == CAMusElement::FunctionMark || elt->musElementType() == CAMusElement::Syllable || elt->musElementType() == CAMusElement::ChordName)) {
                 drawableContext = drawableContextMap[elt->context()];
@@ -464,11 +815,18 @@ void CALayoutEngine::reposit(CAScoreView* v)
 
                 switch (elt->musElementType()) {
                 case CAMusElement::Note: {
+                    const QList<CAMusElement*>& stream = musStreamList[static_cast<int>(i)];
+                    int idx = streamsIdx[i];
+                    if (idx == 0 || stream[idx - 1]->musElementType() != CAMusElement::Note || stream[idx - 1]->timeStart() != elt->timeStart()) {
+                        chordStem = CADrawableNote::chordStemDirection(stream, idx);
+                    }
+
                     newElt = new CADrawableNote(
                         static_cast<CANote*>(elt),
                         drawableContext,
                         streamsX[i],
-                        static_cast<CADrawableStaff*>(drawableContext)->calculateCenterYCoord(static_cast<CANote*>(elt), lastClef[i]));
+                        static_cast<CADrawableStaff*>(drawableContext)->calculateCenterYCoord(static_cast<CANote*>(elt), lastClef[i]),
+                        false, nullptr, chordStem);
 
                     // Create Ties
                     if (static_cast<CADrawableNote*>(newElt)->note()->tieStart()) {
@@ -493,19 +851,8 @@ void CALayoutEngine::reposit(CAScoreView* v)
                     }
                     if (static_cast<CADrawableNote*>(newElt)->note()->tieEnd()) {
                         // Set the slur coordinates for the second note
-                        CASlur::CASlurDirection dir = static_cast<CADrawableNote*>(newElt)->note()->tieEnd()->slurDirection();
-                        if (dir == CASlur::SlurPreferred || dir == CASlur::SlurNeutral)
-                            dir = static_cast<CADrawableNote*>(newElt)->note()->tieEnd()->noteStart()->actualSlurDirection();
-                        CADrawableSlur* dSlur = static_cast<CADrawableSlur*>(v->findMElement(static_cast<CADrawableNote*>(newElt)->note()->tieEnd()));
-                        dSlur->setX2(newElt->xPos());
-                        dSlur->setXMid(qRound(0.5 * dSlur->xPos() + 0.5 * newElt->xPos()));
-                        if (dir == CASlur::SlurUp) {
-                            dSlur->setY2(newElt->yPos());
-                            dSlur->setYMid(qMin(dSlur->y2(), dSlur->y1()) - 5);
-                        } else if (dir == CASlur::SlurDown) {
-                            dSlur->setY2(newElt->yPos() + newElt->height());
-                            dSlur->setYMid(qMax(dSlur->y2(), dSlur->y1()) + 5);
-                        }
+                        CASlur* tie = static_cast<CADrawableNote*>(newElt)->note()->tieEnd();
+                        placeSlurEnd(static_cast<CADrawableSlur*>(v->findMElement(tie)), tie, newElt, 5);
                     }
 
                     // Create Slurs
@@ -531,21 +878,8 @@ void CALayoutEngine::reposit(CAScoreView* v)
                     }
                     if (static_cast<CADrawableNote*>(newElt)->note()->slurEnd()) {
                         // Set the slur coordinates for the second note
-                        CASlur::CASlurDirection dir = static_cast<CADrawableNote*>(newElt)->note()->slurEnd()->slurDirection();
-                        if (dir == CASlur::SlurPreferred || dir == CASlur::SlurNeutral)
-                            dir = static_cast<CADrawableNote*>(newElt)->note()->slurEnd()->noteStart()->actualSlurDirection();
-                        CADrawableSlur* dSlur = static_cast<CADrawableSlur*>(v->findMElement(static_cast<CADrawableNote*>(newElt)->note()->slurEnd()));
-                        if (dSlur) {
-                            dSlur->setX2(newElt->xPos());
-                            dSlur->setXMid(qRound(0.5 * dSlur->xPos() + 0.5 * newElt->xPos()));
-                            if (dir == CASlur::SlurUp) {
-                                dSlur->setY2(newElt->yPos());
-                                dSlur->setYMid(qMin(dSlur->y2(), dSlur->y1()) - 15);
-                            } else if (dir == CASlur::SlurDown) {
-                                dSlur->setY2(newElt->yPos() + newElt->height());
-                                dSlur->setYMid(qMax(dSlur->y2(), dSlur->y1()) + 15);
-                            }
-                        }
+                        CASlur* slur = static_cast<CADrawableNote*>(newElt)->note()->slurEnd();
+                        placeSlurEnd(static_cast<CADrawableSlur*>(v->findMElement(slur)), slur, newElt, 15);
                     }
 
                     // Create Phrasing Slurs
@@ -571,46 +905,15 @@ void CALayoutEngine::reposit(CAScoreView* v)
                     }
                     if (static_cast<CADrawableNote*>(newElt)->note()->phrasingSlurEnd()) {
                         // Set the slur coordinates for the second note
-                        CASlur::CASlurDirection dir = static_cast<CADrawableNote*>(newElt)->note()->phrasingSlurEnd()->slurDirection();
-                        if (dir == CASlur::SlurPreferred || dir == CASlur::SlurNeutral)
-                            dir = static_cast<CADrawableNote*>(newElt)->note()->phrasingSlurEnd()->noteStart()->actualSlurDirection();
-                        CADrawableSlur* dSlur = static_cast<CADrawableSlur*>(v->findMElement(static_cast<CADrawableNote*>(newElt)->note()->phrasingSlurEnd()));
-                        dSlur->setX2(newElt->xPos());
-                        dSlur->setXMid(qRound(0.5 * dSlur->xPos() + 0.5 * newElt->xPos()));
-                        if (dir == CASlur::SlurUp) {
-                            dSlur->setY2(newElt->yPos());
-                            dSlur->setYMid(qMin(dSlur->y2(), dSlur->y1()) - 19);
-                        } else if (dir == CASlur::SlurDown) {
-                            dSlur->setY2(newElt->yPos() + newElt->height());
-                            dSlur->setYMid(qMax(dSlur->y2(), dSlur->y1()) + 19);
-                        }
+                        CASlur* phrasingSlur = static_cast<CADrawableNote*>(newElt)->note()->phrasingSlurEnd();
+                        placeSlurEnd(static_cast<CADrawableSlur*>(v->findMElement(phrasingSlur)), phrasingSlur, newElt, 19);
                     }
 
                     v->addMElement(newElt);
 
                     // add tuplet - same as for the rests
                     if (static_cast<CADrawableNote*>(newElt)->note()->isLastInTuplet()) {
-                        double x1 = v->findMElement(static_cast<CADrawableNote*>(newElt)->note()->tuplet()->firstNote())->xPos();
-                        double x2 = newElt->xPos() + newElt->width();
-                        double y1 = v->findMElement(static_cast<CADrawableNote*>(newElt)->note()->tuplet()->firstNote())->yPos();
-                        if (y1 > drawableContext->yPos() && y1 < drawableContext->yPos() + drawableContext->height()) {
-                            y1 = drawableContext->yPos() + drawableContext->height() + 10; // inside the staff
-                        } else if (y1 < drawableContext->yPos()) {
-                            y1 -= 10; // above the staff
-                        } else {
-                            y1 += 10; // under the staff
-                        }
-                        double y2 = v->findMElement(static_cast<CADrawableNote*>(newElt)->note()->tuplet()->lastNote())->yPos();
-                        if (y2 > drawableContext->yPos() && y2 < drawableContext->yPos() + drawableContext->height()) {
-                            y2 = drawableContext->yPos() + drawableContext->height() + 10; // inside the staff
-                        } else if (y2 < drawableContext->yPos()) {
-                            y2 -= 10; // above the staff
-                        } else {
-                            y2 += 10; // under the staff
-                        }
-
-                        CADrawableTuplet* dTuplet = new CADrawableTuplet(static_cast<CADrawableNote*>(newElt)->note()->tuplet(), drawableContext, x1, y1, x2, y2);
-                        v->addMElement(dTuplet);
+                        placeTuplet(v, static_cast<CADrawableNote*>(newElt)->note()->tuplet(), newElt, drawableContext, reusableTuplets);
                     }
 
                     if (static_cast<CANote*>(elt)->isLastInChord())
@@ -632,28 +935,7 @@ void CALayoutEngine::reposit(CAScoreView* v)
 
                     // add tuplet - same as for the notes
                     if (static_cast<CADrawableRest*>(newElt)->rest()->isLastInTuplet()) {
-                        double x1 = v->findMElement(static_cast<CADrawableRest*>(newElt)->rest()->tuplet()->firstNote())->xPos();
-                        double x2 = newElt->xPos() + newElt->width();
-                        double y1 = v->findMElement(static_cast<CADrawableRest*>(newElt)->rest()->tuplet()->firstNote())->yPos();
-                        if (y1 > drawableContext->yPos() && y1 < drawableContext->yPos() + drawableContext->height()) {
-                            y1 = drawableContext->yPos() + drawableContext->height() + 10; // inside the staff
-                        } else if (y1 < drawableContext->yPos()) {
-                            y1 -= 10; // above the staff
-                        } else {
-                            y1 += 10; // under the staff
-                        }
-                        double y2 = v->findMElement(static_cast<CADrawableRest*>(newElt)->rest()->tuplet()->lastNote())->yPos();
-                        if (y2 > drawableContext->yPos() && y2 < drawableContext->yPos() + drawableContext->height()) {
-                            y2 = drawableContext->yPos() + drawableContext->height() + 10; // inside the staff
-                        } else if (y2 < drawableContext->yPos()) {
-                            y2 -= 10; // above the staff
-                        } else {
-                            y2 += 10; // under the staff
-                        }
-
-                        /// \todo replace raw pointer with shared or unique pointer
-                        CADrawableTuplet* dTuplet = new CADrawableTuplet(static_cast<CADrawableRest*>(newElt)->rest()->tuplet(), drawableContext, x1, y1, x2, y2);
-                        v->addMElement(dTuplet);
+                        placeTuplet(v, static_cast<CADrawableRest*>(newElt)->rest()->tuplet(), newElt, drawableContext, reusableTuplets);
                     }
 
                     placeMarks(newElt, v, static_cast<int>(i));
@@ -981,14 +1263,127 @@ void CALayoutEngine::reposit(CAScoreView* v)
                 streamsIdx[i]++;
             }
         }
+
+        placePendingMarks(v);
+
+        // queue the next elements of the processed streams
+        for (int a = 0; a < activeStreams.size(); a++) {
+            unsigned int i = activeStreams[a];
+            if (streamsIdx[i] < musStreamList[static_cast<int>(i)].size())
+                onsets.push(CALayoutOnset(musStreamList[static_cast<int>(i)].at(streamsIdx[i])->timeStart(), i));
+        }
+    }
+
+    if (incremental && !resume) {
+        // Shift the detached elements right of the settled column and destroy the re-engraved ones.
+        // Scalable elements which weren't re-engraved are placed again below.
+        double settledX = (settledColumn != -1) ? cache.columnList()[settledColumn].x : std::numeric_limits<double>::max();
+        QSet<CADrawableMusElement*> oldScalableElts;
+        for (int i = 0; i < cache.scalableElementList().size(); i++)
+            oldScalableElts.insert(cache.scalableElementList()[i]);
+
+        QList<CADrawableMusElement*> shiftedElts;
+        QSet<CADrawableMusElement*> shiftedSet;
+        for (int i = 0; i < detachedElts.size(); i++) {
+            CADrawableMusElement* elt = detachedElts[i];
+            if (elt->drawableMusElementType() == CADrawableMusElement::DrawableTuplet && reusableTuplets.value(static_cast<CADrawableTuplet*>(elt)->tuplet()) != elt) {
+                continue; // moved by placeTuplet() and already added again
+            } else if (elt->xPos() >= settledX) {
+                elt->moveXPos(deltaX);
+                if (oldScalableElts.contains(elt)) {
+                    scalableElts << elt;
+                } else {
+                    shiftedElts << elt;
+                    shiftedSet.insert(elt);
+                }
+            } else if (elt->xPos() < restartX && oldScalableElts.contains(elt)) {
+                scalableElts << elt; // scalable element starting left of the re-engraved part
+            } else {
+                delete elt;
+            }
+        }
+
+        for (int i = 0; i < shiftedElts.size(); i++) {
+            v->addMElement(shiftedElts[i]);
+        }
+
+        // Connect the re-engraved part with the shifted one
+        for (int i = 0; i < shiftedElts.size(); i++) {
+            CADrawableMusElement* elt = shiftedElts[i];
+            switch (elt->drawableMusElementType()) {
+            case CADrawableMusElement::DrawableNote: {
+                CANote* note = static_cast<CADrawableNote*>(elt)->note();
+                CADrawableSlur* dSlur = nullptr;
+                if (note->tieEnd() && (dSlur = static_cast<CADrawableSlur*>(v->findMElement(note->tieEnd()))) && !shiftedSet.contains(dSlur))
+                    placeSlurEnd(dSlur, note->tieEnd(), elt, 5);
+                if (note->slurEnd() && (dSlur = static_cast<CADrawableSlur*>(v->findMElement(note->slurEnd()))) && !shiftedSet.contains(dSlur))
+                    placeSlurEnd(dSlur, note->slurEnd(), elt, 15);
+                if (note->phrasingSlurEnd() && (dSlur = static_cast<CADrawableSlur*>(v->findMElement(note->phrasingSlurEnd()))) && !shiftedSet.contains(dSlur))
+                    placeSlurEnd(dSlur, note->phrasingSlurEnd(), elt, 19);
+                break;
+            }
+            case CADrawableMusElement::DrawableSyllable:
+            case CADrawableMusElement::DrawableChordName: {
+                CAMusElement* prev = elt->drawableContext()->context()->previous(elt->musElement());
+                CADrawableMusElement* dPrev = (prev ? v->findMElement(prev) : nullptr);
+                if (dPrev && !shiftedSet.contains(dPrev))
+                    dPrev->setWidth(elt->xPos() - dPrev->xPos());
+                break;
+            }
+            default:
+                break;
+            }
+        }
+
+        for (int i = 0; i < detachedNCEs.size(); i++) {
+            if (detachedNCEs[i]->xPos() + 5 >= settledX) {
+                detachedNCEs[i]->moveXPos(deltaX);
+                v->addDrawableNoteCheckerError(detachedNCEs[i]);
+            } else {
+                delete detachedNCEs[i];
+            }
+        }
+
+        // Columns right of the settled one are the same as in the previous pass, only shifted
+        if (settledColumn != -1) {
+            const CALayoutColumn& oldColumn = cache.columnList()[settledColumn];
+            const CALayoutColumn newColumn = columns.last();
+            int deltaTime = newColumn.timeStart - oldColumn.timeStart;
+            for (int i = settledColumn + 1; i < cache.columnList().size(); i++) {
+                CALayoutColumn column = cache.columnList()[i];
+                column.timeStart += deltaTime;
+                column.x += deltaX;
+                for (int j = 0; j < column.streamsIdx.size(); j++) {
+                    column.streamsIdx[j] += newColumn.streamsIdx[j] - oldColumn.streamsIdx[j];
+                    if (column.fronts[j])
+                        column.frontTimes[j] += deltaTime;
+                }
+                columns << column;
+            }
+        }
     }
 
     // reposit the scalable elements (eg. crescendo)
-    for (int i = 0; i < scalableElts.size(); i++) {
+    // and add them afterwards, so the time index is built only once
+    for (int i = 0; i < scalableElts.size() && !stopped; i++) {
         scalableElts[i]->setXPos(v->timeToCoords(scalableElts[i]->musElement()->timeStart()));
         scalableElts[i]->setWidth(v->timeToCoords(scalableElts[i]->musElement()->timeEnd()) - scalableElts[i]->xPos());
+    }
+    for (int i = 0; i < scalableElts.size() && !stopped; i++) {
         v->addMElement(scalableElts[i]);
     }
+
+    // store the layout state for the next incremental pass
+    cache.clear();
+    cache.streamList() = streamOwners;
+    for (int i = 0; i < musStreamList.size(); i++) {
+        cache.streamSizes() << musStreamList[i].size();
+        cache.streamLastTimes() << (musStreamList[i].size() ? musStreamList[i].last()->timeStart() : -1);
+    }
+    cache.columnList() = columns;
+    cache.scalableElementList() = scalableElts;
+    cache.setComplete(!stopped);
+
     delete[] streamsIdx;
     delete[] streamsX;
     delete[] streamsRehersalMarks;
@@ -996,62 +1391,258 @@ void CALayoutEngine::reposit(CAScoreView* v)
     delete[] lastKeySig;
     delete[] lastTimeSig;
     delete[] lastDFMTonicizations;
+
+    return true;
 }
 
 /*!
-	Place marks for the given music element.
+	Returns True, if the layout can be resumed at the given \a column of the previous pass with the
+	current streams \a musStreamList. The elements left of the column must be unchanged and the
+	column shouldn't split a tuplet.
 */
-void CALayoutEngine::placeMarks(CADrawableMusElement* e, CAScoreView* v, int streamIdx)
+bool CALayoutEngine::isValidRestart(const CALayoutColumn& column, const QList<QList<CAMusElement*>>& musStreamList)
 {
-    CAMusElement* elt = e->musElement();
-    double xCoord = e->xPos();
+    if (column.streamsIdx.size() != musStreamList.size()) {
+        return false;
+    }
+
+    for (int i = 0; i < musStreamList.size(); i++) {
+        int idx = column.streamsIdx[i];
+        if (idx > musStreamList[i].size()) {
+            return false;
+        }
+        if (idx > 0 && musStreamList[i][idx - 1]->timeStart() >= column.timeStart) {
+            return false;
+        }
+        if (idx < musStreamList[i].size()) {
+            CAMusElement* front = musStreamList[i][idx];
+            if (front->timeStart() < column.timeStart) {
+                return false;
+            }
+            if (front->isPlayable() && static_cast<CAPlayable*>(front)->tuplet() && !static_cast<CAPlayable*>(front)->isFirstInTuplet()) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
 
-    for (int i = 0, j = 0, k = 0; i < elt->markList().size(); i++) { // j/k are vertical offsets above/below the staff
-        if (elt->markList()[i]->isCommon() && elt->musElementType() == CAMusElement::Note && !static_cast<CANote*>(elt)->isFirstInChord()) {
+/*!
+	Returns True, if the current pass reached the \a newColumn which corresponds to the \a oldColumn
+	of the previous pass stored in \a cache, so the elements right of it can be shifted instead of
+	re-engraved.
+
+	All the streams in \a musStreamList need to continue with the same elements shifted by the same
+	time, the clefs, key and time signatures need to be the same and no elements should have been
+	added or removed right of the column. Detached \a tuplets crossing the column cannot be shifted.
+*/
+bool CALayoutEngine::isSettled(const CALayoutColumn& oldColumn, const CALayoutColumn& newColumn, CALayoutCache& cache, const QList<QList<CAMusElement*>>& musStreamList, const QList<QPair<double, double>>& tuplets)
+{
+    int deltaTime = newColumn.timeStart - oldColumn.timeStart;
+    for (int i = 0; i < newColumn.fronts.size(); i++) {
+        if (newColumn.fronts[i] != oldColumn.fronts[i] || newColumn.lastClef[i] != oldColumn.lastClef[i] || newColumn.lastKeySig[i] != oldColumn.lastKeySig[i] || newColumn.lastTimeSig[i] != oldColumn.lastTimeSig[i] || newColumn.rehersalMarks[i] != oldColumn.rehersalMarks[i]) {
+            return false;
+        }
+
+        if (!newColumn.fronts[i]) {
             continue;
         }
 
-        CAMark* mark = elt->markList()[i];
-
-        double yCoord;
-        CAFingering* fingering = dynamic_cast<CAFingering*>(mark);
-        if (mark->markType() == CAMark::Pedal || (fingering && (fingering->fingerList()[0] == CAFingering::LHeel || fingering->fingerList()[0] == CAFingering::LToe)) || (elt->musElementType() == CAMusElement::Note && static_cast<CANote*>(elt)->actualSlurDirection() == CASlur::SlurDown && ((mark->markType() == CAMark::Text) || (mark->markType() == CAMark::Fermata) || (mark->markType() == CAMark::Articulation)))) {
-            // place mark below
-            xCoord = e->xPos();
-            yCoord = qMax(e->yPos() + e->height(), e->drawableContext()->yPos() + e->drawableContext()->height()) + 20 * (k + 1);
-            k++;
-        } else if (elt->musElementType() == CAMusElement::Note && static_cast<CANote*>(elt)->isPartOfChord() && fingering && fingering->fingerList()[0] < 6) {
-            // place mark beside the note
-            xCoord = e->xPos() + e->width();
-            yCoord = e->yPos() - 2;
-        } else if (mark->markType() == CAMark::Articulation && static_cast<CAArticulation*>(mark)->articulationType() == CAArticulation::Breath) {
-            // place breath mark above right
-            xCoord = e->xPos() + 1.2 * e->width();
-            yCoord = qMin(e->yPos() - 2.5 * e->height(), e->drawableContext()->yPos() - 20);
-        } else if (mark->markType() == CAMark::Articulation) {
-            // place other articulation marks above center
-            xCoord = e->xPos() + e->width() / 2.0 - 3;
-            yCoord = qMin(e->yPos(), e->drawableContext()->yPos()) - 20 * (j + 1);
-            j++;
+        if (newColumn.frontTimes[i] - oldColumn.frontTimes[i] != deltaTime) {
+            return false;
+        }
+
+        if (musStreamList[i].size() - cache.streamSizes()[i] != newColumn.streamsIdx[i] - oldColumn.streamsIdx[i] || musStreamList[i].last()->timeStart() - cache.streamLastTimes()[i] != deltaTime) {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < tuplets.size(); i++) {
+        if (tuplets[i].first < oldColumn.x && tuplets[i].second > oldColumn.x) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*!
+	Places the drawable \a tuplet ending with the drawable note or rest \a dLast in the drawable
+	context \a c. The bracket is placed above or under the first and the last note.
+
+	If the tuplet was detached by the incremental layout and its bracket didn't change, the old
+	drawable tuplet is moved to the new position and removed from \a reusableTuplets instead of
+	creating a new one. This keeps its computed bracket.
+*/
+void CALayoutEngine::placeTuplet(CAScoreView* v, CATuplet* tuplet, CADrawableMusElement* dLast, CADrawableContext* c, QHash<CATuplet*, CADrawableTuplet*>& reusableTuplets)
+{
+    CADrawableMusElement* dFirst = v->findMElement(tuplet->firstNote());
+    double x1 = dFirst->xPos();
+    double x2 = dLast->xPos() + dLast->width();
+    double y[2] = { dFirst->yPos(), v->findMElement(tuplet->lastNote())->yPos() };
+    for (double& yi : y) {
+        if (yi > c->yPos() && yi < c->yPos() + c->height()) {
+            yi = c->yPos() + c->height() + 10; // inside the staff
+        } else if (yi < c->yPos()) {
+            yi -= 10; // above the staff
         } else {
-            // place mark above
-            xCoord = e->xPos();
-            yCoord = qMin(e->yPos(), e->drawableContext()->yPos()) - 20 * (j + 1);
-            j++;
+            yi += 10; // under the staff
         }
+    }
 
+    CADrawableTuplet* dTuplet = reusableTuplets.value(tuplet);
+    if (dTuplet && dTuplet->hasBracket(tuplet, c, x1, y[0], x2, y[1])) {
+        dTuplet->moveXPos(x1 - dTuplet->x1());
+        reusableTuplets.remove(tuplet);
+    } else {
         /// \todo replace raw pointer with shared or unique pointer
-        CADrawableMark* m = new CADrawableMark(mark, e->drawableContext(), xCoord, yCoord);
+        dTuplet = new CADrawableTuplet(tuplet, c, x1, y[0], x2, y[1]);
+    }
+    v->addMElement(dTuplet);
+}
 
-        if (mark->markType() == CAMark::RehersalMark)
-            m->setRehersalMarkNumber(streamsRehersalMarks[streamIdx]++);
+/*!
+	Sets the end coordinates of the drawable slur \a dSlur of the given \a slur, tie or phrasing slur
+	to the drawable note \a dNote. \a curvature is the vertical distance of the middle point.
+*/
+void CALayoutEngine::placeSlurEnd(CADrawableSlur* dSlur, CASlur* slur, CADrawableMusElement* dNote, double curvature)
+{
+    if (!dSlur) {
+        return;
+    }
 
-        if (m->isHScalable() || m->isVScalable()) {
-            scalableElts << m;
-        } else {
-            v->addMElement(m);
+    CASlur::CASlurDirection dir = slur->slurDirection();
+    if (dir == CASlur::SlurPreferred || dir == CASlur::SlurNeutral)
+        dir = slur->noteStart()->actualSlurDirection();
+
+    dSlur->setX2(dNote->xPos());
+    dSlur->setXMid(qRound(0.5 * dSlur->xPos() + 0.5 * dNote->xPos()));
+    if (dir == CASlur::SlurUp) {
+        dSlur->setY2(dNote->yPos());
+        dSlur->setYMid(qMin(dSlur->y2(), dSlur->y1()) - curvature);
+    } else if (dir == CASlur::SlurDown) {
+        dSlur->setY2(dNote->yPos() + dNote->height());
+        dSlur->setYMid(qMax(dSlur->y2(), dSlur->y1()) + curvature);
+    }
+}
+
+/*!
+	Place marks for the given music element.
+*/
+/*!
+	Queues the marks of the drawable element \a e placed in the stream \a streamIdx. The marks are
+	placed by placePendingMarks() together with the marks of the other elements at the same time.
+
+	The rehersal marks are numbered here, so the numbers stored in the layout columns are correct.
+*/
+void CALayoutEngine::placeMarks(CADrawableMusElement* e, CAScoreView*, int streamIdx)
+{
+    CAMusElement* elt = e->musElement();
+    CAPendingMarks pending;
+    pending.elt = e;
+    pending.rehersalMark = streamsRehersalMarks[streamIdx];
+    pending.chordNote = false;
+
+    const QList<CAMark*>& markList = elt->markList();
+    if (!markList.isEmpty()) {
+        pending.chordNote = (elt->musElementType() == CAMusElement::Note && !static_cast<CANote*>(elt)->isFirstInChord());
+        for (CAMark* mark : elt->marksOfType<CAMark>(CAMark::RehersalMark)) {
+            if (!(mark->isCommon() && pending.chordNote)) {
+                streamsRehersalMarks[streamIdx]++;
+            }
         }
     }
+
+    pendingMarks << pending;
+}
+
+/*!
+	Places the marks of all the elements queued by placeMarks() and clears the queue.
+
+	The marks above and below the staffs are stacked using a skyline of each drawable context built
+	from all the queued elements, so the marks of a chord clear all its notes and the marks of the
+	elements in different voices at the same time don't overlap.
+*/
+void CALayoutEngine::placePendingMarks(CAScoreView* v)
+{
+    QHash<CADrawableContext*, CAMarkSkyline> skylines;
+    for (int i = 0; i < pendingMarks.size(); i++) {
+        CADrawableMusElement* e = pendingMarks[i].elt;
+        CAMarkSkyline& skyline = skylines[e->drawableContext()];
+        skyline.above << CAMarkSkyline::Segment{ e->xPos(), e->xPos() + e->width(), qMin(e->yPos(), e->drawableContext()->yPos()) };
+        skyline.below << CAMarkSkyline::Segment{ e->xPos(), e->xPos() + e->width(), qMax(e->yPos() + e->height(), e->drawableContext()->yPos() + e->drawableContext()->height()) };
+    }
+
+    for (int p = 0; p < pendingMarks.size(); p++) {
+        CADrawableMusElement* e = pendingMarks[p].elt;
+        CAMusElement* elt = e->musElement();
+        const QList<CAMark*>& markList = elt->markList();
+        if (markList.isEmpty()) {
+            continue;
+        }
+
+        CAMarkSkyline& skyline = skylines[e->drawableContext()];
+        int rehersalMark = pendingMarks[p].rehersalMark;
+        CASlur::CASlurDirection slurDirection = ((elt->musElementType() == CAMusElement::Note) ? static_cast<CANote*>(elt)->actualSlurDirection() : CASlur::SlurUp);
+        bool partOfChord = (elt->musElementType() == CAMusElement::Note && static_cast<CANote*>(elt)->isPartOfChord());
+
+        for (int i = 0; i < markList.size(); i++) {
+            CAMark* mark = markList[i];
+            if (mark->isCommon() && pendingMarks[p].chordNote) {
+                continue;
+            }
+
+            enum { Above, Below, Fixed } stack = Fixed;
+            double xCoord = e->xPos();
+            double yCoord = e->yPos();
+            CAFingering* fingering = dynamic_cast<CAFingering*>(mark);
+            if (mark->markType() == CAMark::Pedal || (fingering && (fingering->fingerList()[0] == CAFingering::LHeel || fingering->fingerList()[0] == CAFingering::LToe)) || (elt->musElementType() == CAMusElement::Note && slurDirection == CASlur::SlurDown && ((mark->markType() == CAMark::Text) || (mark->markType() == CAMark::Fermata) || (mark->markType() == CAMark::Articulation)))) {
+                // place mark below
+                stack = Below;
+            } else if (partOfChord && fingering && fingering->fingerList()[0] < 6) {
+                // place mark beside the note
+                xCoord = e->xPos() + e->width();
+                yCoord = e->yPos() - 2;
+            } else if (mark->markType() == CAMark::Articulation && static_cast<CAArticulation*>(mark)->articulationType() == CAArticulation::Breath) {
+                // place breath mark above right
+                xCoord = e->xPos() + 1.2 * e->width();
+                yCoord = qMin(e->yPos() - 2.5 * e->height(), e->drawableContext()->yPos() - 20);
+            } else if (mark->markType() == CAMark::Articulation) {
+                // place other articulation marks above center
+                xCoord = e->xPos() + e->width() / 2.0 - 3;
+                stack = Above;
+            } else {
+                // place mark above
+                stack = Above;
+            }
+
+            /// \todo replace raw pointer with shared or unique pointer
+            CADrawableMark* m = new CADrawableMark(mark, e->drawableContext(), xCoord, yCoord);
+
+            if (stack != Fixed) {
+                double x2 = xCoord + ((m->isHScalable() || m->isVScalable()) ? e->width() : m->width());
+                if (stack == Above) {
+                    m->setYPos(skyline.top(xCoord, x2) - 20);
+                    skyline.above << CAMarkSkyline::Segment{ xCoord, x2, m->yPos() };
+                } else {
+                    m->setYPos(skyline.bottom(xCoord, x2) + 20);
+                    skyline.below << CAMarkSkyline::Segment{ xCoord, x2, m->yPos() };
+                }
+            }
+
+            if (mark->markType() == CAMark::RehersalMark)
+                m->setRehersalMarkNumber(rehersalMark++);
+
+            if (m->isHScalable() || m->isVScalable()) {
+                scalableElts << m;
+            } else {
+                v->addMElement(m);
+            }
+        }
+    }
+
+    pendingMarks.clear();
 }
 
 void CALayoutEngine::placeNoteCheckerErrors(CADrawableMusElement* dMusElt, CAScoreView* v)
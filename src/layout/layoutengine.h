@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2009, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -8,20 +8,46 @@
 #ifndef LAYOUTENGINE_
 #define LAYOUTENGINE_
 
+#include <QHash>
 #include <QList>
+#include <QPair>
 
+class CAProgress;
 class CAScoreView;
+class CAMusElement;
 class CADrawableMusElement;
+class CADrawableSlur;
+class CADrawableContext;
+class CADrawableTuplet;
+class CALayoutCache;
+class CASlur;
+class CATuplet;
+struct CALayoutColumn;
 
 class CALayoutEngine {
 public:
-    static void reposit(CAScoreView* v);
+    static void reposit(CAScoreView* v, int xLimit = 0, CAProgress* progress = nullptr);
+    static bool repositRegion(CAScoreView* v, int timeStart, int timeEnd);
+    static bool repositRemaining(CAScoreView* v, int xLimit = 0, CAProgress* progress = nullptr);
 
 private:
+    static bool repositStreams(CAScoreView* v, bool incremental, int regionStart, int regionEnd, int xLimit, CAProgress* progress);
+    static bool isValidRestart(const CALayoutColumn& column, const QList<QList<CAMusElement*>>& musStreamList);
+    static bool isSettled(const CALayoutColumn& oldColumn, const CALayoutColumn& newColumn, CALayoutCache& cache, const QList<QList<CAMusElement*>>& musStreamList, const QList<QPair<double, double>>& tuplets);
+    static void placeTuplet(CAScoreView* v, CATuplet* tuplet, CADrawableMusElement* dLast, CADrawableContext* c, QHash<CATuplet*, CADrawableTuplet*>& reusableTuplets);
+    static void placeSlurEnd(CADrawableSlur* dSlur, CASlur* slur, CADrawableMusElement* dNote, double curvature);
     static void placeMarks(CADrawableMusElement*, CAScoreView*, int);
+    static void placePendingMarks(CAScoreView* v);
     static void placeNoteCheckerErrors(CADrawableMusElement*, CAScoreView*);
     static int* streamsRehersalMarks;
     static QList<CADrawableMusElement*> scalableElts;
+
+    struct CAPendingMarks {
+        CADrawableMusElement* elt;
+        int rehersalMark; // number of the first rehersal mark of the element
+        bool chordNote; // the element is a note in a chord, but not the first one, so its common marks are skipped
+    };
+    static QList<CAPendingMarks> pendingMarks; // elements placed at the current time, see placeMarks()
 };
 
 #endif /* LAYOUTENGINE_ */
@@ -0,0 +1,133 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QPainter>
+
+#include "layout/overviewrenderer.h"
+
+#include "layout/drawablecontext.h"
+#include "layout/drawablemuselement.h"
+#include "layout/sheetlayout.h"
+#include "score/muselement.h"
+
+#include "core/trace.h"
+
+const double CAOverviewRenderer::MAX_ZOOM = 0.35;
+
+namespace {
+
+const int staffAlpha = 48; // staff block fill
+const int elementAlpha = 96; // overlapping elements of dense bars add up to a darker shade
+
+}
+
+/*!
+	\class CAOverviewRenderer
+	\brief Level-of-detail rendering of the sheet layout at low zoom levels
+
+	At zoom levels up to MAX_ZOOM the glyphs are only a few pixels large, but painting them is as
+	expensive as at full size. The overview renderer draws the drawables of the shared CASheetLayout
+	as simplified shapes instead:
+	- staffs as shaded blocks framed by their top and bottom lines,
+	- barlines as vertical lines across the staff,
+	- other music elements as semi-transparent boxes, so the bars with more notes appear darker,
+	- selected elements as boxes in the selection color.
+
+	CAScoreView uses it for the tiles when zoomed out. thumbnail() fits the whole sheet into an image,
+	which can be used for tab previews or a minimap.
+*/
+
+/*!
+	Draws the contexts and music elements of \a layout inside the \a world rectangle at \a zoom.
+	The top-left corner of \a world is drawn at the painter's origin.
+*/
+void CAOverviewRenderer::render(QPainter* p, CASheetLayout* layout, const QRectF& world, double zoom, const QColor& color)
+{
+    CA_TRACE_ZONE("CAOverviewRenderer::render");
+    QColor staffColor(color);
+    staffColor.setAlpha(staffAlpha);
+    QColor elementColor(color);
+    elementColor.setAlpha(elementAlpha);
+
+    p->save();
+    p->setRenderHint(QPainter::Antialiasing, false);
+
+    QList<CADrawableContext*> cList = layout->drawableCList().findInRange(world.x(), world.y(), world.width(), world.height());
+    for (int i = 0; i < cList.size(); i++) {
+        QRectF r = deviceRect(cList[i]->bBox(), world, zoom);
+        r.setLeft(qMax(r.left(), 0.0));
+        r.setRight(qMin(r.right(), world.width() * zoom));
+
+        if (cList[i]->drawableContextType() == CADrawableContext::DrawableStaff) {
+            p->fillRect(r, staffColor);
+            p->setPen(color);
+            p->drawLine(r.topLeft(), r.topRight());
+            p->drawLine(r.bottomLeft(), r.bottomRight());
+        } else {
+            p->fillRect(r, QColor(staffColor.red(), staffColor.green(), staffColor.blue(), staffAlpha / 2));
+        }
+    }
+
+    QList<CADrawableMusElement*> mList = layout->drawableMList().findInRange(world.x(), world.y(), world.width(), world.height());
+    for (int i = 0; i < mList.size(); i++) {
+        CAMusElement* elt = mList[i]->musElement();
+        if (elt && !elt->isVisible()) {
+            continue;
+        }
+
+        if (mList[i]->drawableMusElementType() == CADrawableMusElement::DrawableBarline) {
+            QRectF r = deviceRect(mList[i]->bBox(), world, zoom);
+            p->setPen(color);
+            p->drawLine(QPointF(r.center().x(), r.top()), QPointF(r.center().x(), r.bottom()));
+        } else {
+            p->fillRect(deviceRect(mList[i]->bBox(), world, zoom), elementColor);
+        }
+    }
+
+    p->restore();
+}
+
+/*!
+	Draws the \a selection as boxes in the given \a color. Used over the tiles rendered by render().
+*/
+void CAOverviewRenderer::renderSelection(QPainter* p, const QList<CADrawableMusElement*>& selection, const QRectF& world, double zoom, const QColor& color)
+{
+    for (int i = 0; i < selection.size(); i++) {
+        p->fillRect(deviceRect(selection[i]->bBox(), world, zoom), color);
+    }
+}
+
+/*!
+	Renders the whole \a layout scaled to fit into an image of the given \a size keeping the aspect
+	ratio. The image is filled with the \a background color.
+*/
+QImage CAOverviewRenderer::thumbnail(CASheetLayout* layout, const QSize& size, const QColor& background, const QColor& color)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(background);
+
+    double worldW = qMax(layout->drawableMList().getMaxX(), layout->drawableCList().getMaxX());
+    double worldH = qMax(layout->drawableMList().getMaxY(), layout->drawableCList().getMaxY());
+    if (worldW <= 0 || worldH <= 0) {
+        return image;
+    }
+
+    double zoom = qMin(size.width() / worldW, size.height() / worldH);
+    QPainter p(&image);
+    render(&p, layout, QRectF(0, 0, worldW, worldH), zoom, color);
+
+    return image;
+}
+
+/*!
+	Converts the bounding box \a bBox in world coordinates to the device coordinates. Boxes are at
+	least a pixel large, so the tiny elements don't disappear.
+*/
+QRectF CAOverviewRenderer::deviceRect(const QRectF& bBox, const QRectF& world, double zoom)
+{
+    return QRectF((bBox.x() - world.x()) * zoom, (bBox.y() - world.y()) * zoom, qMax(1.0, bBox.width() * zoom), qMax(1.0, bBox.height() * zoom));
+}
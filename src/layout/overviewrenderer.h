@@ -0,0 +1,32 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef OVERVIEWRENDERER_H_
+#define OVERVIEWRENDERER_H_
+
+#include <QColor>
+#include <QImage>
+#include <QList>
+#include <QRectF>
+
+class QPainter;
+class CADrawableMusElement;
+class CASheetLayout;
+
+class CAOverviewRenderer {
+public:
+    static void render(QPainter* p, CASheetLayout* layout, const QRectF& world, double zoom, const QColor& color);
+    static void renderSelection(QPainter* p, const QList<CADrawableMusElement*>& selection, const QRectF& world, double zoom, const QColor& color);
+    static QImage thumbnail(CASheetLayout* layout, const QSize& size, const QColor& background = Qt::white, const QColor& color = Qt::black);
+
+    static const double MAX_ZOOM;
+
+private:
+    static QRectF deviceRect(const QRectF& bBox, const QRectF& world, double zoom);
+};
+
+#endif /* OVERVIEWRENDERER_H_ */
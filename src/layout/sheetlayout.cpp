@@ -0,0 +1,396 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QCryptographicHash>
+#include <QTimer>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+#include <algorithm>
+
+#include "layout/sheetlayout.h"
+#include "core/archive.h"
+
+#include "layout/drawablecontext.h"
+#include "layout/drawablemuselement.h"
+#include "layout/drawablenotecheckererror.h"
+#include "score/accidentalstate.h"
+#include "score/document.h"
+#include "score/lyricscontext.h"
+#include "score/muselement.h"
+#include "score/sheet.h"
+#include "score/staff.h"
+#include "score/voice.h"
+
+QHash<CASheet*, std::weak_ptr<CASheetLayout>> CASheetLayout::_layouts;
+QHash<CASheet*, CASheetLayout::CALayoutHint> CASheetLayout::_hints;
+
+/*!
+	\class CASheetLayout
+	\brief Engraved layout of a sheet shared by all the score views showing it
+
+	The layout owns the drawable elements and contexts created by CALayoutEngine and the layout cache
+	of the last pass. Score views of the same sheet (split views or views in different main windows)
+	share a single layout, so the sheet is engraved once and the drawable elements are kept in memory
+	only once. Each view keeps only its own world coordinates, zoom, selection, shadow notes and the
+	rendered tiles.
+
+	A view doing the layout pass notifies the other views in viewList() to drop their pointers to the
+	drawable elements before they are destroyed and to restore them afterwards, see
+	CAScoreView::rebuild().
+
+	The layout is destroyed together with its drawable elements, when the last view releases it.
+
+	Views folding some of the contexts (see CAScoreView::setContextHidden()) get their own layout
+	without the hidden contexts, so the layout and paint cost depends only on the shown staffs.
+	These layouts are not shared.
+
+	\sa forSheet(), CAScoreView::rebuild()
+*/
+
+CASheetLayout::CASheetLayout(CASheet* sheet)
+    : _sheet(sheet)
+    , _timeIndexValid(false)
+    , _builtBy(nullptr)
+    , _generation(0)
+    , _valid(false)
+    , _fresh(false)
+{
+}
+
+CASheetLayout::~CASheetLayout()
+{
+    clear();
+
+    if (_sheet && _layouts.contains(_sheet) && _layouts[_sheet].expired()) {
+        _layouts.remove(_sheet);
+    }
+}
+
+/*!
+	Returns the layout of the given \a sheet shared by its views. A new empty layout is created, if
+	the sheet isn't shown yet. Layouts of null sheets are never shared.
+
+	If \a hiddenContexts are given, a new layout leaving out these contexts is always created and
+	it isn't shared with the other views.
+*/
+std::shared_ptr<CASheetLayout> CASheetLayout::forSheet(CASheet* sheet, const QSet<CAContext*>& hiddenContexts)
+{
+    std::shared_ptr<CASheetLayout> layout;
+    if (!hiddenContexts.isEmpty()) {
+        layout = std::shared_ptr<CASheetLayout>(new CASheetLayout(sheet));
+        layout->_hiddenContexts = hiddenContexts;
+        return layout;
+    }
+
+    if (sheet) {
+        layout = _layouts.value(sheet).lock();
+    }
+
+    if (!layout) {
+        layout = std::shared_ptr<CASheetLayout>(new CASheetLayout(sheet));
+        if (sheet) {
+            _layouts[sheet] = layout;
+        }
+    }
+
+    return layout;
+}
+
+/*!
+	Returns True, if the \a context is left out of the layout. The lyrics of the voices in a hidden
+	staff are hidden together with the staff.
+*/
+bool CASheetLayout::isHidden(CAContext* context)
+{
+    if (_hiddenContexts.isEmpty()) {
+        return false;
+    }
+
+    if (context->contextType() == CAContext::LyricsContext) {
+        CAVoice* voice = static_cast<CALyricsContext*>(context)->associatedVoice();
+        if (voice && _hiddenContexts.contains(voice->staff())) {
+            return true;
+        }
+    }
+
+    return _hiddenContexts.contains(context);
+}
+
+/*!
+	Returns True, if the given \a sheet has a layout shown by any view.
+*/
+bool CASheetLayout::isShown(CASheet* sheet)
+{
+    return sheet && !_layouts.value(sheet).expired();
+}
+
+/*!
+	Returns the layout hints of the sheets of the document \a doc, which are stored next to the
+	CanorusML \a content in the .can archive. Returns an empty array, if no sheet has a complete layout.
+
+	Only the extents of the complete layouts are stored together with the hash of the content. They
+	are used by loadLayoutHints() when the document is opened again, so the views have their final
+	scroll range while the visible part is laid out.
+
+	\sa CACanExport
+*/
+QByteArray CASheetLayout::saveLayoutHints(CADocument* doc, const QByteArray& content)
+{
+    QByteArray data;
+    QXmlStreamWriter xml(&data);
+    xml.writeStartDocument();
+    xml.writeStartElement("layout");
+    xml.writeAttribute("content-hash", QCryptographicHash::hash(content, QCryptographicHash::Sha1).toHex());
+
+    bool empty = true;
+    for (int i = 0; i < doc->sheetList().size(); i++) {
+        std::shared_ptr<CASheetLayout> layout = _layouts.value(doc->sheetList()[i]).lock();
+        if (!layout || !layout->isCurrent() || !layout->layoutCache().isComplete()) {
+            continue;
+        }
+
+        xml.writeStartElement("sheet");
+        xml.writeAttribute("index", QString::number(i));
+        xml.writeAttribute("width", QString::number(qMax(layout->drawableMList().getMaxX(), layout->drawableCList().getMaxX())));
+        xml.writeEndElement();
+        empty = false;
+    }
+
+    xml.writeEndElement();
+    xml.writeEndDocument();
+
+    return (empty ? QByteArray() : data);
+}
+
+/*!
+	Reads the layout hints stored by saveLayoutHints() in the archive of the opened document \a doc.
+	The hints are ignored, if the content was changed by another application in the meantime, and
+	are dropped on the first change of the document. The hints of the previously opened document are
+	dropped.
+*/
+void CASheetLayout::loadLayoutHints(CADocument* doc)
+{
+    _hints.clear();
+    if (!doc->archive() || !doc->archive()->contains("layout.xml")) {
+        return;
+    }
+
+    QString contentFileName = doc->archive()->contains("content.bin") ? "content.bin" : "content.xml";
+    if (!doc->archive()->contains(contentFileName)) {
+        return;
+    }
+
+    CAIOPtr content = doc->archive()->file(contentFileName);
+    QByteArray contentHash = QCryptographicHash::hash(content->readAll(), QCryptographicHash::Sha1).toHex();
+
+    CAIOPtr layout = doc->archive()->file("layout.xml");
+    QXmlStreamReader xml(&*layout);
+    while (xml.readNextStartElement()) {
+        if (xml.name() == "layout") {
+            if (xml.attributes().value("content-hash").toString().toLatin1() != contentHash) {
+                return;
+            }
+        } else if (xml.name() == "sheet") {
+            int idx = xml.attributes().value("index").toString().toInt();
+            if (idx >= 0 && idx < doc->sheetList().size()) {
+                CALayoutHint hint;
+                hint.document = doc;
+                hint.generation = doc->generation();
+                hint.width = xml.attributes().value("width").toString().toDouble();
+                _hints[doc->sheetList()[idx]] = hint;
+            }
+            xml.skipCurrentElement();
+        } else {
+            xml.skipCurrentElement();
+        }
+    }
+}
+
+/*!
+	Returns the accidentals in effect in the \a staff used when placing the accidentals. The state
+	is built on the first call after clearAccidentalStates(), which is called by each complete
+	layout pass. The incremental passes update it, see CAAccidentalState::update().
+*/
+CAAccidentalState& CASheetLayout::accidentalState(CAStaff* staff)
+{
+    std::shared_ptr<CAAccidentalState>& state = _accidentalStates[staff];
+    if (!state) {
+        state = std::make_shared<CAAccidentalState>(staff);
+        state->rebuild();
+    }
+    return *state;
+}
+
+/*!
+	Returns the width of the complete layout stored in the opened file or 0, if not known or if the
+	sheet has changed since.
+
+	\sa loadLayoutHints()
+*/
+double CASheetLayout::hintedWidth()
+{
+    QHash<CASheet*, CALayoutHint>::iterator it = _hints.find(_sheet);
+    if (it == _hints.end()) {
+        return 0;
+    }
+
+    if (!_sheet->document() || _sheet->document() != it->document || _sheet->document()->generation() != it->generation) {
+        _hints.erase(it);
+        return 0;
+    }
+
+    return it->width;
+}
+
+/*!
+	Moves the layout to the given \a sheet, eg. when the views are switched to the sheet replacing
+	it on undo. The drawable elements are kept until the next layout pass. The hidden contexts
+	belong to the old sheet, so all the contexts are shown again.
+*/
+void CASheetLayout::setSheet(CASheet* sheet)
+{
+    _hiddenContexts.clear();
+
+    if (_sheet && _layouts.value(_sheet).lock().get() == this) {
+        _layouts.remove(_sheet);
+    }
+
+    _sheet = sheet;
+    _valid = false;
+    if (_sheet) {
+        _layouts[_sheet] = shared_from_this();
+    }
+}
+
+/*!
+	Returns the horizontal positions of the times in the sheet sorted by time.
+
+	The index contains the start time and the left border of the leftmost drawable element placed in
+	any voice at that time and ends with the end of the last element. Both the times and the X
+	coordinates are monotonic, so the conversions in both directions are a single binary search, see
+	CAScoreView::timeToCoords() and CAScoreView::coordsToTime().
+
+	The index is built on the first call after the drawable elements of the voices were changed.
+*/
+const QVector<CATimeCoord>& CASheetLayout::timeIndex()
+{
+    if (_timeIndexValid) {
+        return _timeIndex;
+    }
+
+    _timeIndex.clear();
+    CATimeCoord end = { 0, 0 };
+    QList<CADrawableMusElement*> elts = _drawableMList.list();
+    for (int i = 0; i < elts.size(); i++) {
+        CAMusElement* elt = elts[i]->musElement();
+        if (!elt) {
+            continue;
+        }
+
+        switch (elt->musElementType()) {
+        case CAMusElement::Note:
+        case CAMusElement::Rest:
+        case CAMusElement::MidiNote:
+        case CAMusElement::Barline:
+        case CAMusElement::Clef:
+        case CAMusElement::TimeSignature:
+        case CAMusElement::KeySignature: {
+            CATimeCoord coord = { elt->timeStart(), elts[i]->xPos() };
+            _timeIndex << coord;
+            end.time = qMax(end.time, elt->timeEnd());
+            end.x = qMax(end.x, elts[i]->xPos() + elts[i]->width());
+            break;
+        }
+        default:
+            break; // marks, slurs, lyrics etc. are not placed in the voice columns
+        }
+    }
+
+    std::sort(_timeIndex.begin(), _timeIndex.end(), [](const CATimeCoord& a, const CATimeCoord& b) {
+        return (a.time < b.time || (a.time == b.time && a.x < b.x));
+    });
+
+    // keep the leftmost element of each time and make the coordinates monotonic
+    int n = 0;
+    for (int i = 0; i < _timeIndex.size(); i++) {
+        if (n && _timeIndex[n - 1].time == _timeIndex[i].time) {
+            continue;
+        }
+
+        _timeIndex[n] = _timeIndex[i];
+        if (n && _timeIndex[n].x < _timeIndex[n - 1].x) {
+            _timeIndex[n].x = _timeIndex[n - 1].x;
+        }
+        n++;
+    }
+    _timeIndex.resize(n);
+
+    if (n && end.time > _timeIndex.last().time) {
+        end.x = qMax(end.x, _timeIndex.last().x);
+        _timeIndex << end;
+    }
+
+    _timeIndexValid = true;
+    return _timeIndex;
+}
+
+/*!
+	Destroys all the drawable elements and the layout cache.
+	The views must not point to any of the drawable elements anymore.
+*/
+void CASheetLayout::clear()
+{
+    _drawableMList.clear(true);
+    _drawableCList.clear(true);
+    _drawableNCEList.clear(true);
+    _mapDrawable.clear();
+    _layoutCache.clear();
+    _timeIndex.clear();
+    _timeIndexValid = false;
+
+    _valid = false;
+    _builtBy = nullptr;
+}
+
+/*!
+	Returns True, if the layout was built after the last change of the document.
+*/
+bool CASheetLayout::isCurrent()
+{
+    return _valid && _sheet && _sheet->document() && _sheet->document()->generation() == _generation;
+}
+
+/*!
+	Returns True, if another view than \a v has just built the current layout in this event loop
+	iteration. This is the case when all the views of a sheet are rebuilt one by one after a change
+	and only the first one needs to do the layout pass.
+*/
+bool CASheetLayout::isFresh(CAScoreView* v)
+{
+    return _fresh && _builtBy && _builtBy != v && isCurrent();
+}
+
+/*!
+	Marks the layout as built by the view \a v for the current document generation.
+*/
+void CASheetLayout::setBuilt(CAScoreView* v)
+{
+    _builtBy = v;
+    _valid = true;
+    _generation = ((_sheet && _sheet->document()) ? _sheet->document()->generation() : 0);
+
+    if (!_fresh) {
+        _fresh = true;
+        std::weak_ptr<CASheetLayout> layout = shared_from_this();
+        QTimer::singleShot(0, [layout]() {
+            if (std::shared_ptr<CASheetLayout> l = layout.lock()) {
+                l->_fresh = false;
+            }
+        });
+    }
+}
@@ -0,0 +1,106 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef SHEETLAYOUT_H_
+#define SHEETLAYOUT_H_
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMultiMap>
+#include <QSet>
+#include <QVector>
+
+#include "layout/kdtree.h"
+#include "layout/layoutcache.h"
+
+#include <memory>
+
+class CADocument;
+class CASheet;
+class CAScoreView;
+class CADrawable;
+class CADrawableMusElement;
+class CADrawableContext;
+class CADrawableNoteCheckerError;
+class CAAccidentalState;
+class CAStaff;
+class CAContext;
+
+struct CATimeCoord {
+    int time;
+    double x;
+};
+
+class CASheetLayout : public std::enable_shared_from_this<CASheetLayout> {
+public:
+    static std::shared_ptr<CASheetLayout> forSheet(CASheet* sheet, const QSet<CAContext*>& hiddenContexts = QSet<CAContext*>());
+    static bool isShown(CASheet* sheet);
+    static QByteArray saveLayoutHints(CADocument* doc, const QByteArray& content);
+    static void loadLayoutHints(CADocument* doc);
+    ~CASheetLayout();
+
+    inline CASheet* sheet() { return _sheet; }
+    void setSheet(CASheet* sheet);
+
+    inline const QSet<CAContext*>& hiddenContexts() { return _hiddenContexts; }
+    bool isHidden(CAContext* context);
+
+    inline CAKDTree<CADrawableMusElement*>& drawableMList() { return _drawableMList; }
+    inline CAKDTree<CADrawableContext*>& drawableCList() { return _drawableCList; }
+    inline CAKDTree<CADrawableNoteCheckerError*>& drawableNCEList() { return _drawableNCEList; }
+    inline QMultiMap<void*, CADrawable*>& mapDrawable() { return _mapDrawable; }
+    inline CALayoutCache& layoutCache() { return _layoutCache; }
+    inline int drawableCount() { return _drawableMList.size() + _drawableCList.size(); }
+
+    inline const QList<CAScoreView*>& viewList() { return _viewList; }
+    inline void addView(CAScoreView* v) { _viewList << v; }
+    inline void removeView(CAScoreView* v) { _viewList.removeAll(v); }
+
+    CAAccidentalState& accidentalState(CAStaff* staff);
+    inline void clearAccidentalStates() { _accidentalStates.clear(); }
+
+    double hintedWidth();
+    const QVector<CATimeCoord>& timeIndex();
+    inline void invalidateTimeIndex() { _timeIndexValid = false; }
+
+    void clear();
+    bool isCurrent();
+    bool isFresh(CAScoreView* v);
+    void setBuilt(CAScoreView* v);
+
+private:
+    CASheetLayout(CASheet* sheet);
+
+    CASheet* _sheet;
+    QSet<CAContext*> _hiddenContexts; // Contexts folded in the views of this layout, not laid out
+    CAKDTree<CADrawableMusElement*> _drawableMList; // Drawable music elements of the sheet stored in a tree for faster lookup
+    CAKDTree<CADrawableContext*> _drawableCList; // Drawable contexts (staffs, lyrics etc.) of the sheet
+    CAKDTree<CADrawableNoteCheckerError*> _drawableNCEList; // Drawable note checker errors
+    QMultiMap<void*, CADrawable*> _mapDrawable; // Mapping of all music elements/contexts in the sheet -> drawable elements
+    CALayoutCache _layoutCache; // State of the last layout pass used for re-engraving only the changed part of the score
+    QList<CAScoreView*> _viewList; // Views showing the layout
+    QVector<CATimeCoord> _timeIndex; // Horizontal position of each time in the sheet, see timeIndex()
+    bool _timeIndexValid;
+    QHash<CAStaff*, std::shared_ptr<CAAccidentalState>> _accidentalStates; // Accidentals in effect in the staffs, see accidentalState()
+
+    CAScoreView* _builtBy; // View which did the last layout pass
+    quint64 _generation; // Document generation the layout was built at
+    bool _valid; // False, if cleared since the last layout pass
+    bool _fresh; // The last layout pass was done in the current event loop iteration
+
+    static QHash<CASheet*, std::weak_ptr<CASheetLayout>> _layouts;
+
+    struct CALayoutHint {
+        CADocument* document;
+        quint64 generation; // document generation the hint is valid for
+        double width; // width of the complete layout
+    };
+    static QHash<CASheet*, CALayoutHint> _hints; // Layout extents stored in the opened document, see loadLayoutHints()
+};
+
+#endif /* SHEETLAYOUT_H_ */
@@ -0,0 +1,196 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QPainter>
+
+#include "layout/sheetrenderer.h"
+
+#include "layout/drawablecontext.h"
+#include "layout/drawablemuselement.h"
+#include "layout/overviewrenderer.h"
+#include "layout/sheetlayout.h"
+#include "score/muselement.h"
+#include "score/rest.h"
+#include "widgets/scoreview.h"
+
+#include "core/trace.h"
+
+namespace {
+
+const int margin = 20; // world units around the drawn area, so the elements reaching into it are drawn
+
+}
+
+/*!
+	\class CASheetRenderer
+	\brief Rendering of a sheet into an image without a window
+
+	Lays out the sheet and draws its contexts and music elements into a QImage or any QPainter at
+	the given zoom level and world rectangle. Unlike CAScoreView, nothing is cached in the tiles and
+	no selection, cursor or helpers are drawn, so the result only depends on the sheet. It is used
+	by the benchmarks, the layout checks and for the previews and thumbnails of the documents.
+
+	The layout engine still needs a score view to place the elements, so a hidden view is created
+	for it. It is never shown and doesn't need a main window, but a QApplication is required. Run
+	with the offscreen platform (QT_QPA_PLATFORM=offscreen) on the servers without a display.
+	The view shares the layout with the other views of the sheet, if any (see CASheetLayout).
+
+	As in CAScoreView, zoom levels up to CAOverviewRenderer::MAX_ZOOM draw the simplified shapes.
+
+	\code
+	  CASheetRenderer renderer(sheet);
+	  renderer.layout();
+	  renderer.render(QRectF(0, 0, 1000, 500), 2.0).save("preview.png");
+	\endcode
+*/
+
+CASheetRenderer::CASheetRenderer(CASheet* sheet)
+    : _sheet(sheet)
+    , _view(new CAScoreView(sheet))
+    , _backgroundColor(Qt::white)
+    , _foregroundColor(Qt::black)
+    , _antiAliasing(true)
+    , _layoutTime(0)
+    , _renderTime(0)
+{
+}
+
+CASheetRenderer::~CASheetRenderer()
+{
+    delete _view;
+}
+
+CASheetLayout* CASheetRenderer::sheetLayout()
+{
+    return _view->sheetLayout();
+}
+
+/*!
+	Lays out the whole sheet including the part postponed by the progressive layout. Returns False,
+	if the \a progress was canceled before the layout was complete.
+*/
+bool CASheetRenderer::layout(CAProgress* progress)
+{
+    qint64 start = CATrace::now();
+    bool complete = _view->completeLayout(progress);
+    _layoutTime = CATrace::now() - start;
+    return complete;
+}
+
+/*!
+	Returns the rectangle containing all the laid out drawables in world coordinates.
+*/
+QRectF CASheetRenderer::worldRect()
+{
+    CASheetLayout* l = sheetLayout();
+    return QRectF(0, 0, qMax(l->drawableMList().getMaxX(), l->drawableCList().getMaxX()), qMax(l->drawableMList().getMaxY(), l->drawableCList().getMaxY()));
+}
+
+/*!
+	Renders the \a world rectangle at \a zoom into a new image of the size of the rectangle in
+	pixels filled with the background color.
+*/
+QImage CASheetRenderer::render(const QRectF& world, double zoom)
+{
+    QImage image(qMax(qRound(world.width() * zoom), 1), qMax(qRound(world.height() * zoom), 1), QImage::Format_ARGB32_Premultiplied);
+    image.fill(_backgroundColor);
+
+    QPainter p(&image);
+    render(&p, world, zoom);
+    return image;
+}
+
+/*!
+	Renders the \a world rectangle at \a zoom using the painter \a p. The top-left corner of
+	\a world is drawn at the painter's origin.
+*/
+void CASheetRenderer::render(QPainter* p, const QRectF& world, double zoom)
+{
+    qint64 start = CATrace::now();
+    render(p, sheetLayout(), world, zoom, _foregroundColor, _antiAliasing);
+    _renderTime = CATrace::now() - start;
+}
+
+/*!
+	Renders the whole sheet scaled to fit into an image of the given \a size keeping the aspect
+	ratio.
+*/
+QImage CASheetRenderer::thumbnail(const QSize& size)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(_backgroundColor);
+
+    QRectF world = worldRect();
+    if (world.width() <= 0 || world.height() <= 0) {
+        return image;
+    }
+
+    QPainter p(&image);
+    render(&p, world, qMin(size.width() / world.width(), size.height() / world.height()));
+    return image;
+}
+
+/*!
+	Draws the contexts and music elements of \a layout inside the \a world rectangle at \a zoom in
+	the given \a color. The elements with their own color are drawn in it, the hidden ones are
+	skipped. The elements smaller than legible at \a zoom multiplied by \a lodZoomFactor are drawn
+	as placeholders, see CADrawable::minLegibleZoom().
+*/
+void CASheetRenderer::render(QPainter* p, CASheetLayout* layout, const QRectF& world, double zoom, const QColor& color, bool antiAliasing, double lodZoomFactor)
+{
+    CA_TRACE_ZONE("CASheetRenderer::render");
+    if (zoom <= CAOverviewRenderer::MAX_ZOOM) {
+        CAOverviewRenderer::render(p, layout, world, zoom, color);
+        return;
+    }
+
+    int w = qRound(world.width() * zoom);
+    int h = qRound(world.height() * zoom);
+    p->save();
+    p->setClipRect(0, 0, w, h);
+
+    QList<CADrawableContext*> cList = layout->drawableCList().findInRange(world.x() - margin, world.y() - margin, world.width() + 2 * margin, world.height() + 2 * margin);
+    for (int i = 0; i < cList.size(); i++) {
+        CADrawSettings s = {
+            zoom,
+            qRound((cList[i]->xPos() - world.x()) * zoom),
+            qRound((cList[i]->yPos() - world.y()) * zoom),
+            w, h,
+            color,
+            world.x(),
+            world.y()
+        };
+        cList[i]->draw(p, s);
+    }
+
+    p->setRenderHint(QPainter::Antialiasing, antiAliasing);
+    QList<CADrawableMusElement*> mList = layout->drawableMList().findInRange(world.x() - margin, world.y() - margin, world.width() + 2 * margin, world.height() + 2 * margin);
+    for (int i = 0; i < mList.size(); i++) {
+        CAMusElement* elt = mList[i]->musElement();
+        if (elt && (!elt->isVisible() || (elt->musElementType() == CAMusElement::Rest && static_cast<CARest*>(elt)->restType() == CARest::Hidden))) {
+            continue;
+        }
+
+        CADrawSettings s = {
+            zoom,
+            qRound((mList[i]->xPos() - world.x()) * zoom),
+            qRound((mList[i]->yPos() - world.y()) * zoom),
+            w, h,
+            (elt && elt->color().isValid()) ? elt->color() : color,
+            world.x(),
+            world.y()
+        };
+
+        if (zoom < mList[i]->minLegibleZoom() * lodZoomFactor) {
+            mList[i]->drawPlaceholder(p, s);
+        } else {
+            mList[i]->draw(p, s);
+        }
+    }
+
+    p->restore();
+}
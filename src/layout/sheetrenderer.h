@@ -0,0 +1,60 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef SHEETRENDERER_H_
+#define SHEETRENDERER_H_
+
+#include <QColor>
+#include <QImage>
+#include <QRectF>
+
+class QPainter;
+class CAProgress;
+class CASheet;
+class CASheetLayout;
+class CAScoreView;
+
+class CASheetRenderer {
+public:
+    CASheetRenderer(CASheet* sheet);
+    ~CASheetRenderer();
+
+    inline CASheet* sheet() { return _sheet; }
+    CASheetLayout* sheetLayout();
+
+    inline const QColor& backgroundColor() { return _backgroundColor; }
+    inline void setBackgroundColor(const QColor& color) { _backgroundColor = color; }
+
+    inline const QColor& foregroundColor() { return _foregroundColor; }
+    inline void setForegroundColor(const QColor& color) { _foregroundColor = color; }
+
+    inline bool antiAliasing() { return _antiAliasing; }
+    inline void setAntiAliasing(bool antiAliasing) { _antiAliasing = antiAliasing; }
+
+    bool layout(CAProgress* progress = nullptr);
+    QRectF worldRect();
+
+    QImage render(const QRectF& world, double zoom);
+    void render(QPainter* p, const QRectF& world, double zoom);
+    QImage thumbnail(const QSize& size);
+
+    inline qint64 layoutTime() { return _layoutTime; }
+    inline qint64 renderTime() { return _renderTime; }
+
+    static void render(QPainter* p, CASheetLayout* layout, const QRectF& world, double zoom, const QColor& color, bool antiAliasing = true, double lodZoomFactor = 1.0);
+
+private:
+    CASheet* _sheet;
+    CAScoreView* _view; // drives the layout engine, never shown
+    QColor _backgroundColor;
+    QColor _foregroundColor;
+    bool _antiAliasing;
+    qint64 _layoutTime; // of the last layout() in nanoseconds
+    qint64 _renderTime; // of the last render() in nanoseconds
+};
+
+#endif /* SHEETRENDERER_H_ */
@@ -0,0 +1,92 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QFont>
+#include <QFontMetrics>
+#include <QMutexLocker>
+
+#include "layout/textmetrics.h"
+
+const int CATextMetrics::MAX_ENTRIES = 16384;
+
+QMutex CATextMetrics::_mutex;
+QHash<QPair<QString, QString>, int> CATextMetrics::_widths;
+QHash<QPair<QString, QString>, qreal> CATextMetrics::_widthsF;
+
+/*!
+	\class CATextMetrics
+	\brief Cache of the text widths
+
+	Syllables, chord names, function marks and text marks measure their text each time they are
+	created by the layout and drawn. Lyrics of several stanzas mostly repeat the same syllables, so
+	the widths are measured once per font and text and kept across the rebuilds. The font key
+	includes the pixel size, so each zoom level has its own widths.
+
+	When the cache grows over MAX_ENTRIES, it is cleared and filled again.
+*/
+
+/*!
+	Returns the advance width of \a text in \a font in pixels, as QFontMetrics does.
+*/
+int CATextMetrics::width(const QFont& font, const QString& text)
+{
+    QPair<QString, QString> key(font.key(), text);
+
+    QMutexLocker locker(&_mutex);
+    QHash<QPair<QString, QString>, int>::const_iterator it = _widths.constFind(key);
+    if (it != _widths.constEnd()) {
+        return it.value();
+    }
+
+    if (_widths.size() >= MAX_ENTRIES) {
+        _widths.clear();
+    }
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 11, 0))
+    int w = QFontMetrics(font).horizontalAdvance(text);
+#else
+    int w = QFontMetrics(font).width(text);
+#endif
+    _widths.insert(key, w);
+    return w;
+}
+
+/*!
+	Returns the advance width of \a text in \a font with subpixel precision, as QFontMetricsF does.
+*/
+qreal CATextMetrics::widthF(const QFont& font, const QString& text)
+{
+    QPair<QString, QString> key(font.key(), text);
+
+    QMutexLocker locker(&_mutex);
+    QHash<QPair<QString, QString>, qreal>::const_iterator it = _widthsF.constFind(key);
+    if (it != _widthsF.constEnd()) {
+        return it.value();
+    }
+
+    if (_widthsF.size() >= MAX_ENTRIES) {
+        _widthsF.clear();
+    }
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 11, 0))
+    qreal w = QFontMetricsF(font).horizontalAdvance(text);
+#else
+    qreal w = QFontMetricsF(font).width(text);
+#endif
+    _widthsF.insert(key, w);
+    return w;
+}
+
+/*!
+	Forgets all the cached widths, for example when the fonts are reloaded.
+*/
+void CATextMetrics::clear()
+{
+    QMutexLocker locker(&_mutex);
+    _widths.clear();
+    _widthsF.clear();
+}
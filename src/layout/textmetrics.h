@@ -0,0 +1,32 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef TEXTMETRICS_H_
+#define TEXTMETRICS_H_
+
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+
+class QFont;
+
+class CATextMetrics {
+public:
+    static int width(const QFont& font, const QString& text);
+    static qreal widthF(const QFont& font, const QString& text);
+    static void clear();
+
+private:
+    static const int MAX_ENTRIES;
+
+    static QMutex _mutex;
+    static QHash<QPair<QString, QString>, int> _widths; // text widths indexed by font key and text
+    static QHash<QPair<QString, QString>, qreal> _widthsF;
+};
+
+#endif /* TEXTMETRICS_H_ */
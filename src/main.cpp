@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2019, Reinhard Katzmann, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Reinhard Katzmann, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -9,10 +9,18 @@
 #include <QFile>
 #include <QFont>
 #include <QSplashScreen>
+#include <QTimer>
 
 // Python.h needs to be loaded first!
 #include "canorus.h"
+#include "core/batchconvert.h"
+#include "core/documentstatistics.h"
+#ifdef QT_NETWORK_LIB
+#include "core/renderserver.h"
+#endif
+#include "core/sessionjournal.h"
 #include "core/settings.h"
+#include "core/startupprofiler.h"
 #include "interface/pluginmanager.h"
 #include "ui/mainwin.h"
 #include "ui/settingsdialog.h"
@@ -41,12 +49,10 @@ void catch_sig(int)
 */
 int main(int argc, char* argv[])
 {
-    QApplication mainApp(argc, argv);
-
-#ifdef Q_WS_X11
-    signal(SIGINT, catch_sig);
-    signal(SIGQUIT, catch_sig);
-#endif
+    // Time the startup phases, if requested
+    CAStartupProfiler::parseArguments(argc, argv);
+    CADocumentStatistics::parseArguments(argc, argv);
+    CASessionJournal::parseArguments(argc, argv); // before the application chooses the platform
 
 #ifdef Q_OS_WIN
     // Enable console output on Windows
@@ -55,8 +61,55 @@ int main(int argc, char* argv[])
         freopen("CONOUT$", "w", stderr);
     }
 #endif
+
+    // Convert the documents passed in command line without initializing the user interface
+    if (CABatchConvert::isBatchMode(argc, argv)) {
+        QCoreApplication batchApp(argc, argv);
+        CACanorus::initSearchPaths();
+        CACanorus::initMain();
+        CACanorus::initSettings();
+
+        CABatchConvert batchConvert;
+        if (!batchConvert.parseArguments(batchApp.arguments()))
+            return 1;
+
+        return batchConvert.exec();
+    }
+
+#ifdef QT_NETWORK_LIB
+    // Serve the renders of the stored documents, the layout needs a GUI application but no windows are shown
+    if (CARenderServer::isServerMode(argc, argv)) {
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+        QApplication serverApp(argc, argv);
+        CACanorus::initSearchPaths();
+        CACanorus::initMain();
+        CACanorus::initSettings();
+
+        CARenderServer server;
+        if (!server.parseArguments(serverApp.arguments()) || !server.listen())
+            return 1;
+
+        return serverApp.exec();
+    }
+#endif
+
+    CAStartupProfiler::beginPhase("Application");
+    QApplication mainApp(argc, argv);
+
+#ifdef Q_WS_X11
+    signal(SIGINT, catch_sig);
+    signal(SIGQUIT, catch_sig);
+#endif
+
+    // Record or replay the editing session, if requested
+    CASessionJournal::start();
+
+    CAStartupProfiler::beginPhase("Search paths");
     CACanorus::initSearchPaths();
 
+    CAStartupProfiler::beginPhase("Splash screen");
     QPixmap splashPixmap(400, 300);
     splashPixmap = QPixmap("images:splash.png");
 
@@ -76,51 +129,44 @@ int main(int argc, char* argv[])
     splash.show();
 
     // Load system translation if found
+    CAStartupProfiler::beginPhase("Translations");
     CACanorus::initTranslations();
 
     // Init MIDI devices
+    CAStartupProfiler::beginPhase("Playback");
     CACanorus::initPlayback();
 
     // Load config file
+    CAStartupProfiler::beginPhase("Settings");
     bool firstTime = !QFile::exists(CASettings::defaultSettingsPath() + "/canorus.ini");
     CASettingsDialog::CASettingsPage showSettingsPage = CACanorus::initSettings();
 
-    // Enable scripting and plugins subsystem
-    splash.showMessage(QObject::tr("Initializing Scripting engine", "splashScreen"), Qt::AlignBottom | Qt::AlignLeft, Qt::white);
-    mainApp.processEvents();
-    CACanorus::initScripting();
-
-    // Finds all the plugins
+    // Finds all the plugins. Scripting engine is initialized when the first script is run.
+    CAStartupProfiler::beginPhase("Plugins");
     splash.showMessage(QObject::tr("Reading Plugins", "splashScreen"), Qt::AlignBottom | Qt::AlignLeft, Qt::white);
     mainApp.processEvents();
     CAPluginManager::readPlugins();
 
     // Initialize autosave
+    CAStartupProfiler::beginPhase("Automatic recovery");
     splash.showMessage(QObject::tr("Initializing Automatic recovery", "splashScreen"), Qt::AlignBottom | Qt::AlignLeft, Qt::white);
     mainApp.processEvents();
     CACanorus::initAutoRecovery();
 
-    // Initialize help
-    splash.showMessage(QObject::tr("Initializing Help", "splashScreen"), Qt::AlignBottom | Qt::AlignLeft, Qt::white);
-    mainApp.processEvents();
-    CACanorus::initHelp();
-
     // Initialize undo/redo stacks
+    CAStartupProfiler::beginPhase("Undo");
     splash.showMessage(QObject::tr("Initializing Undo/Redo framework", "splashScreen"), Qt::AlignBottom | Qt::AlignLeft, Qt::white);
     mainApp.processEvents();
     CACanorus::initUndo();
 
-    // Load bundled fonts
-    splash.showMessage(QObject::tr("Loading fonts", "splashScreen"), Qt::AlignBottom | Qt::AlignLeft, Qt::white);
-    mainApp.processEvents();
-    CACanorus::initFonts();
-
     // Check for any crashed Canorus sessions and open the recovery files
+    CAStartupProfiler::beginPhase("Recovery documents");
     splash.showMessage(QObject::tr("Searching for recovery documents", "splashScreen"), Qt::AlignBottom | Qt::AlignLeft, Qt::white);
     mainApp.processEvents();
     CACanorus::autoRecovery()->openRecovery();
 
     // Creates a main window of a document to open if passed in command line
+    CAStartupProfiler::beginPhase("Main window");
     splash.showMessage(QObject::tr("Initializing Main window", "splashScreen"), Qt::AlignBottom | Qt::AlignLeft, Qt::white);
     mainApp.processEvents();
     CACanorus::parseOpenFileArguments(argc, argv);
@@ -129,21 +175,9 @@ int main(int argc, char* argv[])
     if (!CACanorus::mainWinList().size()) {
         CAMainWin* mainWin = new CAMainWin();
 
-        // Init dialogs etc.
-        CACanorus::initCommonGUI(mainWin->uiSaveDialog,
-            mainWin->uiOpenDialog,
-            mainWin->uiExportDialog,
-            mainWin->uiImportDialog);
-
         mainWin->newDocument();
         mainWin->show();
 
-        // Init dialogs etc.
-        CACanorus::initCommonGUI(mainWin->uiSaveDialog,
-            mainWin->uiOpenDialog,
-            mainWin->uiExportDialog,
-            mainWin->uiImportDialog);
-
         if (firstTime) {
             mainWin->on_uiUsersGuide_triggered();
         }
@@ -155,5 +189,12 @@ int main(int argc, char* argv[])
         CASettingsDialog(showSettingsPage, CACanorus::mainWinList()[0]);
     }
 
+    // Log the memory usage of the opened documents, if requested
+    CADocumentStatistics::startLogging();
+
+    // The startup is finished when the event loop processed the shown main window
+    CAStartupProfiler::beginPhase("First event loop iteration");
+    QTimer::singleShot(0, &CAStartupProfiler::finish);
+
     return mainApp.exec();
 }
@@ -0,0 +1,261 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#include "score/accidentalstate.h"
+
+#include "score/diatonicpitch.h"
+#include "score/keysignature.h"
+#include "score/note.h"
+#include "score/staff.h"
+#include "score/voice.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// index of the \a noteName from C to B, watch: % operator with negative numbers is implementation dependent
+inline int step(int noteName)
+{
+    return noteName < 0 ? 6 - (-noteName - 1) % 7 : noteName % 7;
+}
+
+QList<CAMusElement*>::const_iterator lowerBound(const QList<CAMusElement*>& list, int time)
+{
+    return std::lower_bound(list.constBegin(), list.constEnd(), time, [](CAMusElement* elt, int t) { return elt->timeStart() < t; });
+}
+
+}
+
+/*!
+	\class CAAccidentalState
+	\brief Accidentals in effect in each bar of a staff
+
+	The accidental of a note stays in effect for the notes of the same pitch until the end of the
+	bar. Then the accidentals of the key signature apply again. CAAccidentalState tells which
+	accidentals are in effect at any time of the staff (see accs()) and whether a note needs its
+	accidental to be shown (see hasAccidental()). It is used by the layout engine to place the
+	accidentals and by the keyboard input and the MIDI import to spell the entered pitches.
+
+	The bars are started by the barlines and the key signatures of the staff. Only their times and
+	the accidentals of the keys are stored, the notes are looked up in the voices when queried, so
+	the state only needs to be updated, when the barlines or key signatures change.
+
+	The layout engine keeps the state of each staff (see CASheetLayout::accidentalState()). After
+	an edit, update() refreshes the bars of the edited region and returns the notes which now show
+	or hide their accidental, so only their bars need to be engraved again.
+*/
+
+CAAccidentalState::CAAccidentalState(CAStaff* staff)
+    : _staff(staff)
+{
+    updateBars();
+}
+
+/*!
+	Rebuilds the bars and remembers which notes of the staff show their accidental for the later
+	update() calls.
+*/
+void CAAccidentalState::rebuild()
+{
+    updateBars();
+    _shown.clear();
+    for (int i = 0; i < _bars.size(); i++) {
+        updateShown(i, nullptr);
+    }
+}
+
+/*!
+	Refreshes the state after the staff changed between \a timeStart and \a timeEnd. Returns the
+	notes of the staff whose accidental is shown or hidden now, including the new ones.
+
+	The accidentals don't reach over the barlines, so only the bars of the region are checked,
+	unless a key signature was added, removed or changed. Then all the bars after the region are
+	checked as well.
+*/
+QList<CANote*> CAAccidentalState::update(int timeStart, int timeEnd)
+{
+    QVector<CAAccidentalBar> oldBars = _bars;
+    updateBars();
+
+    QList<CANote*> changed;
+    int last = sameKeys(oldBars) ? barAt(timeEnd) : _bars.size() - 1;
+    for (int i = barAt(timeStart); i <= last; i++) {
+        updateShown(i, &changed);
+    }
+    return changed;
+}
+
+/*!
+	Returns the accidentals in effect for the notes of \a noteName starting at \a timeStart. These
+	are the accidentals of the last note of that name in the bar before \a timeStart in any voice
+	of the staff or the accidentals of the key. Notes starting at \a timeStart (eg. other notes
+	of the chord) are not taken into account.
+*/
+int CAAccidentalState::accs(int timeStart, int noteName)
+{
+    int bar = barAt(timeStart);
+    CANote* last = nullptr;
+    for (CAVoice* voice : _staff->voiceList()) {
+        const QList<CAMusElement*>& list = voice->musElementList();
+        QList<CAMusElement*>::const_iterator begin = lowerBound(list, qMax(_bars[bar].timeStart, last ? last->timeStart() : 0));
+        for (QList<CAMusElement*>::const_iterator it = lowerBound(list, timeStart); it != begin;) {
+            --it;
+            if ((*it)->musElementType() == CAMusElement::Note && static_cast<CANote*>(*it)->diatonicPitch().noteName() == noteName) {
+                last = static_cast<CANote*>(*it); // the later voices win, as in updateShown()
+                break;
+            }
+        }
+    }
+
+    return last ? last->diatonicPitch().accs() : _bars[bar].keyAccs[step(noteName)];
+}
+
+/*!
+	Returns True, if the pitch \a p doesn't need an accidental at \a timeStart.
+*/
+bool CAAccidentalState::isInEffect(const CADiatonicPitch& p, int timeStart)
+{
+    return accs(timeStart, p.noteName()) == p.accs();
+}
+
+/*!
+	Returns True, if the accidental of the \a note needs to be shown.
+*/
+bool CAAccidentalState::hasAccidental(CANote* note)
+{
+    return !isInEffect(note->diatonicPitch(), note->timeStart());
+}
+
+/*!
+	Splits the staff into the bars at its barlines and key signatures.
+*/
+void CAAccidentalState::updateBars()
+{
+    _bars.clear();
+    CAAccidentalBar first;
+    first.timeStart = 0;
+    first.key = nullptr;
+    std::memset(first.keyAccs, 0, sizeof(first.keyAccs));
+    _bars << first;
+
+    const QList<CAMusElement*>& barlines = _staff->barlineRefs();
+    const QList<CAMusElement*>& keys = _staff->keySignatureRefs();
+    int b = 0, k = 0;
+    while (b < barlines.size() || k < keys.size()) {
+        bool isKey = (k < keys.size() && (b >= barlines.size() || keys[k]->timeStart() <= barlines[b]->timeStart()));
+        CAMusElement* elt = isKey ? keys[k++] : barlines[b++];
+
+        if (elt->timeStart() != _bars.last().timeStart) {
+            CAAccidentalBar bar = _bars.last(); // the key stays in effect
+            bar.timeStart = elt->timeStart();
+            bar.key = nullptr;
+            _bars << bar;
+        }
+
+        if (isKey) {
+            CAAccidentalBar& bar = _bars.last();
+            bar.key = elt;
+            for (int i = 0; i < 7; i++) {
+                bar.keyAccs[i] = static_cast<signed char>(static_cast<CAKeySignature*>(elt)->accidentals()[i]);
+            }
+        }
+    }
+}
+
+/*!
+	Returns the index of the bar containing the given \a time.
+*/
+int CAAccidentalState::barAt(int time)
+{
+    QVector<CAAccidentalBar>::const_iterator it = std::upper_bound(_bars.constBegin(), _bars.constEnd(), time, [](int t, const CAAccidentalBar& bar) { return t < bar.timeStart; });
+    return qMax(static_cast<int>(it - _bars.constBegin()) - 1, 0);
+}
+
+/*!
+	Returns the time the given \a bar ends at.
+*/
+int CAAccidentalState::barEnd(int bar)
+{
+    return (bar + 1 < _bars.size()) ? _bars[bar + 1].timeStart : std::numeric_limits<int>::max();
+}
+
+/*!
+	Returns the notes of all the voices starting between \a timeStart and \a timeEnd sorted by
+	time. The notes starting at the same time are ordered by their voice.
+*/
+QList<CANote*> CAAccidentalState::notes(int timeStart, int timeEnd)
+{
+    QList<CANote*> list;
+    for (CAVoice* voice : _staff->voiceList()) {
+        const QList<CAMusElement*>& elts = voice->musElementList();
+        for (QList<CAMusElement*>::const_iterator it = lowerBound(elts, timeStart); it != elts.constEnd() && (*it)->timeStart() < timeEnd; it++) {
+            if ((*it)->musElementType() == CAMusElement::Note) {
+                list << static_cast<CANote*>(*it);
+            }
+        }
+    }
+
+    std::stable_sort(list.begin(), list.end(), [](CANote* a, CANote* b) { return a->timeStart() < b->timeStart(); });
+    return list;
+}
+
+/*!
+	Walks the notes of the \a bar and stores whether they show their accidental. The notes whose
+	accidental is shown or hidden now are appended to \a changed, if given.
+*/
+void CAAccidentalState::updateShown(int bar, QList<CANote*>* changed)
+{
+    QList<CANote*> barNotes = notes(_bars[bar].timeStart, barEnd(bar));
+    QHash<int, int> accs; // of the note names altered in the bar so far
+    for (int i = 0; i < barNotes.size();) {
+        // the notes starting at the same time don't change each other's accidentals
+        int j = i;
+        for (; j < barNotes.size() && barNotes[j]->timeStart() == barNotes[i]->timeStart(); j++) {
+            CANote* note = barNotes[j];
+            int noteName = note->diatonicPitch().noteName();
+            bool shown = (accs.value(noteName, _bars[bar].keyAccs[step(noteName)]) != note->diatonicPitch().accs());
+            if (changed && (!_shown.contains(note) || _shown[note] != shown)) {
+                *changed << note;
+            }
+            _shown[note] = shown;
+        }
+
+        for (; i < j; i++) {
+            accs[barNotes[i]->diatonicPitch().noteName()] = barNotes[i]->diatonicPitch().accs();
+        }
+    }
+}
+
+/*!
+	Returns True, if the bars of the previous state \a bars have the same key signatures as the
+	current ones.
+*/
+bool CAAccidentalState::sameKeys(const QVector<CAAccidentalBar>& bars)
+{
+    int j = 0;
+    for (int i = 0; i < bars.size(); i++) {
+        if (!bars[i].key) {
+            continue;
+        }
+        while (j < _bars.size() && !_bars[j].key) {
+            j++;
+        }
+        if (j == _bars.size() || _bars[j].key != bars[i].key || std::memcmp(_bars[j].keyAccs, bars[i].keyAccs, sizeof(bars[i].keyAccs))) {
+            return false;
+        }
+        j++;
+    }
+
+    for (; j < _bars.size(); j++) {
+        if (_bars[j].key) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,52 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#ifndef ACCIDENTALSTATE_H_
+#define ACCIDENTALSTATE_H_
+
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+class CADiatonicPitch;
+class CAMusElement;
+class CANote;
+class CAStaff;
+
+class CAAccidentalState {
+public:
+    CAAccidentalState(CAStaff* staff);
+
+    inline CAStaff* staff() { return _staff; }
+
+    void rebuild();
+    QList<CANote*> update(int timeStart, int timeEnd);
+
+    int accs(int timeStart, int noteName);
+    bool isInEffect(const CADiatonicPitch& p, int timeStart);
+    bool hasAccidental(CANote* note);
+
+private:
+    struct CAAccidentalBar {
+        int timeStart;
+        CAMusElement* key; // key signature starting the bar, null for a barline
+        signed char keyAccs[7]; // accidentals of the key in effect from C to B
+    };
+
+    void updateBars();
+    int barAt(int time);
+    int barEnd(int bar);
+    QList<CANote*> notes(int timeStart, int timeEnd);
+    void updateShown(int bar, QList<CANote*>* changed);
+    bool sameKeys(const QVector<CAAccidentalBar>& bars);
+
+    CAStaff* _staff;
+    QVector<CAAccidentalBar> _bars; // started by the barlines and key signatures of the staff, sorted by time
+    QHash<CANote*, bool> _shown; // whether each note showed an accidental, updated by rebuild() and update()
+};
+
+#endif /* ACCIDENTALSTATE_H_ */
@@ -58,7 +58,11 @@ public:
     }
 
     inline CAArticulationType articulationType() { return _articulationType; }
-    inline void setArticulationType(CAArticulationType t) { _articulationType = t; }
+    inline void setArticulationType(CAArticulationType t)
+    {
+        _articulationType = t;
+        contentChanged();
+    }
 
     static const QString articulationTypeToString(CAArticulationType t);
     static CAArticulationType articulationTypeFromString(const QString s);
@@ -33,7 +33,11 @@ public:
     int compare(CAMusElement* elt);
 
     CABarlineType barlineType() { return _barlineType; }
-    void setBarlineType(CABarlineType t) { _barlineType = t; }
+    void setBarlineType(CABarlineType t)
+    {
+        _barlineType = t;
+        contentChanged();
+    }
 
     static const QString barlineTypeToString(CABarlineType);
     static CABarlineType barlineTypeFromString(const QString);
@@ -17,7 +17,11 @@ public:
     virtual ~CABookMark();
 
     inline const QString text() { return _text; }
-    inline void setText(const QString t) { _text = t; }
+    inline void setText(const QString t)
+    {
+        _text = t;
+        contentChanged();
+    }
 
     CABookMark* clone(CAMusElement* elt = 0);
     int compare(CAMusElement* elt);
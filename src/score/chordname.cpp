@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2019-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -13,6 +13,10 @@
 	\brief Chord name
 
 	Chord name (e.g. C, F#m, Gsus4 etc.) inside the CAChordNameContext.
+
+	The chord names derived from the notes by CAChordAnalyzer are marked as generated. Setting
+	the pitch or the quality modifier makes the chord name user entered again, so the analysis
+	doesn't change it anymore.
 */
 
 CAChordName::CAChordName(CADiatonicPitch pitch, QString qualityModifier, CAChordNameContext* c, int timeStart, int timeLength)
@@ -22,6 +26,7 @@ CAChordName::CAChordName(CADiatonicPitch pitch, QString qualityModifier, CAChord
 
     setDiatonicPitch(pitch);
     setQualityModifier(qualityModifier);
+    _generated = false;
 }
 
 CAChordName::~CAChordName()
@@ -34,12 +39,14 @@ CAChordName* CAChordName::clone(CAContext* context)
         return nullptr;
     }
 
-    return new CAChordName(
+    CAChordName* c = new CAChordName(
         diatonicPitch(),
         qualityModifier(),
         static_cast<CAChordNameContext*>(context),
         timeStart(),
         timeLength());
+    c->setGenerated(isGenerated());
+    return c;
 }
 
 int CAChordName::compare(CAMusElement* elt)
@@ -63,6 +70,7 @@ int CAChordName::compare(CAMusElement* elt)
  */
 bool CAChordName::importFromString(const QString& text)
 {
+    _generated = false;
     int d = text.indexOf(':');
     _diatonicPitch = CADiatonicPitch((d == -1) ? text : text.left(d));
 
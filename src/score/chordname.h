@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2019-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -20,10 +20,21 @@ public:
     virtual ~CAChordName();
 
     CADiatonicPitch diatonicPitch() { return _diatonicPitch; }
-    void setDiatonicPitch(CADiatonicPitch dp) { _diatonicPitch = dp; }
+    void setDiatonicPitch(CADiatonicPitch dp)
+    {
+        _diatonicPitch = dp;
+        _generated = false;
+    }
 
     QString qualityModifier() { return _qualityModifier; }
-    void setQualityModifier(QString qm) { _qualityModifier = qm; }
+    void setQualityModifier(QString qm)
+    {
+        _qualityModifier = qm;
+        _generated = false;
+    }
+
+    bool isGenerated() { return _generated; }
+    void setGenerated(bool generated) { _generated = generated; }
 
     CAChordName* clone(CAContext* c);
     int compare(CAMusElement* elt);
@@ -33,6 +44,7 @@ public:
 private:
     CADiatonicPitch _diatonicPitch;
     QString _qualityModifier;
+    bool _generated; // derived by CAChordAnalyzer, replaced by the next analysis
 };
 
 #endif /* CHORDNAME_H_ */
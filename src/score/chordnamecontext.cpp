@@ -12,6 +12,8 @@
 #include "score/playablelength.h"
 #include "score/sheet.h"
 
+#include <algorithm>
+
 /*!
 	\class CAChordNameContext
 	\brief Context for chord names
@@ -70,30 +72,47 @@ void CAChordNameContext::addEmptyChordName(int timeStart, int timeLength)
 	It repositions the existing chord names (sets timeStart and timeLength) one by one according to the playable music
 	elements above the context.
 
+	Only the chord names from the chord before \a timeStart on are repositioned. Use
+	CASheet::repositContexts() to reposition all the dependent contexts of the sheet at once.
+
  	\sa CALyricsContext::repositSyllables(), CAFiguredBassContext::repositFiguredBassMarks(), CAFunctionMarkContext::repositFunctions()
 */
-void CAChordNameContext::repositChordNames()
+void CAChordNameContext::repositChordNames(int timeStart)
 {
-    int ts, tl;
-    int curIdx; // contains current position in _chordNameList
-    QList<CAPlayable*> chord;
-    for (ts = 0, curIdx = 0;
-         (sheet() && (chord = sheet()->getChord(ts)).size()) || curIdx < _chordNameList.size(); ts += tl, curIdx++) {
-        tl = (chord.size() ? chord[0]->timeLength() : 256);
-        for (int i = 0; i < chord.size(); i++)
-            if (chord[i]->timeLength() < tl)
-                tl = chord[i]->timeLength();
+    if (!sheet()) {
+        repositChordNames(QVector<CAHarmonySlice>(), 0);
+        return;
+    }
+
+    int from = sheet()->harmonySliceStart(timeStart);
+    repositChordNames(sheet()->harmonySlices(from), from);
+}
+
+/*!
+	Assigns the chord names starting at \a from or later to the chords \a slices in order, see
+	CASheet::harmonySlices(). The chord names left over are placed after the last chord.
+*/
+void CAChordNameContext::repositChordNames(const QVector<CAHarmonySlice>& slices, int from)
+{
+    int curIdx = static_cast<int>(std::lower_bound(_chordNameList.begin(), _chordNameList.end(), from, [](CAChordName* c, int t) { return c->timeStart() < t; }) - _chordNameList.begin());
+    int ts = from;
+    int tl = 256;
+    for (int k = 0; k < slices.size() || curIdx < _chordNameList.size(); k++, curIdx++, ts += tl) {
+        if (k < slices.size()) {
+            ts = slices[k].timeStart;
+            tl = slices[k].timeLength;
+        } else {
+            tl = 256;
+        }
 
         // add new empty chord names, if playables still exist above
         if (curIdx == _chordNameList.size()) {
-            addEmptyChordName(ts, tl);
+            _chordNameList << new CAChordName(CADiatonicPitch::Undefined, "", this, ts, tl);
         }
 
         // apply timeStart and timeLength to existing chord names
-        if (curIdx < _chordNameList.size()) {
-            _chordNameList[curIdx]->setTimeLength(tl);
-            _chordNameList[curIdx]->setTimeStart(ts);
-        }
+        _chordNameList[curIdx]->setTimeLength(tl);
+        _chordNameList[curIdx]->setTimeStart(ts);
     }
 }
 
@@ -118,6 +137,7 @@ CAContext* CAChordNameContext::clone(CASheet* s)
 
     for (int i = 0; i < _chordNameList.size(); i++) {
         CAChordName* newCn = static_cast<CAChordName*>(_chordNameList[i]->clone(newCnc));
+        newCn->keepIds(_chordNameList[i]);
         newCnc->addChordName(newCn);
     }
     return newCnc;
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2019-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -10,7 +10,9 @@
 
 #include "score/context.h"
 #include <QList>
+#include <QVector>
 
+struct CAHarmonySlice;
 class CAChordName;
 
 class CAChordNameContext : public CAContext {
@@ -27,7 +29,10 @@ public:
     QList<CAChordName*>& chordNameList() { return _chordNameList; }
     CAChordName* chordNameAtTimeStart(int timeStart);
 
-    void repositChordNames();
+    void repositChordNames(int timeStart = 0);
+#ifndef SWIG
+    void repositChordNames(const QVector<CAHarmonySlice>& slices, int from);
+#endif
     void addChordName(CAChordName*, bool replace = true);
     void addEmptyChordName(int timeStart, int timeLength);
 
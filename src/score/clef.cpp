@@ -126,11 +126,12 @@ void CAClef::setClefType(CAClefType type)
     }
 
     _centerPitch += offset();
+    contentChanged();
 }
 
 CAClef* CAClef::clone(CAContext* context)
 {
-    CAClef* c = new CAClef(_clefType, _c1, static_cast<CAStaff*>(context), _timeStart, _offset);
+    CAClef* c = new CAClef(_clefType, _c1, static_cast<CAStaff*>(context), timeStart(), _offset);
 
     for (int i = 0; i < markList().size(); i++) {
         CAMark* m = static_cast<CAMark*>(markList()[i]->clone(c));
@@ -59,6 +59,7 @@ public:
     {
         _c1 += _offset;
         _c1 -= (_offset = offset);
+        contentChanged();
     }
     inline int offset() { return _offset; }
 
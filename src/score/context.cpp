@@ -6,6 +6,7 @@
 */
 
 #include "score/context.h"
+#include "score/muselement.h"
 
 /*!
 	\class CAContext
@@ -18,6 +19,9 @@
 
 	CAContext is an abstract class and different solutions should be done based on it.
 
+	Each context has a stable id(), which is kept by the undo snapshots the same way as the ids of
+	the music elements, see CAMusElement::id().
+
 	\sa CAStaff, CAFunctionMarkContext
 */
 
@@ -26,6 +30,7 @@
 */
 CAContext::CAContext(const QString name, CASheet* s)
 {
+    _id = CAMusElement::newId();
     _sheet = s;
     _name = name;
 }
@@ -9,6 +9,7 @@
 #define CONTEXT_H_
 
 #include <QString>
+#include <QtGlobal>
 
 class CASheet;
 class CAMusElement;
@@ -27,6 +28,9 @@ public:
         ChordNameContext
     };
 
+    inline quint64 id() const { return _id; }
+    inline void setId(quint64 id) { _id = id; }
+
     const QString name() { return _name; }
     void setName(const QString name) { _name = name; }
 
@@ -43,6 +47,7 @@ public:
 protected:
     void setContextType(CAContextType t) { _contextType = t; }
 
+    quint64 _id; // stable identifier, see CAMusElement::id()
     CASheet* _sheet;
     QString _name;
     CAContextType _contextType;
@@ -26,9 +26,17 @@ public:
     int compare(CAMusElement*);
 
     inline int finalVolume() { return _finalVolume; }
-    inline void setFinalVolume(const int v) { _finalVolume = v; }
+    inline void setFinalVolume(const int v)
+    {
+        _finalVolume = v;
+        contentChanged();
+    }
     inline CACrescendoType crescendoType() { return _crescendoType; }
-    inline void setCrescendoType(CACrescendoType t) { _crescendoType = t; }
+    inline void setCrescendoType(CACrescendoType t)
+    {
+        _crescendoType = t;
+        contentChanged();
+    }
 
     static const QString crescendoTypeToString(CACrescendoType t);
     static CACrescendoType crescendoTypeFromString(const QString r);
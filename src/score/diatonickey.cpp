@@ -7,6 +7,34 @@
 
 #include "score/diatonickey.h"
 
+namespace {
+
+// accidentals from C to B of the keys from 7 flats to 7 sharps, named by their major key, see CADiatonicKey::keyAccs()
+constexpr signed char keyAccsTable[15][7] = {
+    { -1, -1, -1, -1, -1, -1, -1 }, // Ces
+    { -1, -1, -1, 0, -1, -1, -1 }, // Ges
+    { 0, -1, -1, 0, -1, -1, -1 }, // Des
+    { 0, -1, -1, 0, 0, -1, -1 }, // As
+    { 0, 0, -1, 0, 0, -1, -1 }, // Es
+    { 0, 0, -1, 0, 0, 0, -1 }, // Bes
+    { 0, 0, 0, 0, 0, 0, -1 }, // F
+    { 0, 0, 0, 0, 0, 0, 0 }, // C
+    { 0, 0, 0, 1, 0, 0, 0 }, // G
+    { 1, 0, 0, 1, 0, 0, 0 }, // D
+    { 1, 0, 0, 1, 1, 0, 0 }, // A
+    { 1, 1, 0, 1, 1, 0, 0 }, // E
+    { 1, 1, 0, 1, 1, 1, 0 }, // B
+    { 1, 1, 1, 1, 1, 1, 0 }, // Fis
+    { 1, 1, 1, 1, 1, 1, 1 } // Cis
+};
+
+// the sharps are added by the circle of fifths from F, the flats by the circle of fourths from B
+static_assert(keyAccsTable[8][3] == 1 && keyAccsTable[9][0] == 1 && keyAccsTable[6][6] == -1 && keyAccsTable[5][2] == -1, "wrong order of the accidentals");
+
+}
+
+const int CADiatonicKey::MAX_ACCS = 7;
+
 /*!
 	\class CADiatonicKey
 	\brief Musical key
@@ -229,27 +257,31 @@ CADiatonicKey CADiatonicKey::diatonicKeyFromString(const QString s)
  */
 QList<int> CADiatonicKey::accsMatrix()
 {
+    const signed char* accs = keyAccs(numberOfAccs());
     QList<int> matrix;
     for (int i = 0; i < 7; i++)
-        matrix << 0;
-
-    for (int i = 1; i <= numberOfAccs(); i++) {
-        matrix[(i * 4 - 1) % 7] = 1;
-    }
-    for (int i = -1; i >= numberOfAccs(); i--) {
-        matrix[(i * (-3) + 3) % 7] = -1;
-    }
+        matrix << accs[i];
 
     return matrix;
 }
 
+/*!
+	Returns the accidentals from C to B of the key signature with the given \a numberOfAccs
+	(negative for flats). The table is shared by all the keys and precomputed, so the accidentals of
+	each entered or imported note are looked up without going around the circle of fifths.
+*/
+const signed char* CADiatonicKey::keyAccs(int numberOfAccs)
+{
+    return keyAccsTable[qBound(-MAX_ACCS, numberOfAccs, MAX_ACCS) + MAX_ACCS];
+}
+
 /*!
 	Returns number of accidentals for the given note.
 	Eg. If we call noteAccs(17) in D-Major, it returns 1, because 17 is a note F and D-Major has Fis.
  */
 int CADiatonicKey::noteAccs(int noteName)
 {
-    return accsMatrix()[noteName < 0 ? 6 - (-noteName - 1) % 7 : noteName % 7];
+    return keyAccs(numberOfAccs())[noteName < 0 ? 6 - (-noteName - 1) % 7 : noteName % 7];
 }
 
 /*!
@@ -260,7 +292,7 @@ int CADiatonicKey::noteAccs(int noteName)
 */
 bool CADiatonicKey::containsPitch(const CADiatonicPitch& p)
 {
-    return (accsMatrix()[p.noteName() % 7] == p.accs());
+    return (keyAccs(numberOfAccs())[p.noteName() % 7] == p.accs());
 }
 
 /*!
@@ -59,6 +59,11 @@ public:
     QList<int> accsMatrix();
     int noteAccs(int noteName);
     bool containsPitch(const CADiatonicPitch& p);
+#ifndef SWIG
+    static const signed char* keyAccs(int numberOfAccs);
+#endif
+
+    static const int MAX_ACCS; // keys with more accidentals have the same accidentals matrix
 
 private:
     CADiatonicPitch _diatonicPitch; // pitch of the key
@@ -389,7 +389,10 @@ CADiatonicPitch CADiatonicPitch::diatonicPitchFromMidiPitchKey(int midiPitch, CA
 */
 int CADiatonicPitch::diatonicPitchToMidiPitch(const CADiatonicPitch& pitch)
 {
-    // +0.3 - rounding factor for 7/12 that exactly underlays every tone in octave, if rounded
+    // semitones of the white keys from C
+    static const int stepSemitones[] = { 0, 2, 4, 5, 7, 9, 11 };
+
     // +12 - our logical pitch starts at Sub-contra C, midi counting starts one octave lower
-    return qRound(pitch.noteName() * (12 / 7.0) + 0.3 + 12) + pitch.accs();
+    int octave = (pitch.noteName() >= 0 ? pitch.noteName() / 7 : (pitch.noteName() - 6) / 7);
+    return 12 + octave * 12 + stepSemitones[pitch.noteName() - octave * 7] + pitch.accs();
 }
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2008-2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2008-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -51,7 +51,7 @@ public:
     inline int noteName() const { return _noteName; }
     inline signed char accs() const { return _accs; }
 
-    inline void setNoteName(const int noteName) { _noteName = noteName; }
+    inline void setNoteName(const int noteName) { _noteName = static_cast<qint16>(noteName); }
     inline void setAccs(const signed char accs) { _accs = accs; }
     inline int midiPitch() { return CADiatonicPitch::diatonicPitchToMidiPitch(*this); }
 
@@ -63,7 +63,7 @@ public:
     static int diatonicPitchToMidiPitch(const CADiatonicPitch& dp);
 
 private:
-    int _noteName; // 0-sub-contra C, 1-D, 2-E etc.
+    qint16 _noteName; // 0-sub-contra C, 1-D, 2-E etc.
     signed char _accs; // 0-neutral, 1-sharp, -1-flat etc.
 };
 #endif /* DIATONICPITCH_H_ */
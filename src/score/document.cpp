@@ -9,6 +9,7 @@
 #include "control/resourcectl.h"
 #include "core/archive.h"
 #include "score/context.h"
+#include "score/documentversion.h"
 #include "score/resource.h"
 #include "score/sheet.h"
 #include "score/staff.h"
@@ -24,6 +25,8 @@
 	\sa CASheet
 */
 
+quint64 CADocument::_lastGeneration = 0;
+
 /*!
 	Creates an empty document.
 
@@ -31,6 +34,7 @@
 */
 CADocument::CADocument()
 {
+    updateGeneration();
     setDateCreated(QDateTime::currentDateTime());
     setDateLastModified(QDateTime::currentDateTime());
     setTimeEdited(0);
@@ -44,19 +48,7 @@ CADocument::CADocument()
 CADocument* CADocument::clone()
 {
     CADocument* newDocument = new CADocument();
-
-    // set properties
-    newDocument->setTitle(title());
-    newDocument->setSubtitle(subtitle());
-    newDocument->setComposer(composer());
-    newDocument->setArranger(arranger());
-    newDocument->setPoet(poet());
-    newDocument->setCopyright(copyright());
-    newDocument->setDateCreated(dateCreated());
-    newDocument->setDateLastModified(dateLastModified());
-    newDocument->setTimeEdited(timeEdited());
-    newDocument->setComments(comments());
-    newDocument->setFileName(fileName());
+    newDocument->cloneDocumentProperties(this);
 
     for (int i = 0; i < sheetList().size(); i++) {
         CASheet* newSheet = sheetList()[i]->clone(newDocument);
@@ -70,6 +62,49 @@ CADocument* CADocument::clone()
     return newDocument;
 }
 
+/*!
+	Makes a snapshot of this document for the undo and autosave and returns it.
+
+	Unlike clone(), the sheets of the snapshot are left unloaded and only the staffs changed since
+	the previous snapshot are copied, see CASheet::snapshot(). The content is restored when the
+	sheets are read for the first time. The resources are shared with this document.
+*/
+CADocument* CADocument::snapshot()
+{
+    CADocument* newDocument = new CADocument();
+    newDocument->cloneDocumentProperties(this);
+
+    for (int i = 0; i < sheetList().size(); i++) {
+        newDocument->addSheet(sheetList()[i]->snapshot(newDocument));
+    }
+
+    for (int i = 0; i < resourceList().size(); i++) {
+        newDocument->addResource(resourceList()[i]);
+    }
+
+    return newDocument;
+}
+
+/*!
+	Sets the properties of the given document to this document.
+*/
+void CADocument::cloneDocumentProperties(CADocument* doc)
+{
+    setTitle(doc->title());
+    setSubtitle(doc->subtitle());
+    setComposer(doc->composer());
+    setArranger(doc->arranger());
+    setPoet(doc->poet());
+    setTextTranslator(doc->textTranslator());
+    setDedication(doc->dedication());
+    setCopyright(doc->copyright());
+    setDateCreated(doc->dateCreated());
+    setDateLastModified(doc->dateLastModified());
+    setTimeEdited(doc->timeEdited());
+    setComments(doc->comments());
+    setFileName(doc->fileName());
+}
+
 /*!
 	Clears and destroys the document.
 
@@ -123,6 +158,19 @@ CASheet* CADocument::addSheetByName(const QString name)
     return s;
 }
 
+/*!
+	Replaces the sheet at \a index with the given \a sheet and returns the replaced sheet.
+	The caller takes the ownership of the returned sheet.
+*/
+CASheet* CADocument::replaceSheet(int index, CASheet* sheet)
+{
+    CASheet* old = _sheetList[index];
+    _sheetList[index] = sheet;
+    sheet->setDocument(this);
+
+    return old;
+}
+
 /*!
 	Adds and empty sheet to the document.
  */
@@ -146,3 +194,46 @@ CASheet* CADocument::findSheet(const QString name)
 
     return nullptr;
 }
+
+/*!
+	Gives the document a new generation number. Call this whenever the document content changes.
+
+	Generation numbers are unique across all the documents, so comparing the generation alone tells
+	whether the content has changed since it was last stored (eg. by CAAutoRecovery).
+
+	\sa generation()
+*/
+void CADocument::updateGeneration()
+{
+    _generation = ++_lastGeneration;
+}
+
+/*!
+	Publishes the current content of the document for reading from other threads and returns it.
+	A new CADocumentVersion is only made, if the document changed since the last call (see
+	generation()). Call this from the thread changing the document, usually the main thread.
+
+	\sa publishedVersion()
+*/
+std::shared_ptr<CADocumentVersion> CADocument::publish()
+{
+    QMutexLocker locker(&_versionMutex);
+    if (!_version || _version->generation() != generation()) {
+        locker.unlock(); // readers get the previous version meanwhile
+        std::shared_ptr<CADocumentVersion> version = std::make_shared<CADocumentVersion>(this);
+        locker.relock();
+        _version = version;
+    }
+
+    return _version;
+}
+
+/*!
+	Returns the last version published by publish() or nullptr, if none was published yet.
+	Safe to call from any thread. The version may be older than the document.
+*/
+std::shared_ptr<CADocumentVersion> CADocument::publishedVersion()
+{
+    QMutexLocker locker(&_versionMutex);
+    return _version;
+}
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -10,6 +10,7 @@
 
 #include <QDateTime>
 #include <QList>
+#include <QMutex>
 #include <QString>
 
 #include <memory>
@@ -17,12 +18,15 @@
 class CASheet;
 class CAArchive;
 class CAResource;
+class CADocumentVersion;
 
 class CADocument {
 public:
     CADocument();
     virtual ~CADocument();
     CADocument* clone();
+    CADocument* snapshot();
+    void cloneDocumentProperties(CADocument* doc);
     void clear();
 
     const QList<CASheet*>& sheetList() { return _sheetList; }
@@ -30,6 +34,7 @@ public:
     inline void addSheet(CASheet* sheet) { _sheetList << sheet; }
     CASheet* addSheet();
     inline void removeSheet(CASheet* sheet) { _sheetList.removeAll(sheet); }
+    CASheet* replaceSheet(int index, CASheet* sheet);
     CASheet* findSheet(const QString name);
 
     const QList<std::shared_ptr<CAResource> >& resourceList() { return _resourceList; }
@@ -67,12 +72,19 @@ public:
     ///////////////////////////////////////////////////////
     const QString fileName() { return _fileName; }
     bool isModified() { return _modified; }
+    inline quint64 generation() { return _generation; }
     CAArchive* archive() { return _archive; }
 
     void setFileName(const QString fileName) { _fileName = fileName; } // not saved!
     void setModified(bool m) { _modified = m; }
+    void updateGeneration();
     void setArchive(CAArchive* a) { _archive = a; }
 
+#ifndef SWIG
+    std::shared_ptr<CADocumentVersion> publish();
+    std::shared_ptr<CADocumentVersion> publishedVersion();
+#endif
+
 private:
     QList<CASheet*> _sheetList;
     QList<std::shared_ptr<CAResource> > _resourceList;
@@ -95,6 +107,10 @@ private:
     ////////////////////////////////////////////////////
     QString _fileName; // absolute filename of the document
     bool _modified; // unsaved changes
+    quint64 _generation; // unique number of the current document content, changed on every modification
+    static quint64 _lastGeneration; // the last generation number given to any document
     CAArchive* _archive; // pointer to existing archive, if it exists
+    std::shared_ptr<CADocumentVersion> _version; // the last published version, guarded by _versionMutex
+    QMutex _versionMutex;
 };
 #endif /* DOCUMENT_H_ */
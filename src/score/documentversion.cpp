@@ -0,0 +1,81 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#include "score/documentversion.h"
+#include "score/document.h"
+#include "score/resource.h"
+#include "score/sheet.h"
+#include "score/staff.h"
+#include "score/voice.h"
+
+#include "core/trace.h"
+
+/*!
+	\class CADocumentVersion
+	\brief Immutable copy of the document for reading from other threads
+
+	The score model is not locked. It is only changed in the main thread and any other thread
+	reading the live document may see it half-changed. Background work (exports, autosave,
+	typesetting) reads a published version of the document instead: a deep copy made in the main
+	thread, which nobody changes afterwards.
+
+	When a version is created, the lazily built caches of the copy (the sheet's staff and voice
+	lists, the voice's sign index used by getClef(), getKeySig() and getTimeSig()) are built in
+	advance. Any number of threads can then read the copy at the same time without locking.
+
+	Versions are published by CADocument::publish() and shared by std::shared_ptr, which keeps an
+	old version alive until its last reader is done with it:
+	\code
+	  std::shared_ptr<CADocumentVersion> version = document->publish(); // main thread
+	  export->exportSheet(version->sheet(currentSheet)); // keep version until the export is done
+	\endcode
+
+	\sa CADocument::publishedVersion(), CAExportSnapshot
+*/
+
+/*!
+	Copies the document \a doc. Call it from the thread changing the document, usually the
+	main thread.
+*/
+CADocumentVersion::CADocumentVersion(CADocument* doc)
+    : _document(doc->clone())
+    , _generation(doc->generation())
+{
+    CA_TRACE_ZONE("CADocumentVersion::CADocumentVersion");
+
+    for (int i = 0; i < doc->sheetList().size(); i++) {
+        _sheetMap[doc->sheetList()[i]] = _document->sheetList()[i];
+    }
+
+    for (CASheet* sheet : _document->sheetList()) {
+        sheet->staffList();
+        for (CAVoice* voice : sheet->voiceList()) {
+            voice->buildTypeIndex();
+        }
+        sheet->buildTempoMap();
+        sheet->buildChordIndex();
+        sheet->buildBarTable();
+    }
+}
+
+CADocumentVersion::~CADocumentVersion()
+{
+    // the resources are shared with the original document, deleting them would remove them there too
+    while (_document->resourceList().size()) {
+        _document->removeResource(_document->resourceList().first());
+    }
+    delete _document;
+}
+
+/*!
+	Returns the copy of the \a original sheet or nullptr, if the sheet wasn't part of the
+	document when the version was made.
+*/
+CASheet* CADocumentVersion::sheet(CASheet* original) const
+{
+    return _sheetMap.value(original, nullptr);
+}
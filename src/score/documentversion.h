@@ -0,0 +1,35 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#ifndef DOCUMENTVERSION_H_
+#define DOCUMENTVERSION_H_
+
+#include <QHash>
+#include <QtGlobal>
+
+class CADocument;
+class CASheet;
+
+class CADocumentVersion {
+public:
+    CADocumentVersion(CADocument* doc);
+    ~CADocumentVersion();
+
+    inline CADocument* document() const { return _document; }
+    inline quint64 generation() const { return _generation; }
+    CASheet* sheet(CASheet* original) const;
+
+private:
+    CADocumentVersion(const CADocumentVersion&);
+    CADocumentVersion& operator=(const CADocumentVersion&);
+
+    CADocument* _document; // deep copy of the document, never changed
+    quint64 _generation; // generation of the original document when the copy was made
+    QHash<CASheet*, CASheet*> _sheetMap; // original sheets -> copied sheets
+};
+
+#endif /* DOCUMENTVERSION_H_ */
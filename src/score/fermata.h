@@ -30,7 +30,11 @@ public:
     int compare(CAMusElement*);
 
     inline CAFermataType fermataType() { return _fermataType; }
-    inline void setFermataType(CAFermataType t) { _fermataType = t; }
+    inline void setFermataType(CAFermataType t)
+    {
+        _fermataType = t;
+        contentChanged();
+    }
 
     static const QString fermataTypeToString(CAFermataType t);
     static CAFermataType fermataTypeFromString(const QString r);
@@ -11,6 +11,8 @@
 #include "score/playablelength.h"
 #include "score/sheet.h"
 
+#include <algorithm>
+
 /*!
 	\class CAFiguredBassContext
 	\brief Context for keeping the figured bass marks
@@ -69,47 +71,43 @@ void CAFiguredBassContext::addEmptyFiguredBassMark(int timeStart, int timeLength
 	Updates timeStarts and timeLength of all figured bass marks according to the chords they belong.
 	Adds new empty figured bass marks at the end, if needed.
 
+	Only the marks from the chord before \a timeStart on are updated. Use CASheet::repositContexts()
+	to reposition all the dependent contexts of the sheet at once.
+
  	\sa CALyricsContext::repositSyllables(), CAFunctionMarkContext::repositFunctions(), CAChordNameContext::repositChordNames()
  */
-void CAFiguredBassContext::repositFiguredBassMarks()
+void CAFiguredBassContext::repositFiguredBassMarks(int timeStart)
 {
     if (!sheet()) {
         return;
     }
 
-    QList<CAPlayable*> chord = sheet()->getChord(0);
-    int fbmIdx = 0;
-    while (chord.size()) {
-        int maxTimeStart = chord[0]->timeStart();
-        int minTimeEnd = chord[0]->timeEnd();
-        bool notes = false; // are notes present in the chord or only rests?
-        for (int i = 1; i < chord.size(); i++) {
-            if (chord[i]->musElementType() == CAMusElement::Note) {
-                notes = true;
-            }
-
-            if (chord[i]->timeStart() > maxTimeStart) {
-                maxTimeStart = chord[i]->timeStart();
-            }
-            if (chord[i]->timeEnd() < minTimeEnd) {
-                minTimeEnd = chord[i]->timeEnd();
-            }
-        }
+    int from = sheet()->harmonySliceStart(timeStart);
+    repositFiguredBassMarks(sheet()->harmonySlices(from), from);
+}
 
+/*!
+	Assigns the figured bass marks starting at \a from or later to the chords \a slices containing
+	notes in order, see CASheet::harmonySlices().
+*/
+void CAFiguredBassContext::repositFiguredBassMarks(const QVector<CAHarmonySlice>& slices, int from)
+{
+    int fbmIdx = static_cast<int>(std::lower_bound(_figuredBassMarkList.begin(), _figuredBassMarkList.end(), from, [](CAFiguredBassMark* m, int t) { return m->timeStart() < t; }) - _figuredBassMarkList.begin());
+    for (const CAHarmonySlice& slice : slices) {
         // only assign figured bass marks under the notes
-        if (notes) {
-            // add new empty figured bass, if none exist
-            if (fbmIdx == _figuredBassMarkList.size()) {
-                addEmptyFiguredBassMark(maxTimeStart, minTimeEnd - maxTimeStart);
-            }
-
-            CAFiguredBassMark* mark = _figuredBassMarkList[fbmIdx];
-            mark->setTimeStart(maxTimeStart);
-            mark->setTimeLength(minTimeEnd - maxTimeStart);
-            fbmIdx++;
+        if (!slice.notes) {
+            continue;
+        }
+
+        // add new empty figured bass, if none exist
+        if (fbmIdx == _figuredBassMarkList.size()) {
+            _figuredBassMarkList << new CAFiguredBassMark(this, slice.timeStart, slice.timeLength);
         }
 
-        chord = sheet()->getChord(minTimeEnd);
+        CAFiguredBassMark* mark = _figuredBassMarkList[fbmIdx];
+        mark->setTimeStart(slice.timeStart);
+        mark->setTimeLength(slice.timeLength);
+        fbmIdx++;
     }
 
     // updated times for the figured bass marks at the end (after the score)
@@ -140,6 +138,7 @@ CAContext* CAFiguredBassContext::clone(CASheet* s)
 
     for (int i = 0; i < _figuredBassMarkList.size(); i++) {
         CAFiguredBassMark* newFbm = static_cast<CAFiguredBassMark*>(_figuredBassMarkList[i]->clone(newFbc));
+        newFbm->keepIds(_figuredBassMarkList[i]);
         newFbc->addFiguredBassMark(newFbm);
     }
     return newFbc;
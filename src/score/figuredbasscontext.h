@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2009, Matevž Jekovec, Canorus development team
+	Copyright (c) 2009-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -10,7 +10,9 @@
 
 #include "score/context.h"
 #include <QList>
+#include <QVector>
 
+struct CAHarmonySlice;
 class CAFiguredBassMark;
 
 class CAFiguredBassContext : public CAContext {
@@ -27,7 +29,10 @@ public:
     QList<CAFiguredBassMark*>& figuredBassMarkList() { return _figuredBassMarkList; }
     CAFiguredBassMark* figuredBassMarkAtTimeStart(int timeStart);
 
-    void repositFiguredBassMarks();
+    void repositFiguredBassMarks(int timeStart = 0);
+#ifndef SWIG
+    void repositFiguredBassMarks(const QVector<CAHarmonySlice>& slices, int from);
+#endif
     void addFiguredBassMark(CAFiguredBassMark*, bool replace = true);
     void addEmptyFiguredBassMark(int timeStart, int timeLength);
 
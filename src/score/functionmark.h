@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICNESE.GPL for details.
@@ -46,8 +46,8 @@ public:
     CADiatonicKey key() { return _key; }
     CAFunctionType chordArea() { return _chordArea; }
     CAFunctionType tonicDegree() { return _tonicDegree; }
-    QList<int> alteredDegrees() { return _alteredDegrees; }
-    QList<int> addedDegrees() { return _addedDegrees; }
+    const QList<int>& alteredDegrees() { return _alteredDegrees; }
+    const QList<int>& addedDegrees() { return _addedDegrees; }
     void setFunction(CAFunctionType function) { _function = function; }
     void setKey(CADiatonicKey key) { _key = key; }
     void setChordArea(CAFunctionType chordArea) { _chordArea = chordArea; }
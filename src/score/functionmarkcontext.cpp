@@ -10,6 +10,8 @@
 #include "score/playable.h"
 #include "score/sheet.h"
 
+#include <algorithm>
+
 /*!
 	\class CAFunctionMarkContext
 	\brief Context for function marks
@@ -40,6 +42,7 @@ CAFunctionMarkContext* CAFunctionMarkContext::clone(CASheet* s)
 
     for (int i = 0; i < _functionMarkList.size(); i++) {
         CAFunctionMark* newFm = _functionMarkList[i]->clone(newFmc);
+        newFm->keepIds(_functionMarkList[i]);
         newFmc->addFunctionMark(newFm);
     }
 
@@ -108,27 +111,46 @@ bool CAFunctionMarkContext::remove(CAMusElement* elt)
 	If two functions contain the same timeStart, they are treated as modulation and will contain
 	the same timeStart after reposition is done as well!
 
+	Only the functions from the chord before \a timeStart on are repositioned. Use
+	CASheet::repositContexts() to reposition all the dependent contexts of the sheet at once.
+
  	\sa CALyricsContext::repositSyllables(), CAFiguredBassContext::repositFiguredBassMarks(), CAChordNameContext::repositChordNames()
 */
-void CAFunctionMarkContext::repositFunctions()
+void CAFunctionMarkContext::repositFunctions(int timeStart)
+{
+    if (!sheet()) {
+        repositFunctions(QVector<CAHarmonySlice>(), 0);
+        return;
+    }
+
+    int from = sheet()->harmonySliceStart(timeStart);
+    repositFunctions(sheet()->harmonySlices(from), from);
+}
+
+/*!
+	Assigns the functions starting at \a from or later to the chords \a slices in order, see
+	CASheet::harmonySlices(). The functions left over are placed after the last chord.
+*/
+void CAFunctionMarkContext::repositFunctions(const QVector<CAHarmonySlice>& slices, int from)
 {
-    int ts, tl;
-    int curIdx; // contains current position in _functionMarkList
-    QList<CAPlayable*> chord;
-    for (ts = 0, curIdx = 0;
-         (sheet() && (chord = sheet()->getChord(ts)).size()) || curIdx < _functionMarkList.size(); ts += tl) {
-        tl = (chord.size() ? chord[0]->timeLength() : 256);
-        for (int i = 0; i < chord.size(); i++)
-            if (chord[i]->timeLength() < tl)
-                tl = chord[i]->timeLength();
+    int curIdx = static_cast<int>(std::lower_bound(_functionMarkList.begin(), _functionMarkList.end(), from, [](CAFunctionMark* f, int t) { return f->timeStart() < t; }) - _functionMarkList.begin());
+    int ts = from;
+    int tl = 256;
+    for (int k = 0; k < slices.size() || curIdx < _functionMarkList.size(); k++, ts += tl) {
+        if (k < slices.size()) {
+            ts = slices[k].timeStart;
+            tl = slices[k].timeLength;
+        } else {
+            tl = 256;
+        }
 
         if (curIdx == _functionMarkList.size()) { // add new empty functions, if chords still exist
-            addEmptyFunction(ts, tl);
-            curIdx++;
+            _functionMarkList << new CAFunctionMark(CAFunctionMark::Undefined, false, CADiatonicKey("C"), this, ts, tl);
         }
 
-        // apply timeStart and timeLength to existing function marks
-        for (int startIdx = curIdx; curIdx == 0 || (curIdx < _functionMarkList.size() && _functionMarkList[curIdx]->timeStart() == _functionMarkList[startIdx]->timeStart()); curIdx++) {
+        // apply timeStart and timeLength to the function and its modulations
+        int oldTimeStart = _functionMarkList[curIdx]->timeStart();
+        for (; curIdx < _functionMarkList.size() && _functionMarkList[curIdx]->timeStart() == oldTimeStart; curIdx++) {
             _functionMarkList[curIdx]->setTimeLength(tl);
             _functionMarkList[curIdx]->setTimeStart(ts);
         }
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -10,9 +10,11 @@
 
 #include <QList>
 #include <QString>
+#include <QVector>
 
 #include "score/context.h"
 
+struct CAHarmonySlice;
 class CASheet;
 class CAFunctionMark;
 
@@ -27,7 +29,10 @@ public:
     void addFunctionMark(CAFunctionMark* mark, bool replace = true);
     void addEmptyFunction(int timeStart, int timeLength);
 
-    void repositFunctions();
+    void repositFunctions(int timeStart = 0);
+#ifndef SWIG
+    void repositFunctions(const QVector<CAHarmonySlice>& slices, int from);
+#endif
 
     void clear();
     CAMusElement* next(CAMusElement* elt);
@@ -22,7 +22,11 @@ public:
     int compare(CAMusElement*);
 
     inline int instrument() { return _instrument; }
-    inline void setInstrument(const int instrument) { _instrument = instrument; }
+    inline void setInstrument(const int instrument)
+    {
+        _instrument = instrument;
+        contentChanged();
+    }
 
 private:
     int _instrument;
@@ -173,33 +173,11 @@ CAInterval CAInterval::operator+(CAInterval i)
  */
 int CAInterval::semitones()
 {
-    int semitones = 0;
-    int absQuantity = ((qAbs(quantity()) - 1) % 7) + 1;
+    // semitones of the major and perfect intervals, which are default, indexed by quantity
+    static const int majorSemitones[] = { 0, 0, 2, 4, 5, 7, 9, 11 };
 
-    // major and perfect intervals are default
-    switch (absQuantity) {
-    case Prime:
-        semitones = 0;
-        break;
-    case Second:
-        semitones = 2;
-        break;
-    case Third:
-        semitones = 4;
-        break;
-    case Fourth:
-        semitones = 5;
-        break;
-    case Fifth:
-        semitones = 7;
-        break;
-    case Sixth:
-        semitones = 9;
-        break;
-    case Seventh:
-        semitones = 11;
-        break;
-    }
+    int absQuantity = ((qAbs(quantity()) - 1) % 7) + 1;
+    int semitones = majorSemitones[absQuantity];
 
     // minor or diminished/augmented
     switch (quality()) {
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2008, Matevž Jekovec, Canorus development team
+	Copyright (c) 2008-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -77,7 +77,7 @@ public:
     static const QString quantityToReadable(int k);
 
 private:
-    int _qlt;
-    int _qnt;
+    qint16 _qlt;
+    qint16 _qnt;
 };
 #endif /* INTERVAL_H_ */
@@ -89,22 +89,10 @@ CAKeySignature::CAKeySignature(CAModus m, CAStaff* staff, int timeStart)
 void CAKeySignature::updateAccidentals()
 {
     if (keySignatureType() == MajorMinor) {
-        for (int i = 0; i < 7; i++) // clean up the _accidentals array
-            _accidentals[i] = 0;
-
-        // generate the _accidentals array according to the given number of the accidentals
         // eg. _accidentals[3] = -1; means flat on the 3rd note (counting from 0), this means this key signature has Fes instead of F.
-        int idx = 3;
-        for (int i = 0; i < _diatonicKey.numberOfAccs(); i++) { // key signatures with sharps
-            _accidentals[idx] = 1;
-            idx = (idx + 4) % 7; // the circle of fifths in positive direction - add a Fifth
-        }
-
-        idx = 6;
-        for (int i = 0; i > _diatonicKey.numberOfAccs(); i--) { // key signatures with flats
-            _accidentals[idx] = -1;
-            idx = (idx + 3) % 7; // the circle of fifths in negative direction - add a Fourth
-        }
+        const signed char* accs = CADiatonicKey::keyAccs(_diatonicKey.numberOfAccs());
+        for (int i = 0; i < 7; i++)
+            _accidentals[i] = accs[i];
     }
 }
 
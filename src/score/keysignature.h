@@ -45,7 +45,11 @@ public:
     CAStaff* staff() { return static_cast<CAStaff*>(context()); }
 
     inline CAKeySignatureType keySignatureType() { return _keySignatureType; }
-    inline void setKeySignatureType(CAKeySignatureType type) { _keySignatureType = type; }
+    inline void setKeySignatureType(CAKeySignatureType type)
+    {
+        _keySignatureType = type;
+        contentChanged();
+    }
 
     CADiatonicKey diatonicKey() { return _diatonicKey; }
     CAModus modus() { return _modus; }
@@ -54,8 +58,13 @@ public:
     {
         _diatonicKey = k;
         updateAccidentals();
+        contentChanged();
+    }
+    void setModus(CAModus modus)
+    {
+        _modus = modus;
+        contentChanged();
     }
-    void setModus(CAModus modus) { _modus = modus; }
 
     QList<int>& accidentals() { return _accidentals; }
 
@@ -9,6 +9,8 @@
 #include "score/syllable.h"
 #include "score/voice.h"
 
+#include <algorithm>
+
 /*!
 	\class CALyricsContext
 	\brief One stanza line of lyrics
@@ -66,6 +68,7 @@ CALyricsContext* CALyricsContext::clone(CASheet* s)
 
     for (int i = 0; i < _syllableList.size(); i++) {
         CASyllable* newSyllable = static_cast<CASyllable*>(_syllableList[i]->clone(newLc));
+        newSyllable->keepIds(_syllableList[i]);
         newLc->addSyllable(newSyllable);
     }
     return newLc;
@@ -87,39 +90,82 @@ void CALyricsContext::cloneLyricsContextProperties(CALyricsContext* lc)
 	This function is usually called when associatedVoice is changed or the whole lyricsContext is initialized for the first time.
 	If the notes and syllables aren't synchronized (too little syllables for notes) it adds empty syllables.
 
+	Only the syllables starting at \a timeStart or later are repositioned. The syllables before are
+	expected to still match their chords, so pass the time of the first changed note when editing.
+
  	\sa CAFunctionMarkContext::repositFunctions(), CAFiguredBassContext::repositFiguredBassMarks(), CAChordNameContext::repositChordNames()
 */
-void CALyricsContext::repositSyllables()
+void CALyricsContext::repositSyllables(int timeStart)
 {
     if (associatedVoice()) {
-        QList<CANote*> noteList = associatedVoice()->getNoteList();
-        int i, j;
-        for (i = 0, j = 0; i < noteList.size() && j < _syllableList.size(); i++, j++) {
-            if (i > 0 && noteList[i - 1]->timeStart() == noteList[i]->timeStart()) { // chord
-                i++;
-                continue;
-            }
-            _syllableList[j]->setTimeStart(noteList[i]->timeStart());
-            _syllableList[j]->setTimeLength(noteList[i]->timeLength());
-        }
-        int firstEmpty = j;
-        for (; j < _syllableList.size() && j > 0; j++) { // add syllables at the end, if too much of them exist
-            if (!_syllableList[j]->text().isEmpty())
-                firstEmpty = j + 1;
+        repositSyllables(chordTimes(associatedVoice(), timeStart), timeStart);
+    }
+}
 
-            _syllableList[j]->setTimeStart(_syllableList[j - 1]->timeStart() + _syllableList[j - 1]->timeLength());
-            _syllableList[j]->setTimeLength(256);
-        }
-        // remove empty "leftover" syllables from the end
-        for (j = firstEmpty; j < _syllableList.size() && j > 0; j++) {
-            delete _syllableList.takeAt(j);
-        }
+/*!
+	Repositions the syllables of all the stanzas of the given \a voice starting at \a timeStart or
+	later. The chords are collected only once for all the stanzas.
+
+	\sa repositSyllables(int)
+*/
+void CALyricsContext::repositSyllables(CAVoice* voice, int timeStart)
+{
+    if (!voice || voice->lyricsContextList().isEmpty()) {
+        return;
+    }
+
+    QVector<QPair<int, int>> chords = chordTimes(voice, timeStart);
+    for (CALyricsContext* lc : voice->lyricsContextList()) {
+        lc->repositSyllables(chords, timeStart);
+    }
+}
 
-        for (; i < noteList.size(); i++) { // add empty syllables at the end, if missing
-            if (i > 0 && noteList[i]->timeStart() == noteList[i - 1]->timeStart()) // chord
-                continue;
-            addEmptySyllable(noteList[i]->timeStart(), noteList[i]->timeLength());
+/*!
+	Returns the time starts and lengths of the chords in the \a voice starting at \a timeStart or
+	later, one pair per chord.
+*/
+QVector<QPair<int, int>> CALyricsContext::chordTimes(CAVoice* voice, int timeStart)
+{
+    QVector<QPair<int, int>> chords;
+    const QList<CAMusElement*>& list = voice->musElementList();
+    for (int i = voice->lowerBound(timeStart); i < list.size(); i++) {
+        if (list[i]->musElementType() != CAMusElement::Note || (chords.size() && chords.last().first == list[i]->timeStart())) {
+            continue;
         }
+        chords << qMakePair(list[i]->timeStart(), list[i]->timeLength());
+    }
+    return chords;
+}
+
+/*!
+	Assigns the syllables starting at \a timeStart or later to the given \a chords in order, one
+	syllable per chord.
+*/
+void CALyricsContext::repositSyllables(const QVector<QPair<int, int>>& chords, int timeStart)
+{
+    int j = std::lower_bound(_syllableList.begin(), _syllableList.end(), timeStart, [](CASyllable* s, int time) { return s->timeStart() < time; }) - _syllableList.begin();
+    int i;
+    for (i = 0; i < chords.size() && j < _syllableList.size(); i++, j++) {
+        _syllableList[j]->setTimeStart(chords[i].first);
+        _syllableList[j]->setTimeLength(chords[i].second);
+    }
+
+    int firstEmpty = j;
+    for (; j < _syllableList.size(); j++) { // add syllables at the end, if too much of them exist
+        if (!_syllableList[j]->text().isEmpty())
+            firstEmpty = j + 1;
+
+        _syllableList[j]->setTimeStart(j > 0 ? _syllableList[j - 1]->timeStart() + _syllableList[j - 1]->timeLength() : 0);
+        _syllableList[j]->setTimeLength(256);
+    }
+    // remove empty "leftover" syllables from the end
+    while (_syllableList.size() > firstEmpty) {
+        delete _syllableList.takeLast();
+    }
+
+    for (; i < chords.size(); i++) { // add empty syllables at the end, if missing
+        CASyllable* last = _syllableList.size() ? _syllableList.last() : nullptr;
+        _syllableList << new CASyllable("", last && last->hyphenStart(), last && last->melismaStart(), this, chords[i].first, chords[i].second);
     }
 }
 
@@ -189,6 +235,26 @@ CASyllable* CALyricsContext::removeSyllableAtTimeStart(int timeStart)
     }
 }
 
+/*!
+	Removes and destroys the given \a syllables of this context in one pass. The times of the
+	remaining syllables are not changed, call repositSyllables() afterwards.
+
+	\sa removeSyllableAtTimeStart()
+*/
+void CALyricsContext::removeSyllables(const QSet<CASyllable*>& syllables)
+{
+    QList<CASyllable*> list;
+    list.reserve(_syllableList.size());
+    for (CASyllable* syllable : _syllableList) {
+        if (syllables.contains(syllable)) {
+            delete syllable;
+        } else {
+            list << syllable;
+        }
+    }
+    _syllableList = list;
+}
+
 /*!
 	Adds a syllable to the context. The syllable at that location is replaced (default) by the new one, if
 	\a replace is True.
@@ -236,11 +302,9 @@ bool CALyricsContext::addEmptySyllable(int timeStart, int timeLength)
  */
 CASyllable* CALyricsContext::syllableAtTimeStart(int timeStart)
 {
-    int i;
-    for (i = 0; i < _syllableList.size() && _syllableList[i]->timeStart() != timeStart; i++)
-        ;
-    if (i < _syllableList.size())
-        return _syllableList[i];
+    QList<CASyllable*>::const_iterator it = std::lower_bound(_syllableList.constBegin(), _syllableList.constEnd(), timeStart, [](CASyllable* s, int time) { return s->timeStart() < time; });
+    if (it != _syllableList.constEnd() && (*it)->timeStart() == timeStart)
+        return *it;
     else
         return nullptr;
 }
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -13,6 +13,9 @@
 
 #include <QHash>
 #include <QList>
+#include <QPair>
+#include <QSet>
+#include <QVector>
 
 class CASyllable;
 
@@ -24,7 +27,8 @@ public:
     CALyricsContext* clone(CASheet* s);
     void cloneLyricsContextProperties(CALyricsContext*);
 
-    void repositSyllables();
+    void repositSyllables(int timeStart = 0);
+    static void repositSyllables(CAVoice* voice, int timeStart = 0);
 
     CAMusElement* next(CAMusElement*);
     CAMusElement* previous(CAMusElement*);
@@ -36,6 +40,9 @@ public:
     bool addEmptySyllable(int timeStart, int timeLength);
     //	void removeSyllable( CASyllable* s ) { _syllableList.removeAll(s); }
     CASyllable* removeSyllableAtTimeStart(int timeStart);
+#ifndef SWIG
+    void removeSyllables(const QSet<CASyllable*>& syllables);
+#endif
     CASyllable* syllableAtTimeStart(int timeStart);
 
     inline CAVoice* associatedVoice() { return _associatedVoice; }
@@ -46,6 +53,9 @@ public:
     inline void setCustomStanzaName(QString name) { _customStanzaName = name; }
 
 private:
+    static QVector<QPair<int, int>> chordTimes(CAVoice* voice, int timeStart);
+    void repositSyllables(const QVector<QPair<int, int>>& chords, int timeStart);
+
     QList<CASyllable*> _syllableList;
     CAVoice* _associatedVoice;
     int _stanzaNumber;
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -50,10 +50,12 @@ public:
         _associatedElt = elt;
         if (elt)
             _context = elt->context();
+        setTimeSegment(elt ? elt->timeSegment() : nullptr);
     }
 
     inline CAMarkType markType() { return _markType; }
-    inline void setMarkType(CAMarkType type) { _markType = type; }
+    inline void setMarkType(CAMarkType type) { _markType = type; } // only before the mark is added to an element
+    static inline quint32 markTypeBit(CAMarkType type) { return type >= 0 ? 1u << type : 0; }
 
     inline bool isCommon() { return _common; }
 
@@ -69,4 +71,60 @@ private:
     bool _common; // is mark assigned to a single element only or the whole chord - depends who deletes it!
 };
 
+#ifndef SWIG
+// Marks of a single type of an element cast to T, see CAMusElement::marksOfType().
+template <class T>
+class CAMarkRange {
+public:
+    class iterator {
+    public:
+        iterator(QList<CAMark*>::const_iterator it)
+            : _it(it)
+        {
+        }
+
+        inline T* operator*() const { return static_cast<T*>(*_it); }
+        inline iterator& operator++()
+        {
+            ++_it;
+            return *this;
+        }
+        inline bool operator!=(const iterator& other) const { return _it != other._it; }
+
+    private:
+        QList<CAMark*>::const_iterator _it;
+    };
+
+    CAMarkRange(QList<CAMark*>::const_iterator begin, QList<CAMark*>::const_iterator end)
+        : _begin(begin)
+        , _end(end)
+    {
+    }
+
+    inline iterator begin() const { return _begin; }
+    inline iterator end() const { return _end; }
+    inline bool isEmpty() const { return !(_begin != _end); }
+
+private:
+    QList<CAMark*>::const_iterator _begin;
+    QList<CAMark*>::const_iterator _end;
+};
+
+// The marks are sorted by their type, so the marks of the given type are consecutive.
+template <class T>
+CAMarkRange<T> CAMusElement::marksOfType(int markType)
+{
+    const QList<CAMark*>& marks = markList();
+    QList<CAMark*>::const_iterator begin = marks.constEnd();
+    QList<CAMark*>::const_iterator end = marks.constEnd();
+    if (hasMark(markType)) {
+        for (begin = marks.constBegin(); begin != end && (*begin)->markType() != markType; ++begin)
+            ;
+        for (end = begin; end != marks.constEnd() && (*end)->markType() == markType; ++end)
+            ;
+    }
+    return CAMarkRange<T>(begin, end);
+}
+#endif
+
 #endif /* MARK_H_ */
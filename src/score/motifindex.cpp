@@ -0,0 +1,288 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#include <QRegExp>
+#include <QStringList>
+
+#include "score/document.h"
+#include "score/motifindex.h"
+#include "score/note.h"
+#include "score/sheet.h"
+#include "score/slur.h"
+#include "score/voice.h"
+
+#include <algorithm>
+
+const int CAMotifIndex::GRAM_SIZE = 3;
+
+namespace {
+
+/*!
+	Returns the melody of the given music elements sorted by their time: the highest note of
+	each chord with the lengths of tied notes added up.
+*/
+QVector<CAMotifNote> melody(const QList<CAMusElement*>& elts)
+{
+    QVector<CAMotifNote> notes;
+    bool phraseStart = true;
+    for (CAMusElement* elt : elts) {
+        if (elt->musElementType() == CAMusElement::Rest) {
+            phraseStart = true;
+            continue;
+        }
+        if (elt->musElementType() != CAMusElement::Note) {
+            continue;
+        }
+
+        CANote* note = static_cast<CANote*>(elt);
+        if (!notes.isEmpty()) {
+            CAMotifNote& last = notes.last();
+            if (last.note->timeStart() == note->timeStart()) { // chord
+                if (note->midiPitch() > last.pitch) {
+                    last.note = note;
+                    last.pitch = note->midiPitch();
+                    last.timeLength = note->timeLength();
+                }
+                continue;
+            }
+            if (last.note->tieStart() && last.note->tieStart()->noteEnd() == note) {
+                last.timeLength += note->timeLength();
+                continue;
+            }
+        }
+
+        CAMotifNote n;
+        n.note = note;
+        n.pitch = note->midiPitch();
+        n.timeLength = note->timeLength();
+        n.phraseStart = phraseStart;
+        notes << n;
+        phraseStart = false;
+    }
+
+    return notes;
+}
+
+}
+
+/*!
+	\class CAMotifIndex
+	\brief N-gram index of the melody of a voice
+
+	The index keeps the melody of the voice (the highest note of each chord, tied notes
+	merged, see CAMotifNote) and the positions of each sequence of GRAM_SIZE consecutive
+	intervals in it. Patterns are looked up by their first intervals and only the candidates
+	are compared note by note, so the search is transposition-invariant and doesn't scan the
+	whole voice. Rests split the melody into phrases, which patterns don't cross.
+
+	The index of a voice is built by CAVoice::motifIndex() on the first search after the voice
+	was edited.
+
+	\sa CAMotifSearch
+*/
+
+CAMotifIndex::CAMotifIndex(CAVoice* voice)
+    : _notes(melody(voice->musElementList()))
+{
+    for (int i = 0; i + GRAM_SIZE < _notes.size(); i++) {
+        int intervals[GRAM_SIZE];
+        bool phrase = true;
+        for (int j = 0; j < GRAM_SIZE; j++) {
+            if (_notes[i + j + 1].phraseStart) {
+                phrase = false;
+                break;
+            }
+            intervals[j] = _notes[i + j + 1].pitch - _notes[i + j].pitch;
+        }
+
+        if (phrase) {
+            _grams[gramKey(intervals)] << i;
+        }
+    }
+}
+
+/*!
+	Returns the indices of the melody notes starting the given \a pattern.
+*/
+QList<int> CAMotifIndex::find(const CAMotifPattern& pattern) const
+{
+    QList<int> result;
+    if (pattern.intervals.isEmpty()) {
+        return result;
+    }
+
+    if (pattern.intervals.size() >= GRAM_SIZE) {
+        for (int i : _grams.value(gramKey(pattern.intervals.constData()))) {
+            if (matches(pattern, i)) {
+                result << i;
+            }
+        }
+    } else { // too short for the index
+        for (int i = 0; i + pattern.intervals.size() < _notes.size(); i++) {
+            if (matches(pattern, i)) {
+                result << i;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*!
+	Returns True, if the melody starting at the note \a idx matches the \a pattern.
+*/
+bool CAMotifIndex::matches(const CAMotifPattern& pattern, int idx) const
+{
+    int n = pattern.intervals.size();
+    if (idx + n >= _notes.size()) {
+        return false;
+    }
+
+    for (int j = 0; j < n; j++) {
+        const CAMotifNote& next = _notes[idx + j + 1];
+        if (next.phraseStart || next.pitch - _notes[idx + j].pitch != pattern.intervals[j]) {
+            return false;
+        }
+    }
+
+    if (!pattern.lengths.isEmpty()) {
+        for (int j = 0; j <= n; j++) {
+            if (_notes[idx + j].timeLength != pattern.lengths[j]) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/*!
+	Packs the first GRAM_SIZE \a intervals into the hash key. Intervals are limited to two
+	octaves, the larger ones are compared exactly by matches().
+*/
+quint32 CAMotifIndex::gramKey(const int* intervals)
+{
+    quint32 key = 0;
+    for (int j = 0; j < GRAM_SIZE; j++) {
+        key = (key << 8) | static_cast<quint32>(qBound(-24, intervals[j], 24) + 128);
+    }
+    return key;
+}
+
+/*!
+	\class CAMotifSearch
+	\brief Finds the occurrences of a motif in all the voices
+
+	The motif is given by its notes, eg. the current selection, or by its intervals in semitones.
+	It is found at any transposition, and only notes of the same lengths match, if the rhythm
+	is matched as well:
+	\code
+	  search = CanorusPython.CAMotifSearch("2 2 -4")
+	  for i in range(search.search(document)):
+	      print(search.hitVoice(i).name(), search.hitTimeStart(i))
+	\endcode
+
+	The voices keep their CAMotifIndex between the searches, so only the voices edited since
+	the last search are indexed again.
+*/
+
+/*!
+	Creates the search for the melody of the notes in \a motif. At least two melody notes are
+	needed. If \a matchRhythm is True, the note lengths must match as well.
+*/
+CAMotifSearch::CAMotifSearch(const QList<CAMusElement*> motif, bool matchRhythm)
+{
+    QList<CAMusElement*> elts = motif;
+    std::stable_sort(elts.begin(), elts.end(), [](CAMusElement* a, CAMusElement* b) { return a->timeStart() < b->timeStart(); });
+
+    QVector<CAMotifNote> notes = melody(elts);
+    for (int i = 1; i < notes.size(); i++) {
+        _pattern.intervals << notes[i].pitch - notes[i - 1].pitch;
+    }
+    if (matchRhythm && notes.size() > 1) {
+        for (const CAMotifNote& note : notes) {
+            _pattern.lengths << note.timeLength;
+        }
+    }
+}
+
+/*!
+	Creates the search for the \a intervals in semitones separated by spaces or commas, eg.
+	"2 2 -4". The search is invalid, if the string contains anything else.
+*/
+CAMotifSearch::CAMotifSearch(const QString intervals)
+{
+    for (const QString& interval : intervals.split(QRegExp("[\\s,]+"), QString::SkipEmptyParts)) {
+        bool ok = false;
+        int i = interval.toInt(&ok);
+        if (!ok) {
+            _pattern.intervals.clear();
+            return;
+        }
+        _pattern.intervals << i;
+    }
+}
+
+/*!
+	Searches all the sheets of the \a document. Returns the number of hits.
+*/
+int CAMotifSearch::search(CADocument* document)
+{
+    _hits.clear();
+    for (CASheet* sheet : document->sheetList()) {
+        addHits(sheet);
+    }
+
+    return _hits.size();
+}
+
+/*!
+	Searches the voices of the \a sheet only. Returns the number of hits.
+*/
+int CAMotifSearch::search(CASheet* sheet)
+{
+    _hits.clear();
+    addHits(sheet);
+
+    return _hits.size();
+}
+
+void CAMotifSearch::addHits(CASheet* sheet)
+{
+    for (CAVoice* voice : sheet->voiceList()) {
+        for (int i : voice->motifIndex().find(_pattern)) {
+            _hits << CAMotifHit{ voice, i };
+        }
+    }
+}
+
+/*!
+	Returns the melody notes of the hit \a i. The hits are only valid until their voice is
+	edited.
+*/
+QList<CANote*> CAMotifSearch::hitNotes(int i)
+{
+    QList<CANote*> notes;
+    const QVector<CAMotifNote>& melody = _hits[i].voice->motifIndex().notes();
+    if (_hits[i].note + _pattern.intervals.size() >= melody.size()) {
+        return notes;
+    }
+    for (int j = 0; j <= _pattern.intervals.size(); j++) {
+        notes << melody[_hits[i].note + j].note;
+    }
+
+    return notes;
+}
+
+/*!
+	Returns the time of the first note of the hit \a i.
+*/
+int CAMotifSearch::hitTimeStart(int i)
+{
+    const QVector<CAMotifNote>& melody = _hits[i].voice->motifIndex().notes();
+    return (_hits[i].note < melody.size() ? melody[_hits[i].note].note->timeStart() : -1);
+}
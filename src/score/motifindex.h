@@ -0,0 +1,87 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#ifndef MOTIFINDEX_H_
+#define MOTIFINDEX_H_
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+class CADocument;
+class CAMusElement;
+class CANote;
+class CASheet;
+class CAVoice;
+
+#ifndef SWIG
+struct CAMotifPattern {
+    QVector<int> intervals; // in semitones between the consecutive notes
+    QVector<int> lengths; // time lengths of the notes, empty when the rhythm is not matched
+};
+
+struct CAMotifNote {
+    CANote* note; // highest note of the chord
+    int pitch; // midi pitch
+    int timeLength; // including the tied notes
+    bool phraseStart; // a rest or the voice start precedes the note
+};
+#endif
+
+class CAMotifIndex {
+public:
+    CAMotifIndex(CAVoice* voice);
+
+#ifndef SWIG
+    QList<int> find(const CAMotifPattern& pattern) const;
+    inline const QVector<CAMotifNote>& notes() const { return _notes; }
+#endif
+    inline int noteCount() const { return _notes.size(); }
+
+    static const int GRAM_SIZE;
+
+private:
+#ifndef SWIG
+    bool matches(const CAMotifPattern& pattern, int idx) const;
+    static quint32 gramKey(const int* intervals);
+
+    QVector<CAMotifNote> _notes; // melody of the voice
+    QHash<quint32, QVector<int>> _grams; // indices of the notes starting each sequence of GRAM_SIZE intervals
+#endif
+};
+
+class CAMotifSearch {
+public:
+    CAMotifSearch(const QList<CAMusElement*> motif, bool matchRhythm = false);
+    CAMotifSearch(const QString intervals);
+
+    inline bool isValid() { return _pattern.intervals.size() > 0; }
+
+    int search(CADocument* document);
+    int search(CASheet* sheet);
+
+    inline int hitCount() { return _hits.size(); }
+    inline CAVoice* hitVoice(int i) { return _hits[i].voice; }
+    QList<CANote*> hitNotes(int i);
+    int hitTimeStart(int i);
+
+private:
+#ifndef SWIG
+    void addHits(CASheet* sheet);
+
+    struct CAMotifHit {
+        CAVoice* voice;
+        int note; // index of the first note in the motif index of the voice
+    };
+
+    CAMotifPattern _pattern;
+    QList<CAMotifHit> _hits;
+#endif
+};
+
+#endif /* MOTIFINDEX_H_ */
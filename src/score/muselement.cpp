@@ -9,9 +9,19 @@
 #include "score/articulation.h"
 #include "score/context.h"
 #include "score/mark.h"
+#include "score/note.h"
 #include "score/notecheckererror.h"
 #include "score/playable.h"
+#include "score/slur.h"
+#include "score/sheet.h"
 #include "score/staff.h"
+#include "score/tuplet.h"
+#include "score/voice.h"
+
+#include <atomic>
+
+const QList<CAMark*> CAMusElement::EMPTY_MARK_LIST;
+const QList<CANoteCheckerError*> CAMusElement::EMPTY_NOTE_CHECKER_ERROR_LIST;
 
 /*!
 	\class CAMusElement
@@ -29,6 +39,13 @@
 	has one or more of its drawable instances. These classes are named CADrawableClassName,
 	where ClassName is type of the music element. eg. CADrawableClef, CADrawableBarline etc.
 
+	Marks, note checker errors, the name and the color are rarely set, so they are stored in a
+	separate structure which is only allocated for the elements using them. The remaining fields
+	are ordered by size, so the derived classes don't waste space on the padding.
+
+	Each element carries a stable id(), which survives the undo snapshots, so the elements and
+	contexts of two snapshots are matched by a hash lookup instead of by their order.
+
 	\sa CAMusElementType, CAContext, CADrawableMusElement
 */
 
@@ -38,12 +55,48 @@
 */
 CAMusElement::CAMusElement(CAContext* context, int time, int length)
 {
+    _id = newId();
     _context = context;
     _timeStart = time;
     _timeLength = length;
+    _timeSegment = nullptr;
     _musElementType = CAMusElement::Undefined;
     _visible = true;
-    _color = QColor(); // invalid color by default
+    _extras = nullptr; // no marks, errors and invalid color by default
+}
+
+/*!
+	Returns a new identifier, unique within the running application. Both the music elements and
+	the contexts take their ids from this.
+
+	\sa id()
+*/
+quint64 CAMusElement::newId()
+{
+    static std::atomic<quint64> lastId(0);
+    return ++lastId;
+}
+
+/*!
+	\fn quint64 CAMusElement::id() const
+	Returns the stable identifier of the element. The clones made by clone() (eg. when pasting) get
+	new ids, while the snapshots made by CASheet::clone() for the undo keep the ids of the original
+	elements by calling keepIds(), so the same elements of the two documents share the id.
+*/
+
+/*!
+	Sets the ids of the element and its marks to the ids of the \a original element it was cloned
+	from. The marks are matched by their order.
+*/
+void CAMusElement::keepIds(CAMusElement* original)
+{
+    _id = original->id();
+
+    const QList<CAMark*>& marks = markList();
+    const QList<CAMark*>& originalMarks = original->markList();
+    for (int i = 0; i < marks.size() && i < originalMarks.size(); i++) {
+        marks[i]->setId(originalMarks[i]->id());
+    }
 }
 
 /*!
@@ -52,11 +105,11 @@ CAMusElement::CAMusElement(CAContext* context, int time, int length)
 */
 CAMusElement::~CAMusElement()
 {
-    while (!_markList.isEmpty()) {
-        if (!_markList.first()->isCommon() || musElementType() != CAMusElement::Note) {
-            delete _markList.takeFirst();
+    while (_extras && !_extras->markList.isEmpty()) {
+        if (!_extras->markList.first()->isCommon() || musElementType() != CAMusElement::Note) {
+            delete _extras->markList.takeFirst();
         } else {
-            _markList.takeFirst();
+            _extras->markList.takeFirst();
         }
     }
 
@@ -64,8 +117,35 @@ CAMusElement::~CAMusElement()
     if (context() && !isPlayable())
         context()->remove(this);
 
-    while (_noteCheckerErrorList.size()) {
-        delete _noteCheckerErrorList.front(); // also removes instances from _noteCheckerErrorList and CASheet->noteCheckerErrorList
+    while (_extras && _extras->noteCheckerErrorList.size()) {
+        delete _extras->noteCheckerErrorList.front(); // also removes instances from noteCheckerErrorList and CASheet->noteCheckerErrorList
+    }
+
+    delete _extras;
+}
+
+/*!
+	Makes the start time of this element relative to the given time \a segment or absolute, if
+	\a segment is null. The absolute start time doesn't change.
+
+	Marks associated with this element follow it into the same segment.
+
+	\sa CAVoice::updateTimes()
+*/
+void CAMusElement::setTimeSegment(CATimeSegment* segment)
+{
+    int time = timeStart();
+    _timeSegment = segment;
+    setTimeStart(time);
+
+    if (!_extras) {
+        return;
+    }
+
+    for (int i = 0; i < _extras->markList.size(); i++) {
+        if (_extras->markList[i]->associatedElement() == this) {
+            _extras->markList[i]->setTimeSegment(segment);
+        }
     }
 }
 
@@ -164,25 +244,165 @@ CAMusElement::CAMusElementType CAMusElement::musElementTypeFromString(const QStr
     return Undefined;
 }
 
+/*!
+	Returns the start time of the element in miliseconds from the beginning of the sheet, taking
+	the tempo marks of the sheet into account.
+
+	\sa CASheet::timeToMsecs()
+*/
+int CAMusElement::realTimeStart()
+{
+    CASheet* sheet = (_context ? _context->sheet() : nullptr);
+    return sheet ? qRound(sheet->timeToMsecs(timeStart())) : timeStart();
+}
+
+/*!
+	Returns the length of the element in miliseconds, taking the tempo changes during the element
+	into account.
+*/
+int CAMusElement::realTimeLength()
+{
+    CASheet* sheet = (_context ? _context->sheet() : nullptr);
+    return sheet ? qRound(sheet->timeToMsecs(timeStart() + timeLength()) - sheet->timeToMsecs(timeStart())) : timeLength();
+}
+
+/*!
+	Invalidates the tempo map of the sheet, if the given \a mark is a tempo mark.
+*/
+void CAMusElement::tempoMarkChanged(CAMark* mark)
+{
+    if (mark->markType() == CAMark::Tempo && _context && _context->sheet()) {
+        _context->sheet()->invalidateTempoMap();
+    }
+}
+
+/*!
+	Gives the voices containing the element a new generation (see CAVoice::generation()). Call it
+	from the setters of the properties which are written to the score. Signs are shared by all the
+	voices of the staff, marks change the voices of their associated element.
+*/
+void CAMusElement::contentChanged()
+{
+    switch (musElementType()) {
+    case Note:
+    case Rest:
+        if (static_cast<CAPlayable*>(this)->voice()) {
+            static_cast<CAPlayable*>(this)->voice()->updateGeneration();
+        }
+        break;
+    case Slur:
+        if (static_cast<CASlur*>(this)->noteStart()) {
+            static_cast<CASlur*>(this)->noteStart()->contentChanged();
+        }
+        break;
+    case Tuplet:
+        if (!static_cast<CATuplet*>(this)->noteList().isEmpty()) {
+            static_cast<CATuplet*>(this)->noteList().first()->contentChanged();
+        }
+        break;
+    case Mark:
+        if (static_cast<CAMark*>(this)->associatedElement()) {
+            static_cast<CAMark*>(this)->associatedElement()->contentChanged();
+        }
+        break;
+    case Barline:
+    case Clef:
+    case TimeSignature:
+    case KeySignature:
+        if (_context && _context->contextType() == CAContext::Staff) {
+            for (CAVoice* voice : static_cast<CAStaff*>(_context)->voiceList()) {
+                voice->updateGeneration();
+            }
+        }
+        break;
+    case Undefined:
+    case MidiNote:
+    case Syllable:
+    case FunctionMark:
+    case FiguredBassMark:
+    case ChordName:
+        break;
+    }
+}
+
 /*!
 	Adds a \a mark to the mark list in correct order.
 */
 void CAMusElement::addMark(CAMark* mark)
 {
-    if (!mark || _markList.contains(mark))
+    if (!mark || (_extras && _extras->markList.contains(mark)))
         return;
 
+    QList<CAMark*>& marks = extras()->markList;
     int l;
-    for (l = 0; l < markList().size() && mark->markType() > markList()[l]->markType(); l++)
+    for (l = 0; l < marks.size() && mark->markType() > marks[l]->markType(); l++)
         ; // Marks must be sorted by their mark type.
     if (mark->markType() == CAMark::Articulation) {
-        for (; l < markList().size() && markList()[l]->markType() == CAMark::Articulation && static_cast<CAArticulation*>(mark)->articulationType() > static_cast<CAArticulation*>(markList()[l])->articulationType(); l++)
+        for (; l < marks.size() && marks[l]->markType() == CAMark::Articulation && static_cast<CAArticulation*>(mark)->articulationType() > static_cast<CAArticulation*>(marks[l])->articulationType(); l++)
             ; // Articulation marks must be sorted by their articulation mark type.
     }
 
-    _markList.insert(l, mark);
+    marks.insert(l, mark);
+    _extras->markTypes |= CAMark::markTypeBit(mark->markType());
+    tempoMarkChanged(mark);
+    contentChanged();
+
+    if (mark->associatedElement() == this) {
+        mark->setTimeSegment(_timeSegment);
+    }
+}
+
+/*!
+	Removes the given \a mark from the mark list. If the mark is associated with this element,
+	its start time becomes absolute again.
+*/
+void CAMusElement::removeMark(CAMark* mark)
+{
+    if (_extras && _extras->markList.removeAll(mark)) {
+        // other marks of the same type may remain
+        _extras->markTypes = 0;
+        for (CAMark* m : _extras->markList) {
+            _extras->markTypes |= CAMark::markTypeBit(m->markType());
+        }
+        tempoMarkChanged(mark);
+        contentChanged();
+    }
+
+    if (mark && mark->associatedElement() == this) {
+        mark->setTimeSegment(nullptr);
+    }
 }
 
+/*!
+	\fn CAMusElement::markTypes()
+	Returns the bitmask of the types of the marks, CAMark::markTypeBit() of each mark type in
+	markList(). Kept by addMark() and removeMark(), so the elements without the wanted marks can be
+	skipped without iterating over their marks:
+	\code
+	  if (elt->markTypes() & (CAMark::markTypeBit(CAMark::Tempo) | CAMark::markTypeBit(CAMark::Dynamic))) {
+	      ...
+	  }
+	\endcode
+
+	\sa hasMark(), marksOfType()
+*/
+
+/*!
+	\fn CAMusElement::hasMark(int markType)
+	Returns True, if the element has any mark of the given CAMark::CAMarkType \a markType.
+*/
+
+/*!
+	\fn CAMusElement::marksOfType(int markType)
+	Returns the marks of the given CAMark::CAMarkType \a markType cast to \a T for iterating:
+	\code
+	  for (CATempo* tempo : elt->marksOfType<CATempo>(CAMark::Tempo)) {
+	      ...
+	  }
+	\endcode
+	Defined in score/mark.h.
+*/
+
 /*!
 	Adds a list of marks to the mark list in correct order.
 */
@@ -231,7 +451,7 @@ void CAMusElement::addMarks(QList<CAMark*> marks)
 /*!
 	\fn CAMusElement::timeStart()
 	Returns the time in the score when the music element appears in time.
-	The returned time is in absolute time units.
+	The returned time is in absolute time units, even if the element is part of a time segment.
 
 	\sa _timeStart, setTimeStart()
 */
@@ -277,8 +497,9 @@ void CAMusElement::addMarks(QList<CAMark*> marks)
 /*!
 	\fn CAMusElement::setName(QString name)
 	Sets the name of the music element to \a name.
+	Names are optional and are not necessary unique.
 
-	\sa _name, name()
+	\sa name()
 */
 
 /*!
@@ -316,7 +537,8 @@ void CAMusElement::addMarks(QList<CAMark*> marks)
 	\var CAMusElement::_timeStart
 	Where does the music element starts in time.
 	Time is stored in absolute time units and is not affected by different tempos or
-	other expressions.
+	other expressions. If the element is part of a time segment, the time is relative to the
+	segment offset.
 
 	\sa timeStart(), setTimeStart()
 */
@@ -333,9 +555,3 @@ void CAMusElement::addMarks(QList<CAMark*> marks)
 */
 
 /*!
-	\var CAMusElement::_name
-	Specific name of the music element in QString.
-	Names are optional and are not necessary unique.
-
-	\sa name(), setName()
-*/
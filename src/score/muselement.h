@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -12,11 +12,20 @@
 #include <QList>
 #include <QString>
 
+#include "core/objectpool.h"
+
 class CAContext;
 class CAMusElement;
 class CAPlayable;
 class CAMark;
 class CANoteCheckerError;
+template <class T>
+class CAMarkRange;
+
+struct CATimeSegment {
+    int begin; // index of the first music element of the segment in the voice
+    int offset; // time added to the relative start times of the music elements in the segment
+};
 
 class CAMusElement {
 public:
@@ -41,58 +50,119 @@ public:
     CAMusElement(CAContext* context, int timeStart, int timeLength = 0);
     virtual ~CAMusElement();
 
+#ifndef SWIG
+    static void* operator new(std::size_t size) { return CAObjectPool::allocate(size); }
+    static void operator delete(void* p, std::size_t size) { CAObjectPool::release(p, size); }
+#endif
+
     virtual CAMusElement* clone(CAContext* context = nullptr) = 0;
     virtual int compare(CAMusElement* elt) = 0;
 
-    CAMusElementType musElementType() { return _musElementType; }
+    CAMusElementType musElementType() { return static_cast<CAMusElementType>(_musElementType); }
+
+    inline quint64 id() const { return _id; }
+    inline void setId(quint64 id) { _id = id; }
+    void keepIds(CAMusElement* original);
+    static quint64 newId();
 
     inline CAContext* context() { return _context; }
     inline void setContext(CAContext* context) { _context = context; }
 
-    inline virtual int timeStart() const { return _timeStart; }
-    inline void setTimeStart(int time) { _timeStart = time; }
+    inline virtual int timeStart() const { return _timeSegment ? _timeStart + _timeSegment->offset : _timeStart; }
+    inline void setTimeStart(int time) { _timeStart = _timeSegment ? time - _timeSegment->offset : time; }
     inline virtual int timeLength() const { return _timeLength; }
     inline void setTimeLength(int length) { _timeLength = length; }
     inline int timeEnd() { return timeStart() + timeLength(); }
 
-    inline virtual int realTimeStart() { return _timeStart; } // TODO: calculates and returns time in miliseconds
-    inline virtual int realTimeLength() { return _timeLength; } // TODO: calculates and returns time in miliseconds
-    inline int realTimeEnd() { return realTimeStart() + realTimeLength(); } // TODO: calculates and returns time in miliseconds
+    virtual int realTimeStart(); // in miliseconds
+    virtual int realTimeLength(); // in miliseconds
+    inline int realTimeEnd() { return realTimeStart() + realTimeLength(); } // in miliseconds
 
-    inline const QString name() { return _name; }
-    inline void setName(const QString name) { _name = name; }
+    inline const QString name() { return _extras ? _extras->name : QString(); }
+    inline void setName(const QString name)
+    {
+        if (_extras || !name.isEmpty())
+            extras()->name = name;
+    }
 
     inline bool isVisible() { return _visible; }
-    inline void setVisible(const bool v) { _visible = v; }
-
-    inline const QColor color() { return _color; }
-    inline void setColor(const QColor c) { _color = c; }
-
-    inline const QList<CAMark*> markList() { return _markList; }
+    inline void setVisible(const bool v)
+    {
+        _visible = v;
+        contentChanged();
+    }
+
+    inline const QColor color() { return _extras ? _extras->color : QColor(); }
+    inline void setColor(const QColor c)
+    {
+        if (_extras || c.isValid()) {
+            extras()->color = c;
+            contentChanged();
+        }
+    }
+
+    inline const QList<CAMark*>& markList() { return _extras ? _extras->markList : EMPTY_MARK_LIST; }
     void addMark(CAMark* mark);
     void addMarks(QList<CAMark*> marks);
-    inline void removeMark(CAMark* mark) { _markList.removeAll(mark); }
-
-    inline const QList<CANoteCheckerError*>& noteCheckerErrorList() { return _noteCheckerErrorList; }
-    inline void addNoteCheckerError(CANoteCheckerError* nce) { _noteCheckerErrorList << nce; }
-    inline void removeNoteCheckerError(CANoteCheckerError* nce) { _noteCheckerErrorList.removeAll(nce); }
+    void removeMark(CAMark* mark);
+    inline quint32 markTypes() { return _extras ? _extras->markTypes : 0; }
+    inline bool hasMark(int markType) { return markType >= 0 && (markTypes() & (1u << markType)); }
+#ifndef SWIG
+    template <class T>
+    CAMarkRange<T> marksOfType(int markType);
+#endif
+
+    inline const QList<CANoteCheckerError*>& noteCheckerErrorList() { return _extras ? _extras->noteCheckerErrorList : EMPTY_NOTE_CHECKER_ERROR_LIST; }
+    inline void addNoteCheckerError(CANoteCheckerError* nce) { extras()->noteCheckerErrorList << nce; }
+    inline void removeNoteCheckerError(CANoteCheckerError* nce)
+    {
+        if (_extras)
+            _extras->noteCheckerErrorList.removeAll(nce);
+    }
 
     bool isPlayable();
 
+    inline CATimeSegment* timeSegment() { return _timeSegment; }
+    void setTimeSegment(CATimeSegment* segment);
+
     static const QString musElementTypeToString(CAMusElementType);
     static CAMusElementType musElementTypeFromString(const QString);
 
 protected:
     inline void setMusElementType(CAMusElementType type) { _musElementType = type; }
+    void tempoMarkChanged(CAMark* mark);
+    void contentChanged();
 
-    CAMusElementType _musElementType;
-    QList<CAMark*> _markList;
-    QList<CANoteCheckerError*> _noteCheckerErrorList;
+    quint64 _id; // stable identifier, see id()
     CAContext* _context;
-    int _timeStart;
+    CATimeSegment* _timeSegment;
+    int _timeStart; // relative to _timeSegment, if set
     int _timeLength;
+
+private:
+    // rarely used properties, most of the elements have no marks, errors, name or custom color
+    struct CAMusElementExtras {
+        QList<CAMark*> markList;
+        quint32 markTypes = 0; // bit 1 << CAMark::CAMarkType of each mark in markList
+        QList<CANoteCheckerError*> noteCheckerErrorList;
+        QColor color;
+        QString name;
+    };
+
+    inline CAMusElementExtras* extras()
+    {
+        if (!_extras)
+            _extras = new CAMusElementExtras();
+        return _extras;
+    }
+
+    static const QList<CAMark*> EMPTY_MARK_LIST;
+    static const QList<CANoteCheckerError*> EMPTY_NOTE_CHECKER_ERROR_LIST;
+    CAMusElementExtras* _extras; // created on demand
+
+protected:
+    // the byte fields are last, so the derived classes place their small fields in the padding
+    quint8 _musElementType; // CAMusElementType
     bool _visible;
-    QColor _color;
-    QString _name;
 };
 #endif /* MUSELEMENT_H_ */
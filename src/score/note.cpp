@@ -11,6 +11,8 @@
 #include "score/staff.h"
 #include "score/voice.h"
 
+#include <algorithm>
+
 /*!
 	\class CANote
 	\brief Represents a note in the score.
@@ -35,12 +37,9 @@ CANote::CANote(CADiatonicPitch pitch, CAPlayableLength length, CAVoice* voice, i
     _forceAccidentals = false;
     _stemDirection = StemPreferred;
 
+    _slurs = nullptr; // no slurs and phrasing slurs by default
     setTieStart(nullptr);
-    setSlurStart(nullptr);
-    setPhrasingSlurStart(nullptr);
     setTieEnd(nullptr);
-    setSlurEnd(nullptr);
-    setPhrasingSlurEnd(nullptr);
 
     setDiatonicPitch(pitch);
 }
@@ -57,6 +56,8 @@ CANote::~CANote()
     for (int i = 0; i < markList().size(); i++) {
         delete markList()[i--];
     }
+
+    delete _slurs;
 }
 
 /*!
@@ -78,6 +79,22 @@ CANote::~CANote()
 			Use the voice's preferred direction.
 */
 
+/*!
+	Sets the pitch of the note. If \a fixTies is True, the ties to the neighbouring notes are
+	updated as well.
+*/
+void CANote::setDiatonicPitch(CADiatonicPitch pitch, bool fixTies)
+{
+    _diatonicPitch = pitch;
+    if (fixTies)
+        updateTies();
+
+    if (voice()) {
+        voice()->invalidateMotifIndex();
+    }
+    contentChanged();
+}
+
 /*!
 	Clones the note with same pitch, voice, timeStart and other properties.
 	Does *not* create clones of ties, slurs and phrasing slurs!
@@ -108,15 +125,12 @@ int CANote::notePosition()
 {
     CAClef* clef = nullptr;
     if (voice() && voice()->staff()) {
-        // find the corresponding clef
-        int i = 0;
-        while (i < voice()->staff()->clefRefs().size() && staff()->clefRefs()[i]->timeStart() <= timeStart()) {
-            i++;
-        }
-        i--;
+        // find the corresponding clef, the last one starting at or before the note
+        const QList<CAMusElement*>& clefs = voice()->staff()->clefRefs();
+        int i = static_cast<int>(std::upper_bound(clefs.constBegin(), clefs.constEnd(), timeStart(), [](int t, CAMusElement* elt) { return t < elt->timeStart(); }) - clefs.constBegin()) - 1;
 
         if (i >= 0) {
-            clef = static_cast<CAClef*>(voice()->staff()->clefRefs()[i]);
+            clef = static_cast<CAClef*>(clefs[i]);
         }
     }
 
@@ -164,14 +178,14 @@ const QString CANote::generateNoteName(int pitch, int accs)
 */
 bool CANote::isPartOfChord()
 {
-    int idx = voice()->musElementList().indexOf(this);
+    int idx = voice()->eltIndex(this);
 
     // is there a note with the same start time after ours?
-    if (idx + 1 < voice()->musElementList().size() && voice()->musElementList()[idx + 1]->musElementType() == CAMusElement::Note && voice()->musElementList()[idx + 1]->timeStart() == _timeStart)
+    if (idx + 1 < voice()->musElementList().size() && voice()->musElementList()[idx + 1]->musElementType() == CAMusElement::Note && voice()->musElementList()[idx + 1]->timeStart() == timeStart())
         return true;
 
     // is there a note with the same start time before ours?
-    if (idx > 0 && voice()->musElementList()[idx - 1]->musElementType() == CAMusElement::Note && voice()->musElementList()[idx - 1]->timeStart() == _timeStart)
+    if (idx > 0 && voice()->musElementList()[idx - 1]->musElementType() == CAMusElement::Note && voice()->musElementList()[idx - 1]->timeStart() == timeStart())
         return true;
 
     return false;
@@ -182,10 +196,10 @@ bool CANote::isPartOfChord()
 */
 bool CANote::isFirstInChord()
 {
-    int idx = voice()->musElementList().indexOf(this);
+    int idx = voice()->eltIndex(this);
 
     //is there a note with the same start time before ours?
-    if (idx > 0 && voice()->musElementList()[idx - 1]->musElementType() == CAMusElement::Note && voice()->musElementList()[idx - 1]->timeStart() == _timeStart)
+    if (idx > 0 && voice()->musElementList()[idx - 1]->musElementType() == CAMusElement::Note && voice()->musElementList()[idx - 1]->timeStart() == timeStart())
         return false;
 
     return true;
@@ -196,10 +210,10 @@ bool CANote::isFirstInChord()
 */
 bool CANote::isLastInChord()
 {
-    int idx = voice()->musElementList().indexOf(this);
+    int idx = voice()->eltIndex(this);
 
     //is there a note with the same start time after ours?
-    if (idx + 1 < voice()->musElementList().size() && voice()->musElementList()[idx + 1]->musElementType() == CAMusElement::Note && voice()->musElementList()[idx + 1]->timeStart() == _timeStart)
+    if (idx + 1 < voice()->musElementList().size() && voice()->musElementList()[idx + 1]->musElementType() == CAMusElement::Note && voice()->musElementList()[idx + 1]->timeStart() == timeStart())
         return false;
 
     return true;
@@ -216,15 +230,14 @@ bool CANote::isLastInChord()
 QList<CANote*> CANote::getChord()
 {
     QList<CANote*> list;
-    int idx = voice()->musElementList().indexOf(this) - 1;
+    const QList<CAMusElement*>& elts = voice()->musElementList();
+    int idx = voice()->eltIndex(this) - 1;
 
-    while (idx >= 0 && voice()->musElementList()[idx]->musElementType() == CAMusElement::Note && voice()->musElementList()[idx]->timeStart() == timeStart())
+    while (idx >= 0 && elts[idx]->musElementType() == CAMusElement::Note && elts[idx]->timeStart() == timeStart())
         idx--;
 
-    for (idx++;
-         (idx >= 0 && idx < voice()->musElementList().size()) && (voice()->musElementList()[idx]->musElementType() == CAMusElement::Note) && (voice()->musElementList()[idx]->timeStart() == timeStart());
-         idx++)
-        list << static_cast<CANote*>(voice()->musElementList()[idx]);
+    for (idx++; idx >= 0 && idx < elts.size() && elts[idx]->musElementType() == CAMusElement::Note && elts[idx]->timeStart() == timeStart(); idx++)
+        list << static_cast<CANote*>(elts[idx]);
 
     return list;
 }
@@ -249,6 +262,7 @@ int CANote::compare(CAMusElement* elt)
 void CANote::setStemDirection(CAStemDirection dir)
 {
     _stemDirection = dir;
+    contentChanged();
 }
 
 /*!
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -33,34 +33,58 @@ public:
     CAPlayableLength noteLength() { return _playableLength; }
 
     inline CADiatonicPitch& diatonicPitch() { return _diatonicPitch; }
-    inline void setDiatonicPitch(CADiatonicPitch pitch)
-    {
-        _diatonicPitch = pitch;
-        updateTies();
-    }
+    void setDiatonicPitch(CADiatonicPitch pitch, bool fixTies = true);
     inline int midiPitch() { return _diatonicPitch.midiPitch(); }
 
-    CAStemDirection stemDirection() { return _stemDirection; }
+    CAStemDirection stemDirection() { return static_cast<CAStemDirection>(_stemDirection); }
     void setStemDirection(CAStemDirection direction);
 
     int notePosition();
 
     inline CASlur* tieStart() { return _tieStart; }
     inline CASlur* tieEnd() { return _tieEnd; }
-    inline CASlur* slurStart() { return _slurStart; }
-    inline CASlur* slurEnd() { return _slurEnd; }
-    inline CASlur* phrasingSlurStart() { return _phrasingSlurStart; }
-    inline CASlur* phrasingSlurEnd() { return _phrasingSlurEnd; }
+    inline CASlur* slurStart() { return _slurs ? _slurs->slurStart : nullptr; }
+    inline CASlur* slurEnd() { return _slurs ? _slurs->slurEnd : nullptr; }
+    inline CASlur* phrasingSlurStart() { return _slurs ? _slurs->phrasingSlurStart : nullptr; }
+    inline CASlur* phrasingSlurEnd() { return _slurs ? _slurs->phrasingSlurEnd : nullptr; }
 
     CAStemDirection actualStemDirection();
     CASlur::CASlurDirection actualSlurDirection();
 
-    inline void setTieStart(CASlur* tieStart) { _tieStart = tieStart; }
-    inline void setTieEnd(CASlur* tieEnd) { _tieEnd = tieEnd; }
-    inline void setSlurStart(CASlur* slurStart) { _slurStart = slurStart; }
-    inline void setSlurEnd(CASlur* slurEnd) { _slurEnd = slurEnd; }
-    inline void setPhrasingSlurStart(CASlur* pSlurStart) { _phrasingSlurStart = pSlurStart; }
-    inline void setPhrasingSlurEnd(CASlur* pSlurEnd) { _phrasingSlurEnd = pSlurEnd; }
+    inline void setTieStart(CASlur* tieStart)
+    {
+        _tieStart = tieStart;
+        contentChanged();
+    }
+    inline void setTieEnd(CASlur* tieEnd)
+    {
+        _tieEnd = tieEnd;
+        contentChanged();
+    }
+    inline void setSlurStart(CASlur* slurStart)
+    {
+        if (_slurs || slurStart)
+            slurs()->slurStart = slurStart;
+        contentChanged();
+    }
+    inline void setSlurEnd(CASlur* slurEnd)
+    {
+        if (_slurs || slurEnd)
+            slurs()->slurEnd = slurEnd;
+        contentChanged();
+    }
+    inline void setPhrasingSlurStart(CASlur* pSlurStart)
+    {
+        if (_slurs || pSlurStart)
+            slurs()->phrasingSlurStart = pSlurStart;
+        contentChanged();
+    }
+    inline void setPhrasingSlurEnd(CASlur* pSlurEnd)
+    {
+        if (_slurs || pSlurEnd)
+            slurs()->phrasingSlurEnd = pSlurEnd;
+        contentChanged();
+    }
 
     void updateTies();
 
@@ -70,7 +94,11 @@ public:
     QList<CANote*> getChord();
 
     bool forceAccidentals() { return _forceAccidentals; }
-    void setForceAccidentals(bool force) { _forceAccidentals = force; }
+    void setForceAccidentals(bool force)
+    {
+        _forceAccidentals = force;
+        contentChanged();
+    }
 
     static const QString generateNoteName(int pitch, int accs);
 
@@ -81,17 +109,29 @@ public:
 
 private:
     CADiatonicPitch _diatonicPitch;
-    CAStemDirection _stemDirection;
+    qint8 _stemDirection; // CAStemDirection
     bool _forceAccidentals; // Always draw notes accidentals.
 
     ////////////////////
     // Slurs and ties //
     ////////////////////
+    // slurs are much rarer than ties, so they are only allocated for the notes having them
+    struct CANoteSlurs {
+        CASlur* slurStart;
+        CASlur* slurEnd;
+        CASlur* phrasingSlurStart;
+        CASlur* phrasingSlurEnd;
+    };
+
+    inline CANoteSlurs* slurs()
+    {
+        if (!_slurs)
+            _slurs = new CANoteSlurs{ nullptr, nullptr, nullptr, nullptr };
+        return _slurs;
+    }
+
     CASlur* _tieStart;
     CASlur* _tieEnd;
-    CASlur* _slurStart;
-    CASlur* _slurEnd;
-    CASlur* _phrasingSlurStart;
-    CASlur* _phrasingSlurEnd;
+    CANoteSlurs* _slurs; // created on demand
 };
 #endif /* NOTE_H_*/
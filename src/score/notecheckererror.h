@@ -17,6 +17,9 @@ public:
     CANoteCheckerError(CAMusElement* targetElement, QString message);
     ~CANoteCheckerError();
 
+    inline CAMusElement* targetElement() { return _targetElement; }
+    inline const QString& message() { return _message; }
+
 private:
     CAMusElement* _targetElement;
     QString _message;
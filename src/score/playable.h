@@ -21,7 +21,11 @@ public:
     virtual ~CAPlayable();
 
     inline CAPlayableLength& playableLength() { return _playableLength; }
-    inline void setPlayableLength(CAPlayableLength& l) { _playableLength = l; }
+    inline void setPlayableLength(CAPlayableLength& l)
+    {
+        _playableLength = l;
+        contentChanged();
+    }
     virtual CAPlayable* clone(CAContext* context)
     {
         CAPlayable* pl = clone();
@@ -31,7 +35,11 @@ public:
     virtual CAPlayable* clone(CAVoice* voice = nullptr) = 0;
 
     CATuplet* tuplet() { return _tuplet; }
-    void setTuplet(CATuplet* t) { _tuplet = t; }
+    void setTuplet(CATuplet* t)
+    {
+        _tuplet = t;
+        contentChanged();
+    }
 
     inline CAVoice* voice() { return _voice; }
     void setVoice(CAVoice* v);
@@ -100,47 +100,19 @@ const QString CAPlayableLength::musicLengthToString(CAPlayableLength::CAMusicLen
 */
 int CAPlayableLength::playableLengthToTimeLength(CAPlayableLength length)
 {
+    int l = length.musicLength();
     int timeLength;
-
-    switch (length.musicLength()) {
-    case HundredTwentyEighth:
-        timeLength = 8;
-        break;
-    case SixtyFourth:
-        timeLength = 16;
-        break;
-    case ThirtySecond:
-        timeLength = 32;
-        break;
-    case Sixteenth:
-        timeLength = 64;
-        break;
-    case Eighth:
-        timeLength = 128;
-        break;
-    case Quarter:
-        timeLength = 256;
-        break;
-    case Half:
-        timeLength = 512;
-        break;
-    case Whole:
-        timeLength = 1024;
-        break;
-    case Breve:
+    if (l == Breve) {
         timeLength = 2048;
-        break;
-    default: // This should never occur!
-        timeLength = 0;
-        break;
+    } else if (l > 0 && l <= HundredTwentyEighth && !(l & (l - 1))) {
+        timeLength = 1024 / l;
+    } else {
+        return 0; // This should never occur!
     }
 
-    float factor = 1.0, delta = 0.5;
-    for (int i = 0; i < length.dotted(); i++, factor += delta, delta /= 2)
-        ; // calculate the length factor out of number of dots
-    timeLength = qRound(timeLength * factor); // increase the time length for the factor
-
-    return timeLength;
+    // each dot adds half of the previous value, so n dots give 2 - 1/2^n of the length
+    int dots = qMax(length.dotted(), 0);
+    return 2 * timeLength - (dots < 12 ? timeLength >> dots : 0);
 }
 
 /*!
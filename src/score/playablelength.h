@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2008, Matevž Jekovec, Canorus development team
+	Copyright (c) 2008-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -31,11 +31,11 @@ public:
     CAPlayableLength();
     CAPlayableLength(CAMusicLength l, int dotted = 0);
 
-    inline CAMusicLength musicLength() { return _musicLength; }
+    inline CAMusicLength musicLength() { return static_cast<CAMusicLength>(_musicLength); }
     inline int dotted() { return _dotted; }
 
-    inline void setMusicLength(const CAMusicLength l) { _musicLength = l; }
-    inline void setDotted(const int d) { _dotted = d; }
+    inline void setMusicLength(const CAMusicLength l) { _musicLength = static_cast<qint16>(l); }
+    inline void setDotted(const int d) { _dotted = static_cast<qint16>(d); }
 
     bool operator==(CAPlayableLength);
     bool operator!=(CAPlayableLength);
@@ -53,7 +53,7 @@ public:
     static QList<CAPlayableLength> matchToBars(int timeLength, int timeStart, CABarline* lastBarline, CATimeSignature* ts, int dotsLimit = 4, int separiationTime = 0);
 
 private:
-    CAMusicLength _musicLength; // note, rest length (half, whole, quarter)
-    int _dotted; // number of dots
+    qint16 _musicLength; // note, rest length (half, whole, quarter), see CAMusicLength
+    qint16 _dotted; // number of dots
 };
 #endif /* PLAYABLELENGTH_H_ */
@@ -32,10 +32,18 @@ public:
     int compare(CAMusElement*);
 
     inline CARepeatMarkType repeatMarkType() { return _repeatMarkType; }
-    inline void setRepeatMarkType(CARepeatMarkType t) { _repeatMarkType = t; }
+    inline void setRepeatMarkType(CARepeatMarkType t)
+    {
+        _repeatMarkType = t;
+        contentChanged();
+    }
 
     inline int voltaNumber() { return _voltaNumber; }
-    inline void setVoltaNumber(int n) { _voltaNumber = n; }
+    inline void setVoltaNumber(int n)
+    {
+        _voltaNumber = n;
+        contentChanged();
+    }
 
     static const QString repeatMarkTypeToString(CARepeatMarkType t);
     static CARepeatMarkType repeatMarkTypeFromString(const QString r);
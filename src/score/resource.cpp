@@ -1,11 +1,13 @@
 /*!
-	Copyright (c) 2008-2009, Matevž Jekovec, Canorus development team
+	Copyright (c) 2008-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
 */
 
+#include <QCryptographicHash>
 #include <QFile>
+#include <QFileInfo>
 #include <iostream>
 
 #include "score/document.h"
@@ -28,13 +30,17 @@
 	  directory.
 
 	When the resources are saved, internal resources are saved as
-	\sa CAResourceContainer
+	storedFileName(), which is derived from the hash() of their content. A resource
+	which didn't change since the last save has the same name and isn't copied again.
+
+	\sa CAResourceCtl
 */
 
 /*!
 	Default constructor.
 */
 CAResource::CAResource(QUrl url, QString name, bool linked, CAResourceType t, CADocument* parent)
+    : _hashedSize(-1)
 {
     setName(name);
     setUrl(url);
@@ -67,6 +73,64 @@ bool CAResource::copy(QString fileName)
     return QFile::copy(url().toLocalFile(), fileName);
 }
 
+/*!
+	Returns the hex SHA-1 hash of the attached file content or an empty array for the linked
+	resources and missing files.
+	The hash is remembered with the size and modification time of the file and only computed
+	again, if the file changed since (eg. when the midi recorder wrote to it).
+ */
+QByteArray CAResource::hash()
+{
+    if (isLinked()) {
+        return QByteArray();
+    }
+
+    QFileInfo info(url().toLocalFile());
+    if (!info.exists()) {
+        return QByteArray();
+    }
+
+    if (_hash.isEmpty() || info.size() != _hashedSize || info.lastModified() != _hashedTime) {
+        QFile file(info.absoluteFilePath());
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        if (!file.open(QIODevice::ReadOnly) || !hash.addData(&file)) { // read in chunks
+            return QByteArray();
+        }
+        setHash(hash.result().toHex());
+    }
+
+    return _hash;
+}
+
+/*!
+	Sets the known \a hash of the current file content, eg. computed while copying it, so the
+	file doesn't need to be read again by hash().
+ */
+void CAResource::setHash(const QByteArray hash)
+{
+    QFileInfo info(url().toLocalFile());
+    _hash = hash;
+    _hashedSize = info.size();
+    _hashedTime = info.lastModified();
+}
+
+/*!
+	Returns the file name of the attached resource in the saved document, the hash() of its
+	content followed by the suffix of the resource name. The temporary files get random
+	suffixes, so they are not used. The name of the resource file is returned, if the hash is
+	not available.
+ */
+QString CAResource::storedFileName()
+{
+    QByteArray h = hash();
+    if (h.isEmpty()) {
+        return QFileInfo(url().toLocalFile()).fileName();
+    }
+
+    QString suffix = QFileInfo(name()).suffix();
+    return QString::fromLatin1(h) + (suffix.isEmpty() ? QString() : "." + suffix);
+}
+
 /*!
 	Converts the given \a type to string. Usually called when saving the resource.
  */
@@ -8,6 +8,8 @@
 #ifndef RESOURCE_H_
 #define RESOURCE_H_
 
+#include <QByteArray>
+#include <QDateTime>
 #include <QUrl>
 
 #include <memory>
@@ -52,6 +54,10 @@ public:
 
     bool copy(QString fileName);
 
+    QByteArray hash();
+    void setHash(const QByteArray hash);
+    QString storedFileName();
+
     static QString resourceTypeToString(CAResourceType type);
     static CAResourceType resourceTypeFromString(QString type);
 
@@ -62,6 +68,10 @@ private:
     CAResourceType _resType;
     bool _linked;
     CADocument* _document;
+
+    QByteArray _hash; // hex SHA-1 of the attached file content, empty if not computed yet
+    qint64 _hashedSize; // size of the file when the hash was computed
+    QDateTime _hashedTime; // modification time of the file when the hash was computed
 };
 
 #endif /* RESOURCE_H_ */
@@ -26,7 +26,11 @@ public:
     CARest* clone(CAVoice* voice = nullptr);
 
     CARestType restType() { return _restType; }
-    void setRestType(CARestType type) { _restType = type; }
+    void setRestType(CARestType type)
+    {
+        _restType = type;
+        contentChanged();
+    }
 
     int compare(CAMusElement* elt);
 
@@ -26,9 +26,17 @@ public:
     int compare(CAMusElement*);
 
     inline int finalTempo() { return _finalTempo; }
-    inline void setFinalTempo(const int t) { _finalTempo = t; }
+    inline void setFinalTempo(const int t)
+    {
+        _finalTempo = t;
+        contentChanged();
+    }
     inline CARitardandoType ritardandoType() { return _ritardandoType; }
-    inline void setRitardandoType(CARitardandoType t) { _ritardandoType = t; }
+    inline void setRitardandoType(CARitardandoType t)
+    {
+        _ritardandoType = t;
+        contentChanged();
+    }
 
     static const QString ritardandoTypeToString(CARitardandoType t);
     static CARitardandoType ritardandoTypeFromString(const QString r);
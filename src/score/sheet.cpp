@@ -6,17 +6,61 @@
 */
 
 #include <QHash> // used for mapping when cloning the sheet to a new sheet
+#include <QMutex>
+#include <QMutexLocker>
 #include <QObject> // QObject::tr
+#include <QVector>
 
+#include <algorithm>
+
+#include "core/taskscheduler.h"
+
+#include "score/barline.h"
+#include "score/chordnamecontext.h"
 #include "score/context.h"
 #include "score/document.h"
+#include "score/figuredbasscontext.h"
+#include "score/functionmarkcontext.h"
 #include "score/lyricscontext.h"
 #include "score/notecheckererror.h"
 #include "score/sheet.h"
 #include "score/staff.h"
+#include "score/staffchunk.h"
 #include "score/tempo.h"
+#include "score/timesignature.h"
 #include "score/voice.h"
 
+const double CASheet::DEFAULT_MSECS_PER_TIME = 1.0;
+
+namespace {
+
+const int PARALLEL_CLONE_MIN_ELEMENTS = 4096; // staffs of smaller sheets are cloned in the calling thread
+
+QMutex loadMutex; // sheets may be loaded by the export threads
+
+/*!
+	Clones a single staff in the task scheduler. The clone doesn't belong to any sheet until the task
+	is done, so the staffs don't touch the shared sheet while being cloned.
+*/
+class CAStaffCloneTask : public CATask {
+public:
+    CAStaffCloneTask(CAStaff* staff)
+        : CATask(CATask::Interactive) // made for the undo on every edit
+        , _staff(staff)
+        , _clone(nullptr)
+    {
+    }
+
+    void run() { _clone = _staff->clone(nullptr); }
+    CAStaff* clone() { return _clone; }
+
+private:
+    CAStaff* _staff;
+    CAStaff* _clone;
+};
+
+}
+
 /*!
 	\class CASheet
 	\brief Represents a single sheet of paper in the document
@@ -27,9 +71,26 @@
 	CASheet parent is CADocument and CASheet includes various contexts CAContext, let it
 	be staffs, lyrics, function marks etc.
 
+	A sheet of an opened document can be left unloaded until its content is needed. Such a sheet
+	has only its name and a CASheetLoader set by the import filter. The contexts are read by the
+	loader on the first call of contextList(), staffList() or any other function accessing them,
+	so the rest of Canorus doesn't need to know about it. Use isLoaded() to check the sheet without
+	loading it.
+
 	\sa CADocument, CAContext
 */
 
+/*!
+	\class CASheetLoader
+	\brief Deferred reading of the sheet content
+
+	Interface of the import filters which read the contexts of an unloaded sheet. load() is called
+	only once for each sheet. The loader may be shared between the sheet and its clones, so it
+	should not change its own state when loading.
+
+	\sa CASheet::load()
+*/
+
 /*!
 	Creats a new sheet named \a name with parent document \a doc.
 */
@@ -37,26 +98,85 @@ CASheet::CASheet(const QString name, CADocument* doc)
 {
     _name = name;
     _document = doc;
+    _staffListDirty = true;
+    _voiceListDirty = true;
+    _tempoMapDirty = true;
+    _chordIndexValidUntil = std::numeric_limits<int>::min();
+    _barTableValidUntil = std::numeric_limits<int>::min();
+    _firstBarNumber = 1;
 }
 
 CASheet::~CASheet()
 {
 }
 
+/*!
+	Reads the content of the unloaded sheet using its loader. Does nothing, if the sheet is already
+	loaded.
+
+	\sa isLoaded()
+*/
+void CASheet::load()
+{
+    QMutexLocker locker(&loadMutex);
+    std::shared_ptr<CASheetLoader> loader = _loader;
+    if (loader) {
+        _loader.reset(); // the loader adds the contexts using the usual functions
+        loader->load(this);
+    }
+}
+
 /*!
 	Clones the current sheet with all its content.
 	If a new parent document \a doc is given, it also sets the document.
+
+	Unloaded sheets are not loaded, the clone shares the loader instead.
 */
 CASheet* CASheet::clone(CADocument* doc)
 {
     CASheet* newSheet = new CASheet(name(), doc);
+    if (_loader) {
+        newSheet->setLoader(_loader);
+        return newSheet;
+    }
 
     QHash<CAContext*, CAContext*> contextMap; // map between oldContexts<->cloned contexts
     QHash<CAVoice*, CAVoice*> voiceMap; // map between oldVoices<->cloned voices
+    QVector<CAContext*> clones(contextList().size(), nullptr);
+
+    // staffs are independent of each other, clone them in parallel, if there is enough work
+    int elements = 0;
+    for (CAVoice* voice : voiceList()) {
+        elements += voice->musElementList().size();
+    }
+
+    if (staffList().size() > 1 && elements >= PARALLEL_CLONE_MIN_ELEMENTS) {
+        QList<CAStaffCloneTask*> tasks;
+        QList<CATask*> started;
+        for (int i = 0; i < contextList().size(); i++) {
+            if (contextList()[i]->contextType() == CAContext::Staff) {
+                tasks << new CAStaffCloneTask(static_cast<CAStaff*>(contextList()[i]));
+                started << tasks.last();
+                CATaskScheduler::instance()->start(tasks.last());
+            } else {
+                tasks << nullptr;
+            }
+        }
+        CATaskScheduler::instance()->wait(started);
+
+        for (int i = 0; i < tasks.size(); i++) {
+            if (tasks[i]) {
+                clones[i] = tasks[i]->clone();
+                clones[i]->setSheet(newSheet);
+            }
+        }
+        qDeleteAll(tasks);
+    }
 
-    // create clones of contexts
+    // create clones of the other contexts, after the staffs their voices refer to
     for (int i = 0; i < contextList().size(); i++) {
-        CAContext* newContext = contextList()[i]->clone(newSheet);
+        CAContext* newContext = (clones[i] ? clones[i] : contextList()[i]->clone(newSheet));
+        newContext->setId(contextList()[i]->id());
         if (newContext->contextType() == CAContext::Staff) {
             for (int j = 0; j < static_cast<CAStaff*>(contextList()[i])->voiceList().size(); j++) {
                 voiceMap[static_cast<CAStaff*>(contextList()[i])->voiceList()[j]] = static_cast<CAStaff*>(newContext)->voiceList()[j];
@@ -79,27 +199,51 @@ CASheet* CASheet::clone(CADocument* doc)
     return newSheet;
 }
 
+/*!
+	Makes a snapshot of the current content of the sheet for the undo and autosave and returns it
+	as a new unloaded sheet of the document \a doc.
+
+	The staffs are shared with the previous snapshots, if they haven't changed since (see
+	CAStaffChunk), so only the changed staffs and the other contexts are copied. The content is
+	restored by CASnapshotSheetLoader when the snapshot is read. Unloaded sheets share the loader
+	the same as clone().
+*/
+CASheet* CASheet::snapshot(CADocument* doc)
+{
+    CASheet* newSheet = new CASheet(name(), doc);
+    newSheet->setLoader(_loader ? _loader : std::make_shared<CASnapshotSheetLoader>(this));
+
+    return newSheet;
+}
+
 /*!
 	Appends a new staff to the sheet with one empty voice.
  */
 CAStaff* CASheet::addStaff()
 {
+    if (_loader)
+        load();
+
     CAStaff* s = new CAStaff(QObject::tr("Staff%1").arg(staffList().size() + 1), this);
     s->addVoice();
 
     _contextList.append(s);
+    invalidateStaffList();
 
     return s;
 }
 
 void CASheet::clear()
 {
+    _loader.reset(); // the content was not read yet
+
     for (int i = 0; i < _contextList.size(); i++) {
         _contextList[i]->clear();
         delete _contextList[i];
     }
 
     _contextList.clear();
+    invalidateStaffList();
 }
 
 /*!
@@ -107,6 +251,9 @@ void CASheet::clear()
  */
 CAContext* CASheet::findContext(const QString name)
 {
+    if (_loader)
+        load();
+
     for (int i = 0; i < _contextList.size(); i++)
         if (_contextList[i]->name() == name)
             return _contextList[i];
@@ -138,59 +285,439 @@ QString CASheet::findUniqueContextName(const QString mask)
 
 	This is useful for determination of the harmony at certain point in time.
 
-	\sa CAStaff:getChord(), CAVoice::getChord()
+	The sounding playables are looked up in the chord index in logarithmic time. Only the voices
+	silent at the given time are asked for their next chord, as CAStaff::getChord() does.
+
+	\sa CAStaff:getChord(), CAVoice::getChord(), getPlayables()
 */
 QList<CAPlayable*> CASheet::getChord(int time)
 {
+    int k = chordSliceIndex(time);
+    const QList<CAPlayable*> empty;
+    const QList<CAPlayable*>& sounding = (k >= 0 ? _chordIndex.at(k).playables : empty);
+
     QList<CAPlayable*> chordList;
-    QList<CAStaff*> staffs = staffList();
-    for (int i = staffs.size() - 1; i >= 0; i--) {
-        chordList << staffs[i]->getChord(time);
+    int j = 0;
+    const QList<CAStaff*>& staffs = staffList();
+    for (int s = staffs.size() - 1; s >= 0; s--) {
+        const QList<CAVoice*>& voices = staffs[s]->voiceList();
+        for (int v = voices.size() - 1; v >= 0; v--) {
+            int size = chordList.size();
+            for (; j < sounding.size() && sounding[j]->voice() == voices[v]; j++) {
+                if (sounding[j]->timeEnd() > time) {
+                    chordList << sounding[j];
+                }
+            }
+
+            if (chordList.size() == size) {
+                chordList << voices[v]->getChord(time); // silent voice, take its next chord
+            }
+        }
     }
 
     return chordList;
 }
 
+/*!
+	Returns all the notes and rests of the sheet sounding between \a timeStart and \a timeEnd,
+	each only once, sorted by their start time.
+
+	\sa getChord()
+*/
+QList<CAPlayable*> CASheet::getPlayables(int timeStart, int timeEnd)
+{
+    QList<CAPlayable*> playables;
+    int k = chordSliceIndex(timeStart);
+    if (k >= 0) {
+        for (CAPlayable* p : _chordIndex[k].playables) {
+            if (p->timeEnd() > timeStart) {
+                playables << p;
+            }
+        }
+    }
+
+    // the later slices repeat the playables still sounding, only take the new ones
+    for (k++; k < _chordIndex.size() && _chordIndex[k].time < timeEnd; k++) {
+        for (CAPlayable* p : _chordIndex[k].playables) {
+            if (p->timeStart() == _chordIndex[k].time) {
+                playables << p;
+            }
+        }
+    }
+
+    return playables;
+}
+
+/*!
+	Updates the chord index used by getChord() and getPlayables(), if the voices changed.
+
+	The index holds a slice for each distinct start time of the notes and rests in any voice with
+	all the playables sounding at that time. The voices invalidate the index from the time of the
+	change on, so only the slices after the edit are rebuilt.
+
+	Call this before the sheet is read from several threads at once (see CADocumentVersion).
+*/
+void CASheet::buildChordIndex()
+{
+    if (_chordIndexValidUntil == std::numeric_limits<int>::max()) {
+        return;
+    }
+
+    int from = _chordIndexValidUntil;
+    _chordIndex.resize(static_cast<int>(std::lower_bound(_chordIndex.constBegin(), _chordIndex.constEnd(), from,
+                                            [](const CAChordSlice& slice, int t) { return slice.time < t; })
+        - _chordIndex.constBegin()));
+
+    QVector<int> onsets;
+    for (CAVoice* voice : voiceList()) {
+        const QList<CAMusElement*>& elts = voice->musElementList();
+        QList<CAMusElement*>::const_iterator it = std::lower_bound(elts.constBegin(), elts.constEnd(), from,
+            [](CAMusElement* elt, int t) { return elt->timeStart() < t; });
+        for (; it != elts.constEnd(); it++) {
+            if ((*it)->isPlayable() && (onsets.isEmpty() || onsets.last() != (*it)->timeStart())) {
+                onsets << (*it)->timeStart();
+            }
+        }
+    }
+    std::sort(onsets.begin(), onsets.end());
+    onsets.erase(std::unique(onsets.begin(), onsets.end()), onsets.end());
+
+    const QList<CAStaff*>& staffs = staffList();
+    for (int time : onsets) {
+        CAChordSlice slice = { time, QList<CAPlayable*>() };
+        for (int s = staffs.size() - 1; s >= 0; s--) {
+            const QList<CAVoice*>& voices = staffs[s]->voiceList();
+            for (int v = voices.size() - 1; v >= 0; v--) {
+                for (CAPlayable* p : voices[v]->getChord(time)) {
+                    if (p->timeStart() <= time) { // not the next chord of a silent voice
+                        slice.playables << p;
+                    }
+                }
+            }
+        }
+        _chordIndex << slice;
+    }
+
+    _chordIndexValidUntil = std::numeric_limits<int>::max();
+}
+
+/*!
+	Returns the chords of the whole sheet from the time \a from on, as the function marks, figured
+	bass marks and chord names see them. Each chord starts at the latest onset of its sounding
+	playables and lasts until the first of them ends, where the next chord starts.
+
+	\a from should be a start of a chord, see harmonySliceStart().
+
+	\sa repositContexts()
+*/
+QVector<CAHarmonySlice> CASheet::harmonySlices(int from)
+{
+    QVector<CAHarmonySlice> slices;
+    QList<CAPlayable*> chord = getChord(from);
+    while (chord.size()) {
+        CAHarmonySlice slice = { chord[0]->timeStart(), 0, false };
+        int minTimeEnd = chord[0]->timeEnd();
+        for (CAPlayable* p : chord) {
+            slice.timeStart = qMax(slice.timeStart, p->timeStart());
+            minTimeEnd = qMin(minTimeEnd, p->timeEnd());
+            if (p->musElementType() == CAMusElement::Note) {
+                slice.notes = true;
+            }
+        }
+        slice.timeLength = minTimeEnd - slice.timeStart;
+        slices << slice;
+
+        chord = getChord(minTimeEnd);
+    }
+
+    return slices;
+}
+
+/*!
+	Returns the start of the chord before the one at the given \a time. The dependent contexts
+	are repositioned from there on, so the chord split or merged by an edit at \a time is
+	updated as well.
+*/
+int CASheet::harmonySliceStart(int time)
+{
+    int k = (time > 0 ? chordSliceIndex(time - 1) : -1);
+    return (k >= 0 ? _chordIndex.at(k).time : 0);
+}
+
+/*!
+	Repositions the syllables, function marks, figured bass marks and chord names after the notes
+	changed at \a timeStart. The elements before it are kept. The chords shared by the function
+	marks, figured bass and chord names are collected once for all of them.
+
+	\sa CALyricsContext::repositSyllables(), CAFunctionMarkContext::repositFunctions(),
+	CAFiguredBassContext::repositFiguredBassMarks(), CAChordNameContext::repositChordNames()
+*/
+void CASheet::repositContexts(int timeStart)
+{
+    for (CAVoice* voice : voiceList()) {
+        CALyricsContext::repositSyllables(voice, timeStart);
+    }
+
+    int from = harmonySliceStart(timeStart);
+    QVector<CAHarmonySlice> slices;
+    bool collected = false;
+    for (CAContext* context : contextList()) {
+        if (!collected && (context->contextType() == CAContext::FunctionMarkContext || context->contextType() == CAContext::FiguredBassContext || context->contextType() == CAContext::ChordNameContext)) {
+            slices = harmonySlices(from);
+            collected = true;
+        }
+
+        switch (context->contextType()) {
+        case CAContext::FunctionMarkContext:
+            static_cast<CAFunctionMarkContext*>(context)->repositFunctions(slices, from);
+            break;
+        case CAContext::FiguredBassContext:
+            static_cast<CAFiguredBassContext*>(context)->repositFiguredBassMarks(slices, from);
+            break;
+        case CAContext::ChordNameContext:
+            static_cast<CAChordNameContext*>(context)->repositChordNames(slices, from);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/*!
+	Returns the index of the last chord slice starting at or before the given \a time or -1, if
+	there is none. Updates the chord index first.
+*/
+int CASheet::chordSliceIndex(int time)
+{
+    buildChordIndex();
+    return static_cast<int>(std::upper_bound(_chordIndex.constBegin(), _chordIndex.constEnd(), time,
+                                [](int t, const CAChordSlice& slice) { return t < slice.time; })
+               - _chordIndex.constBegin())
+        - 1;
+}
+
+/*!
+	Returns the number of the bar played at the given \a time. Bars are numbered from
+	firstBarNumber(), times after the last barline belong to lastBarNumber().
+
+	Looked up in the bar table in logarithmic time.
+
+	\sa barTimeStart(), buildBarTable()
+*/
+int CASheet::barNumber(int time)
+{
+    buildBarTable();
+    int i = static_cast<int>(std::upper_bound(_barTable.constBegin(), _barTable.constEnd(), time) - _barTable.constBegin()) - 1;
+    return _firstBarNumber + qMax(0, i);
+}
+
+/*!
+	Returns the start time of the bar numbered \a bar or -1, if there is no such bar.
+
+	\sa barNumber()
+*/
+int CASheet::barTimeStart(int bar)
+{
+    buildBarTable();
+    int i = bar - _firstBarNumber;
+    return ((i >= 0 && i < _barTable.size()) ? _barTable[i] : -1);
+}
+
+/*!
+	Updates the bar table used by barNumber() and barTimeStart(), if the voices changed.
+
+	A bar starts at time 0 and at each barline of any staff, except the dotted ones. If the first
+	bar is shorter than the first time signature says, it is a partial bar numbered 0, the same way
+	as the ruler of the score view numbers it. The voices invalidate the table from the time of the
+	change on, so only the bars after the edit are collected again from the barline references of
+	the staffs.
+
+	Call this before the sheet is read from several threads at once (see CADocumentVersion).
+*/
+void CASheet::buildBarTable()
+{
+    if (_barTableValidUntil == std::numeric_limits<int>::max()) {
+        return;
+    }
+
+    int from = _barTableValidUntil;
+    _barTable.resize(static_cast<int>(std::lower_bound(_barTable.constBegin(), _barTable.constEnd(), from) - _barTable.constBegin()));
+    if (_barTable.isEmpty()) {
+        _barTable << 0;
+    }
+
+    QVector<int> barlines;
+    CATimeSignature* timeSig = nullptr;
+    for (CAStaff* staff : staffList()) {
+        const QList<CAMusElement*>& refs = staff->barlineRefs();
+        QList<CAMusElement*>::const_iterator it = std::lower_bound(refs.constBegin(), refs.constEnd(), from,
+            [](CAMusElement* elt, int t) { return elt->timeStart() < t; });
+        for (; it != refs.constEnd(); it++) {
+            if (static_cast<CABarline*>(*it)->barlineType() != CABarline::Dotted && (*it)->timeStart() > _barTable.last()) {
+                barlines << (*it)->timeStart();
+            }
+        }
+
+        if (!timeSig && !staff->timeSignatureRefs().isEmpty()) {
+            timeSig = static_cast<CATimeSignature*>(staff->timeSignatureRefs().first());
+        }
+    }
+    std::sort(barlines.begin(), barlines.end());
+    barlines.erase(std::unique(barlines.begin(), barlines.end()), barlines.end());
+    _barTable << barlines;
+
+    _firstBarNumber = ((timeSig && _barTable.size() > 1 && _barTable[1] < timeSig->barDuration()) ? 0 : 1);
+    _barTableValidUntil = std::numeric_limits<int>::max();
+}
+
 /*!
 	Returns the Tempo element active at the given time.
+
+	Looked up in the tempoMap() in logarithmic time.
  */
 CATempo* CASheet::getTempo(int time)
 {
-    CATempo* tempo = nullptr;
-    for (int i = 0; i < staffList().size(); i++) {
-        CATempo* t = staffList()[i]->getTempo(time);
-        if (t && (!tempo || t->timeStart() > tempo->timeStart())) {
-            tempo = t;
+    const QVector<CATempoMapEntry>& map = tempoMap();
+    int i = tempoMapIndex(map, time);
+    return (i >= 0 ? map[i].tempo : nullptr);
+}
+
+/*!
+	Returns the real time in miliseconds of the given \a time, when the sheet is played from the
+	beginning. Before the first tempo mark, DEFAULT_MSECS_PER_TIME is used the same way as by the
+	playback.
+
+	\sa CAMusElement::realTimeStart()
+*/
+double CASheet::timeToMsecs(int time)
+{
+    const QVector<CATempoMapEntry>& map = tempoMap();
+    int i = tempoMapIndex(map, time);
+    if (i < 0) {
+        return time * DEFAULT_MSECS_PER_TIME;
+    }
+
+    return map[i].msecs + (time - map[i].time) * map[i].msecsPerTime;
+}
+
+/*!
+	Returns the tempo marks of all the voices sorted by their start time with the precomputed real
+	time of each tempo change. When several tempo marks start at the same time, the one in the
+	first voice is used.
+
+	The map is kept until the marks or the times of the music elements change, so it is cheap to
+	call in loops.
+
+	\sa getTempo(), timeToMsecs()
+*/
+const QVector<CATempoMapEntry>& CASheet::tempoMap()
+{
+    if (_tempoMapDirty) {
+        buildTempoMap();
+    }
+
+    return _tempoMap;
+}
+
+/*!
+	Rebuilds the tempo map, if the music elements changed.
+
+	Call this before the sheet is read from several threads at once (see CADocumentVersion).
+*/
+void CASheet::buildTempoMap()
+{
+    if (!_tempoMapDirty) {
+        return;
+    }
+
+    QVector<CATempoMapEntry> map;
+    for (CAVoice* voice : voiceList()) {
+        for (CAMusElement* elt : voice->musElementList()) {
+            for (CATempo* tempo : elt->marksOfType<CATempo>(CAMark::Tempo)) {
+                CATempoMapEntry entry = { tempo->timeStart(), 0, 0, tempo };
+                map << entry;
+            }
+        }
+    }
+
+    std::stable_sort(map.begin(), map.end(), [](const CATempoMapEntry& a, const CATempoMapEntry& b) { return a.time < b.time; });
+
+    _tempoMap.clear();
+    double msecs = 0;
+    double msecsPerTime = DEFAULT_MSECS_PER_TIME;
+    int time = 0;
+    for (const CATempoMapEntry& entry : map) {
+        if (!_tempoMap.isEmpty() && _tempoMap.last().time == entry.time) {
+            continue;
         }
+
+        msecs += (entry.time - time) * msecsPerTime;
+        time = entry.time;
+
+        int beat = CAPlayableLength::playableLengthToTimeLength(entry.tempo->beat());
+        if (beat > 0 && entry.tempo->bpm() > 0) {
+            msecsPerTime = 60000.0 / (beat * entry.tempo->bpm()); // the same as the playback sleep factor
+        }
+
+        CATempoMapEntry e = { time, msecs, msecsPerTime, entry.tempo };
+        _tempoMap << e;
     }
 
-    return tempo;
+    _tempoMapDirty = false;
+}
+
+/*!
+	Returns the index of the last tempo in the \a map starting at or before the given \a time or -1,
+	if there is none.
+*/
+int CASheet::tempoMapIndex(const QVector<CATempoMapEntry>& map, int time)
+{
+    return static_cast<int>(std::upper_bound(map.constBegin(), map.constEnd(), time,
+                                [](int t, const CATempoMapEntry& e) { return t < e.time; })
+               - map.constBegin())
+        - 1;
 }
 
 /*!
 	Returns the list of all the voices in the sheets staffs.
+
+	The list is kept until the contexts of the sheet or the voices of its staffs change, so it is cheap
+	to call in loops.
 */
-QList<CAVoice*> CASheet::voiceList()
+const QList<CAVoice*>& CASheet::voiceList()
 {
-    QList<CAVoice*> list;
-    QList<CAStaff*> staffs = staffList();
-    for (int i = 0; i < staffs.size(); i++)
-        list << staffs[i]->voiceList();
+    if (_voiceListDirty) {
+        const QList<CAStaff*>& staffs = staffList();
+        _voiceList.clear();
+        for (int i = 0; i < staffs.size(); i++)
+            _voiceList << staffs[i]->voiceList();
+        _voiceListDirty = false;
+    }
 
-    return list;
+    return _voiceList;
 }
 
-QList<CAStaff*> CASheet::staffList()
-{
-    QList<CAStaff*> staffList;
+/*!
+	Returns the list of the staffs among the contexts of the sheet.
 
-    for (int i = 0; i < _contextList.size(); i++) {
-        if (_contextList[i]->contextType() == CAContext::Staff) {
-            staffList << static_cast<CAStaff*>(_contextList[i]);
+	\sa voiceList()
+*/
+const QList<CAStaff*>& CASheet::staffList()
+{
+    if (_loader)
+        load();
+
+    if (_staffListDirty) {
+        _staffList.clear();
+        for (int i = 0; i < _contextList.size(); i++) {
+            if (_contextList[i]->contextType() == CAContext::Staff) {
+                _staffList << static_cast<CAStaff*>(_contextList[i]);
+            }
         }
+        _staffListDirty = false;
     }
 
-    return staffList;
+    return _staffList;
 }
 
 /*!
@@ -198,12 +725,16 @@ QList<CAStaff*> CASheet::staffList()
  */
 void CASheet::insertContextAfter(CAContext* after, CAContext* c)
 {
+    if (_loader)
+        load();
+
     int idx = _contextList.indexOf(after);
     if (idx == -1) {
         _contextList.prepend(c);
     } else {
         _contextList.insert(idx + 1, c);
     }
+    invalidateStaffList();
 }
 
 /*!
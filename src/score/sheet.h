@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2009, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -10,6 +10,10 @@
 
 #include <QList>
 #include <QString>
+#include <QVector>
+
+#include <limits>
+#include <memory>
 
 #include "score/context.h"
 #include "score/staff.h"
@@ -18,6 +22,31 @@ class CADocument;
 class CAPlayable;
 class CATempo;
 class CANoteCheckerError;
+class CASheet;
+
+struct CATempoMapEntry {
+    int time; // start time of the tempo
+    double msecs; // real time of the tempo start in miliseconds
+    double msecsPerTime; // miliseconds of a single time unit until the next tempo
+    CATempo* tempo;
+};
+
+struct CAChordSlice {
+    int time; // onset of a playable in any voice
+    QList<CAPlayable*> playables; // sounding at the onset, grouped by voice in the getChord() order
+};
+
+struct CAHarmonySlice {
+    int timeStart; // latest onset of the chord
+    int timeLength; // until the first playable of the chord ends
+    bool notes; // False, if only rests sound
+};
+
+class CASheetLoader {
+public:
+    virtual ~CASheetLoader() {}
+    virtual void load(CASheet* sheet) = 0;
+};
 
 class CASheet {
 public:
@@ -25,21 +54,96 @@ public:
     ~CASheet();
     CASheet* clone(CADocument* doc);
     inline CASheet* clone() { return clone(document()); }
+    CASheet* snapshot(CADocument* doc);
+
+    inline bool isLoaded() { return !_loader; }
+    inline const std::shared_ptr<CASheetLoader>& loader() { return _loader; }
+    inline void setLoader(std::shared_ptr<CASheetLoader> loader) { _loader = loader; }
+    void load();
 
-    inline const QList<CAContext*>& contextList() { return _contextList; }
+    inline const QList<CAContext*>& contextList()
+    {
+        if (_loader)
+            load();
+        return _contextList;
+    }
     CAContext* findContext(const QString name);
-    inline void insertContext(int pos, CAContext* c) { _contextList.insert(pos, c); }
+    inline void insertContext(int pos, CAContext* c)
+    {
+        if (_loader)
+            load();
+        _contextList.insert(pos, c);
+        invalidateStaffList();
+    }
     void insertContextAfter(CAContext* after, CAContext* c);
-    inline void addContext(CAContext* c) { _contextList << c; }
-    inline void removeContext(CAContext* c) { _contextList.removeAll(c); }
+    inline void addContext(CAContext* c)
+    {
+        if (_loader)
+            load();
+        _contextList << c;
+        invalidateStaffList();
+    }
+    inline void removeContext(CAContext* c)
+    {
+        if (_loader)
+            load();
+        _contextList.removeAll(c);
+        invalidateStaffList();
+    }
     QString findUniqueContextName(QString mask);
 
     CAStaff* addStaff();
-    QList<CAStaff*> staffList(); // generated list
-    QList<CAVoice*> voiceList(); // generated list
+    const QList<CAStaff*>& staffList(); // cached list
+    const QList<CAVoice*>& voiceList(); // cached list
+    inline void invalidateStaffList()
+    {
+        _staffListDirty = true;
+        _voiceListDirty = true;
+        _tempoMapDirty = true;
+        invalidateChordIndex();
+        invalidateBarTable();
+    }
+    inline void invalidateVoiceList()
+    {
+        _voiceListDirty = true;
+        _tempoMapDirty = true;
+        invalidateChordIndex();
+        invalidateBarTable();
+    }
 
     QList<CAPlayable*> getChord(int time);
+    QList<CAPlayable*> getPlayables(int timeStart, int timeEnd);
+    void buildChordIndex();
+#ifndef SWIG
+    QVector<CAHarmonySlice> harmonySlices(int from);
+#endif
+    int harmonySliceStart(int time);
+    void repositContexts(int timeStart = 0);
+    inline void invalidateChordIndex(int time = std::numeric_limits<int>::min()) { _chordIndexValidUntil = qMin(_chordIndexValidUntil, time); }
     CATempo* getTempo(int time);
+    double timeToMsecs(int time);
+#ifndef SWIG
+    const QVector<CATempoMapEntry>& tempoMap(); // cached map
+#endif
+    void buildTempoMap();
+    inline void invalidateTempoMap() { _tempoMapDirty = true; }
+
+    static const double DEFAULT_MSECS_PER_TIME;
+
+    int barNumber(int time);
+    int barTimeStart(int bar);
+    inline int firstBarNumber()
+    {
+        buildBarTable();
+        return _firstBarNumber;
+    }
+    inline int lastBarNumber()
+    {
+        buildBarTable();
+        return _firstBarNumber + _barTable.size() - 1;
+    }
+    void buildBarTable();
+    inline void invalidateBarTable(int time = std::numeric_limits<int>::min()) { _barTableValidUntil = qMin(_barTableValidUntil, time); }
 
     inline CADocument* document() { return _document; }
     inline void setDocument(CADocument* doc) { _document = doc; }
@@ -54,9 +158,24 @@ public:
     void clear();
 
 private:
+    static int tempoMapIndex(const QVector<CATempoMapEntry>& map, int time);
+    int chordSliceIndex(int time);
+
     QList<CAContext*> _contextList;
+    QList<CAStaff*> _staffList; // staffs in _contextList, regenerated by staffList() when dirty
+    QList<CAVoice*> _voiceList; // voices of _staffList, regenerated by voiceList() when dirty
+    QVector<CATempoMapEntry> _tempoMap; // tempo marks of all the voices sorted by time, regenerated by tempoMap() when dirty
+    bool _staffListDirty;
+    bool _voiceListDirty;
+    bool _tempoMapDirty;
+    QVector<CAChordSlice> _chordIndex; // distinct onsets of all the voices sorted by time
+    int _chordIndexValidUntil; // slices before this time are up to date, the rest is rebuilt by buildChordIndex()
+    QVector<int> _barTable; // start time of each bar, the first one starts at 0
+    int _barTableValidUntil; // bars starting before this time are up to date, the rest is rebuilt by buildBarTable()
+    int _firstBarNumber; // 0, if the sheet starts with a partial bar, 1 otherwise
     CADocument* _document;
     QList<CANoteCheckerError*> _noteCheckerErrorList;
+    std::shared_ptr<CASheetLoader> _loader; // reads the contexts on the first access, null when loaded
 
     QString _name;
 };
@@ -14,7 +14,7 @@
 	This class represents any type of slur.
 	Holds pointers to the first and last notes.
 
-	\sa CANote::_slurStart, \sa CANote::_tieStart, \sa CANote::_phrasingSlurStart
+	\sa CANote::slurStart(), \sa CANote::tieStart(), \sa CANote::phrasingSlurStart()
 */
 
 /*!
@@ -44,7 +44,11 @@ public:
     int compare(CAMusElement* elt);
 
     inline CASlurDirection slurDirection() { return _slurDirection; }
-    inline void setSlurDirection(CASlurDirection dir) { _slurDirection = dir; }
+    inline void setSlurDirection(CASlurDirection dir)
+    {
+        _slurDirection = dir;
+        contentChanged();
+    }
 
     inline CASlurType slurType() { return _slurType; }
     inline CANote* noteStart() { return _noteStart; }
@@ -52,7 +56,11 @@ public:
     inline CASlurStyle slurStyle() { return _slurStyle; }
     inline void setNoteStart(CANote* noteStart) { _noteStart = noteStart; }
     inline void setNoteEnd(CANote* noteEnd) { _noteEnd = noteEnd; }
-    inline void setSlurStyle(CASlurStyle slurStyle) { _slurStyle = slurStyle; }
+    inline void setSlurStyle(CASlurStyle slurStyle)
+    {
+        _slurStyle = slurStyle;
+        contentChanged();
+    }
 
     static const QString slurStyleToString(CASlurStyle style);
     static CASlurStyle slurStyleFromString(const QString style);
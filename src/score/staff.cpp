@@ -7,11 +7,14 @@
 
 #include <QtDebug>
 
+#include <QHash>
 #include <QPainter>
+#include <QVector>
 #include <iostream>
 
 #include "score/note.h"
 #include "score/rest.h" // used for voice synchronization
+#include "score/sheet.h"
 #include "score/staff.h"
 #include "score/tempo.h"
 #include "score/tuplet.h"
@@ -29,6 +32,10 @@
 
 	CAStaff is by hierarchy part of CASheet and can include various number of CAVoice objects.
 
+	A finished staff can be frozen by setFrozen(). The editor refuses to change the frozen staffs,
+	so the voice synchronization, the note checker and the layout reuse their previous results for
+	them. Only the alignment with the other staffs is computed again after each edit.
+
 	\sa CADrawableStaff, CASheet, CAVoice
 */
 
@@ -44,6 +51,8 @@ CAStaff::CAStaff(const QString name, CASheet* s, int numberOfLines)
     _contextType = CAContext::Staff;
     _numberOfLines = numberOfLines;
     _name = name;
+    _frozen = false;
+    _synchronized = false;
 }
 
 CAStaff::~CAStaff()
@@ -51,9 +60,21 @@ CAStaff::~CAStaff()
     clear();
 }
 
+/*!
+	Creates a copy of the staff with all its voices and music elements in the sheet \a s.
+
+	The elements are cloned in a single pass in the time order. The ties, slurs and phrasing slurs
+	are connected afterwards through the map of the original notes to their clones, so each one is
+	resolved by a single lookup instead of searching the slurs still open.
+
+	The clone is a snapshot of the staff for the undo, so the staff and all the cloned elements keep
+	their ids, see CAMusElement::id().
+*/
 CAStaff* CAStaff::clone(CASheet* s)
 {
     CAStaff* newStaff = new CAStaff(name(), s, numberOfLines());
+    newStaff->setId(id());
+    newStaff->setFrozen(isFrozen());
 
     // create empty voices
     for (int i = 0; i < voiceList().size(); i++) {
@@ -63,12 +84,8 @@ CAStaff* CAStaff::clone(CASheet* s)
     int* peltIdx = new int[voiceList().size()];
     for (int i = 0; i < voiceList().size(); i++)
         peltIdx[i] = 0;
-    QList<CANote*> tiedOrigNotes; // original notes having opened tie
-    QList<CANote*> sluredOrigNotes; // original notes having opened slur
-    QList<CANote*> phrasingSluredOrigNotes; // original notes having opened phrasing slur
-    QList<CANote*> tiedClonedNotes; // cloned notes having opened tie
-    QList<CANote*> sluredClonedNotes; // cloned notes having opened slur
-    QList<CANote*> phrasingSluredClonedNotes; // cloned notes having opened phrasing slur
+    QHash<CANote*, CANote*> clonedNotes; // original notes starting or ending a tie or a slur -> their clones
+    QList<CANote*> slurStarts; // original notes starting a tie or a slur in the time order
 
     bool done = false;
     while (!done) {
@@ -80,63 +97,17 @@ CAStaff* CAStaff::clone(CASheet* s)
             while (peltIdx[i] < voiceList()[i]->musElementList().size() && voiceList()[i]->musElementList()[peltIdx[i]]->isPlayable()) {
                 CAPlayable* origElt = static_cast<CAPlayable*>(voiceList()[i]->musElementList()[peltIdx[i]]);
                 CAPlayable* clonedElt = origElt->clone(newStaff->voiceList()[i]);
+                clonedElt->keepIds(origElt);
                 newStaff->voiceList()[i]->append(clonedElt,
                     voiceList()[i]->musElementList()[peltIdx[i]]->musElementType() == CAMusElement::Note && static_cast<CANote*>(origElt)->isPartOfChord() && !static_cast<CANote*>(origElt)->isFirstInChord());
 
                 if (origElt->musElementType() == CAMusElement::Note) {
                     CANote* origNote = static_cast<CANote*>(origElt);
-                    CANote* clonedNote = static_cast<CANote*>(clonedElt);
-
-                    // check starting ties, slurs, prasing slurs
-                    for (int i = 0; i < tiedOrigNotes.size(); i++) {
-                        if (tiedOrigNotes[i]->tieStart()->noteEnd() == origNote) {
-                            CASlur* newTie = tiedOrigNotes[i]->tieStart()->clone(newStaff);
-                            tiedClonedNotes[i]->setTieStart(newTie);
-                            newTie->setNoteStart(tiedClonedNotes[i]);
-                            newTie->setNoteEnd(clonedNote);
-                            clonedNote->setTieEnd(newTie);
-
-                            tiedOrigNotes.removeAt(i);
-                            tiedClonedNotes.removeAt(i);
-                        }
-                    }
-                    for (int i = 0; i < sluredOrigNotes.size(); i++) {
-                        if (sluredOrigNotes[i]->slurStart()->noteEnd() == origNote) {
-                            CASlur* newSlur = sluredOrigNotes[i]->slurStart()->clone(newStaff);
-                            sluredClonedNotes[i]->setSlurStart(newSlur);
-                            newSlur->setNoteStart(sluredClonedNotes[i]);
-                            newSlur->setNoteEnd(clonedNote);
-                            clonedNote->setSlurEnd(newSlur);
-
-                            sluredOrigNotes.removeAt(i);
-                            sluredClonedNotes.removeAt(i);
-                        }
-                    }
-                    for (int i = 0; i < phrasingSluredOrigNotes.size(); i++) {
-                        if (phrasingSluredOrigNotes[i]->phrasingSlurStart()->noteEnd() == origNote) {
-                            CASlur* newPhrasingSlur = phrasingSluredOrigNotes[i]->phrasingSlurStart()->clone(newStaff);
-                            phrasingSluredClonedNotes[i]->setPhrasingSlurStart(newPhrasingSlur);
-                            newPhrasingSlur->setNoteStart(phrasingSluredClonedNotes[i]);
-                            newPhrasingSlur->setNoteEnd(clonedNote);
-                            clonedNote->setPhrasingSlurEnd(newPhrasingSlur);
-
-                            phrasingSluredOrigNotes.removeAt(i);
-                            phrasingSluredClonedNotes.removeAt(i);
-                        }
+                    if (origNote->tieStart() || origNote->slurStart() || origNote->phrasingSlurStart()) {
+                        slurStarts << origNote;
                     }
-
-                    // check ending ties, slurs, phrasing slurs
-                    if (origNote->tieStart()) {
-                        tiedOrigNotes << origNote;
-                        tiedClonedNotes << static_cast<CANote*>(clonedElt);
-                    }
-                    if (origNote->slurStart()) {
-                        sluredOrigNotes << origNote;
-                        sluredClonedNotes << static_cast<CANote*>(clonedElt);
-                    }
-                    if (origNote->phrasingSlurStart()) {
-                        phrasingSluredOrigNotes << origNote;
-                        phrasingSluredClonedNotes << static_cast<CANote*>(clonedElt);
+                    if (origNote->tieStart() || origNote->slurStart() || origNote->phrasingSlurStart() || origNote->tieEnd() || origNote->slurEnd() || origNote->phrasingSlurEnd()) {
+                        clonedNotes[origNote] = static_cast<CANote*>(clonedElt);
                     }
                 }
 
@@ -146,18 +117,19 @@ CAStaff* CAStaff::clone(CASheet* s)
                 }
 
                 if (origElt->isLastInTuplet()) {
-                    new CATuplet(origElt->tuplet()->number(), origElt->tuplet()->actualNumber(), elementsUnderTuplet);
+                    CATuplet* newTuplet = new CATuplet(origElt->tuplet()->number(), origElt->tuplet()->actualNumber(), elementsUnderTuplet);
+                    newTuplet->setId(origElt->tuplet()->id());
                     elementsUnderTuplet.clear();
                 }
 
                 peltIdx[i]++;
             }
-            newStaff->voiceList()[i]->synchronizeMusElements();
         }
 
         // append non-playable elements (shared by all voices - only create clone of the first voice element and append it to all)
         if (peltIdx[0] < voiceList()[0]->musElementList().size()) {
             CAMusElement* newElt = voiceList()[0]->musElementList()[peltIdx[0]]->clone(newStaff);
+            newElt->keepIds(voiceList()[0]->musElementList()[peltIdx[0]]);
 
             for (int i = 0; i < voiceList().size(); i++) {
                 newStaff->voiceList()[i]->append(newElt);
@@ -176,6 +148,39 @@ CAStaff* CAStaff::clone(CASheet* s)
     }
 
     delete[] peltIdx;
+
+    // connect the cloned ties and slurs, the ones ending outside of the staff are dropped
+    for (CANote* origNote : slurStarts) {
+        CANote* clonedStart = clonedNotes[origNote];
+        if (origNote->tieStart() && clonedNotes.contains(origNote->tieStart()->noteEnd())) {
+            CANote* clonedEnd = clonedNotes[origNote->tieStart()->noteEnd()];
+            CASlur* newTie = origNote->tieStart()->clone(newStaff, clonedStart, clonedEnd);
+            newTie->setId(origNote->tieStart()->id());
+            clonedStart->setTieStart(newTie);
+            clonedEnd->setTieEnd(newTie);
+        }
+        if (origNote->slurStart() && clonedNotes.contains(origNote->slurStart()->noteEnd())) {
+            CANote* clonedEnd = clonedNotes[origNote->slurStart()->noteEnd()];
+            CASlur* newSlur = origNote->slurStart()->clone(newStaff, clonedStart, clonedEnd);
+            newSlur->setId(origNote->slurStart()->id());
+            clonedStart->setSlurStart(newSlur);
+            clonedEnd->setSlurEnd(newSlur);
+        }
+        if (origNote->phrasingSlurStart() && clonedNotes.contains(origNote->phrasingSlurStart()->noteEnd())) {
+            CANote* clonedEnd = clonedNotes[origNote->phrasingSlurStart()->noteEnd()];
+            CASlur* newPhrasingSlur = origNote->phrasingSlurStart()->clone(newStaff, clonedStart, clonedEnd);
+            newPhrasingSlur->setId(origNote->phrasingSlurStart()->id());
+            clonedStart->setPhrasingSlurStart(newPhrasingSlur);
+            clonedEnd->setPhrasingSlurEnd(newPhrasingSlur);
+        }
+    }
+
+    // the content is the same, the results computed from the original voices apply to the clones
+    for (int i = 0; i < voiceList().size(); i++) {
+        newStaff->voiceList()[i]->synchronizeMusElements(); // once for the whole voice
+        newStaff->voiceList()[i]->_generation = voiceList()[i]->_generation;
+    }
+
     return newStaff;
 }
 
@@ -201,6 +206,36 @@ void CAStaff::clear()
     }
 }
 
+/*!
+	Appends the given \a voice to the staff.
+*/
+void CAStaff::addVoice(CAVoice* voice)
+{
+    _voiceList << voice;
+    if (sheet())
+        sheet()->invalidateVoiceList();
+}
+
+/*!
+	Inserts the given \a voice to the staff at index \a idx.
+*/
+void CAStaff::insertVoice(int idx, CAVoice* voice)
+{
+    _voiceList.insert(idx, voice);
+    if (sheet())
+        sheet()->invalidateVoiceList();
+}
+
+/*!
+	Removes the given \a voice from the staff. The voice is not deleted.
+*/
+void CAStaff::removeVoice(CAVoice* voice)
+{
+    _voiceList.removeAll(voice);
+    if (sheet())
+        sheet()->invalidateVoiceList();
+}
+
 /*!
 	Adds an empty voice to the staff.
 	Call synchronizeVoices() manually to synchronize a new voice with other voices.
@@ -260,6 +295,38 @@ bool CAStaff::remove(CAMusElement* elt, bool updateSignTimes)
     return voiceList()[0]->remove(elt, updateSignTimes);
 }
 
+/*!
+	Removes the elements \a elts from their voices at once, see CAVoice::removeBlock(), and
+	synchronizes the voices once from the first removed element on.
+
+	Also updates non-playable shared signs after the elements, if \a updateSignTimes is True.
+*/
+bool CAStaff::removeBlock(const QList<CAMusElement*>& elts, bool updateSignTimes)
+{
+    if (elts.isEmpty() || !voiceList().size())
+        return false;
+
+    QHash<CAVoice*, QList<CAMusElement*>> voiceElts;
+    int timeStart = elts.first()->timeStart();
+    for (CAMusElement* elt : elts) {
+        voiceElts[elt->isPlayable() ? static_cast<CAPlayable*>(elt)->voice() : voiceList()[0]] << elt;
+        timeStart = qMin(timeStart, elt->timeStart());
+    }
+
+    bool removed = false;
+    for (QHash<CAVoice*, QList<CAMusElement*>>::const_iterator i = voiceElts.constBegin(); i != voiceElts.constEnd(); i++) {
+        if (i.key()) {
+            removed |= i.key()->removeBlock(i.value(), updateSignTimes);
+        }
+    }
+
+    if (removed) {
+        synchronizeVoices(timeStart);
+    }
+
+    return removed;
+}
+
 /*!
 	Returns the first voice with the given \a name or Null, if such a voice doesn't exist.
 */
@@ -351,55 +418,110 @@ CATempo* CAStaff::getTempo(int time)
 	3) If a voice elements are not linear (every N-th element's timeEnd should be N+1-th element's timeStart)
 	   inserts rests to achieve linearity.
 
-	Synchronizing voices is relatively slow (O(n*m) where n is number of voices and m number of elements
-	in voice n). This was the main reason to not automate the synchronization: import filters use lots of
-	insertions and synchronization of the voices every time a new element is inserted would considerably
-	slow down the import filter.
+	The voices are walked in a single pass merged by the start time of their elements. Signs already
+	shared by all the voices are kept in place, so synchronizing consistent voices is linear in the
+	number of elements. Synchronization is still not automated: import filters use lots of insertions
+	and synchronizing the voices every time a new element is inserted would slow them down.
+
+	If \a timeStart is given, the voices were consistent before an edit at that time and only the
+	part starting at the last barline before it is synchronized again.
+
+	Frozen staffs (see setFrozen()) are only synchronized once, their content doesn't change later.
 
 	\return True, if everything was ok. False, if fixes were needed.
 */
-bool CAStaff::synchronizeVoices()
+bool CAStaff::synchronizeVoices(int timeStart)
 {
-    int* pidx = new int[voiceList().size()];
-    for (int i = 0; i < voiceList().size(); i++)
-        pidx[i] = -1; // array of current indices of voices at current timeStart
-    CAMusElement** plastPlayable = new CAMusElement*[voiceList().size()];
-    for (int i = 0; i < voiceList().size(); i++)
-        plastPlayable[i] = nullptr;
+    if (_frozen && _synchronized) {
+        return false; // the content didn't change since
+    }
+
+    const QList<CAVoice*>& voices = voiceList();
+    QVector<int> pidx(voices.size(), -1); // array of current indices of voices at current timeStart
+    QVector<CAMusElement*> plastPlayable(voices.size(), nullptr);
 
-    _clefList.clear();
-    _keySignatureList.clear();
-    _timeSignatureList.clear();
-    _barlineList.clear();
+    // start at the last barline before the edit, the voices are consistent up to it
+    int fromTime = 0;
+    for (int i = 0; i < _barlineList.size(); i++) {
+        if (_barlineList[i]->timeStart() < timeStart && _barlineList[i]->timeStart() > fromTime)
+            fromTime = _barlineList[i]->timeStart();
+    }
+    timeStart = fromTime;
+
+    if (timeStart > 0) {
+        QList<CAMusElement*>* refs[] = { &_clefList, &_keySignatureList, &_timeSignatureList, &_barlineList };
+        for (QList<CAMusElement*>* list : refs) {
+            for (int i = list->size() - 1; i >= 0; i--) {
+                if ((*list)[i]->timeStart() >= timeStart)
+                    list->removeAt(i);
+            }
+        }
+    } else {
+        _clefList.clear();
+        _keySignatureList.clear();
+        _timeSignatureList.clear();
+        _barlineList.clear();
+    }
 
-    int timeStart = 0;
     bool done = false;
     bool changesMade = false;
 
     // first fix any inconsistencies inside a voice
-    for (int i = 0; i < voiceList().size(); i++)
-        voiceList()[i]->synchronizeMusElements();
+    for (int i = 0; i < voices.size(); i++)
+        voices[i]->synchronizeMusElements();
+
+    if (timeStart > 0) {
+        for (int i = 0; i < voices.size(); i++) {
+            pidx[i] = voices[i]->lowerBound(timeStart) - 1;
+            for (int j = pidx[i]; j >= 0 && !plastPlayable[i]; j--) {
+                if (voices[i]->musElementList()[j]->isPlayable())
+                    plastPlayable[i] = voices[i]->musElementList()[j];
+            }
+        }
+    }
 
     while (!done) {
         QList<CAMusElement*> sharedList; // list of shared music elements having the same time-start sorted by voice number
 
-        // gather shared elements into sharedList and remove them from the voice at new timeStart
-        for (int i = 0; i < voiceList().size(); i++) {
-            // don't increase pidx[i], if the next element is not-playable
-            while (pidx[i] < voiceList()[i]->musElementList().size() - 1 && !voiceList()[i]->musElementList()[pidx[i] + 1]->isPlayable() && (voiceList()[i]->musElementList()[pidx[i] + 1]->timeStart() == timeStart)) {
-                if (!sharedList.contains(voiceList()[i]->musElementList()[pidx[i] + 1])) {
-                    sharedList << voiceList()[i]->musElementList()[pidx[i] + 1];
+        // signs at the new timeStart which are already shared by all the voices in the same order stay in place
+        bool shared = true;
+        for (int i = 0; i < voices.size() && shared; i++) {
+            const QList<CAMusElement*>& elts = voices[i]->musElementList();
+            int n = 0;
+            while (pidx[i] + 1 + n < elts.size() && !elts[pidx[i] + 1 + n]->isPlayable() && elts[pidx[i] + 1 + n]->timeStart() == timeStart) {
+                if (i == 0)
+                    sharedList << elts[pidx[i] + 1 + n];
+                else if (n >= sharedList.size() || elts[pidx[i] + 1 + n] != sharedList[n])
+                    shared = false;
+                n++;
+            }
+            if (n != sharedList.size())
+                shared = false;
+        }
+
+        if (!shared) {
+            sharedList.clear();
+
+            // gather shared elements into sharedList and remove them from the voice at new timeStart
+            for (int i = 0; i < voices.size(); i++) {
+                // don't increase pidx[i], if the next element is not-playable
+                while (pidx[i] < voices[i]->musElementList().size() - 1 && !voices[i]->musElementList()[pidx[i] + 1]->isPlayable() && (voices[i]->musElementList()[pidx[i] + 1]->timeStart() == timeStart)) {
+                    if (!sharedList.contains(voices[i]->musElementList()[pidx[i] + 1])) {
+                        sharedList << voices[i]->musElementList()[pidx[i] + 1];
+                    }
+                    voices[i]->removeAt(pidx[i] + 1);
                 }
-                voiceList()[i]->_musElementList.removeAt(pidx[i] + 1);
             }
         }
 
         // insert all elements from sharedList into all voices
         // OR increase pidx[i] for 1 in all voices, if their new element is playable and new timeStart is correct
         if (sharedList.size()) {
-            for (int i = 0; i < voiceList().size(); i++) {
-                for (int j = 0; j < sharedList.size(); j++) {
-                    voiceList()[i]->_musElementList.insert(pidx[i] + 1 + j, sharedList[j]);
+            for (int i = 0; i < voices.size(); i++) {
+                if (!shared) {
+                    for (int j = 0; j < sharedList.size(); j++) {
+                        voices[i]->insertAt(pidx[i] + 1 + j, sharedList[j]);
+                    }
                 }
                 pidx[i]++; // jump to the first one inserted from the sharedList, if inserting shared elts for the first time
                     // or the first one after the sharedList in second pass
@@ -426,34 +548,34 @@ bool CAStaff::synchronizeVoices()
             }
 
         } else {
-            for (int i = 0; i < voiceList().size(); i++) {
-                if (pidx[i] < voiceList()[i]->musElementList().size() - 1 && (voiceList()[i]->musElementList()[pidx[i] + 1]->timeStart() == timeStart)) {
-                    if (voiceList()[i]->musElementList()[pidx[i] + 1]->isPlayable()) {
+            for (int i = 0; i < voices.size(); i++) {
+                if (pidx[i] < voices[i]->musElementList().size() - 1 && (voices[i]->musElementList()[pidx[i] + 1]->timeStart() == timeStart)) {
+                    if (voices[i]->musElementList()[pidx[i] + 1]->isPlayable()) {
                         pidx[i]++;
-                        plastPlayable[i] = voiceList()[i]->musElementList()[pidx[i]];
+                        plastPlayable[i] = voices[i]->musElementList()[pidx[i]];
                     }
                 }
             }
         }
 
         // if the shared element overlaps any of the chords in other voices, insert rests (shift the shared sign forward) to that voice
-        for (int i = 0; i < voiceList().size(); i++) {
-            if (pidx[i] == -1 || voiceList()[i]->musElementList()[pidx[i]]->isPlayable()) // only legal pidx[i] and non-playable elements
+        for (int i = 0; i < voices.size(); i++) {
+            if (pidx[i] == -1 || voices[i]->musElementList()[pidx[i]]->isPlayable()) // only legal pidx[i] and non-playable elements
                 continue;
 
-            for (int j = 0; j < voiceList().size(); j++) {
+            for (int j = 0; j < voices.size(); j++) {
                 if (i == j)
                     continue;
 
                 // fix the overlapped chord, rests are inserted later in non-linearity check
-                if (pidx[j] != -1 && voiceList()[i]->musElementList()[pidx[i]]->timeStart() == timeStart && plastPlayable[j] && plastPlayable[j]->timeStart() < timeStart && plastPlayable[j]->timeEnd() > timeStart) {
+                if (pidx[j] != -1 && voices[i]->musElementList()[pidx[i]]->timeStart() == timeStart && plastPlayable[j] && plastPlayable[j]->timeStart() < timeStart && plastPlayable[j]->timeEnd() > timeStart) {
                     int gapLength = plastPlayable[j]->timeEnd() - timeStart;
-                    QList<CARest*> restList = CARest::composeRests(gapLength, voiceList()[i]->musElementList()[pidx[i]]->timeStart(), voiceList()[i]);
+                    QList<CARest*> restList = CARest::composeRests(gapLength, voices[i]->musElementList()[pidx[i]]->timeStart(), voices[i]);
 
-                    voiceList()[i]->musElementList()[pidx[i]]->setTimeStart(plastPlayable[j]->timeEnd());
+                    voices[i]->musElementList()[pidx[i]]->setTimeStart(plastPlayable[j]->timeEnd());
                     for (int k = 0; k < restList.size(); k++)
-                        voiceList()[i]->_musElementList.insert(pidx[i]++, restList[k]); // insert the missing rests, rests are added in back, pidx++
-                    voiceList()[i]->updateTimes(pidx[i], gapLength, false); // increase playable timeStarts
+                        voices[i]->insertAt(pidx[i]++, restList[k]); // insert the missing rests, rests are added in back, pidx++
+                    voices[i]->updateTimes(pidx[i], gapLength, false); // increase playable timeStarts
                     if (restList.size()) {
                         plastPlayable[i] = restList.last();
                     } else {
@@ -466,15 +588,15 @@ bool CAStaff::synchronizeVoices()
         }
 
         // if the elements times are not linear (every N-th element's timeEnd should be N+1-th timeStart), insert rests to achieve it
-        for (int j = 0; j < voiceList().size(); j++) {
+        for (int j = 0; j < voices.size(); j++) {
             // fix the non-linearity
-            if (pidx[j] != -1 && !voiceList()[j]->musElementList()[pidx[j]]->isPlayable() && voiceList()[j]->musElementList()[pidx[j]]->timeStart() == timeStart
+            if (pidx[j] != -1 && !voices[j]->musElementList()[pidx[j]]->isPlayable() && voices[j]->musElementList()[pidx[j]]->timeStart() == timeStart
                 && (plastPlayable[j] ? plastPlayable[j]->timeEnd() : 0) < timeStart) {
                 int gapLength = timeStart - ((pidx[j] == -1 || !plastPlayable[j]) ? 0 : plastPlayable[j]->timeEnd());
-                QList<CARest*> restList = CARest::composeRests(gapLength, (pidx[j] == -1 || !plastPlayable[j]) ? 0 : plastPlayable[j]->timeEnd(), voiceList()[j]);
+                QList<CARest*> restList = CARest::composeRests(gapLength, (pidx[j] == -1 || !plastPlayable[j]) ? 0 : plastPlayable[j]->timeEnd(), voices[j]);
                 for (int k = 0; k < restList.size(); k++)
-                    voiceList()[j]->_musElementList.insert(pidx[j]++, restList[k]); // insert the missing rests, rests are added in back, pidx++
-                voiceList()[j]->updateTimes(pidx[j], gapLength, false); // increase playable timeStarts
+                    voices[j]->insertAt(pidx[j]++, restList[k]); // insert the missing rests, rests are added in back, pidx++
+                voices[j]->updateTimes(pidx[j], gapLength, false); // increase playable timeStarts
                 if (restList.size()) {
                     plastPlayable[j] = restList.last();
                 } else {
@@ -486,7 +608,7 @@ bool CAStaff::synchronizeVoices()
 
         // jump to the last inserted from the sharedList
         if (sharedList.size()) {
-            for (int i = 0; i < voiceList().size(); i++) {
+            for (int i = 0; i < voices.size(); i++) {
                 pidx[i] += (sharedList.size() - 1);
             }
         }
@@ -494,21 +616,21 @@ bool CAStaff::synchronizeVoices()
         // shortest time is delta between the current elements and the nearest one in the future
         int shortestTime = -1;
 
-        for (int i = 0; i < voiceList().size(); i++) {
-            if (pidx[i] < (voiceList()[i]->musElementList().size() - 1) && (shortestTime == -1 || voiceList()[i]->musElementList()[pidx[i] + 1]->timeStart() - timeStart < shortestTime))
-                shortestTime = voiceList()[i]->musElementList()[pidx[i] + 1]->timeStart() - timeStart;
+        for (int i = 0; i < voices.size(); i++) {
+            if (pidx[i] < (voices[i]->musElementList().size() - 1) && (shortestTime == -1 || voices[i]->musElementList()[pidx[i] + 1]->timeStart() - timeStart < shortestTime))
+                shortestTime = voices[i]->musElementList()[pidx[i] + 1]->timeStart() - timeStart;
         }
         int deltaTime = ((shortestTime != -1) ? shortestTime : 0);
         timeStart += deltaTime; // increase timeStart
 
         // if all voices are at the end, finish
         done = (deltaTime == 0); // last pass is only meant to linearize
-        for (int i = 0; i < voiceList().size(); i++)
-            if (pidx[i] < voiceList()[i]->musElementList().size() - 1)
+        for (int i = 0; i < voices.size(); i++)
+            if (pidx[i] < voices[i]->musElementList().size() - 1)
                 done = false;
     }
 
-    delete[] pidx;
+    _synchronized = _frozen;
     return changesMade;
 }
 
@@ -520,32 +642,34 @@ bool CAStaff::synchronizeVoices()
 	It searches for the time signature in effect for the last bar, not to get fooled by
 	time signature(s) already present at a time signature change.
 
+	The barline and time signature are looked up in the staff's reference lists from the
+	back. As the element is the last one, this takes constant time regardless of the
+	length of the staff, so auto-barring doesn't slow down the note entry in long scores.
+
 	\return True, if a new barline was placed; otherwise False.
+
+	\sa placeAutoBars()
  */
 bool CAStaff::placeAutoBar(CAPlayable* elt)
 {
     if (!elt)
         return false;
-    CABarline* b = static_cast<CABarline*>(elt->voice()->previousByType(CAMusElement::Barline, elt));
-    CATimeSignature* t;
-    CAMusElement* prevTimeSig = elt;
+    CAStaff* staff = elt->voice()->staff();
 
     // do not place autobar, if the element was inserted somewhere in the middle
-    for (int i = 0; i < elt->voice()->staff()->voiceList().size(); i++) {
-        if (elt->voice()->staff()->voiceList()[i]->lastTimeEnd() > elt->timeEnd()) {
+    for (int i = 0; i < staff->voiceList().size(); i++) {
+        if (staff->voiceList()[i]->lastTimeEnd() > elt->timeEnd()) {
             return false;
         }
     }
 
-    do {
-        prevTimeSig = elt->voice()->previousByType(CAMusElement::TimeSignature, prevTimeSig);
-        t = static_cast<CATimeSignature*>(prevTimeSig);
-    } while (t && prevTimeSig->timeStart() == elt->timeStart()); // not the time signature for a bar in the future
+    CABarline* b = static_cast<CABarline*>(lastRefBefore(staff->barlineRefs(), elt->timeStart() + 1));
+    CATimeSignature* t = static_cast<CATimeSignature*>(lastRefBefore(staff->timeSignatureRefs(), elt->timeStart())); // not the time signature for a bar in the future
 
     if (t) {
         if ((b ? (b->timeStart()) : 0) + t->barDuration() <= elt->timeStart()) {
             elt->voice()->insert(elt, new CABarline(CABarline::Single, elt->staff(), elt->timeStart()));
-            elt->staff()->synchronizeVoices();
+            elt->staff()->synchronizeVoices(elt->timeStart());
 
             return true;
         }
@@ -553,3 +677,78 @@ bool CAStaff::placeAutoBar(CAPlayable* elt)
 
     return false;
 }
+
+/*!
+	Places the missing barlines from \a timeStart on in a single pass, as calling placeAutoBar()
+	for each playable element in order would do. The barlines are placed in the longest voice and
+	the voices are synchronized only once at the end. This is used after pasting or importing a
+	block of elements at the end of the staff.
+
+	\return The number of the placed barlines.
+
+	\sa placeAutoBar()
+*/
+int CAStaff::placeAutoBars(int timeStart)
+{
+    CAVoice* voice = nullptr;
+    for (int i = 0; i < voiceList().size(); i++) {
+        if (!voice || voiceList()[i]->lastTimeEnd() > voice->lastTimeEnd()) {
+            voice = voiceList()[i];
+        }
+    }
+    if (!voice) {
+        return 0;
+    }
+
+    QList<CAMusElement*>& timeSigs = timeSignatureRefs();
+    CAMusElement* b = lastRefBefore(barlineRefs(), timeStart);
+    int barStart = (b ? b->timeStart() : 0);
+    int ts = 0; // number of the time signatures starting before the current element
+    QList<CAPlayable*> barStarts;
+
+    for (CAMusElement* elt : voice->musElementList()) {
+        if (elt->timeStart() < timeStart) {
+            continue;
+        }
+        if (elt->musElementType() == CAMusElement::Barline) {
+            barStart = elt->timeStart();
+            continue;
+        }
+        if (!elt->isPlayable()) {
+            continue;
+        }
+
+        while (ts < timeSigs.size() && timeSigs[ts]->timeStart() < elt->timeStart()) {
+            ts++;
+        }
+        CATimeSignature* t = (ts ? static_cast<CATimeSignature*>(timeSigs[ts - 1]) : nullptr);
+        if (t && barStart + t->barDuration() <= elt->timeStart()) {
+            barStarts << static_cast<CAPlayable*>(elt);
+            barStart = elt->timeStart();
+        }
+    }
+
+    for (CAPlayable* elt : barStarts) {
+        voice->insert(elt, new CABarline(CABarline::Single, this, elt->timeStart()));
+    }
+    if (!barStarts.isEmpty()) {
+        synchronizeVoices(timeStart);
+    }
+
+    return barStarts.size();
+}
+
+/*!
+	Returns the last of the time sorted \a refs starting before \a time or Null, if there is none.
+	The list is searched from the back, so the look up at the end of the staff is immediate.
+*/
+CAMusElement* CAStaff::lastRefBefore(const QList<CAMusElement*>& refs, int time)
+{
+    for (int i = refs.size() - 1; i >= 0; i--) {
+        if (refs[i]->timeStart() < time) {
+            return refs[i];
+        }
+    }
+
+    return nullptr;
+}
@@ -29,20 +29,27 @@ public:
 
     inline int numberOfLines() { return _numberOfLines; }
     inline void setNumberOfLines(int val) { _numberOfLines = val; }
+    inline bool isFrozen() { return _frozen; }
+    inline void setFrozen(bool frozen)
+    {
+        _frozen = frozen;
+        _synchronized = false;
+    }
     void clear();
     CAStaff* clone(CASheet* s);
 
     inline const QList<CAVoice*>& voiceList() { return _voiceList; }
-    inline void addVoice(CAVoice* voice) { _voiceList << voice; }
-    inline void insertVoice(int idx, CAVoice* voice) { _voiceList.insert(idx, voice); }
+    void addVoice(CAVoice* voice);
+    void insertVoice(int idx, CAVoice* voice);
     CAVoice* addVoice();
-    inline void removeVoice(CAVoice* voice) { _voiceList.removeAll(voice); }
+    void removeVoice(CAVoice* voice);
     CAVoice* findVoice(const QString name);
 
     CAMusElement* next(CAMusElement* elt);
     CAMusElement* previous(CAMusElement* elt);
     bool remove(CAMusElement* elt, bool updateSignTimes);
     bool remove(CAMusElement* elt) { return remove(elt, true); }
+    bool removeBlock(const QList<CAMusElement*>& elts, bool updateSignTimes = true);
 
     int lastTimeEnd();
     QList<CAMusElement*> getEltByType(CAMusElement::CAMusElementType type, int startTime);
@@ -51,9 +58,10 @@ public:
     QList<CAPlayable*> getChord(int time);
     CATempo* getTempo(int time);
 
-    bool synchronizeVoices();
+    bool synchronizeVoices(int timeStart = 0);
 
     static bool placeAutoBar(CAPlayable* elt);
+    int placeAutoBars(int timeStart = 0);
 
     // Functions to keep list of references of signature events for a faster look up.
     inline QList<CAMusElement*>& clefRefs() { return _clefList; }
@@ -62,9 +70,13 @@ public:
     inline QList<CAMusElement*>& barlineRefs() { return _barlineList; }
 
 private:
+    static CAMusElement* lastRefBefore(const QList<CAMusElement*>& refs, int time);
+
     QList<CAVoice*> _voiceList;
 
     int _numberOfLines;
+    bool _frozen; // the content is finished, the edits are refused and the derived data is reused
+    bool _synchronized; // the voices were synchronized, while the staff was frozen
 
     QList<CAMusElement*> _clefList;
     QList<CAMusElement*> _keySignatureList;
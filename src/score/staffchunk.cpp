@@ -0,0 +1,254 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#include "score/staffchunk.h"
+#include "score/chordnamecontext.h"
+#include "score/figuredbasscontext.h"
+#include "score/functionmarkcontext.h"
+#include "score/lyricscontext.h"
+#include "score/staff.h"
+#include "score/syllable.h"
+#include "score/voice.h"
+
+QHash<quint64, std::weak_ptr<CAStaffChunk>> CAStaffChunk::_chunks;
+int CAStaffChunk::_prunedSize = 0;
+const int CAStaffChunk::PRUNE_MIN_SIZE = 64;
+
+/*!
+	\class CAStaffChunk
+	\brief Immutable copy of a staff shared between the document snapshots
+
+	The undo history and the autosave keep snapshots of the whole document (see
+	CADocument::snapshot()). Most edits change a single staff, so consecutive snapshots would
+	mostly contain the same copies of the other staffs. Each snapshot refers to the content of its
+	staffs by a chunk instead, and the chunk of an unchanged staff is shared by all the snapshots
+	since its last change.
+
+	A chunk holds a clone of the staff which doesn't belong to any sheet and is never changed.
+	The staff is only read by restore(), so chunks can be restored from any thread. The staff is
+	unchanged, if its voices have the same generations (see CAVoice::generation()) and the same
+	properties as the ones of the chunk.
+
+	\sa CASnapshotSheetLoader
+*/
+
+/*!
+	Clones the \a staff. The lyrics contexts of the voices are left out, they are relinked by the
+	sheet loader.
+*/
+CAStaffChunk::CAStaffChunk(CAStaff* staff)
+    : _staff(staff->clone(nullptr))
+    , _elementCount(0)
+{
+    for (CAVoice* voice : _staff->voiceList()) {
+        voice->setLyricsContexts(QList<CALyricsContext*>());
+        _elementCount += voice->musElementList().size();
+    }
+}
+
+CAStaffChunk::~CAStaffChunk()
+{
+    _staff->clear();
+    delete _staff;
+}
+
+/*!
+	Returns the chunk with the current content of the \a staff. The last chunk made of the staff
+	is reused, if the staff hasn't changed since, otherwise a new one is made and \a created is set
+	to True.
+
+	Call this from the thread changing the document, usually the main thread.
+*/
+std::shared_ptr<CAStaffChunk> CAStaffChunk::fromStaff(CAStaff* staff, bool* created)
+{
+    std::shared_ptr<CAStaffChunk> chunk = _chunks.value(staff->id()).lock();
+    bool reused = (chunk && chunk->isSnapshotOf(staff));
+    if (created) {
+        *created = !reused;
+    }
+    if (reused) {
+        return chunk;
+    }
+
+    chunk = std::shared_ptr<CAStaffChunk>(new CAStaffChunk(staff)); // the constructor is private
+    _chunks[staff->id()] = chunk;
+
+    // forget the chunks of the deleted staffs and the expired history
+    if (_chunks.size() > qMax(2 * _prunedSize, PRUNE_MIN_SIZE)) {
+        for (QHash<quint64, std::weak_ptr<CAStaffChunk>>::iterator i = _chunks.begin(); i != _chunks.end();) {
+            if (i.value().expired()) {
+                i = _chunks.erase(i);
+            } else {
+                ++i;
+            }
+        }
+        _prunedSize = _chunks.size();
+    }
+
+    return chunk;
+}
+
+/*!
+	Returns True, if the chunk has the current content of the \a staff.
+*/
+bool CAStaffChunk::isSnapshotOf(CAStaff* staff) const
+{
+    if (staff->id() != _staff->id() || staff->name() != _staff->name() || staff->numberOfLines() != _staff->numberOfLines()
+        || staff->isFrozen() != _staff->isFrozen() || staff->voiceList().size() != _staff->voiceList().size()) {
+        return false;
+    }
+
+    for (int i = 0; i < staff->voiceList().size(); i++) {
+        CAVoice* voice = staff->voiceList()[i];
+        CAVoice* chunkVoice = _staff->voiceList()[i];
+        if (voice->generation() != chunkVoice->generation() || voice->name() != chunkVoice->name()
+            || voice->stemDirection() != chunkVoice->stemDirection() || voice->midiChannel() != chunkVoice->midiChannel()
+            || voice->midiProgram() != chunkVoice->midiProgram() || voice->midiPitchOffset() != chunkVoice->midiPitchOffset()
+            || voice->midiPort() != chunkVoice->midiPort()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*!
+	Returns a new staff with the content of the chunk in the given \a sheet. The staff keeps the id
+	and the voice generations of the original staff.
+*/
+CAStaff* CAStaffChunk::restore(CASheet* sheet) const
+{
+    return _staff->clone(sheet);
+}
+
+/*!
+	\class CASnapshotSheetLoader
+	\brief Content of a sheet snapshot
+
+	Loader of the unloaded sheets made by CASheet::snapshot(). The staffs are kept as shared
+	chunks (see CAStaffChunk), the other contexts are copied. Lyrics contexts and syllables refer
+	to their associated voices by the index of the staff and the voice, the voices are only
+	created when the sheet is loaded.
+
+	The loader doesn't change when loading, so it can be shared by the clones of the snapshot.
+*/
+
+/*!
+	Takes the snapshot of the current content of the \a sheet.
+*/
+CASnapshotSheetLoader::CASnapshotSheetLoader(CASheet* sheet)
+    : _newElementCount(0)
+{
+    const QList<CAContext*>& contexts = sheet->contextList();
+    QHash<CAVoice*, CAVoiceRef> voiceRefs;
+    _contexts.resize(contexts.size());
+
+    for (int i = 0; i < contexts.size(); i++) {
+        CAContextEntry& entry = _contexts[i];
+        switch (contexts[i]->contextType()) {
+        case CAContext::Staff: {
+            CAStaff* staff = static_cast<CAStaff*>(contexts[i]);
+            bool created = false;
+            entry.staff = CAStaffChunk::fromStaff(staff, &created);
+            if (created) {
+                _newElementCount += entry.staff->elementCount();
+            }
+            for (int j = 0; j < staff->voiceList().size(); j++) {
+                voiceRefs[staff->voiceList()[j]] = CAVoiceRef(i, j);
+            }
+            continue;
+        }
+        case CAContext::LyricsContext:
+            _newElementCount += static_cast<CALyricsContext*>(contexts[i])->syllableList().size();
+            break;
+        case CAContext::FunctionMarkContext:
+            _newElementCount += static_cast<CAFunctionMarkContext*>(contexts[i])->functionMarkList().size();
+            break;
+        case CAContext::FiguredBassContext:
+            _newElementCount += static_cast<CAFiguredBassContext*>(contexts[i])->figuredBassMarkList().size();
+            break;
+        case CAContext::ChordNameContext:
+            _newElementCount += static_cast<CAChordNameContext*>(contexts[i])->chordNameList().size();
+            break;
+        }
+
+        entry.context = contexts[i]->clone(nullptr);
+        entry.context->setId(contexts[i]->id());
+    }
+
+    // detach the copied lyrics from the voices of the sheet, after all the voices are known
+    for (int i = 0; i < contexts.size(); i++) {
+        if (contexts[i]->contextType() != CAContext::LyricsContext) {
+            continue;
+        }
+
+        CALyricsContext* lc = static_cast<CALyricsContext*>(_contexts[i].context);
+        _contexts[i].voice = voiceRefs.value(lc->associatedVoice(), CAVoiceRef(-1, -1));
+        lc->setAssociatedVoice(nullptr); // the clone was added to the original voice
+        lc->setSheet(nullptr);
+        for (CASyllable* syllable : lc->syllableList()) {
+            _contexts[i].syllableVoices << voiceRefs.value(syllable->associatedVoice(), CAVoiceRef(-1, -1));
+            syllable->setAssociatedVoice(nullptr);
+        }
+    }
+}
+
+CASnapshotSheetLoader::~CASnapshotSheetLoader()
+{
+    for (const CAContextEntry& entry : _contexts) {
+        if (entry.context) {
+            entry.context->clear();
+            delete entry.context;
+        }
+    }
+}
+
+/*!
+	Adds the contexts of the snapshot to the \a sheet. The staffs are restored from their chunks,
+	the other contexts are cloned and the lyrics are associated with the new voices.
+*/
+void CASnapshotSheetLoader::load(CASheet* sheet)
+{
+    QList<CAContext*> contexts;
+    for (const CAContextEntry& entry : _contexts) {
+        CAContext* context = nullptr;
+        if (entry.staff) {
+            context = entry.staff->restore(sheet);
+        } else {
+            context = entry.context->clone(sheet);
+            context->setId(entry.context->id());
+            context->setSheet(sheet); // lyrics contexts take the sheet of the copy
+        }
+        contexts << context;
+        sheet->addContext(context);
+    }
+
+    for (int i = 0; i < contexts.size(); i++) {
+        if (contexts[i]->contextType() != CAContext::LyricsContext) {
+            continue;
+        }
+
+        CALyricsContext* lc = static_cast<CALyricsContext*>(contexts[i]);
+        for (int j = 0; j < lc->syllableList().size() && j < _contexts[i].syllableVoices.size(); j++) {
+            lc->syllableList()[j]->setAssociatedVoice(voice(contexts, _contexts[i].syllableVoices[j]));
+        }
+        lc->setAssociatedVoice(voice(contexts, _contexts[i].voice)); // also reposits the syllables
+    }
+}
+
+/*!
+	Returns the voice referred by \a ref in the given \a contexts or nullptr, if there is none.
+*/
+CAVoice* CASnapshotSheetLoader::voice(const QList<CAContext*>& contexts, const CAVoiceRef& ref)
+{
+    if (ref.first < 0 || ref.first >= contexts.size() || contexts[ref.first]->contextType() != CAContext::Staff) {
+        return nullptr;
+    }
+
+    const QList<CAVoice*>& voices = static_cast<CAStaff*>(contexts[ref.first])->voiceList();
+    return (ref.second >= 0 && ref.second < voices.size() ? voices[ref.second] : nullptr);
+}
@@ -0,0 +1,73 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#ifndef STAFFCHUNK_H_
+#define STAFFCHUNK_H_
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QVector>
+
+#include <memory>
+
+#include "score/sheet.h"
+
+class CAContext;
+class CAStaff;
+class CAVoice;
+
+class CAStaffChunk {
+public:
+    ~CAStaffChunk();
+    static std::shared_ptr<CAStaffChunk> fromStaff(CAStaff* staff, bool* created = nullptr);
+
+    bool isSnapshotOf(CAStaff* staff) const;
+    CAStaff* restore(CASheet* sheet) const;
+    inline int elementCount() const { return _elementCount; }
+
+private:
+    CAStaffChunk(CAStaff* staff);
+    CAStaffChunk(const CAStaffChunk&);
+    CAStaffChunk& operator=(const CAStaffChunk&);
+
+    CAStaff* _staff; // detached clone of the staff, never changed
+    int _elementCount; // music elements of all the voices
+
+    static QHash<quint64, std::weak_ptr<CAStaffChunk>> _chunks; // the last chunk made of each staff, by the staff id
+    static int _prunedSize; // number of chunks after the expired ones were last removed from _chunks
+    static const int PRUNE_MIN_SIZE;
+};
+
+class CASnapshotSheetLoader : public CASheetLoader {
+public:
+    CASnapshotSheetLoader(CASheet* sheet);
+    ~CASnapshotSheetLoader();
+
+    void load(CASheet* sheet);
+    inline int newElementCount() const { return _newElementCount; }
+
+private:
+    CASnapshotSheetLoader(const CASnapshotSheetLoader&);
+    CASnapshotSheetLoader& operator=(const CASnapshotSheetLoader&);
+
+    typedef QPair<int, int> CAVoiceRef; // index of the staff in the context list and of the voice in the staff, -1 if none
+
+    struct CAContextEntry {
+        std::shared_ptr<CAStaffChunk> staff; // content of the staff, shared with the other snapshots
+        CAContext* context = nullptr; // detached copy of the other contexts, owned by the loader
+        CAVoiceRef voice = CAVoiceRef(-1, -1); // associated voice of the lyrics context
+        QVector<CAVoiceRef> syllableVoices; // associated voices of the syllables of the lyrics context
+    };
+
+    static CAVoice* voice(const QList<CAContext*>& contexts, const CAVoiceRef& ref);
+
+    QVector<CAContextEntry> _contexts; // in the order of the sheet's context list
+    int _newElementCount; // music elements of the chunks made for this snapshot and of the copied contexts
+};
+
+#endif /* STAFFCHUNK_H_ */
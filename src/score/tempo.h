@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2007-2019, Matevž Jekovec, Canorus development team
+	Copyright (c) 2007-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -20,9 +20,19 @@ public:
     int compare(CAMusElement* elt);
 
     inline unsigned char bpm() { return _bpm; }
-    inline void setBpm(unsigned char bpm) { _bpm = bpm; }
+    inline void setBpm(unsigned char bpm)
+    {
+        _bpm = bpm;
+        tempoMarkChanged(this);
+        contentChanged();
+    }
     inline CAPlayableLength beat() { return _beat; }
-    inline void setBeat(CAPlayableLength l) { _beat = l; }
+    inline void setBeat(CAPlayableLength l)
+    {
+        _beat = l;
+        tempoMarkChanged(this);
+        contentChanged();
+    }
 
 private:
     CAPlayableLength _beat;
@@ -17,7 +17,11 @@ public:
     virtual ~CAText();
 
     inline const QString text() { return _text; }
-    inline void setText(const QString t) { _text = t; }
+    inline void setText(const QString t)
+    {
+        _text = t;
+        contentChanged();
+    }
 
     CAText* clone(CAMusElement* elt = nullptr);
     int compare(CAMusElement* elt);
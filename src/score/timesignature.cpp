@@ -66,7 +66,7 @@ CATimeSignature::~CATimeSignature()
 
 CATimeSignature* CATimeSignature::clone(CAContext* context)
 {
-    CATimeSignature* t = new CATimeSignature(_beats, _beat, static_cast<CAStaff*>(context), _timeStart, _timeSignatureType);
+    CATimeSignature* t = new CATimeSignature(_beats, _beat, static_cast<CAStaff*>(context), timeStart(), _timeSignatureType);
 
     for (int i = 0; i < markList().size(); i++) {
         CAMark* m = static_cast<CAMark*>(markList()[i]->clone(t));
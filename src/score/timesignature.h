@@ -32,10 +32,18 @@ public:
     CAStaff* staff() { return static_cast<CAStaff*>(context()); }
 
     int beats() { return _beats; }
-    void setBeats(int beats) { _beats = beats; }
+    void setBeats(int beats)
+    {
+        _beats = beats;
+        contentChanged();
+    }
 
     int beat() { return _beat; }
-    void setBeat(int beat) { _beat = beat; }
+    void setBeat(int beat)
+    {
+        _beat = beat;
+        contentChanged();
+    }
 
     int barDuration();
 
@@ -10,6 +10,22 @@
 #include "score/voice.h"
 #include <iostream> // debug
 
+namespace {
+
+/*!
+	Returns \a time scaled by \a actualNumber / \a number rounded to the nearest tick. The ratio
+	is applied in integer arithmetic, so each time is rounded exactly once and the rounding errors
+	of the members don't accumulate.
+*/
+int tupletTime(int time, int actualNumber, int number)
+{
+    qint64 scaled = static_cast<qint64>(time) * actualNumber * 2;
+    qint64 divisor = static_cast<qint64>(number) * 2;
+    return static_cast<int>(scaled >= 0 ? (scaled + number) / divisor : -((-scaled + number) / divisor));
+}
+
+}
+
 /*!
 	\class CATuplet
 	\brief Class used for tuplets (triplets, duols etc.)
@@ -173,6 +189,10 @@ void CATuplet::assignNoteSlurs(QList<QList<CASlur*>> noteSlurs)
  */
 void CATuplet::assignTimes()
 {
+    if (assignTimesInPlace()) {
+        return;
+    }
+
     resetTimes();
 
     CAVoice* voice = noteList().front()->voice();
@@ -192,8 +212,9 @@ void CATuplet::assignTimes()
         voice->remove(noteList()[i]);
     }
 
+    int timeEnd = firstNote()->timeStart() + tupletTime(noteList().back()->timeEnd() - firstNote()->timeStart(), actualNumber(), number());
     for (int i = 0; i < noteList().size(); i++) {
-        noteList()[i]->setTimeStart(qRound(firstNote()->timeStart() + (noteList()[i]->timeStart() - firstNote()->timeStart()) * (static_cast<float>(actualNumber()) / number())));
+        noteList()[i]->setTimeStart(firstNote()->timeStart() + tupletTime(noteList()[i]->timeStart() - firstNote()->timeStart(), actualNumber(), number()));
     }
 
     for (int i = 0; i < noteList().size(); i++) {
@@ -201,11 +222,7 @@ void CATuplet::assignTimes()
         while (j < noteList().size() && (noteList()[j]->timeStart() == noteList()[i]->timeStart())) {
             j++;
         }
-        if (j < noteList().size()) {
-            noteList()[i]->setTimeLength(noteList()[j]->timeStart() - noteList()[i]->timeStart());
-        } else {
-            noteList()[i]->setTimeLength(qRound(CAPlayableLength::playableLengthToTimeLength(noteList()[i]->playableLength()) * (static_cast<float>(actualNumber()) / number())));
-        }
+        noteList()[i]->setTimeLength((j < noteList().size() ? noteList()[j]->timeStart() : timeEnd) - noteList()[i]->timeStart());
     }
 
     // adds notes back to the voice
@@ -232,6 +249,88 @@ void CATuplet::assignTimes()
     }
 }
 
+/*!
+	Computes the tuplet-affected times directly from the playable lengths of the members and
+	applies them without removing the members from the voice. The elements after the tuplet are
+	shifted once by the change of the tuplet length using the time segments of the voice.
+
+	This is only possible when the members are consecutive elements of the voice, which is the
+	usual case. Returns False without changing anything otherwise, and assignTimes() falls back
+	to removing and reinserting the members.
+*/
+bool CATuplet::assignTimesInPlace()
+{
+    if (noteList().isEmpty() || !number())
+        return false;
+
+    CAVoice* voice = noteList().front()->voice();
+    int n = noteList().size();
+    int idx = voice ? voice->eltIndex(noteList().front()) : -1;
+    if (idx == -1 || idx + n > voice->musElementList().size())
+        return false;
+
+    for (int i = 0; i < n; i++) {
+        if (voice->musElementList()[idx + i] != noteList()[i])
+            return false;
+    }
+
+    // untupleted start offsets of the chords from the first one scaled by the tuplet ratio
+    int timeStart = noteList().front()->timeStart();
+    int offset = 0;
+    QVector<int> starts(n);
+    for (int i = 0; i < n;) {
+        int j = i;
+        for (; j < n && noteList()[j]->timeStart() == noteList()[i]->timeStart(); j++) { // chord..
+            starts[j] = timeStart + tupletTime(offset, actualNumber(), number());
+        }
+
+        offset += CAPlayableLength::playableLengthToTimeLength(noteList()[j - 1]->playableLength());
+        i = j;
+    }
+    int timeEnd = timeStart + tupletTime(offset, actualNumber(), number()); // exact end of the whole tuplet
+
+    int oldTimeEnd = noteList().back()->timeEnd();
+    for (int i = 0; i < n; i++) {
+        int j = i + 1;
+        for (; j < n && starts[j] == starts[i]; j++)
+            ;
+
+        CAPlayable* p = noteList()[i];
+        voice->updateTime(p, starts[i] - p->timeStart()); // marks follow the note
+        p->setTimeLength((j < n ? starts[j] : timeEnd) - starts[i]);
+    }
+
+    int delta = noteList().back()->timeEnd() - oldTimeEnd;
+    if (delta) {
+        voice->updateTimes(idx + n, delta, true);
+    }
+
+    // slurs and phrasing slurs keep their length from the start note, as in assignNoteSlurs()
+    for (int i = 0; i < n; i++) {
+        if (noteList()[i]->musElementType() != Note)
+            continue;
+
+        CANote* note = static_cast<CANote*>(noteList()[i]);
+        if (note->slurStart())
+            note->slurStart()->setTimeStart(note->timeStart());
+        if (note->slurEnd())
+            note->slurEnd()->setTimeLength(note->timeStart() - note->slurEnd()->noteStart()->timeStart());
+        if (note->phrasingSlurStart())
+            note->phrasingSlurStart()->setTimeStart(note->timeStart());
+        if (note->phrasingSlurEnd())
+            note->phrasingSlurEnd()->setTimeLength(note->timeStart() - note->phrasingSlurEnd()->noteStart()->timeStart());
+    }
+
+    setTimeLength(noteList().last()->timeEnd() - noteList().front()->timeStart());
+
+    for (int i = 0; i < n; i++) {
+        noteList()[i]->setTuplet(this);
+    }
+    setContext(noteList()[0]->context());
+
+    return true;
+}
+
 /*!
 	Resets the notes times back to their original values before
 	placing the tuplet.
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2008, Matevž Jekovec, Canorus development team
+	Copyright (c) 2008-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -25,10 +25,18 @@ public:
     int compare(CAMusElement*);
 
     inline int number() { return _number; }
-    inline void setNumber(int n) { _number = n; }
+    inline void setNumber(int n)
+    {
+        _number = n;
+        contentChanged();
+    }
 
     inline int actualNumber() { return _actualNumber; }
-    inline void setActualNumber(int n) { _actualNumber = n; }
+    inline void setActualNumber(int n)
+    {
+        _actualNumber = n;
+        contentChanged();
+    }
 
     inline const QList<CAPlayable*>& noteList() const { return _noteList; }
     void addNote(CAPlayable* p);
@@ -45,6 +53,7 @@ public:
     void assignTimes();
 
 private:
+    bool assignTimesInPlace();
     void resetTimes();
     QList<QList<CASlur*>> getNoteSlurs();
     void assignNoteSlurs(QList<QList<CASlur*>>);
@@ -5,6 +5,11 @@
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
 */
 
+#include <QSet>
+
+#include <algorithm>
+#include <limits>
+
 #include "score/voice.h"
 #include "interface/mididevice.h"
 #include "score/clef.h"
@@ -15,11 +20,15 @@
 #include "score/note.h"
 #include "score/playable.h"
 #include "score/rest.h"
+#include "score/sheet.h"
 #include "score/slur.h"
 #include "score/staff.h"
 #include "score/tempo.h"
 #include "score/timesignature.h"
 
+const int CAVoice::TIME_SEGMENT_SIZE = 128;
+std::atomic<quint64> CAVoice::_lastGeneration(0);
+
 /*!
 	\class CAVoice
 	\brief Class which represents a voice in the staff.
@@ -27,6 +36,16 @@
 	CAVoice is a class which holds music elements in the staff. In hieararchy, staff
 	includes multiple voices and every voice includes multiple music elements.
 
+	Music elements are sorted by their start time, so time based queries use binary search
+	on the music element list. Positions of clefs, key signatures, time signatures and barlines
+	are additionally kept in a per-type index which is rebuilt on demand after the music element
+	list changes.
+
+	Long voices are split into time segments of consecutive music elements. Start times of notes
+	and rests are stored relative to their segment offset, so shifting the elements after an
+	insertion or removal only touches the current segment, the segment offsets and the signs.
+	See updateTimes().
+
 	\sa CAStaff, CAMusElement
 */
 
@@ -43,6 +62,9 @@ CAVoice::CAVoice(const QString name, CAStaff* staff, CANote::CAStemDirection ste
     _midiChannel = ((staff && staff->sheet()) ? CAMidiDevice::freeMidiChannel(staff->sheet()) : 0);
     _midiProgram = 0;
     _midiPitchOffset = 0;
+
+    _typeIndexDirty = true;
+    updateGeneration();
 }
 
 /*!
@@ -66,7 +88,8 @@ CAVoice::~CAVoice()
 }
 
 /*!
-	Clones the current voice including all the music elements.
+	Clones the properties of the current voice without the music elements, which are cloned by
+	CAStaff::clone() together with the elements shared by the voices.
 	Sets the voice staff to \a newStaff. If none given, use the original staff.
 */
 CAVoice* CAVoice::clone(CAStaff* newStaff)
@@ -89,6 +112,7 @@ void CAVoice::cloneVoiceProperties(CAVoice* voice)
     setMidiChannel(voice->midiChannel());
     setMidiProgram(voice->midiProgram());
     setMidiPitchOffset(voice->midiPitchOffset());
+    setMidiPort(voice->midiPort());
     setLyricsContexts(voice->lyricsContextList());
 }
 
@@ -105,8 +129,9 @@ void CAVoice::clear()
         if (_musElementList.front()->isPlayable() || (staff() && staff()->voiceList().size() < 2))
             delete _musElementList.front(); // CAMusElement's destructor removes it from the list
         else
-            _musElementList.removeFirst();
+            removeAt(0);
     }
+    clearTimeSegments();
 }
 
 /*!
@@ -135,6 +160,32 @@ void CAVoice::append(CAMusElement* elt, bool addToChord)
     }
 }
 
+/*!
+	Appends the notes of the given \a pitches and \a lengths at the end of the voice one after
+	another. Both lists should be of the same size, extra items are ignored.
+
+	This is used by the scripting languages which would otherwise create and append each note by a
+	separate call. Returns the list of the created notes.
+
+	\sa append()
+*/
+QList<CANote*> CAVoice::appendNotes(const QList<CADiatonicPitch>& pitches, const QList<CAPlayableLength>& lengths)
+{
+    int n = qMin(pitches.size(), lengths.size());
+    QList<CANote*> notes;
+    notes.reserve(n);
+
+    int timeStart = lastTimeEnd();
+    for (int i = 0; i < n; i++) {
+        CANote* note = new CANote(pitches[i], lengths[i], this, timeStart);
+        insertMusElement(nullptr, note);
+        timeStart = note->timeEnd();
+        notes << note;
+    }
+
+    return notes;
+}
+
 /*!
 	Adds the given element \a elt to the voice before the given \a eltAfter. If \a eltAfter is null,
 	the element is appended.
@@ -173,7 +224,7 @@ bool CAVoice::insert(CAMusElement* eltAfter, CAMusElement* elt, bool addToChord)
 
         // calculate note positions in staff when inserting a new clef
         if (elt->musElementType() == CAMusElement::Clef) {
-            for (int i = musElementList().indexOf(elt) + 1; i < musElementList().size(); i++) {
+            for (int i = eltIndex(elt) + 1; i < musElementList().size(); i++) {
                 if (musElementList()[i]->musElementType() == CAMusElement::Note)
                     static_cast<CANote*>(musElementList()[i])->setDiatonicPitch(static_cast<CANote*>(musElementList()[i])->diatonicPitch());
             }
@@ -191,12 +242,69 @@ bool CAVoice::insert(CAMusElement* eltAfter, CAMusElement* elt, bool addToChord)
 
         elt->setTimeStart(eltAfter ? (eltAfter->timeStart()) : lastTimeEnd());
         res = insertMusElement(eltAfter, elt);
-        updateTimes(musElementList().indexOf(elt) + 1, elt->timeLength(), true);
+        updateTimes(eltIndex(elt) + 1, elt->timeLength(), true);
     }
 
     return res;
 }
 
+/*!
+	Inserts the music elements \a elts before the given \a eltAfter or appends them, if \a eltAfter
+	is Null. The elements keep their relative start times, so notes sharing the start time form
+	chords like in the voice they were cloned from.
+
+	Unlike calling insert() for each element, the block is spliced into the music element list at
+	once and the following elements are shifted only once by the total length of the block. This is
+	used for pasting and importing.
+
+	Returns True, if \a eltAfter was found and the elements were inserted; otherwise False.
+
+	\note Voices are NOT synchronized. User should manually call CAStaff::synchronizeVoices().
+
+	\sa insert()
+*/
+bool CAVoice::insertBlock(CAMusElement* eltAfter, const QList<CAMusElement*>& elts)
+{
+    if (elts.isEmpty())
+        return true;
+
+    int idx = (eltAfter ? eltIndex(eltAfter) : _musElementList.size());
+    if (idx == -1)
+        return false;
+
+    int blockStart = elts.first()->timeStart();
+    int blockEnd = blockStart;
+    bool clefs = false;
+    for (int i = 0; i < elts.size(); i++) {
+        blockEnd = qMax(blockEnd, elts[i]->timeEnd());
+        clefs |= (elts[i]->musElementType() == CAMusElement::Clef);
+    }
+
+    int offset = (eltAfter ? eltAfter->timeStart() : lastTimeEnd()) - blockStart;
+    updateTimes(idx, blockEnd - blockStart, true); // make space for the block
+
+    for (int i = 0; i < elts.size(); i++) {
+        elts[i]->setTimeStart(elts[i]->timeStart() + offset);
+    }
+
+    insertRangeAt(idx, elts);
+    for (int i = 0; i < elts.size(); i++) {
+        if (isIndexedType(elts[i]->musElementType())) {
+            addToStaffRefs(elts[i]);
+        }
+    }
+
+    // calculate note positions in staff after the new clefs
+    if (clefs) {
+        for (int i = idx; i < _musElementList.size(); i++) {
+            if (_musElementList[i]->musElementType() == CAMusElement::Note)
+                static_cast<CANote*>(_musElementList[i])->setDiatonicPitch(static_cast<CANote*>(_musElementList[i])->diatonicPitch());
+        }
+    }
+
+    return true;
+}
+
 /*!
 	Inserts a note/rest in a tuplet/voice. If the result should not be a chord the element
 	found will be deleted and replaced. This function probably should also work for non
@@ -244,57 +352,60 @@ CAPlayable* CAVoice::insertInTupletAndVoiceAt(CAPlayable* reference, CAPlayable*
 	Returns a pointer to the clef which the given \a elt belongs to.
 	Returns nullptr, if no clefs placed yet.
 
-	Warning! This operation is slow (linear time), but always returns the
+	The lookup uses the clef index and always returns the
 	correct clef depending on the order of the musElementList. If a timeBased
 	result suffices, use CAStaff::getClef(time).
 */
 CAClef* CAVoice::getClef(CAMusElement* elt)
 {
-    if (!elt || !musElementList().contains(elt))
-        elt = lastMusElement();
+    int idx = eltIndex(elt);
+    if (idx == -1)
+        idx = musElementList().size() - 1;
 
-    while (elt && (elt->musElementType() != CAMusElement::Clef) && (elt = previous(elt)))
-        ;
+    const QVector<int>& positions = typeIndex(CAMusElement::Clef);
+    QVector<int>::const_iterator it = std::upper_bound(positions.constBegin(), positions.constEnd(), idx);
 
-    return static_cast<CAClef*>(elt);
+    return (it == positions.constBegin() ? nullptr : static_cast<CAClef*>(_musElementList[*(--it)]));
 }
 
 /*!
 	Returns a pointer to the time signature which the given \a elt belongs to.
 	Returns nullptr, if no time signatures placed yet.
 
-	Warning! This operation is slow (linear time), but always returns the
+	The lookup uses the time signature index and always returns the
 	correct timeSig depending on the order of the musElementList. If a timeBased
 	result suffices, use CAStaff::getClef(time).
 */
 CATimeSignature* CAVoice::getTimeSig(CAMusElement* elt)
 {
-    if (!elt || !musElementList().contains(elt))
-        elt = lastMusElement();
+    int idx = eltIndex(elt);
+    if (idx == -1)
+        idx = musElementList().size() - 1;
 
-    while (elt && (elt->musElementType() != CAMusElement::TimeSignature) && (elt = previous(elt)))
-        ;
+    const QVector<int>& positions = typeIndex(CAMusElement::TimeSignature);
+    QVector<int>::const_iterator it = std::upper_bound(positions.constBegin(), positions.constEnd(), idx);
 
-    return static_cast<CATimeSignature*>(elt);
+    return (it == positions.constBegin() ? nullptr : static_cast<CATimeSignature*>(_musElementList[*(--it)]));
 }
 
 /*!
 	Returns a pointer to the key signature which the given \a elt belongs to.
 	Returns nullptr, if no key signatures placed yet.
 
-	Warning! This operation is slow (linear time), but always returns the
+	The lookup uses the key signature index and always returns the
 	correct keySig depending on the order of the musElementList. If a timeBased
 	result suffices, use CAStaff::getClef(time).
 */
 CAKeySignature* CAVoice::getKeySig(CAMusElement* elt)
 {
-    if (!elt || !musElementList().contains(elt))
-        elt = lastMusElement();
+    int idx = eltIndex(elt);
+    if (idx == -1)
+        idx = musElementList().size() - 1;
 
-    while (elt && (elt->musElementType() != CAMusElement::KeySignature) && (elt = previous(elt)))
-        ;
+    const QVector<int>& positions = typeIndex(CAMusElement::KeySignature);
+    QVector<int>::const_iterator it = std::upper_bound(positions.constBegin(), positions.constEnd(), idx);
 
-    return static_cast<CAKeySignature*>(elt);
+    return (it == positions.constBegin() ? nullptr : static_cast<CAKeySignature*>(_musElementList[*(--it)]));
 }
 
 /*!
@@ -314,10 +425,13 @@ CAKeySignature* CAVoice::getKeySig(CAMusElement* elt)
 */
 bool CAVoice::remove(CAMusElement* elt, bool updateSigns)
 {
-    if (_musElementList.contains(elt)) { // if the search element is found
+    if (eltIndex(elt) != -1) { // if the search element is found
         if (!elt->isPlayable() && staff()) { // element is shared - remove it from all the voices
             for (int i = 0; i < staff()->voiceList().size(); i++) {
-                staff()->voiceList()[i]->_musElementList.removeAll(elt);
+                int idx = staff()->voiceList()[i]->eltIndex(elt);
+                if (idx != -1) {
+                    staff()->voiceList()[i]->removeAt(idx);
+                }
             }
             // remove it from the references list
             if (elt->musElementType() == CAMusElement::KeySignature)
@@ -334,40 +448,17 @@ bool CAVoice::remove(CAMusElement* elt, bool updateSigns)
                 CANote* n = static_cast<CANote*>(elt);
                 if (n->isPartOfChord() && n->isFirstInChord()) {
                     // if the note is the first in the chord, the slurs and marks should be relinked to the 2nd in the chord
-                    CANote* prevNote = n->getChord().at(1);
-                    prevNote->setSlurStart(n->slurStart());
-                    prevNote->setSlurEnd(n->slurEnd());
-                    prevNote->setPhrasingSlurStart(n->phrasingSlurStart());
-                    prevNote->setPhrasingSlurEnd(n->phrasingSlurEnd());
-
-                    for (int i = 0; i < n->markList().size(); i++) {
-                        if (n->markList()[i]->isCommon()) {
-                            prevNote->addMark(n->markList()[i]);
-                            n->markList()[i]->setAssociatedElement(prevNote);
-                            n->removeMark(n->markList()[i--]);
-                        }
-                    }
+                    relinkChord(n, n->getChord().at(1));
                 } else if (!(n->isPartOfChord())) {
-                    if (n->slurStart())
-                        delete n->slurStart();
-                    if (n->slurEnd())
-                        delete n->slurEnd();
-                    if (n->phrasingSlurStart())
-                        delete n->phrasingSlurStart();
-                    if (n->phrasingSlurEnd())
-                        delete n->phrasingSlurEnd();
-                    if (n->tuplet())
-                        delete n->tuplet();
-
-                    updateTimes(musElementList().indexOf(elt) + 1, elt->timeLength() * (-1), updateSigns); // shift back timeStarts of playable elements after it
+                    removeLinks(n);
+                    updateTimes(eltIndex(elt) + 1, elt->timeLength() * (-1), updateSigns); // shift back timeStarts of playable elements after it
                 }
             } else {
-                if (elt->isPlayable() && static_cast<CAPlayable*>(elt)->tuplet())
-                    delete static_cast<CAPlayable*>(elt)->tuplet();
-                updateTimes(musElementList().indexOf(elt) + 1, elt->timeLength() * (-1), updateSigns); // shift back timeStarts of playable elements after it
+                removeLinks(static_cast<CAPlayable*>(elt));
+                updateTimes(eltIndex(elt) + 1, elt->timeLength() * (-1), updateSigns); // shift back timeStarts of playable elements after it
             }
 
-            _musElementList.removeAll(elt); // removes the element from the voice music element list
+            removeAt(eltIndex(elt)); // removes the element from the voice music element list
         }
 
         return true;
@@ -376,6 +467,140 @@ bool CAVoice::remove(CAMusElement* elt, bool updateSigns)
     }
 }
 
+/*!
+	Removes the notes and rests \a elts from this voice at once. Non-playable elements are removed
+	one by one by remove(). The removed notes and rests are detached from the voice, but not
+	destroyed.
+
+	Unlike calling remove() for each element, the music element list is compacted in one pass and
+	each following element is shifted once by the total length removed before it. The slurs,
+	marks and tuplets are unlinked as in remove(): a chord is shortened only when all its notes
+	are removed, otherwise they are moved to the first remaining note. This is used for deleting
+	large selections.
+
+	If \a updateSignsTimes is True, the shared signs are shifted as well.
+
+	Returns True, if any element was removed; otherwise False.
+
+	\note Voices are NOT synchronized. User should manually call CAStaff::synchronizeVoices().
+
+	\sa remove(), insertBlock()
+*/
+bool CAVoice::removeBlock(const QList<CAMusElement*>& elts, bool updateSignsTimes)
+{
+    QSet<CAMusElement*> removed;
+    for (CAMusElement* elt : elts) {
+        if (!elt->isPlayable()) {
+            remove(elt, updateSignsTimes);
+        } else if (static_cast<CAPlayable*>(elt)->voice() == this) {
+            removed.insert(elt);
+        }
+    }
+
+    if (removed.isEmpty()) {
+        return false;
+    }
+
+    // unlink the elements and gather the ones whose length is removed, one per chord
+    QSet<CAMusElement*> shortening;
+    int timeStart = std::numeric_limits<int>::max();
+    for (CAMusElement* elt : elts) {
+        if (!removed.contains(elt)) {
+            continue;
+        }
+
+        timeStart = qMin(timeStart, elt->timeStart());
+        if (elt->musElementType() == CAMusElement::Note && static_cast<CANote*>(elt)->isPartOfChord()) {
+            CANote* n = static_cast<CANote*>(elt);
+            if (!n->isFirstInChord()) {
+                continue; // the chord is handled by its first note
+            }
+
+            CANote* heir = nullptr;
+            for (CANote* note : n->getChord()) {
+                if (!removed.contains(note)) {
+                    heir = note;
+                    break;
+                }
+            }
+
+            if (heir) {
+                relinkChord(n, heir);
+                continue;
+            }
+        }
+
+        removeLinks(static_cast<CAPlayable*>(elt));
+        shortening.insert(elt);
+    }
+
+    clearTimeSegments();
+
+    QList<CAMusElement*> list;
+    list.reserve(_musElementList.size() - removed.size());
+    int length = 0;
+    for (CAMusElement* elt : _musElementList) {
+        if (removed.contains(elt)) {
+            if (shortening.contains(elt)) {
+                length += elt->timeLength();
+            }
+            static_cast<CAPlayable*>(elt)->setVoice(nullptr); // so destroying it doesn't look for it again
+        } else {
+            if (length && (updateSignsTimes || elt->isPlayable())) {
+                updateTime(elt, -length);
+            }
+            list << elt;
+        }
+    }
+
+    _musElementList = list;
+    invalidateTypeIndex();
+    invalidateSheetIndices(timeStart);
+
+    return true;
+}
+
+/*!
+	Moves the slurs and the common marks of the removed first note \a n of the chord to the note
+	\a heir of the same chord.
+*/
+void CAVoice::relinkChord(CANote* n, CANote* heir)
+{
+    heir->setSlurStart(n->slurStart());
+    heir->setSlurEnd(n->slurEnd());
+    heir->setPhrasingSlurStart(n->phrasingSlurStart());
+    heir->setPhrasingSlurEnd(n->phrasingSlurEnd());
+
+    for (int i = 0; i < n->markList().size(); i++) {
+        if (n->markList()[i]->isCommon()) {
+            heir->addMark(n->markList()[i]);
+            n->markList()[i]->setAssociatedElement(heir);
+            n->removeMark(n->markList()[i--]);
+        }
+    }
+}
+
+/*!
+	Destroys the slurs and the tuplet of the removed note or rest \a p.
+*/
+void CAVoice::removeLinks(CAPlayable* p)
+{
+    if (p->musElementType() == CAMusElement::Note) {
+        CANote* n = static_cast<CANote*>(p);
+        if (n->slurStart())
+            delete n->slurStart();
+        if (n->slurEnd())
+            delete n->slurEnd();
+        if (n->phrasingSlurStart())
+            delete n->phrasingSlurStart();
+        if (n->phrasingSlurEnd())
+            delete n->phrasingSlurEnd();
+    }
+
+    if (p->tuplet())
+        delete p->tuplet();
+}
+
 /*!
 	Inserts the \a elt before the given \a eltAfter. If \a eltAfter is Null, it
 	appends the element.
@@ -385,13 +610,13 @@ bool CAVoice::remove(CAMusElement* elt, bool updateSigns)
 bool CAVoice::insertMusElement(CAMusElement* eltAfter, CAMusElement* elt)
 {
     if (!eltAfter || !_musElementList.size()) {
-        _musElementList.push_back(elt);
+        insertAt(_musElementList.size(), elt);
     } else {
-        int i = musElementList().indexOf(eltAfter);
+        int i = eltIndex(eltAfter);
 
         // if element wasn't found and the element before is slur
         if (eltAfter->musElementType() == CAMusElement::Slur && i == -1)
-            i = musElementList().indexOf(static_cast<CASlur*>(eltAfter)->noteEnd());
+            i = eltIndex(static_cast<CASlur*>(eltAfter)->noteEnd());
 
         if (i == -1) {
             // eltBefore still wasn't found, return False
@@ -399,13 +624,25 @@ bool CAVoice::insertMusElement(CAMusElement* eltAfter, CAMusElement* elt)
         }
 
         // eltBefore found, insert it
-        _musElementList.insert(i, elt);
+        insertAt(i, elt);
     }
 
-    CAMusElement* next = nextByType(elt->musElementType(), elt);
+    addToStaffRefs(elt);
+
+    return true;
+}
+
+/*!
+	Adds the sign  elt to the reference list of its type in the staff, if it isn't there yet.
+	It is put before the next sign of the same type in this voice.
+
+	Signs appended in time order, which is the case when importing or generating the score, are
+	recognized by only looking at the end of the reference list.
+*/
+void CAVoice::addToStaffRefs(CAMusElement* elt)
+{
     QList<CAMusElement*>* refs = nullptr;
 
-    // update staff references
     if (elt->musElementType() == CAMusElement::KeySignature) {
         refs = &staff()->keySignatureRefs();
     } else if (elt->musElementType() == CAMusElement::TimeSignature) {
@@ -416,19 +653,32 @@ bool CAVoice::insertMusElement(CAMusElement* eltAfter, CAMusElement* elt)
         refs = &staff()->barlineRefs();
     }
 
-    if (refs) {
-        int idxInRefs = refs->indexOf(next);
-        if (idxInRefs == -1) {
-            // we want to append the element
-            idxInRefs = refs->size();
-        }
+    if (!refs) {
+        return;
+    }
 
-        if (!refs->contains(elt)) {
-            refs->insert(idxInRefs, elt);
+    CAMusElement* next = nextByType(elt->musElementType(), elt);
+    if (!next && (refs->isEmpty() || refs->last()->timeStart() <= elt->timeStart())) {
+        // appended sign, only the signs at the same time can be the shared one
+        for (int i = refs->size() - 1; i >= 0 && refs->at(i)->timeStart() == elt->timeStart(); i--) {
+            if (refs->at(i) == elt) {
+                return;
+            }
         }
+
+        refs->append(elt);
+        return;
     }
 
-    return true;
+    int idxInRefs = refs->indexOf(next);
+    if (idxInRefs == -1) {
+        // we want to append the element
+        idxInRefs = refs->size();
+    }
+
+    if (!refs->contains(elt)) {
+        refs->insert(idxInRefs, elt);
+    }
 }
 
 /*!
@@ -447,19 +697,19 @@ bool CAVoice::insertMusElement(CAMusElement* eltAfter, CAMusElement* elt)
 */
 bool CAVoice::addNoteToChord(CANote* note, CANote* referenceNote)
 {
-    int idx = _musElementList.indexOf(referenceNote);
+    int idx = eltIndex(referenceNote);
 
     if (idx == -1)
         return false;
 
     QList<CANote*> chord = referenceNote->getChord();
-    idx = _musElementList.indexOf(chord.first());
+    idx = eltIndex(chord.first());
 
     int i;
     for (i = 0; i < chord.size() && chord[i]->diatonicPitch().noteName() < note->diatonicPitch().noteName(); i++)
         ;
 
-    _musElementList.insert(idx + i, note);
+    insertAt(idx + i, note);
     note->setPlayableLength(referenceNote->playableLength());
     note->setTimeLength(referenceNote->timeLength());
     note->setTimeStart(referenceNote->timeStart());
@@ -550,6 +800,101 @@ bool CAVoice::binarySearch_startTime(int time, int& position)
     return false;
 }
 
+/*!
+	Returns the index of the given music element \a elt in the music element list or -1, if the
+	element is not part of this voice.
+
+	The element is first searched among the elements sharing its start time. If the music element
+	list is not sorted at the moment (eg. while the staff is being synchronized), the whole list is
+	searched.
+*/
+int CAVoice::eltIndex(CAMusElement* elt)
+{
+    if (!elt)
+        return -1;
+
+    for (int i = lowerBound(elt->timeStart()); i < _musElementList.size() && _musElementList[i]->timeStart() == elt->timeStart(); i++) {
+        if (_musElementList[i] == elt)
+            return i;
+    }
+
+    return _musElementList.indexOf(elt);
+}
+
+/*!
+	Returns the index of the first music element in the time sorted \a list which starts at or
+	after the given \a time. Returns the size of the list, if no such element exists.
+*/
+int CAVoice::lowerBound(const QList<CAMusElement*>& list, int time)
+{
+    return static_cast<int>(std::lower_bound(list.constBegin(), list.constEnd(), time,
+                                [](CAMusElement* elt, int t) { return elt->timeStart() < t; })
+        - list.constBegin());
+}
+
+/*!
+	Returns the index of the first music element in the time sorted \a list which starts strictly
+	after the given \a time. Returns the size of the list, if no such element exists.
+*/
+int CAVoice::upperBound(const QList<CAMusElement*>& list, int time)
+{
+    return static_cast<int>(std::upper_bound(list.constBegin(), list.constEnd(), time,
+                                [](int t, CAMusElement* elt) { return t < elt->timeStart(); })
+        - list.constBegin());
+}
+
+/*!
+	Returns the sorted positions of music elements of the given \a type in the music element list.
+	Only clefs, key signatures, time signatures and barlines are indexed.
+
+	The index is rebuilt in linear time, if the music element list changed since the last call.
+*/
+const QVector<int>& CAVoice::typeIndex(CAMusElement::CAMusElementType type)
+{
+    if (_typeIndexDirty) {
+        buildTypeIndex();
+    }
+
+    static const QVector<int> empty;
+    QHash<CAMusElement::CAMusElementType, QVector<int>>::const_iterator it = _typeIndex.constFind(type);
+    return (it != _typeIndex.constEnd() ? *it : empty);
+}
+
+/*!
+	Rebuilds the positions of clefs, key signatures, time signatures and barlines used by the
+	lookups, if the music element list changed.
+
+	Call this before the voice is read from several threads at once (see CAExportSnapshot). The
+	lookups don't change the voice afterwards, until the music elements are changed again.
+*/
+void CAVoice::buildTypeIndex()
+{
+    if (!_typeIndexDirty) {
+        return;
+    }
+
+    _typeIndex.clear();
+    for (int i = 0; i < _musElementList.size(); i++) {
+        if (isIndexedType(_musElementList[i]->musElementType())) {
+            _typeIndex[_musElementList[i]->musElementType()] << i;
+        }
+    }
+    _typeIndexDirty = false;
+}
+
+/*!
+	Returns the melody index used by CAMotifSearch. The index is built on the first call after
+	the voice was edited.
+*/
+const CAMotifIndex& CAVoice::motifIndex()
+{
+    if (!_motifIndex) {
+        _motifIndex.reset(new CAMotifIndex(this));
+    }
+
+    return *_motifIndex;
+}
+
 /*!
 	Returns a music element which has the given \a startTime and \a type.
 	This is useful for querying for eg. If a barline exists at the certain
@@ -557,15 +902,10 @@ bool CAVoice::binarySearch_startTime(int time, int& position)
 */
 CAMusElement* CAVoice::getOneEltByType(CAMusElement::CAMusElementType type, int startTime)
 {
-
-    int i;
-    for (i = 0; i < _musElementList.size() && _musElementList[i]->timeStart() < startTime; i++)
-        ; // seek to the start of the music elements with the given time
-
-    while (i < _musElementList.size() && _musElementList[i]->timeStart() == startTime) { // create a list of music elements with the given time
+    // create a list of music elements with the given time
+    for (int i = lowerBound(startTime); i < _musElementList.size() && _musElementList[i]->timeStart() == startTime; i++) {
         if (_musElementList[i]->musElementType() == type)
             return _musElementList[i];
-        i++;
     }
 
     return nullptr;
@@ -581,14 +921,10 @@ QList<CAMusElement*> CAVoice::getEltByType(CAMusElement::CAMusElementType type,
 {
     QList<CAMusElement*> eltList;
 
-    int i;
-    for (i = 0; i < _musElementList.size() && _musElementList[i]->timeStart() < startTime; i++)
-        ; // seek to the start of the music elements with the given time
-
-    while (i < _musElementList.size() && _musElementList[i]->timeStart() == startTime) { // create a list of music elements with the given time
+    // create a list of music elements with the given time
+    for (int i = lowerBound(startTime); i < _musElementList.size() && _musElementList[i]->timeStart() == startTime; i++) {
         if (_musElementList[i]->musElementType() == type)
             eltList << _musElementList[i];
-        i++;
     }
 
     return eltList;
@@ -603,16 +939,21 @@ QList<CAMusElement*> CAVoice::getEltByType(CAMusElement::CAMusElementType type,
 */
 CAMusElement* CAVoice::getOnePreviousByType(CAMusElement::CAMusElementType type, int startTime)
 {
+    if (isIndexedType(type)) {
+        const QVector<int>& positions = typeIndex(type);
+        int n = static_cast<int>(std::upper_bound(positions.constBegin(), positions.constEnd(), startTime,
+                                     [this](int t, int pos) { return t < _musElementList[pos]->timeStart(); })
+            - positions.constBegin());
 
-    int i;
-    for (i = _musElementList.size() - 1;
-         i >= 0 && _musElementList[i]->timeStart() > startTime; i--)
-        ; // seek to the most right of the music elements with the given time
-    while (i >= 0 && _musElementList[i]->timeStart() <= startTime) { // create a list of music elements not past the given time
+        return (n ? _musElementList[positions[n - 1]] : nullptr);
+    }
+
+    // seek to the most right of the music elements with the given time
+    for (int i = upperBound(startTime) - 1; i >= 0; i--) {
         if (_musElementList[i]->musElementType() == type)
             return _musElementList[i];
-        i--;
     }
+
     return nullptr;
 }
 
@@ -629,14 +970,20 @@ QList<CAMusElement*> CAVoice::getPreviousByType(CAMusElement::CAMusElementType t
 {
     QList<CAMusElement*> eltList;
 
-    int i;
-    for (i = _musElementList.size() - 1;
-         i >= 0 && _musElementList[i]->timeStart() > startTime; i--)
-        ; // seek to the most right of the music elements with the given time
-    while (i >= 0 && _musElementList[i]->timeStart() <= startTime) { // create a list of music elements not past the given time
+    if (isIndexedType(type)) {
+        const QVector<int>& positions = typeIndex(type);
+        for (int i = 0; i < positions.size() && _musElementList[positions[i]]->timeStart() <= startTime; i++) {
+            eltList << _musElementList[positions[i]];
+        }
+
+        return eltList;
+    }
+
+    // create a list of music elements not past the given time
+    int n = upperBound(startTime);
+    for (int i = 0; i < n; i++) {
         if (_musElementList[i]->musElementType() == type)
-            eltList.prepend(_musElementList[i]);
-        i--;
+            eltList << _musElementList[i];
     }
 
     return eltList;
@@ -652,9 +999,32 @@ QList<CAMusElement*> CAVoice::getPreviousByType(CAMusElement::CAMusElementType t
 */
 QList<CAPlayable*> CAVoice::getChord(int time)
 {
-    int i;
-    for (i = 0; i < _musElementList.size() && (_musElementList[i]->timeEnd() <= time || !_musElementList[i]->isPlayable()); i++)
-        ;
+    int i = -1;
+
+    // find the first playable element in the last chord starting at or before the given time
+    int last = upperBound(time) - 1;
+    while (last >= 0 && !_musElementList[last]->isPlayable())
+        last--;
+
+    if (last >= 0) {
+        int first = last;
+        for (int j = last - 1; j >= 0 && _musElementList[j]->timeStart() == _musElementList[last]->timeStart(); j--) {
+            if (_musElementList[j]->isPlayable())
+                first = j;
+        }
+
+        for (int j = first; j <= last && i == -1; j++) {
+            if (_musElementList[j]->isPlayable() && _musElementList[j]->timeEnd() > time)
+                i = j;
+        }
+    }
+
+    // otherwise take the first playable element after the given time
+    if (i == -1) {
+        for (i = last + 1; i < _musElementList.size() && (_musElementList[i]->timeEnd() <= time || !_musElementList[i]->isPlayable()); i++)
+            ;
+    }
+
     if (i != _musElementList.size()) {
         if (_musElementList[i]->musElementType() == CAMusElement::Note) { // music element is a note
             //! \todo Casting QList<CANote*> to QList<CAPlayable*> doesn't work?! :( Do the conversation manually. This is slow. -Matevz
@@ -679,34 +1049,44 @@ QList<CAPlayable*> CAVoice::getChord(int time)
 	Expression marks and other non-standalone elements are excluded as well.
 	The parameter \a time is any time of music elements inside the bar.
 
+	The bar limits are looked up in the bar table of the sheet (see CASheet::barNumber()), so the
+	bar is the same in all the voices and dotted barlines don't split it.
+
 	This function is usually called when double clicking on the score.
  */
 QList<CAMusElement*> CAVoice::getBar(int time)
 {
-    QList<CAPlayable*> chord = getChord(time);
     QList<CAMusElement*> ret;
-
-    if (!chord.size()) {
+    if (getChord(time).isEmpty()) {
         return ret;
     }
 
-    // search left
-    CAMusElement* curElt = previous(chord[0]);
-    while (curElt && curElt->musElementType() != CAMusElement::Barline) {
-        ret.append(curElt);
-        curElt = previous(curElt);
-    }
-
-    ret.append(chord[0]);
-
-    curElt = next(chord[0]);
-    while (curElt && curElt->musElementType() != CAMusElement::Barline) {
-        ret.append(curElt);
-        curElt = next(curElt);
+    int timeStart = 0;
+    int timeEnd = std::numeric_limits<int>::max();
+    if (staff() && staff()->sheet()) {
+        CASheet* sheet = staff()->sheet();
+        int bar = sheet->barNumber(time);
+        timeStart = sheet->barTimeStart(bar);
+        if (bar < sheet->lastBarNumber()) {
+            timeEnd = sheet->barTimeStart(bar + 1);
+        }
     }
 
-    if (curElt) { // last elt is barline
-        ret.append(curElt);
+    QList<CAMusElement*>::const_iterator it = std::lower_bound(_musElementList.constBegin(), _musElementList.constEnd(), timeStart,
+        [](CAMusElement* elt, int t) { return elt->timeStart() < t; });
+    QList<CAMusElement*> signs; // signs at the end of the bar, part of it only in front of the closing barline
+    for (; it != _musElementList.constEnd() && (*it)->timeStart() <= timeEnd; it++) {
+        if ((*it)->timeStart() == timeEnd) {
+            if ((*it)->musElementType() == CAMusElement::Barline) {
+                ret << signs << *it;
+                break;
+            } else if ((*it)->isPlayable()) {
+                break;
+            }
+            signs << *it;
+        } else if ((*it)->timeStart() != timeStart || (*it)->musElementType() != CAMusElement::Barline) {
+            ret << *it;
+        }
     }
 
     return ret;
@@ -754,7 +1134,7 @@ CAMusElement* CAVoice::next(CAMusElement* elt)
     if (musElementList().isEmpty())
         return nullptr;
     if (elt) {
-        int idx = _musElementList.indexOf(elt);
+        int idx = eltIndex(elt);
 
         if (idx == -1) //the element wasn't found
             return nullptr;
@@ -811,7 +1191,7 @@ CAMusElement* CAVoice::previous(CAMusElement* elt)
     if (musElementList().isEmpty())
         return nullptr;
     if (elt) {
-        int idx = _musElementList.indexOf(elt);
+        int idx = eltIndex(elt);
 
         if (--idx < 0) //if the element wasn't found or was the first element
             return nullptr;
@@ -829,9 +1209,7 @@ CAMusElement* CAVoice::previous(CAMusElement* elt)
 CANote* CAVoice::nextNote(int timeStart)
 {
     int i;
-    for (i = 0;
-         i < _musElementList.size() && (_musElementList[i]->musElementType() != CAMusElement::Note || _musElementList[i]->timeStart() <= timeStart);
-         i++)
+    for (i = upperBound(timeStart); i < _musElementList.size() && _musElementList[i]->musElementType() != CAMusElement::Note; i++)
         ;
 
     if (i < _musElementList.size())
@@ -847,9 +1225,7 @@ CANote* CAVoice::nextNote(int timeStart)
 CANote* CAVoice::previousNote(int timeStart)
 {
     int i;
-    for (i = _musElementList.size() - 1;
-         i > -1 && (_musElementList[i]->musElementType() != CAMusElement::Note || _musElementList[i]->timeStart() >= timeStart);
-         i--)
+    for (i = lowerBound(timeStart) - 1; i > -1 && _musElementList[i]->musElementType() != CAMusElement::Note; i--)
         ;
 
     if (i > -1)
@@ -865,9 +1241,7 @@ CANote* CAVoice::previousNote(int timeStart)
 CARest* CAVoice::nextRest(int timeStart)
 {
     int i;
-    for (i = 0;
-         i < _musElementList.size() && (_musElementList[i]->musElementType() != CAMusElement::Rest || _musElementList[i]->timeStart() <= timeStart);
-         i++)
+    for (i = upperBound(timeStart); i < _musElementList.size() && _musElementList[i]->musElementType() != CAMusElement::Rest; i++)
         ;
 
     if (i < _musElementList.size())
@@ -883,9 +1257,7 @@ CARest* CAVoice::nextRest(int timeStart)
 CARest* CAVoice::previousRest(int timeStart)
 {
     int i;
-    for (i = _musElementList.size() - 1;
-         i > -1 && (_musElementList[i]->musElementType() != CAMusElement::Rest || _musElementList[i]->timeStart() >= timeStart);
-         i--)
+    for (i = lowerBound(timeStart) - 1; i > -1 && _musElementList[i]->musElementType() != CAMusElement::Rest; i--)
         ;
 
     if (i > -1)
@@ -901,9 +1273,7 @@ CARest* CAVoice::previousRest(int timeStart)
 CAPlayable* CAVoice::nextPlayable(int timeStart)
 {
     int i;
-    for (i = 0;
-         i < _musElementList.size() && (!_musElementList[i]->isPlayable() || _musElementList[i]->timeStart() <= timeStart);
-         i++)
+    for (i = upperBound(timeStart); i < _musElementList.size() && !_musElementList[i]->isPlayable(); i++)
         ;
 
     if (i < _musElementList.size())
@@ -919,9 +1289,7 @@ CAPlayable* CAVoice::nextPlayable(int timeStart)
 CAPlayable* CAVoice::previousPlayable(int timeStart)
 {
     int i;
-    for (i = _musElementList.size() - 1;
-         i > -1 && (!_musElementList[i]->isPlayable() || _musElementList[i]->timeStart() >= timeStart);
-         i--)
+    for (i = lowerBound(timeStart) - 1; i > -1 && !_musElementList[i]->isPlayable(); i--)
         ;
 
     if (i > -1)
@@ -936,21 +1304,289 @@ CAPlayable* CAVoice::previousPlayable(int timeStart)
 
 	This method is usually called when inserting, removing or changing the music elements so they affect
 	others.
+
+	Only the elements till the end of the time segment containing \a idx are updated one by one. The
+	following segments are shifted by changing their offset. Signs are not part of time segments
+	and are updated separately.
+
+	\sa createTimeSegments()
 */
 bool CAVoice::updateTimes(int idx, int length, bool signsToo)
 {
-    for (int i = idx; i < musElementList().size(); i++)
+    if (idx < _musElementList.size()) {
+        int time = _musElementList[idx]->timeStart();
+        invalidateSheetIndices(qMin(time, time + length));
+    }
+
+    if (_timeSegments.isEmpty() && _musElementList.size() >= 2 * TIME_SEGMENT_SIZE) {
+        createTimeSegments();
+    }
+
+    int s = -1;
+    int end = _musElementList.size();
+    if (!_timeSegments.isEmpty() && idx < _musElementList.size()) {
+        s = timeSegmentAt(idx);
+        end = (s + 1 < _timeSegments.size() ? _timeSegments[s + 1]->begin : _musElementList.size());
+    }
+
+    for (int i = idx; i < end; i++) {
         if (signsToo || musElementList()[i]->isPlayable()) {
-            musElementList()[i]->setTimeStart(musElementList()[i]->timeStart() + length);
-            for (int j = 0; j < musElementList()[i]->markList().size(); j++) {
-                CAMark* m = musElementList()[i]->markList()[j];
-                if (!m->isCommon() || musElementList()[i]->musElementType() != CAMusElement::Note || static_cast<CANote*>(musElementList()[i])->isFirstInChord())
-                    m->setTimeStart(musElementList()[i]->timeStart());
+            updateTime(musElementList()[i], length);
+        }
+    }
+
+    if (s == -1) {
+        return true;
+    }
+
+    for (int i = s + 1; i < _timeSegments.size(); i++) {
+        _timeSegments[i]->offset += length;
+    }
+
+    if (signsToo) {
+        const CAMusElement::CAMusElementType signTypes[] = { CAMusElement::Clef, CAMusElement::KeySignature, CAMusElement::TimeSignature, CAMusElement::Barline };
+        for (CAMusElement::CAMusElementType type : signTypes) {
+            const QVector<int>& positions = typeIndex(type);
+            for (QVector<int>::const_iterator it = std::lower_bound(positions.constBegin(), positions.constEnd(), end); it != positions.constEnd(); it++) {
+                updateTime(musElementList()[*it], length);
             }
         }
+    }
+
     return true; // What to return ? Maybe if some music element times were actually set
 }
 
+/*!
+	Shifts the time start of the given music element \a elt and its marks for \a length.
+*/
+void CAVoice::updateTime(CAMusElement* elt, int length)
+{
+    elt->setTimeStart(elt->timeStart() + length);
+    for (CAMark* m : elt->markList()) {
+        if (!m->isCommon() || elt->musElementType() != CAMusElement::Note || static_cast<CANote*>(elt)->isFirstInChord())
+            m->setTimeStart(elt->timeStart());
+    }
+}
+
+/*!
+	Gives the voice a new generation and invalidates its motif index, and the tempo map, the chord
+	index and the bar table of the sheet from the given \a time on. Called whenever the music elements or their times change at or
+	after \a time.
+*/
+void CAVoice::invalidateSheetIndices(int time)
+{
+    updateGeneration();
+    invalidateMotifIndex();
+    if (_staff && _staff->sheet()) {
+        _staff->sheet()->invalidateTempoMap();
+        _staff->sheet()->invalidateChordIndex(time);
+        _staff->sheet()->invalidateBarTable(time);
+    }
+}
+
+/*!
+	\fn CAVoice::generation()
+	Returns the unique number of the current content of the voice: its music elements, their
+	marks and other properties written to the score. The generation changes on every modification
+	of the content. A clone made by CAStaff::clone() keeps the generation of the original, so
+	results computed from the content (eg. the LilyPond source of the voice, see CALilyPondExport)
+	can be shared by the voices of the same generation. The properties of the voice itself (name,
+	MIDI channel etc.) are not part of it.
+
+	Generation numbers are unique across all the voices of all the documents.
+*/
+
+/*!
+	Gives the voice a new generation number. Called by the voice on each change of its music
+	elements and by CAMusElement, when their properties change. Call it after changing the
+	properties of the elements otherwise.
+*/
+void CAVoice::updateGeneration()
+{
+    _generation = ++_lastGeneration;
+}
+
+/*!
+	Inserts the music element \a elt at the given index \a idx and updates the sign index and
+	the time segments.
+
+	All the insertions into the music element list should go through this method.
+*/
+void CAVoice::insertAt(int idx, CAMusElement* elt)
+{
+    _musElementList.insert(idx, elt);
+    invalidateSheetIndices(elt->timeStart());
+
+    if (idx != _musElementList.size() - 1) {
+        invalidateTypeIndex();
+    } else if (!_typeIndexDirty && isIndexedType(elt->musElementType())) {
+        _typeIndex[elt->musElementType()] << idx;
+    }
+
+    if (_timeSegments.isEmpty()) {
+        return;
+    }
+
+    // the element joins the segment of the element before it
+    int s = timeSegmentAt(qMax(idx - 1, 0));
+    for (int i = s + 1; i < _timeSegments.size(); i++) {
+        _timeSegments[i]->begin++;
+    }
+
+    if (elt->isPlayable()) {
+        elt->setTimeSegment(_timeSegments[s]);
+    }
+
+    // split the segment, if it grew too large
+    int end = (s + 1 < _timeSegments.size() ? _timeSegments[s + 1]->begin : _musElementList.size());
+    if (end - _timeSegments[s]->begin >= 2 * TIME_SEGMENT_SIZE) {
+        CATimeSegment* segment = new CATimeSegment{ _timeSegments[s]->begin + TIME_SEGMENT_SIZE, _timeSegments[s]->offset };
+        _timeSegments.insert(s + 1, segment);
+        for (int i = segment->begin; i < end; i++) {
+            if (_musElementList[i]->isPlayable()) {
+                _musElementList[i]->setTimeSegment(segment);
+            }
+        }
+    }
+}
+
+/*!
+	Inserts the time sorted music elements \a elts at the given index \a idx at once and updates the
+	sign index and the time segments.
+
+	\sa insertAt()
+*/
+void CAVoice::insertRangeAt(int idx, const QList<CAMusElement*>& elts)
+{
+    if (!elts.isEmpty()) {
+        invalidateSheetIndices(elts.first()->timeStart());
+    }
+
+    if (idx == _musElementList.size()) {
+        _musElementList.reserve(_musElementList.size() + elts.size());
+        for (CAMusElement* elt : elts) {
+            if (!_typeIndexDirty && isIndexedType(elt->musElementType())) {
+                _typeIndex[elt->musElementType()] << _musElementList.size();
+            }
+            _musElementList << elt;
+        }
+    } else {
+        QList<CAMusElement*> tail = _musElementList.mid(idx);
+        _musElementList.erase(_musElementList.begin() + idx, _musElementList.end());
+        _musElementList.reserve(_musElementList.size() + elts.size() + tail.size());
+        _musElementList << elts << tail;
+        invalidateTypeIndex();
+    }
+
+    if (_timeSegments.isEmpty()) {
+        return;
+    }
+
+    // the elements join the segment of the element before them
+    int s = timeSegmentAt(qMax(idx - 1, 0));
+    for (int i = s + 1; i < _timeSegments.size(); i++) {
+        _timeSegments[i]->begin += elts.size();
+    }
+
+    for (CAMusElement* elt : elts) {
+        if (elt->isPlayable()) {
+            elt->setTimeSegment(_timeSegments[s]);
+        }
+    }
+
+    // split the segment, if it grew too large
+    int end = (s + 1 < _timeSegments.size() ? _timeSegments[s + 1]->begin : _musElementList.size());
+    while (end - _timeSegments[s]->begin >= 2 * TIME_SEGMENT_SIZE) {
+        CATimeSegment* segment = new CATimeSegment{ _timeSegments[s]->begin + TIME_SEGMENT_SIZE, _timeSegments[s]->offset };
+        _timeSegments.insert(++s, segment);
+        for (int i = segment->begin; i < end; i++) {
+            if (_musElementList[i]->isPlayable()) {
+                _musElementList[i]->setTimeSegment(segment);
+            }
+        }
+    }
+}
+
+/*!
+	Removes the music element at the given index \a idx and updates the sign index and the time
+	segments. The start time of the removed element becomes absolute again.
+
+	All the removals from the music element list should go through this method.
+*/
+void CAVoice::removeAt(int idx)
+{
+    CAMusElement* elt = _musElementList.takeAt(idx);
+    if (elt->timeSegment()) {
+        elt->setTimeSegment(nullptr);
+    }
+    invalidateTypeIndex();
+    invalidateSheetIndices(elt->timeStart());
+
+    if (_timeSegments.isEmpty()) {
+        return;
+    }
+
+    int s = timeSegmentAt(idx);
+    for (int i = s + 1; i < _timeSegments.size(); i++) {
+        _timeSegments[i]->begin--;
+    }
+
+    // remove the segment, if it became empty
+    int end = (s + 1 < _timeSegments.size() ? _timeSegments[s + 1]->begin : _musElementList.size());
+    if (end == _timeSegments[s]->begin) {
+        delete _timeSegments.takeAt(s);
+    }
+}
+
+/*!
+	Returns the index of the time segment which contains the music element at the given index \a idx.
+*/
+int CAVoice::timeSegmentAt(int idx)
+{
+    int s = static_cast<int>(std::upper_bound(_timeSegments.constBegin(), _timeSegments.constEnd(), idx,
+                                 [](int i, CATimeSegment* segment) { return i < segment->begin; })
+        - _timeSegments.constBegin());
+
+    return qMax(s - 1, 0);
+}
+
+/*!
+	Splits the music elements into time segments of TIME_SEGMENT_SIZE elements and makes the start
+	times of notes and rests relative to them.
+
+	This is done the first time a long voice needs to be shifted in updateTimes().
+*/
+void CAVoice::createTimeSegments()
+{
+    clearTimeSegments();
+
+    for (int begin = 0; begin < _musElementList.size(); begin += TIME_SEGMENT_SIZE) {
+        CATimeSegment* segment = new CATimeSegment{ begin, 0 };
+        _timeSegments << segment;
+
+        for (int i = begin; i < qMin(begin + TIME_SEGMENT_SIZE, _musElementList.size()); i++) {
+            if (_musElementList[i]->isPlayable()) {
+                _musElementList[i]->setTimeSegment(segment);
+            }
+        }
+    }
+}
+
+/*!
+	Makes the start times of all the music elements absolute and destroys the time segments.
+*/
+void CAVoice::clearTimeSegments()
+{
+    for (int i = 0; i < _musElementList.size(); i++) {
+        if (_musElementList[i]->timeSegment()) {
+            _musElementList[i]->setTimeSegment(nullptr);
+        }
+    }
+
+    qDeleteAll(_timeSegments);
+    _timeSegments.clear();
+}
+
 /*!
 	Fixes any inconsistencies between music elements:
 	1) If a common (shared) mark is present only in non-first note of the chord, it's moved and assigned
@@ -1004,8 +1640,8 @@ bool CAVoice::synchronizeMusElements()
 */
 bool CAVoice::containsPitch(int noteName, int timeStart)
 {
-    for (int i = 0; i < _musElementList.size(); i++) {
-        if (_musElementList[i]->timeStart() == timeStart && _musElementList[i]->musElementType() == CAMusElement::Note && static_cast<CANote*>(_musElementList[i])->diatonicPitch().noteName() == noteName)
+    for (int i = lowerBound(timeStart); i < _musElementList.size() && _musElementList[i]->timeStart() == timeStart; i++) {
+        if (_musElementList[i]->musElementType() == CAMusElement::Note && static_cast<CANote*>(_musElementList[i])->diatonicPitch().noteName() == noteName)
             return true;
     }
 
@@ -1021,8 +1657,8 @@ bool CAVoice::containsPitch(int noteName, int timeStart)
 */
 bool CAVoice::containsPitch(CADiatonicPitch p, int timeStart)
 {
-    for (int i = 0; i < _musElementList.size(); i++) {
-        if (_musElementList[i]->timeStart() == timeStart && _musElementList[i]->musElementType() == CAMusElement::Note && static_cast<CANote*>(_musElementList[i])->diatonicPitch() == p)
+    for (int i = lowerBound(timeStart); i < _musElementList.size() && _musElementList[i]->timeStart() == timeStart; i++) {
+        if (_musElementList[i]->musElementType() == CAMusElement::Note && static_cast<CANote*>(_musElementList[i])->diatonicPitch() == p)
             return true;
     }
     return false;
@@ -1039,7 +1675,7 @@ CATempo* CAVoice::getTempo(int time)
     if (chord.isEmpty()) {
         curElt = musElementList().size() - 1;
     } else {
-        curElt = musElementList().indexOf(chord.last());
+        curElt = eltIndex(chord.last());
     }
 
     CATempo* tempo = nullptr;
@@ -1064,10 +1700,8 @@ QList<CAMusElement*> CAVoice::getKeySignature(int startTime)
 {
 
     QList<CAMusElement*> eltList;
-    int i;
     // seek to the start of the music elements with the given time
-    for (i = 0; i < staff()->keySignatureRefs().size() && staff()->keySignatureRefs()[i]->timeStart() < startTime; i++)
-        ;
+    int i = lowerBound(staff()->keySignatureRefs(), startTime);
 
     // create a list of music elements with the given time
     while (i < staff()->keySignatureRefs().size() && staff()->keySignatureRefs()[i]->timeStart() == startTime) {
@@ -1087,10 +1721,8 @@ QList<CAMusElement*> CAVoice::getTimeSignature(int startTime)
 {
 
     QList<CAMusElement*> eltList;
-    int i;
     // seek to the start of the music elements with the given time
-    for (i = 0; i < staff()->timeSignatureRefs().size() && staff()->timeSignatureRefs()[i]->timeStart() < startTime; i++)
-        ;
+    int i = lowerBound(staff()->timeSignatureRefs(), startTime);
 
     // create a list of music elements with the given time
     while (i < staff()->timeSignatureRefs().size() && staff()->timeSignatureRefs()[i]->timeStart() == startTime) {
@@ -1110,10 +1742,8 @@ QList<CAMusElement*> CAVoice::getClef(int startTime)
 {
 
     QList<CAMusElement*> eltList;
-    int i;
     // seek to the start of the music elements with the given time
-    for (i = 0; i < staff()->clefRefs().size() && staff()->clefRefs()[i]->timeStart() < startTime; i++)
-        ;
+    int i = lowerBound(staff()->clefRefs(), startTime);
 
     // create a list of music elements with the given time
     while (i < staff()->clefRefs().size() && staff()->clefRefs()[i]->timeStart() == startTime) {
@@ -1134,11 +1764,8 @@ QList<CAMusElement*> CAVoice::getPreviousKeySignature(int startTime)
 {
 
     QList<CAMusElement*> eltList;
-    int i;
     // seek to the most right of the music elements with the given time
-    for (i = staff()->keySignatureRefs().size() - 1;
-         i >= 0 && staff()->keySignatureRefs()[i]->timeStart() > startTime; i--)
-        ;
+    int i = upperBound(staff()->keySignatureRefs(), startTime) - 1;
     // create a list of music elements not past the given time
     while (i >= 0 && staff()->keySignatureRefs()[i]->timeStart() <= startTime) {
         eltList.prepend(staff()->keySignatureRefs()[i]);
@@ -1157,11 +1784,8 @@ QList<CAMusElement*> CAVoice::getPreviousTimeSignature(int startTime)
 {
 
     QList<CAMusElement*> eltList;
-    int i;
     // seek to the most right of the music elements with the given time
-    for (i = staff()->timeSignatureRefs().size() - 1;
-         i >= 0 && staff()->timeSignatureRefs()[i]->timeStart() > startTime; i--)
-        ;
+    int i = upperBound(staff()->timeSignatureRefs(), startTime) - 1;
     // create a list of music elements not past the given time
     while (i >= 0 && staff()->timeSignatureRefs()[i]->timeStart() <= startTime) {
         eltList.prepend(staff()->timeSignatureRefs()[i]);
@@ -1180,11 +1804,8 @@ QList<CAMusElement*> CAVoice::getPreviousClef(int startTime)
 {
 
     QList<CAMusElement*> eltList;
-    int i;
     // seek to the most right of the music elements with the given time
-    for (i = staff()->clefRefs().size() - 1;
-         i >= 0 && staff()->clefRefs()[i]->timeStart() > startTime; i--)
-        ;
+    int i = upperBound(staff()->clefRefs(), startTime) - 1;
     // create a list of music elements not past the given time
     while (i >= 0 && staff()->clefRefs()[i]->timeStart() <= startTime) {
         eltList.prepend(staff()->clefRefs()[i]);
@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2008, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICNESE.GPL for details.
@@ -8,8 +8,14 @@
 #ifndef VOICE_H_
 #define VOICE_H_
 
+#include <QHash>
 #include <QList> // music elements container
+#include <QVector>
 
+#include <atomic>
+#include <memory>
+
+#include "score/motifindex.h"
 #include "score/muselement.h"
 #include "score/note.h"
 
@@ -21,7 +27,10 @@ class CARest;
 class CATempo;
 
 class CAVoice {
-    friend class CAStaff; // used for insertion of music elements and updateTimes() when inserting elements and synchronizing voices
+    friend class CAStaff; // used for insertion of music elements and updateTimes() when inserting elements and synchronizing voices, and for keeping the generation of the clones
+    friend class CATuplet; // used for updateTimes() when retiming the tuplet members in place
+    friend class CANote; // used for invalidateMotifIndex() when the pitch changes
+    friend class CALyricsContext; // used for lowerBound() when repositing the syllables from the given time on
 
 public:
     CAVoice(const QString name, CAStaff* staff, CANote::CAStemDirection stemDirection = CANote::StemNeutral);
@@ -36,8 +45,11 @@ public:
     // Notes, rests and signs manipulation //
     /////////////////////////////////////////
     void append(CAMusElement* elt, bool addToChord = false);
+    QList<CANote*> appendNotes(const QList<CADiatonicPitch>& pitches, const QList<CAPlayableLength>& lengths);
     bool insert(CAMusElement* eltAfter, CAMusElement* elt, bool addToChord = false);
+    bool insertBlock(CAMusElement* eltAfter, const QList<CAMusElement*>& elts);
     bool remove(CAMusElement* elt, bool updateSignsTimes = true);
+    bool removeBlock(const QList<CAMusElement*>& elts, bool updateSignsTimes = true);
     CAPlayable* insertInTupletAndVoiceAt(CAPlayable* p, CAPlayable* n);
     bool synchronizeMusElements();
 
@@ -110,21 +122,69 @@ public:
     inline char midiPitchOffset() { return _midiPitchOffset; }
     inline void setMidiPitchOffset(const char midiPitchOffset) { _midiPitchOffset = midiPitchOffset; }
 
+    inline const QString midiPort() { return _midiPort; }
+    inline void setMidiPort(const QString port) { _midiPort = port; }
+
     inline const QList<CALyricsContext*>& lyricsContextList() { return _lyricsContextList; }
     inline void addLyricsContext(CALyricsContext* lc) { _lyricsContextList << lc; }
     inline void setLyricsContexts(QList<CALyricsContext*> list) { _lyricsContextList = list; }
     inline void addLyricsContexts(QList<CALyricsContext*> list) { _lyricsContextList += list; }
     inline bool removeLyricsContext(CALyricsContext* lc) { return _lyricsContextList.removeAll(lc); }
 
+    int eltIndex(CAMusElement* elt);
+    void buildTypeIndex();
+
+    inline quint64 generation() { return _generation; }
+    void updateGeneration();
+#ifndef SWIG
+    const CAMotifIndex& motifIndex();
+#endif
+
 private:
     bool addNoteToChord(CANote* note, CANote* referenceNote);
     bool insertMusElement(CAMusElement* before, CAMusElement* elt);
+    void relinkChord(CANote* n, CANote* heir);
+    void removeLinks(CAPlayable* p);
+    void addToStaffRefs(CAMusElement* elt);
     bool updateTimes(int idx, int length, bool signsToo = false);
+    void updateTime(CAMusElement* elt, int length);
+
+    void insertAt(int idx, CAMusElement* elt);
+    void insertRangeAt(int idx, const QList<CAMusElement*>& elts);
+    void removeAt(int idx);
+    int timeSegmentAt(int idx);
+    void createTimeSegments();
+    void clearTimeSegments();
+
+    inline int lowerBound(int time) { return lowerBound(_musElementList, time); }
+    inline int upperBound(int time) { return upperBound(_musElementList, time); }
+    static int lowerBound(const QList<CAMusElement*>& list, int time);
+    static int upperBound(const QList<CAMusElement*>& list, int time);
+    const QVector<int>& typeIndex(CAMusElement::CAMusElementType type);
+    inline void invalidateTypeIndex() { _typeIndexDirty = true; }
+    void invalidateSheetIndices(int time);
+    inline void invalidateMotifIndex() { _motifIndex.reset(); }
+    static inline bool isIndexedType(CAMusElement::CAMusElementType type)
+    {
+        return type == CAMusElement::Clef || type == CAMusElement::KeySignature || type == CAMusElement::TimeSignature || type == CAMusElement::Barline;
+    }
 
     // list of all the music elements
     QList<CAMusElement*> _musElementList;
     CAStaff* _staff; // parent staff
 
+    // positions of clefs, key signatures, time signatures and barlines in _musElementList
+    QHash<CAMusElement::CAMusElementType, QVector<int>> _typeIndex;
+    bool _typeIndexDirty;
+
+    std::unique_ptr<CAMotifIndex> _motifIndex; // built on demand, null when invalid
+
+    quint64 _generation; // unique number of the current content, kept by the clones, see generation()
+    static std::atomic<quint64> _lastGeneration; // the last generation number given to any voice
+
+    static const int TIME_SEGMENT_SIZE;
+    QList<CATimeSegment*> _timeSegments; // consecutive runs of music elements sorted by their begin index
+
     CANote::CAStemDirection _stemDirection;
     QList<CALyricsContext*> _lyricsContextList;
 
@@ -136,5 +196,6 @@ private:
     unsigned char _midiChannel;
     unsigned char _midiProgram;
     char _midiPitchOffset;
+    QString _midiPort; // name of the MIDI output port playing the voice, empty for the default port
 };
 #endif /* VOICE_H_ */
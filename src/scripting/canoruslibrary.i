@@ -34,6 +34,9 @@ class QSettings {
 // io
 %include "scripting/importexport.i"
 
+// tasks
+%include "scripting/taskscheduler.i"
+
 // console
 %include "scripting/pyconsoleinterface.i"
 
@@ -133,12 +133,7 @@
               const QList<CAFiguredBasMark*>, QList<CAFiguredBassMark*>,
               const QList<CAFunctionMark*>, QList<CAFunctionMark*>,
               const QList<CAChordName*>, QList<CAChordName*> {
-    PyObject *list = PyList_New(0);
-    for (int i=0; i<$1.size(); i++) {
-        PyList_Append(list, CASwigPython::toPythonObject($1.at(i), CASwigPython::MusElement));
-    }
-	
-    $result = list;
+    $result = musElementSequence($1); // wrappers are created when accessed, see CAPyMusElementList
 }
 %typemap(out) const QList<CAMusElement*>&, QList<CAMusElement*>&,
               const QList<CANote*>&, QList<CANote*>&,
@@ -149,12 +144,7 @@
               const QList<CAFiguredBassMark*>&, QList<CAFiguredBassMark*>&,
               const QList<CAFunctionMark*>&, QList<CAFunctionMark*>&,
               const QList<CAChordName*>&, QList<CAChordName*>& {
-    PyObject *list = PyList_New(0);
-    for (int i=0; i<$1->size(); i++) {
-        PyList_Append(list, CASwigPython::toPythonObject($1->at(i), CASwigPython::MusElement));
-    }
-	
-    $result = list;
+    $result = musElementSequence(*$1);
 }
 %typemap(out) const QList< QList<CAMidiNote*> >, QList< QList<CAMidiNote*> > {
     PyObject *list = PyList_New(0);
@@ -265,16 +255,52 @@ bool hasGui();
 // the following functions work when a plugin is launched inside Canorus:
 void rebuildUi();
 void repaintUi();
+void beginBatch( CADocument *document=0, const QString undoText="" );
+void endBatch();
+PyObject *appendNotes( CAVoice *voice, PyObject *notes );
+PyObject *appendNoteArray( CAVoice *voice, PyObject *buffer );
+PyObject *eventArrays( CASheet *sheet );
+PyObject *eventArrays( CAStaff *staff );
+PyObject *eventArrays( CAVoice *voice );
+PyObject *callInGui( PyObject *function );
 void acquireGIL();
 void releaseGIL();
 void setSelection( QList<CAMusElement*> elements, bool centerOn=false );
 
 %include "scripting/canoruslibrary.i"
 
+%pythoncode %{
+class batch(object):
+    """Context manager for a batch of changes made by a script.
+
+    The GUI is rebuilt once when the block is left. If a document is given, all the changes
+    are also undone by a single undo step:
+
+        with CanorusPython.batch(document, "generate exercise"):
+            CanorusPython.appendNotes(voice, notes)
+    """
+    def __init__(self, document=None, undoText=""):
+        self.document = document
+        self.undoText = undoText
+
+    def __enter__(self):
+        beginBatch(self.document, self.undoText)
+        return self
+
+    def __exit__(self, excType, excValue, traceback):
+        endBatch()
+        return False
+%}
+
 %{	// toPythonObject() function
 #include "scripting/swigpython.h"	//needed for CAClassType
 
+#include <QHash>
 #include <QList>
+#include <QPair>
+#include <QVector>
+
+#include "core/eventstore.h"
 QList<void*> markedObjects = QList<void*>(); // define markedObjects
 
 void markDelete( PyObject* object ) {
@@ -294,15 +320,259 @@ void guiError() {
 
 void rebuildUi() {
 #ifndef SWIGCPP
-    CACanorus::rebuildUI();
+    CASwigPython::callInMainThread([]() { CACanorus::rebuildUI(); });
 #else
     guiError();
 #endif
 }
 
+int batchDepth = 0; // number of open batches
+int batchUndoDepth = 0; // depth of the batch which created the undo command or 0
+CADocument *batchUndoDocument = nullptr;
+
+/*!
+    Starts a batch of changes. The GUI rebuilds requested until the matching endBatch()
+    are merged and done only once.
+
+    If a \a document is given, a single undo command named \a undoText is created for all
+    the changes made until the matching endBatch() and the document is rebuilt at the end.
+    Nested batches are part of the outermost undo command.
+*/
+void beginBatch( CADocument *document, const QString undoText ) {
+    batchDepth++;
+#ifndef SWIGCPP
+    CASwigPython::callInMainThread([&]() {
+        if (document && !batchUndoDocument && CACanorus::undo()->containsUndoStack(document)) {
+            CACanorus::undo()->createUndoCommand(document, undoText.isEmpty() ? QObject::tr("script", "undo") : undoText);
+            batchUndoDocument = document;
+            batchUndoDepth = batchDepth;
+        }
+
+        CACanorus::beginBatch();
+    });
+#endif
+}
+
+void endBatch() {
+    if (!batchDepth) {
+        return;
+    }
+
+#ifndef SWIGCPP
+    CASwigPython::callInMainThread([]() {
+        if (batchDepth == batchUndoDepth) {
+            CACanorus::undo()->pushUndoCommand();
+            CACanorus::rebuildUI(batchUndoDocument);
+            batchUndoDocument = nullptr;
+            batchUndoDepth = 0;
+        }
+
+        CACanorus::endBatch();
+    });
+#endif
+    batchDepth--;
+}
+
+/*!
+    Appends notes given by a Python sequence of (pitch, length) tuples to the \a voice.
+    The pitch is a CADiatonicPitch, a note name or a (note name, accidentals) tuple. The length is
+    a CAPlayableLength, a music length or a (music length, dots) tuple.
+
+    The notes are created and appended in C++ at once, which is much faster than appending each
+    note from Python. Nothing is appended, if any item is invalid.
+
+    Returns the number of the appended notes.
+*/
+PyObject *appendNotes( CAVoice *voice, PyObject *notes ) {
+    PyObject *seq = PySequence_Fast(notes, "appendNotes: a sequence of (pitch, length) tuples expected");
+    if (!voice || !seq) {
+        Py_XDECREF(seq);
+        return nullptr;
+    }
+
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    QList<CADiatonicPitch> pitches;
+    QList<CAPlayableLength> lengths;
+    pitches.reserve(n);
+    lengths.reserve(n);
+
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *item = PySequence_Fast_GET_ITEM(seq, i);
+        if (!PyTuple_Check(item) || PyTuple_Size(item) != 2) {
+            Py_DECREF(seq);
+            PyErr_Format(PyExc_TypeError, "appendNotes: item %zd is not a (pitch, length) tuple", i);
+            return nullptr;
+        }
+
+        PyObject *pitch = PyTuple_GET_ITEM(item, 0);
+        PyObject *length = PyTuple_GET_ITEM(item, 1);
+        void *ptr = nullptr;
+
+        if (SWIG_IsOK(SWIG_ConvertPtr(pitch, &ptr, SWIGTYPE_p_CADiatonicPitch, 0)) && ptr) {
+            pitches << *reinterpret_cast<CADiatonicPitch*>(ptr);
+        } else if (PyTuple_Check(pitch) && PyTuple_Size(pitch) == 2) {
+            pitches << CADiatonicPitch(PyInt_AsLong(PyTuple_GET_ITEM(pitch, 0)), PyInt_AsLong(PyTuple_GET_ITEM(pitch, 1)));
+        } else {
+            pitches << CADiatonicPitch(PyInt_AsLong(pitch));
+        }
+
+        if (SWIG_IsOK(SWIG_ConvertPtr(length, &ptr, SWIGTYPE_p_CAPlayableLength, 0)) && ptr) {
+            lengths << *reinterpret_cast<CAPlayableLength*>(ptr);
+        } else if (PyTuple_Check(length) && PyTuple_Size(length) == 2) {
+            lengths << CAPlayableLength(static_cast<CAPlayableLength::CAMusicLength>(PyInt_AsLong(PyTuple_GET_ITEM(length, 0))), PyInt_AsLong(PyTuple_GET_ITEM(length, 1)));
+        } else {
+            lengths << CAPlayableLength(static_cast<CAPlayableLength::CAMusicLength>(PyInt_AsLong(length)));
+        }
+
+        if (PyErr_Occurred()) {
+            Py_DECREF(seq);
+            return nullptr;
+        }
+    }
+    Py_DECREF(seq);
+
+    return PyInt_FromLong(voice->appendNotes(pitches, lengths).size());
+}
+
+/*!
+    Appends notes given by an object supporting the buffer protocol (eg. array.array('i') or
+    a numpy int32 array) to the \a voice. Each note is given by four integers: note name,
+    accidentals, music length and dots.
+
+    The buffer is read directly without creating any Python objects. Returns the number of the
+    appended notes.
+*/
+PyObject *appendNoteArray( CAVoice *voice, PyObject *buffer ) {
+    Py_buffer view;
+    if (!voice || PyObject_GetBuffer(buffer, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) == -1) {
+        return nullptr;
+    }
+
+    QByteArray format(view.format ? view.format : "B");
+    if (view.itemsize != sizeof(int) || !(format.endsWith('i') || format.endsWith('l')) || (view.len / view.itemsize) % 4) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_TypeError, "appendNoteArray: a buffer of 32-bit integers in groups of (note name, accidentals, music length, dots) expected");
+        return nullptr;
+    }
+
+    const int *data = static_cast<const int*>(view.buf);
+    int n = view.len / view.itemsize / 4;
+    QList<CADiatonicPitch> pitches;
+    QList<CAPlayableLength> lengths;
+    pitches.reserve(n);
+    lengths.reserve(n);
+
+    for (int i = 0; i < n; i++, data += 4) {
+        pitches << CADiatonicPitch(data[0], data[1]);
+        lengths << CAPlayableLength(static_cast<CAPlayableLength::CAMusicLength>(data[2]), data[3]);
+    }
+    PyBuffer_Release(&view);
+
+    return PyInt_FromLong(voice->appendNotes(pitches, lengths).size());
+}
+
+/*!
+    Returns a new memoryview of the given struct \a format over a copy of the \a values.
+*/
+template <typename T>
+PyObject *packedArray( const QVector<T>& values, const char *format ) {
+    PyObject *bytes = PyBytes_FromStringAndSize(reinterpret_cast<const char*>(values.constData()), values.size() * sizeof(T));
+    PyObject *view = bytes ? PyMemoryView_FromObject(bytes) : nullptr;
+    Py_XDECREF(bytes); // kept by the view
+    PyObject *array = view ? PyObject_CallMethod(view, "cast", "s", format) : nullptr;
+    Py_XDECREF(view);
+    return array;
+}
+
+bool setArray( PyObject *dict, const char *key, PyObject *array ) {
+    if (!array) {
+        return false;
+    }
+
+    PyDict_SetItemString(dict, key, array);
+    Py_DECREF(array);
+    return true;
+}
+
+/*!
+    Returns the music elements of the \a voices as a dictionary of packed arrays, one row per
+    element in the order of the voices and their music element lists. The arrays are taken from
+    the CAEventStore snapshot and support the buffer protocol, so they are read by the analysis
+    scripts directly (eg. numpy.frombuffer(arrays["pitch"], numpy.uint8)) without calling the
+    wrappers of each note:
+
+    - "time", "length": start time and time length of the element (int32)
+    - "pitch": midi pitch of the note including the voice pitch offset, 0 for the other elements (uint8)
+    - "noteName", "accs": diatonic note name (int32) and accidentals (int8) of the note, 0 otherwise
+    - "channel": midi channel of the voice (uint8)
+    - "flags": 1 playable, 2 note, 4 tie start, 8 tie end, 16 first note in chord (uint8)
+    - "stream": index of the element's voice in "voices" (int32)
+    - "offsets": first row of each voice and the number of rows at the end (int32)
+    - "voices": list of the voices
+
+    The arrays are copies and don't change with the score.
+*/
+PyObject *eventArrays( const QList<CAVoice*>& voices ) {
+    CAEventStore events;
+    events.build(voices);
+
+    QVector<int> stream(events.size());
+    QVector<int> noteName(events.size());
+    QVector<signed char> accs(events.size());
+    QVector<int> offsets;
+    offsets.reserve(events.streamCount() + 1);
+    for (int i = 0; i < events.streamCount(); i++) {
+        offsets << events.streamBegin(i);
+        for (int row = events.streamBegin(i); row < events.streamEnd(i); row++) {
+            stream[row] = i;
+            if (events.flags(row) & CAEventStore::Note) {
+                const CADiatonicPitch& pitch = static_cast<CANote*>(events.element(row))->diatonicPitch();
+                noteName[row] = pitch.noteName();
+                accs[row] = pitch.accs();
+            }
+        }
+    }
+    offsets << events.size();
+
+    PyObject *voiceList = PyList_New(voices.size());
+    for (int i = 0; i < voices.size(); i++) {
+        PyList_SET_ITEM(voiceList, i, CASwigPython::toPythonObject(voices[i], CASwigPython::Voice));
+    }
+
+    PyObject *result = PyDict_New();
+    PyDict_SetItemString(result, "voices", voiceList);
+    Py_DECREF(voiceList);
+    if (!setArray(result, "time", packedArray(events.times(), "i"))
+        || !setArray(result, "length", packedArray(events.lengths(), "i"))
+        || !setArray(result, "pitch", packedArray(events.pitches(), "B"))
+        || !setArray(result, "noteName", packedArray(noteName, "i"))
+        || !setArray(result, "accs", packedArray(accs, "b"))
+        || !setArray(result, "channel", packedArray(events.channels(), "B"))
+        || !setArray(result, "flags", packedArray(events.flagList(), "B"))
+        || !setArray(result, "stream", packedArray(stream, "i"))
+        || !setArray(result, "offsets", packedArray(offsets, "i"))) {
+        Py_DECREF(result);
+        return nullptr;
+    }
+
+    return result;
+}
+
+PyObject *eventArrays( CASheet *sheet ) {
+    return eventArrays(sheet ? sheet->voiceList() : QList<CAVoice*>());
+}
+
+PyObject *eventArrays( CAStaff *staff ) {
+    return eventArrays(staff ? staff->voiceList() : QList<CAVoice*>());
+}
+
+PyObject *eventArrays( CAVoice *voice ) {
+    return eventArrays(voice ? QList<CAVoice*>() << voice : QList<CAVoice*>());
+}
+
 void repaintUi() {
 #ifndef SWIGCPP
-    CACanorus::repaintUI();
+    CASwigPython::callInMainThread([]() { CACanorus::repaintUI(); });
 #else
     guiError();
 #endif
@@ -330,16 +600,29 @@ void releaseGIL() {
     PyEval_ReleaseThread(CASwigPython::mainThreadState);
 }
 
+#ifndef SWIGCPP
+void setSelectionInGui( QList<CAMusElement*> elements, bool centerOn );
+#endif
+
 /*!
     Selects the given elements in the current score view and optionally scrolls
     the view to center them.
 */
 void setSelection( QList<CAMusElement*> elements, bool centerOn ) {
 #ifndef SWIGCPP
+    CASwigPython::callInMainThread([&]() { setSelectionInGui(elements, centerOn); });
+#else
+    guiError();
+#endif
+}
+
+#ifndef SWIGCPP
+void setSelectionInGui( QList<CAMusElement*> elements, bool centerOn ) {
     if (!elements.size() || !elements[0]->context() || !elements[0]->context()->sheet() || !elements[0]->context()->sheet()->document()) {
         return;
     }
 
+    CACanorus::flushRebuildUI(); // drawable elements are needed
     CADocument *doc = elements[0]->context()->sheet()->document();
     QList<CAMainWin*> mainwins = CACanorus::findMainWin(doc);
 
@@ -362,15 +645,193 @@ void setSelection( QList<CAMusElement*> elements, bool centerOn ) {
             false
         );
     }
-#else
-    guiError();
+}
 #endif
+
+/*!
+    Calls the given Python \a function without arguments in the GUI thread and returns its result.
+
+    Scripts run by the Python console are executed in a worker thread so the GUI stays responsive.
+    They should change the document only inside functions passed to callInGui(), as the GUI may be
+    reading the document at the same time. Called directly, when already in the GUI thread.
+*/
+PyObject *callInGui( PyObject *function ) {
+    if (CASwigPython::isMainThread()) {
+        return PyObject_CallObject(function, nullptr);
+    }
+
+    PyObject *ret = nullptr;
+    PyObject *errType = nullptr, *errValue = nullptr, *errTraceback = nullptr;
+    CASwigPython::callInMainThread([&]() {
+        CASwigPython::lockGIL();
+        ret = PyObject_CallObject(function, nullptr);
+        if (!ret) {
+            PyErr_Fetch(&errType, &errValue, &errTraceback); // pass the exception to the calling thread
+        }
+        CASwigPython::unlockGIL();
+    });
+
+    if (!ret) {
+        PyErr_Restore(errType, errValue, errTraceback);
+    }
+
+    return ret;
 }
 
 const char* tr( const char * sourceText, const char * comment = 0, int n = -1 ) {
     return QObject::tr( sourceText, comment, n ).toUtf8().constData();
 }
 
+QHash<QPair<void*, swig_type_info*>, PyObject*> wrapperCache; // object and its type -> weak reference to its wrapper
+int wrapperCacheSweep = 1024; // size of wrapperCache when the dead references are removed next
+
+/*!
+    Returns the Python wrapper of the C++ \a object of the given SWIG \a type. The wrapper is reused
+    while it is referenced in Python, so the loops over the elements don't create a new wrapper
+    and look up its class on every access. Only weak references to the wrappers are kept and Python
+    deletes them as before.
+
+    The wrappers don't own the objects, so a cached wrapper of a deleted object is the same as a new
+    wrapper of the object created at the same address of the same type.
+*/
+PyObject *cachedPointerObj(void *object, swig_type_info *type) {
+    if (!object) {
+        return SWIG_NewPointerObj(object, type, 0);
+    }
+
+    QPair<void*, swig_type_info*> key(object, type);
+    PyObject *ref = wrapperCache.value(key);
+    if (ref) {
+        PyObject *wrapper = PyWeakref_GetObject(ref);
+        if (wrapper != Py_None) {
+            Py_INCREF(wrapper);
+            return wrapper;
+        }
+
+        wrapperCache.remove(key);
+        Py_DECREF(ref);
+    }
+
+    PyObject *wrapper = SWIG_NewPointerObj(object, type, 0);
+    ref = wrapper ? PyWeakref_NewRef(wrapper, nullptr) : nullptr;
+    if (!ref) {
+        PyErr_Clear(); // the wrapper doesn't support weak references, don't cache it
+        return wrapper;
+    }
+
+    if (wrapperCache.size() >= wrapperCacheSweep) {
+        for (QHash<QPair<void*, swig_type_info*>, PyObject*>::iterator it = wrapperCache.begin(); it != wrapperCache.end();) {
+            if (PyWeakref_GetObject(it.value()) == Py_None) {
+                Py_DECREF(it.value());
+                it = wrapperCache.erase(it);
+            } else {
+                it++;
+            }
+        }
+        wrapperCacheSweep = qMax(1024, 2 * wrapperCache.size());
+    }
+
+    wrapperCache.insert(key, ref);
+    return wrapper;
+}
+
+/*!
+    Python sequence of the music elements returned by the list accessors, eg.
+    CAVoice::musElementList().
+
+    The returned list is copied, but the copy is shared with the original until either of them
+    changes, so it doesn't change when the elements are added or removed later. The wrappers of the
+    elements are created only when accessed. Indexing, slicing, len() and iteration are supported,
+    use list() for the other list operations.
+*/
+struct CAPyMusElementList {
+    PyObject_HEAD
+    QList<CAMusElement*> *list;
+};
+
+PyTypeObject CAPyMusElementListType = { PyVarObject_HEAD_INIT(nullptr, 0) };
+
+void musElementListDealloc(PyObject *self) {
+    delete reinterpret_cast<CAPyMusElementList*>(self)->list;
+    Py_TYPE(self)->tp_free(self);
+}
+
+Py_ssize_t musElementListLength(PyObject *self) {
+    return reinterpret_cast<CAPyMusElementList*>(self)->list->size();
+}
+
+PyObject *musElementListItem(PyObject *self, Py_ssize_t i) {
+    QList<CAMusElement*> *list = reinterpret_cast<CAPyMusElementList*>(self)->list;
+    if (i < 0 || i >= list->size()) {
+        PyErr_SetString(PyExc_IndexError, "list index out of range");
+        return nullptr;
+    }
+
+    return CASwigPython::toPythonObject(list->at(i), CASwigPython::MusElement);
+}
+
+PyObject *musElementListSubscript(PyObject *self, PyObject *key) {
+    QList<CAMusElement*> *list = reinterpret_cast<CAPyMusElementList*>(self)->list;
+    if (PySlice_Check(key)) {
+        Py_ssize_t start, stop, step, length;
+        if (PySlice_GetIndicesEx(key, list->size(), &start, &stop, &step, &length) < 0) {
+            return nullptr;
+        }
+
+        PyObject *result = PyList_New(length);
+        for (Py_ssize_t i = 0; i < length; i++) {
+            PyObject *item = CASwigPython::toPythonObject(list->at(start + i * step), CASwigPython::MusElement);
+            if (!item) {
+                Py_DECREF(result);
+                return nullptr;
+            }
+            PyList_SET_ITEM(result, i, item);
+        }
+        return result;
+    }
+
+    Py_ssize_t i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+    if (i == -1 && PyErr_Occurred()) {
+        return nullptr;
+    }
+
+    return musElementListItem(self, (i < 0) ? i + list->size() : i);
+}
+
+PySequenceMethods musElementListSequence = { musElementListLength, nullptr, nullptr, musElementListItem };
+PyMappingMethods musElementListMapping = { musElementListLength, musElementListSubscript, nullptr };
+
+PyObject *musElementSequence(const QList<CAMusElement*>& elements) {
+    if (!CAPyMusElementListType.tp_name) {
+        CAPyMusElementListType.tp_name = "CanorusPython.CAMusElementList";
+        CAPyMusElementListType.tp_basicsize = sizeof(CAPyMusElementList);
+        CAPyMusElementListType.tp_dealloc = musElementListDealloc;
+        CAPyMusElementListType.tp_as_sequence = &musElementListSequence;
+        CAPyMusElementListType.tp_as_mapping = &musElementListMapping;
+        CAPyMusElementListType.tp_flags = Py_TPFLAGS_DEFAULT;
+        CAPyMusElementListType.tp_doc = "Read-only sequence of music elements";
+        if (PyType_Ready(&CAPyMusElementListType) < 0) {
+            return nullptr;
+        }
+    }
+
+    CAPyMusElementList *sequence = PyObject_New(CAPyMusElementList, &CAPyMusElementListType);
+    if (sequence) {
+        sequence->list = new QList<CAMusElement*>(elements);
+    }
+    return reinterpret_cast<PyObject*>(sequence);
+}
+
+template <typename T>
+PyObject *musElementSequence(const QList<T*>& elements) {
+    QList<CAMusElement*> list;
+    list.reserve(elements.size());
+    for (int i = 0; i < elements.size(); i++) {
+        list << elements[i];
+    }
+    return musElementSequence(list);
+}
+
 class QString;
 
 PyObject *CASwigPython::toPythonObject(void *object, CASwigPython::CAClassType type) {
@@ -381,33 +842,33 @@ PyObject *CASwigPython::toPythonObject(void *object, CASwigPython::CAClassType t
             break;
         }
         case CASwigPython::Document: {
-            pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CADocument, 0);
+            pyObj = cachedPointerObj(object, SWIGTYPE_p_CADocument);
             break;
         }
         case CASwigPython::Resource: {
-            pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CAResource, 0);
+            pyObj = cachedPointerObj(object, SWIGTYPE_p_CAResource);
             break;
         }
         case CASwigPython::Sheet: {
-            pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CASheet, 0);
+            pyObj = cachedPointerObj(object, SWIGTYPE_p_CASheet);
             break;
         }
         case CASwigPython::Context: {
             switch (static_cast<CAContext*>(object)->contextType()) {
             case CAContext::Staff:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CAStaff, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CAStaff);
                 break;
             case CAContext::LyricsContext:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CALyricsContext, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CALyricsContext);
                 break;
             case CAContext::FiguredBassContext:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CAFiguredBassContext, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CAFiguredBassContext);
                 break;
             case CAContext::FunctionMarkContext:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CAFunctionMarkContext, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CAFunctionMarkContext);
                 break;
             case CAContext::ChordNameContext:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CAChordNameContext, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CAChordNameContext);
                 break;
             default:
                 std::cerr << "canoruspython.i: Wrong CAContext::contextType()!" << std::endl;
@@ -416,53 +877,53 @@ PyObject *CASwigPython::toPythonObject(void *object, CASwigPython::CAClassType t
             break;
         }
         case CASwigPython::Voice: {
-            pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CAVoice, 0);
+            pyObj = cachedPointerObj(object, SWIGTYPE_p_CAVoice);
             break;
         }
         case CASwigPython::MusElement: {
             CAMusElement *elt = static_cast<CAMusElement*>(object);
             switch (elt->musElementType()) {
             case CAMusElement::Note:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CANote, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CANote);
                 break;
             case CAMusElement::Rest:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CARest, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CARest);
                 break;
             case CAMusElement::KeySignature:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CAKeySignature, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CAKeySignature);
                 break;
             case CAMusElement::TimeSignature:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CATimeSignature, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CATimeSignature);
                 break;
             case CAMusElement::Clef:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CAClef, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CAClef);
                 break;
             case CAMusElement::Barline:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CABarline, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CABarline);
                 break;
             case CAMusElement::FiguredBassMark:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CAFiguredBassMark, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CAFiguredBassMark);
                 break;
             case CAMusElement::FunctionMark:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CAFunctionMark, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CAFunctionMark);
                 break;
             case CAMusElement::Syllable:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CASyllable, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CASyllable);
                 break;
             case CAMusElement::Mark:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CAMark, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CAMark);
                 break;
             case CAMusElement::Slur:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CASlur, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CASlur);
                 break;
             case CAMusElement::Tuplet:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CATuplet, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CATuplet);
                 break;
             case CAMusElement::MidiNote:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CAMidiNote, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CAMidiNote);
                 break;
             case CAMusElement::ChordName:
-                pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CAChordName, 0);
+                pyObj = cachedPointerObj(object, SWIGTYPE_p_CAChordName);
                 break;
             default:
                 std::cerr << "canoruspython.i: Wrong CAMusElement::musElementType()!" << std::endl;
@@ -475,11 +936,11 @@ PyObject *CASwigPython::toPythonObject(void *object, CASwigPython::CAClassType t
             break;
         }
         case CASwigPython::PyConsoleInterface: {
-            pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CAPyConsoleInterface, 0);
+            pyObj = cachedPointerObj(object, SWIGTYPE_p_CAPyConsoleInterface);
             break;
         }
         case CASwigPython::Plugin: {
-            pyObj = SWIG_NewPointerObj(object, SWIGTYPE_p_CAPlugin, 0);
+            pyObj = cachedPointerObj(object, SWIGTYPE_p_CAPlugin);
             break;
         }
         default: {
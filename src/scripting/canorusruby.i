@@ -62,11 +62,211 @@
 	$1 = list;
 }
 
+// batch changes and bulk access, as in CanorusPython
+void beginBatch( CADocument *document=0, const char *undoText="" );
+void endBatch();
+VALUE appendNotes( CAVoice *voice, VALUE notes );
+VALUE eventArrays( CASheet *sheet );
+VALUE eventArrays( CAStaff *staff );
+VALUE eventArrays( CAVoice *voice );
+
 %include "scripting/canoruslibrary.i"
 
 %{	//toRubyObject() function
 #include "scripting/swigruby.h"	//needed for CAClassType
 
+#include <QList>
+#include <QVector>
+
+#include "core/eventstore.h"
+
+#ifndef SWIGCPP
+#include "canorus.h"
+#endif
+
+int batchDepth = 0; // number of open batches
+int batchUndoDepth = 0; // depth of the batch which created the undo command or 0
+CADocument *batchUndoDocument = nullptr;
+
+/*!
+    Starts a batch of changes. The GUI rebuilds requested until the matching endBatch() are merged
+    and done only once. If a \a document is given, a single undo command named \a undoText is
+    created for all the changes until the matching endBatch(). Use CanorusRuby.batch with a block
+    to end the batch also when the block raises.
+*/
+void beginBatch( CADocument *document, const char *undoText ) {
+    batchDepth++;
+#ifndef SWIGCPP
+    if (document && !batchUndoDocument && CACanorus::undo()->containsUndoStack(document)) {
+        QString text = QString::fromUtf8(undoText ? undoText : "");
+        CACanorus::undo()->createUndoCommand(document, text.isEmpty() ? QObject::tr("script", "undo") : text);
+        batchUndoDocument = document;
+        batchUndoDepth = batchDepth;
+    }
+
+    CACanorus::beginBatch();
+#else
+    (void)document;
+    (void)undoText;
+#endif
+}
+
+void endBatch() {
+    if (!batchDepth) {
+        return;
+    }
+
+#ifndef SWIGCPP
+    if (batchDepth == batchUndoDepth) {
+        CACanorus::undo()->pushUndoCommand();
+        CACanorus::rebuildUI(batchUndoDocument);
+        batchUndoDocument = nullptr;
+        batchUndoDepth = 0;
+    }
+
+    CACanorus::endBatch();
+#endif
+    batchDepth--;
+}
+
+bool rubyToPitch( VALUE value, CADiatonicPitch *pitch ) {
+    void *ptr = nullptr;
+    if (SWIG_IsOK(SWIG_ConvertPtr(value, &ptr, SWIGTYPE_p_CADiatonicPitch, 0)) && ptr) {
+        *pitch = *reinterpret_cast<CADiatonicPitch*>(ptr);
+    } else if (TYPE(value) == T_ARRAY && RARRAY_LEN(value) == 2 && FIXNUM_P(rb_ary_entry(value, 0)) && FIXNUM_P(rb_ary_entry(value, 1))) {
+        *pitch = CADiatonicPitch(FIX2INT(rb_ary_entry(value, 0)), FIX2INT(rb_ary_entry(value, 1)));
+    } else if (FIXNUM_P(value)) {
+        *pitch = CADiatonicPitch(FIX2INT(value));
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool rubyToLength( VALUE value, CAPlayableLength *length ) {
+    void *ptr = nullptr;
+    if (SWIG_IsOK(SWIG_ConvertPtr(value, &ptr, SWIGTYPE_p_CAPlayableLength, 0)) && ptr) {
+        *length = *reinterpret_cast<CAPlayableLength*>(ptr);
+    } else if (TYPE(value) == T_ARRAY && RARRAY_LEN(value) == 2 && FIXNUM_P(rb_ary_entry(value, 0)) && FIXNUM_P(rb_ary_entry(value, 1))) {
+        *length = CAPlayableLength(static_cast<CAPlayableLength::CAMusicLength>(FIX2INT(rb_ary_entry(value, 0))), FIX2INT(rb_ary_entry(value, 1)));
+    } else if (FIXNUM_P(value)) {
+        *length = CAPlayableLength(static_cast<CAPlayableLength::CAMusicLength>(FIX2INT(value)));
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/*!
+    Appends notes given by an array of [pitch, length] pairs to the \a voice. The pitch is a
+    CADiatonicPitch, a note name or a [note name, accidentals] array. The length is a
+    CAPlayableLength, a music length or a [music length, dots] array.
+
+    The notes are created and appended in C++ at once. Nothing is appended, if any item is
+    invalid. Returns the number of the appended notes.
+*/
+VALUE appendNotes( CAVoice *voice, VALUE notes ) {
+    Check_Type(notes, T_ARRAY);
+
+    long invalid = -1;
+    int appended = 0;
+    {
+        // the lists are destroyed before raising, Ruby exceptions don't unwind the C++ stack
+        long n = RARRAY_LEN(notes);
+        QList<CADiatonicPitch> pitches;
+        QList<CAPlayableLength> lengths;
+        pitches.reserve(n);
+        lengths.reserve(n);
+        for (long i = 0; i < n && invalid < 0; i++) {
+            VALUE item = rb_ary_entry(notes, i);
+            CADiatonicPitch pitch;
+            CAPlayableLength length;
+            if (TYPE(item) != T_ARRAY || RARRAY_LEN(item) != 2 || !rubyToPitch(rb_ary_entry(item, 0), &pitch) || !rubyToLength(rb_ary_entry(item, 1), &length)) {
+                invalid = i;
+            }
+            pitches << pitch;
+            lengths << length;
+        }
+
+        if (voice && invalid < 0) {
+            appended = voice->appendNotes(pitches, lengths).size();
+        }
+    }
+
+    if (invalid >= 0) {
+        rb_raise(rb_eTypeError, "appendNotes: item %ld is not a [pitch, length] array", invalid);
+    }
+    return INT2NUM(appended);
+}
+
+template <typename T>
+VALUE rubyIntArray( const QVector<T>& values ) {
+    VALUE array = rb_ary_new2(values.size());
+    for (int i = 0; i < values.size(); i++) {
+        rb_ary_push(array, INT2FIX(values[i]));
+    }
+    return array;
+}
+
+/*!
+    Returns the music elements of the \a voices as a hash of integer arrays, one row per element in
+    the order of the voices and their music element lists. The arrays are filled from a
+    CAEventStore snapshot without creating the wrappers of each element. The keys are the same as
+    in CanorusPython.eventArrays(): :time, :length, :pitch, :noteName, :accs, :channel, :flags,
+    :stream, :offsets and :voices.
+*/
+VALUE eventArrays( const QList<CAVoice*>& voices ) {
+    CAEventStore events;
+    events.build(voices);
+
+    QVector<int> stream(events.size());
+    QVector<int> noteName(events.size());
+    QVector<int> accs(events.size());
+    QVector<int> offsets;
+    for (int i = 0; i < events.streamCount(); i++) {
+        offsets << events.streamBegin(i);
+        for (int row = events.streamBegin(i); row < events.streamEnd(i); row++) {
+            stream[row] = i;
+            if (events.flags(row) & CAEventStore::Note) {
+                const CADiatonicPitch& pitch = static_cast<CANote*>(events.element(row))->diatonicPitch();
+                noteName[row] = pitch.noteName();
+                accs[row] = pitch.accs();
+            }
+        }
+    }
+    offsets << events.size();
+
+    VALUE voiceArray = rb_ary_new2(voices.size());
+    for (int i = 0; i < voices.size(); i++) {
+        rb_ary_push(voiceArray, CASwigRuby::toRubyObject(voices[i], CASwigRuby::Voice));
+    }
+
+    VALUE result = rb_hash_new();
+    rb_hash_aset(result, ID2SYM(rb_intern("voices")), voiceArray);
+    rb_hash_aset(result, ID2SYM(rb_intern("time")), rubyIntArray(events.times()));
+    rb_hash_aset(result, ID2SYM(rb_intern("length")), rubyIntArray(events.lengths()));
+    rb_hash_aset(result, ID2SYM(rb_intern("pitch")), rubyIntArray(events.pitches()));
+    rb_hash_aset(result, ID2SYM(rb_intern("noteName")), rubyIntArray(noteName));
+    rb_hash_aset(result, ID2SYM(rb_intern("accs")), rubyIntArray(accs));
+    rb_hash_aset(result, ID2SYM(rb_intern("channel")), rubyIntArray(events.channels()));
+    rb_hash_aset(result, ID2SYM(rb_intern("flags")), rubyIntArray(events.flagList()));
+    rb_hash_aset(result, ID2SYM(rb_intern("stream")), rubyIntArray(stream));
+    rb_hash_aset(result, ID2SYM(rb_intern("offsets")), rubyIntArray(offsets));
+    return result;
+}
+
+VALUE eventArrays( CASheet *sheet ) {
+    return eventArrays(sheet ? sheet->voiceList() : QList<CAVoice*>());
+}
+
+VALUE eventArrays( CAStaff *staff ) {
+    return eventArrays(staff ? staff->voiceList() : QList<CAVoice*>());
+}
+
+VALUE eventArrays( CAVoice *voice ) {
+    return eventArrays(voice ? QList<CAVoice*>() << voice : QList<CAVoice*>());
+}
+
 class QString;
 
 VALUE CASwigRuby::toRubyObject(void *object, CASwigRuby::CAClassType type) {
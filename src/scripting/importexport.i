@@ -23,6 +23,7 @@
 #include "export/canexport.h"
 #include "export/lilypondexport.h"
 #include "export/musicxmlexport.h"
+#include "export/mxlexport.h"
 #include "export/midiexport.h"
 #include "export/pdfexport.h"
 #include "export/svgexport.h"
@@ -45,6 +46,7 @@
 %include "export/canexport.h"
 %include "export/lilypondexport.h"
 %include "export/musicxmlexport.h"
+%include "export/mxlexport.h"
 %include "export/midiexport.h"
 %include "export/pdfexport.h"
 %include "export/svgexport.h"
@@ -21,7 +21,10 @@
 #include "score/diatonicpitch.h"
 #include "score/interval.h"
 #include "score/diatonickey.h"
+#include "core/progress.h"
 #include "core/transpose.h"
+#include "core/documentstatistics.h"
+#include "core/scoregenerator.h"
 
 #include "score/muselement.h"
 #include "score/playable.h"
@@ -38,6 +41,7 @@
 #include "score/rest.h"
 #include "score/midinote.h"
 #include "score/chordname.h"
+#include "score/motifindex.h"
 %}
 
 %include "score/document.h"
@@ -55,7 +59,10 @@
 %include "score/diatonicpitch.h"
 %include "score/interval.h"
 %include "score/diatonickey.h"
+%include "core/progress.h"
 %include "core/transpose.h"
+%include "core/documentstatistics.h"
+%include "core/scoregenerator.h"
 
 %include "score/muselement.h"
 %include "score/playable.h"
@@ -72,5 +79,6 @@
 %include "score/rest.h"
 %include "score/midinote.h"
 %include "score/chordname.h"
+%include "score/motifindex.h"
 
 %include "scripting/mark.i"
@@ -7,10 +7,13 @@
 
 #ifdef USE_PYTHON
 #include "scripting/swigpython.h"
+#include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
+#include <QEvent>
 #include <QFile>
 #include <QFileInfo>
+#include <QSemaphore>
 #include <QThread>
 
 #ifndef SWIGCPP
@@ -28,6 +31,47 @@ protected:
 
 PyThreadState* CASwigPython::mainThreadState;
 PyThreadState* CASwigPython::pycliThreadState;
+QHash<QString, CASwigPython::CAPythonModule> CASwigPython::_moduleCache;
+QObject* CASwigPython::_mainThreadInvoker = nullptr;
+
+namespace {
+
+QEvent::Type mainThreadCallType()
+{
+    static const QEvent::Type type = static_cast<QEvent::Type>(QEvent::registerEventType());
+    return type;
+}
+
+// Function posted by CASwigPython::callInMainThread(), the waiting thread is released when the event is destroyed
+class CAMainThreadCall : public QEvent {
+public:
+    CAMainThreadCall(std::function<void()> f, QSemaphore* d)
+        : QEvent(mainThreadCallType())
+        , function(f)
+        , done(d)
+    {
+    }
+    ~CAMainThreadCall() { done->release(); }
+
+    std::function<void()> function;
+    QSemaphore* done;
+};
+
+class CAMainThreadInvoker : public QObject {
+protected:
+    bool event(QEvent* e)
+    {
+        if (e->type() == mainThreadCallType()) {
+            static_cast<CAMainThreadCall*>(e)->function();
+            return true;
+        }
+        return QObject::event(e);
+    }
+};
+
+thread_local PyGILState_STATE workerGILState; // GIL state of the worker threads, see CASwigPython::lockGIL()
+
+}
 
 /// Load 'CanorusPython' module and initialize classes - defined in SWIG wrapper class
 extern "C" void PyInit__CanorusPython();
@@ -89,6 +133,90 @@ void CASwigPython::init()
     PyThreadState_Swap(mainThreadState);
 
     PyEval_ReleaseThread(mainThreadState);
+
+    if (QCoreApplication::instance()) {
+        _mainThreadInvoker = new CAMainThreadInvoker();
+        _mainThreadInvoker->moveToThread(QCoreApplication::instance()->thread());
+    }
+}
+
+/*!
+	Returns True, if called from the main (GUI) thread.
+*/
+bool CASwigPython::isMainThread()
+{
+    return !QCoreApplication::instance() || QThread::currentThread() == QCoreApplication::instance()->thread();
+}
+
+/*!
+	Acquires the GIL for the current thread. The main thread uses mainThreadState, worker threads
+	(eg. the console worker) get their own Python thread state.
+
+	\sa unlockGIL()
+*/
+void CASwigPython::lockGIL()
+{
+    if (isMainThread()) {
+        PyEval_RestoreThread(mainThreadState);
+    } else {
+        workerGILState = PyGILState_Ensure();
+    }
+}
+
+/*!
+	Releases the GIL acquired by lockGIL().
+*/
+void CASwigPython::unlockGIL()
+{
+    if (isMainThread()) {
+        PyEval_ReleaseThread(mainThreadState);
+    } else {
+        PyGILState_Release(workerGILState);
+    }
+}
+
+/*!
+	Returns the Python identifier of the calling thread used by interruptThread().
+*/
+unsigned long CASwigPython::currentThreadId()
+{
+    return PyThread_get_thread_ident();
+}
+
+/*!
+	Raises KeyboardInterrupt in the script run by the thread \a threadId (see currentThreadId()).
+	The script stops at its next bytecode, the native code it calls is not interrupted. Used to
+	cancel the plugin actions run by a worker thread.
+*/
+void CASwigPython::interruptThread(unsigned long threadId)
+{
+    lockGIL();
+    PyThreadState_SetAsyncExc(threadId, PyExc_KeyboardInterrupt);
+    unlockGIL();
+}
+
+/*!
+	Calls the given \a function in the main thread and waits until it returns. Scripts run by a
+	worker thread use this to change the score and the GUI.
+
+	If the GIL is held by the calling thread, it is released while waiting so the main thread can use
+	Python. The function is called directly, if called from the main thread.
+*/
+void CASwigPython::callInMainThread(std::function<void()> function)
+{
+    if (isMainThread() || !_mainThreadInvoker) {
+        function();
+        return;
+    }
+
+    QSemaphore done;
+    QCoreApplication::postEvent(_mainThreadInvoker, new CAMainThreadCall(function, &done));
+
+    PyThreadState* state = (PyGILState_Check() ? PyEval_SaveThread() : nullptr);
+    done.acquire();
+    if (state) {
+        PyEval_RestoreThread(state);
+    }
 }
 
 /*!
@@ -97,7 +225,12 @@ void CASwigPython::init()
 	\param fileName Absolute path to the filename of the script
 	\param function Function or method name.
 	\param args List of arguments in Python's PyObject pointer format. Use toPythonObject() to convert C++ classes to Python objects.
-	\param autoReload automatically reload module if it was imported before, defaults to false
+	\param autoReload reload the module, if the script was modified since it was imported, defaults to false
+
+	The imported modules and the resolved functions are cached, so frequently called actions don't
+	import the module and look up the function each time, see resolveFunction().
+
+	The function can also be called from a worker thread, the GIL is acquired by lockGIL().
 
 	\warning You have to add path of the plugin to Python path before, manually! This is usually done by CAPlugin::callAction("onInit").
 */
@@ -132,37 +265,11 @@ PyObject* CASwigPython::callFunction(QString fileName, QString function, QList<P
     for (int i = 0; i < args.size(); i++)
         PyTuple_SetItem(pyArgs, i, args[i]);
 
-    // Load module, if not yet
-    QString moduleName = fileName.left(fileName.lastIndexOf(".py"));
-    moduleName = moduleName.remove(0, moduleName.lastIndexOf("/") + 1);
-
-    PyEval_RestoreThread(CASwigPython::mainThreadState);
+    lockGIL();
 
-    PyObject* pyModule;
-    if (autoReload) {
-        PyObject* moduleDict = PyImport_GetModuleDict(); // borrowed ref.
-        PyObject* ourModuleName = PyBytes_FromString(static_cast<const char*>(moduleName.toStdString().c_str())); // new ref.
-        pyModule = PyDict_GetItem(moduleDict, ourModuleName); // borrowed ref.
-        //		Py_DECREF(ourModuleName); // -Matevz
-
-        if (pyModule == nullptr) // not imported yet
-            pyModule = PyImport_ImportModule(static_cast<const char*>(moduleName.toStdString().c_str()));
-        else
-            Py_XDECREF(PyImport_ReloadModule(pyModule)); // we don't need the reference returned from ReloadModule
-    } else {
-        pyModule = PyImport_ImportModule(static_cast<const char*>(moduleName.toStdString().c_str()));
-    }
-    if (PyErr_Occurred()) {
-        PyErr_Print();
-        PyEval_ReleaseThread(mainThreadState);
-        return nullptr;
-    }
-
-    // Get function object
-    PyObject* pyFunction = PyObject_GetAttrString(pyModule, static_cast<const char*>(function.toStdString().c_str()));
-    if (PyErr_Occurred()) {
-        PyErr_Print();
-        PyEval_ReleaseThread(mainThreadState);
+    PyObject* pyFunction = resolveFunction(fileName, function, autoReload);
+    if (!pyFunction) {
+        unlockGIL();
         return nullptr;
     }
 
@@ -174,21 +281,94 @@ PyObject* CASwigPython::callFunction(QString fileName, QString function, QList<P
         ret = PyEval_CallObject(pyFunction, nullptr);
     if (PyErr_Occurred()) {
         PyErr_Print();
-        PyEval_ReleaseThread(mainThreadState);
+        unlockGIL();
         return nullptr;
     }
 
-    //	Py_DECREF(pyFunction); // -Matevz
-    //	Py_DECREF(pyModule); // -Matevz
     /// \todo Crashes if uncommented?!
     //	Py_DECREF(pyArgs);
     //	for (int i=0; i<args.size(); i++)
     //		Py_DECREF(args[i]); // -Matevz
 
-    PyEval_ReleaseThread(mainThreadState);
+    unlockGIL();
     return ret;
 }
 
+/*!
+	Imports the module of the given script and resolves the \a function in advance, so the first
+	call of a frequently triggered action doesn't wait for the import.
+
+	Returns True, if the function was found, otherwise False.
+*/
+bool CASwigPython::preloadFunction(QString fileName, QString function)
+{
+    if (!QFile::exists(fileName))
+        return false;
+
+    lockGIL();
+    bool found = resolveFunction(fileName, function, false);
+    unlockGIL();
+
+    return found;
+}
+
+/*!
+	Returns the \a function of the module of the given script \a fileName (borrowed reference) or
+	null, if the module or the function cannot be loaded. Errors are printed.
+
+	The module is imported on the first call and the functions are looked up once and kept. If
+	\a autoReload is True, the module is reloaded only when the script was modified since it was last
+	loaded.
+
+	\warning GIL thread lock must be acquired before calling this function.
+*/
+PyObject* CASwigPython::resolveFunction(QString fileName, QString function, bool autoReload)
+{
+    QHash<QString, CAPythonModule>::iterator module = _moduleCache.find(fileName);
+
+    if (module == _moduleCache.end()) {
+        QString moduleName = fileName.left(fileName.lastIndexOf(".py"));
+        moduleName = moduleName.remove(0, moduleName.lastIndexOf("/") + 1);
+
+        PyObject* pyModule = PyImport_ImportModule(moduleName.toStdString().c_str()); // new ref., kept in the cache
+        if (!pyModule) {
+            PyErr_Print();
+            return nullptr;
+        }
+
+        CAPythonModule m = { pyModule, QFileInfo(fileName).lastModified(), QHash<QString, PyObject*>() };
+        module = _moduleCache.insert(fileName, m);
+    } else if (autoReload) {
+        QDateTime lastModified = QFileInfo(fileName).lastModified();
+        if (lastModified != module->lastModified) {
+            for (PyObject* f : module->functions) {
+                Py_DECREF(f);
+            }
+            module->functions.clear();
+
+            PyObject* reloaded = PyImport_ReloadModule(module->module); // the same module object
+            if (!reloaded) {
+                PyErr_Print();
+                return nullptr;
+            }
+            Py_DECREF(reloaded);
+            module->lastModified = lastModified;
+        }
+    }
+
+    PyObject* pyFunction = module->functions.value(function);
+    if (!pyFunction) {
+        pyFunction = PyObject_GetAttrString(module->module, function.toStdString().c_str()); // new ref., kept in the cache
+        if (!pyFunction) {
+            PyErr_Print();
+            return nullptr;
+        }
+        module->functions[function] = pyFunction;
+    }
+
+    return pyFunction;
+}
+
 /*!
 	Function for intializing python-CLI pycli, called asynchronously from 'callFunction' (it's a copy to avoid confusion)
 	temporary solution
@@ -265,6 +445,7 @@ void* CASwigPython::callPycli(void*)
 
     Python uses its wrapper classes over C++ objects. Use this function to create a Python wrapper object out of the C++ one of type \a type.
     See CAClassType for details on the types. This function uses SWIG internals and is injected inside swig CXX wrapper file.
+    The wrapper of an object still referenced in Python is returned again instead of creating a new one.
 
     \warning GIL thread lock must be acquired before calling this function.
 */
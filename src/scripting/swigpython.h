@@ -11,9 +11,13 @@
 
 #include <Python.h>
 
+#include <QDateTime>
+#include <QHash>
 #include <QList>
 #include <QString>
 
+#include <functional>
+
 class CASwigPython {
 public:
     enum CAClassType {
@@ -38,10 +42,29 @@ public:
 
     static void init();
     static PyObject* callFunction(QString fileName, QString function, QList<PyObject*> args, bool autoReload = false);
+    static bool preloadFunction(QString fileName, QString function);
     static void* callPycli(void*);
     static PyObject* toPythonObject(void* object, CAClassType type); // defined in scripting/canoruspython.i
 
+    static bool isMainThread();
+    static void lockGIL();
+    static void unlockGIL();
+    static unsigned long currentThreadId();
+    static void interruptThread(unsigned long threadId);
+    static void callInMainThread(std::function<void()> function);
+
     static PyThreadState *mainThreadState, *pycliThreadState;
+
+private:
+    struct CAPythonModule {
+        PyObject* module;
+        QDateTime lastModified; // modification time of the script when it was (re)loaded
+        QHash<QString, PyObject*> functions; // resolved functions of the module
+    };
+
+    static PyObject* resolveFunction(QString fileName, QString function, bool autoReload);
+    static QHash<QString, CAPythonModule> _moduleCache; // script file name -> imported module
+    static QObject* _mainThreadInvoker; // receives the calls of callInMainThread()
 };
 
 #endif /*SWIGPYTHON_H_*/
@@ -16,10 +16,34 @@
 /// Load 'CanorusRuby' module and initialize classes - defined in SWIG wrapper class
 extern "C" void Init_CanorusRuby();
 
+bool CASwigRuby::_initialized = false;
+
+/*!
+	Initializes Ruby and loads the CanorusRuby module. The interpreter is started when the first
+	Ruby plugin action is run, so the Python users don't pay for its startup. Does nothing, if Ruby
+	was already initialized.
+*/
 void CASwigRuby::init()
 {
+    if (_initialized)
+        return;
+    _initialized = true;
+
     ruby_init();
     Init_CanorusRuby();
+
+    // block version of beginBatch()/endBatch(), so the batch is ended also when the block raises
+    rb_eval_string("module CanorusRuby\n"
+                   "  def self.batch(document = nil, undoText = '')\n"
+                   "    beginBatch(document, undoText)\n"
+                   "    begin\n"
+                   "      yield\n"
+                   "    ensure\n"
+                   "      endBatch()\n"
+                   "    end\n"
+                   "  end\n"
+                   "end");
+
     // add path to scripts to Scripting path
     if (QDir::searchPaths("scripts").size())
         rb_eval_string((QString("$: << '") + QDir::searchPaths("scripts")[0] + "'").toStdString().c_str());
@@ -37,6 +37,7 @@ public:
     };
 
     static void init(); ///Initializes Ruby and loads base 'CanorusRuby' module. Call this before any other Ruby operations! Call this before calling toRubyObject() or any other conversation functions as well!
+    inline static bool isInitialized() { return _initialized; }
 
     /*!
 	 	 * Call an external Ruby function in the given module with the list of arguments and return its Ruby value.
@@ -57,6 +58,9 @@ public:
          * \return Pointer to the Ruby object in Ruby's VALUE format.
  		 */
     static VALUE toRubyObject(void* object, CAClassType type); //defined in scripting/canorusruby.i file
+
+private:
+    static bool _initialized; // init() was called
 };
 
 #endif /*SWIGRUBY_H_*/
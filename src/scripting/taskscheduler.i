@@ -0,0 +1,12 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+%{
+#include "core/taskscheduler.h"
+%}
+
+%include "core/taskscheduler.h"
@@ -8,19 +8,39 @@ import code, io, os, sys
 console = code.InteractiveConsole()
 devnull = open(os.devnull, 'r')
 
+# Streams the output to the Canorus console while the command is running.
+class ConsoleStream(io.TextIOBase):
+    def __init__(self, iface, stderr):
+        self.iface = iface
+        self.stderr = stderr
+
+    def write(self, text):
+        if text:
+            self.iface.bufferedOutput(text, self.stderr)
+        return len(text)
+
 # main is called every time user enters a text.
-def main(document, cmd):
+# It runs in the console's worker thread. If iface is given, the output is streamed to the console,
+# otherwise it is returned together with the prompt.
+def main(document, cmd, iface=None):
     console.locals['document'] = document
     console.locals['CanorusPython'] = CanorusPython
     oldStdin, oldStdout, oldStderr = sys.stdin, sys.stdout, sys.stderr
-    newStdout, newStderr = io.StringIO(), io.StringIO()
+    if iface:
+        newStdout, newStderr = ConsoleStream(iface, False), ConsoleStream(iface, True)
+    else:
+        newStdout, newStderr = io.StringIO(), io.StringIO()
     sys.stdin, sys.stdout, sys.stderr = devnull, newStdout, newStderr
 
-    if console.push(cmd):
-        # console requires more input.
-        prompt = "..."
-    else:
-        prompt = ">>>"
+    try:
+        if console.push(cmd):
+            # console requires more input.
+            prompt = "..."
+        else:
+            prompt = ">>>"
+    finally:
+        sys.stdin, sys.stdout, sys.stderr = oldStdin, oldStdout, oldStderr
 
-    sys.stdin, sys.stdout, sys.stderr = oldStdin, oldStdout, oldStderr
+    if iface:
+        return "%s " % prompt
     return "%s%s%s " % (newStdout.getvalue(), newStderr.getvalue(), prompt)
@@ -103,6 +103,9 @@ void CAActionStorage::storeActionsFromMainWindow(CAMainWin& mainWin)
     storeAction(mainWin.uiResourceView);
     storeAction(mainWin.uiInsertFBM);
     storeAction(mainWin.uiShowRuler);
+    storeAction(mainWin.uiFoldContext);
+    storeAction(mainWin.uiUnfoldContexts);
+    storeAction(mainWin.uiPerformancePanel);
     storeAction(mainWin.uiUndo->defaultAction());
     storeAction(mainWin.uiRedo->defaultAction());
     _actionDelegate = new CAActionDelegate(&mainWin);
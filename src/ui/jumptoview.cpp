@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2018, Matevž Jekovec, Canorus development team
+	Copyright (c) 2018-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -9,7 +9,27 @@
 #include "ui/mainwin.h"
 #include "widgets/scoreview.h"
 
-#include "layout/drawablebarline.h"
+#include "score/document.h"
+#include "score/motifindex.h"
+#include "score/sheet.h"
+#include "score/staff.h"
+#include "score/voice.h"
+
+namespace {
+
+const int HIT_VOICE_ROLE = Qt::UserRole;
+const int HIT_TIME_ROLE = Qt::UserRole + 1;
+
+}
+
+/*!
+	\class CAJumpToView
+	\brief Dialog for moving the view to a bar or to the occurrences of a motif
+
+	The motif is given by its intervals in semitones or by the notes selected in the current
+	view. All the sheets of the document are searched by CAMotifSearch and activating a hit
+	shows its sheet and selects its notes.
+*/
 
 CAJumpToView::CAJumpToView(CAMainWin* p)
     : QDialog(p)
@@ -26,6 +46,11 @@ void CAJumpToView::setupCustomUi()
 {
 }
 
+CAMainWin* CAJumpToView::mainWin()
+{
+    return dynamic_cast<CAMainWin*>(parent());
+}
+
 void CAJumpToView::show()
 {
     //	CAScoreView *v = static_cast<CAMainWin*>(parent())->currentScoreView();
@@ -36,23 +61,98 @@ void CAJumpToView::show()
 
 void CAJumpToView::accept()
 {
+    if (uiMotif->hasFocus()) { // return pressed in the motif field
+        on_uiFindMotif_clicked();
+        return;
+    }
+
     int barNumber = uiJumpToBarNum->text().toInt();
 
-    if (dynamic_cast<CAMainWin*>(parent()) && static_cast<CAMainWin*>(parent())->currentScoreView()) {
-        CAScoreView* v = static_cast<CAMainWin*>(parent())->currentScoreView();
-        QMap<int, CADrawableBarline*> dBarlineMap = v->computeBarlinePositions();
+    if (mainWin() && mainWin()->currentScoreView() && mainWin()->currentSheet()) {
+        CAScoreView* v = mainWin()->currentScoreView();
+        int time = mainWin()->currentSheet()->barTimeStart(barNumber);
+        double x = (time != -1 ? v->timeToCoords(time) : -1);
+        if (x < 0) { // no such bar or not laid out yet
+            return;
+        }
 
-        if (!dBarlineMap.isEmpty()) {
-            // if barNumber is outside barlines enumeration, take the first/last barline available
-            if (barNumber < dBarlineMap.firstKey() || barNumber >= dBarlineMap.lastKey()) {
-                return;
-            }
+        // shift the view
+        v->setWorldX(x - v->worldWidth() / 2.0);
+        v->repaint();
 
-            // shift the view
-            v->setWorldX(dBarlineMap[barNumber]->xPos() - v->worldWidth() / 2.0);
-            v->repaint();
+        QDialog::accept();
+    }
+}
+
+/*!
+	Searches the document for the motif and lists the hits.
+*/
+void CAJumpToView::on_uiFindMotif_clicked()
+{
+    uiMotifHits->clear();
+    if (!mainWin() || !mainWin()->document()) {
+        return;
+    }
+
+    if (uiMotif->text().trimmed().isEmpty()) {
+        _motifSearch.reset(new CAMotifSearch(mainWin()->currentScoreView() ? mainWin()->currentScoreView()->musElementSelection() : QList<CAMusElement*>(), uiMatchRhythm->isChecked()));
+    } else {
+        _motifSearch.reset(new CAMotifSearch(uiMotif->text()));
+    }
+
+    if (!_motifSearch->isValid()) {
+        uiMotifHits->addItem(tr("Select at least two notes or enter the intervals in semitones."));
+        return;
+    }
+
+    int hits = _motifSearch->search(mainWin()->document());
+    for (int i = 0; i < hits; i++) {
+        CAVoice* voice = _motifSearch->hitVoice(i);
+        int time = _motifSearch->hitTimeStart(i);
+
+        QListWidgetItem* item = new QListWidgetItem(tr("%1, %2, %3, bar %4").arg(voice->staff()->sheet()->name(), voice->staff()->name(), voice->name()).arg(voice->staff()->sheet()->barNumber(time)));
+        item->setData(HIT_VOICE_ROLE, QVariant::fromValue(static_cast<void*>(voice)));
+        item->setData(HIT_TIME_ROLE, time);
+        uiMotifHits->addItem(item);
+    }
+
+    if (!hits) {
+        uiMotifHits->addItem(tr("The motif was not found."));
+    }
+}
 
-            QDialog::accept();
+/*!
+	Shows the sheet of the activated hit and selects its notes. The search is repeated, so the
+	hit is only shown, if it wasn't edited meanwhile.
+*/
+void CAJumpToView::on_uiMotifHits_itemActivated(QListWidgetItem* item)
+{
+    if (!_motifSearch || !mainWin() || !mainWin()->document() || !item->data(HIT_VOICE_ROLE).isValid()) {
+        return;
+    }
+
+    void* voice = item->data(HIT_VOICE_ROLE).value<void*>();
+    int time = item->data(HIT_TIME_ROLE).toInt();
+
+    int hits = _motifSearch->search(mainWin()->document());
+    for (int i = 0; i < hits; i++) {
+        if (_motifSearch->hitVoice(i) != voice || _motifSearch->hitTimeStart(i) != time) {
+            continue;
         }
+
+        CAScoreView* v = mainWin()->showSheet(_motifSearch->hitVoice(i)->staff()->sheet());
+        if (v) {
+            QList<CAMusElement*> notes;
+            for (CANote* note : _motifSearch->hitNotes(i)) {
+                notes << note;
+            }
+            v->clearSelection();
+            v->addToSelection(notes);
+            v->zoomToSelection(true);
+            v->repaint();
+        }
+        return;
     }
+
+    delete item; // the hit is gone
 }
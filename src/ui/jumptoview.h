@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2018, Matevž Jekovec, Canorus development team
+	Copyright (c) 2018-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -10,9 +10,12 @@
 
 #include <QDialog>
 
+#include <memory>
+
 #include "ui_jumptoview.h"
 
 class CAMainWin;
+class CAMotifSearch;
 
 class CAJumpToView : public QDialog, private Ui::uiJumpToView {
     Q_OBJECT
@@ -24,8 +27,15 @@ public slots:
     void show();
     void accept();
 
+private slots:
+    void on_uiFindMotif_clicked();
+    void on_uiMotifHits_itemActivated(QListWidgetItem* item);
+
 private:
     void setupCustomUi();
+    CAMainWin* mainWin();
+
+    std::unique_ptr<CAMotifSearch> _motifSearch; // last motif search, repeated when a hit is activated
 };
 
 #endif /* JUMPTOVIEW_H_ */
@@ -10,12 +10,14 @@
 #include <Python.h>
 #endif
 
+#include <QApplication>
 #include <QCheckBox>
 #include <QComboBox>
 #include <QKeyEvent>
 #include <QMessageBox>
 #include <QMouseEvent>
 #include <QPoint>
+#include <QPushButton>
 #include <QSlider>
 #include <QString>
 #include <QTextStream>
@@ -26,6 +28,7 @@
 #include <QtGui>
 #include <iostream>
 #include <limits>
+#include <memory>
 
 #include "ui/actionstorage.h"
 #include "ui/jumptoview.h"
@@ -43,15 +46,19 @@
 #include "control/printctl.h"
 #include "control/resourcectl.h"
 
+#include "interface/audition.h"
 #include "interface/keybdinput.h"
 #include "interface/mididevice.h"
 #include "interface/playback.h"
+#include "interface/pluginaction.h"
+#include "interface/pluginfilter.h"
 #include "interface/pluginmanager.h"
 #include "interface/rtmididevice.h"
 
 #include "widgets/lcdnumber.h"
 #include "widgets/menutoolbutton.h"
 #include "widgets/midirecorderview.h"
+#include "widgets/performancepanel.h"
 #include "widgets/undotoolbutton.h"
 #ifdef QT_WEBENGINEWIDGETS_LIB
 #include "widgets/helpbrowser.h"
@@ -71,12 +78,18 @@
 #include "layout/drawablenote.h"
 #include "layout/drawablestaff.h"
 #include "layout/layoutengine.h"
+#include "layout/sheetlayout.h"
 
 #include "canorus.h"
+#include "core/actionlatency.h"
+#include "core/archive.h"
+#include "core/documentstatistics.h"
 #include "core/midirecorder.h"
 #include "core/mimedata.h"
 #include "core/muselementfactory.h"
+#include "core/sessionjournal.h"
 #include "core/settings.h"
+#include "core/trace.h"
 #include "core/undo.h"
 #include "score/articulation.h"
 #include "score/barline.h"
@@ -112,11 +125,15 @@
 #include "export/canexport.h"
 #include "export/canorusmlexport.h"
 #include "export/export.h"
+#include "export/exportsnapshot.h"
 #include "export/lilypondexport.h"
 #include "export/midiexport.h"
 #include "export/musicxmlexport.h"
+#include "export/mxlexport.h"
 #include "export/pdfexport.h"
 #include "export/svgexport.h"
+#include "export/audioexport.h"
+#include "export/vectorexport.h"
 #include "import/canimport.h"
 #include "import/canorusmlimport.h"
 #include "import/lilypondimport.h"
@@ -124,6 +141,10 @@
 #include "import/musicxmlimport.h"
 #include "import/mxlimport.h"
 
+const int CAMainWin::RAPID_ENTRY_INTERVAL = 500;
+const int CAMainWin::WARM_UP_INTERVAL = 500;
+const int CAMainWin::MAX_WARM_DRAWABLES = 100000;
+
 /*!
 	\class CAMainWin
 	\brief Canorus main window
@@ -151,6 +172,7 @@ CAMainWin::CAMainWin(QMainWindow* oParent)
     , _mainWinProgressCtl(this)
     , _playbackView(nullptr)
     , _repaintTimer(nullptr)
+    , _playingGeneration(-1)
     , _playback(nullptr)
 {
     setAttribute(Qt::WA_DeleteOnClose);
@@ -179,6 +201,20 @@ CAMainWin::CAMainWin(QMainWindow* oParent)
     connect(&_timeEditedTimer, SIGNAL(timeout()), this, SLOT(onTimeEditedTimerTimeout()));
     _timeEditedTimer.start(1000);
 
+    // Note checker runs once the edits settle and updates only the drawable errors
+    _noteCheckTimer.setSingleShot(true);
+    _noteCheckTimer.setInterval(200);
+    connect(&_noteCheckTimer, SIGNAL(timeout()), this, SLOT(onNoteCheckTimerTimeout()));
+    connect(&_chordAnalyzer, SIGNAL(chordNamesChanged(CASheet*)), this, SLOT(onChordNamesChanged(CASheet*)));
+
+    // Sheets of the hidden tabs are laid out one at a time, when the window is idle
+    _warmUpTimer.setSingleShot(true);
+    _warmUpTimer.setInterval(WARM_UP_INTERVAL);
+    connect(&_warmUpTimer, SIGNAL(timeout()), this, SLOT(onWarmUpTimerTimeout()));
+
+    _rapidEntryStaff = nullptr;
+    _rapidEntryCommand = nullptr;
+
     // Setup the midi keyboad input processing object
     _keybdInput = new CAKeybdInput(this);
 
@@ -188,9 +224,7 @@ CAMainWin::CAMainWin(QMainWindow* oParent)
     // Tools
     _midiRecorderView = nullptr;
 
-    _transposeView = new CATransposeView(this);
-    addDockWidget(Qt::RightDockWidgetArea, _transposeView);
-    _transposeView->hide();
+    _transposeView = nullptr; // created when first shown
 
     _jumpToView = new CAJumpToView(this);
 
@@ -198,6 +232,15 @@ CAMainWin::CAMainWin(QMainWindow* oParent)
 
     setDocument(nullptr);
     _poExp = nullptr;
+    qRegisterMetaType<CASheet*>("CASheet*"); // sheets are published from the import thread
+
+    // Journal the triggered actions, if the session is recorded
+    if (CASessionJournal::isRecording()) {
+        for (QAction* action : findChildren<QAction*>()) {
+            connect(action, &QAction::triggered, [action]() { CASessionJournal::recordAction(action->objectName()); });
+        }
+    }
+
     CACanorus::addMainWin(this);
 }
 
@@ -206,11 +249,10 @@ CAMainWin::~CAMainWin()
     delete _musElementFactory;
 
     if (document() && CACanorus::mainWinCount(document()) == 1) {
-        CACanorus::undo()->deleteUndoStack(document()); // delete undo stack when the last document deleted
-        delete document();
+        CACanorus::undo()->deleteUndoStackLater(document(), true); // delete undo stack when the last document deleted
     }
 
-    CACanorus::removeMainWin(this); // must be called *after* CACanorus::deleteUndoStack()
+    CACanorus::removeMainWin(this); // must be called *after* CAUndo::deleteUndoStackLater()
     if (_playback)
         delete _playback;
 
@@ -585,13 +627,18 @@ void CAMainWin::createCustomActions()
     uiFingeringOriginal->setObjectName("uiFingeringOriginal");
     uiFingeringOriginal->setToolTip(tr("Is the fingering original by a composer (usually written italic)", "fingering original checkbox"));
 
+    // Performance panel
+    uiPerformanceDock = new QDockWidget(tr("Performance"), this);
+    uiPerformanceDock->setObjectName("uiPerformanceDock");
+    uiPerformanceDock->setAllowedAreas(Qt::LeftDockWidgetArea | Qt::RightDockWidgetArea);
+    uiPerformanceDock->setWidget(new CAPerformancePanel(this, uiPerformanceDock));
+
     // User's guide and other Help
     uiHelpDock = new QDockWidget(tr("Help"), this);
     uiHelpDock->setAllowedAreas(Qt::LeftDockWidgetArea | Qt::RightDockWidgetArea);
     uiHelpDock->setMaximumWidth(400);
 #ifdef QT_WEBENGINEWIDGETS_LIB
-    uiHelpWidget = new CAHelpBrowser(uiHelpDock);
-    uiHelpDock->setWidget(uiHelpWidget);
+    uiHelpWidget = nullptr;
 #endif
 
 #ifdef USE_PYTHON
@@ -603,6 +650,45 @@ void CAMainWin::createCustomActions()
 #endif
 }
 
+#ifdef QT_WEBENGINEWIDGETS_LIB
+/*!
+	Returns the user's guide browser in the help dock. The web view is created when the help is
+	shown for the first time, most sessions never open it.
+*/
+CAHelpBrowser* CAMainWin::helpWidget()
+{
+    if (!uiHelpWidget) {
+        uiHelpWidget = new CAHelpBrowser(uiHelpDock);
+        uiHelpDock->setWidget(uiHelpWidget);
+    }
+    return uiHelpWidget;
+}
+#endif
+
+/*!
+	Returns the save dialog. The file dialogs are shared by all the main windows and created on
+	their first use, see CACanorus::saveDialog().
+*/
+QFileDialog* CAMainWin::saveDialog()
+{
+    return CACanorus::saveDialog();
+}
+
+QFileDialog* CAMainWin::openDialog()
+{
+    return CACanorus::openDialog();
+}
+
+QFileDialog* CAMainWin::exportDialog()
+{
+    return CACanorus::exportDialog();
+}
+
+QFileDialog* CAMainWin::importDialog()
+{
+    return CACanorus::importDialog();
+}
+
 /*!
 	Creates more complex widgets and layouts that cannot be created using Qt Designer (like adding
 	custom toolbars to main window, button boxes etc.).
@@ -691,6 +777,8 @@ void CAMainWin::setupCustomUi()
     uiStanzaNumberAction = uiContextToolBar->addWidget(uiStanzaNumber);
     uiAssociatedVoiceAction = uiContextToolBar->addWidget(uiAssociatedVoice);
     uiContextToolBar->addAction(uiRemoveContext);
+    uiContextToolBar->addAction(uiFreezeContext);
+    uiContextToolBar->addAction(uiFoldContext);
     uiContextToolBar->addAction(uiContextProperties);
     addToolBar(Qt::TopToolBarArea, uiContextToolBar);
 
@@ -814,6 +902,10 @@ void CAMainWin::setupCustomUi()
     // View
     uiShowRuler->setChecked(CACanorus::settings()->showRuler());
 
+    addDockWidget((qApp->isLeftToRight()) ? Qt::RightDockWidgetArea : Qt::LeftDockWidgetArea, uiPerformanceDock);
+    uiPerformanceDock->hide();
+    connect(uiPerformanceDock, SIGNAL(visibilityChanged(bool)), uiPerformancePanel, SLOT(setChecked(bool)));
+
     // Help
     addDockWidget((qApp->isLeftToRight()) ? Qt::RightDockWidgetArea : Qt::LeftDockWidgetArea, uiHelpDock);
     uiHelpDock->hide();
@@ -878,8 +970,7 @@ void CAMainWin::newDocument()
 
     // clear the data part
     if (document() && (CACanorus::mainWinCount(document()) == 1)) {
-        CACanorus::undo()->deleteUndoStack(document());
-        delete document();
+        CACanorus::undo()->deleteUndoStackLater(document(), true);
     }
 
     setDocument(new CADocument());
@@ -889,31 +980,35 @@ void CAMainWin::newDocument()
     restartTimeEditedTime();
 
 #ifdef USE_PYTHON
-    QList<PyObject*> argsPython;
-    PyEval_RestoreThread(CASwigPython::mainThreadState);
-    argsPython << CASwigPython::toPythonObject(document(), CASwigPython::Document);
-    PyEval_ReleaseThread(CASwigPython::mainThreadState);
-    CASwigPython::callFunction(QFileInfo("scripts:newdocument.py").absoluteFilePath(), "newDefaultDocument", argsPython);
-#else
-    // fallback: add basic sheet with two staffs
-    CASheet* sheet1 = document()->addSheet();
-    CAStaff* staff1 = sheet1->addStaff();
-    staff1->addVoice();
-    staff1->voiceList()[0]->setStemDirection(CANote::StemUp);
-    staff1->voiceList()[1]->setStemDirection(CANote::StemDown);
-    staff1->voiceList()[0]->append(new CAClef(CAClef::Treble, staff1, 0));
-    staff1->voiceList()[0]->append(new CATimeSignature(4, 4, staff1, 0));
-
-    CAStaff* staff2 = sheet1->addStaff();
-    staff2->addVoice();
-    staff2->voiceList()[0]->setStemDirection(CANote::StemUp);
-    staff2->voiceList()[1]->setStemDirection(CANote::StemDown);
-    staff2->voiceList()[0]->append(new CAClef(CAClef::Bass, staff2, 0));
-    staff2->voiceList()[0]->append(new CATimeSignature(4, 4, staff2, 0));
-
-    staff1->synchronizeVoices();
-    staff2->synchronizeVoices();
+    // Don't load the interpreter just for the default document. Use the script once it is loaded.
+    if (CACanorus::isScriptingInitialized()) {
+        QList<PyObject*> argsPython;
+        PyEval_RestoreThread(CASwigPython::mainThreadState);
+        argsPython << CASwigPython::toPythonObject(document(), CASwigPython::Document);
+        PyEval_ReleaseThread(CASwigPython::mainThreadState);
+        CASwigPython::callFunction(QFileInfo("scripts:newdocument.py").absoluteFilePath(), "newDefaultDocument", argsPython);
+    } else
 #endif
+    {
+        // fallback: add basic sheet with two staffs
+        CASheet* sheet1 = document()->addSheet();
+        CAStaff* staff1 = sheet1->addStaff();
+        staff1->addVoice();
+        staff1->voiceList()[0]->setStemDirection(CANote::StemUp);
+        staff1->voiceList()[1]->setStemDirection(CANote::StemDown);
+        staff1->voiceList()[0]->append(new CAClef(CAClef::Treble, staff1, 0));
+        staff1->voiceList()[0]->append(new CATimeSignature(4, 4, staff1, 0));
+
+        CAStaff* staff2 = sheet1->addStaff();
+        staff2->addVoice();
+        staff2->voiceList()[0]->setStemDirection(CANote::StemUp);
+        staff2->voiceList()[1]->setStemDirection(CANote::StemDown);
+        staff2->voiceList()[0]->append(new CAClef(CAClef::Bass, staff2, 0));
+        staff2->voiceList()[0]->append(new CATimeSignature(4, 4, staff2, 0));
+
+        staff1->synchronizeVoices();
+        staff2->synchronizeVoices();
+    }
 
     // call local rebuild only because no other main windows share the new document
     rebuildUI();
@@ -956,8 +1051,11 @@ bool CAMainWin::handleUnsavedChanges()
 /*!
 	This adds a tab to tabWidget and creates a single score View of the sheet.
 	It does not add the sheet to the document.
+
+	If \a select is False, the current tab is not changed. Use it when adding many sheets at once,
+	so the unloaded sheets are not loaded by showing them in turn.
 */
-void CAMainWin::addSheet(CASheet* s)
+void CAMainWin::addSheet(CASheet* s, bool select)
 {
     CAScoreView* v = new CAScoreView(s, nullptr);
     initView(v);
@@ -968,8 +1066,10 @@ void CAMainWin::addSheet(CASheet* s)
     _sheetMap[vpc] = s;
 
     uiTabWidget->addTab(vpc, s->name());
-    uiTabWidget->setCurrentIndex(uiTabWidget->count() - 1);
-    setCurrentViewContainer(vpc);
+    if (select) {
+        uiTabWidget->setCurrentIndex(uiTabWidget->count() - 1);
+        setCurrentViewContainer(vpc);
+    }
 
     updateToolBars();
 }
@@ -1019,9 +1119,40 @@ void CAMainWin::on_uiTabWidget_currentChanged(int)
     if (currentViewContainer())
         setCurrentView(currentViewContainer()->currentView());
 
+    // sheets of large documents are read when they are shown for the first time
+    CASheet* sheet = _sheetMap.value(currentViewContainer());
+    if (sheet && !sheet->isLoaded()) {
+        sheet->load();
+        if (document()) {
+            scheduleNoteCheck(sheet);
+        }
+    }
+
+    if (sheet) {
+        _recentSheets.removeAll(sheet);
+        _recentSheets.prepend(sheet);
+        _coldSheets.remove(sheet);
+    }
+    _warmUpTimer.start();
+
     updateToolBars();
 }
 
+/*!
+	Switches to the tab of the given \a sheet. Returns its current score view or null, if the
+	sheet isn't shown in this main window or its current view isn't a score view.
+*/
+CAScoreView* CAMainWin::showSheet(CASheet* sheet)
+{
+    CAViewContainer* vpc = _sheetMap.key(sheet);
+    if (!vpc) {
+        return nullptr;
+    }
+
+    uiTabWidget->setCurrentWidget(vpc);
+    return currentScoreView();
+}
+
 /*!
 	Appends a new sheet to the document.
 	This function is usually called when the user double clicks outside the tabs space.
@@ -1064,17 +1195,21 @@ void CAMainWin::on_uiHiddenRest_toggled(bool checked)
     if (mode() == InsertMode) {
         musElementFactory()->setRestType(checked ? CARest::Hidden : CARest::Normal);
     } else if (mode() == EditMode && currentScoreView() && currentScoreView()->selection().size()) {
-        CAScoreView* v = currentScoreView();
-        CACanorus::undo()->createUndoCommand(document(), tr("change hidden rest", "undo"));
-        for (int i = 0; i < v->selection().size(); i++) {
-            CARest* r = dynamic_cast<CARest*>(v->selection().at(i)->musElement());
+        QList<CAMusElement*> changed;
+        QList<CAMusElement*> selection = currentScoreView()->musElementSelection();
+        CACanorus::undo()->createUndoCommand(document(), tr("change hidden rest", "undo"), selectedStaff());
+        for (int i = 0; i < selection.size(); i++) {
+            CARest* r = dynamic_cast<CARest*>(selection[i]);
             if (r) {
                 r->setRestType(checked ? CARest::Hidden : CARest::Normal);
+                changed << r;
             }
         }
 
-        CACanorus::undo()->pushUndoCommand();
-        CACanorus::rebuildUI(document(), currentSheet());
+        if (changed.size()) {
+            CACanorus::undo()->pushUndoCommand();
+            rebuildChangedElements(changed);
+        }
     }
 }
 
@@ -1130,9 +1265,8 @@ void CAMainWin::on_uiCloseDocument_triggered()
             return;
         }
 
-        CACanorus::undo()->deleteUndoStack(document());
         clearUI();
-        delete document();
+        CACanorus::undo()->deleteUndoStackLater(document(), true);
     }
     setDocument(nullptr);
     uiCloseDocument->setEnabled(false);
@@ -1177,6 +1311,29 @@ void CAMainWin::on_uiShowRuler_toggled(bool checked)
     CACanorus::settings()->writeSettings();
 }
 
+/*!
+	Shows all the contexts folded in the current score view again.
+
+	\sa on_uiFoldContext_triggered()
+*/
+void CAMainWin::on_uiUnfoldContexts_triggered()
+{
+    if (currentScoreView()) {
+        currentScoreView()->showAllContexts();
+        updateToolBars();
+    }
+}
+
+/*!
+	Shows or hides the dock with the live timings of the editor.
+
+	\sa CAPerformancePanel
+*/
+void CAMainWin::on_uiPerformancePanel_toggled(bool checked)
+{
+    uiPerformanceDock->setVisible(checked);
+}
+
 /*!
 	Called when a floating view port is closed
 */
@@ -1297,6 +1454,30 @@ CAVoice* CAMainWin::currentVoice()
     return nullptr;
 }
 
+/*!
+	Returns the staff containing all the selected music elements in the current score view or 0, if
+	nothing is selected or the elements belong to different contexts.
+
+	\sa CAUndo::createUndoCommand()
+*/
+CAStaff* CAMainWin::selectedStaff()
+{
+    if (!currentScoreView() || currentScoreView()->selection().isEmpty()) {
+        return nullptr;
+    }
+
+    CAContext* context = nullptr;
+    for (int i = 0; i < currentScoreView()->selection().size(); i++) {
+        CAMusElement* elt = currentScoreView()->selection()[i]->musElement();
+        if (!elt || (i && elt->context() != context)) {
+            return nullptr;
+        }
+        context = elt->context();
+    }
+
+    return dynamic_cast<CAStaff*>(context);
+}
+
 /*!
 	Sets the currently selected voice and update toolbars and helpers accordingly.
 */
@@ -1319,10 +1500,21 @@ void CAMainWin::setCurrentVoice(CAVoice* v)
 */
 void CAMainWin::on_uiNewWindow_triggered()
 {
+    // The views of the new window attach to the layouts of the sheets already engraved for this
+    // window (see CASheetLayout). It is shown first, so the layout of the sheets in its hidden tabs
+    // is postponed until they are shown, if not current.
     CAMainWin* newMainWin = new CAMainWin();
     newMainWin->setDocument(document());
-    newMainWin->rebuildUI();
     newMainWin->show();
+    newMainWin->rebuildUI();
+
+    for (int i = 0; i < _viewContainerList.size() && i < newMainWin->_viewContainerList.size(); i++) {
+        CAView* v = _viewContainerList[i]->currentView();
+        CAView* newV = newMainWin->_viewContainerList[i]->currentView();
+        if (v && newV && v->viewType() == CAView::ScoreView && newV->viewType() == CAView::ScoreView) {
+            static_cast<CAScoreView*>(newV)->setWorldCoords(static_cast<CAScoreView*>(v)->worldCoords());
+        }
+    }
 }
 
 void CAMainWin::on_uiNewDocument_triggered()
@@ -1339,17 +1531,12 @@ void CAMainWin::on_uiUndo_toggled(bool, int row)
             curVoiceIdx = currentVoice()->staff()->sheet()->voiceList().indexOf(currentVoice());
         }
 
+        CACanorus::undo()->clearChangedSheets();
         for (int i = 0; i <= row; i++) {
             CACanorus::undo()->undo(document());
         }
 
-        if (CACanorus::settings()->useNoteChecker()) {
-            for (int i = 0; i < document()->sheetList().size(); i++) {
-                _noteChecker.checkSheet(document()->sheetList()[i]);
-            }
-        }
-
-        CACanorus::rebuildUI(document());
+        rebuildChangedSheets();
         if (curVoiceIdx >= 0 && curVoiceIdx < currentSheet()->voiceList().size()) {
             setCurrentVoice(currentSheet()->voiceList()[curVoiceIdx]);
         }
@@ -1365,17 +1552,12 @@ void CAMainWin::on_uiRedo_toggled(bool, int row)
             curVoiceIdx = currentVoice()->staff()->sheet()->voiceList().indexOf(currentVoice());
         }
 
+        CACanorus::undo()->clearChangedSheets();
         for (int i = 0; i <= row; i++) {
             CACanorus::undo()->redo(document());
         }
 
-        if (CACanorus::settings()->useNoteChecker()) {
-            for (int i = 0; i < document()->sheetList().size(); i++) {
-                _noteChecker.checkSheet(document()->sheetList()[i]);
-            }
-        }
-
-        CACanorus::rebuildUI(document(), nullptr);
+        rebuildChangedSheets();
 
         if (curVoiceIdx >= 0 && curVoiceIdx < currentSheet()->voiceList().size()) {
             setCurrentVoice(currentSheet()->voiceList()[curVoiceIdx]);
@@ -1383,6 +1565,36 @@ void CAMainWin::on_uiRedo_toggled(bool, int row)
     }
 }
 
+/*!
+	Checks and rebuilds the sheets changed by the last undo or redo. Views of the other sheets are
+	kept as they are, including their world coordinates, selection and current context.
+
+	\sa CAUndo::changedSheets()
+*/
+void CAMainWin::rebuildChangedSheets()
+{
+    QList<CASheet*> sheets;
+    for (int idx : CACanorus::undo()->changedSheets()) {
+        if (idx >= 0 && idx < document()->sheetList().size())
+            sheets << document()->sheetList()[idx];
+    }
+
+    for (CASheet* sheet : sheets) {
+        if (CACanorus::settings()->useNoteChecker()) {
+            _noteChecker.checkSheet(sheet);
+        }
+        _chordAnalyzer.analyze(sheet);
+        CACanorus::rebuildUI(document(), sheet);
+    }
+
+    // undo/redo buttons and toolbars of all the windows showing the document
+    QList<CAMainWin*> mainWinList = CACanorus::findMainWin(document());
+    for (int i = 0; sheets.isEmpty() && i < mainWinList.size(); i++) {
+        mainWinList[i]->updateWindowTitle();
+        mainWinList[i]->updateToolBars();
+    }
+}
+
 /*!
 	Enables or Disabled undo/redo buttons if there are undo/redo commands on the undo stack.
 
@@ -1399,6 +1611,9 @@ void CAMainWin::updateUndoRedoButtons()
         uiRedo->defaultAction()->setEnabled(true);
     else
         uiRedo->defaultAction()->setEnabled(false);
+
+    double usage = CACanorus::undo()->memoryUsage(document()) / (1024.0 * 1024.0);
+    uiUndo->defaultAction()->setToolTip(tr("Undo (history uses %1 MB)").arg(usage, 0, 'f', 1));
 }
 
 /*!
@@ -1619,6 +1834,20 @@ QString CAMainWin::createModeHash()
 	content are to happen and we want to actually draw it only at the end.
 */
 void CAMainWin::rebuildUI(CASheet* sheet, bool repaint)
+{
+    rebuildUI(sheet, -1, -1, repaint);
+}
+
+/*!
+	Rebuilds the GUI from data after a change in the given \a sheet between \a timeStart and \a timeEnd.
+
+	Score views showing the sheet re-engrave only the changed part of the score, if possible. Other
+	views are rebuilt as in rebuildUI(CASheet*, bool). If \a timeStart is negative, the score views are
+	completely rebuilt.
+
+	\sa CAScoreView::rebuildRegion()
+*/
+void CAMainWin::rebuildUI(CASheet* sheet, int timeStart, int timeEnd, bool repaint)
 {
     if (rebuildUILock())
         return;
@@ -1630,7 +1859,10 @@ void CAMainWin::rebuildUI(CASheet* sheet, bool repaint)
             if (sheet && _viewList[i]->viewType() == CAView::ScoreView && static_cast<CAScoreView*>(_viewList[i])->sheet() != sheet)
                 continue;
 
-            _viewList[i]->rebuild();
+            if (sheet && timeStart >= 0 && _viewList[i]->viewType() == CAView::ScoreView)
+                static_cast<CAScoreView*>(_viewList[i])->rebuildRegion(timeStart, timeEnd);
+            else
+                _viewList[i]->rebuild();
 
             if (_viewList[i]->viewType() == CAView::ScoreView)
                 static_cast<CAScoreView*>(_viewList[i])->checkScrollBars();
@@ -1651,6 +1883,9 @@ void CAMainWin::rebuildUI(CASheet* sheet, bool repaint)
         _resourceView->rebuildUi();
     }
 
+    if (document())
+        _warmUpTimer.start();
+
     updateWindowTitle();
     updateToolBars();
     setRebuildUILock(false);
@@ -1679,6 +1914,15 @@ void CAMainWin::rebuildUI(bool repaint)
     setRebuildUILock(true);
     if (document()) {
         int curIndex = uiTabWidget->currentIndex();
+        if (curIndex < 0) {
+            // new window of an opened document, show the sheet shown by the other window
+            QList<CAMainWin*> mainWins = CACanorus::findMainWin(document());
+            for (int i = 0; i < mainWins.size() && curIndex < 0; i++) {
+                if (mainWins[i] != this) {
+                    curIndex = mainWins[i]->uiTabWidget->currentIndex();
+                }
+            }
+        }
 
         // save the current state of Views
         QList<QRectF> worldCoordsList;
@@ -1688,13 +1932,17 @@ void CAMainWin::rebuildUI(bool repaint)
 
         clearUI();
         for (int i = 0; i < document()->sheetList().size(); i++) {
-            addSheet(document()->sheetList()[i]);
+            addSheet(document()->sheetList()[i], false);
 
             // restore the current state of Views
             if (_viewList[i]->viewType() == CAView::ScoreView && i < worldCoordsList.size())
                 static_cast<CAScoreView*>(_viewList[i])->setWorldCoords(worldCoordsList[i]);
         }
 
+        // select the tab first, so only the shown sheets are laid out
+        if (curIndex < uiTabWidget->count())
+            uiTabWidget->setCurrentIndex(curIndex);
+
         for (int i = 0; i < _viewList.size(); i++) {
             _viewList[i]->rebuild();
 
@@ -1704,9 +1952,6 @@ void CAMainWin::rebuildUI(bool repaint)
             if (repaint)
                 _viewList[i]->repaint();
         }
-
-        if (curIndex < uiTabWidget->count())
-            uiTabWidget->setCurrentIndex(curIndex);
     } else {
         clearUI();
     }
@@ -1715,6 +1960,9 @@ void CAMainWin::rebuildUI(bool repaint)
         _resourceView->rebuildUi();
     }
 
+    if (document())
+        _warmUpTimer.start();
+
     updateWindowTitle();
     updateToolBars();
     setRebuildUILock(false);
@@ -1729,6 +1977,17 @@ void CAMainWin::rebuildUI(bool repaint)
 void CAMainWin::scoreViewMousePress(QMouseEvent* e, const QPoint coords)
 {
     CAScoreView* v = static_cast<CAScoreView*>(sender());
+    CASessionJournal::recordMouse(CASessionJournal::MousePress, v, e, coords);
+
+    // clicking an element of the score being played continues the playback from there
+    if (_playback && _playbackView == v && mode() != InsertMode) {
+        QList<CADrawableMusElement*> elts = v->musElementsAt(coords.x(), coords.y());
+        if (elts.size() && elts[0]->musElement()) {
+            _playback->seek(elts[0]->musElement()->timeStart());
+            return;
+        }
+    }
+
     QList<CADrawableMusElement*> oldSelection = v->selection();
 
     CADrawableContext* prevContext = v->currentContext();
@@ -1948,6 +2207,7 @@ void CAMainWin::viewClicked()
 void CAMainWin::scoreViewMouseMove(QMouseEvent* e, QPoint coords)
 {
     CAScoreView* c = static_cast<CAScoreView*>(sender());
+    CASessionJournal::recordMouse(CASessionJournal::MouseMove, c, e, coords);
     c->setMouseTracking(false); // disable mouse move events until we finish with drawing
 
     if ((mode() == InsertMode && musElementFactory()->musElementType() == CAMusElement::Note)) {
@@ -1968,27 +2228,29 @@ void CAMainWin::scoreViewMouseMove(QMouseEvent* e, QPoint coords)
         int iNoteAccs = s->getAccs(coords.x(), pitch) + musElementFactory()->noteExtraAccs();
         musElementFactory()->setNoteAccs(iNoteAccs);
         c->setShadowNoteAccs(iNoteAccs);
-        c->updateHelpers();
-        c->repaint();
+        c->updateShadowNotes();
     } else if (mode() != InsertMode) {
         if (c->resizeDirection() != CADrawable::Undefined) {
             // resize element
             int time = c->coordsToTime(coords.x());
             time -= (time % CAPlayableLength::musicLengthToTimeLength(CAPlayableLength::Sixteenth)); // round timelength to eighth notes length
-            if (c->resizeDirection() == CADrawable::Right && (time > c->selection().at(0)->musElement()->timeStart())) {
-                c->selection().at(0)->musElement()->setTimeLength(time - c->selection().at(0)->musElement()->timeStart());
-                c->selection().at(0)->setWidth(c->timeToCoords(time) - c->selection().at(0)->xPos());
+            CADrawableMusElement* dElt = c->selection().at(0);
+            QRectF oldArea(dElt->xPos(), dElt->yPos(), dElt->width(), dElt->height());
+            if (c->resizeDirection() == CADrawable::Right && (time > dElt->musElement()->timeStart())) {
+                dElt->musElement()->setTimeLength(time - dElt->musElement()->timeStart());
+                dElt->setWidth(c->timeToCoords(time) - dElt->xPos());
+                c->invalidateTiles(oldArea.united(QRectF(dElt->xPos(), dElt->yPos(), dElt->width(), dElt->height())));
                 c->repaint();
-            } else if (c->resizeDirection() == CADrawable::Left && (time < c->selection().at(0)->musElement()->timeEnd())) {
-                c->selection().at(0)->musElement()->setTimeLength(c->selection().at(0)->musElement()->timeEnd() - time);
-                c->selection().at(0)->musElement()->setTimeStart(time);
-                c->selection().at(0)->setXPos(c->timeToCoords(time));
-                c->selection().at(0)->setWidth(c->timeToCoords(c->selection().at(0)->musElement()->timeEnd()) - c->timeToCoords(time));
+            } else if (c->resizeDirection() == CADrawable::Left && (time < dElt->musElement()->timeEnd())) {
+                dElt->musElement()->setTimeLength(dElt->musElement()->timeEnd() - time);
+                dElt->musElement()->setTimeStart(time);
+                dElt->setXPos(c->timeToCoords(time));
+                dElt->setWidth(c->timeToCoords(dElt->musElement()->timeEnd()) - c->timeToCoords(time));
+                c->invalidateTiles(oldArea.united(QRectF(dElt->xPos(), dElt->yPos(), dElt->width(), dElt->height())));
                 c->repaint();
             }
         } else if (e->buttons() == Qt::LeftButton && c->mouseDragActivated()) {
             // multiple selection
-            c->clearSelectionRegionList();
             int x = c->lastMousePressCoords().x(), y = c->lastMousePressCoords().y(),
                 w = coords.x() - c->lastMousePressCoords().x(), h = coords.y() - c->lastMousePressCoords().y();
             if (w < 0) {
@@ -2001,6 +2263,7 @@ void CAMainWin::scoreViewMouseMove(QMouseEvent* e, QPoint coords)
             } // user selected from bottom to top
             QRect selectionRect(x, y, w, h);
 
+            QList<QRect> regions;
             QList<CADrawableContext*> dcList = c->findContextsInRegion(selectionRect);
             for (int i = 0; i < dcList.size(); i++) {
                 QList<CADrawableMusElement*> musEltList = dcList[i]->findInRange(selectionRect.x(), selectionRect.x() + selectionRect.width());
@@ -2009,11 +2272,11 @@ void CAMainWin::scoreViewMouseMove(QMouseEvent* e, QPoint coords)
                         musEltList.removeAt(j--);
 
                 if (musEltList.size()) {
-                    c->addSelectionRegion(QRect(musEltList.front()->xPos(), dcList[i]->yPos(),
-                        musEltList.back()->xPos() + musEltList.back()->width() - musEltList.front()->xPos(), dcList[i]->height()));
+                    regions << QRect(musEltList.front()->xPos(), dcList[i]->yPos(),
+                        musEltList.back()->xPos() + musEltList.back()->width() - musEltList.front()->xPos(), dcList[i]->height());
                 }
             }
-            c->repaint();
+            c->setSelectionRegionList(regions); // only repaints the changed parts
         }
     }
     c->setMouseTracking(true); // re-enable mouse move events, we finished rendering
@@ -2025,8 +2288,9 @@ void CAMainWin::scoreViewMouseMove(QMouseEvent* e, QPoint coords)
 
 	\sa CAScoreView::selectAllCurBar()
  */
-void CAMainWin::scoreViewDoubleClick(QMouseEvent*, const QPoint)
+void CAMainWin::scoreViewDoubleClick(QMouseEvent* e, const QPoint coords)
 {
+    CASessionJournal::recordMouse(CASessionJournal::MouseDoubleClick, static_cast<CAScoreView*>(sender()), e, coords);
     if (mode() == EditMode) {
         static_cast<CAScoreView*>(sender())->selectAllCurBar();
         static_cast<CAScoreView*>(sender())->repaint();
@@ -2039,8 +2303,9 @@ void CAMainWin::scoreViewDoubleClick(QMouseEvent*, const QPoint)
 
 	\sa CAScoreView::selectAllCurContext()
  */
-void CAMainWin::scoreViewTripleClick(QMouseEvent*, const QPoint)
+void CAMainWin::scoreViewTripleClick(QMouseEvent* e, const QPoint coords)
 {
+    CASessionJournal::recordMouse(CASessionJournal::MouseTripleClick, static_cast<CAScoreView*>(sender()), e, coords);
     if (mode() == EditMode) {
         static_cast<CAScoreView*>(sender())->selectAllCurContext();
         static_cast<CAScoreView*>(sender())->repaint();
@@ -2056,6 +2321,7 @@ void CAMainWin::scoreViewTripleClick(QMouseEvent*, const QPoint)
 void CAMainWin::scoreViewMouseRelease(QMouseEvent* e, QPoint coords)
 {
     CAScoreView* v = static_cast<CAScoreView*>(sender());
+    CASessionJournal::recordMouse(CASessionJournal::MouseRelease, v, e, coords);
     if (v->resizeDirection() != CADrawable::Undefined) {
         CACanorus::undo()->pushUndoCommand();
         CACanorus::rebuildUI(document(), v->sheet());
@@ -2156,6 +2422,7 @@ void CAMainWin::scoreViewWheel(QWheelEvent* e, QPoint coords)
 void CAMainWin::scoreViewKeyPress(QKeyEvent* e)
 {
     CAScoreView* v = static_cast<CAScoreView*>(sender());
+    CASessionJournal::recordKey(v, e);
     setCurrentView(v);
 
     // go to Insert mode (if in Select mode) before changing note length
@@ -2200,7 +2467,7 @@ void CAMainWin::scoreViewKeyPress(QKeyEvent* e)
             }
         }
 
-        CACanorus::undo()->createUndoCommand(document(), tr("insert barline", "undo"));
+        CACanorus::undo()->createUndoCommand(document(), tr("insert barline", "undo"), (!currentVoice() || currentVoice()->staff() == staff) ? staff : nullptr);
         CABarline* bar = new CABarline(
             CABarline::Single,
             staff,
@@ -2217,9 +2484,7 @@ void CAMainWin::scoreViewKeyPress(QKeyEvent* e)
 
         staff->synchronizeVoices();
 
-        if (CACanorus::settings()->useNoteChecker()) {
-            _noteChecker.checkSheet(v->sheet());
-        }
+        scheduleNoteCheck(v->sheet());
 
         CACanorus::undo()->pushUndoCommand();
         CACanorus::rebuildUI(document(), v->sheet());
@@ -2232,7 +2497,7 @@ void CAMainWin::scoreViewKeyPress(QKeyEvent* e)
         if ((mode() == InsertMode) || (mode() == EditMode)) {
             bool rebuild = false;
             if (v->selection().size())
-                CACanorus::undo()->createUndoCommand(document(), tr("rise note", "undo"));
+                CACanorus::undo()->createUndoCommand(document(), tr("rise note", "undo"), selectedStaff());
 
             QList<CAMusElement*> eltList;
             for (int i = 0; i < v->selection().size(); i++) {
@@ -2267,7 +2532,7 @@ void CAMainWin::scoreViewKeyPress(QKeyEvent* e)
         if ((mode() == InsertMode) || (mode() == EditMode)) {
             //bool rebuild = false;
             if (v->selection().size())
-                CACanorus::undo()->createUndoCommand(document(), tr("lower note", "undo"));
+                CACanorus::undo()->createUndoCommand(document(), tr("lower note", "undo"), selectedStaff());
 
             QList<CAMusElement*> eltList;
             for (int i = 0; i < v->selection().size(); i++) {
@@ -2337,10 +2602,11 @@ void CAMainWin::scoreViewKeyPress(QKeyEvent* e)
                     if (elt->musElementType() == CAMusElement::Note) {
                         if (!sheet) {
                             sheet = static_cast<CANote*>(elt)->voice()->staff()->sheet();
-                            CACanorus::undo()->createUndoCommand(document(), tr("add sharp", "undo"));
+                            CACanorus::undo()->createUndoCommand(document(), tr("add sharp", "undo"), selectedStaff());
                         }
-                        if (static_cast<CANote*>(elt)->diatonicPitch().accs() < 2) // limit the amount of accidentals
-                            static_cast<CANote*>(elt)->diatonicPitch().setAccs(static_cast<CANote*>(elt)->diatonicPitch().accs() + 1);
+                        CANote* note = static_cast<CANote*>(elt);
+                        if (note->diatonicPitch().accs() < 2) // limit the amount of accidentals
+                            note->setDiatonicPitch(CADiatonicPitch(note->diatonicPitch().noteName(), note->diatonicPitch().accs() + 1), false);
                     }
                     eltList << elt;
                 }
@@ -2372,10 +2638,11 @@ void CAMainWin::scoreViewKeyPress(QKeyEvent* e)
                     if (elt->musElementType() == CAMusElement::Note) {
                         if (!sheet) {
                             sheet = static_cast<CANote*>(elt)->voice()->staff()->sheet();
-                            CACanorus::undo()->createUndoCommand(document(), tr("add flat", "undo"));
+                            CACanorus::undo()->createUndoCommand(document(), tr("add flat", "undo"), selectedStaff());
                         }
-                        if (static_cast<CANote*>(elt)->diatonicPitch().accs() > -2) // limit the amount of accidentals
-                            static_cast<CANote*>(elt)->diatonicPitch().setAccs(static_cast<CANote*>(elt)->diatonicPitch().accs() - 1);
+                        CANote* note = static_cast<CANote*>(elt);
+                        if (note->diatonicPitch().accs() > -2) // limit the amount of accidentals
+                            note->setDiatonicPitch(CADiatonicPitch(note->diatonicPitch().noteName(), note->diatonicPitch().accs() - 1), false);
                     }
                     eltList << elt;
                 }
@@ -2397,11 +2664,10 @@ void CAMainWin::scoreViewKeyPress(QKeyEvent* e)
         if (mode() == InsertMode) {
             musElementFactory()->addPlayableDotted(1, musElementFactory()->playableLength());
             currentScoreView()->setShadowNoteLength(musElementFactory()->playableLength());
-            currentScoreView()->updateHelpers();
-            v->repaint();
+            currentScoreView()->updateShadowNotes();
         } else if (mode() == EditMode) {
             if (!(static_cast<CAScoreView*>(v))->selection().isEmpty()) {
-                CACanorus::undo()->createUndoCommand(document(), tr("set dotted", "undo"));
+                CACanorus::undo()->createUndoCommand(document(), tr("set dotted", "undo"), selectedStaff());
                 CAPlayable* p = dynamic_cast<CAPlayable*>(currentScoreView()->selection().front()->musElement());
 
                 if (p) {
@@ -2441,16 +2707,12 @@ void CAMainWin::scoreViewKeyPress(QKeyEvent* e)
                             p->voice()->insert(next, rests[i]); // insert rests from shortest to longest
                         }
                     } else {
-                        p->staff()->synchronizeVoices();
+                        p->staff()->synchronizeVoices(p->timeStart());
                     }
 
-                    for (int j = 0; j < p->voice()->lyricsContextList().size(); j++) { // reposit syllables
-                        p->voice()->lyricsContextList().at(j)->repositSyllables();
-                    }
+                    p->voice()->staff()->sheet()->repositContexts(p->timeStart());
 
-                    if (CACanorus::settings()->useNoteChecker()) {
-                        _noteChecker.checkSheet(v->sheet());
-                    }
+                    scheduleNoteCheck(v->sheet());
 
                     CACanorus::undo()->pushUndoCommand();
                     CACanorus::rebuildUI(document(), p->staff()->sheet());
@@ -2571,8 +2833,7 @@ void CAMainWin::scoreViewKeyPress(QKeyEvent* e)
     if (e->key() >= Qt::Key_0 && e->key() <= Qt::Key_9 && e->key() != Qt::Key_3) {
         musElementFactory()->playableLength().setDotted(0);
         v->setShadowNoteLength(musElementFactory()->playableLength());
-        v->updateHelpers();
-        v->repaint();
+        v->updateShadowNotes();
     }
 
     updateToolBars();
@@ -2604,10 +2865,14 @@ bool CAMainWin::insertMusElementAt(const QPoint coords, CAScoreView* v)
 
     bool success = false;
 
-    if (!drawableContext)
+    if (!drawableContext || isFrozen(drawableContext->context()))
         return false;
 
-    CACanorus::undo()->createUndoCommand(document(), tr("insertion of music element", "undo"));
+    // notes and rests are inserted into the current voice only, other elements might affect other contexts
+    bool singleStaff = (musElementFactory()->musElementType() == CAMusElement::Note || musElementFactory()->musElementType() == CAMusElement::Rest) && staff && currentVoice() && currentVoice()->staff() == staff;
+    bool rapidEntry = singleStaff && continuesRapidEntry(staff);
+    if (!rapidEntry)
+        CACanorus::undo()->createUndoCommand(document(), tr("insertion of music element", "undo"), singleStaff ? staff : nullptr);
 
     switch (musElementFactory()->musElementType()) {
     case CAMusElement::Clef: {
@@ -2941,11 +3206,26 @@ bool CAMainWin::insertMusElementAt(const QPoint coords, CAScoreView* v)
         if (staff)
             staff->synchronizeVoices();
 
-        CACanorus::undo()->pushUndoCommand();
-        if (CACanorus::settings()->useNoteChecker()) {
-            _noteChecker.checkSheet(v->sheet());
+        if (rapidEntry) {
+            // the undo command of the first entry in the run covers this one as well
+            document()->setModified(true);
+            document()->updateGeneration();
+        } else {
+            CACanorus::undo()->pushUndoCommand();
         }
-        CACanorus::rebuildUI(document(), v->sheet());
+
+        if (singleStaff) {
+            QList<CAUndoCommand*>* stack = CACanorus::undo()->undoStack(document());
+            _rapidEntryStaff = staff;
+            _rapidEntryCommand = stack->at(CACanorus::undo()->undoIndex(document()));
+            _rapidEntryTimer.start();
+        } else {
+            _rapidEntryStaff = nullptr;
+        }
+
+        // only the bars around the new element need to be engraved again
+        CACanorus::rebuildUI(document(), v->sheet(), musElementFactory()->musElement()->timeStart(), musElementFactory()->musElement()->timeEnd());
+        scheduleNoteCheck(v->sheet());
         CADrawableMusElement* d = v->selectMElement(musElementFactory()->musElement());
         musElementFactory()->emptyMusElem();
 
@@ -2992,6 +3272,175 @@ void CAMainWin::onTimeEditedTimerTimeout()
     _timeEditedTime++;
 }
 
+/*!
+	Returns True, if inserting a note or rest into the given \a staff continues the run of entries
+	into the same staff, so no new undo command is needed.
+
+	This is the case when the previous entry was made less than RAPID_ENTRY_INTERVAL ago, for
+	example by holding a key, and its undo command is still the last one on the undo stack. Undoing
+	then removes the whole run at once.
+*/
+bool CAMainWin::continuesRapidEntry(CAStaff* staff)
+{
+    if (!_rapidEntryStaff || _rapidEntryStaff != staff || _rapidEntryTimer.elapsed() > RAPID_ENTRY_INTERVAL)
+        return false;
+
+    if (!CACanorus::undo()->containsUndoStack(document()) || CACanorus::undo()->canRedo(document()))
+        return false;
+
+    QList<CAUndoCommand*>* stack = CACanorus::undo()->undoStack(document());
+    int index = CACanorus::undo()->undoIndex(document());
+    return (index >= 0 && index < stack->size() && stack->at(index) == _rapidEntryCommand);
+}
+
+/*!
+	Checks the given \a sheet with the note checker after the current edit, if the note checker is
+	enabled, and derives its chord names. Edits following each other shortly are checked together.
+
+	\sa onNoteCheckTimerTimeout()
+*/
+void CAMainWin::scheduleNoteCheck(CASheet* sheet)
+{
+    if (!sheet)
+        return;
+
+    _noteCheckSheets << sheet;
+    _noteCheckTimer.start();
+}
+
+/*!
+	Runs the note checker and the chord analyzer on the sheets scheduled by scheduleNoteCheck().
+	When the errors change, only the drawable errors of the score views are replaced, the sheet
+	isn't laid out again. The chord names are shown by onChordNamesChanged() once analyzed.
+*/
+void CAMainWin::onNoteCheckTimerTimeout()
+{
+    QSet<CASheet*> sheets = _noteCheckSheets;
+    _noteCheckSheets.clear();
+    if (!document())
+        return;
+
+    for (int i = 0; i < document()->sheetList().size(); i++) {
+        CASheet* sheet = document()->sheetList()[i];
+        if (!sheets.contains(sheet))
+            continue; // the scheduled sheets might have been removed meanwhile
+
+        _chordAnalyzer.analyze(sheet);
+        if (!CACanorus::settings()->useNoteChecker() || !_noteChecker.checkSheet(sheet))
+            continue;
+
+        for (int j = 0; j < _viewList.size(); j++) {
+            if (_viewList[j]->viewType() == CAView::ScoreView && static_cast<CAScoreView*>(_viewList[j])->sheet() == sheet) {
+                static_cast<CAScoreView*>(_viewList[j])->updateNoteCheckerErrors();
+                _viewList[j]->repaint();
+            }
+        }
+    }
+}
+
+/*!
+	Lays out the sheet of one hidden tab postponed by the score view and restarts the timer for the
+	next one, so switching the tabs is instant. The sheets shown last are laid out first. The drawable
+	elements of the hidden sheets are limited to MAX_WARM_DRAWABLES, see releaseColdLayouts().
+
+	\sa CAScoreView::warmUpLayout()
+*/
+void CAMainWin::onWarmUpTimerTimeout()
+{
+    if (!document() || !isVisible() || rebuildUILock())
+        return;
+
+    if (releaseColdLayouts(nullptr) >= MAX_WARM_DRAWABLES)
+        return;
+
+    QList<CASheet*> sheets = sheetsByUse();
+    for (int i = 0; i < sheets.size(); i++) {
+        CAScoreView* v = hiddenScoreView(sheets[i]);
+        if (v && !_coldSheets.contains(sheets[i]) && v->warmUpLayout()) {
+            releaseColdLayouts(sheets[i]);
+            _warmUpTimer.start();
+            return;
+        }
+    }
+}
+
+/*!
+	Returns the sheets of the document, the ones shown last first.
+*/
+QList<CASheet*> CAMainWin::sheetsByUse()
+{
+    QList<CASheet*> sheets;
+    for (int i = 0; i < _recentSheets.size(); i++) {
+        if (document()->sheetList().contains(_recentSheets[i]))
+            sheets << _recentSheets[i];
+    }
+    _recentSheets = sheets; // forget the removed sheets
+    _coldSheets.intersect(QSet<CASheet*>::fromList(document()->sheetList()));
+
+    for (int i = 0; i < document()->sheetList().size(); i++) {
+        if (!sheets.contains(document()->sheetList()[i]))
+            sheets << document()->sheetList()[i];
+    }
+
+    return sheets;
+}
+
+/*!
+	Returns the score view of the given \a sheet in this main window or null, if the sheet isn't
+	shown here or any of its views is visible, also in other main windows.
+*/
+CAScoreView* CAMainWin::hiddenScoreView(CASheet* sheet)
+{
+    for (int i = 0; i < _viewList.size(); i++) {
+        if (_viewList[i]->viewType() == CAView::ScoreView && static_cast<CAScoreView*>(_viewList[i])->sheet() == sheet) {
+            CAScoreView* v = static_cast<CAScoreView*>(_viewList[i]);
+            return v->isLayoutVisible() ? nullptr : v;
+        }
+    }
+
+    return nullptr;
+}
+
+/*!
+	Releases the layouts of the hidden sheets shown least recently, until their drawable elements fit
+	into MAX_WARM_DRAWABLES. The layout of the \a keep sheet is never released. The released sheets
+	aren't laid out in the background again until they are shown. Returns the number of the drawable
+	elements left for the hidden sheets.
+*/
+int CAMainWin::releaseColdLayouts(CASheet* keep)
+{
+    QList<CASheet*> sheets = sheetsByUse();
+    QList<CAScoreView*> warmViews;
+    int warmDrawables = 0;
+    for (int i = 0; i < sheets.size(); i++) {
+        CAScoreView* v = hiddenScoreView(sheets[i]);
+        if (v && v->isLayoutAttached()) {
+            warmViews << v;
+            warmDrawables += v->sheetLayout()->drawableCount();
+        }
+    }
+
+    for (int i = warmViews.size() - 1; i >= 0 && warmDrawables > MAX_WARM_DRAWABLES; i--) {
+        int count = warmViews[i]->sheetLayout()->drawableCount();
+        if (warmViews[i]->sheet() != keep && warmViews[i]->releaseLayout()) {
+            _coldSheets << warmViews[i]->sheet();
+            warmDrawables -= count;
+        }
+    }
+
+    return warmDrawables;
+}
+
+/*!
+	Shows the chord names of the \a sheet derived by the chord analyzer.
+*/
+void CAMainWin::onChordNamesChanged(CASheet* sheet)
+{
+    if (document() && document()->sheetList().contains(sheet)) {
+        CACanorus::rebuildUI(document(), sheet);
+    }
+}
+
 /*!
 	Called when playback is finished or interrupted by the user.
 	It stops the playback, closes ports etc.
@@ -3008,14 +3457,11 @@ void CAMainWin::playbackFinished()
 
     if (_repaintTimer) {
         _repaintTimer->stop();
-        /// \todo crashes, if disconnected sometimes. -Matevz
-        //_repaintTimer->disconnect();
-        /// \todo crashes, if deleted. -Matevz
-        //delete _repaintTimer;
     }
     CACanorus::midiDevice()->closeOutputPort();
 
     if (_playbackView) {
+        static_cast<CAScoreView*>(_playbackView)->setPlaybackCursor(QList<CAMusElement*>());
         static_cast<CAScoreView*>(_playbackView)->clearSelection();
         static_cast<CAScoreView*>(_playbackView)->addToSelection(_prePlaybackSelection);
         static_cast<CAScoreView*>(_playbackView)->unsetBorder();
@@ -3032,13 +3478,16 @@ void CAMainWin::playbackFinished()
 void CAMainWin::on_uiPlayFromSelection_toggled(bool checked)
 {
     if (checked && currentScoreView() && !_playback) {
-        /// \todo replace raw pointer with shared or unique pointer
-        _repaintTimer = new QTimer();
-        _repaintTimer->setInterval(100);
+        if (!_repaintTimer) {
+            _repaintTimer = new QTimer(this);
+            connect(_repaintTimer, SIGNAL(timeout()), this, SLOT(onRepaintTimerTimeout()));
+        }
+        qreal refreshRate = QGuiApplication::primaryScreen()->refreshRate();
+        _repaintTimer->setInterval(qMax(1, qRound(1000 / (refreshRate > 0 ? refreshRate : 60))));
         _repaintTimer->start();
-        //connect(_repaintTimer, SIGNAL(timeout()), this, SLOT(on_repaintTimer_timeout())); //TODO: timeout is connected directly to repaint() directly. This should be optimized in the future -Matevz
-        connect(_repaintTimer, SIGNAL(timeout()), this, SLOT(onRepaintTimerTimeout()));
+        _playingGeneration = -1;
 
+        CACanorus::audition()->stop();
         CACanorus::midiDevice()->openOutputPort(CACanorus::settings()->midiOutPort());
         /// \todo replace raw pointer with shared or unique pointer
         _playback = new CAPlayback(currentSheet(), CACanorus::midiDevice());
@@ -3059,6 +3508,7 @@ void CAMainWin::on_uiPlayFromSelection_toggled(bool checked)
         _prePlaybackSelection = currentScoreView()->selection();
         currentScoreView()->clearSelection();
 
+        _playback->timeline(); // compiled here, the playback thread only reads the timeline
         _playback->start();
     } else if (_playback) {
         _playback->stop();
@@ -3066,25 +3516,36 @@ void CAMainWin::on_uiPlayFromSelection_toggled(bool checked)
 }
 
 /*!
-	Called every few miliseconds during playback to repaint score View as the GUI can
-	only be repainted from the main thread.
+	Called at the display refresh rate during playback to move the playback cursor, as the GUI can
+	only be repainted from the main thread. The score view only repaints the notes which started or
+	stopped playing since the last call.
 */
 void CAMainWin::onRepaintTimerTimeout()
 {
+    if (!_playback || !_playbackView || _playback->playingGeneration() == _playingGeneration)
+        return;
+
+    _playingGeneration = _playback->playingGeneration();
+    QList<CAPlayable*> playing = _playback->curPlaying();
+
+    QList<CAMusElement*> notes;
+    for (int i = 0; i < playing.size(); i++) {
+        if (playing[i]->musElementType() == CAMusElement::Note)
+            notes << playing[i];
+    }
+
     CAScoreView* sv = static_cast<CAScoreView*>(_playbackView);
-    sv->clearSelection();
-    for (int i = 0; i < _playback->curPlaying().size(); i++) {
-        if (_playback->curPlaying().at(i)->musElementType() == CAMusElement::Note) {
-            CADrawableMusElement* elt = sv->addToSelection(_playback->curPlaying()[i]);
-            if (CACanorus::settings()->lockScrollPlayback()) {
-                if (elt && (elt->xPos() > (sv->worldX() + sv->worldWidth()) || elt->xPos() < sv->worldX())) {
-                    sv->setWorldX(elt->xPos() - 50, CACanorus::settings()->animatedScroll());
-                }
+    sv->setPlaybackCursor(notes);
+
+    if (CACanorus::settings()->lockScrollPlayback()) {
+        for (int i = 0; i < notes.size(); i++) {
+            CADrawableMusElement* elt = sv->findMElement(notes[i]);
+            if (elt && (elt->xPos() > (sv->worldX() + sv->worldWidth()) || elt->xPos() < sv->worldX())) {
+                sv->setWorldX(elt->xPos() - 50, CACanorus::settings()->animatedScroll());
+                break;
             }
         }
     }
-
-    sv->repaint();
 }
 
 void CAMainWin::on_uiLockScrollPlayback_toggled(bool val)
@@ -3151,8 +3612,8 @@ void CAMainWin::on_uiOpenDocument_triggered()
         return;
     }
 
-    if (CAMainWin::uiOpenDialog->exec() && CAMainWin::uiOpenDialog->selectedFiles().size()) {
-        openDocument(CAMainWin::uiOpenDialog->selectedFiles().at(0));
+    if (openDialog()->exec() && openDialog()->selectedFiles().size()) {
+        openDocument(openDialog()->selectedFiles().at(0));
     }
 }
 
@@ -3180,25 +3641,20 @@ bool CAMainWin::on_uiSaveDocument_triggered()
 bool CAMainWin::on_uiSaveDocumentAs_triggered()
 {
     if (document()) {
-        if (CAMainWin::uiSaveDialog) {
-            CAMainWin::uiSaveDialog->exec();
-            if (CAMainWin::uiSaveDialog->selectedFiles().size()) {
-                QString s = CAMainWin::uiSaveDialog->selectedFiles().at(0);
-                // append the extension, if the filename doesn't contain a dot
-                //int i;
-                if (!s.contains('.')) {
-                    int left = uiSaveDialog->selectedNameFilter().indexOf("(*.") + 2;
-                    int len = uiSaveDialog->selectedNameFilter().size() - left - 1;
-                    s.append(uiSaveDialog->selectedNameFilter().mid(left, len));
-                }
-
-                return saveDocument(s);
-            } else {
-                qWarning() << "Save Document: No file selected.";
-                return false;
+        saveDialog()->exec();
+        if (saveDialog()->selectedFiles().size()) {
+            QString s = saveDialog()->selectedFiles().at(0);
+            // append the extension, if the filename doesn't contain a dot
+            //int i;
+            if (!s.contains('.')) {
+                int left = saveDialog()->selectedNameFilter().indexOf("(*.") + 2;
+                int len = saveDialog()->selectedNameFilter().size() - left - 1;
+                s.append(saveDialog()->selectedNameFilter().mid(left, len));
             }
+
+            return saveDocument(s);
         } else {
-            qWarning() << "Save Document: Save Dialog does not exist.";
+            qWarning() << "Save Document: No file selected.";
             return false;
         }
     } else {
@@ -3211,6 +3667,10 @@ bool CAMainWin::on_uiSaveDocumentAs_triggered()
 	Opens a document with the given absolute file name.
 	The previous document will be lost.
 
+	The document is imported in the background. The sheets are shown as soon as the import filter
+	publishes them and the document is set when the import is finished, see onSheetPublished() and
+	onImportDone().
+
 	Returns a pointer to the opened document or null if opening the document has failed.
 */
 CADocument* CAMainWin::openDocument(const QString& fileName)
@@ -3221,22 +3681,54 @@ CADocument* CAMainWin::openDocument(const QString& fileName)
         _importFile.reset();
     }
 
-    if (fileName.endsWith(".xml")) {
+    // sniff the format, so the importer starts without reading the whole file first
+    switch (CAFileFormats::detectType(fileName)) {
+    case CAFileFormats::CanorusML:
         _importFile = std::make_unique<CACanorusMLImport>();
-        uiSaveDialog->selectNameFilter(CAFileFormats::CANORUSML_FILTER);
-    } else if (fileName.endsWith(".can")) {
+        saveDialog()->selectNameFilter(CAFileFormats::CANORUSML_FILTER);
+        break;
+    case CAFileFormats::Can:
         _importFile = std::make_unique<CACanImport>();
-        uiSaveDialog->selectNameFilter(CAFileFormats::CAN_FILTER);
-    } else {
+        saveDialog()->selectNameFilter(CAFileFormats::CAN_FILTER);
+        break;
+    case CAFileFormats::MusicXML:
+        _importFile = std::make_unique<CAMusicXmlImport>();
+        break;
+    case CAFileFormats::MXL:
+        _importFile = std::make_unique<CAMXLImport>();
+        break;
+    default:
         return nullptr; // FIXME Failing quietly, add error message
     }
 
-    connect(_importFile.get(), SIGNAL(importDone(int)), this, SLOT(onImportDone(int)));
     _importFile->setStreamFromFile(fileName);
+    openImport();
+    return _importFile->importedDocument();
+}
+
+/*!
+	Opens the document read by the given \a import, whose stream is already set. The import runs
+	in the background with the progress shown in this window. The sheets are shown as they are
+	read and the document is opened by onImportDone().
+*/
+void CAMainWin::openImport(std::unique_ptr<CAImport> import)
+{
+    stopPlayback();
+    _importFile = std::move(import);
+    openImport();
+}
+
+/*!
+	Starts the import of the document by _importFile.
+*/
+void CAMainWin::openImport()
+{
+    _publishedSheets.clear();
+    connect(_importFile.get(), SIGNAL(sheetPublished(CASheet*)), this, SLOT(onSheetPublished(CASheet*)), Qt::QueuedConnection);
+    connect(_importFile.get(), SIGNAL(importDone(int)), this, SLOT(onImportDone(int)));
     _importFile->importDocument();
 
     _mainWinProgressCtl.startProgress(*_importFile.get());
-    return _importFile->importedDocument();
 }
 
 /*!
@@ -3250,29 +3742,30 @@ CADocument* CAMainWin::openDocument(CADocument* doc)
     stopPlayback();
     if (doc) {
         if (document() && CACanorus::mainWinCount(document()) == 1) {
-            CACanorus::undo()->deleteUndoStack(document());
             clearUI();
-            delete document();
+            CACanorus::undo()->deleteUndoStackLater(document(), true);
         }
 
         setDocument(doc);
         if (!doc->fileName().isEmpty()) {
             CACanorus::insertRecentDocument(doc->fileName());
 
-            QDir dir(QFileInfo(doc->fileName()).absoluteDir());
-            uiOpenDialog->setDirectory(dir);
-            uiSaveDialog->setDirectory(dir);
-            uiExportDialog->setDirectory(dir);
-            uiImportDialog->setDirectory(dir);
+            CACanorus::setFileDialogsDirectory(QFileInfo(doc->fileName()).absoluteDir());
         }
         CACanorus::undo()->createUndoStack(document());
 
         uiCloseDocument->setEnabled(true);
         if (CACanorus::settings()->useNoteChecker()) {
             for (int i = 0; i < doc->sheetList().size(); i++) {
-                _noteChecker.checkSheet(doc->sheetList()[i]);
+                if (doc->sheetList()[i]->isLoaded()) { // the rest is checked when shown
+                    _noteChecker.checkSheet(doc->sheetList()[i]);
+                }
             }
         }
+        if (doc->archive() && doc->archive()->contains("content.bin")) {
+            saveDialog()->selectNameFilter(CAFileFormats::CAN_BINARY_FILTER); // keep the binary score on save
+        }
+        CASheetLayout::loadLayoutHints(doc);
         rebuildUI(); // local rebuild only
         if (doc->sheetList().size())
             uiTabWidget->setCurrentIndex(0);
@@ -3306,16 +3799,21 @@ bool CAMainWin::saveDocument(QString fileName)
     CACanorus::restartTimeEditedTimes(document());
 
     CAExport* save = nullptr;
+    bool append = false; // only the changes are appended to the file, see CACanExport::setJournaled()
     if (fileName.endsWith(".xml")) { // check the filename extension directly without accessing the uiSaveDialog object due to a bug in Qt. -Matevz
         /// \todo replace raw pointer with shared or unique pointer
         save = new CACanorusMLExport();
     } else if (fileName.endsWith(".can")) {
         /// \todo replace raw pointer with shared or unique pointer
-        save = new CACanExport();
+        CACanExport* canExport = new CACanExport();
+        canExport->setBinaryContent(saveDialog()->selectedNameFilter() == CAFileFormats::CAN_BINARY_FILTER);
+        append = CACanorus::settings()->journaledSave() && CACanExport::canAppendJournal(document(), fileName);
+        canExport->setJournaled(append);
+        save = canExport;
     }
 
     if (save) {
-        save->setStreamToFile(fileName);
+        save->setStreamToFile(fileName, append ? QIODevice::WriteOnly | QIODevice::Append : QIODevice::WriteOnly);
         save->exportDocument(document());
         save->wait();
 
@@ -3324,11 +3822,7 @@ bool CAMainWin::saveDocument(QString fileName)
             CACanorus::insertRecentDocument(fileName);
             delete save;
 
-            QDir dir(QFileInfo(fileName).absoluteDir());
-            uiOpenDialog->setDirectory(dir);
-            uiSaveDialog->setDirectory(dir);
-            uiExportDialog->setDirectory(dir);
-            uiImportDialog->setDirectory(dir);
+            CACanorus::setFileDialogsDirectory(QFileInfo(fileName).absoluteDir());
 
             document()->setModified(false);
             updateWindowTitle();
@@ -3347,7 +3841,7 @@ bool CAMainWin::saveDocument(QString fileName)
     QMessageBox::critical(
         this,
         tr("Error while saving document"),
-        tr("Unknown file format %1.").arg(uiSaveDialog->selectedNameFilter()));
+        tr("Unknown file format %1.").arg(saveDialog()->selectedNameFilter()));
     return false;
 }
 
@@ -3370,6 +3864,7 @@ void CAMainWin::updateWindowTitle()
 
 void CAMainWin::onMidiInEvent(QVector<unsigned char> m)
 {
+    CASessionJournal::recordMidiIn(m);
     _keybdInput->onMidiInEvent(m);
     return;
 }
@@ -3382,7 +3877,7 @@ void CAMainWin::on_uiExportDocument_triggered()
     QStringList fileNames;
     QString fileExtString;
     QStringList fileExtList;
-    int ffound = uiExportDialog->exec();
+    int ffound = exportDialog()->exec();
     if (!ffound)
         return;
 
@@ -3391,8 +3886,9 @@ void CAMainWin::on_uiExportDocument_triggered()
     /// \todo: maybe block new export until the old is finished
     if (_poExp) // Delete old export instance
         delete _poExp;
+    _poExp = nullptr;
 
-    fileNames = uiExportDialog->selectedFiles();
+    fileNames = exportDialog()->selectedFiles();
 
     QString s = fileNames[0];
     if (s.isEmpty()) {
@@ -3401,34 +3897,67 @@ void CAMainWin::on_uiExportDocument_triggered()
     }
 
     if (!s.contains('.')) {
-        int left = uiExportDialog->selectedNameFilter().indexOf("(*.") + 2;
-        int len = uiExportDialog->selectedNameFilter().size() - left - 1;
-        fileExtString = uiExportDialog->selectedNameFilter().mid(left, len);
+        int left = exportDialog()->selectedNameFilter().indexOf("(*.") + 2;
+        int len = exportDialog()->selectedNameFilter().size() - left - 1;
+        fileExtString = exportDialog()->selectedNameFilter().mid(left, len);
         // the default file extension is the first one:
         fileExtList = fileExtString.split(" ");
         s.append(fileExtList[0]);
     }
 
-    if (CAPluginManager::exportFilterExists(uiExportDialog->selectedNameFilter())) {
-        CAPluginManager::exportAction(uiExportDialog->selectedNameFilter(), document(), s);
+    if (CAPluginManager::exportFilterExists(exportDialog()->selectedNameFilter())) {
+        CAPluginAction* action = CAPluginManager::exportFilterAction(exportDialog()->selectedNameFilter());
+        if (CAPluginExport::runsInThread(action)) {
+            // the plugin reads a copy of the document, so the user can edit it and start other exports meanwhile
+            CAExportSnapshot* snapshot = new CAExportSnapshot(document(), this);
+            snapshot->addExport(new CAPluginExport(action), s);
+            connect(snapshot, SIGNAL(finished()), this, SLOT(onPluginExportFinished()));
+            snapshot->start();
+            statusBar()->showMessage(tr("Exporting %1...").arg(s));
+        } else {
+            CAPluginManager::exportAction(exportDialog()->selectedNameFilter(), document(), s);
+        }
+    } else if (exportDialog()->selectedNameFilter() == CAFileFormats::ENGRAVED_PDF_FILTER || exportDialog()->selectedNameFilter() == CAFileFormats::ENGRAVED_SVG_FILTER) {
+        // rendered from the layout in the main thread, no typesetter needed
+        CAVectorExport vectorExport((exportDialog()->selectedNameFilter() == CAFileFormats::ENGRAVED_PDF_FILTER) ? CAVectorExport::PDF : CAVectorExport::SVG);
+        if (!vectorExport.exportSheet(currentSheet(), s)) {
+            QMessageBox::critical(this, tr("Error while exporting"), tr("Unable to write %1.").arg(s));
+        }
+    } else if (exportDialog()->selectedNameFilter() == CAFileFormats::WAV_FILTER || exportDialog()->selectedNameFilter() == CAFileFormats::FLAC_FILTER) {
+        // rendered offline by the embedded synth, no midi device needed
+        CAAudioExport audioExport((exportDialog()->selectedNameFilter() == CAFileFormats::FLAC_FILTER) ? CAAudioExport::FLAC : CAAudioExport::WAV);
+        if (currentSheet()->voiceList().size() > 1) {
+            audioExport.setStems(QMessageBox::question(this, tr("Audio export"), tr("Also write each voice to a separate file?")) == QMessageBox::Yes);
+        }
+
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        bool success = audioExport.setSoundFont(CACanorus::settings()->soundFont()) && audioExport.exportSheet(currentSheet(), s);
+        QApplication::restoreOverrideCursor();
+        if (!success) {
+            QMessageBox::critical(this, tr("Error while exporting"), audioExport.errorString());
+        }
     } else {
-        if (uiExportDialog->selectedNameFilter() == CAFileFormats::MIDI_FILTER) {
+        if (exportDialog()->selectedNameFilter() == CAFileFormats::MIDI_FILTER) {
             /// \todo replace raw pointer with shared or unique pointer
             CAMidiExport* pme = new CAMidiExport;
             _poExp = pme;
-        } else if (uiExportDialog->selectedNameFilter() == CAFileFormats::LILYPOND_FILTER) {
+        } else if (exportDialog()->selectedNameFilter() == CAFileFormats::LILYPOND_FILTER) {
             /// \todo replace raw pointer with shared or unique pointer
             CALilyPondExport* ple = new CALilyPondExport;
             _poExp = ple;
-        } else if (uiExportDialog->selectedNameFilter() == CAFileFormats::MUSICXML_FILTER) {
+        } else if (exportDialog()->selectedNameFilter() == CAFileFormats::MUSICXML_FILTER) {
             /// \todo replace raw pointer with shared or unique pointer
             CAMusicXmlExport* musicxml = new CAMusicXmlExport;
             _poExp = musicxml;
-        } else if (uiExportDialog->selectedNameFilter() == CAFileFormats::PDF_FILTER) {
+        } else if (exportDialog()->selectedNameFilter() == CAFileFormats::MXL_FILTER) {
+            /// \todo replace raw pointer with shared or unique pointer
+            CAMXLExport* mxl = new CAMXLExport;
+            _poExp = mxl;
+        } else if (exportDialog()->selectedNameFilter() == CAFileFormats::PDF_FILTER) {
             /// \todo replace raw pointer with shared or unique pointer
             CAPDFExport* ppe = new CAPDFExport;
             _poExp = ppe;
-        } else if (uiExportDialog->selectedNameFilter() == CAFileFormats::SVG_FILTER) {
+        } else if (exportDialog()->selectedNameFilter() == CAFileFormats::SVG_FILTER) {
             /// \todo replace raw pointer with shared or unique pointer
             CASVGExport* pse = new CASVGExport;
             _poExp = pse;
@@ -3458,9 +3987,9 @@ void CAMainWin::on_uiImportDocument_triggered()
     }
 
     QStringList fileNames;
-    int ffound = uiImportDialog->exec();
+    int ffound = importDialog()->exec();
     if (ffound)
-        fileNames = uiImportDialog->selectedFiles();
+        fileNames = importDialog()->selectedFiles();
 
     if (!ffound)
         return;
@@ -3468,14 +3997,22 @@ void CAMainWin::on_uiImportDocument_triggered()
 
     QString s = fileNames[0];
 
-    if (CAPluginManager::importFilterExists(uiImportDialog->selectedNameFilter())) {
-        // Import done using a scripting engine
+    CAPluginAction* pluginAction = CAPluginManager::importFilterAction(importDialog()->selectedNameFilter());
+    if (CAPluginImport::runsInThread(pluginAction)) {
+        // the plugin fills a new document in its own thread, opened by onImportDone()
+        _importFile = std::make_unique<CAPluginImport>(pluginAction);
+        _importFile->setStreamFromFile(s);
+        connect(_importFile.get(), SIGNAL(importDone(int)), this, SLOT(onImportDone(int)));
+        _importFile->importDocument();
+        _mainWinProgressCtl.startProgress(*_importFile.get());
+    } else if (CAPluginManager::importFilterExists(importDialog()->selectedNameFilter())) {
+        // Import done using a scripting engine in the main thread
         /// \todo replace raw pointer with shared or unique pointer
         setDocument(new CADocument());
         CACanorus::undo()->createUndoStack(document());
         uiCloseDocument->setEnabled(true);
 
-        CAPluginManager::importAction(uiImportDialog->selectedNameFilter(), document(), fileNames[0]);
+        CAPluginManager::importAction(importDialog()->selectedNameFilter(), document(), fileNames[0]);
 
         CACanorus::rebuildUI(document());
     } else {
@@ -3483,7 +4020,7 @@ void CAMainWin::on_uiImportDocument_triggered()
             _importFile.reset();
         }
 
-        if (uiImportDialog->selectedNameFilter() == CAFileFormats::MIDI_FILTER) {
+        if (importDialog()->selectedNameFilter() == CAFileFormats::MIDI_FILTER) {
             if (!document())
                 newDocument();
             _importFile = std::make_unique<CAMidiImport>();
@@ -3492,7 +4029,7 @@ void CAMainWin::on_uiImportDocument_triggered()
                 connect(_importFile.get(), SIGNAL(importDone(int)), this, SLOT(onImportDone(int)));
                 _importFile->importSheet();
             }
-        } else if (uiImportDialog->selectedNameFilter() == CAFileFormats::LILYPOND_FILTER) {
+        } else if (importDialog()->selectedNameFilter() == CAFileFormats::LILYPOND_FILTER) {
             // activate this filter in src/canorus.cpp when sheet import is usable
             if (!document())
                 newDocument();
@@ -3502,14 +4039,14 @@ void CAMainWin::on_uiImportDocument_triggered()
                 connect(_importFile.get(), SIGNAL(importDone(int)), this, SLOT(onImportDone(int)));
                 _importFile->importSheet();
             }
-        } else if (uiImportDialog->selectedNameFilter() == CAFileFormats::MUSICXML_FILTER) {
+        } else if (importDialog()->selectedNameFilter() == CAFileFormats::MUSICXML_FILTER) {
             _importFile = std::make_unique<CAMusicXmlImport>();
             if (_importFile) {
                 _importFile->setStreamFromFile(s);
                 connect(_importFile.get(), SIGNAL(importDone(int)), this, SLOT(onImportDone(int)));
                 _importFile->importDocument();
             }
-        } else if (uiImportDialog->selectedNameFilter() == CAFileFormats::MXL_FILTER) {
+        } else if (importDialog()->selectedNameFilter() == CAFileFormats::MXL_FILTER) {
             _importFile = std::make_unique<CAMXLImport>();
             if (_importFile) {
                 _importFile->setStreamFromFile(s);
@@ -3523,6 +4060,37 @@ void CAMainWin::on_uiImportDocument_triggered()
     }
 }
 
+/*!
+	Shows the completely imported \a sheet of the document being opened in a new tab.
+
+	The current document is closed when the first sheet arrives. The tabs stay read-only until
+	onImportDone() sets the imported document and rebuilds them.
+*/
+void CAMainWin::onSheetPublished(CASheet* sheet)
+{
+    if (!sheet || !_importFile || sender() != _importFile.get()) {
+        return;
+    }
+
+    if (_publishedSheets.isEmpty()) {
+        if (document() && CACanorus::mainWinCount(document()) == 1) {
+            clearUI();
+            CACanorus::undo()->deleteUndoStackLater(document(), true);
+        } else {
+            clearUI();
+        }
+        setDocument(nullptr);
+    }
+
+    // keep the tab the user is looking at
+    int curIndex = uiTabWidget->currentIndex();
+    _publishedSheets << sheet;
+    addSheet(sheet, false);
+    if (curIndex >= 0) {
+        uiTabWidget->setCurrentIndex(curIndex);
+    }
+}
+
 void CAMainWin::onImportDone(int)
 {
     CAImport* import = static_cast<CAImport*>(sender());
@@ -3531,7 +4099,27 @@ void CAMainWin::onImportDone(int)
         return;
     }
 
+    if (import->isCanceled()) {
+        // throw away whatever was read until the user canceled the import
+        if (!_publishedSheets.isEmpty()) {
+            _publishedSheets.clear();
+            clearUI();
+        }
+        delete import->importedDocument();
+        delete import->importedSheet();
+        setMode(EditMode);
+        statusBar()->showMessage(tr("Import canceled."), 2000);
+        return;
+    }
+
     bool success = (import->status() == 0);
+    if (!_publishedSheets.isEmpty()) {
+        // the preview tabs are replaced by the imported document or belong to a failed import
+        _publishedSheets.clear();
+        if (!success) {
+            clearUI();
+        }
+    }
 
     if (success) {
         if (import->importedDocument()) {
@@ -3564,7 +4152,7 @@ void CAMainWin::onImportDone(int)
 */
 void CAMainWin::on_uiExportToPdf_triggered()
 {
-    uiExportDialog->setNameFilter(CAFileFormats::PDF_FILTER);
+    exportDialog()->setNameFilter(CAFileFormats::PDF_FILTER);
     on_uiExportDocument_triggered();
 }
 
@@ -3572,6 +4160,70 @@ void CAMainWin::onExportDone(int)
 {
 }
 
+/*!
+	Called when File->Publish is clicked.
+	Saves the document and exports the current sheet to LilyPond and MIDI next to it. The exports
+	run in the background from a snapshot of the document (see CAExportSnapshot), while the
+	document is being saved and edited further.
+*/
+void CAMainWin::on_uiPublish_triggered()
+{
+    if (!document() || !currentSheet()) {
+        return;
+    }
+
+    if (document()->fileName().isEmpty() && !on_uiSaveDocumentAs_triggered()) {
+        return;
+    }
+
+    QFileInfo info(document()->fileName());
+    QString baseName = info.path() + "/" + info.completeBaseName();
+
+    CAExportSnapshot* snapshot = new CAExportSnapshot(document(), this);
+    snapshot->addExport(new CALilyPondExport(), baseName + ".ly", currentSheet());
+    snapshot->addExport(new CAMidiExport(), baseName + ".mid", currentSheet());
+    connect(snapshot, SIGNAL(finished()), this, SLOT(onPublishFinished()));
+    snapshot->start();
+
+    if (document()->isModified()) {
+        saveDocument(document()->fileName());
+    }
+}
+
+/*!
+	Reports the result of the exports started by on_uiPublish_triggered() and destroys their
+	snapshot.
+*/
+void CAMainWin::onPublishFinished()
+{
+    CAExportSnapshot* snapshot = static_cast<CAExportSnapshot*>(sender());
+    QStringList failed = snapshot->failedFileNames();
+    if (failed.isEmpty()) {
+        statusBar()->showMessage(tr("Published %1.").arg(snapshot->fileNames().join(", ")), 5000);
+    } else {
+        QMessageBox::critical(this, tr("Error while publishing"), tr("Unable to write %1.").arg(failed.join(", ")));
+    }
+
+    snapshot->deleteLater();
+}
+
+/*!
+	Reports the result of the plugin export started by on_uiExportDocument_triggered() and
+	destroys its snapshot.
+*/
+void CAMainWin::onPluginExportFinished()
+{
+    CAExportSnapshot* snapshot = static_cast<CAExportSnapshot*>(sender());
+    QStringList failed = snapshot->failedFileNames();
+    if (failed.isEmpty()) {
+        statusBar()->showMessage(tr("Exported %1.").arg(snapshot->fileNames().join(", ")), 5000);
+    } else {
+        QMessageBox::critical(this, tr("Error while exporting"), tr("Unable to write %1.").arg(failed.join(", ")));
+    }
+
+    snapshot->deleteLater();
+}
+
 /*!
 	Called when a user changes the current voice number.
 */
@@ -3613,7 +4265,7 @@ void CAMainWin::on_uiClefOffset_valueChanged(int newOffset)
     } else if (mode() == EditMode) {
         CAScoreView* v = currentScoreView();
         if (v && v->selection().size()) {
-            CACanorus::undo()->createUndoCommand(document(), tr("change clef offset", "undo"));
+            CACanorus::undo()->createUndoCommand(document(), tr("change clef offset", "undo"), selectedStaff());
             CAClef* clef = dynamic_cast<CAClef*>(v->selection().at(0)->musElement());
 
             if (clef) {
@@ -3632,7 +4284,7 @@ void CAMainWin::on_uiVoiceName_returnPressed()
 {
     CAVoice* voice = currentVoice();
     if (voice) {
-        CACanorus::undo()->createUndoCommand(document(), tr("change voice name", "undo"));
+        CACanorus::undo()->createUndoCommand(document(), tr("change voice name", "undo"), voice->staff());
         CACanorus::undo()->pushUndoCommand();
         voice->setName(uiVoiceName->text());
         CACanorus::rebuildUI(document(), currentSheet());
@@ -3647,7 +4299,7 @@ void CAMainWin::on_uiVoiceInstrument_activated(int index)
     if (!currentVoice() || index < 0)
         return;
 
-    CACanorus::undo()->createUndoCommand(document(), tr("change voice instrument", "undo"));
+    CACanorus::undo()->createUndoCommand(document(), tr("change voice instrument", "undo"), currentVoice()->staff());
     CACanorus::undo()->pushUndoCommand();
     currentVoice()->setMidiProgram(static_cast<unsigned char>(index));
     CACanorus::rebuildUI(document(), currentSheet());
@@ -3699,7 +4351,7 @@ void CAMainWin::on_uiPlayableLength_toggled(bool, int buttonId)
         musElementFactory()->setPlayableLength(length);
         if (currentScoreView()) {
             currentScoreView()->setShadowNoteLength(musElementFactory()->playableLength());
-            currentScoreView()->updateHelpers();
+            currentScoreView()->updateShadowNotes();
         }
     } else if (mode() == EditMode && currentScoreView() && currentScoreView()->selection().size()) {
         CAScoreView* v = currentScoreView();
@@ -3738,18 +4390,14 @@ void CAMainWin::on_uiPlayableLength_toggled(bool, int buttonId)
                         p->voice()->insert(next, rests[i]); // insert rests from shortest to longest
                     }
                 } else {
-                    p->staff()->synchronizeVoices();
+                    p->staff()->synchronizeVoices(p->timeStart());
                 }
 
-                for (int j = 0; j < p->voice()->lyricsContextList().size(); j++) { // reposit syllables
-                    p->voice()->lyricsContextList().at(j)->repositSyllables();
-                }
+                p->voice()->staff()->sheet()->repositContexts(p->timeStart());
             }
         }
 
-        if (CACanorus::settings()->useNoteChecker()) {
-            _noteChecker.checkSheet(v->sheet());
-        }
+        scheduleNoteCheck(v->sheet());
 
         CACanorus::undo()->pushUndoCommand();
         CACanorus::rebuildUI(document(), currentSheet());
@@ -3775,6 +4423,7 @@ void CAMainWin::onTextEditKeyPressEvent(QKeyEvent* e)
     CATextEdit* textEdit = static_cast<CATextEdit*>(sender());
 
     CAScoreView* v = currentScoreView();
+    CASessionJournal::recordText(v, e);
     CAMusElement* elt = (v->selection().size() ? v->selection().front()->musElement() : nullptr);
 
     if (!elt)
@@ -3886,7 +4535,7 @@ void CAMainWin::confirmTextEdit(CAScoreView* v, CATextEdit* textEdit, CAMusEleme
 
         QString text = textEdit->text().simplified(); // remove any trailing whitespaces
         cn->importFromString(text);
-        _noteChecker.checkSheet(v->sheet());
+        scheduleNoteCheck(v->sheet());
 
         v->removeTextEdit();
         break;
@@ -4178,9 +4827,7 @@ void CAMainWin::on_uiTimeSigBeats_valueChanged(int beats)
             CATimeSignature* timeSig = dynamic_cast<CATimeSignature*>(v->selection().at(0)->musElement());
             if (timeSig) {
                 timeSig->setBeats(beats);
-                if (CACanorus::settings()->useNoteChecker()) {
-                    _noteChecker.checkSheet(v->sheet());
-                }
+                scheduleNoteCheck(v->sheet());
 
                 CACanorus::rebuildUI(document(), currentSheet());
             }
@@ -4389,9 +5036,7 @@ void CAMainWin::sourceViewCommit(QString inputString)
 
         v->setVoice(newVoice);
 
-        if (CACanorus::settings()->useNoteChecker()) {
-            _noteChecker.checkSheet(newVoice->staff()->sheet());
-        }
+        scheduleNoteCheck(newVoice->staff()->sheet());
 
         CACanorus::undo()->pushUndoCommand();
         CACanorus::rebuildUI(document(), newVoice->staff()->sheet());
@@ -4434,6 +5079,59 @@ void CAMainWin::on_uiUsersGuide_triggered()
 #endif
 }
 
+/*!
+	Saves the recorded trace zones in Chrome trace event format.
+
+	\sa CATrace
+*/
+void CAMainWin::on_uiSavePerformanceTrace_triggered()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save performance trace"), "canorus-trace.json", tr("Chrome trace (*.json)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    if (!CATrace::writeChromeTrace(fileName)) {
+        QMessageBox::critical(this, tr("Save performance trace"), tr("Cannot write the trace to %1.").arg(fileName));
+    }
+}
+
+/*!
+	Shows the latency histograms of the editor actions. They can be saved in CSV format or cleared,
+	eg. before repeating an action on a large score.
+
+	\sa CAActionLatency
+*/
+void CAMainWin::on_uiActionLatencies_triggered()
+{
+    QString report = CAActionLatency::report();
+    QMessageBox box(QMessageBox::Information, tr("Action latencies"), report.isEmpty() ? tr("No actions were timed yet.") : report, QMessageBox::Close, this);
+    QPushButton* save = box.addButton(tr("&Save..."), QMessageBox::ActionRole);
+    QPushButton* clear = box.addButton(tr("C&lear"), QMessageBox::ResetRole);
+    box.exec();
+
+    if (box.clickedButton() == clear) {
+        CAActionLatency::clear();
+    } else if (box.clickedButton() == save) {
+        QString fileName = QFileDialog::getSaveFileName(this, tr("Save action latencies"), "canorus-latencies.csv", tr("CSV file (*.csv)"));
+        if (!fileName.isEmpty() && !CAActionLatency::writeCsv(fileName)) {
+            QMessageBox::critical(this, tr("Save action latencies"), tr("Cannot write the latencies to %1.").arg(fileName));
+        }
+    }
+}
+
+/*!
+	Shows the counts and the estimated memory usage of the parts of the current document.
+*/
+void CAMainWin::on_uiMemoryStatistics_triggered()
+{
+    if (!document()) {
+        return;
+    }
+
+    QMessageBox::information(this, tr("Memory statistics"), CADocumentStatistics(document()).toString());
+}
+
 void CAMainWin::on_uiAboutQt_triggered()
 {
     QMessageBox::aboutQt(this, tr("About Qt"));
@@ -4457,11 +5155,19 @@ Homepage: <a href=\"http://www.canorus.org\">http://www.canorus.org</a></p>")
 
 void CAMainWin::on_uiSettings_triggered()
 {
+    bool useNoteChecker = CACanorus::settings()->useNoteChecker();
     CASettingsDialog(CASettingsDialog::EditorSettings, this);
 
+    // the views refresh the colors and painting settings themselves on CASettings::settingsChanged()
+    if (!document() || CACanorus::settings()->useNoteChecker() == useNoteChecker) {
+        return;
+    }
+
     if (CACanorus::settings()->useNoteChecker()) {
         for (int i = 0; i < document()->sheetList().size(); i++) {
-            _noteChecker.checkSheet(document()->sheetList()[i]);
+            if (document()->sheetList()[i]->isLoaded()) {
+                _noteChecker.checkSheet(document()->sheetList()[i]);
+            }
         }
     } else {
         for (int i = 0; i < document()->sheetList().size(); i++) {
@@ -4492,6 +5198,10 @@ void CAMainWin::on_uiMidiRecorder_triggered()
 void CAMainWin::on_uiTranspose_triggered()
 {
     if (document()) {
+        if (!_transposeView) {
+            _transposeView = new CATransposeView(this);
+            addDockWidget(Qt::RightDockWidgetArea, _transposeView);
+        }
         _transposeView->show();
     }
 }
@@ -4642,6 +5352,55 @@ void CAMainWin::on_uiContextName_returnPressed()
     }
 }
 
+/*!
+	Freezes or thaws the current staff. The contents of a frozen staff cannot be edited and aren't
+	checked or synchronized again, which keeps the editing of the other contexts in large scores
+	responsive.
+
+	\sa CAStaff::setFrozen(), isFrozen()
+*/
+void CAMainWin::on_uiFreezeContext_toggled(bool frozen)
+{
+    if (currentContext() && currentContext()->contextType() == CAContext::Staff) {
+        CAStaff* staff = static_cast<CAStaff*>(currentContext());
+        if (staff->isFrozen() != frozen) {
+            CACanorus::undo()->createUndoCommand(document(), frozen ? tr("freeze staff", "undo") : tr("thaw staff", "undo"));
+            CACanorus::undo()->pushUndoCommand();
+            staff->setFrozen(frozen);
+            CACanorus::rebuildUI(document(), currentSheet());
+        }
+    }
+}
+
+/*!
+	Folds the current context in the current score view. The folded contexts aren't laid out nor
+	painted in the view until they are unfolded by on_uiUnfoldContexts_triggered(). The document
+	and the other views aren't changed.
+
+	\sa CAScoreView::setContextHidden()
+*/
+void CAMainWin::on_uiFoldContext_triggered()
+{
+    if (currentScoreView() && currentContext()) {
+        currentScoreView()->setContextHidden(currentContext(), true);
+        updateToolBars();
+    }
+}
+
+/*!
+	Returns True and shows a notice in the status bar, if the \a context is a frozen staff and its
+	contents shouldn't be changed.
+*/
+bool CAMainWin::isFrozen(CAContext* context)
+{
+    if (context && context->contextType() == CAContext::Staff && static_cast<CAStaff*>(context)->isFrozen()) {
+        statusBar()->showMessage(tr("The staff %1 is frozen. Thaw it to edit its contents.").arg(context->name()), 2000);
+        return true;
+    }
+
+    return false;
+}
+
 /*!
 	Brings up the properties dialog.
 */
@@ -4681,7 +5440,7 @@ void CAMainWin::on_uiVoiceStemDirection_toggled(bool, int direction)
 {
     CAVoice* voice = currentVoice();
     if (voice) {
-        CACanorus::undo()->createUndoCommand(document(), tr("change voice stem direction", "undo"));
+        CACanorus::undo()->createUndoCommand(document(), tr("change voice stem direction", "undo"), voice->staff());
         if (voice->stemDirection() != static_cast<CANote::CAStemDirection>(direction))
             CACanorus::undo()->pushUndoCommand();
         CACanorus::undo()->pushUndoCommand();
@@ -4699,19 +5458,19 @@ void CAMainWin::on_uiNoteStemDirection_toggled(bool, int id)
     if (mode() == InsertMode)
         musElementFactory()->setNoteStemDirection(direction);
     else if (mode() == EditMode) {
-        CACanorus::undo()->createUndoCommand(document(), tr("change note stem direction", "undo"));
-        CAScoreView* v = currentScoreView();
-        bool changed = false;
-        for (int i = 0; v && i < v->selection().size(); i++) {
-            CANote* note = dynamic_cast<CANote*>(v->selection().at(i)->musElement());
+        CACanorus::undo()->createUndoCommand(document(), tr("change note stem direction", "undo"), selectedStaff());
+        QList<CAMusElement*> changed;
+        QList<CAMusElement*> selection = currentScoreView() ? currentScoreView()->musElementSelection() : QList<CAMusElement*>();
+        for (int i = 0; i < selection.size(); i++) {
+            CANote* note = dynamic_cast<CANote*>(selection[i]);
             if (note) {
                 note->setStemDirection(direction);
-                changed = true;
+                changed << note;
             }
         }
-        if (changed) {
+        if (changed.size()) {
             CACanorus::undo()->pushUndoCommand();
-            CACanorus::rebuildUI(document(), currentSheet());
+            rebuildChangedElements(changed);
         }
     }
 }
@@ -4827,10 +5586,14 @@ void CAMainWin::updateContextToolBar()
         if (!uiInsertPlayable->isChecked())
             uiContextToolBar->show();
 
+        uiFreezeContext->setVisible(context->contextType() == CAContext::Staff);
         switch (context->contextType()) {
         case CAContext::Staff: {
             uiStanzaNumberAction->setVisible(false);
             uiAssociatedVoiceAction->setVisible(false);
+            uiFreezeContext->blockSignals(true);
+            uiFreezeContext->setChecked(static_cast<CAStaff*>(context)->isFrozen());
+            uiFreezeContext->blockSignals(false);
             break;
         }
         case CAContext::LyricsContext: {
@@ -5528,6 +6291,12 @@ void CAMainWin::copySelection(CAScoreView* v)
 */
 void CAMainWin::deleteSelection(CAScoreView* v, bool deleteSyllables, bool deleteNotes, bool doUndo)
 {
+    for (int i = 0; i < v->selection().size(); i++) {
+        if (v->selection().at(i)->musElement() && isFrozen(v->selection().at(i)->musElement()->context())) {
+            return;
+        }
+    }
+
     if (v->selection().size()) {
         if (doUndo)
             CACanorus::undo()->createUndoCommand(document(), tr("deletion of elements", "undo"));
@@ -5557,8 +6326,41 @@ void CAMainWin::deleteSelection(CAScoreView* v, bool deleteSyllables, bool delet
             }
         }
 
+        QHash<CAVoice*, QList<CAMusElement*>> removedPlayables; // removed at once per voice after the loop
+        QSet<CASyllable*> removedSyllables;
         for (QSet<CAMusElement*>::const_iterator i = musElemSet.constBegin(); i != musElemSet.constEnd(); i++) {
-            if ((*i)->isPlayable()) {
+            if ((*i)->isPlayable() && deleteNotes && static_cast<CAPlayable*>(*i)->staff()->voiceList().size() == 1) {
+                // no other voices to keep in sync, so the voice is shifted back only once, see CAVoice::removeBlock()
+                CAPlayable* p = static_cast<CAPlayable*>(*i);
+                bool shortens = true; // removes the whole chord
+                if (p->musElementType() == CAMusElement::Note && static_cast<CANote*>(p)->isPartOfChord()) {
+                    QList<CANote*> chord = static_cast<CANote*>(p)->getChord();
+                    shortens = (chord.first() == p);
+                    for (int j = 0; shortens && j < chord.size(); j++) {
+                        shortens = musElemSet.contains(chord[j]);
+                    }
+                }
+
+                if (shortens) {
+                    for (int j = 0; j < p->voice()->lyricsContextList().size(); j++) { // delete and shift syllables
+                        CASyllable* removedSyllable = p->voice()->lyricsContextList().at(j)->syllableAtTimeStart(p->timeStart());
+                        if (removedSyllable) {
+                            removedSyllables << removedSyllable;
+                            musElemSet.remove(removedSyllable);
+                        }
+                    }
+
+                    if (p->tuplet()) { // remove the tuplet from selection, because it's deleted when removing the playable
+                        musElemSet.remove(p->tuplet());
+                    }
+                }
+
+                if (_playback && _playback->curPlaying().contains(p)) {
+                    _playback->stopNow();
+                }
+
+                removedPlayables[p->voice()] << p;
+            } else if ((*i)->isPlayable()) {
                 CAPlayable* p = static_cast<CAPlayable*>(*i);
                 if ((p->musElementType() == CAMusElement::Rest) || (!static_cast<CANote*>(p)->isPartOfChord())) {
                     // find out the status of the rests in other voices
@@ -5696,15 +6498,14 @@ void CAMainWin::deleteSelection(CAScoreView* v, bool deleteSyllables, bool delet
                 }
 
                 p->voice()->remove(p, true);
-                for (int j = 0; j < p->voice()->lyricsContextList().size(); j++) {
-                    p->voice()->lyricsContextList().at(j)->repositSyllables();
-                }
+                p->voice()->staff()->sheet()->repositContexts(p->timeStart());
                 delete p;
             } else if ((*i)->musElementType() == CAMusElement::Syllable) {
                 if (deleteSyllables) {
                     CALyricsContext* lc = static_cast<CALyricsContext*>((*i)->context());
+                    int timeStart = (*i)->timeStart();
                     (*i)->context()->remove(*i); // actually removes the syllable if SHIFT is pressed
-                    lc->repositSyllables();
+                    lc->repositSyllables(timeStart);
                 } else {
                     static_cast<CASyllable*>(*i)->clear(); // only clears syllable's text
                 }
@@ -5713,8 +6514,9 @@ void CAMainWin::deleteSelection(CAScoreView* v, bool deleteSyllables, bool delet
                 CAFiguredBassContext* fbc = static_cast<CAFiguredBassContext*>(fbm->context());
 
                 if (deleteSyllables && fbm->numbers().size() == numbersToDelete[fbm].size()) {
+                    int timeStart = fbm->timeStart();
                     (*i)->context()->remove(*i); // actually removes the function if SHIFT is pressed
-                    fbc->repositFiguredBassMarks();
+                    fbc->repositFiguredBassMarks(timeStart);
                 } else {
                     for (int j = 0; j < numbersToDelete[fbm].size(); j++) {
                         fbm->removeNumber(numbersToDelete[fbm][j]);
@@ -5723,8 +6525,9 @@ void CAMainWin::deleteSelection(CAScoreView* v, bool deleteSyllables, bool delet
             } else if ((*i)->musElementType() == CAMusElement::FunctionMark) {
                 if (deleteSyllables) {
                     CAFunctionMarkContext* fmc = static_cast<CAFunctionMarkContext*>((*i)->context());
+                    int timeStart = (*i)->timeStart();
                     (*i)->context()->remove(*i); // actually removes the function if SHIFT is pressed
-                    fmc->repositFunctions();
+                    fmc->repositFunctions(timeStart);
                 } else {
                     static_cast<CAFunctionMark*>(*i)->clear(); // only clears the function
                 }
@@ -5738,12 +6541,26 @@ void CAMainWin::deleteSelection(CAScoreView* v, bool deleteSyllables, bool delet
                 (*i)->context()->remove(*i);
             }
         }
+
+        for (QHash<CAVoice*, QList<CAMusElement*>>::const_iterator i = removedPlayables.constBegin(); i != removedPlayables.constEnd(); i++) {
+            CAVoice* voice = i.key();
+            int timeStart = i.value().first()->timeStart();
+            for (int j = 0; j < i.value().size(); j++) {
+                timeStart = qMin(timeStart, i.value()[j]->timeStart());
+            }
+
+            for (int j = 0; j < voice->lyricsContextList().size(); j++) {
+                voice->lyricsContextList()[j]->removeSyllables(removedSyllables);
+            }
+            voice->removeBlock(i.value(), true);
+            voice->staff()->sheet()->repositContexts(timeStart);
+            qDeleteAll(i.value());
+        }
+
         if (doUndo)
             CACanorus::undo()->pushUndoCommand();
 
-        if (CACanorus::settings()->useNoteChecker()) {
-            _noteChecker.checkSheet(v->sheet());
-        }
+        scheduleNoteCheck(v->sheet());
 
         v->clearSelection();
         CACanorus::rebuildUI(document(), v->sheet());
@@ -5755,14 +6572,23 @@ void CAMainWin::deleteSelection(CAScoreView* v, bool deleteSyllables, bool delet
 */
 void CAMainWin::pasteAt(const QPoint coords, CAScoreView* v)
 {
-    if (QApplication::clipboard()->mimeData() && dynamic_cast<const CAMimeData*>(QApplication::clipboard()->mimeData()) && v->currentContext()) {
+    const QMimeData* mimeData = QApplication::clipboard()->mimeData();
+    if (mimeData && (dynamic_cast<const CAMimeData*>(mimeData) || mimeData->hasFormat(CAMimeData::CANORUS_MIME_TYPE)) && v->currentContext() && !isFrozen(v->currentContext()->context())) {
+        // contexts copied in this instance are used directly, the ones from other instances are read from CanorusML
+        CADocument* foreignDoc = nullptr;
+        QList<CAContext*> contexts;
+        if (dynamic_cast<const CAMimeData*>(mimeData))
+            contexts = static_cast<const CAMimeData*>(mimeData)->contexts();
+        else
+            contexts = CAMimeData::contextsFromCanorusML(mimeData->data(CAMimeData::CANORUS_MIME_TYPE), &foreignDoc);
+        std::unique_ptr<CADocument> foreignDocOwner(foreignDoc);
+
         CACanorus::undo()->createUndoCommand(document(), tr("paste", "undo"));
 
         CAContext* currentContext = v->currentContext()->context();
         CASheet* currentSheet = currentContext->sheet();
 
         QList<CAMusElement*> newEltList;
-        QList<CAContext*> contexts = static_cast<const CAMimeData*>(QApplication::clipboard()->mimeData())->contexts();
         QHash<CAVoice*, CAVoice*> voiceMap; // MimeData -> paste
         CAContext* insertAfter = nullptr;
         for (CAContext* context : contexts) {
@@ -5824,11 +6650,15 @@ void CAMainWin::pasteAt(const QPoint coords, CAScoreView* v)
                 for (int i = staff->voiceList().size() - 1; i < voice + cbstaff->voiceList().size() - 1; i++) {
                     staff->addVoice();
                 }
+                int pasteStart = staff->lastTimeEnd();
+                bool pasteAtEnd = true; // auto-barring only applies to the pasting at the end of the staff
                 for (int i = voice; i < voice + cbstaff->voiceList().size(); i++) {
                     int cbi = i - voice;
                     CADrawableMusElement* drawable = v->nearestRightElement(coords.x(), coords.y(), staff->voiceList()[i]);
                     voiceMap[cbstaff->voiceList()[cbi]] = staff->voiceList()[i];
                     CAMusElement* right = (drawable) ? drawable->musElement() : nullptr;
+                    pasteStart = qMin(pasteStart, right ? right->timeStart() : staff->voiceList()[i]->lastTimeEnd());
+                    pasteAtEnd &= !right;
 
                     // Can't have playables between two notes linked by a tie. Remove the tie in this case.
                     // FIXME this should be the behavior for insert as well.
@@ -5855,8 +6685,18 @@ void CAMainWin::pasteAt(const QPoint coords, CAScoreView* v)
                         }
                     }
 
+                    // without tuplets, the cloned elements are inserted at once and the following elements are shifted only once
+                    bool bulk = true;
+                    for (CAMusElement* elt : cbstaff->voiceList()[cbi]->musElementList()) {
+                        if (elt->isPlayable() && static_cast<CAPlayable*>(elt)->tuplet()) {
+                            bulk = false;
+                            break;
+                        }
+                    }
+
                     QHash<CATuplet*, QList<CAPlayable*>> tupletMap;
                     QHash<CASlur*, CANote*> slurMap;
+                    QList<CAMusElement*> block;
                     for (CAMusElement* elt : cbstaff->voiceList()[cbi]->musElementList()) {
                         CAMusElement* cloned = (elt->isPlayable()) ? static_cast<CAPlayable*>(elt)->clone(staff->voiceList()[i]) : elt->clone(staff);
                         CANote* n = (elt->musElementType() == CAMusElement::Note) ? static_cast<CANote*>(elt) : nullptr;
@@ -5890,6 +6730,12 @@ void CAMainWin::pasteAt(const QPoint coords, CAScoreView* v)
                                 }
                             }
                         }
+                        if (bulk) {
+                            block << cloned;
+                            newEltList << cloned;
+                            continue;
+                        }
+
                         staff->voiceList()[i]->insert(chord ? newEltList.last() : right, cloned, chord);
                         newEltList << cloned;
                         if (elt->isPlayable()) {
@@ -5909,13 +6755,31 @@ void CAMainWin::pasteAt(const QPoint coords, CAScoreView* v)
                                     static_cast<CAFunctionMarkContext*>(context)->addEmptyFunction(cloned->timeStart(), cloned->timeLength());
                         }
                     }
-                    for (CALyricsContext* context : staff->voiceList()[i]->lyricsContextList())
-                        context->repositSyllables();
+
+                    if (bulk && staff->voiceList()[i]->insertBlock(right, block)) {
+                        // pasted in the middle of the voice, add the syllables and functions for the new notes
+                        CANote* lastNote = staff->voiceList()[i]->lastNote();
+                        if (lastNote && !block.contains(lastNote)) {
+                            for (CAMusElement* cloned : block) {
+                                if (cloned->musElementType() != CAMusElement::Note)
+                                    continue;
+                                for (CALyricsContext* context : staff->voiceList()[i]->lyricsContextList())
+                                    context->addEmptySyllable(cloned->timeStart(), cloned->timeLength());
+                                for (CAContext* context : currentSheet->contextList())
+                                    if (context->contextType() == CAContext::FunctionMarkContext)
+                                        static_cast<CAFunctionMarkContext*>(context)->addEmptyFunction(cloned->timeStart(), cloned->timeLength());
+                            }
+                        }
+                    }
+                    CALyricsContext::repositSyllables(staff->voiceList()[i]);
                     for (CAContext* context : currentSheet->contextList())
                         if (context->contextType() == CAContext::FunctionMarkContext)
                             static_cast<CAFunctionMarkContext*>(context)->repositFunctions();
                 }
                 staff->synchronizeVoices();
+                if (pasteAtEnd && CACanorus::settings()->autoBar()) {
+                    staff->placeAutoBars(pasteStart);
+                }
             } else {
                 /// \todo function mark copy&paste unimplemented
                 if (context->contextType() == CAContext::LyricsContext) {
@@ -5938,9 +6802,7 @@ void CAMainWin::pasteAt(const QPoint coords, CAScoreView* v)
             currentContext = (idx + 1 < currentSheet->contextList().size()) ? currentSheet->contextList()[idx + 1] : nullptr;
         }
 
-        if (CACanorus::settings()->useNoteChecker()) {
-            _noteChecker.checkSheet(currentSheet);
-        }
+        scheduleNoteCheck(currentSheet);
 
         CACanorus::undo()->pushUndoCommand();
         CACanorus::rebuildUI(document(), currentSheet);
@@ -5964,14 +6826,7 @@ void CAMainWin::on_uiDynamicText_toggled(bool, int t)
         musElementFactory()->setDynamicText(text);
         uiDynamicCustomText->setText(text);
     } else if (mode() == EditMode) {
-        CAScoreView* v = currentScoreView();
-        if (v && v->selection().size()) {
-            CADynamic* dynamic = dynamic_cast<CADynamic*>(v->selection().at(0)->musElement());
-            if (dynamic) {
-                dynamic->setText(text);
-                CACanorus::rebuildUI(document(), currentSheet());
-            }
-        }
+        setSelectedDynamics(text, -1);
     }
 }
 
@@ -5980,14 +6835,7 @@ void CAMainWin::on_uiDynamicVolume_valueChanged(int vol)
     if (mode() == InsertMode) {
         musElementFactory()->setDynamicVolume(vol);
     } else if (mode() == EditMode) {
-        CAScoreView* v = currentScoreView();
-        if (v && v->selection().size()) {
-            CADynamic* dynamic = dynamic_cast<CADynamic*>(v->selection().at(0)->musElement());
-            if (dynamic) {
-                dynamic->setVolume(vol);
-                CACanorus::rebuildUI(document(), currentSheet());
-            }
-        }
+        setSelectedDynamics(QString(), vol);
     }
 }
 
@@ -6000,15 +6848,62 @@ void CAMainWin::on_uiDynamicCustomText_returnPressed()
     if (mode() == InsertMode) {
         musElementFactory()->setDynamicText(text);
     } else if (mode() == EditMode) {
-        CAScoreView* v = currentScoreView();
-        if (v && v->selection().size()) {
-            CADynamic* dynamic = dynamic_cast<CADynamic*>(v->selection().at(0)->musElement());
-            if (dynamic) {
+        setSelectedDynamics(text, -1);
+    }
+}
+
+/*!
+	Sets the \a text, if not empty, and the \a volume, if not negative, of all the selected
+	dynamic marks as one undoable edit.
+*/
+void CAMainWin::setSelectedDynamics(const QString& text, int volume)
+{
+    if (!currentScoreView()) {
+        return;
+    }
+
+    QList<CAMusElement*> changed;
+    QList<CAMusElement*> selection = currentScoreView()->musElementSelection();
+    CACanorus::undo()->createUndoCommand(document(), tr("change dynamics", "undo"), selectedStaff());
+    for (int i = 0; i < selection.size(); i++) {
+        CADynamic* dynamic = dynamic_cast<CADynamic*>(selection[i]);
+        if (dynamic) {
+            if (!text.isEmpty()) {
                 dynamic->setText(text);
-                CACanorus::rebuildUI(document(), currentSheet());
             }
+            if (volume >= 0) {
+                dynamic->setVolume(volume);
+            }
+            changed << dynamic;
         }
     }
+
+    if (changed.size()) {
+        CACanorus::undo()->pushUndoCommand();
+        rebuildChangedElements(changed);
+    }
+}
+
+/*!
+	Re-engraves the current sheet between the first and the last of the \a changed music elements
+	after changing their properties, instead of the whole sheet.
+
+	\sa CACanorus::rebuildUI(CADocument*, CASheet*, int, int)
+*/
+void CAMainWin::rebuildChangedElements(const QList<CAMusElement*>& changed)
+{
+    if (changed.isEmpty()) {
+        return;
+    }
+
+    int timeStart = changed.first()->timeStart();
+    int timeEnd = changed.first()->timeEnd();
+    for (int i = 1; i < changed.size(); i++) {
+        timeStart = qMin(timeStart, changed[i]->timeStart());
+        timeEnd = qMax(timeEnd, changed[i]->timeEnd());
+    }
+
+    CACanorus::rebuildUI(document(), currentSheet(), timeStart, timeEnd);
 }
 
 void CAMainWin::on_uiInstrumentChange_activated(int index)
@@ -6017,7 +6912,7 @@ void CAMainWin::on_uiInstrumentChange_activated(int index)
         musElementFactory()->setInstrument(index);
     } else if (mode() == EditMode) {
         CAScoreView* v = currentScoreView();
-        CACanorus::undo()->createUndoCommand(document(), tr("change fermata type", "undo"));
+        CACanorus::undo()->createUndoCommand(document(), tr("change fermata type", "undo"), selectedStaff());
 
         for (int i = 0; i < v->selection().size(); i++) {
             CAInstrumentChange* instrument = dynamic_cast<CAInstrumentChange*>(v->selection().at(i)->musElement());
@@ -6040,7 +6935,7 @@ void CAMainWin::on_uiFermataType_toggled(bool, int t)
         musElementFactory()->setFermataType(type);
     } else if (mode() == EditMode && currentScoreView() && currentScoreView()->selection().size()) {
         CAScoreView* v = currentScoreView();
-        CACanorus::undo()->createUndoCommand(document(), tr("change fermata type", "undo"));
+        CACanorus::undo()->createUndoCommand(document(), tr("change fermata type", "undo"), selectedStaff());
 
         for (int i = 0; i < v->selection().size(); i++) {
             CAFermata* fm = dynamic_cast<CAFermata*>(v->selection().at(i)->musElement());
@@ -6063,7 +6958,7 @@ void CAMainWin::on_uiFinger_toggled(bool, int t)
         musElementFactory()->setFingeringFinger(type);
     } else if (mode() == EditMode && currentScoreView() && currentScoreView()->selection().size()) {
         CAScoreView* v = currentScoreView();
-        CACanorus::undo()->createUndoCommand(document(), tr("change finger", "undo"));
+        CACanorus::undo()->createUndoCommand(document(), tr("change finger", "undo"), selectedStaff());
 
         for (int i = 0; i < v->selection().size(); i++) {
             CAFingering* f = dynamic_cast<CAFingering*>(v->selection().at(i)->musElement());
@@ -6084,7 +6979,7 @@ void CAMainWin::on_uiFingeringOriginal_toggled(bool checked)
         musElementFactory()->setFingeringOriginal(checked);
     } else if (mode() == EditMode && currentScoreView() && currentScoreView()->selection().size()) {
         CAScoreView* v = currentScoreView();
-        CACanorus::undo()->createUndoCommand(document(), tr("change finger original property", "undo"));
+        CACanorus::undo()->createUndoCommand(document(), tr("change finger original property", "undo"), selectedStaff());
 
         for (int i = 0; i < v->selection().size(); i++) {
             CAFingering* f = dynamic_cast<CAFingering*>(v->selection().at(i)->musElement());
@@ -6116,7 +7011,7 @@ void CAMainWin::on_uiRepeatMarkType_toggled(bool, int t)
         musElementFactory()->setRepeatMarkVoltaNumber(voltaNumber);
     } else if (mode() == EditMode && currentScoreView() && currentScoreView()->selection().size()) {
         CAScoreView* v = currentScoreView();
-        CACanorus::undo()->createUndoCommand(document(), tr("change repeat mark", "undo"));
+        CACanorus::undo()->createUndoCommand(document(), tr("change repeat mark", "undo"), selectedStaff());
 
         for (int i = 0; i < v->selection().size(); i++) {
             CARepeatMark* r = dynamic_cast<CARepeatMark*>(v->selection().at(i)->musElement());
@@ -6140,7 +7035,7 @@ void CAMainWin::on_uiTempoBeat_toggled(bool, int t)
         musElementFactory()->setTempoBeat(length);
     } else if (mode() == EditMode && currentScoreView() && currentScoreView()->selection().size()) {
         CAScoreView* v = currentScoreView();
-        CACanorus::undo()->createUndoCommand(document(), tr("change tempo beat", "undo"));
+        CACanorus::undo()->createUndoCommand(document(), tr("change tempo beat", "undo"), selectedStaff());
 
         for (int i = 0; i < v->selection().size(); i++) {
             CATempo* tempo = dynamic_cast<CATempo*>(v->selection().at(i)->musElement());
@@ -6164,7 +7059,7 @@ void CAMainWin::on_uiTempoBpm_returnPressed()
         musElementFactory()->setTempoBpm(bpm);
     } else if (mode() == EditMode) {
         CAScoreView* v = currentScoreView();
-        CACanorus::undo()->createUndoCommand(document(), tr("change tempo bpm", "undo"));
+        CACanorus::undo()->createUndoCommand(document(), tr("change tempo bpm", "undo"), selectedStaff());
 
         for (int i = 0; i < v->selection().size(); i++) {
             CATempo* tempo = dynamic_cast<CATempo*>(v->selection().at(i)->musElement());
@@ -6208,18 +7103,18 @@ void CAMainWin::onUiOpenRecentDocumentTriggered()
 
 /*!
 	Immediately plays the notes. This is usually called when inserting
-	new notes or changing the pitch of existing notes.
+	new notes or changing the pitch of existing notes. Nothing is played
+	while the sheet playback is running.
 
-	\sa CASettings::_playInsertedNotes
+	\sa CASettings::_playInsertedNotes, CAAudition
  */
 void CAMainWin::playImmediately(QList<CAMusElement*> elements)
 {
-    if (!_playback) {
-        _playback = new CAPlayback(CACanorus::midiDevice());
-        connect(_playback, SIGNAL(playbackFinished()), this, SLOT(playbackFinished()));
+    if (_playback) { // the sheet is being played
+        return;
     }
 
-    _playback->playImmediately(elements, CACanorus::settings()->midiOutPort());
+    CACanorus::audition()->play(elements, CACanorus::settings()->midiOutPort());
 }
 
 /*!
@@ -10,7 +10,9 @@
 
 #include <QFileDialog>
 #include <QHash>
+#include <QElapsedTimer>
 #include <QObject>
+#include <QSet>
 #include <QTime>
 #include <QTimer>
 
@@ -18,6 +20,7 @@
 
 #include "control/mainwinprogressctl.h"
 
+#include "core/chordanalyzer.h"
 #include "core/notechecker.h"
 
 #include "score/clef.h"
@@ -70,6 +73,7 @@ class CAKeybdInput;
 class CAExport;
 class CAActionStorage;
 class CAImport;
+class CAUndoCommand;
 
 class CAMainWin : public QMainWindow, private Ui::uiMainWindow {
     Q_OBJECT
@@ -77,6 +81,7 @@ class CAMainWin : public QMainWindow, private Ui::uiMainWindow {
     friend class CAMainWinProgressCtl;
     friend class CAActionDelegate;
     friend class CAActionStorage;
+    friend class CASessionJournal;
 
 public:
     enum CAMode {
@@ -92,12 +97,13 @@ public:
 
     void clearUI();
     void rebuildUI(CASheet* sheet, bool repaint = true);
+    void rebuildUI(CASheet* sheet, int timeStart, int timeEnd, bool repaint = true);
     void rebuildUI(bool repaint = true);
     inline bool rebuildUILock() { return _rebuildUILock; }
     void updateWindowTitle();
 
     void newDocument();
-    void addSheet(CASheet* s);
+    void addSheet(CASheet* s, bool select = true);
     void removeSheet(CASheet* s);
     bool insertMusElementAt(const QPoint coords, CAScoreView* v);
     void restartTimeEditedTime() { _timeEditedTime = 0; }
@@ -107,15 +113,17 @@ public:
 
     CADocument* openDocument(const QString& fileName);
     CADocument* openDocument(CADocument* doc);
+    void openImport(std::unique_ptr<CAImport> import);
     bool saveDocument(QString fileName);
 
     void setMode(CAMode mode, const QString& oModeHash);
     inline CAMode mode() { return _mode; }
-    inline QFileDialog* saveDialog() { return uiSaveDialog.get(); }
-    inline QFileDialog* openDialog() { return uiOpenDialog.get(); }
-    inline QFileDialog* exportDialog() { return uiExportDialog.get(); }
-    inline QFileDialog* importDialog() { return uiImportDialog.get(); }
+    QFileDialog* saveDialog();
+    QFileDialog* openDialog();
+    QFileDialog* exportDialog();
+    QFileDialog* importDialog();
     inline CAResourceView* resourceView() { return _resourceView; }
+    inline CAPlayback* playback() { return _playback; }
     inline QAction* resourceViewAction() { return uiResourceView; }
     inline CAMidiRecorderView* midiRecorderView() { return _midiRecorderView; }
     inline void setMidiRecorderView(CAMidiRecorderView* v) { _midiRecorderView = v; }
@@ -132,6 +140,7 @@ public:
     }
 
     CASheet* currentSheet();
+    CAScoreView* showSheet(CASheet* sheet);
 
     inline CAStaff* currentStaff()
     {
@@ -145,32 +154,25 @@ public:
     CAContext* currentContext();
     void setCurrentVoice(CAVoice*);
     CAVoice* currentVoice();
+    CAStaff* selectedStaff();
     inline CAViewContainer* currentViewContainer() { return _currentViewContainer; }
     inline CADocument* document() { return _document; }
 
     inline void setDocument(CADocument* document)
     {
+        _chordAnalyzer.cancel(); // the results belong to the previous document
         _document = document;
         _resourceView->setDocument(document);
     }
     inline bool isInsertKeySigChecked() { return uiInsertKeySig->isChecked(); }
 
-    // Dialogs, Windows
-    std::unique_ptr<QFileDialog> uiSaveDialog;
-    std::unique_ptr<QFileDialog> uiOpenDialog;
-    std::unique_ptr<QFileDialog> uiExportDialog;
-    std::unique_ptr<QFileDialog> uiImportDialog;
-
     // Python Console
     CAPyConsole* pyConsole;
     CAPyConsoleInterface* pyConsoleIface;
 
     QDockWidget* helpDock() { return uiHelpDock; }
 #ifdef QT_WEBENGINEWIDGETS_LIB
-    CAHelpBrowser* helpWidget()
-    {
-        return uiHelpWidget;
-    }
+    CAHelpBrowser* helpWidget();
 #endif
 private slots:
     ///////////////////////////
@@ -186,6 +188,7 @@ private slots:
     void on_uiExportDocument_triggered();
     void on_uiImportDocument_triggered();
     void on_uiExportToPdf_triggered();
+    void on_uiPublish_triggered();
     void on_uiOpenRecent_aboutToShow();
     void onUiOpenRecentDocumentTriggered();
 
@@ -227,6 +230,8 @@ private slots:
     void on_uiCanorusMLSource_triggered();
     void on_uiResourceView_toggled(bool);
     void on_uiShowRuler_toggled(bool);
+    void on_uiUnfoldContexts_triggered();
+    void on_uiPerformancePanel_toggled(bool);
 
     // Sheet
     void on_uiRemoveSheet_triggered();
@@ -236,6 +241,8 @@ private slots:
     // Context
     void on_uiContextName_returnPressed();
     void on_uiRemoveContext_triggered();
+    void on_uiFreezeContext_toggled(bool);
+    void on_uiFoldContext_triggered();
     void on_uiStanzaNumber_valueChanged(int);
     void on_uiAssociatedVoice_activated(int);
     void on_uiContextProperties_triggered();
@@ -321,6 +328,9 @@ private slots:
 public slots:
     void on_uiUsersGuide_triggered();
 private slots:
+    void on_uiSavePerformanceTrace_triggered();
+    void on_uiMemoryStatistics_triggered();
+    void on_uiActionLatencies_triggered();
     void on_uiAboutCanorus_triggered();
     void on_uiAboutQt_triggered();
 
@@ -345,6 +355,9 @@ private slots:
     void floatViewClosed(CAView*);
 
     void onTimeEditedTimerTimeout();
+    void onNoteCheckTimerTimeout();
+    void onWarmUpTimerTimeout();
+    void onChordNamesChanged(CASheet* sheet);
 
     void playbackFinished();
     void onScoreViewSelectionChanged();
@@ -353,11 +366,17 @@ private slots:
     ////////////////////////////////
     // Handle progress bar events //
     ////////////////////////////////
+    void onSheetPublished(CASheet* sheet);
     void onImportDone(int status);
     void onExportDone(int status);
+    void onPublishFinished();
+    void onPluginExportFinished();
 
 private:
     void playImmediately(QList<CAMusElement*> elements);
+    void openImport();
+    void setSelectedDynamics(const QString& text, int volume);
+    void rebuildChangedElements(const QList<CAMusElement*>& changed);
 
     ////////////////////////
     // General properties //
@@ -394,7 +413,8 @@ private:
     CAView* _currentView;
     CAView* _playbackView;
     QList<CADrawableMusElement*> _prePlaybackSelection;
-    QTimer* _repaintTimer;
+    QTimer* _repaintTimer; // updates the playback cursor at the display refresh rate
+    int _playingGeneration; // CAPlayback::playingGeneration() shown by the playback cursor
     bool _rebuildUILock;
     inline void setRebuildUILock(bool l) { _rebuildUILock = l; }
 
@@ -403,7 +423,26 @@ private:
     unsigned int _timeEditedTime;
     CAMusElementFactory* _musElementFactory;
     CANoteChecker _noteChecker;
+    QTimer _noteCheckTimer; // runs the note checker and the chord analysis after the edits settle
+    QSet<CASheet*> _noteCheckSheets; // sheets waiting for the note checker and the chord analysis
+    CAChordAnalyzer _chordAnalyzer; // fills the chord name contexts in the background
+    void scheduleNoteCheck(CASheet* sheet);
+    QTimer _warmUpTimer; // lays out the sheets of the hidden tabs when the window is idle
+    QList<CASheet*> _recentSheets; // sheets in the order their tabs were shown, the last one first
+    QSet<CASheet*> _coldSheets; // sheets released by releaseColdLayouts(), not laid out until shown again
+    QList<CASheet*> sheetsByUse();
+    CAScoreView* hiddenScoreView(CASheet* sheet);
+    int releaseColdLayouts(CASheet* keep);
+    static const int WARM_UP_INTERVAL; // ms the window is idle before the next hidden sheet is laid out
+    static const int MAX_WARM_DRAWABLES; // drawable elements kept for the sheets of the hidden tabs
+    static const int RAPID_ENTRY_INTERVAL; // ms between note entries merged into a single undo step
+    QElapsedTimer _rapidEntryTimer; // started after each note or rest entry
+    CAStaff* _rapidEntryStaff; // staff of the last note or rest entry, null if the last insertion was something else
+    CAUndoCommand* _rapidEntryCommand; // undo command covering the current run of entries
+    bool continuesRapidEntry(CAStaff* staff);
+    bool isFrozen(CAContext* context);
     std::unique_ptr<CAImport> _importFile;
+    QList<CASheet*> _publishedSheets; // sheets of the document being opened which are already shown
 
 public:
     inline CAMusElementFactory* musElementFactory() { return _musElementFactory; }
@@ -427,6 +466,7 @@ private:
     void initView(CAView*);
     void updateUndoRedoButtons();
     void updateToolBars();
+    void rebuildChangedSheets();
     void updateSheetToolBar();
     void updateContextToolBar();
     void updateVoiceToolBar();
@@ -478,6 +518,8 @@ private:
     // CAContext
     QLineEdit* uiContextName;
     //QAction         *uiRemoveContext; // made by Qt Designer
+    //QAction         *uiFreezeContext; // made by Qt Designer
+    //QAction         *uiFoldContext; // made by Qt Designer
     //QAction         *uiContextProperties; // made by Qt Designer
     // CAStaff
     // CALyricsContext
@@ -569,10 +611,13 @@ private:
     // Python console
     QDockWidget* uiPyConsoleDock;
 
+    // Performance panel
+    QDockWidget* uiPerformanceDock;
+
     // Help widget
     QDockWidget* uiHelpDock;
 #ifdef QT_WEBENGINEWIDGETS_LIB
-    CAHelpBrowser* uiHelpWidget;
+    CAHelpBrowser* uiHelpWidget; // created by helpWidget() when the help is first shown
 #endif
 };
 #endif /* MAINWIN_H_ */
@@ -14,6 +14,7 @@
 
 #include "canorus.h"
 #include "core/undo.h"
+#include "interface/mididevice.h"
 
 #include "score/chordnamecontext.h"
 #include "score/document.h"
@@ -356,6 +357,7 @@ void CAPropertiesDialog::applyProperties()
         CAVoiceProperties* vp = static_cast<CAVoiceProperties*>(_voicePropertiesWidget[voice]);
         voice->setMidiChannel(vp->uiMidiChannel->value() - 1);
         voice->setMidiPitchOffset(vp->uiMidiPitchOffset->value());
+        voice->setMidiPort(vp->uiMidiPort->currentIndex() > 0 ? vp->uiMidiPort->currentText() : QString());
     }
 
     CACanorus::rebuildUI(_document);
@@ -460,6 +462,16 @@ void CAPropertiesDialog::updateVoiceProperties(CAVoice* voice)
 {
     static_cast<CAVoiceProperties*>(_voicePropertiesWidget[voice])->uiMidiChannel->setValue(voice->midiChannel() + 1);
     static_cast<CAVoiceProperties*>(_voicePropertiesWidget[voice])->uiMidiPitchOffset->setValue(voice->midiPitchOffset());
+
+    // the port of the voice is kept, even if the synthesizer isn't connected now
+    QComboBox* port = static_cast<CAVoiceProperties*>(_voicePropertiesWidget[voice])->uiMidiPort;
+    port->clear();
+    port->addItem(tr("Default"));
+    port->addItems(CACanorus::midiDevice()->getOutputPorts().values());
+    if (!voice->midiPort().isEmpty() && port->findText(voice->midiPort()) == -1) {
+        port->addItem(voice->midiPort());
+    }
+    port->setCurrentIndex(voice->midiPort().isEmpty() ? 0 : port->findText(voice->midiPort()));
 }
 
 void CAPropertiesDialog::updateLyricsContextProperties(CALyricsContext* lc)
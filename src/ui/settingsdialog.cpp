@@ -7,12 +7,17 @@
 
 #include <QBoxLayout>
 #include <QDir>
+#include <QEventLoop>
 #include <QFileDialog>
+#include <QMessageBox>
+#include <QProgressDialog>
 #include <QSettings>
 
 // Python.h needs to be loaded first!
 #include "canorus.h"
 #include "core/settings.h"
+#include "interface/audition.h"
+#include "interface/midilatencycalibration.h"
 #include "interface/mididevice.h"
 #include "score/clef.h" // needed for preview sheet
 #include "score/sheet.h" // needed for preview sheet
@@ -56,6 +61,7 @@ void CASettingsDialog::setupPages(CASettingsPage currentPage)
     uiPlayInsertedNotes->setChecked(CACanorus::settings()->playInsertedNotes());
     uiAutoBar->setChecked(CACanorus::settings()->autoBar());
     uiUseNoteChecker->setChecked(CACanorus::settings()->useNoteChecker());
+    uiUndoMemoryLimitSpinBox->setValue(CACanorus::settings()->undoMemoryLimit());
 
     // Appearance Page
     uiAntiAliasing->setChecked(CACanorus::settings()->antiAliasing());
@@ -88,6 +94,7 @@ void CASettingsDialog::setupPages(CASettingsPage currentPage)
             CAFileFormats::getFilter(CACanorus::settings()->defaultSaveFormat())));
 
     uiAutoRecoverySpinBox->setValue(CACanorus::settings()->autoRecoveryInterval());
+    uiJournaledSave->setChecked(CACanorus::settings()->journaledSave());
 
     // Playback Page
     _midiInPorts = CACanorus::midiDevice()->getInputPorts();
@@ -102,6 +109,10 @@ void CASettingsDialog::setupPages(CASettingsPage currentPage)
     if (CACanorus::settings()->midiInPort() == -1)
         uiMidiInList->setCurrentItem(uiMidiInList->item(0)); // select the previous device
 
+    for (const QString& port : _midiOutPorts) {
+        _midiOutLatencies[port] = CACanorus::settings()->midiOutLatency(port);
+    }
+
     uiMidiOutList->addItem(tr("None"));
     for (int i = 0; i < _midiOutPorts.values().size(); i++) {
         uiMidiOutList->addItem(_midiOutPorts.value(i));
@@ -110,6 +121,7 @@ void CASettingsDialog::setupPages(CASettingsPage currentPage)
     }
     if (CACanorus::settings()->midiOutPort() == -1)
         uiMidiOutList->setCurrentItem(uiMidiOutList->item(0)); // select the previous device
+    on_uiMidiOutList_currentRowChanged(uiMidiOutList->currentRow());
 
     uiSettingsList->setCurrentRow((currentPage != UndefinedSettings) ? currentPage : 0);
 
@@ -147,17 +159,16 @@ void CASettingsDialog::applySettings()
     CACanorus::settings()->setPlayInsertedNotes(uiPlayInsertedNotes->isChecked());
     CACanorus::settings()->setAutoBar(uiAutoBar->isChecked());
     CACanorus::settings()->setUseNoteChecker(uiUseNoteChecker->isChecked());
+    CACanorus::settings()->setUndoMemoryLimit(uiUndoMemoryLimitSpinBox->value());
 
     // Saving/Loading Page
     CACanorus::settings()->setDocumentsDirectory(uiDocumentsDirectory->text());
-    _mainWin->uiOpenDialog->setDirectory(CACanorus::settings()->documentsDirectory());
-    _mainWin->uiSaveDialog->setDirectory(CACanorus::settings()->documentsDirectory());
-    _mainWin->uiImportDialog->setDirectory(CACanorus::settings()->documentsDirectory());
-    _mainWin->uiExportDialog->setDirectory(CACanorus::settings()->documentsDirectory());
+    CACanorus::setFileDialogsDirectory(CACanorus::settings()->documentsDirectory());
     CACanorus::settings()->setDefaultSaveFormat(CAFileFormats::getType(uiDefaultSaveComboBox->currentText()));
-    _mainWin->uiSaveDialog->selectNameFilter(uiDefaultSaveComboBox->currentText());
+    _mainWin->saveDialog()->selectNameFilter(uiDefaultSaveComboBox->currentText());
     CACanorus::settings()->setAutoRecoveryInterval(uiAutoRecoverySpinBox->value());
     CACanorus::autoRecovery()->updateTimer();
+    CACanorus::settings()->setJournaledSave(uiJournaledSave->isChecked());
 
     // Appearance Page
     CACanorus::settings()->setAntiAliasing(uiAntiAliasing->isChecked());
@@ -181,6 +192,10 @@ void CASettingsDialog::applySettings()
     else
         CACanorus::settings()->setMidiOutPort(_midiOutPorts.keys().at(uiMidiOutList->currentIndex().row() - 1));
 
+    for (QMap<QString, int>::const_iterator i = _midiOutLatencies.constBegin(); i != _midiOutLatencies.constEnd(); i++) {
+        CACanorus::settings()->setMidiOutLatency(i.key(), i.value());
+    }
+
     // Printing Page
     CACanorus::settings()->setTypesetter(static_cast<CATypesetter::CATypesetterType>(uiTypesetter->currentIndex() + 1));
     CACanorus::settings()->setTypesetterLocation(uiTypesetterLocation->text());
@@ -388,3 +403,75 @@ void CASettingsDialog::on_uiPdfViewerDefault_toggled(bool checked)
         uiPdfViewerBrowse->setEnabled(true);
     }
 }
+
+/*!
+	Shows the output latency of the selected MIDI OUT device.
+*/
+void CASettingsDialog::on_uiMidiOutList_currentRowChanged(int row)
+{
+    bool port = (row > 0 && row <= _midiOutPorts.size());
+    uiMidiOutLatency->setEnabled(port);
+    uiMidiOutCalibrate->setEnabled(port);
+    uiMidiOutLatency->blockSignals(true);
+    uiMidiOutLatency->setValue(port ? _midiOutLatencies.value(_midiOutPorts.values().at(row - 1)) : 0);
+    uiMidiOutLatency->blockSignals(false);
+}
+
+void CASettingsDialog::on_uiMidiOutLatency_valueChanged(int latency)
+{
+    int row = uiMidiOutList->currentRow();
+    if (row > 0 && row <= _midiOutPorts.size()) {
+        _midiOutLatencies[_midiOutPorts.values().at(row - 1)] = latency;
+    }
+}
+
+/*!
+	Measures the output latency of the selected MIDI OUT device by CAMidiLatencyCalibration. The
+	user taps along with the clicks on the MIDI IN device currently in use.
+*/
+void CASettingsDialog::on_uiMidiOutCalibrate_clicked(bool)
+{
+    int row = uiMidiOutList->currentRow();
+    if (row <= 0 || row > _midiOutPorts.size()) {
+        return;
+    }
+
+    CAMidiDevice* device = CACanorus::midiDevice();
+    if (CACanorus::audition()) {
+        CACanorus::audition()->stop();
+    }
+    device->closeOutputPort();
+    if (!device->openOutputPort(_midiOutPorts.keys().at(row - 1))) {
+        QMessageBox::warning(this, tr("Canorus"), tr("The MIDI OUT device cannot be opened."));
+        return;
+    }
+
+    CAMidiLatencyCalibration calibration(device);
+    QProgressDialog progress(tr("Tap any key of the MIDI keyboard together with the clicks you hear."), tr("Cancel"), 0, CAMidiLatencyCalibration::CLICKS, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setAutoClose(false);
+    progress.setAutoReset(false);
+
+    QEventLoop loop;
+    connect(&calibration, SIGNAL(clicked(int)), &progress, SLOT(setValue(int)));
+    connect(&calibration, SIGNAL(finished(int)), &loop, SLOT(quit()));
+    connect(&progress, SIGNAL(canceled()), &loop, SLOT(quit()));
+    calibration.start();
+    progress.show();
+    loop.exec();
+
+    bool canceled = calibration.isRunning();
+    calibration.stop();
+    progress.hide();
+    device->closeOutputPort();
+    if (canceled) {
+        return;
+    }
+
+    int latency = calibration.latency();
+    if (latency < 0) {
+        QMessageBox::warning(this, tr("Canorus"), tr("Not enough taps were received. Check the MIDI IN device and try again."));
+    } else {
+        uiMidiOutLatency->setValue(qMin(latency, uiMidiOutLatency->maximum()));
+    }
+}
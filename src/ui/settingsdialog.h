@@ -64,6 +64,10 @@ private slots:
     void on_uiTypesetterDefault_toggled(bool);
     void on_uiPdfViewerDefault_toggled(bool);
 
+    void on_uiMidiOutList_currentRowChanged(int);
+    void on_uiMidiOutLatency_valueChanged(int);
+    void on_uiMidiOutCalibrate_clicked(bool);
+
 private:
     void setupPages(CASettingsPage currentPage = EditorSettings);
     void buildPreviewSheet();
@@ -75,6 +79,7 @@ private:
     CAActionsEditor* _commandsEditor;
     QMap<int, QString> _midiInPorts;
     QMap<int, QString> _midiOutPorts;
+    QMap<QString, int> _midiOutLatencies; // edited latency of each output port by its name
     CAMainWin* _mainWin; // access to file dialogs instances
 };
 #endif /* MIDISETUPDIALOG_H_ */
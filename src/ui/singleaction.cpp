@@ -9,6 +9,8 @@
 
 #include "singleaction.h"
 
+int CASingleAction::_keyRevision = 0;
+
 CASingleAction::CASingleAction(QObject*)
     : _pAction(nullptr)
 {
@@ -32,6 +34,7 @@ void CASingleAction::setCommandName(QString oCommandName)
         }
         _oCommandNameNoAmpersand = _oCommandName;
         _oCommandNameNoAmpersand.remove("&");
+        _keyRevision++;
     }
 }
 
@@ -52,6 +55,7 @@ void CASingleAction::setShortCutAsString(QString oShortCut)
         if (_pAction) {
             _pAction->setShortcut(oShortCut);
         }
+        _keyRevision++;
         //_oSysShortCut = shortcut();
     }
 }
@@ -67,6 +71,7 @@ void CASingleAction::setMidiKeySequence(QString oMidiKeySequence, bool combined)
         foreach (le, mksList) {
             _oMidiKeyParameters.push_back(le.toInt());
         }
+        _keyRevision++;
     }
 }
 
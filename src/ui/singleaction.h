@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2009, Reinhard Katzmann, Matevž Jekovec, Canorus development team
+	Copyright (c) 2009-2020, Reinhard Katzmann, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
@@ -42,6 +42,9 @@ public:
     QAction* newAction(QObject* parent = nullptr);
     static void fromQAction(const QAction& action, CASingleAction& sAction);
 
+    // Changes whenever a command name, shortcut or midi key sequence of any action is set
+    static inline int keyRevision() { return _keyRevision; }
+
 protected:
     // Action parameters to be stored / loaded via Settings Dialog
     QString _oCommandName;
@@ -55,6 +58,9 @@ protected:
     QKeySequence _oSysShortCut;
     QList<int> _oMidiKeyParameters;
     bool m_localCreated = false;
+
+private:
+    static int _keyRevision;
 };
 
 #endif // _CASINGLEACTION_H_
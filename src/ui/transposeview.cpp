@@ -186,6 +186,6 @@ void CATransposeView::on_uiApply_clicked(QAbstractButton*)
         }
 
         CACanorus::undo()->pushUndoCommand();
-        CACanorus::rebuildUI(static_cast<CAMainWin*>(parent())->document(), v->sheet());
+        CACanorus::rebuildUI(static_cast<CAMainWin*>(parent())->document(), v->sheet(), t.timeStart(), t.timeEnd());
     }
 }
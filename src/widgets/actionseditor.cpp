@@ -120,6 +120,9 @@ CAActionsEditor::CAActionsEditor(QWidget* parent, Qt::WindowFlags f)
         this, SLOT(editShortcut()));
     //#endif
 
+    filterEdit = new QLineEdit(this);
+    connect(filterEdit, SIGNAL(textChanged(const QString&)), this, SLOT(filterActions(const QString&)));
+
     saveButton = new QPushButton(this);
     loadButton = new QPushButton(this);
 
@@ -143,6 +146,7 @@ CAActionsEditor::CAActionsEditor(QWidget* parent, Qt::WindowFlags f)
     QVBoxLayout* mainLayout = new QVBoxLayout(this);
     mainLayout->setMargin(8);
     mainLayout->setSpacing(8);
+    mainLayout->addWidget(filterEdit);
     mainLayout->addWidget(actionsTable);
     mainLayout->addLayout(buttonLayout);
 
@@ -160,6 +164,8 @@ void CAActionsEditor::retranslateStrings()
     //saveButton->setIcon(Images::icon("save"));
     //loadButton->setIcon(Images::icon("open"));
 
+    filterEdit->setPlaceholderText(tr("Filter"));
+
     saveButton->setText(tr("&Save shortcuts..."));
     loadButton->setText(tr("&Load shortcuts..."));
 
@@ -203,6 +209,10 @@ void CAActionsEditor::addActions(const QList<CASingleAction*>& actionList)
 void CAActionsEditor::updateView()
 {
     actionsTable->setRowCount(m_actionsList.count());
+    commandRows.clear();
+    shortcutRows.clear();
+    midiRows.clear();
+    commandRows.reserve(m_actionsList.count());
 
     CASingleAction* action;
     QString accelText, midi_com, midi_scut, description;
@@ -262,9 +272,17 @@ void CAActionsEditor::updateView()
         actionsTable->setItem(n, COL_SHORTCUT, i_shortcut);
         actionsTable->setItem(n, COL_MIDI, i_midi);
         actionsTable->setItem(n, COL_MIDISCUT, i_midiscut);
+
+        if (!commandRows.contains(i_command->text()))
+            commandRows.insert(i_command->text(), n);
+        shortcutRows.insert(accelText, n);
+        midiRows.insert(midi_com, n);
     }
     hasConflicts(); // Check for conflicts
 
+    filterText.clear();
+    filterActions(filterEdit->text());
+
     actionsTable->resizeColumnsToContents();
     // @ToDo: Set to last edited cell type (Midi or Shortcut ?)
     actionsTable->setCurrentCell(0, COL_SHORTCUT);
@@ -322,6 +340,7 @@ void CAActionsEditor::recordAction(QTableWidgetItem* i)
 void CAActionsEditor::validateAction(QTableWidgetItem* i)
 {
     //qDebug("CAActionsEditor::validateAction");
+    indexAction(i); // also when loading, before the conflicts are checked
     if (dont_validate)
         return;
 
@@ -375,41 +394,72 @@ void CAActionsEditor::editShortcut()
     }
 }
 
+void CAActionsEditor::indexAction(QTableWidgetItem* i)
+{
+    if (i->column() == COL_SHORTCUT && !shortcutRows.contains(i->text(), i->row()))
+        shortcutRows.insert(i->text(), i->row());
+    else if (i->column() == COL_MIDI && !midiRows.contains(i->text(), i->row()))
+        midiRows.insert(i->text(), i->row());
+}
+
 int CAActionsEditor::findActionCommand(const QString& name)
 {
-    for (int row = 0; row < actionsTable->rowCount(); row++) {
-        if (actionsTable->item(row, COL_COMMAND)->text() == name)
-            return row;
-    }
-    return -1;
+    return commandRows.value(name, -1);
 }
 
 int CAActionsEditor::findActionAccel(const QString& accel, int ignoreRow)
 {
-    for (int row = 0; row < actionsTable->rowCount(); row++) {
-        QTableWidgetItem* i = actionsTable->item(row, COL_SHORTCUT);
-        if ((i) && (i->text() == accel)) {
-            if (ignoreRow == -1)
-                return row;
-            else if (ignoreRow != row)
-                return row;
-        }
-    }
-    return -1;
+    return findActionRow(shortcutRows, COL_SHORTCUT, accel, ignoreRow);
 }
 
 int CAActionsEditor::findActionMidi(const QString& midi, int ignoreRow)
 {
+    return findActionRow(midiRows, COL_MIDI, midi, ignoreRow);
+}
+
+/*!
+	Returns the first row except \a ignoreRow with the given \a text in the column \a col or -1.
+	The rows in the \a index are only candidates, because the item may have been edited since.
+*/
+int CAActionsEditor::findActionRow(const QMultiHash<QString, int>& index, int col, const QString& text, int ignoreRow)
+{
+    int found = -1;
+    for (QMultiHash<QString, int>::const_iterator it = index.constFind(text); it != index.constEnd() && it.key() == text; ++it) {
+        int row = it.value();
+        if (row == ignoreRow || (found != -1 && row > found))
+            continue;
+
+        QTableWidgetItem* i = actionsTable->item(row, col);
+        if (i && i->text() == text)
+            found = row;
+    }
+    return found;
+}
+
+bool CAActionsEditor::rowMatchesFilter(int row, const QString& text)
+{
+    for (int col = COL_COMMAND; col <= COL_MIDI; col++) {
+        QTableWidgetItem* i = actionsTable->item(row, col);
+        if (i && i->text().contains(text, Qt::CaseInsensitive))
+            return true;
+    }
+    return false;
+}
+
+/*!
+	Hides the rows which don't contain \a text in their name, description, shortcut or midi command.
+	When the new text contains the previous filter, only the currently shown rows are checked again.
+*/
+void CAActionsEditor::filterActions(const QString& text)
+{
+    bool narrowing = !filterText.isEmpty() && text.contains(filterText, Qt::CaseInsensitive);
     for (int row = 0; row < actionsTable->rowCount(); row++) {
-        QTableWidgetItem* i = actionsTable->item(row, COL_MIDI);
-        if ((i) && (i->text() == midi)) {
-            if (ignoreRow == -1)
-                return row;
-            else if (ignoreRow != row)
-                return row;
-        }
+        if (narrowing && actionsTable->isRowHidden(row))
+            continue;
+
+        actionsTable->setRowHidden(row, !text.isEmpty() && !rowMatchesFilter(row, text));
     }
-    return -1;
+    filterText = text;
 }
 
 bool CAActionsEditor::hasConflicts(bool bMidi)
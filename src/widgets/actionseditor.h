@@ -1,5 +1,5 @@
 /*!
-        Copyright (c) 2009, Reinhard Katzmann, Matevž Jekovec, Canorus development team
+        Copyright (c) 2009-2020, Reinhard Katzmann, Matevž Jekovec, Canorus development team
         All Rights Reserved. See AUTHORS for a complete list of authors.
 
         Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -16,6 +16,7 @@
 
 #include "ui/singleaction.h"
 #include <QDialog>
+#include <QHash>
 #include <QList>
 #include <QStringList>
 
@@ -79,6 +80,8 @@ public slots:
 
     // Add all actions to the table widget
     void updateView();
+    // Show only the actions containing the given text
+    void filterActions(const QString& text);
 
 protected:
     // Translate strings dynamically
@@ -92,6 +95,11 @@ protected:
     int findActionMidi(const QString& midi, int ignoreRow = -1);
     // Check for Conflicts of shortcut or midi command
     bool hasConflicts(bool bMidi = false);
+    // Index lookup of shortcut or midi command rows
+    int findActionRow(const QMultiHash<QString, int>& index, int col, const QString& text, int ignoreRow);
+    bool rowMatchesFilter(int row, const QString& text);
+    // Add the edited shortcut / midi command to the row indexes
+    void indexAction(QTableWidgetItem* i);
 
 protected slots:
     //#if !USE_SHORTCUTGETTER
@@ -108,7 +116,15 @@ private:
     QList<CASingleAction*> m_actionsList;
     QPushButton* saveButton;
     QPushButton* loadButton;
+    QLineEdit* filterEdit;
     QString latest_dir;
+    QString filterText; // currently applied filter
+
+    // Rows of the table by command, shortcut and midi command text.
+    // Edited items are added to the shortcut and midi indexes, their old entries are skipped on lookup.
+    QHash<QString, int> commandRows;
+    QMultiHash<QString, int> shortcutRows;
+    QMultiHash<QString, int> midiRows;
 
     //#if USE_SHORTCUTGETTER
     QPushButton* editButton;
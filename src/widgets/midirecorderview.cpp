@@ -7,6 +7,7 @@
 
 #include "widgets/midirecorderview.h"
 #include "core/midirecorder.h"
+#include "widgets/pianoroll.h"
 
 #include "canorus.h"
 
@@ -46,6 +47,14 @@ void CAMidiRecorderView::setupCustomUi()
 
     connect(_timer, SIGNAL(timeout()), this, SLOT(onTimerTimeout()));
 
+    // the recorded notes are shown next to the buttons, the dock fills the width of the window
+    _pianoRoll = new CAPianoRoll(this);
+    horizontalLayout->addWidget(_pianoRoll, 1);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+    if (_midiRecorder) {
+        connect(_midiRecorder, SIGNAL(messageRecorded(QVector<unsigned char>, int)), this, SLOT(onMessageRecorded(QVector<unsigned char>, int)));
+    }
+
     uiTime->setText("0:00");
 
     uiRecord->setEnabled(true);
@@ -61,6 +70,25 @@ void CAMidiRecorderView::onTimerTimeout()
         } else {
             uiTime->setText("");
         }
+        if (_status == Recording) {
+            _pianoRoll->setTimeEnd(_midiRecorder->recordedTime());
+        }
+    }
+}
+
+/*!
+	Streams the recorded note ons and offs into the piano roll.
+*/
+void CAMidiRecorderView::onMessageRecorded(QVector<unsigned char> m, int time)
+{
+    if (m.size() < 3) {
+        return;
+    }
+
+    if ((m[0] & 0xf0) == 0x90 && m[2]) {
+        _pianoRoll->noteOn(m[1] & 0x7f, time);
+    } else if ((m[0] & 0xf0) == 0x80 || (m[0] & 0xf0) == 0x90) {
+        _pianoRoll->noteOff(m[1] & 0x7f, time);
     }
 }
 
@@ -89,6 +117,9 @@ void CAMidiRecorderView::on_uiRecord_clicked(bool)
     uiPause->setVisible(true);
     uiStop->setEnabled(true);
 
+    if (_status == Idle) {
+        _pianoRoll->clear(); // a new recording, see CAMidiRecorder::startRecording()
+    }
     _midiRecorder->startRecording();
     _status = Recording;
 }
@@ -10,6 +10,7 @@
 
 #include <QDockWidget>
 #include <QTimer>
+#include <QVector>
 
 #include "ui_midirecorder.h"
 
@@ -19,6 +20,7 @@ class QSlider;
 class QWidget;
 
 class CAMidiRecorder;
+class CAPianoRoll;
 
 class CAMidiRecorderView : public QDockWidget, private Ui::uiMidiRecorder {
     Q_OBJECT
@@ -41,11 +43,13 @@ private slots:
     void on_uiPause_clicked(bool);
     void on_uiStop_clicked(bool);
     void onTimerTimeout();
+    void onMessageRecorded(QVector<unsigned char> message, int time);
 
 private:
     void setupCustomUi();
 
     QTimer* _timer;
+    CAPianoRoll* _pianoRoll; // shows the notes while recording
 
     CAMidiRecorder* _midiRecorder;
     CARecorderStatus _status;
@@ -0,0 +1,166 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QDateTime>
+#include <QFileDialog>
+#include <QFormLayout>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+#include "canorus.h"
+#include "core/autorecovery.h"
+#include "core/taskscheduler.h"
+#include "core/undo.h"
+#include "interface/playback.h"
+#include "layout/sheetlayout.h"
+#include "ui/mainwin.h"
+#include "widgets/performancepanel.h"
+#include "widgets/scoreview.h"
+
+const int CAPerformancePanel::INTERVAL = 500;
+
+/*!
+	\class CAPerformancePanel
+	\brief Live timings of the editor shown in a dock of the main window
+
+	The panel samples the timings already measured by the parts of the editor each INTERVAL
+	miliseconds while it is shown:
+	- the last frame and layout times and the number of drawables of the current score view, see
+	  CAScoreView::lastFrameTime() and CAScoreView::lastLayoutTime()
+	- the memory used by the undo history of the document, see CAUndo::memoryUsage()
+	- the duration of the last recovery save, see CAAutoRecovery::lastSaveTime()
+	- the largest lateness of the MIDI events sent by the playback since the previous sample, see
+	  CAPlayback::takeMaxLateness()
+	- the tasks waiting in the CATaskScheduler queue and the number of its workers
+
+	The samples can be recorded to a CSV file, one line per sample, and attached to a bug report
+	together with the trace saved by CAMainWin::on_uiSavePerformanceTrace_triggered(). The samples
+	are recorded also while the panel is hidden.
+*/
+
+CAPerformancePanel::CAPerformancePanel(CAMainWin* mainWin, QWidget* parent)
+    : QWidget(parent)
+    , _mainWin(mainWin)
+{
+    _frameTime = new QLabel(this);
+    _layoutTime = new QLabel(this);
+    _drawables = new QLabel(this);
+    _undoMemory = new QLabel(this);
+    _autosaveTime = new QLabel(this);
+    _playbackLateness = new QLabel(this);
+    _tasks = new QLabel(this);
+    _recordButton = new QPushButton(tr("&Record..."), this);
+    _recordButton->setCheckable(true);
+    _recordButton->setToolTip(tr("Record the samples to a CSV file for a bug report"));
+
+    QFormLayout* form = new QFormLayout();
+    form->addRow(tr("Frame time:"), _frameTime);
+    form->addRow(tr("Layout time:"), _layoutTime);
+    form->addRow(tr("Drawables:"), _drawables);
+    form->addRow(tr("Undo memory:"), _undoMemory);
+    form->addRow(tr("Autosave time:"), _autosaveTime);
+    form->addRow(tr("Playback jitter:"), _playbackLateness);
+    form->addRow(tr("Queued tasks:"), _tasks);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->addLayout(form);
+    layout->addWidget(_recordButton);
+    layout->addStretch();
+
+    _timer.setInterval(INTERVAL);
+    connect(&_timer, SIGNAL(timeout()), this, SLOT(sample()));
+    connect(_recordButton, SIGNAL(toggled(bool)), this, SLOT(on_recordButton_toggled(bool)));
+}
+
+CAPerformancePanel::~CAPerformancePanel()
+{
+    stopRecording();
+}
+
+/*!
+	Reads the current timings, shows them and writes them to the recording, if any.
+*/
+void CAPerformancePanel::sample()
+{
+    CAScoreView* v = _mainWin->currentScoreView();
+    double frameTime = v ? v->lastFrameTime() : 0;
+    double layoutTime = v ? v->lastLayoutTime() : 0;
+    int drawables = v && v->sheetLayout() ? v->sheetLayout()->drawableCount() : 0;
+    qint64 undoMemory = _mainWin->document() ? CACanorus::undo()->memoryUsage(_mainWin->document()) : 0;
+    qint64 autosaveTime = CACanorus::autoRecovery() ? CACanorus::autoRecovery()->lastSaveTime() : -1;
+    int lateness = _mainWin->playback() ? _mainWin->playback()->takeMaxLateness() : 0;
+    int queued = CATaskScheduler::instance()->queuedCount();
+    int workers = CATaskScheduler::instance()->workerCount();
+
+    _frameTime->setText(v ? tr("%1 ms").arg(frameTime, 0, 'f', 2) : "-");
+    _layoutTime->setText(v ? tr("%1 ms").arg(layoutTime, 0, 'f', 2) : "-");
+    _drawables->setText(v ? QString::number(drawables) : "-");
+    _undoMemory->setText(tr("%1 kB").arg(undoMemory / 1024));
+    _autosaveTime->setText(autosaveTime != -1 ? tr("%1 ms").arg(autosaveTime) : "-");
+    _playbackLateness->setText(_mainWin->playback() ? tr("%1 ms").arg(lateness / 1000.0, 0, 'f', 2) : "-");
+    _tasks->setText(tr("%1 (%2 workers)").arg(queued).arg(workers));
+
+    if (isRecording()) {
+        _recordingStream << QDateTime::currentDateTime().toString(Qt::ISODate) << ","
+                         << frameTime << "," << layoutTime << "," << drawables << ","
+                         << undoMemory << "," << autosaveTime << "," << lateness << ","
+                         << queued << "," << workers << "\n";
+        _recordingStream.flush(); // the file is complete when Canorus crashes
+    }
+}
+
+void CAPerformancePanel::showEvent(QShowEvent*)
+{
+    sample();
+    _timer.start();
+}
+
+void CAPerformancePanel::hideEvent(QHideEvent*)
+{
+    if (!isRecording()) {
+        _timer.stop();
+    }
+}
+
+void CAPerformancePanel::on_recordButton_toggled(bool checked)
+{
+    if (!checked) {
+        stopRecording();
+        return;
+    }
+
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Record performance"), "canorus-performance.csv", tr("CSV file (*.csv)"));
+    _recording.setFileName(fileName);
+    if (fileName.isEmpty() || !_recording.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        if (!fileName.isEmpty()) {
+            QMessageBox::critical(this, tr("Record performance"), tr("Cannot write the samples to %1.").arg(fileName));
+        }
+        _recordButton->blockSignals(true);
+        _recordButton->setChecked(false);
+        _recordButton->blockSignals(false);
+        return;
+    }
+
+    _recordingStream.setDevice(&_recording);
+    _recordingStream << "time,frame_ms,layout_ms,drawables,undo_bytes,autosave_ms,playback_lateness_us,queued_tasks,workers\n";
+    _timer.start();
+}
+
+void CAPerformancePanel::stopRecording()
+{
+    if (isRecording()) {
+        _recordingStream.flush();
+        _recordingStream.setDevice(nullptr);
+        _recording.close();
+    }
+
+    if (!isVisible()) {
+        _timer.stop();
+    }
+}
@@ -0,0 +1,58 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef PERFORMANCEPANEL_H_
+#define PERFORMANCEPANEL_H_
+
+#include <QFile>
+#include <QTextStream>
+#include <QTimer>
+#include <QWidget>
+
+class QLabel;
+class QPushButton;
+class CAMainWin;
+
+class CAPerformancePanel : public QWidget {
+    Q_OBJECT
+public:
+    CAPerformancePanel(CAMainWin* mainWin, QWidget* parent = nullptr);
+    virtual ~CAPerformancePanel();
+
+    inline bool isRecording() { return _recording.isOpen(); }
+
+    static const int INTERVAL; // between the samples in miliseconds
+
+public slots:
+    void sample();
+
+protected:
+    void showEvent(QShowEvent*);
+    void hideEvent(QHideEvent*);
+
+private slots:
+    void on_recordButton_toggled(bool);
+
+private:
+    void stopRecording();
+
+    CAMainWin* _mainWin;
+    QTimer _timer;
+    QFile _recording; // open while the samples are recorded
+    QTextStream _recordingStream;
+
+    QLabel* _frameTime;
+    QLabel* _layoutTime;
+    QLabel* _drawables;
+    QLabel* _undoMemory;
+    QLabel* _autosaveTime;
+    QLabel* _playbackLateness;
+    QLabel* _tasks;
+    QPushButton* _recordButton;
+};
+
+#endif /* PERFORMANCEPANEL_H_ */
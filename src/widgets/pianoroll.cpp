@@ -0,0 +1,189 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#include <QImage>
+#include <QPainter>
+
+#include "score/playablelength.h"
+#include "widgets/pianoroll.h"
+
+#include <algorithm>
+
+/*!
+	\class CAPianoRoll
+	\brief Compact piano roll of the recorded or imported MIDI notes
+
+	Shows the notes as horizontal bars, the time going from the left to the right and the pitch
+	from the bottom to the top. The whole time up to timeEnd() is fitted into the width of the
+	widget and only the range of the pitches played is shown.
+
+	Unlike the score, the notes are not music elements with their own drawables. They are stored in
+	a flat array of intervals, so hours of recording take a few megabytes and the notes can be
+	streamed in while recording by noteOn() and noteOff().
+
+	When there are more notes than pixel columns, the individual notes are not drawn. The time each
+	pitch sounds within a column is summed up instead and drawn as the opacity of the column, so the
+	painting time depends on the size of the widget and not on the length of the recording.
+
+	\sa CAMidiRecorderView
+*/
+
+CAPianoRoll::CAPianoRoll(QWidget* parent)
+    : QWidget(parent)
+{
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
+    clear();
+}
+
+CAPianoRoll::~CAPianoRoll()
+{
+}
+
+/*!
+	Removes all the notes.
+*/
+void CAPianoRoll::clear()
+{
+    _notes.clear();
+    _soundingNotes.clear();
+    _timeEnd = 0;
+    _minPitch = 128;
+    _maxPitch = -1;
+    update();
+}
+
+/*!
+	Adds a finished note of the given midi \a pitch. The notes should be added in the order of their
+	\a timeStart.
+*/
+void CAPianoRoll::addNote(int pitch, int timeStart, int timeLength)
+{
+    CAPianoRollNote note = { timeStart, timeStart + timeLength, pitch };
+    _notes << note;
+    addPitch(pitch);
+    _timeEnd = qMax(_timeEnd, note.timeEnd);
+    update();
+}
+
+/*!
+	Starts a note of the given midi \a pitch at \a time. The note sounds until noteOff() is called
+	for the same pitch.
+*/
+void CAPianoRoll::noteOn(int pitch, int time)
+{
+    CAPianoRollNote note = { time, -1, pitch };
+    _soundingNotes << _notes.size();
+    _notes << note;
+    addPitch(pitch);
+    setTimeEnd(time);
+}
+
+/*!
+	Ends the last started note of the given midi \a pitch at \a time.
+*/
+void CAPianoRoll::noteOff(int pitch, int time)
+{
+    for (int i = _soundingNotes.size() - 1; i >= 0; i--) {
+        if (_notes[_soundingNotes[i]].pitch == pitch) {
+            _notes[_soundingNotes[i]].timeEnd = time;
+            _soundingNotes.remove(i);
+            break;
+        }
+    }
+    setTimeEnd(time);
+}
+
+/*!
+	Sets the end of the shown time to \a time, if it is later than the current one. Used to move
+	the sounding notes on while recording.
+*/
+void CAPianoRoll::setTimeEnd(int time)
+{
+    if (time > _timeEnd) {
+        _timeEnd = time;
+        update();
+    }
+}
+
+QSize CAPianoRoll::sizeHint() const
+{
+    return QSize(400, 48);
+}
+
+void CAPianoRoll::addPitch(int pitch)
+{
+    _minPitch = qMin(_minPitch, pitch);
+    _maxPitch = qMax(_maxPitch, pitch);
+}
+
+void CAPianoRoll::paintEvent(QPaintEvent*)
+{
+    QPainter p(this);
+    p.fillRect(rect(), palette().base());
+    if (_notes.isEmpty() || width() <= 0) {
+        return;
+    }
+
+    // show at least a few bars, so the first notes don't fill the whole width
+    int timeSpan = qMax(_timeEnd, 4 * CAPlayableLength::musicLengthToTimeLength(CAPlayableLength::Whole));
+    double timeScale = width() / static_cast<double>(timeSpan);
+    if (_notes.size() > width()) {
+        drawDensity(&p, timeScale);
+    } else {
+        drawNotes(&p, timeScale, height() / static_cast<double>(_maxPitch - _minPitch + 1));
+    }
+}
+
+/*!
+	Draws each note as a bar at least a pixel wide.
+*/
+void CAPianoRoll::drawNotes(QPainter* p, double timeScale, double rowHeight)
+{
+    QBrush brush = palette().text();
+    for (const CAPianoRollNote& note : _notes) {
+        int timeEnd = (note.timeEnd == -1) ? _timeEnd : note.timeEnd;
+        QRectF bar(note.timeStart * timeScale, (_maxPitch - note.pitch) * rowHeight, (timeEnd - note.timeStart) * timeScale, rowHeight);
+        bar.setWidth(qMax(bar.width(), 1.0));
+        bar.setHeight(qMax(bar.height(), 1.0));
+        p->fillRect(bar, brush);
+    }
+}
+
+/*!
+	Draws the time the pitches sound per pixel column as the opacity of the column. The image has a
+	row per pitch and is stretched to the height of the widget.
+*/
+void CAPianoRoll::drawDensity(QPainter* p, double timeScale)
+{
+    int columns = width();
+    int rows = _maxPitch - _minPitch + 1;
+    QVector<double> coverage(columns * rows, 0); // time sounding per pitch and column in pixels
+    for (const CAPianoRollNote& note : _notes) {
+        double x1 = note.timeStart * timeScale;
+        double x2 = ((note.timeEnd == -1) ? _timeEnd : note.timeEnd) * timeScale;
+        double* row = coverage.data() + (_maxPitch - note.pitch) * columns;
+        for (int c = qMax(static_cast<int>(x1), 0); c < columns && c < x2; c++) {
+            row[c] += std::min(x2, c + 1.0) - std::max(x1, static_cast<double>(c));
+        }
+    }
+
+    QImage image(columns, rows, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QColor color = palette().text().color();
+    for (int r = 0; r < rows; r++) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(r));
+        for (int c = 0; c < columns; c++) {
+            double v = coverage[r * columns + c];
+            if (v > 0) {
+                int a = qRound(qMin(v, 1.0) * 255);
+                line[c] = qRgba(color.red() * a / 255, color.green() * a / 255, color.blue() * a / 255, a);
+            }
+        }
+    }
+
+    p->drawImage(QRectF(0, 0, columns, height()), image);
+}
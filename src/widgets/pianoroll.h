@@ -0,0 +1,55 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See LICENSE.GPL for details.
+*/
+
+#ifndef PIANOROLL_H_
+#define PIANOROLL_H_
+
+#include <QVector>
+#include <QWidget>
+
+class QPainter;
+
+class CAPianoRoll : public QWidget {
+    Q_OBJECT
+
+public:
+    CAPianoRoll(QWidget* parent = nullptr);
+    virtual ~CAPianoRoll();
+
+    void clear();
+    void addNote(int pitch, int timeStart, int timeLength);
+    void noteOn(int pitch, int time);
+    void noteOff(int pitch, int time);
+
+    inline int timeEnd() { return _timeEnd; }
+    void setTimeEnd(int time);
+    inline int noteCount() { return _notes.size(); }
+
+    QSize sizeHint() const;
+
+protected:
+    void paintEvent(QPaintEvent*);
+
+private:
+    struct CAPianoRollNote {
+        int timeStart;
+        int timeEnd; // -1 while the note is sounding
+        int pitch;
+    };
+
+    void addPitch(int pitch);
+    void drawNotes(QPainter* p, double timeScale, double rowHeight);
+    void drawDensity(QPainter* p, double timeScale);
+
+    QVector<CAPianoRollNote> _notes; // sorted by the start time
+    QVector<int> _soundingNotes; // indices of the notes without the end yet
+    int _timeEnd; // end of the shown time, the sounding notes reach until it
+    int _minPitch;
+    int _maxPitch;
+};
+
+#endif /* PIANOROLL_H_ */
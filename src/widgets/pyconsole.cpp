@@ -8,14 +8,21 @@
 #include "scripting/swigpython.h" // Must be included first (includes Python.h).
 
 #include "canorus.h"
+#include "core/trace.h"
 #include "interface/plugin.h"
 #include "interface/pluginmanager.h"
 #include "widgets/pyconsole.h"
 
 #include <QKeyEvent>
+#include <QMutexLocker>
+#include <QResizeEvent>
+#include <QThread>
+#include <QToolButton>
 #include <qwaitcondition.h>
 #include <stdio.h>
 
+#include <atomic>
+
 #ifdef USE_PYTHON
 /*!
 	\class CAPyConsole
@@ -31,6 +38,142 @@
 	Still under development (beta)
 */
 
+/*!
+	\class CAPyConsoleWorker
+	\brief Thread running the commands of the Python console
+
+	Commands entered in the console are queued and executed one after another in this thread, so
+	long running scripts don't freeze the GUI. The output of the interactive commands is streamed
+	to the console through CAPyConsoleInterface. Scripts should change the document using
+	CanorusPython.callInGui(), which runs the given function in the GUI thread.
+
+	The running command can be interrupted by cancel(), which raises KeyboardInterrupt in it.
+*/
+class CAPyConsoleWorker : public QThread {
+public:
+    struct CACommand {
+        QString fileName;
+        QString function;
+        bool autoReload;
+        CADocument* document;
+        QString input; // interactive input or null for the scripts called by /callscript
+        CAPyConsoleInterface* iface;
+    };
+
+    CAPyConsoleWorker(CAPyConsole* console)
+        : _console(console)
+        , _quit(false)
+        , _busy(false)
+        , _pythonThread(0)
+    {
+        setObjectName("Python console");
+    }
+
+    void enqueue(const CACommand& command)
+    {
+        QMutexLocker locker(&_mutex);
+        _queue << command;
+        _wait.wakeOne();
+    }
+
+    bool isIdle()
+    {
+        QMutexLocker locker(&_mutex);
+        return !_busy && _queue.isEmpty();
+    }
+
+    void cancel();
+    bool stop();
+
+protected:
+    void run();
+
+private:
+    CAPyConsole* _console;
+    QMutex _mutex;
+    QWaitCondition _wait;
+    QList<CACommand> _queue;
+    bool _quit;
+    std::atomic<bool> _busy;
+    std::atomic<unsigned long> _pythonThread; // Python thread id used for interrupting the command
+};
+
+void CAPyConsoleWorker::run()
+{
+    _pythonThread = PyThread_get_thread_ident();
+
+    forever {
+        QMutexLocker locker(&_mutex);
+        while (_queue.isEmpty() && !_quit) {
+            _wait.wait(&_mutex);
+        }
+        if (_quit) {
+            return;
+        }
+        CACommand command = _queue.takeFirst();
+        _busy = true;
+        locker.unlock();
+
+        CASwigPython::lockGIL();
+        QList<PyObject*> args;
+        args << CASwigPython::toPythonObject(command.document, CASwigPython::Document);
+        if (!command.input.isNull()) {
+            args << PyUnicode_FromString(command.input.toUtf8().constData());
+            args << CASwigPython::toPythonObject(command.iface, CASwigPython::PyConsoleInterface);
+        }
+        CASwigPython::unlockGIL();
+
+        PyObject* ret = CASwigPython::callFunction(command.fileName, command.function, args, command.autoReload);
+
+        QString prompt(">>> ");
+        if (ret) {
+            CASwigPython::lockGIL();
+            if (!command.input.isNull() && PyUnicode_Check(ret)) {
+                prompt = QString::fromUtf8(PyUnicode_AsUTF8(ret));
+            }
+            Py_DECREF(ret);
+            CASwigPython::unlockGIL();
+        }
+
+        locker.relock();
+        _busy = false;
+        if (!_quit) {
+            _console->asyncCommandFinished(prompt);
+        }
+    }
+}
+
+/*!
+	Interrupts the running command by raising KeyboardInterrupt in it. Called from the GUI thread.
+	A command waiting for the GUI thread is interrupted when it continues.
+*/
+void CAPyConsoleWorker::cancel()
+{
+    if (!_busy) {
+        return;
+    }
+
+    CASwigPython::lockGIL();
+    PyThreadState_SetAsyncExc(_pythonThread, PyExc_KeyboardInterrupt);
+    CASwigPython::unlockGIL();
+}
+
+/*!
+	Drops the queued commands, interrupts the running one and waits for the thread to finish.
+	Returns False, if the command didn't stop in time.
+*/
+bool CAPyConsoleWorker::stop()
+{
+    QMutexLocker locker(&_mutex);
+    _quit = true;
+    _queue.clear();
+    _wait.wakeOne();
+    locker.unlock();
+
+    cancel();
+    return wait(2000);
+}
+
 // --python shell emulation; script interaction--
 // document as parameter won't work (solved like in pluginaction.cpp)
 /// \todo pycli: interactive help won't work. More sys.std* overrides?
@@ -50,12 +193,13 @@
 // Internal commands: are entered to python shell
 // 			looks like this "/commandx", have / at the beginning
 // 			are interpreted in canorus not python
-//     "/callscript <script>", "/entryfunc", "entryfunc <function>"
+//     "/callscript <script>", "/entryfunc", "entryfunc <function>", "/trace <file>"
 //
 // /todo autoindentation, internal variable (like in idle), test it!
 
 CAPyConsole::CAPyConsole(CADocument* doc, QWidget* parent)
     : QTextEdit(parent)
+    , _iface(this)
 {
     _parent = parent;
     _canorusDoc = doc;
@@ -73,8 +217,11 @@ CAPyConsole::CAPyConsole(CADocument* doc, QWidget* parent)
     auto txt = "Welcome to the Python CLI. In addition to standard python CLI, you can use\n"
                "  /callscript path_to_script.py    to call external script\n"
                "  /entryfunc entry_function        to set or display entry function in script ran by /callscript\n"
+               "  /trace trace_file.json           to save the performance trace for bug reports\n"
                "  document                         variable to manipulate canorus itself\n"
                "  CanorusPython                    library to create Canorus objects\n"
+               "  CanorusPython.callInGui(f)       to change the document from a long running command\n"
+               "  Ctrl+C                           to interrupt the running command\n"
                "\n"
                ">>> ";
     setText(txt);
@@ -105,6 +252,24 @@ CAPyConsole::CAPyConsole(CADocument* doc, QWidget* parent)
 
     _thrIntrWaitMut = new QMutex();
     _thrIntrWait = new QWaitCondition();
+
+    // commands
+    _worker = new CAPyConsoleWorker(this);
+    connect(this, SIGNAL(sig_syncCommandFinished(const QString&)), SLOT(syncCommandFinished(const QString&)), Qt::QueuedConnection);
+
+    _cancelButton = new QToolButton(this);
+    _cancelButton->setText(tr("Cancel"));
+    _cancelButton->setToolTip(tr("Interrupt the running command (Ctrl+C)"));
+    _cancelButton->resize(_cancelButton->sizeHint());
+    _cancelButton->hide();
+    connect(_cancelButton, SIGNAL(clicked()), SLOT(cancelCommand()));
+}
+
+CAPyConsole::~CAPyConsole()
+{
+    if (!_worker->isRunning() || _worker->stop()) {
+        delete _worker;
+    } // otherwise the command is stuck and the thread is left running until the application exits
 }
 
 // --------------------------------
@@ -353,6 +518,58 @@ void CAPyConsole::asyncBufferedOutput(QString bufInp, bool bStdErr)
     emit sig_txtAppend(bufInp, bStdErr ? txtStderr : txtStdout);
 }
 
+/*!
+	Called by the worker thread when a command finished. Shows the next \a prompt.
+*/
+void CAPyConsole::asyncCommandFinished(QString prompt)
+{
+    emit sig_syncCommandFinished(prompt);
+}
+
+void CAPyConsole::syncCommandFinished(const QString& prompt)
+{
+    txtAppend(prompt, txtNormal);
+
+    if (_worker->isIdle()) {
+        _cancelButton->hide();
+    }
+}
+
+/*!
+	Queues the \a function of the given script to be run by the worker thread with the document of
+	the main window. If \a input is given, it is passed to the function together with the console
+	interface for streaming the output, and the returned string is shown as the next prompt.
+*/
+void CAPyConsole::runCommand(QString fileName, QString function, bool autoReload, QString input)
+{
+    QObject* curObject = this;
+    while (dynamic_cast<CAMainWin*>(curObject) == nullptr && curObject != nullptr) // find the parent which is mainwindow
+        curObject = curObject->parent();
+
+    CAPyConsoleWorker::CACommand command;
+    command.fileName = fileName;
+    command.function = function;
+    command.autoReload = autoReload;
+    command.document = (curObject ? static_cast<CAMainWin*>(curObject)->document() : _canorusDoc);
+    command.input = input;
+    command.iface = &_iface;
+
+    if (!_worker->isRunning()) {
+        _worker->start();
+    }
+    _worker->enqueue(command);
+
+    _cancelButton->show();
+}
+
+/*!
+	Interrupts the running command.
+*/
+void CAPyConsole::cancelCommand()
+{
+    _worker->cancel();
+}
+
 void CAPyConsole::asyncKeyboardInterrupt()
 {
     Py_BEGIN_ALLOW_THREADS
@@ -428,6 +645,11 @@ void CAPyConsole::histGet(HistLay histLay)
 */
 void CAPyConsole::keyPressEvent(QKeyEvent* e)
 {
+    if (e->matches(QKeySequence::Copy) && !textCursor().hasSelection() && !_worker->isIdle()) {
+        cancelCommand();
+        return;
+    }
+
     bool defCase = false;
     //sometimes it's Key_Enter instead of Key_Return, weird
     switch (e->key()) {
@@ -491,6 +713,17 @@ void CAPyConsole::keyPressEvent(QKeyEvent* e)
     }
 }
 
+/*!
+	Keeps the cancel button in the top right corner.
+*/
+void CAPyConsole::resizeEvent(QResizeEvent* e)
+{
+    QTextEdit::resizeEvent(e);
+
+    QRect r = viewport()->geometry();
+    _cancelButton->move(r.right() - _cancelButton->width() - 4, r.top() + 4);
+}
+
 // --------------------------------
 // -------INTERNAL-COMMANDS--------
 // --------------------------------
@@ -499,6 +732,9 @@ void CAPyConsole::keyPressEvent(QKeyEvent* e)
 
 bool CAPyConsole::cmdIntern(QString strCmd)
 {
+    // Interpreter is loaded on the first command
+    CACanorus::initScripting();
+
     // TODO(stefan): we are handling everything with cmdIntern now. If this works we can completely remove the old pycli.
     // Handle all txt input this method.
     // if (!strCmd.startsWith("/"))
@@ -527,18 +763,17 @@ bool CAPyConsole::cmdIntern(QString strCmd)
             return true;
         }
 
-        QList<PyObject*> argsPython;
-
-        QObject* curObject = this;
-        while (dynamic_cast<CAMainWin*>(curObject) == nullptr && curObject != nullptr) // find the parent which is mainwindow
-            curObject = curObject->parent();
-
-        PyEval_RestoreThread(CASwigPython::mainThreadState);
-        argsPython << CASwigPython::toPythonObject(static_cast<CAMainWin*>(curObject)->document(), CASwigPython::Document);
-        PyEval_ReleaseThread(CASwigPython::mainThreadState);
+        runCommand(QFileInfo("scripts:" + strCmd.mid(12)).absoluteFilePath(), _strEntryFunc, true);
+        return true;
+    }
 
-        CASwigPython::callFunction(QFileInfo("scripts:" + strCmd.mid(12)).absoluteFilePath(), _strEntryFunc, argsPython, true);
-        emit sig_txtAppend(">>> ", txtNormal); // if not emitted, error from python and this are not in order
+    else if (strCmd.startsWith("/trace ")) {
+        if (CATrace::writeChromeTrace(strCmd.mid(7).trimmed())) {
+            txtAppend("Trace saved\n", txtStdout);
+        } else {
+            txtAppend("Cannot write the trace\n", txtStderr);
+        }
+        txtAppend(">>> ", txtNormal);
         return true;
     }
 
@@ -551,23 +786,8 @@ bool CAPyConsole::cmdIntern(QString strCmd)
         _strEntryFunc = strCmd.mid(11);
         txtAppend(">>> ", txtNormal);
     } else {
-        // TODO(stefan): DRY this from the other if condition.
-        QList<PyObject*> argsPython;
-        QObject* curObject = this;
-        while (dynamic_cast<CAMainWin*>(curObject) == nullptr && curObject != nullptr) // find the parent which is mainwindow
-            curObject = curObject->parent();
-        PyEval_RestoreThread(CASwigPython::mainThreadState);
-        argsPython << CASwigPython::toPythonObject(static_cast<CAMainWin*>(curObject)->document(), CASwigPython::Document);
-        PyEval_ReleaseThread(CASwigPython::mainThreadState);
-        argsPython << PyUnicode_FromString(strCmd.toStdString().c_str());
-
         // Can't autoreload because we are using global objects in pycl2.py that would get overwritten.
-        auto ret = CASwigPython::callFunction(QFileInfo("scripts:pycl2.py").absoluteFilePath(), "main", argsPython, false);
-        if (ret==nullptr) {
-            return false;
-        }
-
-        emit sig_txtAppend(PyUnicode_AsUTF8(ret), txtNormal);
+        runCommand(QFileInfo("scripts:pycl2.py").absoluteFilePath(), "main", false, strCmd);
         return true;
     }
 
@@ -576,11 +796,15 @@ bool CAPyConsole::cmdIntern(QString strCmd)
 #else
 
 // If there is no python, generate dummy functions
+CAPyConsole::~CAPyConsole() {}
 void CAPyConsole::txtAppend(QString const&, CAPyConsole::TxtType) {}
 void CAPyConsole::on_txtChanged() {}
 void CAPyConsole::on_posChanged() {}
 void CAPyConsole::on_selChanged() {}
 void CAPyConsole::on_fmtChanged() {}
 void CAPyConsole::syncPluginInit() {}
+void CAPyConsole::syncCommandFinished(const QString&) {}
+void CAPyConsole::cancelCommand() {}
+void CAPyConsole::resizeEvent(QResizeEvent*) {}
 void CAPyConsole::keyPressEvent(QKeyEvent* e) {}
 #endif //USE_PYTHON
@@ -8,6 +8,7 @@
 #ifndef PYCONSOLE_H_
 #define PYCONSOLE_H_
 
+#include "interface/pyconsoleinterface.h"
 #include "score/document.h"
 #include <QMutex>
 #include <QObject>
@@ -15,6 +16,9 @@
 #include <QToolBar>
 #include <QWaitCondition>
 
+class QToolButton;
+class CAPyConsoleWorker;
+
 class CAPyConsole : public QTextEdit {
     Q_OBJECT
 public:
@@ -25,14 +29,17 @@ public:
     };
 
     CAPyConsole(CADocument* doc, QWidget* parent = nullptr);
+    ~CAPyConsole();
 
     QString asyncBufferedInput(QString prompt);
     void asyncBufferedOutput(QString bufInp, bool bStdErr);
     void asyncPluginInit();
     void asyncKeyboardInterrupt();
+    void asyncCommandFinished(QString prompt);
 
 protected:
     void keyPressEvent(QKeyEvent* e);
+    void resizeEvent(QResizeEvent* e);
 
 private slots:
     void txtAppend(const QString& text, TxtType txtType = txtNormal);
@@ -41,10 +48,13 @@ private slots:
     void on_selChanged();
     void on_fmtChanged();
     void syncPluginInit();
+    void syncCommandFinished(const QString& prompt);
+    void cancelCommand();
 
 signals:
     void sig_txtAppend(const QString& text, TxtType stdType);
     void sig_syncPluginInit();
+    void sig_syncCommandFinished(const QString& prompt);
 
 private:
     enum HistLay {
@@ -90,6 +100,12 @@ private:
     QMutex* _thrIntrWaitMut;
     QWaitCondition* _thrIntrWait;
 
+    // worker running the commands, so the GUI stays responsive
+    void runCommand(QString fileName, QString function, bool autoReload, QString input = QString());
+    CAPyConsoleWorker* _worker;
+    CAPyConsoleInterface _iface; // passed to the commands for streaming their output
+    QToolButton* _cancelButton;
+
     // pyconsole '/' commands
     bool cmdIntern(QString strCmd);
     QString _strEntryFunc;
@@ -9,16 +9,24 @@
 #include <QColor>
 #include <QDebug>
 #include <QGridLayout>
+#include <QHash>
 #include <QMouseEvent>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 4, 0)
+#include <QOpenGLWidget>
+#endif
 #include <QPainter>
 #include <QPalette>
 #include <QScrollBar>
+#include <QShowEvent>
 #include <QTimer>
 #include <QWheelEvent>
+#include <QtMath>
 
 #include <math.h> // needed for square root in animated scrolls/zoom
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
 
 #include "layout/drawable.h"
 #include "layout/drawableaccidental.h"
@@ -27,9 +35,12 @@
 #include "layout/drawablelyricscontext.h" // syllable edit creation
 #include "layout/drawablemuselement.h"
 #include "layout/drawablenote.h"
+#include "layout/drawablenotecheckererror.h"
 #include "layout/drawablestaff.h"
 #include "layout/drawabletimesignature.h"
+#include "layout/fontcache.h"
 #include "layout/layoutengine.h"
+#include "layout/overviewrenderer.h"
 #include "widgets/scoreview.h"
 
 #include "score/barline.h"
@@ -40,6 +51,7 @@
 #include "score/lyricscontext.h"
 #include "score/muselement.h"
 #include "score/note.h"
+#include "score/notecheckererror.h"
 #include "score/rest.h"
 #include "score/sheet.h"
 #include "score/staff.h"
@@ -49,13 +61,54 @@
 #include "score/voice.h"
 
 #include "canorus.h"
+#include "core/actionlatency.h"
+#include "core/progress.h"
 #include "core/settings.h"
+#include "core/trace.h"
 
 const int CAScoreView::RIGHT_EXTRA_SPACE = 100; // Gives some space after the music so you're able to insert music elements after the last element
 const int CAScoreView::BOTTOM_EXTRA_SPACE = 30; // Gives some space after the music so you're able to insert new contexts below the last context
 const int CAScoreView::RULER_HEIGHT = 15;
-const int CAScoreView::ANIMATION_STEPS = 7;
+const int CAScoreView::ANIMATION_DURATION = 350;
+const int CAScoreView::FRAME_INTERVAL = 16; // 60 frames per second
 const int CAScoreView::SELECTION_REGION_THRESHOLD = 10;
+const int CAScoreView::TILE_SIZE = 256;
+const int CAScoreView::TILE_MARGIN = 20;
+const int CAScoreView::MAX_TILES = 128;
+const int CAScoreView::LAYOUT_CHUNK_WIDTH = 2000;
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 4, 0)
+namespace {
+
+/*!
+	OpenGL canvas of the score view.
+
+	Paints the score view using CAScoreView::paintCanvas(). The OpenGL paint engine keeps the cached
+	tile pixmaps as textures, so scrolling and the overlays don't rasterize the tiles again. Mouse
+	events aren't handled and are propagated to the view like on the plain canvas.
+*/
+class CAScoreCanvas : public QOpenGLWidget {
+public:
+    CAScoreCanvas(CAScoreView* view)
+        : QOpenGLWidget(view)
+        , _view(view)
+    {
+    }
+
+protected:
+    void paintGL()
+    {
+        QPainter p(this);
+        p.translate(-pos()); // paintCanvas() uses the view coordinates
+        _view->paintCanvas(&p);
+    }
+
+private:
+    CAScoreView* _view;
+};
+
+}
+#endif
 
 /*!
 	\class CATextEdit
@@ -127,6 +180,8 @@ void CAScoreView::initScoreView(CASheet* sheet)
 {
     setViewType(ScoreView);
 
+    _layoutAttached = false;
+    _shadowNoteLength = CAPlayableLength(CAPlayableLength::Quarter);
     setSheet(sheet);
     _worldX = _worldY = 0;
     _worldW = _worldH = 0;
@@ -137,6 +192,9 @@ void CAScoreView::initScoreView(CASheet* sheet)
     _checkScrollBarsDeadLock = false;
     _playing = false;
     _currentContext = nullptr;
+    _rebuildPending = false;
+    _pendingContextIdx = -1;
+    _layoutProgress = nullptr;
     _xCursor = _yCursor = 0;
     setResizeDirection(CADrawable::Undefined);
 
@@ -149,13 +207,31 @@ void CAScoreView::initScoreView(CASheet* sheet)
     setFocusPolicy(Qt::StrongFocus);
 
     // init virtual canvas
+#if QT_VERSION >= QT_VERSION_CHECK(5, 4, 0)
+    _openGLCanvas = CACanorus::settings()->openGLCanvas();
+    if (_openGLCanvas) {
+        _canvas = new CAScoreCanvas(this);
+    } else {
+        _canvas = new QWidget(this);
+    }
+#else
+    _openGLCanvas = false;
     _canvas = new QWidget(this);
+#endif
     setMouseTracking(true);
-    _repaintArea = nullptr;
+    _tileZoom = 0;
+    _tileVoice = nullptr;
+    _tileContext = nullptr;
+    _tileAntiAliasing = false;
+    _tileLodZoomFactor = 0;
 
     // init animation stuff
     _animationTimer = new QTimer(this);
-    _animationTimer->setInterval(50);
+    _animationTimer->setInterval(FRAME_INTERVAL);
+    _animationStartX = _animationStartY = _animationStartZoom = 0;
+    _animationFrameStart = -1;
+    _lastFrameTime = 0;
+    _lastLayoutTime = 0;
     connect(_animationTimer, SIGNAL(timeout()), this, SLOT(on_animationTimer_timeout()));
 
     // init click timer (used for measuring double/triple click since Qt4 doesn't support triple click yet ;))
@@ -164,6 +240,12 @@ void CAScoreView::initScoreView(CASheet* sheet)
     _clickTimer->setInterval(static_cast<int>(QApplication::doubleClickInterval() * 1.5));
     connect(_clickTimer, SIGNAL(timeout()), this, SLOT(on_clickTimer_timeout()));
 
+    // init layout timer (places the music right of the visible part when it is scrolled to)
+    _layoutTimer = new QTimer(this);
+    _layoutTimer->setSingleShot(true);
+    _layoutTimer->setInterval(0);
+    connect(_layoutTimer, SIGNAL(timeout()), this, SLOT(on_layoutTimer_timeout()));
+
     // init helpers
     setSelectedVoice(nullptr);
     setShadowNoteVisible(false);
@@ -197,6 +279,17 @@ void CAScoreView::initScoreView(CASheet* sheet)
     _oldWorldW = 0;
     _oldWorldH = 0;
 
+    applySettings();
+    connect(CACanorus::settings(), SIGNAL(settingsChanged()), this, SLOT(applySettings()));
+}
+
+/*!
+	Reads the colors and the painting settings from CASettings and repaints the view.
+	The settings are kept in the view, so they are not looked up on every paint.
+	This is called whenever the settings are written.
+*/
+void CAScoreView::applySettings()
+{
     setBackgroundColor(CACanorus::settings()->backgroundColor());
     setForegroundColor(CACanorus::settings()->foregroundColor());
     setSelectionColor(CACanorus::settings()->selectionColor());
@@ -204,14 +297,19 @@ void CAScoreView::initScoreView(CASheet* sheet)
     setSelectedContextColor(CACanorus::settings()->selectedContextColor());
     setHiddenElementsColor(CACanorus::settings()->hiddenElementsColor());
     setDisabledElementsColor(CACanorus::settings()->disabledElementsColor());
+
+    _antiAliasing = CACanorus::settings()->antiAliasing();
+    _lodZoomFactor = CACanorus::settings()->lodZoomFactor();
+    _showRuler = CACanorus::settings()->showRuler();
+    _shadowNotesInOtherStaffs = CACanorus::settings()->shadowNotesInOtherStaffs();
+
+    update(); // the tiles are rendered again, if the colors or painting settings changed
 }
 
 CAScoreView::~CAScoreView()
 {
-    // Delete the drawable elements/contexts
-    _drawableMList.clear(true);
-    _drawableCList.clear(true);
-    _drawableNCEList.clear(true);
+    // The drawable elements/contexts are deleted together with the sheet layout, when no other view shows it
+    _sheetLayout->removeView(this);
 
     while (!_shadowNote.isEmpty()) {
         delete _shadowNote.takeFirst();
@@ -222,26 +320,45 @@ CAScoreView::~CAScoreView()
     _animationTimer->stop();
     delete _animationTimer;
 
+    _layoutTimer->disconnect();
+    _layoutTimer->stop();
+
     _hScrollBar->disconnect();
     _vScrollBar->disconnect();
 }
 
+/*!
+	Moves the view to the position of the scroll/zoom animation at the current time.
+
+	The position depends on the time elapsed since the animation started and not on the number of
+	painted frames. When a frame takes longer than FRAME_INTERVAL to paint, the intermediate
+	positions are skipped and the timer waits for the slow frame, so the frames don't queue up and
+	the animation still ends after ANIMATION_DURATION.
+*/
 void CAScoreView::on_animationTimer_timeout()
 {
-    _animationStep++;
+    if (_animationFrameStart != -1 && _animationClock.elapsed() < ANIMATION_DURATION) {
+        return; // the last frame hasn't been painted yet
+    }
+
+    double t = qMin(1.0, static_cast<double>(_animationClock.elapsed()) / ANIMATION_DURATION);
+    double progress = 1 - (1 - t) * (1 - t); // ease out
 
-    double newZoom = _zoom + (_targetZoom - _zoom) * sqrt(static_cast<double>(_animationStep) / ANIMATION_STEPS);
-    double newWorldX = _worldX + (_targetWorldX - _worldX) * sqrt(static_cast<double>(_animationStep) / ANIMATION_STEPS);
-    double newWorldY = _worldY + (_targetWorldY - _worldY) * sqrt(static_cast<double>(_animationStep) / ANIMATION_STEPS);
+    double newZoom = _animationStartZoom + (_targetZoom - _animationStartZoom) * progress;
+    double newWorldX = _animationStartX + (_targetWorldX - _animationStartX) * progress;
+    double newWorldY = _animationStartY + (_targetWorldY - _animationStartY) * progress;
     double newWorldW = drawableWidth() / newZoom;
     double newWorldH = drawableHeight() / newZoom;
 
     setWorldCoords(newWorldX, newWorldY, newWorldW, newWorldH);
 
-    if (_animationStep == ANIMATION_STEPS)
+    if (t == 1.0)
         _animationTimer->stop();
+    else
+        _animationTimer->setInterval(qBound(FRAME_INTERVAL, static_cast<int>(_lastFrameTime / 1000000), ANIMATION_DURATION / 4));
 
-    repaint();
+    _animationFrameStart = CATrace::now();
+    update();
 }
 
 /**
@@ -256,15 +373,14 @@ void CAScoreView::setMouseTracking(bool mt)
 
 CAScoreView* CAScoreView::clone()
 {
-    CAScoreView* v = new CAScoreView(_sheet, static_cast<QWidget*>(parent()));
-    v->rebuild();
-    v->setWorldX(worldX(), false);
-    v->setWorldY(worldY(), false);
-    v->repaint();
-
-    return v;
+    return clone(static_cast<QWidget*>(parent()));
 }
 
+/*!
+	Creates a new view of the same sheet with the given \a parent. The new view uses the sheet
+	layout of this view, so the drawable elements are not copied nor laid out again, only the
+	selection and the world coordinates are its own.
+*/
 CAScoreView* CAScoreView::clone(QWidget* parent)
 {
     CAScoreView* v = new CAScoreView(_sheet, parent);
@@ -277,46 +393,316 @@ CAScoreView* CAScoreView::clone(QWidget* parent)
 }
 
 /*!
-	Adds a drawable music element \a elt to the score view and selects it, if \a select is true.
+	Sets the \a sheet shown by the view.
+
+	If no other view shows the new sheet yet, the view keeps its drawable elements until the next
+	rebuild(). This is the case when the sheets are replaced by their copies on undo. Otherwise the
+	view switches to the layout shared with the other views of the sheet on the next rebuild().
+*/
+void CAScoreView::setSheet(CASheet* sheet)
+{
+    _sheet = sheet;
+    if (!_sheetLayout) {
+        setSheetLayout(CASheetLayout::forSheet(sheet));
+    } else if (_sheetLayout->sheet() != sheet && !CASheetLayout::isShown(sheet)) {
+        _sheetLayout->setSheet(sheet);
+    }
+}
+
+/*!
+	Starts showing the given sheet \a layout. Pointers to the drawable elements of the previous
+	layout are dropped. The selection and the current context are restored by attachLayout().
+*/
+void CAScoreView::setSheetLayout(std::shared_ptr<CASheetLayout> layout)
+{
+    if (_sheetLayout == layout) {
+        return;
+    }
+
+    if (_sheetLayout) {
+        detachLayout();
+        _sheetLayout->removeView(this);
+    }
+
+    _sheetLayout = layout;
+    _sheetLayout->addView(this);
+}
+
+/*!
+	Returns True, if the \a context is folded in this view and isn't laid out nor painted.
+*/
+bool CAScoreView::isContextHidden(CAContext* context)
+{
+    return _sheetLayout->isHidden(context);
+}
+
+/*!
+	Folds the \a context in this view, if \a hidden is True, or shows it again. Folding a staff
+	folds its lyrics too. The other views of the sheet keep showing all the contexts.
+
+	The view switches to its own layout without the hidden contexts (see
+	CASheetLayout::forSheet()), so the cost of the layout and paint depends only on the shown
+	contexts. The view is laid out again.
+*/
+void CAScoreView::setContextHidden(CAContext* context, bool hidden)
+{
+    QSet<CAContext*> hiddenContexts = _sheetLayout->hiddenContexts();
+    if (hidden == hiddenContexts.contains(context)) {
+        return;
+    }
+
+    if (hidden) {
+        hiddenContexts.insert(context);
+    } else {
+        hiddenContexts.remove(context);
+    }
+
+    CAContext* current = (_currentContext ? _currentContext->context() : nullptr);
+    setSheetLayout(CASheetLayout::forSheet(_sheet, hiddenContexts));
+    rebuild();
+    setCurrentContext((current && !isContextHidden(current)) ? findCElement(current) : nullptr);
+    update();
+}
+
+/*!
+	Shows all the contexts folded by setContextHidden(). The view uses the layout shared with the
+	other views of the sheet again.
+*/
+void CAScoreView::showAllContexts()
+{
+    if (!hasHiddenContexts()) {
+        return;
+    }
+
+    setSheetLayout(CASheetLayout::forSheet(_sheet));
+    rebuild();
+    update();
+}
+
+/*!
+	Drops all the pointers to the drawable elements of the sheet layout before they are destroyed.
+	The selected music elements and the index of the current context are remembered and restored
+	by attachLayout() after the next layout pass.
+*/
+void CAScoreView::detachLayout()
+{
+    QSet<CAMusElement*> musElementSet = QSet<CAMusElement*>::fromList(_pendingSelection);
+    for (int i = 0; i < _selection.size(); i++) {
+        if (!musElementSet.contains(_selection[i]->musElement())) {
+            musElementSet.insert(_selection[i]->musElement());
+            _pendingSelection << _selection[i]->musElement();
+        }
+    }
+
+    _selection.clear();
+    _selectionSet.clear();
+
+    if (_currentContext) {
+        _pendingContextIdx = _sheetLayout->drawableCList().list().indexOf(_currentContext); // remember the index of last used context
+        _currentContext = nullptr;
+    }
+
+    // clear the shadow notes
+    for (int i = 0; i < _shadowNote.size(); i++) {
+        delete _shadowDrawableNote[i];
+        _shadowNoteLength = _shadowNote[i]->playableLength();
+        delete _shadowNote[i];
+    }
+    _shadowNote.clear();
+    _shadowDrawableNote.clear();
+
+    _layoutTimer->stop();
+    invalidateTiles();
+    _layoutAttached = false;
+}
+
+/*!
+	Restores the selection, the current context and the shadow notes remembered by detachLayout()
+	using the new drawable elements of the sheet layout.
 */
+void CAScoreView::attachLayout()
+{
+    QList<CAMusElement*> musElementSelection = _pendingSelection;
+    int contextIdx = _pendingContextIdx;
+    _pendingSelection.clear();
+    _pendingContextIdx = -1;
+    _rebuildPending = false;
+    _layoutAttached = true;
+
+    QList<CADrawableContext*> drawableContexts = _sheetLayout->drawableCList().list();
+    if (_shadowNote.isEmpty()) {
+        for (int i = 0; i < drawableContexts.size(); i++) {
+            addShadowNote(drawableContexts[i]);
+        }
+    }
+
+    if (contextIdx != -1) // restore the last used context
+        setCurrentContext((drawableContexts.size() > contextIdx) ? drawableContexts[contextIdx] : nullptr);
+    else
+        setCurrentContext(nullptr);
+
+    addToSelection(musElementSelection);
 
+    if (!_sheetLayout->layoutCache().isComplete()) {
+        // select the elements right of the visible part when they are placed
+        for (int i = 0; i < musElementSelection.size(); i++) {
+            if (!_sheetLayout->mapDrawable().contains(musElementSelection[i]))
+                _pendingSelection << musElementSelection[i];
+        }
+        continueLayout();
+    }
+
+    setWorldCoords(worldCoords()); // needed to update the scrollbars
+    checkScrollBars();
+    updateHelpers();
+}
+
+/*!
+	Creates the shadow note for the drawable context \a elt, if it is a staff.
+*/
+void CAScoreView::addShadowNote(CADrawableContext* elt)
+{
+    if (elt->drawableContextType() == CADrawableContext::DrawableStaff && static_cast<CAStaff*>(elt->context())->voiceList().size()) {
+        _shadowNote << new CANote(CADiatonicPitch(), _shadowNoteLength, static_cast<CAStaff*>(elt->context())->voiceList()[0], 0);
+        _shadowDrawableNote << new CADrawableNote(_shadowNote.back(), elt, 0, 0, true);
+    }
+}
+
+/*!
+	Returns True, if any view of the sheet layout is visible.
+*/
+bool CAScoreView::isLayoutVisible()
+{
+    for (int i = 0; i < _sheetLayout->viewList().size(); i++) {
+        if (_sheetLayout->viewList()[i]->isVisible()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*!
+	Adds a drawable music element \a elt to the sheet layout and selects it, if \a select is true.
+*/
 void CAScoreView::addMElement(CADrawableMusElement* elt, bool select)
 {
-    _drawableMList.addElement(elt);
-    _mapDrawable.insertMulti(elt->musElement(), elt);
+    _sheetLayout->drawableMList().addElement(elt);
+    _sheetLayout->invalidateTimeIndex();
+    _sheetLayout->mapDrawable().insertMulti(elt->musElement(), elt);
+    for (int i = 0; i < _sheetLayout->viewList().size(); i++) {
+        _sheetLayout->viewList()[i]->_dirtyDrawables.insert(elt);
+    }
+
     if (select) {
         _selection.clear();
+        _selectionSet.clear();
         addToSelection(elt);
+        emit selectionChanged();
     }
 
     elt->drawableContext()->addMElement(elt);
-    emit selectionChanged();
 }
 
 /*!
-	Adds a drawable music element \a elt to the score view and selects it, if \a select is true.
+	Adds a drawable context \a elt to the sheet layout and makes it current, if \a select is true.
 */
 void CAScoreView::addCElement(CADrawableContext* elt, bool select)
 {
-    _drawableCList.addElement(elt);
-    _mapDrawable.insertMulti(elt->context(), elt);
+    _sheetLayout->drawableCList().addElement(elt);
+    _sheetLayout->mapDrawable().insertMulti(elt->context(), elt);
+    for (int i = 0; i < _sheetLayout->viewList().size(); i++) {
+        _sheetLayout->viewList()[i]->_dirtyDrawables.insert(elt);
+    }
 
     if (select)
         setCurrentContext(elt);
+}
 
-    if (elt->drawableContextType() == CADrawableContext::DrawableStaff && static_cast<CAStaff*>(elt->context())->voiceList().size()) {
-        _shadowNote << new CANote(CADiatonicPitch(), CAPlayableLength(CAPlayableLength::Quarter, 0), static_cast<CAStaff*>(elt->context())->voiceList()[0], 0);
-        _shadowDrawableNote << new CADrawableNote(_shadowNote.back(), elt, 0, 0, true);
+/*!
+	Adds a drawable note checker error \a dnce to the sheet layout.
+*/
+void CAScoreView::addDrawableNoteCheckerError(CADrawableNoteCheckerError* dnce)
+{
+    _sheetLayout->drawableNCEList().addElement(dnce);
+    _sheetLayout->mapDrawable().insertMulti(nullptr, dnce);
+}
+
+/*!
+	Removes all the drawable music elements placed at the horizontal coordinate \a x or right of it
+	and the additional elements \a elts from the sheet layout without destroying them.
+	Returns the list of the removed elements.
+
+	This is used by the incremental layout which re-engraves only part of the score.
+
+	\sa CALayoutEngine::repositRegion()
+*/
+QList<CADrawableMusElement*> CAScoreView::detachMElements(double x, const QList<CADrawableMusElement*>& elts)
+{
+    QList<CADrawableMusElement*> detached = _sheetLayout->drawableMList().takeFrom(x);
+    _sheetLayout->invalidateTimeIndex();
+    QSet<CADrawableMusElement*> detachedSet;
+    for (int i = 0; i < detached.size(); i++) {
+        detachedSet.insert(detached[i]);
     }
+
+    for (int i = 0; i < elts.size(); i++) {
+        if (!detachedSet.contains(elts[i]) && _sheetLayout->drawableMList().removeElement(elts[i])) {
+            detached << elts[i];
+            detachedSet.insert(elts[i]);
+        }
+    }
+
+    QHash<CADrawableContext*, QSet<CADrawableMusElement*>> contextElts;
+    for (int i = 0; i < detached.size(); i++) {
+        for (int j = 0; j < _sheetLayout->viewList().size(); j++) {
+            CAScoreView* v = _sheetLayout->viewList()[j];
+            v->_dirtyDrawables.remove(detached[i]);
+            v->_dirtyAreas << QRectF(detached[i]->xPos(), detached[i]->yPos(), detached[i]->width(), detached[i]->height());
+        }
+        _sheetLayout->mapDrawable().remove(detached[i]->musElement(), detached[i]);
+        contextElts[detached[i]->drawableContext()].insert(detached[i]);
+    }
+
+    for (QHash<CADrawableContext*, QSet<CADrawableMusElement*>>::const_iterator it = contextElts.constBegin(); it != contextElts.constEnd(); it++) {
+        it.key()->removeMElements(it.value());
+    }
+
+    return detached;
 }
 
 /*!
-	Adds a drawable music element \a elt to the score view and selects it, if \a select is true.
+	Removes all the drawable note checker errors placed at the horizontal coordinate \a x or right
+	of it from the score view without destroying them.
+	Returns the list of the removed elements.
 */
-void CAScoreView::addDrawableNoteCheckerError(CADrawableNoteCheckerError* dnce)
+QList<CADrawableNoteCheckerError*> CAScoreView::detachDrawableNoteCheckerErrors(double x)
 {
-    _drawableNCEList.addElement(dnce);
-    _mapDrawable.insertMulti(nullptr, dnce);
+    QList<CADrawableNoteCheckerError*> detached = _sheetLayout->drawableNCEList().takeFrom(x);
+    for (int i = 0; i < detached.size(); i++) {
+        _sheetLayout->mapDrawable().remove(nullptr, detached[i]);
+    }
+
+    return detached;
+}
+
+/*!
+	Replaces the drawable note checker errors with the current errors of the sheet without laying
+	out the sheet again. Errors of the elements which aren't laid out yet are placed by the layout.
+
+	\sa CANoteChecker::checkSheet()
+*/
+void CAScoreView::updateNoteCheckerErrors()
+{
+    qDeleteAll(detachDrawableNoteCheckerErrors(std::numeric_limits<double>::lowest()));
+
+    const QList<CANoteCheckerError*>& errors = sheet()->noteCheckerErrorList();
+    for (int i = 0; i < errors.size(); i++) {
+        CADrawableMusElement* target = findMElement(errors[i]->targetElement());
+        if (target) {
+            addDrawableNoteCheckerError(new CADrawableNoteCheckerError(errors[i], target));
+        }
+    }
 }
 
 /*!
@@ -334,7 +720,7 @@ CADrawableContext* CAScoreView::selectContext(CAContext* context)
         return nullptr;
     }
 
-    QList<CADrawableContext*> drawableContexts = _drawableCList.list();
+    QList<CADrawableContext*> drawableContexts = _sheetLayout->drawableCList().list();
     for (int i = 0; i < drawableContexts.size(); i++) {
         CAContext* c = drawableContexts[i]->context();
         if (c == context) {
@@ -353,7 +739,7 @@ void CAScoreView::setLastMousePressCoordsAfter(const QList<CAMusElement*> list)
 {
     double maxX = 0;
     for (int i = 0; i < list.size(); i++) {
-        QList<CADrawable*> drawables = _mapDrawable.values(list[i]);
+        QList<CADrawable*> drawables = _sheetLayout->mapDrawable().values(list[i]);
         for (int j = 0; j < drawables.size(); j++) {
             maxX = qMax(drawables[j]->xPos() + drawables[j]->width(), maxX);
         }
@@ -374,7 +760,7 @@ void CAScoreView::setLastMousePressCoordsAfter(const QList<CAMusElement*> list)
 */
 CADrawableContext* CAScoreView::selectCElement(double x, double y)
 {
-    QList<CADrawableContext*> l = _drawableCList.findInRange(x, y);
+    QList<CADrawableContext*> l = _sheetLayout->drawableCList().findInRange(x, y);
 
     if (l.size() != 0) {
         setCurrentContext(l.front());
@@ -393,7 +779,7 @@ CADrawableContext* CAScoreView::selectCElement(double x, double y)
 */
 QList<CADrawableMusElement*> CAScoreView::musElementsAt(double x, double y)
 {
-    QList<CADrawableMusElement*> l = _drawableMList.findInRange(x, y);
+    QList<CADrawableMusElement*> l = _sheetLayout->drawableMList().findInRange(x, y);
     for (int i = 0; i < l.size(); i++)
         if (!l[i]->isSelectable() || (selectedVoice() && l[i]->musElement() && l[i]->musElement()->isPlayable() && static_cast<CAPlayable*>(l[i]->musElement())->voice() != selectedVoice()))
             l.removeAt(i--);
@@ -412,8 +798,9 @@ QList<CADrawableMusElement*> CAScoreView::musElementsAt(double x, double y)
 CADrawableMusElement* CAScoreView::selectMElement(CAMusElement* elt)
 {
     _selection.clear();
+    _selectionSet.clear();
 
-    QList<CADrawable*> drawables = _mapDrawable.values(elt);
+    QList<CADrawable*> drawables = _sheetLayout->mapDrawable().values(elt);
     for (int i = 0; i < drawables.size(); i++) {
         if (drawables[i]->drawableType() == CADrawable::DrawableMusElement && static_cast<CADrawableMusElement*>(drawables[i])->musElement() == elt && drawables[i]->isSelectable()) {
             addToSelection(static_cast<CADrawableMusElement*>(drawables[i]));
@@ -428,34 +815,6 @@ CADrawableMusElement* CAScoreView::selectMElement(CAMusElement* elt)
         return nullptr;
 }
 
-/**!
- * This function clones the given drawable instances of musElements and contexts.
- * 
- * \obsolete This Function was used in the past when cloning the views to also clone the
- * elements. This behaviour was replaced for creating a new drawable instances
- * from the scene from scratch.
- */
-void CAScoreView::importElements(CAKDTree<CADrawableMusElement*>* origDMusElts, CAKDTree<CADrawableContext*>* origDContexts)
-{
-    QList<CADrawableContext*> drawableContexts = origDContexts->list();
-    for (int i = 0; i < drawableContexts.size(); i++) {
-        addCElement(drawableContexts[i]->clone());
-    }
-    QList<CADrawableContext*> newDrawableContexts = _drawableCList.list();
-
-    QList<CADrawableMusElement*> drawableMusElements = origDMusElts->list();
-    for (int i = 0; i < drawableMusElements.size(); i++) {
-        int idx = drawableContexts.indexOf(drawableMusElements[i]->drawableContext());
-        if (idx == -1) {
-            std::cerr << "ERROR: Music element " << drawableMusElements[i] << " does not have a drawable context!" << std::endl;
-        } else if (newDrawableContexts.size() <= idx) {
-            std::cerr << "ERROR: Index out of range. " << newDrawableContexts.size() << " new drawable contexts created. Request for idx=" << idx << std::endl;
-        } else {
-            addMElement(drawableMusElements[i]->clone(newDrawableContexts[idx]));
-        }
-    }
-}
-
 /*!
 	Returns a pointer to the nearest drawable music element left of the current coordinates with the largest startTime.
 	Drawable elements left borders are taken into account.
@@ -463,7 +822,7 @@ void CAScoreView::importElements(CAKDTree<CADrawableMusElement*>* origDMusElts,
 */
 CADrawableMusElement* CAScoreView::nearestLeftElement(double x, double, CADrawableContext* context)
 {
-    return _drawableMList.findNearestLeft(x, true, context);
+    return _sheetLayout->drawableMList().findNearestLeft(x, true, context);
 }
 
 /*!
@@ -473,7 +832,7 @@ CADrawableMusElement* CAScoreView::nearestLeftElement(double x, double, CADrawab
 */
 CADrawableMusElement* CAScoreView::nearestLeftElement(double x, double, CAVoice* voice)
 {
-    return _drawableMList.findNearestLeft(x, true, nullptr, voice);
+    return _sheetLayout->drawableMList().findNearestLeft(x, true, nullptr, voice);
 }
 
 /*!
@@ -483,7 +842,7 @@ CADrawableMusElement* CAScoreView::nearestLeftElement(double x, double, CAVoice*
 */
 CADrawableMusElement* CAScoreView::nearestRightElement(double x, double, CADrawableContext* context)
 {
-    return _drawableMList.findNearestRight(x, true, context);
+    return _sheetLayout->drawableMList().findNearestRight(x, true, context);
 }
 
 /*!
@@ -493,7 +852,7 @@ CADrawableMusElement* CAScoreView::nearestRightElement(double x, double, CADrawa
 */
 CADrawableMusElement* CAScoreView::nearestRightElement(double x, double, CAVoice* voice)
 {
-    return _drawableMList.findNearestRight(x, true, nullptr, voice);
+    return _sheetLayout->drawableMList().findNearestRight(x, true, nullptr, voice);
 }
 
 /*!
@@ -502,7 +861,7 @@ CADrawableMusElement* CAScoreView::nearestRightElement(double x, double, CAVoice
 */
 CADrawableContext* CAScoreView::nearestUpContext(double, double y)
 {
-    return static_cast<CADrawableContext*>(_drawableCList.findNearestUp(y));
+    return static_cast<CADrawableContext*>(_sheetLayout->drawableCList().findNearestUp(y));
 }
 
 /*!
@@ -511,7 +870,7 @@ CADrawableContext* CAScoreView::nearestUpContext(double, double y)
 */
 CADrawableContext* CAScoreView::nearestDownContext(double, double y)
 {
-    return static_cast<CADrawableContext*>(_drawableCList.findNearestDown(y));
+    return static_cast<CADrawableContext*>(_sheetLayout->drawableCList().findNearestDown(y));
 }
 
 /*!
@@ -519,8 +878,8 @@ CADrawableContext* CAScoreView::nearestDownContext(double, double y)
 */
 int CAScoreView::calculateTime(double x, double)
 {
-    CADrawableMusElement* left = _drawableMList.findNearestLeft(x, true);
-    CADrawableMusElement* right = _drawableMList.findNearestRight(x, true);
+    CADrawableMusElement* left = _sheetLayout->drawableMList().findNearestLeft(x, true);
+    CADrawableMusElement* right = _sheetLayout->drawableMList().findNearestRight(x, true);
 
     if (left) //the user clicked right of the element - return the nearest left element end time
         return left->musElement()->timeStart() + left->musElement()->timeLength();
@@ -541,7 +900,7 @@ int CAScoreView::calculateTime(double x, double)
 */
 QMap<int, CADrawableBarline*> CAScoreView::computeBarlinePositions(bool dotted)
 {
-    QList<CADrawableContext*> dContextList = _drawableCList.list();
+    QList<CADrawableContext*> dContextList = _sheetLayout->drawableCList().list();
     QMap<int, CADrawableBarline*> result;
 
     // determine staff with most barlines
@@ -589,7 +948,7 @@ QMap<int, CADrawableBarline*> CAScoreView::computeBarlinePositions(bool dotted)
 */
 CAContext* CAScoreView::contextCollision(double x, double y)
 {
-    QList<CADrawableContext*> l = _drawableCList.findInRange(x, y, 0, 0);
+    QList<CADrawableContext*> l = _sheetLayout->drawableCList().findInRange(x, y, 0, 0);
     if (l.size() == 0) {
         return nullptr;
     } else {
@@ -601,49 +960,282 @@ CAContext* CAScoreView::contextCollision(double x, double y)
 /*!
 	Calls the engraver to reposition the music elements on the canvas.
 	Also updates scrollbars.
+
+	The drawable elements are shared by all the views of the sheet (see CASheetLayout). The layout
+	pass is done once and the other views only restore their selection and current context. If
+	another view has already placed the current content of the sheet (eg. when all the views of the
+	document are rebuilt one by one), the view only starts using it.
+
+	If all the views of the sheet are hidden in a shown window (eg. a sheet in a background tab), only
+	the old drawable elements are removed and the layout is postponed until a view is shown. This way
+	changes in the document only engrave the sheets the user is actually looking at.
+
+	A visible view first lays out the music up to the right border of the visible part, so it can
+	be painted at once. The rest of the sheet is placed in chunks by the layout timer only when the
+	views are scrolled close to it, so long scores engrave and keep in memory only the part which was
+	actually shown. The scrollbars are estimated until the layout is complete.
+
+	\sa showEvent(), on_layoutTimer_timeout()
  */
 void CAScoreView::rebuild()
 {
-    // clear the shadow notes
-    CAPlayableLength l(CAPlayableLength::Quarter);
-    for (int i = 0; i < _shadowNote.size(); i++) {
-        delete _shadowDrawableNote[i];
-        l = _shadowNote[i]->playableLength();
-        delete _shadowNote[i];
+    CA_TRACE_ZONE("CAScoreView::rebuild");
+    CAActionLatency::beginPhase(CAActionLatency::LayoutPhase);
+    if (_sheetLayout->sheet() != _sheet) {
+        setSheetLayout(CASheetLayout::forSheet(_sheet)); // the sheet was replaced, but the layout is used by other views
     }
-    _shadowNote.clear();
-    _shadowDrawableNote.clear();
 
-    QList<CAMusElement*> musElementSelection;
-    for (int i = 0; i < _selection.size(); i++) {
-        if (!musElementSelection.contains(_selection[i]->musElement()))
-            musElementSelection << _selection[i]->musElement();
+    if (_sheetLayout->isCurrent() && (!_layoutAttached || _sheetLayout->isFresh(this))) {
+        if (!_layoutAttached) {
+            attachLayout();
+        }
+        return;
     }
 
-    _selection.clear();
+    if (!isLayoutVisible() && window()->isVisible()) {
+        postponeLayout();
+        return;
+    }
 
-    _drawableMList.clear(true);
-    int contextIdx = (_currentContext ? _drawableCList.list().indexOf(_currentContext) : -1); // remember the index of last used context
-    _drawableCList.clear(true);
-    _drawableNCEList.clear(true);
-    _mapDrawable.clear();
+    relayout(layoutLimit());
+}
+
+/*!
+	Lays out the sheet up to \a xLimit for all the views of the sheet layout. The views drop their
+	pointers to the old drawable elements and restore them from the new ones.
+*/
+void CAScoreView::relayout(int xLimit)
+{
+    const QList<CAScoreView*> views = _sheetLayout->viewList();
+    for (int i = 0; i < views.size(); i++) {
+        views[i]->detachLayout();
+    }
+    _sheetLayout->clear();
 
-    CALayoutEngine::reposit(this);
+    qint64 layoutStart = CATrace::now();
+    CALayoutEngine::reposit(this, xLimit, _layoutProgress);
+    _lastLayoutTime = CATrace::now() - layoutStart;
+    _sheetLayout->setBuilt(this);
 
-    for (int i = 0; i < _shadowNote.size(); i++) {
-        _shadowNote[i]->setPlayableLength(l);
+    for (int i = 0; i < views.size(); i++) {
+        views[i]->attachLayout();
+        if (views[i] != this) {
+            views[i]->update();
+        }
     }
+}
 
-    if (contextIdx != -1) // restore the last used context
-        setCurrentContext(static_cast<CADrawableContext*>((_drawableCList.size() > contextIdx) ? _drawableCList.list().at(contextIdx) : nullptr));
-    else
-        setCurrentContext(nullptr);
+/*!
+	Removes the drawable elements of the sheet layout and postpones the layout of all its views
+	until one of them is shown.
 
-    addToSelection(musElementSelection);
+	\sa showEvent()
+*/
+void CAScoreView::postponeLayout()
+{
+    const QList<CAScoreView*> views = _sheetLayout->viewList();
+    for (int i = 0; i < views.size(); i++) {
+        views[i]->detachLayout();
+        views[i]->_rebuildPending = true;
+    }
+    _sheetLayout->clear();
+}
+
+/*!
+	Does the layout postponed by rebuild() while all the views of the sheet were hidden, so the sheet
+	is painted at once when its tab is selected. Only the part of the sheet shown by this view is
+	placed, the rest is placed by the layout timer once the view is shown. Returns False, if the
+	layout wasn't postponed.
+
+	\sa releaseLayout(), CAMainWin::onWarmUpTimerTimeout()
+*/
+bool CAScoreView::warmUpLayout()
+{
+    if (!_rebuildPending) {
+        return false;
+    }
+
+    if (_sheetLayout->isCurrent()) {
+        attachLayout(); // placed by a view in another window meanwhile
+    } else {
+        relayout(qRound(worldX() + worldWidth()) + LAYOUT_CHUNK_WIDTH);
+    }
+    return true;
+}
+
+/*!
+	Removes the drawable elements of the sheet to free the memory, if none of its views is visible.
+	The sheet is laid out again, when a view is shown. Returns False, if the layout is shown or it
+	was already removed.
+
+	\sa warmUpLayout()
+*/
+bool CAScoreView::releaseLayout()
+{
+    if (!_layoutAttached || isLayoutVisible()) {
+        return false;
+    }
+
+    postponeLayout();
+    return true;
+}
+
+/*!
+	Rebuilds the layout, if needed, and places the rest of the sheet stopped by the progressive
+	layout at once. Used when the whole engraving is needed, eg. when exporting it.
+
+	If \a progress is set, the progress of the layout is reported to it. Returns False, if the
+	\a progress was canceled before the layout was complete. The part placed so far is kept and the
+	layout continues from there the next time.
+*/
+bool CAScoreView::completeLayout(CAProgress* progress)
+{
+    _layoutProgress = progress;
+    rebuild();
+    while (_layoutAttached && !layoutCache().isComplete() && !(progress && progress->isCanceled())) {
+        if (!CALayoutEngine::repositRemaining(this, 0, progress)) {
+            rebuild(); // the sheet was changed in the meantime
+        }
+    }
+    _layoutProgress = nullptr;
+
+    return !(progress && progress->isCanceled());
+}
+
+/*!
+	Returns the X coordinate up to which the sheet should be laid out, so all the visible views of
+	the sheet can be painted and scrolled a bit further. Returns 0, if no view is visible.
+*/
+int CAScoreView::layoutLimit()
+{
+    int xLimit = 0;
+    for (int i = 0; i < _sheetLayout->viewList().size(); i++) {
+        CAScoreView* v = _sheetLayout->viewList()[i];
+        if (v->isVisible()) {
+            xLimit = qMax(xLimit, qRound(v->worldX() + v->worldWidth()) + LAYOUT_CHUNK_WIDTH);
+        }
+    }
+
+    return xLimit;
+}
+
+/*!
+	Starts the layout timer, if the progressive layout stopped left of the layout limit of the
+	visible views.
+
+	\sa layoutLimit()
+*/
+void CAScoreView::continueLayout()
+{
+    if (!_layoutAttached || _layoutTimer->isActive() || _sheetLayout->layoutCache().isComplete() || _sheetLayout->layoutCache().isEmpty()) {
+        return;
+    }
+
+    if (_sheetLayout->layoutCache().columnList().last().x < layoutLimit()) {
+        _layoutTimer->start();
+    }
+}
+
+/*!
+	Places the next chunk of the sheet stopped by the progressive layout in rebuild() and
+	repaints the view. Restarts the timer until the sheet is placed up to the layout limit.
+	This function is usually layout timer's slot.
+
+	\sa continueLayout()
+*/
+void CAScoreView::on_layoutTimer_timeout()
+{
+    if (!_layoutAttached) {
+        return;
+    }
+
+    // other views of the sheet may have placed the rest of the sheet already
+    if (!_sheetLayout->layoutCache().isComplete() && !CALayoutEngine::repositRemaining(this, _sheetLayout->layoutCache().columnList().last().x + LAYOUT_CHUNK_WIDTH)) {
+        rebuild(); // the sheet was changed in the meantime
+        update();
+        return;
+    }
+
+    if (_sheetLayout->layoutCache().isComplete()) {
+        addToSelection(_pendingSelection);
+        _pendingSelection.clear();
+    } else {
+        // select the elements placed in this chunk
+        QList<CAMusElement*> placed;
+        for (int i = 0; i < _pendingSelection.size(); i++) {
+            if (_sheetLayout->mapDrawable().contains(_pendingSelection[i])) {
+                placed << _pendingSelection.takeAt(i--);
+            }
+        }
+        addToSelection(placed);
+
+        continueLayout();
+    }
 
     setWorldCoords(worldCoords()); // needed to update the scrollbars
     checkScrollBars();
-    updateHelpers();
+    update();
+}
+
+/*!
+	Re-engraves only the part of the score changed between \a timeStart and \a timeEnd and shifts
+	the drawable elements after it. Does a complete rebuild(), if the part cannot be re-engraved
+	separately.
+
+	The selection of all the views of the sheet is restored afterwards.
+
+	\sa CALayoutEngine::repositRegion(), rebuild()
+*/
+void CAScoreView::rebuildRegion(int timeStart, int timeEnd)
+{
+    CA_TRACE_ZONE("CAScoreView::rebuildRegion");
+    CAActionLatency::beginPhase(CAActionLatency::LayoutPhase);
+    if (_sheetLayout->sheet() != _sheet || !_layoutAttached || (!isLayoutVisible() && window()->isVisible())) {
+        rebuild();
+        return;
+    }
+
+    if (_sheetLayout->isFresh(this)) {
+        return; // another view of the sheet has already re-engraved it
+    }
+
+    QList<CAScoreView*> views;
+    QList<QList<CAMusElement*>> musElementSelections;
+    QList<QList<CADrawableMusElement*>> oldSelections;
+    for (int i = 0; i < _sheetLayout->viewList().size(); i++) {
+        CAScoreView* v = _sheetLayout->viewList()[i];
+        if (v->_layoutAttached) {
+            views << v;
+            musElementSelections << v->musElementSelection();
+            oldSelections << v->_selection;
+            v->_selection.clear();
+            v->_selectionSet.clear();
+        }
+    }
+
+    qint64 layoutStart = CATrace::now();
+    bool reposited = CALayoutEngine::repositRegion(this, timeStart, timeEnd);
+    _lastLayoutTime = CATrace::now() - layoutStart;
+    if (!reposited) {
+        for (int i = 0; i < views.size(); i++) {
+            views[i]->_selection = oldSelections[i];
+            views[i]->_selectionSet = QSet<CADrawableMusElement*>::fromList(oldSelections[i]);
+        }
+        rebuild();
+        return;
+    }
+    _sheetLayout->setBuilt(this);
+
+    for (int i = 0; i < views.size(); i++) {
+        views[i]->addToSelection(musElementSelections[i]);
+
+        views[i]->setWorldCoords(views[i]->worldCoords()); // needed to update the scrollbars
+        views[i]->checkScrollBars();
+        views[i]->updateHelpers();
+        if (views[i] != this) {
+            views[i]->update();
+        }
+    }
 }
 
 /*!
@@ -655,7 +1247,7 @@ void CAScoreView::rebuild()
 void CAScoreView::setWorldX(double x, bool animate, bool force)
 {
     if (!force) {
-        double maxX = (getMaxXExtended(_drawableMList) > getMaxXExtended(_drawableCList)) ? getMaxXExtended(_drawableMList) : getMaxXExtended(_drawableCList);
+        double maxX = getMaxWorldX();
         if (x > maxX - _worldW)
             x = maxX - _worldW;
         if (x < 0)
@@ -678,6 +1270,7 @@ void CAScoreView::setWorldX(double x, bool animate, bool force)
 
     checkScrollBars();
     updateHelpers();
+    continueLayout();
 }
 
 /*!
@@ -689,7 +1282,7 @@ void CAScoreView::setWorldX(double x, bool animate, bool force)
 void CAScoreView::setWorldY(double y, bool animate, bool force)
 {
     if (!force) {
-        int maxY = getMaxYExtended(_drawableMList) > getMaxYExtended(_drawableCList) ? getMaxYExtended(_drawableMList) : getMaxYExtended(_drawableCList);
+        int maxY = getMaxYExtended(_sheetLayout->drawableMList()) > getMaxYExtended(_sheetLayout->drawableCList()) ? getMaxYExtended(_sheetLayout->drawableMList()) : getMaxYExtended(_sheetLayout->drawableCList());
         if (y > maxY - _worldH)
             y = maxY - _worldH;
         if (y < 0)
@@ -731,7 +1324,7 @@ void CAScoreView::setWorldWidth(double w, bool force)
     _worldW = w;
 
     double scrollMax;
-    if ((scrollMax = ((getMaxXExtended(_drawableMList) > getMaxXExtended(_drawableCList)) ? getMaxXExtended(_drawableMList) : getMaxXExtended(_drawableCList)) - _worldW) >= 0) {
+    if ((scrollMax = getMaxWorldX() - _worldW) >= 0) {
         if (scrollMax < _worldX) //if you resize the widget at a large zoom level and if the getMax border has been reached
             setWorldX(scrollMax); //scroll the view away from the border
 
@@ -744,6 +1337,7 @@ void CAScoreView::setWorldWidth(double w, bool force)
     _zoom = static_cast<double>(drawableWidth() / _worldW);
 
     checkScrollBars();
+    continueLayout();
 }
 
 /*!
@@ -763,7 +1357,7 @@ void CAScoreView::setWorldHeight(double h, bool force)
     _worldH = h;
 
     double scrollMax;
-    if ((scrollMax = ((getMaxYExtended(_drawableMList) > getMaxYExtended(_drawableCList)) ? getMaxYExtended(_drawableMList) : getMaxYExtended(_drawableCList)) - _worldH) >= 0) {
+    if ((scrollMax = ((getMaxYExtended(_sheetLayout->drawableMList()) > getMaxYExtended(_sheetLayout->drawableCList())) ? getMaxYExtended(_sheetLayout->drawableMList()) : getMaxYExtended(_sheetLayout->drawableCList())) - _worldH) >= 0) {
         if (scrollMax < _worldY) //if you resize the widget at a large zoom level and if the getMax border has been reached
             setWorldY(scrollMax); //scroll the view away from the border
 
@@ -851,214 +1445,460 @@ void CAScoreView::zoomToSelection(bool animate, bool force)
 
 void CAScoreView::zoomToWidth(bool animate, bool force)
 {
-    int maxX = (getMaxXExtended(_drawableCList) > getMaxXExtended(_drawableMList)) ? getMaxXExtended(_drawableCList) : getMaxXExtended(_drawableMList);
+    int maxX = (getMaxXExtended(_sheetLayout->drawableCList()) > getMaxXExtended(_sheetLayout->drawableMList())) ? getMaxXExtended(_sheetLayout->drawableCList()) : getMaxXExtended(_sheetLayout->drawableMList());
     setWorldCoords(0, 0, maxX, 0, animate, force);
 }
 
 void CAScoreView::zoomToHeight(bool animate, bool force)
 {
-    int maxY = (getMaxYExtended(_drawableCList) > getMaxYExtended(_drawableMList)) ? getMaxYExtended(_drawableCList) : getMaxYExtended(_drawableMList);
+    int maxY = (getMaxYExtended(_sheetLayout->drawableCList()) > getMaxYExtended(_sheetLayout->drawableMList())) ? getMaxYExtended(_sheetLayout->drawableCList()) : getMaxYExtended(_sheetLayout->drawableMList());
     setWorldCoords(0, 0, 0, maxY, animate, force);
 }
 
-void CAScoreView::zoomToFit(bool animate, bool force)
-{
-    int maxX = ((_drawableCList.getMaxX() > _drawableMList.getMaxX()) ? _drawableCList.getMaxX() : _drawableMList.getMaxX());
-    int maxY = ((_drawableCList.getMaxY() > _drawableMList.getMaxY()) ? _drawableCList.getMaxY() : _drawableMList.getMaxY());
+void CAScoreView::zoomToFit(bool animate, bool force)
+{
+    int maxX = ((_sheetLayout->drawableCList().getMaxX() > _sheetLayout->drawableMList().getMaxX()) ? _sheetLayout->drawableCList().getMaxX() : _sheetLayout->drawableMList().getMaxX());
+    int maxY = ((_sheetLayout->drawableCList().getMaxY() > _sheetLayout->drawableMList().getMaxY()) ? _sheetLayout->drawableCList().getMaxY() : _sheetLayout->drawableMList().getMaxY());
+
+    setWorldCoords(0, 0, maxX, maxY, animate, force);
+}
+
+/*!
+	Sets the world coordinates of the view, so the given coordinates are the center of the new view area.
+	If the area has for eg. negative top-left coordinates, the area is moved to the (0,0) coordinates if \a force is False.
+	View's width and height stay intact.
+	\warning Repaint is not done automatically!
+*/
+void CAScoreView::setCenterCoords(double x, double y, bool animate, bool force)
+{
+    //	_checkScrollBarsDeadLock = true;
+    setWorldX(x - 0.5 * _worldW, animate, force);
+    setWorldY(y - 0.5 * _worldH, animate, force);
+    //	_checkScrollBarsDeadLock = false;
+
+    checkScrollBars();
+}
+
+/*!
+	Zooms to the given level to given direction.
+	\warning Repaint is not done automatically, if \a animate is False!
+
+	\param z Zoom level. (1.0 = 100%, 1.5 = 150% etc.)
+	\param x X coordinate of the point of the zoom direction.
+	\param y Y coordinate of the point of the zoom direction.
+	\param animate Use smooth animated zoom.
+	\param force Use the given world units despite their illegal values (like negative coordinates etc.).
+*/
+void CAScoreView::setZoom(float z, double x, double y, bool animate, bool force)
+{
+    bool zoomOut = false;
+    if (_zoom - z > 0.0)
+        zoomOut = true;
+
+    if (animate) {
+        if (!zoomOut) {
+            _targetWorldX = (_worldX - (_worldW / 2) + x) / 2;
+            _targetWorldY = (_worldY - (_worldH / 2) + y) / 2;
+            _targetZoom = z;
+            startAnimationTimer();
+            return;
+        } else {
+            _targetWorldX = 1.5 * _worldX + 0.25 * _worldW - 0.5 * x;
+            _targetWorldY = 1.5 * _worldY + 0.25 * _worldH - 0.5 * y;
+            _targetZoom = z;
+            startAnimationTimer();
+            return;
+        }
+    }
+
+    //set the world width - updates the zoom level zoom_ as well
+    setWorldWidth(drawableWidth() / z);
+    setWorldHeight(drawableHeight() / z);
+
+    if (!zoomOut) { //zoom in
+        //the new view's center coordinates will become the middle point of the current view center coords and the mouse pointer coords
+        setCenterCoords((_worldX + (_worldW / 2) + x) / 2,
+            (_worldY + (_worldH / 2) + y) / 2,
+            force);
+    } else { //zoom out
+        //the new view's center coordinates will become the middle point of the current view center coords and the mirrored over center pointer coords
+        //worldX_ + (worldW_/2) + (worldX_ + (worldW_/2) - x)/2
+        setCenterCoords(1.5 * _worldX + 0.75 * _worldW - 0.5 * x,
+            1.5 * _worldY + 0.75 * _worldH - 0.5 * y,
+            force);
+    }
+
+    checkScrollBars();
+    updateHelpers();
+}
+
+/*!
+	\fn void CAScoreView::setZoom(float z, QPoint p, bool animate, bool force);
+	Zooms to the given level to given direction.
+	This is an overloaded member function, provided for convenience.
+	\warning Repaint is not done automatically, if \a animate is False!
+
+	\param z Zoom level. (1.0 = 100%, 1.5 = 150% etc.)
+	\param p QPoint of the zoom direction.
+	\param animate Use smooth animated zoom.
+	\param force Use the given world units despite their illegal values (like negative coordinates etc.).
+*/
+
+/*!
+	Forgets all the rendered tiles. They are rendered again on the next repaint.
+	Call this when the drawable elements are changed outside of the layout engine, for example
+	when moved or resized.
+
+	\sa invalidateTiles(const QRectF&)
+*/
+void CAScoreView::invalidateTiles()
+{
+    _tiles.clear();
+    _dirtyDrawables.clear();
+    _dirtyAreas.clear();
+}
+
+/*!
+	Forgets the rendered tiles intersecting the given \a area in world coordinates.
+	Zero width or height of the area is treated as unlimited in that direction, the same as for
+	the drawable elements.
+*/
+void CAScoreView::invalidateTiles(const QRectF& area)
+{
+    if (_tiles.isEmpty()) {
+        return;
+    }
+
+    double x1 = area.x() - TILE_MARGIN;
+    double y1 = (area.height() ? (area.y() - TILE_MARGIN) : -std::numeric_limits<double>::max());
+    double x2 = (area.width() ? (area.x() + area.width() + TILE_MARGIN) : std::numeric_limits<double>::max());
+    double y2 = (area.height() ? (area.y() + area.height() + TILE_MARGIN) : std::numeric_limits<double>::max());
+
+    double tileWorldSize = TILE_SIZE / _tileZoom;
+    for (QHash<quint64, QPixmap>::iterator it = _tiles.begin(); it != _tiles.end();) {
+        double tx = static_cast<qint32>(it.key() >> 32) * tileWorldSize;
+        double ty = static_cast<qint32>(it.key() & 0xFFFFFFFF) * tileWorldSize;
+        if (tx <= x2 && tx + tileWorldSize >= x1 && ty <= y2 && ty + tileWorldSize >= y1)
+            it = _tiles.erase(it);
+        else
+            it++;
+    }
+}
+
+/*!
+	Returns the memory used by the rendered tiles in bytes.
+
+	\sa CADocumentStatistics
+*/
+qint64 CAScoreView::tileMemoryUsage()
+{
+    qint64 usage = 0;
+    for (QHash<quint64, QPixmap>::const_iterator it = _tiles.constBegin(); it != _tiles.constEnd(); it++) {
+        usage += static_cast<qint64>(it.value().width()) * it.value().height() * it.value().depth() / 8;
+    }
+    return usage;
+}
+
+/*!
+	Forgets the tiles intersecting the elements added or removed since the last repaint.
+	The dimensions of the added elements are read now, because the layout engine may change them
+	after the elements were added.
+*/
+void CAScoreView::invalidateDirtyTiles()
+{
+    for (QSet<CADrawable*>::const_iterator it = _dirtyDrawables.constBegin(); it != _dirtyDrawables.constEnd() && !_tiles.isEmpty(); it++) {
+        invalidateTiles(QRectF((*it)->xPos(), (*it)->yPos(), (*it)->width(), (*it)->height()));
+    }
+    for (int i = 0; i < _dirtyAreas.size() && !_tiles.isEmpty(); i++) {
+        invalidateTiles(_dirtyAreas[i]);
+    }
+
+    _dirtyDrawables.clear();
+    _dirtyAreas.clear();
+}
+
+/*!
+	Returns the color the drawable music element \a drawable is painted with, when not selected.
+	It depends on the currently selected voice and the element visibility.
+*/
+QColor CAScoreView::drawableColor(CADrawableMusElement* drawable)
+{
+    CAMusElement* elt = drawable->musElement();
+
+    if ((selectedVoice() && ((elt && ((elt->isPlayable() && static_cast<CAPlayable*>(elt)->voice() == selectedVoice()) || (!elt->isPlayable() && elt->context() == selectedVoice()->staff()) || elt->context() != selectedVoice()->staff())) || (!elt && drawable->drawableContext()->context() == selectedVoice()->staff()))) || (!selectedVoice())) {
+        if (elt && elt->musElementType() == CAMusElement::Rest && static_cast<CAPlayable*>(elt)->voice() == selectedVoice() && static_cast<CARest*>(elt)->restType() == CARest::Hidden) {
+            return hiddenElementsColor();
+        } else if ((elt && elt->musElementType() == CAMusElement::Rest && static_cast<CARest*>(elt)->restType() == CARest::Hidden) || (elt && !elt->isVisible())) {
+            return QColor(0, 0, 0, 0); // transparent color
+        } else if (elt && elt->color().isValid()) {
+            return elt->color(); // set elements color, if defined
+        } else {
+            return foregroundColor(); // set default color for foreground elements
+        }
+    } else {
+        if (elt && elt->musElementType() == CAMusElement::Rest && static_cast<CARest*>(elt)->restType() == CARest::Hidden) {
+            return QColor(0, 0, 0, 0); // transparent color
+        } else {
+            return disabledElementsColor();
+        }
+    }
+}
+
+/*!
+	Renders the contexts and music elements of the tile in column \a tx and row \a ty at the
+	current zoom level. Elements up to TILE_MARGIN world units outside the tile are also drawn,
+	because their glyphs may reach into it.
+*/
+QPixmap CAScoreView::renderTile(int tx, int ty)
+{
+    QPixmap tile(TILE_SIZE, TILE_SIZE);
+    tile.fill(_backgroundColor);
+
+    double tileWorldSize = TILE_SIZE / _zoom;
+    double tileX = tx * tileWorldSize;
+    double tileY = ty * tileWorldSize;
+
+    QPainter p(&tile);
+
+    // glyphs are too small to be recognized, draw the simplified shapes instead
+    if (_zoom <= CAOverviewRenderer::MAX_ZOOM) {
+        CAOverviewRenderer::render(&p, _sheetLayout.get(), QRectF(tileX, tileY, tileWorldSize, tileWorldSize), _zoom, foregroundColor());
+        return tile;
+    }
+
+    // draw contexts
+    QList<CADrawableContext*> cList = _sheetLayout->drawableCList().findInRange(tileX - TILE_MARGIN, tileY - TILE_MARGIN, tileWorldSize + 2 * TILE_MARGIN, tileWorldSize + 2 * TILE_MARGIN);
+    for (int i = 0; i < cList.size(); i++) {
+        CADrawSettings s = {
+            _zoom,
+            qRound((cList[i]->xPos() - tileX) * _zoom),
+            qRound((cList[i]->yPos() - tileY) * _zoom),
+            TILE_SIZE, TILE_SIZE,
+            ((_currentContext == cList[i]) ? selectedContextColor() : foregroundColor()),
+            tileX,
+            tileY
+        };
+        cList[i]->draw(&p, s);
+    }
+
+    // draw music elements
+    QList<CADrawableMusElement*> mList = _sheetLayout->drawableMList().findInRange(tileX - TILE_MARGIN, tileY - TILE_MARGIN, tileWorldSize + 2 * TILE_MARGIN, tileWorldSize + 2 * TILE_MARGIN);
+
+    p.setRenderHint(QPainter::Antialiasing, _antiAliasing);
+    double lodZoomFactor = _lodZoomFactor;
+
+    for (int i = 0; i < mList.size(); i++) {
+        CADrawSettings s = {
+            _zoom,
+            qRound((mList[i]->xPos() - tileX) * _zoom),
+            qRound((mList[i]->yPos() - tileY) * _zoom),
+            TILE_SIZE, TILE_SIZE,
+            drawableColor(mList[i]),
+            tileX,
+            tileY
+        };
+
+        // skip the text layout of the elements only a few pixels large
+        if (_zoom < mList[i]->minLegibleZoom() * lodZoomFactor) {
+            mList[i]->drawPlaceholder(&p, s);
+        } else {
+            mList[i]->draw(&p, s);
+        }
+    }
 
-    setWorldCoords(0, 0, maxX, maxY, animate, force);
+    return tile;
 }
 
 /*!
-	Sets the world coordinates of the view, so the given coordinates are the center of the new view area.
-	If the area has for eg. negative top-left coordinates, the area is moved to the (0,0) coordinates if \a force is False.
-	View's width and height stay intact.
-	\warning Repaint is not done automatically!
+	Does the layout postponed by rebuild() while the view was hidden or continues the layout done by
+	warmUpLayout().
 */
-void CAScoreView::setCenterCoords(double x, double y, bool animate, bool force)
+void CAScoreView::showEvent(QShowEvent* e)
 {
-    //	_checkScrollBarsDeadLock = true;
-    setWorldX(x - 0.5 * _worldW, animate, force);
-    setWorldY(y - 0.5 * _worldH, animate, force);
-    //	_checkScrollBarsDeadLock = false;
+    QWidget::showEvent(e);
 
-    checkScrollBars();
+    if (_rebuildPending) {
+        rebuild();
+    } else {
+        continueLayout(); // laid out in the background up to the visible part only
+    }
 }
 
 /*!
-	Zooms to the given level to given direction.
-	\warning Repaint is not done automatically, if \a animate is False!
+	General Qt's paint event.
 
-	\param z Zoom level. (1.0 = 100%, 1.5 = 150% etc.)
-	\param x X coordinate of the point of the zoom direction.
-	\param y Y coordinate of the point of the zoom direction.
-	\param animate Use smooth animated zoom.
-	\param force Use the given world units despite their illegal values (like negative coordinates etc.).
+	Paints the view using paintCanvas(), unless the OpenGL canvas is used. The OpenGL canvas is
+	repainted together with the view and calls paintCanvas() itself, so only the border is drawn
+	here.
 */
-void CAScoreView::setZoom(float z, double x, double y, bool animate, bool force)
+void CAScoreView::paintEvent(QPaintEvent* e)
 {
-    bool zoomOut = false;
-    if (_zoom - z > 0.0)
-        zoomOut = true;
-
-    if (animate) {
-        if (!zoomOut) {
-            _targetWorldX = (_worldX - (_worldW / 2) + x) / 2;
-            _targetWorldY = (_worldY - (_worldH / 2) + y) / 2;
-            _targetZoom = z;
-            startAnimationTimer();
-            return;
-        } else {
-            _targetWorldX = 1.5 * _worldX + 0.25 * _worldW - 0.5 * x;
-            _targetWorldY = 1.5 * _worldY + 0.25 * _worldH - 0.5 * y;
-            _targetZoom = z;
-            startAnimationTimer();
-            return;
-        }
-    }
-
-    //set the world width - updates the zoom level zoom_ as well
-    setWorldWidth(drawableWidth() / z);
-    setWorldHeight(drawableHeight() / z);
-
-    if (!zoomOut) { //zoom in
-        //the new view's center coordinates will become the middle point of the current view center coords and the mouse pointer coords
-        setCenterCoords((_worldX + (_worldW / 2) + x) / 2,
-            (_worldY + (_worldH / 2) + y) / 2,
-            force);
-    } else { //zoom out
-        //the new view's center coordinates will become the middle point of the current view center coords and the mirrored over center pointer coords
-        //worldX_ + (worldW_/2) + (worldX_ + (worldW_/2) - x)/2
-        setCenterCoords(1.5 * _worldX + 0.75 * _worldW - 0.5 * x,
-            1.5 * _worldY + 0.75 * _worldH - 0.5 * y,
-            force);
+    QPainter p(this);
+    if (!_openGLCanvas) {
+        paintCanvas(&p, e->rect());
+    } else if (_drawBorder) {
+        p.setPen(_borderPen);
+        p.drawRect(0, 0, width() - 1, height() - 1);
     }
-
-    checkScrollBars();
-    updateHelpers();
 }
 
 /*!
-	\fn void CAScoreView::setZoom(float z, QPoint p, bool animate, bool force);
-	Zooms to the given level to given direction.
-	This is an overloaded member function, provided for convenience.
-	\warning Repaint is not done automatically, if \a animate is False!
+	Paints the view using the given \a painter in the view coordinates.
 
-	\param z Zoom level. (1.0 = 100%, 1.5 = 150% etc.)
-	\param p QPoint of the zoom direction.
-	\param animate Use smooth animated zoom.
-	\param force Use the given world units despite their illegal values (like negative coordinates etc.).
-*/
+	Contexts and music elements are rendered into pixmap tiles of TILE_SIZE pixels which are kept
+	until the zoom level, colors or the elements inside them change. This way scrolling and playback
+	only blit the cached tiles. Selected elements, note checker errors, selection regions and shadow
+	notes are drawn directly over the tiles.
 
-/*!
-	General Qt's paint event.
-	All the music elements get actually rendered in this method.
+	When painted on the OpenGL canvas, the tiles are uploaded as textures once and scrolling only
+	composites them again on the GPU. While the zoom is animated, the tiles rendered at the starting
+	zoom level are scaled and the new ones are rendered once the animation ends.
+
+	If the \a dirty rectangle in view coordinates is set, only the tiles inside it are drawn. The
+	shadow notes and the selection regions are repainted this way when the mouse moves, see
+	updateArea().
+
+	\sa renderTile(), invalidateTiles()
 */
-#include <sys/time.h> //benchmarking
-#include <time.h> //benchmarking
-void CAScoreView::paintEvent(QPaintEvent*)
+void CAScoreView::paintCanvas(QPainter* painter, const QRect& dirty)
 {
+    CA_TRACE_ZONE("CAScoreView::paintCanvas");
     if (_holdRepaint)
         return;
 
+    CAActionLatency::beginPhase(CAActionLatency::PaintPhase);
+    qint64 frameStart = CATrace::now();
+
     // draw the border
-    QPainter p(this);
+    QPainter& p = *painter;
     if (_drawBorder) {
         p.setPen(_borderPen);
         p.drawRect(0, 0, width() - 1, height() - 1);
     }
 
-    // draw the background
-    if (_repaintArea)
-        p.fillRect(qRound((_repaintArea->x() - _worldX) * _zoom), qRound((_repaintArea->y() - _worldY) * _zoom), qRound(_repaintArea->width() * _zoom), qRound(_repaintArea->height() * _zoom), _backgroundColor);
-    else
-        p.fillRect(_canvas->x(), _canvas->y(), _canvas->width(), _canvas->height(), _backgroundColor);
-
-    // draw contexts
-    timeval timeStart, timeEnd, timeEnd2;
-    gettimeofday(&timeStart, nullptr);
-    QList<CADrawableContext*> cList;
-    //int j = _drawableCList.size();
-    if (_repaintArea)
-        cList = _drawableCList.findInRange(_repaintArea->x(), _repaintArea->y(), _repaintArea->width(), _repaintArea->height());
-    else
-        cList = _drawableCList.findInRange(_worldX, _worldY, _worldW, _worldH);
-
-    for (int i = 0; i < cList.size(); i++) {
-        CADrawSettings s = {
-            _zoom,
-            qRound((cList[i]->xPos() - _worldX) * _zoom),
-            qRound((cList[i]->yPos() - _worldY) * _zoom),
-            drawableWidth(), drawableHeight(),
-            ((_currentContext == cList[i]) ? selectedContextColor() : foregroundColor()),
-            _worldX,
-            _worldY
-        };
-        cList[i]->draw(&p, s);
+    // drop the tiles rendered with different colors or zoom level
+    bool tilesChanged = _tileVoice != selectedVoice() || _tileContext != _currentContext
+        || _tileAntiAliasing != _antiAliasing
+        || _tileLodZoomFactor != _lodZoomFactor
+        || _tileColors != (QList<QColor>() << _backgroundColor << foregroundColor() << selectedContextColor() << disabledElementsColor() << hiddenElementsColor());
+    bool scaleTiles = !tilesChanged && _tileZoom != _zoom && isAnimating() && !_tiles.isEmpty(); // reuse the tiles while zooming
+    if (tilesChanged || (_tileZoom != _zoom && !scaleTiles)) {
+        invalidateTiles();
+        _tileZoom = _zoom;
+        _tileVoice = selectedVoice();
+        _tileContext = _currentContext;
+        _tileAntiAliasing = _antiAliasing;
+        _tileLodZoomFactor = _lodZoomFactor;
+        _tileColors = QList<QColor>() << _backgroundColor << foregroundColor() << selectedContextColor() << disabledElementsColor() << hiddenElementsColor();
+    }
+    invalidateDirtyTiles();
+
+    // world coordinates of the view snapped to the pixels, so tiles and overlays are aligned
+    int originX = qRound(_worldX * _zoom);
+    int originY = qRound(_worldY * _zoom);
+    double worldX = originX / _zoom;
+    double worldY = originY / _zoom;
+
+    // draw contexts and music elements from the cached tiles
+    QRect area = dirty.isNull() ? _canvas->geometry() : (dirty & _canvas->geometry());
+    bool partial = (area != _canvas->geometry());
+    p.save();
+    p.setClipRect(area);
+
+    QSet<quint64> visibleTiles;
+    if (scaleTiles) {
+        // stretch the tiles of the zoom level the animation started at, the missing ones are left empty
+        double scale = _zoom / _tileZoom;
+        double tileOriginX = _worldX * _tileZoom;
+        double tileOriginY = _worldY * _tileZoom;
+        p.fillRect(_canvas->geometry(), _backgroundColor);
+        p.scale(scale, scale);
+        for (int ty = static_cast<int>(floor(tileOriginY / TILE_SIZE)); ty * TILE_SIZE < tileOriginY + drawableHeight() / scale; ty++) {
+            for (int tx = static_cast<int>(floor(tileOriginX / TILE_SIZE)); tx * TILE_SIZE < tileOriginX + drawableWidth() / scale; tx++) {
+                quint64 key = tileKey(tx, ty);
+                if (_tiles.contains(key)) {
+                    p.drawPixmap(QPointF(tx * TILE_SIZE - tileOriginX, ty * TILE_SIZE - tileOriginY), _tiles[key]);
+                }
+            }
+        }
+    } else {
+        for (int ty = static_cast<int>(floor(static_cast<double>(originY + area.top()) / TILE_SIZE)); ty * TILE_SIZE < originY + area.top() + area.height(); ty++) {
+            for (int tx = static_cast<int>(floor(static_cast<double>(originX + area.left()) / TILE_SIZE)); tx * TILE_SIZE < originX + area.left() + area.width(); tx++) {
+                quint64 key = tileKey(tx, ty);
+                if (!_tiles.contains(key)) {
+                    _tiles[key] = renderTile(tx, ty);
+                }
+                p.drawPixmap(tx * TILE_SIZE - originX, ty * TILE_SIZE - originY, _tiles[key]);
+                visibleTiles << key;
+            }
+        }
     }
+    p.restore();
 
-    // draw music elements
-    QList<CADrawableMusElement*> mList;
-    if (_repaintArea)
-        mList = _drawableMList.findInRange(_repaintArea->x(), _repaintArea->y(), _repaintArea->width(), _repaintArea->height());
-    else
-        mList = _drawableMList.findInRange(_worldX, _worldY, _worldW, _worldH);
-
-    gettimeofday(&timeEnd, nullptr);
+    if (!scaleTiles && !partial && _tiles.size() > MAX_TILES) {
+        // forget the invisible tiles
+        for (QHash<quint64, QPixmap>::iterator it = _tiles.begin(); it != _tiles.end();) {
+            if (visibleTiles.contains(it.key()))
+                it++;
+            else
+                it = _tiles.erase(it);
+        }
+    }
 
-    p.setRenderHint(QPainter::Antialiasing, CACanorus::settings()->antiAliasing());
+    // draw the selected music elements over the tiles
+    p.setRenderHint(QPainter::Antialiasing, _antiAliasing);
 
-    for (int i = 0; i < mList.size(); i++) {
-        QColor color;
-        CAMusElement* elt = mList[i]->musElement();
-
-        // determine element color (based on selection, current mode, active voice etc.)
-        if (_selection.contains(mList[i])) {
-            color = selectionColor();
-        } else if ((selectedVoice() && ((elt && ((elt->isPlayable() && static_cast<CAPlayable*>(elt)->voice() == selectedVoice()) || (!elt->isPlayable() && elt->context() == selectedVoice()->staff()) || elt->context() != selectedVoice()->staff())) || (!elt && mList[i]->drawableContext()->context() == selectedVoice()->staff()))) || (!selectedVoice())) {
-            if (elt && elt->musElementType() == CAMusElement::Rest && static_cast<CAPlayable*>(elt)->voice() == selectedVoice() && static_cast<CARest*>(elt)->restType() == CARest::Hidden) {
-                color = hiddenElementsColor();
-            } else if ((elt && elt->musElementType() == CAMusElement::Rest && static_cast<CARest*>(elt)->restType() == CARest::Hidden) || (elt && !elt->isVisible())) {
-                color = QColor(0, 0, 0, 0); // transparent color
-            } else if (elt && elt->color().isValid()) {
-                color = elt->color(); // set elements color, if defined
-            } else {
-                color = foregroundColor(); // set default color for foreground elements
+    if (_zoom <= CAOverviewRenderer::MAX_ZOOM) {
+        CAOverviewRenderer::renderSelection(&p, _selection, QRectF(worldX, worldY, _worldW, _worldH), _zoom, selectionColor());
+    } else {
+        for (int i = 0; i < _selection.size(); i++) {
+            CADrawSettings s = {
+                _zoom,
+                qRound((_selection[i]->xPos() - worldX) * _zoom),
+                qRound((_selection[i]->yPos() - worldY) * _zoom),
+                drawableWidth(), drawableHeight(),
+                selectionColor(),
+                worldX,
+                worldY
+            };
+            _selection[i]->draw(&p, s);
+            if (_selection[i]->isHScalable()) {
+                s.color = foregroundColor();
+                _selection[i]->drawHScaleHandles(&p, s);
             }
-        } else {
-            if (elt && elt->musElementType() == CAMusElement::Rest && static_cast<CARest*>(elt)->restType() == CARest::Hidden) {
-                color = QColor(0, 0, 0, 0); // transparent color
-            } else {
-                color = disabledElementsColor();
+            if (_selection[i]->isVScalable()) {
+                s.color = foregroundColor();
+                _selection[i]->drawVScaleHandles(&p, s);
             }
         }
+    }
 
-        CADrawSettings s = {
-            _zoom,
-            qRound((mList[i]->xPos() - _worldX) * _zoom),
-            qRound((mList[i]->yPos() - _worldY) * _zoom),
-            drawableWidth(), drawableHeight(),
-            color,
-            _worldX,
-            _worldY
-        };
-        mList[i]->draw(&p, s);
-        if (_selection.contains(mList[i]) && mList[i]->isHScalable()) {
-            s.color = foregroundColor();
-            mList[i]->drawHScaleHandles(&p, s);
-        }
-        if (_selection.contains(mList[i]) && mList[i]->isVScalable()) {
-            s.color = foregroundColor();
-            mList[i]->drawVScaleHandles(&p, s);
+    // draw the playback cursor over the tiles
+    if (!_playbackCursor.isEmpty()) {
+        QList<CADrawableMusElement*> played = playbackCursorDrawables();
+        if (_zoom <= CAOverviewRenderer::MAX_ZOOM) {
+            CAOverviewRenderer::renderSelection(&p, played, QRectF(worldX, worldY, _worldW, _worldH), _zoom, selectionColor());
+        } else {
+            for (int i = 0; i < played.size(); i++) {
+                CADrawSettings s = {
+                    _zoom,
+                    qRound((played[i]->xPos() - worldX) * _zoom),
+                    qRound((played[i]->yPos() - worldY) * _zoom),
+                    drawableWidth(), drawableHeight(),
+                    selectionColor(),
+                    worldX,
+                    worldY
+                };
+                played[i]->draw(&p, s);
+            }
         }
     }
 
     // draw ruler
-    if (CACanorus::settings()->showRuler()) {
+    if (_showRuler) {
         p.fillRect(0, 0, width(), RULER_HEIGHT, QColor::fromRgb(200, 200, 200, 128));
 
-        QFont font("FreeSans");
-        font.setPixelSize(qRound(RULER_HEIGHT * 0.8));
+        QFont font = CAFontCache::font(CAFontCache::FreeSans, qRound(RULER_HEIGHT * 0.8));
         p.setFont(font);
         p.setPen(Qt::black);
 
@@ -1084,16 +1924,16 @@ void CAScoreView::paintEvent(QPaintEvent*)
 
     // draw note checker errors
     {
-        QList<CADrawableNoteCheckerError*> dnceList = _drawableNCEList.findInRange(_worldX, _worldY, _worldW, _worldH);
+        QList<CADrawableNoteCheckerError*> dnceList = _sheetLayout->drawableNCEList().findInRange(_worldX, _worldY, _worldW, _worldH);
         for (int i = 0; i < dnceList.size(); i++) {
             CADrawSettings c = {
                 _zoom,
-                qRound((dnceList[i]->xPos() - _worldX) * _zoom),
-                qRound((dnceList[i]->yPos() - _worldY) * _zoom),
+                qRound((dnceList[i]->xPos() - worldX) * _zoom),
+                qRound((dnceList[i]->yPos() - worldY) * _zoom),
                 drawableWidth(), drawableHeight(),
                 Qt::red,
-                _worldX,
-                _worldY
+                worldX,
+                worldY
             };
             dnceList[i]->draw(&p, c);
         }
@@ -1103,13 +1943,13 @@ void CAScoreView::paintEvent(QPaintEvent*)
     for (int i = 0; i < selectionRegionList().size(); i++) {
         CADrawSettings c = {
             _zoom,
-            qRound((selectionRegionList().at(i).x() - _worldX) * _zoom),
-            qRound((selectionRegionList().at(i).y() - _worldY) * _zoom),
+            qRound((selectionRegionList().at(i).x() - worldX) * _zoom),
+            qRound((selectionRegionList().at(i).y() - worldY) * _zoom),
             qRound(selectionRegionList().at(i).width() * _zoom),
             qRound(selectionRegionList().at(i).height() * _zoom),
             selectionAreaColor(),
-            _worldX,
-            _worldY
+            worldX,
+            worldY
         };
         drawSelectionRegion(&p, c);
     }
@@ -1117,15 +1957,15 @@ void CAScoreView::paintEvent(QPaintEvent*)
     // draw shadow note
     if (_shadowNoteVisible) {
         for (int i = 0; i < _shadowDrawableNote.size(); i++) {
-            if (CACanorus::settings()->shadowNotesInOtherStaffs() || _shadowDrawableNote[i]->drawableContext() == currentContext()) {
+            if (_shadowNotesInOtherStaffs || _shadowDrawableNote[i]->drawableContext() == currentContext()) {
                 CADrawSettings s = {
                     _zoom,
-                    qRound((_shadowDrawableNote[i]->xPos() - _worldX - _shadowDrawableNote[i]->width() / 2) * _zoom),
-                    qRound((_shadowDrawableNote[i]->yPos() - _worldY) * _zoom),
+                    qRound((_shadowDrawableNote[i]->xPos() - worldX - _shadowDrawableNote[i]->width() / 2) * _zoom),
+                    qRound((_shadowDrawableNote[i]->yPos() - worldY) * _zoom),
                     drawableWidth(), drawableHeight(),
                     disabledElementsColor(),
-                    _worldX,
-                    _worldY
+                    worldX,
+                    worldY
                 };
 
                 _shadowDrawableNote[i]->draw(&p, s);
@@ -1133,7 +1973,7 @@ void CAScoreView::paintEvent(QPaintEvent*)
                 if (_drawShadowNoteAccs) {
                     CADrawableAccidental acc(_shadowNoteAccs, nullptr, nullptr, 0, _shadowDrawableNote[i]->yCenter());
                     s.x -= qRound((acc.width() + 2) * _zoom);
-                    s.y = qRound((acc.yPos() - _worldY) * _zoom);
+                    s.y = qRound((acc.yPos() - worldY) * _zoom);
                     acc.draw(&p, s);
                 }
             }
@@ -1141,29 +1981,28 @@ void CAScoreView::paintEvent(QPaintEvent*)
 
         // draw note name
         if (_shadowNote.size()) {
-            QFont font("FreeSans");
-            font.setPixelSize(20);
+            QFont font = CAFontCache::font(CAFontCache::FreeSans, 20);
             p.setFont(font);
             p.setPen(disabledElementsColor());
-            p.drawText(qRound((_xCursor - _worldX + 10) * _zoom), qRound((_yCursor - _worldY - 10) * _zoom), CANote::generateNoteName(_shadowNote[0]->diatonicPitch().noteName(), _shadowNoteAccs));
+            p.drawText(qRound((_xCursor - worldX + 10) * _zoom), qRound((_yCursor - worldY - 10) * _zoom), CANote::generateNoteName(_shadowNote[0]->diatonicPitch().noteName(), _shadowNoteAccs));
         }
     }
 
-    gettimeofday(&timeEnd2, nullptr);
-
-    //	std::cout << "finding elements to draw took " << timeEnd.tv_sec-timeStart.tv_sec+(timeEnd.tv_usec-timeStart.tv_usec)/1000000.0 << "s." << std::endl;
-    //	std::cout << "painting " << mList.size() << " elements took " << timeEnd2.tv_sec-timeEnd.tv_sec+(timeEnd2.tv_usec-timeEnd.tv_usec)/1000000.0 << "s." << std::endl;
-
     // flush the oldWorld coordinates as they're needed for the first repaint only
     _oldWorldX = _worldX;
     _oldWorldY = _worldY;
     _oldWorldW = _worldW;
     _oldWorldH = _worldH;
 
-    if (_repaintArea) {
-        delete _repaintArea;
-        _repaintArea = nullptr;
+    // frame time feeds the animation pacing, animation frames are traced from the step to the paint
+    qint64 frameEnd = CATrace::now();
+    _lastFrameTime = frameEnd - frameStart;
+    if (_animationFrameStart != -1) {
+        if (CATrace::isEnabled())
+            CATrace::record("CAScoreView::animationFrame", _animationFrameStart, frameEnd);
+        _animationFrameStart = -1;
     }
+    CAActionLatency::endAction(); // the first frame after an edit
 }
 
 void CAScoreView::updateHelpers()
@@ -1186,16 +2025,23 @@ void CAScoreView::updateHelpers()
         }
     }
 
-    // Text edit widget
+    // Text edit widget, moved and resized only when changed, so the widget isn't repainted on each call
     if (textEditVisible()) {
-        textEdit()->setFont(QFont("Century Schoolbook L", qRound(zoom() * (12 - 2))));
-        textEdit()->setGeometry(
+        QFont font(CAFontCache::family(CAFontCache::CenturySchoolbook), qRound(zoom() * (12 - 2)));
+        if (textEdit()->font() != font)
+            textEdit()->setFont(font);
+
+        QRect geometry(
             qRound((textEditGeometry().x() - worldX()) * zoom()),
             qRound((textEditGeometry().y() - worldY()) * zoom()),
             qRound(textEditGeometry().width() * zoom()),
             qRound(textEditGeometry().height() * zoom()));
-        textEdit()->show();
-    } else {
+        if (textEdit()->geometry() != geometry)
+            textEdit()->setGeometry(geometry);
+
+        if (textEdit()->isHidden())
+            textEdit()->show();
+    } else if (!textEdit()->isHidden()) {
         textEdit()->hide();
     }
 }
@@ -1246,7 +2092,7 @@ void CAScoreView::checkScrollBars()
     bool change = false;
     _holdRepaint = true; // disable repaint until the scrollbar values are set
     _checkScrollBarsDeadLock = true; // disable any further method calls until the method is over
-    if ((((getMaxXExtended(_drawableMList) > getMaxXExtended(_drawableCList)) ? getMaxXExtended(_drawableMList) : getMaxXExtended(_drawableCList)) - worldWidth() > 0) || (_hScrollBar->value() != 0)) { //if scrollbar is needed
+    if ((getMaxWorldX() - worldWidth() > 0) || (_hScrollBar->value() != 0)) { //if scrollbar is needed
         if (!_hScrollBar->isVisible()) {
             _hScrollBar->show();
             change = true;
@@ -1257,7 +2103,7 @@ void CAScoreView::checkScrollBars()
         change = true;
     }
 
-    if ((((getMaxYExtended(_drawableMList) > getMaxYExtended(_drawableCList)) ? getMaxYExtended(_drawableMList) : getMaxYExtended(_drawableCList)) - worldHeight() > 0) || (_vScrollBar->value() != 0)) { //if scrollbar is needed
+    if ((((getMaxYExtended(_sheetLayout->drawableMList()) > getMaxYExtended(_sheetLayout->drawableCList())) ? getMaxYExtended(_sheetLayout->drawableMList()) : getMaxYExtended(_sheetLayout->drawableCList())) - worldHeight() > 0) || (_vScrollBar->value() != 0)) { //if scrollbar is needed
         if (!_vScrollBar->isVisible()) {
             _vScrollBar->show();
             change = true;
@@ -1481,7 +2327,12 @@ void CAScoreView::enterEvent(QEvent*)
 void CAScoreView::startAnimationTimer()
 {
     _animationTimer->stop();
-    _animationStep = 0;
+    _animationStartX = _worldX;
+    _animationStartY = _worldY;
+    _animationStartZoom = _zoom;
+    _animationFrameStart = -1;
+    _animationClock.start();
+    _animationTimer->setInterval(FRAME_INTERVAL);
     _animationTimer->start();
     on_animationTimer_timeout();
 }
@@ -1575,17 +2426,31 @@ CADrawableMusElement* CAScoreView::selectDownMusElement()
 */
 void CAScoreView::addToSelection(CADrawableMusElement* elt, bool triggerSignal)
 {
-    int i;
-    for (i = 0; i < _selection.size() && _selection[i]->xPos() < elt->xPos(); i++)
-        ;
-
-    if (elt->isSelectable())
-        _selection.insert(i, elt);
+    if (elt->isSelectable() && !_selectionSet.contains(elt)) {
+        QList<CADrawableMusElement*>::iterator it = std::lower_bound(_selection.begin(), _selection.end(), elt,
+            [](CADrawableMusElement* a, CADrawableMusElement* b) { return a->xPos() < b->xPos(); });
+        _selection.insert(it, elt);
+        _selectionSet.insert(elt);
+    }
 
     if (triggerSignal)
         emit selectionChanged();
 }
 
+/*!
+	Removes the given drawable music element \a elt from the selection, if it exists.
+	Returns True, if element existed in the selection and was removed, false otherwise.
+*/
+bool CAScoreView::removeFromSelection(CADrawableMusElement* elt)
+{
+    if (!_selectionSet.remove(elt))
+        return false;
+
+    _selection.removeOne(elt);
+    emit selectionChanged();
+    return true;
+}
+
 /*!
 	Adds the given list of drawable music elements \a list to the current selection.
 */
@@ -1605,7 +2470,7 @@ void CAScoreView::addToSelection(const QList<CADrawableMusElement*> list, bool s
 */
 CADrawableMusElement* CAScoreView::addToSelection(CAMusElement* elt)
 {
-    QList<CADrawable*> l = _mapDrawable.values(elt);
+    QList<CADrawable*> l = _sheetLayout->mapDrawable().values(elt);
     for (int i = 0; i < l.size(); i++) {
         addToSelection(static_cast<CADrawableMusElement*>(l[i]));
     }
@@ -1614,13 +2479,151 @@ CADrawableMusElement* CAScoreView::addToSelection(CAMusElement* elt)
     return _selection.back();
 }
 
+/*!
+	Shows the given music elements \a elts being played. They are drawn in the selection color over
+	the score, without changing the selection. Only the area of the previous and the new cursor is
+	repainted, so this can be called at the display refresh rate.
+*/
+void CAScoreView::setPlaybackCursor(const QList<CAMusElement*>& elts)
+{
+    QRect dirty = _playbackCursorRect;
+    _playbackCursor = elts;
+    _playbackCursorRect = QRect();
+
+    QList<CADrawableMusElement*> played = playbackCursorDrawables();
+    for (int i = 0; i < played.size(); i++) {
+        QRect r(qRound((played[i]->xPos() - _worldX) * _zoom), qRound((played[i]->yPos() - _worldY) * _zoom),
+            qRound(played[i]->width() * _zoom) + 1, qRound(played[i]->height() * _zoom) + 1);
+        _playbackCursorRect |= r.adjusted(-2, -2, 2, 2); // antialiased edges
+    }
+
+    dirty |= _playbackCursorRect;
+    updateArea(dirty);
+}
+
+/*!
+	Replaces the selection regions drawn while dragging the mouse by the given \a regions in world
+	coordinates. Only the area where the old and the new regions differ is repainted, so the
+	rectangle follows the mouse without painting the whole view on every move.
+*/
+void CAScoreView::setSelectionRegionList(const QList<QRect>& regions)
+{
+    QRegion oldArea, newArea, borders;
+    for (int i = 0; i < _selectionRegionList.size(); i++) {
+        QRect r = worldToView(_selectionRegionList[i], 1);
+        oldArea |= r;
+        borders |= QRegion(r).subtracted(r.adjusted(3, 3, -3, -3));
+    }
+    for (int i = 0; i < regions.size(); i++) {
+        QRect r = worldToView(regions[i], 1);
+        newArea |= r;
+        borders |= QRegion(r).subtracted(r.adjusted(3, 3, -3, -3));
+    }
+
+    // the borders may move inside the area covered by both the old and the new regions
+    _selectionRegionList = regions;
+    updateArea(oldArea.xored(newArea) | borders);
+}
+
+/*!
+	Updates the shadow notes to the current cursor position (see updateHelpers()) and repaints
+	only the area of the previous and the new shadow notes.
+*/
+void CAScoreView::updateShadowNotes()
+{
+    updateHelpers();
+
+    QRect dirty = _shadowNoteRect;
+    _shadowNoteRect = shadowNoteRect();
+    updateArea(dirty | _shadowNoteRect);
+}
+
+/*!
+	Returns the area of the shadow notes, their accidentals and the note name drawn by
+	paintCanvas() in view coordinates.
+*/
+QRect CAScoreView::shadowNoteRect()
+{
+    QRect r;
+    if (!_shadowNoteVisible) {
+        return r;
+    }
+
+    for (int i = 0; i < _shadowDrawableNote.size(); i++) {
+        CADrawableNote* note = _shadowDrawableNote[i];
+        if (_shadowNotesInOtherStaffs || note->drawableContext() == currentContext()) {
+            // the accidental is drawn left of the note and may reach above and below it
+            double left = note->xPos() - note->width() / 2 - 2 * note->width();
+            r |= worldToView(QRectF(left, note->yPos() - note->height(), 3 * note->width(), 3 * note->height()), 2);
+        }
+    }
+
+    if (_shadowNote.size()) {
+        QPoint name(qRound((_xCursor - _worldX + 10) * _zoom), qRound((_yCursor - _worldY - 10) * _zoom));
+        r |= QRect(name.x() - 2, name.y() - 24, 160, 30); // note name in the 20 px font
+    }
+
+    return r;
+}
+
+/*!
+	Converts the \a world rectangle to the view coordinates and grows it by \a margin pixels to
+	cover the rounding and antialiasing.
+*/
+QRect CAScoreView::worldToView(const QRectF& world, int margin)
+{
+    return QRect(qFloor((world.x() - _worldX) * _zoom) - margin, qFloor((world.y() - _worldY) * _zoom) - margin,
+        qCeil(world.width() * _zoom) + 2 * margin + 1, qCeil(world.height() * _zoom) + 2 * margin + 1);
+}
+
+/*!
+	Schedules the repaint of the given \a area in world coordinates only, not the whole view.
+
+	\sa updateArea()
+*/
+void CAScoreView::setRepaintArea(const QRectF& area)
+{
+    updateArea(worldToView(area, 2));
+}
+
+/*!
+	Schedules the repaint of the \a dirty area of the view only.
+*/
+void CAScoreView::updateArea(const QRegion& dirty)
+{
+    if (dirty.isEmpty())
+        return;
+
+    if (_openGLCanvas)
+        _canvas->update(dirty);
+    else
+        update(dirty);
+}
+
+/*!
+	Returns the drawable elements of the music elements being played.
+	They are looked up on every paint, because the layout may be rebuilt during the playback.
+*/
+QList<CADrawableMusElement*> CAScoreView::playbackCursorDrawables()
+{
+    QList<CADrawableMusElement*> drawables;
+    for (int i = 0; i < _playbackCursor.size(); i++) {
+        QList<CADrawable*> l = _sheetLayout->mapDrawable().values(_playbackCursor[i]);
+        for (int j = 0; j < l.size(); j++) {
+            drawables << static_cast<CADrawableMusElement*>(l[j]);
+        }
+    }
+
+    return drawables;
+}
+
 /*!
 	Adds the given list of abstract music elements to the selection.
 */
 void CAScoreView::addToSelection(const QList<CAMusElement*> elts)
 {
     for (int i = 0; i < elts.size(); i++) {
-        QList<CADrawable*> l = _mapDrawable.values(elts[i]);
+        QList<CADrawable*> l = _sheetLayout->mapDrawable().values(elts[i]);
         for (int j = 0; j < l.size(); j++) {
             addToSelection(static_cast<CADrawableMusElement*>(l[j]), false);
         }
@@ -1637,7 +2640,7 @@ void CAScoreView::selectAll()
 {
     clearSelection();
 
-    QList<CADrawableMusElement*> elts = _drawableMList.list();
+    QList<CADrawableMusElement*> elts = _sheetLayout->drawableMList().list();
     for (int i = 0; i < elts.size(); i++)
         addToSelection(elts[i], false);
 
@@ -1689,10 +2692,10 @@ void CAScoreView::selectAllCurContext()
 */
 void CAScoreView::invertSelection()
 {
-    QList<CADrawableMusElement*> oldSelection = selection();
+    QSet<CADrawableMusElement*> oldSelection = _selectionSet;
     clearSelection();
 
-    QList<CADrawableMusElement*> elts = _drawableMList.list();
+    QList<CADrawableMusElement*> elts = _sheetLayout->drawableMList().list();
     for (int i = 0; i < elts.size(); i++)
         if (!oldSelection.contains(elts[i]))
             addToSelection(elts[i], false);
@@ -1711,7 +2714,7 @@ CADrawableMusElement* CAScoreView::findMElement(CAMusElement* elt)
         return nullptr;
     }
 
-    QList<CADrawable*> hits = _mapDrawable.values(elt);
+    QList<CADrawable*> hits = _sheetLayout->mapDrawable().values(elt);
     if (hits.size()) {
         return static_cast<CADrawableMusElement*>(hits[0]);
     }
@@ -1729,7 +2732,7 @@ CADrawableContext* CAScoreView::findCElement(CAContext* context)
         return nullptr;
     }
 
-    QList<CADrawable*> hits = _mapDrawable.values(context);
+    QList<CADrawable*> hits = _sheetLayout->mapDrawable().values(context);
     if (hits.size()) {
         return static_cast<CADrawableContext*>(hits[0]);
     }
@@ -1828,6 +2831,32 @@ double CAScoreView::getMaxXExtended(CAKDTree<T>& v)
     return v.getMaxX() + RIGHT_EXTRA_SPACE;
 }
 
+/*!
+	Returns the maximum X of the viewable World including the extra space for insertion at the end.
+	While the progressive layout is not complete, the width of the rest of the sheet is taken from the
+	layout hints of the opened file or estimated from the width and the duration of the already
+	placed bars.
+*/
+double CAScoreView::getMaxWorldX()
+{
+    double maxX = qMax(getMaxXExtended(_sheetLayout->drawableMList()), getMaxXExtended(_sheetLayout->drawableCList()));
+    if (!_sheetLayout->layoutCache().isComplete() && _sheetLayout->hintedWidth() > 0) {
+        maxX = qMax(maxX, _sheetLayout->hintedWidth() + RIGHT_EXTRA_SPACE);
+    } else if (!_sheetLayout->layoutCache().isComplete()) {
+        const CALayoutColumn& lastColumn = _sheetLayout->layoutCache().columnList().last();
+        int timeEnd = 0;
+        for (int i = 0; i < _sheetLayout->layoutCache().streamLastTimes().size(); i++) {
+            timeEnd = qMax(timeEnd, _sheetLayout->layoutCache().streamLastTimes()[i]);
+        }
+
+        if (lastColumn.timeStart > 0 && timeEnd > lastColumn.timeStart) {
+            maxX = qMax(maxX, static_cast<double>(lastColumn.x) * timeEnd / lastColumn.timeStart + RIGHT_EXTRA_SPACE);
+        }
+    }
+
+    return maxX;
+}
+
 /*!
 	Returns the maximum Y of the viewable World a little bigger to make insertion at the end easy.
 */
@@ -1846,140 +2875,72 @@ double CAScoreView::getMaxYExtended(CAKDTree<T>& v)
 */
 QList<CADrawableContext*> CAScoreView::findContextsInRegion(QRect& region)
 {
-    return _drawableCList.findInRange(region);
+    return _sheetLayout->drawableCList().findInRange(region);
 }
 
 /*!
 	Returns Canorus time for the given X coordinate \a x.
+	The time is interpolated between the nearest times left and right of the coordinate.
 
 	Returns 0, if no contexts are present.
+
+	\sa CASheetLayout::timeIndex()
 */
 int CAScoreView::coordsToTime(double x)
 {
-    CADrawableMusElement* d1 = nearestLeftElement(x, 0);
-    if (selection().contains(d1)) {
-        CADrawableMusElement* newD1 = nearestLeftElement(d1->xPos(), 0);
-        d1 = newD1;
+    const QVector<CATimeCoord>& index = _sheetLayout->timeIndex();
+    if (index.isEmpty()) {
+        return 0;
     }
 
-    CADrawableMusElement* d2 = nearestRightElement(x, 0);
-    if (selection().contains(d2)) {
-        CADrawableMusElement* newD2 = nearestRightElement(d2->xPos() + d2->width(), 0);
-        d2 = newD2;
+    QVector<CATimeCoord>::const_iterator right = std::upper_bound(index.constBegin(), index.constEnd(), x, [](double x, const CATimeCoord& c) { return x < c.x; });
+    if (right == index.constBegin()) {
+        return index.first().time;
+    } else if (right == index.constEnd()) {
+        return index.last().time;
     }
 
-    if (d1 && d2 && d1->musElement() && d2->musElement()) {
-        int delta = (d2->xPos() - d1->xPos());
-        if (!delta)
-            delta = 1;
-        return qRound(d1->musElement()->timeStart() + (d2->musElement()->timeStart() - d1->musElement()->timeStart()) * ((x - d1->xPos()) / delta));
-    } else if (d1 && d1->musElement())
-        return (d1->musElement()->timeEnd());
-    else
-        return 0;
-}
-
-/*!
- * Helper function for timeToCoords() when doing the binary search over elements.
- * 
- * \sa timeMusElementLessThan
- */
-bool CAScoreView::musElementTimeLessThan(const CAMusElement* a, const int b)
-{
-    return (a->timeStart() < b);
-}
-
-/*!
- * Helper function for timeToCoords() when doing the binary search over elements.
- * 
- * \sa musElementTimeLessThan
- */
-bool CAScoreView::timeMusElementLessThan(const int a, const CAMusElement* b)
-{
-    return (a < b->timeStart());
+    QVector<CATimeCoord>::const_iterator left = right - 1;
+    return qRound(left->time + (right->time - left->time) * ((x - left->x) / (right->x - left->x)));
 }
 
 /*!
 	Simple Version of \sa timeToCoords( time ):
-	Returns the X coordinate for the given Canorus \a time.
+	Returns the X coordinate of the nearest time in the score equal or greater than the given Canorus \a time.
 	Returns -1, if such a time doesn't exist in the score.
 */
 double CAScoreView::timeToCoordsSimpleVersion(int time)
 {
-    CADrawableMusElement* leftElt = nullptr;
-
-    QList<CAVoice*> voiceList = _sheet->voiceList();
-    for (int i = 0; i < voiceList.size(); i++) {
-        // get the element still smaller or equal, but nearest to time
-        QList<CAMusElement*>::const_iterator it = std::lower_bound(voiceList[i]->musElementList().constBegin(), voiceList[i]->musElementList().constEnd(), time, CAScoreView::musElementTimeLessThan);
-        if (it != voiceList[i]->musElementList().constEnd()) {
-            if (_mapDrawable.contains(*it)) {
-                CADrawableMusElement* dElt = static_cast<CADrawableMusElement*>(_mapDrawable.values(*it).last());
-                if (leftElt && leftElt->xPos() < dElt->xPos()) {
-                    leftElt = dElt;
-                }
-            } else {
-                std::cerr << "ERROR: Drawable instance of musElement " << (*it) << " doesn't exist in _mapDrawable!" << std::endl;
-            }
-        }
-    }
+    const QVector<CATimeCoord>& index = _sheetLayout->timeIndex();
+    QVector<CATimeCoord>::const_iterator it = std::lower_bound(index.constBegin(), index.constEnd(), time, [](const CATimeCoord& c, int time) { return c.time < time; });
 
-    return leftElt ? (leftElt->xPos()) : (-1);
+    return (it != index.constEnd()) ? (it->x) : (-1);
 }
 
 /*!
 	Returns the X coordinate for the given Canorus \a time.
+	The coordinate is interpolated between the nearest times left and right of the given one.
 	Returns -1, if such a time doesn't exist in the score.
+
+	\sa CASheetLayout::timeIndex()
 */
 double CAScoreView::timeToCoords(int time)
 {
-    CADrawableMusElement* leftElt = nullptr;
-    CADrawableMusElement* rightElt = nullptr;
-
-    QList<CAVoice*> voiceList = _sheet->voiceList();
-    for (int i = 0; i < voiceList.size(); i++) {
-        // get the element still smaller or equal, but nearest to time
-        QList<CAMusElement*>::const_iterator it = std::lower_bound(voiceList[i]->musElementList().constBegin(), voiceList[i]->musElementList().constEnd(), time, CAScoreView::musElementTimeLessThan);
-        if (it != voiceList[i]->musElementList().constEnd()) {
-            if (_mapDrawable.contains(*it)) {
-                CADrawableMusElement* dElt = static_cast<CADrawableMusElement*>(_mapDrawable.values(*it).last());
-                if (!leftElt || leftElt->xPos() < dElt->xPos()) {
-                    leftElt = dElt;
-                }
-            } else {
-                std::cerr << "ERROR: Drawable instance of musElement " << (*it) << " doesn't exist in _mapDrawable!" << std::endl;
-            }
-        }
-
-        // and for the right element
-        it = std::upper_bound(voiceList[i]->musElementList().constBegin(), voiceList[i]->musElementList().constEnd(), time, CAScoreView::timeMusElementLessThan);
-        if (it != voiceList[i]->musElementList().constEnd()) {
-            if (_mapDrawable.contains(*it)) {
-                CADrawableMusElement* dElt = static_cast<CADrawableMusElement*>(_mapDrawable.values(*it).first());
-                if (!rightElt || rightElt->xPos() > dElt->xPos()) {
-                    rightElt = dElt;
-                }
-            } else {
-                std::cerr << "ERROR: Drawable instance of musElement " << (*it) << " doesn't exist in _mapDrawable!" << std::endl;
-            }
-        }
-    }
-
-    // get the relative position between the nearest left and the nearest right elements
-    if (leftElt && rightElt && leftElt->musElement() && rightElt->musElement()) {
-        int delta = (rightElt->musElement()->timeStart() - leftElt->musElement()->timeStart());
-        if (!delta)
-            delta = 1;
-        // Note Reinhard: Fixed conversion to double
-        // I assume that division by delta should result in double value
-        return leftElt->xPos() + (rightElt->xPos() - leftElt->xPos()) * static_cast<double>(time - leftElt->musElement()->timeStart() / static_cast<double>(delta));
-    } else {
+    const QVector<CATimeCoord>& index = _sheetLayout->timeIndex();
+    QVector<CATimeCoord>::const_iterator right = std::lower_bound(index.constBegin(), index.constEnd(), time, [](const CATimeCoord& c, int time) { return c.time < time; });
+    if (right == index.constEnd()) {
         return -1;
+    } else if (right->time == time || right == index.constBegin()) {
+        return right->x;
     }
+
+    QVector<CATimeCoord>::const_iterator left = right - 1;
+    return left->x + (right->x - left->x) * (time - left->time) / static_cast<double>(right->time - left->time);
 }
 
 void CAScoreView::setShadowNoteLength(CAPlayableLength l)
 {
+    _shadowNoteLength = l;
     for (int i = 0; i < _shadowNote.size(); i++) {
         _shadowNote[i]->setPlayableLength(l);
     }
@@ -1994,9 +2955,11 @@ void CAScoreView::setShadowNoteLength(CAPlayableLength l)
 QList<CAMusElement*> CAScoreView::musElementSelection()
 {
     QList<CAMusElement*> res;
+    QSet<CAMusElement*> resSet;
 
     for (int i = 0; i < _selection.size(); i++) {
-        if (!res.contains(_selection[i]->musElement())) {
+        if (!resSet.contains(_selection[i]->musElement())) {
+            resSet.insert(_selection[i]->musElement());
             res << _selection[i]->musElement();
         }
     }
@@ -2010,9 +2973,9 @@ QList<CAMusElement*> CAScoreView::musElementSelection()
 */
 
 /*!
-	\fn bool CAScoreView::removeFromSelection(CADrawableMusElement *elt)
-	Removes the given drawable music element \a elt from the selection, if it exists.
-	Returns True, if element existed in the selection and was removed, false otherwise.
+	\fn bool CAScoreView::isSelected(CADrawableMusElement *elt)
+	Returns True, if the given drawable music element \a elt is selected. The lookup doesn't depend
+	on the number of the selected elements.
 */
 
 /*!
@@ -2044,20 +3007,6 @@ QList<CAMusElement*> CAScoreView::musElementSelection()
 	Returns the zoom level of the view (1.0 = 100%, 1.5 = 150% etc.).
 */
 
-/*!
-	\fn void CAScoreView::setRepaintArea(QRect *area)
-	Sets the area to be repainted, not the whole widget.
-
-	\sa clearRepaintArea()
-*/
-
-/*!
-	\fn void CAScoreView::clearRepaintArea()
-	Disables and deletes the area to be repainted.
-
-	\sa setRepaintArea()
-*/
-
 /*!
 	\fn void CAScoreView::CAMousePressEvent(QMouseEvent *e, QPoint p, CAScoreView *v)
 
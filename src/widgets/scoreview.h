@@ -1,5 +1,5 @@
 /*!
-	Copyright (c) 2006-2007, Matevž Jekovec, Canorus development team
+	Copyright (c) 2006-2020, Matevž Jekovec, Canorus development team
 	All Rights Reserved. See AUTHORS for a complete list of authors.
 
 	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
@@ -9,24 +9,37 @@
 #define SCOREVIEW_H_
 
 #include <QBrush>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QLineEdit>
 #include <QList>
 #include <QMultiMap>
 #include <QPen>
+#include <QPixmap>
 #include <QRect>
+#include <QRectF>
+#include <QRegion>
+#include <QSet>
 #include <QTimer>
 
 #include "layout/kdtree.h"
+#include "layout/layoutcache.h"
+#include "layout/sheetlayout.h"
 #include "score/note.h"
 #include "widgets/view.h"
 
+#include <memory>
+
 class QScrollBar;
 class QMouseEvent;
 class QWheelEvent;
+class QShowEvent;
 class QTimer;
 class QGridLayout;
+class QPainter;
 
 class CADrawable;
+class CAProgress;
 class CADrawableMusElement;
 class CADrawableContext;
 class CADrawableNote;
@@ -71,7 +84,8 @@ public:
     CAScoreView* clone();
     CAScoreView* clone(QWidget* parent);
     inline CASheet* sheet() { return _sheet; }
-    inline void setSheet(CASheet* sheet) { _sheet = sheet; }
+    void setSheet(CASheet* sheet);
+    inline CASheetLayout* sheetLayout() { return _sheetLayout.get(); }
 
     ////////////////////////////////////////////
     // Addition, removal of drawable elements //
@@ -79,13 +93,15 @@ public:
     void addMElement(CADrawableMusElement* elt, bool select = false);
     void addCElement(CADrawableContext* elt, bool select = false);
     void addDrawableNoteCheckerError(CADrawableNoteCheckerError* dnce);
-
-    void importElements(CAKDTree<CADrawableMusElement*>* drawableMList, CAKDTree<CADrawableContext*>* drawableCList);
+    QList<CADrawableMusElement*> detachMElements(double x, const QList<CADrawableMusElement*>& elts = QList<CADrawableMusElement*>());
+    QList<CADrawableNoteCheckerError*> detachDrawableNoteCheckerErrors(double x);
+    void updateNoteCheckerErrors();
 
     ///////////////
     // Selection //
     ///////////////
     inline const QList<CADrawableMusElement*>& selection() { return _selection; }
+    inline bool isSelected(CADrawableMusElement* elt) const { return _selectionSet.contains(elt); }
     QList<CAMusElement*> musElementSelection();
     QList<CADrawableMusElement*> musElementsAt(double x, double y);
     CADrawableContext* selectCElement(double x, double y);
@@ -104,14 +120,10 @@ public:
     inline void clearSelection()
     {
         _selection.clear();
+        _selectionSet.clear();
         emit selectionChanged();
     }
-    // Note Reinhard: This code does not make sense
-    inline bool removeFromSelection(CADrawableMusElement* elt)
-    {
-        return _selection.removeAll(elt);
-        emit selectionChanged();
-    }
+    bool removeFromSelection(CADrawableMusElement* elt);
 
     void addToSelection(CADrawableMusElement* elt, bool triggerSignal = true);
     void addToSelection(const QList<CADrawableMusElement*> list, bool selectableOnly = true);
@@ -127,6 +139,7 @@ public:
     inline void addSelectionRegion(QRect r) { _selectionRegionList << r; }
     inline void removeSelectionRegion(QRect r) { _selectionRegionList.removeAll(r); }
     inline void clearSelectionRegionList() { _selectionRegionList.clear(); }
+    void setSelectionRegionList(const QList<QRect>& regions);
     inline CADrawable::CADirection resizeDirection() { return _resizeDirection; }
     bool mouseDragActivated();
 
@@ -143,8 +156,6 @@ public:
     int coordsToTime(double x);
     double timeToCoords(int time);
     double timeToCoordsSimpleVersion(int time);
-    static bool musElementTimeLessThan(const CAMusElement* a, const int b);
-    static bool timeMusElementLessThan(const int a, const CAMusElement* b);
 
     CADrawableContext* nearestUpContext(double x, double y);
     CADrawableContext* nearestDownContext(double x, double y);
@@ -154,6 +165,11 @@ public:
 
     CAContext* contextCollision(double x, double y);
 
+    bool isContextHidden(CAContext* context);
+    void setContextHidden(CAContext* context, bool hidden);
+    inline bool hasHiddenContexts() { return !_sheetLayout->hiddenContexts().isEmpty(); }
+    void showAllContexts();
+
     ////////////////
     // Scrollbars //
     ////////////////
@@ -169,9 +185,25 @@ public:
     // Scene appearance, properties and actions //
     //////////////////////////////////////////////
     void rebuild();
+    void rebuildRegion(int timeStart, int timeEnd);
+    bool completeLayout(CAProgress* progress = nullptr);
+    bool warmUpLayout();
+    bool releaseLayout();
+    inline bool isLayoutAttached() { return _layoutAttached; }
+    bool isLayoutVisible();
+    void invalidateTiles();
+    void invalidateTiles(const QRectF& area);
+    inline int tileCount() { return _tiles.size(); }
+    qint64 tileMemoryUsage();
+    inline CALayoutCache& layoutCache() { return _sheetLayout->layoutCache(); }
     void setMouseTracking(bool); // reimplemented!
     inline int drawableWidth() { return _canvas->width(); }
     inline int drawableHeight() { return _canvas->height(); }
+    inline bool isOpenGLCanvas() { return _openGLCanvas; }
+    inline bool isAnimating() { return _animationTimer->isActive(); }
+    inline double lastFrameTime() { return _lastFrameTime / 1e6; } // in milliseconds
+    inline double lastLayoutTime() { return _lastLayoutTime / 1e6; } // in milliseconds
+    void paintCanvas(QPainter* painter, const QRect& dirty = QRect());
 
     void setWorldX(double x, bool animate = false, bool force = false);
     void setWorldY(double y, bool animate = false, bool force = false);
@@ -222,14 +254,9 @@ public:
 
     inline bool playing() { return _playing; }
     inline void setPlaying(bool playing) { _playing = playing; }
+    void setPlaybackCursor(const QList<CAMusElement*>& elts);
 
-    inline void setRepaintArea(QRect* area) { _repaintArea = area; }
-    inline void clearRepaintArea()
-    {
-        if (_repaintArea)
-            delete _repaintArea;
-        _repaintArea = nullptr;
-    }
+    void setRepaintArea(const QRectF& area);
 
     inline CAVoice* selectedVoice() { return _selectedVoice; }
     inline void setSelectedVoice(CAVoice* selectedVoice) { _selectedVoice = selectedVoice; }
@@ -261,6 +288,10 @@ public:
     void setNoteName(QString n) { _noteName = n; }
 
     void updateHelpers(); // method for updating shadow notes, syllable edits and other post-engrave elements coordinates and sizes when zoom level is changed etc.
+    void updateShadowNotes();
+
+public slots:
+    void applySettings();
 
 private slots:
     void mousePressEvent(QMouseEvent* e);
@@ -274,10 +305,12 @@ private slots:
 
     void resizeEvent(QResizeEvent* e);
     void paintEvent(QPaintEvent* p);
+    void showEvent(QShowEvent* e);
     void leaveEvent(QEvent* e);
     void enterEvent(QEvent* e);
     void on_animationTimer_timeout();
     void on_clickTimer_timeout();
+    void on_layoutTimer_timeout();
 
 signals:
     void CATripleClickEvent(QMouseEvent* e, QPoint p);
@@ -294,27 +327,39 @@ protected:
 
 private:
     void initScoreView(CASheet* s);
-    inline void clearMElements() { _drawableMList.clear(true); }
-    inline void clearCElements() { _drawableCList.clear(true); }
-    inline bool isSelected(CADrawableMusElement* elt) { return (_selection.contains(elt)); }
+    void setSheetLayout(std::shared_ptr<CASheetLayout> layout);
+    void detachLayout();
+    void attachLayout();
+    void relayout(int xLimit);
+    void postponeLayout();
+    void addShadowNote(CADrawableContext* elt);
+    int layoutLimit();
+    void continueLayout();
 
     //////////////////
     // Core Widgets //
     //////////////////
     QGridLayout* _layout; // Grid layout for placing the scrollbars at the right and the bottom.
     QWidget* _canvas; // Virtual canvas which represents the size of the drawable area. All its signals are forwarded to CAView.
+    bool _openGLCanvas; // _canvas is an OpenGL widget which paints the view, see paintCanvas()
     QScrollBar *_hScrollBar, *_vScrollBar; // Horizontal/vertical scrollbars
 
     ////////////////////////
     // General properties //
     ////////////////////////
-    CAKDTree<CADrawableMusElement*> _drawableMList; // The list of music elements stored in a tree for faster lookup and other operations. Every view has its own list of drawable elements and drawable objects themselves!
-    CAKDTree<CADrawableContext*> _drawableCList; // The list of context drawable elements (staffs, lyrics etc.). Every view has its own list of drawable elements and drawable objects themselves!
-    CAKDTree<CADrawableNoteCheckerError*> _drawableNCEList; // The list of drawable note checker errors
-    QMultiMap<void*, CADrawable*> _mapDrawable; // Mapping of all music elements/contexts in the score -> drawable elements on canvas
+    std::shared_ptr<CASheetLayout> _sheetLayout; // Drawable elements and contexts shared by all the views of the sheet
+    bool _layoutAttached; // The selection and the current context point to the current drawable elements of _sheetLayout
+    bool _rebuildPending; // The view was hidden when rebuild() was called. The layout is done when it is shown.
+    QList<CAMusElement*> _pendingSelection; // Selected music elements to restore after the pending rebuild
+    int _pendingContextIdx; // Index of the current context to restore after the pending rebuild or -1
+    CAProgress* _layoutProgress; // Progress and cancellation of the layout done by completeLayout()
+    QTimer* _layoutTimer; // Places the rest of the sheet in chunks when the views are scrolled close to it
+    static const int LAYOUT_CHUNK_WIDTH; // Width in world units laid out at once right of the visible part
+    double getMaxWorldX(); // Right border of the world including the estimated width of the music not laid out yet
     CASheet* _sheet; // Pointer to the CASheet which the view represents.
 
-    QList<CADrawableMusElement*> _selection; // The set of elements being selected.
+    QList<CADrawableMusElement*> _selection; // The set of elements being selected, ordered by their x position.
+    QSet<CADrawableMusElement*> _selectionSet; // The same elements as _selection for fast lookup.
     CADrawableContext* _currentContext; // The pointer to the currently active context (staff, lyrics).
 
     static const int RIGHT_EXTRA_SPACE; // Extra space at the right end to insert new music
@@ -346,6 +391,7 @@ private:
     bool _drawShadowNoteAccs; // Draw shadow note accs?
     QList<CANote*> _shadowNote; // List of all shadow notes - one shadow note per drawable staff
     QList<CADrawableNote*> _shadowDrawableNote; // List of drawable shadow notes
+    CAPlayableLength _shadowNoteLength; // Length of the shadow notes kept while the layout is detached
 
     // QLineEdit for editing or creating a lyrics syllable
     CATextEdit* _textEdit;
@@ -362,6 +408,28 @@ private:
     QList<QRect> _selectionRegionList;
     void drawSelectionRegion(QPainter* p, CADrawSettings s);
 
+    // Rendered tiles
+    static const int TILE_SIZE; // Width and height of the rendered tiles in pixels
+    static const int TILE_MARGIN; // Extra space in world units around a tile the elements are looked up in
+    static const int MAX_TILES; // Number of cached tiles when the invisible tiles are forgotten
+    inline static quint64 tileKey(int tx, int ty) { return (static_cast<quint64>(static_cast<quint32>(tx)) << 32) | static_cast<quint32>(ty); }
+    QHash<quint64, QPixmap> _tiles; // Rendered contexts and music elements for the current zoom level, indexed by tile column and row
+    QSet<CADrawable*> _dirtyDrawables; // Elements added since the last repaint. Their tiles need to be rendered again.
+    QList<QRectF> _dirtyAreas; // Areas of the elements removed since the last repaint
+    double _tileZoom; // Zoom level the tiles were rendered at
+    CAVoice* _tileVoice; // Selected voice the tiles were rendered with
+    CADrawableContext* _tileContext; // Current context the tiles were rendered with
+    bool _antiAliasing; // Settings used when painting, refreshed by applySettings()
+    double _lodZoomFactor;
+    bool _showRuler;
+    bool _shadowNotesInOtherStaffs;
+    bool _tileAntiAliasing; // Antialiasing setting the tiles were rendered with
+    double _tileLodZoomFactor; // Level of detail setting the tiles were rendered with
+    QList<QColor> _tileColors; // Colors the tiles were rendered with
+    void invalidateDirtyTiles();
+    QColor drawableColor(CADrawableMusElement* drawable);
+    QPixmap renderTile(int tx, int ty);
+
 public:
     static const int SELECTION_REGION_THRESHOLD; // Threshold in px for mouse move until the selection region is activated
 
@@ -371,7 +439,6 @@ private:
     ////////////////
     bool _grabTabKey; // Pass the tab key to keyPressEvent() or treat it like the next item key
     bool _drawBorder; // Should the border be drawn or not.
-    QRect* _repaintArea; // Area to be repainted on paintEvent().
     QPen _borderPen; // Pen which the border is drawn by.
     QColor _backgroundColor; // Color which the background is filled.
     QColor _foregroundColor; // Color which the music elements are painted.
@@ -387,8 +454,13 @@ private:
     // Animation //
     ///////////////
     QTimer* _animationTimer; // Timer used to animate scroll/zoom behaviour.
-    static const int ANIMATION_STEPS; // Number of steps used in animation
-    int _animationStep; // Current step in the animation
+    static const int ANIMATION_DURATION; // Duration of the animation in milliseconds
+    static const int FRAME_INTERVAL; // Shortest time between the animation frames in milliseconds
+    QElapsedTimer _animationClock; // Time since the animation started
+    double _animationStartX, _animationStartY, _animationStartZoom; // World coordinates and zoom level when the animation started
+    qint64 _animationFrameStart; // CATrace::now() of the animation step waiting to be painted, -1 if none
+    qint64 _lastFrameTime; // Duration of the last paintCanvas() in nanoseconds
+    qint64 _lastLayoutTime; // Duration of the last layout pass done by this view in nanoseconds
     double _targetWorldX, _targetWorldY, _targetWorldW, _targetWorldH; // Absolute world coordinates of the area the view is currently showing.
     double _targetZoom; // Zoom level of the view (1.0 = 100%, 1.5 = 150% etc.).
 
@@ -405,6 +477,13 @@ private:
     /////////////////////////
     double _oldWorldX, _oldWorldY, _oldWorldW, _oldWorldH; // Old coordinates used before the repaint. This is needed so only the new part of the view gets repainted when panning.
     bool _playing; // Set to on, when in Playback mode
+    QList<CAMusElement*> _playbackCursor; // Elements being played, drawn over the tiles
+    QRect _playbackCursorRect; // Area covered by the drawn playback cursor in view coordinates
+    QList<CADrawableMusElement*> playbackCursorDrawables();
+    QRect _shadowNoteRect; // Area covered by the shadow notes and the note name in view coordinates, set by updateShadowNotes()
+    QRect shadowNoteRect();
+    QRect worldToView(const QRectF& world, int margin = 0);
+    void updateArea(const QRegion& dirty);
     QTimer* _clickTimer; // Used for measuring doubleClick and tripleClick
     int _numberOfClicks; // Used for measuring doubleClick and tripleClick
 
@@ -0,0 +1,570 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#include <QFont>
+#include <QTextDocument>
+
+#include "widgets/sourcehighlighter.h"
+
+#include "core/taskscheduler.h"
+#include "core/trace.h"
+
+const int CASourceHighlighter::PARSE_DELAY = 300; // miliseconds after the last change
+
+struct CASourceBlock { // validated by CASourceParseJob
+    int number;
+    int revision; // of the block text when it was taken
+    int startState; // state of the previous block
+    QString text;
+    QVector<CASourceError> errors;
+};
+
+namespace {
+
+// lexical state at the block end, stored in the block state together with the nesting depth
+enum CAScanMode {
+    Normal,
+    InComment,
+    InString, // LilyPond string
+    InTag, // between the CanorusML tag name and its end
+    InQuote, // CanorusML attribute value in double quotes
+    InApostrophe // CanorusML attribute value in single quotes
+};
+
+const int MODE_MASK = 0x0f;
+const int DEPTH_SHIFT = 4; // depth of the braces or the tags
+
+void addToken(QVector<CASourceHighlighter::CASourceToken>* tokens, int start, int length, CASourceHighlighter::CASourceTokenType type)
+{
+    if (tokens && length > 0) {
+        CASourceHighlighter::CASourceToken token = { start, length, type };
+        tokens->append(token);
+    }
+}
+
+void addError(QVector<CASourceError>* errors, int start, int length, const QString& message)
+{
+    if (errors) {
+        CASourceError error = { start, length, message };
+        errors->append(error);
+    }
+}
+
+inline bool isNameStart(QChar c)
+{
+    return c.isLetter() || c == '_' || c == ':';
+}
+
+int nameEnd(const QString& text, int i)
+{
+    while (i < text.size() && (text[i].isLetterOrNumber() || text[i] == '_' || text[i] == ':' || text[i] == '-' || text[i] == '.')) {
+        i++;
+    }
+    return i;
+}
+
+int skipSpaces(const QString& text, int i)
+{
+    while (i < text.size() && text[i].isSpace()) {
+        i++;
+    }
+    return i;
+}
+
+/*!
+	Returns True, if the LilyPond \a word is a pitch name in the dutch notation or a rest.
+*/
+bool isPitchName(const QString& word)
+{
+    if (word == "r" || word == "R" || word == "s") {
+        return true;
+    }
+    if (word.isEmpty() || word[0] < 'a' || word[0] > 'g') {
+        return false;
+    }
+
+    int i = 1;
+    if ((word[0] == 'a' || word[0] == 'e') && word.midRef(i, 1) == QLatin1String("s")) {
+        i++; // as, es
+    }
+    while (word.midRef(i, 2) == QLatin1String("is") || word.midRef(i, 2) == QLatin1String("es")) {
+        i += 2;
+    }
+
+    return i == word.size();
+}
+
+/*!
+	Validation result of a block, kept until its text or the state of the previous block changes.
+*/
+class CASourceBlockData : public QTextBlockUserData {
+public:
+    int revision;
+    int startState;
+    QVector<CASourceError> errors;
+};
+
+}
+
+/*!
+	Scans the text of the changed blocks for errors in the task scheduler and passes them back to
+	the highlighter by CASourceHighlighter::finishParse().
+*/
+class CASourceParseJob : public CATask {
+public:
+    CASourceParseJob(CASourceHighlighter* highlighter, const QVector<CASourceBlock>& blocks)
+        : CATask(CATask::Interactive)
+        , _highlighter(highlighter)
+        , _syntax(highlighter->syntax())
+        , _blocks(blocks)
+    {
+    }
+
+    void run()
+    {
+        CA_TRACE_ZONE("CASourceParseJob::run");
+        for (CASourceBlock& block : _blocks) {
+            if (isCanceled()) {
+                return;
+            }
+            CASourceHighlighter::scan(_syntax, block.text, block.startState, nullptr, &block.errors);
+        }
+
+        QMetaObject::invokeMethod(_highlighter, "finishParse", Qt::QueuedConnection);
+    }
+
+    inline const QVector<CASourceBlock>& blocks() const { return _blocks; }
+
+private:
+    CASourceHighlighter* _highlighter;
+    CASourceHighlighter::CASourceSyntax _syntax;
+    QVector<CASourceBlock> _blocks;
+};
+
+/*!
+	\class CASourceHighlighter
+	\brief Incremental syntax highlighting and validation of the CanorusML and LilyPond source
+
+	The highlighter is attached to the document of the source view. Like every QSyntaxHighlighter
+	it only highlights the blocks (lines) which changed and the following blocks, as long as the
+	state at their end changes. The state holds the lexical mode at the end of the block (comment,
+	string, inside a tag) and the depth of the braces or tags, see scan().
+
+	Errors are found by scanning the changed blocks again in the task scheduler, PARSE_DELAY after
+	the last change. A block is only validated again, when its text or the state of the previous
+	block changes. The errors are underlined in the text when the result arrives and can be
+	retrieved by errors().
+
+	\sa CASourceView
+*/
+
+CASourceHighlighter::CASourceHighlighter(QTextDocument* doc, CASourceSyntax syntax)
+    : QSyntaxHighlighter(doc)
+    , _syntax(syntax)
+{
+    _formats[Comment].setForeground(Qt::darkGray);
+    _formats[Comment].setFontItalic(true);
+    _formats[String].setForeground(Qt::darkRed);
+    _formats[Keyword].setForeground(Qt::darkBlue);
+    _formats[Keyword].setFontWeight(QFont::Bold);
+    _formats[Attribute].setForeground(Qt::darkMagenta);
+    _formats[Bracket].setForeground(Qt::darkCyan);
+    _formats[Number].setForeground(Qt::darkGreen);
+    _formats[Entity].setForeground(Qt::darkYellow);
+
+    _parseTimer.setSingleShot(true);
+    _parseTimer.setInterval(PARSE_DELAY);
+    connect(&_parseTimer, SIGNAL(timeout()), this, SLOT(startParse()));
+}
+
+CASourceHighlighter::~CASourceHighlighter()
+{
+    if (_job) {
+        _job->cancel();
+        _job->wait(); // its result is dropped together with this object
+    }
+}
+
+/*!
+	Returns the errors found in the given \a block. The list is empty, if the block wasn't
+	validated since it was last changed.
+*/
+QVector<CASourceError> CASourceHighlighter::errors(const QTextBlock& block)
+{
+    if (!isValidated(block)) {
+        return QVector<CASourceError>();
+    }
+
+    return static_cast<CASourceBlockData*>(block.userData())->errors;
+}
+
+/*!
+	Returns the first block with errors or an invalid block, if no errors were found.
+*/
+QTextBlock CASourceHighlighter::firstError()
+{
+    for (QTextBlock block = document()->begin(); block != document()->end(); block = block.next()) {
+        if (isValidated(block) && !static_cast<CASourceBlockData*>(block.userData())->errors.isEmpty()) {
+            return block;
+        }
+    }
+
+    return QTextBlock();
+}
+
+/*!
+	Scans the \a text of a single block in the given \a syntax starting in the \a state of the
+	previous block (-1 for the first block). The highlighted parts are appended to \a tokens and
+	the errors to \a errors, if not null.
+
+	Returns the state at the end of the block.
+*/
+int CASourceHighlighter::scan(CASourceSyntax syntax, const QString& text, int state, QVector<CASourceToken>* tokens, QVector<CASourceError>* errors)
+{
+    switch (syntax) {
+    case CanorusML:
+        return scanCanorusML(text, state, tokens, errors);
+    case LilyPond:
+        return scanLilyPond(text, state, tokens, errors);
+    }
+
+    return state;
+}
+
+int CASourceHighlighter::scanCanorusML(const QString& text, int state, QVector<CASourceToken>* tokens, QVector<CASourceError>* errors)
+{
+    int mode = (state < 0 ? Normal : state & MODE_MASK);
+    int depth = (state < 0 ? 0 : state >> DEPTH_SHIFT);
+    int n = text.size();
+    int i = 0;
+
+    while (i < n) {
+        switch (mode) {
+        case InComment: {
+            int end = text.indexOf("-->", i);
+            int stop = (end < 0 ? n : end + 3);
+            addToken(tokens, i, stop - i, Comment);
+            i = stop;
+            if (end >= 0) {
+                mode = Normal;
+            }
+            break;
+        }
+        case InQuote:
+        case InApostrophe: {
+            int end = text.indexOf(mode == InQuote ? '"' : '\'', i);
+            int stop = (end < 0 ? n : end + 1);
+            addToken(tokens, i, stop - i, String);
+            i = stop;
+            if (end >= 0) {
+                mode = InTag;
+            }
+            break;
+        }
+        case InTag: {
+            QChar c = text[i];
+            if (c.isSpace() || c == '=') {
+                i++;
+            } else if (c == '>') {
+                addToken(tokens, i, 1, Bracket);
+                mode = Normal;
+                i++;
+            } else if (c == '/' && text.midRef(i, 2) == QLatin1String("/>")) {
+                addToken(tokens, i, 2, Bracket);
+                depth = qMax(depth - 1, 0); // the element opened by the tag is empty
+                mode = Normal;
+                i += 2;
+            } else if (c == '"' || c == '\'') {
+                addToken(tokens, i, 1, String);
+                mode = (c == '"' ? InQuote : InApostrophe);
+                i++;
+            } else if (isNameStart(c)) {
+                int end = nameEnd(text, i);
+                addToken(tokens, i, end - i, Attribute);
+                int j = skipSpaces(text, end);
+                if (j < n && text[j] != '=') {
+                    addError(errors, i, end - i, tr("Attribute without a value"));
+                } else if (j < n) {
+                    j = skipSpaces(text, j + 1);
+                    if (j < n && text[j] != '"' && text[j] != '\'') {
+                        addError(errors, j, 1, tr("Attribute value must be quoted"));
+                    }
+                }
+                i = end;
+            } else {
+                addError(errors, i, 1, tr("Unexpected character in the tag"));
+                i++;
+            }
+            break;
+        }
+        default: {
+            int lt = text.indexOf('<', i);
+            int amp = text.indexOf('&', i);
+            if (lt < 0 && amp < 0) {
+                i = n;
+            } else if (amp >= 0 && (lt < 0 || amp < lt)) {
+                int j = amp + 1;
+                if (text.midRef(j, 2) == QLatin1String("#x")) {
+                    for (j += 2; j < n && QString("0123456789abcdefABCDEF").contains(text[j]); j++) {
+                    }
+                } else if (text.midRef(j, 1) == QLatin1String("#")) {
+                    for (j++; j < n && text[j].isDigit(); j++) {
+                    }
+                } else {
+                    j = nameEnd(text, j);
+                }
+                if (j > amp + 1 && text.midRef(j, 1) == QLatin1String(";")) {
+                    addToken(tokens, amp, j + 1 - amp, Entity);
+                    i = j + 1;
+                } else {
+                    addError(errors, amp, 1, tr("Invalid entity"));
+                    i = amp + 1;
+                }
+            } else if (text.midRef(lt, 4) == QLatin1String("<!--")) {
+                addToken(tokens, lt, 4, Comment);
+                mode = InComment;
+                i = lt + 4;
+            } else if (text.midRef(lt, 2) == QLatin1String("<?") || text.midRef(lt, 2) == QLatin1String("<!")) {
+                int end = text.indexOf('>', lt);
+                int stop = (end < 0 ? n : end + 1);
+                addToken(tokens, lt, stop - lt, Keyword);
+                i = stop;
+            } else {
+                bool closing = (text.midRef(lt, 2) == QLatin1String("</"));
+                int start = lt + (closing ? 2 : 1);
+                if (start < n && isNameStart(text[start])) {
+                    int end = nameEnd(text, start);
+                    addToken(tokens, lt, end - lt, Keyword);
+                    depth += (closing ? -1 : 1);
+                    if (depth < 0) {
+                        addError(errors, lt, end - lt, tr("Unmatched closing tag"));
+                        depth = 0;
+                    }
+                    mode = InTag;
+                    i = end;
+                } else {
+                    addError(errors, lt, start - lt, tr("Invalid tag name"));
+                    i = start;
+                }
+            }
+            break;
+        }
+        }
+    }
+
+    return mode | (depth << DEPTH_SHIFT);
+}
+
+int CASourceHighlighter::scanLilyPond(const QString& text, int state, QVector<CASourceToken>* tokens, QVector<CASourceError>* errors)
+{
+    int mode = (state < 0 ? Normal : state & MODE_MASK);
+    int depth = (state < 0 ? 0 : state >> DEPTH_SHIFT);
+    int n = text.size();
+    int i = 0;
+
+    while (i < n) {
+        if (mode == InComment) {
+            int end = text.indexOf("%}", i);
+            int stop = (end < 0 ? n : end + 2);
+            addToken(tokens, i, stop - i, Comment);
+            i = stop;
+            if (end >= 0) {
+                mode = Normal;
+            }
+            continue;
+        } else if (mode == InString) {
+            int j = i;
+            while (j < n && text[j] != '"') {
+                j += (text[j] == '\\' ? 2 : 1);
+            }
+            int stop = qMin(j + 1, n);
+            addToken(tokens, i, stop - i, String);
+            i = stop;
+            if (j < n) {
+                mode = Normal;
+            }
+            continue;
+        }
+
+        QChar c = text[i];
+        if (c == '%') {
+            if (text.midRef(i, 2) == QLatin1String("%{")) {
+                addToken(tokens, i, 2, Comment);
+                mode = InComment;
+                i += 2;
+            } else {
+                addToken(tokens, i, n - i, Comment);
+                i = n;
+            }
+        } else if (c == '"') {
+            addToken(tokens, i, 1, String);
+            mode = InString;
+            i++;
+        } else if (c == '\\') {
+            int j = i + 1;
+            while (j < n && text[j].isLetter()) {
+                j++;
+            }
+            if (j == i + 1 && j < n && QString("\\()[]<>!~=_^-+.|").contains(text[j])) {
+                j++; // \\, \(, \[, \< and the other short commands
+            }
+            if (j > i + 1) {
+                addToken(tokens, i, j - i, Keyword);
+            } else {
+                addError(errors, i, 1, tr("Invalid command"));
+            }
+            i = j;
+        } else if (c == '{' || text.midRef(i, 2) == QLatin1String("<<")) {
+            int length = (c == '{' ? 1 : 2);
+            addToken(tokens, i, length, Bracket);
+            depth++;
+            i += length;
+        } else if (c == '}' || text.midRef(i, 2) == QLatin1String(">>")) {
+            int length = (c == '}' ? 1 : 2);
+            addToken(tokens, i, length, Bracket);
+            if (--depth < 0) {
+                addError(errors, i, length, tr("Unmatched closing brace"));
+                depth = 0;
+            }
+            i += length;
+        } else if (c == '<' || c == '>') {
+            addToken(tokens, i, 1, Bracket);
+            i++;
+        } else if (c.isLetter()) {
+            int j = i;
+            while (j < n && text[j].isLetter()) {
+                j++;
+            }
+            bool pitch = isPitchName(text.mid(i, j - i));
+            while (pitch && j < n && QString("',!?").contains(text[j])) {
+                j++; // octave and accidental marks
+            }
+            i = j;
+            if (pitch && j < n && text[j].isDigit()) {
+                while (j < n && text[j].isDigit()) {
+                    j++;
+                }
+                addToken(tokens, i, j - i, Number);
+                int duration = text.mid(i, j - i).toInt();
+                if (duration < 1 || duration > 128 || (duration & (duration - 1))) {
+                    addError(errors, i, j - i, tr("Invalid duration"));
+                }
+                i = j;
+            }
+        } else if (c.isDigit()) {
+            int j = i;
+            while (j < n && text[j].isDigit()) {
+                j++;
+            }
+            addToken(tokens, i, j - i, Number);
+            i = j;
+        } else {
+            i++;
+        }
+    }
+
+    return mode | (depth << DEPTH_SHIFT);
+}
+
+/*!
+	Highlights the block and underlines its errors, if it was validated since it was changed.
+	Otherwise the parse timer is restarted, so the block is validated as soon as the typing
+	pauses.
+*/
+void CASourceHighlighter::highlightBlock(const QString& text)
+{
+    QVector<CASourceToken> tokens;
+    setCurrentBlockState(scan(_syntax, text, previousBlockState(), &tokens, nullptr));
+    for (const CASourceToken& token : tokens) {
+        setFormat(token.start, token.length, _formats[token.type]);
+    }
+
+    if (!isValidated(currentBlock())) {
+        if (!_job) {
+            _parseTimer.start();
+        }
+        return;
+    }
+
+    for (const CASourceError& error : static_cast<CASourceBlockData*>(currentBlockUserData())->errors) {
+        int start = qMin(error.start, text.size() - 1);
+        for (int i = qMax(start, 0); i < qMin(start + qMax(error.length, 1), text.size()); i++) {
+            QTextCharFormat f = format(i);
+            f.setUnderlineStyle(QTextCharFormat::WaveUnderline);
+            f.setUnderlineColor(Qt::red);
+            setFormat(i, 1, f);
+        }
+    }
+}
+
+/*!
+	Returns True, if the errors of the \a block are up to date.
+*/
+bool CASourceHighlighter::isValidated(const QTextBlock& block)
+{
+    CASourceBlockData* data = static_cast<CASourceBlockData*>(block.userData());
+    QTextBlock previous = block.previous();
+    return data && data->revision == block.revision() && data->startState == (previous.isValid() ? previous.userState() : -1);
+}
+
+/*!
+	Starts validating the blocks changed since the last validation in the task scheduler. Only
+	a single job runs at a time, the blocks changed meanwhile are taken by the next one.
+*/
+void CASourceHighlighter::startParse()
+{
+    if (_job) {
+        return; // started again by finishParse()
+    }
+
+    QVector<CASourceBlock> blocks;
+    for (QTextBlock block = document()->begin(); block != document()->end(); block = block.next()) {
+        if (!isValidated(block)) {
+            QTextBlock previous = block.previous();
+            CASourceBlock b = { block.blockNumber(), block.revision(), (previous.isValid() ? previous.userState() : -1), block.text(), QVector<CASourceError>() };
+            blocks << b;
+        }
+    }
+
+    if (!blocks.isEmpty()) {
+        _job.reset(new CASourceParseJob(this, blocks));
+        CATaskScheduler::instance()->start(_job.get());
+    }
+}
+
+/*!
+	Stores the errors found by the parse job and underlines them. The blocks changed while the job
+	was running are skipped and validated by the next job.
+*/
+void CASourceHighlighter::finishParse()
+{
+    std::unique_ptr<CASourceParseJob> job(std::move(_job));
+    job->wait(); // the result is posted just before the job finishes
+
+    for (const CASourceBlock& b : job->blocks()) {
+        QTextBlock block = document()->findBlockByNumber(b.number);
+        QTextBlock previous = block.previous();
+        if (!block.isValid() || block.revision() != b.revision || (previous.isValid() ? previous.userState() : -1) != b.startState || block.text() != b.text) {
+            continue;
+        }
+
+        CASourceBlockData* data = static_cast<CASourceBlockData*>(block.userData());
+        if (!data) {
+            data = new CASourceBlockData();
+            block.setUserData(data);
+        }
+        data->revision = b.revision;
+        data->startState = b.startState;
+        data->errors = b.errors;
+
+        if (!b.errors.isEmpty()) {
+            rehighlightBlock(block); // the old errors were removed when the block changed
+        }
+    }
+
+    startParse();
+}
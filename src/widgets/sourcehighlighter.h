@@ -0,0 +1,82 @@
+/*!
+	Copyright (c) 2020, Matevž Jekovec, Canorus development team
+	All Rights Reserved. See AUTHORS for a complete list of authors.
+
+	Licensed under the GNU GENERAL PUBLIC LICENSE. See COPYING for details.
+*/
+
+#ifndef SOURCEHIGHLIGHTER_H_
+#define SOURCEHIGHLIGHTER_H_
+
+#include <QString>
+#include <QSyntaxHighlighter>
+#include <QTextBlock>
+#include <QTextCharFormat>
+#include <QTimer>
+#include <QVector>
+
+#include <memory>
+
+class CASourceParseJob;
+
+struct CASourceError {
+    int start; // column in the block
+    int length;
+    QString message;
+};
+
+class CASourceHighlighter : public QSyntaxHighlighter {
+    Q_OBJECT
+public:
+    enum CASourceSyntax {
+        LilyPond,
+        CanorusML
+    };
+
+    enum CASourceTokenType {
+        Comment,
+        String,
+        Keyword, // LilyPond command or CanorusML tag name
+        Attribute,
+        Bracket,
+        Number,
+        Entity
+    };
+
+    struct CASourceToken {
+        int start;
+        int length;
+        CASourceTokenType type;
+    };
+
+    CASourceHighlighter(QTextDocument* doc, CASourceSyntax syntax);
+    virtual ~CASourceHighlighter();
+
+    inline CASourceSyntax syntax() { return _syntax; }
+
+    QVector<CASourceError> errors(const QTextBlock& block);
+    QTextBlock firstError();
+
+    static int scan(CASourceSyntax syntax, const QString& text, int state, QVector<CASourceToken>* tokens, QVector<CASourceError>* errors);
+
+    static const int PARSE_DELAY;
+
+protected:
+    void highlightBlock(const QString& text);
+
+private slots:
+    void startParse();
+    void finishParse();
+
+private:
+    static int scanCanorusML(const QString& text, int state, QVector<CASourceToken>* tokens, QVector<CASourceError>* errors);
+    static int scanLilyPond(const QString& text, int state, QVector<CASourceToken>* tokens, QVector<CASourceError>* errors);
+    bool isValidated(const QTextBlock& block);
+
+    CASourceSyntax _syntax;
+    QTextCharFormat _formats[Entity + 1]; // for each token type
+    QTimer _parseTimer; // started by the highlighting of a changed block, collects the changes while typing
+    std::unique_ptr<CASourceParseJob> _job; // validates the dirty blocks in the task scheduler, one at a time
+};
+
+#endif /* SOURCEHIGHLIGHTER_H_ */
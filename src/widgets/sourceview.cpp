@@ -6,23 +6,30 @@
 */
 
 #include <QGridLayout>
+#include <QHelpEvent>
 #include <QMouseEvent>
 #include <QPushButton>
-#include <QTextEdit>
+#include <QTextCursor>
+#include <QTextDocument>
 #include <QTextStream>
+#include <QToolTip>
 
 #include "export/canorusmlexport.h"
 #include "score/document.h"
+#include "score/lyricscontext.h"
+#include "score/sheet.h"
+#include "score/staff.h"
 #include "score/voice.h"
+#include "widgets/sourcehighlighter.h"
 #include "widgets/sourceview.h"
 
 #include "export/lilypondexport.h"
 #include "import/lilypondimport.h"
 
-class CASourceView::CATextEdit : public QTextEdit {
+class CASourceView::CATextEdit : public QPlainTextEdit {
 public:
     CATextEdit(CASourceView* v)
-        : QTextEdit(v)
+        : QPlainTextEdit(v)
         , _view(v)
     {
     }
@@ -30,11 +37,31 @@ public:
 protected:
     void focusInEvent(QFocusEvent* event)
     {
-        QTextEdit::focusInEvent(event);
+        QPlainTextEdit::focusInEvent(event);
         QMouseEvent fake(QEvent::MouseButtonPress, QCursor::pos(), Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
         _view->mousePressEvent(&fake);
     }
 
+    bool viewportEvent(QEvent* event)
+    {
+        if (event->type() == QEvent::ToolTip) {
+            // show the error under the mouse
+            QHelpEvent* help = static_cast<QHelpEvent*>(event);
+            QTextCursor cursor = cursorForPosition(help->pos());
+            int column = cursor.positionInBlock();
+            for (const CASourceError& error : _view->_highlighter->errors(cursor.block())) {
+                if (column >= error.start && column <= error.start + qMax(error.length, 1)) {
+                    QToolTip::showText(help->globalPos(), error.message, this);
+                    return true;
+                }
+            }
+            QToolTip::hideText();
+            return true;
+        }
+
+        return QPlainTextEdit::viewportEvent(event);
+    }
+
 private:
     CASourceView* _view;
 };
@@ -46,6 +73,10 @@ private:
 	This widget is a view which shows in the main text area the syntax of the current score (or voice, staff).
 	It includes 2 buttons for committing the changes to the score and reverting any changes back from the score.
 
+	The source is highlighted and validated incrementally by CASourceHighlighter, so only the edited
+	lines are scanned again. The errors are underlined and shown as a tooltip. The changes are not
+	committed while the source contains known errors, the cursor is moved to the first one instead.
+
 	\sa CAScoreView
 */
 
@@ -62,6 +93,7 @@ CASourceView::CASourceView(CADocument* doc, QWidget* parent)
     _document = doc;
     _voice = nullptr;
     _lyricsContext = nullptr;
+    _generation = 0;
 
     setupUI();
 }
@@ -79,6 +111,7 @@ CASourceView::CASourceView(CAVoice* voice, QWidget* parent)
     _document = nullptr;
     _voice = voice;
     _lyricsContext = nullptr;
+    _generation = 0;
 
     setupUI();
 }
@@ -96,6 +129,7 @@ CASourceView::CASourceView(CALyricsContext* lc, QWidget* parent)
     _document = nullptr;
     _voice = nullptr;
     _lyricsContext = lc;
+    _generation = 0;
 
     setupUI();
 }
@@ -104,11 +138,12 @@ void CASourceView::setupUI()
 {
     _layout = new QGridLayout(this);
     _layout->addWidget(_textEdit = new CATextEdit(this));
+    _highlighter = new CASourceHighlighter(_textEdit->document(), (sourceViewType() == CanorusML ? CASourceHighlighter::CanorusML : CASourceHighlighter::LilyPond));
     _layout->addWidget(_commit = new QPushButton(tr("Commit changes")));
     _layout->addWidget(_revert = new QPushButton(tr("Revert changes")));
 
     connect(_commit, SIGNAL(clicked()), this, SLOT(on_commit_clicked()));
-    connect(_revert, SIGNAL(clicked()), this, SLOT(rebuild()));
+    connect(_revert, SIGNAL(clicked()), this, SLOT(on_revert_clicked()));
 
     rebuild();
 }
@@ -128,9 +163,24 @@ CASourceView::~CASourceView()
 
 void CASourceView::on_commit_clicked()
 {
+    QTextBlock error = _highlighter->firstError();
+    if (error.isValid()) {
+        QTextCursor cursor(error);
+        cursor.setPosition(error.position() + _highlighter->errors(error).first().start);
+        _textEdit->setTextCursor(cursor);
+        _textEdit->setFocus();
+        return;
+    }
+
     emit CACommit(_textEdit->toPlainText());
 }
 
+void CASourceView::on_revert_clicked()
+{
+    _generation = 0;
+    rebuild();
+}
+
 CASourceView* CASourceView::clone()
 {
     CASourceView* v = nullptr;
@@ -159,13 +209,20 @@ CASourceView* CASourceView::clone(QWidget* parent)
 
 /*!
 	Generates the score source from the current score and fill the text area with it.
+
+	The source is only generated if the document was changed since the last rebuild or the text was
+	edited by the user. Only the part of the text which differs from the new source is replaced, so
+	the text area keeps its cursor and scroll position and doesn't lay out the whole text again.
 */
 void CASourceView::rebuild()
 {
-    _textEdit->clear();
+    CADocument* doc = sourceDocument();
+    if (doc && _generation == doc->generation() && !_textEdit->document()->isModified()) {
+        return;
+    }
 
-    QString* value = new QString();
-    QTextStream stream(value);
+    QString value;
+    QTextStream stream(&value);
 
     // CanorusML
     if (document()) {
@@ -183,8 +240,55 @@ void CASourceView::rebuild()
             le.wait();
         }
     }
+    stream.flush();
+
+    updateText(value);
+    _generation = (doc ? doc->generation() : 0);
+}
 
-    _textEdit->insertPlainText(*value);
+/*!
+	Returns the document of the shown voice, lyrics context or the document itself.
+*/
+CADocument* CASourceView::sourceDocument()
+{
+    if (document()) {
+        return document();
+    } else if (voice() && voice()->staff() && voice()->staff()->sheet()) {
+        return voice()->staff()->sheet()->document();
+    } else if (lyricsContext() && lyricsContext()->sheet()) {
+        return lyricsContext()->sheet()->document();
+    }
+
+    return nullptr;
+}
+
+/*!
+	Replaces the text in the text area with the given \a source. The common beginning and end of the
+	old and the new text are kept.
+*/
+void CASourceView::updateText(const QString& source)
+{
+    QString old = _textEdit->toPlainText();
+
+    int prefix = 0;
+    int maxPrefix = qMin(old.size(), source.size());
+    while (prefix < maxPrefix && old[prefix] == source[prefix]) {
+        prefix++;
+    }
+
+    int suffix = 0;
+    int maxSuffix = maxPrefix - prefix;
+    while (suffix < maxSuffix && old[old.size() - suffix - 1] == source[source.size() - suffix - 1]) {
+        suffix++;
+    }
+
+    if (prefix != old.size() || prefix != source.size()) {
+        QTextCursor cursor(_textEdit->document());
+        cursor.setPosition(prefix);
+        cursor.setPosition(old.size() - suffix, QTextCursor::KeepAnchor);
+        cursor.insertText(source.mid(prefix, source.size() - prefix - suffix));
+    }
 
-    delete value;
+    _textEdit->document()->clearUndoRedoStacks();
+    _textEdit->document()->setModified(false);
 }
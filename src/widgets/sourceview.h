@@ -8,7 +8,7 @@
 #ifndef SOURCEVIEW_H_
 #define SOURCEVIEW_H_
 
-#include <QTextEdit>
+#include <QPlainTextEdit>
 
 #include "widgets/view.h"
 
@@ -18,6 +18,7 @@ class QGridLayout;
 class CADocument;
 class CAVoice;
 class CALyricsContext;
+class CASourceHighlighter;
 
 class CASourceView : public CAView {
     Q_OBJECT
@@ -42,9 +43,21 @@ public:
     inline CADocument* document() { return _document; }
     inline CAVoice* voice() { return _voice; }
     inline CALyricsContext* lyricsContext() { return _lyricsContext; }
-    inline void setDocument(CADocument* doc) { _document = doc; }
-    inline void setVoice(CAVoice* voice) { _voice = voice; }
-    inline void setLyricsContext(CALyricsContext* c) { _lyricsContext = c; }
+    inline void setDocument(CADocument* doc)
+    {
+        _document = doc;
+        _generation = 0;
+    }
+    inline void setVoice(CAVoice* voice)
+    {
+        _voice = voice;
+        _generation = 0;
+    }
+    inline void setLyricsContext(CALyricsContext* c)
+    {
+        _lyricsContext = c;
+        _generation = 0;
+    }
 
     inline void selectAll() { _textEdit->selectAll(); }
 signals:
@@ -55,9 +68,12 @@ public slots:
 
 private slots:
     void on_commit_clicked();
+    void on_revert_clicked();
 
 private:
     void setupUI();
+    CADocument* sourceDocument();
+    void updateText(const QString& source);
 
     class CATextEdit;
     friend class CASourceView::CATextEdit;
@@ -65,7 +81,8 @@ private:
     /////////////
     // Widgets //
     /////////////
-    QTextEdit* _textEdit;
+    QPlainTextEdit* _textEdit;
+    CASourceHighlighter* _highlighter; // owned by the text document
     QPushButton* _commit;
     QPushButton* _revert;
     QGridLayout* _layout;
@@ -77,6 +94,7 @@ private:
     CADocument* _document;
     CAVoice* _voice;
     CALyricsContext* _lyricsContext;
+    quint64 _generation; // generation of the document when the source was generated, 0 if none
 };
 
 #endif /* SOURCEVIEW_H_ */